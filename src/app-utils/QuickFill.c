@@ -32,11 +32,22 @@
 #include "gnc-ui-util.h"
 
 
+/* The child of a node for the strings continuing with the letter key */
+typedef struct
+{
+    guint key;
+    QuickFill *qf;
+} QuickFillMatch;
+
 struct _QuickFill
 {
-    char *text;          /* the first matching text string     */
-    int len;             /* number of chars in text string     */
-    GHashTable *matches; /* array of children in the tree      */
+    const char *text;        /* the first matching text string     */
+    int len;                 /* number of chars in text string     */
+    guint n_matches;         /* number of children in the tree     */
+    guint size;              /* allocated length of matches        */
+    QuickFillMatch *matches; /* the children, sorted by key        */
+    GStringChunk *strings;   /* the texts inserted through this node,
+                              * shared by all the nodes below it   */
 };
 
 
@@ -64,12 +75,7 @@ gnc_quickfill_new (void)
         return NULL;
     }
 
-    qf = g_new (QuickFill, 1);
-
-    qf->text = NULL;
-    qf->len = 0;
-
-    qf->matches = g_hash_table_new (g_direct_hash, g_direct_equal);
+    qf = g_new0 (QuickFill, 1);
 
     return qf;
 }
@@ -77,11 +83,17 @@ gnc_quickfill_new (void)
 /********************************************************************\
 \********************************************************************/
 
-static gboolean
-destroy_helper (gpointer key, gpointer value, gpointer data)
+static void
+destroy_matches (QuickFill *qf)
 {
-    gnc_quickfill_destroy (value);
-    return TRUE;
+    guint i;
+
+    for (i = 0; i < qf->n_matches; i++)
+        gnc_quickfill_destroy (qf->matches[i].qf);
+    g_free (qf->matches);
+    qf->matches = NULL;
+    qf->n_matches = 0;
+    qf->size = 0;
 }
 
 void
@@ -90,12 +102,11 @@ gnc_quickfill_destroy (QuickFill *qf)
     if (qf == NULL)
         return;
 
-    g_hash_table_foreach (qf->matches, (GHFunc)destroy_helper, NULL);
-    g_hash_table_destroy (qf->matches);
-    qf->matches = NULL;
+    destroy_matches (qf);
 
-    if (qf->text)
-        g_free(qf->text);
+    if (qf->strings)
+        g_string_chunk_free (qf->strings);
+    qf->strings = NULL;
     qf->text = NULL;
     qf->len = 0;
 
@@ -108,10 +119,10 @@ gnc_quickfill_purge (QuickFill *qf)
     if (qf == NULL)
         return;
 
-    g_hash_table_foreach_remove (qf->matches, destroy_helper, NULL);
+    destroy_matches (qf);
 
-    if (qf->text)
-        g_free (qf->text);
+    if (qf->strings)
+        g_string_chunk_clear (qf->strings);
     qf->text = NULL;
     qf->len = 0;
 }
@@ -131,6 +142,36 @@ gnc_quickfill_string (QuickFill *qf)
 /********************************************************************\
 \********************************************************************/
 
+/* Find the position of key among the children of qf, or where it
+ * would be inserted. */
+static guint
+match_position (const QuickFill *qf, guint key, gboolean *found)
+{
+    guint lo = 0, hi = qf->n_matches;
+
+    while (lo < hi)
+    {
+        guint mid = (lo + hi) / 2;
+
+        if (qf->matches[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *found = (lo < qf->n_matches && qf->matches[lo].key == key);
+    return lo;
+}
+
+static QuickFill *
+lookup_match (const QuickFill *qf, guint key)
+{
+    gboolean found;
+    guint pos = match_position (qf, key, &found);
+
+    return found ? qf->matches[pos].qf : NULL;
+}
+
 QuickFill *
 gnc_quickfill_get_char_match (QuickFill *qf, gunichar uc)
 {
@@ -140,7 +181,7 @@ gnc_quickfill_get_char_match (QuickFill *qf, gunichar uc)
 
     DEBUG ("xaccGetQuickFill(): index = %u\n", key);
 
-    return g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
+    return lookup_match (qf, key);
 }
 
 /********************************************************************\
@@ -187,14 +228,6 @@ gnc_quickfill_get_string_match (QuickFill *qf, const char *str)
 /********************************************************************\
 \********************************************************************/
 
-static void
-unique_len_helper (gpointer key, gpointer value, gpointer data)
-{
-    QuickFill **qf_p = data;
-
-    *qf_p = value;
-}
-
 QuickFill *
 gnc_quickfill_get_unique_len_match (QuickFill *qf, int *length)
 {
@@ -204,16 +237,9 @@ gnc_quickfill_get_unique_len_match (QuickFill *qf, int *length)
     if (qf == NULL)
         return NULL;
 
-    while (1)
+    while (qf->n_matches == 1)
     {
-        guint count;
-
-        count = g_hash_table_size (qf->matches);
-
-        if (count != 1)
-            break;
-
-        g_hash_table_foreach (qf->matches, unique_len_helper, &qf);
+        qf = qf->matches[0].qf;
 
         if (length != NULL)
             (*length)++;
@@ -229,27 +255,69 @@ void
 gnc_quickfill_insert (QuickFill *qf, const char *text, QuickFillSort sort)
 {
     gchar *normalized_str;
+    const char *stored_str;
     int len;
 
     if (NULL == qf) return;
     if (NULL == text) return;
 
+    /* The text is stored once for all of the nodes it goes through. */
+    if (qf->strings == NULL)
+        qf->strings = g_string_chunk_new (4096);
 
     normalized_str = g_utf8_normalize (text, -1, G_NORMALIZE_NFC);
-    len = g_utf8_strlen (text, -1);
-    quickfill_insert_recursive (qf, normalized_str, len, normalized_str, sort);
+    stored_str = g_string_chunk_insert_const (qf->strings, normalized_str);
     g_free (normalized_str);
+    len = g_utf8_strlen (text, -1);
+    quickfill_insert_recursive (qf, stored_str, len, stored_str, sort);
 }
 
 /********************************************************************\
 \********************************************************************/
 
+static QuickFill *
+add_match (QuickFill *qf, guint key)
+{
+    gboolean found;
+    guint pos = match_position (qf, key, &found);
+
+    if (found)
+        return qf->matches[pos].qf;
+
+    if (qf->n_matches == qf->size)
+    {
+        qf->size = qf->size ? 2 * qf->size : 1;
+        qf->matches = g_renew (QuickFillMatch, qf->matches, qf->size);
+    }
+    memmove (&qf->matches[pos + 1], &qf->matches[pos],
+             (qf->n_matches - pos) * sizeof (QuickFillMatch));
+    qf->n_matches++;
+
+    qf->matches[pos].key = key;
+    qf->matches[pos].qf = gnc_quickfill_new ();
+    return qf->matches[pos].qf;
+}
+
+static void
+remove_match (QuickFill *qf, guint key)
+{
+    gboolean found;
+    guint pos = match_position (qf, key, &found);
+
+    if (!found)
+        return;
+
+    qf->n_matches--;
+    memmove (&qf->matches[pos], &qf->matches[pos + 1],
+             (qf->n_matches - pos) * sizeof (QuickFillMatch));
+}
+
 static void
 quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
                             const char *next_char, QuickFillSort sort)
 {
     guint key;
-    char *old_text;
+    const char *old_text;
     QuickFill *match_qf;
     gunichar key_char_uc;
 
@@ -263,12 +331,7 @@ quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
     key_char_uc = g_utf8_get_char (next_char);
     key = g_unichar_toupper (key_char_uc);
 
-    match_qf = g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
-    if (match_qf == NULL)
-    {
-        match_qf = gnc_quickfill_new ();
-        g_hash_table_insert (qf->matches, GUINT_TO_POINTER (key), match_qf);
-    }
+    match_qf = add_match (qf, key);
 
     old_text = match_qf->text;
 
@@ -284,7 +347,7 @@ quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
         /* If there's no string there already, just put the new one in. */
         if (old_text == NULL)
         {
-            match_qf->text = g_strdup(text);
+            match_qf->text = text;
             match_qf->len = len;
             break;
         }
@@ -294,8 +357,7 @@ quickfill_insert_recursive (QuickFill *qf, const char *text, int len,
                 (strncmp(text, old_text, strlen(old_text)) == 0))
             break;
 
-        g_free(old_text);
-        match_qf->text = g_strdup(text);
+        match_qf->text = text;
         match_qf->len = len;
         break;
     }
@@ -322,45 +384,39 @@ gnc_quickfill_remove (QuickFill *qf, const gchar *text, QuickFillSort sort)
 /********************************************************************\
 \********************************************************************/
 
-struct _BestText
-{
-    gchar *text;
-    QuickFillSort sort;
-};
-
-static void
-best_text_helper (gpointer key, gpointer value, gpointer user_data)
+/* Find another text to show for qf among its children, the first in
+ * collation order. We do not track history, so this is done for
+ * QUICKFILL_LIFO as well. */
+static const gchar *
+best_child_text (const QuickFill *qf)
 {
-    QuickFill *qf = value;
-    struct _BestText *best = user_data;
+    const gchar *best = NULL;
+    guint i;
 
-    if (best->text == NULL)
+    for (i = 0; i < qf->n_matches; i++)
     {
-        /* start with the first text */
-        best->text = qf->text;
+        const gchar *text = qf->matches[i].qf->text;
 
+        if (best == NULL)
+        {
+            /* start with the first text */
+            best = text;
+        }
+        else if (g_utf8_collate (text, best) < 0)
+        {
+            /* even better text */
+            best = text;
+        }
     }
-    else if (best->text == QUICKFILL_LIFO)
-    {
-        /* we do not track history, so ignore it */
-        return;
-
-    }
-    else if (g_utf8_collate (qf->text, best->text) < 0)
-    {
-        /* even better text */
-        best->text = qf->text;
-    }
+    return best;
 }
 
-
-
 static void
 gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
                                 QuickFillSort sort)
 {
     QuickFill *match_qf;
-    gchar *child_text;
+    const gchar *child_text;
     gint child_len;
 
     child_text = NULL;
@@ -378,7 +434,7 @@ gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
         key_char_uc = g_utf8_get_char (key_char);
         key = g_unichar_toupper (key_char_uc);
 
-        match_qf = g_hash_table_lookup (qf->matches, GUINT_TO_POINTER (key));
+        match_qf = lookup_match (qf, key);
         if (match_qf)
         {
             /* remove text from child qf */
@@ -387,7 +443,7 @@ gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
             if (match_qf->text == NULL)
             {
                 /* text was the only word with a prefix up to match_qf */
-                g_hash_table_remove (qf->matches, GUINT_TO_POINTER (key));
+                remove_match (qf, key);
                 gnc_quickfill_destroy (match_qf);
 
             }
@@ -407,7 +463,7 @@ gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
     {
         /* the currently best text is about to be removed */
 
-        gchar *best_text = NULL;
+        const gchar *best_text = NULL;
         gint best_len = 0;
 
         if (child_text != NULL)
@@ -419,31 +475,15 @@ gnc_quickfill_remove_recursive (QuickFill *qf, const gchar *text, gint depth,
         }
         else
         {
-            if (g_hash_table_size (qf->matches) != 0)
-            {
-                /* otherwise search for another good text */
-                struct _BestText bts;
-                bts.text = NULL;
-                bts.sort = sort;
-
-                g_hash_table_foreach (qf->matches, (GHFunc) best_text_helper, &bts);
-                best_text = bts.text;
-                best_len = (best_text == NULL) ? 0 : g_utf8_strlen (best_text, -1);
-            }
+            /* otherwise search for another good text */
+            best_text = best_child_text (qf);
+            best_len = (best_text == NULL) ? 0 : g_utf8_strlen (best_text, -1);
         }
 
-        /* now replace or clear text */
-        g_free(qf->text);
-        if (best_text != NULL)
-        {
-            qf->text = g_strdup(best_text);
-            qf->len = best_len;
-        }
-        else
-        {
-            qf->text = NULL;
-            qf->len = 0;
-        }
+        /* now replace or clear text; the texts stay in the string
+         * chunk until the tree is purged or destroyed */
+        qf->text = best_text;
+        qf->len = best_len;
     }
 }
 
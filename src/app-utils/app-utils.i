@@ -34,6 +34,7 @@
 #include <gnc-component-manager.h>
 #include <guile-util.h>
 #include <app-utils/gnc-sx-instance-model.h>
+#include <gnc-qif-formats.h>
 
 #include "engine-helpers-guile.h"
 %}
@@ -173,4 +174,42 @@ time64 gnc_parse_time_to_time64(const gchar *s, const gchar *format);
 }
 GHashTable* gnc_sx_all_instantiate_cashflow_all(GDate range_start, GDate range_end);
 %clear GHashTable *;
+
+%ignore gnc_qif_parse_date;
+%include <gnc-qif-formats.h>
+
+%inline %{
+/* gnc_qif_parse_date for qif-parse.scm: a list of the day, month and
+ * year, or #f. */
+static SCM
+gnc_qif_parse_date_list (const gchar *date_str, GncQifDateFormat format)
+{
+  gint day, month, year;
+
+  if (!gnc_qif_parse_date (date_str, format, &day, &month, &year))
+    return SCM_BOOL_F;
+  return scm_list_3 (scm_from_int (day), scm_from_int (month),
+                     scm_from_int (year));
+}
+%}
+
+%init {
+  {
+    char tmp[100];
+
+#define SET_ENUM(e) snprintf(tmp, 100, "(set! %s (%s))", (e), (e));  \
+    scm_c_eval_string(tmp);
+
+    SET_ENUM("GNC-QIF-DATE-M-D-Y");
+    SET_ENUM("GNC-QIF-DATE-D-M-Y");
+    SET_ENUM("GNC-QIF-DATE-Y-M-D");
+    SET_ENUM("GNC-QIF-DATE-Y-D-M");
+
+    SET_ENUM("GNC-QIF-NUMBER-DECIMAL");
+    SET_ENUM("GNC-QIF-NUMBER-COMMA");
+    SET_ENUM("GNC-QIF-NUMBER-INTEGER");
+
+#undef SET_ENUM
+  }
+}
 #endif
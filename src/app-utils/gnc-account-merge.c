@@ -46,13 +46,50 @@ determine_merge_disposition(Account *existing_root, Account *new_acct)
     return determine_account_merge_disposition(existing_acct, new_acct);
 }
 
+void
+gnc_account_merge_child_map_add(GHashTable *map, Account *acct)
+{
+    const char *name = xaccAccountGetName(acct);
+
+    if (name && !g_hash_table_lookup(map, name))
+        g_hash_table_insert(map, g_strdup(name), acct);
+}
+
+GHashTable *
+gnc_account_merge_child_map(Account *parent)
+{
+    GHashTable *map;
+    GList *children, *node;
+
+    map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    children = gnc_account_get_children(parent);
+    for (node = children; node; node = g_list_next(node))
+        gnc_account_merge_child_map_add(map, (Account*)node->data);
+    g_list_free(children);
+
+    return map;
+}
+
+Account *
+gnc_account_merge_lookup(GHashTable *map, Account *parent, const char *name)
+{
+    Account *acct = g_hash_table_lookup(map, name);
+
+    if (!acct)
+        acct = gnc_account_lookup_by_name(parent, name);
+    return acct;
+}
+
 void
 account_trees_merge(Account *existing_root, Account *new_accts_root)
 {
     GList *accounts, *node;
+    GHashTable *existing_children;
     g_return_if_fail(new_accts_root != NULL);
     g_return_if_fail(existing_root != NULL);
 
+    existing_children = gnc_account_merge_child_map(existing_root);
+
     /* since we're have a chance of mutating the list (via
      * gnc_account_add_child) while we're iterating over it, iterate
      * over a copy. */
@@ -64,7 +101,8 @@ account_trees_merge(Account *existing_root, Account *new_accts_root)
 
         new_acct = (Account*)node->data;
         name = xaccAccountGetName(new_acct);
-        existing_named = gnc_account_lookup_by_name(existing_root, name);
+        existing_named = gnc_account_merge_lookup(existing_children,
+                         existing_root, name);
         switch (determine_account_merge_disposition(existing_named, new_acct))
         {
         case GNC_ACCOUNT_MERGE_DISPOSITION_USE_EXISTING:
@@ -74,8 +112,10 @@ account_trees_merge(Account *existing_root, Account *new_accts_root)
         case GNC_ACCOUNT_MERGE_DISPOSITION_CREATE_NEW:
             /* merge this one in. */
             gnc_account_append_child(existing_root, new_acct);
+            gnc_account_merge_child_map_add(existing_children, new_acct);
             break;
         }
     }
     g_list_free(accounts);
+    g_hash_table_destroy(existing_children);
 }
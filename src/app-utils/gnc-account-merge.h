@@ -39,6 +39,18 @@ typedef struct _merge_error
 GncAccountMergeDisposition determine_account_merge_disposition(Account *existing_acct, Account *new_acct);
 GncAccountMergeDisposition determine_merge_disposition(Account *existing_root, Account *new_acct);
 
+/** Map the names of parent's children to the children, so that a merge
+ * looks each name up once per level instead of searching the tree.
+ * Where siblings share a name the first one is kept.  Free the map with
+ * g_hash_table_destroy(). */
+GHashTable *gnc_account_merge_child_map(Account *parent);
+/** Add acct, just appended to the map's parent, unless its name is taken. */
+void gnc_account_merge_child_map_add(GHashTable *map, Account *acct);
+/** Find name among the children in map, or failing that anywhere below
+ * parent as gnc_account_lookup_by_name() does. */
+Account *gnc_account_merge_lookup(GHashTable *map, Account *parent,
+                                  const char *name);
+
 void account_trees_merge(Account *existing_root, Account *new_accts_root);
 
 #endif /* GNC_ACCOUNT_MERGE_H */
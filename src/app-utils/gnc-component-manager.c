@@ -36,6 +36,14 @@ typedef struct
     QofEventId event_mask;
 } EntityTypeEventInfo;
 
+/* The values of the GncGUID --> EventInfo hashes. entity_type is only
+ * known for changes, and is NULL in watches. */
+typedef struct
+{
+    EventInfo info;
+    QofIdTypeConst entity_type;
+} ChangeInfo;
+
 typedef struct
 {
     GHashTable * event_masks;
@@ -47,6 +55,7 @@ typedef struct
 typedef struct
 {
     GNCComponentRefreshHandler refresh_handler;
+    GNCComponentDeltaHandler delta_handler;
     GNCComponentCloseHandler close_handler;
     gpointer user_data;
 
@@ -179,7 +188,7 @@ clear_event_info (ComponentEventInfo *cei)
 
 static void
 add_event (ComponentEventInfo *cei, const GncGUID *entity,
-           QofEventId event_mask, gboolean or_in)
+           QofIdTypeConst entity_type, QofEventId event_mask, gboolean or_in)
 {
     GHashTable *hash;
 
@@ -211,11 +220,14 @@ add_event (ComponentEventInfo *cei, const GncGUID *entity,
         if (ei == NULL)
         {
             GncGUID *key;
+            ChangeInfo *ci;
 
             key = guid_malloc ();
             *key = *entity;
 
-            ei = g_new (EventInfo, 1);
+            ci = g_new (ChangeInfo, 1);
+            ci->entity_type = entity_type;
+            ei = &ci->info;
             ei->event_mask = 0;
 
             g_hash_table_insert (hash, key, ei);
@@ -265,7 +277,7 @@ gnc_cm_event_handler (QofInstance *entity,
     fprintf (stderr, "event_handler: event %d, entity %p, guid %s\n", event_type,
              entity, guidstr);
 #endif
-    add_event (&changes, guid, event_type, TRUE);
+    add_event (&changes, guid, entity->e_type, event_type, TRUE);
 
     if (QOF_CHECK_TYPE(entity, GNC_ID_SPLIT))
     {
@@ -448,6 +460,31 @@ gnc_register_gui_component (const char *component_class,
     return ci->component_id;
 }
 
+gint
+gnc_register_gui_component_delta (const char *component_class,
+                                  GNCComponentDeltaHandler delta_handler,
+                                  GNCComponentCloseHandler close_handler,
+                                  gpointer user_data)
+{
+    ComponentInfo *ci;
+
+    /* sanity check */
+    if (!component_class)
+    {
+        PERR ("no class specified");
+        return NO_COMPONENT;
+    }
+
+    ci = gnc_register_gui_component_internal (component_class);
+    g_return_val_if_fail (ci, NO_COMPONENT);
+
+    ci->delta_handler = delta_handler;
+    ci->close_handler = close_handler;
+    ci->user_data = user_data;
+
+    return ci->component_id;
+}
+
 void
 gnc_gui_component_watch_entity (gint component_id,
                                 const GncGUID *entity,
@@ -465,7 +502,7 @@ gnc_gui_component_watch_entity (gint component_id,
         return;
     }
 
-    add_event (&ci->watch_info, entity, event_mask, FALSE);
+    add_event (&ci->watch_info, entity, NULL, event_mask, FALSE);
 }
 
 void
@@ -662,6 +699,57 @@ changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
     return big_cei->match;
 }
 
+/* Collect the changes which match the watches in cei. The whole event mask
+ * of each matching entity is reported, not just the part that matched. */
+static GArray *
+changes_delta (ComponentEventInfo *cei, ComponentEventInfo *changes)
+{
+    GArray *delta = g_array_new (FALSE, FALSE, sizeof (GncComponentChange));
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, changes->entity_events);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        ChangeInfo *change = value;
+        QofEventId mask = change->info.event_mask;
+        EventInfo *ei;
+        QofEventId *et;
+        gboolean match = FALSE;
+
+        ei = g_hash_table_lookup (cei->entity_events, key);
+        if (ei && (ei->event_mask & mask))
+            match = TRUE;
+
+        if (!match && change->entity_type)
+        {
+            et = g_hash_table_lookup (cei->event_masks, change->entity_type);
+            if (et && (*et & mask))
+                match = TRUE;
+
+            /* As in gnc_cm_event_handler, split events count as a
+             * transaction modify. */
+            else if (!g_strcmp0 (change->entity_type, GNC_ID_SPLIT))
+            {
+                et = g_hash_table_lookup (cei->event_masks, GNC_ID_TRANS);
+                match = et && (*et & QOF_EVENT_MODIFY);
+            }
+        }
+
+        if (match)
+        {
+            GncComponentChange cc;
+
+            cc.guid = *(GncGUID *) key;
+            cc.entity_type = change->entity_type;
+            cc.event_mask = mask;
+            g_array_append_val (delta, cc);
+        }
+    }
+
+    return delta;
+}
+
 static void
 gnc_gui_refresh_internal (gboolean force)
 {
@@ -698,7 +786,7 @@ gnc_gui_refresh_internal (gboolean force)
         if (!ci)
             continue;
 
-        if (!ci->refresh_handler)
+        if (!ci->refresh_handler && !ci->delta_handler)
         {
 #if CM_DEBUG
             fprintf (stderr, "no handlers for %s:%d\n", ci->component_class, ci->component_id);
@@ -706,7 +794,27 @@ gnc_gui_refresh_internal (gboolean force)
             continue;
         }
 
-        if (force)
+        if (ci->delta_handler)
+        {
+            if (force)
+                ci->delta_handler (NULL, 0, ci->user_data);
+            else
+            {
+                GArray *delta = changes_delta (&ci->watch_info,
+                                               &changes_backup);
+                if (delta->len)
+                {
+#if CM_DEBUG
+                    fprintf (stderr, "calling %s:%d delta handler with %u changes\n",
+                             ci->component_class, ci->component_id, delta->len);
+#endif
+                    ci->delta_handler ((GncComponentChange *) delta->data,
+                                       delta->len, ci->user_data);
+                }
+                g_array_free (delta, TRUE);
+            }
+        }
+        else if (force)
         {
             if (ci->refresh_handler)
             {
@@ -72,6 +72,40 @@ typedef struct
 typedef void (*GNCComponentRefreshHandler) (GHashTable *changes,
         gpointer user_data);
 
+/* GncComponentChange
+ *   One entity that changed since the last refresh.
+ *
+ * guid:        the GncGUID of the entity, which may not exist anymore
+ * entity_type: the type of the entity
+ * event_mask:  all of the events the entity generated
+ */
+typedef struct
+{
+    GncGUID guid;
+    QofIdTypeConst entity_type;
+    QofEventId event_mask;
+} GncComponentChange;
+
+/* GNCComponentDeltaHandler
+ *   Handler invoked instead of a GNCComponentRefreshHandler for
+ *   components registered with gnc_register_gui_component_delta.
+ *
+ * changes:   if NULL, the component should perform a full refresh.
+ *
+ *            if non-NULL, the entities whose events match the
+ *            component's watches, either by GncGUID or by type.
+ *            The handler is not invoked when there are none, so
+ *            components can update just what the changed entities
+ *            affect. The array must not be changed.
+ *
+ * n_changes: the number of entries in changes.
+ *
+ * user_data: user_data supplied when component was registered.
+ */
+typedef void (*GNCComponentDeltaHandler) (const GncComponentChange *changes,
+        guint n_changes,
+        gpointer user_data);
+
 /* GNCComponentCloseHandler
  *   Handler invoked to close the component.
  *
@@ -151,6 +185,18 @@ gint gnc_register_gui_component (const char *component_class,
                                  GNCComponentCloseHandler close_handler,
                                  gpointer user_data);
 
+/* gnc_register_gui_component_delta
+ *   Register a GUI component which is told exactly which watched
+ *   entities changed, see GNCComponentDeltaHandler.
+ *
+ *   The arguments and return value are as for
+ *   gnc_register_gui_component.
+ */
+gint gnc_register_gui_component_delta (const char *component_class,
+                                       GNCComponentDeltaHandler delta_handler,
+                                       GNCComponentCloseHandler close_handler,
+                                       gpointer user_data);
+
 /* gnc_gui_component_set_session
  *   Set the associated session of this component
  *
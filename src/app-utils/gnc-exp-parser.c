@@ -48,6 +48,34 @@ typedef struct ParserNum
     gnc_numeric value;
 } ParserNum;
 
+typedef enum
+{
+    EXP_NODE_NUMBER,
+    EXP_NODE_VARIABLE,
+    EXP_NODE_NEGATE,
+    EXP_NODE_OPERATOR
+} ExpNodeType;
+
+/* A node of a compiled expression. The compiling parser hands these
+ * around in place of ParserNums. */
+typedef struct ExpNode
+{
+    ExpNodeType type;
+    char op;                /* EXP_NODE_OPERATOR */
+    gnc_numeric value;      /* EXP_NODE_NUMBER */
+    guint slot;             /* EXP_NODE_VARIABLE */
+    struct ExpNode *left;   /* EXP_NODE_NEGATE, EXP_NODE_OPERATOR */
+    struct ExpNode *right;  /* EXP_NODE_OPERATOR */
+} ExpNode;
+
+struct GncExpProgram
+{
+    ExpNode *root;
+    GPtrArray *nodes;       /* All of the nodes, which the program owns */
+    GPtrArray *var_names;   /* The variable names, by slot */
+    gboolean unsupported;   /* Set while compiling */
+};
+
 
 /** Static Globals *************************************************/
 static GHashTable   *variable_bindings = NULL;
@@ -55,6 +83,14 @@ static ParseError    last_error        = PARSER_NO_ERROR;
 static GNCParseError last_gncp_error   = NO_ERR;
 static gboolean      parser_inited     = FALSE;
 
+/* Expression string -> GncExpProgram, or NULL if it can't be compiled */
+static GHashTable   *compiled_expressions = NULL;
+static GncExpProgram *compiling_program   = NULL;
+
+/* The compiled expressions kept by gnc_exp_parser_parse_separate_vars
+ * before the cache is emptied. */
+#define COMPILED_EXPRESSIONS_MAX 256
+
 
 /** Implementations ************************************************/
 
@@ -151,6 +187,12 @@ gnc_exp_parser_shutdown (void)
     g_hash_table_destroy (variable_bindings);
     variable_bindings = NULL;
 
+    if (compiled_expressions)
+    {
+        g_hash_table_destroy (compiled_expressions);
+        compiled_expressions = NULL;
+    }
+
     last_error = PARSER_NO_ERROR;
     last_gncp_error = NO_ERR;
 
@@ -449,6 +491,321 @@ gnc_ep_tmpvarhash_clean( gpointer key, gpointer value, gpointer user_data )
     }
 }
 
+static ExpNode *
+compile_new_node (ExpNodeType type)
+{
+    ExpNode *node = g_new0 (ExpNode, 1);
+
+    node->type = type;
+    g_ptr_array_add (compiling_program->nodes, node);
+    return node;
+}
+
+static void *
+compile_trans_numeric (const char *digit_str,
+                       gchar      *radix_point,
+                       gchar      *group_char,
+                       char      **rstr)
+{
+    ExpNode *node;
+    gnc_numeric value;
+
+    if (digit_str == NULL)
+        return NULL;
+
+    /* The parser creates each variable, in order, by asking for the
+     * value of "0" without a place to return the rest of the string. */
+    if (rstr == NULL)
+    {
+        node = compile_new_node (EXP_NODE_VARIABLE);
+        node->slot = compiling_program->var_names->len;
+        g_ptr_array_add (compiling_program->var_names, NULL);
+        return node;
+    }
+
+    if (!xaccParseAmount (digit_str, TRUE, &value, rstr))
+        return NULL;
+
+    node = compile_new_node (EXP_NODE_NUMBER);
+    node->value = value;
+    return node;
+}
+
+static void *
+compile_numeric_ops (char op_sym, void *left_value, void *right_value)
+{
+    ExpNode *node;
+
+    if ((left_value == NULL) || (right_value == NULL))
+        return NULL;
+
+    /* Assignments change variables, which programs don't. */
+    if (op_sym == ASN_OP)
+    {
+        compiling_program->unsupported = TRUE;
+        return left_value;
+    }
+
+    node = compile_new_node (EXP_NODE_OPERATOR);
+    node->op = op_sym;
+    node->left = left_value;
+    node->right = right_value;
+    return node;
+}
+
+static void *
+compile_negate_numeric (void *value)
+{
+    ExpNode *node = value;
+    ExpNode *copy;
+
+    if (value == NULL)
+        return NULL;
+
+    /* The parser negates values in place, so the node itself becomes
+     * the negation of a copy of what it was. */
+    copy = compile_new_node (node->type);
+    *copy = *node;
+    node->type = EXP_NODE_NEGATE;
+    node->left = copy;
+    node->right = NULL;
+
+    return node;
+}
+
+static void
+compile_free_numeric (void *value)
+{
+    /* The nodes belong to the program. */
+}
+
+static void *
+compile_func_op (const char *fname, int argc, void **argv)
+{
+    int i;
+
+    /* Functions are evaluated by guile, and may not return the same
+     * thing twice, so expressions calling them are always parsed. */
+    compiling_program->unsupported = TRUE;
+
+    for (i = 0; i < argc; i++)
+    {
+        var_store *vs = argv[i];
+        if (vs->type == VST_STRING)
+        {
+            g_free (vs->value);
+            vs->value = NULL;
+        }
+    }
+
+    return compile_new_node (EXP_NODE_NUMBER);
+}
+
+GncExpProgram *
+gnc_exp_parser_compile (const char *expression, char **error_loc_p)
+{
+    GncExpProgram *prog;
+    parser_env_ptr pe;
+    var_store_ptr vars;
+    struct lconv *lc;
+    var_store result;
+    char *error_loc;
+
+    if (expression == NULL)
+        return NULL;
+
+    if (!parser_inited)
+        gnc_exp_parser_real_init (FALSE);
+
+    prog = g_new0 (GncExpProgram, 1);
+    prog->nodes = g_ptr_array_new_with_free_func (g_free);
+    prog->var_names = g_ptr_array_new_with_free_func (g_free);
+
+    result.variable_name = NULL;
+    result.value = NULL;
+    result.next_var = NULL;
+
+    lc = gnc_localeconv ();
+
+    pe = init_parser (NULL, lc->mon_decimal_point, lc->mon_thousands_sep,
+                      compile_trans_numeric, compile_numeric_ops,
+                      compile_negate_numeric, compile_free_numeric,
+                      compile_func_op);
+
+    compiling_program = prog;
+    error_loc = parse_string (&result, expression, pe);
+    compiling_program = NULL;
+
+    if (error_loc_p != NULL)
+        *error_loc_p = error_loc;
+    last_error = error_loc ? get_parse_error (pe) : PARSER_NO_ERROR;
+
+    if (error_loc == NULL)
+    {
+        prog->root = result.value;
+
+        for (vars = parser_get_vars (pe); vars; vars = vars->next_var)
+            if (vars->assign_flag == ASSIGNED_TO)
+                prog->unsupported = TRUE;
+
+        /* Name the variable slots; the parser keeps its variables in
+         * the order it created them. */
+        if (!prog->unsupported)
+            for (vars = parser_get_vars (pe); vars; vars = vars->next_var)
+            {
+                ExpNode *node = vars->value;
+
+                while (node->type == EXP_NODE_NEGATE)
+                    node = node->left;
+                g_ptr_array_index (prog->var_names, node->slot) =
+                    g_strdup (vars->variable_name);
+            }
+    }
+
+    exit_parser (pe);
+
+    if (error_loc != NULL || prog->unsupported)
+    {
+        gnc_exp_program_free (prog);
+        return NULL;
+    }
+
+    return prog;
+}
+
+void
+gnc_exp_program_free (GncExpProgram *prog)
+{
+    if (prog == NULL)
+        return;
+
+    g_ptr_array_free (prog->nodes, TRUE);
+    g_ptr_array_free (prog->var_names, TRUE);
+    g_free (prog);
+}
+
+guint
+gnc_exp_program_get_num_variables (const GncExpProgram *prog)
+{
+    g_return_val_if_fail (prog, 0);
+
+    return prog->var_names->len;
+}
+
+const char *
+gnc_exp_program_get_variable_name (const GncExpProgram *prog, guint slot)
+{
+    g_return_val_if_fail (prog, NULL);
+    g_return_val_if_fail (slot < prog->var_names->len, NULL);
+
+    return g_ptr_array_index (prog->var_names, slot);
+}
+
+static gnc_numeric
+program_eval_node (const ExpNode *node, const gnc_numeric *values)
+{
+    gnc_numeric left, right;
+
+    switch (node->type)
+    {
+    case EXP_NODE_NUMBER:
+        return node->value;
+    case EXP_NODE_VARIABLE:
+        return values[node->slot];
+    case EXP_NODE_NEGATE:
+        return gnc_numeric_neg (program_eval_node (node->left, values));
+    case EXP_NODE_OPERATOR:
+        break;
+    }
+
+    left = program_eval_node (node->left, values);
+    right = program_eval_node (node->right, values);
+
+    /* The same arithmetic as numeric_ops */
+    switch (node->op)
+    {
+    case ADD_OP:
+        return gnc_numeric_add (left, right,
+                                GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    case SUB_OP:
+        return gnc_numeric_sub (left, right,
+                                GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    case DIV_OP:
+        return gnc_numeric_div (left, right,
+                                GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    case MUL_OP:
+        return gnc_numeric_mul (left, right,
+                                GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    }
+
+    return gnc_numeric_error (GNC_ERROR_ARG);
+}
+
+gboolean
+gnc_exp_program_evaluate (const GncExpProgram *prog,
+                          const gnc_numeric *values, gnc_numeric *value_p)
+{
+    gnc_numeric value;
+
+    g_return_val_if_fail (prog, FALSE);
+
+    value = program_eval_node (prog->root, values);
+    if (gnc_numeric_check (value))
+    {
+        last_error = NUMERIC_ERROR;
+        return FALSE;
+    }
+
+    if (value_p)
+        *value_p = gnc_numeric_reduce (value);
+
+    last_error = PARSER_NO_ERROR;
+    return TRUE;
+}
+
+/* Evaluate a compiled expression the way parsing it with
+ * gnc_exp_parser_parse_separate_vars would: variables are looked up in
+ * varHash, then in the parser's own bindings, and any others are added
+ * to varHash with a value of zero. */
+static gboolean
+evaluate_with_var_hash (const GncExpProgram *prog, const char *expression,
+                        gnc_numeric *value_p, char **error_loc_p,
+                        GHashTable *varHash)
+{
+    guint i, n_vars = gnc_exp_program_get_num_variables (prog);
+    gnc_numeric *values = g_newa (gnc_numeric, n_vars + 1);
+    gboolean ok;
+
+    for (i = 0; i < n_vars; i++)
+    {
+        const char *name = gnc_exp_program_get_variable_name (prog, i);
+        gpointer value;
+        ParserNum *pnum;
+
+        if (g_hash_table_lookup_extended (varHash, name, NULL, &value))
+        {
+            values[i].num = values[i].denom = 0;
+            if (value != NULL)
+                values[i] = *(gnc_numeric*)value;
+        }
+        else if ((pnum = g_hash_table_lookup (variable_bindings, name)))
+            values[i] = pnum->value;
+        else
+        {
+            gnc_numeric *zero = g_new0 (gnc_numeric, 1);
+
+            *zero = values[i] = gnc_numeric_zero ();
+            g_hash_table_insert (varHash, g_strdup (name), zero);
+        }
+    }
+
+    ok = gnc_exp_program_evaluate (prog, values, value_p);
+    if (error_loc_p != NULL)
+        *error_loc_p = ok ? NULL : (char *) expression;
+
+    return ok;
+}
+
 gboolean
 gnc_exp_parser_parse( const char * expression, gnc_numeric *value_p,
                       char **error_loc_p )
@@ -501,6 +858,34 @@ gnc_exp_parser_parse_separate_vars (const char * expression,
     if (!parser_inited)
         gnc_exp_parser_real_init ( (varHash == NULL) );
 
+    /* Expressions that only read variables are compiled once and then
+     * evaluated from the program. */
+    if (varHash != NULL)
+    {
+        GncExpProgram *prog;
+
+        if (!compiled_expressions)
+            compiled_expressions =
+                g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify) gnc_exp_program_free);
+
+        if (!g_hash_table_lookup_extended (compiled_expressions, expression,
+                                           NULL, (gpointer *) &prog))
+        {
+            if (g_hash_table_size (compiled_expressions) >=
+                    COMPILED_EXPRESSIONS_MAX)
+                g_hash_table_remove_all (compiled_expressions);
+
+            prog = gnc_exp_parser_compile (expression, NULL);
+            g_hash_table_insert (compiled_expressions,
+                                 g_strdup (expression), prog);
+        }
+
+        if (prog)
+            return evaluate_with_var_hash (prog, expression, value_p,
+                                           error_loc_p, varHash);
+    }
+
     result.variable_name = NULL;
     result.value = NULL;
     result.next_var = NULL;
@@ -75,7 +75,8 @@ gboolean gnc_exp_parser_parse (const char * expression,
  * Parses as per gnc_exp_parser_parse, but with an optional last argument
  * dealing with a non-shared variable list and state, local to the expression
  * being parsed.  This is a hashTable of variable names mapping to
- * gnc_numeric pointers.
+ * gnc_numeric pointers. When it is given, expressions that can be
+ * compiled are kept compiled, and only evaluated on later calls.
  *
  * @note It is the CALLER'S RESPONSIBILITY to g_free() both the keys and
  * values of varHash when done.
@@ -85,6 +86,42 @@ gboolean gnc_exp_parser_parse_separate_vars (const char * expression,
         char **error_loc_p,
         GHashTable *varHash );
 
+/** A compiled expression, which can be evaluated repeatedly with
+ *  different variable values without parsing it again. */
+typedef struct GncExpProgram GncExpProgram;
+
+/**
+ * Compile the expression into a program. The variables it uses are
+ * numbered in the order they first appear, and their values are given
+ * by that number when the program is evaluated.
+ *
+ * Returns NULL if the expression can't be parsed, in which case
+ * error_loc_p and gnc_exp_parser_error_string() are set as by
+ * gnc_exp_parser_parse(). Expressions that assign to variables or call
+ * functions are not compiled either, and also return NULL; they must
+ * be parsed every time.
+ **/
+GncExpProgram * gnc_exp_parser_compile (const char *expression,
+                                        char **error_loc_p);
+
+/* Free a program returned by gnc_exp_parser_compile. */
+void gnc_exp_program_free (GncExpProgram *prog);
+
+/* Return the number of variables the program uses. */
+guint gnc_exp_program_get_num_variables (const GncExpProgram *prog);
+
+/* Return the name of the variable with the given number. */
+const char * gnc_exp_program_get_variable_name (const GncExpProgram *prog,
+        guint slot);
+
+/* Evaluate the program with values[i] as the value of variable i. On
+ * success, return TRUE and set *value_p if value_p is non-NULL.
+ * Otherwise return FALSE; gnc_exp_parser_error_string() describes the
+ * problem. */
+gboolean gnc_exp_program_evaluate (const GncExpProgram *prog,
+                                   const gnc_numeric *values,
+                                   gnc_numeric *value_p);
+
 /* If the last parse returned FALSE, return an error string describing
  * the problem. Otherwise, return NULL. */
 const char * gnc_exp_parser_error_string (void);
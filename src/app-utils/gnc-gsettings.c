@@ -59,44 +59,119 @@ static QofLogModule log_module = "gnc.app-utils.gsettings";
 /************************************************************/
 /*               Internal helper functions                  */
 /************************************************************/
-static gboolean gnc_gsettings_is_valid_key(GSettings *settings, const gchar *key)
+
+/* Each GSettings object carries the set of its keys, made when it is
+ * created, and the values read through it so far.  The preferences are
+ * read many times for every redraw of a register, so the values are
+ * kept until the "changed" signal says otherwise. */
+static GQuark keys_quark = 0;
+static GQuark values_quark = 0;
+static GQuark enums_quark = 0;
+
+static void
+gnc_gsettings_changed_cb (GSettings *settings, const gchar *key,
+                          gpointer user_data)
+{
+    g_hash_table_remove (g_object_get_qdata (G_OBJECT (settings),
+                         values_quark), key);
+    g_hash_table_remove (g_object_get_qdata (G_OBJECT (settings),
+                         enums_quark), key);
+}
+
+static void
+gnc_gsettings_init_cache (GSettings *settings)
 {
-    gchar **keys = NULL;
-    gint i = 0;
-    gboolean found = FALSE;
+    GHashTable *keys;
+    gchar **key_list;
+    gint i;
+
+    if (!keys_quark)
+    {
+        keys_quark = g_quark_from_static_string ("gnc-gsettings-keys");
+        values_quark = g_quark_from_static_string ("gnc-gsettings-values");
+        enums_quark = g_quark_from_static_string ("gnc-gsettings-enums");
+    }
+
+    keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    key_list = g_settings_list_keys (settings);
+    for (i = 0; key_list && key_list[i]; i++)
+        g_hash_table_insert (keys, key_list[i], key_list[i]);
+    /* The table took the strings. */
+    g_free (key_list);
+    g_object_set_qdata_full (G_OBJECT (settings), keys_quark, keys,
+                             (GDestroyNotify) g_hash_table_destroy);
+    g_object_set_qdata_full (G_OBJECT (settings), values_quark,
+                             g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     g_free,
+                                     (GDestroyNotify) g_variant_unref),
+                             (GDestroyNotify) g_hash_table_destroy);
+    g_object_set_qdata_full (G_OBJECT (settings), enums_quark,
+                             g_hash_table_new_full (g_str_hash, g_str_equal,
+                                     g_free, NULL),
+                             (GDestroyNotify) g_hash_table_destroy);
+    /* Connected first, so that the callbacks registered later read the
+     * new values. */
+    g_signal_connect (settings, "changed",
+                      G_CALLBACK (gnc_gsettings_changed_cb), NULL);
+}
 
+static gboolean gnc_gsettings_is_valid_key(GSettings *settings, const gchar *key)
+{
     // Check if the key is valid key within settings
-    if (!G_IS_SETTINGS(settings))
+    if (!G_IS_SETTINGS(settings) || !key)
         return FALSE;
 
-    // Get list of keys
-    keys = g_settings_list_keys(settings);
+    return g_hash_table_lookup (g_object_get_qdata (G_OBJECT (settings),
+                                keys_quark), key) != NULL;
+}
+
+/* The value of a valid key, read once and then kept until it changes.
+ * The caller doesn't own it. */
+static GVariant *
+gnc_gsettings_get_cached_value (GSettings *settings, const gchar *key)
+{
+    GHashTable *values = g_object_get_qdata (G_OBJECT (settings),
+                         values_quark);
+    GVariant *value = g_hash_table_lookup (values, key);
 
-    while (keys && keys[i])
+    if (!value)
     {
-        if (!g_strcmp0(key, keys[i]))
-        {
-            found = TRUE;
-            break;
-        }
-        i++;
+        value = g_settings_get_value (settings, key);
+        g_hash_table_insert (values, g_strdup (key), value);
     }
+    return value;
+}
 
-    // Free keys
-    g_strfreev(keys);
-
-    return found;
+/* The setters drop the value themselves too, in case the backend
+ * doesn't emit "changed" before they return. */
+static void
+gnc_gsettings_forget_value (GSettings *settings, const gchar *key)
+{
+    gnc_gsettings_changed_cb (settings, key, NULL);
 }
 
 static GSettings * gnc_gsettings_get_schema_ptr (const gchar *schema_str)
 {
     GSettings *gset = NULL;
-    gchar *full_name = gnc_gsettings_normalize_schema_name (schema_str);
+    gchar *full_name;
 
     ENTER("");
     if (!schema_hash)
         schema_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
+    /* The schemas are also filed under the names they're asked for, to
+     * save normalizing them every time. */
+    if (schema_str)
+    {
+        gset = g_hash_table_lookup (schema_hash, schema_str);
+        if (gset)
+        {
+            LEAVE("");
+            return gset;
+        }
+    }
+
+    full_name = gnc_gsettings_normalize_schema_name (schema_str);
     gset = g_hash_table_lookup (schema_hash, full_name);
     DEBUG ("Looking for schema %s returned gsettings %p", full_name, gset);
     if (!gset)
@@ -104,14 +179,22 @@ static GSettings * gnc_gsettings_get_schema_ptr (const gchar *schema_str)
         gset = g_settings_new (full_name);
         DEBUG ("Created gsettings object %p for schema %s", gset, full_name);
         if (G_IS_SETTINGS(gset))
+        {
+            gnc_gsettings_init_cache (gset);
             g_hash_table_insert (schema_hash, full_name, gset);
+        }
         else
+        {
             PWARN ("Ignoring attempt to access unknown gsettings schema %s", full_name);
+            g_free(full_name);
+        }
     }
     else
     {
         g_free(full_name);
     }
+    if (G_IS_SETTINGS(gset) && schema_str)
+        g_hash_table_insert (schema_hash, g_strdup (schema_str), gset);
 
     LEAVE("");
     return gset;
@@ -283,7 +366,8 @@ gnc_gsettings_get_bool (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), FALSE);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_boolean (schema_ptr, key);
+        return g_variant_get_boolean (gnc_gsettings_get_cached_value (schema_ptr,
+                key));
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -304,6 +388,7 @@ gnc_gsettings_set_bool (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_boolean (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -322,7 +407,8 @@ gnc_gsettings_get_int (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), 0);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_int (schema_ptr, key);
+        return g_variant_get_int32 (gnc_gsettings_get_cached_value (schema_ptr,
+                key));
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -342,6 +428,7 @@ gnc_gsettings_set_int (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_int (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -359,7 +446,8 @@ gnc_gsettings_get_float (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), 0);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_double (schema_ptr, key);
+        return g_variant_get_double (gnc_gsettings_get_cached_value (schema_ptr,
+                key));
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -379,6 +467,7 @@ gnc_gsettings_set_float (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_double (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -396,7 +485,8 @@ gnc_gsettings_get_string (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), NULL);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_string (schema_ptr, key);
+        return g_variant_dup_string (gnc_gsettings_get_cached_value (schema_ptr,
+                key), NULL);
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -417,6 +507,7 @@ gnc_gsettings_set_string (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_string (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -435,7 +526,18 @@ gnc_gsettings_get_enum (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), 0);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_enum (schema_ptr, key);
+    {
+        GHashTable *enums = g_object_get_qdata (G_OBJECT (schema_ptr),
+                                                enums_quark);
+        gpointer value;
+
+        if (!g_hash_table_lookup_extended (enums, key, NULL, &value))
+        {
+            value = GINT_TO_POINTER (g_settings_get_enum (schema_ptr, key));
+            g_hash_table_insert (enums, g_strdup (key), value);
+        }
+        return GPOINTER_TO_INT (value);
+    }
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -455,6 +557,7 @@ gnc_gsettings_set_enum (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_enum (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -472,7 +575,8 @@ gnc_gsettings_get_value (const gchar *schema,
     g_return_val_if_fail (G_IS_SETTINGS (schema_ptr), NULL);
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
-        return g_settings_get_value (schema_ptr, key);
+        return g_variant_ref (gnc_gsettings_get_cached_value (schema_ptr,
+                key));
     else
     {
         PERR ("Invalid key %s for schema %s", key, schema);
@@ -492,6 +596,7 @@ gnc_gsettings_set_value (const gchar *schema,
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
     {
         result = g_settings_set_value (schema_ptr, key, value);
+        gnc_gsettings_forget_value (schema_ptr, key);
         if (!result)
             PERR ("Unable to set value for key %s in schema %s", key, schema);
     }
@@ -509,7 +614,10 @@ gnc_gsettings_reset (const gchar *schema,
     g_return_if_fail (G_IS_SETTINGS (schema_ptr));
 
     if (gnc_gsettings_is_valid_key (schema_ptr, key))
+    {
         g_settings_reset (schema_ptr, key);
+        gnc_gsettings_forget_value (schema_ptr, key);
+    }
     else
         PERR ("Invalid key %s for schema %s", key, schema);
 }
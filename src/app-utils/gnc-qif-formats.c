@@ -0,0 +1,395 @@
+/********************************************************************\
+ * gnc-qif-formats.c -- date and amount formats of QIF fields       *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gnc-qif-formats.h"
+
+static QofLogModule log_module = G_LOG_DOMAIN;
+
+/* Date parts are compared with nothing bigger than a year, so longer
+ * runs of digits are cut off here rather than overflowing. */
+#define DATE_PART_MAX 1000000000
+
+typedef struct
+{
+    gint64 value[3];
+    gsize length[3];
+} DateParts;
+
+static const gchar *
+read_date_part (const gchar *p, DateParts *parts, int i, gsize max_length)
+{
+    const gchar *start = p;
+
+    parts->value[i] = 0;
+    while (g_ascii_isdigit (*p) && (gsize) (p - start) < max_length)
+    {
+        if (parts->value[i] < DATE_PART_MAX)
+            parts->value[i] = parts->value[i] * 10 + (*p - '0');
+        p++;
+    }
+    parts->length[i] = p - start;
+    return p;
+}
+
+static const gchar *
+skip_date_separator (const gchar *p)
+{
+    while (*p == ' ')
+        p++;
+    if (*p == '\0' || !strchr ("-/.'", *p))
+        return NULL;
+    p++;
+    while (*p == ' ')
+        p++;
+    return p;
+}
+
+/* Split "1/2/2003", with any of "-/.'" between the parts, into parts.
+ * Otherwise return the eight digits of a date like "20030102" in
+ * packed, or FALSE if date_str is neither. */
+static gboolean
+split_date (const gchar *date_str, DateParts *parts, const gchar **packed)
+{
+    const gchar *p = date_str;
+    int i;
+
+    *packed = NULL;
+    while (*p == ' ')
+        p++;
+    for (i = 0; i < 3; i++)
+    {
+        if (i > 0 && !(p = skip_date_separator (p)))
+            break;
+        p = read_date_part (p, parts, i, G_MAXSIZE);
+        if (parts->length[i] == 0)
+            break;
+    }
+    if (i == 3)
+        return TRUE;
+
+    for (p = date_str; *p == ' '; p++)
+        ;
+    for (i = 0; i < 8; i++)
+        if (!g_ascii_isdigit (p[i]))
+            return FALSE;
+    *packed = p;
+    return TRUE;
+}
+
+/* Split the eight digits of a packed date with the year first or
+ * last. */
+static void
+split_packed_date (const gchar *packed, gboolean year_first,
+                   DateParts *parts)
+{
+    gsize first = year_first ? 4 : 2, second = 2;
+
+    packed = read_date_part (packed, parts, 0, first);
+    packed = read_date_part (packed, parts, 1, second);
+    read_date_part (packed, parts, 2, 8 - first - second);
+}
+
+static guint
+check_date_parts (const DateParts *parts, guint formats)
+{
+    gint64 n1 = parts->value[0], n2 = parts->value[1], n3 = parts->value[2];
+
+    if (n1 > 12)
+        formats &= ~GNC_QIF_DATE_M_D_Y;
+    if (n1 > 31)
+        formats &= ~GNC_QIF_DATE_D_M_Y;
+    if (n1 < 1)
+        formats &= ~(GNC_QIF_DATE_D_M_Y | GNC_QIF_DATE_M_D_Y);
+    if (n2 > 12)
+        formats &= ~(GNC_QIF_DATE_D_M_Y | GNC_QIF_DATE_Y_M_D);
+    if (n2 > 31)
+        formats &= ~(GNC_QIF_DATE_M_D_Y | GNC_QIF_DATE_Y_D_M);
+    if (n3 > 12)
+        formats &= ~GNC_QIF_DATE_Y_D_M;
+    if (n3 > 31)
+        formats &= ~GNC_QIF_DATE_Y_M_D;
+    if (n3 < 1)
+        formats &= ~(GNC_QIF_DATE_Y_M_D | GNC_QIF_DATE_Y_D_M);
+
+    /* A four-digit year has to be after 1930. */
+    if (parts->length[0] == 4 && n1 < 1930)
+        formats &= ~(GNC_QIF_DATE_Y_M_D | GNC_QIF_DATE_Y_D_M);
+    if (parts->length[2] == 4 && n3 < 1930)
+        formats &= ~(GNC_QIF_DATE_M_D_Y | GNC_QIF_DATE_D_M_Y);
+    return formats;
+}
+
+guint
+gnc_qif_check_date_format (const gchar *date_str, guint formats)
+{
+    const guint year_first = GNC_QIF_DATE_Y_M_D | GNC_QIF_DATE_Y_D_M;
+    const guint year_last = GNC_QIF_DATE_M_D_Y | GNC_QIF_DATE_D_M_Y;
+    DateParts parts;
+    const gchar *packed;
+    guint retval = 0;
+
+    g_return_val_if_fail (date_str, 0);
+
+    if (!split_date (date_str, &parts, &packed))
+        return 0;
+    if (!packed)
+        return check_date_parts (&parts, formats);
+
+    /* There's no telling which end of "20030102" the year is on, so
+     * try both and let each check whether its year is valid. */
+    if (formats & year_first)
+    {
+        split_packed_date (packed, TRUE, &parts);
+        retval |= check_date_parts (&parts, formats);
+    }
+    if (formats & year_last)
+    {
+        split_packed_date (packed, FALSE, &parts);
+        retval |= check_date_parts (&parts, formats);
+    }
+    return retval;
+}
+
+/* "00", "2000" and "19100", which Quicken has printed for 2000, are all
+ * the same year. */
+static gint64
+fix_year (gint64 year)
+{
+    if (year < 50)
+        return year + 2000;
+    if (year > 19000)
+        return year - 19000 + 1900;
+    if (year < 1902)
+        return year + 1900;
+    return year;
+}
+
+gboolean
+gnc_qif_parse_date (const gchar *date_str, GncQifDateFormat format,
+                    gint *day, gint *month, gint *year)
+{
+    DateParts parts;
+    const gchar *packed;
+    gint64 d, m, y;
+
+    g_return_val_if_fail (date_str && day && month && year, FALSE);
+
+    if (!split_date (date_str, &parts, &packed))
+    {
+        PWARN ("can't interpret date [%s]", date_str);
+        return FALSE;
+    }
+    if (packed)
+        split_packed_date (packed, (format == GNC_QIF_DATE_Y_M_D ||
+                                    format == GNC_QIF_DATE_Y_D_M), &parts);
+
+    switch (format)
+    {
+    case GNC_QIF_DATE_D_M_Y:
+        d = parts.value[0];
+        m = parts.value[1];
+        y = parts.value[2];
+        break;
+    case GNC_QIF_DATE_M_D_Y:
+        m = parts.value[0];
+        d = parts.value[1];
+        y = parts.value[2];
+        break;
+    case GNC_QIF_DATE_Y_M_D:
+        y = parts.value[0];
+        m = parts.value[1];
+        d = parts.value[2];
+        break;
+    case GNC_QIF_DATE_Y_D_M:
+        y = parts.value[0];
+        d = parts.value[1];
+        m = parts.value[2];
+        break;
+    default:
+        PWARN ("unknown date format %d", format);
+        return FALSE;
+    }
+
+    if (m > 12 || d > 31)
+    {
+        PWARN ("date [%s] is not in format %d", date_str, format);
+        return FALSE;
+    }
+    *day = d;
+    *month = m;
+    *year = fix_year (y);
+    return TRUE;
+}
+
+/* Skip the "[$]?[+-]?[$]?" any amount may begin with. */
+static const gchar *
+skip_number_sign (const gchar *p)
+{
+    if (*p == '$')
+        p++;
+    if (*p == '+' || *p == '-')
+        p++;
+    if (*p == '$')
+        p++;
+    return p;
+}
+
+static const gchar *
+skip_digits (const gchar *p, gsize *count)
+{
+    const gchar *start = p;
+
+    while (g_ascii_isdigit (*p))
+        p++;
+    if (count)
+        *count = p - start;
+    return p;
+}
+
+/* Whether p is all that an amount may end with, "[+-]?", followed by
+ * spaces if trailing_spaces is set. */
+static gboolean
+is_number_end (const gchar *p, gboolean trailing_spaces)
+{
+    if (*p == '+' || *p == '-')
+        p++;
+    if (trailing_spaces)
+        while (*p == ' ')
+            p++;
+    return *p == '\0';
+}
+
+/* Whether number_str is an amount with a radix and groups of three
+ * digits separated by group or an apostrophe: "1234", "1234.5" or
+ * "1,234.5" when radix is '.' and group ','. */
+static gboolean
+is_radix_number (const gchar *number_str, gchar radix, gchar group)
+{
+    const gchar *p = number_str, *end;
+    gsize digits;
+
+    while (*p == ' ')
+        p++;
+    end = skip_digits (skip_number_sign (p), &digits);
+    if (digits > 0 && is_number_end (end, FALSE))
+        return TRUE;
+    if (digits > 0 && *end == radix &&
+            is_number_end (skip_digits (end + 1, NULL), TRUE))
+        return TRUE;
+
+    if (digits > 3)
+        return FALSE;
+    while ((*end == group || *end == '\'') && g_ascii_isdigit (end[1]) &&
+            g_ascii_isdigit (end[2]) && g_ascii_isdigit (end[3]))
+        end += 4;
+    if (*end == radix)
+        end = skip_digits (end + 1, NULL);
+    return is_number_end (end, TRUE);
+}
+
+static gboolean
+is_integer_number (const gchar *number_str)
+{
+    gsize digits;
+    const gchar *end = skip_digits (skip_number_sign (number_str), &digits);
+
+    return digits > 0 && is_number_end (end, TRUE);
+}
+
+guint
+gnc_qif_check_number_format (const gchar *number_str, guint formats)
+{
+    g_return_val_if_fail (number_str, 0);
+
+    if ((formats & GNC_QIF_NUMBER_DECIMAL) &&
+            !is_radix_number (number_str, '.', ','))
+        formats &= ~GNC_QIF_NUMBER_DECIMAL;
+    if ((formats & GNC_QIF_NUMBER_COMMA) &&
+            !is_radix_number (number_str, ',', '.'))
+        formats &= ~GNC_QIF_NUMBER_COMMA;
+    if ((formats & GNC_QIF_NUMBER_INTEGER) && !is_integer_number (number_str))
+        formats &= ~GNC_QIF_NUMBER_INTEGER;
+    return formats;
+}
+
+gnc_numeric
+gnc_qif_parse_number (const gchar *number_str, GncQifNumberFormat format)
+{
+    gchar radix = format == GNC_QIF_NUMBER_COMMA ? ',' : '.';
+    GString *digits;
+    gboolean seen_radix = FALSE;
+    gsize decimals = 0, ndigits;
+    gnc_numeric retval;
+    const gchar *p;
+
+    g_return_val_if_fail (number_str, gnc_numeric_zero ());
+
+    /* Keep the digits and the radix; signs, currency symbols and group
+     * separators don't change the value. */
+    digits = g_string_sized_new (strlen (number_str));
+    for (p = number_str; *p; p++)
+    {
+        if (g_ascii_isdigit (*p))
+        {
+            g_string_append_c (digits, *p);
+            if (seen_radix)
+                decimals++;
+        }
+        else if (*p == radix && !seen_radix)
+        {
+            g_string_append_c (digits, '.');
+            seen_radix = TRUE;
+        }
+        else if (!strchr ("$'+- .,", *p))
+            break;
+    }
+    ndigits = digits->len - (seen_radix ? 1 : 0);
+
+    if (ndigits == 0 || *p)
+        retval = gnc_numeric_zero ();
+    else if (ndigits < 19)
+    {
+        gint64 num = 0, denom = 1;
+        for (p = digits->str; *p; p++)
+            if (*p != '.')
+                num = num * 10 + (*p - '0');
+        while (decimals-- > 0)
+            denom *= 10;
+        retval = gnc_numeric_create (num, denom);
+    }
+    else
+        retval = double_to_gnc_numeric (g_ascii_strtod (digits->str, NULL),
+                                        GNC_DENOM_AUTO,
+                                        GNC_HOW_DENOM_SIGFIGS (ndigits) |
+                                        GNC_HOW_RND_ROUND);
+    g_string_free (digits, TRUE);
+
+    if (format == GNC_QIF_NUMBER_INTEGER)
+        retval = gnc_numeric_convert (retval, 1, GNC_HOW_RND_ROUND);
+    if (strchr (number_str, '-'))
+        retval = gnc_numeric_neg (retval);
+    return retval;
+}
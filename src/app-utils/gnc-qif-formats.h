@@ -0,0 +1,89 @@
+/********************************************************************\
+ * gnc-qif-formats.h -- date and amount formats of QIF fields       *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+/** @addtogroup GUI
+    @{ */
+/** @file gnc-qif-formats.h
+    @brief Format detection and parsing of QIF dates and amounts
+
+    The QIF importer doesn't know which date or number format a file
+    uses until it has seen every value of a field.  It starts with all
+    the formats it accepts, narrows them with each value it checks and
+    then parses the field with the format that is left.  These are the
+    compiled checks and parsers behind qif-parse.scm; they accept
+    exactly the strings its regular expressions did.
+*/
+
+#ifndef GNC_QIF_FORMATS_H
+#define GNC_QIF_FORMATS_H
+
+#include <glib.h>
+#include "qof.h"
+
+/** The orders a QIF date's day, month and year may come in.  They are
+ *  flags, so that a set of possible formats fits in a guint. */
+typedef enum
+{
+    GNC_QIF_DATE_M_D_Y = 1 << 0,
+    GNC_QIF_DATE_D_M_Y = 1 << 1,
+    GNC_QIF_DATE_Y_M_D = 1 << 2,
+    GNC_QIF_DATE_Y_D_M = 1 << 3,
+} GncQifDateFormat;
+
+/** The ways a QIF amount may be written: with a decimal point and
+ *  comma or apostrophe grouping, with a decimal comma and point or
+ *  apostrophe grouping, or as a plain integer. */
+typedef enum
+{
+    GNC_QIF_NUMBER_DECIMAL = 1 << 0,
+    GNC_QIF_NUMBER_COMMA   = 1 << 1,
+    GNC_QIF_NUMBER_INTEGER = 1 << 2,
+} GncQifNumberFormat;
+
+/** Return those of the GncQifDateFormat flags in formats that
+ *  date_str could be written in.  Dates are three numbers separated
+ *  by any of "-/.'", or eight digits with the year first or last. */
+guint gnc_qif_check_date_format (const gchar *date_str, guint formats);
+
+/** Parse date_str in format, putting the day, the month and the
+ *  four-digit year in day, month and year.  Two-digit years below 50
+ *  are taken to be after 2000.
+ *
+ *  @return FALSE if date_str isn't a date in format. */
+gboolean gnc_qif_parse_date (const gchar *date_str, GncQifDateFormat format,
+                             gint *day, gint *month, gint *year);
+
+/** Return those of the GncQifNumberFormat flags in formats that
+ *  number_str could be written in. */
+guint gnc_qif_check_number_format (const gchar *number_str, guint formats);
+
+/** Parse number_str, which was written in format.  The result is
+ *  exact, with a denominator of ten to the power of the number of
+ *  digits after the radix; a '-' anywhere in the string makes it
+ *  negative.
+ *
+ *  @return The amount, or zero if number_str has no digits. */
+gnc_numeric gnc_qif_parse_number (const gchar *number_str,
+                                  GncQifNumberFormat format);
+
+#endif /* GNC_QIF_FORMATS_H */
+/** @} */
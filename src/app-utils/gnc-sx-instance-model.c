@@ -374,7 +374,7 @@ _gnc_sx_gen_instances(gpointer *data, gpointer user_data)
             inst = gnc_sx_instance_new(instances, SX_INSTANCE_STATE_POSTPONED,
                                        &inst_date, postponed->data, seq_num);
             instances->instance_list =
-                g_list_append(instances->instance_list, inst);
+                g_list_prepend(instances->instance_list, inst);
             gnc_sx_destroy_temporal_state(temporal_state);
             temporal_state = gnc_sx_clone_temporal_state(postponed->data);
             gnc_sx_incr_temporal_state(sx, temporal_state);
@@ -392,7 +392,7 @@ _gnc_sx_gen_instances(gpointer *data, gpointer user_data)
         seq_num = gnc_sx_get_instance_count(sx, temporal_state);
         inst = gnc_sx_instance_new(instances, SX_INSTANCE_STATE_TO_CREATE,
                                    &cur_date, temporal_state, seq_num);
-        instances->instance_list = g_list_append(instances->instance_list, inst);
+        instances->instance_list = g_list_prepend(instances->instance_list, inst);
         gnc_sx_incr_temporal_state(sx, temporal_state);
         cur_date = xaccSchedXactionGetNextInstance(sx, temporal_state);
     }
@@ -406,12 +406,15 @@ _gnc_sx_gen_instances(gpointer *data, gpointer user_data)
         seq_num = gnc_sx_get_instance_count(sx, temporal_state);
         inst = gnc_sx_instance_new(instances, SX_INSTANCE_STATE_REMINDER,
                                    &cur_date, temporal_state, seq_num);
-        instances->instance_list = g_list_append(instances->instance_list,
-                                                 inst);
+        instances->instance_list = g_list_prepend(instances->instance_list,
+                                                  inst);
         gnc_sx_incr_temporal_state(sx, temporal_state);
         cur_date = xaccSchedXactionGetNextInstance(sx, temporal_state);
     }
 
+    /* The instances were prepended, as long ranges of frequent
+     * recurrences make appending each one quadratic. */
+    instances->instance_list = g_list_reverse(instances->instance_list);
     return instances;
 }
 
@@ -893,9 +896,34 @@ increment_sx_state(GncSxInstance *inst, GDate **last_occur_date, int *instance_c
     }
 }
 
+/** What creating a transaction from one template split needs, read
+ * from its KVP once per SX rather than once per instance. */
+typedef struct
+{
+    const Split *template_split;
+    Account *account; /* NULL if its sx-account is unknown */
+    char *credit_formula;
+    char *debit_formula;
+    gnc_numeric *credit_numeric;
+    gnc_numeric *debit_numeric;
+} SxSplitPlan;
+
+typedef struct
+{
+    Transaction *template_txn;
+    GList *splits; /* SxSplitPlans, in the template's split order */
+} SxTxnPlan;
+
+/** The template transactions of an SX; see sx_creation_plan_get(). */
+typedef struct
+{
+    GList *txns; /* SxTxnPlans */
+} SxCreationPlan;
+
 typedef struct _SxTxnCreationData
 {
     GncSxInstance *instance;
+    SxTxnPlan *txn_plan;
     GList **created_txn_guids;
     GList **creation_errors;
 } SxTxnCreationData;
@@ -930,21 +958,15 @@ _get_template_split_account(const SchedXaction* sx,
 }
 
 static void
-_get_sx_formula_value(const SchedXaction* sx,
-		      const Split *template_split,
-		      gnc_numeric *numeric,
-		      GList **creation_errors,
-		      const char *formula_key,
-		      const char* numeric_key,
-		      GHashTable *variable_bindings)
+_eval_sx_formula(const SchedXaction* sx,
+                 const char *formula_key,
+                 const char *formula_str,
+                 const gnc_numeric *numeric_val,
+                 gnc_numeric *numeric,
+                 GList **creation_errors,
+                 GHashTable *variable_bindings)
 {
-
-    char *formula_str = NULL, *parseErrorLoc = NULL;
-    gnc_numeric *numeric_val = NULL;
-    qof_instance_get (QOF_INSTANCE (template_split),
-		      formula_key, &formula_str,
-		      numeric_key, &numeric_val,
-		      NULL);
+    char *parseErrorLoc = NULL;
 
     if ((variable_bindings == NULL ||
          g_hash_table_size (variable_bindings) == 0) &&
@@ -993,26 +1015,31 @@ _get_sx_formula_value(const SchedXaction* sx,
 }
 
 static void
-_get_credit_formula_value(GncSxInstance *instance,
-                          const Split *template_split, gnc_numeric *credit_num,
-                          GList **creation_errors)
+_get_sx_formula_value(const SchedXaction* sx,
+		      const Split *template_split,
+		      gnc_numeric *numeric,
+		      GList **creation_errors,
+		      const char *formula_key,
+		      const char* numeric_key,
+		      GHashTable *variable_bindings)
 {
-    _get_sx_formula_value(instance->parent->sx, template_split, credit_num,
-                          creation_errors, "sx-credit-formula",
-                          "sx-credit-numeric", instance->variable_bindings);
-}
 
-static void
-_get_debit_formula_value(GncSxInstance *instance, const Split *template_split,
-                         gnc_numeric *debit_num, GList **creation_errors)
-{
-    _get_sx_formula_value(instance->parent->sx, template_split, debit_num,
-                          creation_errors, "sx-debit-formula",
-                          "sx-debit-numeric", instance->variable_bindings);
+    char *formula_str = NULL;
+    gnc_numeric *numeric_val = NULL;
+    qof_instance_get (QOF_INSTANCE (template_split),
+		      formula_key, &formula_str,
+		      numeric_key, &numeric_val,
+		      NULL);
+
+    _eval_sx_formula (sx, formula_key, formula_str, numeric_val, numeric,
+                      creation_errors, variable_bindings);
+    g_free (formula_str);
+    g_free (numeric_val);
 }
 
 static gnc_numeric
-split_apply_formulas (const Split *split, SxTxnCreationData* creation_data)
+split_apply_formulas (const SxSplitPlan *split_plan,
+                      SxTxnCreationData* creation_data)
 {
     gnc_numeric credit_num = gnc_numeric_zero();
     gnc_numeric debit_num = gnc_numeric_zero();
@@ -1020,10 +1047,14 @@ split_apply_formulas (const Split *split, SxTxnCreationData* creation_data)
     gint gncn_error;
     SchedXaction *sx = creation_data->instance->parent->sx;
 
-    _get_credit_formula_value(creation_data->instance, split, &credit_num,
-                              creation_data->creation_errors);
-    _get_debit_formula_value(creation_data->instance, split, &debit_num,
-                             creation_data->creation_errors);
+    _eval_sx_formula(sx, "sx-credit-formula", split_plan->credit_formula,
+                     split_plan->credit_numeric, &credit_num,
+                     creation_data->creation_errors,
+                     creation_data->instance->variable_bindings);
+    _eval_sx_formula(sx, "sx-debit-formula", split_plan->debit_formula,
+                     split_plan->debit_numeric, &debit_num,
+                     creation_data->creation_errors,
+                     creation_data->instance->variable_bindings);
 
     final = gnc_numeric_sub_fixed(debit_num, credit_num);
 
@@ -1091,12 +1122,15 @@ create_each_transaction_helper(Transaction *template_txn, void *user_data)
 {
     Transaction *new_txn;
     GList *txn_splits, *template_splits;
+    SxTxnPlan *txn_plan;
     Split *copying_split;
     gnc_commodity *first_cmdty = NULL;
     gboolean err_flag = FALSE;
     SxTxnCreationData *creation_data = (SxTxnCreationData*)user_data;
     SchedXaction *sx = creation_data->instance->parent->sx;
 
+    txn_plan = creation_data->txn_plan;
+
     /* FIXME: In general, this should [correctly] deal with errors such
        as not finding the approrpiate Accounts and not being able to
        parse the formula|credit/debit strings. */
@@ -1122,7 +1156,7 @@ create_each_transaction_helper(Transaction *template_txn, void *user_data)
                      g_date_get_month(&creation_data->instance->date),
                      g_date_get_year(&creation_data->instance->date));
 
-    template_splits = xaccTransGetSplitList(template_txn);
+    template_splits = txn_plan->splits;
     txn_splits = xaccTransGetSplitList(new_txn);
     if ((template_splits == NULL) || (txn_splits == NULL))
     {
@@ -1137,17 +1171,21 @@ create_each_transaction_helper(Transaction *template_txn, void *user_data)
          txn_splits && template_splits;
          txn_splits = txn_splits->next, template_splits = template_splits->next)
     {
-        const Split *template_split;
+        const SxSplitPlan *split_plan;
         Account *split_acct;
         gnc_commodity *split_cmdty = NULL;
 
         /* FIXME: Ick.  This assumes that the split lists will be ordered
            identically. :( They are, but we'd rather not have to count on
            it. --jsled */
-        template_split = (Split*)template_splits->data;
+        split_plan = (SxSplitPlan*)template_splits->data;
         copying_split = (Split*)txn_splits->data;
 
-        if (!_get_template_split_account(sx, template_split, &split_acct,
+        split_acct = split_plan->account;
+        /* Look it up again for the error message. */
+        if (split_acct == NULL &&
+            !_get_template_split_account(sx, split_plan->template_split,
+                                         &split_acct,
                                          creation_data->creation_errors))
         {
             err_flag = TRUE;
@@ -1174,7 +1212,7 @@ create_each_transaction_helper(Transaction *template_txn, void *user_data)
         xaccSplitSetAccount(copying_split, split_acct);
 
         {
-            gnc_numeric final = split_apply_formulas(template_split,
+            gnc_numeric final = split_apply_formulas(split_plan,
                                                      creation_data);
             xaccSplitSetValue(copying_split, final);
             g_debug("value is %s for memo split '%s'",
@@ -1221,20 +1259,100 @@ create_each_transaction_helper(Transaction *template_txn, void *user_data)
 }
 
 static void
-create_transactions_for_instance(GncSxInstance *instance, GList **created_txn_guids, GList **creation_errors)
+sx_split_plan_free (SxSplitPlan *split_plan)
 {
-    SxTxnCreationData creation_data;
-    Account *sx_template_account;
+    g_free (split_plan->credit_formula);
+    g_free (split_plan->debit_formula);
+    g_free (split_plan->credit_numeric);
+    g_free (split_plan->debit_numeric);
+    g_free (split_plan);
+}
 
-    sx_template_account = gnc_sx_get_template_transaction_account(instance->parent->sx);
+static void
+sx_creation_plan_free (SxCreationPlan *plan)
+{
+    GList *node;
+
+    for (node = plan->txns; node; node = node->next)
+    {
+        SxTxnPlan *txn_plan = node->data;
+
+        g_list_free_full (txn_plan->splits, (GDestroyNotify) sx_split_plan_free);
+        g_free (txn_plan);
+    }
+    g_list_free (plan->txns);
+    g_free (plan);
+}
+
+static gboolean
+sx_creation_plan_add_txn (Transaction *template_txn, void *user_data)
+{
+    SxCreationPlan *plan = user_data;
+    SxTxnPlan *txn_plan = g_new0 (SxTxnPlan, 1);
+    GList *node;
+
+    txn_plan->template_txn = template_txn;
+    for (node = xaccTransGetSplitList (template_txn); node; node = node->next)
+    {
+        SxSplitPlan *split_plan = g_new0 (SxSplitPlan, 1);
+        GncGUID *acct_guid = NULL;
+
+        split_plan->template_split = node->data;
+        qof_instance_get (QOF_INSTANCE (node->data),
+                          "sx-account", &acct_guid,
+                          "sx-credit-formula", &split_plan->credit_formula,
+                          "sx-credit-numeric", &split_plan->credit_numeric,
+                          "sx-debit-formula", &split_plan->debit_formula,
+                          "sx-debit-numeric", &split_plan->debit_numeric,
+                          NULL);
+        split_plan->account = xaccAccountLookup (acct_guid,
+                                                 gnc_get_current_book ());
+        guid_free (acct_guid);
+        txn_plan->splits = g_list_prepend (txn_plan->splits, split_plan);
+    }
+    txn_plan->splits = g_list_reverse (txn_plan->splits);
+    plan->txns = g_list_prepend (plan->txns, txn_plan);
+    return FALSE;
+}
+
+/** The template transactions of sx with their splits' accounts and
+ * formulas, read when the first of its instances is created and kept in
+ * plans for the others. */
+static SxCreationPlan *
+sx_creation_plan_get (GHashTable *plans, SchedXaction *sx)
+{
+    SxCreationPlan *plan = g_hash_table_lookup (plans, sx);
+
+    if (plan == NULL)
+    {
+        plan = g_new0 (SxCreationPlan, 1);
+        xaccAccountForEachTransaction
+            (gnc_sx_get_template_transaction_account (sx),
+             sx_creation_plan_add_txn, plan);
+        plan->txns = g_list_reverse (plan->txns);
+        g_hash_table_insert (plans, sx, plan);
+    }
+    return plan;
+}
+
+static void
+create_transactions_for_instance(GncSxInstance *instance, SxCreationPlan *plan,
+                                 GList **created_txn_guids,
+                                 GList **creation_errors)
+{
+    SxTxnCreationData creation_data;
+    GList *node;
 
     creation_data.instance = instance;
     creation_data.created_txn_guids = created_txn_guids;
     creation_data.creation_errors = creation_errors;
 
-    xaccAccountForEachTransaction(sx_template_account,
-                                  create_each_transaction_helper,
-                                  &creation_data);
+    for (node = plan->txns; node; node = node->next)
+    {
+        creation_data.txn_plan = node->data;
+        create_each_transaction_helper (creation_data.txn_plan->template_txn,
+                                        &creation_data);
+    }
 }
 
 void
@@ -1243,6 +1361,7 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
                                     GList **created_transaction_guids,
                                     GList **creation_errors)
 {
+    GHashTable *plans;
     GList *iter;
 
     if (qof_book_is_readonly(gnc_get_current_book()))
@@ -1251,6 +1370,13 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
         return;
     }
 
+    plans = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                   (GDestroyNotify) sx_creation_plan_free);
+
+    /* Hold the events of the created transactions until all are done. */
+    qof_event_begin_batch();
+    xaccTransBeginDeferredScrub();
+    xaccTransBeginJournaledEdits();
     for (iter = model->sx_instance_list; iter != NULL; iter = iter->next)
     {
         GList *instance_iter;
@@ -1312,6 +1438,7 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
                     break;
                 case SX_INSTANCE_STATE_TO_CREATE:
                     create_transactions_for_instance (inst,
+                                                      sx_creation_plan_get (plans, inst->parent->sx),
                                                       created_transaction_guids,
                                                       &instance_errors);
                     if (instance_errors == NULL)
@@ -1340,6 +1467,10 @@ gnc_sx_instance_model_effect_change(GncSxInstanceModel *model,
         gnc_sx_set_instance_count(instances->sx, instance_count);
         xaccSchedXactionSetRemOccur(instances->sx, remain_occur_count);
     }
+    xaccTransEndJournaledEdits();
+    xaccTransEndDeferredScrub();
+    qof_event_end_batch();
+    g_hash_table_destroy (plans);
 }
 
 void
@@ -1527,7 +1658,6 @@ static void add_to_hash_amount(GHashTable* hash, const GncGUID* guid, const gnc_
      * hash. */
     gnc_numeric* elem = g_hash_table_lookup(hash, guid);
     gchar guidstr[GUID_ENCODING_LENGTH+1];
-    guid_to_string_buff(guid, guidstr);
     if (!elem)
     {
         elem = g_new0(gnc_numeric, 1);
@@ -1538,6 +1668,7 @@ static void add_to_hash_amount(GHashTable* hash, const GncGUID* guid, const gnc_
     /* Check input arguments for sanity */
     if (gnc_numeric_check(*amount) != GNC_ERROR_OK)
     {
+        guid_to_string_buff(guid, guidstr);
         g_critical("Oops, the given amount [%s] has the error code %d, at guid [%s].",
                    gnc_num_dbg_to_string(*amount),
                    gnc_numeric_check(*amount),
@@ -1546,6 +1677,7 @@ static void add_to_hash_amount(GHashTable* hash, const GncGUID* guid, const gnc_
     }
     if (gnc_numeric_check(*elem) != GNC_ERROR_OK)
     {
+        guid_to_string_buff(guid, guidstr);
         g_critical("Oops, the account's amount [%s] has the error code %d, at guid [%s].",
                    gnc_num_dbg_to_string(*elem),
                    gnc_numeric_check(*elem),
@@ -1564,6 +1696,7 @@ static void add_to_hash_amount(GHashTable* hash, const GncGUID* guid, const gnc_
     /* Check for sanity of the output. */
     if (gnc_numeric_check(*elem) != GNC_ERROR_OK)
     {
+        guid_to_string_buff(guid, guidstr);
         g_critical("Oops, after addition at guid [%s] the resulting amount [%s] has the error code %d; added amount = [%s].",
                    guidstr,
                    gnc_num_dbg_to_string(*elem),
@@ -1573,10 +1706,14 @@ static void add_to_hash_amount(GHashTable* hash, const GncGUID* guid, const gnc_
     }
 
     /* In case anyone wants to see this in the debug log. */
-    g_debug("Adding to guid [%s] the value [%s]. Value now [%s].",
-            guidstr,
-            gnc_num_dbg_to_string(*amount),
-            gnc_num_dbg_to_string(*elem));
+    if (qof_log_check(G_LOG_DOMAIN, QOF_LOG_DEBUG))
+    {
+        guid_to_string_buff(guid, guidstr);
+        g_debug("Adding to guid [%s] the value [%s]. Value now [%s].",
+                guidstr,
+                gnc_num_dbg_to_string(*amount),
+                gnc_num_dbg_to_string(*elem));
+    }
 }
 
 static gboolean
@@ -1696,13 +1833,6 @@ instantiate_cashflow_internal(const SchedXaction* sx,
         return;
     }
 
-    if (!xaccSchedXactionGetEnabled(sx))
-    {
-        g_debug("Skipping non-enabled SX [%s]",
-                xaccSchedXactionGetName(sx));
-        return;
-    }
-
     create_cashflow_data.hash = map;
     create_cashflow_data.creation_errors = creation_errors;
     create_cashflow_data.sx = sx;
@@ -1732,6 +1862,14 @@ static void instantiate_cashflow_cb(gpointer data, gpointer _user_data)
     g_assert(sx);
     g_assert(userdata);
 
+    /* Check this before stepping through the occurrences below. */
+    if (!xaccSchedXactionGetEnabled(sx))
+    {
+        g_debug("Skipping non-enabled SX [%s]",
+                xaccSchedXactionGetName(sx));
+        return;
+    }
+
     /* How often does this particular SX occur in the date range? */
     count = gnc_sx_get_num_occur_daterange(sx, userdata->range_start,
                                            userdata->range_end);
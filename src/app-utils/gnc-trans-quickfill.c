@@ -0,0 +1,159 @@
+/********************************************************************\
+ * gnc-trans-quickfill.c -- Create transaction text quick-fills      *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "config.h"
+#include "gnc-trans-quickfill.h"
+#include "engine/gnc-event.h"
+#include "engine/Transaction.h"
+
+/* This static indicates the debugging module that this .o belongs to. */
+G_GNUC_UNUSED static QofLogModule log_module = GNC_MOD_REGISTER;
+
+#define TRANS_QF_KEY "gnc-trans-quickfills"
+
+/* The quickfills of one account */
+typedef struct
+{
+    QuickFill *qf[GNC_TRANS_QF_NUM_FIELDS];
+} AccountQF;
+
+/* The quickfills of all of the accounts of a book that asked for them */
+typedef struct
+{
+    GHashTable *accounts; /* Account* -> AccountQF* */
+    gint  listener;
+} TransQF;
+
+static void
+account_qf_destroy (gpointer data)
+{
+    AccountQF *aqf = data;
+    gint i;
+
+    for (i = 0; i < GNC_TRANS_QF_NUM_FIELDS; i++)
+        gnc_quickfill_destroy (aqf->qf[i]);
+    g_free (aqf);
+}
+
+static void
+account_qf_add_trans (AccountQF *aqf, Transaction *trans)
+{
+    GList *node;
+
+    gnc_quickfill_insert (aqf->qf[GNC_TRANS_QF_DESCRIPTION],
+                          xaccTransGetDescription (trans), QUICKFILL_LIFO);
+    gnc_quickfill_insert (aqf->qf[GNC_TRANS_QF_NOTES],
+                          xaccTransGetNotes (trans), QUICKFILL_LIFO);
+    for (node = xaccTransGetSplitList (trans); node; node = node->next)
+        gnc_quickfill_insert (aqf->qf[GNC_TRANS_QF_MEMO],
+                              xaccSplitGetMemo (node->data), QUICKFILL_LIFO);
+}
+
+static void
+listen_for_trans_events (QofInstance *entity,  QofEventId event_type,
+                         gpointer user_data, gpointer event_data)
+{
+    TransQF *tqf = user_data;
+    GList *node;
+
+    if (GNC_IS_ACCOUNT (entity))
+    {
+        /* Forget the quickfills of deleted accounts. */
+        if (event_type & QOF_EVENT_DESTROY)
+            g_hash_table_remove (tqf->accounts, entity);
+        return;
+    }
+
+    /* We only listen for changes of transactions, and add their texts to
+     * the quickfills of their accounts. */
+    if (!GNC_IS_TRANSACTION (entity) || !(event_type & QOF_EVENT_MODIFY))
+        return;
+
+    for (node = xaccTransGetSplitList (GNC_TRANSACTION (entity)); node;
+            node = node->next)
+    {
+        AccountQF *aqf = g_hash_table_lookup (tqf->accounts,
+                                              xaccSplitGetAccount (node->data));
+        if (aqf)
+            account_qf_add_trans (aqf, GNC_TRANSACTION (entity));
+    }
+}
+
+static void
+shared_quickfill_destroy (QofBook *book, gpointer key, gpointer user_data)
+{
+    TransQF *tqf = user_data;
+    qof_event_unregister_handler (tqf->listener);
+    g_hash_table_destroy (tqf->accounts);
+    g_free (tqf);
+}
+
+static AccountQF *
+build_account_quickfill (Account *account)
+{
+    AccountQF *aqf = g_new0 (AccountQF, 1);
+    GList *node;
+    gint i;
+
+    for (i = 0; i < GNC_TRANS_QF_NUM_FIELDS; i++)
+        aqf->qf[i] = gnc_quickfill_new ();
+
+    for (node = xaccAccountGetSplitList (account); node; node = node->next)
+    {
+        Transaction *trans = xaccSplitGetParent (node->data);
+        if (trans)
+            account_qf_add_trans (aqf, trans);
+    }
+    return aqf;
+}
+
+QuickFill *
+gnc_get_shared_trans_quickfill (Account *account, GncTransQuickFillField field)
+{
+    QofBook *book;
+    TransQF *tqf;
+    AccountQF *aqf;
+
+    g_return_val_if_fail (account, NULL);
+    g_return_val_if_fail (field < GNC_TRANS_QF_NUM_FIELDS, NULL);
+
+    book = gnc_account_get_book (account);
+    tqf = qof_book_get_data (book, TRANS_QF_KEY);
+    if (!tqf)
+    {
+        tqf = g_new0 (TransQF, 1);
+        tqf->accounts = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                               NULL, account_qf_destroy);
+        tqf->listener =
+            qof_event_register_handler (listen_for_trans_events, tqf);
+        qof_book_set_data_fin (book, TRANS_QF_KEY, tqf,
+                               shared_quickfill_destroy);
+    }
+
+    aqf = g_hash_table_lookup (tqf->accounts, account);
+    if (!aqf)
+    {
+        aqf = build_account_quickfill (account);
+        g_hash_table_insert (tqf->accounts, account, aqf);
+    }
+    return aqf->qf[field];
+}
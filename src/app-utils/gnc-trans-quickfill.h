@@ -0,0 +1,67 @@
+/********************************************************************\
+ * gnc-trans-quickfill.h -- Create transaction text quick-fills      *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup QuickFill Auto-complete typed user input.
+   @{
+*/
+/** Similar to the @ref Account_QuickFill account name quickfill, we
+ * create cached quickfills with the descriptions, notes and memos of
+ * the transactions of an account, shared by all of its registers.
+*/
+
+#ifndef GNC_TRANS_QUICKFILL_H
+#define GNC_TRANS_QUICKFILL_H
+
+#include "qof.h"
+#include "Account.h"
+#include "app-utils/QuickFill.h"
+
+/** The texts of the transactions held by a shared quickfill */
+typedef enum
+{
+    GNC_TRANS_QF_DESCRIPTION,
+    GNC_TRANS_QF_NOTES,
+    GNC_TRANS_QF_MEMO, /**< The memos of all of the splits */
+    GNC_TRANS_QF_NUM_FIELDS
+} GncTransQuickFillField;
+
+/** Create/fetch a quickfill of the descriptions, notes or memos of the
+ *  transactions with a split in the account.
+ *
+ *  The quickfills of an account are created on first use, from its
+ *  split list in order, and stored with the account's book; they are
+ *  destroyed with the book or the account. This code listens to
+ *  transaction change events and adds the texts of the changed
+ *  transactions to the quickfills of their accounts. Texts are not
+ *  removed when transactions are deleted.
+ *
+ * \param account The account
+ * \param field Which texts the quickfill holds
+ *
+ * \return The shared QuickFill object, which is owned by the book.
+ */
+QuickFill * gnc_get_shared_trans_quickfill (Account *account,
+        GncTransQuickFillField field);
+
+#endif
+
+/** @} */
+/** @} */
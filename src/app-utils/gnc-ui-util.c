@@ -1328,6 +1328,140 @@ gnc_integral_print_info (void)
     return info;
 }
 
+/* The first character of each of the locale's separators, which is all
+ * that amounts are printed with, read once since gnc_localeconv() doesn't
+ * change either. */
+typedef struct
+{
+    char decimal_point[8];
+    char thousands_sep[8];
+    const char *grouping;
+} GNCNumberSeparators;
+
+static const GNCNumberSeparators *
+gnc_number_separators (gboolean monetary)
+{
+    static GNCNumberSeparators seps[2];
+    static gboolean seps_set = FALSE;
+
+    if (!seps_set)
+    {
+        struct lconv *lc = gnc_localeconv();
+
+        g_utf8_strncpy (seps[0].decimal_point, lc->decimal_point, 1);
+        g_utf8_strncpy (seps[0].thousands_sep, lc->thousands_sep, 1);
+        seps[0].grouping = lc->grouping;
+        g_utf8_strncpy (seps[1].decimal_point, lc->mon_decimal_point, 1);
+        g_utf8_strncpy (seps[1].thousands_sep, lc->mon_thousands_sep, 1);
+        seps[1].grouping = lc->mon_grouping;
+        seps_set = TRUE;
+    }
+    return &seps[monetary ? 1 : 0];
+}
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Writes the decimal digits of n backwards from just before end, two at a
+ * time, and returns where they start. */
+static char *
+print_digits_backwards (char *end, guint64 n)
+{
+    while (n >= 100)
+    {
+        guint pair = (n % 100) * 2;
+        n /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+    if (n >= 10)
+    {
+        *--end = digit_pairs[n * 2 + 1];
+        *--end = digit_pairs[n * 2];
+    }
+    else
+        *--end = '0' + n;
+    return end;
+}
+
+/* Prints a non-negative decimal val, whose denominator is a power of ten,
+ * as PrintAmountInternal would, without its gnc_numeric arithmetic or
+ * string reversal. */
+static int
+PrintDecimalAmount (char *buf, gnc_numeric val, int min_dp, int max_dp,
+                    const GNCPrintAmountInfo *info)
+{
+    const GNCNumberSeparators *seps = gnc_number_separators (info->monetary);
+    guint64 denom = val.denom, frac = (guint64)val.num % denom;
+    char digit_buf[24], whole_buf[128], frac_buf[128];
+    char *digits_end = digit_buf + sizeof (digit_buf);
+    char *digits = print_digits_backwards (digits_end,
+                                           (guint64)val.num / denom);
+    char *out = buf;
+    int places = 0;
+
+    /* The whole part, with the separators put in from the right */
+    if (!info->use_separators || !seps->thousands_sep[0])
+    {
+        memcpy (out, digits, digits_end - digits);
+        out += digits_end - digits;
+    }
+    else
+    {
+        const char *group = seps->grouping;
+        size_t sep_len = strlen (seps->thousands_sep);
+        char *end = whole_buf + sizeof (whole_buf);
+        char *digit = digits_end;
+        char *p = end;
+        int group_count = 0;
+
+        while (digit != digits)
+        {
+            *--p = *--digit;
+            if (digit == digits || *group == CHAR_MAX)
+                continue;
+            if (++group_count == *group)
+            {
+                p -= sep_len;
+                memcpy (p, seps->thousands_sep, sep_len);
+                group_count = 0;
+                /* A NUL repeats the last group size indefinitely */
+                if (group[1] != '\0')
+                    group++;
+            }
+        }
+        memcpy (out, p, end - p);
+        out += end - p;
+    }
+
+    /* The fraction, to max_dp places and with the trailing zeros beyond
+     * min_dp taken off */
+    for (; denom > 1; denom /= 10)
+        places++;
+    if (places > 0)
+    {
+        char *p = print_digits_backwards (frac_buf + places, frac);
+        while (p > frac_buf)
+            *--p = '0';
+    }
+    if (places > max_dp)
+        places = max_dp;
+    while (places > min_dp && frac_buf[places - 1] == '0')
+        places--;
+    while (places < min_dp)
+        frac_buf[places++] = '0';
+    if (places > 0)
+    {
+        out = g_stpcpy (out, seps->decimal_point);
+        memcpy (out, frac_buf, places);
+        out += places;
+    }
+    *out = '\0';
+    return out - buf;
+}
+
 /* Utility function for printing non-negative amounts */
 static int
 PrintAmountInternal(char *buf, gnc_numeric val, const GNCPrintAmountInfo *info)
@@ -1389,6 +1523,11 @@ PrintAmountInternal(char *buf, gnc_numeric val, const GNCPrintAmountInfo *info)
         }
     }
 
+    /* Most amounts are in a decimal currency and print without any
+     * gnc_numeric arithmetic. */
+    if (value_is_decimal && val.denom > 0 && min_dp <= max_dp)
+        return PrintDecimalAmount (buf, val, min_dp, max_dp, info);
+
     /* calculate the integer part and the remainder */
     whole = gnc_numeric_convert(val, 1, GNC_HOW_RND_TRUNC);
     val = gnc_numeric_sub (val, whole, GNC_DENOM_AUTO, GNC_HOW_RND_NEVER);
@@ -1924,6 +2063,204 @@ multiplier (int num_decimals)
     return 1;
 }
 
+/* The state machine below for the common case of ASCII input and
+ * separators, accumulating the digits as it goes instead of copying them
+ * out for sscanf.  Returns FALSE, leaving the outputs alone, whenever the
+ * state machine should decide: for non-ASCII text, whitespace separators,
+ * malformed numbers and numbers too large for an int64. */
+static gboolean
+parse_ascii_amount (const char *in_str, gunichar negative_sign,
+                    gunichar decimal_point, gunichar group_separator,
+                    const char *group, const char *ignore_list,
+                    long long int *numer_out, long long int *denom_out,
+                    gboolean *got_decimal_out, gboolean *is_negative_out,
+                    const char **end_out)
+{
+    int groups[32];
+    int num_groups = 0, group_count = 0, frac_len = 0, i;
+    long long int numer = 0, fraction = 0, denom = 1;
+    gboolean is_negative = FALSE, got_decimal = FALSE, need_paren = FALSE;
+    ParseState state = START_ST;
+    const char *in, *rest;
+
+    if (negative_sign == 0 || negative_sign >= 0x80 ||
+            decimal_point == 0 || decimal_point >= 0x80 ||
+            g_ascii_isspace (decimal_point) ||
+            group_separator == 0 || group_separator >= 0x80 ||
+            g_ascii_isspace (group_separator))
+        return FALSE;
+
+    for (in = in_str; ; in++)
+    {
+        unsigned char c = *in;
+
+        if (c >= 0x80)
+            return FALSE;
+        if (ignore_list && c && strchr (ignore_list, c) != NULL)
+            continue;
+
+        if (g_ascii_isdigit (c))
+        {
+            if (state == FRAC_ST)
+            {
+                /* Like the state machine, keep eight places at most */
+                if (frac_len < 8)
+                {
+                    fraction = fraction * 10 + (c - '0');
+                    frac_len++;
+                }
+                continue;
+            }
+            if (numer > (G_MAXINT64 - (c - '0')) / 10)
+                return FALSE;
+            numer = numer * 10 + (c - '0');
+            if (state == START_GROUP_ST || state == IN_GROUP_ST)
+            {
+                group_count++;
+                state = IN_GROUP_ST;
+            }
+            else
+                state = PRE_GROUP_ST;
+            continue;
+        }
+
+        switch (state)
+        {
+        case START_ST:
+            if (c == decimal_point)
+                state = FRAC_ST;
+            else if (g_ascii_isspace (c))
+                ;
+            else if (c == negative_sign)
+            {
+                is_negative = TRUE;
+                state = NEG_ST;
+            }
+            else if (c == '(')
+            {
+                is_negative = TRUE;
+                need_paren = TRUE;
+                state = NEG_ST;
+            }
+            else
+                return FALSE;
+            break;
+
+        case NEG_ST:
+            if (c == decimal_point)
+                state = FRAC_ST;
+            else if (!g_ascii_isspace (c))
+                return FALSE;
+            break;
+
+        case PRE_GROUP_ST:
+        case IN_GROUP_ST:
+            if (state == IN_GROUP_ST)
+            {
+                if ((guint) num_groups == G_N_ELEMENTS (groups))
+                    return FALSE;
+                groups[num_groups++] = group_count;
+                group_count = 0;
+            }
+            if (c == decimal_point)
+                state = FRAC_ST;
+            else if (c == group_separator)
+                state = START_GROUP_ST;
+            else
+            {
+                if (c == ')' && need_paren)
+                    need_paren = FALSE;
+                state = DONE_ST;
+            }
+            break;
+
+        case FRAC_ST:
+            if (c == decimal_point || c == group_separator)
+                return FALSE;
+            if (c == ')' && need_paren)
+                need_paren = FALSE;
+            state = DONE_ST;
+            break;
+
+        default:
+            return FALSE;
+        }
+
+        if (state == FRAC_ST)
+            got_decimal = TRUE;
+        else if (state == DONE_ST)
+            break;
+    }
+
+    /* The state machine rejects the whole string if any of it is not
+     * UTF-8, so anything past the number has to be plain ASCII too. */
+    for (rest = in; *rest; rest++)
+        if ((unsigned char) *rest >= 0x80)
+            return FALSE;
+
+    if (need_paren)
+        return FALSE;
+
+    /* The groups are checked from the decimal point leftwards */
+    for (i = num_groups - 1; group && i >= 0; i--)
+    {
+        if (*group != groups[i])
+            return FALSE;
+        if (group[1] == CHAR_MAX)
+        {
+            if (i > 0)
+                return FALSE;
+        }
+        else if (group[1] != '\0')
+            group++;
+    }
+
+    if (frac_len > 0)
+    {
+        denom = multiplier (frac_len);
+        if (numer > (G_MAXINT64 - fraction) / denom)
+            return FALSE;
+        numer = numer * denom + fraction;
+    }
+
+    *numer_out = numer;
+    *denom_out = denom;
+    *got_decimal_out = got_decimal;
+    *is_negative_out = is_negative;
+    *end_out = in;
+    return TRUE;
+}
+
+/* Sets result, which may be NULL, to the parsed number, applying the
+ * auto decimal point preference to a monetary number typed without a
+ * decimal point. */
+static void
+set_parsed_amount (gboolean monetary, long long int numer,
+                   long long int denom, gboolean got_decimal,
+                   gboolean is_negative, gnc_numeric *result)
+{
+    if (monetary && auto_decimal_enabled && !got_decimal)
+    {
+        if ((auto_decimal_places > 0) && (auto_decimal_places < 9))
+        {
+            denom = multiplier(auto_decimal_places);
+
+            /* No need to multiply numer by denom at this point,
+             * since by specifying the auto decimal places the
+             * user has effectively determined the scaling factor
+             * for the numerator they entered.
+             */
+        }
+    }
+
+    if (result != NULL)
+    {
+        *result = gnc_numeric_create (numer, denom);
+        if (is_negative)
+            *result = gnc_numeric_neg (*result);
+    }
+}
+
 gboolean
 xaccParseAmount (const char * in_str, gboolean monetary, gnc_numeric *result,
                  char **endstr)
@@ -1985,6 +2322,17 @@ xaccParseAmountExtended (const char * in_str, gboolean monetary,
     if (in_str == NULL)
         return FALSE;
 
+    if (parse_ascii_amount (in_str, negative_sign, decimal_point,
+                            group_separator, group, ignore_list, &numer,
+                            &denom, &got_decimal, &is_negative, &in))
+    {
+        set_parsed_amount (monetary, numer, denom, got_decimal, is_negative,
+                           result);
+        if (endstr != NULL)
+            *endstr = (char *) in;
+        return TRUE;
+    }
+
     if (!g_utf8_validate(in_str, -1, &in))
     {
         printf("Invalid utf8 string '%s'. Bad character at position %ld.\n",
@@ -2353,26 +2701,9 @@ xaccParseAmountExtended (const char * in_str, gboolean monetary,
         numer *= denom;
         numer += fraction;
     }
-    else if (monetary && auto_decimal_enabled && !got_decimal)
-    {
-        if ((auto_decimal_places > 0) && (auto_decimal_places < 9))
-        {
-            denom = multiplier(auto_decimal_places);
 
-            /* No need to multiply numer by denom at this point,
-             * since by specifying the auto decimal places the
-             * user has effectively determined the scaling factor
-             * for the numerator they entered.
-             */
-        }
-    }
-
-    if (result != NULL)
-    {
-        *result = gnc_numeric_create (numer, denom);
-        if (is_negative)
-            *result = gnc_numeric_neg (*result);
-    }
+    set_parsed_amount (monetary, numer, denom, got_decimal, is_negative,
+                       result);
 
     if (endstr != NULL)
         *endstr = (char *) in;
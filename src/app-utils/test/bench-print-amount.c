@@ -0,0 +1,152 @@
+/***************************************************************************
+ *            bench-print-amount.c
+ *
+ *  Timings of xaccSPrintAmount and xaccParseAmountExtended
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+/* bench-print-amount prints --count amounts drawn from --seed with each
+ * of the print infos the register and reports use, parses them back as
+ * the CSV importer does, and reports one JSON object per line:
+ *
+ *   {"benchmark":"print-currency","iterations":1000000,"seconds":0.21}
+ */
+#include "config.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "qof.h"
+#include "gnc-ui-util.h"
+
+static gint count = 1000000;
+static gint seed = 1;
+
+static GOptionEntry bench_options[] =
+{
+    { "count", 'n', 0, G_OPTION_ARG_INT, &count,
+      "Amounts printed by each benchmark", "N" },
+    { "seed", 'r', 0, G_OPTION_ARG_INT, &seed,
+      "Seed for the amounts", "N" },
+    { NULL }
+};
+
+static void
+bench_report (const char *name, gint iterations, gint64 usecs)
+{
+    printf ("{\"benchmark\":\"%s\",\"iterations\":%d,\"seconds\":%.6f}\n",
+            name, iterations, usecs / (double) G_USEC_PER_SEC);
+    fflush (stdout);
+}
+
+static void
+bench_print (const char *name, const gnc_numeric *amounts,
+             GNCPrintAmountInfo info)
+{
+    char buf[64];
+    gint64 start = g_get_monotonic_time ();
+    gint i;
+
+    for (i = 0; i < count; i++)
+        xaccSPrintAmount (buf, amounts[i], info);
+    bench_report (name, count, g_get_monotonic_time () - start);
+}
+
+static void
+bench_parse (const char *name, const gnc_numeric *amounts,
+             GNCPrintAmountInfo info)
+{
+    gchar **strings = g_new (gchar *, count);
+    gint64 start;
+    gint i;
+
+    for (i = 0; i < count; i++)
+        strings[i] = g_strdup (xaccPrintAmount (amounts[i], info));
+    start = g_get_monotonic_time ();
+    for (i = 0; i < count; i++)
+    {
+        gnc_numeric n;
+        char *end;
+        xaccParseAmountExtended (strings[i], TRUE, '-', '.', ',', "\003\003",
+                                 "$+", &n, &end);
+    }
+    bench_report (name, count, g_get_monotonic_time () - start);
+    for (i = 0; i < count; i++)
+        g_free (strings[i]);
+    g_free (strings);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context = g_option_context_new ("- amount printing benchmarks");
+    GError *error = NULL;
+    GNCPrintAmountInfo info;
+    gnc_numeric *cents, *shares, *fractions;
+    gint i;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+    count = MAX (count, 1);
+
+    qof_init ();
+    srand (seed);
+    printf ("{\"parameters\":{\"count\":%d,\"seed\":%d}}\n", count, seed);
+
+    /* Register-sized amounts, up to ten million, some negative. */
+    cents = g_new (gnc_numeric, count);
+    shares = g_new (gnc_numeric, count);
+    fractions = g_new (gnc_numeric, count);
+    for (i = 0; i < count; i++)
+    {
+        gint64 num = ((gint64) rand () << 8 ^ rand ()) % G_GINT64_CONSTANT (1000000000);
+        if (rand () % 4 == 0)
+            num = -num;
+        cents[i] = gnc_numeric_create (num, 100);
+        shares[i] = gnc_numeric_create (num, 10000);
+        fractions[i] = gnc_numeric_create (num, 96);
+    }
+
+    /* As gnc_commodity_print_info() sets it up for a two-place currency,
+     * less the commodity, which would need a book. */
+    info = gnc_default_share_print_info ();
+    info.min_decimal_places = info.max_decimal_places = 2;
+    bench_print ("print-currency", cents, info);
+    info.use_separators = 0;
+    bench_print ("print-currency-plain", cents, info);
+    bench_print ("print-shares", shares, gnc_default_share_print_info ());
+    bench_print ("print-shares-fixed", shares, gnc_share_print_info_places (2));
+    bench_print ("print-fraction", fractions, gnc_default_share_print_info ());
+
+    /* Parsed with the importer's US separators, which are the C
+     * locale's as gnc_localeconv() fills them in. */
+    bench_parse ("parse-plain", cents, info);
+    info.use_separators = 1;
+    bench_parse ("parse-grouped", cents, info);
+
+    g_free (cents);
+    g_free (shares);
+    g_free (fractions);
+    qof_close ();
+    return 0;
+}
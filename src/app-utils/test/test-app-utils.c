@@ -28,6 +28,8 @@
 
 extern void test_suite_option_util (void);
 extern void test_suite_gnc_ui_util (void);
+extern void test_suite_gnc_qif_formats (void);
+extern void test_suite_quickfill (void);
 
 static void
 guile_main (void *closure, int argc, char **argv)
@@ -39,6 +41,8 @@ guile_main (void *closure, int argc, char **argv)
 
     test_suite_option_util ();
     test_suite_gnc_ui_util ();
+    test_suite_gnc_qif_formats ();
+    test_suite_quickfill ();
     retval = g_test_run ();
 
     exit (retval);
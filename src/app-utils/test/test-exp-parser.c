@@ -246,12 +246,54 @@ test_variable_expressions()
     success("variable found");
 }
 
+static void
+test_compiled_expressions()
+{
+    GncExpProgram *prog;
+    gnc_numeric values[2], num;
+    gchar *errLoc = NULL;
+    GHashTable *vars;
+
+    prog = gnc_exp_parser_compile("a * 2 - -b", &errLoc);
+    do_test(prog != NULL && errLoc == NULL, "compiling");
+    do_test(gnc_exp_program_get_num_variables(prog) == 2, "two variables");
+    do_test(g_strcmp0(gnc_exp_program_get_variable_name(prog, 0), "a") == 0
+            && g_strcmp0(gnc_exp_program_get_variable_name(prog, 1), "b") == 0,
+            "variables in order");
+
+    values[0] = gnc_numeric_create(7, 2);
+    values[1] = gnc_numeric_create(3, 1);
+    do_test(gnc_exp_program_evaluate(prog, values, &num)
+            && gnc_numeric_equal(num, gnc_numeric_create(10, 1)), "evaluating");
+    values[1] = gnc_numeric_create(-1, 4);
+    do_test(gnc_exp_program_evaluate(prog, values, &num)
+            && gnc_numeric_equal(num, gnc_numeric_create(27, 4)),
+            "evaluating again");
+    gnc_exp_program_free(prog);
+
+    do_test(gnc_exp_parser_compile("(a = 42) + a", NULL) == NULL,
+            "assignments aren't compiled");
+    do_test(gnc_exp_parser_compile("1 +", &errLoc) == NULL, "syntax error");
+
+    /* The second parse is evaluated from the compiled expression. */
+    vars = g_hash_table_new(g_str_hash, g_str_equal);
+    do_test(gnc_exp_parser_parse_separate_vars("5 / x", &num, &errLoc, vars)
+            == FALSE, "new variable is zero");
+    do_test(g_hash_table_size(vars) == 1, "new variable added");
+    *(gnc_numeric*)g_hash_table_lookup(vars, "x") = gnc_numeric_create(2, 1);
+    do_test(gnc_exp_parser_parse_separate_vars("5 / x", &num, &errLoc, vars)
+            && gnc_numeric_equal(num, gnc_numeric_create(5, 2)),
+            "variable from the hash");
+    success("compiled expressions");
+}
+
 static void
 real_main (void *closure, int argc, char **argv)
 {
     /* set_should_print_success (TRUE); */
     test_parser();
     test_variable_expressions();
+    test_compiled_expressions();
     print_test_results();
     exit(get_rv());
 }
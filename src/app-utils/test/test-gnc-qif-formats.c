@@ -0,0 +1,185 @@
+/********************************************************************
+ * test-gnc-qif-formats.c: GLib g_test test suite for               *
+ * gnc-qif-formats.c.                                               *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+#include <qof.h>
+
+#include "../gnc-qif-formats.h"
+
+static const gchar *suitename = "/app-utils/gnc-qif-formats";
+void test_suite_gnc_qif_formats (void);
+
+#define ALL_DATES (GNC_QIF_DATE_M_D_Y | GNC_QIF_DATE_D_M_Y | \
+                   GNC_QIF_DATE_Y_M_D | GNC_QIF_DATE_Y_D_M)
+#define ALL_NUMBERS (GNC_QIF_NUMBER_DECIMAL | GNC_QIF_NUMBER_COMMA | \
+                     GNC_QIF_NUMBER_INTEGER)
+
+static void
+test_check_date_format (void)
+{
+    g_assert_cmpuint (gnc_qif_check_date_format ("1/2/2003", ALL_DATES), ==,
+                      GNC_QIF_DATE_M_D_Y | GNC_QIF_DATE_D_M_Y);
+    g_assert_cmpuint (gnc_qif_check_date_format ("13/2/2003", ALL_DATES), ==,
+                      GNC_QIF_DATE_D_M_Y);
+    g_assert_cmpuint (gnc_qif_check_date_format ("2003-01-22", ALL_DATES), ==,
+                      GNC_QIF_DATE_Y_M_D);
+    /* Quicken's "' 3" for 2003. */
+    g_assert_cmpuint (gnc_qif_check_date_format ("12/25' 3",
+                      GNC_QIF_DATE_M_D_Y), ==, GNC_QIF_DATE_M_D_Y);
+    /* Eight digits may have the year at either end. */
+    g_assert_cmpuint (gnc_qif_check_date_format ("20030122", ALL_DATES), ==,
+                      GNC_QIF_DATE_Y_M_D);
+    g_assert_cmpuint (gnc_qif_check_date_format ("01222003", ALL_DATES), ==,
+                      GNC_QIF_DATE_M_D_Y);
+    /* Only the formats asked about come back. */
+    g_assert_cmpuint (gnc_qif_check_date_format ("1/2/2003",
+                      GNC_QIF_DATE_Y_M_D), ==, 0);
+    g_assert_cmpuint (gnc_qif_check_date_format ("1/2", ALL_DATES), ==, 0);
+    g_assert_cmpuint (gnc_qif_check_date_format ("today", ALL_DATES), ==, 0);
+}
+
+static void
+test_parse_date (void)
+{
+    gint day, month, year;
+
+    g_assert (gnc_qif_parse_date ("1/2/2003", GNC_QIF_DATE_M_D_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (day, ==, 2);
+    g_assert_cmpint (month, ==, 1);
+    g_assert_cmpint (year, ==, 2003);
+    g_assert (gnc_qif_parse_date ("1/2/2003", GNC_QIF_DATE_D_M_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (day, ==, 1);
+    g_assert_cmpint (month, ==, 2);
+    g_assert (gnc_qif_parse_date ("20030122", GNC_QIF_DATE_Y_M_D,
+                                  &day, &month, &year));
+    g_assert_cmpint (day, ==, 22);
+    g_assert_cmpint (month, ==, 1);
+    g_assert_cmpint (year, ==, 2003);
+
+    /* Two-digit years, and years since 1900. */
+    g_assert (gnc_qif_parse_date ("1/2/98", GNC_QIF_DATE_M_D_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (year, ==, 1998);
+    g_assert (gnc_qif_parse_date ("1/2/03", GNC_QIF_DATE_M_D_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (year, ==, 2003);
+    g_assert (gnc_qif_parse_date ("1/2/103", GNC_QIF_DATE_M_D_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (year, ==, 2003);
+    g_assert (gnc_qif_parse_date ("1/2/19103", GNC_QIF_DATE_M_D_Y,
+                                  &day, &month, &year));
+    g_assert_cmpint (year, ==, 2003);
+}
+
+static void
+test_parse_date_bad (void)
+{
+    guint log_level = G_LOG_LEVEL_WARNING | G_LOG_FLAG_FATAL;
+    gchar *log_domain = "gnc.app-utils";
+    gchar *msg1 = "[gnc_qif_parse_date()] date [13/13/98] is not in format 1";
+    gchar *msg2 = "[gnc_qif_parse_date()] can't interpret date [today]";
+    TestErrorStruct check = { log_level, log_domain, msg1, 0 };
+    GLogFunc oldlogger;
+    gint day, month, year;
+
+    oldlogger = g_log_set_default_handler ((GLogFunc)test_null_handler, &check);
+    g_test_log_set_fatal_handler ((GTestLogFatalFunc)test_checked_handler,
+                                  &check);
+    g_assert (!gnc_qif_parse_date ("13/13/98", GNC_QIF_DATE_M_D_Y,
+                                   &day, &month, &year));
+    g_assert_cmpint (check.hits, ==, 1);
+    check.msg = msg2;
+    g_assert (!gnc_qif_parse_date ("today", GNC_QIF_DATE_M_D_Y,
+                                   &day, &month, &year));
+    g_assert_cmpint (check.hits, ==, 2);
+    g_log_set_default_handler (oldlogger, NULL);
+}
+
+static void
+test_check_number_format (void)
+{
+    g_assert_cmpuint (gnc_qif_check_number_format ("1234", ALL_NUMBERS), ==,
+                      ALL_NUMBERS);
+    g_assert_cmpuint (gnc_qif_check_number_format ("1,234.56", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpuint (gnc_qif_check_number_format ("1.234,56", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_COMMA);
+    g_assert_cmpuint (gnc_qif_check_number_format ("-$12.50", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpuint (gnc_qif_check_number_format ("12.50-", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpuint (gnc_qif_check_number_format (" 1'234.5 ", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_DECIMAL);
+    /* A group has to have three digits. */
+    g_assert_cmpuint (gnc_qif_check_number_format ("1,2345", ALL_NUMBERS),
+                      ==, GNC_QIF_NUMBER_COMMA);
+    g_assert_cmpuint (gnc_qif_check_number_format ("1234.5.6", ALL_NUMBERS),
+                      ==, 0);
+    g_assert_cmpuint (gnc_qif_check_number_format ("1,234.56",
+                      GNC_QIF_NUMBER_COMMA), ==, 0);
+}
+
+static void
+test_parse_number (void)
+{
+    gnc_numeric n;
+
+    n = gnc_qif_parse_number ("1,234.56", GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpint (n.num, ==, 123456);
+    g_assert_cmpint (n.denom, ==, 100);
+    n = gnc_qif_parse_number ("1.234,56", GNC_QIF_NUMBER_COMMA);
+    g_assert_cmpint (n.num, ==, 123456);
+    g_assert_cmpint (n.denom, ==, 100);
+    n = gnc_qif_parse_number ("-$12.50", GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpint (n.num, ==, -1250);
+    g_assert_cmpint (n.denom, ==, 100);
+    n = gnc_qif_parse_number ("12.5-", GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpint (n.num, ==, -125);
+    g_assert_cmpint (n.denom, ==, 10);
+    n = gnc_qif_parse_number ("1'000", GNC_QIF_NUMBER_DECIMAL);
+    g_assert_cmpint (n.num, ==, 1000);
+    g_assert_cmpint (n.denom, ==, 1);
+    n = gnc_qif_parse_number ("42", GNC_QIF_NUMBER_INTEGER);
+    g_assert_cmpint (n.num, ==, 42);
+    g_assert_cmpint (n.denom, ==, 1);
+    g_assert (gnc_numeric_zero_p (gnc_qif_parse_number ("",
+                                  GNC_QIF_NUMBER_DECIMAL)));
+    g_assert (gnc_numeric_zero_p (gnc_qif_parse_number ("$",
+                                  GNC_QIF_NUMBER_DECIMAL)));
+}
+
+void
+test_suite_gnc_qif_formats (void)
+{
+    GNC_TEST_ADD_FUNC (suitename, "check date format", test_check_date_format);
+    GNC_TEST_ADD_FUNC (suitename, "parse date", test_parse_date);
+    GNC_TEST_ADD_FUNC (suitename, "parse bad date", test_parse_date_bad);
+    GNC_TEST_ADD_FUNC (suitename, "check number format",
+                       test_check_number_format);
+    GNC_TEST_ADD_FUNC (suitename, "parse number", test_parse_number);
+}
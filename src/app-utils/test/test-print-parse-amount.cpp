@@ -27,6 +27,7 @@ extern "C"
 
 #include "gnc-ui-util.h"
 #include "gnc-numeric.h"
+#include "gnc-locale-utils.h"
 #include "test-engine-stuff.h"
 #include "test-stuff.h"
 #include <unittest-support.h>
@@ -153,9 +154,102 @@ run_tests (void)
     }
 }
 
+static void
+test_print_decimal (gint64 num, gint64 denom, int min_dp, int max_dp,
+                    gboolean force_fit, const char *whole, const char *frac,
+                    int line)
+{
+    GNCPrintAmountInfo print_info;
+    char buf[64];
+
+    print_info.commodity = NULL;
+    print_info.min_decimal_places = min_dp;
+    print_info.max_decimal_places = max_dp;
+    print_info.use_separators = 0;
+    print_info.use_symbol = 0;
+    print_info.use_locale = 1;
+    print_info.monetary = 0;
+    print_info.force_fit = force_fit;
+    print_info.round = 0;
+
+    auto expected = frac ? g_strdup_printf ("%s%.1s%s", whole,
+                                            gnc_localeconv ()->decimal_point,
+                                            frac)
+                         : g_strdup (whole);
+    xaccSPrintAmount (buf, gnc_numeric_create (num, denom), print_info);
+    do_test_args (g_strcmp0 (buf, expected) == 0, "decimal printing",
+                  __FILE__, __LINE__, "expected %s, got %s (line %d)",
+                  expected, buf, line);
+    g_free (expected);
+}
+
+static void
+run_decimal_tests (void)
+{
+    test_print_decimal (1234567, 100, 2, 2, FALSE, "12345", "67", __LINE__);
+    test_print_decimal (5, 1, 2, 2, FALSE, "5", "00", __LINE__);
+    test_print_decimal (1230, 1000, 0, 3, FALSE, "1", "23", __LINE__);
+    test_print_decimal (1000, 1000, 0, 3, FALSE, "1", NULL, __LINE__);
+    test_print_decimal (7, 1000, 2, 3, FALSE, "0", "007", __LINE__);
+    test_print_decimal (1299, 1000, 0, 1, TRUE, "1", "2", __LINE__);
+    test_print_decimal (G_GINT64_CONSTANT (9223372036854775807), 1, 0, 0,
+                        FALSE, "9223372036854775807", NULL, __LINE__);
+}
+
+static void
+test_parse_extended (const char *in, const char *ignore, gboolean ok,
+                     gint64 num, gint64 denom, int end, int line)
+{
+    gnc_numeric n = gnc_numeric_zero ();
+    char *endstr = NULL;
+    gboolean parsed = xaccParseAmountExtended (in, FALSE, '-', '.', ',',
+                                               (char *) "\003", (char *) ignore,
+                                               &n, &endstr);
+    do_test_args (parsed == ok, "extended parsing", __FILE__, __LINE__,
+                  "%s: expected %s (line %d)", in, ok ? "success" : "failure",
+                  line);
+    if (!ok || !parsed)
+        return;
+    do_test_args (gnc_numeric_equal (n, gnc_numeric_create (num, denom)) &&
+                  n.denom == denom, "extended parsing", __FILE__, __LINE__,
+                  "%s: expected %" G_GINT64_FORMAT "/%" G_GINT64_FORMAT
+                  ", got %" G_GINT64_FORMAT "/%" G_GINT64_FORMAT " (line %d)",
+                  in, num, denom, n.num, n.denom, line);
+    do_test_args (endstr == in + end, "extended parsing end", __FILE__,
+                  __LINE__, "%s: expected end at %d, got %d (line %d)", in,
+                  end, (int) (endstr - in), line);
+}
+
+/* The ASCII inputs go through the fast path, the rest through the state
+ * machine; both have to agree on the edge cases. */
+static void
+run_parse_extended_tests (void)
+{
+    test_parse_extended ("1234.56", NULL, TRUE, 123456, 100, 7, __LINE__);
+    test_parse_extended ("  -1,234,567.8", NULL, TRUE, -12345678, 10, 14,
+                         __LINE__);
+    test_parse_extended ("(1,234.50)", NULL, TRUE, -123450, 100, 9, __LINE__);
+    test_parse_extended ("(1,234.50", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("1,23", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("1,234,", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("1.2.3", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("$1,234.5+", "$+", TRUE, 12345, 10, 9, __LINE__);
+    test_parse_extended ("12 USD", NULL, TRUE, 12, 1, 2, __LINE__);
+    test_parse_extended ("12.", NULL, TRUE, 12, 1, 3, __LINE__);
+    test_parse_extended (".5", NULL, TRUE, 5, 10, 2, __LINE__);
+    test_parse_extended ("0.123456789", NULL, TRUE, 12345678, 100000000, 11,
+                         __LINE__);
+    test_parse_extended ("12 \xe2\x82\xac", NULL, TRUE, 12, 1, 2, __LINE__);
+    test_parse_extended ("\xe2\x82\xac" "12", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("12\xff", NULL, FALSE, 0, 1, 0, __LINE__);
+    test_parse_extended ("abc", NULL, FALSE, 0, 1, 0, __LINE__);
+}
+
 int
 main (int argc, char **argv)
 {
+    run_decimal_tests ();
+    run_parse_extended_tests ();
     run_tests ();
     print_test_results ();
     exit (get_rv ());
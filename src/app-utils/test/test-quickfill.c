@@ -0,0 +1,137 @@
+/********************************************************************
+ * test-quickfill.c: GLib g_test test suite for QuickFill.c.        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+
+#include <config.h>
+#include <glib.h>
+#include <unittest-support.h>
+
+#include "../QuickFill.h"
+
+static const gchar *suitename = "/app-utils/quickfill";
+void test_suite_quickfill (void);
+
+typedef struct
+{
+    QuickFill *qf;
+} Fixture;
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    fixture->qf = gnc_quickfill_new ();
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    gnc_quickfill_destroy (fixture->qf);
+}
+
+static void
+test_quickfill_match (Fixture *fixture, gconstpointer pData)
+{
+    QuickFill *qf = fixture->qf, *match;
+
+    gnc_quickfill_insert (qf, "Groceries", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "Gas", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "Rent", QUICKFILL_LIFO);
+
+    match = gnc_quickfill_get_string_match (qf, "gr");
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Groceries");
+    match = gnc_quickfill_get_string_match (qf, "RE");
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Rent");
+    /* The latest insertion wins for a common prefix. */
+    match = gnc_quickfill_get_char_match (qf, 'g');
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Gas");
+    g_assert (gnc_quickfill_get_string_match (qf, "Gx") == NULL);
+    g_assert (gnc_quickfill_get_string_match (qf, "Rents") == NULL);
+}
+
+static void
+test_quickfill_sort (Fixture *fixture, gconstpointer pData)
+{
+    QuickFill *qf = fixture->qf, *match;
+
+    gnc_quickfill_insert (qf, "Beta", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "Bank", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "Bus", QUICKFILL_ALPHA);
+
+    match = gnc_quickfill_get_char_match (qf, 'b');
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Bank");
+    match = gnc_quickfill_get_string_match (qf, "Be");
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Beta");
+
+    /* Longer texts don't replace their prefixes. */
+    gnc_quickfill_insert (qf, "Car", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "Cart", QUICKFILL_LIFO);
+    match = gnc_quickfill_get_string_match (qf, "Car");
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Car");
+}
+
+static void
+test_quickfill_unique_len (Fixture *fixture, gconstpointer pData)
+{
+    QuickFill *qf = fixture->qf, *match;
+    int len;
+
+    gnc_quickfill_insert (qf, "The Book", QUICKFILL_LIFO);
+    gnc_quickfill_insert (qf, "The Movie", QUICKFILL_LIFO);
+
+    match = gnc_quickfill_get_unique_len_match (qf, &len);
+    g_assert_cmpint (len, ==, 4);
+    match = gnc_quickfill_get_char_match (match, 'B');
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "The Book");
+}
+
+static void
+test_quickfill_remove (Fixture *fixture, gconstpointer pData)
+{
+    QuickFill *qf = fixture->qf, *match;
+
+    gnc_quickfill_insert (qf, "Salary", QUICKFILL_ALPHA);
+    gnc_quickfill_insert (qf, "Savings", QUICKFILL_ALPHA);
+
+    gnc_quickfill_remove (qf, "Salary", QUICKFILL_ALPHA);
+    match = gnc_quickfill_get_string_match (qf, "Sa");
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Savings");
+    g_assert (gnc_quickfill_get_string_match (qf, "Sal") == NULL);
+
+    gnc_quickfill_remove (qf, "Savings", QUICKFILL_ALPHA);
+    g_assert (gnc_quickfill_get_char_match (qf, 'S') == NULL);
+
+    gnc_quickfill_insert (qf, "Tax", QUICKFILL_LIFO);
+    gnc_quickfill_purge (qf);
+    g_assert (gnc_quickfill_get_char_match (qf, 'T') == NULL);
+    gnc_quickfill_insert (qf, "Tax", QUICKFILL_LIFO);
+    match = gnc_quickfill_get_char_match (qf, 't');
+    g_assert_cmpstr (gnc_quickfill_string (match), ==, "Tax");
+}
+
+void
+test_suite_quickfill (void)
+{
+    GNC_TEST_ADD (suitename, "match", Fixture, NULL, setup, test_quickfill_match, teardown);
+    GNC_TEST_ADD (suitename, "sort", Fixture, NULL, setup, test_quickfill_sort, teardown);
+    GNC_TEST_ADD (suitename, "unique len", Fixture, NULL, setup, test_quickfill_unique_len, teardown);
+    GNC_TEST_ADD (suitename, "remove", Fixture, NULL, setup, test_quickfill_remove, teardown);
+}
@@ -46,6 +46,7 @@ extern "C"
 
 #include <inttypes.h>
 #include <errno.h>
+#include <stdio.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 
@@ -498,15 +499,21 @@ gnc_dbi_session_begin<DbType::DBI_SQLITE>(QofBackend* qbe, QofSession* session,
         return;
     }
 
+    GncDbiSqlConnection* sql_conn;
     try
     {
-        be->connect(new GncDbiSqlConnection(DbType::DBI_SQLITE,
-                                            qbe, conn, ignore_lock));
+        sql_conn = new GncDbiSqlConnection(DbType::DBI_SQLITE,
+                                           qbe, conn, ignore_lock);
+        be->connect(sql_conn);
     }
     catch (std::runtime_error& err)
     {
         return;
     }
+    /* The write-ahead log leaves -wal and -shm files beside the book while
+     * it's open, so it has to be asked for. */
+    if (g_getenv ("GNC_SQLITE_PERFORMANCE") != nullptr)
+        (void)sql_conn->set_sqlite_profile (SqliteProfile::PERFORMANCE);
 
     /* We should now have a proper session set up.
      * Let's start logging */
@@ -755,6 +762,9 @@ gnc_dbi_session_begin (QofBackend* qbe, QofSession* session,
     {
         return;
     }
+    /* Give the databases written from scratch, and the existing ones when
+     * they're loaded, native GUID columns where the server has them. */
+    be->set_want_native_guids (g_getenv ("GNC_SQL_NATIVE_GUIDS") != nullptr);
     /* We should now have a proper session set up.
      * Let's start logging */
     auto translog_path = gnc_build_translog_path (uri.basename().c_str());
@@ -821,6 +831,8 @@ gnc_dbi_session_end (QofBackend* be_start)
 
     ENTER (" ");
 
+    be->set_shared (0);
+    be->set_write_behind (0);
     be->finalize_version_info ();
     be->connect(nullptr);
 
@@ -868,14 +880,51 @@ gnc_dbi_load (QofBackend* qbe,  QofBook* book, QofBackendLoadType loadType)
         be->init_version_info ();
         assert (be->m_book == nullptr);
 
+        /* Leave the transactions in the database until an account's
+         * splits are asked for. */
+        be->set_load_tx_as_needed (g_getenv ("GNC_SQL_LOAD_TX_AS_NEEDED") != nullptr);
+
+        /* Read only the latest price of each pair, and the earlier ones
+         * when a lookup needs them. */
+        be->set_load_prices_as_needed (g_getenv ("GNC_SQL_LOAD_PRICES_AS_NEEDED") != nullptr);
+
+        /* Or only leave there those posted before a date, as YYYY-MM-DD. */
+        auto cold_before = g_getenv ("GNC_SQL_COLD_BEFORE");
+        if (cold_before != nullptr)
+        {
+            int year, month, day;
+            if (sscanf (cold_before, "%d-%d-%d", &year, &month, &day) == 3)
+                be->set_cold_before (gnc_dmy2timespec (day, month, year).tv_sec);
+            else
+                PWARN ("GNC_SQL_COLD_BEFORE isn't a YYYY-MM-DD date: %s",
+                       cold_before);
+        }
+
+        /* Group the commits made within that many milliseconds into one
+         * database transaction. */
+        auto write_behind = g_getenv ("GNC_SQL_WRITE_BEHIND");
+        if (write_behind != nullptr)
+            be->set_write_behind (g_ascii_strtoull (write_behind, nullptr, 10));
+
         // Call all object backends to create any required tables
         auto registry = gnc_sql_get_backend_registry();
         for (auto entry : registry)
             create_tables(entry, be);
+        be->upgrade_guid_columns ();
     }
 
     gnc_sql_load (be, book, loadType);
 
+    /* Report the lookups the database has no index for. */
+    if (loadType == LOAD_TYPE_INITIAL_LOAD &&
+        g_getenv ("GNC_SQL_ANALYZE") != nullptr)
+        (void)be->analyze_queries ();
+
+    /* Pick up other sessions' transactions every that many seconds. */
+    auto shared = g_getenv ("GNC_SQL_SHARED");
+    if (loadType == LOAD_TYPE_INITIAL_LOAD && shared != nullptr)
+        be->set_shared (g_ascii_strtoull (shared, nullptr, 10));
+
     if (GNUCASH_RESAVE_VERSION > be->get_table_version("Gnucash"))
     {
         /* The database was loaded with an older database schema or
@@ -956,7 +1005,12 @@ gnc_dbi_safe_sync_all (QofBackend* qbe, QofBook* book)
         }
     }
 
+    /* Write the book without syncing, then sync it all at once. */
+    auto profile = conn->sqlite_profile ();
+    if (profile != SqliteProfile::DEFAULT)
+        (void)conn->set_sqlite_profile (SqliteProfile::BULK_LOAD);
     gnc_sql_sync_all (be, book);
+    (void)conn->set_sqlite_profile (profile);
     if (qof_backend_check_error (qbe))
     {
         conn->table_operation (table_list, rollback);
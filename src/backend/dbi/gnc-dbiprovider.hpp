@@ -47,6 +47,9 @@ public:
                                 const GncSqlColumnInfo& info) = 0;
     virtual StrVec get_index_list (dbi_conn conn) = 0;
     virtual void drop_index(dbi_conn conn, const std::string& index) = 0;
+    /** Whether the database's plan for the SELECT reads a whole table
+     * because no index fits.  False if the plan can't be had. */
+    virtual bool is_full_scan(dbi_conn conn, const std::string& sql) = 0;
 };
 
 using GncDbiProviderPtr = std::unique_ptr<GncDbiProvider>;
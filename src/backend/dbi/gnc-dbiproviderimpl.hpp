@@ -38,6 +38,7 @@ public:
     void append_col_def(std::string& ddl, const GncSqlColumnInfo& info);
     StrVec get_index_list (dbi_conn conn);
     void drop_index(dbi_conn conn, const std::string& index);
+    bool is_full_scan(dbi_conn conn, const std::string& sql);
 };
 
 template <DbType T> GncDbiProviderPtr
@@ -191,6 +192,10 @@ GncDbiProviderImpl<DbType::DBI_PGSQL>::append_col_def (std::string& ddl,
     {
         type_name = "timestamp without time zone";
     }
+    else if (info.m_type == BCT_GUID)
+    {
+        type_name = "uuid";
+    }
     else
     {
         PERR ("Unknown column type: %d\n", info.m_type);
@@ -368,4 +373,89 @@ GncDbiProviderImpl<DbType::DBI_MYSQL>::drop_index (dbi_conn conn, const std::str
     if (result)
         dbi_result_free (result);
 }
+
+/* The plan's detail reads "SCAN TABLE splits" or, since 3.36, "SCAN splits"
+ * for a full scan and "SEARCH ..." or "SCAN ... USING INDEX" otherwise. */
+template<> bool
+GncDbiProviderImpl<DbType::DBI_SQLITE>::is_full_scan (dbi_conn conn,
+                                                      const std::string& sql)
+{
+    const char* errmsg;
+    auto result = dbi_conn_queryf (conn, "EXPLAIN QUERY PLAN %s", sql.c_str());
+    if (dbi_conn_error (conn, &errmsg) != DBI_ERROR_NONE)
+    {
+        PWARN ("Query plan error: %s\n", errmsg);
+        return false;
+    }
+    auto retval = false;
+    while (dbi_result_next_row (result) != 0)
+    {
+        auto detail = dbi_result_get_string (result, "detail");
+        if (detail == nullptr)
+            continue;
+        std::string plan{detail};
+        if (plan.compare (0, 5, "SCAN ") == 0 &&
+            plan.find (" INDEX ") == std::string::npos)
+            retval = true;
+    }
+    dbi_result_free (result);
+    return retval;
+}
+
+/* MySQL may well choose a full scan of a small table, so go by whether it
+ * had any index to choose. */
+template<> bool
+GncDbiProviderImpl<DbType::DBI_MYSQL>::is_full_scan (dbi_conn conn,
+                                                     const std::string& sql)
+{
+    const char* errmsg;
+    auto result = dbi_conn_queryf (conn, "EXPLAIN %s", sql.c_str());
+    if (dbi_conn_error (conn, &errmsg) != DBI_ERROR_NONE)
+    {
+        PWARN ("Query plan error: %s\n", errmsg);
+        return false;
+    }
+    auto retval = false;
+    while (dbi_result_next_row (result) != 0)
+    {
+        auto type = dbi_result_get_string (result, "type");
+        auto keys = dbi_result_get_string (result, "possible_keys");
+        if (type != nullptr && std::string{type} == "ALL" && keys == nullptr)
+            retval = true;
+    }
+    dbi_result_free (result);
+    return retval;
+}
+
+/* PostgreSQL too, so it's told to shun sequential scans while planning:
+ * one is left only where no index will do. */
+template<> bool
+GncDbiProviderImpl<DbType::DBI_PGSQL>::is_full_scan (dbi_conn conn,
+                                                     const std::string& sql)
+{
+    const char* errmsg;
+    auto result = dbi_conn_query (conn, "SET enable_seqscan = off");
+    if (result)
+        dbi_result_free (result);
+    result = dbi_conn_queryf (conn, "EXPLAIN %s", sql.c_str());
+    if (dbi_conn_error (conn, &errmsg) != DBI_ERROR_NONE)
+    {
+        PWARN ("Query plan error: %s\n", errmsg);
+        result = nullptr;
+    }
+    auto retval = false;
+    while (result && dbi_result_next_row (result) != 0)
+    {
+        auto line = dbi_result_get_string_idx (result, 1);
+        if (line != nullptr &&
+            std::string{line}.find ("Seq Scan") != std::string::npos)
+            retval = true;
+    }
+    if (result)
+        dbi_result_free (result);
+    result = dbi_conn_query (conn, "RESET enable_seqscan");
+    if (result)
+        dbi_result_free (result);
+    return retval;
+}
 #endif //__GNC_DBISQLPROVIDERIMPL_HPP__
@@ -82,7 +82,10 @@ GncDbiSqlConnection::GncDbiSqlConnection (DbType type, QofBackend* qbe,
                          make_dbi_provider<DbType::DBI_MYSQL>() :
                          make_dbi_provider<DbType::DBI_PGSQL>())},
     m_conn_ok{true}, m_last_error{ERR_BACKEND_NO_ERR}, m_error_repeat{0},
-    m_retry{false}
+    m_retry{false}, m_type{type}, m_sqlite_profile{SqliteProfile::DEFAULT},
+    m_in_transaction{false}, m_prefetch_idle{nullptr},
+    m_prefetch_done{nullptr}, m_prefetch_pool{nullptr}, m_next_prefetch{0},
+    m_select_count{0}, m_nonselect_count{0}
 {
     if (!lock_database(ignore_lock))
         throw std::runtime_error("Failed to lock database!");
@@ -263,6 +266,7 @@ GncDbiSqlConnection::unlock_database ()
 
 GncDbiSqlConnection::~GncDbiSqlConnection()
 {
+    end_prefetch();
     if (m_conn)
     {
         unlock_database();
@@ -277,6 +281,14 @@ GncDbiSqlConnection::execute_select_statement (const GncSqlStatementPtr& stmt)
 {
     dbi_result result;
 
+    ++m_select_count;
+    auto prefetched = take_prefetched (stmt->to_sql());
+    if (prefetched != nullptr)
+    {
+        DEBUG ("SQL: %s (prefetched)\n", stmt->to_sql());
+        return prefetched;
+    }
+
     DEBUG ("SQL: %s\n", stmt->to_sql());
     gnc_push_locale (LC_NUMERIC, "C");
     do
@@ -287,8 +299,147 @@ GncDbiSqlConnection::execute_select_statement (const GncSqlStatementPtr& stmt)
     while (m_retry);
     if (result == nullptr)
         PERR ("Error executing SQL %s\n", stmt->to_sql());
+    /* The result fetches and converts its rows as it's made. */
+    GncSqlResultPtr retval {new GncDbiSqlResult (this, result)};
     gnc_pop_locale (LC_NUMERIC);
-    return GncSqlResultPtr(new GncDbiSqlResult (this, result));
+    return retval;
+}
+
+/* Another connection with the same options, without the error handler,
+ * which reports to the backend from the thread the connection is used
+ * on. */
+static dbi_conn
+clone_connection (dbi_conn conn)
+{
+    auto clone = dbi_conn_open (dbi_conn_get_driver (conn));
+    if (clone == nullptr)
+        return nullptr;
+    for (auto opt = dbi_conn_get_option_list (conn, nullptr); opt != nullptr;
+         opt = dbi_conn_get_option_list (conn, opt))
+    {
+        auto val = dbi_conn_get_option (conn, opt);
+        if (val != nullptr)
+            dbi_conn_set_option (clone, opt, val);
+        else
+            dbi_conn_set_option_numeric (clone, opt,
+                                         dbi_conn_get_option_numeric (conn,
+                                                                      opt));
+    }
+    if (dbi_conn_connect (clone) < 0)
+    {
+        dbi_conn_close (clone);
+        return nullptr;
+    }
+    return clone;
+}
+
+void
+GncDbiSqlConnection::prefetch (const StrVec& queries) noexcept
+{
+    if (m_type == DbType::DBI_SQLITE || m_prefetch_pool != nullptr ||
+        queries.size() < 2)
+        return;
+
+    auto n_conns = std::min<size_t> (queries.size(),
+                                     GNC_DBI_PREFETCH_CONNECTIONS);
+    while (m_prefetch_conns.size() < n_conns)
+    {
+        auto conn = clone_connection (m_conn);
+        if (conn == nullptr)
+            break;
+        m_prefetch_conns.push_back (conn);
+    }
+    if (m_prefetch_conns.empty())
+    {
+        PWARN ("Unable to open another connection, loading without prefetch.");
+        return;
+    }
+
+    m_prefetch_idle = g_async_queue_new ();
+    m_prefetch_done = g_async_queue_new ();
+    for (auto conn : m_prefetch_conns)
+        g_async_queue_push (m_prefetch_idle, conn);
+    /* The drivers read the numbers in the results with the C library,
+     * whose locale is shared with the threads. */
+    gnc_push_locale (LC_NUMERIC, "C");
+    m_prefetch_pool = g_thread_pool_new (prefetch_thread, this,
+                                         m_prefetch_conns.size(), FALSE,
+                                         nullptr);
+    for (auto& sql : queries)
+    {
+        m_prefetches.emplace_back (new GncDbiPrefetch {sql, nullptr, false});
+        g_thread_pool_push (m_prefetch_pool, m_prefetches.back().get(),
+                            nullptr);
+    }
+    m_next_prefetch = 0;
+}
+
+void
+GncDbiSqlConnection::prefetch_thread (gpointer data, gpointer user_data)
+{
+    auto prefetch = static_cast<GncDbiPrefetch*>(data);
+    auto self = static_cast<GncDbiSqlConnection*>(user_data);
+    auto conn = static_cast<dbi_conn>(g_async_queue_pop (self->m_prefetch_idle));
+
+    auto result = dbi_conn_query (conn, prefetch->sql.c_str());
+    if (result != nullptr)
+    {
+        prefetch->result = new GncDbiPrefetchedResult (result);
+        dbi_result_free (result);
+    }
+    g_async_queue_push (self->m_prefetch_idle, conn);
+    g_async_queue_push (self->m_prefetch_done, prefetch);
+}
+
+/* The result of sql if it is one of the SELECTs still to be handed out.
+ * Those before it were skipped by the loads and won't be asked for. */
+GncSqlResult*
+GncDbiSqlConnection::take_prefetched (const char* sql) noexcept
+{
+    if (m_prefetch_pool == nullptr)
+        return nullptr;
+    auto match = std::find_if (m_prefetches.begin() + m_next_prefetch,
+                               m_prefetches.end(),
+                               [sql](const std::unique_ptr<GncDbiPrefetch>& p)
+                               { return p->sql == sql; });
+    if (match == m_prefetches.end())
+        return nullptr;
+    m_next_prefetch = match - m_prefetches.begin() + 1;
+
+    auto prefetch = match->get();
+    while (!prefetch->done)
+    {
+        auto fetched = static_cast<GncDbiPrefetch*>(g_async_queue_pop (m_prefetch_done));
+        fetched->done = true;
+    }
+    if (prefetch->result == nullptr)
+        PWARN ("Prefetching %s failed, running it again.", sql);
+    auto result = prefetch->result;
+    prefetch->result = nullptr;
+    return result;
+}
+
+void
+GncDbiSqlConnection::end_prefetch () noexcept
+{
+    if (m_prefetch_pool == nullptr)
+        return;
+
+    /* Let the SELECTs being run finish and drop those not started. */
+    g_thread_pool_free (m_prefetch_pool, TRUE, TRUE);
+    m_prefetch_pool = nullptr;
+    gnc_pop_locale (LC_NUMERIC);
+
+    for (auto& prefetch : m_prefetches)
+        delete prefetch->result;
+    m_prefetches.clear();
+    m_next_prefetch = 0;
+    for (auto conn : m_prefetch_conns)
+        dbi_conn_close (conn);
+    m_prefetch_conns.clear();
+    g_async_queue_unref (m_prefetch_idle);
+    g_async_queue_unref (m_prefetch_done);
+    m_prefetch_idle = m_prefetch_done = nullptr;
 }
 
 int
@@ -297,6 +448,7 @@ GncDbiSqlConnection::execute_nonselect_statement (const GncSqlStatementPtr& stmt
 {
     dbi_result result;
 
+    ++m_nonselect_count;
     DEBUG ("SQL: %s\n", stmt->to_sql());
     do
     {
@@ -328,6 +480,153 @@ GncDbiSqlConnection::create_statement_from_sql (const std::string& sql)
     return std::unique_ptr<GncSqlStatement>{new GncDbiSqlStatement (this, sql)};
 }
 
+/* A commit writes each object with an INSERT or UPDATE whose text only
+ * differs from the last one for the same table in its values. PostgreSQL
+ * lets us PREPARE that statement once per connection and send just the
+ * values with EXECUTE after that, which saves the server parsing and
+ * planning it for every object. libdbi can't bind parameters, so the
+ * values are still quoted literals. The other databases get plain SQL.
+ */
+GncSqlStatementPtr
+GncDbiSqlConnection::create_write_statement (E_DB_OPERATION op,
+                                             const std::string& table_name,
+                                             const PairVec& values) noexcept
+{
+    g_return_val_if_fail (op == OP_DB_INSERT || op == OP_DB_UPDATE, nullptr);
+    g_return_val_if_fail (!values.empty(), nullptr);
+
+    if (m_type != DbType::DBI_PGSQL)
+        return create_statement_from_sql (gnc_sql_build_write_sql (this, op,
+                                                                   table_name,
+                                                                   values));
+
+    std::string key{op == OP_DB_INSERT ? "I " : "U "};
+    key += table_name;
+    for (auto const& col_value : values)
+        key += " " + col_value.first;
+
+    auto prepared = m_prepared.find (key);
+    if (prepared == m_prepared.end())
+    {
+        auto name = "gnc_stmt_" + std::to_string (m_prepared.size());
+        std::string sql{"PREPARE " + name + " AS "};
+        unsigned int param = 0;
+
+        if (op == OP_DB_INSERT)
+        {
+            sql += "INSERT INTO " + table_name + "(";
+            for (auto iter = values.begin(); iter != values.end(); ++iter)
+                sql += (iter == values.begin() ? "" : ",") + iter->first;
+            sql += ") VALUES(";
+            for (auto iter = values.begin(); iter != values.end(); ++iter)
+                sql += (iter == values.begin() ? "$" : ",$") +
+                    std::to_string (++param);
+            sql += ")";
+        }
+        else
+        {
+            sql += "UPDATE " + table_name + " SET ";
+            for (auto iter = values.begin(); iter != values.end(); ++iter)
+                sql += (iter == values.begin() ? "" : ",") + iter->first +
+                    "=$" + std::to_string (++param);
+            sql += " WHERE " + values.front().first + " = $1";
+        }
+
+        DEBUG ("SQL: %s\n", sql.c_str());
+        init_error ();
+        auto result = dbi_conn_query (m_conn, sql.c_str());
+        if (result == nullptr)
+        {
+            /* Not fatal: the statement just won't be cached. */
+            PWARN ("Failed to prepare %s, using plain SQL\n", sql.c_str());
+            init_error ();
+            return create_statement_from_sql (gnc_sql_build_write_sql (this, op,
+                                                                       table_name,
+                                                                       values));
+        }
+        dbi_result_free (result);
+        prepared = m_prepared.emplace (key, name).first;
+    }
+
+    std::string sql{"EXECUTE " + prepared->second + "("};
+    for (auto iter = values.begin(); iter != values.end(); ++iter)
+        sql += (iter == values.begin() ? "" : ",") +
+            quote_string (iter->second);
+    sql += ")";
+    return create_statement_from_sql (sql);
+}
+
+void
+GncDbiSqlConnection::forget_prepared_statements () noexcept
+{
+    if (m_prepared.empty())
+        return;
+    if (m_conn_ok)
+    {
+        auto result = dbi_conn_query (m_conn, "DEALLOCATE ALL");
+        if (result)
+            dbi_result_free (result);
+    }
+    m_prepared.clear();
+}
+
+/* The cache sizes are negative, so in KiB rather than pages: 64 MiB and for
+ * the bulk load 256 MiB. The memory map covers the first 256 MiB of the
+ * file. Going back to DEFAULT from the write-ahead log needs the journal
+ * mode SQLite opens files with, DELETE.
+ */
+bool
+GncDbiSqlConnection::set_sqlite_profile (SqliteProfile profile) noexcept
+{
+    if (m_type != DbType::DBI_SQLITE || profile == m_sqlite_profile)
+        return true;
+
+    StrVec pragmas;
+    switch (profile)
+    {
+    case SqliteProfile::DEFAULT:
+        pragmas = {"journal_mode=DELETE", "synchronous=FULL", "mmap_size=0",
+                   "cache_size=-2000", "temp_store=DEFAULT"};
+        break;
+    case SqliteProfile::PERFORMANCE:
+        pragmas = {"journal_mode=WAL", "synchronous=NORMAL",
+                   "mmap_size=268435456", "cache_size=-65536",
+                   "temp_store=MEMORY"};
+        break;
+    case SqliteProfile::BULK_LOAD:
+        pragmas = {"synchronous=OFF", "cache_size=-262144",
+                   "temp_store=MEMORY"};
+        break;
+    }
+
+    auto success = true;
+    for (auto const& pragma : pragmas)
+    {
+        DEBUG ("PRAGMA %s\n", pragma.c_str());
+        auto result = dbi_conn_queryf (m_conn, "PRAGMA %s", pragma.c_str());
+        if (result == nullptr)
+        {
+            PWARN ("PRAGMA %s failed\n", pragma.c_str());
+            success = false;
+            continue;
+        }
+        /* journal_mode answers with the mode it ended up in. */
+        if (pragma == "journal_mode=WAL" && dbi_result_next_row (result))
+        {
+            auto mode = dbi_result_get_string_idx (result, 1);
+            if (g_ascii_strcasecmp (mode ? mode : "", "wal") != 0)
+            {
+                PWARN ("SQLite kept journal mode %s\n", mode ? mode : "");
+                success = false;
+            }
+        }
+        dbi_result_free (result);
+    }
+    init_error ();
+    m_sqlite_profile = profile;
+    return success;
+}
+
 bool
 GncDbiSqlConnection::does_table_exist (const std::string& table_name)
     const noexcept
@@ -368,6 +667,7 @@ GncDbiSqlConnection::begin_transaction () noexcept
         PERR ("BEGIN transaction failed()\n");
         qof_backend_set_error (m_qbe, ERR_BACKEND_SERVER_ERR);
     }
+    m_in_transaction = success;
 
     return success;
 }
@@ -376,6 +676,7 @@ bool
 GncDbiSqlConnection::rollback_transaction () const noexcept
 {
     DEBUG ("ROLLBACK\n");
+    m_in_transaction = false;
     const char* command =  "ROLLBACK";
     auto result = dbi_conn_query (m_conn, command);
     auto success = (result != nullptr);
@@ -399,6 +700,7 @@ bool
 GncDbiSqlConnection::commit_transaction () const noexcept
 {
     DEBUG ("COMMIT\n");
+    m_in_transaction = false;
     auto result = dbi_conn_queryf (m_conn, "COMMIT");
     auto success = (result != nullptr);
 
@@ -451,17 +753,21 @@ GncDbiSqlConnection::create_table (const std::string& table_name,
     return true;
 }
 
+/* PostgreSQL can build the index without locking out writes, though not
+ * inside a transaction.  MySQL's InnoDB does so anyway. */
 static std::string
 create_index_ddl (const GncSqlConnection* conn, const std::string& index_name,
-                  const std::string& table_name, const EntryVec& col_table)
+                  const std::string& table_name, const EntryVec& col_table,
+                  bool online)
 {
     std::string ddl;
-    ddl += "CREATE INDEX " + index_name + " ON " + table_name + "(";
+    ddl += online ? "CREATE INDEX CONCURRENTLY " : "CREATE INDEX ";
+    ddl += index_name + " ON " + table_name + "(";
     for (auto const table_row : col_table)
     {
         if (table_row != *col_table.begin())
         {
-            ddl =+ ", ";
+            ddl += ", ";
         }
         ddl += table_row->name();
     }
@@ -474,7 +780,9 @@ GncDbiSqlConnection::create_index(const std::string& index_name,
                                   const std::string& table_name,
                                   const EntryVec& col_table) const noexcept
 {
-    auto ddl = create_index_ddl (this, index_name, table_name, col_table);
+    auto online = m_type == DbType::DBI_PGSQL && !m_in_transaction;
+    auto ddl = create_index_ddl (this, index_name, table_name, col_table,
+                                 online);
     if (ddl.empty())
         return false;
     DEBUG ("SQL: %s\n", ddl.c_str());
@@ -489,6 +797,12 @@ GncDbiSqlConnection::create_index(const std::string& index_name,
     return true;
 }
 
+bool
+GncDbiSqlConnection::is_full_scan (const std::string& sql) const noexcept
+{
+    return m_provider->is_full_scan (m_conn, sql);
+}
+
 bool
 GncDbiSqlConnection::add_columns_to_table(const std::string& table_name,
                                           const ColVec& info_vec)
@@ -543,6 +857,7 @@ GncDbiSqlConnection::verify () noexcept
      */
     init_error ();
     m_conn_ok = true;
+    m_prepared.clear();
     (void)dbi_conn_connect (m_conn);
 
     return m_conn_ok;
@@ -555,6 +870,7 @@ GncDbiSqlConnection::retry_connection(const char* msg)
     while (m_retry && m_error_repeat <= DBI_MAX_CONN_ATTEMPTS)
     {
         m_conn_ok = false;
+        m_prepared.clear();
         if (dbi_conn_connect(m_conn) == 0)
         {
             init_error();
@@ -635,6 +951,7 @@ GncDbiSqlConnection::table_operation(const StrVec& table_names,
 {
     g_return_val_if_fail (!table_names.empty(), FALSE);
     bool retval{true};
+    forget_prepared_statements();
     for (auto table : table_names)
     {
         dbi_result result;
@@ -27,8 +27,35 @@
 #include "gnc-dbisqlresult.hpp"
 #include "gnc-dbiprovider.hpp"
 
+#include <unordered_map>
+#include <memory>
+#include <vector>
+
 class GncDbiProvider;
 
+/** The most connections GncDbiSqlConnection::prefetch() opens. */
+#define GNC_DBI_PREFETCH_CONNECTIONS 4
+
+/** The pragmas GncDbiSqlConnection::set_sqlite_profile() gives SQLite.
+ * DEFAULT leaves SQLite's own settings; PERFORMANCE uses a write-ahead log
+ * synced only at checkpoints, memory mapped reads and a bigger cache;
+ * BULK_LOAD, for writing a whole book, doesn't sync at all.
+ */
+enum class SqliteProfile
+{
+    DEFAULT,
+    PERFORMANCE,
+    BULK_LOAD
+};
+
+/** A SELECT given to GncDbiSqlConnection::prefetch(). */
+struct GncDbiPrefetch
+{
+    std::string sql;
+    GncSqlResult* result;   /**< nullptr if the SELECT failed */
+    bool done;              /**< Taken from the queue of those fetched */
+};
+
 /**
  * Encapsulate a libdbi dbi_conn connection.
  */
@@ -44,6 +71,10 @@ public:
         noexcept override;
     GncSqlStatementPtr create_statement_from_sql (const std::string&)
         const noexcept override;
+    GncSqlStatementPtr create_write_statement (E_DB_OPERATION,
+                                               const std::string&,
+                                               const PairVec&)
+        noexcept override;
     bool does_table_exist (const std::string&) const noexcept override;
     bool begin_transaction () noexcept override;
     bool rollback_transaction () const noexcept override;
@@ -53,6 +84,12 @@ public:
         const noexcept override;
     bool add_columns_to_table (const std::string&, const ColVec&)
         const noexcept override;
+    bool is_full_scan (const std::string& sql) const noexcept override;
+    uint64_t select_count () const noexcept override { return m_select_count; }
+    uint64_t nonselect_count () const noexcept override
+    {
+        return m_nonselect_count;
+    }
     std::string quote_string (const std::string&) const noexcept override;
     int dberror() const noexcept override {
         return dbi_conn_error(m_conn, nullptr); }
@@ -74,6 +111,28 @@ public:
      */
     bool verify() noexcept override;
     bool retry_connection(const char* msg) noexcept override;
+    /** Fetch the SELECTs on a few more connections to the same database,
+     * each on its own thread. SQLite doesn't wait on a network, so this
+     * does nothing for it.
+     */
+    void prefetch (const StrVec&) noexcept override;
+    void end_prefetch () noexcept override;
+    /** Switch an SQLite connection to the profile's pragmas; the other
+     * databases ignore it.  Must not be called inside a transaction.
+     * Returns false if SQLite refused the write-ahead log, as it does on
+     * some network file systems, in which case it keeps its journal. */
+    bool set_sqlite_profile (SqliteProfile profile) noexcept;
+    SqliteProfile sqlite_profile () const noexcept { return m_sqlite_profile; }
+    /** PostgreSQL's uuid: 16 bytes, taking the hex strings as they are and
+     * returning the hyphenated form, which string_to_guid() reads too. */
+    bool has_native_guids () const noexcept override
+    {
+        return m_type == DbType::DBI_PGSQL;
+    }
+    std::string cast_to_guid (const std::string& col) const noexcept override
+    {
+        return "CAST(NULLIF(" + col + ",'') AS uuid)";
+    }
     dbi_result table_manage_backup(const std::string& table_name, TableOpType op);
     bool table_operation (const StrVec& table_name_list,
                           TableOpType op) noexcept;
@@ -103,6 +162,31 @@ private:
      * original query)
      */
     gboolean m_retry;
+    DbType m_type;
+    SqliteProfile m_sqlite_profile;
+    /** Between begin_transaction() and its commit or rollback. */
+    mutable bool m_in_transaction;
+    /** Names of the statements prepared on the server, keyed by table,
+     * operation and columns. Only PostgreSQL can prepare them from SQL, so
+     * the other databases leave it empty.
+     */
+    std::unordered_map<std::string, std::string> m_prepared;
+    void forget_prepared_statements() noexcept;
+    /** The connections, threads and SELECTs of prefetch(). The SELECTs come
+     * back through m_prefetch_done in whatever order they finish, and are
+     * handed out in the order they were given. */
+    std::vector<dbi_conn> m_prefetch_conns;
+    GAsyncQueue* m_prefetch_idle;
+    GAsyncQueue* m_prefetch_done;
+    GThreadPool* m_prefetch_pool;
+    std::vector<std::unique_ptr<GncDbiPrefetch>> m_prefetches;
+    size_t m_next_prefetch;
+    /** Statements run through execute_select_statement() and
+     * execute_nonselect_statement(), retries counted once. */
+    uint64_t m_select_count;
+    uint64_t m_nonselect_count;
+    static void prefetch_thread (gpointer data, gpointer user_data);
+    GncSqlResult* take_prefetched (const char* sql) noexcept;
     bool lock_database(bool ignore_lock);
     void unlock_database();
 
@@ -25,11 +25,11 @@
 extern "C"
 {
 #include <config.h>
-#include <gnc-locale-utils.h>
 #include <dbi/dbi.h>
 /* For direct access to dbi data structs, sadly needed for datetime */
 #include <dbi/dbi-dev.h>
 }
+#include <cmath>
 #include <gnc-datetime.hpp>
 #include <gnc-backend-sql.h>
 #include "gnc-dbisqlresult.hpp"
@@ -37,6 +37,59 @@ extern "C"
 
 static QofLogModule log_module = G_LOG_DOMAIN;
 
+/* The datetime in the current row's field at idx, counting from 1. */
+static time64
+dbi_time64_at_idx (dbi_result dbi_result, unsigned int idx)
+{
+#if HAVE_LIBDBI_TO_LONGLONG
+    /* A less evil hack than the one equrie by libdbi-0.8, but
+     * still necessary to work around the same bug.
+     */
+    auto retval = dbi_result_get_as_longlong_idx(dbi_result, idx);
+#else
+    /* A seriously evil hack to work around libdbi bug #15
+     * https://sourceforge.net/p/libdbi/bugs/15/. When libdbi
+     * v0.9 is widely available this can be replaced with
+     * dbi_result_get_as_longlong.
+     * Note: 0.9 is available in Debian Jessie and Fedora 21.
+     */
+    auto result = (dbi_result_t*) (dbi_result);
+    auto row = dbi_result_get_currow (result);
+    time64 retval = result->rows[row]->field_values[idx - 1].d_datetime;
+    if (retval < MINTIME || retval > MAXTIME)
+        retval = 0;
+#endif //HAVE_LIBDBI_TO_LONGLONG
+    return retval;
+}
+
+GncDbiSqlResult::GncDbiSqlResult (const GncDbiSqlConnection* conn,
+                                  dbi_result result) :
+    m_conn{conn}, m_dbi_result{result}, m_iter{this}, m_row{&m_iter},
+    m_sentinel{nullptr}
+{
+    if (result == nullptr)
+        return;
+    auto n_fields = dbi_result_get_numfields (result);
+    if (n_fields != DBI_FIELD_ERROR)
+    {
+        m_types.reserve (n_fields);
+        m_attribs.reserve (n_fields);
+        for (unsigned int idx = 1; idx <= n_fields; ++idx)
+        {
+            m_types.push_back (dbi_result_get_field_type_idx (result, idx));
+            m_attribs.push_back (dbi_result_get_field_attribs_idx (result,
+                                                                   idx));
+        }
+    }
+    /* libdbi fetches a row from the driver the first time it's visited;
+     * visit them all now rather than under a pushed locale per field. */
+    auto n_rows = dbi_result_get_numrows (result);
+    if (n_rows == DBI_ROW_ERROR)
+        return;
+    for (unsigned long long row = 1; row <= n_rows; ++row)
+        dbi_result_seek_row (result, row);
+}
+
 GncDbiSqlResult::~GncDbiSqlResult()
 {
     int status = dbi_result_free (m_dbi_result);
@@ -95,91 +148,345 @@ GncDbiSqlResult::IteratorImpl::operator++()
     return m_inst->m_sentinel;
 }
 
+int
+GncDbiSqlResult::IteratorImpl::get_col_index (const char* col,
+                                              const char* suffix) const noexcept
+{
+    auto key = std::make_pair (col, suffix);
+    auto iter = m_col_indexes.find (key);
+    if (iter != m_col_indexes.end())
+        return iter->second;
+    int idx;
+    if (suffix == nullptr)
+        idx = dbi_result_get_field_idx (m_inst->m_dbi_result, col);
+    else
+        idx = dbi_result_get_field_idx (m_inst->m_dbi_result,
+                                        (std::string{col} + suffix).c_str());
+    m_col_indexes.emplace (key, idx);
+    return idx;
+}
+
 int64_t
 GncDbiSqlResult::IteratorImpl::get_int_at_col(const char* col) const
 {
-    auto type = dbi_result_get_field_type (m_inst->m_dbi_result, col);
-    if(type != DBI_TYPE_INTEGER)
-        throw (std::invalid_argument{"Requested integer from non-integer column."});
-    return dbi_result_get_longlong (m_inst->m_dbi_result, col);
+    return get_int_at_idx (column (col));
 }
 
 float
 GncDbiSqlResult::IteratorImpl::get_float_at_col(const char* col) const
 {
-    auto type = dbi_result_get_field_type (m_inst->m_dbi_result, col);
-    auto attrs = dbi_result_get_field_attribs (m_inst->m_dbi_result, col);
+    return get_float_at_idx (column (col));
+}
+
+double
+GncDbiSqlResult::IteratorImpl::get_double_at_col(const char* col) const
+{
+    return get_double_at_idx (column (col));
+}
+
+std::string
+GncDbiSqlResult::IteratorImpl::get_string_at_col(const char* col) const
+{
+    auto strval = get_cstring_at_idx (column (col));
+    if (strval == nullptr)
+        throw (std::invalid_argument{"Column empty."});
+    return std::string{strval};
+}
+
+time64
+GncDbiSqlResult::IteratorImpl::get_time64_at_col (const char* col) const
+{
+    return get_time64_at_idx (column (col));
+}
+
+bool
+GncDbiSqlResult::IteratorImpl::is_col_null (const char* col) const noexcept
+{
+    return is_idx_null (column (col));
+}
+
+/* The drivers converted the numbers when the constructor fetched the rows,
+ * so none of these depend on the locale. */
+int64_t
+GncDbiSqlResult::IteratorImpl::get_int_at_idx (int idx) const
+{
+    auto type = m_inst->type (idx);
+    if (type == DBI_TYPE_INTEGER)
+        return dbi_result_get_longlong_idx (m_inst->m_dbi_result, idx);
+    /* PostgreSQL and MySQL return SUM() of an integer column as a decimal,
+     * which the drivers hand over as a double or a string respectively. */
+    if (type == DBI_TYPE_DECIMAL)
+    {
+        auto retval = dbi_result_get_double_idx (m_inst->m_dbi_result, idx);
+        return static_cast<int64_t>(std::llround (retval));
+    }
+    if (type == DBI_TYPE_STRING)
+    {
+        auto strval = dbi_result_get_string_idx (m_inst->m_dbi_result, idx);
+        char* end = nullptr;
+        if (strval != nullptr)
+        {
+            auto retval = g_ascii_strtoll (strval, &end, 10);
+            if (end != strval && *end == '\0')
+                return retval;
+        }
+    }
+    throw (std::invalid_argument{"Requested integer from non-integer column."});
+}
+
+float
+GncDbiSqlResult::IteratorImpl::get_float_at_idx (int idx) const
+{
+    auto type = m_inst->type (idx);
+    auto attrs = m_inst->attribs (idx);
     if(type != DBI_TYPE_DECIMAL ||
        (attrs & DBI_DECIMAL_SIZEMASK) != DBI_DECIMAL_SIZE4)
         throw (std::invalid_argument{"Requested float from non-float column."});
-    gnc_push_locale (LC_NUMERIC, "C");
-    auto retval =  dbi_result_get_float(m_inst->m_dbi_result, col);
-    gnc_pop_locale (LC_NUMERIC);
-    return retval;
+    return dbi_result_get_float_idx(m_inst->m_dbi_result, idx);
 }
 
 double
-GncDbiSqlResult::IteratorImpl::get_double_at_col(const char* col) const
+GncDbiSqlResult::IteratorImpl::get_double_at_idx (int idx) const
 {
-    auto type = dbi_result_get_field_type (m_inst->m_dbi_result, col);
-    auto attrs = dbi_result_get_field_attribs (m_inst->m_dbi_result, col);
+    auto type = m_inst->type (idx);
+    auto attrs = m_inst->attribs (idx);
     if(type != DBI_TYPE_DECIMAL ||
        (attrs & DBI_DECIMAL_SIZEMASK) != DBI_DECIMAL_SIZE8)
         throw (std::invalid_argument{"Requested double from non-double column."});
-    gnc_push_locale (LC_NUMERIC, "C");
-    auto retval =  dbi_result_get_double(m_inst->m_dbi_result, col);
-    gnc_pop_locale (LC_NUMERIC);
-    return retval;
+    return dbi_result_get_double_idx(m_inst->m_dbi_result, idx);
 }
 
-std::string
-GncDbiSqlResult::IteratorImpl::get_string_at_col(const char* col) const
+const char*
+GncDbiSqlResult::IteratorImpl::get_cstring_at_idx (int idx) const
 {
-    auto type = dbi_result_get_field_type (m_inst->m_dbi_result, col);
-    auto attrs = dbi_result_get_field_attribs (m_inst->m_dbi_result, col);
+    auto type = m_inst->type (idx);
     if(type != DBI_TYPE_STRING)
         throw (std::invalid_argument{"Requested string from non-string column."});
-    gnc_push_locale (LC_NUMERIC, "C");
-    auto strval = dbi_result_get_string(m_inst->m_dbi_result, col);
-    if (strval == nullptr)
+    return dbi_result_get_string_idx (m_inst->m_dbi_result, idx);
+}
+
+time64
+GncDbiSqlResult::IteratorImpl::get_time64_at_idx (int idx) const
+{
+    auto type = m_inst->type (idx);
+    if (type != DBI_TYPE_DATETIME)
+        throw (std::invalid_argument{"Requested time64 from non-time64 column."});
+    return dbi_time64_at_idx (m_inst->m_dbi_result, idx);
+}
+
+bool
+GncDbiSqlResult::IteratorImpl::is_idx_null (int idx) const noexcept
+{
+    return dbi_result_field_is_null_idx (m_inst->m_dbi_result, idx);
+}
+
+/* --------------------------------------------------------- */
+
+GncDbiPrefetchedResult::GncDbiPrefetchedResult (dbi_result result) :
+    m_iter{this}, m_row{&m_iter}, m_sentinel{nullptr}
+{
+    if (result == nullptr)
+        return;
+    auto n_fields = dbi_result_get_numfields (result);
+    if (n_fields == DBI_FIELD_ERROR)
+        return;
+    for (unsigned int idx = 1; idx <= n_fields; ++idx)
     {
-        gnc_pop_locale (LC_NUMERIC);
-        throw (std::invalid_argument{"Column empty."});
+        m_columns[dbi_result_get_field_name (result, idx)] = idx - 1;
+        m_types.push_back (dbi_result_get_field_type_idx (result, idx));
+        m_attribs.push_back (dbi_result_get_field_attribs_idx (result, idx));
+    }
+
+    m_rows.reserve (dbi_result_get_numrows (result));
+    while (dbi_result_next_row (result))
+    {
+        Row row (n_fields);
+        for (unsigned int idx = 1; idx <= n_fields; ++idx)
+        {
+            auto& field = row[idx - 1];
+            field.is_null = dbi_result_field_is_null_idx (result, idx) != 0;
+            field.int_val = 0;
+            field.double_val = 0.0;
+            if (field.is_null)
+                continue;
+            switch (m_types[idx - 1])
+            {
+            case DBI_TYPE_INTEGER:
+                field.int_val = dbi_result_get_longlong_idx (result, idx);
+                break;
+            case DBI_TYPE_DECIMAL:
+                if ((m_attribs[idx - 1] & DBI_DECIMAL_SIZEMASK) ==
+                    DBI_DECIMAL_SIZE4)
+                    field.double_val = dbi_result_get_float_idx (result, idx);
+                else
+                    field.double_val = dbi_result_get_double_idx (result, idx);
+                break;
+            case DBI_TYPE_STRING:
+            {
+                auto strval = dbi_result_get_string_idx (result, idx);
+                if (strval == nullptr)
+                    field.is_null = true;
+                else
+                    field.str_val = strval;
+                break;
+            }
+            case DBI_TYPE_DATETIME:
+                field.int_val = dbi_time64_at_idx (result, idx);
+                break;
+            default:
+                break;
+            }
+        }
+        m_rows.push_back (std::move (row));
     }
-    auto retval =  std::string{strval};
-    gnc_pop_locale (LC_NUMERIC);
-    return retval;
 }
+
+GncSqlRow&
+GncDbiPrefetchedResult::begin()
+{
+    m_iter.rewind();
+    if (m_rows.empty())
+        return m_sentinel;
+    return m_row;
+}
+
+GncSqlRow&
+GncDbiPrefetchedResult::IteratorImpl::operator++()
+{
+    if (++m_index >= m_inst->m_rows.size())
+        return m_inst->m_sentinel;
+    return m_inst->m_row;
+}
+
+int
+GncDbiPrefetchedResult::IteratorImpl::column (const char* col) const noexcept
+{
+    auto iter = m_inst->m_columns.find (col);
+    if (iter == m_inst->m_columns.end())
+        return -1;
+    return iter->second;
+}
+
+unsigned short
+GncDbiPrefetchedResult::IteratorImpl::type (int idx) const noexcept
+{
+    return idx < 0 ? DBI_TYPE_ERROR : m_inst->m_types[idx];
+}
+
+int64_t
+GncDbiPrefetchedResult::IteratorImpl::get_int_at_idx (int idx) const
+{
+    auto type = this->type (idx);
+    if (type == DBI_TYPE_INTEGER)
+        return m_inst->m_rows[m_index][idx].int_val;
+    if (type == DBI_TYPE_DECIMAL)
+        return static_cast<int64_t>(std::llround (
+                                        m_inst->m_rows[m_index][idx].double_val));
+    if (type == DBI_TYPE_STRING && !m_inst->m_rows[m_index][idx].is_null)
+    {
+        auto strval = m_inst->m_rows[m_index][idx].str_val.c_str();
+        char* end = nullptr;
+        auto retval = g_ascii_strtoll (strval, &end, 10);
+        if (end != strval && *end == '\0')
+            return retval;
+    }
+    throw (std::invalid_argument{"Requested integer from non-integer column."});
+}
+
+float
+GncDbiPrefetchedResult::IteratorImpl::get_float_at_idx (int idx) const
+{
+    if (type (idx) != DBI_TYPE_DECIMAL ||
+        (m_inst->m_attribs[idx] & DBI_DECIMAL_SIZEMASK) != DBI_DECIMAL_SIZE4)
+        throw (std::invalid_argument{"Requested float from non-float column."});
+    return static_cast<float>(m_inst->m_rows[m_index][idx].double_val);
+}
+
+double
+GncDbiPrefetchedResult::IteratorImpl::get_double_at_idx (int idx) const
+{
+    if (type (idx) != DBI_TYPE_DECIMAL ||
+        (m_inst->m_attribs[idx] & DBI_DECIMAL_SIZEMASK) != DBI_DECIMAL_SIZE8)
+        throw (std::invalid_argument{"Requested double from non-double column."});
+    return m_inst->m_rows[m_index][idx].double_val;
+}
+
+const char*
+GncDbiPrefetchedResult::IteratorImpl::get_cstring_at_idx (int idx) const
+{
+    if (type (idx) != DBI_TYPE_STRING)
+        throw (std::invalid_argument{"Requested string from non-string column."});
+    if (m_inst->m_rows[m_index][idx].is_null)
+        return nullptr;
+    return m_inst->m_rows[m_index][idx].str_val.c_str();
+}
+
 time64
-GncDbiSqlResult::IteratorImpl::get_time64_at_col (const char* col) const
+GncDbiPrefetchedResult::IteratorImpl::get_time64_at_idx (int idx) const
 {
-    auto type = dbi_result_get_field_type (m_inst->m_dbi_result, col);
-    auto attrs = dbi_result_get_field_attribs (m_inst->m_dbi_result, col);
-    if (type != DBI_TYPE_DATETIME)
+    if (type (idx) != DBI_TYPE_DATETIME)
         throw (std::invalid_argument{"Requested time64 from non-time64 column."});
-    gnc_push_locale (LC_NUMERIC, "C");
-#if HAVE_LIBDBI_TO_LONGLONG
-    /* A less evil hack than the one equrie by libdbi-0.8, but
-     * still necessary to work around the same bug.
-     */
-    auto retval = dbi_result_get_as_longlong(dbi_row->result,
-                                             col_name);
-#else
-    /* A seriously evil hack to work around libdbi bug #15
-     * https://sourceforge.net/p/libdbi/bugs/15/. When libdbi
-     * v0.9 is widely available this can be replaced with
-     * dbi_result_get_as_longlong.
-     * Note: 0.9 is available in Debian Jessie and Fedora 21.
-     */
-    auto result = (dbi_result_t*) (m_inst->m_dbi_result);
-    auto row = dbi_result_get_currow (result);
-    auto idx = dbi_result_get_field_idx (result, col) - 1;
-    time64 retval = result->rows[row]->field_values[idx].d_datetime;
-    if (retval < MINTIME || retval > MAXTIME)
-        retval = 0;
-#endif //HAVE_LIBDBI_TO_LONGLONG
-    gnc_pop_locale (LC_NUMERIC);
-    return retval;
+    return m_inst->m_rows[m_index][idx].int_val;
+}
+
+bool
+GncDbiPrefetchedResult::IteratorImpl::is_idx_null (int idx) const noexcept
+{
+    return idx < 0 || m_inst->m_rows[m_index][idx].is_null;
+}
+
+int
+GncDbiPrefetchedResult::IteratorImpl::get_col_index (const char* col,
+                                                     const char* suffix)
+    const noexcept
+{
+    auto key = std::make_pair (col, suffix);
+    auto iter = m_col_indexes.find (key);
+    if (iter != m_col_indexes.end())
+        return iter->second;
+    auto idx = suffix == nullptr ? column (col) :
+        column ((std::string{col} + suffix).c_str());
+    m_col_indexes.emplace (key, idx);
+    return idx;
+}
+
+int64_t
+GncDbiPrefetchedResult::IteratorImpl::get_int_at_col (const char* col) const
+{
+    return get_int_at_idx (column (col));
+}
+
+float
+GncDbiPrefetchedResult::IteratorImpl::get_float_at_col (const char* col) const
+{
+    return get_float_at_idx (column (col));
+}
+
+double
+GncDbiPrefetchedResult::IteratorImpl::get_double_at_col (const char* col) const
+{
+    return get_double_at_idx (column (col));
+}
+
+std::string
+GncDbiPrefetchedResult::IteratorImpl::get_string_at_col (const char* col) const
+{
+    auto strval = get_cstring_at_idx (column (col));
+    if (strval == nullptr)
+        throw (std::invalid_argument{"Column empty."});
+    return std::string{strval};
+}
+
+time64
+GncDbiPrefetchedResult::IteratorImpl::get_time64_at_col (const char* col) const
+{
+    return get_time64_at_idx (column (col));
+}
+
+bool
+GncDbiPrefetchedResult::IteratorImpl::is_col_null (const char* col) const noexcept
+{
+    return is_idx_null (column (col));
 }
 
 
@@ -27,17 +27,28 @@
 
 #include "gnc-backend-dbi.h"
 
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 class GncDbiSqlConnection;
 
+/** Column indexes by the addresses of the column name and suffix given to
+ * get_col_index(). */
+using GncDbiColIndexes = std::map<std::pair<const char*, const char*>, int>;
+
 /**
  * An iterable wrapper for dbi_result; allows using C++11 range for.
  */
 class GncDbiSqlResult : public GncSqlResult
 {
 public:
-    GncDbiSqlResult(const GncDbiSqlConnection* conn, dbi_result result) :
-        m_conn{conn}, m_dbi_result{result}, m_iter{this}, m_row{&m_iter},
-        m_sentinel{nullptr} {}
+    /** Reads the columns' types and has the driver fetch every row, which
+     * is when it converts the numbers; call it with LC_NUMERIC set to
+     * "C" so that the fields can be read in any locale afterwards. */
+    GncDbiSqlResult(const GncDbiSqlConnection* conn, dbi_result result);
     ~GncDbiSqlResult();
     uint64_t size() const noexcept;
     int dberror() const noexcept;
@@ -57,21 +68,113 @@ protected:
         virtual double get_double_at_col (const char* col) const;
         virtual std::string get_string_at_col (const char* col)const;
         virtual time64 get_time64_at_col (const char* col) const;
-        virtual bool is_col_null(const char* col) const noexcept
+        virtual bool is_col_null(const char* col) const noexcept;
+        virtual int get_col_index (const char* col, const char* suffix)
+            const noexcept;
+        virtual int64_t get_int_at_idx (int idx) const;
+        virtual float get_float_at_idx (int idx) const;
+        virtual double get_double_at_idx (int idx) const;
+        virtual const char* get_cstring_at_idx (int idx) const;
+        virtual time64 get_time64_at_idx (int idx) const;
+        virtual bool is_idx_null (int idx) const noexcept;
+    private:
+        /** Looked up each time: unlike get_col_index's, these callers
+         * may pass names built in temporaries. */
+        int column (const char* col) const noexcept
         {
-            return dbi_result_field_is_null(m_inst->m_dbi_result, col);
+            return dbi_result_get_field_idx (m_inst->m_dbi_result, col);
         }
-    private:
         GncDbiSqlResult* m_inst;
+        /** libdbi's field indexes, by the addresses of the names. */
+        mutable GncDbiColIndexes m_col_indexes;
     };
 
 private:
+    /** The field's DBI_TYPE, or 0 if idx is out of range; fields count
+     * from 1. */
+    unsigned short type (int idx) const noexcept
+    {
+        return idx > 0 && static_cast<size_t>(idx) <= m_types.size() ?
+            m_types[idx - 1] : 0;
+    }
+    unsigned int attribs (int idx) const noexcept
+    {
+        return idx > 0 && static_cast<size_t>(idx) <= m_attribs.size() ?
+            m_attribs[idx - 1] : 0;
+    }
     const GncDbiSqlConnection* m_conn;
     dbi_result m_dbi_result;
+    std::vector<unsigned short> m_types;
+    std::vector<unsigned int> m_attribs;
     IteratorImpl m_iter;
     GncSqlRow m_row;
     GncSqlRow m_sentinel;
 
 };
 
+/**
+ * A dbi_result read to the end and kept as plain values, so that it can be
+ * fetched on one thread and loaded on another. Its rows read like those of
+ * a GncDbiSqlResult.
+ */
+class GncDbiPrefetchedResult : public GncSqlResult
+{
+public:
+    GncDbiPrefetchedResult(dbi_result result);
+    ~GncDbiPrefetchedResult() = default;
+    uint64_t size() const noexcept { return m_rows.size(); }
+    GncSqlRow& begin();
+    GncSqlRow& end() { return m_sentinel; }
+private:
+    struct Field
+    {
+        bool is_null;
+        int64_t int_val;        /**< DBI_TYPE_INTEGER and DBI_TYPE_DATETIME */
+        double double_val;      /**< DBI_TYPE_DECIMAL */
+        std::string str_val;    /**< DBI_TYPE_STRING */
+    };
+    using Row = std::vector<Field>;
+protected:
+    class IteratorImpl : public GncSqlResult::IteratorImpl
+    {
+    public:
+        ~IteratorImpl() = default;
+        IteratorImpl(GncDbiPrefetchedResult* inst) : m_inst{inst}, m_index{0} {}
+        virtual GncSqlRow& operator++();
+        virtual GncSqlRow& operator++(int) { return ++(*this); };
+        virtual GncSqlResult* operator*() { return m_inst; }
+        virtual int64_t get_int_at_col (const char* col) const;
+        virtual float get_float_at_col (const char* col) const;
+        virtual double get_double_at_col (const char* col) const;
+        virtual std::string get_string_at_col (const char* col)const;
+        virtual time64 get_time64_at_col (const char* col) const;
+        virtual bool is_col_null(const char* col) const noexcept;
+        virtual int get_col_index (const char* col, const char* suffix)
+            const noexcept;
+        virtual int64_t get_int_at_idx (int idx) const;
+        virtual float get_float_at_idx (int idx) const;
+        virtual double get_double_at_idx (int idx) const;
+        virtual const char* get_cstring_at_idx (int idx) const;
+        virtual time64 get_time64_at_idx (int idx) const;
+        virtual bool is_idx_null (int idx) const noexcept;
+        void rewind() noexcept { m_index = 0; }
+    private:
+        /** The column's index, or -1 if there's no such column. */
+        int column (const char* col) const noexcept;
+        unsigned short type (int idx) const noexcept;
+        GncDbiPrefetchedResult* m_inst;
+        size_t m_index;
+        mutable GncDbiColIndexes m_col_indexes;
+    };
+
+private:
+    std::unordered_map<std::string, int> m_columns;
+    std::vector<unsigned short> m_types;
+    std::vector<unsigned int> m_attribs;
+    std::vector<Row> m_rows;
+    IteratorImpl m_iter;
+    GncSqlRow m_row;
+    GncSqlRow m_sentinel;
+};
+
 #endif //__GNC_DBISQLRESULT_HPP__
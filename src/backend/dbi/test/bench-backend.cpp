@@ -0,0 +1,316 @@
+/********************************************************************\
+ * bench-backend.cpp -- load and save timings for the file backends *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+/* bench-backend saves a reference book in each backend and loads it
+ * back, printing one JSON object per operation:
+ *
+ *   {"book":"random","backend":"sqlite","operation":"save",
+ *    "seconds":1.25,"peak_rss_kb":81234,"selects":12,"statements":40321,
+ *    "bytes":10485760}
+ *
+ * The reference books are the files or URLs given on the command line;
+ * without any, a random book of --transactions transactions is built
+ * from --seed.  The backends are uncompressed XML, gzipped XML and
+ * SQLite, plus MySQL and PostgreSQL when GNC_BENCH_MYSQL_URL and
+ * GNC_BENCH_PGSQL_URL name databases that may be overwritten.
+ *
+ * peak_rss_kb is the high-water mark of the process during the
+ * operation where Linux can reset it, null elsewhere.  The statement
+ * counts come from the SQL connection and are null for XML; bytes is
+ * the size of the file written and null for the servers.
+ */
+
+extern "C"
+{
+#include "config.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qof.h>
+#include <cashobjects.h>
+#include <gnc-prefs.h>
+#include <test-engine-stuff.h>
+}
+#include "../gnc-backend-dbi.h"
+#include "../gnc-backend-dbi.hpp"
+
+static gint num_transactions = 10000;
+static gint seed = 1;
+static gchar* xml_backend_dir = NULL;
+static gchar** reference_books = NULL;
+
+static GOptionEntry bench_options[] =
+{
+    { "transactions", 't', 0, G_OPTION_ARG_INT, &num_transactions,
+      "Transactions in the random book", "N" },
+    { "seed", 'r', 0, G_OPTION_ARG_INT, &seed,
+      "Seed for the random book", "N" },
+    { "backend-dir", 'b', 0, G_OPTION_ARG_FILENAME, &xml_backend_dir,
+      "Directory holding the xml backend module", "DIR" },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &reference_books,
+      NULL, "[BOOK...]" },
+    { NULL }
+};
+
+typedef struct
+{
+    const char* name;
+    bool compressed;
+    /* Where the book goes: a file of the scheme in the temporary
+     * directory when env is NULL, else the URL in that variable. */
+    const char* scheme;
+    const char* env;
+} BenchBackend;
+
+static const BenchBackend bench_backends[] =
+{
+    { "xml", false, "xml", NULL },
+    { "xml-gzip", true, "xml", NULL },
+    { "sqlite", false, "sqlite3", NULL },
+    { "mysql", false, "mysql", "GNC_BENCH_MYSQL_URL" },
+    { "pgsql", false, "postgres", "GNC_BENCH_PGSQL_URL" },
+};
+
+typedef struct
+{
+    gint64 start;
+    uint64_t selects;
+    uint64_t statements;
+} BenchMark;
+
+static void bench_reset_peak_rss (void);
+static gint64 bench_peak_rss (void);
+static const GncSqlConnection* bench_sql_connection (QofSession* session);
+
+/* Linux resets VmHWM to the current RSS when 5 is written to
+ * clear_refs; without that the peak would be the whole run's. */
+static void
+bench_reset_peak_rss (void)
+{
+    FILE* f = fopen ("/proc/self/clear_refs", "w");
+    if (f == NULL)
+        return;
+    fputs ("5", f);
+    fclose (f);
+}
+
+static gint64
+bench_peak_rss (void)
+{
+    gchar* status = NULL;
+    gint64 peak = -1;
+
+    if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+        return -1;
+    auto hwm = strstr (status, "VmHWM:");
+    if (hwm != NULL)
+        peak = g_ascii_strtoll (hwm + strlen ("VmHWM:"), NULL, 10);
+    g_free (status);
+    return peak;
+}
+
+static const GncSqlConnection*
+bench_sql_connection (QofSession* session)
+{
+    auto url = qof_session_get_url (session);
+    if (url == NULL || g_str_has_prefix (url, "xml") ||
+        g_str_has_prefix (url, "file"))
+        return NULL;
+    auto be = (GncSqlBackend*)qof_session_get_backend (session);
+    return be != NULL ? be->connection () : NULL;
+}
+
+static void
+bench_mark (QofSession* session, BenchMark* mark)
+{
+    auto conn = bench_sql_connection (session);
+    mark->selects = conn != NULL ? conn->select_count () : 0;
+    mark->statements = conn != NULL ? conn->nonselect_count () : 0;
+    bench_reset_peak_rss ();
+    mark->start = g_get_monotonic_time ();
+}
+
+static void
+bench_report (QofSession* session, const BenchMark* mark, const char* book,
+              const char* backend, const char* operation, const char* path)
+{
+    auto usecs = g_get_monotonic_time () - mark->start;
+    auto peak = bench_peak_rss ();
+    auto conn = bench_sql_connection (session);
+    GStatBuf st;
+
+    printf ("{\"book\":\"%s\",\"backend\":\"%s\",\"operation\":\"%s\","
+            "\"seconds\":%.6f", book, backend, operation,
+            usecs / (double) G_USEC_PER_SEC);
+    if (peak >= 0)
+        printf (",\"peak_rss_kb\":%" G_GINT64_FORMAT, peak);
+    else
+        printf (",\"peak_rss_kb\":null");
+    if (conn != NULL)
+        printf (",\"selects\":%" G_GUINT64_FORMAT
+                ",\"statements\":%" G_GUINT64_FORMAT,
+                static_cast<guint64>(conn->select_count () - mark->selects),
+                static_cast<guint64>(conn->nonselect_count () -
+                                     mark->statements));
+    else
+        printf (",\"selects\":null,\"statements\":null");
+    if (path != NULL && g_stat (path, &st) == 0)
+        printf (",\"bytes\":%" G_GINT64_FORMAT, (gint64) st.st_size);
+    else
+        printf (",\"bytes\":null");
+    if (qof_session_get_error (session) != ERR_BACKEND_NO_ERR)
+        printf (",\"error\":%d", qof_session_get_error (session));
+    printf ("}\n");
+    fflush (stdout);
+}
+
+static void
+bench_backend (QofSession* source, const char* book,
+               const BenchBackend* backend)
+{
+    gchar* path = NULL;
+    gchar* url;
+    BenchMark mark;
+
+    if (backend->env != NULL)
+    {
+        auto env_url = g_getenv (backend->env);
+        if (env_url == NULL || *env_url == '\0')
+            return;
+        url = g_strdup (env_url);
+    }
+    else
+    {
+        auto file = g_strdup_printf ("bench-backend-%s.%s", backend->name,
+                                     backend->scheme);
+        path = g_build_filename (g_get_tmp_dir (), file, NULL);
+        url = g_strdup_printf ("%s://%s", backend->scheme, path);
+        g_unlink (path);
+        g_free (file);
+    }
+    gnc_prefs_set_file_save_compressed (backend->compressed);
+
+    auto save = qof_session_new ();
+    qof_session_begin (save, url, FALSE, TRUE, TRUE);
+    if (qof_session_get_error (save) != ERR_BACKEND_NO_ERR)
+    {
+        printf ("{\"book\":\"%s\",\"backend\":\"%s\",\"skipped\":true,"
+                "\"error\":%d}\n", book, backend->name,
+                qof_session_get_error (save));
+        qof_session_destroy (save);
+        g_free (url);
+        g_free (path);
+        return;
+    }
+    qof_session_swap_data (source, save);
+    bench_mark (save, &mark);
+    qof_session_save (save, NULL);
+    bench_report (save, &mark, book, backend->name, "save", path);
+    qof_session_swap_data (source, save);
+    qof_session_end (save);
+    qof_session_destroy (save);
+
+    auto load = qof_session_new ();
+    qof_session_begin (load, url, TRUE, FALSE, FALSE);
+    bench_mark (load, &mark);
+    qof_session_load (load, NULL);
+    bench_report (load, &mark, book, backend->name, "load", NULL);
+    qof_session_end (load);
+    qof_session_destroy (load);
+
+    if (path != NULL)
+        g_unlink (path);
+    g_free (url);
+    g_free (path);
+}
+
+static void
+bench_book (QofSession* source, const char* book)
+{
+    for (auto& backend : bench_backends)
+        bench_backend (source, book, &backend);
+}
+
+int
+main (int argc, char** argv)
+{
+    auto context = g_option_context_new ("- backend load and save benchmarks");
+    GError* error = NULL;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    qof_init ();
+    cashobjects_register ();
+    gnc_module_init_backend_dbi ();
+    if (!qof_load_backend_library (xml_backend_dir != NULL ?
+                                   xml_backend_dir : "../../xml/.libs",
+                                   "gncmod-backend-xml"))
+        fprintf (stderr, "The xml backend could not be loaded\n");
+
+    if (reference_books == NULL)
+    {
+        srand (seed);
+        auto session = get_random_session ();
+        add_random_transactions_to_book (qof_session_get_book (session),
+                                         num_transactions);
+        gchar* name = g_strdup_printf ("random-%d-%d", num_transactions,
+                                       seed);
+        bench_book (session, name);
+        g_free (name);
+        qof_session_destroy (session);
+    }
+    else
+    {
+        for (auto book = reference_books; *book != NULL; book++)
+        {
+            auto session = qof_session_new ();
+            qof_session_begin (session, *book, TRUE, FALSE, FALSE);
+            qof_session_load (session, NULL);
+            if (qof_session_get_error (session) != ERR_BACKEND_NO_ERR)
+                fprintf (stderr, "Loading %s failed: %d\n", *book,
+                         qof_session_get_error (session));
+            else
+            {
+                auto name = g_path_get_basename (*book);
+                bench_book (session, name);
+                g_free (name);
+            }
+            qof_session_end (session);
+            qof_session_destroy (session);
+        }
+    }
+
+    g_strfreev (reference_books);
+    g_free (xml_backend_dir);
+    gnc_module_finalize_backend_dbi ();
+    qof_close ();
+    return 0;
+}
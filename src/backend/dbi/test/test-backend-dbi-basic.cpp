@@ -52,6 +52,8 @@ extern "C"
 }
 /* For test_conn_index_functions */
 #include "../gnc-backend-dbi.hpp"
+/* For test_dbi_prefetched_result */
+#include "../gnc-dbisqlresult.hpp"
 extern "C"
 {
 #include <unittest-support.h>
@@ -134,6 +136,10 @@ setup_memory (Fixture* fixture, gconstpointer pData)
     auto guid = qof_instance_get_guid (QOF_INSTANCE (acct1));
     frame->set ("guid-val", new KvpValue (const_cast<GncGUID*> (guid_copy (
             guid))));
+    frame->set_path ("frame-val/nested/int64-val", new KvpValue (INT64_C (200)));
+    auto list = g_list_append (nullptr, new KvpValue (INT64_C (1)));
+    list = g_list_append (list, new KvpValue (g_strdup ("list string")));
+    frame->set ("list-val", new KvpValue (list));
 
     gnc_account_append_child (root, acct1);
 
@@ -353,7 +359,7 @@ test_conn_index_functions (QofBackend* qbe)
 
     auto index_list = conn->provider()->get_index_list (be->conn);
     g_test_message ("Returned from index list\n");
-    g_assert_cmpint (index_list.size(), == , 4);
+    g_assert_cmpint (index_list.size(), == , 7);
     for (auto index : index_list)
     {
         const char* errmsg;
@@ -414,6 +420,232 @@ test_dbi_store_and_reload (Fixture* fixture, gconstpointer pData)
     qof_session_destroy (session_3);
 }
 
+/* The same with the GUIDs in the server's native type, where it has one. */
+static void
+test_dbi_store_and_reload_native_guids (Fixture* fixture, gconstpointer pData)
+{
+    g_setenv ("GNC_SQL_NATIVE_GUIDS", "1", TRUE);
+    test_dbi_store_and_reload (fixture, pData);
+    g_unsetenv ("GNC_SQL_NATIVE_GUIDS");
+}
+
+/* And with SQLite's write-ahead log and the bulk load profile for the save. */
+static void
+test_dbi_store_and_reload_sqlite_profile (Fixture* fixture, gconstpointer pData)
+{
+    g_setenv ("GNC_SQLITE_PERFORMANCE", "1", TRUE);
+    test_dbi_store_and_reload (fixture, pData);
+    g_unsetenv ("GNC_SQLITE_PERFORMANCE");
+}
+
+static Transaction*
+shared_lookup_tx (QofSession* session, const GncGUID* guid)
+{
+    return xaccTransLookup (guid, qof_session_get_book (session));
+}
+
+/* Two sessions open the same database in shared mode: what one of them
+ * commits the other picks up from the changes table. */
+static void
+test_dbi_shared_sessions (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_1 = qof_session_new ();
+    qof_session_begin (session_1, url, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_1);
+    qof_session_destroy (session_1);
+
+    /* The timer doesn't get to run, the changes are read by hand. */
+    g_setenv ("GNC_SQL_SHARED", "3600", TRUE);
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    g_unsetenv ("GNC_SQL_SHARED");
+    auto be_3 = reinterpret_cast<GncSqlBackend*>(qof_session_get_backend (session_3));
+    g_assert (be_3->shared ());
+
+    auto book = qof_session_get_book (session_2);
+    auto table = gnc_commodity_table_get_table (book);
+    auto currency = gnc_commodity_table_lookup (table,
+                                                GNC_COMMODITY_NS_CURRENCY,
+                                                "CAD");
+    auto accounts = gnc_account_get_descendants (gnc_book_get_root_account (book));
+    g_assert (accounts != NULL);
+    auto acct = static_cast<Account*>(accounts->data);
+    g_list_free (accounts);
+    auto amount = gnc_numeric_create (1234, 100);
+    auto tx = xaccMallocTransaction (book);
+    xaccTransBeginEdit (tx);
+    xaccTransSetCurrency (tx, currency);
+    xaccTransSetDatePostedSecsNormalized (tx, 1420070400);
+    xaccTransSetDescription (tx, "Shared");
+    auto spl1 = xaccMallocSplit (book);
+    xaccSplitSetAccount (spl1, acct);
+    xaccSplitSetParent (spl1, tx);
+    xaccSplitSetAmount (spl1, amount);
+    xaccSplitSetValue (spl1, amount);
+    auto spl2 = xaccMallocSplit (book);
+    xaccSplitSetAccount (spl2, acct);
+    xaccSplitSetParent (spl2, tx);
+    xaccSplitSetAmount (spl2, gnc_numeric_neg (amount));
+    xaccSplitSetValue (spl2, gnc_numeric_neg (amount));
+    xaccTransCommitEdit (tx);
+    GncGUID guid = *qof_instance_get_guid (tx);
+
+    g_assert (shared_lookup_tx (session_3, &guid) == NULL);
+    g_assert (be_3->load_changes ());
+    auto tx_3 = shared_lookup_tx (session_3, &guid);
+    g_assert (tx_3 != NULL);
+    g_assert_cmpstr (xaccTransGetDescription (tx_3), == , "Shared");
+    g_assert_cmpint (xaccTransCountSplits (tx_3), == , 2);
+
+    xaccTransBeginEdit (tx);
+    xaccTransSetDescription (tx, "Shared again");
+    xaccSplitDestroy (spl2);
+    xaccSplitSetAmount (spl1, gnc_numeric_zero ());
+    xaccSplitSetValue (spl1, gnc_numeric_zero ());
+    xaccTransCommitEdit (tx);
+    g_assert (be_3->load_changes ());
+    g_assert (shared_lookup_tx (session_3, &guid) == tx_3);
+    g_assert_cmpstr (xaccTransGetDescription (tx_3), == , "Shared again");
+    g_assert_cmpint (xaccTransCountSplits (tx_3), == , 1);
+
+    xaccTransBeginEdit (tx);
+    xaccTransDestroy (tx);
+    xaccTransCommitEdit (tx);
+    g_assert (be_3->load_changes ());
+    g_assert (shared_lookup_tx (session_3, &guid) == NULL);
+
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+static Transaction*
+cold_period_tx (QofBook* book, Account* acct1, Account* acct2,
+                time64 date, gint64 cents)
+{
+    auto currency = xaccAccountGetCommodity (acct1);
+    auto amount = gnc_numeric_create (cents, 100);
+    auto tx = xaccMallocTransaction (book);
+    xaccTransBeginEdit (tx);
+    xaccTransSetCurrency (tx, currency);
+    xaccTransSetDatePostedSecsNormalized (tx, date);
+    auto spl1 = xaccMallocSplit (book);
+    xaccSplitSetAccount (spl1, acct1);
+    xaccSplitSetParent (spl1, tx);
+    xaccSplitSetAmount (spl1, amount);
+    xaccSplitSetValue (spl1, amount);
+    auto spl2 = xaccMallocSplit (book);
+    xaccSplitSetAccount (spl2, acct2);
+    xaccSplitSetParent (spl2, tx);
+    xaccSplitSetAmount (spl2, gnc_numeric_neg (amount));
+    xaccSplitSetValue (spl2, gnc_numeric_neg (amount));
+    xaccTransCommitEdit (tx);
+    return tx;
+}
+
+/* A session leaving the closed periods in the database has only the later
+ * transactions, with the earlier ones in the accounts' balances until an
+ * account's splits are asked for. */
+static void
+test_dbi_cold_period (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session_1 = qof_session_new ();
+    qof_session_begin (session_1, url, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+
+    auto book = qof_session_get_book (session_1);
+    auto root = gnc_book_get_root_account (book);
+    auto currency = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                                GNC_COMMODITY_NS_CURRENCY,
+                                                "CAD");
+    Account* accts[2];
+    for (auto& acct : accts)
+    {
+        acct = xaccMallocAccount (book);
+        xaccAccountBeginEdit (acct);
+        xaccAccountSetType (acct, ACCT_TYPE_BANK);
+        xaccAccountSetName (acct, "Cold");
+        xaccAccountSetCommodity (acct, currency);
+        gnc_account_append_child (root, acct);
+        xaccAccountCommitEdit (acct);
+    }
+    /* 2010-06-01 and 2016-06-01 */
+    auto old_tx = cold_period_tx (book, accts[0], accts[1], 1275393600, 10000);
+    auto new_tx = cold_period_tx (book, accts[0], accts[1], 1464782400, 2500);
+    GncGUID acct_guid = *qof_instance_get_guid (accts[0]);
+    GncGUID old_guid = *qof_instance_get_guid (old_tx);
+    GncGUID new_guid = *qof_instance_get_guid (new_tx);
+    qof_session_end (session_1);
+    qof_session_destroy (session_1);
+
+    g_setenv ("GNC_SQL_COLD_BEFORE", "2015-01-01", TRUE);
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_2, NULL);
+    g_unsetenv ("GNC_SQL_COLD_BEFORE");
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+
+    book = qof_session_get_book (session_2);
+    auto acct = xaccAccountLookup (&acct_guid, book);
+    auto balance = gnc_numeric_create (12500, 100);
+    g_assert (acct != NULL);
+    g_assert (gnc_account_get_splits_pending (acct));
+    g_assert (xaccTransLookup (&new_guid, book) != NULL);
+    g_assert (xaccTransLookup (&old_guid, book) == NULL);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (acct), balance));
+
+    g_assert_cmpint (gnc_account_n_splits (acct), == , 2);
+    g_assert (!gnc_account_get_splits_pending (acct));
+    g_assert (xaccTransLookup (&old_guid, book) != NULL);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalance (acct), balance));
+
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+}
+
+/* A freshly saved database has an index for each of the common lookups. */
+static void
+test_dbi_analyze_queries (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    if (fixture->filename)
+        url = fixture->filename;
+
+    auto session = qof_session_new ();
+    qof_session_begin (session, url, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session);
+    qof_session_save (session, NULL);
+    g_assert_cmpint (qof_session_get_error (session), == , ERR_BACKEND_NO_ERR);
+    auto be = reinterpret_cast<GncSqlBackend*>(qof_session_get_backend (session));
+    auto missing = be->analyze_queries ();
+    g_assert_cmpint (missing.size (), == , 0);
+    qof_session_end (session);
+    qof_session_destroy (session);
+}
+
 /** Test the safe_save mechanism.  Beware that this test used on its
  * own doesn't ensure that the resave is done safely, only that the
  * database is intact and unchanged after the save. To observe the
@@ -629,6 +861,274 @@ test_adjust_sql_options_string (void)
     }
 }
 
+/* The rows of a prefetched result must read like those of the dbi_result
+ * it was made from. */
+static void
+test_dbi_prefetched_result (void)
+{
+    auto dbname = g_strdup_printf ("test-prefetch-%d.sqlite3", getpid ());
+#if HAVE_LIBDBI_R
+    auto conn = dbi_conn_new_r ("sqlite3", dbi_instance);
+#else
+    auto conn = dbi_conn_new ("sqlite3");
+#endif
+    g_assert (conn != nullptr);
+    dbi_conn_set_option (conn, "sqlite3_dbdir", g_get_tmp_dir ());
+    dbi_conn_set_option (conn, "dbname", dbname);
+    g_assert_cmpint (dbi_conn_connect (conn), ==, 0);
+    dbi_result_free (dbi_conn_query (conn, "CREATE TABLE t (id integer, "
+                                     "amount double, name text)"));
+    dbi_result_free (dbi_conn_query (conn, "INSERT INTO t VALUES "
+                                     "(1, 2.5, 'one')"));
+    dbi_result_free (dbi_conn_query (conn, "INSERT INTO t VALUES "
+                                     "(2, -0.125, NULL)"));
+
+    const char* sql = "SELECT * FROM t ORDER BY id";
+    GncDbiSqlResult direct {nullptr, dbi_conn_query (conn, sql)};
+    auto fetched = dbi_conn_query (conn, sql);
+    GncDbiPrefetchedResult prefetched {fetched};
+    dbi_result_free (fetched);
+
+    g_assert_cmpint (prefetched.size (), ==, 2);
+    auto row = direct.begin ();
+    for (auto prow : prefetched)
+    {
+        g_assert (row != direct.end ());
+        g_assert_cmpint (prow.get_int_at_col ("id"), ==,
+                         row.get_int_at_col ("id"));
+        g_assert_cmpfloat (prow.get_double_at_col ("amount"), ==,
+                           row.get_double_at_col ("amount"));
+        g_assert (prow.is_col_null ("name") == row.is_col_null ("name"));
+        if (!row.is_col_null ("name"))
+            g_assert_cmpstr (prow.get_string_at_col ("name").c_str (), ==,
+                             row.get_string_at_col ("name").c_str ());
+        else
+        {
+            auto threw = false;
+            try { prow.get_string_at_col ("name"); }
+            catch (std::invalid_argument&) { threw = true; }
+            g_assert (threw);
+        }
+        auto threw = false;
+        try { prow.get_time64_at_col ("id"); }
+        catch (std::invalid_argument&) { threw = true; }
+        g_assert (threw);
+        g_assert (prow.is_col_null ("nonesuch"));
+
+        auto name_idx = row.get_col_index ("name");
+        auto pname_idx = prow.get_col_index ("name");
+        g_assert_cmpint (name_idx, ==, row.get_col_index ("name"));
+        g_assert_cmpint (prow.get_int_at_idx (prow.get_col_index ("id")), ==,
+                         row.get_int_at_idx (row.get_col_index ("id")));
+        g_assert_cmpfloat (prow.get_double_at_idx (prow.get_col_index ("amount")),
+                           ==,
+                           row.get_double_at_idx (row.get_col_index ("amount")));
+        g_assert (prow.is_idx_null (pname_idx) == row.is_idx_null (name_idx));
+        g_assert_cmpstr (prow.get_cstring_at_idx (pname_idx), ==,
+                         row.get_cstring_at_idx (name_idx));
+        g_assert (prow.is_idx_null (prow.get_col_index ("nonesuch")));
+        ++row;
+    }
+    g_assert (row == direct.end ());
+
+    dbi_conn_close (conn);
+    auto path = g_build_filename (g_get_tmp_dir (), dbname, nullptr);
+    g_unlink (path);
+    g_free (path);
+    g_free (dbname);
+}
+
+/* A benchmark of the SQLite profiles, run with -m perf: the time to save a
+ * book of PERF_TXNS transactions, to load it back and to commit changes to
+ * PERF_COMMITS of them one by one.
+ */
+#define PERF_TXNS 5000
+#define PERF_COMMITS 200
+
+static void
+perf_sqlite_profile (const char* name, bool performance)
+{
+    if (performance)
+        g_setenv ("GNC_SQLITE_PERFORMANCE", "1", TRUE);
+    else
+        g_unsetenv ("GNC_SQLITE_PERFORMANCE");
+    auto filename = g_strdup_printf ("/tmp/test-sqlite-perf-%d", getpid ());
+
+    auto session_1 = qof_session_new ();
+    auto book = qof_session_get_book (session_1);
+    auto root = gnc_book_get_root_account (book);
+    auto table = gnc_commodity_table_get_table (book);
+    auto currency = gnc_commodity_table_lookup (table,
+                                                GNC_COMMODITY_NS_CURRENCY,
+                                                "CAD");
+    auto acct1 = xaccMallocAccount (book);
+    xaccAccountSetType (acct1, ACCT_TYPE_BANK);
+    xaccAccountSetName (acct1, "Perf 1");
+    xaccAccountSetCommodity (acct1, currency);
+    gnc_account_append_child (root, acct1);
+    auto acct2 = xaccMallocAccount (book);
+    xaccAccountSetType (acct2, ACCT_TYPE_EXPENSE);
+    xaccAccountSetName (acct2, "Perf 2");
+    xaccAccountSetCommodity (acct2, currency);
+    gnc_account_append_child (root, acct2);
+    for (auto i = 0; i < PERF_TXNS; ++i)
+    {
+        auto amount = gnc_numeric_create (100 + i, 100);
+        auto tx = xaccMallocTransaction (book);
+        xaccTransBeginEdit (tx);
+        xaccTransSetCurrency (tx, currency);
+        xaccTransSetDatePostedSecsNormalized (tx, 1420070400 + i * 3600);
+        xaccTransSetDescription (tx, "Perf");
+        auto spl1 = xaccMallocSplit (book);
+        xaccSplitSetAccount (spl1, acct1);
+        xaccSplitSetParent (spl1, tx);
+        xaccSplitSetAmount (spl1, gnc_numeric_neg (amount));
+        xaccSplitSetValue (spl1, gnc_numeric_neg (amount));
+        auto spl2 = xaccMallocSplit (book);
+        xaccSplitSetAccount (spl2, acct2);
+        xaccSplitSetParent (spl2, tx);
+        xaccSplitSetAmount (spl2, amount);
+        xaccSplitSetValue (spl2, amount);
+        xaccTransCommitEdit (tx);
+    }
+
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, filename, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (session_1, session_2);
+    g_test_timer_start ();
+    qof_session_save (session_2, NULL);
+    auto save_time = g_test_timer_elapsed ();
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_destroy (session_1);
+
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, filename, TRUE, FALSE, FALSE);
+    g_test_timer_start ();
+    qof_session_load (session_3, NULL);
+    auto load_time = g_test_timer_elapsed ();
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+
+    root = gnc_book_get_root_account (qof_session_get_book (session_3));
+    acct1 = gnc_account_lookup_by_name (root, "Perf 1");
+    g_assert (acct1 != NULL);
+    auto splits = xaccAccountGetSplitList (acct1);
+    auto n_commits = 0;
+    g_test_timer_start ();
+    for (auto node = splits; node && n_commits < PERF_COMMITS;
+         node = g_list_next (node), ++n_commits)
+    {
+        auto tx = xaccSplitGetParent (static_cast<Split*>(node->data));
+        xaccTransBeginEdit (tx);
+        xaccTransSetDescription (tx, "Changed");
+        xaccTransCommitEdit (tx);
+    }
+    auto commit_time = g_test_timer_elapsed ();
+    g_assert_cmpint (n_commits, ==, PERF_COMMITS);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+
+    g_test_message ("%s: save %.3f s, load %.3f s, commit %.2f ms", name,
+                    save_time, load_time, commit_time * 1000 / n_commits);
+    g_test_minimized_result (commit_time * 1000 / n_commits,
+                             "%s commit latency %.2f ms", name,
+                             commit_time * 1000 / n_commits);
+
+    g_unsetenv ("GNC_SQLITE_PERFORMANCE");
+    for (auto suffix : {"", "-wal", "-shm"})
+    {
+        auto path = g_strconcat (filename, suffix, nullptr);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_free (filename);
+}
+
+static void
+test_dbi_sqlite_profiles_perf (void)
+{
+    perf_sqlite_profile ("default", false);
+    perf_sqlite_profile ("performance", true);
+}
+
+/* The owner and address loaders build their column names in temporary
+ * strings, which the result mustn't mistake for one another. */
+static void
+test_dbi_owner_and_address (Fixture* fixture, gconstpointer pData)
+{
+    auto book = qof_session_get_book (fixture->session);
+    auto table = gnc_commodity_table_get_table (book);
+    auto currency = gnc_commodity_table_lookup (table,
+                                                GNC_COMMODITY_NS_CURRENCY,
+                                                "CAD");
+    auto cust = gncCustomerCreate (book);
+    gncCustomerSetID (cust, "0002");
+    gncCustomerSetName (cust, "Owner");
+    gncCustomerSetCurrency (cust, currency);
+    auto addr = gncCustomerGetAddr (cust);
+    gncAddressSetName (addr, "Owner's address");
+    gncAddressSetAddr1 (addr, "Line 1");
+    gncAddressSetAddr2 (addr, "Line 2");
+    gncAddressSetAddr3 (addr, "Line 3");
+    gncAddressSetAddr4 (addr, "Line 4");
+    gncAddressSetPhone (addr, "(123) 555-1212");
+    gncAddressSetFax (addr, "(123) 555-2121");
+    gncAddressSetEmail (addr, "owner@example.com");
+
+    GncOwner owner;
+    gncOwnerInitCustomer (&owner, cust);
+    auto inv = gncInvoiceCreate (book);
+    gncInvoiceSetID (inv, "0002");
+    gncInvoiceSetCurrency (inv, currency);
+    gncInvoiceSetOwner (inv, &owner);
+
+    auto cust_guid = *qof_instance_get_guid (QOF_INSTANCE (cust));
+    auto inv_guid = *qof_instance_get_guid (QOF_INSTANCE (inv));
+
+    auto msg = "[gnc_dbi_unlock()] There was no lock entry in the Lock table";
+    auto log_domain = "gnc.backend.dbi";
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    const gchar* url = fixture->filename ? fixture->filename : (gchar*)pData;
+    auto session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_session_save (session_2, NULL);
+
+    auto session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_3, NULL);
+    auto book_3 = qof_session_get_book (session_3);
+
+    auto inv_3 = gncInvoiceLookup (book_3, &inv_guid);
+    g_assert (inv_3 != NULL);
+    auto owner_3 = gncInvoiceGetOwner (inv_3);
+    g_assert_cmpint (gncOwnerGetType (owner_3), ==, GNC_OWNER_CUSTOMER);
+    g_assert (guid_equal (gncOwnerGetGUID (owner_3), &cust_guid));
+
+    auto cust_3 = gncCustomerLookup (book_3, &cust_guid);
+    g_assert (cust_3 != NULL);
+    auto addr_3 = gncCustomerGetAddr (cust_3);
+    g_assert_cmpstr (gncAddressGetName (addr_3), ==, "Owner's address");
+    g_assert_cmpstr (gncAddressGetAddr1 (addr_3), ==, "Line 1");
+    g_assert_cmpstr (gncAddressGetAddr2 (addr_3), ==, "Line 2");
+    g_assert_cmpstr (gncAddressGetAddr3 (addr_3), ==, "Line 3");
+    g_assert_cmpstr (gncAddressGetAddr4 (addr_3), ==, "Line 4");
+    g_assert_cmpstr (gncAddressGetPhone (addr_3), ==, "(123) 555-1212");
+    g_assert_cmpstr (gncAddressGetFax (addr_3), ==, "(123) 555-2121");
+    g_assert_cmpstr (gncAddressGetEmail (addr_3), ==, "owner@example.com");
+
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
 static void
 create_dbi_test_suite (const char* dbm_name, const char* url)
 {
@@ -641,6 +1141,8 @@ create_dbi_test_suite (const char* dbm_name, const char* url)
                   test_dbi_version_control, teardown);
     GNC_TEST_ADD (subsuite, "business_store_and_reload", Fixture, url,
                   setup_business, test_dbi_version_control, teardown);
+    GNC_TEST_ADD (subsuite, "analyze_queries", Fixture, url, setup,
+                  test_dbi_analyze_queries, teardown);
     g_free (subsuite);
 
 }
@@ -664,13 +1166,35 @@ test_suite_gnc_backend_dbi (void)
     for (auto name : drivers)
     {
         if (name == "sqlite3")
+        {
             create_dbi_test_suite ("sqlite3", "sqlite3");
+            GNC_TEST_ADD_FUNC (suitename, "prefetched result",
+                               test_dbi_prefetched_result);
+            GNC_TEST_ADD (suitename, "sqlite3/store_and_reload_profile",
+                          Fixture, "sqlite3", setup,
+                          test_dbi_store_and_reload_sqlite_profile, teardown);
+            GNC_TEST_ADD (suitename, "sqlite3/shared_sessions",
+                          Fixture, "sqlite3", setup,
+                          test_dbi_shared_sessions, teardown);
+            GNC_TEST_ADD (suitename, "sqlite3/cold_period",
+                          Fixture, "sqlite3", setup,
+                          test_dbi_cold_period, teardown);
+            GNC_TEST_ADD (suitename, "sqlite3/owner_and_address",
+                          Fixture, "sqlite3", setup_business,
+                          test_dbi_owner_and_address, teardown);
+            if (g_test_perf ())
+                GNC_TEST_ADD_FUNC (suitename, "sqlite3/profiles perf",
+                                   test_dbi_sqlite_profiles_perf);
+        }
         if (strlen (TEST_MYSQL_URL) > 0 && name == "mysql")
             create_dbi_test_suite ("mysql", TEST_MYSQL_URL);
         if (strlen (TEST_PGSQL_URL) > 0 && name == "pgsql")
         {
             g_setenv ("PGOPTIONS", "-c client_min_messages=WARNING", FALSE);
             create_dbi_test_suite ("postgres", TEST_PGSQL_URL);
+            GNC_TEST_ADD (suitename, "postgres/store_and_reload_native_guids",
+                          Fixture, TEST_PGSQL_URL, setup,
+                          test_dbi_store_and_reload_native_guids, teardown);
         }
     }
 
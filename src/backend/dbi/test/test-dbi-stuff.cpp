@@ -218,7 +218,7 @@ test_conn_index_functions (QofBackend* qbe)
 
     auto index_list = conn->provider()->get_index_list (be->conn);
     g_test_message ("Returned from index list\n");
-    g_assert_cmpint (index_list.size(), == , 4);
+    g_assert_cmpint (index_list.size(), == , 7);
     for (auto index : index_list)
     {
         const char* errmsg;
@@ -307,10 +307,7 @@ GncSqlAccountBackend::load_all (GncSqlBackend* be)
 
         qof_instance_decrease_editlevel (balances->acct);
     }
-    if (bal_slist != NULL)
-    {
-        g_slist_free (bal_slist);
-    }
+    g_slist_free_full (bal_slist, g_free);
 
     LEAVE ("");
 }
@@ -40,6 +40,7 @@ extern "C"
 #include <qofquery-p.h>
 #include <qofquerycore-p.h>
 #include <Account.h>
+#include <Query.h>
 #include <TransLog.h>
 #include <gnc-engine.h>
 #include <SX-book.h>
@@ -56,8 +57,10 @@ extern "C"
 #endif
 }
 
+#include <cstdio>
 #include <tuple>
 #include <iomanip>
+#include <kvp_frame.hpp>
 
 #include "gnc-backend-sql.h"
 
@@ -83,11 +86,27 @@ extern "C"
 #include "gnc-vendor-sql.h"
 
 #define VERSION_TABLE_NAME "versions"
+/* The version table's entry for the type of the GUID columns: only
+ * databases with native GUID columns have one. */
+#define GUIDS_VERSION_NAME "Gnucash-Guids"
+#define GUIDS_VERSION_NATIVE 2
 #define MAX_TABLE_NAME_LEN 50
 #define TABLE_COL_NAME "table_name"
 #define VERSION_COL_NAME "table_version"
+/* Shared mode's log of the objects each session committed. */
+#define CHANGES_TABLE_NAME "changes"
+#define CHANGES_TABLE_VERSION 1
+#define MAX_CHANGES_TYPE_LEN 50
 
 static void gnc_sql_init_object_handlers (void);
+static void load_tx_for_account_as_needed (QofBackend* qbe, Account* account);
+static gboolean load_balance_as_of_as_needed (QofBackend* qbe, Account* account,
+                                              time64 date, gnc_numeric* balance);
+static void load_splits_for_query_as_needed (QofBackend* qbe, QofQuery* query);
+static void load_prices_as_needed (QofBackend* qbe, GNCPriceDB* db,
+                                   const gnc_commodity* commodity,
+                                   const gnc_commodity* currency, Timespec t,
+                                   Timespec loaded_since);
 static GncSqlStatementPtr build_insert_statement (GncSqlBackend* be,
                                                   const gchar* table_name,
                                                   QofIdTypeConst obj_name,
@@ -172,6 +191,10 @@ gnc_sql_init(GncSqlBackend* be)
     if (!initialized)
     {
         gnc_sql_init_object_handlers ();
+        gnc_account_set_splits_loader (load_tx_for_account_as_needed);
+        gnc_account_set_balance_loader (load_balance_as_of_as_needed);
+        xaccQuerySetSplitsLoader (load_splits_for_query_as_needed);
+        gnc_pricedb_set_prices_loader (load_prices_as_needed);
         initialized = TRUE;
     }
 }
@@ -214,10 +237,45 @@ initial_load(const OBEEntry& entry, GncSqlBackend* be)
                   type) != fixed_load_order.end()) return;
     if (std::find(business_fixed_load_order.begin(), business_fixed_load_order.end(),
                   type) != business_fixed_load_order.end()) return;
+    /* Transactions are then loaded an account at a time by
+     * load_tx_for_account_as_needed. */
+    if (be->load_tx_as_needed() && type == GNC_ID_TRANS) return;
 
     obe->load_all (be);
 }
 
+/* The SELECTs started by the loads of gnc_sql_load, in their order. */
+static StrVec
+initial_load_queries (const GncSqlBackend* be)
+{
+    StrVec queries;
+    auto add_query = [&queries, be](GncSqlObjectBackendPtr obe) {
+        if (obe == nullptr)
+            return;
+        auto sql = obe->load_all_sql (be);
+        if (!sql.empty())
+            queries.push_back (sql);
+    };
+
+    for (auto type : fixed_load_order)
+        add_query (gnc_sql_get_object_backend (type));
+    for (auto type : business_fixed_load_order)
+        add_query (gnc_sql_get_object_backend (type));
+    for (auto entry : backend_registry)
+    {
+        std::string type;
+        GncSqlObjectBackendPtr obe = nullptr;
+        std::tie(type, obe) = entry;
+        if (std::find(fixed_load_order.begin(), fixed_load_order.end(),
+                      type) != fixed_load_order.end()) continue;
+        if (std::find(business_fixed_load_order.begin(),
+                      business_fixed_load_order.end(),
+                      type) != business_fixed_load_order.end()) continue;
+        add_query (obe);
+    }
+    return queries;
+}
+
 void
 gnc_sql_push_commodity_for_postload_processing (GncSqlBackend* be,
                                                 gpointer comm)
@@ -232,9 +290,86 @@ commit_commodity (gpointer data)
     gnc_sql_commit_commodity (comm);
 }
 
+static void
+set_splits_pending (QofBook* book, gboolean pending)
+{
+    auto set_pending = [](Account* acc, gpointer data) {
+        gnc_account_set_splits_pending (acc, GPOINTER_TO_INT (data));
+    };
+    auto root = gnc_book_get_root_account (book);
+    gnc_account_foreach_descendant (root, set_pending,
+                                    GINT_TO_POINTER (pending));
+    root = gnc_book_get_template_root (book);
+    if (root != nullptr)
+        gnc_account_foreach_descendant (root, set_pending,
+                                        GINT_TO_POINTER (pending));
+}
+
+/* An AccountSplitsLoader for accounts left pending by the initial load. */
+static void
+load_tx_for_account_as_needed (QofBackend* qbe, Account* account)
+{
+    auto be = reinterpret_cast<GncSqlBackend*>(qbe);
+    auto was_loading = be->loading();
+
+    be->set_loading(true);
+    qof_event_suspend ();
+    gnc_sql_transaction_load_tx_for_account (be, account);
+    qof_event_resume ();
+    be->set_loading(was_loading);
+}
+
+/* An AccountBalanceLoader summing the splits in the database, which
+ * holds everything once the queued commits are out. */
+static gboolean
+load_balance_as_of_as_needed (QofBackend* qbe, Account* account, time64 date,
+                              gnc_numeric* balance)
+{
+    auto be = reinterpret_cast<GncSqlBackend*>(qbe);
+
+    if (!be->flush_commits ())
+        return FALSE;
+    return gnc_sql_get_account_balance_as_of (be, account, date, balance);
+}
+
+/* A PriceDBPricesLoader for the pairs whose earlier prices the initial
+ * load left out. */
+static void
+load_prices_as_needed (QofBackend* qbe, GNCPriceDB* db,
+                       const gnc_commodity* commodity,
+                       const gnc_commodity* currency, Timespec t,
+                       Timespec loaded_since)
+{
+    auto be = reinterpret_cast<GncSqlBackend*>(qbe);
+    auto was_loading = be->loading();
+
+    be->set_loading(true);
+    qof_event_suspend ();
+    gnc_sql_price_load_before (be, commodity, currency,
+                               t.tv_sec == INT64_MIN ? nullptr : &t,
+                               loaded_since);
+    qof_event_resume ();
+    be->set_loading(was_loading);
+}
+
+/* A QuerySplitsLoader for split queries run while accounts are pending. */
+static void
+load_splits_for_query_as_needed (QofBackend* qbe, QofQuery* query)
+{
+    auto be = reinterpret_cast<GncSqlBackend*>(qbe);
+    auto was_loading = be->loading();
+
+    be->set_loading(true);
+    qof_event_suspend ();
+    gnc_sql_transaction_load_for_split_query (be, query);
+    qof_event_resume ();
+    be->set_loading(was_loading);
+}
+
 void
 gnc_sql_load (GncSqlBackend* be,  QofBook* book, QofBackendLoadType loadType)
 {
+    QOF_TRACE_SCOPE ("gnc_sql_load");
     Account* root;
 
     g_return_if_fail (be != NULL);
@@ -249,6 +384,15 @@ gnc_sql_load (GncSqlBackend* be,  QofBook* book, QofBackendLoadType loadType)
         g_assert (be->m_book == NULL);
         be->m_book = book;
 
+        /* Transactions loaded as needed don't take their slots now, so
+         * reading them all ahead would only cost memory. */
+        if (!be->load_tx_as_needed())
+            gnc_sql_slots_preload (be);
+
+        /* The connection may fetch the tables while the objects of those
+         * before them are created. */
+        be->m_conn->prefetch (initial_load_queries (be));
+
         /* Load any initial stuff. Some of this needs to happen in a certain order */
         for (auto type : fixed_load_order)
         {
@@ -275,15 +419,27 @@ gnc_sql_load (GncSqlBackend* be,  QofBook* book, QofBackendLoadType loadType)
 
         for (auto entry : backend_registry)
             initial_load(entry, be);
+        be->m_conn->end_prefetch ();
+        gnc_sql_slots_end_preload (be);
 
         gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
                                        nullptr);
+
+        /* What the accounts' starting balances don't carry forward. */
+        if (be->cold_before() != INT64_MIN)
+            gnc_sql_transaction_load_posted_since (be, be->cold_before());
+        if (be->load_tx_as_needed())
+            set_splits_pending (book, TRUE);
     }
     else if (loadType == LOAD_TYPE_LOAD_ALL)
     {
         // Load all transactions
         auto obe = gnc_sql_get_object_backend (GNC_ID_TRANS);
         obe->load_all (be);
+        if (be->load_tx_as_needed())
+            set_splits_pending (book, FALSE);
+        if (be->load_prices_as_needed())
+            gnc_pricedb_load_all_prices (gnc_pricedb_get_db (book));
     }
 
     be->m_loading = FALSE;
@@ -426,12 +582,30 @@ static EntryVec version_table
     gnc_sql_make_table_entry<CT_INT>(VERSION_COL_NAME, 0, COL_NNUL)
 };
 
+static EntryVec changes_table
+{
+    gnc_sql_make_table_entry<CT_INT>(
+        "id", 0, COL_PKEY | COL_NNUL | COL_AUTOINC),
+    gnc_sql_make_table_entry<CT_STRING>(
+        "session", GUID_ENCODING_LENGTH, COL_NNUL),
+    gnc_sql_make_table_entry<CT_STRING>(
+        "obj_type", MAX_CHANGES_TYPE_LEN, COL_NNUL),
+    gnc_sql_make_table_entry<CT_STRING>(
+        "obj_guid", GUID_ENCODING_LENGTH, COL_NNUL)
+};
+
 GncSqlBackend::GncSqlBackend(GncSqlConnection *conn, QofBook* book,
                              const char* format) :
         be {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
             nullptr, nullptr, nullptr, nullptr, ERR_BACKEND_NO_ERR, nullptr, 0,
             nullptr}, m_conn{conn}, m_book{book}, m_loading{false},
-        m_in_query{false}, m_is_pristine_db{false}, m_timespec_format{format}
+        m_in_query{false}, m_is_pristine_db{false}, m_load_tx_as_needed{false},
+        m_cold_before{INT64_MIN}, m_load_prices_as_needed{false},
+        m_native_guids{false}, m_want_native_guids{false},
+        m_timespec_format{format},
+        m_bulk_batch_size{0}, m_bulk_ok{true}, m_write_behind_ms{0},
+        m_write_behind_max{0}, m_flush_source{0}, m_flush_failed{false},
+        m_shared_s{0}, m_poll_source{0}, m_last_change{0}
 {
     if (conn != nullptr)
         connect (conn);
@@ -458,9 +632,24 @@ GncSqlBackend::create_statement_from_sql(const std::string& str) const noexcept
     return stmt;
 }
 
+GncSqlStatementPtr
+GncSqlBackend::create_write_statement(E_DB_OPERATION op,
+                                      const std::string& table_name,
+                                      const PairVec& values) const noexcept
+{
+    auto stmt = m_conn->create_write_statement(op, table_name, values);
+    if (stmt == nullptr)
+    {
+        PERR ("SQL error writing to %s\n", table_name.c_str());
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+    }
+    return stmt;
+}
+
 GncSqlResultPtr
 GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
+    flush_bulk_rows_for (stmt->to_sql());
     auto result = m_conn->execute_select_statement(stmt);
     if (result == nullptr)
     {
@@ -473,6 +662,7 @@ GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const no
 int
 GncSqlBackend::execute_nonselect_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
+    flush_bulk_rows_for (stmt->to_sql());
     auto result = m_conn->execute_nonselect_statement(stmt);
     if (result == -1)
     {
@@ -488,6 +678,165 @@ GncSqlBackend::quote_string(const std::string& str) const noexcept
     return m_conn->quote_string(str);
 }
 
+void
+GncSqlBackend::begin_bulk_insert(uint_t batch_size) noexcept
+{
+    m_bulk_batch_size = batch_size ? batch_size : 1;
+    m_bulk_ok = true;
+}
+
+bool
+GncSqlBackend::end_bulk_insert(bool write) noexcept
+{
+    if (write)
+        for (auto& entry : m_bulk_rows)
+            flush_bulk_rows (entry.second);
+    m_bulk_rows.clear();
+    m_bulk_batch_size = 0;
+    auto ok = m_bulk_ok;
+    m_bulk_ok = true;
+    return ok;
+}
+
+bool
+GncSqlBackend::bulk_insert(const std::string& table_name,
+                           const PairVec& values) noexcept
+{
+    if (m_bulk_batch_size == 0 || values.empty())
+        return false;
+
+    std::string columns, row{"("};
+    for (auto iter = values.begin(); iter != values.end(); ++iter)
+    {
+        if (iter != values.begin())
+        {
+            columns += ",";
+            row += ",";
+        }
+        columns += iter->first;
+        row += m_conn->quote_string(iter->second);
+    }
+    row += ")";
+
+    auto& pending = m_bulk_rows[table_name + " " + columns];
+    if (pending.table.empty())
+    {
+        pending.table = table_name;
+        pending.columns = columns;
+        pending.rows.reserve(m_bulk_batch_size);
+    }
+    pending.rows.push_back(std::move(row));
+    if (pending.rows.size() >= m_bulk_batch_size)
+        flush_bulk_rows (pending);
+    return m_bulk_ok;
+}
+
+bool
+GncSqlBackend::flush_bulk_rows(BulkRows& pending) const noexcept
+{
+    if (pending.rows.empty())
+        return true;
+
+    std::string sql{"INSERT INTO " + pending.table + "(" + pending.columns +
+            ") VALUES"};
+    for (auto iter = pending.rows.begin(); iter != pending.rows.end(); ++iter)
+    {
+        if (iter != pending.rows.begin())
+            sql += ",";
+        sql += *iter;
+    }
+    pending.rows.clear();
+
+    auto stmt = m_conn->create_statement_from_sql(sql);
+    if (stmt == nullptr || m_conn->execute_nonselect_statement(stmt) == -1)
+    {
+        PERR ("SQL error inserting rows into %s\n", pending.table.c_str());
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        m_bulk_ok = false;
+        return false;
+    }
+    return true;
+}
+
+/* Write out the waiting rows of each table that sql refers to, so that
+ * it sees them. Table names are matched as whole words. */
+bool
+GncSqlBackend::flush_bulk_rows_for(const char* sql) const noexcept
+{
+    auto ok = true;
+    if (m_bulk_rows.empty() || sql == nullptr)
+        return ok;
+
+    auto is_word_char = [](char c) {
+        return g_ascii_isalnum(c) || c == '_';
+    };
+    std::string text{sql};
+    for (auto& entry : m_bulk_rows)
+    {
+        auto& pending = entry.second;
+        if (pending.rows.empty())
+            continue;
+        for (auto pos = text.find(pending.table); pos != std::string::npos;
+             pos = text.find(pending.table, pos + 1))
+        {
+            auto end = pos + pending.table.size();
+            if ((pos == 0 || !is_word_char(text[pos - 1])) &&
+                (end == text.size() || !is_word_char(text[end])))
+            {
+                ok = flush_bulk_rows (pending) && ok;
+                break;
+            }
+        }
+    }
+    return ok;
+}
+
+bool
+GncSqlBackend::slots_unchanged(const GncGUID* guid,
+                               const KvpFrame* frame) const noexcept
+{
+    auto saved = m_saved_slots.find(*guid);
+    if (saved == m_saved_slots.end())
+        return false;
+    if (frame == nullptr || frame->empty())
+        return saved->second == nullptr;
+    return saved->second != nullptr && compare(*saved->second, *frame) == 0;
+}
+
+void
+GncSqlBackend::remember_slots(const GncGUID* guid,
+                              const KvpFrame* frame) noexcept
+{
+    if (frame == nullptr || frame->empty())
+        m_saved_slots[*guid] = nullptr;
+    else
+        m_saved_slots[*guid] = std::make_shared<KvpFrameImpl>(*frame);
+}
+
+void
+GncSqlBackend::forget_slots(const GncGUID* guid) noexcept
+{
+    m_saved_slots.erase(*guid);
+}
+
+bool
+GncSqlBackend::is_persisted(const GncGUID* guid) const noexcept
+{
+    return m_persisted.find(*guid) != m_persisted.end();
+}
+
+void
+GncSqlBackend::remember_persisted(const GncGUID* guid) noexcept
+{
+    m_persisted.insert(*guid);
+}
+
+void
+GncSqlBackend::forget_persisted(const GncGUID* guid) noexcept
+{
+    m_persisted.erase(*guid);
+}
+
 bool
 GncSqlBackend::create_table(const std::string& table_name,
                             const EntryVec& col_table) const noexcept
@@ -569,12 +918,15 @@ GncSqlBackend::init_version_info() noexcept
             unsigned int version = row.get_int_at_col (VERSION_COL_NAME);
             m_versions.push_back(std::make_pair(name, version));
         }
+        m_native_guids =
+            get_table_version (GUIDS_VERSION_NAME) == GUIDS_VERSION_NATIVE;
     }
     else
     {
         create_table (VERSION_TABLE_NAME, version_table);
         set_table_version("Gnucash", gnc_prefs_get_long_version ());
         set_table_version("Gnucash-Resave", GNUCASH_RESAVE_VERSION);
+        init_native_guids ();
     }
 }
 
@@ -594,9 +946,53 @@ GncSqlBackend::reset_version_info() noexcept
     m_versions.clear();
     set_table_version ("Gnucash", gnc_prefs_get_long_version ());
     set_table_version ("Gnucash-Resave", GNUCASH_RESAVE_VERSION);
+    init_native_guids ();
     return ok;
 }
 
+/* A new database, or one being written anew: its tables get native GUID
+ * columns if they're wanted and there are any. */
+void
+GncSqlBackend::init_native_guids() noexcept
+{
+    m_native_guids = m_want_native_guids && m_conn->has_native_guids();
+    if (m_native_guids)
+        set_table_version (GUIDS_VERSION_NAME, GUIDS_VERSION_NATIVE);
+}
+
+void
+GncSqlBackend::upgrade_guid_columns() noexcept
+{
+    if (m_native_guids || !m_want_native_guids || !m_conn->has_native_guids())
+        return;
+    /* Don't mistake an earlier error for one of the upgrade. */
+    if (qof_backend_check_error ((QofBackend*)this))
+        return;
+
+    PINFO ("Converting the GUID columns to the native GUID type");
+    if (!m_conn->begin_transaction ())
+        return;
+    m_native_guids = true;
+    for (auto entry : gnc_sql_get_backend_registry())
+    {
+        update_progress();
+        std::get<1>(entry)->upgrade_guid_columns (this);
+    }
+    if (qof_backend_check_error ((QofBackend*)this) ||
+        !set_table_version (GUIDS_VERSION_NAME, GUIDS_VERSION_NATIVE) ||
+        !m_conn->commit_transaction ())
+    {
+        PERR ("Converting the GUID columns failed, keeping the hex strings");
+        (void)m_conn->rollback_transaction ();
+        m_native_guids = false;
+        m_versions.erase (std::remove_if (m_versions.begin(), m_versions.end(),
+                                          [](const VersionPair& ver) {
+                                              return ver.first ==
+                                                  GUIDS_VERSION_NAME; }),
+                          m_versions.end());
+    }
+}
+
 /**
  * Finalizes the version table info by destroying the hash table.
  *
@@ -675,14 +1071,33 @@ GncSqlBackend::set_table_version (const std::string& table_name,
 
 void
 GncSqlBackend::upgrade_table (const std::string& table_name,
-                              const EntryVec& col_table) noexcept
+                              const EntryVec& col_table,
+                              bool cast_guids) noexcept
 {
     DEBUG ("Upgrading %s table\n", table_name.c_str());
 
     auto temp_table_name = table_name + "_new";
     create_table (temp_table_name, col_table);
     std::stringstream sql;
-    sql << "INSERT INTO " << temp_table_name << " SELECT * FROM " << table_name;
+    sql << "INSERT INTO " << temp_table_name << " SELECT ";
+    if (cast_guids)
+    {
+        ColVec info_vec;
+        for (auto const& table_row : col_table)
+            table_row->add_to_table (this, info_vec);
+        for (auto iter = info_vec.begin(); iter != info_vec.end(); ++iter)
+        {
+            if (iter != info_vec.begin())
+                sql << ",";
+            if (iter->m_type == BCT_GUID)
+                sql << m_conn->cast_to_guid (iter->m_name);
+            else
+                sql << iter->m_name;
+        }
+    }
+    else
+        sql << "*";
+    sql << " FROM " << table_name;
     auto stmt = create_statement_from_sql(sql.str());
     execute_nonselect_statement(stmt);
 
@@ -697,24 +1112,57 @@ GncSqlBackend::upgrade_table (const std::string& table_name,
     execute_nonselect_statement(stmt);
 }
 
+/* Days since 1970-01-01 of a date in the proleptic Gregorian calendar, and
+ * back, by the civil calendar algorithms of Howard Hinnant.  They spare
+ * the timestamps of every row the trip through gnc_gmtime() or the ISO
+ * 8601 parser. */
+static int64_t
+days_from_civil (int64_t year, int month, int day) noexcept
+{
+    year -= month <= 2;
+    auto era = (year >= 0 ? year : year - 399) / 400;
+    auto yoe = year - era * 400;
+    auto doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void
+civil_from_days (int64_t days, int& year, int& month, int& day) noexcept
+{
+    days += 719468;
+    auto era = (days >= 0 ? days : days - 146096) / 146097;
+    auto doe = days - era * 146097;
+    auto yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    auto doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    auto mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yoe + era * 400 + (month <= 2));
+}
+
 /* This is required because we're passing be->timespace_format to
- * g_strdup_printf.
+ * snprintf. Its %d conversions don't depend on the locale.
  */
 #pragma GCC diagnostic ignored "-Wformat-nonliteral"
 std::string
 GncSqlBackend::time64_to_string (time64 t) const noexcept
 {
-    auto tm = gnc_gmtime (&t);
-
-    auto year = tm->tm_year + 1900;
+    auto days = t / 86400;
+    auto secs = t % 86400;
+    if (secs < 0)
+    {
+        secs += 86400;
+        --days;
+    }
+    int year, month, day;
+    civil_from_days (days, year, month, day);
 
-    auto datebuf = g_strdup_printf (m_timespec_format,
-                                    year, tm->tm_mon + 1, tm->tm_mday,
-                                    tm->tm_hour, tm->tm_min, tm->tm_sec);
-    gnc_tm_free (tm);
-    std::string date{datebuf};
-    g_free(datebuf);
-    return date;
+    char datebuf[32];
+    snprintf (datebuf, sizeof (datebuf), m_timespec_format,
+              year, month, day, static_cast<int>(secs / 3600),
+              static_cast<int>(secs / 60 % 60), static_cast<int>(secs % 60));
+    return std::string{datebuf};
 }
 #pragma GCC diagnostic warning "-Wformat-nonliteral"
 
@@ -730,14 +1178,23 @@ gnc_sql_sync_all (GncSqlBackend* be,  QofBook* book)
     ENTER ("book=%p, be->book=%p", book, be->book());
     be->update_progress();
 
+    /* Anything queued goes to the old tables, which are kept if this fails. */
+    (void)be->flush_commits ();
+
     /* Create new tables */
     be->m_is_pristine_db = true;
+    be->forget_all_slots ();
+    be->forget_all_persisted ();
     for(auto entry : backend_registry)
         create_tables(entry, be);
 
     /* Save all contents */
     be->m_book = book;
     is_ok = be->m_conn->begin_transaction ();
+    /* Nothing is in the new tables yet, so every object is an INSERT;
+     * batch them up. */
+    if (is_ok)
+        be->begin_bulk_insert ();
 
     // FIXME: should write the set of commodities that are used
     //write_commodities( be, book );
@@ -767,6 +1224,8 @@ gnc_sql_sync_all (GncSqlBackend* be,  QofBook* book)
         for (auto entry : backend_registry)
             std::get<1>(entry)->write (be);
     }
+    if (!be->end_bulk_insert (is_ok))
+        is_ok = false;
     if (is_ok)
     {
         is_ok = be->m_conn->commit_transaction ();
@@ -785,6 +1244,8 @@ gnc_sql_sync_all (GncSqlBackend* be,  QofBook* book)
         if (!qof_backend_check_error ((QofBackend*)be))
             qof_backend_set_error ((QofBackend*)be, ERR_BACKEND_SERVER_ERR);
         is_ok = be->m_conn->rollback_transaction ();
+        be->forget_all_slots ();
+        be->forget_all_persisted ();
     }
     be->finish_progress();
     LEAVE ("book=%p", book);
@@ -845,19 +1306,20 @@ gnc_sql_commit_edit (GncSqlBackend* be, QofInstance* inst)
     g_return_if_fail (be != NULL);
     g_return_if_fail (inst != NULL);
 
-    if (qof_book_is_readonly (be->book()))
-    {
-        qof_backend_set_error ((QofBackend*)be, ERR_BACKEND_READONLY);
-        (void)be->m_conn->rollback_transaction ();
-        return;
-    }
     /* During initial load where objects are being created, don't commit
-    anything, but do mark the object as clean. */
+    anything, but do mark the object as clean. The same goes for loading
+    transactions as needed, which can happen in a read-only book. */
     if (be->m_loading)
     {
         qof_instance_mark_clean (inst);
         return;
     }
+    if (qof_book_is_readonly (be->book()))
+    {
+        qof_backend_set_error ((QofBackend*)be, ERR_BACKEND_READONLY);
+        (void)be->m_conn->rollback_transaction ();
+        return;
+    }
 
     // The engine has a PriceDB object but it isn't in the database
     if (strcmp (inst->e_type, "PriceDB") == 0)
@@ -883,6 +1345,27 @@ gnc_sql_commit_edit (GncSqlBackend* be, QofInstance* inst)
         return;
     }
 
+    /* Changes can wait, but new and deleted objects go out at once, after
+     * the queued changes. The queued commits can't know whether the
+     * object was new by then. */
+    if (be->write_behind () && !is_destroying && !is_infant)
+    {
+        if (!be->queue_commit (inst))
+        {
+            LEAVE ("Queued commits failed");
+            return;
+        }
+        qof_book_mark_session_saved (be->book());
+        qof_instance_mark_clean (inst);
+        LEAVE ("Queued");
+        return;
+    }
+    if (!be->flush_commits ())
+    {
+        LEAVE ("Queued commits failed");
+        return;
+    }
+
     if (!be->m_conn->begin_transaction ())
     {
         PERR ("gnc_sql_commit_edit(): begin_transaction failed\n");
@@ -897,6 +1380,8 @@ gnc_sql_commit_edit (GncSqlBackend* be, QofInstance* inst)
 
     for (auto entry : backend_registry)
         commit(entry, &be_data);
+    if (be_data.is_known && be_data.is_ok && be->shared ())
+        be_data.is_ok = be->log_change (inst);
 
     if (!be_data.is_known)
     {
@@ -913,6 +1398,8 @@ gnc_sql_commit_edit (GncSqlBackend* be, QofInstance* inst)
     {
         // Error - roll it back
         (void)be->m_conn->rollback_transaction ();
+        be->forget_all_slots ();
+        be->forget_all_persisted ();
 
         // This *should* leave things marked dirty
         LEAVE ("Rolled back - database error");
@@ -926,6 +1413,263 @@ gnc_sql_commit_edit (GncSqlBackend* be, QofInstance* inst)
 
     LEAVE ("");
 }
+
+void
+GncSqlBackend::set_write_behind(uint_t interval_ms, uint_t max_pending) noexcept
+{
+    if (interval_ms == 0)
+        (void)flush_commits();
+    m_write_behind_ms = interval_ms;
+    m_write_behind_max = max_pending ? max_pending : 1;
+}
+
+void
+GncSqlBackend::schedule_flush() noexcept
+{
+    if (m_flush_source != 0)
+        return;
+    m_flush_source = g_timeout_add (m_write_behind_ms ? m_write_behind_ms : 1,
+                                    [](gpointer data) -> gboolean
+                                    {
+                                        auto be = static_cast<GncSqlBackend*>(data);
+                                        be->m_flush_source = 0;
+                                        (void)be->flush_commits();
+                                        return FALSE;
+                                    }, this);
+}
+
+bool
+GncSqlBackend::queue_commit(QofInstance* inst) noexcept
+{
+    if (m_flush_failed && !flush_commits())
+        return false;
+
+    if (std::find(m_pending_commits.begin(), m_pending_commits.end(), inst) ==
+        m_pending_commits.end())
+    {
+        g_object_ref (inst);
+        m_pending_commits.push_back(inst);
+    }
+    if (m_pending_commits.size() >= m_write_behind_max)
+        return flush_commits();
+    schedule_flush();
+    return true;
+}
+
+bool
+GncSqlBackend::flush_commits() noexcept
+{
+    if (m_flush_source != 0)
+    {
+        g_source_remove (m_flush_source);
+        m_flush_source = 0;
+    }
+    if (m_pending_commits.empty())
+        return true;
+
+    ENTER ("%d queued", static_cast<int>(m_pending_commits.size()));
+    auto is_ok = m_conn->begin_transaction();
+    for (auto inst : m_pending_commits)
+    {
+        if (!is_ok)
+            break;
+        sql_backend be_data;
+        be_data.is_known = FALSE;
+        be_data.be = this;
+        be_data.inst = inst;
+        be_data.is_ok = TRUE;
+        for (auto entry : backend_registry)
+            commit(entry, &be_data);
+        is_ok = be_data.is_ok;
+        if (is_ok && shared())
+            is_ok = log_change(inst);
+    }
+    if (is_ok)
+        is_ok = m_conn->commit_transaction();
+    if (!is_ok)
+    {
+        (void)m_conn->rollback_transaction();
+        forget_all_slots();
+        forget_all_persisted();
+        if (!qof_backend_check_error ((QofBackend*)this))
+            qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        /* Keep the commits and try again later. */
+        m_flush_failed = true;
+        if (m_write_behind_ms > 0)
+            schedule_flush();
+        LEAVE ("Rolled back - database error");
+        return false;
+    }
+
+    for (auto inst : m_pending_commits)
+        g_object_unref (inst);
+    m_pending_commits.clear();
+    m_flush_failed = false;
+    LEAVE ("");
+    return true;
+}
+
+void
+GncSqlBackend::set_shared(uint_t interval_s) noexcept
+{
+    if (m_poll_source != 0)
+    {
+        g_source_remove (m_poll_source);
+        m_poll_source = 0;
+    }
+    m_shared_s = 0;
+    if (interval_s == 0)
+        return;
+    if (m_load_tx_as_needed)
+    {
+        /* The accounts' start balances would go wrong. */
+        PWARN ("Shared mode doesn't work with loading transactions as needed.");
+        return;
+    }
+    if (!create_changes_table())
+        return;
+
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+    auto guid = guid_new ();
+    (void)guid_to_string_buff (guid, guid_buf);
+    guid_free (guid);
+    m_session_id = guid_buf;
+
+    /* Only what's committed after the load is news. */
+    m_last_change = 0;
+    std::string sql{"SELECT id FROM " CHANGES_TABLE_NAME
+            " ORDER BY id DESC LIMIT 1"};
+    auto stmt = create_statement_from_sql (sql);
+    if (stmt == nullptr)
+        return;
+    auto result = execute_select_statement (stmt);
+    if (result == nullptr)
+        return;
+    for (auto row : *result)
+        m_last_change = row.get_int_at_col ("id");
+
+    m_shared_s = interval_s;
+    m_poll_source = g_timeout_add_seconds (interval_s,
+                                           [](gpointer data) -> gboolean
+                                           {
+                                               auto be = static_cast<GncSqlBackend*>(data);
+                                               (void)be->load_changes();
+                                               return TRUE;
+                                           }, this);
+}
+
+/* The lookups other than the initial load's, with the index each needs. */
+static const std::vector<std::pair<const char*, const char*>> common_queries
+{
+    {"splits(tx_guid)", "SELECT * FROM splits WHERE tx_guid = "
+     "'00000000000000000000000000000000'"},
+    {"splits(account_guid)", "SELECT * FROM splits WHERE account_guid = "
+     "'00000000000000000000000000000000'"},
+    {"splits(lot_guid)", "SELECT * FROM splits WHERE lot_guid = "
+     "'00000000000000000000000000000000'"},
+    {"transactions(post_date)", "SELECT * FROM transactions WHERE "
+     "post_date >= '1970-01-01 00:00:00'"},
+    {"prices(commodity_guid, currency_guid, date)", "SELECT * FROM prices "
+     "WHERE commodity_guid = '00000000000000000000000000000000' AND "
+     "currency_guid = '00000000000000000000000000000000' ORDER BY date"},
+    {"slots(obj_guid)", "SELECT * FROM slots WHERE obj_guid = "
+     "'00000000000000000000000000000000'"},
+    {"slots(guid_val)", "SELECT * FROM slots WHERE guid_val = "
+     "'00000000000000000000000000000000'"}
+};
+
+StrVec
+GncSqlBackend::analyze_queries() const noexcept
+{
+    StrVec missing;
+    for (auto const& query : common_queries)
+    {
+        if (!m_conn->is_full_scan (query.second))
+            continue;
+        PWARN ("No index for %s: %s", query.first, query.second);
+        missing.push_back (query.first);
+    }
+    return missing;
+}
+
+bool
+GncSqlBackend::create_changes_table() noexcept
+{
+    if (get_table_version (CHANGES_TABLE_NAME) != 0)
+        return true;
+    if (!create_table (CHANGES_TABLE_NAME, changes_table))
+        return false;
+    return set_table_version (CHANGES_TABLE_NAME, CHANGES_TABLE_VERSION);
+}
+
+bool
+GncSqlBackend::log_change(QofInstance* inst) noexcept
+{
+    /* A split's change is its transaction's. */
+    if (GNC_IS_SPLIT (inst))
+        inst = QOF_INSTANCE (xaccSplitGetParent (GNC_SPLIT (inst)));
+    if (inst == nullptr)
+        return true;
+    /* A full save drops and recreates the tables. */
+    if (!create_changes_table())
+        return false;
+
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+    (void)guid_to_string_buff (qof_instance_get_guid (inst), guid_buf);
+    std::stringstream sql;
+    sql << "INSERT INTO " << CHANGES_TABLE_NAME <<
+        " (session, obj_type, obj_guid) VALUES (" <<
+        quote_string (m_session_id) << "," <<
+        quote_string (inst->e_type) << "," <<
+        quote_string (guid_buf) << ")";
+    auto stmt = create_statement_from_sql (sql.str());
+    if (stmt == nullptr)
+        return false;
+    return execute_nonselect_statement (stmt) != -1;
+}
+
+bool
+GncSqlBackend::load_changes() noexcept
+{
+    if (!shared())
+        return true;
+    /* Whatever is still queued goes out first, so that it isn't
+     * overwritten. */
+    if (!flush_commits())
+        return false;
+
+    std::stringstream sql;
+    sql << "SELECT * FROM " << CHANGES_TABLE_NAME << " WHERE id > " <<
+        m_last_change << " ORDER BY id";
+    auto stmt = create_statement_from_sql (sql.str());
+    if (stmt == nullptr)
+        return false;
+    auto result = execute_select_statement (stmt);
+    if (result == nullptr)
+        return false;
+
+    std::vector<GncGUID> guids;
+    for (auto row : *result)
+    {
+        m_last_change = row.get_int_at_col ("id");
+        if (row.get_string_at_col ("session") == m_session_id ||
+            row.get_string_at_col ("obj_type") != GNC_ID_TRANS)
+            continue;
+        GncGUID guid;
+        if (!string_to_guid (row.get_string_at_col ("obj_guid").c_str(), &guid))
+            continue;
+        if (std::find_if (guids.begin(), guids.end(),
+                          [&guid](const GncGUID& g)
+                          { return guid_equal (&g, &guid); }) == guids.end())
+            guids.push_back (guid);
+    }
+    if (!guids.empty())
+    {
+        DEBUG ("Reloading %d transactions", static_cast<int>(guids.size()));
+        gnc_sql_transaction_reload (this, guids);
+    }
+    return true;
+}
 /* ---------------------------------------------------------------------- */
 
 /* Query processing */
@@ -1417,7 +2161,8 @@ GncSqlColumnTableEntry::add_objectref_guid_to_table (const GncSqlBackend* be,
 {
     g_return_if_fail (be != NULL);
 
-    GncSqlColumnInfo info{*this, BCT_STRING, GUID_ENCODING_LENGTH, FALSE};
+    GncSqlColumnInfo info{*this, be->native_guids() ? BCT_GUID : BCT_STRING,
+            GUID_ENCODING_LENGTH, FALSE};
     vec.emplace_back(std::move(info));
 }
 
@@ -1434,8 +2179,9 @@ GncSqlColumnTableEntryImpl<CT_STRING>::load (const GncSqlBackend* be,
 
     try
     {
-        auto s = row.get_string_at_col (m_col_name);
-        set_parameter(pObject, s.c_str(), get_setter(obj_name), m_gobj_param_name);
+        auto s = row.get_cstring_at_idx (row.get_col_index (m_col_name));
+        if (s != nullptr)
+            set_parameter(pObject, s, get_setter(obj_name), m_gobj_param_name);
     }
     catch (std::invalid_argument) {}
 }
@@ -1483,7 +2229,7 @@ GncSqlColumnTableEntryImpl<CT_INT>::load (const GncSqlBackend* be, GncSqlRow& ro
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != NULL || get_setter(obj_name) != NULL);
 
-    auto val = row.get_int_at_col(m_col_name);
+    auto val = row.get_int_at_idx (row.get_col_index (m_col_name));
     set_parameter(pObject, val,
                   reinterpret_cast<IntSetterFunc>(get_setter(obj_name)), m_gobj_param_name);
 }
@@ -1521,7 +2267,7 @@ GncSqlColumnTableEntryImpl<CT_BOOLEAN>::load (const GncSqlBackend* be,
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != NULL || get_setter(obj_name) != NULL);
 
-    auto val = row.get_int_at_col (m_col_name);
+    auto val = row.get_int_at_idx (row.get_col_index (m_col_name));
     set_parameter(pObject, val,
                   reinterpret_cast<BooleanSetterFunc>(get_setter(obj_name)),
                   m_gobj_param_name);
@@ -1559,7 +2305,7 @@ GncSqlColumnTableEntryImpl<CT_INT64>::load (const GncSqlBackend* be,
 {
     g_return_if_fail (m_gobj_param_name != nullptr || get_setter(obj_name) != nullptr);
 
-    auto val = row.get_int_at_col (m_col_name);
+    auto val = row.get_int_at_idx (row.get_col_index (m_col_name));
     set_parameter(pObject, val,
                   reinterpret_cast<Int64SetterFunc>(get_setter(obj_name)),
                   m_gobj_param_name);
@@ -1595,21 +2341,22 @@ GncSqlColumnTableEntryImpl<CT_DOUBLE>::load (const GncSqlBackend* be,
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != nullptr || get_setter(obj_name) != nullptr);
     double val;
+    auto idx = row.get_col_index (m_col_name);
     try
     {
-        val = static_cast<double>(row.get_int_at_col(m_col_name));
+        val = static_cast<double>(row.get_int_at_idx (idx));
     }
     catch (std::invalid_argument)
     {
         try
         {
-            val = static_cast<double>(row.get_float_at_col(m_col_name));
+            val = static_cast<double>(row.get_float_at_idx (idx));
         }
         catch (std::invalid_argument)
         {
             try
             {
-                val = row.get_double_at_col(m_col_name);
+                val = row.get_double_at_idx (idx);
             }
             catch (std::invalid_argument)
             {
@@ -1655,16 +2402,18 @@ GncSqlColumnTableEntryImpl<CT_GUID>::load (const GncSqlBackend* be,
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != nullptr || get_setter(obj_name) != nullptr);
 
-    std::string str;
+    const char* str;
     try
     {
-        str = row.get_string_at_col(m_col_name);
+        str = row.get_cstring_at_idx (row.get_col_index (m_col_name));
     }
     catch (std::invalid_argument)
     {
         return;
     }
-    (void)string_to_guid (str.c_str(), &guid);
+    if (str == nullptr)
+        return;
+    (void)string_to_guid (str, &guid);
     set_parameter(pObject, &guid, get_setter(obj_name), m_gobj_param_name);
 }
 
@@ -1674,7 +2423,8 @@ GncSqlColumnTableEntryImpl<CT_GUID>::add_to_table(const GncSqlBackend* be,
 {
     g_return_if_fail (be != NULL);
 
-    GncSqlColumnInfo info{*this, BCT_STRING, GUID_ENCODING_LENGTH, FALSE};
+    GncSqlColumnInfo info{*this, be->native_guids() ? BCT_GUID : BCT_STRING,
+            GUID_ENCODING_LENGTH, FALSE};
     vec.emplace_back(std::move(info));
 }
 
@@ -1701,6 +2451,31 @@ typedef void (*TimespecSetterFunc) (const gpointer, Timespec*);
 #define TIMESPEC_STR_FORMAT "%04d%02d%02d%02d%02d%02d"
 #define TIMESPEC_COL_SIZE (4+2+2+2+2+2)
 
+/* Read a TIMESPEC_STR_FORMAT string as UTC, as SQLite hands them back.
+ * Returns false unless s starts with its fourteen digits. */
+static bool
+timespec_from_digits (const char* s, Timespec& ts) noexcept
+{
+    int fields[6];
+    static const int widths[6] = { 4, 2, 2, 2, 2, 2 };
+    for (int i = 0; i < 6; ++i)
+    {
+        fields[i] = 0;
+        for (int j = 0; j < widths[i]; ++j, ++s)
+        {
+            if (*s < '0' || *s > '9')
+                return false;
+            fields[i] = fields[i] * 10 + (*s - '0');
+        }
+    }
+    if (fields[1] < 1 || fields[1] > 12 || fields[2] < 1 || fields[2] > 31)
+        return false;
+    ts.tv_sec = days_from_civil (fields[0], fields[1], fields[2]) * 86400 +
+        fields[3] * 3600 + fields[4] * 60 + fields[5];
+    ts.tv_nsec = 0;
+    return true;
+}
+
 template<> void
 GncSqlColumnTableEntryImpl<CT_TIMESPEC>::load (const GncSqlBackend* be,
                                                GncSqlRow& row,
@@ -1715,23 +2490,28 @@ GncSqlColumnTableEntryImpl<CT_TIMESPEC>::load (const GncSqlBackend* be,
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != nullptr || get_setter(obj_name) != nullptr);
 
+    auto idx = row.get_col_index (m_col_name);
     try
     {
-        auto val = row.get_time64_at_col(m_col_name);
+        auto val = row.get_time64_at_idx (idx);
         timespecFromTime64 (&ts, val);
     }
     catch (std::invalid_argument)
     {
         try
         {
-            auto val = row.get_string_at_col(m_col_name);
-            auto s = val.c_str();
-            auto buf = g_strdup_printf ("%c%c%c%c-%c%c-%c%c %c%c:%c%c:%c%c",
-                                        s[0], s[1], s[2], s[3], s[4], s[5],
-                                        s[6], s[7], s[8], s[9], s[10], s[11],
-                                        s[12], s[13]);
-            ts = gnc_iso8601_to_timespec_gmt (buf);
-            g_free (buf);
+            auto s = row.get_cstring_at_idx (idx);
+            if (s == nullptr)
+                return;
+            if (!timespec_from_digits (s, ts))
+            {
+                auto buf = g_strdup_printf ("%c%c%c%c-%c%c-%c%c %c%c:%c%c:%c%c",
+                                            s[0], s[1], s[2], s[3], s[4], s[5],
+                                            s[6], s[7], s[8], s[9], s[10],
+                                            s[11], s[12], s[13]);
+                ts = gnc_iso8601_to_timespec_gmt (buf);
+                g_free (buf);
+            }
         }
         catch (std::invalid_argument)
         {
@@ -1801,7 +2581,8 @@ GncSqlColumnTableEntryImpl<CT_GDATE>::load (const GncSqlBackend* be,
 {
     g_return_if_fail (pObject != NULL);
     g_return_if_fail (m_gobj_param_name != nullptr || get_setter(obj_name) != nullptr);
-    if (row.is_col_null(m_col_name))
+    auto idx = row.get_col_index (m_col_name);
+    if (row.is_idx_null (idx))
         return;
     GDate date;
     g_date_clear (&date, 1);
@@ -1810,7 +2591,7 @@ GncSqlColumnTableEntryImpl<CT_GDATE>::load (const GncSqlBackend* be,
 	/* timespec_to_gdate applies the tz, and gdates are saved
 	 * as ymd, so we don't want that.
 	 */
-	auto time = row.get_time64_at_col(m_col_name);
+	auto time = row.get_time64_at_idx (idx);
 	auto tm = gnc_gmtime(&time);
 	g_date_set_dmy(&date, tm->tm_mday,
 		       static_cast<GDateMonth>(tm->tm_mon + 1),
@@ -1821,7 +2602,9 @@ GncSqlColumnTableEntryImpl<CT_GDATE>::load (const GncSqlBackend* be,
     {
         try
         {
-            std::string str = row.get_string_at_col(m_col_name);
+            auto cstr = row.get_cstring_at_idx (idx);
+            if (cstr == nullptr) return;
+            std::string str{cstr};
             if (str.empty()) return;
             auto year = static_cast<GDateYear>(stoi (str.substr (0,4)));
             auto month = static_cast<GDateMonth>(stoi (str.substr (4,2)));
@@ -1891,11 +2674,9 @@ GncSqlColumnTableEntryImpl<CT_NUMERIC>::load (const GncSqlBackend* be,
     gnc_numeric n;
     try
     {
-        auto buf = g_strdup_printf ("%s_num", m_col_name);
-        auto num = row.get_int_at_col (buf);
-        g_free (buf);
-        buf = g_strdup_printf ("%s_denom", m_col_name);
-        auto denom = row.get_int_at_col (buf);
+        auto num = row.get_int_at_idx (row.get_col_index (m_col_name, "_num"));
+        auto denom = row.get_int_at_idx (row.get_col_index (m_col_name,
+                                                            "_denom"));
         n = gnc_numeric_create (num, denom);
     }
     catch (std::invalid_argument)
@@ -2040,21 +2821,30 @@ create_single_col_select_statement (GncSqlBackend* be,
 
 uint_t
 gnc_sql_append_guids_to_sql (std::stringstream& sql, const InstanceVec& instances)
+{
+    return gnc_sql_append_guids_to_sql (sql, instances.begin(),
+                                        instances.end());
+}
+
+uint_t
+gnc_sql_append_guids_to_sql (std::stringstream& sql,
+                             InstanceVec::const_iterator begin,
+                             InstanceVec::const_iterator end)
 {
     char guid_buf[GUID_ENCODING_LENGTH + 1];
 
-    for (auto inst : instances)
+    for (auto iter = begin; iter != end; ++iter)
     {
-        (void)guid_to_string_buff (qof_instance_get_guid (inst), guid_buf);
+        (void)guid_to_string_buff (qof_instance_get_guid (*iter), guid_buf);
 
-        if (inst != *(instances.begin()))
+        if (iter != begin)
         {
             sql << ",";
         }
         sql << "'" << guid_buf << "'";
     }
 
-    return instances.size();
+    return end - begin;
 }
 /* ================================================================= */
 static PairVec
@@ -2115,6 +2905,11 @@ gnc_sql_do_db_operation (GncSqlBackend* be,
     g_return_val_if_fail (obj_name != NULL, FALSE);
     g_return_val_if_fail (pObject != NULL, FALSE);
 
+    if (op == OP_DB_INSERT && be->bulk_insert_active())
+    {
+        PairVec values{get_object_values (be, obj_name, pObject, table)};
+        return be->bulk_insert (table_name, values);
+    }
     if (op == OP_DB_INSERT)
     {
         stmt = build_insert_statement (be, table_name, obj_name, pObject, table);
@@ -2131,47 +2926,72 @@ gnc_sql_do_db_operation (GncSqlBackend* be,
     {
         g_assert (FALSE);
     }
-    if (be->execute_nonselect_statement (stmt) != -1)
+    if (stmt != nullptr && be->execute_nonselect_statement (stmt) != -1)
         ok = true;
 
     return ok;
 }
 
+std::string
+gnc_sql_build_write_sql (const GncSqlConnection* conn, E_DB_OPERATION op,
+                         const std::string& table_name, const PairVec& values)
+{
+    std::ostringstream sql;
+
+    g_return_val_if_fail (conn != nullptr, "");
+    g_return_val_if_fail (!values.empty(), "");
+
+    if (op == OP_DB_INSERT)
+    {
+        sql << "INSERT INTO " << table_name <<"(";
+        for (auto iter = values.begin(); iter != values.end(); ++iter)
+        {
+            if (iter != values.begin())
+                sql << ",";
+            sql << iter->first;
+        }
+
+        sql << ") VALUES(";
+        for (auto iter = values.begin(); iter != values.end(); ++iter)
+        {
+            if (iter != values.begin())
+                sql << ",";
+            sql << conn->quote_string(iter->second);
+        }
+        sql << ")";
+    }
+    else
+    {
+        g_return_val_if_fail (op == OP_DB_UPDATE, "");
+        sql <<  "UPDATE " << table_name << " SET ";
+
+        for (auto iter = values.begin(); iter != values.end(); ++iter)
+        {
+            if (iter != values.begin())
+                sql << ",";
+            sql << iter->first << "=" << conn->quote_string(iter->second);
+        }
+        /* The where condition is just the first column and value, i.e.
+         * the guid of the object. */
+        sql << " WHERE " << values.front().first << " = " <<
+            conn->quote_string(values.front().second);
+    }
+    return sql.str();
+}
+
 static GncSqlStatementPtr
 build_insert_statement (GncSqlBackend* be,
                         const gchar* table_name,
                         QofIdTypeConst obj_name, gpointer pObject,
                         const EntryVec& table)
 {
-    GncSqlStatementPtr stmt;
-    PairVec col_values;
-    std::ostringstream sql;
-
     g_return_val_if_fail (be != NULL, NULL);
     g_return_val_if_fail (table_name != NULL, NULL);
     g_return_val_if_fail (obj_name != NULL, NULL);
     g_return_val_if_fail (pObject != NULL, NULL);
     PairVec values{get_object_values(be, obj_name, pObject, table)};
 
-    sql << "INSERT INTO " << table_name <<"(";
-    for (auto const& col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << col_value.first;
-    }
-
-    sql << ") VALUES(";
-    for (auto col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << be->quote_string(col_value.second);
-    }
-    sql << ")";
-
-    stmt = be->create_statement_from_sql(sql.str());
-    return stmt;
+    return be->create_write_statement(OP_DB_INSERT, table_name, values);
 }
 
 static GncSqlStatementPtr
@@ -2180,35 +3000,14 @@ build_update_statement (GncSqlBackend* be,
                         QofIdTypeConst obj_name, gpointer pObject,
                         const EntryVec& table)
 {
-    GncSqlStatementPtr stmt;
-    std::ostringstream sql;
-
     g_return_val_if_fail (be != NULL, NULL);
     g_return_val_if_fail (table_name != NULL, NULL);
     g_return_val_if_fail (obj_name != NULL, NULL);
     g_return_val_if_fail (pObject != NULL, NULL);
 
-
     PairVec values{get_object_values (be, obj_name, pObject, table)};
 
-    // Create the SQL statement
-    sql <<  "UPDATE " << table_name << " SET ";
-
-    for (auto const& col_value : values)
-    {
-        if (col_value != *values.begin())
-            sql << ",";
-        sql << col_value.first << "=" <<
-            be->quote_string(col_value.second);
-    }
-
-    stmt = be->create_statement_from_sql(sql.str());
-    /* We want our where condition to be just the first column and
-     * value, i.e. the guid of the object.
-     */
-    values.erase(values.begin() + 1, values.end());
-    stmt->add_where_cond(obj_name, values);
-    return stmt;
+    return be->create_write_statement(OP_DB_UPDATE, table_name, values);
 }
 
 static GncSqlStatementPtr
@@ -2294,6 +3093,14 @@ GncSqlObjectBackend::create_tables (GncSqlBackend* be)
              "Table creation aborted.", m_table_name.c_str(), m_version, version);
 }
 
+void
+GncSqlObjectBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != nullptr);
+    if (be->get_table_version (m_table_name) > 0)
+        be->upgrade_table (m_table_name, m_col_table, true);
+}
+
 /* ================================================================= */
 
 
@@ -51,6 +51,8 @@ extern "C"
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <map>
+#include <set>
 
 
 using uint_t = unsigned int;
@@ -64,6 +66,27 @@ using InstanceVec = std::vector<QofInstance*>;
 using PairVec = std::vector<std::pair<std::string, std::string>>;
 using VersionPair = std::pair<const std::string, unsigned int>;
 using VersionVec = std::vector<VersionPair>;
+
+typedef enum
+{
+    OP_DB_INSERT,
+    OP_DB_UPDATE,
+    OP_DB_DELETE
+} E_DB_OPERATION;
+
+/**
+ * Default number of rows in each multi-row INSERT written in bulk insert
+ * mode; see GncSqlBackend::begin_bulk_insert().  Older SQLite versions
+ * allow at most 500 rows in a VALUES list.
+ */
+#define GNC_SQL_BULK_BATCH_SIZE 250
+
+/**
+ * Default number of objects whose commits are queued in write-behind mode
+ * before they are written out; see GncSqlBackend::set_write_behind().
+ */
+#define GNC_SQL_WRITE_BEHIND_MAX 100
+
 class GncSqlConnection;
 class GncSqlStatement;
 using GncSqlStatementPtr = std::unique_ptr<GncSqlStatement>;
@@ -102,6 +125,9 @@ public:
     void finalize_version_info() noexcept;
     /* FIXME: These are just pass-throughs of m_conn functions. */
     GncSqlStatementPtr create_statement_from_sql(const std::string& str) const noexcept;
+    GncSqlStatementPtr create_write_statement(E_DB_OPERATION op,
+                                              const std::string& table_name,
+                                              const PairVec& values) const noexcept;
     /** Executes an SQL SELECT statement and returns the result rows.  If an
      * error occurs, an entry is added to the log, an error status is returned
      * to qof and nullptr is returned.
@@ -160,9 +186,13 @@ public:
      *
      * @param table_name SQL table name
      * @param col_table Column table
+     * @param cast_guids Convert the old table's GUID hex strings for the
+     * native GUID columns of the new one; the columns are SELECTed by name,
+     * so the old table must have them all.
      */
     void upgrade_table (const std::string& table_name,
-                        const EntryVec& col_table) noexcept;
+                        const EntryVec& col_table,
+                        bool cast_guids = false) noexcept;
     /**
      * Returns the version number for a DB table.
      *
@@ -178,14 +208,179 @@ public:
      * @return String representation of the Timespec
      */
     std::string time64_to_string (time64 t) const noexcept;
+    /**
+     * Starts collecting the rows of INSERTs made through
+     * gnc_sql_do_db_operation() instead of running each one. The rows are
+     * written per table as multi-row INSERTs of up to batch_size rows, and
+     * before any statement that mentions a table with rows waiting.
+     *
+     * @param batch_size Number of rows per INSERT
+     */
+    void begin_bulk_insert (uint_t batch_size = GNC_SQL_BULK_BATCH_SIZE) noexcept;
+    /**
+     * Writes any rows still waiting and stops collecting them.
+     *
+     * @param write false to drop the waiting rows, e.g. before a rollback
+     * @return false if writing this or any earlier batch failed
+     */
+    bool end_bulk_insert (bool write = true) noexcept;
+    /**
+     * Queues a row for the table, if begin_bulk_insert() is in effect.
+     *
+     * @return false if not collecting rows, or if a batch failed
+     */
+    bool bulk_insert (const std::string& table_name,
+                      const PairVec& values) noexcept;
+    bool bulk_insert_active () const noexcept { return m_bulk_batch_size > 0; }
+    /**
+     * Queues the commits of changed objects instead of writing each one in
+     * its own database transaction. An object committed again while queued
+     * is only written once. The queue is written out in one database
+     * transaction interval_ms after the first commit was queued, once
+     * max_pending objects are waiting, and before any object is created or
+     * deleted. It needs a running main loop for the timer.
+     *
+     * @param interval_ms 0 writes out what is queued and stops queueing
+     * @param max_pending Number of objects to queue at most
+     */
+    void set_write_behind (uint_t interval_ms,
+                           uint_t max_pending = GNC_SQL_WRITE_BEHIND_MAX) noexcept;
+    bool write_behind () const noexcept { return m_write_behind_ms > 0; }
+    /**
+     * Queues the commit of a changed object in write-behind mode. If
+     * writing out the queue failed before, it is tried again first.
+     *
+     * @return false if the queue couldn't be written out
+     */
+    bool queue_commit (QofInstance* inst) noexcept;
+    /**
+     * Writes out the queued commits in one database transaction. On
+     * failure the backend error is set and the commits stay queued.
+     *
+     * @return false if writing failed
+     */
+    bool flush_commits () noexcept;
+    /**
+     * Shares the database with other sessions: every commit logs the
+     * object in the changes table, and every interval_s seconds the
+     * transactions other sessions committed are reloaded, see
+     * gnc_sql_transaction_reload().  The other objects aren't.  It needs a
+     * running main loop for the timer and can't be used with
+     * load_tx_as_needed().  Call it after the initial load.
+     *
+     * @param interval_s 0 stops sharing
+     */
+    void set_shared (uint_t interval_s) noexcept;
+    bool shared () const noexcept { return m_shared_s > 0; }
+    /**
+     * Reloads the transactions other sessions committed since the last
+     * call.
+     *
+     * @return false if the changes couldn't be read
+     */
+    bool load_changes () noexcept;
+    /**
+     * Whether the slots of the object are the same as when they were last
+     * loaded from or written to the database, so that saving them again
+     * can be skipped.
+     *
+     * @param guid GUID of the object owning the slots
+     * @param frame The object's current slots
+     * @return false if the slots aren't known to be in the database
+     */
+    bool slots_unchanged (const GncGUID* guid,
+                          const KvpFrame* frame) const noexcept;
+    /**
+     * Records the slots of the object as being those in the database.
+     * The frame is copied.
+     */
+    void remember_slots (const GncGUID* guid, const KvpFrame* frame) noexcept;
+    void forget_slots (const GncGUID* guid) noexcept;
+    /** Forgets all recorded slots, e.g. after a rollback. */
+    void forget_all_slots () noexcept { m_saved_slots.clear(); }
+    /**
+     * Whether the object's row is known to be in the database because it
+     * was loaded or inserted since the last rollback, so that asking the
+     * database, e.g. in gnc_sql_save_commodity(), can be skipped.
+     *
+     * @param guid GUID of the object
+     * @return false if the row isn't known to be there
+     */
+    bool is_persisted (const GncGUID* guid) const noexcept;
+    /** Records the object's row as being in the database. */
+    void remember_persisted (const GncGUID* guid) noexcept;
+    void forget_persisted (const GncGUID* guid) noexcept;
+    /** Forgets all the rows recorded, e.g. after a rollback. */
+    void forget_all_persisted () noexcept { m_persisted.clear(); }
 
     QofBook* book() const noexcept { return m_book; }
 
     bool pristine() const noexcept { return m_is_pristine_db; }
     void update_progress() const noexcept;
     void finish_progress() const noexcept;
+    bool loading() const noexcept { return m_loading; }
     void set_loading(bool val) noexcept { m_loading = val; }
+    /**
+     * Whether the initial load leaves out the transactions, loading those
+     * of an account when something first asks for its splits instead.
+     * Must be set before the initial load.
+     */
+    bool load_tx_as_needed() const noexcept { return m_load_tx_as_needed; }
+    void set_load_tx_as_needed(bool val) noexcept { m_load_tx_as_needed = val; }
+    /**
+     * Leaves the transactions posted before date, those of the closed
+     * periods, in the database at the initial load, which then loads only
+     * the later ones.  It turns on load_tx_as_needed(): the accounts are
+     * left pending with the earlier splits carried forward in their
+     * starting balances, and the earlier transactions are loaded when an
+     * account's whole split list, or a split query that might match them,
+     * is asked for.  Must be set before the initial load.
+     *
+     * @param date INT64_MIN to load every transaction
+     */
+    void set_cold_before(time64 date) noexcept
+    {
+        m_cold_before = date;
+        if (date != INT64_MIN)
+            m_load_tx_as_needed = true;
+    }
+    time64 cold_before() const noexcept { return m_cold_before; }
+    /**
+     * Whether the initial load reads only the latest prices of each pair
+     * of commodities, loading the earlier ones when a lookup first needs
+     * them.  Must be set before the initial load.
+     */
+    bool load_prices_as_needed() const noexcept { return m_load_prices_as_needed; }
+    void set_load_prices_as_needed(bool val) noexcept { m_load_prices_as_needed = val; }
+    /**
+     * Whether the GUID columns have the database's native GUID type (see
+     * GncSqlConnection::has_native_guids()) instead of the hex string.  The
+     * version table records it, so existing databases keep what they have
+     * until upgrade_guid_columns() converts them.
+     */
+    bool native_guids() const noexcept { return m_native_guids; }
+    /**
+     * Ask for native GUID columns in the databases created from now on and
+     * in those upgrade_guid_columns() is called for.  Must be set before
+     * init_version_info().
+     */
+    void set_want_native_guids(bool val) noexcept { m_want_native_guids = val; }
+    /**
+     * Rebuilds all the tables with native GUID columns if they are wanted,
+     * the database has them and the tables don't use them yet.  Call it
+     * after the object backends' create_tables().  The tables are kept as
+     * they were if it fails.
+     */
+    void upgrade_guid_columns() noexcept;
+    /**
+     * Asks the database for its plans for the backend's common lookups and
+     * warns about those that have to read a whole table.
+     *
+     * @return The indexes the lookups lack, as "table(columns)"
+     */
+    StrVec analyze_queries() const noexcept;
     const char* timespec_format() const noexcept { return m_timespec_format; }
+    const GncSqlConnection* connection() const noexcept { return m_conn; }
 
     friend void gnc_sql_load(GncSqlBackend*, QofBook*, QofBackendLoadType);
     friend void gnc_sql_sync_all(GncSqlBackend*, QofBook*);
@@ -198,9 +393,52 @@ protected:
     bool m_loading;        /**< We are performing an initial load */
     bool m_in_query;       /**< We are processing a query */
     bool m_is_pristine_db; /**< Are we saving to a new pristine db? */
+    bool m_load_tx_as_needed; /**< Transactions are loaded per account */
+    time64 m_cold_before;     /**< Earlier transactions aren't loaded */
+    bool m_load_prices_as_needed; /**< Earlier prices are loaded per pair */
+    bool m_native_guids;      /**< GUID columns have the native type */
+    bool m_want_native_guids; /**< Use the native type where possible */
     VersionVec m_versions;    /**< Version number for each table */
     const char* m_timespec_format;   /**< Format string for SQL for timespec values */
 private:
+    void init_native_guids() noexcept;
+    /** Rows waiting to be inserted with the same table and columns. */
+    struct BulkRows
+    {
+        std::string table;
+        std::string columns;
+        std::vector<std::string> rows;
+    };
+    bool flush_bulk_rows (BulkRows& pending) const noexcept;
+    bool flush_bulk_rows_for (const char* sql) const noexcept;
+    uint_t m_bulk_batch_size;  /**< 0 unless in begin_bulk_insert() */
+    /** Keyed by table and column names. Mutable because any statement
+     * may need to write out rows first. */
+    mutable std::map<std::string, BulkRows> m_bulk_rows;
+    mutable bool m_bulk_ok;
+    void schedule_flush () noexcept;
+    uint_t m_write_behind_ms;  /**< 0 unless in write-behind mode */
+    uint_t m_write_behind_max;
+    guint m_flush_source;      /**< Timer writing out the queue, or 0 */
+    bool m_flush_failed;
+    bool create_changes_table () noexcept;
+    bool log_change (QofInstance* inst) noexcept;
+    uint_t m_shared_s;         /**< 0 unless in shared mode */
+    guint m_poll_source;       /**< Timer reading the changes, or 0 */
+    int64_t m_last_change;     /**< Last change read */
+    std::string m_session_id;  /**< Marks this session's changes */
+    /** Objects whose commits are queued, referenced, in commit order. */
+    std::vector<QofInstance*> m_pending_commits;
+    struct GuidLess
+    {
+        bool operator() (const GncGUID& a, const GncGUID& b) const noexcept
+        { return guid_compare (&a, &b) < 0; }
+    };
+    /** Copies of the slots last loaded or saved per object. A nullptr
+     * stands for no slots at all. */
+    std::map<GncGUID, std::shared_ptr<KvpFrame>, GuidLess> m_saved_slots;
+    /** Objects whose rows are known to be in the database. */
+    std::set<GncGUID, GuidLess> m_persisted;
 };
 
 /**
@@ -290,6 +528,15 @@ public:
         noexcept = 0;
     virtual GncSqlStatementPtr create_statement_from_sql (const std::string&)
         const noexcept = 0;
+    /** Returns a statement that writes the column values to the table:
+     * an INSERT for OP_DB_INSERT, or for OP_DB_UPDATE an UPDATE of the row
+     * whose first column matches the first value.  Connections able to
+     * prepare statements on the server reuse one per table, operation and
+     * set of columns.  Returns NULL if error. */
+    virtual GncSqlStatementPtr create_write_statement (E_DB_OPERATION,
+                                                       const std::string&,
+                                                       const PairVec&)
+        noexcept = 0;
     /** Returns true if successful */
     virtual bool does_table_exist (const std::string&) const noexcept = 0;
     /** Returns TRUE if successful, false if error */
@@ -316,6 +563,33 @@ public:
     virtual void set_error(int error, unsigned int repeat,  bool retry) noexcept = 0;
     virtual bool verify() noexcept = 0;
     virtual bool retry_connection(const char* msg) noexcept = 0;
+    /** Start running the SELECTs in the background, so that
+     * execute_select_statement() can hand their results over when they are
+     * asked for, in the same order.  Connections unable to do that ignore
+     * it. */
+    virtual void prefetch (const StrVec&) noexcept {}
+    /** Drop whatever prefetch() fetched that wasn't asked for. */
+    virtual void end_prefetch () noexcept {}
+    /** Whether the database has a GUID column type more compact than the
+     * 32 character hex string, which BCT_GUID columns then get.  It must
+     * accept the hex strings as literals. */
+    virtual bool has_native_guids () const noexcept { return false; }
+    /** SQL converting the hex string column col to the native GUID type. */
+    virtual std::string cast_to_guid (const std::string& col) const noexcept
+    {
+        return col;
+    }
+    /** Whether the database would read a whole table for the SELECT, as
+     * no index fits it.  Connections that can't tell say false. */
+    virtual bool is_full_scan (const std::string&) const noexcept
+    {
+        return false;
+    }
+    /** The number of SELECT statements run so far, for the benchmarks.
+     * Connections that don't count them say 0. */
+    virtual uint64_t select_count () const noexcept { return 0; }
+    /** The number of the other statements run so far, likewise. */
+    virtual uint64_t nonselect_count () const noexcept { return 0; }
 
 };
 
@@ -348,6 +622,17 @@ protected:
         virtual std::string get_string_at_col (const char* col) const = 0;
         virtual time64 get_time64_at_col (const char* col) const = 0;
         virtual bool is_col_null (const char* col) const noexcept = 0;
+        /* Access by the index get_col_index gives, which holds for every
+         * row of the result. get_cstring_at_idx returns nullptr for NULL
+         * and its string lasts until the next row. */
+        virtual int get_col_index (const char* col, const char* suffix)
+            const noexcept = 0;
+        virtual int64_t get_int_at_idx (int idx) const = 0;
+        virtual float get_float_at_idx (int idx) const = 0;
+        virtual double get_double_at_idx (int idx) const = 0;
+        virtual const char* get_cstring_at_idx (int idx) const = 0;
+        virtual time64 get_time64_at_idx (int idx) const = 0;
+        virtual bool is_idx_null (int idx) const noexcept = 0;
     };
 };
 
@@ -389,6 +674,27 @@ public:
         return m_iter->get_time64_at_col (col); }
     bool is_col_null (const char* col) const noexcept {
         return m_iter->is_col_null (col); }
+    /**
+     * The index of the column named col followed by suffix, if any, for
+     * the accessors below. The result looks each name up only once, by its
+     * address, so col and suffix must outlive it: string literals, like the
+     * column names of the EntryVecs, do.
+     */
+    int get_col_index (const char* col, const char* suffix = nullptr)
+        const noexcept { return m_iter->get_col_index (col, suffix); }
+    int64_t get_int_at_idx (int idx) const {
+        return m_iter->get_int_at_idx (idx); }
+    float get_float_at_idx (int idx) const {
+        return m_iter->get_float_at_idx (idx); }
+    double get_double_at_idx (int idx) const {
+        return m_iter->get_double_at_idx (idx); }
+    /** The string in the row itself, nullptr if NULL. */
+    const char* get_cstring_at_idx (int idx) const {
+        return m_iter->get_cstring_at_idx (idx); }
+    time64 get_time64_at_idx (int idx) const {
+        return m_iter->get_time64_at_idx (idx); }
+    bool is_idx_null (int idx) const noexcept {
+        return m_iter->is_idx_null (idx); }
 private:
     GncSqlResult::IteratorImpl* m_iter;
 };
@@ -424,6 +730,16 @@ public:
      * @param be The GncSqlBackend containing the database connection.
      */
     virtual void load_all (GncSqlBackend*) = 0;
+    /**
+     * The SELECT of the whole table that load_all() starts with, so that it
+     * can be fetched ahead of time.  Empty if the objects are loaded some
+     * other way.
+     * @param be The GncSqlBackend containing the database connection.
+     */
+    virtual std::string load_all_sql (const GncSqlBackend*) const
+    {
+        return "SELECT * FROM " + m_table_name;
+    }
     /**
      * Conditionally create or update a database table from m_col_table. The
      * condition is the version returned by querying the database's version
@@ -435,6 +751,13 @@ public:
      * @param be The GncSqlBackend containing the database connection.
      */
     virtual void create_tables (GncSqlBackend*);
+    /**
+     * Rebuild the existing tables with GncSqlBackend::upgrade_table() when
+     * the database switches to native GUID columns, recreating their
+     * indexes.  Only the m_col_table one by default.
+     * @param be The GncSqlBackend containing the database connection.
+     */
+    virtual void upgrade_guid_columns (GncSqlBackend*);
     /**
      * UPDATE/INSERT a single instance of m_type_name into the database.
      * @param be The GncSqlBackend containing the database.
@@ -506,7 +829,8 @@ typedef enum
     BCT_INT64,
     BCT_DATE,
     BCT_DOUBLE,
-    BCT_DATETIME
+    BCT_DATETIME,
+    BCT_GUID
 } GncSqlBasicColumnType;
 
 
@@ -625,8 +949,10 @@ public:
             try
             {
                 GncGUID guid;
-                auto val = row.get_string_at_col (m_col_name);
-                (void)string_to_guid (val.c_str(), &guid);
+                auto val = row.get_cstring_at_idx (row.get_col_index (m_col_name));
+                if (val == nullptr)
+                    return;
+                (void)string_to_guid (val, &guid);
                 auto target = get_ref(&guid);
                 if (target != nullptr)
                     set_parameter (pObject, target, get_setter(obj_name),
@@ -782,13 +1108,6 @@ inline bool operator!=(const GncSqlColumnInfo& l,
     return !(l == r);
 }
 
-typedef enum
-{
-    OP_DB_INSERT,
-    OP_DB_UPDATE,
-    OP_DB_DELETE
-} E_DB_OPERATION;
-
 
 /**
  * Set an object property with a setter function.
@@ -916,13 +1235,37 @@ const GncGUID* gnc_sql_load_guid (const GncSqlBackend* be, GncSqlRow& row);
 /**
  * Appends the ascii strings for a list of GUIDs to the end of an SQL string.
  *
- * @param str SQL string
- * @param list List of GUIDs
- * @param maxCount Max # of GUIDs to append
+ * @param sql SQL string
+ * @param instances Instances whose GUIDs are appended
  * @return Number of GUIDs appended
  */
 uint_t gnc_sql_append_guids_to_sql (std::stringstream& sql,
                                     const InstanceVec& instances);
+/**
+ * Builds the literal SQL text of the INSERT or UPDATE that
+ * GncSqlConnection::create_write_statement() describes, quoting the values
+ * with the connection.  For connections with no statement cache.
+ */
+std::string gnc_sql_build_write_sql (const GncSqlConnection* conn,
+                                     E_DB_OPERATION op,
+                                     const std::string& table_name,
+                                     const PairVec& values);
+/**
+ * Appends the GUIDs of the instances in [begin, end) to an SQL string.
+ *
+ * @return Number of GUIDs appended
+ */
+uint_t gnc_sql_append_guids_to_sql (std::stringstream& sql,
+                                    InstanceVec::const_iterator begin,
+                                    InstanceVec::const_iterator end);
+
+/**
+ * Largest number of GUIDs to put in one "IN (...)" list when loading
+ * the children of many objects, so that neither the statement nor its
+ * result grows with the size of the book.  Each GUID is about 35 bytes
+ * of SQL, well under MySQL's default max_allowed_packet per batch.
+ */
+#define GNC_SQL_GUID_BATCH_SIZE 1000
 
 void _retrieve_guid_ (gpointer pObject,  gpointer pValue);
 
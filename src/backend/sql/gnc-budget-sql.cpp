@@ -84,6 +84,7 @@ public:
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override;
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit (GncSqlBackend* be, QofInstance* inst) override;
     bool write(GncSqlBackend*) override;
 private:
@@ -372,6 +373,17 @@ GncSqlBudgetBackend::create_tables (GncSqlBackend* be)
     }
 }
 
+void
+GncSqlBudgetBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != NULL);
+
+    if (be->get_table_version (BUDGET_TABLE) > 0)
+        be->upgrade_table (BUDGET_TABLE, col_table, true);
+    if (be->get_table_version (AMOUNTS_TABLE) > 0)
+        be->upgrade_table (AMOUNTS_TABLE, budget_amounts_col_table, true);
+}
+
 /* ================================================================= */
 bool
 GncSqlBudgetBackend::commit (GncSqlBackend* be, QofInstance* inst)
@@ -164,6 +164,7 @@ GncSqlCommodityBackend::load_all (GncSqlBackend* be)
             if (qof_instance_is_dirty (QOF_INSTANCE (pCommodity)))
                 gnc_sql_push_commodity_for_postload_processing (be, (gpointer)pCommodity);
             qof_instance_set_guid (QOF_INSTANCE (pCommodity), &guid);
+            be->remember_persisted (&guid);
         }
 
         auto sql = g_strdup_printf ("SELECT DISTINCT guid FROM %s", COMMODITIES_TABLE);
@@ -202,6 +203,10 @@ do_commit_commodity (GncSqlBackend* be, QofInstance* inst,
     {
         // Now, commit any slots
         guid = qof_instance_get_guid (inst);
+        if (op == OP_DB_DELETE)
+            be->forget_persisted (guid);
+        else
+            be->remember_persisted (guid);
         if (!qof_instance_get_destroying (inst))
         {
             is_ok = gnc_sql_slots_save (be, guid, is_infant, inst);
@@ -231,8 +236,14 @@ is_commodity_in_db (GncSqlBackend* be, gnc_commodity* pCommodity)
     g_return_val_if_fail (be != NULL, FALSE);
     g_return_val_if_fail (pCommodity != NULL, FALSE);
 
-    return gnc_sql_object_is_it_in_db (be, COMMODITIES_TABLE, GNC_ID_COMMODITY,
-                                       pCommodity, col_table);
+    auto guid = qof_instance_get_guid (QOF_INSTANCE (pCommodity));
+    if (be->is_persisted (guid))
+        return TRUE;
+    if (!gnc_sql_object_is_it_in_db (be, COMMODITIES_TABLE, GNC_ID_COMMODITY,
+                                     pCommodity, col_table))
+        return FALSE;
+    be->remember_persisted (guid);
+    return TRUE;
 }
 
 gboolean
@@ -164,7 +164,8 @@ GncSqlColumnTableEntryImpl<CT_OWNERREF>::add_to_table(const GncSqlBackend* be,
     vec.emplace_back(std::move(info));
 /* Buf isn't leaking, it belongs to ColVec now. */
     buf = g_strdup_printf ("%s_guid", m_col_name);
-    GncSqlColumnInfo info2(buf, BCT_STRING, GUID_ENCODING_LENGTH, false, false,
+    GncSqlColumnInfo info2(buf, be->native_guids() ? BCT_GUID : BCT_STRING,
+                           GUID_ENCODING_LENGTH, false, false,
                            m_flags & COL_PKEY, m_flags & COL_NNUL);
     vec.emplace_back(std::move(info2));
 }
@@ -48,7 +48,7 @@ extern "C"
 static QofLogModule log_module = G_LOG_DOMAIN;
 
 #define TABLE_NAME "prices"
-#define TABLE_VERSION 2
+#define TABLE_VERSION 3
 
 #define PRICE_MAX_SOURCE_LEN 2048
 #define PRICE_MAX_TYPE_LEN 2048
@@ -67,6 +67,14 @@ static const EntryVec col_table
     gnc_sql_make_table_entry<CT_NUMERIC>("value", 0, COL_NNUL, "value")
 });
 
+/* The price database looks prices up by commodity, currency and date. */
+static const EntryVec lookup_col_table
+({
+    gnc_sql_make_table_entry<CT_COMMODITYREF>("commodity_guid", 0, 0),
+    gnc_sql_make_table_entry<CT_COMMODITYREF>("currency_guid", 0, 0),
+    gnc_sql_make_table_entry<CT_TIMESPEC>("date", 0, 0)
+});
+
 class GncSqlPriceBackend : public GncSqlObjectBackend
 {
 public:
@@ -74,7 +82,9 @@ public:
                       const std::string& table, const EntryVec& vec) :
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override;
+    std::string load_all_sql(const GncSqlBackend* be) const override;
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit (GncSqlBackend* be, QofInstance* inst) override;
     bool write(GncSqlBackend*) override;
 };
@@ -98,45 +108,121 @@ load_single_price (GncSqlBackend* be, GncSqlRow& row)
     return pPrice;
 }
 
+/* Loads the prices "SELECT prices.* FROM <from>" selects and their
+ * slots, and calls seen for each price. */
+template <typename F> static void
+load_prices (GncSqlBackend* be, const std::string& from, F seen)
+{
+    auto pPriceDB = gnc_pricedb_get_db (be->book());
+    auto stmt = be->create_statement_from_sql("SELECT " TABLE_NAME ".* FROM " +
+                                              from);
+    if (stmt == nullptr)
+        return;
+
+    auto result = be->execute_select_statement(stmt);
+    if (result->begin() == result->end())
+        return;
+
+    gnc_pricedb_set_bulk_update (pPriceDB, TRUE);
+    for (auto row : *result)
+    {
+        auto pPrice = load_single_price (be, row);
+
+        if (pPrice != NULL)
+        {
+            seen (pPrice);
+            (void)gnc_pricedb_add_price (pPriceDB, pPrice);
+            gnc_price_unref (pPrice);
+        }
+    }
+    gnc_pricedb_set_bulk_update (pPriceDB, FALSE);
+
+    auto sql = "SELECT DISTINCT " TABLE_NAME ".guid FROM " + from;
+    gnc_sql_slots_load_for_sql_subquery (be, sql.c_str(),
+                                         (BookLookupFn)gnc_price_lookup);
+}
+
+/* The prices of each pair on its latest date, which are all the initial
+ * load reads when the earlier ones are loaded as needed. */
+static std::string
+latest_prices_from ()
+{
+    return TABLE_NAME " INNER JOIN (SELECT commodity_guid, currency_guid, "
+        "MAX(date) AS latest FROM " TABLE_NAME
+        " GROUP BY commodity_guid, currency_guid) l ON "
+        TABLE_NAME ".commodity_guid = l.commodity_guid AND "
+        TABLE_NAME ".currency_guid = l.currency_guid AND "
+        TABLE_NAME ".date = l.latest";
+}
+
+std::string
+GncSqlPriceBackend::load_all_sql (const GncSqlBackend* be) const
+{
+    if (be->load_prices_as_needed())
+        return "SELECT " TABLE_NAME ".* FROM " + latest_prices_from ();
+    return "SELECT " TABLE_NAME ".* FROM " TABLE_NAME;
+}
+
 void
 GncSqlPriceBackend::load_all (GncSqlBackend* be)
 {
-    QofBook* pBook;
-    GNCPriceDB* pPriceDB;
-
     g_return_if_fail (be != NULL);
 
-    pBook = be->book();
-    pPriceDB = gnc_pricedb_get_db (pBook);
-    std::stringstream sql;
-    sql << "SELECT * FROM " << TABLE_NAME;
-    auto stmt = be->create_statement_from_sql(sql.str());
-    if (stmt != nullptr)
+    if (!be->load_prices_as_needed())
     {
-        auto result = be->execute_select_statement(stmt);
-        if (result->begin() == result->end())
-            return;
-
-        GNCPrice* pPrice;
-        gchar* sql;
+        load_prices (be, TABLE_NAME, [](GNCPrice*) {});
+        return;
+    }
 
-        gnc_pricedb_set_bulk_update (pPriceDB, TRUE);
-        for (auto row : *result)
-        {
-            pPrice = load_single_price (be, row);
+    auto pPriceDB = gnc_pricedb_get_db (be->book());
+    load_prices (be, latest_prices_from (), [pPriceDB](GNCPrice* p) {
+            auto t = gnc_price_get_time (p);
+            gnc_pricedb_set_prices_pending (pPriceDB, gnc_price_get_commodity (p),
+                                            gnc_price_get_currency (p), &t);
+        });
+}
 
-            if (pPrice != NULL)
-            {
-                (void)gnc_pricedb_add_price (pPriceDB, pPrice);
-                gnc_price_unref (pPrice);
-            }
-        }
-        gnc_pricedb_set_bulk_update (pPriceDB, FALSE);
+void
+gnc_sql_price_load_before (GncSqlBackend* be, const gnc_commodity* commodity,
+                           const gnc_commodity* currency, const Timespec* t,
+                           Timespec loaded_since)
+{
+    gchar commodity_guid[GUID_ENCODING_LENGTH + 1];
+    gchar currency_guid[GUID_ENCODING_LENGTH + 1];
 
-        sql = g_strdup_printf ("SELECT DISTINCT guid FROM %s", TABLE_NAME);
-        gnc_sql_slots_load_for_sql_subquery (be, sql, (BookLookupFn)gnc_price_lookup);
-        g_free (sql);
-    }
+    g_return_if_fail (be != NULL);
+    g_return_if_fail (commodity != NULL && currency != NULL);
+
+    guid_to_string_buff (qof_instance_get_guid (commodity), commodity_guid);
+    guid_to_string_buff (qof_instance_get_guid (currency), currency_guid);
+    std::stringstream pair;
+    pair << "commodity_guid = '" << commodity_guid <<
+        "' AND currency_guid = '" << currency_guid << "'";
+
+    /* The rows come from the prices_lookup_index. */
+    std::stringstream from;
+    from << TABLE_NAME << " WHERE " << pair.str() << " AND date < '" <<
+        be->time64_to_string (loaded_since.tv_sec) << "'";
+    if (t != nullptr)
+        from << " AND date >= COALESCE((SELECT MAX(date) FROM " << TABLE_NAME <<
+            " WHERE " << pair.str() << " AND date <= '" <<
+            be->time64_to_string (t->tv_sec) << "'), (SELECT MIN(date) FROM " <<
+            TABLE_NAME << " WHERE " << pair.str() << "))";
+
+    auto earliest = loaded_since;
+    auto found = false;
+    load_prices (be, from.str(), [&earliest, &found](GNCPrice* p) {
+            auto price_t = gnc_price_get_time (p);
+            if (timespec_cmp (&price_t, &earliest) < 0)
+                earliest = price_t;
+            found = true;
+        });
+
+    /* Whether still earlier prices are left isn't known; if there are
+     * none the next load finds nothing and marks nothing. */
+    if (found && t != nullptr)
+        gnc_pricedb_set_prices_pending (gnc_pricedb_get_db (be->book()),
+                                        commodity, currency, &earliest);
 }
 
 /* ================================================================= */
@@ -151,17 +237,40 @@ GncSqlPriceBackend::create_tables (GncSqlBackend* be)
     if (version == 0)
     {
         (void)be->create_table(TABLE_NAME, TABLE_VERSION, col_table);
+        if (!be->create_index ("prices_lookup_index", TABLE_NAME,
+                               lookup_col_table))
+            PERR ("Unable to create index\n");
     }
-    else if (version == 1)
+    else if (version < TABLE_VERSION)
     {
-        /* Upgrade 64 bit int handling */
-        be->upgrade_table(TABLE_NAME, col_table);
+        /* Upgrade:
+            1->2: 64 bit int handling
+            2->3: Add commodity, currency and date index
+        */
+        if (version == 1)
+            be->upgrade_table(TABLE_NAME, col_table);
+        if (!be->create_index ("prices_lookup_index", TABLE_NAME,
+                               lookup_col_table))
+            PERR ("Unable to create index\n");
         be->set_table_version (TABLE_NAME, TABLE_VERSION);
 
-        PINFO ("Prices table upgraded from version 1 to version %d\n", TABLE_VERSION);
+        PINFO ("Prices table upgraded from version %d to version %d\n",
+               version, TABLE_VERSION);
     }
 }
 
+void
+GncSqlPriceBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != NULL);
+
+    if (be->get_table_version (TABLE_NAME) == 0)
+        return;
+    be->upgrade_table (TABLE_NAME, col_table, true);
+    if (!be->create_index ("prices_lookup_index", TABLE_NAME, lookup_col_table))
+        PERR ("Unable to create index\n");
+}
+
 /* ================================================================= */
 
 bool
@@ -228,6 +337,7 @@ GncSqlPriceBackend::write (GncSqlBackend* be)
     g_return_val_if_fail (be != NULL, FALSE);
     write_objects_t data{be, true, this};
 
+    /* Iterating the prices loads those left pending first. */
     auto priceDB = gnc_pricedb_get_db (be->book());
     return gnc_pricedb_foreach_price (priceDB, write_price, &data, TRUE);
 }
@@ -29,6 +29,26 @@
 #ifndef GNC_PRICE_SQL_H
 #define GNC_PRICE_SQL_H
 
+#include "gnc-backend-sql.h"
+extern "C"
+{
+#include "gnc-pricedb.h"
+}
 void gnc_sql_init_price_handler (void);
 
+/**
+ * Loads the prices of commodity in currency dated before loaded_since
+ * and no earlier than the latest one dated no later than *t, or all of
+ * them before loaded_since if there is none or t is NULL, and marks the
+ * pair pending again if earlier ones may be left.
+ *
+ * @param be SQL backend
+ * @param t The date a lookup wants a price for
+ * @param loaded_since The date from which on the pair's prices are loaded
+ */
+void gnc_sql_price_load_before (GncSqlBackend* be,
+                                const gnc_commodity* commodity,
+                                const gnc_commodity* currency,
+                                const Timespec* t, Timespec loaded_since);
+
 #endif /* GNC_PRICE_SQL_H */
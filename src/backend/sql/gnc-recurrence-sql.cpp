@@ -120,6 +120,7 @@ public:
                       const std::string& table, const EntryVec& vec) :
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override { return; }
+    std::string load_all_sql(const GncSqlBackend*) const override { return ""; }
     void create_tables(GncSqlBackend*) override;
     bool commit(GncSqlBackend*, QofInstance*) override { return false; }
 };
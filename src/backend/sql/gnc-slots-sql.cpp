@@ -43,17 +43,19 @@ extern "C"
 #include "gnc-slots-sql.h"
 
 #include <kvp_frame.hpp>
+#include <map>
 
 static QofLogModule log_module = G_LOG_DOMAIN;
 
 #define TABLE_NAME "slots"
-#define TABLE_VERSION 3
+#define TABLE_VERSION 4
 
 typedef enum
 {
     NONE,
     FRAME,
-    LIST
+    LIST,
+    SCAN    /* A row of gnc_sql_slots_preload(), whose value is only read */
 } context_t;
 
 typedef struct
@@ -67,8 +69,20 @@ typedef struct
     context_t context;
     KvpValue* pKvpValue;
     GString* path;
+    GncGUID child_guid;  /* Where a scanned frame or list keeps its slots */
 } slot_info_t;
 
+struct GuidLess
+{
+    bool operator() (const GncGUID& a, const GncGUID& b) const noexcept
+    { return guid_compare (&a, &b) < 0; }
+};
+
+/* The top-level slots read by gnc_sql_slots_preload(), by owner, until the
+ * owners are loaded and take them. */
+static const GncSqlBackend* preload_backend = nullptr;
+static std::map<GncGUID, KvpFrame*, GuidLess> preloaded_slots;
+
 
 static  gpointer get_obj_guid (gpointer pObject);
 static void set_obj_guid (void);
@@ -92,6 +106,7 @@ static GDate* get_gdate_val (gpointer pObject);
 static void set_gdate_val (gpointer pObject, GDate* value);
 static slot_info_t* slot_info_copy (slot_info_t* pInfo, GncGUID* guid);
 static void slots_load_info (slot_info_t* pInfo);
+static bool take_preloaded_slots (GncSqlBackend* be, QofInstance* inst);
 
 #define SLOT_MAX_PATHNAME_LEN 4096
 #define SLOT_MAX_STRINGVAL_LEN 4096
@@ -155,6 +170,12 @@ static const EntryVec obj_guid_col_table
                                       _retrieve_guid_),
 };
 
+/* For finding the slots referring to an object. */
+static const EntryVec guid_val_col_table
+{
+    gnc_sql_make_table_entry<CT_GUID>("guid_val", 0, 0),
+};
+
 static const EntryVec gdate_col_table
 {
     gnc_sql_make_table_entry<CT_GDATE>("gdate_val", 0, 0),
@@ -171,7 +192,9 @@ public:
                       const std::string& table, const EntryVec& vec) :
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override { return; }
+    std::string load_all_sql(const GncSqlBackend*) const override { return ""; }
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit(GncSqlBackend*, QofInstance*) override { return false; }
 };
 
@@ -257,6 +280,9 @@ set_slot_from_value (slot_info_t* pInfo, KvpValue* pValue)
         pInfo->pList = g_list_append (pInfo->pList, pValue);
         break;
     }
+    case SCAN:
+        pInfo->pKvpValue = pValue;
+        break;
     case NONE:
     default:
     {
@@ -311,10 +337,9 @@ set_path (gpointer pObject,  gpointer pValue)
     g_return_if_fail (pValue != NULL);
 
     if (pInfo->path != NULL)
-    {
-        (void)g_string_free (pInfo->path, TRUE);
-    }
-    pInfo->path = g_string_new ((gchar*)pValue);
+        pInfo->path = g_string_assign (pInfo->path, (gchar*)pValue);
+    else
+        pInfo->path = g_string_new ((gchar*)pValue);
 }
 
 static KvpValue::Type
@@ -490,6 +515,12 @@ set_guid_val (gpointer pObject,  gpointer pValue)
     }
     case KvpValue::Type::GLIST:
     {
+        if (pInfo->context == SCAN)
+        {
+            pInfo->child_guid = *static_cast<GncGUID*> (pValue);
+            set_slot_from_value (pInfo, new KvpValue {(GList*)nullptr});
+            break;
+        }
         slot_info_t* newInfo = slot_info_copy (pInfo, (GncGUID*)pValue);
         KvpValue* pValue = NULL;
         gchar* key = get_key_from_path (pInfo->path);
@@ -506,6 +537,12 @@ set_guid_val (gpointer pObject,  gpointer pValue)
     }
     case KvpValue::Type::FRAME:
     {
+        if (pInfo->context == SCAN)
+        {
+            pInfo->child_guid = *static_cast<GncGUID*> (pValue);
+            set_slot_from_value (pInfo, new KvpValue {new KvpFrame});
+            break;
+        }
         slot_info_t* newInfo = slot_info_copy (pInfo, (GncGUID*)pValue) ;
         auto newFrame = new KvpFrame;
         newInfo->pKvpFrame = newFrame;
@@ -713,9 +750,15 @@ gnc_sql_slots_save (GncSqlBackend* be, const GncGUID* guid, gboolean is_infant,
     g_return_val_if_fail (guid != NULL, FALSE);
     g_return_val_if_fail (pFrame != NULL, FALSE);
 
-    // If this is not saving into a new db, clear out the old saved slots first
+    // If this is not saving into a new db, clear out the old saved slots
+    // first, unless they are the same as the ones being saved.
     if (!be->pristine() && !is_infant)
     {
+        if (be->slots_unchanged (guid, pFrame))
+        {
+            (void)g_string_free (slot_info.path, TRUE);
+            return TRUE;
+        }
         (void)gnc_sql_slots_delete (be, guid);
     }
 
@@ -724,6 +767,8 @@ gnc_sql_slots_save (GncSqlBackend* be, const GncGUID* guid, gboolean is_infant,
     pFrame->for_each_slot (save_slot, &slot_info);
     (void)g_string_free (slot_info.path, TRUE);
 
+    if (slot_info.is_ok)
+        be->remember_slots (guid, pFrame);
     return slot_info.is_ok;
 }
 
@@ -737,6 +782,7 @@ gnc_sql_slots_delete (GncSqlBackend* be, const GncGUID* guid)
     g_return_val_if_fail (be != NULL, FALSE);
     g_return_val_if_fail (guid != NULL, FALSE);
 
+    be->forget_slots (guid);
     (void)guid_to_string_buff (guid, guid_buf);
 
     buf = g_strdup_printf ("SELECT * FROM %s WHERE obj_guid='%s' and slot_type in ('%d', '%d') and not guid_val is null",
@@ -813,12 +859,20 @@ gnc_sql_slots_load (GncSqlBackend* be, QofInstance* inst)
     g_return_if_fail (be != NULL);
     g_return_if_fail (inst != NULL);
 
+    if (take_preloaded_slots (be, inst))
+    {
+        (void)g_string_free (info.path, TRUE);
+        return;
+    }
+
     info.be = be;
     info.guid = qof_instance_get_guid (inst);
     info.pKvpFrame = qof_instance_get_slots (inst);
     info.context = NONE;
 
     slots_load_info (&info);
+    if (info.is_ok)
+        be->remember_slots (info.guid, info.pKvpFrame);
 }
 
 static void
@@ -837,12 +891,19 @@ slots_load_info (slot_info_t* pInfo)
     buf << "SELECT * FROM " << TABLE_NAME <<
         " WHERE obj_guid='" << guid_buf << "'";
     auto stmt = pInfo->be->create_statement_from_sql (buf.str());
-    if (stmt != nullptr)
+    if (stmt == nullptr)
     {
-        auto result = pInfo->be->execute_select_statement (stmt);
-        for (auto row : *result)
-            load_slot (pInfo, row);
+        pInfo->is_ok = FALSE;
+        return;
+    }
+    auto result = pInfo->be->execute_select_statement (stmt);
+    if (result == nullptr)
+    {
+        pInfo->is_ok = FALSE;
+        return;
     }
+    for (auto row : *result)
+        load_slot (pInfo, row);
 }
 
 static  const GncGUID*
@@ -857,6 +918,131 @@ load_obj_guid (const GncSqlBackend* be, GncSqlRow& row)
     return &guid;
 }
 
+/* Trims the trailing /es off a slot's name, which is the whole path to it,
+ * and returns its last segment, the key. */
+static const char*
+key_from_name (std::string& name)
+{
+    auto end = name.find_last_not_of ('/');
+    name.erase (end == std::string::npos ? 0 : end + 1);
+    auto slash = name.rfind ('/');
+    return name.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+static bool
+take_preloaded_slots (GncSqlBackend* be, QofInstance* inst)
+{
+    if (preload_backend != be)
+        return false;
+    auto guid = qof_instance_get_guid (inst);
+    auto frame = qof_instance_get_slots (inst);
+    auto spot = preloaded_slots.find (*guid);
+    if (spot != preloaded_slots.end())
+    {
+        auto slots = spot->second;
+        for (auto& key : slots->get_keys())
+            delete frame->set (key.c_str(), slots->set (key.c_str(), nullptr));
+        delete slots;
+        preloaded_slots.erase (spot);
+    }
+    be->remember_slots (guid, frame);
+    return true;
+}
+
+void
+gnc_sql_slots_preload (GncSqlBackend* be)
+{
+    using SlotVec = std::vector<std::pair<std::string, KvpValue*>>;
+    /* The rows of each obj_guid: an object's top-level slots or the
+     * contents of a frame or list slot, in the order they were saved. */
+    std::map<GncGUID, SlotVec, GuidLess> groups;
+    /* The frame and list slots, with the obj_guid of their contents. */
+    std::vector<std::pair<GncGUID, KvpValue*>> containers;
+
+    g_return_if_fail (be != NULL);
+
+    gnc_sql_slots_end_preload (preload_backend);
+    std::stringstream sql;
+    sql << "SELECT * FROM " << TABLE_NAME << " ORDER BY " <<
+        obj_guid_col_table[0]->name() << ", " << col_table[id_col]->name();
+    auto stmt = be->create_statement_from_sql (sql.str());
+    if (stmt == nullptr)
+        return;
+    auto result = be->execute_select_statement (stmt);
+    if (result == nullptr)
+        return;
+
+    /* The rows come grouped by obj_guid, so a group is only looked up
+     * when the obj_guid changes. */
+    SlotVec* group = nullptr;
+    GncGUID group_guid;
+    for (auto row : *result)
+    {
+        auto guid = load_obj_guid (be, row);
+        if (group == nullptr || !guid_equal (guid, &group_guid))
+        {
+            group_guid = *guid;
+            group = &groups[group_guid];
+        }
+        slot_info_t info = { be, guid, TRUE, NULL, KvpValue::Type::INVALID,
+                             NULL, SCAN, NULL, NULL };
+        gnc_sql_load_object (be, row, TABLE_NAME, &info, col_table);
+        if (info.pKvpValue != NULL)
+        {
+            group->emplace_back (info.path ? info.path->str : "",
+                                 info.pKvpValue);
+            if (info.value_type == KvpValue::Type::FRAME ||
+                info.value_type == KvpValue::Type::GLIST)
+                containers.emplace_back (info.child_guid, info.pKvpValue);
+        }
+        if (info.path != NULL)
+            (void)g_string_free (info.path, TRUE);
+    }
+
+    /* Fill each frame and list from its group; what's left are the
+     * objects' own slots. */
+    for (auto& container : containers)
+    {
+        auto spot = groups.find (container.first);
+        if (spot == groups.end())
+            continue;
+        auto value = container.second;
+        if (value->get_type() == KvpValue::Type::FRAME)
+        {
+            auto frame = value->get<KvpFrame*>();
+            for (auto& slot : spot->second)
+                delete frame->set (key_from_name (slot.first), slot.second);
+        }
+        else
+        {
+            GList* list = NULL;
+            for (auto& slot : spot->second)
+                list = g_list_prepend (list, slot.second);
+            value->set (g_list_reverse (list));
+        }
+        groups.erase (spot);
+    }
+    for (auto& group : groups)
+    {
+        auto frame = new KvpFrame;
+        for (auto& slot : group.second)
+            delete frame->set_path (slot.first.c_str(), slot.second);
+        preloaded_slots[group.first] = frame;
+    }
+    preload_backend = be;
+}
+
+void
+gnc_sql_slots_end_preload (const GncSqlBackend* be)
+{
+    if (preload_backend != be)
+        return;
+    for (auto& slots : preloaded_slots)
+        delete slots.second;
+    preloaded_slots.clear();
+    preload_backend = nullptr;
+}
+
 static void
 load_slot_for_list_item (GncSqlBackend* be, GncSqlRow& row,
                          QofCollection* coll)
@@ -888,41 +1074,60 @@ void
 gnc_sql_slots_load_for_instancevec (GncSqlBackend* be, InstanceVec& instances)
 {
     QofCollection* coll;
-    std::stringstream sql;
 
     g_return_if_fail (be != NULL);
 
     // Ignore empty list
     if (instances.empty()) return;
 
-    coll = qof_instance_get_collection (instances[0]);
+    if (preload_backend == be)
+    {
+        for (auto inst : instances)
+            take_preloaded_slots (be, inst);
+        return;
+    }
 
-    // Create the query for all slots for all items on the list
+    coll = qof_instance_get_collection (instances[0]);
 
-    sql << "SELECT * FROM " << TABLE_NAME << " WHERE " <<
-                            obj_guid_col_table[0]->name();
-    if (instances.size() != 1)
-        sql << " IN (";
-    else
-        sql << " = ";
+    // Query the slots for the items on the list a batch at a time
+    for (auto batch = instances.cbegin(); batch != instances.cend();)
+    {
+        auto batch_begin = batch;
+        auto batch_end = batch + std::min<ptrdiff_t> (GNC_SQL_GUID_BATCH_SIZE,
+                                                      instances.cend() - batch);
+        std::stringstream sql;
+
+        sql << "SELECT * FROM " << TABLE_NAME << " WHERE " <<
+                                obj_guid_col_table[0]->name();
+        if (batch_end - batch != 1)
+            sql << " IN (";
+        else
+            sql << " = ";
 
-    gnc_sql_append_guids_to_sql (sql, instances);
-    if (instances.size() > 1)
-        sql << ")";
+        gnc_sql_append_guids_to_sql (sql, batch, batch_end);
+        if (batch_end - batch > 1)
+            sql << ")";
+        batch = batch_end;
 
-    // Execute the query and load the slots
-    auto stmt = be->create_statement_from_sql(sql.str());
-    if (stmt == nullptr)
-    {
-        PERR ("stmt == NULL, SQL = '%s'\n", sql.str().c_str());
-        return;
+        // Execute the query and load the slots
+        auto stmt = be->create_statement_from_sql(sql.str());
+        if (stmt == nullptr)
+        {
+            PERR ("stmt == NULL, SQL = '%s'\n", sql.str().c_str());
+            return;
+        }
+        auto result = be->execute_select_statement (stmt);
+        if (result == nullptr)
+            continue;
+        for (auto row : *result)
+            load_slot_for_list_item (be, row, coll);
+        for (auto inst = batch_begin; inst != batch; ++inst)
+            be->remember_slots (qof_instance_get_guid (*inst),
+                                qof_instance_get_slots (*inst));
     }
-    auto result = be->execute_select_statement (stmt);
-    for (auto row : *result)
-        load_slot_for_list_item (be, row, coll);
 }
 
-static void
+static QofInstance*
 load_slot_for_book_object (GncSqlBackend* be, GncSqlRow& row,
                            BookLookupFn lookup_fn)
 {
@@ -930,13 +1135,13 @@ load_slot_for_book_object (GncSqlBackend* be, GncSqlRow& row,
     const GncGUID* guid;
     QofInstance* inst;
 
-    g_return_if_fail (be != NULL);
-    g_return_if_fail (lookup_fn != NULL);
+    g_return_val_if_fail (be != NULL, NULL);
+    g_return_val_if_fail (lookup_fn != NULL, NULL);
 
     guid = load_obj_guid (be, row);
-    g_return_if_fail (guid != NULL);
+    g_return_val_if_fail (guid != NULL, NULL);
     inst = lookup_fn (guid, be->book());
-    g_return_if_fail (inst != NULL);
+    g_return_val_if_fail (inst != NULL, NULL);
 
     slot_info.be = be;
     slot_info.pKvpFrame = qof_instance_get_slots (inst);
@@ -948,6 +1153,7 @@ load_slot_for_book_object (GncSqlBackend* be, GncSqlRow& row,
     {
         (void)g_string_free (slot_info.path, TRUE);
     }
+    return inst;
 }
 
 /**
@@ -970,6 +1176,25 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* be,
     // Ignore empty subquery
     if (subquery == NULL) return;
 
+    /* The slots are already read, all that's needed is whose they are. */
+    if (preload_backend == be)
+    {
+        auto stmt = be->create_statement_from_sql(subquery);
+        auto result = stmt ? be->execute_select_statement(stmt) : nullptr;
+        if (result == nullptr)
+        {
+            PERR ("Subquery failed, SQL = '%s'\n", subquery);
+            return;
+        }
+        for (auto row : *result)
+        {
+            auto inst = lookup_fn (gnc_sql_load_guid (be, row), be->book());
+            if (inst != nullptr)
+                take_preloaded_slots (be, inst);
+        }
+        return;
+    }
+
     sql = g_strdup_printf ("SELECT * FROM %s WHERE %s IN (%s)",
                            TABLE_NAME, obj_guid_col_table[0]->name(),
                            subquery);
@@ -984,8 +1209,17 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* be,
     }
     g_free (sql);
     auto result = be->execute_select_statement(stmt);
+    std::vector<QofInstance*> loaded;
     for (auto row : *result)
-        load_slot_for_book_object (be, row, lookup_fn);
+    {
+        auto inst = load_slot_for_book_object (be, row, lookup_fn);
+        if (inst != nullptr &&
+            (loaded.empty() || loaded.back() != inst))
+            loaded.push_back (inst);
+    }
+    for (auto inst : loaded)
+        be->remember_slots (qof_instance_get_guid (inst),
+                            qof_instance_get_slots (inst));
 }
 
 /* ================================================================= */
@@ -1008,12 +1242,16 @@ GncSqlSlotsBackend::create_tables (GncSqlBackend* be)
         {
             PERR ("Unable to create index\n");
         }
+        if (!be->create_index ("slots_guid_val_index", TABLE_NAME,
+                               guid_val_col_table))
+            PERR ("Unable to create index\n");
     }
     else if (version < TABLE_VERSION)
     {
         /* Upgrade:
             1->2: 64-bit int values to proper definition, add index
             2->3: Add gdate field
+            3->4: Add guid_val index
         */
         if (version == 1)
         {
@@ -1033,12 +1271,30 @@ GncSqlSlotsBackend::create_tables (GncSqlBackend* be)
                 PERR ("Unable to add gdate column\n");
             }
         }
+        if (!be->create_index ("slots_guid_val_index", TABLE_NAME,
+                               guid_val_col_table))
+            PERR ("Unable to create index\n");
         be->set_table_version (TABLE_NAME, TABLE_VERSION);
         PINFO ("Slots table upgraded from version %d to version %d\n", version,
                TABLE_VERSION);
     }
 }
 
+void
+GncSqlSlotsBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != NULL);
+
+    if (be->get_table_version (TABLE_NAME) == 0)
+        return;
+    be->upgrade_table (TABLE_NAME, col_table, true);
+    if (!be->create_index ("slots_guid_index", TABLE_NAME, obj_guid_col_table))
+        PERR ("Unable to create index\n");
+    if (!be->create_index ("slots_guid_val_index", TABLE_NAME,
+                           guid_val_col_table))
+        PERR ("Unable to create index\n");
+}
+
 /* ================================================================= */
 void
 gnc_sql_init_slots_handler (void)
@@ -90,6 +90,24 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* be,
                                           const gchar* subquery,
                                           BookLookupFn lookup_fn);
 
+/**
+ * gnc_sql_slots_preload - Reads the whole slots table in one scan ordered
+ * by obj_guid and builds every object's slots from it, nested frames and
+ * lists included.  Until gnc_sql_slots_end_preload(), the gnc_sql_slots_load
+ * functions move the objects' slots from there instead of querying the
+ * table, which saves the query per nested frame or list.
+ *
+ * @param be SQL backend
+ */
+void gnc_sql_slots_preload (GncSqlBackend* be);
+
+/**
+ * gnc_sql_slots_end_preload - Frees the preloaded slots that no object took.
+ *
+ * @param be SQL backend
+ */
+void gnc_sql_slots_end_preload (const GncSqlBackend* be);
+
 void gnc_sql_init_slots_handler (void);
 
 #endif /* GNC_SLOTS_SQL_H */
@@ -121,6 +121,7 @@ public:
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override;
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit (GncSqlBackend* be, QofInstance* inst) override;
     bool write(GncSqlBackend*) override;
 };
@@ -365,6 +366,17 @@ GncSqlTaxTableBackend::create_tables (GncSqlBackend* be)
     }
 }
 
+void
+GncSqlTaxTableBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != NULL);
+
+    if (be->get_table_version (TT_TABLE_NAME) > 0)
+        be->upgrade_table (TT_TABLE_NAME, tt_col_table, true);
+    if (be->get_table_version (TTENTRIES_TABLE_NAME) > 0)
+        be->upgrade_table (TTENTRIES_TABLE_NAME, ttentries_col_table, true);
+}
+
 /* ================================================================= */
 static gboolean
 delete_all_tt_entries (GncSqlBackend* be, const GncGUID* guid)
@@ -26,6 +26,9 @@
  * restoring data to/from an SQL db
  */
 #include <guid.hpp>
+#include <algorithm>
+#include <cmath>
+#include <set>
 extern "C"
 {
 #include "config.h"
@@ -43,28 +46,24 @@ extern "C"
 #include "engine-helpers.h"
 #include "gnc-commodity.h"
 #include "gnc-engine.h"
+#include "SX-book.h"
 
 #ifdef S_SPLINT_S
 #include "splint-defs.h"
 #endif
 }
 
-#include "escape.h"
-
 #include "gnc-backend-sql.h"
 #include "gnc-transaction-sql.h"
 #include "gnc-commodity-sql.h"
 #include "gnc-slots-sql.h"
 
-#define SIMPLE_QUERY_COMPILATION 1
-#define LOAD_TRANSACTIONS_AS_NEEDED 0
-
 static QofLogModule log_module = G_LOG_DOMAIN;
 
 #define TRANSACTION_TABLE "transactions"
 #define TX_TABLE_VERSION 3
 #define SPLIT_TABLE "splits"
-#define SPLIT_TABLE_VERSION 4
+#define SPLIT_TABLE_VERSION 5
 
 struct split_info_t : public write_objects_t
 {
@@ -135,6 +134,11 @@ static const EntryVec tx_guid_col_table
     gnc_sql_make_table_entry<CT_GUID>("tx_guid", 0, 0, "guid"),
 };
 
+static const EntryVec lot_guid_col_table
+{
+    gnc_sql_make_table_entry<CT_LOTREF>("lot_guid", 0, 0),
+};
+
 class GncSqlTransBackend : public GncSqlObjectBackend
 {
 public:
@@ -142,7 +146,15 @@ public:
                       const std::string& table, const EntryVec& vec) :
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override;
+    std::string load_all_sql(const GncSqlBackend* be) const override
+    {
+        /* Left for load_tx_for_account_as_needed. */
+        if (be->load_tx_as_needed())
+            return "";
+        return GncSqlObjectBackend::load_all_sql(be);
+    }
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit (GncSqlBackend* be, QofInstance* inst) override;
 };
 
@@ -153,18 +165,13 @@ public:
                       const std::string& table, const EntryVec& vec) :
         GncSqlObjectBackend(version, type, table, vec) {}
     void load_all(GncSqlBackend*) override { return; } // loaded by transaction.
+    std::string load_all_sql(const GncSqlBackend*) const override { return ""; }
     void create_tables(GncSqlBackend*) override;
+    void upgrade_guid_columns(GncSqlBackend*) override;
     bool commit (GncSqlBackend* be, QofInstance* inst) override;
 };
 static GncSqlSplitBackend be_data_split {
     GNC_SQL_BACKEND_VERSION, GNC_ID_SPLIT, SPLIT_TABLE, split_col_table};
-/* These functions exist but have not been tested.
-   #if LOAD_TRANSACTIONS_AS_NEEDED
-   compile_split_query,
-   run_split_query,
-   free_split_query,
-*/
-
 /* ================================================================= */
 
 static  gpointer
@@ -257,32 +264,47 @@ load_single_split (GncSqlBackend* be, GncSqlRow& row)
     return pSplit;
 }
 
+/* Load the splits, and their slots, of transactions in batches of
+ * GNC_SQL_GUID_BATCH_SIZE so that a big book doesn't make for a huge
+ * query.  The splits found are added to loaded if it isn't null. */
 static void
-load_splits_for_tx_list (GncSqlBackend* be, InstanceVec& transactions)
+load_splits_for_tx_list (GncSqlBackend* be, InstanceVec& transactions,
+                         InstanceVec* loaded = nullptr)
 {
     g_return_if_fail (be != NULL);
 
-    std::stringstream sql;
-
-    sql << "SELECT * FROM " << SPLIT_TABLE << " WHERE " <<
-        tx_guid_col_table[0]->name() << " IN (";
-    gnc_sql_append_guids_to_sql (sql, transactions);
-    sql << ")";
-
-    // Execute the query and load the splits
-    auto stmt = be->create_statement_from_sql(sql.str());
-    auto result = be->execute_select_statement (stmt);
     InstanceVec instances;
-
-    for (auto row : *result)
+    for (auto batch = transactions.cbegin(); batch != transactions.cend();)
     {
-        Split* s = load_single_split (be, row);
-        if (s != nullptr)
-            instances.push_back(QOF_INSTANCE(s));
-    }
+        auto batch_end = batch + std::min<ptrdiff_t> (GNC_SQL_GUID_BATCH_SIZE,
+                                                      transactions.cend() - batch);
+        std::stringstream sql;
+
+        sql << "SELECT * FROM " << SPLIT_TABLE << " WHERE " <<
+            tx_guid_col_table[0]->name() << " IN (";
+        gnc_sql_append_guids_to_sql (sql, batch, batch_end);
+        sql << ")";
+        batch = batch_end;
+
+        // Execute the query and load the splits
+        auto stmt = be->create_statement_from_sql(sql.str());
+        auto result = be->execute_select_statement (stmt);
+        if (result == nullptr)
+            continue;
+
+        for (auto row : *result)
+        {
+            Split* s = load_single_split (be, row);
+            if (s != nullptr)
+                instances.push_back(QOF_INSTANCE(s));
+        }
 
-    if (!instances.empty())
-        gnc_sql_slots_load_for_instancevec (be, instances);
+        if (!instances.empty())
+            gnc_sql_slots_load_for_instancevec (be, instances);
+        if (loaded != nullptr)
+            loaded->insert (loaded->end(), instances.begin(), instances.end());
+        instances.clear();
+    }
 }
 
 static  Transaction*
@@ -322,21 +344,84 @@ load_single_tx (GncSqlBackend* be, GncSqlRow& row)
 }
 
 /**
- * Structure to hold start/end balances for each account.  The values are
- * saved before splits are loaded, and then used to adjust the start balances
- * so that the end balances (which are calculated and correct on initial load)
- * are unchanged.
+ * When transactions are loaded as needed, the start balances set by the
+ * account load already count every split in the database (see
+ * gnc_sql_get_account_balances_slist()), so each split that is loaded
+ * later has to be taken back out of them, using the same reconcile states.
+ *
+ * @param instances Newly loaded and committed transactions
  */
-typedef struct
+static void
+remove_loaded_splits_from_start_balances (const InstanceVec& instances)
 {
-    Account* acc;
-    gnc_numeric start_bal;
-    gnc_numeric end_bal;
-    gnc_numeric start_cleared_bal;
-    gnc_numeric end_cleared_bal;
-    gnc_numeric start_reconciled_bal;
-    gnc_numeric end_reconciled_bal;
-} full_acct_balances_t;
+    std::map<Account*, acct_balances_t> loaded;
+
+    for (auto instance : instances)
+    {
+        auto splits = xaccTransGetSplitList (GNC_TRANSACTION (instance));
+        for (auto node = splits; node != NULL; node = node->next)
+        {
+            auto split = GNC_SPLIT (node->data);
+            auto acct = xaccSplitGetAccount (split);
+            auto state = xaccSplitGetReconcile (split);
+            if (acct == nullptr)
+                continue;
+
+            auto iter = loaded.find (acct);
+            if (iter == loaded.end())
+                iter = loaded.emplace (acct, acct_balances_t {
+                        acct, gnc_numeric_zero (), gnc_numeric_zero (),
+                        gnc_numeric_zero ()}).first;
+            auto& bal = iter->second;
+            auto amount = xaccSplitGetAmount (split);
+
+            bal.balance = gnc_numeric_add (bal.balance, amount,
+                                           GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+            if (state != NREC)
+                bal.cleared_balance = gnc_numeric_add (bal.cleared_balance,
+                                                       amount, GNC_DENOM_AUTO,
+                                                       GNC_HOW_DENOM_LCD);
+            if (state == YREC || state == FREC)
+                bal.reconciled_balance = gnc_numeric_add (bal.reconciled_balance,
+                                                          amount, GNC_DENOM_AUTO,
+                                                          GNC_HOW_DENOM_LCD);
+        }
+    }
+
+    for (auto& entry : loaded)
+    {
+        auto& bal = entry.second;
+        gnc_numeric* start_bal;
+        gnc_numeric* start_c_bal;
+        gnc_numeric* start_r_bal;
+
+        g_object_get (bal.acct,
+                      "start-balance", &start_bal,
+                      "start-cleared-balance", &start_c_bal,
+                      "start-reconciled-balance", &start_r_bal,
+                      NULL);
+        bal.balance = gnc_numeric_sub (*start_bal, bal.balance,
+                                       GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+        bal.cleared_balance = gnc_numeric_sub (*start_c_bal, bal.cleared_balance,
+                                               GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+        bal.reconciled_balance = gnc_numeric_sub (*start_r_bal,
+                                                  bal.reconciled_balance,
+                                                  GNC_DENOM_AUTO,
+                                                  GNC_HOW_DENOM_LCD);
+        g_free (start_bal);
+        g_free (start_c_bal);
+        g_free (start_r_bal);
+
+        qof_instance_increase_editlevel (bal.acct);
+        g_object_set (bal.acct,
+                      "start-balance", &bal.balance,
+                      "start-cleared-balance", &bal.cleared_balance,
+                      "start-reconciled-balance", &bal.reconciled_balance,
+                      NULL);
+        qof_instance_decrease_editlevel (bal.acct);
+        xaccAccountRecomputeBalance (bal.acct);
+    }
+}
 
 /**
  * Executes a transaction query statement and loads the transactions and all
@@ -355,22 +440,7 @@ query_transactions (GncSqlBackend* be, const GncSqlStatementPtr& stmt)
     if (result->begin() == result->end())
         return;
 
-    GList* node;
     Transaction* tx;
-#if LOAD_TRANSACTIONS_AS_NEEDED
-    GSList* bal_list = NULL;
-    GSList* nextbal;
-    Account* root = gnc_book_get_root_account (be->book());
-
-    qof_event_suspend ();
-    xaccAccountBeginEdit (root);
-
-    // Save the start/ending balances (balance, cleared and reconciled) for
-    // every account.
-    gnc_account_foreach_descendant (gnc_book_get_root_account (be->primary_book),
-                                    save_account_balances,
-                                    &bal_list);
-#endif
 
     // Load the transactions
     InstanceVec instances;
@@ -395,69 +465,104 @@ query_transactions (GncSqlBackend* be, const GncSqlStatementPtr& stmt)
     for (auto instance : instances)
          xaccTransCommitEdit(GNC_TRANSACTION(instance));
 
-#if LOAD_TRANSACTIONS_AS_NEEDED
-    // Update the account balances based on the loaded splits.  If the end
-    // balance has changed, update the start balance so that the end
-    // balance is the same as it was before the splits were loaded.
-    // Repeat for cleared and reconciled balances.
-    for (nextbal = bal_list; nextbal != NULL; nextbal = nextbal->next)
+    if (be->load_tx_as_needed())
+        remove_loaded_splits_from_start_balances (instances);
+}
+
+void
+gnc_sql_transaction_reload (GncSqlBackend* be, const std::vector<GncGUID>& guids)
+{
+    g_return_if_fail (be != NULL);
+
+    if (guids.empty())
+        return;
+
+    std::stringstream sql;
+    sql << "SELECT * FROM " << TRANSACTION_TABLE << " WHERE " <<
+        tx_col_table[0]->name() << " IN (";
+    for (auto iter = guids.begin(); iter != guids.end(); ++iter)
     {
-        full_acct_balances_t* balns = (full_acct_balances_t*)nextbal->data;
-        gnc_numeric* pnew_end_bal;
-        gnc_numeric* pnew_end_c_bal;
-        gnc_numeric* pnew_end_r_bal;
-        gnc_numeric adj;
-
-        g_object_get (balns->acc,
-                      "end-balance", &pnew_end_bal,
-                      "end-cleared-balance", &pnew_end_c_bal,
-                      "end-reconciled-balance", &pnew_end_r_bal,
-                      NULL);
+        gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+        (void)guid_to_string_buff (&*iter, guid_buf);
+        sql << (iter == guids.begin() ? "'" : ",'") << guid_buf << "'";
+    }
+    sql << ")";
+    auto stmt = be->create_statement_from_sql (sql.str());
+    if (stmt == nullptr)
+        return;
+    auto result = be->execute_select_statement (stmt);
+    if (result == nullptr)
+        return;
+
+    /* What's read in mustn't be written back. */
+    auto loading = be->loading();
+    be->set_loading (true);
 
-        qof_instance_increase_editlevel (balns - acc);
-        if (!gnc_numeric_eq (*pnew_end_bal, balns->end_bal))
+    InstanceVec instances;
+    std::vector<GncGUID> found;
+    for (auto row : *result)
+    {
+        auto guid = gnc_sql_load_guid (be, row);
+        if (guid == nullptr)
+            continue;
+        found.push_back (*guid);
+        auto tx = xaccTransLookup (&found.back(), be->book());
+        if (tx == nullptr)
         {
-            adj = gnc_numeric_sub (balns->end_bal, *pnew_end_bal,
-                                   GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            balns->start_bal = gnc_numeric_add (balns->start_bal, adj,
-                                                GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            g_object_set (balns->acc, "start-balance", &balns->start_bal, NULL);
-            qof_instance_decrease_editlevel (balns - acc);
+            tx = load_single_tx (be, row);
+            if (tx == nullptr)
+                continue;
+            xaccTransScrubPostedDate (tx);
         }
-        if (!gnc_numeric_eq (*pnew_end_c_bal, balns->end_cleared_bal))
+        else
         {
-            adj = gnc_numeric_sub (balns->end_cleared_bal, *pnew_end_c_bal,
-                                   GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            balns->start_cleared_bal = gnc_numeric_add (balns->start_cleared_bal, adj,
-                                                        GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            g_object_set (balns->acc, "start-cleared-balance", &balns->start_cleared_bal,
-                          NULL);
+            /* The user's own edits win. */
+            if (xaccTransIsOpen (tx) || qof_instance_is_dirty (QOF_INSTANCE (tx)))
+                continue;
+            xaccTransBeginEdit (tx);
+            gnc_sql_load_object (be, row, GNC_ID_TRANS, tx, tx_col_table);
         }
-        if (!gnc_numeric_eq (*pnew_end_r_bal, balns->end_reconciled_bal))
+        instances.push_back (QOF_INSTANCE (tx));
+    }
+
+    if (!instances.empty())
+    {
+        InstanceVec splits;
+        gnc_sql_slots_load_for_instancevec (be, instances);
+        load_splits_for_tx_list (be, instances, &splits);
+        /* Drop the splits that are gone from the database. */
+        for (auto instance : instances)
         {
-            adj = gnc_numeric_sub (balns->end_reconciled_bal, *pnew_end_r_bal,
-                                   GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            balns->start_reconciled_bal = gnc_numeric_add (balns->start_reconciled_bal,
-                                                           adj,
-                                                           GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            g_object_set (balns->acc, "start-reconciled-balance",
-                          &balns->start_reconciled_bal, NULL);
+            auto tx = GNC_TRANSACTION (instance);
+            auto node = xaccTransGetSplitList (tx);
+            while (node != nullptr)
+            {
+                auto split = GNC_SPLIT (node->data);
+                node = node->next;
+                if (std::find (splits.begin(), splits.end(),
+                               QOF_INSTANCE (split)) == splits.end())
+                    xaccSplitDestroy (split);
+            }
         }
-        qof_instance_decrease_editlevel (balns - acc);
-        xaccAccountRecomputeBalance (balns->acc);
-        g_free (pnew_end_bal);
-        g_free (pnew_end_c_bal);
-        g_free (pnew_end_r_bal);
-        g_free (balns);
     }
-    if (bal_list != NULL)
+    for (auto instance : instances)
+        xaccTransCommitEdit (GNC_TRANSACTION (instance));
+
+    /* And those gone altogether. */
+    for (auto const& guid : guids)
     {
-        g_slist_free (bal_list);
+        if (std::find_if (found.begin(), found.end(),
+                          [&guid](const GncGUID& f)
+                          { return guid_equal (&f, &guid); }) != found.end())
+            continue;
+        auto tx = xaccTransLookup (&guid, be->book());
+        if (tx == nullptr || xaccTransIsOpen (tx))
+            continue;
+        xaccTransBeginEdit (tx);
+        xaccTransDestroy (tx);
+        xaccTransCommitEdit (tx);
     }
-
-    xaccAccountCommitEdit (root);
-    qof_event_resume ();
-#endif
+    be->set_loading (loading);
 }
 
 /* ================================================================= */
@@ -498,6 +603,19 @@ GncSqlTransBackend::create_tables (GncSqlBackend* be)
                version, m_version);
     }
 }
+
+void
+GncSqlTransBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != nullptr);
+
+    if (be->get_table_version (m_table_name) == 0)
+        return;
+    be->upgrade_table (m_table_name, m_col_table, true);
+    if (!be->create_index ("tx_post_date_index", TRANSACTION_TABLE,
+                           post_date_col_table))
+        PERR ("Unable to create index\n");
+}
 void
 GncSqlSplitBackend::create_tables (GncSqlBackend* be)
 {
@@ -515,27 +633,56 @@ GncSqlSplitBackend::create_tables (GncSqlBackend* be)
                                    m_table_name.c_str(),
                                    account_guid_col_table))
             PERR ("Unable to create index\n");
+        if (!be->create_index("splits_lot_guid_index",
+                                   m_table_name.c_str(), lot_guid_col_table))
+            PERR ("Unable to create index\n");
     }
     else if (version < SPLIT_TABLE_VERSION)
     {
 
         /* Upgrade:
            1->2: 64 bit int handling
-           3->4: Split reconcile date can be NULL */
-        be->upgrade_table(m_table_name.c_str(), split_col_table);
-        if (!be->create_index("splits_tx_guid_index",
-                                   m_table_name.c_str(),
-                                   tx_guid_col_table))
-            PERR ("Unable to create index\n");
-        if (!be->create_index("splits_account_guid_index",
-                                   m_table_name.c_str(),
-                                   account_guid_col_table))
+           3->4: Split reconcile date can be NULL
+           4->5: Add lot_guid index */
+        if (version < 4)
+        {
+            be->upgrade_table(m_table_name.c_str(), split_col_table);
+            if (!be->create_index("splits_tx_guid_index",
+                                       m_table_name.c_str(),
+                                       tx_guid_col_table))
+                PERR ("Unable to create index\n");
+            if (!be->create_index("splits_account_guid_index",
+                                       m_table_name.c_str(),
+                                       account_guid_col_table))
+                PERR ("Unable to create index\n");
+        }
+        if (!be->create_index("splits_lot_guid_index",
+                                   m_table_name.c_str(), lot_guid_col_table))
             PERR ("Unable to create index\n");
         be->set_table_version (m_table_name.c_str(), m_version);
         PINFO ("Splits table upgraded from version %d to version %d\n", version,
                m_version);
     }
 }
+
+void
+GncSqlSplitBackend::upgrade_guid_columns (GncSqlBackend* be)
+{
+    g_return_if_fail (be != nullptr);
+
+    if (be->get_table_version (m_table_name) == 0)
+        return;
+    be->upgrade_table (m_table_name, m_col_table, true);
+    if (!be->create_index ("splits_tx_guid_index", m_table_name,
+                           tx_guid_col_table))
+        PERR ("Unable to create index\n");
+    if (!be->create_index ("splits_account_guid_index", m_table_name,
+                           account_guid_col_table))
+        PERR ("Unable to create index\n");
+    if (!be->create_index ("splits_lot_guid_index", m_table_name,
+                           lot_guid_col_table))
+        PERR ("Unable to create index\n");
+}
 /* ================================================================= */
 /**
  * Callback function to delete slots for a split
@@ -769,6 +916,27 @@ void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* be,
     }
 }
 
+/**
+ * Loads all transactions posted on or after a date, for a backend that
+ * leaves the earlier ones in the database (see
+ * GncSqlBackend::set_cold_before()).
+ *
+ * @param be SQL backend
+ * @param date The earliest posted date loaded
+ */
+void
+gnc_sql_transaction_load_posted_since (GncSqlBackend* be, time64 date)
+{
+    g_return_if_fail (be != NULL);
+
+    std::stringstream sql;
+    sql << "SELECT * FROM " << TRANSACTION_TABLE << " WHERE post_date >= '" <<
+        be->time64_to_string (date) << "'";
+    auto stmt = be->create_statement_from_sql (sql.str());
+    if (stmt != nullptr)
+        query_transactions (be, stmt);
+}
+
 /**
  * Loads all transactions.  This might be used during a save-as operation to ensure that
  * all data is in memory and ready to be saved.
@@ -789,424 +957,428 @@ GncSqlTransBackend::load_all (GncSqlBackend* be)
     }
 }
 
+/* ----------------------------------------------------------------- */
+/* Split queries are still run by the engine against the splits in
+ * memory.  What is done here is to load beforehand the transactions of
+ * the pending accounts that the query might match, which means that a
+ * term is never allowed to leave out a split it would match.  Each term
+ * is converted to a condition that holds for at least the same splits;
+ * an empty condition is always true.
+ */
+using GuidStrSet = std::set<std::string>;
+
 static void
-convert_query_comparison_to_sql (QofQueryPredData* pPredData,
-                                 gboolean isInverted, GString* sql)
+collect_pending_accounts (Account* root, GuidStrSet& pending)
 {
-    if (pPredData->how == QOF_COMPARE_LT
-        || (isInverted && pPredData->how == QOF_COMPARE_GTE))
-    {
-        g_string_append (sql, "<");
-    }
-    else if (pPredData->how == QOF_COMPARE_LTE
-             || (isInverted && pPredData->how == QOF_COMPARE_GT))
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+
+    if (root == nullptr)
+        return;
+    auto descendants = gnc_account_get_descendants (root);
+    for (auto node = descendants; node != nullptr; node = node->next)
     {
-        g_string_append (sql, "<=");
+        auto acct = static_cast<Account*> (node->data);
+        if (!gnc_account_get_splits_pending (acct))
+            continue;
+        (void)guid_to_string_buff (qof_instance_get_guid (QOF_INSTANCE (acct)),
+                                   guid_buf);
+        pending.insert (guid_buf);
     }
-    else if (pPredData->how == QOF_COMPARE_EQUAL
-             || (isInverted && pPredData->how == QOF_COMPARE_NEQ))
+    g_list_free (descendants);
+}
+
+static std::string
+guid_str_list (const GuidStrSet& guids)
+{
+    std::string list;
+    for (auto& guid : guids)
     {
-        g_string_append (sql, "=");
+        if (!list.empty())
+            list += ",";
+        list += "'" + guid + "'";
     }
-    else if (pPredData->how == QOF_COMPARE_GT
-             || (isInverted && pPredData->how == QOF_COMPARE_LTE))
+    return list;
+}
+
+static QofQueryCompare
+invert_compare (QofQueryCompare how)
+{
+    switch (how)
     {
-        g_string_append (sql, ">");
+    case QOF_COMPARE_LT:
+        return QOF_COMPARE_GTE;
+    case QOF_COMPARE_LTE:
+        return QOF_COMPARE_GT;
+    case QOF_COMPARE_EQUAL:
+        return QOF_COMPARE_NEQ;
+    case QOF_COMPARE_GT:
+        return QOF_COMPARE_LTE;
+    case QOF_COMPARE_GTE:
+        return QOF_COMPARE_LT;
+    case QOF_COMPARE_NEQ:
+        return QOF_COMPARE_EQUAL;
+    case QOF_COMPARE_CONTAINS:
+        return QOF_COMPARE_NCONTAINS;
+    case QOF_COMPARE_NCONTAINS:
+        return QOF_COMPARE_CONTAINS;
     }
-    else if (pPredData->how == QOF_COMPARE_GTE
-             || (isInverted && pPredData->how == QOF_COMPARE_LT))
+    return how;
+}
+
+static bool
+account_term_to_sql (const query_guid_def* pdata, gboolean inverted,
+                     const GuidStrSet& pending, std::string& cond)
+{
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+    GuidStrSet guids;
+
+    if (pdata->options != QOF_GUID_MATCH_ANY &&
+        pdata->options != QOF_GUID_MATCH_NONE)
+        return true;
+
+    for (auto node = pdata->guids; node != nullptr; node = node->next)
     {
-        g_string_append (sql, ">=");
+        (void)guid_to_string_buff (static_cast<GncGUID*> (node->data),
+                                   guid_buf);
+        guids.insert (guid_buf);
     }
-    else if (pPredData->how == QOF_COMPARE_NEQ
-             || (isInverted && pPredData->how == QOF_COMPARE_EQUAL))
+
+    if ((pdata->options == QOF_GUID_MATCH_ANY) != static_cast<bool>(inverted))
     {
-        g_string_append (sql, "~=");
+        GuidStrSet wanted;
+        for (auto& guid : guids)
+            if (pending.count (guid))
+                wanted.insert (guid);
+        if (wanted.empty())
+            return false;
+        cond = "s.account_guid IN (" + guid_str_list (wanted) + ")";
     }
-    else
+    else if (!guids.empty())
     {
-        PERR ("Unknown comparison type\n");
-        g_string_append (sql, "??");
+        cond = "s.account_guid NOT IN (" + guid_str_list (guids) + ")";
     }
+    return true;
 }
 
 static void
-convert_query_term_to_sql (const GncSqlBackend* be, const gchar* fieldName,
-                           QofQueryTerm* pTerm, GString* sql)
+reconcile_term_to_sql (const query_char_def* pdata, gboolean inverted,
+                       std::string& cond)
 {
-    QofQueryPredData* pPredData;
-    gboolean isInverted;
-
-    g_return_if_fail (pTerm != NULL);
-    g_return_if_fail (sql != NULL);
+    std::string list;
 
-    pPredData = qof_query_term_get_pred_data (pTerm);
-    isInverted = qof_query_term_is_inverted (pTerm);
-
-    if (g_strcmp0 (pPredData->type_name, QOF_TYPE_GUID) == 0)
+    for (auto c = pdata->char_list; c != nullptr && *c != '\0'; ++c)
     {
-        query_guid_t guid_data = (query_guid_t)pPredData;
-        GList* guid_entry;
-
-        g_string_append (sql, "(");
-        g_string_append (sql, fieldName);
+        if (!list.empty())
+            list += ",";
+        list += std::string{"'"} + *c + "'";
+    }
+    if ((pdata->options == QOF_CHAR_MATCH_ANY) != static_cast<bool>(inverted))
+        cond = list.empty() ? "1=0" : "s.reconcile_state IN (" + list + ")";
+    else if (!list.empty())
+        cond = "s.reconcile_state NOT IN (" + list + ")";
+}
 
-        switch (guid_data->options)
-        {
-        case QOF_GUID_MATCH_ANY:
-            if (isInverted) g_string_append (sql, " NOT IN (");
-            else g_string_append (sql, " IN (");
-            break;
+/* The dates are stored to the second, so a comparison with a fraction of
+ * a second is widened to the enclosing seconds. */
+static void
+date_term_to_sql (const GncSqlBackend* be, const query_date_def* pdata,
+                  gboolean inverted, const char* column, std::string& cond)
+{
+    if (pdata->options != QOF_DATE_MATCH_NORMAL)
+        return;
 
-        case QOF_GUID_MATCH_NONE:
-            if (isInverted) g_string_append (sql, " IN (");
-            else g_string_append (sql, " NOT IN (");
-            break;
+    auto how = inverted ? invert_compare (pdata->pd.how) : pdata->pd.how;
+    auto secs = pdata->date.tv_sec;
+    auto has_nsecs = pdata->date.tv_nsec != 0;
+    const char* op = nullptr;
+    switch (how)
+    {
+    case QOF_COMPARE_LT:
+        op = "<";
+        if (has_nsecs)
+            ++secs;
+        break;
+    case QOF_COMPARE_LTE:
+        op = "<=";
+        break;
+    case QOF_COMPARE_GT:
+        op = ">";
+        break;
+    case QOF_COMPARE_GTE:
+        op = ">=";
+        break;
+    case QOF_COMPARE_EQUAL:
+        op = has_nsecs ? nullptr : "=";
+        break;
+    case QOF_COMPARE_NEQ:
+        op = has_nsecs ? nullptr : "<>";
+        break;
+    default:
+        break;
+    }
+    if (op != nullptr)
+        cond = std::string{column} + " " + op + " '" +
+            be->time64_to_string (secs) + "'";
+}
 
-        default:
-            PERR ("Unexpected GncGUID match type: %d\n", guid_data->options);
-        }
+static bool
+is_literal_regex (const char* str)
+{
+    return strpbrk (str, ".[]()*+?{}|^$\\") == nullptr;
+}
 
-        for (guid_entry = guid_data->guids; guid_entry != NULL;
-             guid_entry = guid_entry->next)
-        {
-            gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+static bool
+is_ascii (const char* str)
+{
+    for (; *str != '\0'; ++str)
+        if (static_cast<unsigned char> (*str) > 0x7f)
+            return false;
+    return true;
+}
 
-            if (guid_entry != guid_data->guids) g_string_append (sql, ",");
-            (void)guid_to_string_buff (static_cast<GncGUID*> (guid_entry->data),
-                                       guid_buf);
-            g_string_append_printf (sql, "'%s'", guid_buf);
-        }
-        g_string_append (sql, "))");
+/* Only what the string is to match is used, never what it must not. */
+static void
+string_term_to_sql (const GncSqlBackend* be, const query_string_def* pdata,
+                    gboolean inverted, const char* column, std::string& cond)
+{
+    auto how = inverted ? invert_compare (pdata->pd.how) : pdata->pd.how;
+    auto match = pdata->matchstring;
 
-    }
-    else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_CHAR) == 0)
+    if (how != QOF_COMPARE_EQUAL && how != QOF_COMPARE_CONTAINS)
+        return;
+    if (match == nullptr || *match == '\0')
+        return;
+    if (pdata->is_regex)
     {
-        query_char_t char_data = (query_char_t)pPredData;
-        int i;
-
-        if (isInverted)
-        {
-            g_string_append (sql, "NOT(");
-        }
-        if (char_data->options == QOF_CHAR_MATCH_NONE)
-        {
-            g_string_append (sql, "NOT ");
-        }
-        g_string_append (sql, "(");
-        for (i = 0; char_data->char_list[i] != '\0'; i++)
-        {
-            if (i != 0)
-            {
-                g_string_append (sql, " OR ");
-            }
-            g_string_append (sql, fieldName);
-            g_string_append (sql, " = '");
-            g_string_append_c (sql, char_data->char_list[i]);
-            g_string_append (sql, "'");
-        }
-        g_string_append (sql, ") ");
-        if (isInverted)
-        {
-            g_string_append (sql, ") ");
-        }
-
+        if (!is_literal_regex (match))
+            return;
+        how = QOF_COMPARE_CONTAINS;
     }
-    else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_STRING) == 0)
-    {
-        query_string_t string_data = (query_string_t)pPredData;
-        sqlEscape* escape = sqlEscape_new ();
 
-        if (isInverted)
-        {
-            g_string_append (sql, "NOT(");
-        }
-        if (pPredData->how == QOF_COMPARE_NEQ)
-        {
-            g_string_append (sql, "NOT(");
-        }
-        g_string_append (sql, fieldName);
-        if (string_data->is_regex ||
-            string_data->options == QOF_STRING_MATCH_CASEINSENSITIVE)
-        {
-            PWARN ("String is_regex || option = QOF_STRING_MATCH_INSENSITIVE\n");
-        }
-//          g_string_append( sql, " ~" );
-//      } else {
-        g_string_append (sql, " =");
-//      }
-//      if( string_data->options == QOF_STRING_MATCH_CASEINSENSITIVE ) {
-//          g_string_append( sql, "*" );
-//      }
-        g_string_append (sql, "'");
-        g_string_append (sql, sqlEscapeString (escape, string_data->matchstring));
-        g_string_append (sql, "'");
-        if (pPredData->how == QOF_COMPARE_NEQ)
-        {
-            g_string_append (sql, ")");
-        }
-        if (isInverted)
-        {
-            g_string_append (sql, ")");
-        }
-        sqlEscape_destroy (escape);
+    auto nocase = pdata->options == QOF_STRING_MATCH_CASEINSENSITIVE;
+    if (how == QOF_COMPARE_EQUAL)
+    {
+        if (!nocase)
+            cond = std::string{column} + " = " + be->quote_string (match);
+        return;
+    }
+    if (nocase && !is_ascii (match))
+        return;
 
+    std::string pattern{"%"};
+    for (auto c = match; *c != '\0'; ++c)
+    {
+        if (*c == '!' || *c == '%' || *c == '_')
+            pattern += '!';
+        pattern += *c;
     }
+    pattern += "%";
+    if (nocase)
+        cond = std::string{"LOWER("} + column + ") LIKE LOWER(" +
+            be->quote_string (pattern) + ") ESCAPE '!'";
     else
-    {
-        g_string_append (sql, "(");
-        g_string_append (sql, fieldName);
-        convert_query_comparison_to_sql (pPredData, isInverted, sql);
-
-        if (strcmp (pPredData->type_name, QOF_TYPE_NUMERIC) == 0)
-        {
-            query_numeric_t pData = (query_numeric_t)pPredData;
-            double d = gnc_numeric_to_double (pData->amount);
-
-            g_string_append_printf (sql, "%f", d);
-
-        }
-        else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_DATE) == 0)
-        {
-            query_date_t date_data = (query_date_t)pPredData;
-
-            auto datebuf = be->time64_to_string (date_data->date.tv_sec);
-            g_string_append_printf (sql, "'%s'", datebuf.c_str());
-
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_INT32) == 0)
-        {
-            query_int32_t pData = (query_int32_t)pPredData;
-
-            g_string_append_printf (sql, "%d", pData->val);
-
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_INT64) == 0)
-        {
-            query_int64_t pData = (query_int64_t)pPredData;
-
-            g_string_append_printf (sql, "%" G_GINT64_FORMAT, pData->val);
-
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_DOUBLE) == 0)
-        {
-            query_double_t pData = (query_double_t)pPredData;
-
-            g_string_append_printf (sql, "%f", pData->val);
-
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_BOOLEAN) == 0)
-        {
-            query_boolean_t pData = (query_boolean_t)pPredData;
+        cond = std::string{column} + " LIKE " + be->quote_string (pattern) +
+            " ESCAPE '!'";
+}
 
-            g_string_append_printf (sql, "%d", pData->val);
+/* The engine compares the magnitudes to four decimal places. */
+static void
+numeric_term_to_sql (const query_numeric_def* pdata, gboolean inverted,
+                     const char* num_col, const char* denom_col,
+                     std::string& cond)
+{
+    std::stringstream sql;
 
-        }
-        else
-        {
-            PERR ("Unknown query predicate type: %s\n", pPredData->type_name);
-        }
+    if (inverted)
+        return;
 
-        g_string_append (sql, ")");
+    if (pdata->options == QOF_NUMERIC_MATCH_CREDIT)
+        sql << num_col << " <= 0";
+    else if (pdata->options == QOF_NUMERIC_MATCH_DEBIT)
+        sql << num_col << " >= 0";
+
+    auto amount = gnc_numeric_to_double (pdata->amount);
+    auto eps = 1e-6 + std::fabs (amount) * 1e-9;
+    auto separator = sql.tellp() > 0 ? " AND " : "";
+    auto value = std::string{"ABS(CAST("} + num_col + " AS REAL)/" +
+        denom_col + ")";
+    sql.precision (17);
+    switch (pdata->pd.how)
+    {
+    case QOF_COMPARE_EQUAL:
+        sql << separator << value << " BETWEEN " <<
+            std::fabs (amount) - 0.0002 << " AND " <<
+            std::fabs (amount) + 0.0002;
+        break;
+    case QOF_COMPARE_LT:
+    case QOF_COMPARE_LTE:
+        sql << separator << value << " <= " << amount + eps;
+        break;
+    case QOF_COMPARE_GT:
+    case QOF_COMPARE_GTE:
+        sql << separator << value << " >= " << amount - eps;
+        break;
+    default:
+        break;
     }
+    cond = sql.str();
 }
 
-typedef struct
-{
-    GncSqlStatementPtr stmt;
-    gboolean has_been_run;
-} split_query_info_t;
-
-#define TX_GUID_CHECK 0
-
-G_GNUC_UNUSED static  gpointer
-compile_split_query (GncSqlBackend* be, QofQuery* query)
+static bool
+split_term_to_sql (const GncSqlBackend* be, QofQueryTerm* term,
+                   const GuidStrSet& pending, std::string& cond)
 {
-    split_query_info_t* query_info = NULL;
-    gchar* query_sql;
-
-    g_return_val_if_fail (be != NULL, NULL);
-    g_return_val_if_fail (query != NULL, NULL);
-
-    query_info = static_cast<decltype (query_info)> (
-                     g_malloc (sizeof (split_query_info_t)));
-    g_assert (query_info != NULL);
-    query_info->has_been_run = FALSE;
-
-    if (qof_query_has_terms (query))
+    auto path = qof_query_term_get_param_path (term);
+    auto pdata = qof_query_term_get_pred_data (term);
+    auto inverted = qof_query_term_is_inverted (term);
+    auto param = static_cast<const char*> (path->data);
+    auto next = path->next ? static_cast<const char*> (path->next->data) :
+        nullptr;
+    auto type = pdata->type_name;
+
+    if (g_strcmp0 (param, SPLIT_TRANS) == 0 && next != nullptr &&
+        path->next->next == nullptr)
     {
-        GList* orterms = qof_query_get_terms (query);
-        GList* orTerm;
-        GString* sql = g_string_new ("");
-        gboolean need_OR = FALSE;
-
-        for (orTerm = orterms; orTerm != NULL; orTerm = orTerm->next)
-        {
-            GList* andterms = (GList*)orTerm->data;
-            GList* andTerm;
-            gboolean need_AND = FALSE;
-#if TX_GUID_CHECK
-            gboolean has_tx_guid_check = FALSE;
-#endif
-            if (need_OR)
-            {
-                g_string_append (sql, " OR ");
-            }
-            g_string_append (sql, "(");
-            for (andTerm = andterms; andTerm != NULL; andTerm = andTerm->next)
-            {
-                QofQueryTerm* term;
-                GSList* paramPath;
-                gboolean unknownPath = FALSE;
-
-                term = (QofQueryTerm*)andTerm->data;
-                paramPath = qof_query_term_get_param_path (term);
-                const char* path = static_cast<decltype (path)> (paramPath->data);
-                const char* next_path =
-                    static_cast<decltype (next_path)> (paramPath->next->data);
-                if (strcmp (path, QOF_PARAM_BOOK) == 0) continue;
-
-#if SIMPLE_QUERY_COMPILATION
-                if (strcmp (path, SPLIT_ACCOUNT) != 0 ||
-                    strcmp (next_path, QOF_PARAM_GUID) != 0) continue;
-#endif
-
-                if (need_AND) g_string_append (sql, " AND ");
-
-                if (strcmp (path, SPLIT_ACCOUNT) == 0 &&
-                    strcmp (next_path, QOF_PARAM_GUID) == 0)
-                {
-                    convert_query_term_to_sql (be, "s.account_guid", term, sql);
-#if SIMPLE_QUERY_COMPILATION
-                    goto done_compiling_query;
-#endif
-
-                }
-                else if (strcmp (path, SPLIT_RECONCILE) == 0)
-                {
-                    convert_query_term_to_sql (be, "s.reconcile_state", term, sql);
-
-                }
-                else if (strcmp (path, SPLIT_TRANS) == 0)
-                {
-#if TX_GUID_CHECK
-                    if (!has_tx_guid_check)
-                    {
-                        g_string_append (sql, "(splits.tx_guid = transactions.guid) AND ");
-                        has_tx_guid_check = TRUE;
-                    }
-#endif
-                    if (strcmp (next_path, TRANS_DATE_POSTED) == 0)
-                    {
-                        convert_query_term_to_sql (be, "t.post_date", term, sql);
-                    }
-                    else if (strcmp (next_path, TRANS_DESCRIPTION) == 0)
-                    {
-                        convert_query_term_to_sql (be, "t.description", term, sql);
-                    }
-                    else
-                    {
-                        unknownPath = TRUE;
-                    }
-
-                }
-                else if (strcmp (path, SPLIT_VALUE) == 0)
-                {
-                    convert_query_term_to_sql (be, "s.value_num/s.value_denom", term, sql);
-
-                }
-                else
-                {
-                    unknownPath = TRUE;
-                }
-
-                if (unknownPath)
-                {
-                    GString* name = g_string_new ((gchar*)paramPath->data);
-                    while (paramPath->next != NULL)
-                    {
-                        g_string_append (name, ".");
-                        g_string_append (name, next_path);
-                        paramPath = paramPath->next;
-                    }
-                    PERR ("Unknown SPLIT query field: %s\n", name->str);
-                    g_string_free (name, TRUE);
-                }
-                need_AND = TRUE;
-            }
-
-            /* If the last char in the string is a '(', then for some reason, there were
-               no terms added to the SQL.  If so, remove it and ignore the OR term. */
-            if (sql->str[sql->len - 1] == '(')
-            {
-                g_string_truncate (sql, sql->len - 1);
-                need_OR = FALSE;
-            }
-            else
-            {
-                g_string_append (sql, ")");
-                need_OR = TRUE;
-            }
-        }
-
-#if SIMPLE_QUERY_COMPILATION
-done_compiling_query:
-#endif
-        if (sql->len != 0)
+        if (g_strcmp0 (type, QOF_TYPE_DATE) == 0)
         {
-#if SIMPLE_QUERY_COMPILATION
-            g_string_append (sql, ")");
-#endif
-            query_sql = g_strdup_printf (
-                            "SELECT DISTINCT t.* FROM %s AS t, %s AS s WHERE s.tx_guid=t.guid AND %s",
-                            TRANSACTION_TABLE, SPLIT_TABLE, sql->str);
+            auto pd = reinterpret_cast<query_date_def*> (pdata);
+            if (g_strcmp0 (next, TRANS_DATE_POSTED) == 0)
+                date_term_to_sql (be, pd, inverted, "t.post_date", cond);
+            else if (g_strcmp0 (next, TRANS_DATE_ENTERED) == 0)
+                date_term_to_sql (be, pd, inverted, "t.enter_date", cond);
         }
-        else
+        else if (g_strcmp0 (type, QOF_TYPE_STRING) == 0)
         {
-            query_sql = g_strdup_printf ("SELECT * FROM %s", TRANSACTION_TABLE);
+            auto pd = reinterpret_cast<query_string_def*> (pdata);
+            std::string notes;
+            if (g_strcmp0 (next, TRANS_DESCRIPTION) == 0)
+                string_term_to_sql (be, pd, inverted, "t.description", cond);
+            else if (g_strcmp0 (next, TRANS_NUM) == 0)
+                string_term_to_sql (be, pd, inverted, "t.num", cond);
+            else if (g_strcmp0 (next, TRANS_NOTES) == 0)
+                string_term_to_sql (be, pd, inverted, "string_val", notes);
+            if (!notes.empty())
+                cond = std::string{"t.guid IN (SELECT obj_guid FROM slots "
+                                   "WHERE name = 'notes' AND "} + notes + ")";
         }
-        query_info->stmt = be->create_statement_from_sql(query_sql);
-
-        g_string_free (sql, TRUE);
-        g_free (query_sql);
-
+        return true;
     }
-    else
+    if (next != nullptr)
     {
-        query_sql = g_strdup_printf ("SELECT * FROM %s", TRANSACTION_TABLE);
-        query_info->stmt = be->create_statement_from_sql(query_sql);
-        g_free (query_sql);
+        if (g_strcmp0 (param, SPLIT_ACCOUNT) == 0 &&
+            g_strcmp0 (next, QOF_PARAM_GUID) == 0 &&
+            path->next->next == nullptr &&
+            g_strcmp0 (type, QOF_TYPE_GUID) == 0)
+            return account_term_to_sql (
+                reinterpret_cast<query_guid_def*> (pdata), inverted, pending,
+                cond);
+        return true;
     }
 
-    return query_info;
+    if (g_strcmp0 (type, QOF_TYPE_CHAR) == 0 &&
+        g_strcmp0 (param, SPLIT_RECONCILE) == 0)
+        reconcile_term_to_sql (reinterpret_cast<query_char_def*> (pdata),
+                               inverted, cond);
+    else if (g_strcmp0 (type, QOF_TYPE_DATE) == 0 &&
+             g_strcmp0 (param, SPLIT_DATE_RECONCILED) == 0)
+        date_term_to_sql (be, reinterpret_cast<query_date_def*> (pdata),
+                          inverted, "s.reconcile_date", cond);
+    else if (g_strcmp0 (type, QOF_TYPE_STRING) == 0)
+    {
+        auto pd = reinterpret_cast<query_string_def*> (pdata);
+        if (g_strcmp0 (param, SPLIT_MEMO) == 0)
+            string_term_to_sql (be, pd, inverted, "s.memo", cond);
+        else if (g_strcmp0 (param, SPLIT_ACTION) == 0)
+            string_term_to_sql (be, pd, inverted, "s.action", cond);
+    }
+    else if (g_strcmp0 (type, QOF_TYPE_NUMERIC) == 0)
+    {
+        auto pd = reinterpret_cast<query_numeric_def*> (pdata);
+        if (g_strcmp0 (param, SPLIT_VALUE) == 0)
+            numeric_term_to_sql (pd, inverted, "s.value_num", "s.value_denom",
+                                 cond);
+        else if (g_strcmp0 (param, SPLIT_AMOUNT) == 0)
+            numeric_term_to_sql (pd, inverted, "s.quantity_num",
+                                 "s.quantity_denom", cond);
+    }
+    return true;
 }
 
-G_GNUC_UNUSED static void
-run_split_query (GncSqlBackend* be, gpointer pQuery)
+/* The condition for one OR term of the query, false if the term cannot
+ * match a split of a pending account. */
+static bool
+split_and_terms_to_sql (const GncSqlBackend* be, GList* and_terms,
+                        const GuidStrSet& pending, std::string& cond)
 {
-    split_query_info_t* query_info = (split_query_info_t*)pQuery;
-
-    g_return_if_fail (be != NULL);
-    g_return_if_fail (pQuery != NULL);
-
-    if (!query_info->has_been_run)
+    for (auto node = and_terms; node != nullptr; node = node->next)
     {
-        query_transactions (be, query_info->stmt);
-        query_info->has_been_run = TRUE;
-        query_info->stmt = nullptr;
+        std::string term_cond;
+        if (!split_term_to_sql (be, static_cast<QofQueryTerm*> (node->data),
+                                pending, term_cond))
+            return false;
+        if (term_cond.empty())
+            continue;
+        if (!cond.empty())
+            cond += " AND ";
+        cond += "(" + term_cond + ")";
     }
+    return true;
 }
 
-G_GNUC_UNUSED static void
-free_split_query (GncSqlBackend* be, gpointer pQuery)
+/**
+ * Loads the transactions of the pending accounts which have splits that
+ * a split query might match, so that running it in memory gives the same
+ * result as if all transactions had been loaded.
+ *
+ * @param be SQL backend
+ * @param query Split query
+ */
+void
+gnc_sql_transaction_load_for_split_query (GncSqlBackend* be, QofQuery* query)
 {
+    GuidStrSet pending;
+
     g_return_if_fail (be != NULL);
-    g_return_if_fail (pQuery != NULL);
+    g_return_if_fail (query != NULL);
+
+    collect_pending_accounts (gnc_book_get_root_account (be->book()), pending);
+    collect_pending_accounts (gnc_book_get_template_root (be->book()), pending);
+    if (pending.empty())
+        return;
+
+    std::string where;
+    bool may_match = !qof_query_has_terms (query);
+    for (auto node = qof_query_get_terms (query); node != nullptr;
+         node = node->next)
+    {
+        std::string cond;
+        if (!split_and_terms_to_sql (be, static_cast<GList*> (node->data),
+                                     pending, cond))
+            continue;
+        may_match = true;
+        if (cond.empty())
+        {
+            /* This term takes all the splits of the pending accounts. */
+            where.clear();
+            break;
+        }
+        where += where.empty() ? "(" : " OR (";
+        where += cond + ")";
+    }
+    if (!may_match)
+        return;
 
-    g_free (pQuery);
+    std::stringstream sql;
+    sql << "SELECT DISTINCT t.* FROM " << TRANSACTION_TABLE << " AS t, " <<
+        SPLIT_TABLE << " AS s WHERE s.tx_guid=t.guid AND s.account_guid IN (" <<
+        guid_str_list (pending) << ")";
+    if (!where.empty())
+        sql << " AND (" << where << ")";
+    auto stmt = be->create_statement_from_sql (sql.str());
+    if (stmt != nullptr)
+        query_transactions (be, stmt);
 }
 
-/* ----------------------------------------------------------------- */
 typedef struct
 {
     const GncSqlBackend* be;
@@ -1259,7 +1431,7 @@ static const EntryVec acct_balances_col_table
                                          (QofSetterFunc)set_acct_bal_balance),
 };
 
-G_GNUC_UNUSED static  single_acct_balance_t*
+static  single_acct_balance_t*
 load_single_acct_balances (const GncSqlBackend* be, GncSqlRow& row)
 {
     single_acct_balance_t* bal = NULL;
@@ -1278,12 +1450,15 @@ load_single_acct_balances (const GncSqlBackend* be, GncSqlRow& row)
 GSList*
 gnc_sql_get_account_balances_slist (GncSqlBackend* be)
 {
-#if LOAD_TRANSACTIONS_AS_NEEDED
     gchar* buf;
     GSList* bal_slist = NULL;
 
     g_return_val_if_fail (be != NULL, NULL);
 
+    /* The splits are going to be loaded and will make up the balances. */
+    if (!be->load_tx_as_needed())
+        return NULL;
+
     buf = g_strdup_printf ("SELECT account_guid, reconcile_state, sum(quantity_num) as quantity_num, quantity_denom FROM %s GROUP BY account_guid, reconcile_state, quantity_denom ORDER BY account_guid, reconcile_state",
                            SPLIT_TABLE);
     auto stmt = be->create_statement_from_sql(buf);
@@ -1312,7 +1487,7 @@ gnc_sql_get_account_balances_slist (GncSqlBackend* be)
             }
             if (bal == NULL)
             {
-                bal = g_malloc ((gsize)sizeof (acct_balances_t));
+                bal = static_cast<decltype (bal)> (g_malloc (sizeof (acct_balances_t)));
                 g_assert (bal != NULL);
 
                 bal->acct = single_bal->acct;
@@ -1320,23 +1495,26 @@ gnc_sql_get_account_balances_slist (GncSqlBackend* be)
                 bal->cleared_balance = gnc_numeric_zero ();
                 bal->reconciled_balance = gnc_numeric_zero ();
             }
-            if (single_bal->reconcile_state == 'n')
+            /* The same states as the engine's balances: everything not
+             * NREC is cleared, and frozen counts as reconciled. */
+            if (single_bal->reconcile_state == NREC)
             {
                 bal->balance = gnc_numeric_add (bal->balance, single_bal->balance,
                                                 GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
             }
-            else if (single_bal->reconcile_state == 'c')
-            {
-                bal->cleared_balance = gnc_numeric_add (bal->cleared_balance,
-                                                        single_bal->balance,
-                                                        GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            }
-            else if (single_bal->reconcile_state == 'y')
+            else if (single_bal->reconcile_state == YREC ||
+                     single_bal->reconcile_state == FREC)
             {
                 bal->reconciled_balance = gnc_numeric_add (bal->reconciled_balance,
                                                            single_bal->balance,
                                                            GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
             }
+            else
+            {
+                bal->cleared_balance = gnc_numeric_add (bal->cleared_balance,
+                                                        single_bal->balance,
+                                                        GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+            }
             g_free (single_bal);
         }
     }
@@ -1353,9 +1531,52 @@ gnc_sql_get_account_balances_slist (GncSqlBackend* be)
     }
 
     return bal_slist;
-#else
-    return NULL;
-#endif
+}
+
+gboolean
+gnc_sql_get_account_balance_as_of (GncSqlBackend* be, Account* acct,
+                                   time64 date, gnc_numeric* balance)
+{
+    gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+
+    g_return_val_if_fail (be != NULL, FALSE);
+    g_return_val_if_fail (acct != NULL, FALSE);
+    g_return_val_if_fail (balance != NULL, FALSE);
+
+    (void)guid_to_string_buff (qof_instance_get_guid (QOF_INSTANCE (acct)),
+                               guid_buf);
+    /* Summed per denominator, so that each sum is exact. */
+    std::stringstream sql;
+    sql << "SELECT account_guid, reconcile_state, sum(quantity_num) as "
+        "quantity_num, quantity_denom FROM " << SPLIT_TABLE <<
+        " INNER JOIN " << TRANSACTION_TABLE << " ON " << SPLIT_TABLE <<
+        ".tx_guid = " << TRANSACTION_TABLE << ".guid WHERE account_guid = '" <<
+        guid_buf << "' AND post_date < '" << be->time64_to_string (date) <<
+        "' GROUP BY account_guid, reconcile_state, quantity_denom";
+    auto stmt = be->create_statement_from_sql (sql.str());
+    if (stmt == nullptr)
+        return FALSE;
+    auto result = be->execute_select_statement (stmt);
+    if (result == nullptr)
+        return FALSE;
+
+    auto total = gnc_numeric_zero ();
+    for (auto row : *result)
+    {
+        auto single_bal = load_single_acct_balances (be, row);
+        if (single_bal == NULL)
+            continue;
+        total = gnc_numeric_add (total, single_bal->balance, GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_LCD);
+        g_free (single_bal);
+    }
+    if (gnc_numeric_check (total) != GNC_ERROR_OK)
+    {
+        PWARN ("Overflow summing the balance of %s", xaccAccountGetName (acct));
+        return FALSE;
+    }
+    *balance = total;
+    return TRUE;
 }
 
 /* ----------------------------------------------------------------- */
@@ -1372,9 +1593,11 @@ GncSqlColumnTableEntryImpl<CT_TXREF>::load (const GncSqlBackend* be,
 
     try
     {
-        auto val = row.get_string_at_col (m_col_name);
+        auto val = row.get_cstring_at_idx (row.get_col_index (m_col_name));
+        if (val == nullptr)
+            return;
         GncGUID guid;
-        (void)string_to_guid (val.c_str(), &guid);
+        (void)string_to_guid (val, &guid);
         auto tx = xaccTransLookup (&guid, be->book());
 
         // If the transaction is not found, try loading it
@@ -46,6 +46,32 @@ void gnc_sql_init_transaction_handler (void);
  */
 void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* be,
                                               Account* account);
+/**
+ * Loads all transactions posted on or after a date.
+ *
+ * @param be SQL backend
+ * @param date The earliest posted date loaded
+ */
+void gnc_sql_transaction_load_posted_since (GncSqlBackend* be, time64 date);
+/**
+ * Loads the transactions of the accounts with pending splits that a split
+ * query might match.
+ *
+ * @param be SQL backend
+ * @param query Split query
+ */
+void gnc_sql_transaction_load_for_split_query (GncSqlBackend* be,
+                                               QofQuery* query);
+/**
+ * Reloads the transactions from the database, as another session changed
+ * them.  Those open or dirty here are left alone, those the engine doesn't
+ * have are loaded and those no longer in the database are destroyed.  The
+ * engine's commits raise the QOF events.
+ *
+ * @param be SQL backend
+ * @param guids The transactions' GUIDs
+ */
+void gnc_sql_transaction_reload (GncSqlBackend* be, const std::vector<GncGUID>& guids);
 typedef struct
 {
     Account* acct;
@@ -63,4 +89,17 @@ typedef struct
  */
 GSList* gnc_sql_get_account_balances_slist (GncSqlBackend* be);
 
+/**
+ * Sums the amounts of the account's splits in transactions posted before
+ * the date in the database, without loading them.
+ *
+ * @param be SQL backend
+ * @param acct Account
+ * @param date Date
+ * @param balance Set to the balance on success
+ * @return FALSE if the query failed or the sum overflowed
+ */
+gboolean gnc_sql_get_account_balance_as_of (GncSqlBackend* be, Account* acct,
+                                            time64 date, gnc_numeric* balance);
+
 #endif /* GNC_TRANSACTION_SQL_H */
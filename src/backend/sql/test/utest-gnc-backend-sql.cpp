@@ -29,6 +29,7 @@ extern "C"
 }
 /* Add specific headers for this class */
 #include "../gnc-backend-sql.h"
+#include <kvp_frame.hpp>
 
 static const gchar* suitename = "/backend/sql/gnc-backend-sql";
 void test_suite_gnc_backend_sql (void);
@@ -63,6 +64,21 @@ protected:
             { return 1466270857LL; }
             virtual bool is_col_null(const char* col) const noexcept
             { return false; }
+            virtual int get_col_index (const char* col, const char* suffix)
+                const noexcept
+            { return 0; }
+            virtual int64_t get_int_at_idx (int idx) const
+            { return 1LL; }
+            virtual float get_float_at_idx (int idx) const
+            { return 1.0; }
+            virtual double get_double_at_idx (int idx) const
+            { return 1.0; }
+            virtual const char* get_cstring_at_idx (int idx) const
+            { return "foo"; }
+            virtual time64 get_time64_at_idx (int idx) const
+            { return 1466270857LL; }
+            virtual bool is_idx_null(int idx) const noexcept
+            { return false; }
         private:
             GncMockSqlResult* m_inst;
         };
@@ -91,6 +107,11 @@ public:
     GncSqlStatementPtr create_statement_from_sql (const std::string&)
         const noexcept override {
         return std::unique_ptr<GncMockSqlStatement>(new GncMockSqlStatement); }
+    GncSqlStatementPtr create_write_statement (E_DB_OPERATION,
+                                               const std::string&,
+                                               const PairVec&)
+        noexcept override {
+        return std::unique_ptr<GncMockSqlStatement>(new GncMockSqlStatement); }
     bool does_table_exist (const std::string&) const noexcept override {
         return true; }
     bool begin_transaction () noexcept override { return true;}
@@ -330,6 +351,41 @@ test_gnc_sql_commit_edit (void)
     g_object_unref (inst);
     g_object_unref (book);
 }
+
+static void
+test_write_behind (void)
+{
+    GncMockSqlConnection conn;
+
+    qof_object_initialize ();
+    auto book = qof_book_new();
+    GncSqlBackend be (&conn, book);
+    auto inst = static_cast<QofInstance*> (g_object_new (QOF_TYPE_INSTANCE,
+                                                         NULL));
+    qof_instance_init_data (inst, QOF_ID_NULL, book);
+
+    g_assert (!be.write_behind ());
+    be.set_write_behind (60000, 3);
+    g_assert (be.write_behind ());
+
+    /* Committing the same object again doesn't queue it twice. */
+    g_assert (be.queue_commit (inst));
+    g_assert (be.queue_commit (inst));
+    g_assert_cmpuint (G_OBJECT (inst)->ref_count, == , 2);
+    g_assert (be.flush_commits ());
+    g_assert_cmpuint (G_OBJECT (inst)->ref_count, == , 1);
+    g_assert (be.flush_commits ());
+
+    /* Leaving write-behind mode writes out the queue. */
+    g_assert (be.queue_commit (inst));
+    g_assert_cmpuint (G_OBJECT (inst)->ref_count, == , 2);
+    be.set_write_behind (0);
+    g_assert (!be.write_behind ());
+    g_assert_cmpuint (G_OBJECT (inst)->ref_count, == , 1);
+
+    g_object_unref (inst);
+    g_object_unref (book);
+}
 /* handle_and_term
 static void
 handle_and_term (QofQueryTerm* pTerm, GString* sql)// 2
@@ -595,7 +651,7 @@ test_gnc_sql_add_objectref_guid_col_info_to_list (Fixture *fixture, gconstpointe
 std::string
 GncDbiBackend::time64_to_string (time64 t)// C: 1 */
 
-#define numtests 6
+#define numtests 8
 static void
 test_time64_to_string ()
 {
@@ -605,7 +661,9 @@ test_time64_to_string ()
                                   "1964-02-29 09:15:23",
                                   "1959-04-02 00:00:00",
                                   "2043-11-22 05:32:45",
-                                  "2153-12-18 01:15:30"
+                                  "2153-12-18 01:15:30",
+                                  "1969-12-31 23:59:59",
+                                  "2000-02-29 00:00:00"
                                  };
     
     for (auto date : dates)
@@ -617,6 +675,56 @@ test_time64_to_string ()
     }
 
 }
+
+static void
+test_saved_slots ()
+{
+    GncSqlBackend be {nullptr, nullptr};
+    auto guid = guid_new_return ();
+    KvpFrameImpl frame;
+
+    g_assert (!be.slots_unchanged (&guid, &frame));
+    be.remember_slots (&guid, &frame);
+    g_assert (be.slots_unchanged (&guid, &frame));
+    g_assert (be.slots_unchanged (&guid, nullptr));
+
+    frame.set ("foo", new KvpValue {INT64_C(15)});
+    g_assert (!be.slots_unchanged (&guid, &frame));
+    be.remember_slots (&guid, &frame);
+    g_assert (be.slots_unchanged (&guid, &frame));
+    g_assert (!be.slots_unchanged (&guid, nullptr));
+
+    /* The remembered slots are a copy, not the frame itself. */
+    delete frame.set ("foo", new KvpValue {INT64_C(16)});
+    g_assert (!be.slots_unchanged (&guid, &frame));
+    be.remember_slots (&guid, &frame);
+    g_assert (be.slots_unchanged (&guid, &frame));
+
+    be.forget_slots (&guid);
+    g_assert (!be.slots_unchanged (&guid, &frame));
+    be.remember_slots (&guid, &frame);
+    be.forget_all_slots ();
+    g_assert (!be.slots_unchanged (&guid, &frame));
+}
+
+static void
+test_persisted ()
+{
+    GncSqlBackend be {nullptr, nullptr};
+    auto guid = guid_new_return ();
+    auto other = guid_new_return ();
+
+    g_assert (!be.is_persisted (&guid));
+    be.remember_persisted (&guid);
+    g_assert (be.is_persisted (&guid));
+    g_assert (!be.is_persisted (&other));
+    be.remember_persisted (&other);
+    be.forget_persisted (&guid);
+    g_assert (!be.is_persisted (&guid));
+    g_assert (be.is_persisted (&other));
+    be.forget_all_persisted ();
+    g_assert (!be.is_persisted (&other));
+}
 /* load_timespec
 static void
 load_timespec (const GncSqlBackend* be, GncSqlRow& row,// 2
@@ -900,6 +1008,7 @@ test_suite_gnc_backend_sql (void)
 // GNC_TEST_ADD (suitename, "gnc sql rollback edit", Fixture, nullptr, test_gnc_sql_rollback_edit,  teardown);
 // GNC_TEST_ADD (suitename, "commit cb", Fixture, nullptr, test_commit_cb,  teardown);
     GNC_TEST_ADD_FUNC (suitename, "gnc sql commit edit", test_gnc_sql_commit_edit);
+    GNC_TEST_ADD_FUNC (suitename, "gnc sql write behind", test_write_behind);
 // GNC_TEST_ADD (suitename, "handle and term", Fixture, nullptr, test_handle_and_term,  teardown);
 // GNC_TEST_ADD (suitename, "compile query cb", Fixture, nullptr, test_compile_query_cb,  teardown);
 // GNC_TEST_ADD (suitename, "gnc sql compile query", Fixture, nullptr, test_gnc_sql_compile_query,  teardown);
@@ -937,6 +1046,10 @@ test_suite_gnc_backend_sql (void)
 // GNC_TEST_ADD (suitename, "gnc sql add objectref guid col info to list", Fixture, nullptr, test_gnc_sql_add_objectref_guid_col_info_to_list,  teardown);
     GNC_TEST_ADD_FUNC (suitename, "GncDbiBackend time64 to string",
                        test_time64_to_string);
+    GNC_TEST_ADD_FUNC (suitename, "GncSqlBackend saved slots",
+                       test_saved_slots);
+    GNC_TEST_ADD_FUNC (suitename, "GncSqlBackend persisted rows",
+                       test_persisted);
 // GNC_TEST_ADD (suitename, "load timespec", Fixture, nullptr, test_load_timespec,  teardown);
 // GNC_TEST_ADD (suitename, "add timespec col info to list", Fixture, nullptr, test_add_timespec_col_info_to_list,  teardown);
 // GNC_TEST_ADD (suitename, "add value timespec to vec", Fixture, nullptr, test_add_value_timespec_to_vec,  teardown);
@@ -166,6 +166,69 @@ gnc_account_dom_tree_create (Account* act,
     return ret;
 }
 
+/* The streaming version of gnc_account_dom_tree_create(); keep them in
+ * step. */
+void
+gnc_account_to_xml_stream (GncXmlStreamWriter& writer, Account* act,
+                           gboolean exporting, gboolean allow_incompat)
+{
+    char buff[32];
+
+    ENTER ("(account=%p)", act);
+
+    writer.start_element (gnc_account_string);
+    writer.add_attribute ("version", account_version_string);
+
+    text_to_xml_stream (writer, act_name_string, xaccAccountGetName (act));
+    guid_to_xml_stream (writer, act_id_string, xaccAccountGetGUID (act));
+    text_to_xml_stream (writer, act_type_string,
+                        xaccAccountTypeEnumAsString (xaccAccountGetType (act)));
+
+    auto acct_commodity = xaccAccountGetCommodity (act);
+    if (acct_commodity != NULL)
+    {
+        commodity_ref_to_xml_stream (writer, act_commodity_string,
+                                     acct_commodity);
+        g_snprintf (buff, sizeof (buff), "%d",
+                    xaccAccountGetCommoditySCUi (act));
+        writer.text_element (act_commodity_scu_string, buff);
+        if (xaccAccountGetNonStdSCU (act))
+            writer.text_element (act_non_standard_scu_string, nullptr);
+    }
+
+    auto str = xaccAccountGetCode (act);
+    if (str && strlen (str) > 0)
+        text_to_xml_stream (writer, act_code_string, str);
+
+    str = xaccAccountGetDescription (act);
+    if (str && strlen (str) > 0)
+        text_to_xml_stream (writer, act_description_string, str);
+
+    qof_instance_slots_to_xml_stream (writer, act_slots_string,
+                                      QOF_INSTANCE (act));
+    auto parent = gnc_account_get_parent (act);
+    if (parent)
+    {
+        if (!gnc_account_is_root (parent) || allow_incompat)
+            guid_to_xml_stream (writer, act_parent_string,
+                                xaccAccountGetGUID (parent));
+    }
+
+    auto lots = xaccAccountGetLotList (act);
+    if (lots && !exporting)
+    {
+        writer.start_element (act_lots_string);
+        lots = g_list_sort (lots, qof_instance_guid_compare);
+        for (auto n = lots; n; n = n->next)
+            gnc_lot_to_xml_stream (writer, static_cast<GNCLot*> (n->data));
+        writer.end_element (act_lots_string);
+    }
+    g_list_free (lots);
+
+    writer.end_element (gnc_account_string);
+    LEAVE ("");
+}
+
 /***********************************************************************/
 
 struct account_pdata
@@ -555,7 +618,7 @@ dom_tree_to_account (xmlNodePtr node, QofBook* book)
 sixtp*
 gnc_account_sixtp_parser_create (void)
 {
-    return sixtp_dom_parser_new (gnc_account_end_handler, NULL, NULL);
+    return sixtp_dom_slots_parser_new (gnc_account_end_handler, NULL, NULL);
 }
 
 /* ======================  END OF FILE ===================*/
@@ -106,6 +106,13 @@ extern "C"
 static QofLogModule log_module = GNC_MOD_BACKEND;
 
 static gboolean save_may_clobber_data (FileBackend *bend);
+static gboolean gnc_xml_be_write_to_file (FileBackend* fbe, QofBook* book,
+                                          const gchar* datafile,
+                                          gboolean make_backup);
+static gboolean xml_background_save_wait (FileBackend* fbe);
+
+/* Past this size a journaled save becomes a full one */
+#define GNC_XML_JOURNAL_MAX_SIZE (16 * 1024 * 1024)
 
 struct QofXmlBackendProvider : public QofBackendProvider
 {
@@ -417,12 +424,29 @@ xml_session_end (QofBackend* be_start)
     FileBackend* be = (FileBackend*)be_start;
     ENTER (" ");
 
+    /* A background save that failed leaves the book dirty, so the
+     * journal isn't folded in below. */
+    if (!xml_background_save_wait (be))
+    {
+        qof_backend_set_error (be_start, ERR_FILEIO_WRITE_ERROR);
+        qof_backend_set_message (be_start, "The last background save failed");
+    }
+
     if (be->book && qof_book_is_readonly (be->book))
     {
         qof_backend_set_error ((QofBackend*)be, ERR_BACKEND_READONLY);
         return;
     }
 
+    /* Fold a journal into the data file, unless that would also save
+     * changes the user chose not to keep. */
+    if (be->book && be->fullpath && gnc_xml2_journal_size (be->fullpath) >= 0 &&
+        !qof_book_session_not_saved (be->book))
+    {
+        if (gnc_xml_be_write_to_file (be, be->book, be->fullpath, FALSE))
+            gnc_xml2_journal_reset (be);
+    }
+
     if (be->linkfile)
         g_unlink (be->linkfile);
 
@@ -462,6 +486,12 @@ xml_session_end (QofBackend* be_start)
 static void
 xml_destroy_backend (QofBackend* be)
 {
+    FileBackend* fbe = (FileBackend*) be;
+
+    xml_background_save_wait (fbe);
+    if (fbe->journal)
+        g_hash_table_destroy (fbe->journal);
+
     /* Stop transaction logging */
     xaccLogSetBaseName (NULL);
 
@@ -671,18 +701,17 @@ det_exit:
     return result;
 }
 
+/* be may be NULL, as it is for a background save; the caller then
+ * sets the error. */
 static gboolean
-gnc_xml_be_backup_file (FileBackend* be)
+gnc_xml_be_backup_file (FileBackend* be, const char* datafile)
 {
     gboolean bkup_ret;
     char* timestamp;
     char* backup;
-    const char* datafile;
     struct stat statbuf;
     int rc;
 
-    datafile = be->fullpath;
-
     rc = g_stat (datafile, &statbuf);
     if (rc)
         return (errno == ENOENT);
@@ -714,6 +743,94 @@ gnc_xml_be_backup_file (FileBackend* be)
 
 /* ================================================================= */
 
+/* A name beside datafile for a save to be written to, or NULL. */
+static gchar*
+gnc_xml_be_temp_name (const gchar* datafile)
+{
+    gchar* tmp_name = g_new (char, strlen (datafile) + 12);
+
+    strcpy (tmp_name, datafile);
+    strcat (tmp_name, ".tmp-XXXXXX");
+    if (!mktemp (tmp_name))
+    {
+        g_free (tmp_name);
+        return NULL;
+    }
+    return tmp_name;
+}
+
+/* Put the completed save tmp_name in place of datafile, with the data
+ * file's permissions, and return the error if that fails. Nothing here
+ * touches the book or the backend, so it can run in any thread. */
+static QofBackendError
+gnc_xml_be_install_file (const gchar* tmp_name, const gchar* datafile)
+{
+    struct stat statbuf;
+    int rc;
+
+    /* Record the file's permissions before g_unlinking it */
+    rc = g_stat (datafile, &statbuf);
+    if (rc == 0)
+    {
+        /* We must never chmod the file /dev/null */
+        g_assert (g_strcmp0 (tmp_name, "/dev/null") != 0);
+
+        /* Use the permissions from the original data file */
+        if (g_chmod (tmp_name, statbuf.st_mode) != 0)
+        {
+            /* qof_backend_set_error(be, ERR_BACKEND_PERM); */
+            /* qof_backend_set_message( be, "Failed to chmod filename %s", tmp_name ); */
+            /* Even if the chmod did fail, the save
+               nevertheless completed successfully. It is
+               therefore wrong to signal the ERR_BACKEND_PERM
+               error here which implies that the saving itself
+               failed. Instead, we simply ignore this. */
+            PWARN ("unable to chmod filename %s: %s",
+                   tmp_name ? tmp_name : "(null)",
+                   g_strerror (errno) ? g_strerror (errno) : "");
+#if VFAT_DOESNT_SUCK  /* chmod always fails on vfat/samba fs */
+            /* g_free(tmp_name); */
+            /* return FALSE; */
+#endif
+        }
+#ifdef HAVE_CHOWN
+        /* Don't try to change the owner. Only root can do
+           that. */
+        if (chown (tmp_name, -1, statbuf.st_gid) != 0)
+        {
+            /* qof_backend_set_error(be, ERR_BACKEND_PERM); */
+            /* qof_backend_set_message( be, "Failed to chown filename %s", tmp_name ); */
+            /* A failed chown doesn't mean that the saving itself
+            failed. So don't abort with an error here! */
+            PWARN ("unable to chown filename %s: %s",
+                   tmp_name ? tmp_name : "(null)",
+                   strerror (errno) ? strerror (errno) : "");
+#if VFAT_DOESNT_SUCK /* chown always fails on vfat fs */
+            /* g_free(tmp_name);
+            return FALSE; */
+#endif
+        }
+#endif
+    }
+    if (g_unlink (datafile) != 0 && errno != ENOENT)
+    {
+        PWARN ("unable to unlink filename %s: %s",
+               datafile ? datafile : "(null)",
+               g_strerror (errno) ? g_strerror (errno) : "");
+        return ERR_BACKEND_READONLY;
+    }
+    if (!gnc_int_link_or_make_backup (NULL, tmp_name, datafile))
+        return ERR_FILEIO_BACKUP_ERROR;
+    if (g_unlink (tmp_name) != 0)
+    {
+        PWARN ("unable to unlink temp filename %s: %s",
+               tmp_name ? tmp_name : "(null)",
+               g_strerror (errno) ? g_strerror (errno) : "");
+        return ERR_BACKEND_PERM;
+    }
+    return ERR_BACKEND_NO_ERR;
+}
+
 static gboolean
 gnc_xml_be_write_to_file (FileBackend* fbe,
                           QofBook* book,
@@ -722,8 +839,6 @@ gnc_xml_be_write_to_file (FileBackend* fbe,
 {
     QofBackend* be = &fbe->be;
     char* tmp_name;
-    struct stat statbuf;
-    int rc;
     QofBackendError be_err;
 
     ENTER (" book=%p file=%s", book, datafile);
@@ -740,11 +855,8 @@ gnc_xml_be_write_to_file (FileBackend* fbe,
     /* XXX this is currently broken due to faulty 'Save As' logic. */
     /* if (FALSE == qof_book_session_not_saved (book)) return FALSE; */
 
-    tmp_name = g_new (char, strlen (datafile) + 12);
-    strcpy (tmp_name, datafile);
-    strcat (tmp_name, ".tmp-XXXXXX");
-
-    if (!mktemp (tmp_name))
+    tmp_name = gnc_xml_be_temp_name (datafile);
+    if (!tmp_name)
     {
         qof_backend_set_error (be, ERR_BACKEND_MISC);
         qof_backend_set_message (be, "Failed to make temp file");
@@ -754,8 +866,9 @@ gnc_xml_be_write_to_file (FileBackend* fbe,
 
     if (make_backup)
     {
-        if (!gnc_xml_be_backup_file (fbe))
+        if (!gnc_xml_be_backup_file (fbe, fbe->fullpath))
         {
+            g_free (tmp_name);
             LEAVE ("");
             return FALSE;
         }
@@ -764,80 +877,25 @@ gnc_xml_be_write_to_file (FileBackend* fbe,
     if (gnc_book_write_to_xml_file_v2 (book, tmp_name,
                                        gnc_prefs_get_file_save_compressed ()))
     {
-        /* Record the file's permissions before g_unlinking it */
-        rc = g_stat (datafile, &statbuf);
-        if (rc == 0)
-        {
-            /* We must never chmod the file /dev/null */
-            g_assert (g_strcmp0 (tmp_name, "/dev/null") != 0);
-
-            /* Use the permissions from the original data file */
-            if (g_chmod (tmp_name, statbuf.st_mode) != 0)
-            {
-                /* qof_backend_set_error(be, ERR_BACKEND_PERM); */
-                /* qof_backend_set_message( be, "Failed to chmod filename %s", tmp_name ); */
-                /* Even if the chmod did fail, the save
-                   nevertheless completed successfully. It is
-                   therefore wrong to signal the ERR_BACKEND_PERM
-                   error here which implies that the saving itself
-                   failed. Instead, we simply ignore this. */
-                PWARN ("unable to chmod filename %s: %s",
-                       tmp_name ? tmp_name : "(null)",
-                       g_strerror (errno) ? g_strerror (errno) : "");
-#if VFAT_DOESNT_SUCK  /* chmod always fails on vfat/samba fs */
-                /* g_free(tmp_name); */
-                /* return FALSE; */
-#endif
-            }
-#ifdef HAVE_CHOWN
-            /* Don't try to change the owner. Only root can do
-               that. */
-            if (chown (tmp_name, -1, statbuf.st_gid) != 0)
-            {
-                /* qof_backend_set_error(be, ERR_BACKEND_PERM); */
-                /* qof_backend_set_message( be, "Failed to chown filename %s", tmp_name ); */
-                /* A failed chown doesn't mean that the saving itself
-                failed. So don't abort with an error here! */
-                PWARN ("unable to chown filename %s: %s",
-                       tmp_name ? tmp_name : "(null)",
-                       strerror (errno) ? strerror (errno) : "");
-#if VFAT_DOESNT_SUCK /* chown always fails on vfat fs */
-                /* g_free(tmp_name);
-                return FALSE; */
-#endif
-            }
-#endif
-        }
-        if (g_unlink (datafile) != 0 && errno != ENOENT)
-        {
-            qof_backend_set_error (be, ERR_BACKEND_READONLY);
-            PWARN ("unable to unlink filename %s: %s",
-                   datafile ? datafile : "(null)",
-                   g_strerror (errno) ? g_strerror (errno) : "");
-            g_free (tmp_name);
-            LEAVE ("");
-            return FALSE;
-        }
-        if (!gnc_int_link_or_make_backup (fbe, tmp_name, datafile))
-        {
-            qof_backend_set_error (be, ERR_FILEIO_BACKUP_ERROR);
-            qof_backend_set_message (be, "Failed to make backup file %s",
-                                     datafile ? datafile : "NULL");
-            g_free (tmp_name);
-            LEAVE ("");
-            return FALSE;
-        }
-        if (g_unlink (tmp_name) != 0)
+        be_err = gnc_xml_be_install_file (tmp_name, datafile);
+        g_free (tmp_name);
+        if (be_err != ERR_BACKEND_NO_ERR)
         {
-            qof_backend_set_error (be, ERR_BACKEND_PERM);
-            PWARN ("unable to unlink temp filename %s: %s",
-                   tmp_name ? tmp_name : "(null)",
-                   g_strerror (errno) ? g_strerror (errno) : "");
-            g_free (tmp_name);
+            qof_backend_set_error (be, be_err);
+            if (be_err == ERR_FILEIO_BACKUP_ERROR)
+                qof_backend_set_message (be, "Failed to make backup file %s",
+                                         datafile ? datafile : "NULL");
             LEAVE ("");
             return FALSE;
         }
-        g_free (tmp_name);
+
+        /* A snapshot only pays off for compressed files, and a stale one
+         * would never be used again. */
+        if (gnc_prefs_get_file_save_snapshot () &&
+            gnc_prefs_get_file_save_compressed ())
+            gnc_book_write_snapshot_v2 (book, datafile);
+        else
+            gnc_xml2_remove_snapshot (datafile);
 
         /* Since we successfully saved the book,
          * we should mark it clean. */
@@ -1017,8 +1075,206 @@ gnc_xml_be_remove_old_files (FileBackend* be)
     g_dir_close (dir);
 }
 
+/* ================================================================= */
+/* Background saves. The book isn't safe to read from another thread
+ * while it is being edited, so the main thread still writes it out,
+ * uncompressed, which the parallel serializer keeps short. A thread
+ * then does the slow part: the backup, compression, fsync, moving the
+ * file into place and the snapshot. The book is marked saved as of the
+ * serialization, so later edits dirty it again.
+ */
+
+typedef struct
+{
+    FileBackend* fbe;
+    gchar* datafile;
+    gchar* staging;     /* The uncompressed save */
+    gboolean compress;
+    gint compression_level;
+    gint compression_threads;
+    gboolean snapshot;
+    QofBackendError err;
+} XmlBackgroundSave;
+
+static gboolean xml_background_save_done (gpointer data);
+
+static gboolean
+gnc_xml_be_sync_to_disk (const gchar* path)
+{
+#ifdef HAVE_FSYNC
+    int fd = g_open (path, O_RDONLY, 0);
+    gboolean synced;
+
+    if (fd == -1)
+        return FALSE;
+    synced = fsync (fd) == 0;
+    close (fd);
+    return synced;
+#else
+    return TRUE;
+#endif
+}
+
+static gpointer
+xml_background_save_thread (gpointer data)
+{
+    auto save = static_cast<XmlBackgroundSave*> (data);
+    gchar* tmp_name = NULL;
+
+    if (!save->compress)
+        tmp_name = g_strdup (save->staging);
+    else if ((tmp_name = gnc_xml_be_temp_name (save->datafile)) == NULL)
+        save->err = ERR_BACKEND_MISC;
+    else if (!gnc_xml2_compress_file (save->staging, tmp_name,
+                                      save->compression_level,
+                                      save->compression_threads))
+        save->err = ERR_FILEIO_WRITE_ERROR;
+
+    if (save->err == ERR_BACKEND_NO_ERR && !gnc_xml_be_sync_to_disk (tmp_name))
+        save->err = ERR_FILEIO_WRITE_ERROR;
+    if (save->err == ERR_BACKEND_NO_ERR &&
+        !gnc_xml_be_backup_file (NULL, save->datafile))
+        save->err = ERR_FILEIO_BACKUP_ERROR;
+    /* Until it is installed the data file is untouched, and tmp_name
+     * is of no use. */
+    if (save->err != ERR_BACKEND_NO_ERR)
+    {
+        if (tmp_name)
+            g_unlink (tmp_name);
+    }
+    else
+        save->err = gnc_xml_be_install_file (tmp_name, save->datafile);
+    if (save->err == ERR_BACKEND_NO_ERR)
+    {
+        /* The journal belonged to the data file just replaced. */
+        gnc_xml2_journal_remove (save->datafile);
+        if (save->snapshot)
+            gnc_xml2_write_snapshot_from_file (save->staging, save->datafile);
+        else
+            gnc_xml2_remove_snapshot (save->datafile);
+    }
+    /* Uncompressed, the staging file was moved into place. */
+    if (save->compress)
+        g_unlink (save->staging);
+    g_free (tmp_name);
+
+    g_idle_add (xml_background_save_done, save->fbe);
+    return save;
+}
+
+/* Serialize the book and start the thread that finishes the save, or
+ * return FALSE for the caller to save in the foreground. */
+static gboolean
+xml_background_save_start (FileBackend* fbe, QofBook* book)
+{
+    XmlBackgroundSave* save;
+    GError* error = NULL;
+    gchar* staging;
+
+    staging = gnc_xml_be_temp_name (fbe->fullpath);
+    if (!staging)
+        return FALSE;
+    if (!gnc_book_write_to_xml_file_v2 (book, staging, FALSE))
+    {
+        g_unlink (staging);
+        g_free (staging);
+        return FALSE;
+    }
+
+    save = g_new0 (XmlBackgroundSave, 1);
+    save->fbe = fbe;
+    save->datafile = g_strdup (fbe->fullpath);
+    save->staging = staging;
+    /* The preferences are read here rather than in the thread. */
+    save->compress = gnc_prefs_get_file_save_compressed ();
+    save->compression_level = gnc_prefs_get_file_compression_level ();
+    save->compression_threads = gnc_prefs_get_file_compression_threads ();
+    save->snapshot = save->compress && gnc_prefs_get_file_save_snapshot ();
+    save->err = ERR_BACKEND_NO_ERR;
+
+#ifndef HAVE_GLIB_2_32
+    fbe->save_thread = g_thread_create (xml_background_save_thread, save,
+                                        TRUE, &error);
+#else
+    fbe->save_thread = g_thread_try_new ("xml_save", xml_background_save_thread,
+                                         save, &error);
+#endif
+    if (!fbe->save_thread)
+    {
+        PWARN ("Could not start the background save: %s",
+               error ? error->message : "");
+        if (error)
+            g_error_free (error);
+        g_unlink (staging);
+        g_free (staging);
+        g_free (save->datafile);
+        g_free (save);
+        return FALSE;
+    }
+
+    /* Whatever the journal held is in the save now. */
+    if (fbe->journal)
+        g_hash_table_remove_all (fbe->journal);
+    fbe->journal_needs_full_save = FALSE;
+    qof_book_mark_session_saved (book);
+    return TRUE;
+}
+
+/* Take in the outcome of the background save, waiting for it to finish
+ * if need be. Returns FALSE if it failed, in which case the book is
+ * dirty again and the next save is a full one. */
+static gboolean
+xml_background_save_collect (FileBackend* fbe)
+{
+    XmlBackgroundSave* save;
+    gboolean success;
+
+    if (!fbe->save_thread)
+        return TRUE;
+    save = static_cast<XmlBackgroundSave*> (g_thread_join (fbe->save_thread));
+    fbe->save_thread = NULL;
+
+    success = save->err == ERR_BACKEND_NO_ERR;
+    if (success)
+    {
+        if (fbe->lockfile)
+            gnc_xml_be_remove_old_files (fbe);
+    }
+    else
+    {
+        PERR ("The background save of %s failed: %d", save->datafile,
+              save->err);
+        fbe->journal_needs_full_save = TRUE;
+        if (fbe->book)
+            qof_book_mark_session_dirty (fbe->book);
+    }
+    g_free (save->staging);
+    g_free (save->datafile);
+    g_free (save);
+    return success;
+}
+
+/* Run from the main loop once the thread is done, so that a failure
+ * dirties the book without waiting for the next save. */
+static gboolean
+xml_background_save_done (gpointer data)
+{
+    xml_background_save_collect (static_cast<FileBackend*> (data));
+    return FALSE;
+}
+
+static gboolean
+xml_background_save_wait (FileBackend* fbe)
+{
+    gboolean success = xml_background_save_collect (fbe);
+
+    /* The thread is gone; so must be the callback it queued. */
+    g_idle_remove_by_data (fbe);
+    return success;
+}
+
 static void
-xml_sync_all (QofBackend* be, QofBook* book)
+xml_sync (QofBackend* be, QofBook* book, gboolean background)
 {
     FileBackend* fbe = (FileBackend*) be;
     ENTER ("book=%p, fbe->book=%p", book, fbe->book);
@@ -1039,11 +1295,46 @@ xml_sync_all (QofBackend* be, QofBook* book)
         return;
     }
 
-    gnc_xml_be_write_to_file (fbe, book, fbe->fullpath, TRUE);
+    /* Saves don't overlap. One that failed in the background is redone
+     * in the foreground, so that its error gets reported. */
+    if (!xml_background_save_wait (fbe))
+        background = FALSE;
+
+    /* Between full saves, only append the changed transactions to the
+     * journal, until it grows too big. */
+    if (be->commit && gnc_xml2_journal_size (fbe->fullpath) < GNC_XML_JOURNAL_MAX_SIZE &&
+        g_file_test (fbe->fullpath, G_FILE_TEST_EXISTS) &&
+        gnc_xml2_journal_append (fbe, book))
+    {
+        qof_book_mark_session_saved (book);
+        LEAVE ("book=%p journaled", book);
+        return;
+    }
+
+    if (background && xml_background_save_start (fbe, book))
+    {
+        LEAVE ("book=%p saving in the background", book);
+        return;
+    }
+
+    if (gnc_xml_be_write_to_file (fbe, book, fbe->fullpath, TRUE))
+        gnc_xml2_journal_reset (fbe);
     gnc_xml_be_remove_old_files (fbe);
     LEAVE ("book=%p", book);
 }
 
+static void
+xml_sync_all (QofBackend* be, QofBook* book)
+{
+    xml_sync (be, book, FALSE);
+}
+
+static void
+xml_background_sync (QofBackend* be, QofBook* book)
+{
+    xml_sync (be, book, TRUE);
+}
+
 /* ================================================================= */
 /* Routines to deal with the creation of multiple books.
  * The core design assumption here is that the book
@@ -1077,6 +1368,15 @@ build_period_filepath (FileBackend* fbe, QofBook* book)
     return str;
 }
 
+static void
+xml_commit_edit (QofBackend* be, QofInstance* inst)
+{
+    FileBackend* fbe = (FileBackend*) be;
+
+    if (!fbe->loading)
+        gnc_xml2_journal_note_commit (fbe, inst);
+}
+
 static void
 xml_begin_edit (QofBackend* be, QofInstance* inst)
 {
@@ -1137,16 +1437,25 @@ gnc_xml_be_load_from_file (QofBackend* bend, QofBook* book,
 
     error = ERR_BACKEND_NO_ERR;
     be->book = book;
+    be->loading = TRUE;
 
     switch (gnc_xml_be_determine_file_type (be->fullpath))
     {
     case GNC_BOOK_XML2_FILE:
-        rc = qof_session_load_from_xml_file_v2 (be, book, GNC_BOOK_XML2_FILE);
+        if (gnc_prefs_get_file_save_snapshot () &&
+            gnc_xml2_snapshot_is_current (be->fullpath))
+            rc = qof_session_load_from_xml_snapshot_v2 (be, book);
+        else
+            rc = qof_session_load_from_xml_file_v2 (be, book, GNC_BOOK_XML2_FILE);
         if (FALSE == rc)
         {
             PWARN ("Syntax error in Xml File %s", be->fullpath);
             error = ERR_FILEIO_PARSE_ERROR;
         }
+        else if (!gnc_xml2_journal_replay (be, book))
+        {
+            error = ERR_FILEIO_PARSE_ERROR;
+        }
         break;
 
     case GNC_BOOK_XML2_FILE_NO_ENCODING:
@@ -1192,6 +1501,8 @@ gnc_xml_be_load_from_file (QofBackend* bend, QofBook* book,
         qof_backend_set_error (bend, error);
     }
 
+    be->loading = FALSE;
+
     /* We just got done loading, it can't possibly be dirty !! */
     qof_book_mark_session_saved (book);
 }
@@ -1238,12 +1549,14 @@ QofXmlBackendProvider::create_backend(void)
 
     be->load = gnc_xml_be_load_from_file;
 
-    /* The file backend treats accounting periods transactionally. */
+    /* The file backend treats accounting periods transactionally.
+     * Commits are only needed to feed the journal. */
     be->begin = xml_begin_edit;
-    be->commit = NULL;
+    be->commit = gnc_prefs_get_file_save_journal () ? xml_commit_edit : NULL;
     be->rollback = xml_rollback_edit;
 
     be->sync = xml_sync_all;
+    be->background_sync = xml_background_sync;
 
     be->export_fn = gnc_xml_be_write_accounts_to_file;
 
@@ -67,6 +67,13 @@ struct FileBackend_struct
     int lockfd;
 
     QofBook* book;  /* The primary, main open book */
+
+    gboolean loading;
+    /* GUIDs of the transactions committed since the last save */
+    GHashTable* journal;
+    gboolean journal_needs_full_save;
+    /* The thread finishing a background save, until it is collected */
+    GThread* save_thread;
 };
 
 typedef struct FileBackend_struct FileBackend;
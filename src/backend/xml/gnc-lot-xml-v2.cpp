@@ -73,6 +73,20 @@ gnc_lot_dom_tree_create (GNCLot* lot)
     return ret;
 }
 
+/* The streaming version of gnc_lot_dom_tree_create(); keep them in step. */
+void
+gnc_lot_to_xml_stream (GncXmlStreamWriter& writer, GNCLot* lot)
+{
+    writer.start_element (gnc_lot_string);
+    writer.add_attribute ("version", lot_version_string);
+
+    guid_to_xml_stream (writer, lot_id_string, gnc_lot_get_guid (lot));
+    qof_instance_slots_to_xml_stream (writer, lot_slots_string,
+                                      QOF_INSTANCE (lot));
+
+    writer.end_element (gnc_lot_string);
+}
+
 /* =================================================================== */
 
 struct lot_pdata
@@ -186,7 +200,7 @@ dom_tree_to_lot (xmlNodePtr node, QofBook* book)
 sixtp*
 gnc_lot_sixtp_parser_create (void)
 {
-    return sixtp_dom_parser_new (gnc_lot_end_handler, NULL, NULL);
+    return sixtp_dom_slots_parser_new (gnc_lot_end_handler, NULL, NULL);
 }
 
 /* ================== END OF FILE ========================== */
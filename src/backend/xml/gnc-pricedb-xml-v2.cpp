@@ -508,6 +508,12 @@ gnc_pricedb_to_dom_tree (const xmlChar* tag, GNCPriceDB* db)
     return db_xml;
 }
 
+xmlNodePtr
+gnc_price_dom_tree_create (GNCPrice* price)
+{
+    return gnc_price_to_dom_tree (BAD_CAST "price", price);
+}
+
 xmlNodePtr
 gnc_pricedb_dom_tree_create (GNCPriceDB* db)
 {
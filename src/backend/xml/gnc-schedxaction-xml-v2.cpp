@@ -936,6 +936,6 @@ gnc_template_transaction_end_handler (gpointer data_for_children,
 sixtp*
 gnc_template_transaction_sixtp_parser_create (void)
 {
-    return sixtp_dom_parser_new (gnc_template_transaction_end_handler,
-                                 NULL, NULL);
+    return sixtp_dom_slots_parser_new (gnc_template_transaction_end_handler,
+                                       NULL, NULL);
 }
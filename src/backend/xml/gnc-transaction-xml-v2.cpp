@@ -194,6 +194,88 @@ gnc_transaction_dom_tree_create (Transaction* trn)
     return ret;
 }
 
+/* The streaming versions of split_to_dom_tree() and
+ * gnc_transaction_dom_tree_create(); keep them in step. */
+static void
+split_to_xml_stream (GncXmlStreamWriter& writer, const gchar* tag, Split* spl)
+{
+    writer.start_element (tag);
+
+    guid_to_xml_stream (writer, "split:id", xaccSplitGetGUID (spl));
+
+    auto memo = xaccSplitGetMemo (spl);
+    if (memo && g_strcmp0 (memo, "") != 0)
+        writer.text_element ("split:memo", memo);
+
+    auto action = xaccSplitGetAction (spl);
+    if (action && g_strcmp0 (action, "") != 0)
+        writer.text_element ("split:action", action);
+
+    char tmp[2];
+    tmp[0] = xaccSplitGetReconcile (spl);
+    tmp[1] = '\0';
+    writer.text_element ("split:reconciled-state", tmp);
+
+    auto tms = xaccSplitRetDateReconciledTS (spl);
+    if (!((tms.tv_sec == 0) && (tms.tv_nsec == 0)))
+        timespec_to_xml_stream (writer, "split:reconcile-date", &tms);
+
+    auto num = xaccSplitGetValue (spl);
+    gnc_numeric_to_xml_stream (writer, "split:value", &num);
+
+    num = xaccSplitGetAmount (spl);
+    gnc_numeric_to_xml_stream (writer, "split:quantity", &num);
+
+    guid_to_xml_stream (writer, "split:account",
+                        xaccAccountGetGUID (xaccSplitGetAccount (spl)));
+
+    auto lot = xaccSplitGetLot (spl);
+    if (lot)
+        guid_to_xml_stream (writer, "split:lot", gnc_lot_get_guid (lot));
+
+    qof_instance_slots_to_xml_stream (writer, "split:slots",
+                                      QOF_INSTANCE (spl));
+    writer.end_element (tag);
+}
+
+void
+gnc_transaction_to_xml_stream (GncXmlStreamWriter& writer, Transaction* trn)
+{
+    writer.start_element ("gnc:transaction");
+    writer.add_attribute ("version", transaction_version_string);
+
+    guid_to_xml_stream (writer, "trn:id", xaccTransGetGUID (trn));
+
+    commodity_ref_to_xml_stream (writer, "trn:currency",
+                                 xaccTransGetCurrency (trn));
+
+    auto str = xaccTransGetNum (trn);
+    if (str && (g_strcmp0 (str, "") != 0))
+        writer.text_element ("trn:num", str);
+
+    auto tms = xaccTransRetDatePostedTS (trn);
+    timespec_to_xml_stream (writer, "trn:date-posted", &tms);
+
+    tms = xaccTransRetDateEnteredTS (trn);
+    timespec_to_xml_stream (writer, "trn:date-entered", &tms);
+
+    str = xaccTransGetDescription (trn);
+    if (str)
+        writer.text_element ("trn:description", str);
+
+    qof_instance_slots_to_xml_stream (writer, "trn:slots", QOF_INSTANCE (trn));
+
+    writer.start_element ("trn:splits");
+    for (auto n = xaccTransGetSplitList (trn); n; n = n->next)
+    {
+        Split* s = static_cast<decltype (s)> (n->data);
+        split_to_xml_stream (writer, "trn:split", s);
+    }
+    writer.end_element ("trn:splits");
+
+    writer.end_element ("gnc:transaction");
+}
+
 /***********************************************************************/
 
 struct split_pdata
@@ -645,5 +727,5 @@ dom_tree_to_transaction (xmlNodePtr node, QofBook* book)
 sixtp*
 gnc_transaction_sixtp_parser_create (void)
 {
-    return sixtp_dom_parser_new (gnc_transaction_end_handler, NULL, NULL);
+    return sixtp_dom_slots_parser_new (gnc_transaction_end_handler, NULL, NULL);
 }
@@ -36,8 +36,14 @@ extern "C"
 #include "gnc-xml-helper.h"
 #include "sixtp.h"
 
+class GncXmlStreamWriter;
+
 xmlNodePtr gnc_account_dom_tree_create (Account* act, gboolean exporting,
                                         gboolean allow_incompat);
+/** Writes the same XML as xmlElemDump() of gnc_account_dom_tree_create()
+ *  without building the tree. */
+void gnc_account_to_xml_stream (GncXmlStreamWriter& writer, Account* act,
+                                gboolean exporting, gboolean allow_incompat);
 sixtp* gnc_account_sixtp_parser_create (void);
 
 xmlNodePtr gnc_book_dom_tree_create (QofBook* book);
@@ -51,9 +57,13 @@ sixtp* gnc_commodity_sixtp_parser_create (void);
 sixtp* gnc_freqSpec_sixtp_parser_create (void);
 
 xmlNodePtr gnc_lot_dom_tree_create (GNCLot*);
+/** As gnc_lot_dom_tree_create(), written straight to @a writer. */
+void gnc_lot_to_xml_stream (GncXmlStreamWriter& writer, GNCLot* lot);
 sixtp* gnc_lot_sixtp_parser_create (void);
 
 xmlNodePtr gnc_pricedb_dom_tree_create (GNCPriceDB* db);
+/** The <price> element of one price, as in gnc_pricedb_dom_tree_create(). */
+xmlNodePtr gnc_price_dom_tree_create (GNCPrice* price);
 sixtp* gnc_pricedb_sixtp_parser_create (void);
 
 xmlNodePtr gnc_schedXaction_dom_tree_create (SchedXaction* sx);
@@ -63,6 +73,10 @@ xmlNodePtr gnc_budget_dom_tree_create (GncBudget* bgt);
 sixtp* gnc_budget_sixtp_parser_create (void);
 
 xmlNodePtr gnc_transaction_dom_tree_create (Transaction* txn);
+/** Writes the same XML as xmlElemDump() of
+ *  gnc_transaction_dom_tree_create() without building the tree. */
+void gnc_transaction_to_xml_stream (GncXmlStreamWriter& writer,
+                                    Transaction* txn);
 sixtp* gnc_transaction_sixtp_parser_create (void);
 
 sixtp* gnc_template_transaction_sixtp_parser_create (void);
@@ -372,6 +372,99 @@ gnc_read_example_account (const gchar* filename)
     return gea;
 }
 
+/* Stands in for the gnc:account parser when only the description of a
+ * template is wanted: the account's DOM tree is dropped unconverted,
+ * so no engine objects are made. */
+static gboolean
+gnc_skip_account_end_handler (gpointer data_for_children,
+                              GSList* data_from_children, GSList* sibling_data,
+                              gpointer parent_data, gpointer global_data,
+                              gpointer* result, const gchar* tag)
+{
+    if (parent_data || !tag)
+        return TRUE;
+
+    xmlFreeNode ((xmlNodePtr)data_for_children);
+    return TRUE;
+}
+
+GncExampleAccount*
+gnc_read_example_account_header (const gchar* filename)
+{
+    GncExampleAccount* gea;
+    sixtp* top_parser;
+    sixtp* main_parser;
+
+    g_return_val_if_fail (filename != NULL, NULL);
+
+    gea = g_new0 (GncExampleAccount, 1);
+    gea->filename = g_strdup (filename);
+
+    top_parser = sixtp_new ();
+    main_parser = sixtp_new ();
+
+    if (!sixtp_add_some_sub_parsers (
+            top_parser, TRUE,
+            GNC_ACCOUNT_STRING, main_parser,
+            NULL, NULL))
+    {
+        gnc_destroy_example_account (gea);
+        return NULL;
+    }
+
+    /* A few templates put their description after the accounts, so the
+     * whole file is read anyway. */
+    if (!sixtp_add_some_sub_parsers (
+            main_parser, TRUE,
+            GNC_ACCOUNT_TITLE, gnc_titse_sixtp_parser_create (),
+            GNC_ACCOUNT_SHORT, gnc_short_descrip_sixtp_parser_create (),
+            GNC_ACCOUNT_LONG, gnc_long_descrip_sixtp_parser_create (),
+            GNC_ACCOUNT_EXCLUDEP, gnc_excludep_sixtp_parser_create (),
+            GNC_ACCOUNT_SELECTED, gnc_selected_sixtp_parser_create (),
+            "gnc:account",
+            sixtp_dom_parser_new (gnc_skip_account_end_handler, NULL, NULL),
+            NULL, NULL))
+    {
+        sixtp_destroy (top_parser);
+        gnc_destroy_example_account (gea);
+        return NULL;
+    }
+
+    if (!gnc_xml_parse_file (top_parser, filename,
+                             generic_callback, gea, NULL))
+    {
+        sixtp_destroy (top_parser);
+        gnc_destroy_example_account (gea);
+        return NULL;
+    }
+
+    sixtp_destroy (top_parser);
+    return gea;
+}
+
+gboolean
+gnc_example_account_load_accounts (GncExampleAccount* gea)
+{
+    GncExampleAccount* full;
+
+    g_return_val_if_fail (gea != NULL, FALSE);
+
+    if (gea->root)
+        return TRUE;
+
+    full = gnc_read_example_account (gea->filename);
+    if (full == NULL)
+        return FALSE;
+
+    gea->book = full->book;
+    gea->root = full->root;
+    full->book = NULL;
+    full->root = NULL;
+    gnc_destroy_example_account (full);
+
+    return gea->root != NULL;
+}
+
 static void
 write_string_part (FILE* out, const char* tag, const char* data)
 {
@@ -505,6 +598,87 @@ gnc_load_example_account_list (const char* dirname)
 
 
 
+GSList*
+gnc_load_example_account_headers (const char* dirname)
+{
+    GSList* ret = NULL;
+    GDir* dir;
+    const gchar* direntry;
+
+    dir = g_dir_open (dirname, 0, NULL);
+
+    if (dir == NULL)
+    {
+        return NULL;
+    }
+
+    for (direntry = g_dir_read_name (dir); direntry != NULL;
+         direntry = g_dir_read_name (dir))
+    {
+        gchar* filename;
+        GncExampleAccount* gea;
+        if (!g_str_has_suffix (direntry, "xea"))
+            continue;
+
+        filename = g_build_filename (dirname, direntry, (gchar*) NULL);
+
+        if (!g_file_test (filename, G_FILE_TEST_IS_DIR))
+        {
+            gea = gnc_read_example_account_header (filename);
+
+            if (gea == NULL)
+            {
+                g_free (filename);
+                gnc_free_example_account_list (ret);
+                g_dir_close (dir);
+                return NULL;
+            }
+
+            ret = g_slist_prepend (ret, gea);
+        }
+
+        g_free (filename);
+    }
+    g_dir_close (dir);
+
+    return g_slist_reverse (ret);
+}
+
+/* dirname -> GSList of GncExampleAccount, read by
+ * gnc_load_example_account_headers. */
+static GHashTable* example_account_index = NULL;
+
+const GSList*
+gnc_get_example_account_index (const char* dirname)
+{
+    GSList* list;
+
+    g_return_val_if_fail (dirname != NULL, NULL);
+
+    if (!example_account_index)
+        example_account_index =
+            g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                   (GDestroyNotify)gnc_free_example_account_list);
+
+    if (g_hash_table_lookup_extended (example_account_index, dirname,
+                                      NULL, (gpointer*)&list))
+        return list;
+
+    list = gnc_load_example_account_headers (dirname);
+    if (list)
+        g_hash_table_insert (example_account_index, g_strdup (dirname), list);
+    return list;
+}
+
+void
+gnc_clear_example_account_index (void)
+{
+    if (!example_account_index)
+        return;
+    g_hash_table_destroy (example_account_index);
+    example_account_index = NULL;
+}
+
 /***********************************************************************/
 /*
 gboolean
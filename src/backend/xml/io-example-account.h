@@ -51,9 +51,31 @@ gboolean gnc_write_example_account (GncExampleAccount* gea,
                                     const gchar* filename);
 GncExampleAccount* gnc_read_example_account (const gchar* filename);
 
+/** Read only the title, descriptions and flags of the template in
+ * filename; book and root stay NULL until
+ * gnc_example_account_load_accounts() fills them in. */
+GncExampleAccount* gnc_read_example_account_header (const gchar* filename);
+
+/** Read the accounts of a template returned by
+ * gnc_read_example_account_header(), if that hasn't been done yet.
+ * Returns FALSE if the file can't be read. */
+gboolean gnc_example_account_load_accounts (GncExampleAccount* gea);
+
 
 void gnc_free_example_account_list (GSList* list);
 GSList* gnc_load_example_account_list (const char* dirname);
+
+/** Like gnc_load_example_account_list(), but reads only the headers. */
+GSList* gnc_load_example_account_headers (const char* dirname);
+
+/** The headers of the templates in dirname, read the first time a
+ * directory is asked for and kept until
+ * gnc_clear_example_account_index().  The list and its templates
+ * belong to the index; accounts loaded into them with
+ * gnc_example_account_load_accounts() are kept as well.  Templates
+ * added to the directory later aren't seen. */
+const GSList* gnc_get_example_account_index (const char* dirname);
+void gnc_clear_example_account_index (void);
 #ifdef __cplusplus
 }
 #endif
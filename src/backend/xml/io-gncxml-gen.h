@@ -53,4 +53,9 @@ gnc_xml_parse_fd (sixtp* top_parser, FILE* fd,
                   gxpf_callback callback, gpointer parsedata,
                   gpointer bookdata);
 
+gboolean
+gnc_xml_parse_buffer (sixtp* top_parser, const char* bufp, int bufsz,
+                      gxpf_callback callback, gpointer parsedata,
+                      gpointer bookdata);
+
 #endif /* IO_GNCXML_GEN_H */
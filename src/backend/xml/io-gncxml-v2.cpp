@@ -39,6 +39,7 @@ extern "C"
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <string.h>
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
@@ -54,6 +55,7 @@ extern "C"
 #include "Transaction.h"
 #include "TransactionP.h"
 #include "TransLog.h"
+#include "gnc-prefs.h"
 #if PLATFORM(WINDOWS)
 #ifdef __STRICT_ANSI_UNSET__
 #undef __STRICT_ANSI_UNSET__
@@ -66,10 +68,14 @@ extern "C"
 #endif
 }
 
+#include <algorithm>
+#include <deque>
+
 #include "sixtp-parsers.h"
 #include "sixtp-utils.h"
 #include "gnc-xml.h"
 #include "io-utils.h"
+#include "sixtp-dom-generators.h"
 #include "sixtp-dom-parsers.h"
 #include "io-gncxml-v2.h"
 #include "io-gncxml-gen.h"
@@ -94,6 +100,8 @@ typedef struct
     gchar* filename;
     gchar* perms;
     gboolean compress;
+    gint level;
+    gint threads;
 } gz_thread_params_t;
 
 /* Callback structure */
@@ -105,6 +113,7 @@ struct file_backend
     const char*     tag;
     sixtp*          parser;
     FILE*           out;
+    GncXmlStreamWriter* writer;
     QofBook*        book;
 };
 
@@ -127,6 +136,7 @@ static FILE* try_gz_open (const char* filename, const char* perms,
                           gboolean compress);
 static gboolean is_gzipped_file (const gchar* name);
 static gboolean wait_for_gzip (FILE* file);
+static gint gz_compression_threads (gint threads);
 
 static void
 clear_up_account_commodity (
@@ -696,7 +706,9 @@ qof_session_load_from_xml_file_v2_full (
     sixtp_push_handler push_handler, gpointer push_user_data,
     QofBookFileType type)
 {
+    QOF_TRACE_SCOPE ("qof_session_load_from_xml_file_v2");
     Account* root;
+    time64 since;
     QofBackend* be = &fbe->be;
     sixtp_gdv2* gd;
     sixtp* top_parser;
@@ -794,10 +806,24 @@ qof_session_load_from_xml_file_v2_full (
          * info.
          */
         gchar* filename = fbe->fullpath;
-        FILE* file;
+        FILE* file = NULL;
+        GMappedFile* mapped = NULL;
         gboolean is_compressed = is_gzipped_file (filename);
-        file = try_gz_open (filename, "r", is_compressed, FALSE);
-        if (file == NULL)
+
+        /* Parse uncompressed files straight out of a mapping, sparing
+         * the pipe and libxml2's copy of the whole book. */
+        if (!is_compressed && !strstr (filename, ".gz."))
+            mapped = g_mapped_file_new (filename, FALSE, NULL);
+        if (mapped && g_mapped_file_get_length (mapped) > 0 &&
+            g_mapped_file_get_length (mapped) <= G_MAXINT)
+        {
+            retval = gnc_xml_parse_buffer (top_parser,
+                                           g_mapped_file_get_contents (mapped),
+                                           g_mapped_file_get_length (mapped),
+                                           generic_callback, gd, book);
+        }
+        else if ((file = try_gz_open (filename, "r", is_compressed,
+                                      FALSE)) == NULL)
         {
             PWARN ("Unable to open file %s", filename);
             retval = FALSE;
@@ -810,6 +836,8 @@ qof_session_load_from_xml_file_v2_full (
             if (is_compressed)
                 wait_for_gzip (file);
         }
+        if (mapped)
+            g_mapped_file_unref (mapped);
     }
 
     if (!retval)
@@ -840,11 +868,16 @@ qof_session_load_from_xml_file_v2_full (
     root = gnc_book_get_root_account (book);
     xaccAccountTreeScrubQuoteSources (root, gnc_commodity_table_get_table (book));
 
+    /* The transactions before the auto-read-only threshold were
+     * scrubbed by an earlier load and can't have changed since. */
+    since = xaccBookScrubSkipBefore (book);
+
     /* Fix account and transaction commodities */
-    xaccAccountTreeScrubCommodities (root);
+    xaccAccountTreeScrubCommoditiesSince (root, since);
 
     /* Fix split amount/value */
-    xaccAccountTreeScrubSplits (root);
+    xaccAccountTreeScrubSplitsSince (root, since);
+    xaccBookMarkScrubbed (book);
 
     /* commit all groups, this completes the BeginEdit started when the
      * account_end_handler finished reading the account.
@@ -870,6 +903,522 @@ qof_session_load_from_xml_file_v2 (FileBackend* fbe, QofBook* book,
     return qof_session_load_from_xml_file_v2_full (fbe, book, NULL, NULL, type);
 }
 
+/***********************************************************************/
+/* Snapshots: an uncompressed copy of a compressed data file, written
+ * beside it at save time and stamped with the SHA-1 of the file it
+ * mirrors.  Reopening the book from a current snapshot spares the
+ * decompression; the data file stays the authoritative copy.
+ */
+#define GNC_SNAPSHOT_EXT ".snap"
+#define GNC_SNAPSHOT_MAGIC "gnc-snapshot-1 "
+#define GNC_SNAPSHOT_CHUNK (1024 * 1024)
+
+static gchar*
+snapshot_file_name (const char* datafile)
+{
+    return g_strconcat (datafile, GNC_SNAPSHOT_EXT, NULL);
+}
+
+static gchar*
+snapshot_data_file_digest (const char* datafile)
+{
+    GMappedFile* mapped = g_mapped_file_new (datafile, FALSE, NULL);
+    gchar* digest = NULL;
+
+    if (!mapped)
+        return NULL;
+    if (g_mapped_file_get_length (mapped) > 0)
+        digest = g_compute_checksum_for_data (
+                     G_CHECKSUM_SHA1,
+                     (const guchar*) g_mapped_file_get_contents (mapped),
+                     g_mapped_file_get_length (mapped));
+    g_mapped_file_unref (mapped);
+    return digest;
+}
+
+gboolean
+gnc_book_write_snapshot_v2 (QofBook* book, const char* datafile)
+{
+    gchar* digest = snapshot_data_file_digest (datafile);
+    gchar* snapname = snapshot_file_name (datafile);
+    gchar* tmp_name = g_strconcat (snapname, ".tmp", NULL);
+    gboolean success = FALSE;
+    FILE* out;
+
+    if (digest && (out = g_fopen (tmp_name, "wb")) != NULL)
+    {
+        success = fprintf (out, GNC_SNAPSHOT_MAGIC "%s\n", digest) > 0 &&
+                  gnc_book_write_to_xml_filehandle_v2 (book, out);
+        if (fclose (out) != 0)
+            success = FALSE;
+        /* g_rename doesn't replace an existing file on Windows */
+        if (success)
+        {
+            g_unlink (snapname);
+            success = g_rename (tmp_name, snapname) == 0;
+        }
+        if (!success)
+            g_unlink (tmp_name);
+    }
+    if (!success)
+        PWARN ("Could not write the snapshot %s", snapname);
+
+    g_free (tmp_name);
+    g_free (snapname);
+    g_free (digest);
+    return success;
+}
+
+gboolean
+gnc_xml2_write_snapshot_from_file (const char* xmlfile, const char* datafile)
+{
+    gchar* digest = snapshot_data_file_digest (datafile);
+    gchar* snapname = snapshot_file_name (datafile);
+    gchar* tmp_name = g_strconcat (snapname, ".tmp", NULL);
+    gboolean success = FALSE;
+    FILE* in = NULL;
+    FILE* out;
+
+    if (digest && (in = g_fopen (xmlfile, "rb")) != NULL &&
+        (out = g_fopen (tmp_name, "wb")) != NULL)
+    {
+        gchar* buf = static_cast<gchar*> (g_malloc (GNC_SNAPSHOT_CHUNK));
+        size_t bytes;
+
+        success = fprintf (out, GNC_SNAPSHOT_MAGIC "%s\n", digest) > 0;
+        while (success && (bytes = fread (buf, 1, GNC_SNAPSHOT_CHUNK, in)) > 0)
+            success = fwrite (buf, 1, bytes, out) == bytes;
+        if (ferror (in))
+            success = FALSE;
+        g_free (buf);
+        if (fclose (out) != 0)
+            success = FALSE;
+        if (success)
+        {
+            g_unlink (snapname);
+            success = g_rename (tmp_name, snapname) == 0;
+        }
+        if (!success)
+            g_unlink (tmp_name);
+    }
+    if (in)
+        fclose (in);
+    if (!success)
+        PWARN ("Could not write the snapshot %s", snapname);
+
+    g_free (tmp_name);
+    g_free (snapname);
+    g_free (digest);
+    return success;
+}
+
+void
+gnc_xml2_remove_snapshot (const char* datafile)
+{
+    gchar* snapname = snapshot_file_name (datafile);
+    g_unlink (snapname);
+    g_free (snapname);
+}
+
+gboolean
+gnc_xml2_snapshot_is_current (const char* datafile)
+{
+    gchar* snapname = snapshot_file_name (datafile);
+    gchar line[64];
+    gchar* digest;
+    gboolean current = FALSE;
+    FILE* snap = g_fopen (snapname, "rb");
+
+    g_free (snapname);
+    if (!snap)
+        return FALSE;
+    if (fgets (line, sizeof (line), snap) &&
+        g_str_has_prefix (line, GNC_SNAPSHOT_MAGIC) &&
+        (digest = snapshot_data_file_digest (datafile)) != NULL)
+    {
+        const gchar* stamp = line + strlen (GNC_SNAPSHOT_MAGIC);
+        current = strncmp (stamp, digest, strlen (digest)) == 0 &&
+                  stamp[strlen (digest)] == '\n';
+        g_free (digest);
+    }
+    fclose (snap);
+    return current;
+}
+
+static void
+snapshot_push_handler (xmlParserCtxtPtr xml_context, const gchar* snapname)
+{
+    GMappedFile* mapped = g_mapped_file_new (snapname, FALSE, NULL);
+    const gchar* data;
+    const gchar* end;
+
+    if (!mapped)
+    {
+        PWARN ("Unable to open snapshot %s", snapname);
+        return;
+    }
+    data = g_mapped_file_get_contents (mapped);
+    end = data + g_mapped_file_get_length (mapped);
+
+    /* skip the stamp */
+    data = data ? static_cast<const gchar*> (memchr (data, '\n', end - data)) : NULL;
+    if (data)
+    {
+        for (++data; data < end; data += GNC_SNAPSHOT_CHUNK)
+        {
+            int len = MIN (end - data, GNC_SNAPSHOT_CHUNK);
+            if (xmlParseChunk (xml_context, data, len, 0) != 0)
+                break;
+        }
+        xmlParseChunk (xml_context, "", 0, 1);
+    }
+    g_mapped_file_unref (mapped);
+}
+
+gboolean
+qof_session_load_from_xml_snapshot_v2 (FileBackend* fbe, QofBook* book)
+{
+    gchar* snapname = snapshot_file_name (fbe->fullpath);
+    gboolean success;
+
+    success = qof_session_load_from_xml_file_v2_full (
+                  fbe, book, (sixtp_push_handler) snapshot_push_handler,
+                  snapname, GNC_BOOK_XML2_FILE);
+    g_free (snapname);
+    return success;
+}
+
+/***********************************************************************/
+/* The journal: transactions committed since the last full save,
+ * appended to <file>.journal by journaled saves and replayed on top of
+ * the data file when it is loaded.  The journal is stamped with the size
+ * and modification time of the data file it applies to, so a full save
+ * silently invalidates it.  Each save appends one batch, an XML document
+ * preceded by its length, which first removes every journaled
+ * transaction and then adds back the ones still in the book.
+ */
+#define GNC_JOURNAL_EXT ".journal"
+#define GNC_JOURNAL_MAGIC "gnc-journal-1"
+#define GNC_JOURNAL_BATCH "gnc-journal-batch"
+static const char* JOURNAL_TAG = "gnc-journal";
+static const char* JOURNAL_REMOVE_TAG = "journal:remove";
+
+static gchar*
+journal_file_name (const char* datafile)
+{
+    return g_strconcat (datafile, GNC_JOURNAL_EXT, NULL);
+}
+
+static gchar*
+journal_stamp (const char* datafile)
+{
+    struct stat statbuf;
+
+    if (g_stat (datafile, &statbuf) != 0)
+        return NULL;
+    return g_strdup_printf (GNC_JOURNAL_MAGIC " %" G_GINT64_FORMAT
+                            " %" G_GINT64_FORMAT "\n",
+                            (gint64) statbuf.st_size,
+                            (gint64) statbuf.st_mtime);
+}
+
+/* Opens the journal of datafile for appending, starting it afresh if it
+ * belongs to another version of the data file. */
+static FILE*
+journal_open (const char* datafile)
+{
+    gchar* name = journal_file_name (datafile);
+    gchar* stamp = journal_stamp (datafile);
+    gchar line[128];
+    FILE* journal = NULL;
+
+    if (stamp)
+    {
+        journal = g_fopen (name, "r+b");
+        if (journal && !(fgets (line, sizeof (line), journal) &&
+                         strcmp (line, stamp) == 0))
+        {
+            fclose (journal);
+            journal = NULL;
+        }
+        if (!journal && (journal = g_fopen (name, "w+b")) != NULL &&
+            fputs (stamp, journal) < 0)
+        {
+            fclose (journal);
+            journal = NULL;
+        }
+        if (journal && fseek (journal, 0, SEEK_END) != 0)
+        {
+            fclose (journal);
+            journal = NULL;
+        }
+    }
+    g_free (stamp);
+    g_free (name);
+    return journal;
+}
+
+void
+gnc_xml2_journal_note_commit (FileBackend* fbe, QofInstance* inst)
+{
+    Transaction* trans = NULL;
+    Split* split;
+    Account* acct;
+
+    if (fbe->journal_needs_full_save)
+        return;
+
+    if (GNC_IS_TRANSACTION (inst))
+        trans = GNC_TRANSACTION (inst);
+    else if (GNC_IS_SPLIT (inst))
+        /* A split leaving its transaction is written out with it. */
+        trans = xaccSplitGetParent (GNC_SPLIT (inst));
+    else
+    {
+        /* Only transactions are journaled. */
+        fbe->journal_needs_full_save = TRUE;
+        return;
+    }
+    if (!trans)
+        return;
+
+    /* Template transactions are saved with their scheduled transactions. */
+    split = xaccTransGetSplit (trans, 0);
+    acct = split ? xaccSplitGetAccount (split) : NULL;
+    if (acct && gnc_account_get_root (acct) ==
+        gnc_book_get_template_root (qof_instance_get_book (inst)))
+    {
+        fbe->journal_needs_full_save = TRUE;
+        return;
+    }
+
+    if (!fbe->journal)
+        fbe->journal = g_hash_table_new_full (guid_hash_to_guint,
+                                              guid_g_hash_table_equal,
+                                              (GDestroyNotify) guid_free,
+                                              NULL);
+    g_hash_table_insert (fbe->journal,
+                         guid_copy (qof_instance_get_guid (QOF_INSTANCE (trans))),
+                         NULL);
+}
+
+gboolean
+gnc_xml2_journal_append (FileBackend* fbe, QofBook* book)
+{
+    GHashTableIter iter;
+    gpointer key;
+    long start, data_start, end;
+    gboolean success;
+    FILE* journal;
+
+    if (fbe->journal_needs_full_save)
+        return FALSE;
+    if (!fbe->journal || g_hash_table_size (fbe->journal) == 0)
+        return TRUE;
+    if ((journal = journal_open (fbe->fullpath)) == NULL)
+        return FALSE;
+
+    /* The length is filled in once the batch is complete; a batch left
+     * with a zero length by a crash is ignored on replay. */
+    start = ftell (journal);
+    success = fprintf (journal, GNC_JOURNAL_BATCH " %010ld\n", 0L) > 0;
+    data_start = ftell (journal);
+    {
+        GncXmlStreamWriter writer (journal);
+
+        writer.start_element (JOURNAL_TAG);
+        g_hash_table_iter_init (&iter, fbe->journal);
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+            guid_to_xml_stream (writer, JOURNAL_REMOVE_TAG,
+                                static_cast<GncGUID*> (key));
+        g_hash_table_iter_init (&iter, fbe->journal);
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+            Transaction* trans = xaccTransLookup (static_cast<GncGUID*> (key),
+                                                  book);
+            if (trans)
+                gnc_transaction_to_xml_stream (writer, trans);
+        }
+        writer.end_element (JOURNAL_TAG);
+        writer.append ("\n");
+        success = writer.flush () && success;
+    }
+    end = ftell (journal);
+    success = success && start >= 0 && data_start >= 0 && end >= 0 &&
+              fseek (journal, start, SEEK_SET) == 0 &&
+              fprintf (journal, GNC_JOURNAL_BATCH " %010ld\n",
+                       end - data_start) > 0;
+    if (fclose (journal) != 0)
+        success = FALSE;
+
+    if (success)
+        g_hash_table_remove_all (fbe->journal);
+    else
+        PWARN ("Could not append to the journal of %s", fbe->fullpath);
+    return success;
+}
+
+gint64
+gnc_xml2_journal_size (const char* datafile)
+{
+    gchar* name = journal_file_name (datafile);
+    struct stat statbuf;
+    gint64 size = -1;
+
+    if (g_stat (name, &statbuf) == 0)
+        size = statbuf.st_size;
+    g_free (name);
+    return size;
+}
+
+void
+gnc_xml2_journal_remove (const char* datafile)
+{
+    gchar* name = journal_file_name (datafile);
+
+    g_unlink (name);
+    g_free (name);
+}
+
+void
+gnc_xml2_journal_reset (FileBackend* fbe)
+{
+    gnc_xml2_journal_remove (fbe->fullpath);
+    if (fbe->journal)
+        g_hash_table_remove_all (fbe->journal);
+    fbe->journal_needs_full_save = FALSE;
+}
+
+static gboolean
+journal_remove_end_handler (gpointer data_for_children,
+                            GSList* data_from_children, GSList* sibling_data,
+                            gpointer parent_data, gpointer global_data,
+                            gpointer* result, const gchar* tag)
+{
+    xmlNodePtr tree = (xmlNodePtr)data_for_children;
+    gxpf_data* gdata = (gxpf_data*)global_data;
+    GncGUID* guid;
+
+    if (parent_data)
+        return TRUE;
+    if (!tag)
+        return TRUE;
+    g_return_val_if_fail (tree, FALSE);
+
+    guid = dom_tree_to_guid (tree);
+    if (guid)
+    {
+        gdata->cb (tag, gdata->parsedata, guid);
+        guid_free (guid);
+    }
+    xmlFreeNode (tree);
+    return guid != NULL;
+}
+
+static gboolean
+journal_replay_callback (const char* tag, gpointer parsedata, gpointer data)
+{
+    QofBook* book = static_cast<QofBook*> (parsedata);
+
+    if (g_strcmp0 (tag, JOURNAL_REMOVE_TAG) == 0)
+    {
+        Transaction* trans = xaccTransLookup (static_cast<GncGUID*> (data), book);
+        if (trans)
+        {
+            xaccTransBeginEdit (trans);
+            xaccTransClearReadOnly (trans);
+            xaccTransDestroy (trans);
+            xaccTransCommitEdit (trans);
+        }
+    }
+    else if (g_strcmp0 (tag, TRANSACTION_TAG) == 0)
+    {
+        Transaction* trans = static_cast<Transaction*> (data);
+        xaccTransBeginEdit (trans);
+        clear_up_transaction_commodity (gnc_commodity_table_get_table (book),
+                                        trans, xaccTransGetCurrency,
+                                        xaccTransSetCurrency);
+        xaccTransScrubCurrency (trans);
+        xaccTransScrubPostedDate (trans);
+        xaccTransCommitEdit (trans);
+    }
+    return TRUE;
+}
+
+gboolean
+gnc_xml2_journal_replay (FileBackend* fbe, QofBook* book)
+{
+    gchar* name = journal_file_name (fbe->fullpath);
+    gchar* stamp = journal_stamp (fbe->fullpath);
+    GMappedFile* mapped = g_mapped_file_new (name, FALSE, NULL);
+    gboolean success = TRUE;
+    const gchar* data;
+    const gchar* end;
+    sixtp* top_parser;
+    sixtp* journal_parser;
+
+    g_free (name);
+    if (!mapped || !stamp || g_mapped_file_get_length (mapped) < strlen (stamp) ||
+        strncmp (g_mapped_file_get_contents (mapped), stamp, strlen (stamp)) != 0)
+    {
+        /* no journal, or one for another version of the file */
+        if (mapped)
+            g_mapped_file_unref (mapped);
+        g_free (stamp);
+        return TRUE;
+    }
+    data = g_mapped_file_get_contents (mapped) + strlen (stamp);
+    end = g_mapped_file_get_contents (mapped) + g_mapped_file_get_length (mapped);
+    g_free (stamp);
+
+    top_parser = sixtp_new ();
+    journal_parser = sixtp_new ();
+    if (!sixtp_add_some_sub_parsers (
+            top_parser, TRUE,
+            JOURNAL_TAG, journal_parser,
+            NULL, NULL) ||
+        !sixtp_add_some_sub_parsers (
+            journal_parser, TRUE,
+            JOURNAL_REMOVE_TAG, sixtp_dom_parser_new (journal_remove_end_handler,
+                                                      NULL, NULL),
+            TRANSACTION_TAG, gnc_transaction_sixtp_parser_create (),
+            NULL, NULL))
+    {
+        sixtp_destroy (top_parser);
+        g_mapped_file_unref (mapped);
+        return FALSE;
+    }
+
+    xaccLogDisable ();
+    xaccDisableDataScrubbing ();
+    while (success && data < end)
+    {
+        const gsize header_len = strlen (GNC_JOURNAL_BATCH " 0000000000\n");
+        gchar* endptr;
+        gint64 len;
+
+        if ((gsize) (end - data) < header_len ||
+            strncmp (data, GNC_JOURNAL_BATCH " ", strlen (GNC_JOURNAL_BATCH " ")) != 0)
+            break;
+        len = g_ascii_strtoll (data + strlen (GNC_JOURNAL_BATCH " "), &endptr, 10);
+        data += header_len;
+        /* an unfinished batch ends the journal */
+        if (len <= 0 || len > end - data || len > G_MAXINT)
+            break;
+        success = gnc_xml_parse_buffer (top_parser, data, len,
+                                        journal_replay_callback, book, book);
+        data += len;
+    }
+    xaccEnableDataScrubbing ();
+    xaccLogEnable ();
+
+    sixtp_destroy (top_parser);
+    g_mapped_file_unref (mapped);
+    if (!success)
+        PWARN ("Could not replay the journal of %s", fbe->fullpath);
+    return success;
+}
+
 /***********************************************************************/
 
 static gboolean
@@ -1046,8 +1595,8 @@ write_book (FILE* out, QofBook* book, sixtp_gdv2* gd)
 
         return FALSE;
 
-    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_BUDGET),
-                            write_budget, &be_data);
+    qof_collection_foreach_sorted (qof_book_get_collection (book, GNC_ID_BUDGET),
+                                   write_budget, &be_data);
     if (ferror (out))
         return FALSE;
 
@@ -1114,12 +1663,149 @@ write_commodities (FILE* out, QofBook* book, sixtp_gdv2* gd)
     return success;
 }
 
+/* Serializing on a thread pool: the objects of a section are cut into
+ * chunks which worker threads format into strings, and the calling thread
+ * writes the strings out in the original order, so the file is exactly
+ * what a serial save writes.  Formatting only reads the objects; anything
+ * that changes them, like marking visited transactions, stays on the
+ * calling thread.
+ */
+#define XML_WRITE_CHUNK_SIZE 256
+
+typedef void (*xml_chunk_formatter) (std::string& text, gpointer object);
+
+struct xml_write_chunk
+{
+    const gpointer* objects;
+    gsize n_objects;
+    xml_chunk_formatter format;
+    std::string text;
+    GAsyncQueue* done;
+};
+
+static void
+xml_format_chunk (gpointer data, gpointer user_data)
+{
+    auto chunk = static_cast<xml_write_chunk*> (data);
+
+    for (gsize i = 0; i < chunk->n_objects; ++i)
+        chunk->format (chunk->text, chunk->objects[i]);
+    g_async_queue_push (chunk->done, chunk);
+}
+
+/* The number of threads to serialize n_objects with, or 0 if it doesn't
+ * pay to go parallel. */
+static gint
+xml_write_threads (gsize n_objects)
+{
+    gint threads = gz_compression_threads (0);
+
+    if (threads <= 1 || n_objects < 2 * XML_WRITE_CHUNK_SIZE)
+        return 0;
+    return threads;
+}
+
+/* Writes objects formatted by format to out, counting them in *counter. */
+static gboolean
+write_objects_parallel (FILE* out, const std::vector<gpointer>& objects,
+                        xml_chunk_formatter format, gint threads,
+                        sixtp_gdv2* gd, int* counter, const char* type)
+{
+    std::deque<xml_write_chunk*> pending;
+    GThreadPool* pool;
+    gsize next = 0;
+    gboolean success = TRUE;
+
+    /* without a pool the chunks are formatted here, one at a time */
+    pool = g_thread_pool_new (xml_format_chunk, NULL, threads, FALSE, NULL);
+    if (!pool)
+        threads = 1;
+
+    while (next < objects.size () || !pending.empty ())
+    {
+        while (next < objects.size () &&
+               pending.size () < 4 * static_cast<gsize> (threads))
+        {
+            auto chunk = new xml_write_chunk;
+            chunk->objects = objects.data () + next;
+            chunk->n_objects = MIN (XML_WRITE_CHUNK_SIZE, objects.size () - next);
+            chunk->format = format;
+            chunk->done = g_async_queue_new ();
+            next += chunk->n_objects;
+            if (pool)
+                g_thread_pool_push (pool, chunk, NULL);
+            else
+                xml_format_chunk (chunk, NULL);
+            pending.push_back (chunk);
+        }
+
+        auto chunk = pending.front ();
+        pending.pop_front ();
+        g_async_queue_pop (chunk->done);
+        if (success &&
+            fwrite (chunk->text.data (), 1, chunk->text.size (), out)
+            != chunk->text.size ())
+            success = FALSE;
+        *counter += chunk->n_objects;
+        sixtp_run_callback (gd, type);
+        g_async_queue_unref (chunk->done);
+        delete chunk;
+    }
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+
+    return success && !ferror (out);
+}
+
+static void
+format_price (std::string& text, gpointer object)
+{
+    xmlNodePtr node = gnc_price_dom_tree_create (static_cast<GNCPrice*> (object));
+    xmlBufferPtr buf = xmlBufferCreate ();
+    xmlOutputBufferPtr outbuf = xmlOutputBufferCreateBuffer (buf, NULL);
+
+    /* the same layout as the serial loop in write_pricedb */
+    xmlOutputBufferWrite (outbuf, 2, "  ");
+    xmlNodeDumpOutput (outbuf, NULL, node, 1, 1, NULL);
+    xmlOutputBufferWrite (outbuf, 1, "\n");
+    xmlOutputBufferClose (outbuf);
+
+    text.append (reinterpret_cast<const char*> (xmlBufferContent (buf)),
+                 xmlBufferLength (buf));
+    xmlBufferFree (buf);
+    xmlFreeNode (node);
+}
+
+static gboolean
+collect_price (GNCPrice* p, gpointer data)
+{
+    auto prices = static_cast<std::vector<gpointer>*> (data);
+
+    /* gnc_price_dom_tree_create fails on these, failing the whole db */
+    if (!gnc_price_get_commodity (p) || !gnc_price_get_currency (p))
+        return FALSE;
+    prices->push_back (p);
+    return TRUE;
+}
+
 static gboolean
 write_pricedb (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     xmlNodePtr node;
     xmlNodePtr parent;
     xmlOutputBufferPtr outbuf;
+    std::vector<gpointer> prices;
+    gint threads;
+
+    if (gnc_pricedb_foreach_price (gnc_pricedb_get_db (book), collect_price,
+                                   &prices, TRUE) &&
+        (threads = xml_write_threads (prices.size ())) > 0)
+    {
+        return fprintf (out, "<gnc:pricedb version=\"1\">\n") >= 0
+               && write_objects_parallel (out, prices, format_price, threads, gd,
+                                          &gd->counter.prices_loaded, "prices")
+               && fprintf (out, "</gnc:pricedb>\n") >= 0;
+    }
 
     parent = gnc_pricedb_dom_tree_create (gnc_pricedb_get_db (book));
 
@@ -1174,14 +1860,11 @@ static int
 xml_add_trn_data (Transaction* t, gpointer data)
 {
     struct file_backend* be_data = static_cast<decltype (be_data)> (data);
-    xmlNodePtr node;
 
-    node = gnc_transaction_dom_tree_create (t);
-
-    xmlElemDump (be_data->out, NULL, node);
-    xmlFreeNode (node);
+    gnc_transaction_to_xml_stream (*be_data->writer, t);
+    be_data->writer->append ("\n");
 
-    if (ferror (be_data->out) || fprintf (be_data->out, "\n") < 0)
+    if (ferror (be_data->out))
         return -1;
 
     be_data->gd->counter.transactions_loaded++;
@@ -1189,17 +1872,47 @@ xml_add_trn_data (Transaction* t, gpointer data)
     return 0;
 }
 
+static void
+format_transaction (std::string& text, gpointer object)
+{
+    GncXmlStreamWriter writer;
+
+    gnc_transaction_to_xml_stream (writer, static_cast<Transaction*> (object));
+    writer.append ("\n");
+    text += writer.take ();
+}
+
+static int
+collect_transaction (Transaction* t, gpointer data)
+{
+    static_cast<std::vector<gpointer>*> (data)->push_back (t);
+    return 0;
+}
+
 static gboolean
 write_transactions (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     struct file_backend be_data;
-
+    std::vector<gpointer> transactions;
+    gint threads;
+
+    /* The walk marks the transactions it visits, so it stays here. */
+    xaccAccountTreeForEachTransaction (gnc_book_get_root_account (book),
+                                       collect_transaction, &transactions);
+    if ((threads = xml_write_threads (transactions.size ())) > 0)
+        return write_objects_parallel (out, transactions, format_transaction,
+                                       threads, gd,
+                                       &gd->counter.transactions_loaded,
+                                       "transaction");
+
+    GncXmlStreamWriter writer (out);
     be_data.out = out;
+    be_data.writer = &writer;
     be_data.gd = gd;
-    return 0 ==
-           xaccAccountTreeForEachTransaction (gnc_book_get_root_account (book),
-                                              xml_add_trn_data,
-                                              (gpointer) &be_data);
+    for (auto t : transactions)
+        if (xml_add_trn_data (static_cast<Transaction*> (t), &be_data) != 0)
+            return FALSE;
+    return writer.flush ();
 }
 
 static gboolean
@@ -1214,9 +1927,12 @@ write_template_transaction_data (FILE* out, QofBook* book, sixtp_gdv2* gd)
     ra = gnc_book_get_template_root (book);
     if (gnc_account_n_descendants (ra) > 0)
     {
+        GncXmlStreamWriter writer (out);
+        be_data.writer = &writer;
         if (fprintf (out, "<%s>\n", TEMPLATE_TRANSACTION_TAG) < 0
             || !write_account_tree (out, ra, gd)
             || xaccAccountTreeForEachTransaction (ra, xml_add_trn_data, (gpointer)&be_data)
+            || !writer.flush ()
             || fprintf (out, "</%s>\n", TEMPLATE_TRANSACTION_TAG) < 0)
 
             return FALSE;
@@ -1399,6 +2115,207 @@ gnc_book_write_accounts_to_xml_filehandle_v2 (QofBackend* be, QofBook* book,
 }
 
 #define BUFLEN 4096
+#define GZ_READ_BUFLEN (64 * 1024)
+#define GZ_BLOCK_SIZE (128 * 1024)
+#define GZ_DICT_SIZE 32768
+
+/* Parallel compression, the way pigz does it: the input is cut into
+ * blocks which are deflated independently on a thread pool, each primed
+ * with the last 32KiB of the block before it and ended with a sync flush
+ * so the raw deflate streams can simply be concatenated.  Wrapped in a
+ * single gzip header and trailer the result is an ordinary gzip file.
+ */
+struct gz_block_t
+{
+    std::vector<unsigned char> in;  /* dictionary followed by the data */
+    gsize dict_len;
+    std::vector<unsigned char> out;
+    gboolean last;
+    gint level;
+    uLong crc;
+    gboolean ok;
+    GAsyncQueue* done;
+};
+
+static void
+gz_compress_block (gpointer data, gpointer user_data)
+{
+    auto block = static_cast<gz_block_t*> (data);
+    unsigned char* input = block->in.data () + block->dict_len;
+    gsize in_len = block->in.size () - block->dict_len;
+    z_stream strm;
+    int ret;
+
+    memset (&strm, 0, sizeof (z_stream));
+    block->ok = FALSE;
+    block->crc = crc32 (crc32 (0L, Z_NULL, 0), input, in_len);
+
+    if (deflateInit2 (&strm, block->level, Z_DEFLATED, -MAX_WBITS, 8,
+                      Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        if (block->dict_len)
+            deflateSetDictionary (&strm, block->in.data (), block->dict_len);
+
+        block->out.resize (deflateBound (&strm, in_len) + 16);
+        strm.next_in = input;
+        strm.avail_in = in_len;
+        strm.next_out = block->out.data ();
+        strm.avail_out = block->out.size ();
+        do
+        {
+            if (strm.avail_out == 0)
+            {
+                gsize used = block->out.size ();
+                block->out.resize (2 * used);
+                strm.next_out = block->out.data () + used;
+                strm.avail_out = block->out.size () - used;
+            }
+            ret = deflate (&strm, block->last ? Z_FINISH : Z_SYNC_FLUSH);
+        }
+        while (ret == Z_OK && strm.avail_out == 0);
+
+        block->ok = block->last ? ret == Z_STREAM_END :
+                    (ret == Z_OK && strm.avail_in == 0);
+        block->out.resize (strm.total_out);
+        deflateEnd (&strm);
+    }
+
+    g_async_queue_push (block->done, block);
+}
+
+static void
+gz_put_le32 (unsigned char* buf, guint32 val)
+{
+    for (int i = 0; i < 4; ++i, val >>= 8)
+        buf[i] = val & 0xff;
+}
+
+/* Reads params->fd until EOF and writes it gzipped to params->filename
+ * using the given number of compression threads. */
+static gboolean
+gz_write_parallel (gz_thread_params_t* params, gint threads, gint level)
+{
+    static const unsigned char header[10] =
+    { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3 };
+    std::deque<gz_block_t*> pending;
+    std::vector<unsigned char> dict;
+    unsigned char trailer[8];
+    GThreadPool* pool;
+    GError* error = NULL;
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    guint32 isize = 0;
+    gboolean success = TRUE;
+    gboolean eof = FALSE;
+    FILE* out;
+
+    out = g_fopen (params->filename, "wb");
+    if (out == NULL)
+    {
+        g_warning ("Could not open '%s' for writing: %s", params->filename,
+                   g_strerror (errno));
+        return FALSE;
+    }
+
+    pool = g_thread_pool_new (gz_compress_block, NULL, threads, FALSE, &error);
+    if (pool == NULL)
+    {
+        g_warning ("Could not create compression threads: %s",
+                   error ? error->message : "");
+        if (error)
+            g_error_free (error);
+        fclose (out);
+        return FALSE;
+    }
+
+    if (fwrite (header, 1, sizeof (header), out) != sizeof (header))
+        success = FALSE;
+
+    while (!eof)
+    {
+        auto block = new gz_block_t;
+        gsize got = 0;
+        gssize bytes = 0;
+
+        block->in = dict;
+        block->dict_len = dict.size ();
+        block->in.resize (block->dict_len + GZ_BLOCK_SIZE);
+        block->level = level;
+        block->done = g_async_queue_new ();
+
+        while (got < GZ_BLOCK_SIZE &&
+               (bytes = read (params->fd, block->in.data () + block->dict_len + got,
+                              GZ_BLOCK_SIZE - got)) > 0)
+            got += bytes;
+        if (got < GZ_BLOCK_SIZE)
+        {
+            if (bytes < 0)
+            {
+                g_warning ("Could not read from pipe. The error is '%s' (errno %d)",
+                           g_strerror (errno) ? g_strerror (errno) : "", errno);
+                success = FALSE;
+            }
+            eof = TRUE;
+        }
+        block->in.resize (block->dict_len + got);
+        block->last = eof;
+
+        auto tail = std::min<gsize> (got, GZ_DICT_SIZE);
+        dict.assign (block->in.end () - tail, block->in.end ());
+
+        g_thread_pool_push (pool, block, NULL);
+        pending.push_back (block);
+
+        /* Write out finished blocks in order, keeping a bounded number of
+         * blocks in flight. */
+        while (!pending.empty () &&
+               (eof || pending.size () > 2 * static_cast<gsize> (threads)))
+        {
+            block = pending.front ();
+            pending.pop_front ();
+            g_async_queue_pop (block->done);
+
+            gsize len = block->in.size () - block->dict_len;
+            crc = crc32_combine (crc, block->crc, len);
+            isize += len;
+            if (success && (!block->ok ||
+                            fwrite (block->out.data (), 1, block->out.size (), out)
+                            != block->out.size ()))
+            {
+                g_warning ("Could not write the compressed file '%s'",
+                           params->filename);
+                success = FALSE;
+            }
+            g_async_queue_unref (block->done);
+            delete block;
+        }
+    }
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+    gz_put_le32 (trailer, crc);
+    gz_put_le32 (trailer + 4, isize);
+    if (fwrite (trailer, 1, sizeof (trailer), out) != sizeof (trailer))
+        success = FALSE;
+    if (fclose (out) != 0)
+    {
+        g_warning ("Could not close the compressed file '%s'", params->filename);
+        success = FALSE;
+    }
+    return success;
+}
+
+static gint
+gz_compression_threads (gint threads)
+{
+    if (threads > 0)
+        return threads;
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    return g_get_num_processors ();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1;
+#endif
+}
 
 /* Compress or decompress function that is to be run in a separate thread.
  * Returns 1 on success or 0 otherwise, stuffed into a pointer type. */
@@ -1411,6 +2328,12 @@ gz_thread_func (gz_thread_params_t* params)
     gzFile file;
     gint success = 1;
 
+    if (params->compress && params->threads > 1)
+    {
+        success = gz_write_parallel (params, params->threads, params->level);
+        goto cleanup_gz_thread_func;
+    }
+
 #ifdef G_OS_WIN32
     {
         gchar* conv_name = g_win32_locale_filename_from_utf8 (params->filename);
@@ -1474,9 +2397,13 @@ gz_thread_func (gz_thread_params_t* params)
     }
     else
     {
+        gchar* read_buffer = static_cast<gchar*> (g_malloc (GZ_READ_BUFLEN));
+#if ZLIB_VERNUM >= 0x1235
+        gzbuffer (file, 4 * GZ_READ_BUFLEN);
+#endif
         while (success)
         {
-            gzval = gzread (file, buffer, BUFLEN);
+            gzval = gzread (file, read_buffer, GZ_READ_BUFLEN);
             if (gzval > 0)
             {
                 if (
@@ -1485,7 +2412,7 @@ gz_thread_func (gz_thread_params_t* params)
 #else
                     write
 #endif
-                    (params->fd, buffer, gzval) < 0)
+                    (params->fd, read_buffer, gzval) < 0)
                 {
                     g_warning ("Could not write to pipe. The error is '%s' (%d)",
                                g_strerror (errno) ? g_strerror (errno) : "", errno);
@@ -1505,6 +2432,7 @@ gz_thread_func (gz_thread_params_t* params)
                 success = 0;
             }
         }
+        g_free (read_buffer);
     }
 
     if ((gzval = gzclose (file)) != Z_OK)
@@ -1523,6 +2451,29 @@ cleanup_gz_thread_func:
     return GINT_TO_POINTER (success);
 }
 
+static gz_thread_params_t*
+gz_thread_params_new (int fd, const char* filename, const char* perms,
+                      gboolean compress, gint level, gint threads)
+{
+    auto params = g_new (gz_thread_params_t, 1);
+
+    params->fd = fd;
+    params->filename = g_strdup (filename);
+    params->perms = g_strdup (perms);
+    params->compress = compress;
+    params->level = level;
+    params->threads = gz_compression_threads (threads);
+    if (params->level < 0 || params->level > 9)
+        params->level = Z_DEFAULT_COMPRESSION;
+    if (compress && params->level != Z_DEFAULT_COMPRESSION)
+    {
+        gchar* level_perms = g_strdup_printf ("%s%d", perms, params->level);
+        g_free (params->perms);
+        params->perms = level_perms;
+    }
+    return params;
+}
+
 static FILE*
 try_gz_open (const char* filename, const char* perms, gboolean use_gzip,
              gboolean compress)
@@ -1551,11 +2502,10 @@ try_gz_open (const char* filename, const char* perms, gboolean use_gzip,
             return g_fopen (filename, perms);
         }
 
-        params = g_new (gz_thread_params_t, 1);
-        params->fd = filedes[compress ? 0 : 1];
-        params->filename = g_strdup (filename);
-        params->perms = g_strdup (perms);
-        params->compress = compress;
+        params = gz_thread_params_new (filedes[compress ? 0 : 1], filename,
+                                       perms, compress,
+                                       gnc_prefs_get_file_compression_level (),
+                                       gnc_prefs_get_file_compression_threads ());
 
 #ifndef HAVE_GLIB_2_32
         thread = g_thread_create ((GThreadFunc) gz_thread_func, params,
@@ -1581,7 +2531,12 @@ try_gz_open (const char* filename, const char* perms, gboolean use_gzip,
         if (compress)
             file = fdopen (filedes[1], "w");
         else
+        {
             file = fdopen (filedes[0], "r");
+            /* Read ahead in big chunks rather than a pipe buffer at a time. */
+            if (file)
+                setvbuf (file, NULL, _IOFBF, GZ_READ_BUFLEN);
+        }
 
         G_LOCK (threads);
         if (!threads)
@@ -1644,6 +2599,29 @@ gnc_book_write_to_xml_file_v2 (
     return success;
 }
 
+gboolean
+gnc_xml2_compress_file (const char* source, const char* filename,
+                        gint level, gint threads)
+{
+    int flags = O_RDONLY;
+    int fd;
+
+#ifdef G_OS_WIN32
+    flags |= O_BINARY;
+#endif
+    fd = g_open (source, flags, 0);
+    if (fd == -1)
+    {
+        g_warning ("Could not open '%s' for compression: %s", source,
+                   g_strerror (errno));
+        return FALSE;
+    }
+    /* gz_thread_func closes fd and frees the parameters. */
+    return GPOINTER_TO_INT (gz_thread_func (
+                                gz_thread_params_new (fd, filename, "w", TRUE,
+                                                      level, threads)));
+}
+
 /*
  * Have to pass in the backend as this routine needs the temporary
  * backend for file export, not the real backend which could be
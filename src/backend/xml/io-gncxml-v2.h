@@ -91,6 +91,40 @@ gboolean qof_session_load_from_xml_file_v2 (FileBackend*, QofBook*,
 gboolean gnc_book_write_to_xml_filehandle_v2 (QofBook* book, FILE* fh);
 gboolean gnc_book_write_to_xml_file_v2 (QofBook* book, const char* filename,
                                         gboolean compress);
+/** Gzip the file source into filename, as a compressed save would
+ * write it, at the given compression level and number of threads.
+ * Needs no book, so it can run in any thread. */
+gboolean gnc_xml2_compress_file (const char* source, const char* filename,
+                                 gint level, gint threads);
+
+/** Write an uncompressed snapshot of the book beside datafile, stamped
+ * with a digest of datafile as it is on disk now. */
+gboolean gnc_book_write_snapshot_v2 (QofBook* book, const char* datafile);
+/** Write the snapshot of datafile from xmlfile, an uncompressed save of
+ * the book, rather than from the book itself. */
+gboolean gnc_xml2_write_snapshot_from_file (const char* xmlfile,
+                                            const char* datafile);
+/** Remove the snapshot of datafile, if there is one. */
+void gnc_xml2_remove_snapshot (const char* datafile);
+/** Whether datafile has a snapshot matching its current contents. */
+gboolean gnc_xml2_snapshot_is_current (const char* datafile);
+/** Load the book from the snapshot of the backend's data file. */
+gboolean qof_session_load_from_xml_snapshot_v2 (FileBackend*, QofBook*);
+
+/** Record a committed instance for the next journaled save; anything
+ * but a transaction or split makes the next save a full one. */
+void gnc_xml2_journal_note_commit (FileBackend* fbe, QofInstance* inst);
+/** Append the recorded transactions to the journal of the data file.
+ * @return FALSE if they could not be, or a full save is needed. */
+gboolean gnc_xml2_journal_append (FileBackend* fbe, QofBook* book);
+/** The size of the journal of datafile, or -1 if there is none. */
+gint64 gnc_xml2_journal_size (const char* datafile);
+/** Remove the journal file of datafile, if there is one. */
+void gnc_xml2_journal_remove (const char* datafile);
+/** Remove the journal after a full save and forget what it recorded. */
+void gnc_xml2_journal_reset (FileBackend* fbe);
+/** Replay the journal of the backend's data file into the loaded book. */
+gboolean gnc_xml2_journal_replay (FileBackend* fbe, QofBook* book);
 
 /** write just the commodities and accounts to a file */
 gboolean gnc_book_write_accounts_to_xml_filehandle_v2 (QofBackend* be,
@@ -33,6 +33,7 @@ extern "C"
 #include "gnc-xml.h"
 #include "io-utils.h"
 #include "sixtp.h"
+#include "sixtp-dom-generators.h"
 /*
   <!-- Local variables: -->
   <!-- mode: C          -->
@@ -57,15 +58,12 @@ write_one_account (FILE* out,
                    sixtp_gdv2* gd,
                    gboolean allow_incompat)
 {
-    xmlNodePtr accnode;
+    GncXmlStreamWriter writer (out);
 
-    accnode =
-        gnc_account_dom_tree_create (account, gd && gd->exporting, allow_incompat);
-
-    xmlElemDump (out, NULL, accnode);
-    xmlFreeNode (accnode);
-
-    if (ferror (out) || fprintf (out, "\n") < 0)
+    gnc_account_to_xml_stream (writer, account, gd && gd->exporting,
+                               allow_incompat);
+    writer.append ("\n");
+    if (!writer.flush ())
         return FALSE;
 
     gd->counter.accounts_loaded++;
@@ -26,6 +26,7 @@ extern "C"
 
 #include "config.h"
 #include <glib.h>
+#include <string.h>
 
 #include <gnc-date.h>
 }
@@ -61,14 +62,10 @@ text_to_dom_tree (const char* tag, const char* str)
 xmlNodePtr
 int_to_dom_tree (const char* tag, gint64 val)
 {
-    gchar* text;
-    xmlNodePtr result;
+    char text[GNC_INT64_BUFF_SIZE];
 
-    text = g_strdup_printf ("%" G_GINT64_FORMAT, val);
-    g_return_val_if_fail (text, NULL);
-    result = text_to_dom_tree (tag, text);
-    g_free (text);
-    return result;
+    gnc_int64_to_buff (val, text);
+    return text_to_dom_tree (tag, text);
 }
 
 xmlNodePtr
@@ -134,50 +131,44 @@ commodity_ref_to_dom_tree (const char* tag, const gnc_commodity* c)
 char*
 timespec_sec_to_string (const Timespec* ts)
 {
-    return gnc_print_time64 (ts->tv_sec, "%Y-%m-%d %H:%M:%S %q");
+    char buff[GNC_ISO8601_LOCAL_BUFF_SIZE];
+
+    if (!gnc_time64_to_iso8601_local_buff (ts->tv_sec, buff))
+        return NULL;
+    return g_strdup (buff);
 }
 
 gchar*
 timespec_nsec_to_string (const Timespec* ts)
 {
-    return g_strdup_printf ("%ld", ts->tv_nsec);
+    char buff[GNC_INT64_BUFF_SIZE];
+
+    gnc_int64_to_buff (ts->tv_nsec, buff);
+    return g_strdup (buff);
 }
 
 xmlNodePtr
 timespec_to_dom_tree (const char* tag, const Timespec* spec)
 {
     xmlNodePtr ret;
-    gchar* date_str = NULL;
-    gchar* ns_str = NULL;
+    char date_str[GNC_ISO8601_LOCAL_BUFF_SIZE];
+    char ns_str[GNC_INT64_BUFF_SIZE];
 
     g_return_val_if_fail (spec, NULL);
 
-    date_str = timespec_sec_to_string (spec);
-
-    if (!date_str)
+    if (!gnc_time64_to_iso8601_local_buff (spec->tv_sec, date_str))
     {
         return NULL;
     }
 
     ret = xmlNewNode (NULL, BAD_CAST tag);
 
-    xmlNewTextChild (ret, NULL, BAD_CAST "ts:date",
-                     checked_char_cast (date_str));
+    xmlNewTextChild (ret, NULL, BAD_CAST "ts:date", BAD_CAST date_str);
 
     if (spec->tv_nsec > 0)
     {
-        ns_str = timespec_nsec_to_string (spec);
-        if (ns_str)
-        {
-            xmlNewTextChild (ret, NULL, BAD_CAST "ts:ns",
-                             checked_char_cast (ns_str));
-        }
-    }
-
-    g_free (date_str);
-    if (ns_str)
-    {
-        g_free (ns_str);
+        gnc_int64_to_buff (spec->tv_nsec, ns_str);
+        xmlNewTextChild (ret, NULL, BAD_CAST "ts:ns", BAD_CAST ns_str);
     }
 
     return ret;
@@ -207,18 +198,15 @@ xmlNodePtr
 gnc_numeric_to_dom_tree (const char* tag, const gnc_numeric* num)
 {
     xmlNodePtr ret;
-    gchar* numstr;
+    char numstr[GNC_NUMERIC_BUFF_SIZE];
 
     g_return_val_if_fail (num, NULL);
 
-    numstr = gnc_numeric_to_string (*num);
-    g_return_val_if_fail (numstr, NULL);
+    gnc_numeric_to_buff (*num, numstr);
 
     ret = xmlNewNode (NULL, BAD_CAST tag);
 
-    xmlNodeAddContent (ret, checked_char_cast (numstr));
-
-    g_free (numstr);
+    xmlNodeAddContent (ret, BAD_CAST numstr);
 
     return ret;
 }
@@ -243,12 +231,8 @@ double_to_string (double value)
 static void
 add_text_to_node (xmlNodePtr node, const gchar* type, gchar* val)
 {
-    gchar* newtype = g_strdup (type);
-    gchar* newval = g_strdup (val);
     xmlSetProp (node, BAD_CAST "type", BAD_CAST type);
     xmlNodeSetContent (node, checked_char_cast (val));
-    g_free (newtype);
-    g_free (newval);
 }
 
 static void add_kvp_slot (const char* key, KvpValue* value, void* data);
@@ -286,18 +270,26 @@ add_kvp_value_node (xmlNodePtr node, const gchar* tag, KvpValue* val)
     switch (val->get_type ())
     {
     case KvpValue::Type::INT64:
-        add_text_to_node (val_node, "integer",
-                          g_strdup_printf ("%" G_GINT64_FORMAT,
-                                           val->get<int64_t> ()));
+    {
+        char buff[GNC_INT64_BUFF_SIZE];
+        gnc_int64_to_buff (val->get<int64_t> (), buff);
+        add_text_to_node (val_node, "integer", buff);
         break;
+    }
     case KvpValue::Type::DOUBLE:
-        add_text_to_node (val_node, "double",
-                          double_to_string (val->get<double> ()));
+    {
+        auto str = double_to_string (val->get<double> ());
+        add_text_to_node (val_node, "double", str);
+        g_free (str);
         break;
+    }
     case KvpValue::Type::NUMERIC:
-        add_text_to_node (val_node, "numeric",
-                          gnc_numeric_to_string (val->get<gnc_numeric> ()));
+    {
+        char buff[GNC_NUMERIC_BUFF_SIZE];
+        gnc_numeric_to_buff (val->get<gnc_numeric> (), buff);
+        add_text_to_node (val_node, "numeric", buff);
         break;
+    }
     case KvpValue::Type::STRING:
         xmlSetProp (val_node, BAD_CAST "type", BAD_CAST "string");
         break;
@@ -369,3 +361,338 @@ qof_instance_slots_to_dom_tree (const char* tag, const QofInstance* inst)
     frame->for_each_slot (add_kvp_slot, static_cast<void*> (ret));
     return ret;
 }
+
+/* ================================================================ */
+/* Streaming counterparts of the generators above.  Keep the two in
+ * step: the stream writer must produce exactly what xmlElemDump()
+ * produces for the tree, with format on and libxml2's default two-space
+ * indentation, which stops deepening after 30 levels.
+ */
+
+#define XML_STREAM_FLUSH_SIZE (64 * 1024)
+#define XML_STREAM_MAX_INDENT 30
+
+void
+GncXmlStreamWriter::begin_child ()
+{
+    if (m_tag_open)
+    {
+        m_buf += ">\n";
+        m_tag_open = false;
+    }
+    m_buf.append (2 * MIN (m_level, XML_STREAM_MAX_INDENT), ' ');
+}
+
+void
+GncXmlStreamWriter::end_child ()
+{
+    /* The top element isn't terminated, as with xmlElemDump(). */
+    if (m_level > 0)
+        m_buf += '\n';
+    if (m_out && m_buf.size () >= XML_STREAM_FLUSH_SIZE)
+        flush ();
+}
+
+/* Whether checked_char_cast() would leave text as it is. */
+static bool
+xml_text_is_clean (const char* text)
+{
+    for (auto c = text; *c; ++c)
+        if (*c > 0 && *c < 0x20 && *c != 0x09 && *c != 0x0a && *c != 0x0d)
+            return false;
+    return g_utf8_validate (text, -1, NULL);
+}
+
+void
+GncXmlStreamWriter::append_escaped (const char* text)
+{
+    /* Nearly all text is clean, and is escaped straight from the
+     * caller's string a run at a time. */
+    gchar* copy = nullptr;
+    if (!xml_text_is_clean (text))
+    {
+        copy = g_strdup (text);
+        text = reinterpret_cast<const char*> (checked_char_cast (copy));
+    }
+    for (auto c = text; *c;)
+    {
+        auto run = strcspn (c, "<>&\r");
+        m_buf.append (c, run);
+        c += run;
+        switch (*c)
+        {
+        case '<':
+            m_buf += "&lt;";
+            break;
+        case '>':
+            m_buf += "&gt;";
+            break;
+        case '&':
+            m_buf += "&amp;";
+            break;
+        case '\r':
+            m_buf += "&#13;";
+            break;
+        default:
+            continue;
+        }
+        ++c;
+    }
+    g_free (copy);
+}
+
+void
+GncXmlStreamWriter::start_element (const char* tag)
+{
+    begin_child ();
+    m_buf += '<';
+    m_buf += tag;
+    m_tag_open = true;
+    ++m_level;
+}
+
+void
+GncXmlStreamWriter::add_attribute (const char* name, const char* value)
+{
+    g_return_if_fail (m_tag_open);
+    m_buf += ' ';
+    m_buf += name;
+    m_buf += "=\"";
+    m_buf += value;
+    m_buf += '"';
+}
+
+void
+GncXmlStreamWriter::end_element (const char* tag)
+{
+    g_return_if_fail (m_level > 0);
+    --m_level;
+    if (m_tag_open)
+    {
+        m_buf += "/>";
+        m_tag_open = false;
+    }
+    else
+    {
+        m_buf.append (2 * MIN (m_level, XML_STREAM_MAX_INDENT), ' ');
+        m_buf += "</";
+        m_buf += tag;
+        m_buf += '>';
+    }
+    end_child ();
+}
+
+void
+GncXmlStreamWriter::text_element (const char* tag, const char* text,
+                                  const char* type)
+{
+    begin_child ();
+    m_buf += '<';
+    m_buf += tag;
+    if (type)
+    {
+        m_buf += " type=\"";
+        m_buf += type;
+        m_buf += '"';
+    }
+    if (text)
+    {
+        m_buf += '>';
+        append_escaped (text);
+        m_buf += "</";
+        m_buf += tag;
+        m_buf += '>';
+    }
+    else
+        m_buf += "/>";
+    end_child ();
+}
+
+gboolean
+GncXmlStreamWriter::flush ()
+{
+    if (!m_out)
+        return TRUE;
+    if (!m_buf.empty ())
+    {
+        fwrite (m_buf.data (), 1, m_buf.size (), m_out);
+        m_buf.clear ();
+    }
+    return !ferror (m_out);
+}
+
+void
+text_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                    const char* str)
+{
+    g_return_if_fail (str);
+    writer.text_element (tag, *str ? str : nullptr);
+}
+
+void
+guid_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                    const GncGUID* gid)
+{
+    char guid_str[GUID_ENCODING_LENGTH + 1];
+
+    if (!guid_to_string_buff (gid, guid_str))
+    {
+        PERR ("guid_to_string_buff failed\n");
+        return;
+    }
+    writer.text_element (tag, guid_str, "guid");
+}
+
+void
+commodity_ref_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                             const gnc_commodity* c)
+{
+    g_return_if_fail (c);
+
+    if (!gnc_commodity_get_namespace (c) || !gnc_commodity_get_mnemonic (c))
+        return;
+
+    writer.start_element (tag);
+    writer.text_element ("cmdty:space", gnc_commodity_get_namespace_compat (c));
+    writer.text_element ("cmdty:id", gnc_commodity_get_mnemonic (c));
+    writer.end_element (tag);
+}
+
+void
+timespec_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                        const Timespec* spec, const char* type)
+{
+    char date_str[GNC_ISO8601_LOCAL_BUFF_SIZE];
+
+    g_return_if_fail (spec);
+
+    if (!gnc_time64_to_iso8601_local_buff (spec->tv_sec, date_str))
+        return;
+
+    writer.start_element (tag);
+    if (type)
+        writer.add_attribute ("type", type);
+    writer.text_element ("ts:date", date_str);
+    if (spec->tv_nsec > 0)
+    {
+        char ns_str[GNC_INT64_BUFF_SIZE];
+        gnc_int64_to_buff (spec->tv_nsec, ns_str);
+        writer.text_element ("ts:ns", ns_str);
+    }
+    writer.end_element (tag);
+}
+
+void
+gnc_numeric_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                           const gnc_numeric* num)
+{
+    char numstr[GNC_NUMERIC_BUFF_SIZE];
+
+    g_return_if_fail (num);
+
+    gnc_numeric_to_buff (*num, numstr);
+    writer.text_element (tag, numstr);
+}
+
+static void add_kvp_slot_to_stream (const char* key, KvpValue* value,
+                                    void* data);
+
+static void
+add_kvp_value_to_stream (GncXmlStreamWriter& writer, const gchar* tag,
+                         KvpValue* val)
+{
+    gchar* str;
+    char buff[GNC_NUMERIC_BUFF_SIZE];
+
+    switch (val->get_type ())
+    {
+    case KvpValue::Type::INT64:
+        gnc_int64_to_buff (val->get<int64_t> (), buff);
+        writer.text_element (tag, buff, "integer");
+        break;
+    case KvpValue::Type::DOUBLE:
+        str = double_to_string (val->get<double> ());
+        writer.text_element (tag, str, "double");
+        g_free (str);
+        break;
+    case KvpValue::Type::NUMERIC:
+        gnc_numeric_to_buff (val->get<gnc_numeric> (), buff);
+        writer.text_element (tag, buff, "numeric");
+        break;
+    case KvpValue::Type::STRING:
+        writer.text_element (tag, val->get<const char*> (), "string");
+        break;
+    case KvpValue::Type::GUID:
+    {
+        gchar guidstr[GUID_ENCODING_LENGTH + 1];
+        guid_to_string_buff (val->get<GncGUID*> (), guidstr);
+        writer.text_element (tag, guidstr, "guid");
+        break;
+    }
+    case KvpValue::Type::TIMESPEC:
+    {
+        auto ts = val->get<Timespec> ();
+        timespec_to_xml_stream (writer, tag, &ts, "timespec");
+        break;
+    }
+    case KvpValue::Type::GDATE:
+    {
+        gchar date_str[512];
+        auto d = val->get<GDate> ();
+        g_date_strftime (date_str, sizeof (date_str), "%Y-%m-%d", &d);
+        writer.start_element (tag);
+        writer.add_attribute ("type", "gdate");
+        writer.text_element ("gdate", date_str);
+        writer.end_element (tag);
+        break;
+    }
+    case KvpValue::Type::GLIST:
+        writer.start_element (tag);
+        writer.add_attribute ("type", "list");
+        for (auto cursor = val->get<GList*> (); cursor; cursor = cursor->next)
+        {
+            auto val = static_cast<KvpValue*> (cursor->data);
+            add_kvp_value_to_stream (writer, "slot:value", val);
+        }
+        writer.end_element (tag);
+        break;
+    case KvpValue::Type::FRAME:
+    {
+        writer.start_element (tag);
+        writer.add_attribute ("type", "frame");
+        auto frame = val->get<KvpFrame*> ();
+        if (frame)
+            frame->for_each_slot (add_kvp_slot_to_stream,
+                                  static_cast<void*> (&writer));
+        writer.end_element (tag);
+        break;
+    }
+    default:
+        writer.text_element (tag, nullptr);
+        break;
+    }
+}
+
+static void
+add_kvp_slot_to_stream (const char* key, KvpValue* value, void* data)
+{
+    auto& writer = *static_cast<GncXmlStreamWriter*> (data);
+
+    writer.start_element ("slot");
+    writer.text_element ("slot:key", key);
+    add_kvp_value_to_stream (writer, "slot:value", value);
+    writer.end_element ("slot");
+}
+
+void
+qof_instance_slots_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                                  const QofInstance* inst)
+{
+    KvpFrame* frame = qof_instance_get_slots (inst);
+    if (!frame)
+        return;
+
+    writer.start_element (tag);
+    frame->for_each_slot (add_kvp_slot_to_stream, static_cast<void*> (&writer));
+    writer.end_element (tag);
+}
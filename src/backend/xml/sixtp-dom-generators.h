@@ -35,6 +35,9 @@ extern "C"
 
 #include "gnc-xml-helper.h"
 
+#include <cstdio>
+#include <string>
+
 xmlNodePtr text_to_dom_tree (const char* tag, const char* str);
 xmlNodePtr int_to_dom_tree (const char* tag, gint64 val);
 xmlNodePtr boolean_to_dom_tree (const char* tag, gboolean val);
@@ -52,4 +55,66 @@ xmlNodePtr recurrence_to_dom_tree (const gchar* tag, const Recurrence* r);
 
 gchar* double_to_string (double value);
 
+/**
+ * Writes XML straight to a FILE*, laid out byte for byte the way
+ * xmlElemDump() lays out the DOM tree the *_to_dom_tree functions build for
+ * the same data.  Used for the big, repetitive parts of a book so that they
+ * can be saved without allocating a tree per object.
+ *
+ * Output is buffered; call flush() and check its result before inspecting
+ * the FILE*.  Text passes through checked_char_cast() and is escaped as
+ * libxml2 escapes it.
+ */
+class GncXmlStreamWriter
+{
+public:
+    GncXmlStreamWriter (FILE* out) : m_out{out} {}
+    /** Collects the XML in memory instead, to be handed over by take(). */
+    GncXmlStreamWriter () : m_out{nullptr} {}
+    ~GncXmlStreamWriter () { flush (); }
+    /** Opens an element; follow with add_attribute() calls, then
+     *  children.  Must be paired with end_element(). */
+    void start_element (const char* tag);
+    /** Adds an attribute to the element just opened.  The value is
+     *  written as is and must not need escaping. */
+    void add_attribute (const char* name, const char* value);
+    void end_element (const char* tag);
+    /** Writes a complete element holding only text, with an optional
+     *  type attribute.  A NULL text gives an empty element, like
+     *  xmlNodeAddContent() with an empty string; "" gives a start and end
+     *  tag, like xmlNewTextChild(). */
+    void text_element (const char* tag, const char* text,
+                       const char* type = nullptr);
+    /** Writes @a text as is, e.g. a newline after a top element. */
+    void append (const char* text) { m_buf += text; }
+    /** Writes out the buffer.  @return FALSE if the FILE* has an error. */
+    gboolean flush ();
+    /** Returns the XML collected so far by a writer without a FILE*. */
+    std::string take () { std::string buf; buf.swap (m_buf); return buf; }
+private:
+    void begin_child ();
+    void end_child ();
+    void append_escaped (const char* text);
+    FILE* m_out;
+    std::string m_buf;
+    unsigned int m_level = 0;
+    /** The last start tag still lacks its '>'. */
+    bool m_tag_open = false;
+};
+
+/** As text_to_dom_tree(): an empty string gives an empty element. */
+void text_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                         const char* str);
+void guid_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                         const GncGUID* gid);
+void commodity_ref_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                                  const gnc_commodity* c);
+void timespec_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                             const Timespec* spec, const char* type = nullptr);
+void gnc_numeric_to_xml_stream (GncXmlStreamWriter& writer, const char* tag,
+                                const gnc_numeric* num);
+void qof_instance_slots_to_xml_stream (GncXmlStreamWriter& writer,
+                                       const char* tag,
+                                       const QofInstance* inst);
+
 #endif /* _SIXTP_DOM_GENERATORS_H_ */
@@ -35,8 +35,57 @@ extern "C"
 #include "sixtp-dom-parsers.h"
 #include <kvp_frame.hpp>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 static QofLogModule log_module = GNC_MOD_IO;
 
+/* The text of a node for converters that only look at it.  Text in a
+ * single text node, which is how the parser leaves it, is used in place
+ * rather than copied out; anything else goes through dom_tree_to_text.
+ */
+class DomText
+{
+public:
+    DomText (xmlNodePtr tree) : m_text (nullptr), m_copy (nullptr)
+    {
+        xmlNodePtr child = tree ? tree->xmlChildrenNode : nullptr;
+        if (child && child->type == XML_TEXT_NODE && !child->next)
+            m_text = reinterpret_cast<const gchar*> (child->content);
+        else
+            m_text = m_copy = dom_tree_to_text (tree);
+    }
+    ~DomText () { g_free (m_copy); }
+    DomText (const DomText&) = delete;
+    DomText& operator= (const DomText&) = delete;
+    const gchar* c_str () const { return m_text; }
+private:
+    const gchar* m_text;
+    gchar* m_copy;
+};
+
+/* The value of an attribute, in place if it's a single text node. */
+class DomAttrText
+{
+public:
+    DomAttrText (xmlAttrPtr attr) : m_text (nullptr), m_copy (nullptr)
+    {
+        xmlNodePtr child = attr->xmlAttrPropertyValue;
+        if (child && child->type == XML_TEXT_NODE && !child->next)
+            m_text = reinterpret_cast<const gchar*> (child->content);
+        else
+            m_text = m_copy = reinterpret_cast<gchar*> (xmlNodeGetContent (child));
+    }
+    ~DomAttrText () { xmlFree (m_copy); }
+    DomAttrText (const DomAttrText&) = delete;
+    DomAttrText& operator= (const DomAttrText&) = delete;
+    const gchar* c_str () const { return m_text; }
+private:
+    const gchar* m_text;
+    gchar* m_copy;
+};
+
 GncGUID*
 dom_tree_to_guid (xmlNodePtr node)
 {
@@ -54,29 +103,24 @@ dom_tree_to_guid (xmlNodePtr node)
     }
 
     {
-        char* type;
-
-        type = (char*)xmlNodeGetContent (node->properties->xmlAttrPropertyValue);
+        DomAttrText type (node->properties);
 
         /* handle new and guid the same for the moment */
-        if ((g_strcmp0 ("guid", type) == 0) || (g_strcmp0 ("new", type) == 0))
+        if ((g_strcmp0 ("guid", type.c_str ()) == 0) ||
+            (g_strcmp0 ("new", type.c_str ()) == 0))
         {
             auto gid = guid_new ();
-            char* guid_str;
+            DomText guid_str (node);
 
-            guid_str = (char*)xmlNodeGetContent (node->xmlChildrenNode);
-            string_to_guid (guid_str, gid);
-            xmlFree (guid_str);
-            xmlFree (type);
+            string_to_guid (guid_str.c_str (), gid);
             return gid;
         }
         else
         {
             PERR ("Unknown type %s for attribute type for tag %s",
-                  type ? type : "(null)",
+                  type.c_str () ? type.c_str () : "(null)",
                   node->properties->name ?
                   (char*) node->properties->name : "(null)");
-            xmlFree (type);
             return NULL;
         }
     }
@@ -85,17 +129,14 @@ dom_tree_to_guid (xmlNodePtr node)
 static KvpValue*
 dom_tree_to_integer_kvp_value (xmlNodePtr node)
 {
-    gchar* text;
+    DomText text (node);
     gint64 daint;
     KvpValue* ret = NULL;
 
-    text = dom_tree_to_text (node);
-
-    if (string_to_gint64 (text, &daint))
+    if (string_to_gint64 (text.c_str (), &daint))
     {
         ret = new KvpValue {daint};
     }
-    g_free (text);
 
     return ret;
 }
@@ -103,16 +144,9 @@ dom_tree_to_integer_kvp_value (xmlNodePtr node)
 gboolean
 dom_tree_to_integer (xmlNodePtr node, gint64* daint)
 {
-    gchar* text;
-    gboolean ret;
-
-    text = dom_tree_to_text (node);
-
-    ret = string_to_gint64 (text, daint);
-
-    g_free (text);
+    DomText text (node);
 
-    return ret;
+    return string_to_gint64 (text.c_str (), daint);
 }
 
 gboolean
@@ -129,31 +163,34 @@ dom_tree_to_guint16 (xmlNodePtr node, guint16* i)
 gboolean
 dom_tree_to_guint (xmlNodePtr node, guint* i)
 {
-    gchar* text, *endptr;
-    gboolean ret;
+    DomText text (node);
+    gchar* endptr;
 
-    text = dom_tree_to_text (node);
+    if (!text.c_str ())
+        return FALSE;
     /* In spite of the strange string_to_gint64 function, I'm just
        going to use strtoul here until someone shows me the error of
        my ways. -CAS */
-    *i = (guint) strtoul (text, &endptr, 0);
-    ret = (endptr != text);
-    g_free (text);
-    return ret;
+    *i = (guint) strtoul (text.c_str (), &endptr, 0);
+    return (endptr != text.c_str ());
 }
 
 gboolean
 dom_tree_to_boolean (xmlNodePtr node, gboolean* b)
 {
-    gchar* text;
+    DomText text (node);
 
-    text = dom_tree_to_text (node);
-    if (g_ascii_strncasecmp (text, "true", 4) == 0)
+    if (!text.c_str ())
+    {
+        *b = FALSE;
+        return FALSE;
+    }
+    else if (g_ascii_strncasecmp (text.c_str (), "true", 4) == 0)
     {
         *b = TRUE;
         return TRUE;
     }
-    else if (g_ascii_strncasecmp (text, "false", 5) == 0)
+    else if (g_ascii_strncasecmp (text.c_str (), "false", 5) == 0)
     {
         *b = FALSE;
         return TRUE;
@@ -168,19 +205,15 @@ dom_tree_to_boolean (xmlNodePtr node, gboolean* b)
 static KvpValue*
 dom_tree_to_double_kvp_value (xmlNodePtr node)
 {
-    gchar* text;
+    DomText text (node);
     double dadoub;
     KvpValue* ret = NULL;
 
-    text = dom_tree_to_text (node);
-
-    if (string_to_double (text, &dadoub))
+    if (string_to_double (text.c_str (), &dadoub))
     {
         ret = new KvpValue {dadoub};
     }
 
-    g_free (text);
-
     return ret;
 }
 
@@ -402,6 +435,8 @@ dom_tree_to_kvp_value (xmlNodePtr node)
     return ret;
 }
 
+static void dom_slots_reader_move (DomSlotsReader* reader, KvpFrame* frame);
+
 static gboolean
 dom_tree_to_kvp_frame_given (xmlNodePtr node, KvpFrame* frame)
 {
@@ -410,6 +445,13 @@ dom_tree_to_kvp_frame_given (xmlNodePtr node, KvpFrame* frame)
     g_return_val_if_fail (node, FALSE);
     g_return_val_if_fail (frame, FALSE);
 
+    if (node->_private)
+    {
+        dom_slots_reader_move (static_cast<DomSlotsReader*> (node->_private),
+                               frame);
+        return TRUE;
+    }
+
     for (mark = node->xmlChildrenNode; mark; mark = mark->next)
     {
         if (g_strcmp0 ((char*)mark->name, "slot") == 0)
@@ -500,6 +542,11 @@ dom_tree_to_text (xmlNodePtr tree)
         return g_strdup ("");
     }
 
+    /* a single text node needs no collapsing */
+    if (tree->xmlChildrenNode->type == XML_TEXT_NODE &&
+        !tree->xmlChildrenNode->next)
+        return g_strdup ((gchar*) tree->xmlChildrenNode->content);
+
     temp = (char*)xmlNodeListGetString (NULL, tree->xmlChildrenNode, TRUE);
     if (!temp)
     {
@@ -513,27 +560,70 @@ dom_tree_to_text (xmlNodePtr tree)
     return result;
 }
 
+/* Reads the decimal digits of a gint64 at str, as g_ascii_strtoll would.
+ * Anything it might read differently -- leading blanks or zeros, a plus
+ * sign, a base prefix, or overflow -- is left to it by returning FALSE. */
+static gboolean
+scan_decimal_gint64 (const gchar*& str, gint64& value)
+{
+    const gchar* p = str;
+    gboolean negative = (*p == '-');
+    guint64 magnitude = 0;
+
+    if (negative)
+        ++p;
+    if (!g_ascii_isdigit (*p) || (*p == '0' && g_ascii_isdigit (p[1])))
+        return FALSE;
+    for (; g_ascii_isdigit (*p); ++p)
+    {
+        guint digit = *p - '0';
+        if (magnitude > (G_MAXUINT64 - digit) / 10)
+            return FALSE;
+        magnitude = magnitude * 10 + digit;
+    }
+    if (magnitude > static_cast<guint64> (G_MAXINT64) + (negative ? 1 : 0))
+        return FALSE;
+    if (negative && magnitude)
+        value = -static_cast<gint64> (magnitude - 1) - 1;
+    else
+        value = static_cast<gint64> (magnitude);
+    str = p;
+    return TRUE;
+}
+
+/* "num/denom" as gnc_numeric_to_string writes it, without the generality
+ * of string_to_gnc_numeric, which gets anything else. */
+static gboolean
+text_to_gnc_numeric (const gchar* str, gnc_numeric* n)
+{
+    gint64 num, denom;
+    const gchar* p = str;
+
+    if (scan_decimal_gint64 (p, num) && *p == '/' &&
+        scan_decimal_gint64 (++p, denom) && *p == '\0')
+    {
+        n->num = num;
+        n->denom = denom;
+        return TRUE;
+    }
+    return string_to_gnc_numeric (str, n);
+}
+
 gnc_numeric*
 dom_tree_to_gnc_numeric (xmlNodePtr node)
 {
-    gchar* content = dom_tree_to_text (node);
+    DomText content (node);
     gnc_numeric* ret;
-    if (!content)
+    if (!content.c_str ())
         return NULL;
 
     ret = g_new (gnc_numeric, 1);
 
-    if (string_to_gnc_numeric (content, ret))
-    {
-        g_free (content);
+    if (text_to_gnc_numeric (content.c_str (), ret))
         return ret;
-    }
-    else
-    {
-        g_free (content);
-        g_free (ret);
-        return NULL;
-    }
+
+    g_free (ret);
+    return NULL;
 }
 
 static inline Timespec
@@ -583,18 +673,16 @@ dom_tree_to_timespec (xmlNodePtr node)
                 }
                 else
                 {
-                    gchar* content = dom_tree_to_text (n);
-                    if (!content)
+                    DomText content (n);
+                    if (!content.c_str ())
                     {
                         return timespec_failure (ret);
                     }
 
-                    if (!string_to_timespec_secs (content, &ret))
+                    if (!string_to_timespec_secs (content.c_str (), &ret))
                     {
-                        g_free (content);
                         return timespec_failure (ret);
                     }
-                    g_free (content);
                     seen_s = TRUE;
                 }
             }
@@ -606,18 +694,16 @@ dom_tree_to_timespec (xmlNodePtr node)
                 }
                 else
                 {
-                    gchar* content = dom_tree_to_text (n);
-                    if (!content)
+                    DomText content (n);
+                    if (!content.c_str ())
                     {
                         return timespec_failure (ret);
                     }
 
-                    if (!string_to_timespec_nsecs (content, &ret))
+                    if (!string_to_timespec_nsecs (content.c_str (), &ret))
                     {
-                        g_free (content);
                         return timespec_failure (ret);
                     }
-                    g_free (content);
                     seen_ns = TRUE;
                 }
             }
@@ -914,3 +1000,351 @@ dom_tree_valid_timespec (Timespec* ts, const xmlChar* name)
                "with a date of 1969-12-31 or 1970-01-01.", name);
     return FALSE;
 }
+
+/* ================================================================ */
+/* The slots as the SAX events come in.  This follows
+ * dom_tree_to_kvp_frame_given() and the converters above exactly, on
+ * the tree the DOM parser would have built: keys and scalar values are
+ * the text directly in their element, a list takes a value from every
+ * child element except one called "text", and a frame is made of the
+ * "slot" elements in it.  Values of the rarer types, or with more than
+ * a type attribute, are built as a little DOM tree and handed to
+ * dom_tree_to_kvp_value().
+ */
+
+struct DomSlotsReader
+{
+    enum class Kind { SLOTS, SLOT, KEY, SCALAR, LIST, FRAME };
+    struct Level
+    {
+        Kind kind;
+        KvpValue* (*convert) (const gchar* text);
+        gchar* key;
+        KvpValue* value;
+        GList* list;
+        KvpFrame* frame;
+        std::string text;
+    };
+
+    DomSlotsReader (xmlNodePtr node) : m_node (node)
+    {
+        m_stack.push_back (Level {Kind::SLOTS});
+    }
+    ~DomSlotsReader ();
+    void start (const gchar* tag, gchar** attrs);
+    void characters (const char* text, int length);
+    void end ();
+    void deliver (KvpValue* value);
+    void start_value (const gchar* tag, gchar** attrs);
+
+    xmlNodePtr m_node;
+    std::vector<Level> m_stack;
+    /* The slots of the slots element itself, in the order they came. */
+    std::vector<std::pair<gchar*, KvpValue*>> m_slots;
+    /* Elements being ignored, and a value being built as DOM. */
+    int m_skip = 0;
+    xmlNodePtr m_dom = nullptr;
+    xmlNodePtr m_dom_cur = nullptr;
+};
+
+static KvpValue*
+text_to_integer_kvp_value (const gchar* text)
+{
+    gint64 daint;
+    return string_to_gint64 (text, &daint) ? new KvpValue {daint} : nullptr;
+}
+
+static KvpValue*
+text_to_double_kvp_value (const gchar* text)
+{
+    double dadoub;
+    return string_to_double (text, &dadoub) ? new KvpValue {dadoub} : nullptr;
+}
+
+static KvpValue*
+text_to_numeric_kvp_value (const gchar* text)
+{
+    gnc_numeric danum;
+    return text_to_gnc_numeric (text, &danum) ? new KvpValue {danum} : nullptr;
+}
+
+static KvpValue*
+text_to_string_kvp_value (const gchar* text)
+{
+    return new KvpValue {g_strdup (text)};
+}
+
+static KvpValue*
+text_to_guid_kvp_value (const gchar* text)
+{
+    auto gid = guid_new ();
+    string_to_guid (text, gid);
+    return new KvpValue {gid};
+}
+
+static const struct
+{
+    const gchar* type;
+    KvpValue* (*convert) (const gchar* text);
+} text_converters[] =
+{
+    { "integer", text_to_integer_kvp_value },
+    { "double", text_to_double_kvp_value },
+    { "numeric", text_to_numeric_kvp_value },
+    { "string", text_to_string_kvp_value },
+    { "guid", text_to_guid_kvp_value },
+};
+
+DomSlotsReader::~DomSlotsReader ()
+{
+    for (auto& level : m_stack)
+    {
+        g_free (level.key);
+        delete level.value;
+        g_list_free_full (level.list, [] (gpointer p)
+        {
+            delete static_cast<KvpValue*> (p);
+        });
+        delete level.frame;
+    }
+    for (auto& slot : m_slots)
+    {
+        g_free (slot.first);
+        delete slot.second;
+    }
+    if (m_dom)
+        xmlFreeNode (m_dom);
+}
+
+void
+DomSlotsReader::start_value (const gchar* tag, gchar** attrs)
+{
+    /* A guid is only read when its type is the first attribute, so only
+     * a lone type attribute is taken as it comes. */
+    if (attrs && attrs[0] && attrs[2] == nullptr &&
+        strcmp (attrs[0], "type") == 0)
+    {
+        auto type = attrs[1];
+        for (auto& conv : text_converters)
+            if (strcmp (type, conv.type) == 0)
+            {
+                m_stack.push_back (Level {Kind::SCALAR, conv.convert});
+                return;
+            }
+        if (strcmp (type, "list") == 0)
+        {
+            m_stack.push_back (Level {Kind::LIST});
+            return;
+        }
+        if (strcmp (type, "frame") == 0)
+        {
+            Level level {Kind::FRAME};
+            level.frame = new KvpFrame;
+            m_stack.push_back (std::move (level));
+            return;
+        }
+    }
+    m_dom = m_dom_cur = xmlNewNode (NULL, BAD_CAST tag);
+    for (auto attr = attrs; attr && *attr; attr += 2)
+        xmlSetProp (m_dom, BAD_CAST attr[0], BAD_CAST attr[1]);
+}
+
+void
+DomSlotsReader::start (const gchar* tag, gchar** attrs)
+{
+    if (m_dom)
+    {
+        m_dom_cur = xmlNewChild (m_dom_cur, NULL, BAD_CAST tag, NULL);
+        for (auto attr = attrs; attr && *attr; attr += 2)
+            xmlSetProp (m_dom_cur, BAD_CAST attr[0], BAD_CAST attr[1]);
+        return;
+    }
+    if (m_skip)
+    {
+        ++m_skip;
+        return;
+    }
+    switch (m_stack.back ().kind)
+    {
+    case Kind::SLOTS:
+    case Kind::FRAME:
+        if (strcmp (tag, "slot") == 0)
+        {
+            m_stack.push_back (Level {Kind::SLOT});
+            return;
+        }
+        break;
+    case Kind::SLOT:
+        if (strcmp (tag, "slot:key") == 0)
+        {
+            m_stack.push_back (Level {Kind::KEY});
+            return;
+        }
+        if (strcmp (tag, "slot:value") == 0)
+        {
+            start_value (tag, attrs);
+            return;
+        }
+        break;
+    case Kind::LIST:
+        if (strcmp (tag, "text") != 0)
+        {
+            start_value (tag, attrs);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    m_skip = 1;
+}
+
+void
+DomSlotsReader::characters (const char* text, int length)
+{
+    if (m_dom)
+    {
+        xmlNodeAddContentLen (m_dom_cur, BAD_CAST text, length);
+        return;
+    }
+    if (m_skip)
+        return;
+    auto& level = m_stack.back ();
+    if (level.kind == Kind::KEY || level.kind == Kind::SCALAR)
+        level.text.append (text, length);
+}
+
+/* Hands a finished value to the slot or list it's in. */
+void
+DomSlotsReader::deliver (KvpValue* value)
+{
+    auto& level = m_stack.back ();
+    if (level.kind == Kind::SLOT)
+    {
+        delete level.value;
+        level.value = value;
+    }
+    else if (value)
+        level.list = g_list_prepend (level.list, value);
+}
+
+void
+DomSlotsReader::end ()
+{
+    if (m_dom)
+    {
+        if (m_dom_cur != m_dom)
+        {
+            m_dom_cur = m_dom_cur->parent;
+            return;
+        }
+        auto value = dom_tree_to_kvp_value (m_dom);
+        xmlFreeNode (m_dom);
+        m_dom = m_dom_cur = nullptr;
+        deliver (value);
+        return;
+    }
+    if (m_skip)
+    {
+        --m_skip;
+        return;
+    }
+
+    auto level = std::move (m_stack.back ());
+    m_stack.pop_back ();
+    auto& parent = m_stack.back ();
+    switch (level.kind)
+    {
+    case Kind::KEY:
+        g_free (parent.key);
+        parent.key = g_strdup (level.text.c_str ());
+        break;
+    case Kind::SCALAR:
+        deliver (level.convert (level.text.c_str ()));
+        break;
+    case Kind::LIST:
+        deliver (new KvpValue {g_list_reverse (level.list)});
+        break;
+    case Kind::FRAME:
+        deliver (new KvpValue {level.frame});
+        break;
+    case Kind::SLOT:
+        if (level.key && level.value)
+        {
+            if (parent.kind == Kind::SLOTS)
+                m_slots.emplace_back (level.key, level.value);
+            else
+            {
+                delete parent.frame->set (level.key, level.value);
+                g_free (level.key);
+            }
+        }
+        else
+        {
+            g_free (level.key);
+            delete level.value;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* The readers whose slots nobody has taken yet; see dom_slots_release(). */
+static thread_local std::vector<std::unique_ptr<DomSlotsReader>> pending_slots;
+
+static void
+dom_slots_reader_move (DomSlotsReader* reader, KvpFrame* frame)
+{
+    for (auto& slot : reader->m_slots)
+    {
+        delete frame->set (slot.first, slot.second);
+        g_free (slot.first);
+    }
+    reader->m_slots.clear ();
+}
+
+DomSlotsReader*
+dom_slots_reader_new (xmlNodePtr node)
+{
+    return new DomSlotsReader (node);
+}
+
+void
+dom_slots_reader_start (DomSlotsReader* reader, const gchar* tag,
+                        gchar** attrs)
+{
+    reader->start (tag, attrs);
+}
+
+void
+dom_slots_reader_characters (DomSlotsReader* reader, const char* text,
+                             int length)
+{
+    reader->characters (text, length);
+}
+
+void
+dom_slots_reader_end (DomSlotsReader* reader)
+{
+    reader->end ();
+}
+
+void
+dom_slots_reader_finish (DomSlotsReader* reader)
+{
+    reader->m_node->_private = reader;
+    pending_slots.emplace_back (reader);
+}
+
+void
+dom_slots_reader_free (DomSlotsReader* reader)
+{
+    delete reader;
+}
+
+void
+dom_slots_release (void)
+{
+    pending_slots.clear ();
+}
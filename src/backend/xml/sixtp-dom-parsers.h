@@ -50,6 +50,25 @@ gchar* dom_tree_to_text (xmlNodePtr tree);
 gboolean string_to_binary (const gchar* str,  void** v, guint64* data_len);
 gboolean dom_tree_create_instance_slots (xmlNodePtr node, QofInstance* inst);
 
+/* Slots read from SAX events, for sixtp_dom_slots_parser_new(): the
+ * elements inside a *:slots element go to a reader instead of into the
+ * DOM tree, and dom_tree_create_instance_slots() on the empty slots
+ * node takes the slots from the reader finished on it.  Finished
+ * readers belong to the thread until dom_slots_release(); free them
+ * when the nodes are gone. */
+struct DomSlotsReader;
+DomSlotsReader* dom_slots_reader_new (xmlNodePtr node);
+void dom_slots_reader_start (DomSlotsReader* reader, const gchar* tag,
+                             gchar** attrs);
+void dom_slots_reader_characters (DomSlotsReader* reader, const char* text,
+                                  int length);
+void dom_slots_reader_end (DomSlotsReader* reader);
+/** Attaches the slots read to the node given to dom_slots_reader_new(). */
+void dom_slots_reader_finish (DomSlotsReader* reader);
+/** Frees a reader that wasn't finished. */
+void dom_slots_reader_free (DomSlotsReader* reader);
+void dom_slots_release (void);
+
 gboolean dom_tree_to_integer (xmlNodePtr node, gint64* daint);
 gboolean dom_tree_to_guint16 (xmlNodePtr node, guint16* i);
 gboolean dom_tree_to_guint (xmlNodePtr node, guint* i);
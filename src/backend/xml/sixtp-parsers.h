@@ -35,4 +35,14 @@ sixtp* sixtp_dom_parser_new (sixtp_end_handler ender,
                              sixtp_result_handler cleanup_result_by_default_func,
                              sixtp_result_handler cleanup_result_on_fail_func);
 
+/* As sixtp_dom_parser_new(), but the slots of accounts, lots,
+   transactions and splits are read straight into KVP rather than into
+   the tree; the slots nodes are left empty for
+   dom_tree_create_instance_slots() to pick the slots up from.  The
+   tree must not outlive the start of the next one.
+*/
+sixtp* sixtp_dom_slots_parser_new (sixtp_end_handler ender,
+                                   sixtp_result_handler cleanup_result_by_default_func,
+                                   sixtp_result_handler cleanup_result_on_fail_func);
+
 #endif /* _SIXTP_PARSERS_H_ */
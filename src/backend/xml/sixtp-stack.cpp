@@ -40,15 +40,17 @@ sixtp_stack_frame_destroy (sixtp_stack_frame* sf)
     g_slist_free (sf->data_from_children);
     sf->data_from_children = NULL;
 
-    g_free (sf);
+    g_slice_free (sixtp_stack_frame, sf);
 }
 
 sixtp_stack_frame*
-sixtp_stack_frame_new (sixtp* next_parser, char* tag)
+sixtp_stack_frame_new (sixtp* next_parser, const gchar* tag)
 {
     sixtp_stack_frame* new_frame;
 
-    new_frame = g_new0 (sixtp_stack_frame, 1);
+    /* A frame is made and destroyed for every element, so they come from
+       the slice allocator's per-thread free lists rather than malloc. */
+    new_frame = g_slice_new0 (sixtp_stack_frame);
     new_frame->parser = next_parser;
     new_frame->tag = tag;
     new_frame->data_for_children = NULL;
@@ -134,6 +136,7 @@ sixtp_context_new (sixtp* initial_parser, gpointer global_data,
     ret->data.parsing_ok = TRUE;
     ret->data.stack = NULL;
     ret->data.global_data = global_data;
+    ret->data.interned_names = g_hash_table_new (g_direct_hash, g_direct_equal);
 
     ret->top_frame = sixtp_stack_frame_new (initial_parser, NULL);
 
@@ -182,6 +185,7 @@ sixtp_context_destroy (sixtp_parser_context* context)
 {
     sixtp_stack_frame_destroy (context->top_frame);
     g_slist_free (context->data.stack);
+    g_hash_table_destroy (context->data.interned_names);
     context->data.saxParserCtxt->userData = NULL;
     context->data.saxParserCtxt->sax = NULL;
     xmlFreeParserCtxt (context->data.saxParserCtxt);
@@ -30,11 +30,30 @@ extern "C"
 }
 
 #include "sixtp-parsers.h"
+#include "sixtp-dom-parsers.h"
 #include "sixtp-utils.h"
 #include "sixtp.h"
 
 static xmlNsPtr global_namespace = NULL;
 
+/* The fragments are built in a document with a dictionary so that their
+ * element and attribute names are interned instead of being allocated
+ * anew for every node.  The names of a book come from a small fixed set,
+ * so the document lives as long as the process and is never freed.
+ */
+static xmlDocPtr
+dom_fragment_doc (void)
+{
+    static xmlDocPtr doc = NULL;
+
+    if (!doc)
+    {
+        doc = xmlNewDoc (BAD_CAST "1.0");
+        doc->dict = xmlDictCreate ();
+    }
+    return doc;
+}
+
 /* Don't pass anything in the data_for_children value to this
    function.  It'll cause a segfault */
 static gboolean dom_start_handler (
@@ -47,7 +66,8 @@ static gboolean dom_start_handler (
 
     if (parent_data == NULL)
     {
-        thing = xmlNewNode (global_namespace, BAD_CAST tag);
+        thing = xmlNewDocNode (dom_fragment_doc (), global_namespace,
+                               BAD_CAST tag, NULL);
         /* only publish the result if we're the parent */
         *result = thing;
     }
@@ -65,12 +85,7 @@ static gboolean dom_start_handler (
     {
         while (*atptr != 0)
         {
-            gchar* attr0 = g_strdup (atptr[0]);
-            gchar* attr1 = g_strdup (atptr[1]);
-            xmlSetProp (thing, checked_char_cast (attr0),
-                        checked_char_cast (attr1));
-            g_free (attr0);
-            g_free (attr1);
+            xmlSetProp (thing, BAD_CAST atptr[0], BAD_CAST atptr[1]);
             atptr += 2;
         }
     }
@@ -93,13 +108,10 @@ static gboolean dom_chars_handler (
     GSList* sibling_data, gpointer parent_data, gpointer global_data,
     gpointer* result, const char* text, int length)
 {
+    /* libxml2 has already rejected input that is not valid UTF-8 or
+     * holds control characters, so the text needs no checked copy. */
     if (length > 0)
-    {
-        gchar* newtext = g_strdup (text);
-        xmlNodeAddContentLen ((xmlNodePtr)parent_data,
-                              checked_char_cast (newtext), length);
-        g_free (newtext);
-    }
+        xmlNodeAddContentLen ((xmlNodePtr)parent_data, BAD_CAST text, length);
     return TRUE;
 }
 
@@ -141,3 +153,127 @@ sixtp_dom_parser_new (sixtp_end_handler ender,
 
     return top_level;
 }
+
+/* The slots elements of the objects whose parsers read them from SAX. */
+static const gchar* slots_tags[] =
+{
+    "act:slots", "lot:slots", "trn:slots", "split:slots", NULL
+};
+
+static gboolean dom_slots_top_start_handler (
+    GSList* sibling_data, gpointer parent_data, gpointer global_data,
+    gpointer* data_for_children, gpointer* result, const gchar* tag,
+    gchar** attrs)
+{
+    /* The tree of the last object, and with it its slots nodes, is gone. */
+    if (parent_data == NULL)
+        dom_slots_release ();
+    return dom_start_handler (sibling_data, parent_data, global_data,
+                              data_for_children, result, tag, attrs);
+}
+
+static gboolean dom_slots_start_handler (
+    GSList* sibling_data, gpointer parent_data, gpointer global_data,
+    gpointer* data_for_children, gpointer* result, const gchar* tag,
+    gchar** attrs)
+{
+    auto thing = xmlNewChild ((xmlNodePtr) parent_data, global_namespace,
+                              BAD_CAST tag, NULL);
+    *result = NULL;
+    *data_for_children = dom_slots_reader_new (thing);
+    return TRUE;
+}
+
+static gboolean
+dom_slots_end_handler (gpointer data_for_children,
+                       GSList* data_from_children, GSList* sibling_data,
+                       gpointer parent_data, gpointer global_data,
+                       gpointer* result, const gchar* tag)
+{
+    dom_slots_reader_finish (static_cast<DomSlotsReader*> (data_for_children));
+    return TRUE;
+}
+
+static void
+dom_slots_fail_handler (gpointer data_for_children,
+                        GSList* data_from_children,
+                        GSList* sibling_data,
+                        gpointer parent_data,
+                        gpointer global_data,
+                        gpointer* result,
+                        const gchar* tag)
+{
+    dom_slots_reader_free (static_cast<DomSlotsReader*> (data_for_children));
+}
+
+static gboolean dom_slot_start_handler (
+    GSList* sibling_data, gpointer parent_data, gpointer global_data,
+    gpointer* data_for_children, gpointer* result, const gchar* tag,
+    gchar** attrs)
+{
+    dom_slots_reader_start (static_cast<DomSlotsReader*> (parent_data), tag,
+                            attrs);
+    *result = NULL;
+    *data_for_children = parent_data;
+    return TRUE;
+}
+
+static gboolean dom_slot_chars_handler (
+    GSList* sibling_data, gpointer parent_data, gpointer global_data,
+    gpointer* result, const char* text, int length)
+{
+    if (length > 0)
+        dom_slots_reader_characters (static_cast<DomSlotsReader*> (parent_data),
+                                     text, length);
+    return TRUE;
+}
+
+static gboolean
+dom_slot_end_handler (gpointer data_for_children,
+                      GSList* data_from_children, GSList* sibling_data,
+                      gpointer parent_data, gpointer global_data,
+                      gpointer* result, const gchar* tag)
+{
+    dom_slots_reader_end (static_cast<DomSlotsReader*> (data_for_children));
+    return TRUE;
+}
+
+sixtp*
+sixtp_dom_slots_parser_new (sixtp_end_handler ender,
+                            sixtp_result_handler cleanup_result_by_default_func,
+                            sixtp_result_handler cleanup_result_on_fail_func)
+{
+    sixtp* top_level;
+    sixtp* slots_parser;
+    sixtp* slot_parser;
+
+    if (! (top_level = sixtp_dom_parser_new (ender,
+                                             cleanup_result_by_default_func,
+                                             cleanup_result_on_fail_func)))
+        return NULL;
+    sixtp_set_start (top_level, dom_slots_top_start_handler);
+
+    slots_parser = sixtp_set_any (sixtp_new (), FALSE,
+                                  SIXTP_START_HANDLER_ID, dom_slots_start_handler,
+                                  SIXTP_CHARACTERS_HANDLER_ID, dom_slot_chars_handler,
+                                  SIXTP_END_HANDLER_ID, dom_slots_end_handler,
+                                  SIXTP_FAIL_HANDLER_ID, dom_slots_fail_handler,
+                                  SIXTP_NO_MORE_HANDLERS);
+    slot_parser = sixtp_set_any (sixtp_new (), FALSE,
+                                 SIXTP_START_HANDLER_ID, dom_slot_start_handler,
+                                 SIXTP_CHARACTERS_HANDLER_ID, dom_slot_chars_handler,
+                                 SIXTP_END_HANDLER_ID, dom_slot_end_handler,
+                                 SIXTP_NO_MORE_HANDLERS);
+    if (!slots_parser || !slot_parser ||
+        !sixtp_add_sub_parser (slot_parser, SIXTP_MAGIC_CATCHER, slot_parser) ||
+        !sixtp_add_sub_parser (slots_parser, SIXTP_MAGIC_CATCHER, slot_parser))
+    {
+        sixtp_destroy (top_level);
+        return NULL;
+    }
+
+    for (auto tag = slots_tags; *tag; ++tag)
+        sixtp_add_sub_parser (top_level, *tag, slots_parser);
+
+    return top_level;
+}
@@ -37,6 +37,9 @@ extern "C"
 #endif
 }
 
+#include <string>
+#include <vector>
+
 #include "sixtp.h"
 #include "sixtp-parsers.h"
 #include "sixtp-stack.h"
@@ -68,7 +71,6 @@ sixtp_child_result_destroy (sixtp_child_result* r)
     {
         r->cleanup_handler (r);
     }
-    if (r->type == SIXTP_CHILD_RESULT_NODE) g_free (r->tag);
     g_free (r);
 }
 
@@ -151,7 +153,7 @@ sixtp_new (void)
 
     if (s)
     {
-        s->child_parsers = g_hash_table_new (g_str_hash, g_str_equal);
+        s->child_parsers = g_hash_table_new (g_direct_hash, g_direct_equal);
         if (!s->child_parsers)
         {
             g_free (s);
@@ -267,7 +269,6 @@ sixtp_destroy_child (gpointer key, gpointer value, gpointer user_data)
     gpointer lookup_value;
 
     g_debug ("Killing sixtp child under key <%s>", key ? (char*) key : "(null)");
-    g_free (key);
 
     if (!corpses)
     {
@@ -312,7 +313,7 @@ sixtp_add_sub_parser (sixtp* parser, const gchar* tag, sixtp* sub_parser)
     g_return_val_if_fail (sub_parser, FALSE);
 
     g_hash_table_insert (parser->child_parsers,
-                         g_strdup (tag), (gpointer) sub_parser);
+                         (gpointer) g_intern_string (tag), (gpointer) sub_parser);
     return (TRUE);
 }
 
@@ -381,42 +382,46 @@ sixtp_add_some_sub_parsers (sixtp* tochange, int cleanup, ...)
 
 /************************************************************************/
 
-void
-sixtp_sax_start_handler (void* user_data,
-                         const xmlChar* name,
-                         const xmlChar** attrs)
+/* libxml2 hands the handlers the names from its dictionary, which stay
+ * put as long as the parser context, so each is interned only once.
+ * Names it doesn't own aren't remembered, since their memory may be
+ * reused for another name.
+ */
+static const gchar*
+sixtp_intern_name (GHashTable* interned, xmlDictPtr dict, const xmlChar* name)
 {
-    sixtp_sax_data* pdata = (sixtp_sax_data*) user_data;
+    auto tag = static_cast<const gchar*> (g_hash_table_lookup (interned, name));
+    if (tag)
+        return tag;
+    tag = g_intern_string ((const gchar*) name);
+    if (dict && xmlDictOwns (dict, name) == 1)
+        g_hash_table_insert (interned, (gpointer) name, (gpointer) tag);
+    return tag;
+}
+
+static void
+sixtp_start_element (sixtp_sax_data* pdata, const gchar* tag,
+                     const xmlChar** attrs)
+{
+    static const gchar* magic_catcher = g_intern_static_string (SIXTP_MAGIC_CATCHER);
     sixtp_stack_frame* current_frame = NULL;
     sixtp* current_parser = NULL;
     sixtp* next_parser = NULL;
-    gchar* next_parser_tag = NULL;
-    gboolean lookup_success = FALSE;
     sixtp_stack_frame* new_frame = NULL;
 
     current_frame = (sixtp_stack_frame*) pdata->stack->data;
     current_parser = current_frame->parser;
 
-    /* Use an extended lookup so we can get *our* copy of the key.
-       Since we've strduped it, we know its lifetime... */
-    lookup_success =
-        g_hash_table_lookup_extended (current_parser->child_parsers,
-                                      name,
-                                      reinterpret_cast<void**> (&next_parser_tag),
-                                      reinterpret_cast<void**> (&next_parser));
-
-
-    if (!lookup_success)
+    next_parser = static_cast<sixtp*> (
+        g_hash_table_lookup (current_parser->child_parsers, tag));
+    if (!next_parser)
     {
         /* magic catch all value */
-        lookup_success = g_hash_table_lookup_extended (
-                             current_parser->child_parsers, SIXTP_MAGIC_CATCHER,
-                             reinterpret_cast<void**> (&next_parser_tag),
-                             reinterpret_cast<void**> (&next_parser));
-        if (!lookup_success)
+        next_parser = static_cast<sixtp*> (
+            g_hash_table_lookup (current_parser->child_parsers, magic_catcher));
+        if (!next_parser)
         {
-            g_critical ("Tag <%s> not allowed in current context.",
-                        name ? (char*) name : "(null)");
+            g_critical ("Tag <%s> not allowed in current context.", tag);
             pdata->parsing_ok = FALSE;
             next_parser = pdata->bad_xml_parser;
         }
@@ -444,14 +449,22 @@ sixtp_sax_start_handler (void* user_data,
                                                  pdata->global_data,
                                                  & (current_frame->frame_data),
                                                  current_frame->tag,
-                                                 (gchar*) name);
+                                                 tag);
     }
 
     /* now allocate the new stack frame and shift to it */
-    new_frame = sixtp_stack_frame_new (next_parser, g_strdup ((char*) name));
+    new_frame = sixtp_stack_frame_new (next_parser, tag);
 
-    new_frame->line = xmlSAX2GetLineNumber (pdata->saxParserCtxt);
-    new_frame->col  = xmlSAX2GetColumnNumber (pdata->saxParserCtxt);
+    if (pdata->replaying)
+    {
+        new_frame->line = pdata->replay_line;
+        new_frame->col  = pdata->replay_col;
+    }
+    else
+    {
+        new_frame->line = xmlSAX2GetLineNumber (pdata->saxParserCtxt);
+        new_frame->col  = xmlSAX2GetColumnNumber (pdata->saxParserCtxt);
+    }
 
     pdata->stack = g_slist_prepend (pdata->stack, (gpointer) new_frame);
 
@@ -463,11 +476,23 @@ sixtp_sax_start_handler (void* user_data,
                                         pdata->global_data,
                                         &new_frame->data_for_children,
                                         &new_frame->frame_data,
-                                        (gchar*) name,
+                                        tag,
                                         (gchar**)attrs);
     }
 }
 
+void
+sixtp_sax_start_handler (void* user_data,
+                         const xmlChar* name,
+                         const xmlChar** attrs)
+{
+    sixtp_sax_data* pdata = (sixtp_sax_data*) user_data;
+    sixtp_start_element (pdata, sixtp_intern_name (pdata->interned_names,
+                                                   pdata->saxParserCtxt->dict,
+                                                   name),
+                         attrs);
+}
+
 void
 sixtp_sax_characters_handler (void* user_data, const xmlChar* text, int len)
 {
@@ -503,32 +528,32 @@ sixtp_sax_characters_handler (void* user_data, const xmlChar* text, int len)
     }
 }
 
-void
-sixtp_sax_end_handler (void* user_data, const xmlChar* name)
+static void
+sixtp_end_element (sixtp_sax_data* pdata, const gchar* tag)
 {
-    sixtp_sax_data* pdata = (sixtp_sax_data*) user_data;
     sixtp_stack_frame* current_frame;
     sixtp_stack_frame* parent_frame;
     sixtp_child_result* child_result_data = NULL;
-    gchar* end_tag = NULL;
+    const gchar* end_tag = NULL;
 
     current_frame = (sixtp_stack_frame*) pdata->stack->data;
     parent_frame = (sixtp_stack_frame*) pdata->stack->next->data;
 
     /* time to make sure we got the right closing tag.  Is this really
        necessary? */
-    if (g_strcmp0 (current_frame->tag, (gchar*) name) != 0)
+    if (current_frame->tag != tag)
     {
-        g_warning ("bad closing tag (start <%s>, end <%s>)", current_frame->tag, name);
+        g_warning ("bad closing tag (start <%s>, end <%s>)",
+                   current_frame->tag ? current_frame->tag : "(null)", tag);
         pdata->parsing_ok = FALSE;
 
         /* See if we're just off by one and try to recover */
-        if (g_strcmp0 (parent_frame->tag, (gchar*) name) == 0)
+        if (parent_frame->tag == tag)
         {
             pdata->stack = sixtp_pop_and_destroy_frame (pdata->stack);
             current_frame = (sixtp_stack_frame*) pdata->stack->data;
             parent_frame = (sixtp_stack_frame*) pdata->stack->next->data;
-            g_warning ("found matching start <%s> tag up one level", name);
+            g_warning ("found matching start <%s> tag up one level", tag);
         }
     }
 
@@ -551,7 +576,7 @@ sixtp_sax_end_handler (void* user_data, const xmlChar* name)
         child_result_data = g_new (sixtp_child_result, 1);
 
         child_result_data->type = SIXTP_CHILD_RESULT_NODE;
-        child_result_data->tag = g_strdup (current_frame->tag);
+        child_result_data->tag = current_frame->tag;
         child_result_data->data = current_frame->frame_data;
         child_result_data->should_cleanup = TRUE;
         child_result_data->cleanup_handler = current_frame->parser->cleanup_result;
@@ -561,7 +586,7 @@ sixtp_sax_end_handler (void* user_data, const xmlChar* name)
             g_slist_prepend (parent_frame->data_from_children, child_result_data);
     }
 
-    /* grab it before it goes away - we own the reference */
+    /* grab it before the frame goes away */
     end_tag = current_frame->tag;
 
     g_debug ("Finished with end of <%s>", end_tag ? end_tag : "(null)");
@@ -602,8 +627,15 @@ sixtp_sax_end_handler (void* user_data, const xmlChar* name)
                                                 end_tag,
                                                 child_result_data);
     }
+}
 
-    g_free (end_tag);
+void
+sixtp_sax_end_handler (void* user_data, const xmlChar* name)
+{
+    sixtp_sax_data* pdata = (sixtp_sax_data*) user_data;
+    sixtp_end_element (pdata, sixtp_intern_name (pdata->interned_names,
+                                                 pdata->saxParserCtxt->dict,
+                                                 name));
 }
 
 xmlEntityPtr
@@ -693,12 +725,251 @@ gnc_bad_xml_end_handler (gpointer data_for_children,
     return TRUE;
 }
 
+/* Pipelined parsing: libxml2 tokenizes the document on a thread of its
+ * own and records the SAX events in batches, which the calling thread
+ * replays through the sixtp handlers.  Building the engine objects is
+ * not thread safe, so all of the handlers still run on the calling
+ * thread; what overlaps is the reading, decompressing and tokenizing of
+ * the input with the construction of the book.
+ */
+#define SIXTP_EVENT_BATCH_SIZE 4096
+#define SIXTP_EVENT_BATCHES 8
+
+enum class SaxEventType { START, CHARS, END };
+
+struct SaxEvent
+{
+    SaxEventType type;
+    const gchar* tag;                   /* interned tag name */
+    std::string text;                   /* character data */
+    std::vector<std::string> attrs;     /* name, value, name, value, ... */
+    size_t n_attrs;
+    int line;
+    int col;
+};
+
+struct SaxEventBatch
+{
+    std::vector<SaxEvent> events;
+    size_t used;
+    gboolean last;
+    SaxEventBatch () : events (SIXTP_EVENT_BATCH_SIZE), used (0), last (FALSE) {}
+};
+
+struct SaxPipeline
+{
+    xmlParserCtxtPtr xml_context;
+    GAsyncQueue* full;
+    GAsyncQueue* free;
+    GHashTable* interned_names;         /* used only by the parser thread */
+    SaxEventBatch* current;
+    gint abort;
+    int parse_ret;
+};
+
+static SaxEvent*
+sax_pipeline_next_event (SaxPipeline* p, SaxEventType type)
+{
+    if (!p->current)
+        p->current = static_cast<SaxEventBatch*> (g_async_queue_pop (p->free));
+    auto event = &p->current->events[p->current->used];
+    event->type = type;
+    event->n_attrs = 0;
+    event->line = xmlSAX2GetLineNumber (p->xml_context);
+    event->col = xmlSAX2GetColumnNumber (p->xml_context);
+    return event;
+}
+
+static void
+sax_pipeline_commit_event (SaxPipeline* p)
+{
+    if (++p->current->used == SIXTP_EVENT_BATCH_SIZE)
+    {
+        g_async_queue_push (p->full, p->current);
+        p->current = NULL;
+    }
+}
+
+static void
+sax_pipeline_start (void* user_data, const xmlChar* name,
+                    const xmlChar** attrs)
+{
+    auto p = static_cast<SaxPipeline*> (user_data);
+    if (g_atomic_int_get (&p->abort))
+        return;
+    auto event = sax_pipeline_next_event (p, SaxEventType::START);
+    event->tag = sixtp_intern_name (p->interned_names, p->xml_context->dict,
+                                    name);
+    for (const xmlChar** attr = attrs; attr && *attr; ++attr)
+    {
+        if (event->n_attrs == event->attrs.size ())
+            event->attrs.emplace_back ();
+        event->attrs[event->n_attrs++].assign ((const char*) *attr);
+    }
+    sax_pipeline_commit_event (p);
+}
+
+static void
+sax_pipeline_characters (void* user_data, const xmlChar* text, int len)
+{
+    auto p = static_cast<SaxPipeline*> (user_data);
+    if (g_atomic_int_get (&p->abort))
+        return;
+    auto event = sax_pipeline_next_event (p, SaxEventType::CHARS);
+    event->text.assign ((const char*) text, len);
+    sax_pipeline_commit_event (p);
+}
+
+static void
+sax_pipeline_end (void* user_data, const xmlChar* name)
+{
+    auto p = static_cast<SaxPipeline*> (user_data);
+    if (g_atomic_int_get (&p->abort))
+        return;
+    auto event = sax_pipeline_next_event (p, SaxEventType::END);
+    event->tag = sixtp_intern_name (p->interned_names, p->xml_context->dict,
+                                    name);
+    sax_pipeline_commit_event (p);
+}
+
+static xmlEntityPtr
+sax_pipeline_get_entity (void* user_data, const xmlChar* name)
+{
+    return xmlGetPredefinedEntity (name);
+}
+
+static gpointer
+sax_pipeline_thread_func (gpointer data)
+{
+    auto p = static_cast<SaxPipeline*> (data);
+
+    p->parse_ret = xmlParseDocument (p->xml_context);
+
+    if (!p->current)
+        p->current = static_cast<SaxEventBatch*> (g_async_queue_pop (p->free));
+    p->current->last = TRUE;
+    g_async_queue_push (p->full, p->current);
+    p->current = NULL;
+    return NULL;
+}
+
+static void
+sax_pipeline_replay (sixtp_sax_data* pdata, const SaxEventBatch* batch)
+{
+    std::vector<const xmlChar*> attrs;
+
+    for (size_t i = 0; i < batch->used; ++i)
+    {
+        const SaxEvent& event = batch->events[i];
+        switch (event.type)
+        {
+        case SaxEventType::START:
+            attrs.clear ();
+            for (size_t j = 0; j < event.n_attrs; ++j)
+                attrs.push_back ((const xmlChar*) event.attrs[j].c_str ());
+            attrs.push_back (NULL);
+            pdata->replay_line = event.line;
+            pdata->replay_col = event.col;
+            sixtp_start_element (pdata, event.tag,
+                                 event.n_attrs ? attrs.data () : NULL);
+            break;
+        case SaxEventType::CHARS:
+            sixtp_sax_characters_handler (pdata,
+                                          (const xmlChar*) event.text.c_str (),
+                                          event.text.size ());
+            break;
+        case SaxEventType::END:
+            sixtp_end_element (pdata, event.tag);
+            break;
+        }
+    }
+}
+
+/* Runs xmlParseDocument on a parser thread and replays its events into
+ * ctxt.  Returns the result of xmlParseDocument, or falls back to
+ * parsing on the calling thread if no thread can be started.
+ */
+static int
+sixtp_parse_pipelined (sixtp_parser_context* ctxt)
+{
+    xmlParserCtxtPtr xml_context = ctxt->data.saxParserCtxt;
+    xmlSAXHandler handler;
+    SaxPipeline p;
+    SaxEventBatch batches[SIXTP_EVENT_BATCHES];
+    GThread* thread;
+    GError* error = NULL;
+    gboolean last = FALSE;
+
+    p.xml_context = xml_context;
+    p.full = g_async_queue_new ();
+    p.free = g_async_queue_new ();
+    p.interned_names = g_hash_table_new (g_direct_hash, g_direct_equal);
+    p.current = NULL;
+    p.abort = 0;
+    p.parse_ret = -1;
+    for (auto& batch : batches)
+        g_async_queue_push (p.free, &batch);
+
+    memset (&handler, '\0', sizeof (xmlSAXHandler));
+    handler.startElement = sax_pipeline_start;
+    handler.endElement = sax_pipeline_end;
+    handler.characters = sax_pipeline_characters;
+    handler.getEntity = sax_pipeline_get_entity;
+    xml_context->sax = &handler;
+    xml_context->userData = &p;
+
+#ifndef HAVE_GLIB_2_32
+    thread = g_thread_create (sax_pipeline_thread_func, &p, TRUE, &error);
+#else
+    thread = g_thread_try_new ("sixtp_parser", sax_pipeline_thread_func, &p,
+                               &error);
+#endif
+
+    if (!thread)
+    {
+        g_warning ("Could not create XML parser thread: %s",
+                   error ? error->message : "unknown error");
+        if (error)
+            g_error_free (error);
+        xml_context->sax = &ctxt->handler;
+        xml_context->userData = &ctxt->data;
+        p.parse_ret = xmlParseDocument (xml_context);
+    }
+    else
+    {
+        ctxt->data.replaying = TRUE;
+        while (!last)
+        {
+            auto batch = static_cast<SaxEventBatch*> (g_async_queue_pop (p.full));
+            sax_pipeline_replay (&ctxt->data, batch);
+            last = batch->last;
+            batch->used = 0;
+            batch->last = FALSE;
+            g_async_queue_push (p.free, batch);
+            /* A failed handler fails the whole parse; spare the parser
+             * thread from recording the rest of the document. */
+            if (!ctxt->data.parsing_ok)
+                g_atomic_int_set (&p.abort, 1);
+        }
+        g_thread_join (thread);
+        ctxt->data.replaying = FALSE;
+        xml_context->sax = &ctxt->handler;
+        xml_context->userData = &ctxt->data;
+    }
+
+    g_async_queue_unref (p.full);
+    g_async_queue_unref (p.free);
+    g_hash_table_destroy (p.interned_names);
+    return p.parse_ret;
+}
+
 static gboolean
 sixtp_parse_file_common (sixtp* sixtp,
                          xmlParserCtxtPtr xml_context,
                          gpointer data_for_top_level,
                          gpointer global_data,
-                         gpointer* parse_result)
+                         gpointer* parse_result,
+                         gboolean pipelined)
 {
     sixtp_parser_context* ctxt;
     int parse_ret;
@@ -714,7 +985,10 @@ sixtp_parse_file_common (sixtp* sixtp,
     ctxt->data.saxParserCtxt->userData = &ctxt->data;
     ctxt->data.bad_xml_parser = sixtp_dom_parser_new (gnc_bad_xml_end_handler,
                                                       NULL, NULL);
-    parse_ret = xmlParseDocument (ctxt->data.saxParserCtxt);
+    if (pipelined)
+        parse_ret = sixtp_parse_pipelined (ctxt);
+    else
+        parse_ret = xmlParseDocument (ctxt->data.saxParserCtxt);
     //xmlSAXUserParseFile(&ctxt->handler, &ctxt->data, filename);
 
     sixtp_context_run_end_handler (ctxt);
@@ -762,7 +1036,7 @@ sixtp_parse_file (sixtp* sixtp,
     context = xmlCreateFileParserCtxt (filename);
 #endif
     ret = sixtp_parse_file_common (sixtp, context, data_for_top_level,
-                                   global_data, parse_result);
+                                   global_data, parse_result, TRUE);
     return ret;
 }
 
@@ -790,7 +1064,7 @@ sixtp_parse_fd (sixtp* sixtp,
                                                       sixtp_parser_read, NULL /*no close */, fd,
                                                       XML_CHAR_ENCODING_NONE);
     ret = sixtp_parse_file_common (sixtp, context, data_for_top_level,
-                                   global_data, parse_result);
+                                   global_data, parse_result, TRUE);
     return ret;
 }
 
@@ -805,10 +1079,47 @@ sixtp_parse_buffer (sixtp* sixtp,
     gboolean ret;
     xmlParserCtxtPtr context = xmlCreateMemoryParserCtxt (bufp, bufsz);
     ret = sixtp_parse_file_common (sixtp, context, data_for_top_level,
-                                   global_data, parse_result);
+                                   global_data, parse_result, FALSE);
     return ret;
 }
 
+gboolean
+sixtp_parse_static_buffer (sixtp* sixtp,
+                           const char* bufp,
+                           int bufsz,
+                           gpointer data_for_top_level,
+                           gpointer global_data,
+                           gpointer* parse_result)
+{
+    xmlParserCtxtPtr context;
+    xmlParserInputBufferPtr buffer;
+    xmlParserInputPtr input;
+
+    /* xmlCreateMemoryParserCtxt copies the whole buffer, so set up the
+     * context the same way around a static input buffer instead. */
+    context = xmlNewParserCtxt ();
+    if (!context)
+        return FALSE;
+    buffer = xmlParserInputBufferCreateStatic (bufp, bufsz,
+                                               XML_CHAR_ENCODING_NONE);
+    if (!buffer)
+    {
+        xmlFreeParserCtxt (context);
+        return FALSE;
+    }
+    input = xmlNewIOInputStream (context, buffer, XML_CHAR_ENCODING_NONE);
+    if (!input)
+    {
+        xmlFreeParserInputBuffer (buffer);
+        xmlFreeParserCtxt (context);
+        return FALSE;
+    }
+    inputPush (context, input);
+
+    return sixtp_parse_file_common (sixtp, context, data_for_top_level,
+                                    global_data, parse_result, TRUE);
+}
+
 gboolean
 sixtp_parse_push (sixtp* sixtp,
                   sixtp_push_handler push_handler,
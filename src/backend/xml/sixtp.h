@@ -148,6 +148,8 @@ typedef struct sixtp
     /* called to cleanup character results when cleaning up this node's
        children. */
 
+    /* Keyed by tags interned with g_intern_string, so the lookup hashes
+       and compares pointers. */
     GHashTable* child_parsers;
 } sixtp;
 
@@ -183,7 +185,7 @@ typedef enum
 struct _sixtp_child_result
 {
     sixtp_child_result_type type;
-    gchar* tag; /* NULL for a CHARS node. */
+    const gchar* tag; /* interned; NULL for a CHARS node. */
     gpointer data;
     gboolean should_cleanup;
     sixtp_result_handler cleanup_handler;
@@ -197,6 +199,13 @@ typedef struct sixtp_sax_data
     gpointer global_data;
     xmlParserCtxtPtr saxParserCtxt;
     sixtp* bad_xml_parser;
+    /* Set while replaying events recorded by the parser thread, whose
+     * recorded position then replaces the one of saxParserCtxt. */
+    gboolean replaying;
+    int replay_line;
+    int replay_col;
+    /* The interned tag of each name from saxParserCtxt's dictionary. */
+    GHashTable* interned_names;
 } sixtp_sax_data;
 
 gboolean is_child_result_from_node_named (sixtp_child_result* cr,
@@ -227,6 +236,12 @@ gboolean sixtp_parse_fd (sixtp* sixtp, FILE* fd,
 gboolean sixtp_parse_buffer (sixtp* sixtp, char* bufp, int bufsz,
                              gpointer data_for_top_level, gpointer global_data,
                              gpointer* parse_result);
+/* Like sixtp_parse_buffer, but parses bufp in place without copying it;
+ * bufp must stay valid and unchanged until the parse returns. */
+gboolean sixtp_parse_static_buffer (sixtp* sixtp, const char* bufp, int bufsz,
+                                    gpointer data_for_top_level,
+                                    gpointer global_data,
+                                    gpointer* parse_result);
 gboolean sixtp_parse_push (sixtp* sixtp, sixtp_push_handler push_handler,
                            gpointer push_user_data, gpointer data_for_top_level,
                            gpointer global_data, gpointer* parse_result);
@@ -236,6 +236,36 @@ test_dom_tree_to_gnc_numeric (void)
         do_test_args (message == NULL, "gnc_num 18768786810/100000",
                       __FILE__, __LINE__, message);
     }
+
+    {
+        /* Text gnc_numeric_to_string doesn't write is still read as
+         * string_to_gnc_numeric reads it. */
+        struct
+        {
+            const char* text;
+            gint64 num;
+            gint64 denom;
+        } cases[] =
+        {
+            { "-9223372036854775808/1", G_MININT64, 1 },
+            { "9223372036854775807/100", G_MAXINT64, 100 },
+            { "-0/1", 0, 1 },
+            { "0x10/100", 16, 100 },
+            { " 7/10", 7, 10 },
+            { "12/100abc", 12, 100 },
+        };
+        for (auto& c : cases)
+        {
+            xmlNodePtr node = xmlNewNode (NULL, BAD_CAST "test-num");
+            xmlNodeAddContent (node, BAD_CAST c.text);
+            gnc_numeric* num = dom_tree_to_gnc_numeric (node);
+            do_test_args (num && num->num == c.num && num->denom == c.denom,
+                          "dom_tree_to_gnc_numeric text", __FILE__, __LINE__,
+                          "%s", c.text);
+            g_free (num);
+            xmlFreeNode (node);
+        }
+    }
 }
 
 
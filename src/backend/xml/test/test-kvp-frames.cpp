@@ -15,6 +15,8 @@ extern "C"
 #include "test-file-stuff.h"
 #include "sixtp-dom-generators.h"
 #include "sixtp-dom-parsers.h"
+#include "sixtp-parsers.h"
+#include "sixtp-utils.h"
 
 #define GNC_V2_STRING "gnc-v2"
 const gchar* gnc_v2_xml_version_string = GNC_V2_STRING;
@@ -182,6 +184,70 @@ test_kvp_xml_stuff (void)
     }
 }
 
+static gboolean
+grab_dom_tree_end_handler (gpointer data_for_children,
+                           GSList* data_from_children, GSList* sibling_data,
+                           gpointer parent_data, gpointer global_data,
+                           gpointer* result, const gchar* tag)
+{
+    if (!parent_data && tag)
+        *static_cast<xmlNodePtr*> (global_data) =
+            static_cast<xmlNodePtr> (data_for_children);
+    return TRUE;
+}
+
+/* The slots read from SAX must be what the DOM tree gives. */
+static void
+test_kvp_sax_stuff (void)
+{
+    auto top = sixtp_new ();
+    sixtp_set_chars (top, allow_and_ignore_only_whitespace);
+    sixtp_add_sub_parser (top, "gnc:account",
+                          sixtp_dom_slots_parser_new (grab_dom_tree_end_handler,
+                                                      NULL, NULL));
+    for (int i = 0; i < 20; i++)
+    {
+        auto inst = static_cast<QofInstance*> (g_object_new (QOF_TYPE_INSTANCE, NULL));
+        inst->kvp_data = get_random_kvp_frame ();
+        auto msg = "SAX slots";
+
+        GncXmlStreamWriter writer;
+        writer.start_element ("gnc:account");
+        qof_instance_slots_to_xml_stream (writer, "act:slots", inst);
+        writer.end_element ("gnc:account");
+        auto xml = writer.take ();
+
+        xmlNodePtr tree = NULL;
+        gpointer parse_result = NULL;
+        if (!sixtp_parse_buffer (top, &xml[0], xml.size (), NULL, &tree,
+                                 &parse_result) || !tree)
+        {
+            failure_args (msg, __FILE__, __LINE__, "parse failed");
+            g_object_unref (inst);
+            continue;
+        }
+        auto slots = tree->xmlChildrenNode;
+        auto test_frame2 = slots ? dom_tree_to_kvp_frame (slots) : NULL;
+        if (test_frame2 && !slots->xmlChildrenNode &&
+            compare (inst->kvp_data, test_frame2) == 0)
+        {
+            success (msg);
+        }
+        else
+        {
+            failure (msg);
+            printf ("  With KvpFrame 1:\n%s\n",
+                    inst->kvp_data->to_string ().c_str ());
+            printf ("  and XML:\n%s\n", xml.c_str ());
+        }
+        delete test_frame2;
+        xmlFreeNode (tree);
+        dom_slots_release ();
+        g_object_unref (inst);
+    }
+    sixtp_destroy (top);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -190,6 +256,7 @@ main (int argc, char** argv)
     test_kvp_printing ();
     test_kvp_frames1 ();
     test_kvp_xml_stuff ();
+    test_kvp_sax_stuff ();
     print_test_results ();
     exit (get_rv ());
 }
@@ -63,6 +63,23 @@ test_load_file (const char* filename)
         failure_args ("example account load", __FILE__, __LINE__, "for file %s",
                       filename);
     }
+
+    gea = gnc_read_example_account_header (filename);
+
+    if (gea != NULL && gea->title != NULL && gea->root == NULL)
+    {
+        success ("example account header load");
+        do_test (gnc_example_account_load_accounts (gea) && gea->root != NULL,
+                 "example account load accounts");
+        gnc_destroy_example_account (gea);
+    }
+    else
+    {
+        failure_args ("example account header load", __FILE__, __LINE__,
+                      "for file %s", filename);
+        if (gea)
+            gnc_destroy_example_account (gea);
+    }
 }
 
 static void
@@ -111,6 +128,16 @@ guile_main (void* closure, int argc, char** argv)
         gnc_free_example_account_list (list);
     }
 
+    {
+        const GSList* index = gnc_get_example_account_index (location);
+
+        do_test (index != NULL, "gnc_get_example_account_index");
+        do_test (index == gnc_get_example_account_index (location),
+                 "gnc_get_example_account_index is cached");
+
+        gnc_clear_example_account_index ();
+    }
+
 
     print_test_results ();
     exit (get_rv ());
@@ -51,11 +51,52 @@ extern "C"
 #include "../gnc-xml.h"
 #include "../sixtp-parsers.h"
 #include "../sixtp-dom-parsers.h"
+#include "../sixtp-dom-generators.h"
 #include "../io-gncxml-gen.h"
 #include <test-file-stuff.h>
 
 static QofBook* book;
 
+static gchar*
+read_back (FILE* file)
+{
+    GString* str = g_string_new (NULL);
+    char buf[4096];
+    size_t len;
+
+    rewind (file);
+    while ((len = fread (buf, 1, sizeof (buf), file)) > 0)
+        g_string_append_len (str, buf, len);
+    fclose (file);
+    return g_string_free (str, FALSE);
+}
+
+/* The streaming writer has to produce exactly what xmlElemDump() makes
+ * of the tree. */
+static gboolean
+stream_matches_dom (xmlNodePtr node, Transaction* trn)
+{
+    FILE* dom_file = tmpfile ();
+    FILE* stream_file = tmpfile ();
+    gboolean ret;
+
+    xmlElemDump (dom_file, NULL, node);
+    {
+        GncXmlStreamWriter writer (stream_file);
+        gnc_transaction_to_xml_stream (writer, trn);
+        writer.flush ();
+    }
+
+    auto dom_text = read_back (dom_file);
+    auto stream_text = read_back (stream_file);
+    ret = g_strcmp0 (dom_text, stream_text) == 0;
+    if (!ret)
+        printf ("DOM:\n%s\nstream:\n%s\n", dom_text, stream_text);
+    g_free (dom_text);
+    g_free (stream_text);
+    return ret;
+}
+
 extern gboolean gnc_transaction_xml_v2_testing;
 
 static xmlNodePtr
@@ -442,6 +483,12 @@ test_transaction (void)
             success_args ("transaction_xml", __FILE__, __LINE__, "%d", i);
         }
 
+        if (!stream_matches_dom (test_node, ran_trn))
+            failure_args ("transaction_xml", __FILE__, __LINE__,
+                          "streamed transaction differs from the DOM dump");
+        else
+            success_args ("transaction_xml stream", __FILE__, __LINE__, "%d", i);
+
         filename1 = g_strdup_printf ("test_file_XXXXXX");
 
         fd = g_mkstemp (filename1);
@@ -35,6 +35,7 @@
 #include "gnc-locale-utils.h"
 #include "core-utils/gnc-version.h"
 #include "gnc-engine.h"
+#include "gnc-memory-report.h"
 #include "gnc-environment.h"
 #include "gnc-filepath-utils.h"
 #include "gnc-ui-util.h"
@@ -86,6 +87,9 @@ static int          nofile           = 0;
 static const gchar *gsettings_prefix = NULL;
 static const char  *add_quotes_file  = NULL;
 static char        *namespace_regexp = NULL;
+static const char  *memory_report_file = NULL;
+static gchar      **batch_reports    = NULL;
+static const char  *batch_report_dir = NULL;
 static const char  *file_to_load     = NULL;
 static gchar      **args_remaining   = NULL;
 
@@ -143,6 +147,27 @@ static GOptionEntry options[] =
            http://developer.gnome.org/doc/API/2.0/glib/glib-Commandline-option-parser.html */
         N_("REGEXP")
     },
+    {
+        "memory-report", '\0', 0, G_OPTION_ARG_STRING, &memory_report_file,
+        N_("Print what the given GnuCash datafile takes up in memory, by object type, and exit"),
+        /* Translators: Argument description for autohelp; see
+           http://developer.gnome.org/doc/API/2.0/glib/glib-Commandline-option-parser.html */
+        N_("FILE")
+    },
+    {
+        "run-report", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &batch_reports,
+        N_("Open the datafile read-only, write the report or saved report of the given name as HTML and exit, without starting the user interface.\nThis can be invoked multiple times."),
+        /* Translators: Argument description for autohelp; see
+           http://developer.gnome.org/doc/API/2.0/glib/glib-Commandline-option-parser.html */
+        N_("REPORT")
+    },
+    {
+        "report-dir", '\0', 0, G_OPTION_ARG_STRING, &batch_report_dir,
+        N_("Directory for the files written by --run-report; defaults to the current directory"),
+        /* Translators: Argument description for autohelp; see
+           http://developer.gnome.org/doc/API/2.0/glib/glib-Commandline-option-parser.html */
+        N_("DIR")
+    },
     {
         G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &args_remaining, NULL, N_("[datafile]") },
     { NULL }
@@ -481,53 +506,91 @@ gnc_parse_command_line(int *argc, char ***argv)
         file_to_load = args_remaining[0];
 }
 
+/* The startup timing trace, shown with --log gnc.startup=info */
+static QofLogModule startup_log_module = "gnc.startup";
+static GTimer *startup_timer = NULL;
+
 static void
-load_gnucash_modules()
+startup_trace(const gchar *stage)
+{
+    if (!startup_timer || !qof_log_check(startup_log_module, QOF_LOG_INFO))
+        return;
+    g_log(startup_log_module, G_LOG_LEVEL_INFO, "%8.3fs %s",
+          g_timer_elapsed(startup_timer, NULL), stage);
+}
+
+/* The deferred modules only add importers and plugins to the main
+ * windows, which take them whenever they are registered; they are
+ * loaded once the windows are shown. */
+static struct
+{
+    gchar * name;
+    int version;
+    gboolean optional;
+    gboolean deferred;
+} modules[] =
+{
+    { "gnucash/app-utils", 0, FALSE, FALSE },
+    { "gnucash/engine", 0, FALSE, FALSE },
+    { "gnucash/register/ledger-core", 0, FALSE, FALSE },
+    { "gnucash/register/register-core", 0, FALSE, FALSE },
+    { "gnucash/register/register-gnome", 0, FALSE, FALSE },
+    { "gnucash/import-export/qif-import", 0, FALSE, TRUE },
+    { "gnucash/import-export/ofx", 0, TRUE, TRUE },
+    { "gnucash/import-export/csv-import", 0, TRUE, TRUE },
+    { "gnucash/import-export/csv-export", 0, TRUE, TRUE },
+    { "gnucash/import-export/log-replay", 0, TRUE, TRUE },
+    { "gnucash/import-export/aqbanking", 0, TRUE, TRUE },
+    { "gnucash/report/report-system", 0, FALSE, FALSE },
+    { "gnucash/report/stylesheets", 0, FALSE, FALSE },
+    { "gnucash/report/standard-reports", 0, FALSE, FALSE },
+    { "gnucash/report/utility-reports", 0, FALSE, FALSE },
+    { "gnucash/report/locale-specific/us", 0, FALSE, FALSE },
+    { "gnucash/report/report-gnome", 0, FALSE, FALSE },
+    { "gnucash/business-gnome", 0, TRUE, FALSE },
+    { "gnucash/gtkmm", 0, TRUE, FALSE },
+    { "gnucash/python", 0, TRUE, FALSE },
+    { "gnucash/plugins/bi_import", 0, TRUE, TRUE },
+    { "gnucash/plugins/customer_import", 0, TRUE, TRUE },
+};
+
+static void
+load_gnucash_module_list(gboolean deferred)
 {
     int i, len;
-    struct
-    {
-        gchar * name;
-        int version;
-        gboolean optional;
-    } modules[] =
-    {
-        { "gnucash/app-utils", 0, FALSE },
-        { "gnucash/engine", 0, FALSE },
-        { "gnucash/register/ledger-core", 0, FALSE },
-        { "gnucash/register/register-core", 0, FALSE },
-        { "gnucash/register/register-gnome", 0, FALSE },
-        { "gnucash/import-export/qif-import", 0, FALSE },
-        { "gnucash/import-export/ofx", 0, TRUE },
-        { "gnucash/import-export/csv-import", 0, TRUE },
-        { "gnucash/import-export/csv-export", 0, TRUE },
-        { "gnucash/import-export/log-replay", 0, TRUE },
-        { "gnucash/import-export/aqbanking", 0, TRUE },
-        { "gnucash/report/report-system", 0, FALSE },
-        { "gnucash/report/stylesheets", 0, FALSE },
-        { "gnucash/report/standard-reports", 0, FALSE },
-        { "gnucash/report/utility-reports", 0, FALSE },
-        { "gnucash/report/locale-specific/us", 0, FALSE },
-        { "gnucash/report/report-gnome", 0, FALSE },
-        { "gnucash/business-gnome", 0, TRUE },
-        { "gnucash/gtkmm", 0, TRUE },
-        { "gnucash/python", 0, TRUE },
-        { "gnucash/plugins/bi_import", 0, TRUE},
-        { "gnucash/plugins/customer_import", 0, TRUE},
-    };
 
     /* module initializations go here */
     len = sizeof(modules) / sizeof(*modules);
     for (i = 0; i < len; i++)
     {
+        if (modules[i].deferred != deferred)
+            continue;
         DEBUG("Loading module %s started", modules[i].name);
-        gnc_update_splash_screen(modules[i].name, GNC_SPLASH_PERCENTAGE_UNKNOWN);
+        if (!deferred)
+            gnc_update_splash_screen(modules[i].name, GNC_SPLASH_PERCENTAGE_UNKNOWN);
         if (modules[i].optional)
             gnc_module_load_optional(modules[i].name, modules[i].version);
         else
             gnc_module_load(modules[i].name, modules[i].version);
         DEBUG("Loading module %s finished", modules[i].name);
+        startup_trace(modules[i].name);
     }
+}
+
+static gboolean
+load_deferred_gnucash_modules(gpointer data)
+{
+    load_gnucash_module_list(TRUE);
+    startup_trace("deferred modules loaded");
+    g_timer_destroy(startup_timer);
+    startup_timer = NULL;
+    return FALSE;
+}
+
+static void
+load_gnucash_modules()
+{
+    load_gnucash_module_list(FALSE);
     if (!gnc_engine_is_initialized())
     {
         /* On Windows this check used to fail anyway, see
@@ -554,6 +617,7 @@ inner_main_add_price_quotes(void *closure, int argc, char **argv)
        GUI is not initialized */
 #ifdef PRICE_QUOTES_NEED_MODULES
     load_gnucash_modules();
+    load_gnucash_module_list(TRUE);
 #endif
     gnc_prefs_init ();
     qof_event_suspend();
@@ -599,6 +663,164 @@ fail:
     gnc_shutdown(1);
 }
 
+static void
+inner_main_memory_report(void *closure, int argc, char **argv)
+{
+    QofSession *session = NULL;
+
+    gnc_module_load("gnucash/engine", 0);
+    if (!gnc_engine_is_initialized())
+    {
+        g_warning("GnuCash engine failed to initialize.  Exiting.\n");
+        gnc_shutdown(1);
+    }
+    gnc_prefs_init ();
+    qof_event_suspend();
+
+    session = gnc_get_current_session();
+    if (!session) goto fail;
+
+    qof_session_begin(session, memory_report_file, TRUE, FALSE, FALSE);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR) goto fail;
+
+    qof_session_load(session, NULL);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR) goto fail;
+
+    gnc_memory_report_write(qof_session_get_book(session), stdout, 20);
+
+    qof_session_end(session);
+    gnc_clear_current_session();
+    qof_event_resume();
+    gnc_shutdown(0);
+    return;
+fail:
+    if (session && qof_session_get_error(session) != ERR_BACKEND_NO_ERR)
+        g_warning("Session Error: %s", qof_session_get_error_message(session));
+    qof_event_resume();
+    gnc_shutdown(1);
+}
+
+static void
+batch_report_error_handler(const char *error_message)
+{
+    g_printerr("%s\n", error_message);
+}
+
+/* Renders the report template called name and writes it to a file named
+ * after it in batch_report_dir. */
+static gboolean
+run_batch_report(const gchar *name)
+{
+    SCM template_id, report;
+    gchar *html = NULL, *base, *filename, *path;
+    GError *error = NULL;
+    gboolean ok;
+    gint report_id;
+
+    template_id = scm_call_1(scm_c_eval_string("gnc:report-template-name-to-id"),
+                             scm_from_utf8_string(name));
+    if (scm_is_false(template_id))
+    {
+        g_printerr(_("There is no report named \"%s\".\n"), name);
+        return FALSE;
+    }
+    report = scm_call_1(scm_c_eval_string("gnc:make-report"), template_id);
+    report_id = scm_to_int(report);
+
+    ok = gnc_run_report(report_id, &html);
+    gnc_report_remove_by_id(report_id);
+    if (!ok || !html)
+    {
+        g_printerr(_("The report \"%s\" could not be run.\n"), name);
+        g_free(html);
+        return FALSE;
+    }
+
+    base = g_strcanon(g_strdup(name),
+                      G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "-_", '_');
+    filename = g_strconcat(base, ".html", NULL);
+    path = g_build_filename(batch_report_dir ? batch_report_dir : ".",
+                            filename, NULL);
+    ok = g_file_set_contents(path, html, -1, &error);
+    if (ok)
+        g_print("%s\n", path);
+    else
+    {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+    }
+    g_free(path);
+    g_free(filename);
+    g_free(base);
+    g_free(html);
+    return ok;
+}
+
+static void
+inner_main_run_reports(void *closure, int argc, char **argv)
+{
+    QofSession *session = NULL;
+    gchar **name;
+    int failures = 0;
+
+    scm_c_eval_string("(debug-set! stack 200000)");
+    scm_set_current_module(scm_c_resolve_module("gnucash main"));
+
+    /* The report modules, less the stylesheets' gnc-module, which adds
+     * a menu plugin; the stylesheets themselves are plain scheme. */
+    gnc_module_load("gnucash/app-utils", 0);
+    gnc_module_load("gnucash/engine", 0);
+    if (!gnc_engine_is_initialized())
+    {
+        g_warning("GnuCash engine failed to initialize.  Exiting.\n");
+        gnc_shutdown(1);
+    }
+    gnc_module_load("gnucash/report/report-system", 0);
+    gnc_module_load("gnucash/report/standard-reports", 0);
+    gnc_module_load("gnucash/report/utility-reports", 0);
+    gfec_eval_string("(use-modules (gnucash report stylesheets))",
+                     batch_report_error_handler);
+    gfec_eval_string("(use-modules (gnucash report business-reports))",
+                     batch_report_error_handler);
+    gnc_prefs_init ();
+
+    /* The saved reports are among the user's configuration */
+    load_system_config();
+    load_user_config();
+
+    if (!file_to_load)
+    {
+        g_printerr(_("A datafile must be given to run reports on.\n"));
+        gnc_shutdown(1);
+    }
+
+    qof_event_suspend();
+    session = gnc_get_current_session();
+    if (!session) goto fail;
+
+    qof_session_begin(session, file_to_load, TRUE, FALSE, FALSE);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR) goto fail;
+
+    qof_session_load(session, NULL);
+    if (qof_session_get_error(session) != ERR_BACKEND_NO_ERR) goto fail;
+
+    for (name = batch_reports; *name; name++)
+        if (!run_batch_report(*name))
+            failures++;
+
+    /* Read-only: there is nothing to save */
+    qof_session_end(session);
+    gnc_clear_current_session();
+    qof_event_resume();
+    gnc_shutdown(failures ? 1 : 0);
+    return;
+fail:
+    if (session && qof_session_get_error(session) != ERR_BACKEND_NO_ERR)
+        g_warning("Session Error: %s", qof_session_get_error_message(session));
+    qof_event_resume();
+    gnc_shutdown(1);
+}
+
 static char *
 get_file_to_load()
 {
@@ -624,6 +846,7 @@ inner_main (void *closure, int argc, char **argv)
      * Migrate the user's preferences from gconf if needed */
     gnc_gsettings_migrate_from_gconf();
 
+    startup_trace("guile started");
     load_gnucash_modules();
 
     /* Load the config before starting up the gui. This insures that
@@ -631,15 +854,18 @@ inner_main (void *closure, int argc, char **argv)
      * menu is created. */
     load_system_config();
     load_user_config();
+    startup_trace("config loaded");
 
     /* Setting-up the report menu must come after the module
        loading but before the gui initialization. */
     scm_c_use_module("gnucash report report-gnome");
     scm_c_eval_string("(gnc:report-menu-setup)");
+    startup_trace("report menu set up");
 
     /* TODO: After some more guile-extraction, this should happen even
        before booting guile.  */
     gnc_main_gui_init();
+    startup_trace("gui initialized");
 
     gnc_hook_add_dangler(HOOK_UI_SHUTDOWN, (GFunc)gnc_file_quit, NULL);
 
@@ -647,6 +873,7 @@ inner_main (void *closure, int argc, char **argv)
     gnc_update_splash_screen(_("Checking Finance::Quote..."), GNC_SPLASH_PERCENTAGE_UNKNOWN);
     scm_c_use_module("gnucash price-quotes");
     scm_c_eval_string("(gnc:price-quotes-install-sources)");
+    startup_trace("quote sources installed");
 
     gnc_hook_run(HOOK_STARTUP, NULL);
 
@@ -655,6 +882,7 @@ inner_main (void *closure, int argc, char **argv)
         gnc_update_splash_screen(_("Loading data..."), GNC_SPLASH_PERCENTAGE_UNKNOWN);
         gnc_file_open_file(fn, /*open_readonly*/ FALSE);
         g_free(fn);
+        startup_trace("data file loaded");
     }
     else if (gnc_prefs_get_bool(GNC_PREFS_GROUP_NEW_USER, GNC_PREF_FIRST_STARTUP))
     {
@@ -666,6 +894,8 @@ inner_main (void *closure, int argc, char **argv)
 
     gnc_destroy_splash_screen();
     gnc_main_window_show_all_windows();
+    startup_trace("main window shown");
+    g_idle_add(load_deferred_gnucash_modules, NULL);
 
     gnc_hook_run(HOOK_UI_POST_STARTUP, NULL);
     gnc_ui_start_event_loop();
@@ -784,6 +1014,7 @@ main(int argc, char ** argv)
     }
 #endif
     
+    startup_timer = g_timer_new();
     gnc_parse_command_line(&argc, &argv);
     gnc_print_unstable_message();
 
@@ -807,6 +1038,22 @@ main(int argc, char ** argv)
         exit(0);  /* never reached */
     }
 
+    /* Likewise for the memory report, which needs no user interface */
+    if (memory_report_file)
+    {
+        gnc_module_system_init();
+        scm_boot_guile(argc, argv, inner_main_memory_report, 0);
+        exit(0);  /* never reached */
+    }
+
+    /* And for batch reports, which render without a display */
+    if (batch_reports)
+    {
+        gnc_module_system_init();
+        scm_boot_guile(argc, argv, inner_main_run_reports, 0);
+        exit(0);  /* never reached */
+    }
+
     /* We need to initialize gtk before looking up all modules */
     gnc_gtk_add_rc_file ();
     if(!gtk_init_check (&argc, &argv))
@@ -820,7 +1067,9 @@ main(int argc, char ** argv)
 
     /* Now the module files are looked up, which might cause some library
     initialization to be run, hence gtk must be initialized beforehand. */
+    startup_trace("gtk initialized");
     gnc_module_system_init();
+    startup_trace("module files looked up");
 
     gnc_gui_init();
     scm_boot_guile(argc, argv, inner_main, 0);
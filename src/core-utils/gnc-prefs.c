@@ -34,6 +34,10 @@ static gboolean extras_enabled    = FALSE;
 static gboolean use_compression   = TRUE; // This is also the default in the prefs backend
 static gint file_retention_policy = 1;    // 1 = "days", the default in the prefs backend
 static gint file_retention_days   = 30;   // This is also the default in the prefs backend
+static gint file_compression_level   = 6; // This is also the default in the prefs backend
+static gboolean use_snapshot      = FALSE; // This is also the default in the prefs backend
+static gboolean use_journal       = FALSE; // This is also the default in the prefs backend
+static gint file_compression_threads = 0; // 0 = one per processor, the default in the prefs backend
 
 PrefsBackend *prefsbackend = NULL;
 
@@ -92,6 +96,54 @@ gnc_prefs_set_file_save_compressed(gboolean compressed)
     use_compression = compressed;
 }
 
+gboolean
+gnc_prefs_get_file_save_snapshot(void)
+{
+    return use_snapshot;
+}
+
+void
+gnc_prefs_set_file_save_snapshot(gboolean snapshot)
+{
+    use_snapshot = snapshot;
+}
+
+gboolean
+gnc_prefs_get_file_save_journal(void)
+{
+    return use_journal;
+}
+
+void
+gnc_prefs_set_file_save_journal(gboolean journal)
+{
+    use_journal = journal;
+}
+
+gint
+gnc_prefs_get_file_compression_level(void)
+{
+    return file_compression_level;
+}
+
+void
+gnc_prefs_set_file_compression_level(gint level)
+{
+    file_compression_level = level;
+}
+
+gint
+gnc_prefs_get_file_compression_threads(void)
+{
+    return file_compression_threads;
+}
+
+void
+gnc_prefs_set_file_compression_threads(gint threads)
+{
+    file_compression_threads = threads;
+}
+
 gint
 gnc_prefs_get_file_retention_policy(void)
 {
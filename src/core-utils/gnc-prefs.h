@@ -107,6 +107,25 @@ void gnc_prefs_set_extra(gboolean enabled);
 gboolean gnc_prefs_get_file_save_compressed(void);
 void gnc_prefs_set_file_save_compressed(gboolean compressed);
 
+/** Whether to keep an uncompressed snapshot beside compressed data files
+ *  and reopen them from it. */
+gboolean gnc_prefs_get_file_save_snapshot(void);
+void gnc_prefs_set_file_save_snapshot(gboolean snapshot);
+
+/** Whether saves between full saves of an XML file only append the
+ *  changed transactions to a journal.  Read when a file is opened. */
+gboolean gnc_prefs_get_file_save_journal(void);
+void gnc_prefs_set_file_save_journal(gboolean journal);
+
+/** The zlib compression level (0-9) used when saving compressed files. */
+gint gnc_prefs_get_file_compression_level(void);
+void gnc_prefs_set_file_compression_level(gint level);
+
+/** The number of threads compressing a file being saved. 0 means one
+ *  per processor, 1 disables parallel compression. */
+gint gnc_prefs_get_file_compression_threads(void);
+void gnc_prefs_set_file_compression_threads(gint threads);
+
 gint gnc_prefs_get_file_retention_policy(void);
 void gnc_prefs_set_file_retention_policy(gint policy);
 
@@ -39,6 +39,7 @@
 #include "gnc-glib-utils.h"
 #include "gnc-lot.h"
 #include "gnc-pricedb.h"
+#include "gnc-pricedb-p.h"
 #include "qofinstance-p.h"
 #include "gnc-features.h"
 
@@ -119,6 +120,10 @@ enum
 \********************************************************************/
 
 static void xaccAccountBringUpToDate (Account *acc);
+static void account_free_balance_index (AccountPrivate *priv);
+static void account_free_split_list (AccountPrivate *priv);
+static void lot_index_destroy (AccountPrivate *priv);
+static void bayes_model_destroy (AccountPrivate *priv);
 
 
 /********************************************************************\
@@ -151,12 +156,14 @@ gnc_set_account_separator (const gchar *separator)
     {
         account_uc_separator = ':';
         strcpy(account_separator, ":");
+        full_names_changed ();
         return;
     }
 
     account_uc_separator = uc;
     count = g_unichar_to_utf8(uc, account_separator);
     account_separator[count] = '\0';
+    full_names_changed ();
 }
 
 gchar *gnc_account_name_violations_errmsg (const gchar *separator, GList* invalid_account_names)
@@ -229,6 +236,43 @@ GList *gnc_account_list_name_violations (QofBook *book, const gchar *separator)
 /********************************************************************\
 \********************************************************************/
 
+/* Bumped whenever a balance, the tree's shape or a commodity changes,
+ * making all cached subtree totals stale; see account_subtree_total(). */
+static guint subtree_totals_generation = 1;
+
+static inline void
+subtree_totals_changed (void)
+{
+    subtree_totals_generation++;
+}
+
+/* Bumped whenever a split is added, removed or changed or the tree's
+ * shape changes, making all cached subtree split statistics stale; see
+ * account_get_subtree_stats(). */
+static guint subtree_stats_generation = 1;
+
+static inline void
+subtree_stats_changed (void)
+{
+    subtree_stats_generation++;
+}
+
+/* Bumped whenever a name, the tree's shape or the separator changes,
+ * making all cached full names stale. */
+static guint full_names_generation = 1;
+
+static inline void
+full_names_changed (void)
+{
+    full_names_generation++;
+}
+
+guint
+gnc_account_get_names_generation (void)
+{
+    return full_names_generation;
+}
+
 G_INLINE_FUNC void mark_account (Account *acc);
 void
 mark_account (Account *acc)
@@ -274,8 +318,24 @@ gnc_account_init(Account* acc)
     priv->starting_reconciled_balance = gnc_numeric_zero();
     priv->balance_dirty = FALSE;
 
-    priv->splits = NULL;
+    priv->splits = g_ptr_array_new ();
     priv->sort_dirty = FALSE;
+    priv->split_list = NULL;
+    priv->split_list_built = FALSE;
+    priv->unreconciled = g_hash_table_new (NULL, NULL);
+    priv->splits_pending = FALSE;
+
+    priv->balance_blocks = NULL;
+    priv->balance_index_dirty = TRUE;
+    priv->date_index = NULL;
+    priv->date_index_dirty = TRUE;
+    priv->desc_index = NULL;
+    priv->desc_index_dirty = TRUE;
+    priv->online_id_index = NULL;
+    priv->online_id_index_dirty = TRUE;
+    priv->subtree_totals = NULL;
+    priv->subtree_totals_stamp = 0;
+    priv->subtree_stats_stamp = 0;
 }
 
 static void
@@ -1004,11 +1064,122 @@ gnc_account_class_init (AccountClass *klass)
 
 }
 
+/********************************************************************\
+ * The name and code index
+ *
+ * The accounts of a book by name and by code, built on the first
+ * lookup and kept up to date as accounts are created, renamed and
+ * freed.  Membership in a particular tree isn't indexed; the lookups
+ * check the ancestors of the few accounts sharing a name instead, so
+ * moving accounts around needs no upkeep.
+\********************************************************************/
+
+#define ACCOUNT_NAME_INDEX "gnc-account-name-index"
+
+typedef struct
+{
+    GHashTable *by_name;        /* name -> GPtrArray of Account* */
+    GHashTable *by_code;        /* code -> GPtrArray of Account* */
+} AccountNameIndex;
+
+static void
+account_name_index_destroy (QofBook *book, gpointer key, gpointer data)
+{
+    AccountNameIndex *index = data;
+    g_hash_table_destroy (index->by_name);
+    g_hash_table_destroy (index->by_code);
+    g_free (index);
+}
+
+static void
+name_table_add (GHashTable *table, const char *key, Account *acc)
+{
+    GPtrArray *accounts = g_hash_table_lookup (table, key ? key : "");
+
+    if (!accounts)
+    {
+        accounts = g_ptr_array_new ();
+        g_hash_table_insert (table, g_strdup (key ? key : ""), accounts);
+    }
+    g_ptr_array_add (accounts, acc);
+}
+
+static void
+name_table_remove (GHashTable *table, const char *key, Account *acc)
+{
+    GPtrArray *accounts = g_hash_table_lookup (table, key ? key : "");
+
+    if (!accounts)
+        return;
+    g_ptr_array_remove_fast (accounts, acc);
+    if (accounts->len == 0)
+        g_hash_table_remove (table, key ? key : "");
+}
+
+static void
+account_name_index_add (Account *acc, gpointer data)
+{
+    AccountNameIndex *index = data;
+    AccountPrivate *priv = GET_PRIVATE(acc);
+
+    name_table_add (index->by_name, priv->accountName, acc);
+    name_table_add (index->by_code, priv->accountCode, acc);
+}
+
+static AccountNameIndex *
+get_account_name_index (QofBook *book, gboolean build)
+{
+    AccountNameIndex *index;
+
+    /* The book data is finalized before the accounts are freed. */
+    if (!book || qof_book_shutting_down (book))
+        return NULL;
+
+    index = qof_book_get_data (book, ACCOUNT_NAME_INDEX);
+    if (index || !build)
+        return index;
+
+    index = g_new0 (AccountNameIndex, 1);
+    index->by_name = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            (GDestroyNotify)g_ptr_array_unref);
+    index->by_code = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            (GDestroyNotify)g_ptr_array_unref);
+    qof_collection_foreach (qof_book_get_collection (book, GNC_ID_ACCOUNT),
+                            (QofInstanceForeachCB)account_name_index_add,
+                            index);
+    qof_book_set_data_fin (book, ACCOUNT_NAME_INDEX, index,
+                           account_name_index_destroy);
+    return index;
+}
+
+static void
+account_name_index_insert (Account *acc)
+{
+    AccountNameIndex *index = get_account_name_index (gnc_account_get_book (acc),
+                              FALSE);
+    if (index)
+        account_name_index_add (acc, index);
+}
+
+static void
+account_name_index_remove (Account *acc)
+{
+    AccountNameIndex *index = get_account_name_index (gnc_account_get_book (acc),
+                              FALSE);
+    AccountPrivate *priv = GET_PRIVATE(acc);
+
+    if (!index)
+        return;
+    name_table_remove (index->by_name, priv->accountName, acc);
+    name_table_remove (index->by_code, priv->accountCode, acc);
+}
+
 static void
 xaccInitAccount (Account * acc, QofBook *book)
 {
     ENTER ("book=%p\n", book);
     qof_instance_init_data (&acc->inst, GNC_ID_ACCOUNT, book);
+    account_name_index_insert (acc);
 
     LEAVE ("account=%p\n", acc);
 }
@@ -1119,7 +1290,9 @@ gnc_account_create_root (QofBook *book)
     rpriv = GET_PRIVATE(root);
     xaccAccountBeginEdit(root);
     rpriv->type = ACCT_TYPE_ROOT;
+    account_name_index_remove (root);
     CACHE_REPLACE(rpriv->accountName, "Root Account");
+    account_name_index_insert (root);
     mark_account (root);
     xaccAccountCommitEdit(root);
     gnc_book_set_root_account(book, root);
@@ -1148,9 +1321,11 @@ xaccCloneAccount(const Account *from, QofBook *book)
      * Also let caller issue the generate_event (EVENT_CREATE) */
     priv->type = from_priv->type;
 
+    account_name_index_remove (ret);
     priv->accountName = CACHE_INSERT(from_priv->accountName);
     priv->accountCode = CACHE_INSERT(from_priv->accountCode);
     priv->description = CACHE_INSERT(from_priv->description);
+    account_name_index_insert (ret);
 
     qof_instance_copy_kvp (QOF_INSTANCE (ret), QOF_INSTANCE (from));
 
@@ -1236,32 +1411,38 @@ xaccFreeAccount (Account *acc)
         g_list_free (priv->lots);
         priv->lots = NULL;
     }
+    lot_index_destroy (priv);
+    bayes_model_destroy (priv);
 
     /* Next, clean up the splits */
     /* NB there shouldn't be any splits by now ... they should
      * have been all been freed by CommitEdit().  We can remove this
      * check once we know the warning isn't occurring any more. */
-    if (priv->splits)
+    if (priv->splits->len)
     {
-        GList *slist;
+        GPtrArray *slist;
+        guint i;
         PERR (" instead of calling xaccFreeAccount(), please call \n"
               " xaccAccountBeginEdit(); xaccAccountDestroy(); \n");
 
         qof_instance_reset_editlevel(acc);
 
-        slist = g_list_copy(priv->splits);
-        for (lp = slist; lp; lp = lp->next)
+        slist = g_ptr_array_sized_new (priv->splits->len);
+        for (i = 0; i < priv->splits->len; ++i)
+            g_ptr_array_add (slist, g_ptr_array_index (priv->splits, i));
+        for (i = 0; i < slist->len; ++i)
         {
-            Split *s = (Split *) lp->data;
+            Split *s = (Split *) g_ptr_array_index (slist, i);
             g_assert(xaccSplitGetAccount(s) == acc);
             xaccSplitDestroy (s);
         }
-        g_list_free(slist);
-/* Nothing here (or in xaccAccountCommitEdit) NULLs priv->splits, so this asserts every time.
-        g_assert(priv->splits == NULL);
+        g_ptr_array_free (slist, TRUE);
+/* Nothing here (or in xaccAccountCommitEdit) empties priv->splits, so this asserts every time.
+        g_assert(priv->splits->len == 0);
 */
     }
 
+    account_name_index_remove (acc);
     CACHE_REPLACE(priv->accountName, NULL);
     CACHE_REPLACE(priv->accountCode, NULL);
     CACHE_REPLACE(priv->description, NULL);
@@ -1282,6 +1463,28 @@ xaccFreeAccount (Account *acc)
 
     priv->balance_dirty = FALSE;
     priv->sort_dirty = FALSE;
+    account_free_balance_index (priv);
+    if (priv->desc_index)
+        g_hash_table_destroy (priv->desc_index);
+    priv->desc_index = NULL;
+    priv->desc_index_dirty = TRUE;
+    if (priv->online_id_index)
+        g_hash_table_destroy (priv->online_id_index);
+    priv->online_id_index = NULL;
+    priv->online_id_index_dirty = TRUE;
+    if (priv->subtree_totals)
+        g_array_free (priv->subtree_totals, TRUE);
+    priv->subtree_totals = NULL;
+    subtree_totals_changed ();
+    subtree_stats_changed ();
+    g_free (priv->full_name);
+    g_free (priv->full_name_key);
+    priv->full_name = priv->full_name_key = NULL;
+    account_free_split_list (priv);
+    g_ptr_array_free (priv->splits, TRUE);
+    priv->splits = NULL;
+    g_hash_table_destroy (priv->unreconciled);
+    priv->unreconciled = NULL;
 
     /* qof_instance_release (&acc->inst); */
     g_object_unref(acc);
@@ -1346,7 +1549,7 @@ xaccAccountCommitEdit (Account *acc)
     priv = GET_PRIVATE(acc);
     if (qof_instance_get_destroying(acc))
     {
-        GList *lp, *slist;
+        GList *lp;
         QofCollection *col;
 
         qof_instance_increase_editlevel(acc);
@@ -1363,18 +1566,25 @@ xaccAccountCommitEdit (Account *acc)
            themselves will be destroyed by the transaction code */
         if (!qof_book_shutting_down(book))
         {
-            slist = g_list_copy(priv->splits);
-            for (lp = slist; lp; lp = lp->next)
-            {
-                Split *s = lp->data;
-                xaccSplitDestroy (s);
-            }
-            g_list_free(slist);
+            GPtrArray *slist = g_ptr_array_sized_new (priv->splits->len);
+            guint i;
+
+            for (i = 0; i < priv->splits->len; ++i)
+                g_ptr_array_add (slist, g_ptr_array_index (priv->splits, i));
+            for (i = 0; i < slist->len; ++i)
+                xaccSplitDestroy (g_ptr_array_index (slist, i));
+            g_ptr_array_free (slist, TRUE);
         }
         else
         {
-            g_list_free(priv->splits);
-            priv->splits = NULL;
+            /* Emptied first so that nothing touches the splits, which
+             * may be freed before or after the accounts. */
+            g_ptr_array_set_size (priv->splits, 0);
+            g_hash_table_remove_all (priv->unreconciled);
+            account_free_balance_index (priv);
+            priv->desc_index_dirty = TRUE;
+            priv->online_id_index_dirty = TRUE;
+            account_free_split_list (priv);
         }
 
         /* It turns out there's a case where this assertion does not hold:
@@ -1399,12 +1609,17 @@ xaccAccountCommitEdit (Account *acc)
         }
         g_list_free(priv->lots);
         priv->lots = NULL;
+        lot_index_destroy (priv);
 
         qof_instance_set_dirty(&acc->inst);
         qof_instance_decrease_editlevel(acc);
     }
     else
     {
+        /* The edit may have changed the import map behind the back of
+         * the compiled model. */
+        if (!priv->bayes_model_updating)
+            bayes_model_destroy (priv);
         xaccAccountBringUpToDate(acc);
     }
 
@@ -1654,34 +1869,32 @@ xaccAccountEqual(const Account *aa, const Account *ab, gboolean check_guids)
     /* no parent; always compare downwards. */
 
     {
-        GList *la = priv_aa->splits;
-        GList *lb = priv_ab->splits;
+        GPtrArray *la = priv_aa->splits;
+        GPtrArray *lb = priv_ab->splits;
+        guint i;
 
-        if ((la && !lb) || (!la && lb))
+        if ((la->len && !lb->len) || (!la->len && lb->len))
         {
             PWARN ("only one has splits");
             return FALSE;
         }
 
-        if (la && lb)
+        if (la->len && lb->len)
         {
             /* presume that the splits are in the same order */
-            while (la && lb)
+            for (i = 0; i < la->len && i < lb->len; ++i)
             {
-                Split *sa = (Split *) la->data;
-                Split *sb = (Split *) lb->data;
+                Split *sa = (Split *) g_ptr_array_index (la, i);
+                Split *sb = (Split *) g_ptr_array_index (lb, i);
 
                 if (!xaccSplitEqual(sa, sb, check_guids, TRUE, FALSE))
                 {
                     PWARN ("splits differ");
                     return(FALSE);
                 }
-
-                la = la->next;
-                lb = lb->next;
             }
 
-            if ((la != NULL) || (lb != NULL))
+            if (la->len != lb->len)
             {
                 PWARN ("number of splits differs");
                 return(FALSE);
@@ -1712,6 +1925,7 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+    priv->date_index_dirty = TRUE;
 }
 
 void
@@ -1726,216 +1940,1281 @@ gnc_account_set_balance_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->balance_dirty = TRUE;
+    priv->balance_index_dirty = TRUE;
+    priv->date_index_dirty = TRUE;
+    subtree_totals_changed ();
 }
 
-/********************************************************************\
-\********************************************************************/
+/* The balance index
+ *
+ * The account's split vector is partitioned into blocks of about
+ * BALANCE_BLOCK_SIZE consecutive splits. Each block caches the sum of
+ * its splits' amounts and the running balances just before its first
+ * split. Inserting, removing or changing a split only marks its own
+ * block dirty; xaccAccountRecomputeBalance() then re-sums the dirty
+ * blocks and walks the block totals to move the start balances of the
+ * blocks after them. The running balances stored in the splits of a
+ * block whose start moved are rewritten lazily, the next time one of
+ * them is read.
+ */
 
-gboolean
-gnc_account_insert_split (Account *acc, Split *s)
+#define BALANCE_BLOCK_SIZE 256
+
+struct account_balance_block
 {
-    AccountPrivate *priv;
-    GList *node;
+    guint first;                /* index of the block's first split */
+    guint n_splits;
 
-    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
+    /* Sums of the amounts of the splits in the block */
+    gnc_numeric total;
+    gnc_numeric cleared_total;
+    gnc_numeric reconciled_total;
 
-    priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (node)
-        return FALSE;
+    /* Running balances before the first split of the block */
+    gnc_numeric start;
+    gnc_numeric cleared_start;
+    gnc_numeric reconciled_start;
 
-    if (qof_instance_get_editlevel(acc) == 0)
-    {
-        priv->splits = g_list_insert_sorted(priv->splits, s,
-                                            (GCompareFunc)xaccSplitOrder);
-    }
-    else
-    {
-        priv->splits = g_list_prepend(priv->splits, s);
-        priv->sort_dirty = TRUE;
-    }
+    gboolean dirty;             /* totals must be re-summed */
+    gboolean stale;             /* split balances lag a moved start */
+};
 
-    //FIXME: find better event
-    qof_event_gen (&acc->inst, QOF_EVENT_MODIFY, NULL);
-    /* Also send an event based on the account */
-    qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
+typedef struct account_balance_block AccountBalanceBlock;
 
-    priv->balance_dirty = TRUE;
-//  DRH: Should the below be added? It is present in the delete path.
-//  xaccAccountRecomputeBalance(acc);
-    return TRUE;
+#define SPLIT_AT(priv, i) ((Split *) g_ptr_array_index ((priv)->splits, (i)))
+#define BLOCK_AT(priv, i) \
+    ((AccountBalanceBlock *) g_ptr_array_index ((priv)->balance_blocks, (i)))
+
+static AccountBalanceBlock *
+balance_block_new (guint first)
+{
+    AccountBalanceBlock *block = g_new0 (AccountBalanceBlock, 1);
+
+    block->first = first;
+    block->total = gnc_numeric_zero ();
+    block->cleared_total = gnc_numeric_zero ();
+    block->reconciled_total = gnc_numeric_zero ();
+    block->start = gnc_numeric_zero ();
+    block->cleared_start = gnc_numeric_zero ();
+    block->reconciled_start = gnc_numeric_zero ();
+    block->dirty = TRUE;
+    return block;
 }
 
-gboolean
-gnc_account_remove_split (Account *acc, Split *s)
+/* Re-sum the block from its start balances, writing the running
+ * balances into its splits. */
+static void
+balance_block_sum (AccountPrivate *priv, AccountBalanceBlock *block)
 {
-    AccountPrivate *priv;
-    GList *node;
+    gnc_numeric balance = block->start;
+    gnc_numeric cleared_balance = block->cleared_start;
+    gnc_numeric reconciled_balance = block->reconciled_start;
+    guint i, end = MIN (block->first + block->n_splits, priv->splits->len);
 
-    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
+    for (i = block->first; i < end; ++i)
+    {
+        Split *split = SPLIT_AT (priv, i);
+        gnc_numeric amt = xaccSplitGetAmount (split);
 
-    priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (NULL == node)
-        return FALSE;
+        balance = gnc_numeric_add_fixed (balance, amt);
 
-    priv->splits = g_list_delete_link(priv->splits, node);
-    //FIXME: find better event type
-    qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
-    // And send the account-based event, too
-    qof_event_gen(&acc->inst, GNC_EVENT_ITEM_REMOVED, s);
+        if (NREC != split->reconciled)
+            cleared_balance = gnc_numeric_add_fixed (cleared_balance, amt);
 
-    priv->balance_dirty = TRUE;
-    xaccAccountRecomputeBalance(acc);
-    return TRUE;
+        if (YREC == split->reconciled || FREC == split->reconciled)
+            reconciled_balance =
+                gnc_numeric_add_fixed (reconciled_balance, amt);
+
+        split->balance = balance;
+        split->cleared_balance = cleared_balance;
+        split->reconciled_balance = reconciled_balance;
+    }
+
+    block->total = gnc_numeric_sub_fixed (balance, block->start);
+    block->cleared_total = gnc_numeric_sub_fixed (cleared_balance,
+                                                  block->cleared_start);
+    block->reconciled_total =
+        gnc_numeric_sub_fixed (reconciled_balance, block->reconciled_start);
+    block->dirty = FALSE;
+    block->stale = FALSE;
 }
 
-void
-xaccAccountSortSplits (Account *acc, gboolean force)
+/* Drop the index, detaching the splits still in the account, and the day
+ * index built over them. */
+static void
+account_free_balance_index (AccountPrivate *priv)
 {
-    AccountPrivate *priv;
+    guint i;
 
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    if (priv->date_index)
+        g_array_free (priv->date_index, TRUE);
+    priv->date_index = NULL;
+    priv->date_index_dirty = TRUE;
 
-    priv = GET_PRIVATE(acc);
-    if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
+    if (!priv->balance_blocks)
         return;
-    priv->splits = g_list_sort(priv->splits, (GCompareFunc)xaccSplitOrder);
-    priv->sort_dirty = FALSE;
-    priv->balance_dirty = TRUE;
+
+    for (i = 0; i < priv->splits->len; ++i)
+        SPLIT_AT (priv, i)->balance_block = NULL;
+
+    for (i = 0; i < priv->balance_blocks->len; ++i)
+        g_free (BLOCK_AT (priv, i));
+    g_ptr_array_free (priv->balance_blocks, TRUE);
+    priv->balance_blocks = NULL;
+    priv->balance_index_dirty = TRUE;
 }
 
+/* Partition the whole split vector into fresh, dirty blocks. Every
+ * split is reassigned, so there's no need to detach them first. */
 static void
-xaccAccountBringUpToDate(Account *acc)
+account_rebuild_balance_index (AccountPrivate *priv)
 {
-    if (!acc) return;
+    AccountBalanceBlock *block = NULL;
+    guint i;
 
-    /* if a re-sort happens here, then everything will update, so the
-       cost basis and balance calls are no-ops */
-    xaccAccountSortSplits(acc, FALSE);
-    xaccAccountRecomputeBalance(acc);
-}
+    if (priv->balance_blocks)
+    {
+        for (i = 0; i < priv->balance_blocks->len; ++i)
+            g_free (BLOCK_AT (priv, i));
+        g_ptr_array_set_size (priv->balance_blocks, 0);
+    }
+    else
+        priv->balance_blocks = g_ptr_array_new ();
 
-/********************************************************************\
-\********************************************************************/
+    for (i = 0; i < priv->splits->len; ++i)
+    {
+        if (!block || block->n_splits == BALANCE_BLOCK_SIZE)
+        {
+            block = balance_block_new (i);
+            g_ptr_array_add (priv->balance_blocks, block);
+        }
+        SPLIT_AT (priv, i)->balance_block = block;
+        ++block->n_splits;
+    }
+    priv->balance_index_dirty = FALSE;
+}
 
-void
-xaccAccountSetGUID (Account *acc, const GncGUID *guid)
+/* Position in balance_blocks of the block holding split @index. */
+static guint
+balance_block_find (AccountPrivate *priv, guint index)
 {
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
-    g_return_if_fail(guid);
+    guint lo = 0, hi = priv->balance_blocks->len;
 
-    /* XXX this looks fishy and weird to me ... */
-    PINFO("acct=%p", acc);
-    xaccAccountBeginEdit (acc);
-    qof_instance_set_guid (&acc->inst, guid);
-    qof_instance_set_dirty(&acc->inst);
-    xaccAccountCommitEdit (acc);
-}
+    while (hi - lo > 1)
+    {
+        guint mid = lo + (hi - lo) / 2;
 
-/********************************************************************\
-\********************************************************************/
+        if (BLOCK_AT (priv, mid)->first <= index)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
 
-Account *
-xaccAccountLookup (const GncGUID *guid, QofBook *book)
+/* Move the blocks after position @pos by @delta splits. */
+static void
+balance_blocks_shift (AccountPrivate *priv, guint pos, gint delta)
 {
-    QofCollection *col;
-    if (!guid || !book) return NULL;
-    col = qof_book_get_collection (book, GNC_ID_ACCOUNT);
-    return (Account *) qof_collection_lookup_entity (col, guid);
+    for (++pos; pos < priv->balance_blocks->len; ++pos)
+        BLOCK_AT (priv, pos)->first += delta;
 }
 
-/********************************************************************\
-\********************************************************************/
-
-void
-xaccAccountSetMark (Account *acc, short m)
+/* Move the second half of the overgrown block at @pos into a new block
+ * placed right after it. */
+static void
+balance_block_split (AccountPrivate *priv, guint pos)
 {
-    AccountPrivate *priv;
+    GPtrArray *blocks = priv->balance_blocks;
+    AccountBalanceBlock *block = BLOCK_AT (priv, pos);
+    AccountBalanceBlock *tail;
+    guint i;
 
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    tail = balance_block_new (block->first + BALANCE_BLOCK_SIZE);
+    tail->n_splits = block->n_splits - BALANCE_BLOCK_SIZE;
+    block->n_splits = BALANCE_BLOCK_SIZE;
+    block->dirty = TRUE;
+    for (i = tail->first; i < tail->first + tail->n_splits; ++i)
+        SPLIT_AT (priv, i)->balance_block = tail;
 
-    priv = GET_PRIVATE(acc);
-    priv->mark = m;
+    g_ptr_array_add (blocks, NULL);
+    memmove (&blocks->pdata[pos + 2], &blocks->pdata[pos + 1],
+             (blocks->len - pos - 2) * sizeof (gpointer));
+    blocks->pdata[pos + 1] = tail;
 }
 
-void
-xaccClearMark (Account *acc, short val)
+/* Add the split just placed at @index in the vector to the block of its
+ * predecessor, or to the first block if it is at the front. */
+static void
+account_index_insert_split (AccountPrivate *priv, guint index)
 {
-    Account *root;
+    Split *split = SPLIT_AT (priv, index);
+    AccountBalanceBlock *block;
+    guint pos;
 
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    if (priv->balance_index_dirty)
+        return;
 
-    root = gnc_account_get_root(acc);
-    xaccClearMarkDown(root ? root : acc, val);
+    if (priv->balance_blocks->len == 0)
+    {
+        block = balance_block_new (0);
+        g_ptr_array_add (priv->balance_blocks, block);
+        pos = 0;
+    }
+    else
+    {
+        pos = balance_block_find (priv, index ? index - 1 : 0);
+        block = BLOCK_AT (priv, pos);
+        if (index && SPLIT_AT (priv, index - 1)->balance_block != block)
+        {
+            /* The neighbour isn't where the index says it is. */
+            priv->balance_index_dirty = TRUE;
+            return;
+        }
+    }
+
+    split->balance_block = block;
+    ++block->n_splits;
+    block->dirty = TRUE;
+    balance_blocks_shift (priv, pos, 1);
+    if (block->n_splits >= 2 * BALANCE_BLOCK_SIZE)
+        balance_block_split (priv, pos);
 }
 
-void
-xaccClearMarkDown (Account *acc, short val)
+/* Drop the split at @index from its block; must be called before the
+ * split is taken out of the vector. */
+static void
+account_index_remove_split (AccountPrivate *priv, guint index)
 {
-    AccountPrivate *priv;
-    GList *node;
+    Split *split = SPLIT_AT (priv, index);
+    AccountBalanceBlock *block = split->balance_block;
+    guint pos;
 
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    split->balance_block = NULL;
+    if (priv->balance_index_dirty)
+        return;
 
-    priv = GET_PRIVATE(acc);
-    priv->mark = val;
-    for (node = priv->children; node; node = node->next)
+    pos = balance_block_find (priv, index);
+    if (block != BLOCK_AT (priv, pos))
     {
-        xaccClearMarkDown(node->data, val);
+        priv->balance_index_dirty = TRUE;
+        return;
     }
-}
 
-/********************************************************************\
-\********************************************************************/
+    block->dirty = TRUE;
+    balance_blocks_shift (priv, pos, -1);
+    if (--block->n_splits == 0)
+    {
+        g_ptr_array_remove_index (priv->balance_blocks, pos);
+        g_free (block);
+    }
+}
 
-GNCPolicy *
-gnc_account_get_policy (Account *acc)
+/* Keep @split in the account's set of unreconciled splits or out of it,
+ * as its reconcile state says. */
+static void
+account_track_reconcile (AccountPrivate *priv, Split *split)
 {
-    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
-
-    return GET_PRIVATE(acc)->policy;
+    if (split->reconciled == YREC)
+        g_hash_table_remove (priv->unreconciled, split);
+    else
+        g_hash_table_insert (priv->unreconciled, split, split);
 }
 
 void
-gnc_account_set_policy (Account *acc, GNCPolicy *policy)
+gnc_account_set_split_balance_dirty (Account *acc, Split *split)
 {
     AccountPrivate *priv;
 
     g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_SPLIT(split));
+
+    if (qof_instance_get_destroying(acc))
+        return;
 
     priv = GET_PRIVATE(acc);
-    priv->policy = policy ? policy : xaccGetFIFOPolicy();
+    priv->sort_dirty = TRUE;
+    priv->balance_dirty = TRUE;
+    priv->date_index_dirty = TRUE;
+    subtree_stats_changed ();
+    if (!priv->balance_index_dirty && split->balance_block)
+        split->balance_block->dirty = TRUE;
+    if (split->held_by == acc)
+        account_track_reconcile (priv, split);
 }
 
-/********************************************************************\
-\********************************************************************/
-
 void
-xaccAccountRemoveLot (Account *acc, GNCLot *lot)
+gnc_account_refresh_split_balance (Split *split)
 {
+    AccountBalanceBlock *block;
     AccountPrivate *priv;
 
-    g_return_if_fail(GNC_IS_ACCOUNT(acc));
-    g_return_if_fail(GNC_IS_LOT(lot));
-
-    priv = GET_PRIVATE(acc);
-    g_return_if_fail(priv->lots);
+    g_return_if_fail (split);
 
-    ENTER ("(acc=%p, lot=%p)", acc, lot);
-    priv->lots = g_list_remove(priv->lots, lot);
-    qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_REMOVE, NULL);
-    qof_event_gen (&acc->inst, QOF_EVENT_MODIFY, NULL);
-    LEAVE ("(acc=%p, lot=%p)", acc, lot);
+    if (!split->balance_block || !split->acc)
+        return;
+    priv = GET_PRIVATE (split->acc);
+    if (priv->balance_index_dirty)
+        return;
+    block = split->balance_block;
+    qof_book_cache_lock (qof_instance_get_book (split->acc));
+    if (block->stale && !block->dirty)
+        balance_block_sum (priv, block);
+    qof_book_cache_unlock (qof_instance_get_book (split->acc));
 }
 
-void
-xaccAccountInsertLot (Account *acc, GNCLot *lot)
-{
-    AccountPrivate *priv, *opriv;
-    Account * old_acc = NULL;
+/* The date index
+ *
+ * Pairs each split with the post date of its transaction in a
+ * contiguous array parallel to the split vector, so that the balance as
+ * of a date is a binary search away. Splits are ordered by post date
+ * first, so the index is sorted by date whenever the splits are. It's
+ * kept in step by gnc_account_insert_split() and
+ * gnc_account_remove_split(); sorting and anything that may change a
+ * post date mark it dirty and it's rebuilt on the next lookup.
+ */
+
+typedef struct
+{
+    time64 date;
+    Split *split;
+} AccountDateEntry;
+
+static GArray *
+account_get_date_index (const Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE (acc);
+    guint i;
+
+    if (priv->date_index && !priv->date_index_dirty)
+        return priv->date_index;
+
+    qof_book_cache_lock (qof_instance_get_book (acc));
+    if (!priv->date_index_dirty && priv->date_index)
+    {
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return priv->date_index;
+    }
+
+    if (!priv->date_index)
+        priv->date_index = g_array_sized_new (FALSE, FALSE,
+                                              sizeof (AccountDateEntry),
+                                              priv->splits->len);
+    g_array_set_size (priv->date_index, priv->splits->len);
+
+    for (i = 0; i < priv->splits->len; ++i)
+    {
+        AccountDateEntry *entry = &g_array_index (priv->date_index,
+                                                  AccountDateEntry, i);
+
+        entry->split = SPLIT_AT (priv, i);
+        entry->date = xaccTransGetDate (xaccSplitGetParent (entry->split));
+    }
+    priv->date_index_dirty = FALSE;
+    qof_book_cache_unlock (qof_instance_get_book (acc));
+    return priv->date_index;
+}
+
+/* Position of the first entry from @lo on posted at or after @date. */
+static guint
+date_index_lower_bound_from (GArray *index, guint lo, time64 date)
+{
+    guint hi = index->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index (index, AccountDateEntry, mid).date < date)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Position of the first entry posted at or after @date. */
+static guint
+date_index_lower_bound (GArray *index, time64 date)
+{
+    return date_index_lower_bound_from (index, 0, date);
+}
+
+/* Position of the first entry posted after @date. */
+static guint
+date_index_upper_bound (GArray *index, time64 date)
+{
+    guint lo = 0, hi = index->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index (index, AccountDateEntry, mid).date <= date)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+account_date_index_insert_split (AccountPrivate *priv, guint index)
+{
+    AccountDateEntry entry;
+
+    if (!priv->date_index || priv->date_index_dirty)
+        return;
+
+    entry.split = SPLIT_AT (priv, index);
+    entry.date = xaccTransGetDate (xaccSplitGetParent (entry.split));
+    g_array_insert_val (priv->date_index, index, entry);
+}
+
+static void
+account_date_index_remove_split (AccountPrivate *priv, guint index)
+{
+    if (!priv->date_index || priv->date_index_dirty)
+        return;
+
+    g_array_remove_index (priv->date_index, index);
+}
+
+/* The description index
+ *
+ * Maps each transaction description to the last split in the vector
+ * whose transaction has it, which is the one the register's autofill
+ * copies. Appending a split keeps it in step. Anything else that may
+ * move a split in the vector or change which description it has marks
+ * it dirty, and it's rebuilt on the next lookup. The keys are the
+ * descriptions' cached strings.
+ */
+
+static void
+account_desc_index_set (AccountPrivate *priv, Split *split)
+{
+    const char *desc = xaccTransGetDescription (xaccSplitGetParent (split));
+
+    if (desc)
+        g_hash_table_replace (priv->desc_index, CACHE_INSERT (desc), split);
+}
+
+static GHashTable *
+account_get_desc_index (const Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE (acc);
+    guint i;
+
+    if (priv->desc_index && !priv->desc_index_dirty)
+        return priv->desc_index;
+
+    qof_book_cache_lock (qof_instance_get_book (acc));
+    if (!priv->desc_index_dirty && priv->desc_index)
+    {
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return priv->desc_index;
+    }
+
+    if (!priv->desc_index)
+        priv->desc_index =
+            g_hash_table_new_full (g_str_hash, g_str_equal,
+                                   (GDestroyNotify) qof_string_cache_remove,
+                                   NULL);
+    else
+        g_hash_table_remove_all (priv->desc_index);
+    for (i = 0; i < priv->splits->len; ++i)
+        account_desc_index_set (priv, SPLIT_AT (priv, i));
+    priv->desc_index_dirty = FALSE;
+    qof_book_cache_unlock (qof_instance_get_book (acc));
+    return priv->desc_index;
+}
+
+static void
+account_desc_index_insert_split (AccountPrivate *priv, guint index)
+{
+    Split *split;
+    const char *desc;
+
+    if (!priv->desc_index || priv->desc_index_dirty)
+        return;
+
+    /* A split ahead of another with the same description doesn't
+     * change the index, but finding out would take a search. */
+    split = SPLIT_AT (priv, index);
+    desc = xaccTransGetDescription (split->parent);
+    if (!desc)
+        return;
+    if (index + 1 == priv->splits->len ||
+            !g_hash_table_lookup (priv->desc_index, desc))
+        account_desc_index_set (priv, split);
+    else
+        priv->desc_index_dirty = TRUE;
+}
+
+static void
+account_desc_index_remove_split (AccountPrivate *priv, guint index)
+{
+    Split *split;
+    const char *desc;
+
+    if (!priv->desc_index || priv->desc_index_dirty)
+        return;
+
+    split = SPLIT_AT (priv, index);
+    desc = xaccTransGetDescription (split->parent);
+    if (!desc || g_hash_table_lookup (priv->desc_index, desc) == split)
+        priv->desc_index_dirty = TRUE;
+}
+
+void
+gnc_account_set_desc_index_dirty (Account *acc)
+{
+    g_return_if_fail (GNC_IS_ACCOUNT (acc));
+
+    if (qof_instance_get_destroying (acc))
+        return;
+
+    GET_PRIVATE (acc)->desc_index_dirty = TRUE;
+}
+
+/* The online id index
+ *
+ * Maps each online id in the account to a split that has it: the
+ * split's own "online_id", or if it has none its transaction's, as the
+ * importers compare them. The order of the splits doesn't matter, so
+ * sorting leaves it alone. Adding a split keeps it in step; removing the
+ * split it holds for an id, or changing an online id, marks it dirty and
+ * it's rebuilt on the next lookup.
+ */
+
+static const char *
+split_online_id (const Split *split)
+{
+    const char *online_id;
+
+    online_id = qof_instance_get_kvp_string (QOF_INSTANCE (split),
+                                             "online_id");
+    if ((!online_id || !*online_id) && split->parent)
+        online_id = qof_instance_get_kvp_string (QOF_INSTANCE (split->parent),
+                                                 "online_id");
+    return online_id && *online_id ? online_id : NULL;
+}
+
+static void
+account_online_id_index_set (AccountPrivate *priv, Split *split)
+{
+    const char *online_id = split_online_id (split);
+
+    if (online_id && !g_hash_table_lookup (priv->online_id_index, online_id))
+        g_hash_table_insert (priv->online_id_index, g_strdup (online_id),
+                             split);
+}
+
+static GHashTable *
+account_get_online_id_index (const Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE (acc);
+    guint i;
+
+    if (priv->online_id_index && !priv->online_id_index_dirty)
+        return priv->online_id_index;
+
+    qof_book_cache_lock (qof_instance_get_book (acc));
+    if (!priv->online_id_index_dirty && priv->online_id_index)
+    {
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return priv->online_id_index;
+    }
+
+    if (!priv->online_id_index)
+        priv->online_id_index = g_hash_table_new_full (g_str_hash,
+                                g_str_equal, g_free, NULL);
+    else
+        g_hash_table_remove_all (priv->online_id_index);
+    for (i = 0; i < priv->splits->len; ++i)
+        account_online_id_index_set (priv, SPLIT_AT (priv, i));
+    priv->online_id_index_dirty = FALSE;
+    qof_book_cache_unlock (qof_instance_get_book (acc));
+    return priv->online_id_index;
+}
+
+static void
+account_online_id_index_insert_split (AccountPrivate *priv, guint index)
+{
+    if (!priv->online_id_index || priv->online_id_index_dirty)
+        return;
+
+    account_online_id_index_set (priv, SPLIT_AT (priv, index));
+}
+
+static void
+account_online_id_index_remove_split (AccountPrivate *priv, guint index)
+{
+    Split *split;
+    const char *online_id;
+
+    if (!priv->online_id_index || priv->online_id_index_dirty)
+        return;
+
+    split = SPLIT_AT (priv, index);
+    online_id = split_online_id (split);
+    if (online_id &&
+            g_hash_table_lookup (priv->online_id_index, online_id) == split)
+        priv->online_id_index_dirty = TRUE;
+}
+
+void
+gnc_account_set_online_id_index_dirty (Account *acc)
+{
+    g_return_if_fail (GNC_IS_ACCOUNT (acc));
+
+    if (qof_instance_get_destroying (acc))
+        return;
+
+    GET_PRIVATE (acc)->online_id_index_dirty = TRUE;
+}
+
+Split *
+gnc_account_find_split_by_online_id (const Account *acc, const char *online_id)
+{
+    g_return_val_if_fail (GNC_IS_ACCOUNT (acc), NULL);
+
+    if (!online_id || !*online_id)
+        return NULL;
+    return g_hash_table_lookup (account_get_online_id_index (acc), online_id);
+}
+
+/* The xaccAccountGetSplitList() view */
+
+static void
+account_split_list_insert (AccountPrivate *priv, guint index)
+{
+    if (priv->split_list_built)
+        priv->split_list = g_list_insert (priv->split_list,
+                                          SPLIT_AT (priv, index), index);
+}
+
+static void
+account_split_list_remove (AccountPrivate *priv, guint index)
+{
+    if (priv->split_list_built)
+        priv->split_list = g_list_delete_link (priv->split_list,
+                                               g_list_nth (priv->split_list,
+                                                           index));
+}
+
+/* Point the view's nodes at the splits in vector order, reusing the
+ * nodes so that callers holding on to the list still have a valid one. */
+static void
+account_split_list_sync (AccountPrivate *priv)
+{
+    GList *node;
+    guint i;
+
+    if (!priv->split_list_built)
+        return;
+
+    for (i = 0, node = priv->split_list; node && i < priv->splits->len;
+            ++i, node = node->next)
+        node->data = SPLIT_AT (priv, i);
+}
+
+static void
+account_free_split_list (AccountPrivate *priv)
+{
+    g_list_free (priv->split_list);
+    priv->split_list = NULL;
+    priv->split_list_built = FALSE;
+}
+
+/* Position of @split in the vector, or -1 if it isn't in the account.
+ * With a clean balance index only the split's block needs looking at. */
+static gint
+account_find_split (AccountPrivate *priv, const Split *split)
+{
+    guint i, end;
+
+    if (!priv->balance_index_dirty)
+    {
+        AccountBalanceBlock *block = split->balance_block;
+
+        if (!block)
+            return -1;
+        end = MIN (block->first + block->n_splits, priv->splits->len);
+        for (i = block->first; i < end; ++i)
+            if (SPLIT_AT (priv, i) == split)
+                return i;
+        return -1;
+    }
+
+    for (i = 0; i < priv->splits->len; ++i)
+        if (SPLIT_AT (priv, i) == split)
+            return i;
+    return -1;
+}
+
+/* Put @split at @index in the vector and every index built on it. */
+static void
+account_add_split_at (AccountPrivate *priv, Split *split, guint index)
+{
+    g_ptr_array_add (priv->splits, NULL);
+    memmove (&priv->splits->pdata[index + 1], &priv->splits->pdata[index],
+             (priv->splits->len - index - 1) * sizeof (gpointer));
+    priv->splits->pdata[index] = split;
+
+    account_index_insert_split (priv, index);
+    account_date_index_insert_split (priv, index);
+    account_desc_index_insert_split (priv, index);
+    account_online_id_index_insert_split (priv, index);
+    account_split_list_insert (priv, index);
+    subtree_stats_changed ();
+}
+
+/********************************************************************\
+\********************************************************************/
+
+gboolean
+gnc_account_insert_split (Account *acc, Split *s)
+{
+    AccountPrivate *priv;
+    guint index;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
+    g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
+
+    priv = GET_PRIVATE(acc);
+    if (account_find_split (priv, s) >= 0)
+        return FALSE;
+
+    if (qof_instance_get_editlevel(acc) == 0 && !priv->sort_dirty)
+    {
+        /* Binary search for the first split that doesn't sort ahead */
+        guint lo = 0, hi = priv->splits->len;
+        while (lo < hi)
+        {
+            guint mid = lo + (hi - lo) / 2;
+            if (xaccSplitOrder (s, SPLIT_AT (priv, mid)) > 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        index = lo;
+    }
+    else
+    {
+        index = priv->splits->len;
+        priv->sort_dirty = TRUE;
+    }
+    account_add_split_at (priv, s, index);
+    s->held_by = acc;
+    account_track_reconcile (priv, s);
+
+    //FIXME: find better event
+    qof_event_gen (&acc->inst, QOF_EVENT_MODIFY, NULL);
+    /* Also send an event based on the account */
+    qof_event_gen(&acc->inst, GNC_EVENT_ITEM_ADDED, s);
+
+    priv->balance_dirty = TRUE;
+//  DRH: Should the below be added? It is present in the delete path.
+//  xaccAccountRecomputeBalance(acc);
+    return TRUE;
+}
+
+gboolean
+gnc_account_remove_split (Account *acc, Split *s)
+{
+    AccountPrivate *priv;
+    gint index;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
+    g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
+
+    priv = GET_PRIVATE(acc);
+    index = account_find_split (priv, s);
+    if (index < 0)
+        return FALSE;
+
+    account_index_remove_split (priv, index);
+    account_date_index_remove_split (priv, index);
+    account_desc_index_remove_split (priv, index);
+    account_online_id_index_remove_split (priv, index);
+    account_split_list_remove (priv, index);
+    g_ptr_array_remove_index (priv->splits, index);
+    g_hash_table_remove (priv->unreconciled, s);
+    subtree_stats_changed ();
+    s->held_by = NULL;
+    //FIXME: find better event type
+    qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
+    // And send the account-based event, too
+    qof_event_gen(&acc->inst, GNC_EVENT_ITEM_REMOVED, s);
+
+    priv->balance_dirty = TRUE;
+    xaccAccountRecomputeBalance(acc);
+    return TRUE;
+}
+
+/* A split decorated with the leading keys of xaccSplitOrder(), so that
+ * sorting mostly compares integers. */
+typedef struct
+{
+    Split *split;
+    gboolean has_key;   /* FALSE: always use xaccSplitOrder() */
+    time64 posted;
+    int num;
+    time64 entered;
+} SplitSortKey;
+
+static void
+split_sort_key_init (SplitSortKey *key, Split *split, gboolean action_for_num)
+{
+    Transaction *trans = split->parent;
+
+    key->split = split;
+    /* xaccTransOrder_num_action() only uses the actions if neither is NULL */
+    key->has_key = trans && (!action_for_num || split->action);
+    if (!key->has_key)
+        return;
+    key->posted = trans->date_posted;
+    key->num = atoi (action_for_num ? split->action : trans->num);
+    key->entered = trans->date_entered;
+}
+
+static gint
+split_sort_key_cmp (gconstpointer pa, gconstpointer pb)
+{
+    const SplitSortKey *a = pa, *b = pb;
+
+    if (a->has_key && b->has_key)
+    {
+        DATE_CMP (a, b, posted);
+        if (a->num != b->num) return a->num < b->num ? -1 : 1;
+        DATE_CMP (a, b, entered);
+    }
+    return xaccSplitOrder (a->split, b->split);
+}
+
+/* Sort the splits into xaccSplitOrder() order */
+static void
+account_sort_split_array (AccountPrivate *priv, QofBook *book)
+{
+    gboolean action_for_num = qof_book_use_split_action_for_num_field (book);
+    guint i, n = priv->splits->len;
+    SplitSortKey *keys = g_new (SplitSortKey, n);
+
+    for (i = 0; i < n; i++)
+        split_sort_key_init (&keys[i], SPLIT_AT (priv, i), action_for_num);
+    qsort (keys, n, sizeof (SplitSortKey), split_sort_key_cmp);
+    for (i = 0; i < n; i++)
+        g_ptr_array_index (priv->splits, i) = keys[i].split;
+    g_free (keys);
+}
+
+void
+xaccAccountSortSplits (Account *acc, gboolean force)
+{
+    AccountPrivate *priv;
+    Split **before = NULL;
+    guint i, b, k;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
+        return;
+
+    qof_book_cache_lock (qof_instance_get_book (acc));
+    if (!priv->sort_dirty)
+    {
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return;
+    }
+    if (!priv->balance_index_dirty)
+        before = g_memdup (priv->splits->pdata,
+                           priv->splits->len * sizeof (gpointer));
+
+    account_sort_split_array (priv, qof_instance_get_book (acc));
+
+    /* Keep the block boundaries where they were: a block is dirty only
+     * if a different split now sits at one of its positions. */
+    if (before)
+    {
+        for (i = 0, b = 0, k = 0; i < priv->splits->len; ++i)
+        {
+            Split *split = SPLIT_AT (priv, i);
+            AccountBalanceBlock *block;
+
+            if (b >= priv->balance_blocks->len)
+            {
+                priv->balance_index_dirty = TRUE;
+                break;
+            }
+            block = BLOCK_AT (priv, b);
+
+            if (split != before[i])
+            {
+                split->balance_block = block;
+                block->dirty = TRUE;
+            }
+            if (++k == block->n_splits)
+            {
+                k = 0;
+                ++b;
+            }
+        }
+        g_free (before);
+    }
+
+    account_split_list_sync (priv);
+    priv->sort_dirty = FALSE;
+    priv->balance_dirty = TRUE;
+    priv->date_index_dirty = TRUE;
+    priv->desc_index_dirty = TRUE;
+    qof_book_cache_unlock (qof_instance_get_book (acc));
+}
+
+static void
+xaccAccountBringUpToDate(Account *acc)
+{
+    if (!acc) return;
+
+    /* if a re-sort happens here, then everything will update, so the
+       cost basis and balance calls are no-ops */
+    xaccAccountSortSplits(acc, FALSE);
+    xaccAccountRecomputeBalance(acc);
+}
+
+/********************************************************************\
+\********************************************************************/
+
+void
+xaccAccountSetGUID (Account *acc, const GncGUID *guid)
+{
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(guid);
+
+    /* XXX this looks fishy and weird to me ... */
+    PINFO("acct=%p", acc);
+    xaccAccountBeginEdit (acc);
+    qof_instance_set_guid (&acc->inst, guid);
+    qof_instance_set_dirty(&acc->inst);
+    xaccAccountCommitEdit (acc);
+}
+
+/********************************************************************\
+\********************************************************************/
+
+Account *
+xaccAccountLookup (const GncGUID *guid, QofBook *book)
+{
+    static gint type_id = -1;
+    QofCollection *col;
+    if (!guid || !book) return NULL;
+    if (type_id < 0)
+        type_id = qof_object_get_type_id (GNC_ID_ACCOUNT);
+    col = qof_book_get_collection_by_id (book, type_id);
+    return (Account *) qof_collection_lookup_entity (col, guid);
+}
+
+/********************************************************************\
+\********************************************************************/
+
+void
+xaccAccountSetMark (Account *acc, short m)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    priv->mark = m;
+}
+
+void
+xaccClearMark (Account *acc, short val)
+{
+    Account *root;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    root = gnc_account_get_root(acc);
+    xaccClearMarkDown(root ? root : acc, val);
+}
+
+void
+xaccClearMarkDown (Account *acc, short val)
+{
+    AccountPrivate *priv;
+    GList *node;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    priv->mark = val;
+    for (node = priv->children; node; node = node->next)
+    {
+        xaccClearMarkDown(node->data, val);
+    }
+}
+
+/********************************************************************\
+\********************************************************************/
+
+GNCPolicy *
+gnc_account_get_policy (Account *acc)
+{
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
+
+    return GET_PRIVATE(acc)->policy;
+}
+
+void
+gnc_account_set_policy (Account *acc, GNCPolicy *policy)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    priv->policy = policy ? policy : xaccGetFIFOPolicy();
+}
+
+/********************************************************************\
+ * The open lot index.
+ *
+ * FIFO and LIFO lot assignment want the earliest or latest open lot,
+ * which used to mean looking at every lot the account ever had.  The
+ * index keeps each account's open lots in two sequences, for lots opened
+ * by a negative and by a positive split, sorted by the post date of the
+ * opening split.  Every lot of the account has an entry; when a lot's
+ * splits, or their amounts or dates, change gnc-lot.c and mark_split()
+ * call gnc_account_lot_changed(), and the entry is put back in place at
+ * the next lookup.  Lots whose dates are equal stay in the order of
+ * priv->lots, where later insertions come first.  The index is built on
+ * the first lookup; accounts without lots never pay for it.
+\********************************************************************/
+
+typedef struct
+{
+    GNCLot *lot;
+    Split *opening;             /* earliest split, while the lot is open */
+    time64 opened;              /* its post date */
+    guint64 seq;                /* higher for later insertions */
+    GSequenceIter *iter;        /* place in open_lots, NULL if not open */
+    gboolean dirty;             /* in dirty_lots */
+} OpenLotEntry;
+
+static gint
+open_lot_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    const OpenLotEntry *ea = a, *eb = b;
+
+    if (ea->opened != eb->opened)
+        return ea->opened < eb->opened ? -1 : 1;
+    if (ea->seq != eb->seq)
+        return ea->seq > eb->seq ? -1 : 1;
+    return 0;
+}
+
+static void
+lot_entry_mark_dirty (AccountPrivate *priv, OpenLotEntry *entry)
+{
+    if (entry->dirty) return;
+    entry->dirty = TRUE;
+    g_ptr_array_add (priv->dirty_lots, entry);
+}
+
+static void
+lot_index_add (AccountPrivate *priv, GNCLot *lot)
+{
+    OpenLotEntry *entry = g_new0 (OpenLotEntry, 1);
+
+    entry->lot = lot;
+    entry->seq = ++priv->lot_seq;
+    g_hash_table_insert (priv->lot_entries, lot, entry);
+    lot_entry_mark_dirty (priv, entry);
+}
+
+static void
+lot_index_remove (AccountPrivate *priv, GNCLot *lot)
+{
+    OpenLotEntry *entry;
+
+    if (!priv->lot_entries) return;
+    entry = g_hash_table_lookup (priv->lot_entries, lot);
+    if (!entry) return;
+
+    if (entry->iter)
+        g_sequence_remove (entry->iter);
+    if (entry->dirty)
+        g_ptr_array_remove_fast (priv->dirty_lots, entry);
+    g_hash_table_remove (priv->lot_entries, lot);
+}
+
+static void
+lot_index_build (AccountPrivate *priv)
+{
+    GList *node;
+
+    priv->lot_entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                               NULL, g_free);
+    priv->open_lots[0] = g_sequence_new (NULL);
+    priv->open_lots[1] = g_sequence_new (NULL);
+    priv->dirty_lots = g_ptr_array_new ();
+    for (node = g_list_last (priv->lots); node; node = node->prev)
+        lot_index_add (priv, node->data);
+}
+
+static void
+lot_index_destroy (AccountPrivate *priv)
+{
+    if (!priv->lot_entries) return;
+
+    g_sequence_free (priv->open_lots[0]);
+    g_sequence_free (priv->open_lots[1]);
+    priv->open_lots[0] = priv->open_lots[1] = NULL;
+    g_ptr_array_free (priv->dirty_lots, TRUE);
+    priv->dirty_lots = NULL;
+    g_hash_table_destroy (priv->lot_entries);
+    priv->lot_entries = NULL;
+}
+
+/* Put a changed lot where it now belongs, if it's still open.  The
+ * tests are those the old search made of every lot: a closed lot, one
+ * without an opening amount and an overfull one, whose balance has the
+ * opposite sign of its opening split, aren't open for assignment. */
+static void
+lot_entry_update (AccountPrivate *priv, OpenLotEntry *entry)
+{
+    Split *opening;
+    gboolean positive;
+
+    entry->dirty = FALSE;
+    if (entry->iter)
+    {
+        g_sequence_remove (entry->iter);
+        entry->iter = NULL;
+    }
+    entry->opening = NULL;
+
+    if (gnc_lot_is_closed (entry->lot)) return;
+    opening = gnc_lot_get_earliest_split (entry->lot);
+    if (!opening || !opening->parent || gnc_numeric_zero_p (opening->amount))
+        return;
+    positive = gnc_numeric_positive_p (opening->amount);
+    if (positive != gnc_numeric_positive_p (gnc_lot_get_balance (entry->lot)))
+        return;
+
+    entry->opening = opening;
+    entry->opened = opening->parent->date_posted;
+    entry->iter = g_sequence_insert_sorted (priv->open_lots[positive ? 1 : 0],
+                                            entry, open_lot_cmp, NULL);
+}
+
+static gboolean
+open_lot_matches (const OpenLotEntry *entry, const gnc_commodity *currency)
+{
+    return !currency ||
+           gnc_commodity_equiv (currency, entry->opening->parent->common_currency);
+}
+
+void
+gnc_account_lot_changed (Account *acc, GNCLot *lot)
+{
+    AccountPrivate *priv;
+    OpenLotEntry *entry;
+
+    g_return_if_fail (GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    if (!priv->lot_entries) return;
+    entry = g_hash_table_lookup (priv->lot_entries, lot);
+    if (entry)
+        lot_entry_mark_dirty (priv, entry);
+}
+
+void
+gnc_account_forget_lot (Account *acc, GNCLot *lot)
+{
+    g_return_if_fail (GNC_IS_ACCOUNT(acc));
+    lot_index_remove (GET_PRIVATE(acc), lot);
+}
+
+GNCLot *
+gnc_account_find_open_lot (Account *acc, gboolean opened_positive,
+                           const gnc_commodity *currency, gboolean latest)
+{
+    AccountPrivate *priv;
+    GSequence *open_lots;
+    GSequenceIter *iter;
+    OpenLotEntry *found = NULL;
+    guint i;
+
+    g_return_val_if_fail (GNC_IS_ACCOUNT(acc), NULL);
+
+    priv = GET_PRIVATE(acc);
+    if (!priv->lot_entries)
+        lot_index_build (priv);
+    for (i = 0; i < priv->dirty_lots->len; ++i)
+        lot_entry_update (priv, g_ptr_array_index (priv->dirty_lots, i));
+    g_ptr_array_set_size (priv->dirty_lots, 0);
+
+    open_lots = priv->open_lots[opened_positive ? 1 : 0];
+    if (!latest)
+    {
+        for (iter = g_sequence_get_begin_iter (open_lots);
+                !g_sequence_iter_is_end (iter);
+                iter = g_sequence_iter_next (iter))
+        {
+            OpenLotEntry *entry = g_sequence_get (iter);
+            if (open_lot_matches (entry, currency))
+                return entry->lot;
+        }
+        return NULL;
+    }
+
+    /* Of the latest lots, the one that comes first in priv->lots. */
+    iter = g_sequence_get_end_iter (open_lots);
+    while (!g_sequence_iter_is_begin (iter))
+    {
+        OpenLotEntry *entry;
+
+        iter = g_sequence_iter_prev (iter);
+        entry = g_sequence_get (iter);
+        if (found && found->opened != entry->opened)
+            break;
+        if (open_lot_matches (entry, currency))
+            found = entry;
+    }
+    return found ? found->lot : NULL;
+}
+
+/********************************************************************\
+\********************************************************************/
+
+void
+xaccAccountRemoveLot (Account *acc, GNCLot *lot)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_LOT(lot));
+
+    priv = GET_PRIVATE(acc);
+    g_return_if_fail(priv->lots);
+
+    ENTER ("(acc=%p, lot=%p)", acc, lot);
+    priv->lots = g_list_remove(priv->lots, lot);
+    lot_index_remove (priv, lot);
+    qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_REMOVE, NULL);
+    qof_event_gen (&acc->inst, QOF_EVENT_MODIFY, NULL);
+    LEAVE ("(acc=%p, lot=%p)", acc, lot);
+}
+
+void
+xaccAccountInsertLot (Account *acc, GNCLot *lot)
+{
+    AccountPrivate *priv, *opriv;
+    Account * old_acc = NULL;
     Account* lot_account;
 
     /* errors */
@@ -1955,10 +3234,13 @@ xaccAccountInsertLot (Account *acc, GNCLot *lot)
         old_acc = lot_account;
         opriv = GET_PRIVATE(old_acc);
         opriv->lots = g_list_remove(opriv->lots, lot);
+        lot_index_remove (opriv, lot);
     }
 
     priv = GET_PRIVATE(acc);
     priv->lots = g_list_prepend(priv->lots, lot);
+    if (priv->lot_entries)
+        lot_index_add (priv, lot);
     gnc_lot_set_account(lot, acc);
 
     /* Don't move the splits to the new account.  The caller will do this
@@ -1995,14 +3277,17 @@ void
 xaccAccountMoveAllSplits (Account *accfrom, Account *accto)
 {
     AccountPrivate *from_priv;
+    GPtrArray *splits;
+    guint i;
 
     /* errors */
     g_return_if_fail(GNC_IS_ACCOUNT(accfrom));
     g_return_if_fail(GNC_IS_ACCOUNT(accto));
 
     /* optimizations */
+    gnc_account_load_splits(accfrom);
     from_priv = GET_PRIVATE(accfrom);
-    if (!from_priv->splits || accfrom == accto)
+    if (!from_priv->splits->len || accfrom == accto)
         return;
 
     /* check for book mix-up */
@@ -2012,7 +3297,12 @@ xaccAccountMoveAllSplits (Account *accfrom, Account *accto)
     xaccAccountBeginEdit(accfrom);
     xaccAccountBeginEdit(accto);
     /* Begin editing both accounts and all transactions in accfrom. */
-    g_list_foreach(from_priv->splits, (GFunc)xaccPreSplitMove, NULL);
+    splits = g_ptr_array_sized_new (from_priv->splits->len);
+    for (i = 0; i < from_priv->splits->len; ++i)
+        g_ptr_array_add (splits, g_ptr_array_index (from_priv->splits, i));
+    xaccTransBeginJournaledEdits ();
+    g_ptr_array_foreach (splits, (GFunc)xaccPreSplitMove, NULL);
+    xaccTransEndJournaledEdits ();
 
     /* Concatenate accfrom's lists of splits and lots to accto's lists. */
     //to_priv->splits = g_list_concat(to_priv->splits, from_priv->splits);
@@ -2029,10 +3319,11 @@ xaccAccountMoveAllSplits (Account *accfrom, Account *accto)
      * Convert each split's amount to accto's commodity.
      * Commit to editing each transaction.
      */
-    g_list_foreach(from_priv->splits, (GFunc)xaccPostSplitMove, (gpointer)accto);
+    g_ptr_array_foreach (splits, (GFunc)xaccPostSplitMove, (gpointer)accto);
+    g_ptr_array_free (splits, TRUE);
 
     /* Finally empty accfrom. */
-    g_assert(from_priv->splits == NULL);
+    g_assert(from_priv->splits->len == 0);
     g_assert(from_priv->lots == NULL);
     xaccAccountCommitEdit(accfrom);
     xaccAccountCommitEdit(accto);
@@ -2076,7 +3367,7 @@ xaccAccountRecomputeBalance (Account * acc)
     gnc_numeric  balance;
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
-    GList *lp;
+    guint i;
 
     if (NULL == acc) return;
 
@@ -2086,41 +3377,52 @@ xaccAccountRecomputeBalance (Account * acc)
     if (qof_instance_get_destroying(acc)) return;
     if (qof_book_shutting_down(qof_instance_get_book(acc))) return;
 
+    qof_book_cache_lock (qof_instance_get_book (acc));
+    if (!priv->balance_dirty)
+    {
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return;
+    }
     balance            = priv->starting_balance;
     cleared_balance    = priv->starting_cleared_balance;
     reconciled_balance = priv->starting_reconciled_balance;
 
     PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
            priv->accountName, balance.num, balance.denom);
-    for (lp = priv->splits; lp; lp = lp->next)
-    {
-        Split *split = (Split *) lp->data;
-        gnc_numeric amt = xaccSplitGetAmount (split);
 
-        balance = gnc_numeric_add_fixed(balance, amt);
+    if (priv->balance_index_dirty)
+        account_rebuild_balance_index (priv);
 
-        if (NREC != split->reconciled)
-        {
-            cleared_balance = gnc_numeric_add_fixed(cleared_balance, amt);
-        }
+    for (i = 0; i < priv->balance_blocks->len; ++i)
+    {
+        AccountBalanceBlock *block = g_ptr_array_index (priv->balance_blocks, i);
 
-        if (YREC == split->reconciled ||
-                FREC == split->reconciled)
+        if (!gnc_numeric_equal (block->start, balance) ||
+                !gnc_numeric_equal (block->cleared_start, cleared_balance) ||
+                !gnc_numeric_equal (block->reconciled_start,
+                                    reconciled_balance))
         {
-            reconciled_balance =
-                gnc_numeric_add_fixed(reconciled_balance, amt);
+            block->start = balance;
+            block->cleared_start = cleared_balance;
+            block->reconciled_start = reconciled_balance;
+            block->stale = TRUE;
         }
-
-        split->balance = balance;
-        split->cleared_balance = cleared_balance;
-        split->reconciled_balance = reconciled_balance;
-
+        if (block->dirty)
+            balance_block_sum (priv, block);
+
+        balance = gnc_numeric_add_fixed (balance, block->total);
+        cleared_balance = gnc_numeric_add_fixed (cleared_balance,
+                                                 block->cleared_total);
+        reconciled_balance = gnc_numeric_add_fixed (reconciled_balance,
+                                                    block->reconciled_total);
     }
 
     priv->balance = balance;
     priv->cleared_balance = cleared_balance;
     priv->reconciled_balance = reconciled_balance;
     priv->balance_dirty = FALSE;
+    subtree_totals_changed ();
+    qof_book_cache_unlock (qof_instance_get_book (acc));
 }
 
 /********************************************************************\
@@ -2235,6 +3537,7 @@ xaccAccountSetType (Account *acc, GNCAccountType tip)
 
     xaccAccountBeginEdit(acc);
     priv->type = tip;
+    xaccTransForgetImbalances ();
     priv->balance_dirty = TRUE; /* new type may affect balance computation */
     mark_account(acc);
     xaccAccountCommitEdit(acc);
@@ -2255,7 +3558,10 @@ xaccAccountSetName (Account *acc, const char *str)
         return;
 
     xaccAccountBeginEdit(acc);
+    account_name_index_remove (acc);
     CACHE_REPLACE(priv->accountName, str);
+    account_name_index_insert (acc);
+    full_names_changed ();
     mark_account (acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2274,7 +3580,9 @@ xaccAccountSetCode (Account *acc, const char *str)
         return;
 
     xaccAccountBeginEdit(acc);
+    account_name_index_remove (acc);
     CACHE_REPLACE(priv->accountCode, str ? str : "");
+    account_name_index_insert (acc);
     mark_account (acc);
     xaccAccountCommitEdit(acc);
 }
@@ -2329,10 +3637,8 @@ set_kvp_string_tag (Account *acc, const char *tag, const char *value)
 static const char*
 get_kvp_string_tag (const Account *acc, const char *tag)
 {
-    GValue v = G_VALUE_INIT;
     if (acc == NULL || tag == NULL) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE (acc), tag, &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE (acc), tag);
 }
 
 void
@@ -2387,7 +3693,7 @@ void
 xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
 {
     AccountPrivate *priv;
-    GList *lp;
+    guint i;
 
     /* errors */
     g_return_if_fail(GNC_IS_ACCOUNT(acc));
@@ -2406,9 +3712,9 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
     priv->non_standard_scu = FALSE;
 
     /* iterate over splits */
-    for (lp = priv->splits; lp; lp = lp->next)
+    for (i = 0; i < priv->splits->len; ++i)
     {
-        Split *s = (Split *) lp->data;
+        Split *s = (Split *) g_ptr_array_index (priv->splits, i);
         Transaction *trans = xaccSplitGetParent (s);
 
         xaccTransBeginEdit (trans);
@@ -2418,6 +3724,8 @@ xaccAccountSetCommodity (Account * acc, gnc_commodity * com)
 
     priv->sort_dirty = TRUE;  /* Not needed. */
     priv->balance_dirty = TRUE;
+    subtree_totals_changed ();
+    xaccTransForgetImbalances ();
     mark_account (acc);
 
     xaccAccountCommitEdit(acc);
@@ -2562,14 +3870,19 @@ gnc_account_append_child (Account *new_parent, Account *child)
             PWARN ("reparenting accounts across books is not correctly supported\n");
 
             qof_event_gen (&child->inst, QOF_EVENT_DESTROY, NULL);
+            account_name_index_remove (child);
             col = qof_book_get_collection (qof_instance_get_book(new_parent),
                                            GNC_ID_ACCOUNT);
             qof_collection_insert_entity (col, &child->inst);
+            account_name_index_insert (child);
             qof_event_gen (&child->inst, QOF_EVENT_CREATE, NULL);
         }
     }
     cpriv->parent = new_parent;
     ppriv->children = g_list_append(ppriv->children, child);
+    subtree_totals_changed ();
+    subtree_stats_changed ();
+    full_names_changed ();
     qof_instance_set_dirty(&new_parent->inst);
     qof_instance_set_dirty(&child->inst);
 
@@ -2610,6 +3923,9 @@ gnc_account_remove_child (Account *parent, Account *child)
     ed.idx = g_list_index(ppriv->children, child);
 
     ppriv->children = g_list_remove(ppriv->children, child);
+    subtree_totals_changed ();
+    subtree_stats_changed ();
+    full_names_changed ();
 
     /* Now send the event. */
     qof_event_gen(&child->inst, QOF_EVENT_REMOVE, &ed);
@@ -2800,118 +4116,189 @@ gnc_account_get_descendants_sorted (const Account *account)
     return descendants;
 }
 
-Account *
-gnc_account_lookup_by_name (const Account *parent, const char * name)
+/* The accounts from just below parent down to acc, or NULL if acc
+ * isn't a descendant of parent. */
+static GPtrArray *
+account_path_below (const Account *parent, Account *acc)
 {
-    AccountPrivate *cpriv, *ppriv;
-    Account *child, *result;
-    GList *node;
+    GPtrArray *path = g_ptr_array_new ();
+    Account *node;
+    guint i;
 
-    g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
-    g_return_val_if_fail(name, NULL);
-
-    /* first, look for accounts hanging off the current node */
-    ppriv = GET_PRIVATE(parent);
-    for (node = ppriv->children; node; node = node->next)
+    for (node = acc; node && node != parent; node = GET_PRIVATE(node)->parent)
+        g_ptr_array_add (path, node);
+    if (!node)
     {
-        child = node->data;
-        cpriv = GET_PRIVATE(child);
-        if (g_strcmp0(cpriv->accountName, name) == 0)
-            return child;
+        g_ptr_array_free (path, TRUE);
+        return NULL;
     }
 
-    /* if we are still here, then we haven't found the account yet.
-     * Recursively search each of the child accounts next */
-    for (node = ppriv->children; node; node = node->next)
+    /* Top down */
+    for (i = 0; i < path->len / 2; i++)
     {
-        child = node->data;
-        result = gnc_account_lookup_by_name (child, name);
-        if (result)
-            return result;
+        gpointer tmp = g_ptr_array_index (path, i);
+        g_ptr_array_index (path, i) = g_ptr_array_index (path, path->len - 1 - i);
+        g_ptr_array_index (path, path->len - 1 - i) = tmp;
     }
-
-    return NULL;
+    return path;
 }
 
-Account *
-gnc_account_lookup_by_code (const Account *parent, const char * code)
+static gint
+account_sibling_index (Account *acc)
 {
-    AccountPrivate *cpriv, *ppriv;
-    Account *child, *result;
-    GList *node;
+    return g_list_index (GET_PRIVATE(GET_PRIVATE(acc)->parent)->children, acc);
+}
 
-    g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
-    g_return_val_if_fail(code, NULL);
+/* Whether the tree searches below find path a before path b: at each
+ * level they check the children of the current account first, and then
+ * search below each child in turn. */
+static gboolean
+account_path_precedes (GPtrArray *a, GPtrArray *b)
+{
+    guint i;
 
-    /* first, look for accounts hanging off the current node */
-    ppriv = GET_PRIVATE(parent);
-    for (node = ppriv->children; node; node = node->next)
+    for (i = 0; ; i++)
     {
-        child = node->data;
-        cpriv = GET_PRIVATE(child);
-        if (g_strcmp0(cpriv->accountCode, code) == 0)
-            return child;
+        gboolean a_here = (i == a->len - 1), b_here = (i == b->len - 1);
+        Account *a_node = g_ptr_array_index (a, i);
+        Account *b_node = g_ptr_array_index (b, i);
+
+        if (a_here != b_here)
+            return a_here;
+        if (a_here || a_node != b_node)
+            return account_sibling_index (a_node) <
+                   account_sibling_index (b_node);
     }
+}
+
+/* The first of the indexed accounts below parent in search order */
+static Account *
+account_lookup_below (const Account *parent, GPtrArray *accounts)
+{
+    GPtrArray *best_path = NULL;
+    Account *best = NULL;
+    guint i;
+
+    if (!accounts)
+        return NULL;
 
-    /* if we are still here, then we haven't found the account yet.
-     * Recursively search each of the child accounts next */
-    for (node = ppriv->children; node; node = node->next)
+    for (i = 0; i < accounts->len; i++)
     {
-        child = node->data;
-        result = gnc_account_lookup_by_code (child, code);
-        if (result)
-            return result;
+        Account *acc = g_ptr_array_index (accounts, i);
+        GPtrArray *path = account_path_below (parent, acc);
+
+        if (!path)
+            continue;
+        if (path->len == 0)     /* parent itself */
+        {
+            g_ptr_array_free (path, TRUE);
+            continue;
+        }
+        if (!best || account_path_precedes (path, best_path))
+        {
+            if (best_path)
+                g_ptr_array_free (best_path, TRUE);
+            best_path = path;
+            best = acc;
+        }
+        else
+            g_ptr_array_free (path, TRUE);
     }
+    if (best_path)
+        g_ptr_array_free (best_path, TRUE);
+    return best;
+}
 
-    return NULL;
+Account *
+gnc_account_lookup_by_name (const Account *parent, const char * name)
+{
+    AccountNameIndex *index;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
+    g_return_val_if_fail(name, NULL);
+
+    index = get_account_name_index (gnc_account_get_book (parent), TRUE);
+    if (!index)
+        return NULL;
+    return account_lookup_below (parent,
+                                 g_hash_table_lookup (index->by_name, name));
+}
+
+Account *
+gnc_account_lookup_by_code (const Account *parent, const char * code)
+{
+    AccountNameIndex *index;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
+    g_return_val_if_fail(code, NULL);
+
+    index = get_account_name_index (gnc_account_get_book (parent), TRUE);
+    if (!index)
+        return NULL;
+    return account_lookup_below (parent,
+                                 g_hash_table_lookup (index->by_code, code));
 }
 
 /********************************************************************\
  * Fetch an account, given its full name                            *
 \********************************************************************/
 
+/* Whether acc sits at names below root, names holding n_names names */
+static gboolean
+account_has_full_name (const Account *root, Account *acc, gchar **names,
+                       guint n_names)
+{
+    while (n_names > 0)
+    {
+        AccountPrivate *priv;
+
+        if (!acc || acc == root)
+            return FALSE;
+        priv = GET_PRIVATE(acc);
+        if (g_strcmp0 (priv->accountName, names[--n_names]) != 0)
+            return FALSE;
+        acc = priv->parent;
+    }
+    return acc == root;
+}
+
+/* The first account in search order named names below parent */
 static Account *
 gnc_account_lookup_by_full_name_helper (const Account *parent,
                                         gchar **names)
 {
-    const AccountPrivate *priv, *ppriv;
+    AccountNameIndex *index;
+    GPtrArray *accounts, *matches;
     Account *found;
-    GList *node;
+    guint n_names, i;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(parent), NULL);
     g_return_val_if_fail(names, NULL);
 
-    /* Look for the first name in the children. */
-    ppriv = GET_PRIVATE(parent);
-    for (node = ppriv->children; node; node = node->next)
+    /* Start from the accounts with the last name and check the ones
+     * above them. */
+    n_names = g_strv_length (names);
+    if (n_names == 0)
+        return NULL;
+    index = get_account_name_index (gnc_account_get_book (parent), TRUE);
+    if (!index)
+        return NULL;
+    accounts = g_hash_table_lookup (index->by_name, names[n_names - 1]);
+    if (!accounts)
+        return NULL;
+
+    matches = g_ptr_array_new ();
+    for (i = 0; i < accounts->len; i++)
     {
-        Account *account = node->data;
-
-        priv = GET_PRIVATE(account);
-        if (g_strcmp0(priv->accountName, names[0]) == 0)
-        {
-            /* We found an account.  If the next entry is NULL, there is
-             * nothing left in the name, so just return the account. */
-            if (names[1] == NULL)
-                return account;
-
-            /* No children?  We're done. */
-            if (!priv->children)
-                return NULL;
-
-            /* There's stuff left to search for.  Search recursively. */
-            found = gnc_account_lookup_by_full_name_helper(account, &names[1]);
-            if (found != NULL)
-            {
-                return found;
-            }
-        }
+        Account *acc = g_ptr_array_index (accounts, i);
+        if (account_has_full_name (parent, acc, names, n_names))
+            g_ptr_array_add (matches, acc);
     }
-
-    return NULL;
+    found = account_lookup_below (parent, matches);
+    g_ptr_array_free (matches, TRUE);
+    return found;
 }
 
-
 Account *
 gnc_account_lookup_by_full_name (const Account *any_acc,
                                  const gchar *name)
@@ -3083,6 +4470,49 @@ gnc_account_get_full_name(const Account *account)
     return fullname;
 }
 
+static void
+account_update_cached_full_name (const Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+
+    if (priv->full_name && priv->full_name_stamp == full_names_generation)
+        return;
+
+    g_free (priv->full_name);
+    g_free (priv->full_name_key);
+    priv->full_name = gnc_account_get_full_name (acc);
+    priv->full_name_key = g_utf8_collate_key (priv->full_name, -1);
+    priv->full_name_stamp = full_names_generation;
+}
+
+const char *
+gnc_account_get_cached_full_name (const Account *acc)
+{
+    if (NULL == acc)
+        return "";
+    g_return_val_if_fail (GNC_IS_ACCOUNT(acc), "");
+
+    account_update_cached_full_name (acc);
+    return GET_PRIVATE(acc)->full_name;
+}
+
+const char *
+gnc_account_get_full_name_collate_key (const Account *acc)
+{
+    static gchar *empty_key = NULL;
+
+    if (NULL == acc)
+    {
+        if (!empty_key)
+            empty_key = g_utf8_collate_key ("", -1);
+        return empty_key;
+    }
+    g_return_val_if_fail (GNC_IS_ACCOUNT(acc), "");
+
+    account_update_cached_full_name (acc);
+    return GET_PRIVATE(acc)->full_name_key;
+}
+
 const char *
 xaccAccountGetCode (const Account *acc)
 {
@@ -3136,14 +4566,11 @@ xaccAccountGetNotes (const Account *acc)
 gnc_commodity *
 DxaccAccountGetCurrency (const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
-    const char *s = NULL;
+    const char *s;
     gnc_commodity_table *table;
 
     if (!acc) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "old-currency", &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-        s = g_value_get_string (&v);
+    s = qof_instance_get_kvp_string (QOF_INSTANCE(acc), "old-currency");
     if (!s) return NULL;
 
     table = gnc_commodity_table_get_table (qof_instance_get_book(acc));
@@ -3257,7 +4684,7 @@ gnc_numeric
 xaccAccountGetProjectedMinimumBalance (const Account *acc)
 {
     AccountPrivate *priv;
-    GList *node;
+    guint i;
     time64 today;
     gnc_numeric lowest = gnc_numeric_zero ();
     int seen_a_transaction = 0;
@@ -3266,9 +4693,9 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 
     priv = GET_PRIVATE(acc);
     today = gnc_time64_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+    for (i = priv->splits->len; i > 0; --i)
     {
-        Split *split = node->data;
+        Split *split = g_ptr_array_index (priv->splits, i - 1);
 
         if (!seen_a_transaction)
         {
@@ -3291,76 +4718,61 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 /********************************************************************\
 \********************************************************************/
 
+static AccountBalanceLoader balance_loader = NULL;
+
+/* Ask the backend for the balance of a pending account, so that its
+ * splits needn't be loaded.  Otherwise load them. */
+static gboolean
+account_pending_balance_as_of (Account *acc, time64 date,
+                               gnc_numeric *balance)
+{
+    QofBackend *be;
+
+    if (!GET_PRIVATE(acc)->splits_pending)
+        return FALSE;
+
+    be = qof_book_get_backend (gnc_account_get_book (acc));
+    if (balance_loader && be && balance_loader (be, acc, date, balance))
+        return TRUE;
+
+    gnc_account_load_splits (acc);
+    return FALSE;
+}
+
 gnc_numeric
 xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
 {
-    /* Ideally this could use xaccAccountForEachSplit, but
-     * it doesn't exist yet and I'm uncertain of exactly how
-     * it would work at this time, since it differs from
-     * xaccAccountForEachTransaction by using gpointer return
-     * values rather than gints.
-     */
     AccountPrivate *priv;
-    GList   *lp;
-    Timespec ts, trans_ts;
-    gboolean found = FALSE;
+    GArray *index;
     gnc_numeric balance;
+    guint i;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
+    if (account_pending_balance_as_of (acc, date, &balance))
+        return balance;
+
     xaccAccountSortSplits (acc, TRUE); /* just in case, normally a noop */
     xaccAccountRecomputeBalance (acc); /* just in case, normally a noop */
 
     priv = GET_PRIVATE(acc);
-    balance = priv->balance;
-
-    /* Since transaction post times are stored as a Timespec,
-     * convert date into a Timespec as well rather than converting
-     * each transaction's Timespec into a time64.
-     *
-     * FIXME: CAS: I think this comment is a bogus justification for
-     * using xaccTransGetDatePostedTS.  There's no benefit to using
-     * Timespec when the input argument is time64, and it's hard to
-     * imagine that casting long long to long and comparing two longs is
-     * worse than comparing two long longs every time.  IMO,
-     * xaccAccountGetPresentBalance gets this right, and its algorithm
-     * should be used here.
-     */
-    ts.tv_sec = date;
-    ts.tv_nsec = 0;
+    index = account_get_date_index (acc);
 
-    lp = priv->splits;
-    while ( lp && !found )
-    {
-        xaccTransGetDatePostedTS( xaccSplitGetParent( (Split *)lp->data ),
-                                  &trans_ts );
-        if ( timespec_cmp( &trans_ts, &ts ) >= 0 )
-            found = TRUE;
-        else
-            lp = lp->next;
-    }
+    /* Find the first split posted on or after the date; the balance we
+     * want is the running balance of the split before it. */
+    i = date_index_lower_bound (index, date);
 
-    if ( lp )
-    {
-        if ( lp->prev )
-        {
-            /* Since lp is now pointing to a split which was past the reconcile
-             * date, get the running balance of the previous split.
-             */
-            balance = xaccSplitGetBalance( (Split *)lp->prev->data );
-        }
-        else
-        {
-            /* AsOf date must be before any entries, return zero. */
-            balance = gnc_numeric_zero();
-        }
-    }
+    /* No splits posted after the given date, so the latest account
+     * balance is good enough. */
+    if (i == index->len)
+        return priv->balance;
 
-    /* Otherwise there were no splits posted after the given date,
-     * so the latest account balance should be good enough.
-     */
+    /* AsOf date must be before any entries, return zero. */
+    if (i == 0)
+        return gnc_numeric_zero();
 
-    return( balance );
+    return xaccSplitGetBalance (g_array_index (index, AccountDateEntry,
+                                               i - 1).split);
 }
 
 /*
@@ -3375,16 +4787,28 @@ gnc_numeric
 xaccAccountGetPresentBalance (const Account *acc)
 {
     AccountPrivate *priv;
-    GList *node;
+    guint i;
     time64 today;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
     priv = GET_PRIVATE(acc);
     today = gnc_time64_get_today_end();
-    for (node = g_list_last(priv->splits); node; node = node->prev)
+
+    if (!priv->sort_dirty)
+    {
+        GArray *index = account_get_date_index (acc);
+        guint i = date_index_upper_bound (index, today);
+
+        if (i == 0)
+            return gnc_numeric_zero ();
+        return xaccSplitGetBalance (g_array_index (index, AccountDateEntry,
+                                                   i - 1).split);
+    }
+
+    for (i = priv->splits->len; i > 0; --i)
     {
-        Split *split = node->data;
+        Split *split = g_ptr_array_index (priv->splits, i - 1);
 
         if (xaccTransGetDate (xaccSplitGetParent (split)) <= today)
             return xaccSplitGetBalance (split);
@@ -3546,6 +4970,63 @@ xaccAccountBalanceAsOfDateHelper (Account *acc, gpointer data)
 
 
 
+typedef struct
+{
+    xaccGetBalanceFn fn;
+    const gnc_commodity *commodity;
+    gnc_numeric total;
+} AccountSubtreeTotal;
+
+/*
+ * The balance of an account and all its descendants in the given
+ * commodity, summed bottom up.  The total of every account visited is
+ * kept until a balance, the tree or a price changes, so that the
+ * account tree asking for each of its rows in turn only converts and
+ * adds each account once.  Only the stored balances are cached, as the
+ * present and projected ones change with the day.
+ */
+static gnc_numeric
+account_subtree_total (const Account *acc, xaccGetBalanceFn fn,
+                       const gnc_commodity *commodity)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    guint stamp = subtree_totals_generation + gnc_pricedb_get_mod_count ();
+    AccountSubtreeTotal entry;
+    GList *node;
+    guint i;
+
+    if (!priv->subtree_totals)
+        priv->subtree_totals = g_array_new (FALSE, FALSE,
+                                            sizeof (AccountSubtreeTotal));
+    if (priv->subtree_totals_stamp != stamp)
+    {
+        g_array_set_size (priv->subtree_totals, 0);
+        priv->subtree_totals_stamp = stamp;
+    }
+    for (i = 0; i < priv->subtree_totals->len; i++)
+    {
+        AccountSubtreeTotal *cached = &g_array_index (priv->subtree_totals,
+                                                      AccountSubtreeTotal, i);
+        if (cached->fn == fn && cached->commodity == commodity)
+            return cached->total;
+    }
+
+    entry.fn = fn;
+    entry.commodity = commodity;
+    entry.total = xaccAccountGetXxxBalanceInCurrency (acc, fn, commodity);
+    for (node = priv->children; node; node = node->next)
+        entry.total = gnc_numeric_add (entry.total,
+                                       account_subtree_total (node->data, fn,
+                                                              commodity),
+                                       gnc_commodity_get_fraction (commodity),
+                                       GNC_HOW_RND_ROUND_HALF_UP);
+
+    /* Converting the balances must not have changed any of them. */
+    if (stamp == subtree_totals_generation + gnc_pricedb_get_mod_count ())
+        g_array_append_val (priv->subtree_totals, entry);
+    return entry.total;
+}
+
 /*
  * Common function that iterates recursively over all accounts below
  * the specified account.  It uses xaccAccountBalanceHelper to sum up
@@ -3570,6 +5051,16 @@ xaccAccountGetXxxBalanceInCurrencyRecursive (const Account *acc,
     if (!report_commodity)
         return gnc_numeric_zero();
 
+    if (include_children && (fn == xaccAccountGetBalance ||
+                             fn == xaccAccountGetClearedBalance ||
+                             fn == xaccAccountGetReconciledBalance))
+    {
+        qof_book_cache_lock (qof_instance_get_book (acc));
+        balance = account_subtree_total (acc, fn, report_commodity);
+        qof_book_cache_unlock (qof_instance_get_book (acc));
+        return balance;
+    }
+
     balance = xaccAccountGetXxxBalanceInCurrency (acc, fn, report_commodity);
 
     /* If needed, sum up the children converting to the *requested*
@@ -3623,128 +5114,502 @@ xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
         CurrencyBalance cb = { report_commodity, balance, NULL, fn, date };
 #endif
 
-        gnc_account_foreach_descendant (acc, xaccAccountBalanceAsOfDateHelper, &cb);
-        balance = cb.balance;
-    }
+        gnc_account_foreach_descendant (acc, xaccAccountBalanceAsOfDateHelper, &cb);
+        balance = cb.balance;
+    }
+
+    return balance;
+}
+
+gnc_numeric
+xaccAccountGetBalanceInCurrency (const Account *acc,
+                                 const gnc_commodity *report_commodity,
+                                 gboolean include_children)
+{
+    gnc_numeric rc;
+    rc = xaccAccountGetXxxBalanceInCurrencyRecursive (
+             acc, xaccAccountGetBalance, report_commodity, include_children);
+    PINFO(" baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, rc.num, rc.denom);
+    return rc;
+}
+
+
+gnc_numeric
+xaccAccountGetClearedBalanceInCurrency (const Account *acc,
+                                        const gnc_commodity *report_commodity,
+                                        gboolean include_children)
+{
+    return xaccAccountGetXxxBalanceInCurrencyRecursive (
+               acc, xaccAccountGetClearedBalance, report_commodity,
+               include_children);
+}
+
+gnc_numeric
+xaccAccountGetReconciledBalanceInCurrency (const Account *acc,
+        const gnc_commodity *report_commodity,
+        gboolean include_children)
+{
+    return xaccAccountGetXxxBalanceInCurrencyRecursive (
+               acc, xaccAccountGetReconciledBalance, report_commodity,
+               include_children);
+}
+
+gnc_numeric
+xaccAccountGetPresentBalanceInCurrency (const Account *acc,
+                                        const gnc_commodity *report_commodity,
+                                        gboolean include_children)
+{
+    return xaccAccountGetXxxBalanceInCurrencyRecursive (
+               acc, xaccAccountGetPresentBalance, report_commodity,
+               include_children);
+}
+
+gnc_numeric
+xaccAccountGetProjectedMinimumBalanceInCurrency (
+    const Account *acc,
+    const gnc_commodity *report_commodity,
+    gboolean include_children)
+{
+    return xaccAccountGetXxxBalanceInCurrencyRecursive (
+               acc, xaccAccountGetProjectedMinimumBalance, report_commodity,
+               include_children);
+}
+
+gnc_numeric
+xaccAccountGetBalanceAsOfDateInCurrency(
+    Account *acc, time64 date, gnc_commodity *report_commodity,
+    gboolean include_children)
+{
+    return xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
+               acc, date, xaccAccountGetBalanceAsOfDate, report_commodity,
+               include_children);
+}
+
+gnc_numeric
+xaccAccountGetBalanceChangeForPeriod (Account *acc, time64 t1, time64 t2,
+                                      gboolean recurse)
+{
+    gnc_numeric b1, b2;
+
+    b1 = xaccAccountGetBalanceAsOfDateInCurrency(acc, t1, NULL, recurse);
+    b2 = xaccAccountGetBalanceAsOfDateInCurrency(acc, t2, NULL, recurse);
+    return gnc_numeric_sub(b2, b1, GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
+}
+
+typedef struct
+{
+    Account *acc;
+    gnc_commodity *commodity;
+    guint end;                  /* the row after the last descendant */
+} BalanceMatrixRow;
+
+/* Append the rows of @acc and its descendants, in the order
+ * gnc_account_get_descendants returns them. */
+static void
+balance_matrix_add_rows (GArray *rows, Account *acc)
+{
+    BalanceMatrixRow row;
+    guint index = rows->len;
+    GList *node;
+
+    row.acc = acc;
+    row.commodity = xaccAccountGetCommodity (acc);
+    row.end = 0;
+    g_array_append_val (rows, row);
+
+    for (node = GET_PRIVATE(acc)->children; node; node = node->next)
+        balance_matrix_add_rows (rows, node->data);
+    g_array_index (rows, BalanceMatrixRow, index).end = rows->len;
+}
+
+/* The same balances as xaccAccountGetBalanceAsOfDate, but looking the
+ * dates up in one pass over the date index while they are increasing. */
+static void
+account_balances_as_of_dates (Account *acc, const time64 *dates,
+                              guint n_dates, gnc_numeric *balances)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    GArray *index;
+    guint i, j = 0;
+
+    for (i = 0; priv->splits_pending && i < n_dates; i++)
+        if (!account_pending_balance_as_of (acc, dates[i], &balances[i]))
+            break;
+    if (n_dates > 0 && i == n_dates)
+        return;
+
+    xaccAccountSortSplits (acc, TRUE);
+    xaccAccountRecomputeBalance (acc);
+    index = account_get_date_index (acc);
+
+    for (i = 0; i < n_dates; i++)
+    {
+        if (i == 0 || dates[i] < dates[i - 1])
+            j = 0;
+        j = date_index_lower_bound_from (index, j, dates[i]);
+
+        if (j == index->len)
+            balances[i] = priv->balance;
+        else if (j == 0)
+            balances[i] = gnc_numeric_zero ();
+        else
+            balances[i] = xaccSplitGetBalance (g_array_index (index,
+                                               AccountDateEntry,
+                                               j - 1).split);
+    }
+}
+
+gnc_numeric *
+xaccAccountTreeGetBalanceMatrix (Account *root, const time64 *dates,
+                                 guint n_dates,
+                                 gnc_commodity *report_commodity,
+                                 gboolean include_children)
+{
+    GArray *rows;
+    gnc_numeric *native, *converted, *matrix;
+    guint r, k, i;
+
+    g_return_val_if_fail (GNC_IS_ACCOUNT(root), NULL);
+    g_return_val_if_fail (dates || n_dates == 0, NULL);
+
+    rows = g_array_new (FALSE, FALSE, sizeof (BalanceMatrixRow));
+    balance_matrix_add_rows (rows, root);
+
+    native = g_new (gnc_numeric, rows->len * n_dates);
+    for (r = 0; r < rows->len; r++)
+        account_balances_as_of_dates (g_array_index (rows, BalanceMatrixRow,
+                                                     r).acc,
+                                      dates, n_dates, native + r * n_dates);
+
+    /* With a single report commodity every balance is converted once,
+     * however many ancestors it gets added to. */
+    converted = native;
+    if (report_commodity)
+    {
+        converted = g_new (gnc_numeric, rows->len * n_dates);
+        for (r = 0; r < rows->len; r++)
+        {
+            BalanceMatrixRow *row = &g_array_index (rows, BalanceMatrixRow, r);
+
+            for (i = 0; i < n_dates; i++)
+                converted[r * n_dates + i] =
+                    xaccAccountConvertBalanceToCurrency (
+                        row->acc, native[r * n_dates + i], row->commodity,
+                        report_commodity);
+        }
+    }
+
+    matrix = g_new (gnc_numeric, rows->len * n_dates);
+    for (r = 0; r < rows->len; r++)
+    {
+        BalanceMatrixRow *row = &g_array_index (rows, BalanceMatrixRow, r);
+        gnc_commodity *commodity = report_commodity ? report_commodity :
+                                   row->commodity;
+        guint end = include_children ? row->end : r + 1;
+
+        for (i = 0; i < n_dates; i++)
+        {
+            gnc_numeric balance = gnc_numeric_zero ();
+
+            if (!commodity)
+            {
+                matrix[r * n_dates + i] = balance;
+                continue;
+            }
+
+            /* Sum in the same order and with the same rounding as
+             * xaccAccountGetBalanceAsOfDateInCurrency. */
+            balance = converted[r * n_dates + i];
+            for (k = r + 1; k < end; k++)
+            {
+                BalanceMatrixRow *child = &g_array_index (rows,
+                                                          BalanceMatrixRow, k);
+                gnc_numeric child_balance = converted[k * n_dates + i];
+
+                if (!report_commodity)
+                    child_balance = xaccAccountConvertBalanceToCurrency (
+                                        child->acc, child_balance,
+                                        child->commodity, commodity);
+                balance = gnc_numeric_add (balance, child_balance,
+                                           gnc_commodity_get_fraction (commodity),
+                                           GNC_HOW_RND_ROUND_HALF_UP);
+            }
+            matrix[r * n_dates + i] = balance;
+        }
+    }
+
+    if (converted != native)
+        g_free (converted);
+    g_free (native);
+    g_array_free (rows, TRUE);
+    return matrix;
+}
+
+
+/********************************************************************\
+\********************************************************************/
+
+static AccountSplitsLoader splits_loader = NULL;
+
+void
+gnc_account_set_splits_loader (AccountSplitsLoader loader)
+{
+    splits_loader = loader;
+}
+
+void
+gnc_account_set_balance_loader (AccountBalanceLoader loader)
+{
+    balance_loader = loader;
+}
+
+void
+gnc_account_set_splits_pending (Account *acc, gboolean pending)
+{
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    GET_PRIVATE(acc)->splits_pending = pending;
+}
+
+gboolean
+gnc_account_get_splits_pending (const Account *acc)
+{
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
+    return GET_PRIVATE(acc)->splits_pending;
+}
+
+/* The flag is cleared before calling the loader: loading the account's
+ * transactions adds their splits here and may ask for these splits
+ * again. */
+void
+gnc_account_load_splits (Account *acc)
+{
+    AccountPrivate *priv;
+    QofBackend *be;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    priv = GET_PRIVATE(acc);
+    if (!priv->splits_pending)
+        return;
+    priv->splits_pending = FALSE;
+
+    be = qof_book_get_backend (gnc_account_get_book (acc));
+    if (splits_loader == NULL || be == NULL)
+        return;
 
-    return balance;
+    ENTER ("(acc=%s)", priv->accountName);
+    splits_loader (be, acc);
+    LEAVE ("(acc=%s, %u splits)", priv->accountName, priv->splits->len);
 }
 
-gnc_numeric
-xaccAccountGetBalanceInCurrency (const Account *acc,
-                                 const gnc_commodity *report_commodity,
-                                 gboolean include_children)
+/* The splits live in priv->splits; the GList handed out here is a
+ * view of it that's built on first use and then kept in step by
+ * gnc_account_insert_split() and gnc_account_remove_split(), because
+ * callers still expect the same list back on every call and don't free
+ * it.  Accounts nobody asks for a list from never pay for one. */
+/* XXX: violates the const'ness by forcing a sort before returning
+ * the splitlist */
+SplitList *
+xaccAccountGetSplitList (const Account *acc)
 {
-    gnc_numeric rc;
-    rc = xaccAccountGetXxxBalanceInCurrencyRecursive (
-             acc, xaccAccountGetBalance, report_commodity, include_children);
-    PINFO(" baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, rc.num, rc.denom);
-    return rc;
-}
+    AccountPrivate *priv;
+    guint i;
 
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
+    gnc_account_load_splits((Account*)acc);
+    xaccAccountSortSplits((Account*)acc, FALSE);  // normally a noop
 
-gnc_numeric
-xaccAccountGetClearedBalanceInCurrency (const Account *acc,
-                                        const gnc_commodity *report_commodity,
-                                        gboolean include_children)
-{
-    return xaccAccountGetXxxBalanceInCurrencyRecursive (
-               acc, xaccAccountGetClearedBalance, report_commodity,
-               include_children);
+    priv = GET_PRIVATE(acc);
+    if (!priv->split_list_built)
+    {
+        for (i = priv->splits->len; i > 0; --i)
+            priv->split_list = g_list_prepend (priv->split_list,
+                                               g_ptr_array_index (priv->splits,
+                                                                  i - 1));
+        priv->split_list_built = TRUE;
+    }
+    return priv->split_list;
 }
 
-gnc_numeric
-xaccAccountGetReconciledBalanceInCurrency (const Account *acc,
-        const gnc_commodity *report_commodity,
-        gboolean include_children)
+gint
+gnc_account_n_splits (const Account *acc)
 {
-    return xaccAccountGetXxxBalanceInCurrencyRecursive (
-               acc, xaccAccountGetReconciledBalance, report_commodity,
-               include_children);
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), 0);
+    gnc_account_load_splits((Account*)acc);
+    xaccAccountSortSplits((Account*)acc, FALSE);
+    return GET_PRIVATE(acc)->splits->len;
 }
 
-gnc_numeric
-xaccAccountGetPresentBalanceInCurrency (const Account *acc,
-                                        const gnc_commodity *report_commodity,
-                                        gboolean include_children)
+Split *
+gnc_account_nth_split (const Account *acc, gint num)
 {
-    return xaccAccountGetXxxBalanceInCurrencyRecursive (
-               acc, xaccAccountGetPresentBalance, report_commodity,
-               include_children);
+    AccountPrivate *priv;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
+    gnc_account_load_splits((Account*)acc);
+    xaccAccountSortSplits((Account*)acc, FALSE);
+
+    priv = GET_PRIVATE(acc);
+    if ((num < 0) || ((guint) num >= priv->splits->len))
+        return NULL;
+    return g_ptr_array_index (priv->splits, num);
 }
 
-gnc_numeric
-xaccAccountGetProjectedMinimumBalanceInCurrency (
-    const Account *acc,
-    const gnc_commodity *report_commodity,
-    gboolean include_children)
+void
+gnc_account_foreach_unreconciled_split (const Account *acc, GFunc func,
+                                        gpointer user_data)
 {
-    return xaccAccountGetXxxBalanceInCurrencyRecursive (
-               acc, xaccAccountGetProjectedMinimumBalance, report_commodity,
-               include_children);
+    GHashTableIter iter;
+    gpointer split;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(func);
+
+    gnc_account_load_splits((Account*)acc);
+    g_hash_table_iter_init (&iter, GET_PRIVATE(acc)->unreconciled);
+    while (g_hash_table_iter_next (&iter, &split, NULL))
+        func (split, user_data);
 }
 
-gnc_numeric
-xaccAccountGetBalanceAsOfDateInCurrency(
-    Account *acc, time64 date, gnc_commodity *report_commodity,
-    gboolean include_children)
+void
+gnc_account_split_iter_init (AccountSplitIter *iter, const Account *acc)
 {
-    return xaccAccountGetXxxBalanceAsOfDateInCurrencyRecursive (
-               acc, date, xaccAccountGetBalanceAsOfDate, report_commodity,
-               include_children);
+    g_return_if_fail (iter);
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+
+    gnc_account_load_splits((Account*)acc);
+    xaccAccountSortSplits((Account*)acc, FALSE);
+    iter->account = acc;
+    iter->index = 0;
+    iter->current = NULL;
 }
 
-gnc_numeric
-xaccAccountGetBalanceChangeForPeriod (Account *acc, time64 t1, time64 t2,
-                                      gboolean recurse)
+Split *
+gnc_account_split_iter_next (AccountSplitIter *iter)
 {
-    gnc_numeric b1, b2;
+    AccountPrivate *priv;
 
-    b1 = xaccAccountGetBalanceAsOfDateInCurrency(acc, t1, NULL, recurse);
-    b2 = xaccAccountGetBalanceAsOfDateInCurrency(acc, t2, NULL, recurse);
-    return gnc_numeric_sub(b2, b1, GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
+    g_return_val_if_fail (iter, NULL);
+    if (!iter->account)
+        return NULL;
+
+    /* Step past the split returned last time, unless it has since been
+     * taken out of the account and its successor moved into its slot. */
+    priv = GET_PRIVATE(iter->account);
+    if (iter->current && iter->index < priv->splits->len &&
+            g_ptr_array_index (priv->splits, iter->index) == iter->current)
+        ++iter->index;
+
+    if (iter->index >= priv->splits->len)
+    {
+        iter->current = NULL;
+        return NULL;
+    }
+    iter->current = g_ptr_array_index (priv->splits, iter->index);
+    return iter->current;
 }
 
+/* The post date range of the account's own splits.  While they're
+ * sorted the first and last split have the earliest and latest dates.
+ * @return FALSE if the account has no splits. */
+static gboolean
+account_own_date_range (Account *acc, time64 *first, time64 *last)
+{
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    guint i, n = gnc_account_n_splits (acc);
+
+    if (n == 0)
+        return FALSE;
 
-/********************************************************************\
-\********************************************************************/
+    if (!priv->sort_dirty)
+    {
+        *first = xaccTransGetDate (xaccSplitGetParent (SPLIT_AT (priv, 0)));
+        *last = xaccTransGetDate (xaccSplitGetParent (SPLIT_AT (priv, n - 1)));
+        return TRUE;
+    }
 
-/* THIS API NEEDS TO CHANGE.
- *
- * This code exposes the internal structure of the account object to
- * external callers by returning the actual list used by the object.
- * It should instead return a copy of the split list that the caller
- * is required to free.  That change would provide the freedom of
- * allowing the internal organization to change data structures if
- * necessary for whatever reason, while leaving the external API
- * unchanged. */
-/* XXX: violates the const'ness by forcing a sort before returning
- * the splitlist */
-SplitList *
-xaccAccountGetSplitList (const Account *acc)
+    *first = INT64_MAX;
+    *last = INT64_MIN;
+    for (i = 0; i < n; ++i)
+    {
+        time64 date = xaccTransGetDate (xaccSplitGetParent (SPLIT_AT (priv, i)));
+        *first = MIN (*first, date);
+        *last = MAX (*last, date);
+    }
+    return TRUE;
+}
+
+/* Bring the split count and date range of acc and its descendants up
+ * to date.  The children's are kept too, so asking for every account
+ * of the tree in turn, as the account tree's filter does, visits each
+ * account once per change. */
+static AccountPrivate *
+account_get_subtree_stats (Account *acc)
 {
-    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), NULL);
-    xaccAccountSortSplits((Account*)acc, FALSE);  // normally a noop
-    return GET_PRIVATE(acc)->splits;
+    AccountPrivate *priv = GET_PRIVATE(acc);
+    GList *node;
+
+    if (priv->subtree_stats_stamp == subtree_stats_generation)
+        return priv;
+
+    priv->subtree_n_splits = gnc_account_n_splits (acc);
+    if (!account_own_date_range (acc, &priv->subtree_first_date,
+                                 &priv->subtree_last_date))
+    {
+        priv->subtree_first_date = INT64_MAX;
+        priv->subtree_last_date = INT64_MIN;
+    }
+
+    for (node = priv->children; node; node = node->next)
+    {
+        AccountPrivate *cpriv = account_get_subtree_stats (node->data);
+
+        priv->subtree_n_splits += cpriv->subtree_n_splits;
+        priv->subtree_first_date = MIN (priv->subtree_first_date,
+                                        cpriv->subtree_first_date);
+        priv->subtree_last_date = MAX (priv->subtree_last_date,
+                                       cpriv->subtree_last_date);
+    }
+
+    priv->subtree_stats_stamp = subtree_stats_generation;
+    return priv;
 }
 
 gint64
 xaccAccountCountSplits (const Account *acc, gboolean include_children)
 {
-    gint64 nr, i;
-
-    nr = 0;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), 0);
 
-    nr = g_list_length(xaccAccountGetSplitList(acc));
-    if (include_children && (gnc_account_n_children(acc) != 0))
+    if (!include_children)
+        return gnc_account_n_splits(acc);
+    return account_get_subtree_stats ((Account*)acc)->subtree_n_splits;
+}
+
+gboolean
+xaccAccountGetPostDateRange (const Account *acc, gboolean include_children,
+                             time64 *first, time64 *last)
+{
+    time64 f, l;
+
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
+
+    if (include_children)
     {
-        for (i=0; i < gnc_account_n_children(acc); i++)
-        {
-            nr += xaccAccountCountSplits(gnc_account_nth_child(acc, i), TRUE);
-        }
+        AccountPrivate *priv = account_get_subtree_stats ((Account*)acc);
+
+        if (priv->subtree_n_splits == 0)
+            return FALSE;
+        f = priv->subtree_first_date;
+        l = priv->subtree_last_date;
     }
-    return nr;
+    else if (!account_own_date_range ((Account*)acc, &f, &l))
+        return FALSE;
+
+    if (first)
+        *first = f;
+    if (last)
+        *last = l;
+    return TRUE;
 }
 
 LotList *
@@ -3824,14 +5689,11 @@ set_boolean_key (Account *acc, const char* key, gboolean option)
 static gboolean
 boolean_from_key (const Account *acc, const char *key)
 {
-    GValue v = G_VALUE_INIT;
+    const char *s;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), key, &v);
-    if (G_VALUE_HOLDS_BOOLEAN (&v))
-         return g_value_get_boolean (&v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         return strcmp (g_value_get_string (&v), "true") == 0;
-    return FALSE;
+    /* KVP has no boolean type, so the flag is stored as a string. */
+    s = qof_instance_get_kvp_string (QOF_INSTANCE(acc), key);
+    return s != NULL && strcmp (s, "true") == 0;
 }
 
 /********************************************************************\
@@ -3853,10 +5715,8 @@ xaccAccountSetTaxRelated (Account *acc, gboolean tax_related)
 const char *
 xaccAccountGetTaxUSCode (const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "/tax-US/code", &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE(acc), "/tax-US/code");
 }
 
 void
@@ -3876,11 +5736,9 @@ xaccAccountSetTaxUSCode (Account *acc, const char *code)
 const char *
 xaccAccountGetTaxUSPayerNameSource (const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc),
-                          "/tax-US/payer-name-source", &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE(acc),
+                                        "/tax-US/payer-name-source");
  }
 
 void
@@ -3901,11 +5759,9 @@ gint64
 xaccAccountGetTaxUSCopyNumber (const Account *acc)
 {
     gint64 copy_number = 0;
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "/tax-US/copy-number", &v);
-    if (G_VALUE_HOLDS_INT64 (&v))
-        copy_number = g_value_get_int64 (&v);
+    qof_instance_get_kvp_int64 (QOF_INSTANCE(acc), "/tax-US/copy-number",
+                                &copy_number);
 
     return (copy_number == 0) ? 1 : copy_number;
 }
@@ -4267,11 +6123,9 @@ gboolean
 xaccAccountGetReconcileLastDate (const Account *acc, time64 *last_date)
 {
     gint64 date = 0;
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "reconcile-info/last-date", &v);
-    if (G_VALUE_HOLDS_INT64 (&v))
-        date = g_value_get_int64 (&v);
+    qof_instance_get_kvp_int64 (QOF_INSTANCE(acc), "reconcile-info/last-date",
+                                &date);
 
     if (date)
     {
@@ -4306,19 +6160,14 @@ gboolean
 xaccAccountGetReconcileLastInterval (const Account *acc,
                                      int *months, int *days)
 {
-    GValue v1 = G_VALUE_INIT, v2 = G_VALUE_INIT;
-    int64_t m = 0, d = 0;
+    gint64 m = 0, d = 0;
 
     if (!acc) return FALSE;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc),
-                          "reconcile-info/last-interval/months", &v1);
-    qof_instance_get_kvp (QOF_INSTANCE(acc),
-                          "reconcile-info/last-interval/days", &v2);
-    if (G_VALUE_HOLDS_INT64 (&v1))
-        m = g_value_get_int64 (&v1);
-    if (G_VALUE_HOLDS_INT64 (&v2))
-        d = g_value_get_int64 (&v2);
+    qof_instance_get_kvp_int64 (QOF_INSTANCE(acc),
+                                "reconcile-info/last-interval/months", &m);
+    qof_instance_get_kvp_int64 (QOF_INSTANCE(acc),
+                                "reconcile-info/last-interval/days", &d);
     if (m && d)
     {
         if (months)
@@ -4359,12 +6208,9 @@ gboolean
 xaccAccountGetReconcilePostponeDate (const Account *acc, time64 *postpone_date)
 {
     gint64 date = 0;
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc),
-                          "reconcile-info/postpone/date", &v);
-    if (G_VALUE_HOLDS_INT64 (&v))
-        date = g_value_get_int64 (&v);
+    qof_instance_get_kvp_int64 (QOF_INSTANCE(acc),
+                                "reconcile-info/postpone/date", &date);
 
     if (date)
     {
@@ -4401,12 +6247,9 @@ xaccAccountGetReconcilePostponeBalance (const Account *acc,
                                         gnc_numeric *balance)
 {
     gnc_numeric bal = gnc_numeric_zero ();
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc),
-                          "reconcile-info/postpone/balance", &v);
-    if (G_VALUE_HOLDS_INT64 (&v))
-        bal = *(gnc_numeric*)g_value_get_boxed (&v);
+    qof_instance_get_kvp_numeric (QOF_INSTANCE(acc),
+                                  "reconcile-info/postpone/balance", &bal);
 
     if (bal.denom)
     {
@@ -4478,10 +6321,8 @@ xaccAccountSetAutoInterestXfer (Account *acc, gboolean option)
 const char *
 xaccAccountGetLastNum (const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "last-num", &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE(acc), "last-num");
 }
 
 /********************************************************************\
@@ -4549,21 +6390,18 @@ GetOrMakeOrphanAccount (Account *root, gnc_commodity * currency)
 Account *
 xaccAccountGainsAccount (Account *acc, gnc_commodity *curr)
 {
-    GValue v = G_VALUE_INIT;
     gchar *curr_name = g_strdup_printf ("/lot-mgmt/gains-act/%s",
                                       gnc_commodity_get_unique_name (curr));
-    GncGUID *guid = NULL;
+    const GncGUID *guid;
     Account *gains_account;
 
     g_return_val_if_fail (acc != NULL, NULL);
-    qof_instance_get_kvp (QOF_INSTANCE(acc), curr_name, &v);
-    if (G_VALUE_HOLDS_BOXED (&v))
-        guid = (GncGUID*)g_value_get_boxed (&v);
+    guid = qof_instance_get_kvp_guid (QOF_INSTANCE(acc), curr_name);
     if (guid == NULL) /* No gains account for this currency */
     {
         gains_account = GetOrMakeOrphanAccount (gnc_account_get_root (acc),
                                                 curr);
-        guid = (GncGUID*)qof_instance_get_guid (QOF_INSTANCE (gains_account));
+        guid = qof_instance_get_guid (QOF_INSTANCE (gains_account));
         xaccAccountBeginEdit (acc);
         {
              GValue vr = G_VALUE_INIT;
@@ -4615,13 +6453,11 @@ dxaccAccountSetPriceSrc(Account *acc, const char *src)
 const char*
 dxaccAccountGetPriceSrc(const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
     if (!acc) return NULL;
 
     if (!xaccAccountIsPriced(acc)) return NULL;
 
-    qof_instance_get_kvp (QOF_INSTANCE(acc), "old-price-source", &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE(acc), "old-price-source");
 }
 
 /********************************************************************\
@@ -4647,11 +6483,9 @@ dxaccAccountSetQuoteTZ(Account *acc, const char *tz)
 const char*
 dxaccAccountGetQuoteTZ(const Account *acc)
 {
-    GValue v = G_VALUE_INIT;
     if (!acc) return NULL;
     if (!xaccAccountIsPriced(acc)) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE (acc), "old-quote-tz", &v);
-    return G_VALUE_HOLDS_STRING (&v) ? g_value_get_string (&v) : NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE (acc), "old-quote-tz");
 }
 
 /********************************************************************\
@@ -4686,11 +6520,11 @@ xaccAccountGetReconcileChildrenStatus(const Account *acc)
      * is found then we can assume not to include the children, that being
      * the default behaviour
      */
-    GValue v = G_VALUE_INIT;
+    gint64 status = 0;
     if (!acc) return FALSE;
-    qof_instance_get_kvp (QOF_INSTANCE (acc),
-                          "reconcile-info/include-children", &v);
-    return G_VALUE_HOLDS_INT64 (&v) ? g_value_get_int64 (&v) : FALSE;
+    qof_instance_get_kvp_int64 (QOF_INSTANCE (acc),
+                                "reconcile-info/include-children", &status);
+    return status;
 }
 
 /********************************************************************\
@@ -4705,31 +6539,22 @@ static void
 finder_help_function(const Account *acc, const char *description,
                      Split **split, Transaction **trans )
 {
-    AccountPrivate *priv;
-    GList *slp;
+    Split *lsplit;
 
     /* First, make sure we set the data to NULL BEFORE we start */
     if (split) *split = NULL;
     if (trans) *trans = NULL;
 
     /* Then see if we have any work to do */
-    if (acc == NULL) return;
+    if (acc == NULL || description == NULL) return;
 
-    /* Why is this loop iterated backwards ?? Presumably because the split
-     * list is in date order, and the most recent matches should be
-     * returned!?  */
-    priv = GET_PRIVATE(acc);
-    for (slp = g_list_last(priv->splits); slp; slp = slp->prev)
+    /* The split list is in date order, so the last match is the most
+     * recent; the description index keeps that one. */
+    lsplit = g_hash_table_lookup (account_get_desc_index (acc), description);
+    if (lsplit)
     {
-        Split *lsplit = slp->data;
-        Transaction *ltrans = xaccSplitGetParent(lsplit);
-
-        if (g_strcmp0 (description, xaccTransGetDescription (ltrans)) == 0)
-        {
-            if (split) *split = lsplit;
-            if (trans) *trans = ltrans;
-            return;
-        }
+        if (split) *split = lsplit;
+        if (trans) *trans = xaccSplitGetParent (lsplit);
     }
 }
 
@@ -4838,8 +6663,9 @@ gnc_account_merge_children (Account *parent)
             gnc_account_merge_children (acc_a);
 
             /* consolidate transactions */
-            while (priv_b->splits)
-                xaccSplitSetAccount (priv_b->splits->data, acc_a);
+            while (priv_b->splits->len)
+                xaccSplitSetAccount (g_ptr_array_index (priv_b->splits, 0),
+                                     acc_a);
 
             /* move back one before removal. next iteration around the loop
              * will get the node after node_b */
@@ -4877,11 +6703,17 @@ void
 xaccAccountBeginStagedTransactionTraversals (const Account *account)
 {
     AccountPrivate *priv;
+    guint i;
 
     if (!account)
         return;
     priv = GET_PRIVATE(account);
-    xaccSplitsBeginStagedTransactionTraversals(priv->splits);
+    for (i = 0; i < priv->splits->len; ++i)
+    {
+        Split *s = g_ptr_array_index (priv->splits, i);
+        if (s->parent)
+            s->parent->marker = 0;
+    }
 }
 
 gboolean
@@ -4907,7 +6739,7 @@ static void do_one_split (Split *s, gpointer data)
 static void do_one_account (Account *account, gpointer data)
 {
     AccountPrivate *priv = GET_PRIVATE(account);
-    g_list_foreach(priv->splits, (GFunc)do_one_split, NULL);
+    g_ptr_array_foreach(priv->splits, (GFunc)do_one_split, NULL);
 }
 
 /* Replacement for xaccGroupBeginStagedTransactionTraversals */
@@ -4927,25 +6759,19 @@ xaccAccountStagedTransactionTraversal (const Account *acc,
                                        TransactionCallback thunk,
                                        void *cb_data)
 {
-    AccountPrivate *priv;
-    GList *split_p;
-    GList *next;
+    AccountSplitIter iter;
     Transaction *trans;
     Split *s;
     int retval;
 
     if (!acc) return 0;
 
-    priv = GET_PRIVATE(acc);
-    for (split_p = priv->splits; split_p; split_p = next)
+    /* The iterator copes with a naughty thunk destroying the split
+     * we're on, though not with one that removes other splits from
+     * this account. */
+    gnc_account_split_iter_init (&iter, acc);
+    while ((s = gnc_account_split_iter_next (&iter)))
     {
-        /* Get the next element in the split list now, just in case some
-         * naughty thunk destroys the one we're using. This reduces, but
-         * does not eliminate, the possibility of undefined results if
-         * a thunk removes splits from this account. */
-        next = g_list_next(split_p);
-
-        s = split_p->data;
         trans = s->parent;
         if (trans && (trans->marker < stage))
         {
@@ -4968,7 +6794,8 @@ gnc_account_tree_staged_transaction_traversal (const Account *acc,
         void *cb_data)
 {
     const AccountPrivate *priv;
-    GList *acc_p, *split_p;
+    AccountSplitIter iter;
+    GList *acc_p;
     Transaction *trans;
     Split *s;
     int retval;
@@ -4985,9 +6812,9 @@ gnc_account_tree_staged_transaction_traversal (const Account *acc,
     }
 
     /* Now this account */
-    for (split_p = priv->splits; split_p; split_p = g_list_next(split_p))
+    gnc_account_split_iter_init (&iter, acc);
+    while ((s = gnc_account_split_iter_next (&iter)))
     {
-        s = split_p->data;
         trans = s->parent;
         if (trans && (trans->marker < stage))
         {
@@ -5140,122 +6967,200 @@ gnc_account_imap_delete_account (GncImportMatchMap *imap,
 --------------------------------------------------------------------------*/
 
 
-struct account_token_count
+/* The import-map-bayes frame of an account holds, for each token, the
+ * number of times it was seen in a transaction matched to each account:
+ * IMAP_FRAME_BAYES/<token>/<account guid string> = count. Looking that
+ * up through the KVP for every token of every imported transaction is
+ * slow with a big map, so the frame is compiled once into a bayes_model
+ * that gnc_account_imap_add_account_bayes() keeps up to date and any
+ * other edit of the account throws away.
+ */
+
+/** the number of times a token appeared for one of the model's accounts */
+typedef struct
 {
-    char* account_guid;
-    gint64 token_count; /**< occurances of a given token for this account_guid */
-};
+    guint account;      /**< index into bayes_model.accounts */
+    gint64 token_count;
+} BayesTokenCount;
 
 /** total_count and the token_count for a given account let us calculate the
  * probability of a given account with any single token
  */
-struct token_accounts_info
+typedef struct
 {
-    GList *accounts; /**< array of struct account_token_count */
+    GArray *counts;     /**< of BayesTokenCount */
     gint64 total_count;
-};
-
-/** gpointer is a pointer to a struct token_accounts_info
- * \note Can always assume that keys are unique, reduces code in this function
- */
-static void
-buildTokenInfo(const char *key, const GValue *value, gpointer data)
-{
-    struct token_accounts_info *tokenInfo = (struct token_accounts_info*)data;
-    struct account_token_count* this_account;
-
-    //  PINFO("buildTokenInfo: account '%s', token_count: '%" G_GINT64_FORMAT "'", (char*)key,
-    //                  g_value_get_int64(value));
-
-    /* add the count to the total_count */
-    tokenInfo->total_count += g_value_get_int64(value);
-
-    /* allocate a new structure for this account and it's token count */
-    this_account = (struct account_token_count*)
-                   g_new0(struct account_token_count, 1);
-
-    /* fill in the account guid and number of tokens found for this account guid */
-    this_account->account_guid = (char*)key;
-    this_account->token_count = g_value_get_int64(value);
-
-    /* append onto the glist a pointer to the new account_token_count structure */
-    tokenInfo->accounts = g_list_prepend(tokenInfo->accounts, this_account);
-}
+} BayesToken;
 
 /** intermediate values used to calculate the bayes probability of a given account
   where p(AB) = (a*b)/[a*b + (1-a)(1-b)], product is (a*b),
   product_difference is (1-a) * (1-b)
  */
-struct account_probability
+typedef struct
 {
     double product; /* product of probabilities */
     double product_difference; /* product of (1-probabilities) */
+    guint stamp;    /* the lookup which last set the products */
+} BayesProbability;
+
+struct bayes_model
+{
+    GHashTable *tokens;         /**< token -> BayesToken */
+    GPtrArray *accounts;        /**< the account guid strings of the map */
+    GHashTable *account_index;  /**< guid string -> index in accounts + 1 */
+
+    /* Scratch space of gnc_account_imap_find_account_bayes(), kept so
+     * that lookups don't allocate. */
+    GArray *probabilities;      /**< of BayesProbability, one per account */
+    GArray *touched;            /**< indices of the accounts seen */
+    guint stamp;
 };
 
-/** convert a hash table of account names and (struct account_probability*)
-  into a hash table of 100000x the percentage match value, ie. 10% would be
-  0.10 * 100000 = 10000
- */
-#define PROBABILITY_FACTOR 100000
 static void
-buildProbabilities(gpointer key, gpointer value, gpointer data)
+bayes_token_free (gpointer data)
 {
-    GHashTable *final_probabilities = (GHashTable*)data;
-    struct account_probability *account_p = (struct account_probability*)value;
-
-    /* P(AB) = A*B / [A*B + (1-A)*(1-B)]
-     * NOTE: so we only keep track of a running product(A*B*C...)
-     * and product difference ((1-A)(1-B)...)
-     */
-    gint32 probability =
-        (account_p->product /
-         (account_p->product + account_p->product_difference))
-        * PROBABILITY_FACTOR;
+    BayesToken *token = data;
+    g_array_free (token->counts, TRUE);
+    g_free (token);
+}
 
-    PINFO("P('%s') = '%d'", (char*)key, probability);
+static void
+bayes_model_destroy (AccountPrivate *priv)
+{
+    struct bayes_model *model = priv->bayes_model;
+    if (!model) return;
 
-    g_hash_table_insert(final_probabilities, key, GINT_TO_POINTER(probability));
+    g_hash_table_destroy (model->tokens);
+    g_hash_table_destroy (model->account_index);
+    g_ptr_array_free (model->accounts, TRUE);
+    g_array_free (model->probabilities, TRUE);
+    g_array_free (model->touched, TRUE);
+    g_free (model);
+    priv->bayes_model = NULL;
 }
 
-/** Frees an array of the same time that buildProperties built */
 static void
-freeProbabilities(gpointer key, gpointer value, gpointer data)
+bayes_model_add (struct bayes_model *model, const char *token_string,
+                 const char *account_guid, gint64 token_count)
 {
-    /* free up the struct account_probability that was allocated
-     * in gnc_account_find_account_bayes()
-     */
-    g_free(value);
+    BayesToken *token;
+    BayesTokenCount *count = NULL;
+    guint account, i;
+
+    account = GPOINTER_TO_UINT (g_hash_table_lookup (model->account_index,
+                                                     account_guid));
+    if (account == 0)
+    {
+        BayesProbability zero = { 0.0, 0.0, 0 };
+        char *key = g_strdup (account_guid);
+        g_ptr_array_add (model->accounts, key);
+        g_array_append_val (model->probabilities, zero);
+        account = model->accounts->len;
+        g_hash_table_insert (model->account_index, key,
+                             GUINT_TO_POINTER (account));
+    }
+    --account;
+
+    token = g_hash_table_lookup (model->tokens, token_string);
+    if (!token)
+    {
+        token = g_new0 (BayesToken, 1);
+        token->counts = g_array_new (FALSE, FALSE, sizeof (BayesTokenCount));
+        g_hash_table_insert (model->tokens, g_strdup (token_string), token);
+    }
+
+    token->total_count += token_count;
+    for (i = 0; i < token->counts->len; ++i)
+    {
+        count = &g_array_index (token->counts, BayesTokenCount, i);
+        if (count->account == account)
+        {
+            count->token_count += token_count;
+            return;
+        }
+    }
+    {
+        BayesTokenCount new_count;
+        new_count.account = account;
+        new_count.token_count = token_count;
+        g_array_append_val (token->counts, new_count);
+    }
 }
 
-/** holds an account guid and its corresponding integer probability
-  the integer probability is some factor of 10
- */
-struct account_info
+struct bayes_model_build_info
 {
-    char* account_guid;
-    gint32 probability;
+    Account *acc;
+    struct bayes_model *model;
+    const char *token;          /**< relative to IMAP_FRAME_BAYES */
 };
 
-/** Find the highest probability and the corresponding account guid
-    store in data, a (struct account_info*)
-    NOTE: this is a g_hash_table_foreach() function for a hash table of entries
-    key is a  pointer to the account guid, value is a gint32, 100000x
-    the probability for this account
-*/
+/* Counts are the int64 slots, named by the account, in the frame of
+ * their token. Tokens containing the separator are nested deeper. */
 static void
-highestProbability(gpointer key, gpointer value, gpointer data)
+bayes_model_build_slot (const char *key, const GValue *value, gpointer data)
 {
-    struct account_info *account_i = (struct account_info*)data;
+    struct bayes_model_build_info *info = data;
 
-    /* if the current probability is greater than the stored, store the current */
-    if (GPOINTER_TO_INT(value) > account_i->probability)
+    if (G_VALUE_HOLDS_INT64 (value))
+    {
+        if (info->token)
+            bayes_model_add (info->model, info->token, key,
+                             g_value_get_int64 (value));
+    }
+    else if (G_VALUE_HOLDS (value, G_TYPE_STRING) &&
+             g_value_get_string (value) == NULL)
     {
-        /* Save the new highest probability and the assoaciated account guid */
-        account_i->probability = GPOINTER_TO_INT(value);
-        account_i->account_guid = key;
+        struct bayes_model_build_info sub_info;
+        char *token = info->token ? g_strdup_printf ("%s/%s", info->token, key)
+                                  : g_strdup (key);
+        char *path = g_strdup_printf (IMAP_FRAME_BAYES "/%s", token);
+
+        sub_info.acc = info->acc;
+        sub_info.model = info->model;
+        sub_info.token = token;
+        qof_instance_foreach_slot (QOF_INSTANCE (info->acc), path,
+                                   bayes_model_build_slot, &sub_info);
+        g_free (path);
+        g_free (token);
     }
 }
 
+static struct bayes_model *
+bayes_model_get (Account *acc)
+{
+    AccountPrivate *priv = GET_PRIVATE (acc);
+    struct bayes_model *model;
+    struct bayes_model_build_info info;
+
+    if (priv->bayes_model)
+        return priv->bayes_model;
+
+    model = g_new0 (struct bayes_model, 1);
+    model->tokens = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, bayes_token_free);
+    model->accounts = g_ptr_array_new_with_free_func (g_free);
+    model->account_index = g_hash_table_new (g_str_hash, g_str_equal);
+    model->probabilities = g_array_new (FALSE, FALSE,
+                                        sizeof (BayesProbability));
+    model->touched = g_array_new (FALSE, FALSE, sizeof (guint));
+
+    info.acc = acc;
+    info.model = model;
+    info.token = NULL;
+    if (qof_instance_has_slot (QOF_INSTANCE (acc), IMAP_FRAME_BAYES))
+        qof_instance_foreach_slot (QOF_INSTANCE (acc), IMAP_FRAME_BAYES,
+                                   bayes_model_build_slot, &info);
+
+    PINFO("compiled %u tokens for %u accounts", g_hash_table_size (model->tokens),
+          model->accounts->len);
+    priv->bayes_model = model;
+    return model;
+}
+
+/** convert the running probabilities into 100000x the percentage match
+  value, ie. 10% would be 0.10 * 100000 = 10000
+ */
+#define PROBABILITY_FACTOR 100000
 
 #define threshold (.90 * PROBABILITY_FACTOR) /* 90% */
 
@@ -5263,24 +7168,13 @@ highestProbability(gpointer key, gpointer value, gpointer data)
 Account*
 gnc_account_imap_find_account_bayes (GncImportMatchMap *imap, GList *tokens)
 {
-    struct token_accounts_info tokenInfo; /**< holds the accounts and total
-                                           * token count for a single token */
+    struct bayes_model *model;
     GList *current_token;                 /**< pointer to the current
                                            * token from the input GList
                                            * tokens */
-    GList *current_account_token;         /**< pointer to the struct
-                                           * account_token_count */
-    struct account_token_count *account_c; /**< an account name and the number
-                                            * of times a token has appeared
-                                            * for the account */
-    struct account_probability *account_p; /**< intermediate storage of values
-                                            * to compute the bayes probability
-                                            * of an account */
-    GHashTable *running_probabilities = g_hash_table_new(g_str_hash,
-                                                         g_str_equal);
-    GHashTable *final_probabilities = g_hash_table_new(g_str_hash,
-                                                       g_str_equal);
-    struct account_info account_i;
+    const char *best_guid = NULL;
+    gint32 best_probability = 0;
+    guint i;
 
     ENTER(" ");
 
@@ -5292,135 +7186,106 @@ gnc_account_imap_find_account_bayes (GncImportMatchMap *imap, GList *tokens)
         return NULL;
     }
 
+    model = bayes_model_get (imap->acc);
+    if (++model->stamp == 0)
+    {
+        /* Wrapped around: forget every old stamp. */
+        for (i = 0; i < model->probabilities->len; ++i)
+            g_array_index (model->probabilities, BayesProbability, i).stamp = 0;
+        model->stamp = 1;
+    }
+    g_array_set_size (model->touched, 0);
+
     /* find the probability for each account that contains any of the tokens
      * in the input tokens list
      */
     for (current_token = tokens; current_token;
          current_token = current_token->next)
     {
-        char* path = g_strdup_printf (IMAP_FRAME_BAYES "/%s",
-                                            (char*)current_token->data);
-        /* zero out the token_accounts_info structure */
-        memset(&tokenInfo, 0, sizeof(struct token_accounts_info));
+        BayesToken *token;
 
         PINFO("token: '%s'", (char*)current_token->data);
 
-        /* process the accounts for this token, adding the account if it
-         * doesn't already exist or adding to the existing accounts token
-         * count if it does
-         */
-        qof_instance_foreach_slot(QOF_INSTANCE (imap->acc), path,
-                                  buildTokenInfo, &tokenInfo);
-        g_free (path);
-        /* for each account we have just found, see if the account
-         * already exists in the list of account probabilities, if not
-         * add it
+        if (!current_token->data)
+            continue;
+        token = g_hash_table_lookup (model->tokens, current_token->data);
+        if (!token)
+            continue;
+
+        /* for each account of this token, continue its running
+         * probabilities, starting them if it's the first token seen
+         * for the account
          */
-        for (current_account_token = tokenInfo.accounts; current_account_token;
-                current_account_token = current_account_token->next)
+        for (i = 0; i < token->counts->len; ++i)
         {
-            /* get the account name and corresponding token count */
-            account_c = (struct account_token_count*)current_account_token->data;
-
-            PINFO("account_c->account_guid('%s'), "
-                  "account_c->token_count('%" G_GINT64_FORMAT
-                  "')/total_count('%" G_GINT64_FORMAT "')",
-                  account_c->account_guid, account_c->token_count,
-                  tokenInfo.total_count);
-
-            account_p = g_hash_table_lookup(running_probabilities,
-                                            account_c->account_guid);
-
-            /* if the account exists in the list then continue
-             * the running probablities
-             */
-            if (account_p)
+            BayesTokenCount *count = &g_array_index (token->counts,
+                                                     BayesTokenCount, i);
+            BayesProbability *account_p =
+                &g_array_index (model->probabilities, BayesProbability,
+                                count->account);
+            double p = (double)count->token_count / (double)token->total_count;
+
+            if (account_p->stamp == model->stamp)
             {
-                account_p->product = (((double)account_c->token_count /
-                                      (double)tokenInfo.total_count)
-                                      * account_p->product);
-                account_p->product_difference =
-                    ((double)1 - ((double)account_c->token_count /
-                                  (double)tokenInfo.total_count))
-                    * account_p->product_difference;
-                PINFO("product == %f, product_difference == %f",
-                      account_p->product, account_p->product_difference);
+                account_p->product *= p;
+                account_p->product_difference *= (double)1 - p;
             }
             else
             {
-                /* add a new entry */
-                PINFO("adding a new entry for this account");
-                account_p = (struct account_probability*)
-                            g_new0(struct account_probability, 1);
-
-                /* set the product and product difference values */
-                account_p->product = ((double)account_c->token_count /
-                                      (double)tokenInfo.total_count);
-                account_p->product_difference =
-                    (double)1 - ((double)account_c->token_count /
-                                 (double)tokenInfo.total_count);
-
-                PINFO("product == %f, product_difference == %f",
-                      account_p->product, account_p->product_difference);
-
-                /* add the account guid and (struct account_probability*)
-                 * to the hash table */
-                g_hash_table_insert(running_probabilities,
-                                    account_c->account_guid, account_p);
+                account_p->product = p;
+                account_p->product_difference = (double)1 - p;
+                account_p->stamp = model->stamp;
+                g_array_append_val (model->touched, count->account);
             }
-        } /* for all accounts in tokenInfo */
-
-        /* free the data in tokenInfo */
-        for (current_account_token = tokenInfo.accounts; current_account_token;
-                current_account_token = current_account_token->next)
-        {
-            /* free up each struct account_token_count we allocated */
-            g_free((struct account_token_count*)current_account_token->data);
+            PINFO("product == %f, product_difference == %f",
+                  account_p->product, account_p->product_difference);
         }
-
-        g_list_free(tokenInfo.accounts); /* free the accounts GList */
     }
 
-    /* build a hash table of account names and their final probabilities
-     * from each entry in the running_probabilties hash table
-     */
-    g_hash_table_foreach(running_probabilities, buildProbabilities,
-                         final_probabilities);
-
     /* find the highest probabilty and the corresponding account */
-    memset(&account_i, 0, sizeof(struct account_info));
-    g_hash_table_foreach(final_probabilities, highestProbability, &account_i);
+    for (i = 0; i < model->touched->len; ++i)
+    {
+        guint account = g_array_index (model->touched, guint, i);
+        BayesProbability *account_p =
+            &g_array_index (model->probabilities, BayesProbability, account);
+
+        /* P(AB) = A*B / [A*B + (1-A)*(1-B)]
+         * NOTE: so we only keep track of a running product(A*B*C...)
+         * and product difference ((1-A)(1-B)...)
+         */
+        gint32 probability =
+            (account_p->product /
+             (account_p->product + account_p->product_difference))
+            * PROBABILITY_FACTOR;
 
-    /* free each element of the running_probabilities hash */
-    g_hash_table_foreach(running_probabilities, freeProbabilities, NULL);
+        PINFO("P('%s') = '%d'",
+              (char*)g_ptr_array_index (model->accounts, account), probability);
 
-    /* free the hash tables */
-    g_hash_table_destroy(running_probabilities);
-    g_hash_table_destroy(final_probabilities);
+        if (probability > best_probability)
+        {
+            best_probability = probability;
+            best_guid = g_ptr_array_index (model->accounts, account);
+        }
+    }
 
     PINFO("highest P('%s') = '%d'",
-          account_i.account_guid ? account_i.account_guid : "(null)",
-          account_i.probability);
+          best_guid ? best_guid : "(null)", best_probability);
 
     /* has this probability met our threshold? */
-    if (account_i.probability >= threshold)
+    if (best_probability >= threshold)
     {
-        GncGUID *guid;
+        GncGUID guid;
         Account *account = NULL;
 
         PINFO("Probability has met threshold");
 
-        guid = g_new (GncGUID, 1);
-
-        if (string_to_guid (account_i.account_guid, guid))
-            account = xaccAccountLookup (guid, imap->book);
-
-        g_free (guid);
+        if (string_to_guid (best_guid, &guid))
+            account = xaccAccountLookup (&guid, imap->book);
 
         if (account != NULL)
             LEAVE("Return account is '%s'", xaccAccountGetName (account));
         else
-            LEAVE("Return NULL, account for Guid '%s' can not be found", account_i.account_guid);
+            LEAVE("Return NULL, account for Guid '%s' can not be found", best_guid);
 
         return account;
     }
@@ -5480,6 +7345,7 @@ gnc_account_imap_add_account_bayes (GncImportMatchMap *imap,
     gint64 token_count;
     char *account_fullname, *kvp_path;
     char *guid_string;
+    struct bayes_model *model;
 
     ENTER(" ");
     if (!imap)
@@ -5491,6 +7357,7 @@ gnc_account_imap_add_account_bayes (GncImportMatchMap *imap,
     g_return_if_fail (acc != NULL);
     account_fullname = gnc_account_get_full_name(acc);
     xaccAccountBeginEdit (imap->acc);
+    model = GET_PRIVATE (imap->acc)->bayes_model;
 
     PINFO("account name: '%s'", account_fullname);
 
@@ -5519,13 +7386,19 @@ gnc_account_imap_add_account_bayes (GncImportMatchMap *imap,
 
         /* change the imap entry for the account */
         change_imap_entry (imap, kvp_path, token_count);
+        if (model)
+            bayes_model_add (model, current_token->data, guid_string,
+                             token_count);
 
         g_free (kvp_path);
     }
 
     /* free up the account fullname and guid string */
     qof_instance_set_dirty (QOF_INSTANCE (imap->acc));
+    /* The model has had the same changes as the map. */
+    GET_PRIVATE (imap->acc)->bayes_model_updating = TRUE;
     xaccAccountCommitEdit (imap->acc);
+    GET_PRIVATE (imap->acc)->bayes_model_updating = FALSE;
     g_free (account_fullname);
     g_free (guid_string);
 
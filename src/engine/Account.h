@@ -601,6 +601,26 @@ gnc_numeric xaccAccountGetBalanceAsOfDateInCurrency(
 gnc_numeric xaccAccountGetBalanceChangeForPeriod (
     Account *acc, time64 date1, time64 date2, gboolean recurse);
 
+/** Get the balances of a whole account tree at several dates at once.
+ *
+ *  The result has a row for root followed by one for each of its
+ *  descendants, in the order gnc_account_get_descendants returns them,
+ *  and n_dates columns.  The entry at (row, column) is what
+ *  xaccAccountGetBalanceAsOfDateInCurrency would return for the row's
+ *  account and dates[column], but each account's splits are searched
+ *  only once for all the dates and its balances are reused for all its
+ *  ancestors.  Increasing dates are the fastest to look up.
+ *
+ *  @param report_commodity The commodity to convert to, or NULL for each
+ *  row's own account commodity.
+ *  @param include_children Add the balances of the descendants to each
+ *  row.
+ *  @return The matrix, by row.  The caller must g_free it.
+ */
+gnc_numeric *xaccAccountTreeGetBalanceMatrix (Account *root,
+        const time64 *dates, guint n_dates,
+        gnc_commodity *report_commodity, gboolean include_children);
+
 /** @} */
 
 /** @name Account Children and Parents.
@@ -983,17 +1003,84 @@ gboolean xaccAccountIsEquityType(GNCAccountType t);
 
 /** The xaccAccountGetSplitList() routine returns a pointer to a GList of
  *    the splits in the account.
- * @note This GList is the account's internal
- *    data structure: do not delete it when done; treat it as a read-only
- *    structure.  Note that some routines (such as xaccAccountRemoveSplit())
- *    modify this list directly, and could leave you with a corrupted
- *    pointer.
- * @note This should be changed so that the returned value is a copy
- * of the list. No other part of the code should have access to the
- * internal data structure used by this object.
+ * @note This GList belongs to the account: do not delete it when
+ *    done; treat it as a read-only structure.  The account keeps its
+ *    splits in a vector and builds this list on the first call, then
+ *    updates it as splits are added and removed, so removing a split
+ *    (e.g. with xaccSplitDestroy()) can leave you with a dangling node.
+ *    New code should prefer gnc_account_n_splits() and
+ *    gnc_account_nth_split(), or an AccountSplitIter.
  */
 SplitList* xaccAccountGetSplitList (const Account *account);
 
+/** Return the number of splits in the account, sorting them first
+ *  if needed. */
+gint gnc_account_n_splits (const Account *account);
+
+/** Return the split at position @a num in the account's sorted
+ *  splits, or NULL if @a num is out of range. */
+Split *gnc_account_nth_split (const Account *account, gint num);
+
+/** Call @a func on each split of the account whose reconcile state
+ *  isn't YREC, in no particular order.  The account keeps these apart
+ *  as the states change, so the reconciled splits aren't looked at;
+ *  @a func must not change any split's account or reconcile state. */
+void gnc_account_foreach_unreconciled_split (const Account *account,
+                                             GFunc func, gpointer user_data);
+
+/** An iterator over an account's splits in sort order.  Unlike a walk
+ *  over xaccAccountGetSplitList(), it's safe to remove the split last
+ *  returned from the account while iterating.  Allocate it on the stack
+ *  and treat the members as private. */
+typedef struct
+{
+    /*< private >*/
+    const Account *account;
+    guint index;
+    Split *current;
+} AccountSplitIter;
+
+/** Set up @a iter to walk the splits of @a account, sorting them
+ *  first if needed. */
+void gnc_account_split_iter_init (AccountSplitIter *iter,
+                                  const Account *account);
+
+/** Return the next split, or NULL when there are no more. */
+Split *gnc_account_split_iter_next (AccountSplitIter *iter);
+
+
+/** A backend that doesn't load all transactions up front registers one
+ *  of these to load the transactions of a single account on demand. */
+typedef void (*AccountSplitsLoader) (QofBackend *be, Account *account);
+
+/** Set the function gnc_account_load_splits() calls. */
+void gnc_account_set_splits_loader (AccountSplitsLoader loader);
+
+/** A backend that leaves splits pending can also register one of these
+ *  to answer xaccAccountGetBalanceAsOfDate() for a pending account
+ *  without loading its splits.  It sets @a balance to the total amount
+ *  of the account's splits posted before @a date and returns TRUE, or
+ *  returns FALSE to have the splits loaded instead. */
+typedef gboolean (*AccountBalanceLoader) (QofBackend *be, Account *account,
+                                          time64 date, gnc_numeric *balance);
+
+/** Set the function a pending account's balances as of a date come
+ *  from. */
+void gnc_account_set_balance_loader (AccountBalanceLoader loader);
+
+/** Mark whether @a account's splits are still in the backend.  Only
+ *  backends should set this, and only after setting the account's
+ *  starting balances to the totals of the splits not yet loaded so that
+ *  the balances are right meanwhile. */
+void gnc_account_set_splits_pending (Account *account, gboolean pending);
+gboolean gnc_account_get_splits_pending (const Account *account);
+
+/** Load @a account's splits from the backend if they're pending.
+ *  xaccAccountGetSplitList(), gnc_account_n_splits(),
+ *  gnc_account_nth_split() and gnc_account_split_iter_init() call this;
+ *  code that finds splits with a QofQuery instead must call it for the
+ *  accounts it's about to query. */
+void gnc_account_load_splits (Account *account);
 
 /** The xaccAccountCountSplits() routine returns the number of all
  *    the splits in the account.
@@ -1004,6 +1091,26 @@ SplitList* xaccAccountGetSplitList (const Account *account);
  */
 gint64 xaccAccountCountSplits (const Account *acc, gboolean include_children);
 
+/** Get the earliest and latest post dates of the transactions of the
+ *  splits in the account.  The split counts and date ranges of whole
+ *  subtrees are cached until a split or the tree changes, so they're
+ *  cheap to ask for every account in turn.
+ *
+ * @param acc the account whose dates to find
+ *
+ * @param include_children also look at the splits in descendants
+ *        (TRUE) or in this account only (FALSE).
+ *
+ * @param first where to put the earliest post date, or NULL
+ *
+ * @param last where to put the latest post date, or NULL
+ *
+ * @return FALSE, leaving first and last alone, if there are no splits.
+ */
+gboolean xaccAccountGetPostDateRange (const Account *acc,
+                                      gboolean include_children,
+                                      time64 *first, time64 *last);
+
 /** The xaccAccountMoveAllSplits() routine reassigns each of the splits
  *  in accfrom to accto. */
 void xaccAccountMoveAllSplits (Account *accfrom, Account *accto);
@@ -1048,6 +1155,17 @@ Transaction * xaccAccountFindTransByDesc(const Account *account,
 Split * xaccAccountFindSplitByDesc(const Account *account,
                                    const char *description);
 
+/** Returns a split in the account with the given online id, the one the
+ *  importers give the splits they create: the split's own, or if it has
+ *  none its transaction's.  The ids are indexed the first time the
+ *  account is asked, so checking a batch of imported transactions
+ *  doesn't walk the account for each of them.
+ *
+ *  @return A pointer to the split, not a copy, or NULL if the account
+ *  has none with that online id. */
+Split * gnc_account_find_split_by_online_id (const Account *account,
+                                             const char *online_id);
+
 /** @} */
 
 /* ------------------ */
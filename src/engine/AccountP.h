@@ -110,12 +110,82 @@ typedef struct AccountPrivate
 
     gboolean balance_dirty;     /* balances in splits incorrect */
 
-    GList *splits;              /* list of split pointers */
+    GPtrArray *splits;          /* vector of split pointers */
     gboolean sort_dirty;        /* sort order of splits is bad */
 
+    /* GList copy of splits handed out by xaccAccountGetSplitList().
+     * Built on first request, then kept node for node in step with
+     * the vector. */
+    GList *split_list;
+    gboolean split_list_built;
+
+    /* The splits that aren't reconciled, as a set, so that reconciling
+     * only looks at those; kept by account_track_reconcile(). */
+    GHashTable *unreconciled;
+
+    /* Set by a backend that hasn't loaded this account's splits yet;
+     * see gnc_account_load_splits(). */
+    gboolean splits_pending;
+
+    /* The balance index partitions the split vector into blocks of
+     * consecutive splits, each caching its amount totals, so that a
+     * single edit only re-sums one block. See Account.c. */
+    GPtrArray *balance_blocks;
+    gboolean balance_index_dirty; /* balance_blocks must be rebuilt */
+
+    /* The post dates of the splits' transactions, parallel to the split
+     * vector, for binary searching by date while the splits are sorted;
+     * see account_get_date_index() in Account.c. */
+    GArray *date_index;
+    gboolean date_index_dirty;  /* date_index must be rebuilt */
+
+    /* The last split in the vector for each transaction description,
+     * for the register's autofill; see account_get_desc_index() in
+     * Account.c. */
+    GHashTable *desc_index;
+    gboolean desc_index_dirty;  /* desc_index must be rebuilt */
+
+    /* A split for each online id the importers gave the splits, for
+     * their duplicate checks; see account_get_online_id_index() in
+     * Account.c. */
+    GHashTable *online_id_index;
+    gboolean online_id_index_dirty; /* online_id_index must be rebuilt */
+
+    /* Balances of this account and all its descendants converted to a
+     * commodity, kept while subtree_totals_stamp is current; see
+     * account_subtree_total() in Account.c. */
+    GArray *subtree_totals;
+    guint subtree_totals_stamp;
+
+    /* The number of splits in this account and its descendants and the
+     * range of their post dates, kept while subtree_stats_stamp is
+     * current; see account_get_subtree_stats() in Account.c. */
+    gint64 subtree_n_splits;
+    time64 subtree_first_date;
+    time64 subtree_last_date;
+    guint subtree_stats_stamp;
+
+    /* The full name and its collation key, kept while full_name_stamp
+     * is current; see account_get_cached_full_name() in Account.c. */
+    gchar *full_name;
+    gchar *full_name_key;
+    guint full_name_stamp;
+
     LotList   *lots;		/* list of lot pointers */
+
+    /* Index of the open lots by opening date, NULL until the first
+     * gnc_account_find_open_lot(); see Account.c. */
+    GHashTable *lot_entries;    /* GNCLot* -> entry, for every lot */
+    GSequence *open_lots[2];    /* opened by a negative, positive split */
+    GPtrArray *dirty_lots;      /* entries to re-sort at next lookup */
+    guint64 lot_seq;
     GNCPolicy *policy;		/* Cached pointer to policy method */
 
+    /* The import-map-bayes frame compiled for lookups, NULL until the
+     * first gnc_account_imap_find_account_bayes(); see Account.c. */
+    struct bayes_model *bayes_model;
+    gboolean bayes_model_updating;
+
     /* The "mark" flag can be used by the user to mark this account
      * in any way desired.  Handy for specialty traversals of the
      * account tree. */
@@ -135,6 +205,55 @@ void xaccAccountSetGUID (Account *account, const GncGUID *guid);
 /* Register Accounts with the engine */
 gboolean xaccAccountRegister (void);
 
+/* Mark the sort order and balances of the account dirty because the
+ * amount, reconcile state or sort keys of one of its splits changed.
+ * Unlike gnc_account_set_balance_dirty() this keeps the balance index,
+ * so the next xaccAccountRecomputeBalance() only re-sums the block
+ * holding the split. */
+void gnc_account_set_split_balance_dirty (Account *acc, Split *split);
+
+/* Mark the account's description index dirty because the description
+ * of one of its splits' transactions changed, or one of its splits
+ * moved to another transaction. */
+void gnc_account_set_desc_index_dirty (Account *acc);
+
+/* Mark the account's online id index dirty because the online id of one
+ * of its splits or their transactions changed, or one of its splits
+ * moved to another transaction. */
+void gnc_account_set_online_id_index_dirty (Account *acc);
+
+/* Bring the running balances cached in the split up to date with its
+ * account's balance index. The balances of splits after an edit are
+ * only rewritten when they're next read; the xaccSplitGet*Balance()
+ * accessors call this first. */
+void gnc_account_refresh_split_balance (Split *split);
+
+/* Tell the open lot index that the splits of lot, or their amounts or
+ * dates, have changed. */
+void gnc_account_lot_changed (Account *acc, GNCLot *lot);
+
+/* The full name of the account, and a key giving the order of
+ * g_utf8_collate() on full names when compared with strcmp().  Both
+ * belong to the account and stay valid until any account's name or
+ * place in the tree, or the separator, changes. */
+const char *gnc_account_get_cached_full_name (const Account *acc);
+const char *gnc_account_get_full_name_collate_key (const Account *acc);
+
+/* A counter that changes whenever any account's name or place in the
+ * tree, or the separator, changes, for caches of accounts found by
+ * name. */
+guint gnc_account_get_names_generation (void);
+
+/* Drop a lot that's being freed from the open lot index. */
+void gnc_account_forget_lot (Account *acc, GNCLot *lot);
+
+/* The earliest or latest open lot of the account opened by a positive
+ * or negative split, in currency unless that is NULL, without looking
+ * at every lot of the account. */
+GNCLot *gnc_account_find_open_lot (Account *acc, gboolean opened_positive,
+                                   const gnc_commodity *currency,
+                                   gboolean latest);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
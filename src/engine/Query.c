@@ -597,13 +597,13 @@ xaccQueryGetEarliestDateFound(QofQuery * q)
 
     /* Safe until 2038 on archs where time64 is 32bit */
     sp = spl->data;
-    earliest = sp->parent->date_posted.tv_sec;
+    earliest = sp->parent->date_posted;
     for (; spl; spl = spl->next)
     {
         sp = spl->data;
-        if (sp->parent->date_posted.tv_sec < earliest)
+        if (sp->parent->date_posted < earliest)
         {
-            earliest = sp->parent->date_posted.tv_sec;
+            earliest = sp->parent->date_posted;
         }
     }
     return earliest;
@@ -627,9 +627,9 @@ xaccQueryGetLatestDateFound(QofQuery * q)
     for (; spl; spl = spl->next)
     {
         sp = spl->data;
-        if (sp->parent->date_posted.tv_sec > latest)
+        if (sp->parent->date_posted > latest)
         {
-            latest = sp->parent->date_posted.tv_sec;
+            latest = sp->parent->date_posted;
         }
     }
     return latest;
@@ -706,5 +706,33 @@ xaccQueryAddBalanceMatch(QofQuery *q, QofQueryCompare bal, QofQueryOp op)
         SPLIT_TRANS, TRANS_IMBALANCE, NULL);
 }
 
+static QuerySplitsLoader splits_loader = NULL;
+
+void
+xaccQuerySetSplitsLoader (QuerySplitsLoader loader)
+{
+    splits_loader = loader;
+}
+
+void
+xaccQueryLoadPendingSplits (QofQuery *q)
+{
+    GList *node;
+
+    g_return_if_fail (q);
+
+    if (!splits_loader ||
+        g_strcmp0 (qof_query_get_search_for (q), GNC_ID_SPLIT) != 0)
+        return;
+
+    for (node = qof_query_get_books (q); node; node = node->next)
+    {
+        QofBackend *be = qof_book_get_backend (node->data);
+
+        if (be)
+            splits_loader (be, q);
+    }
+}
+
 
 /* ======================== END OF FILE ======================= */
@@ -187,6 +187,21 @@ void xaccQueryAddGUIDMatch(QofQuery * q, const GncGUID *guid,
                            QofIdType id_type, QofQueryOp op);
 
 
+/** A backend that leaves some accounts' splits pending (see
+ *  gnc_account_set_splits_pending()) registers one of these to load the
+ *  transactions whose splits might match a split query.  It may load more
+ *  than match, since the query is still run in memory afterwards, but
+ *  not fewer. */
+typedef void (*QuerySplitsLoader) (QofBackend *be, QofQuery *q);
+
+/** Set the function xaccQueryLoadPendingSplits() calls. */
+void xaccQuerySetSplitsLoader (QuerySplitsLoader loader);
+
+/** Load what a split query might find from the backend of each of its
+ *  books, so that qof_query_run() doesn't miss splits still pending in
+ *  the backend.  Does nothing for other queries. */
+void xaccQueryLoadPendingSplits (QofQuery *q);
+
 /*******************************************************************
  *  compatibility interface with old QofQuery API
  *******************************************************************/
@@ -370,6 +370,37 @@ recurrenceNthInstance(const Recurrence *r, guint n, GDate *date)
     GDate ref;
     guint i;
 
+    /* Periods of a fixed number of days, and months without weekend
+       adjustment, can be counted off from the start directly instead
+       of stepping through every instance before the nth. */
+    switch (r->ptype)
+    {
+    case PERIOD_WEEK:
+    case PERIOD_DAY:
+        *date = r->start;
+        g_date_add_days(date, n * r->mult *
+                        (r->ptype == PERIOD_WEEK ? 7 : 1));
+        return;
+    case PERIOD_YEAR:
+    case PERIOD_MONTH:
+        if (r->wadj == WEEKEND_ADJ_NONE)
+        {
+            guint dim;
+
+            g_date_set_dmy(date, 1, g_date_get_month(&r->start),
+                           g_date_get_year(&r->start));
+            g_date_add_months(date, n * r->mult *
+                              (r->ptype == PERIOD_YEAR ? 12 : 1));
+            dim = g_date_get_days_in_month(g_date_get_month(date),
+                                           g_date_get_year(date));
+            g_date_set_day(date, MIN(g_date_get_day(&r->start), dim));
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
     for (*date = ref = r->start, i = 0; i < n; i++)
     {
         recurrenceNextInstance(r, &ref, date);
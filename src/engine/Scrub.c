@@ -40,12 +40,18 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "Account.h"
 #include "AccountP.h"
 #include "Scrub.h"
+#include "Scrub3.h"
+#include "ScrubBusiness.h"
 #include "ScrubP.h"
 #include "Transaction.h"
 #include "TransactionP.h"
@@ -57,6 +63,10 @@
 
 static QofLogModule log_module = G_LOG_DOMAIN;
 
+static Account *scrub_get_or_make_root_account (Account *root,
+                                                gnc_commodity *currency,
+                                                const char *accname);
+
 /* ================================================================ */
 
 void
@@ -90,8 +100,8 @@ TransScrubOrphansFast (Transaction *trans, Account *root)
         accname = g_strconcat (_("Orphan"), "-",
                                gnc_commodity_get_mnemonic (trans->common_currency),
                                NULL);
-        orph = xaccScrubUtilityGetOrMakeAccount (root, trans->common_currency,
-                                                 accname, ACCT_TYPE_BANK, FALSE);
+        orph = scrub_get_or_make_root_account (root, trans->common_currency,
+                                               accname);
         g_free (accname);
         if (!orph) continue;
 
@@ -156,12 +166,34 @@ xaccTransScrubOrphans (Transaction *trans)
 
 void
 xaccAccountTreeScrubSplits (Account *account)
+{
+    xaccAccountTreeScrubSplitsSince (account, INT64_MIN);
+}
+
+static void
+scrub_splits_since_helper (Account *account, gpointer data)
+{
+    time64 since = *(time64 *)data;
+    GList *node;
+
+    for (node = xaccAccountGetSplitList (account); node; node = node->next)
+    {
+        Transaction *trans = xaccSplitGetParent (node->data);
+
+        if (trans && xaccTransGetDate (trans) < since)
+            continue;
+        xaccSplitScrub (node->data);
+    }
+}
+
+void
+xaccAccountTreeScrubSplitsSince (Account *account, time64 since)
 {
     if (!account) return;
 
-    xaccAccountScrubSplits (account);
-    gnc_account_foreach_descendant(account,
-                                   (AccountCb)xaccAccountScrubSplits, NULL);
+    scrub_splits_since_helper (account, &since);
+    gnc_account_foreach_descendant (account, scrub_splits_since_helper,
+                                    &since);
 }
 
 void
@@ -314,6 +346,590 @@ xaccAccountScrubImbalance (Account *acc)
     }
 }
 
+/* ================================================================ */
+/* Check & Repair of a whole account tree.  Finding the transactions
+ * that need repairing only reads the engine objects, so it's spread over
+ * a thread pool in chunks of accounts.  The repairs, and the lot and
+ * business scrubs, change the book and run on the calling thread, which
+ * is also the only one that reports progress.
+ */
+#define SCRUB_CHUNK_ACCOUNTS 16
+
+static gint abort_scrub = 0;
+static gint ongoing_scrub = 0;
+
+void
+gnc_set_abort_scrub (gboolean abort)
+{
+    g_atomic_int_set (&abort_scrub, abort ? 1 : 0);
+}
+
+gboolean
+gnc_get_abort_scrub (void)
+{
+    return g_atomic_int_get (&abort_scrub) != 0;
+}
+
+gboolean
+gnc_get_ongoing_scrub (void)
+{
+    return ongoing_scrub > 0;
+}
+
+typedef struct
+{
+    GPtrArray *accounts;        /* every account being scrubbed */
+    GHashTable *in_tree;        /* the same accounts, as a set */
+    guint first, last;          /* this chunk's range in accounts */
+    gboolean use_trading;
+    GPtrArray *found;           /* the transactions to repair */
+    GAsyncQueue *done;
+} ScrubChunk;
+
+static gint
+scrub_threads (void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    return g_get_num_processors ();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1;
+#endif
+}
+
+/* A read-only version of the checks made by xaccTransScrubCurrency,
+ * xaccSplitScrub and xaccTransScrubImbalance.  It may say yes to a
+ * transaction those leave alone, e.g. any multi-commodity one when
+ * trading accounts are used, but never no to one they'd change. */
+static gboolean
+trans_needs_scrub (const Transaction *trans, gboolean use_trading)
+{
+    gnc_commodity *currency = trans->common_currency;
+    gnc_numeric imbal = gnc_numeric_zero ();
+    gnc_numeric imbal_trading = gnc_numeric_zero ();
+    GList *node;
+
+    if (!currency || !gnc_commodity_is_currency (currency))
+        return TRUE;
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *split = node->data;
+        gnc_numeric amount, value;
+        gnc_commodity *acc_comm;
+
+        if (!xaccTransStillHasSplit (trans, split))
+            continue;
+        if (!split->acc)
+            return TRUE;
+
+        amount = xaccSplitGetAmount (split);
+        value = xaccSplitGetValue (split);
+        if (gnc_numeric_check (amount) || gnc_numeric_check (value))
+            return TRUE;
+
+        acc_comm = xaccAccountGetCommodity (split->acc);
+        if (!acc_comm)
+            return TRUE;
+        if (gnc_commodity_equiv (acc_comm, currency))
+        {
+            if (!gnc_numeric_equal (amount, value))
+                return TRUE;
+        }
+        else if (use_trading)
+            return TRUE;
+
+        if (use_trading && xaccAccountGetType (split->acc) == ACCT_TYPE_TRADING)
+            imbal_trading = gnc_numeric_add (imbal_trading, value,
+                                             GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+        else
+            imbal = gnc_numeric_add (imbal, value,
+                                     GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT);
+    }
+    return !gnc_numeric_zero_p (imbal) || !gnc_numeric_zero_p (imbal_trading);
+}
+
+/* Each transaction is looked at only from its first split in the tree. */
+static gboolean
+first_split_in_tree (const Transaction *trans, const Split *split,
+                     GHashTable *in_tree)
+{
+    GList *node;
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *s = node->data;
+        if (s == split)
+            return TRUE;
+        if (s->acc && g_hash_table_lookup (in_tree, s->acc))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+scrub_find_chunk (gpointer data, gpointer user_data)
+{
+    ScrubChunk *chunk = data;
+    guint i;
+
+    for (i = chunk->first; i < chunk->last && !gnc_get_abort_scrub (); ++i)
+    {
+        Account *acc = g_ptr_array_index (chunk->accounts, i);
+        gint j, n_splits = gnc_account_n_splits (acc);
+
+        for (j = 0; j < n_splits; ++j)
+        {
+            Split *split = gnc_account_nth_split (acc, j);
+            Transaction *trans = split->parent;
+
+            if (trans && first_split_in_tree (trans, split, chunk->in_tree) &&
+                    trans_needs_scrub (trans, chunk->use_trading))
+                g_ptr_array_add (chunk->found, trans);
+        }
+    }
+    g_async_queue_push (chunk->done, chunk);
+}
+
+/* Wait for the next chunk, keeping the progress display alive. */
+static void
+scrub_wait_chunk (GAsyncQueue *done, QofPercentageFunc percentagefunc,
+                  double percent)
+{
+    while (TRUE)
+    {
+#ifdef HAVE_GLIB_2_32
+        if (g_async_queue_timeout_pop (done, G_USEC_PER_SEC / 10))
+            return;
+#else
+        GTimeVal timeout;
+        g_get_current_time (&timeout);
+        g_time_val_add (&timeout, G_USEC_PER_SEC / 10);
+        if (g_async_queue_timed_pop (done, &timeout))
+            return;
+#endif
+        if (percentagefunc)
+            percentagefunc (_("Checking accounts"), percent);
+    }
+}
+
+gboolean
+xaccAccountTreeScrubAll (Account *acc, gboolean scrub_lots,
+                         QofPercentageFunc percentagefunc)
+{
+    GPtrArray *accounts;
+    GHashTable *in_tree;
+    GList *descendants, *node;
+    ScrubChunk *chunks;
+    GAsyncQueue *done;
+    GThreadPool *pool = NULL;
+    guint n_chunks, n_found = 0, n_fixed = 0, i, j;
+    gboolean use_trading;
+
+    g_return_val_if_fail (acc, FALSE);
+    ENTER ("(acc=%s)", xaccAccountGetName (acc));
+    ++ongoing_scrub;
+    gnc_set_abort_scrub (FALSE);
+
+    accounts = g_ptr_array_new ();
+    in_tree = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_ptr_array_add (accounts, acc);
+    descendants = gnc_account_get_descendants (acc);
+    for (node = descendants; node; node = node->next)
+        g_ptr_array_add (accounts, node->data);
+    g_list_free (descendants);
+    /* Loading and sorting the splits changes the accounts, so get it
+     * out of the way before the threads look at them. */
+    for (i = 0; i < accounts->len; ++i)
+    {
+        Account *a = g_ptr_array_index (accounts, i);
+        gnc_account_n_splits (a);
+        g_hash_table_insert (in_tree, a, a);
+    }
+    use_trading = qof_book_use_trading_accounts (gnc_account_get_book (acc));
+
+    /* Find the transactions that need repairing. */
+    n_chunks = (accounts->len + SCRUB_CHUNK_ACCOUNTS - 1) / SCRUB_CHUNK_ACCOUNTS;
+    chunks = g_new0 (ScrubChunk, n_chunks);
+    done = g_async_queue_new ();
+    if (n_chunks > 1 && scrub_threads () > 1)
+        pool = g_thread_pool_new (scrub_find_chunk, NULL, scrub_threads (),
+                                  FALSE, NULL);
+    for (i = 0; i < n_chunks; ++i)
+    {
+        ScrubChunk *chunk = &chunks[i];
+        chunk->accounts = accounts;
+        chunk->in_tree = in_tree;
+        chunk->first = i * SCRUB_CHUNK_ACCOUNTS;
+        chunk->last = MIN (chunk->first + SCRUB_CHUNK_ACCOUNTS, accounts->len);
+        chunk->use_trading = use_trading;
+        chunk->found = g_ptr_array_new ();
+        chunk->done = done;
+        if (pool)
+            g_thread_pool_push (pool, chunk, NULL);
+    }
+    for (i = 0; i < n_chunks; ++i)
+    {
+        if (pool)
+            scrub_wait_chunk (done, percentagefunc, 30.0 * i / n_chunks);
+        else
+        {
+            scrub_find_chunk (&chunks[i], NULL);
+            g_async_queue_pop (done);
+        }
+        if (percentagefunc)
+            percentagefunc (_("Checking accounts"), 30.0 * (i + 1) / n_chunks);
+    }
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+    g_async_queue_unref (done);
+    for (i = 0; i < n_chunks; ++i)
+        n_found += chunks[i].found->len;
+    PINFO ("%u transactions to repair in %u accounts", n_found, accounts->len);
+
+    xaccScrubBeginAccountCache ();
+
+    /* Repair them, in the order the accounts came in. */
+    for (i = 0; i < n_chunks && !gnc_get_abort_scrub (); ++i)
+    {
+        for (j = 0; j < chunks[i].found->len && !gnc_get_abort_scrub (); ++j)
+        {
+            Transaction *trans = g_ptr_array_index (chunks[i].found, j);
+
+            xaccTransScrubCurrency (trans);
+            xaccTransScrubImbalance (trans, gnc_account_get_root (acc), NULL);
+            if (percentagefunc && (++n_fixed % 100) == 0)
+                percentagefunc (_("Repairing transactions"),
+                                30.0 + 40.0 * n_fixed / n_found);
+        }
+    }
+
+    /* The lot scrubs work on whole accounts at a time. */
+    for (i = 0; i < accounts->len && !gnc_get_abort_scrub (); ++i)
+    {
+        Account *a = g_ptr_array_index (accounts, i);
+
+        if (scrub_lots)
+            xaccAccountScrubLots (a);
+        gncScrubBusinessAccount (a);
+        if (percentagefunc)
+            percentagefunc (_("Checking lots"),
+                            70.0 + 30.0 * (i + 1) / accounts->len);
+    }
+
+    xaccScrubEndAccountCache ();
+
+    for (i = 0; i < n_chunks; ++i)
+        g_ptr_array_free (chunks[i].found, TRUE);
+    g_free (chunks);
+    g_hash_table_destroy (in_tree);
+    g_ptr_array_free (accounts, TRUE);
+
+    if (!gnc_get_abort_scrub () && gnc_account_is_root (acc))
+        xaccBookMarkScrubbed (gnc_account_get_book (acc));
+
+    --ongoing_scrub;
+    LEAVE ("%s", gnc_get_abort_scrub () ? "aborted" : "done");
+    return !gnc_get_abort_scrub ();
+}
+
+/* ================================================================ */
+/* The watermark is the auto-read-only threshold at the last time the
+ * whole book was scrubbed.  It is kept in the book's KVP without
+ * dirtying the book, so it reaches the file with the next save. */
+#define KEY_SCRUBBED_BEFORE "scrubbed-before"
+
+time64
+xaccBookScrubSkipBefore (const QofBook *book)
+{
+    GDate *threshold;
+    time64 since, scrubbed;
+
+    g_return_val_if_fail (book, INT64_MIN);
+    if (!qof_instance_get_kvp_int64 (QOF_INSTANCE (book), KEY_SCRUBBED_BEFORE,
+                                     &scrubbed))
+        return INT64_MIN;
+    threshold = qof_book_get_autoreadonly_gdate (book);
+    if (!threshold)
+        return INT64_MIN;
+    since = gdate_to_timespec (*threshold).tv_sec;
+    g_date_free (threshold);
+    return MIN (since, scrubbed);
+}
+
+void
+xaccBookMarkScrubbed (QofBook *book)
+{
+    GDate *threshold;
+    GValue value = G_VALUE_INIT;
+
+    g_return_if_fail (book);
+    threshold = qof_book_get_autoreadonly_gdate (book);
+    if (!threshold)
+    {
+        /* Old transactions may be edited while the feature is off, so
+         * the next threshold has to start again from the beginning. */
+        qof_instance_set_kvp (QOF_INSTANCE (book), KEY_SCRUBBED_BEFORE, NULL);
+        return;
+    }
+    g_value_init (&value, G_TYPE_INT64);
+    g_value_set_int64 (&value, gdate_to_timespec (*threshold).tv_sec);
+    qof_instance_set_kvp (QOF_INSTANCE (book), KEY_SCRUBBED_BEFORE, &value);
+    g_value_unset (&value);
+    g_date_free (threshold);
+}
+
+/* ================================================================ */
+/* While a batch scrub is running the accounts found by name are
+ * remembered, so that the imbalance and trading accounts are looked up
+ * once per commodity instead of walking the account tree for every
+ * transaction.  The cache holds GUIDs rather than pointers and each hit
+ * is checked against the account's current name, so an account that was
+ * destroyed or renamed in the meantime is simply looked up again.
+ * Each thread has a cache of its own, since the batches of threads
+ * working on different books are independent.
+ */
+typedef struct
+{
+    GHashTable *table;
+    gint depth;
+} BatchAccountCache;
+
+static void
+batch_account_cache_free (gpointer data)
+{
+    BatchAccountCache *cache = data;
+
+    if (cache->table)
+        g_hash_table_destroy (cache->table);
+    g_free (cache);
+}
+
+static BatchAccountCache *
+batch_account_cache (void)
+{
+#ifndef HAVE_GLIB_2_32
+    static GStaticPrivate batch_account_cache_key = G_STATIC_PRIVATE_INIT;
+    BatchAccountCache *cache;
+
+    cache = g_static_private_get (&batch_account_cache_key);
+    if (cache == NULL)
+    {
+        cache = g_new0 (BatchAccountCache, 1);
+        g_static_private_set (&batch_account_cache_key, cache,
+                              batch_account_cache_free);
+    }
+#else
+    static GPrivate batch_account_cache_key =
+        G_PRIVATE_INIT (batch_account_cache_free);
+    BatchAccountCache *cache;
+
+    cache = g_private_get (&batch_account_cache_key);
+    if (cache == NULL)
+    {
+        cache = g_new0 (BatchAccountCache, 1);
+        g_private_set (&batch_account_cache_key, cache);
+    }
+#endif
+    return cache;
+}
+
+void
+xaccScrubBeginAccountCache (void)
+{
+    BatchAccountCache *cache = batch_account_cache ();
+
+    if (cache->depth++ == 0)
+        cache->table = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free,
+                                              (GDestroyNotify) guid_free);
+}
+
+void
+xaccScrubEndAccountCache (void)
+{
+    BatchAccountCache *cache = batch_account_cache ();
+
+    g_return_if_fail (cache->depth > 0);
+    if (--cache->depth == 0)
+    {
+        g_hash_table_destroy (cache->table);
+        cache->table = NULL;
+    }
+}
+
+static gchar *
+account_cache_key (const Account *parent, const char *accname)
+{
+    gchar guidstr[GUID_ENCODING_LENGTH + 1];
+    guid_to_string_buff (qof_entity_get_guid (QOF_INSTANCE (parent)), guidstr);
+    return g_strconcat (guidstr, "/", accname, NULL);
+}
+
+static Account *
+scrub_lookup_account (Account *parent, const char *accname)
+{
+    GHashTable *account_cache = batch_account_cache ()->table;
+    Account *acc;
+    gchar *key;
+    GncGUID *guid;
+
+    if (!account_cache)
+        return gnc_account_lookup_by_name (parent, accname);
+
+    key = account_cache_key (parent, accname);
+    guid = g_hash_table_lookup (account_cache, key);
+    if (guid)
+    {
+        acc = xaccAccountLookup (guid, gnc_account_get_book (parent));
+        if (acc && !qof_instance_get_destroying (acc) &&
+            g_strcmp0 (xaccAccountGetName (acc), accname) == 0)
+        {
+            g_free (key);
+            return acc;
+        }
+    }
+
+    acc = gnc_account_lookup_by_name (parent, accname);
+    if (acc)
+        g_hash_table_replace (account_cache, key,
+                              guid_copy (qof_entity_get_guid (QOF_INSTANCE (acc))));
+    else
+        g_free (key);
+    return acc;
+}
+
+/* ================================================================ */
+/* The imbalance, orphan and trading accounts found under a book's root,
+ * and the Income account whose currency the trading accounts get, are
+ * also kept in the book between scrubs.  The whole cache is dropped
+ * whenever any account is added, removed or renamed, which is what
+ * gnc_account_get_names_generation() counts, so a hit can't be an
+ * account that has gone or has another name now.  The keys are names
+ * rather than commodity pointers for the same reason.
+ */
+#define SCRUB_ACCOUNT_CACHE "gnc-scrub-account-cache"
+
+typedef struct
+{
+    Account *root;
+    guint generation;
+    gboolean have_income;
+    Account *income;
+    GHashTable *by_name;    /* imbalance or orphan name -> Account* */
+    GHashTable *trading;    /* commodity unique name -> Account* */
+} ScrubAccountCache;
+
+static void
+scrub_account_cache_destroy (QofBook *book, gpointer key, gpointer data)
+{
+    ScrubAccountCache *cache = data;
+    g_hash_table_destroy (cache->by_name);
+    g_hash_table_destroy (cache->trading);
+    g_free (cache);
+}
+
+static void
+scrub_account_cache_reset (ScrubAccountCache *cache, Account *root)
+{
+    cache->root = root;
+    cache->generation = gnc_account_get_names_generation ();
+    cache->have_income = FALSE;
+    cache->income = NULL;
+    g_hash_table_remove_all (cache->by_name);
+    g_hash_table_remove_all (cache->trading);
+}
+
+static ScrubAccountCache *
+get_scrub_account_cache (Account *root)
+{
+    QofBook *book = gnc_account_get_book (root);
+    ScrubAccountCache *cache;
+
+    if (!book || qof_book_shutting_down (book))
+        return NULL;
+
+    cache = qof_book_get_data (book, SCRUB_ACCOUNT_CACHE);
+    if (!cache)
+    {
+        cache = g_new0 (ScrubAccountCache, 1);
+        cache->by_name = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, NULL);
+        cache->trading = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, NULL);
+        scrub_account_cache_reset (cache, root);
+        qof_book_set_data_fin (book, SCRUB_ACCOUNT_CACHE, cache,
+                               scrub_account_cache_destroy);
+    }
+    else if (cache->root != root ||
+             cache->generation != gnc_account_get_names_generation ())
+        scrub_account_cache_reset (cache, root);
+    return cache;
+}
+
+/* Making an account to remember changes the generation itself; only
+ * the lookups of the new account's name can have changed, but the rest
+ * of the cache is dropped too rather than reasoning about that. */
+static void
+scrub_account_cache_insert (ScrubAccountCache *cache, GHashTable *table,
+                            const char *key, Account *acc)
+{
+    if (cache->generation != gnc_account_get_names_generation ())
+        scrub_account_cache_reset (cache, cache->root);
+    g_hash_table_replace (table, g_strdup (key), acc);
+}
+
+/* Find or make the bank account accname directly under root, as the
+ * imbalance and orphan accounts are. */
+static Account *
+scrub_get_or_make_root_account (Account *root, gnc_commodity *currency,
+                                const char *accname)
+{
+    ScrubAccountCache *cache = get_scrub_account_cache (root);
+    Account *acc;
+
+    if (cache)
+    {
+        acc = g_hash_table_lookup (cache->by_name, accname);
+        if (acc)
+            return acc;
+    }
+
+    acc = xaccScrubUtilityGetOrMakeAccount (root, currency, accname,
+                                            ACCT_TYPE_BANK, FALSE);
+    if (cache && acc)
+        scrub_account_cache_insert (cache, cache->by_name, accname, acc);
+    return acc;
+}
+
+/* Get the default currency.  This is harder than it seems.  It's not
+   possible to call gnc_default_currency() since it's a UI function.  One
+   might think that the currency of the root account would do, but the root
+   account has no currency.  Instead look for the Income placeholder account
+   and use its currency.  Only the account is cached; its currency is read
+   each time, since changing it doesn't change the generation. */
+static gnc_commodity *
+scrub_default_currency (ScrubAccountCache *cache, Account *root)
+{
+    Account *income;
+
+    if (cache && cache->have_income)
+        income = cache->income;
+    else
+    {
+        income = scrub_lookup_account (root, _("Income"));
+        if (cache)
+        {
+            cache->income = income;
+            cache->have_income = TRUE;
+        }
+    }
+    return xaccAccountGetCommodity (income);
+}
+
+/* ================================================================ */
+
 static Split *
 get_balance_split (Transaction *trans, Account *root, Account *account,
                    gnc_commodity *commodity)
@@ -336,8 +952,7 @@ get_balance_split (Transaction *trans, Account *root, Account *account,
         }
         accname = g_strconcat (_("Imbalance"), "-",
                                gnc_commodity_get_mnemonic (commodity), NULL);
-        account = xaccScrubUtilityGetOrMakeAccount (root, commodity,
-                                                    accname, ACCT_TYPE_BANK, FALSE);
+        account = scrub_get_or_make_root_account (root, commodity, accname);
         g_free (accname);
         if (!account)
         {
@@ -373,6 +988,8 @@ get_trading_split (Transaction *trans, Account *root,
     Account *ns_account;
     Account *account;
     gnc_commodity *default_currency = NULL;
+    ScrubAccountCache *cache;
+    const char *unique_name;
 
     if (!root)
     {
@@ -385,48 +1002,51 @@ get_trading_split (Transaction *trans, Account *root,
         }
     }
 
-    /* Get the default currency.  This is harder than it seems.  It's not
-       possible to call gnc_default_currency() since it's a UI function.  One
-       might think that the currency of the root account would do, but the root
-       account has no currency.  Instead look for the Income placeholder account
-       and use its currency.  */
-    default_currency = xaccAccountGetCommodity(gnc_account_lookup_by_name(root,
-                                                                          _("Income")));
-    if (! default_currency)
+    cache = get_scrub_account_cache (root);
+    unique_name = gnc_commodity_get_unique_name (commodity);
+    account = cache && unique_name ?
+              g_hash_table_lookup (cache->trading, unique_name) : NULL;
+    if (!account)
     {
-        default_currency = commodity;
-    }
+        default_currency = scrub_default_currency (cache, root);
+        if (! default_currency)
+        {
+            default_currency = commodity;
+        }
 
-    trading_account = xaccScrubUtilityGetOrMakeAccount (root,
-                                                        default_currency,
-                                                        _("Trading"),
-                                                        ACCT_TYPE_TRADING, TRUE);
-    if (!trading_account)
-    {
-        PERR ("Can't get trading account");
-        return NULL;
-    }
+        trading_account = xaccScrubUtilityGetOrMakeAccount (root,
+                                                            default_currency,
+                                                            _("Trading"),
+                                                            ACCT_TYPE_TRADING, TRUE);
+        if (!trading_account)
+        {
+            PERR ("Can't get trading account");
+            return NULL;
+        }
 
-    ns_account = xaccScrubUtilityGetOrMakeAccount (trading_account,
-                                                   default_currency,
-                                                   gnc_commodity_get_namespace(commodity),
-                                                   ACCT_TYPE_TRADING, TRUE);
-    if (!ns_account)
-    {
-        PERR ("Can't get namespace account");
-        return NULL;
-    }
+        ns_account = xaccScrubUtilityGetOrMakeAccount (trading_account,
+                                                       default_currency,
+                                                       gnc_commodity_get_namespace(commodity),
+                                                       ACCT_TYPE_TRADING, TRUE);
+        if (!ns_account)
+        {
+            PERR ("Can't get namespace account");
+            return NULL;
+        }
 
-    account = xaccScrubUtilityGetOrMakeAccount (ns_account, commodity,
-                                                gnc_commodity_get_mnemonic(commodity),
-                                                ACCT_TYPE_TRADING, FALSE);
-    if (!account)
-    {
-        PERR ("Can't get commodity account");
-        return NULL;
+        account = xaccScrubUtilityGetOrMakeAccount (ns_account, commodity,
+                                                    gnc_commodity_get_mnemonic(commodity),
+                                                    ACCT_TYPE_TRADING, FALSE);
+        if (!account)
+        {
+            PERR ("Can't get commodity account");
+            return NULL;
+        }
+        if (cache && unique_name)
+            scrub_account_cache_insert (cache, cache->trading, unique_name,
+                                        account);
     }
 
-
     balance_split = xaccTransFindSplitByAccount(trans, account);
 
     /* Put split into account before setting split value */
@@ -464,21 +1084,21 @@ find_trading_split (Transaction *trans, Account *root,
         }
     }
 
-    trading_account = gnc_account_lookup_by_name (root, _("Trading"));
+    trading_account = scrub_lookup_account (root, _("Trading"));
     if (!trading_account)
     {
         return NULL;
     }
 
-    ns_account = gnc_account_lookup_by_name (trading_account,
-                                             gnc_commodity_get_namespace(commodity));
+    ns_account = scrub_lookup_account (trading_account,
+                                       gnc_commodity_get_namespace(commodity));
     if (!ns_account)
     {
         return NULL;
     }
 
-    account = gnc_account_lookup_by_name (ns_account,
-                                          gnc_commodity_get_mnemonic(commodity));
+    account = scrub_lookup_account (ns_account,
+                                    gnc_commodity_get_mnemonic(commodity));
     if (!account)
     {
         return NULL;
@@ -1218,7 +1838,8 @@ xaccAccountDeleteOldData (Account *account)
 static int
 scrub_trans_currency_helper (Transaction *t, gpointer data)
 {
-    xaccTransScrubCurrency (t);
+    if (xaccTransGetDate (t) >= *(time64 *)data)
+        xaccTransScrubCurrency (t);
     return 0;
 }
 
@@ -1231,10 +1852,17 @@ scrub_account_commodity_helper (Account *account, gpointer data)
 
 void
 xaccAccountTreeScrubCommodities (Account *acc)
+{
+    xaccAccountTreeScrubCommoditiesSince (acc, INT64_MIN);
+}
+
+void
+xaccAccountTreeScrubCommoditiesSince (Account *acc, time64 since)
 {
     if (!acc) return;
 
-    xaccAccountTreeForEachTransaction (acc, scrub_trans_currency_helper, NULL);
+    xaccAccountTreeForEachTransaction (acc, scrub_trans_currency_helper,
+                                       &since);
 
     scrub_account_commodity_helper (acc, NULL);
     gnc_account_foreach_descendant (acc, scrub_account_commodity_helper, NULL);
@@ -1342,6 +1970,7 @@ xaccScrubUtilityGetOrMakeAccount (Account *root, gnc_commodity * currency,
                                   const char *accname, GNCAccountType acctype,
                                   gboolean placeholder)
 {
+    GHashTable *account_cache;
     Account * acc;
 
     g_return_val_if_fail (root, NULL);
@@ -1354,7 +1983,7 @@ xaccScrubUtilityGetOrMakeAccount (Account *root, gnc_commodity * currency,
     }
 
     /* See if we've got one of these going already ... */
-    acc = gnc_account_lookup_by_name(root, accname);
+    acc = scrub_lookup_account (root, accname);
 
     if (acc == NULL)
     {
@@ -1369,6 +1998,11 @@ xaccScrubUtilityGetOrMakeAccount (Account *root, gnc_commodity * currency,
         /* Hang the account off the root. */
         gnc_account_append_child (root, acc);
         xaccAccountCommitEdit (acc);
+        account_cache = batch_account_cache ()->table;
+        if (account_cache)
+            g_hash_table_replace (account_cache,
+                                  account_cache_key (root, accname),
+                                  guid_copy (qof_entity_get_guid (QOF_INSTANCE (acc))));
     }
 
     return acc;
@@ -101,6 +101,12 @@ void xaccTransScrubSplits (Transaction *trans);
 void xaccAccountScrubSplits (Account *account);
 void xaccAccountTreeScrubSplits (Account *account);
 
+/** Like xaccAccountTreeScrubSplits(), but leaves alone the splits of
+ *  transactions posted before @a since.  Pass the result of
+ *  xaccBookScrubSkipBefore() to skip the periods scrubbed already.
+ */
+void xaccAccountTreeScrubSplitsSince (Account *account, time64 since);
+
 /** The xaccScrubImbalance() method searches for transactions that do
  *    not balance to zero. If any such transactions are found, a split
  *    is created to offset this amount and is added to an "imbalance"
@@ -111,6 +117,52 @@ void xaccTransScrubImbalance (Transaction *trans, Account *root,
 void xaccAccountScrubImbalance (Account *acc);
 void xaccAccountTreeScrubImbalance (Account *acc);
 
+/** The xaccAccountTreeScrubAll() method does a complete Check & Repair
+ *  of @a acc and all of its descendants: orphans, split values,
+ *  currencies and imbalances, the lots (only if @a scrub_lots) and the
+ *  business lots and splits.  The transactions that need repairing are
+ *  found on a thread pool; the repairs are made on the calling thread.
+ *
+ *  @param percentagefunc If not NULL, called on the calling thread with
+ *  the progress in percent, often enough to keep a UI responsive.  It
+ *  must not change the book.
+ *
+ *  @return FALSE if gnc_set_abort_scrub() stopped the scrub early.
+ */
+gboolean xaccAccountTreeScrubAll (Account *acc, gboolean scrub_lots,
+                                  QofPercentageFunc percentagefunc);
+
+/** The date before which the load-time scrubs may skip transactions:
+ *  the earlier of the book's auto-read-only threshold and the threshold
+ *  when xaccBookMarkScrubbed() was last called.  Transactions before it
+ *  were scrubbed then and can't have been edited since.
+ *
+ *  The skip only holds for edits made through the engine's read-only
+ *  checks.  If the book may have been changed some other way, run
+ *  xaccAccountTreeScrubAll() on the root account, which scrubs every
+ *  period.
+ *
+ *  @return INT64_MIN if nothing may be skipped: the book was never
+ *  marked or doesn't use the auto-read-only feature.
+ */
+time64 xaccBookScrubSkipBefore (const QofBook *book);
+
+/** Record that every transaction before the book's current auto-read-only
+ *  threshold has been scrubbed.  This doesn't mark the book dirty.  A
+ *  book without the feature loses its mark instead, because its old
+ *  transactions may be edited.
+ */
+void xaccBookMarkScrubbed (QofBook *book);
+
+/** Ask a running xaccAccountTreeScrubAll() to stop as soon as it can,
+ *  for instance from a key press handled during its progress
+ *  callback. The flag is cleared when the next scrub starts. */
+void gnc_set_abort_scrub (gboolean abort);
+gboolean gnc_get_abort_scrub (void);
+
+/** TRUE while xaccAccountTreeScrubAll() is running. */
+gboolean gnc_get_ongoing_scrub (void);
+
 /** The xaccTransScrubCurrency method fixes transactions without a
  * common_currency by looking for the most commonly used currency
  * among all the splits in the transaction.  If this fails it falls
@@ -127,6 +179,10 @@ void xaccAccountScrubCommodity (Account *account);
  * account or any child account. */
 void xaccAccountTreeScrubCommodities (Account *acc);
 
+/** Like xaccAccountTreeScrubCommodities(), but doesn't scrub the
+ *  currencies of transactions posted before @a since. */
+void xaccAccountTreeScrubCommoditiesSince (Account *acc, time64 since);
+
 /** This routine will migrate the information about price quote
  *  sources from the account data structures to the commodity data
  *  structures.  It first checks to see if this is necessary since,
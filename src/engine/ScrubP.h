@@ -37,5 +37,11 @@ Account * xaccScrubUtilityGetOrMakeAccount (Account *root,
         gnc_commodity * currency, const char *accname,
         GNCAccountType acctype, gboolean placeholder);
 
+/* Remember the accounts found by xaccScrubUtilityGetOrMakeAccount() and
+ * the trading account lookups until the matching
+ * xaccScrubEndAccountCache().  Calls may be nested. */
+void xaccScrubBeginAccountCache (void);
+void xaccScrubEndAccountCache (void);
+
 
 #endif /* XACC_SCRUB_P_H */
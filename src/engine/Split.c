@@ -117,12 +117,12 @@ gnc_split_init(Split* split)
     split->amount      = gnc_numeric_zero();
     split->value       = gnc_numeric_zero();
 
-    split->date_reconciled.tv_sec  = 0;
-    split->date_reconciled.tv_nsec = 0;
+    split->date_reconciled = 0;
 
     split->balance             = gnc_numeric_zero();
     split->cleared_balance     = gnc_numeric_zero();
     split->reconciled_balance  = gnc_numeric_zero();
+    split->balance_block       = NULL;
 
     split->gains = GAINS_STATUS_UNKNOWN;
     split->gains_split = NULL;
@@ -153,6 +153,7 @@ gnc_split_get_property(GObject         *object,
 {
     Split *split;
     gchar *key;
+    Timespec ts;
 
     g_return_if_fail(GNC_IS_SPLIT(object));
 
@@ -172,7 +173,8 @@ gnc_split_get_property(GObject         *object,
             g_value_set_boxed(value, &split->amount);
             break;
         case PROP_RECONCILE_DATE:
-            g_value_set_boxed(value, &split->date_reconciled);
+            timespecFromTime64(&ts, split->date_reconciled);
+            g_value_set_boxed(value, &ts);
             break;
         case PROP_TX:
             g_value_take_object(value, split->parent);
@@ -240,6 +242,8 @@ gnc_split_set_property(GObject         *object,
     split = GNC_SPLIT(object);
     if (prop_id < PROP_RUNTIME_0 && split->parent != NULL)
         g_assert (qof_instance_get_editlevel(split->parent));
+    if (prop_id < PROP_RUNTIME_0)
+        xaccTransJournalSplit (split);
 
     switch (prop_id)
     {
@@ -296,6 +300,8 @@ gnc_split_set_property(GObject         *object,
         case PROP_ONLINE_ACCOUNT:
             key = "online_id";
             qof_instance_set_kvp (QOF_INSTANCE (split), key, value);
+            if (split->held_by)
+                gnc_account_set_online_id_index_dirty (split->held_by);
             break;
         case PROP_GAINS_SPLIT:
             key = "gains-split";
@@ -526,12 +532,12 @@ xaccSplitReinit(Split * split)
     split->amount      = gnc_numeric_zero();
     split->value       = gnc_numeric_zero();
 
-    split->date_reconciled.tv_sec  = 0;
-    split->date_reconciled.tv_nsec = 0;
+    split->date_reconciled = 0;
 
     split->balance             = gnc_numeric_zero();
     split->cleared_balance     = gnc_numeric_zero();
     split->reconciled_balance  = gnc_numeric_zero();
+    split->balance_block       = NULL;
 
     qof_instance_set_idata(split, 0);
 
@@ -634,6 +640,7 @@ xaccSplitCloneNoKvp (const Split *s)
 void
 xaccSplitCopyKvp (const Split *from, Split *to)
 {
+    xaccTransJournalSplit (to);
     qof_instance_copy_kvp (QOF_INSTANCE (to), QOF_INSTANCE (from));
 }
 
@@ -688,7 +695,7 @@ xaccSplitDump (const Split *split, const char *tag)
     printf("    Action:   %s\n", split->action ? split->action : "(null)");
     printf("    KVP Data: %s\n", qof_instance_kvp_as_string (QOF_INSTANCE (split)));
     printf("    Recncld:  %c (date %s)\n", split->reconciled,
-           gnc_print_date(split->date_reconciled));
+           gnc_print_date(xaccSplitRetDateReconciledTS(split)));
     printf("    Value:    %s\n", gnc_numeric_to_string(split->value));
     printf("    Amount:   %s\n", gnc_numeric_to_string(split->amount));
     printf("    Balance:  %s\n", gnc_numeric_to_string(split->balance));
@@ -727,8 +734,7 @@ xaccFreeSplit (Split *split)
     split->acc         = NULL;
     split->orig_acc    = NULL;
 
-    split->date_reconciled.tv_sec = 0;
-    split->date_reconciled.tv_nsec = 0;
+    split->date_reconciled = 0;
     G_OBJECT_CLASS (QOF_INSTANCE_GET_CLASS (&split->inst))->dispose(G_OBJECT (split));
     // Is this right?
     if (split->gains_split) split->gains_split->gains_split = NULL;
@@ -740,7 +746,7 @@ void mark_split (Split *s)
 {
     if (s->acc)
     {
-        g_object_set(s->acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_set_split_balance_dirty (s->acc, s);
     }
 
     /* set dirty flag on lot too. */
@@ -837,7 +843,7 @@ xaccSplitEqual(const Split *sa, const Split *sb,
         return FALSE;
     }
 
-    if (timespec_cmp(&(sa->date_reconciled), &(sb->date_reconciled)))
+    if (sa->date_reconciled != sb->date_reconciled)
     {
         PINFO ("reconciled date differs");
         return FALSE;
@@ -877,13 +883,16 @@ xaccSplitEqual(const Split *sa, const Split *sb,
 
     if (check_balances)
     {
-        if (!xaccSplitEqualCheckBal ("", sa->balance, sb->balance))
+        if (!xaccSplitEqualCheckBal ("", xaccSplitGetBalance (sa),
+                                     xaccSplitGetBalance (sb)))
             return FALSE;
-        if (!xaccSplitEqualCheckBal ("cleared ", sa->cleared_balance,
-                                     sb->cleared_balance))
+        if (!xaccSplitEqualCheckBal ("cleared ",
+                                     xaccSplitGetClearedBalance (sa),
+                                     xaccSplitGetClearedBalance (sb)))
             return FALSE;
-        if (!xaccSplitEqualCheckBal ("reconciled ", sa->reconciled_balance,
-                                     sb->reconciled_balance))
+        if (!xaccSplitEqualCheckBal ("reconciled ",
+                                     xaccSplitGetReconciledBalance (sa),
+                                     xaccSplitGetReconciledBalance (sb)))
             return FALSE;
     }
 
@@ -1027,7 +1036,7 @@ xaccSplitCommitEdit(Split *s)
 
     if (acc)
     {
-        g_object_set(acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_set_split_balance_dirty (acc, s);
         xaccAccountRecomputeBalance(acc);
     }
 }
@@ -1064,9 +1073,12 @@ xaccSplitRollbackEdit(Split *s)
 Split *
 xaccSplitLookup (const GncGUID *guid, QofBook *book)
 {
+    static gint type_id = -1;
     QofCollection *col;
     if (!guid || !book) return NULL;
-    col = qof_book_get_collection (book, GNC_ID_SPLIT);
+    if (type_id < 0)
+        type_id = qof_object_get_type_id (GNC_ID_SPLIT);
+    col = qof_book_get_collection_by_id (book, type_id);
     return (Split *) qof_collection_lookup_entity (col, guid);
 }
 
@@ -1084,8 +1096,7 @@ void
 xaccSplitDetermineGainStatus (Split *split)
 {
     Split *other;
-    GValue v = G_VALUE_INIT;
-    GncGUID *guid = NULL;
+    const GncGUID *guid;
 
     if (GAINS_STATUS_UNKNOWN != split->gains) return;
 
@@ -1097,9 +1108,7 @@ xaccSplitDetermineGainStatus (Split *split)
         return;
     }
 
-    qof_instance_get_kvp (QOF_INSTANCE (split), "gains-source", &v);
-    if (G_VALUE_HOLDS_BOXED (&v))
-        guid = (GncGUID*)g_value_get_boxed (&v);
+    guid = qof_instance_get_kvp_guid (QOF_INSTANCE (split), "gains-source");
     if (!guid)
     {
         // CHECKME: We leave split->gains_split alone.  Is that correct?
@@ -1162,6 +1171,7 @@ xaccSplitSetSharePriceAndAmount (Split *s, gnc_numeric price, gnc_numeric amt)
     if (!s) return;
     ENTER (" ");
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
 
     s->amount = gnc_numeric_convert(amt, get_commodity_denom(s),
                                     GNC_HOW_RND_ROUND_HALF_UP);
@@ -1190,6 +1200,7 @@ xaccSplitSetSharePrice (Split *s, gnc_numeric price)
     if (!s) return;
     ENTER (" ");
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
 
     s->value = gnc_numeric_mul(xaccSplitGetAmount(s),
                                price, get_currency_denom(s),
@@ -1206,6 +1217,8 @@ static void
 qofSplitSetAmount (Split *split, gnc_numeric amt)
 {
     g_return_if_fail(split);
+    /* may be called outside of an edit of the parent */
+    xaccTransForgetImbalances ();
     if (split->acc)
     {
         split->amount = gnc_numeric_convert(amt,
@@ -1228,6 +1241,7 @@ xaccSplitSetAmount (Split *s, gnc_numeric amt)
            s->amount.num, s->amount.denom, amt.num, amt.denom);
 
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
     if (s->acc)
     {
         s->amount = gnc_numeric_convert(amt, get_commodity_denom(s),
@@ -1248,6 +1262,8 @@ static void
 qofSplitSetValue (Split *split, gnc_numeric amt)
 {
     g_return_if_fail(split);
+    /* may be called outside of an edit of the parent */
+    xaccTransForgetImbalances ();
     split->value = gnc_numeric_convert(amt,
                                        get_currency_denom(split), GNC_HOW_RND_ROUND_HALF_UP);
     g_assert(gnc_numeric_check (split->value) != GNC_ERROR_OK);
@@ -1266,6 +1282,7 @@ xaccSplitSetValue (Split *s, gnc_numeric amt)
            s->value.num, s->value.denom, amt.num, amt.denom);
 
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
     new_val = gnc_numeric_convert(amt, get_currency_denom(s),
                                   GNC_HOW_RND_ROUND_HALF_UP);
     if (gnc_numeric_check(new_val) == GNC_ERROR_OK &&
@@ -1286,19 +1303,25 @@ xaccSplitSetValue (Split *s, gnc_numeric amt)
 gnc_numeric
 xaccSplitGetBalance (const Split *s)
 {
-    return s ? s->balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    gnc_account_refresh_split_balance ((Split *) s);
+    return s->balance;
 }
 
 gnc_numeric
 xaccSplitGetClearedBalance (const Split *s)
 {
-    return s ? s->cleared_balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    gnc_account_refresh_split_balance ((Split *) s);
+    return s->cleared_balance;
 }
 
 gnc_numeric
 xaccSplitGetReconciledBalance (const Split *s)
 {
-    return s ? s->reconciled_balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    gnc_account_refresh_split_balance ((Split *) s);
+    return s->reconciled_balance;
 }
 
 void
@@ -1310,6 +1333,7 @@ xaccSplitSetBaseValue (Split *s, gnc_numeric value,
 
     if (!s) return;
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
 
     if (!s->acc)
     {
@@ -1639,21 +1663,14 @@ xaccSplitGetCorrAccountCode(const Split *sa)
 int
 xaccSplitCompareAccountFullNames(const Split *sa, const Split *sb)
 {
-    Account *aa, *ab;
-    char *full_a, *full_b;
-    int retval;
     if (!sa && !sb) return 0;
     if (!sa) return -1;
     if (!sb) return 1;
 
-    aa = sa->acc;
-    ab = sb->acc;
-    full_a = gnc_account_get_full_name(aa);
-    full_b = gnc_account_get_full_name(ab);
-    retval = g_utf8_collate(full_a, full_b);
-    g_free(full_a);
-    g_free(full_b);
-    return retval;
+    /* Sorting calls this for every comparison, so use the precomputed
+     * collation keys rather than g_utf8_collate() on fresh names. */
+    return strcmp(gnc_account_get_full_name_collate_key(sa->acc),
+                  gnc_account_get_full_name_collate_key(sb->acc));
 }
 
 
@@ -1671,11 +1688,26 @@ xaccSplitCompareAccountCodes(const Split *sa, const Split *sb)
     return g_strcmp0(xaccAccountGetCode(aa), xaccAccountGetCode(ab));
 }
 
+/* Like xaccSplitGetCorrAccountFullName(), without building the name */
+static const char *
+get_corr_account_cached_full_name(const Split *sa)
+{
+    static const char *split_const = NULL;
+    const Split *other_split;
+
+    if (!get_corr_account_split(sa, &other_split))
+    {
+        if (!split_const)
+            split_const = _("-- Split Transaction --");
+
+        return split_const;
+    }
+    return gnc_account_get_cached_full_name(other_split->acc);
+}
+
 int
 xaccSplitCompareOtherAccountFullNames(const Split *sa, const Split *sb)
 {
-    char *ca, *cb;
-    int retval;
     if (!sa && !sb) return 0;
     if (!sa) return -1;
     if (!sb) return 1;
@@ -1684,12 +1716,8 @@ xaccSplitCompareOtherAccountFullNames(const Split *sa, const Split *sb)
      * as long as they are the same
      */
 
-    ca = xaccSplitGetCorrAccountFullName(sa);
-    cb = xaccSplitGetCorrAccountFullName(sb);
-    retval = g_strcmp0(ca, cb);
-    g_free(ca);
-    g_free(cb);
-    return retval;
+    return g_strcmp0(get_corr_account_cached_full_name(sa),
+                     get_corr_account_cached_full_name(sb));
 }
 
 int
@@ -1717,6 +1745,7 @@ xaccSplitSetMemo (Split *split, const char *memo)
 {
     if (!split || !memo) return;
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
 
     CACHE_REPLACE(split->memo, memo);
     qof_instance_set_dirty(QOF_INSTANCE(split));
@@ -1736,6 +1765,7 @@ xaccSplitSetAction (Split *split, const char *actn)
 {
     if (!split || !actn) return;
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
 
     CACHE_REPLACE(split->action, actn);
     qof_instance_set_dirty(QOF_INSTANCE(split));
@@ -1769,6 +1799,7 @@ xaccSplitSetReconcile (Split *split, char recn)
 {
     if (!split || split->reconciled == recn) return;
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
 
     switch (recn)
     {
@@ -1795,9 +1826,9 @@ xaccSplitSetDateReconciledSecs (Split *split, time64 secs)
 {
     if (!split) return;
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
 
-    split->date_reconciled.tv_sec = secs;
-    split->date_reconciled.tv_nsec = 0;
+    split->date_reconciled = secs;
     qof_instance_set_dirty(QOF_INSTANCE(split));
     xaccTransCommitEdit(split->parent);
 
@@ -1808,8 +1839,9 @@ xaccSplitSetDateReconciledTS (Split *split, Timespec *ts)
 {
     if (!split || !ts) return;
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
 
-    split->date_reconciled = *ts;
+    split->date_reconciled = ts->tv_sec;
     qof_instance_set_dirty(QOF_INSTANCE(split));
     xaccTransCommitEdit(split->parent);
 
@@ -1819,21 +1851,21 @@ void
 xaccSplitGetDateReconciledTS (const Split * split, Timespec *ts)
 {
     if (!split || !ts) return;
-    *ts = (split->date_reconciled);
+    timespecFromTime64 (ts, split->date_reconciled);
 }
 
 Timespec
 xaccSplitRetDateReconciledTS (const Split * split)
 {
-    Timespec ts = {0, 0};
-    return split ? split->date_reconciled : ts;
+    Timespec ts = {split ? split->date_reconciled : 0, 0};
+    return ts;
 }
 
 /*################## Added for Reg2 #################*/
 time64
 xaccSplitGetDateReconciled (const Split * split)
 {
-    return split ? split->date_reconciled.tv_sec : 0;
+    return split ? split->date_reconciled : 0;
 }
 /*################## Added for Reg2 #################*/
 
@@ -1871,6 +1903,11 @@ xaccSplitSetParent(Split *s, Transaction *t)
         qof_event_gen(&old_trans->inst, GNC_EVENT_ITEM_REMOVED, &ed);
     }
     s->parent = t;
+    if (s->held_by)
+    {
+        gnc_account_set_desc_index_dirty(s->held_by);
+        gnc_account_set_online_id_index_dirty(s->held_by);
+    }
 
     xaccTransCommitEdit(old_trans);
     qof_instance_set_dirty(QOF_INSTANCE(s));
@@ -1901,6 +1938,7 @@ void
 xaccSplitSetLot(Split* split, GNCLot* lot)
 {
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
     split->lot = lot;
     qof_instance_set_dirty(QOF_INSTANCE(split));
     xaccTransCommitEdit(split->parent);
@@ -1989,13 +2027,10 @@ xaccSplitGetBook (const Split *split)
 const char *
 xaccSplitGetType(const Split *s)
 {
-    GValue v = G_VALUE_INIT;
-    const char *split_type = NULL;
+    const char *split_type;
 
     if (!s) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE (s), "split-type", &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-        split_type = g_value_get_string (&v);
+    split_type = qof_instance_get_kvp_string (QOF_INSTANCE (s), "split-type");
     return split_type ? split_type : "normal";
 }
 
@@ -2006,6 +2041,7 @@ xaccSplitMakeStockSplit(Split *s)
 {
     GValue v = G_VALUE_INIT;
     xaccTransBeginEdit (s->parent);
+    xaccTransJournalSplit (s);
 
     s->value = gnc_numeric_zero();
     g_value_init (&v, G_TYPE_STRING);
@@ -2028,6 +2064,7 @@ xaccSplitAddPeerSplit (Split *split, const Split *other_split,
 
     guid = qof_instance_get_guid (QOF_INSTANCE (other_split));
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
     qof_instance_kvp_add_guid (QOF_INSTANCE (split), "lot-split",
                                timespec_now(), "peer_guid", guid_copy(guid));
     mark_split (split);
@@ -2064,6 +2101,7 @@ xaccSplitRemovePeerSplit (Split *split, const Split *other_split)
 
     guid = qof_instance_get_guid (QOF_INSTANCE (other_split));
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
     qof_instance_kvp_remove_guid (QOF_INSTANCE (split), "lot-split",
                                   "peer_guid", guid);
     mark_split (split);
@@ -2075,6 +2113,7 @@ void
 xaccSplitMergePeerSplits (Split *split, const Split *other_split)
 {
     xaccTransBeginEdit (split->parent);
+    xaccTransJournalSplit (split);
     qof_instance_kvp_merge_guids (QOF_INSTANCE (split),
                                   QOF_INSTANCE (other_split), "lot-split");
     mark_split (split);
@@ -2144,25 +2183,19 @@ xaccSplitGetOtherSplit (const Split *split)
 gnc_numeric
 xaccSplitVoidFormerAmount(const Split *split)
 {
-    GValue v = G_VALUE_INIT;
-    gnc_numeric *num = NULL;
+    gnc_numeric num = gnc_numeric_zero();
     g_return_val_if_fail(split, gnc_numeric_zero());
-    qof_instance_get_kvp (QOF_INSTANCE (split), void_former_amt_str, &v);
-    if (G_VALUE_HOLDS_BOXED (&v))
-        num = (gnc_numeric*)g_value_get_boxed (&v);
-    return num ? *num : gnc_numeric_zero();
+    qof_instance_get_kvp_numeric (QOF_INSTANCE (split), void_former_amt_str, &num);
+    return num;
 }
 
 gnc_numeric
 xaccSplitVoidFormerValue(const Split *split)
 {
-    GValue v = G_VALUE_INIT;
-    gnc_numeric *num = NULL;
+    gnc_numeric num = gnc_numeric_zero();
     g_return_val_if_fail(split, gnc_numeric_zero());
-    qof_instance_get_kvp (QOF_INSTANCE (split), void_former_val_str, &v);
-    if (G_VALUE_HOLDS_BOXED (&v))
-        num = (gnc_numeric*)g_value_get_boxed (&v);
-    return num ? *num : gnc_numeric_zero();
+    qof_instance_get_kvp_numeric (QOF_INSTANCE (split), void_former_val_str, &num);
+    return num;
 }
 
 void
@@ -2171,6 +2204,7 @@ xaccSplitVoid(Split *split)
     gnc_numeric zero = gnc_numeric_zero(), num;
     GValue v = G_VALUE_INIT;
 
+    xaccTransJournalSplit (split);
     g_value_init (&v, GNC_TYPE_NUMERIC);
     num =  xaccSplitGetAmount(split);
     g_value_set_boxed (&v, &num);
@@ -2266,6 +2300,46 @@ qofSplitSetAccount(Split *s, QofInstance *ent)
     xaccSplitSetAccount(s, acc);
 }
 
+/* Queries for the splits in some accounts can start from the accounts'
+ * split lists instead of looking at every split in the book. */
+static void
+split_account_index (QofBook *book, const GncGUID *guid,
+                     QofInstanceForeachCB cb, gpointer user_data)
+{
+    Account *acc = xaccAccountLookup (guid, book);
+    GList *node;
+
+    if (!acc) return;
+    for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+        cb (node->data, user_data);
+}
+
+/* Reconciling only wants the splits that aren't reconciled yet, which
+ * the account keeps apart from the rest. */
+static const char unreconciled_states[] = { NREC, CREC, FREC, VREC, '\0' };
+
+static void
+split_account_unreconciled_index (QofBook *book, const GncGUID *guid,
+                                  QofInstanceForeachCB cb, gpointer user_data)
+{
+    Account *acc = xaccAccountLookup (guid, book);
+
+    if (!acc) return;
+    gnc_account_foreach_unreconciled_split (acc, (GFunc)cb, user_data);
+}
+
+/* A change to a transaction can change which queries its splits match. */
+static void
+split_trans_dependents (QofInstance *trans, QofInstanceForeachCB cb,
+                        gpointer user_data)
+{
+    GList *node;
+
+    for (node = xaccTransGetSplitList (GNC_TRANSACTION (trans)); node;
+         node = node->next)
+        cb (node->data, user_data);
+}
+
 gboolean xaccSplitRegister (void)
 {
     static const QofParam params[] =
@@ -2358,6 +2432,20 @@ gboolean xaccSplitRegister (void)
         };
 
     qof_class_register (GNC_ID_SPLIT, (QofSortFunc)xaccSplitOrder, params);
+    qof_query_register_guid_index (GNC_ID_SPLIT,
+                                   qof_query_build_param_list (SPLIT_ACCOUNT,
+                                                               QOF_PARAM_GUID,
+                                                               NULL),
+                                   split_account_index);
+    qof_query_register_guid_char_index (GNC_ID_SPLIT,
+                                        qof_query_build_param_list
+                                        (SPLIT_ACCOUNT, QOF_PARAM_GUID, NULL),
+                                        qof_query_build_param_list
+                                        (SPLIT_RECONCILE, NULL),
+                                        unreconciled_states,
+                                        split_account_unreconciled_index);
+    qof_query_register_dependents (GNC_ID_SPLIT, GNC_ID_TRANS,
+                                   split_trans_dependents);
     qof_class_register (SPLIT_ACCT_FULLNAME,
                         (QofSortFunc)xaccSplitCompareAccountFullNames, NULL);
     qof_class_register (SPLIT_CORR_ACCT_NAME,
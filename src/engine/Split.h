@@ -188,7 +188,8 @@ char          xaccSplitGetReconcile (const Split *split);
  * time as time64. */
 void          xaccSplitSetDateReconciledSecs (Split *split, time64 time);
 /** Set the date on which this split was reconciled by specifying the
- * time as Timespec.  Caller still owns *ts! */
+ * time as Timespec.  Caller still owns *ts!  The date is kept as a
+ * time64, so ts->tv_nsec is dropped. */
 void          xaccSplitSetDateReconciledTS (Split *split, Timespec *ts);
 /** Get the date on which this split was reconciled by having it
  * written into the Timespec that 'ts' is pointing to. */
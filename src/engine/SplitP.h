@@ -72,28 +72,21 @@ struct split_s
 {
     QofInstance inst;
 
+    /* The fields from here to held_by are the ones read by every balance
+     * scan, register load and query over an account's splits.  They are
+     * kept together at the front, next to inst, so that a scan touches
+     * as few cache lines of each split as it can; the fields used only
+     * when a split is edited, reconciled or scrubbed follow them.  Keep new fields out of this group unless they are read on
+     * those paths too. */
     Account *acc;              /* back-pointer to debited/credited account  */
-    Account *orig_acc;
-    GNCLot *lot;               /* back-pointer to debited/credited lot */
-
     Transaction *parent;       /* parent of split                           */
-    Transaction *orig_parent;
-
-    /* The memo field is an arbitrary user-assiged value.
-     * It is intended to hold a short (zero to forty character) string
-     * that is displayed by the GUI along with this split.
-     */
-    char  * memo;
 
-    /* The action field is an arbitrary user-assigned value.
-     * It is meant to be a very short (one to ten character) string that
-     * signifies the "type" of this split, such as e.g. Buy, Sell, Div,
-     * Withdraw, Deposit, ATM, Check, etc. The idea is that this field
-     * can be used to create custom reports or graphs of data.
-     */
-    char  * action;            /* Buy, Sell, Div, etc.                      */
+    /* 'value' is the quantity of the transaction balancing commodity
+     * (i.e. currency) involved, 'amount' is the amount of the account's
+     * commodity involved. */
+    gnc_numeric  value;
+    gnc_numeric  amount;
 
-    Timespec date_reconciled;  /* date split was reconciled                 */
     char    reconciled;        /* The reconciled field                      */
 
     /* gains is a flag used to track the relationship between
@@ -103,17 +96,13 @@ struct split_s
      */
     unsigned char  gains;
 
-    /* 'gains_split' is a convenience pointer used to track down the
-     * other end of a cap-gains transaction pair.  NULL if this split
-     * doesn't involve cap gains.
-     */
-    Split *gains_split;
+    /* The block of the account's balance index holding this split,
+     * NULL if the split isn't indexed. Owned by the account. */
+    struct account_balance_block *balance_block;
 
-    /* 'value' is the quantity of the transaction balancing commodity
-     * (i.e. currency) involved, 'amount' is the amount of the account's
-     * commodity involved. */
-    gnc_numeric  value;
-    gnc_numeric  amount;
+    /* The account whose split vector holds this split, NULL if none.
+     * Set by the account. */
+    Account *held_by;
 
     /* -------------------------------------------------------------- */
     /* Below follow some 'temporary' fields */
@@ -121,10 +110,40 @@ struct split_s
     /* The various "balances" are the sum of all of the values of
      * all the splits in the account, up to and including this split.
      * These balances apply to a sorting order by date posted
-     * (not by date entered). */
+     * (not by date entered).  They are written by the account's
+     * balance index. */
     gnc_numeric  balance;
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
+
+    /* -------------------------------------------------------------- */
+    /* Below follow the fields used only while editing */
+
+    Account *orig_acc;
+    Transaction *orig_parent;
+    GNCLot *lot;               /* back-pointer to debited/credited lot */
+
+    /* The memo field is an arbitrary user-assiged value.
+     * It is intended to hold a short (zero to forty character) string
+     * that is displayed by the GUI along with this split.
+     */
+    char  * memo;
+
+    /* The action field is an arbitrary user-assigned value.
+     * It is meant to be a very short (one to ten character) string that
+     * signifies the "type" of this split, such as e.g. Buy, Sell, Div,
+     * Withdraw, Deposit, ATM, Check, etc. The idea is that this field
+     * can be used to create custom reports or graphs of data.
+     */
+    char  * action;            /* Buy, Sell, Div, etc.                      */
+
+    time64 date_reconciled;    /* date split was reconciled                 */
+
+    /* 'gains_split' is a convenience pointer used to track down the
+     * other end of a cap-gains transaction pair.  NULL if this split
+     * doesn't involve cap gains.
+     */
+    Split *gains_split;
 };
 
 struct _SplitClass
@@ -202,24 +221,13 @@ void         DxaccSplitSetShareAmount (Split *split, double amount);
 \********************************************************************/
 
 
+/* The fields compared are time64s. */
 #define DATE_CMP(aaa,bbb,field) {                       \
   /* if dates differ, return */                         \
-  if ( (aaa->field.tv_sec) <                            \
-       (bbb->field.tv_sec)) {                           \
-    return -1;                                          \
-  } else                                                \
-  if ( (aaa->field.tv_sec) >                            \
-       (bbb->field.tv_sec)) {                           \
-    return +1;                                          \
-  }                                                     \
-                                                        \
-  /* else, seconds match. check nanoseconds */          \
-  if ( (aaa->field.tv_nsec) <                           \
-       (bbb->field.tv_nsec)) {                          \
+  if ( (aaa->field) < (bbb->field)) {                   \
     return -1;                                          \
   } else                                                \
-  if ( (aaa->field.tv_nsec) >                           \
-       (bbb->field.tv_nsec)) {                          \
+  if ( (aaa->field) > (bbb->field)) {                   \
     return +1;                                          \
   }                                                     \
 }
@@ -27,6 +27,12 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+#ifdef G_OS_WIN32
+# include <io.h>
+#endif
 
 #include "Account.h"
 #include "Transaction.h"
@@ -87,6 +93,16 @@ static FILE * trans_log = NULL; /**< current log file handle */
 static char * trans_log_name = NULL; /**< current log file name */
 static char * log_base_name = NULL;
 
+/* Inside xaccLogBeginGroup() and xaccLogEndGroup() the records are
+   flushed, and synced to disk, every LOG_GROUP_RECORDS records or
+   LOG_GROUP_SECONDS seconds instead of one by one. */
+#define LOG_GROUP_RECORDS 256
+#define LOG_GROUP_SECONDS 1
+static int log_group_level = 0;
+static int log_unflushed = 0; /**< records written since the last flush */
+static time64 log_flushed_time = 0;
+static GString * log_record = NULL; /**< buffer for formatting a record */
+
 /********************************************************************\
 \********************************************************************/
 
@@ -205,15 +221,46 @@ xaccOpenLog (void)
 /********************************************************************\
 \********************************************************************/
 
+/* Get the records written so far out to the disk. */
+static void
+log_flush (gboolean sync)
+{
+    fflush (trans_log);
+    if (sync)
+    {
+#ifdef G_OS_WIN32
+        _commit (_fileno (trans_log));
+#else
+        fsync (fileno (trans_log));
+#endif
+    }
+    log_unflushed = 0;
+    log_flushed_time = gnc_time (NULL);
+}
+
 void
 xaccCloseLog (void)
 {
     if (!trans_log) return;
-    fflush (trans_log);
+    log_flush (log_unflushed > 0 && log_group_level > 0);
     fclose (trans_log);
     trans_log = NULL;
 }
 
+void
+xaccLogBeginGroup (void)
+{
+    log_group_level++;
+}
+
+void
+xaccLogEndGroup (void)
+{
+    g_return_if_fail (log_group_level > 0);
+    if (--log_group_level == 0 && trans_log && log_unflushed > 0)
+        log_flush (TRUE);
+}
+
 /********************************************************************\
 \********************************************************************/
 
@@ -237,15 +284,19 @@ xaccTransWriteLog (Transaction *trans, char flag)
     timespecFromTime64(&ts, gnc_time (NULL));
     gnc_timespec_to_iso8601_buff (ts, dnow);
 
-    timespecFromTime64(&ts, trans->date_entered.tv_sec);
+    timespecFromTime64(&ts, trans->date_entered);
     gnc_timespec_to_iso8601_buff (ts, dent);
 
-    timespecFromTime64(&ts, trans->date_posted.tv_sec);
+    timespecFromTime64(&ts, trans->date_posted);
     gnc_timespec_to_iso8601_buff (ts, dpost);
 
     guid_to_string_buff (xaccTransGetGUID(trans), trans_guid_str);
     trans_notes = xaccTransGetNotes(trans);
-    fprintf (trans_log, "===== START\n");
+
+    /* The record is formatted in memory and written out in one go. */
+    if (!log_record)
+        log_record = g_string_sized_new (1024);
+    g_string_assign (log_record, "===== START\n");
 
     for (node = trans->splits; node; node = node->next)
     {
@@ -265,7 +316,7 @@ xaccTransWriteLog (Transaction *trans, char flag)
             acc_guid_str[0] = '\0';
         }
 
-        timespecFromTime64(&ts, split->date_reconciled.tv_sec);
+        timespecFromTime64(&ts, split->date_reconciled);
         gnc_timespec_to_iso8601_buff (ts, drecn);
 
         guid_to_string_buff (xaccSplitGetGUID(split), split_guid_str);
@@ -273,7 +324,7 @@ xaccTransWriteLog (Transaction *trans, char flag)
         val = xaccSplitGetValue (split);
 
         /* use tab-separated fields */
-        fprintf (trans_log,
+        g_string_append_printf (log_record,
                  "%c\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
                  "%s\t%s\t%s\t%s\t%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
                  flag,
@@ -299,10 +350,16 @@ xaccTransWriteLog (Transaction *trans, char flag)
                  drecn);
     }
 
-    fprintf (trans_log, "===== END\n");
+    g_string_append (log_record, "===== END\n");
+    fwrite (log_record->str, 1, log_record->len, trans_log);
 
     /* get data out to the disk */
-    fflush (trans_log);
+    log_unflushed++;
+    if (log_group_level == 0)
+        log_flush (FALSE);
+    else if (log_unflushed >= LOG_GROUP_RECORDS
+             || gnc_time (NULL) - log_flushed_time >= LOG_GROUP_SECONDS)
+        log_flush (TRUE);
 }
 
 /************************ END OF ************************************\
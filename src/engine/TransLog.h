@@ -65,6 +65,15 @@ void    xaccReopenLog (void);
  */
 void    xaccTransWriteLog (Transaction *trans, char flag);
 
+/** Between xaccLogBeginGroup() and the matching xaccLogEndGroup() the
+ *  log is flushed every few hundred records or once a second, instead of
+ *  after each record, and synced to disk when it is.  The last
+ *  xaccLogEndGroup() flushes and syncs whatever is left.  Use it around
+ *  bulk operations such as imports.  Calls may be nested.
+ */
+void    xaccLogBeginGroup (void);
+void    xaccLogEndGroup (void);
+
 /** document me */
 void    xaccLogEnable (void);
 
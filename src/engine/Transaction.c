@@ -53,6 +53,7 @@ struct timeval
 
 #include "AccountP.h"
 #include "Scrub.h"
+#include "ScrubP.h"
 #include "Scrub3.h"
 #include "TransactionP.h"
 #include "SplitP.h"
@@ -66,6 +67,7 @@ struct timeval
 #include "SchedXaction.h"
 #include "gncBusiness.h"
 #include <qofinstance-p.h>
+#include <qofbook-p.h>
 
 /* Notes about xaccTransBeginEdit(), xaccTransCommitEdit(), and
  *  xaccTransRollback():
@@ -197,6 +199,89 @@ const char *assoc_uri_str = "assoc_uri";
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_ENGINE;
 
+/* The scrubbing state is kept per thread, so that threads working on
+ * books of their own don't switch each other's scrubbing off or scrub
+ * each other's transactions. */
+typedef struct
+{
+    /* Set by xaccDisableDataScrubbing() and while a scrub runs. */
+    gboolean scrub_off;
+    /* Transactions committed between xaccTransBeginDeferredScrub() and
+     * xaccTransEndDeferredScrub(), waiting to be scrubbed. */
+    GHashTable *queue;
+    gint defer_depth;
+} ScrubState;
+
+static void
+scrub_state_free (gpointer data)
+{
+    ScrubState *state = data;
+
+    if (state->queue)
+        g_hash_table_destroy (state->queue);
+    g_free (state);
+}
+
+static ScrubState *
+scrub_state (void)
+{
+#ifndef HAVE_GLIB_2_32
+    static GStaticPrivate scrub_state_key = G_STATIC_PRIVATE_INIT;
+    ScrubState *state;
+
+    state = g_static_private_get (&scrub_state_key);
+    if (state == NULL)
+    {
+        state = g_new0 (ScrubState, 1);
+        g_static_private_set (&scrub_state_key, state, scrub_state_free);
+    }
+#else
+    static GPrivate scrub_state_key = G_PRIVATE_INIT (scrub_state_free);
+    ScrubState *state;
+
+    state = g_private_get (&scrub_state_key);
+    if (state == NULL)
+    {
+        state = g_new0 (ScrubState, 1);
+        g_private_set (&scrub_state_key, state);
+    }
+#endif
+    return state;
+}
+
+/* Edits begun between xaccTransBeginJournaledEdits() and
+ * xaccTransEndJournaledEdits() keep a journal instead of orig. */
+static gint journal_depth = 0;
+
+/* A split's fields from before its first change in the edit. */
+typedef struct
+{
+    Split *split;
+    char *memo;
+    char *action;
+    KvpFrame *kvp;
+    char reconciled;
+    time64 date_reconciled;
+    gnc_numeric amount;
+    gnc_numeric value;
+    GNCLot *lot;
+    Split *gains_split;
+} SplitJournal;
+
+struct trans_journal_s
+{
+    char *num;
+    char *description;
+    time64 date_entered;
+    time64 date_posted;
+    gnc_commodity *common_currency;
+    KvpFrame *kvp;
+    /* The splits the transaction had when the edit began are the first
+     * num_splits of its list; splits holds those that have changed. */
+    guint num_splits;
+    GArray *splits;
+};
+
 enum
 {
     PROP_0,
@@ -236,6 +321,76 @@ xaccTransStillHasSplit(const Transaction *trans, const Split *s)
         }                                                               \
     }
 
+#define INDEXED_SPLIT(trans, i)                                    \
+    ((i) < TRANS_INLINE_SPLITS ? (trans)->split_inline[i] :        \
+     (Split*) g_ptr_array_index ((trans)->split_overflow,          \
+                                 (i) - TRANS_INLINE_SPLITS))
+
+/* Return TRUE if the transaction's split index can be used, building
+ * it first if needed.  An open transaction may be changing its splits,
+ * so it has none and is walked instead. */
+static gboolean
+trans_split_index (const Transaction *trans)
+{
+    Transaction *t = (Transaction *) trans;
+    GList *node;
+    gint n = 0;
+
+    if (qof_instance_get_editlevel (trans) != 0)
+        return FALSE;
+    if (trans->n_indexed_splits >= 0)
+        return TRUE;
+
+    qof_book_cache_lock (qof_instance_get_book (trans));
+    if (trans->n_indexed_splits < 0)
+    {
+        if (t->split_overflow)
+            g_ptr_array_set_size (t->split_overflow, 0);
+        for (node = trans->splits; node; node = node->next)
+        {
+            Split *s = node->data;
+            if (!xaccTransStillHasSplit (trans, s)) continue;
+            if (n < TRANS_INLINE_SPLITS)
+                t->split_inline[n] = s;
+            else
+            {
+                if (!t->split_overflow)
+                    t->split_overflow = g_ptr_array_new ();
+                g_ptr_array_add (t->split_overflow, s);
+            }
+            n++;
+        }
+        t->n_indexed_splits = n;
+    }
+    qof_book_cache_unlock (qof_instance_get_book (trans));
+    return TRUE;
+}
+
+static inline void
+trans_split_index_dirty (Transaction *trans)
+{
+    trans->n_indexed_splits = -1;
+}
+
+/* Bumped by xaccTransForgetImbalances(); cached imbalances stamped with
+ * an older value are stale.  Editing a transaction drops its own. */
+static guint imbalance_generation = 1;
+
+void
+xaccTransForgetImbalances (void)
+{
+    imbalance_generation++;
+}
+
+/* The splits only change while the transaction is open, so anything
+ * cached while it is closed holds until the next edit. */
+static inline gboolean
+trans_imbalance_cached (const Transaction *trans, guint stamp)
+{
+    return stamp == imbalance_generation &&
+           qof_instance_get_editlevel (trans) == 0;
+}
+
 G_INLINE_FUNC void mark_trans (Transaction *trans);
 void mark_trans (Transaction *trans)
 {
@@ -276,15 +431,15 @@ gnc_transaction_init(Transaction* trans)
 
     trans->common_currency = NULL;
     trans->splits = NULL;
+    trans->split_overflow = NULL;
+    trans->n_indexed_splits = -1;
 
-    trans->date_entered.tv_sec  = 0;
-    trans->date_entered.tv_nsec = 0;
-
-    trans->date_posted.tv_sec  = 0;
-    trans->date_posted.tv_nsec = 0;
+    trans->date_entered = 0;
+    trans->date_posted = 0;
 
     trans->marker = 0;
     trans->orig = NULL;
+    trans->journal = NULL;
     LEAVE (" ");
 }
 
@@ -297,6 +452,10 @@ gnc_transaction_dispose(GObject *txnp)
 static void
 gnc_transaction_finalize(GObject* txnp)
 {
+    Transaction *trans = GNC_TRANSACTION(txnp);
+
+    if (trans->split_overflow)
+        g_ptr_array_free (trans->split_overflow, TRUE);
     G_OBJECT_CLASS(gnc_transaction_parent_class)->finalize(txnp);
 }
 
@@ -315,6 +474,7 @@ gnc_transaction_get_property(GObject* object,
     Transaction* tx;
     gchar *key;
     GValue *temp;
+    Timespec ts;
 
     g_return_if_fail(GNC_IS_TRANSACTION(object));
 
@@ -331,10 +491,12 @@ gnc_transaction_get_property(GObject* object,
         g_value_take_object(value, tx->common_currency);
         break;
     case PROP_POST_DATE:
-        g_value_set_boxed(value, &tx->date_posted);
+        timespecFromTime64(&ts, tx->date_posted);
+        g_value_set_boxed(value, &ts);
         break;
     case PROP_ENTER_DATE:
-        g_value_set_boxed(value, &tx->date_entered);
+        timespecFromTime64(&ts, tx->date_entered);
+        g_value_set_boxed(value, &ts);
         break;
     case PROP_INVOICE:
 	key = GNC_INVOICE_ID "/" GNC_INVOICE_GUID;
@@ -362,6 +524,7 @@ gnc_transaction_set_property(GObject* object,
 {
     Transaction* tx;
     gchar *key;
+    GList *node;
 
     g_return_if_fail(GNC_IS_TRANSACTION(object));
 
@@ -396,6 +559,12 @@ gnc_transaction_set_property(GObject* object,
     case PROP_ONLINE_ACCOUNT:
 	key = "online_id";
 	qof_instance_set_kvp (QOF_INSTANCE (tx), key, value);
+	for (node = tx->splits; node; node = node->next)
+	{
+	    Split *s = node->data;
+	    if (s->held_by)
+		gnc_account_set_online_id_index_dirty (s->held_by);
+	}
 	break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -538,8 +707,10 @@ xaccTransDump (const Transaction *trans, const char *tag)
     GList *node;
 
     printf("%s Trans %p", tag, trans);
-    printf("    Entered:     %s\n", gnc_print_date(trans->date_entered));
-    printf("    Posted:      %s\n", gnc_print_date(trans->date_posted));
+    printf("    Entered:     %s\n",
+           gnc_print_date(xaccTransRetDateEnteredTS(trans)));
+    printf("    Posted:      %s\n",
+           gnc_print_date(xaccTransRetDatePostedTS(trans)));
     printf("    Num:         %s\n", trans->num ? trans->num : "(null)");
     printf("    Description: %s\n",
            trans->description ? trans->description : "(null)");
@@ -591,11 +762,92 @@ xaccTransSortSplits (Transaction *trans)
     /* install newly sorted list */
     g_list_free(trans->splits);
     trans->splits = new_list;
+    trans_split_index_dirty (trans);
 }
 
 
 /********************************************************************\
 \********************************************************************/
+static TransJournal *
+trans_journal_new (const Transaction *trans)
+{
+    TransJournal *journal = g_slice_new0 (TransJournal);
+
+    journal->num = CACHE_INSERT (trans->num);
+    journal->description = CACHE_INSERT (trans->description);
+    journal->date_entered = trans->date_entered;
+    journal->date_posted = trans->date_posted;
+    journal->common_currency = trans->common_currency;
+    journal->kvp = qof_instance_save_kvp (QOF_INSTANCE (trans));
+    journal->num_splits = g_list_length (trans->splits);
+    return journal;
+}
+
+static void
+trans_journal_free (TransJournal *journal)
+{
+    guint i;
+
+    if (!journal) return;
+    CACHE_REMOVE (journal->num);
+    CACHE_REMOVE (journal->description);
+    qof_instance_free_saved_kvp (journal->kvp);
+    if (journal->splits)
+    {
+        for (i = 0; i < journal->splits->len; i++)
+        {
+            SplitJournal *entry = &g_array_index (journal->splits,
+                                                  SplitJournal, i);
+            CACHE_REMOVE (entry->memo);
+            CACHE_REMOVE (entry->action);
+            qof_instance_free_saved_kvp (entry->kvp);
+        }
+        g_array_free (journal->splits, TRUE);
+    }
+    g_slice_free (TransJournal, journal);
+}
+
+static SplitJournal *
+trans_journal_find_split (const TransJournal *journal, const Split *split)
+{
+    guint i;
+
+    if (!journal->splits) return NULL;
+    for (i = 0; i < journal->splits->len; i++)
+    {
+        SplitJournal *entry = &g_array_index (journal->splits, SplitJournal, i);
+        if (entry->split == split)
+            return entry;
+    }
+    return NULL;
+}
+
+void
+xaccTransJournalSplit (Split *split)
+{
+    TransJournal *journal;
+    SplitJournal entry;
+
+    /* A split new to the edit has no orig_parent and goes on rollback. */
+    if (!split || !split->orig_parent) return;
+    journal = split->orig_parent->journal;
+    if (!journal || trans_journal_find_split (journal, split)) return;
+
+    if (!journal->splits)
+        journal->splits = g_array_new (FALSE, FALSE, sizeof (SplitJournal));
+    entry.split = split;
+    entry.memo = CACHE_INSERT (split->memo);
+    entry.action = CACHE_INSERT (split->action);
+    entry.kvp = qof_instance_save_kvp (QOF_INSTANCE (split));
+    entry.reconciled = split->reconciled;
+    entry.date_reconciled = split->date_reconciled;
+    entry.amount = split->amount;
+    entry.value = split->value;
+    entry.lot = split->lot;
+    entry.gains_split = split->gains_split;
+    g_array_append_val (journal->splits, entry);
+}
+
 /* This routine is not exposed externally, since it does weird things,
  * like not really owning the splits correctly, and other weirdnesses.
  * This routine is prone to programmer snafu if not used correctly.
@@ -746,7 +998,6 @@ void
 xaccTransCopyFromClipBoard(const Transaction *from_trans, Transaction *to_trans,
                            const Account *from_acc, Account *to_acc, gboolean no_date)
 {
-    Timespec ts = {0,0};
     gboolean change_accounts = FALSE;
     GList *node;
 
@@ -769,8 +1020,7 @@ xaccTransCopyFromClipBoard(const Transaction *from_trans, Transaction *to_trans,
     xaccTransSetNotes(to_trans, xaccTransGetNotes(from_trans));
     if(!no_date)
     {
-        xaccTransGetDatePostedTS(from_trans, &ts);
-        xaccTransSetDatePostedTS(to_trans, &ts);
+        xaccTransSetDatePostedSecs(to_trans, xaccTransGetDate(from_trans));
     }
 
     /* Each new split will be parented to 'to' */
@@ -793,6 +1043,7 @@ xaccTransCopyFromClipBoard(const Transaction *from_trans, Transaction *to_trans,
 static void
 xaccFreeTransaction (Transaction *trans)
 {
+    ScrubState *scrub;
     GList *node;
 
     if (!trans) return;
@@ -805,11 +1056,16 @@ xaccFreeTransaction (Transaction *trans)
         return;
     }
 
+    scrub = scrub_state ();
+    if (scrub->queue)
+        g_hash_table_remove (scrub->queue, trans);
+
     /* free up the destination splits */
     for (node = trans->splits; node; node = node->next)
         xaccFreeSplit (node->data);
     g_list_free (trans->splits);
     trans->splits = NULL;
+    trans_split_index_dirty (trans);
 
     /* free up transaction strings */
     CACHE_REMOVE(trans->num);
@@ -819,16 +1075,16 @@ xaccFreeTransaction (Transaction *trans)
     trans->num         = (char *) 1;
     trans->description = NULL;
 
-    trans->date_entered.tv_sec = 0;
-    trans->date_entered.tv_nsec = 0;
-    trans->date_posted.tv_sec = 0;
-    trans->date_posted.tv_nsec = 0;
+    trans->date_entered = 0;
+    trans->date_posted = 0;
 
     if (trans->orig)
     {
         xaccFreeTransaction (trans->orig);
         trans->orig = NULL;
     }
+    trans_journal_free (trans->journal);
+    trans->journal = NULL;
 
     /* qof_instance_release (&trans->inst); */
     g_object_unref(trans);
@@ -897,24 +1153,24 @@ xaccTransEqual(const Transaction *ta, const Transaction *tb,
         return FALSE;
     }
 
-    if (timespec_cmp(&(ta->date_entered), &(tb->date_entered)))
+    if (ta->date_entered != tb->date_entered)
     {
         char buf1[100];
         char buf2[100];
 
-        (void)gnc_timespec_to_iso8601_buff(ta->date_entered, buf1);
-        (void)gnc_timespec_to_iso8601_buff(tb->date_entered, buf2);
+        (void)gnc_timespec_to_iso8601_buff(xaccTransRetDateEnteredTS(ta), buf1);
+        (void)gnc_timespec_to_iso8601_buff(xaccTransRetDateEnteredTS(tb), buf2);
         PINFO ("date entered differs: '%s' vs '%s'", buf1, buf2);
         return FALSE;
     }
 
-    if (timespec_cmp(&(ta->date_posted), &(tb->date_posted)))
+    if (ta->date_posted != tb->date_posted)
     {
         char buf1[100];
         char buf2[100];
 
-        (void)gnc_timespec_to_iso8601_buff(ta->date_posted, buf1);
-        (void)gnc_timespec_to_iso8601_buff(tb->date_posted, buf2);
+        (void)gnc_timespec_to_iso8601_buff(xaccTransRetDatePostedTS(ta), buf1);
+        (void)gnc_timespec_to_iso8601_buff(xaccTransRetDatePostedTS(tb), buf2);
         PINFO ("date posted differs: '%s' vs '%s'", buf1, buf2);
         return FALSE;
     }
@@ -1030,9 +1286,12 @@ gboolean xaccTransUseTradingAccounts(const Transaction *trans)
 Transaction *
 xaccTransLookup (const GncGUID *guid, QofBook *book)
 {
+    static gint type_id = -1;
     QofCollection *col;
     if (!guid || !book) return NULL;
-    col = qof_book_get_collection (book, GNC_ID_TRANS);
+    if (type_id < 0)
+        type_id = qof_object_get_type_id (GNC_ID_TRANS);
+    col = qof_book_get_collection_by_id (book, type_id);
     return (Transaction *) qof_collection_lookup_entity (col, guid);
 }
 
@@ -1043,14 +1302,31 @@ gnc_numeric
 xaccTransGetImbalanceValue (const Transaction * trans)
 {
     gnc_numeric imbal = gnc_numeric_zero();
+    gboolean cached;
     if (!trans) return imbal;
 
+    qof_book_cache_lock (qof_instance_get_book (trans));
+    cached = trans_imbalance_cached (trans, trans->imbalance_stamp);
+    if (cached)
+        imbal = trans->imbalance_value;
+    qof_book_cache_unlock (qof_instance_get_book (trans));
+    if (cached)
+        return imbal;
+
     ENTER("(trans=%p)", trans);
     /* Could use xaccSplitsComputeValue, except that we want to use
        GNC_HOW_DENOM_EXACT */
     FOR_EACH_SPLIT(trans, imbal =
                        gnc_numeric_add(imbal, xaccSplitGetValue(s),
                                        GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT));
+    if (qof_instance_get_editlevel (trans) == 0)
+    {
+        Transaction *t = (Transaction *)trans;
+        qof_book_cache_lock (qof_instance_get_book (trans));
+        t->imbalance_value = imbal;
+        t->imbalance_stamp = imbalance_generation;
+        qof_book_cache_unlock (qof_instance_get_book (trans));
+    }
     LEAVE("(trans=%p) imbal=%s", trans, gnc_num_dbg_to_string(imbal));
     return imbal;
 }
@@ -1127,17 +1403,15 @@ xaccTransGetImbalance (const Transaction * trans)
     return imbal_list;
 }
 
-gboolean
-xaccTransIsBalanced (const Transaction *trans)
+static gboolean
+trans_compute_is_balanced (const Transaction *trans, gboolean trading_accts)
 {
     MonetaryList *imbal_list;
     gboolean result;
     gnc_numeric imbal = gnc_numeric_zero();
     gnc_numeric imbal_trading = gnc_numeric_zero();
 
-    if (trans == NULL) return FALSE;
-
-    if (xaccTransUseTradingAccounts(trans))
+    if (trading_accts)
     {
         /* Transaction is imbalanced if the value is imbalanced in either
            trading or non-trading splits.  One can't be used to balance
@@ -1164,7 +1438,7 @@ xaccTransIsBalanced (const Transaction *trans)
     if (! gnc_numeric_zero_p(imbal) || ! gnc_numeric_zero_p(imbal_trading))
         return FALSE;
 
-    if (!xaccTransUseTradingAccounts (trans))
+    if (!trading_accts)
         return TRUE;
 
     imbal_list = xaccTransGetImbalance(trans);
@@ -1173,6 +1447,35 @@ xaccTransIsBalanced (const Transaction *trans)
     return result;
 }
 
+gboolean
+xaccTransIsBalanced (const Transaction *trans)
+{
+    gboolean trading_accts, result, cached;
+
+    if (trans == NULL) return FALSE;
+
+    trading_accts = xaccTransUseTradingAccounts (trans);
+    qof_book_cache_lock (qof_instance_get_book (trans));
+    cached = trans_imbalance_cached (trans, trans->is_balanced_stamp) &&
+             trans->is_balanced_trading == trading_accts;
+    result = trans->is_balanced;
+    qof_book_cache_unlock (qof_instance_get_book (trans));
+    if (cached)
+        return result;
+
+    result = trans_compute_is_balanced (trans, trading_accts);
+    if (qof_instance_get_editlevel (trans) == 0)
+    {
+        Transaction *t = (Transaction *)trans;
+        qof_book_cache_lock (qof_instance_get_book (trans));
+        t->is_balanced = result;
+        t->is_balanced_trading = trading_accts;
+        t->is_balanced_stamp = imbalance_generation;
+        qof_book_cache_unlock (qof_instance_get_book (trans));
+    }
+    return result;
+}
+
 gnc_numeric
 xaccTransGetAccountValue (const Transaction *trans,
                           const Account *acc)
@@ -1443,6 +1746,8 @@ void
 xaccTransBeginEdit (Transaction *trans)
 {
     if (!trans) return;
+    trans->imbalance_stamp = trans->is_balanced_stamp = 0;
+    trans_split_index_dirty (trans);
     if (!qof_begin_edit(&trans->inst)) return;
 
     if (qof_book_shutting_down(qof_instance_get_book(trans))) return;
@@ -1453,9 +1758,12 @@ xaccTransBeginEdit (Transaction *trans)
         xaccTransWriteLog (trans, 'B');
     }
 
-    /* Make a clone of the transaction; we will use this
-     * in case we need to roll-back the edit. */
-    trans->orig = dupe_trans (trans);
+    /* Make a clone of the transaction, or start its journal; we will
+     * use this in case we need to roll-back the edit. */
+    if (journal_depth > 0)
+        trans->journal = trans_journal_new (trans);
+    else
+        trans->orig = dupe_trans (trans);
 }
 
 /********************************************************************\
@@ -1545,14 +1853,79 @@ do_destroy (Transaction *trans)
 \********************************************************************/
 
 /* Temporary hack for data consistency */
-static int scrub_data = 1;
 void xaccEnableDataScrubbing(void)
 {
-    scrub_data = 1;
+    scrub_state ()->scrub_off = FALSE;
 }
 void xaccDisableDataScrubbing(void)
 {
-    scrub_data = 0;
+    scrub_state ()->scrub_off = TRUE;
+}
+
+void
+xaccTransBeginDeferredScrub (void)
+{
+    ++scrub_state ()->defer_depth;
+}
+
+static void
+scrub_queued_trans (ScrubState *scrub, Transaction *trans)
+{
+    gboolean saved_scrub_off = scrub->scrub_off;
+
+    if (qof_instance_get_destroying(trans) ||
+            qof_book_shutting_down(xaccTransGetBook(trans)))
+        return;
+
+    /* As in xaccTransCommitEdit, don't scrub the commits made by the
+     * scrub itself. */
+    scrub->scrub_off = TRUE;
+    xaccTransScrubImbalance (trans, NULL, NULL);
+    if (g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL)
+        xaccTransScrubGains (trans, NULL);
+    scrub->scrub_off = saved_scrub_off;
+}
+
+void
+xaccTransEndDeferredScrub (void)
+{
+    ScrubState *scrub = scrub_state ();
+    GList *queued, *node;
+
+    g_return_if_fail (scrub->defer_depth > 0);
+    if (--scrub->defer_depth > 0 || !scrub->queue)
+        return;
+
+    ENTER ("(%u queued)", g_hash_table_size (scrub->queue));
+    /* All of the queued transactions share the same few imbalance and
+     * trading accounts, so find each of them only once. */
+    xaccScrubBeginAccountCache ();
+    queued = g_hash_table_get_keys (scrub->queue);
+    for (node = queued; node; node = node->next)
+    {
+        /* Skip a transaction that has been freed since it was listed. */
+        if (g_hash_table_remove (scrub->queue, node->data))
+            scrub_queued_trans (scrub, node->data);
+    }
+    g_list_free (queued);
+    xaccScrubEndAccountCache ();
+
+    g_hash_table_destroy (scrub->queue);
+    scrub->queue = NULL;
+    LEAVE (" ");
+}
+
+void
+xaccTransBeginJournaledEdits (void)
+{
+    ++journal_depth;
+}
+
+void
+xaccTransEndJournaledEdits (void)
+{
+    g_return_if_fail (journal_depth > 0);
+    --journal_depth;
 }
 
 /* Check for an implicitly deleted transaction */
@@ -1583,6 +1956,8 @@ static void trans_cleanup_commit(Transaction *trans)
 {
     GList *slist, *node;
 
+    trans_split_index_dirty (trans);
+
     /* ------------------------------------------------- */
     /* Make sure all associated splits are in proper order
      * in their accounts with the correct balances. */
@@ -1625,6 +2000,8 @@ static void trans_cleanup_commit(Transaction *trans)
     PINFO ("get rid of rollback trans=%p", trans->orig);
     xaccFreeTransaction (trans->orig);
     trans->orig = NULL;
+    trans_journal_free (trans->journal);
+    trans->journal = NULL;
 
     /* Sort the splits. Why do we need to do this ?? */
     /* Good question.  Who knows?  */
@@ -1641,6 +2018,9 @@ static void trans_cleanup_commit(Transaction *trans)
 void
 xaccTransCommitEdit (Transaction *trans)
 {
+    ScrubState *scrub;
+    QofBook *book;
+
     if (!trans) return;
     ENTER ("(trans=%p)", trans);
 
@@ -1650,6 +2030,11 @@ xaccTransCommitEdit (Transaction *trans)
         return;
     }
 
+    /* The whole commit moves splits between accounts, so no snapshot
+     * may see it halfway through. */
+    book = xaccTransGetBook(trans);
+    qof_book_begin_write(book);
+
     /* We increment this for the duration of the call
      * so other functions don't result in a recursive
      * call to xaccTransCommitEdit. */
@@ -1667,11 +2052,21 @@ xaccTransCommitEdit (Transaction *trans)
      * can cause pointers to splits and transactions to disappear out
      * from under the holder.
      */
-    if (!qof_instance_get_destroying(trans) && scrub_data &&
+    scrub = scrub_state ();
+    if (!qof_instance_get_destroying(trans) && !scrub->scrub_off &&
+            !qof_book_shutting_down(xaccTransGetBook(trans)) &&
+            scrub->defer_depth > 0)
+    {
+        /* Leave it to xaccTransEndDeferredScrub. */
+        if (!scrub->queue)
+            scrub->queue = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (scrub->queue, trans, trans);
+    }
+    else if (!qof_instance_get_destroying(trans) && !scrub->scrub_off &&
             !qof_book_shutting_down(xaccTransGetBook(trans)))
     {
         /* If scrubbing gains recurses through here, don't call it again. */
-        scrub_data = 0;
+        scrub->scrub_off = TRUE;
         /* The total value of the transaction should sum to zero.
          * Call the trans scrub routine to fix it. Indirectly, this
          * routine also performs a number of other transaction fixes too.
@@ -1684,13 +2079,13 @@ xaccTransCommitEdit (Transaction *trans)
             xaccTransScrubGains (trans, NULL);
 
         /* Allow scrubbing in transaction commit again */
-        scrub_data = 1;
+        scrub->scrub_off = FALSE;
     }
 
     /* Record the time of last modification */
-    if (0 == trans->date_entered.tv_sec)
+    if (0 == trans->date_entered)
     {
-	trans->date_entered.tv_sec = gnc_time(NULL);
+	trans->date_entered = gnc_time(NULL);
         qof_instance_set_dirty(QOF_INSTANCE(trans));
     }
 
@@ -1699,45 +2094,45 @@ xaccTransCommitEdit (Transaction *trans)
                           trans_on_error,
                           (void (*) (QofInstance *)) trans_cleanup_commit,
                           (void (*) (QofInstance *)) do_destroy);
+    qof_book_end_write(book);
     LEAVE ("(trans=%p)", trans);
 }
 
 #define SWAP(a, b) do { gpointer tmp = (a); (a) = (b); (b) = tmp; } while (0);
 
-/* Ughhh. The Rollback function is terribly complex, and, what's worse,
- * it only rolls back the basics.  The TransCommit functions did a bunch
- * of Lot/Cap-gains scrubbing that don't get addressed/undone here, and
- * so the rollback can potentially leave a bit of a mess behind.  We
- * really need a more robust undo capability.  Part of the problem is
- * that the biggest user of the undo is the multi-user backend, which
- * also adds complexity.
- */
-void
-xaccTransRollbackEdit (Transaction *trans)
+/* Takes a split added during the edit back out of the transaction. */
+static void
+remove_added_split (Transaction *trans, Split *s)
+{
+    if (trans != xaccSplitGetParent(s))
+    {
+        trans->splits = g_list_remove(trans->splits, s);
+        /* New split added, but then moved to another
+           transaction */
+        return;
+    }
+    xaccSplitRollbackEdit(s);
+    trans->splits = g_list_remove(trans->splits, s);
+    g_assert(trans != xaccSplitGetParent(s));
+    /* NB: our memory management policy here is that a new split
+       added to the transaction which is then rolled-back still
+       belongs to the engine.  Specifically, it's freed by the
+       transaction to which it was added.  Don't add the Split to
+       more than one transaction during the begin/commit block! */
+    if (NULL == xaccSplitGetParent(s))
+    {
+        xaccFreeSplit(s);  // a newly malloc'd split
+    }
+}
+
+static void
+restore_from_orig (Transaction *trans)
 {
     GList *node, *onode;
-    QofBackend *be;
     Transaction *orig;
     GList *slist;
     int num_preexist, i;
 
-/* FIXME: This isn't quite the right way to handle nested edits --
- * there should be a stack of transaction states that are popped off
- * and restored at each level -- but it does prevent restoring to the
- * editlevel 0 state until one is returning to editlevel 0, and
- * thereby prevents a crash caused by trans->orig getting NULLed too
- * soon.
- */
-    if (!qof_instance_get_editlevel (QOF_INSTANCE (trans))) return;
-    if (qof_instance_get_editlevel (QOF_INSTANCE (trans)) > 1) {
-	 qof_instance_decrease_editlevel (QOF_INSTANCE (trans));
-	 return;
-    }
-
-    ENTER ("trans addr=%p\n", trans);
-
-    check_open(trans);
-
     /* copy the original values back in. */
 
     orig = trans->orig;
@@ -1747,6 +2142,8 @@ xaccTransRollbackEdit (Transaction *trans)
     trans->date_posted = orig->date_posted;
     SWAP(trans->common_currency, orig->common_currency);
     qof_instance_swap_kvp (QOF_INSTANCE (trans), QOF_INSTANCE (orig));
+    /* The restored dates may change the splits' order in their accounts */
+    mark_trans(trans);
 
     /* The splits at the front of trans->splits are exactly the same
        splits as in the original, but some of them may have changed, so
@@ -1779,36 +2176,110 @@ xaccTransRollbackEdit (Transaction *trans)
             s->gains_split = so->gains_split;
             //SET_GAINS_A_VDIRTY(s);
             s->date_reconciled = so->date_reconciled;
+            /* The restored amount must reach the account's balance index */
+            mark_split (s);
             qof_instance_mark_clean(QOF_INSTANCE(s));
             xaccFreeSplit(so);
         }
         else
         {
-            /* Potentially added splits */
-            if (trans != xaccSplitGetParent(s))
-            {
-                trans->splits = g_list_remove(trans->splits, s);
-                /* New split added, but then moved to another
-                   transaction */
-                continue;
-            }
-            xaccSplitRollbackEdit(s);
-            trans->splits = g_list_remove(trans->splits, s);
-            g_assert(trans != xaccSplitGetParent(s));
-            /* NB: our memory management policy here is that a new split
-               added to the transaction which is then rolled-back still
-               belongs to the engine.  Specifically, it's freed by the
-               transaction to which it was added.  Don't add the Split to
-               more than one transaction during the begin/commit block! */
-            if (NULL == xaccSplitGetParent(s))
-            {
-                xaccFreeSplit(s);  // a newly malloc'd split
-            }
+            remove_added_split (trans, s);
         }
     }
     g_list_free(slist);
     g_list_free(orig->splits);
     orig->splits = NULL;
+}
+
+/* As restore_from_orig(), from the journal. */
+static void
+restore_from_journal (Transaction *trans)
+{
+    TransJournal *journal = trans->journal;
+    GList *node, *slist;
+    guint i;
+
+    SWAP(trans->num, journal->num);
+    SWAP(trans->description, journal->description);
+    trans->date_entered = journal->date_entered;
+    trans->date_posted = journal->date_posted;
+    trans->common_currency = journal->common_currency;
+    qof_instance_restore_kvp (QOF_INSTANCE (trans), journal->kvp);
+    journal->kvp = NULL;
+    /* The restored dates may change the splits' order in their accounts */
+    mark_trans(trans);
+
+    slist = g_list_copy(trans->splits);
+    for (i = 0, node = slist; node; i++, node = node->next)
+    {
+        Split *s = node->data;
+        SplitJournal *entry;
+
+        if (!qof_instance_is_dirty(QOF_INSTANCE(s)))
+            continue;
+
+        if (i >= journal->num_splits)
+        {
+            remove_added_split (trans, s);
+            continue;
+        }
+
+        xaccSplitRollbackEdit(s);
+        entry = trans_journal_find_split (journal, s);
+        if (entry)
+        {
+            SWAP(s->action, entry->action);
+            SWAP(s->memo, entry->memo);
+            qof_instance_restore_kvp (QOF_INSTANCE (s), entry->kvp);
+            entry->kvp = NULL;
+            s->reconciled = entry->reconciled;
+            s->amount = entry->amount;
+            s->value = entry->value;
+            s->lot = entry->lot;
+            s->gains_split = entry->gains_split;
+            s->date_reconciled = entry->date_reconciled;
+        }
+        /* The restored amount must reach the account's balance index */
+        mark_split (s);
+        qof_instance_mark_clean(QOF_INSTANCE(s));
+    }
+    g_list_free(slist);
+}
+
+/* Ughhh. The Rollback function is terribly complex, and, what's worse,
+ * it only rolls back the basics.  The TransCommit functions did a bunch
+ * of Lot/Cap-gains scrubbing that don't get addressed/undone here, and
+ * so the rollback can potentially leave a bit of a mess behind.  We
+ * really need a more robust undo capability.  Part of the problem is
+ * that the biggest user of the undo is the multi-user backend, which
+ * also adds complexity.
+ */
+void
+xaccTransRollbackEdit (Transaction *trans)
+{
+    QofBackend *be;
+
+/* FIXME: This isn't quite the right way to handle nested edits --
+ * there should be a stack of transaction states that are popped off
+ * and restored at each level -- but it does prevent restoring to the
+ * editlevel 0 state until one is returning to editlevel 0, and
+ * thereby prevents a crash caused by trans->orig getting NULLed too
+ * soon.
+ */
+    if (!qof_instance_get_editlevel (QOF_INSTANCE (trans))) return;
+    if (qof_instance_get_editlevel (QOF_INSTANCE (trans)) > 1) {
+	 qof_instance_decrease_editlevel (QOF_INSTANCE (trans));
+	 return;
+    }
+
+    ENTER ("trans addr=%p\n", trans);
+
+    check_open(trans);
+
+    if (trans->journal)
+        restore_from_journal (trans);
+    else
+        restore_from_orig (trans);
 
     /* Now that the engine copy is back to its original version,
      * get the backend to fix it in the database */
@@ -1856,9 +2327,12 @@ xaccTransRollbackEdit (Transaction *trans)
         xaccTransWriteLog (trans, 'R');
 
     xaccFreeTransaction (trans->orig);
+    trans_journal_free (trans->journal);
 
     trans->orig = NULL;
+    trans->journal = NULL;
     qof_instance_set_destroying(trans, FALSE);
+    trans_split_index_dirty (trans);
 
     /* Put back to zero. */
     qof_instance_decrease_editlevel(trans);
@@ -1930,15 +2404,14 @@ xaccTransOrder_num_action (const Transaction *ta, const char *actna,
 \********************************************************************/
 
 static inline void
-xaccTransSetDateInternal(Transaction *trans, Timespec *dadate, Timespec val)
+xaccTransSetDateInternal(Transaction *trans, time64 *dadate, time64 val)
 {
     xaccTransBeginEdit(trans);
 
     {
-        time64 secs = (time64) val.tv_sec;
-        gchar *tstr = gnc_ctime (&secs);
-        PINFO ("addr=%p set date to %" G_GUINT64_FORMAT ".%09ld %s\n",
-               trans, val.tv_sec, val.tv_nsec, tstr ? tstr : "(null)");
+        gchar *tstr = gnc_ctime (&val);
+        PINFO ("addr=%p set date to %" G_GINT64_FORMAT " %s\n",
+               trans, val, tstr ? tstr : "(null)");
         g_free(tstr);
     }
 
@@ -1965,9 +2438,8 @@ set_gains_date_dirty (Transaction *trans)
 void
 xaccTransSetDatePostedSecs (Transaction *trans, time64 secs)
 {
-    Timespec ts = {secs, 0};
     if (!trans) return;
-    xaccTransSetDateInternal(trans, &trans->date_posted, ts);
+    xaccTransSetDateInternal(trans, &trans->date_posted, secs);
     set_gains_date_dirty (trans);
 }
 
@@ -1993,16 +2465,15 @@ xaccTransSetDatePostedGDate (Transaction *trans, GDate date)
     qof_instance_set_kvp (QOF_INSTANCE(trans), TRANS_DATE_POSTED, &v);
     /* mark dirty and commit handled by SetDateInternal */
     xaccTransSetDateInternal(trans, &trans->date_posted,
-                             gdate_to_timespec(date));
+                             gdate_to_timespec(date).tv_sec);
     set_gains_date_dirty (trans);
 }
 
 void
 xaccTransSetDateEnteredSecs (Transaction *trans, time64 secs)
 {
-    Timespec ts = {secs, 0};
     if (!trans) return;
-    xaccTransSetDateInternal(trans, &trans->date_entered, ts);
+    xaccTransSetDateInternal(trans, &trans->date_entered, secs);
 }
 
 static void
@@ -2011,7 +2482,7 @@ qofTransSetDatePosted (Transaction *trans, Timespec ts)
     if (!trans) return;
     if ((ts.tv_nsec == 0) && (ts.tv_sec == 0)) return;
     if (!qof_begin_edit(&trans->inst)) return;
-    xaccTransSetDateInternal(trans, &trans->date_posted, ts);
+    xaccTransSetDateInternal(trans, &trans->date_posted, ts.tv_sec);
     set_gains_date_dirty(trans);
     qof_commit_edit(&trans->inst);
 }
@@ -2020,7 +2491,7 @@ void
 xaccTransSetDatePostedTS (Transaction *trans, const Timespec *ts)
 {
     if (!trans || !ts) return;
-    xaccTransSetDateInternal(trans, &trans->date_posted, *ts);
+    xaccTransSetDateInternal(trans, &trans->date_posted, ts->tv_sec);
     set_gains_date_dirty (trans);
 }
 
@@ -2030,7 +2501,7 @@ qofTransSetDateEntered (Transaction *trans, Timespec ts)
     if (!trans) return;
     if ((ts.tv_nsec == 0) && (ts.tv_sec == 0)) return;
     if (!qof_begin_edit(&trans->inst)) return;
-    xaccTransSetDateInternal(trans, &trans->date_entered, ts);
+    xaccTransSetDateInternal(trans, &trans->date_entered, ts.tv_sec);
     qof_commit_edit(&trans->inst);
 }
 
@@ -2038,7 +2509,7 @@ void
 xaccTransSetDateEnteredTS (Transaction *trans, const Timespec *ts)
 {
     if (!trans || !ts) return;
-    xaccTransSetDateInternal(trans, &trans->date_entered, *ts);
+    xaccTransSetDateInternal(trans, &trans->date_entered, ts->tv_sec);
 }
 
 void
@@ -2146,6 +2617,10 @@ xaccTransSetDescription (Transaction *trans, const char *desc)
     xaccTransBeginEdit(trans);
 
     CACHE_REPLACE(trans->description, desc);
+    /* The description breaks ties in the order kept by the lots. */
+    FOR_EACH_SPLIT(trans, if (s->lot) gnc_lot_set_closed_unknown(s->lot));
+    FOR_EACH_SPLIT(trans, if (s->held_by)
+                   gnc_account_set_desc_index_dirty(s->held_by));
     qof_instance_set_dirty(QOF_INSTANCE(trans));
     xaccTransCommitEdit(trans);
 }
@@ -2214,6 +2689,8 @@ xaccTransGetSplit (const Transaction *trans, int i)
     int j = 0;
     if (!trans || i < 0) return NULL;
 
+    if (trans_split_index (trans))
+        return i < trans->n_indexed_splits ? INDEXED_SPLIT (trans, i) : NULL;
     FOR_EACH_SPLIT(trans, { if (i == j) return s; j++; });
     return NULL;
 }
@@ -2224,6 +2701,13 @@ xaccTransGetSplitIndex(const Transaction *trans, const Split *split)
     int j = 0;
     g_return_val_if_fail(trans && split, -1);
 
+    if (trans_split_index (trans))
+    {
+        for (j = 0; j < trans->n_indexed_splits; j++)
+            if (INDEXED_SPLIT (trans, j) == split)
+                return j;
+        return -1;
+    }
     FOR_EACH_SPLIT(trans, { if (s == split) return j; j++; });
     return -1;
 }
@@ -2260,6 +2744,9 @@ int
 xaccTransCountSplits (const Transaction *trans)
 {
     gint i = 0;
+    if (!trans) return 0;
+    if (trans_split_index (trans))
+        return trans->n_indexed_splits;
     FOR_EACH_SPLIT(trans, i++);
     return i;
 }
@@ -2279,34 +2766,25 @@ xaccTransGetDescription (const Transaction *trans)
 const char *
 xaccTransGetAssociation (const Transaction *trans)
 {
-    GValue v = G_VALUE_INIT;
     if (!trans) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE (trans), assoc_uri_str, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         return g_value_get_string (&v);
-    return NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE (trans), assoc_uri_str);
 }
 
 const char *
 xaccTransGetNotes (const Transaction *trans)
 {
-    GValue v = G_VALUE_INIT;
     if (!trans) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE (trans), trans_notes_str, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         return g_value_get_string (&v);
-    return NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE (trans), trans_notes_str);
 }
 
 gboolean
 xaccTransGetIsClosingTxn (const Transaction *trans)
 {
-    GValue v = G_VALUE_INIT;
+    gint64 is_closing = 0;
     if (!trans) return FALSE;
-    qof_instance_get_kvp (QOF_INSTANCE (trans), trans_is_closing_str, &v);
-    if (G_VALUE_HOLDS_INT64 (&v))
-         return g_value_get_int64 (&v);
-    return FALSE;
+    qof_instance_get_kvp_int64 (QOF_INSTANCE (trans), trans_is_closing_str,
+                                &is_closing);
+    return is_closing != 0;
 }
 
 /********************************************************************\
@@ -2315,14 +2793,14 @@ xaccTransGetIsClosingTxn (const Transaction *trans)
 time64
 xaccTransGetDate (const Transaction *trans)
 {
-    return trans ? trans->date_posted.tv_sec : 0;
+    return trans ? trans->date_posted : 0;
 }
 
 /*################## Added for Reg2 #################*/
 time64
 xaccTransGetDateEntered (const Transaction *trans)
 {
-    return trans ? trans->date_entered.tv_sec : 0;
+    return trans ? trans->date_entered : 0;
 }
 /*################## Added for Reg2 #################*/
 
@@ -2330,21 +2808,21 @@ void
 xaccTransGetDatePostedTS (const Transaction *trans, Timespec *ts)
 {
     if (trans && ts)
-        *ts = trans->date_posted;
+        timespecFromTime64 (ts, trans->date_posted);
 }
 
 void
 xaccTransGetDateEnteredTS (const Transaction *trans, Timespec *ts)
 {
     if (trans && ts)
-        *ts = trans->date_entered;
+        timespecFromTime64 (ts, trans->date_entered);
 }
 
 Timespec
 xaccTransRetDatePostedTS (const Transaction *trans)
 {
-    Timespec ts = {0, 0};
-    return trans ? trans->date_posted : ts;
+    Timespec ts = {trans ? trans->date_posted : 0, 0};
+    return ts;
 }
 
 GDate
@@ -2370,8 +2848,8 @@ xaccTransGetDatePostedGDate (const Transaction *trans)
 Timespec
 xaccTransRetDateEnteredTS (const Transaction *trans)
 {
-    Timespec ts = {0, 0};
-    return trans ? trans->date_entered : ts;
+    Timespec ts = {trans ? trans->date_entered : 0, 0};
+    return ts;
 }
 
 void
@@ -2398,13 +2876,10 @@ xaccTransRetDateDueTS (const Transaction *trans)
 char
 xaccTransGetTxnType (const Transaction *trans)
 {
-    const char *s = NULL;
-    GValue v = G_VALUE_INIT;
+    const char *s;
 
     if (!trans) return TXN_TYPE_NONE;
-    qof_instance_get_kvp (QOF_INSTANCE (trans), TRANS_TXN_TYPE_KVP, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         s = g_value_get_string (&v);
+    s = qof_instance_get_kvp_string (QOF_INSTANCE (trans), TRANS_TXN_TYPE_KVP);
     if (s && strlen (s) == 1)
 	return *s;
 
@@ -2417,12 +2892,10 @@ xaccTransGetReadOnly (const Transaction *trans)
     /* XXX This flag should be cached in the transaction structure
      * for performance reasons, since its checked every trans commit.
      */
-    GValue v = G_VALUE_INIT;
-    const char *s = NULL;
+    const char *s;
     if (trans == NULL) return NULL;
-    qof_instance_get_kvp (QOF_INSTANCE(trans), TRANS_READ_ONLY_REASON, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         s = g_value_get_string (&v);
+    s = qof_instance_get_kvp_string (QOF_INSTANCE(trans),
+                                     TRANS_READ_ONLY_REASON);
     if (s && strlen (s))
 	return s;
 
@@ -2500,7 +2973,7 @@ gboolean xaccTransInFutureByPostedDate (const Transaction *trans)
 
     present = gnc_time64_get_today_end ();
 
-    if (trans->date_posted.tv_sec > present)
+    if (trans->date_posted > present)
         result = TRUE;
     else
         result = FALSE;
@@ -2640,42 +3113,66 @@ xaccTransVoid(Transaction *trans, const char *reason)
     xaccTransCommitEdit(trans);
 }
 
+/* The bulk operations below hold back the events, the log and the
+ * scrubs of the transactions they change until all of them are done. */
+static void
+trans_begin_many (void)
+{
+    qof_event_begin_batch ();
+    xaccLogBeginGroup ();
+    xaccTransBeginDeferredScrub ();
+    xaccTransBeginJournaledEdits ();
+}
+
+static void
+trans_end_many (void)
+{
+    xaccTransEndJournaledEdits ();
+    xaccTransEndDeferredScrub ();
+    xaccLogEndGroup ();
+    qof_event_end_batch ();
+}
+
+void
+xaccTransVoidMany (TransList *transactions, const char *reason)
+{
+    TransList *node;
+
+    g_return_if_fail (reason);
+
+    trans_begin_many ();
+    for (node = transactions; node; node = node->next)
+        if (node->data)
+            xaccTransVoid (node->data, reason);
+    trans_end_many ();
+}
+
 gboolean
 xaccTransGetVoidStatus(const Transaction *trans)
 {
-    const char *s = NULL;
-    GValue v = G_VALUE_INIT;
+    const char *s;
     g_return_val_if_fail(trans, FALSE);
 
-    qof_instance_get_kvp (QOF_INSTANCE (trans), void_reason_str, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         s = g_value_get_string (&v);
+    s = qof_instance_get_kvp_string (QOF_INSTANCE (trans), void_reason_str);
     return s && strlen(s);
 }
 
 const char *
 xaccTransGetVoidReason(const Transaction *trans)
 {
-    GValue v = G_VALUE_INIT;
     g_return_val_if_fail(trans, FALSE);
 
-    qof_instance_get_kvp (QOF_INSTANCE (trans), void_reason_str, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-         return g_value_get_string (&v);
-    return NULL;
+    return qof_instance_get_kvp_string (QOF_INSTANCE (trans), void_reason_str);
 }
 
 Timespec
 xaccTransGetVoidTime(const Transaction *tr)
 {
-    GValue v = G_VALUE_INIT;
-    const char *s = NULL;
-    Timespec void_time = {0, 0}, *ts;
+    const char *s;
+    Timespec void_time = {0, 0};
 
     g_return_val_if_fail(tr, void_time);
-    qof_instance_get_kvp (QOF_INSTANCE (tr), void_time_str, &v);
-    if (G_VALUE_HOLDS_STRING (&v))
-        s = g_value_get_string (&v);
+    s = qof_instance_get_kvp_string (QOF_INSTANCE (tr), void_time_str);
     if (s)
 	return gnc_iso8601_to_timespec_gmt (s);
     return void_time;
@@ -2739,15 +3236,28 @@ xaccTransReverse (Transaction *orig)
     return trans;
 }
 
+TransList *
+xaccTransReverseMany (TransList *transactions)
+{
+    TransList *node, *reversed = NULL;
+
+    trans_begin_many ();
+    for (node = transactions; node; node = node->next)
+        if (node->data)
+            reversed = g_list_prepend (reversed, xaccTransReverse (node->data));
+    trans_end_many ();
+
+    return g_list_reverse (reversed);
+}
+
 Transaction *
 xaccTransGetReversedBy(const Transaction *trans)
 {
-    GValue v = G_VALUE_INIT;
+    const GncGUID *guid;
     g_return_val_if_fail(trans, NULL);
-    qof_instance_get_kvp (QOF_INSTANCE(trans), TRANS_REVERSED_BY, &v);
-    if (G_VALUE_HOLDS_BOXED (&v))
-        return xaccTransLookup((GncGUID*)g_value_get_boxed (&v),
-                               qof_instance_get_book(trans));
+    guid = qof_instance_get_kvp_guid (QOF_INSTANCE(trans), TRANS_REVERSED_BY);
+    if (guid)
+        return xaccTransLookup(guid, qof_instance_get_book(trans));
     return NULL;
 }
 
@@ -2785,7 +3295,6 @@ static void
 xaccTransScrubGainsDate (Transaction *trans)
 {
     SplitList *node;
-    Timespec ts = {0, 0};
 //restart_search:
     for (node = trans->splits; node; node = node->next)
     {
@@ -2800,11 +3309,10 @@ xaccTransScrubGainsDate (Transaction *trans)
              (s->gains & GAINS_STATUS_DATE_DIRTY)))
         {
             Transaction *source_trans = s->gains_split->parent;
-            ts = source_trans->date_posted;
             s->gains &= ~GAINS_STATUS_DATE_DIRTY;
             s->gains_split->gains &= ~GAINS_STATUS_DATE_DIRTY;
 
-            xaccTransSetDatePostedTS(trans, &ts);
+            xaccTransSetDatePostedSecs(trans, source_trans->date_posted);
             FOR_EACH_SPLIT(trans, s->gains &= ~GAINS_STATUS_DATE_DIRTY);
             //goto restart_search;
         }
@@ -2817,6 +3325,7 @@ void
 xaccTransScrubGains (Transaction *trans, Account *gain_acc)
 {
     SplitList *node;
+    GList *lots = NULL;
 
     ENTER("(trans=%p)", trans);
     /* Lock down posted date, its to be synced to the posted date
@@ -2844,13 +3353,22 @@ restart:
         }
     }
 
-    /* Fix up gains split value */
+    /* Fix up gains split value.  The gains are recomputed a lot at a
+     * time, once for each lot a dirty split belongs to: a new value of
+     * a lot's opening split changes the gains of every split that the
+     * lot closes, and xaccSplitComputeCapGains() alone would leave those
+     * stale.  The lots of clean splits aren't touched. */
     FOR_EACH_SPLIT(trans,
-                   if ((s->gains & GAINS_STATUS_VDIRTY) ||
-                       (s->gains_split &&
-                        (s->gains_split->gains & GAINS_STATUS_VDIRTY)))
-                       xaccSplitComputeCapGains(s, gain_acc);
+                   if (s->lot &&
+                       ((s->gains & GAINS_STATUS_VDIRTY) ||
+                        (s->gains_split &&
+                         (s->gains_split->gains & GAINS_STATUS_VDIRTY))) &&
+                       !g_list_find (lots, s->lot))
+                       lots = g_list_prepend (lots, s->lot);
         );
+    for (node = lots; node; node = node->next)
+        xaccLotComputeCapGains (node->data, gain_acc);
+    g_list_free (lots);
 
     LEAVE("(trans=%p)", trans);
 }
@@ -2872,8 +3390,21 @@ static void
 destroy_tx_on_book_close(QofInstance *ent, gpointer data)
 {
     Transaction* tx = GNC_TRANSACTION(ent);
+    GList *node, *next;
 
-    xaccTransDestroy(tx);
+    /* The accounts and the lots are torn down without looking at their
+     * splits, so nothing needs to be told: free the transaction and the
+     * splits it owns directly instead of destroying them through an edit,
+     * which would take each split out of its account one at a time. */
+    for (node = tx->splits; node; node = next)
+    {
+        Split *s = node->data;
+
+        next = node->next;
+        if (s->parent != tx)
+            tx->splits = g_list_delete_link (tx->splits, node);
+    }
+    xaccFreeTransaction(tx);
 }
 
 /** Handles book end - frees all transactions from the book
@@ -3003,6 +3534,7 @@ gboolean xaccTransRegister (void)
         };
 
     qof_class_register (GNC_ID_TRANS, (QofSortFunc)xaccTransOrder, params);
+    qof_query_register_string_index (GNC_ID_TRANS, TRANS_NUM);
 
     return qof_object_register (&trans_object_def);
 }
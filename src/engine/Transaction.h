@@ -274,6 +274,30 @@ Split * xaccTransFindSplitByAccount(const Transaction *trans,
  */
 void xaccTransScrubGains (Transaction *trans, Account *gain_acc);
 
+/** Between xaccTransBeginDeferredScrub() and the matching
+ *  xaccTransEndDeferredScrub(), xaccTransCommitEdit() queues the
+ *  transaction instead of scrubbing it.  The last
+ *  xaccTransEndDeferredScrub() scrubs each queued transaction once,
+ *  looking up the imbalance and trading accounts only once for the
+ *  whole batch.  Use it around bulk operations such as imports and
+ *  scheduled transaction creation.  Calls may be nested.
+ */
+void xaccTransBeginDeferredScrub (void);
+void xaccTransEndDeferredScrub (void);
+
+/** Between xaccTransBeginJournaledEdits() and the matching
+ *  xaccTransEndJournaledEdits(), xaccTransBeginEdit() doesn't copy the
+ *  transaction and all of its splits for xaccTransRollbackEdit().  It
+ *  keeps only the transaction's own fields; a split's fields are kept
+ *  when it is first changed, and splits added during the edit need
+ *  nothing.  The rollback is the same, as long as the splits are
+ *  changed through the Split API.  Use it around bulk operations that
+ *  edit many transactions and seldom roll one back.  Calls may be
+ *  nested.
+ */
+void xaccTransBeginJournaledEdits (void);
+void xaccTransEndJournaledEdits (void);
+
 
 /** \warning XXX FIXME
  * gnc_book_count_transactions is a utility function,
@@ -604,7 +628,8 @@ void          xaccTransSetDatePostedSecs (Transaction *trans, time64 time);
 void          xaccTransSetDatePostedSecsNormalized (Transaction *trans, time64 time);
 
 /**  The xaccTransSetDatePostedTS() method does the same thing as
-     xaccTransSetDatePostedSecs(), but takes a struct timespec64. */
+     xaccTransSetDatePostedSecs(), but takes a struct timespec64.
+     The dates are kept as time64, so ts->tv_nsec is dropped. */
 void          xaccTransSetDatePostedTS (Transaction *trans,
                                         const Timespec *ts);
 
@@ -612,7 +637,8 @@ void          xaccTransSetDatePostedTS (Transaction *trans,
  * date is the date when the register entry was made. */
 void          xaccTransSetDateEnteredSecs (Transaction *trans, time64 time);
 /** Modify the date of when the transaction was entered. The entered
- * date is the date when the register entry was made. */
+ * date is the date when the register entry was made.  ts->tv_nsec is
+ * dropped. */
 void          xaccTransSetDateEnteredTS (Transaction *trans,
         const Timespec *ts);
 
@@ -622,7 +648,8 @@ void	      xaccTransSetDateDueTS (Transaction *trans, const Timespec *ts);
 /** Retrieve the posted date of the transaction. The posted date is
     the date when this transaction was posted at the bank. (Although
     having different function names, GetDate and GetDatePosted refer
-    to the same single date.)*/
+    to the same single date.)  Prefer it to the Timespec getters below,
+    which convert the time64 the transaction keeps.*/
 time64        xaccTransGetDate (const Transaction *trans);
 /** Retrieve the posted date of the transaction. The posted date is
     the date when this transaction was posted at the bank. (Although
@@ -678,6 +705,19 @@ void	      xaccTransGetDateDueTS (const Transaction *trans, Timespec *ts);
 void xaccTransVoid(Transaction *transaction,
                    const char *reason);
 
+/** xaccTransVoidMany voids each transaction in the list as
+ *  xaccTransVoid would, for rolling back a batch of transactions such
+ *  as a bad import.  The whole run is one event batch and one
+ *  transaction log group, and the transactions are scrubbed together
+ *  at the end.  Read-only transactions are left alone, as
+ *  xaccTransVoid leaves them.
+ *
+ *  @param transactions The transactions to void.
+ *
+ *  @param reason The textual reason why they are being voided.
+ */
+void xaccTransVoidMany(TransList *transactions, const char *reason);
+
 /** xaccTransUnvoid restores a voided transaction to its original
  *  state.  At some point when gnucash is enhanced to support an audit
  *  trail (i.e. write only transactions) this command should be
@@ -700,6 +740,17 @@ void xaccTransUnvoid(Transaction *transaction);
  */
 Transaction * xaccTransReverse(Transaction *transaction);
 
+/** xaccTransReverseMany reverses each transaction in the list as
+ *  xaccTransReverse would, in one event batch and transaction log
+ *  group like xaccTransVoidMany.
+ *
+ *  @param transactions The transactions to reverse.
+ *
+ *  @return the new transactions, in the order given.  Free the list
+ *  with g_list_free, not the transactions.
+ */
+TransList * xaccTransReverseMany(TransList *transactions);
+
 /** Returns the transaction that reversed the given transaction.
  *
  *  @param trans a Transaction that has been reversed
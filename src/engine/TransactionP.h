@@ -71,12 +71,19 @@
  * A "split" is more commonly referred to as an "entry" in a "transaction".
  */
 
+/* What xaccTransRollbackEdit() needs of an edit begun while edits are
+ * journaled; see xaccTransBeginJournaledEdits(). */
+typedef struct trans_journal_s TransJournal;
+
+/* Nearly every transaction has four splits or fewer. */
+#define TRANS_INLINE_SPLITS 4
+
 struct transaction_s
 {
     QofInstance inst;     /* glbally unique id */
 
-    Timespec date_entered;     /* date register entry was made              */
-    Timespec date_posted;      /* date transaction was posted at bank       */
+    time64 date_entered;       /* date register entry was made              */
+    time64 date_posted;        /* date transaction was posted at bank       */
 
     /* The num field is a arbitrary user-assigned field.
      * It is intended to store a short id number, typically the check number,
@@ -97,6 +104,16 @@ struct transaction_s
 
     GList * splits; /* list of splits */
 
+    /* The splits of 'splits' the transaction still has, in order, for
+     * xaccTransGetSplit(), xaccTransGetSplitIndex() and
+     * xaccTransCountSplits().  The first TRANS_INLINE_SPLITS are held
+     * in split_inline and the rest in split_overflow.  n_indexed_splits
+     * is -1 until the index is built; it is only kept while the
+     * transaction isn't open for editing. */
+    Split *split_inline[TRANS_INLINE_SPLITS];
+    GPtrArray *split_overflow;
+    gint n_indexed_splits;
+
     /* marker is used to track the progress of transaction traversals.
      * 0 is never a legitimate marker value, so we can tell is we hit
      * a new transaction in the middle of a traversal. All each new
@@ -110,6 +127,18 @@ struct transaction_s
      * any changes made if/when the edit is abandoned.
      */
     Transaction *orig;
+
+    /* Used instead of orig for journaled edits. */
+    TransJournal *journal;
+
+    /* The imbalance and balanced state, cached while the transaction
+     * isn't open for editing and the stamps are current; see
+     * xaccTransGetImbalanceValue() and xaccTransIsBalanced(). */
+    gnc_numeric imbalance_value;
+    guint imbalance_stamp;
+    gboolean is_balanced;
+    gboolean is_balanced_trading; /* the trading accounts setting used */
+    guint is_balanced_stamp;
 };
 
 struct _TransactionClass
@@ -164,6 +193,16 @@ QofBackend * xaccTransactionGetBackend (Transaction *trans);
 void xaccEnableDataScrubbing(void);
 void xaccDisableDataScrubbing(void);
 
+/* Make the imbalances cached in every transaction stale, for changes
+ * they depend on that don't happen inside a transaction edit, such as
+ * an account's type or commodity. */
+void xaccTransForgetImbalances (void);
+
+/* Records the split's fields in the journal of the transaction it was
+ * in when that transaction's edit began, if the edit is journaled and
+ * the split isn't recorded yet.  Call it before changing the split. */
+void xaccTransJournalSplit (Split *split);
+
 void xaccTransRemoveSplit (Transaction *trans, const Split *split);
 void check_open (const Transaction *trans);
 
@@ -76,6 +76,7 @@ GLIST_HELPER_INOUT(GncInvoiceList, SWIGTYPE_p__gncInvoice);
 GLIST_HELPER_INOUT(EntryList, SWIGTYPE_p__gncEntry);
 GLIST_HELPER_INOUT(GncTaxTableEntryList, SWIGTYPE_p__gncTaxTableEntry);
 GLIST_HELPER_INOUT(OwnerList, SWIGTYPE_p__gncOwner);
+GLIST_HELPER_INOUT(GncAgingOwnerList, SWIGTYPE_p__gncAgingOwner);
 
 #if defined(SWIGGUILE)
 %typemap(in) GncAccountValue * "$1 = gnc_scm_to_account_value_ptr($input);"
@@ -113,6 +114,7 @@ GLIST_HELPER_INOUT(OwnerList, SWIGTYPE_p__gncOwner);
 
 /* Parse the header files to generate wrappers */
 %include <gncAddress.h>
+%include <gncAging.h>
 %include <gncBillTerm.h>
 %include <gncBusiness.h>
 %include <gncCustomer.h>
@@ -102,89 +102,15 @@ xaccAccountHasTrades (const Account *acc)
 
 /* ============================================================== */
 
-struct find_lot_s
-{
-    GNCLot *lot;
-    gnc_commodity *currency;
-    Timespec ts;
-    int (*numeric_pred)(gnc_numeric);
-    gboolean (*date_pred)(Timespec e, Timespec tr);
-};
-
-static gboolean
-earliest_pred (Timespec earl, Timespec tran)
-{
-    return ((earl.tv_sec > tran.tv_sec)  ||
-            ((earl.tv_sec == tran.tv_sec) && (earl.tv_nsec > tran.tv_nsec)));
-}
-
-static gboolean
-latest_pred (Timespec earl, Timespec tran)
-{
-    return ((earl.tv_sec < tran.tv_sec)  ||
-            ((earl.tv_sec == tran.tv_sec) && (earl.tv_nsec < tran.tv_nsec)));
-}
-
-static gpointer
-finder_helper (GNCLot *lot,  gpointer user_data)
-{
-    struct find_lot_s *els = user_data;
-    Split *s;
-    Transaction *trans;
-    gnc_numeric bal;
-    gboolean opening_is_positive, bal_is_positive;
-
-    if (gnc_lot_is_closed (lot)) return NULL;
-
-    s = gnc_lot_get_earliest_split (lot);
-    if (s == NULL) return NULL;
-
-    /* We want a lot whose balance is of the correct sign.  All splits
-       in a lot must be the opposite sign of the opening split.  We also
-       want to ignore lots that are overfull, i.e., where the balance in
-       the lot is of opposite sign to the opening split in the lot. */
-    if (0 == (els->numeric_pred) (s->amount)) return NULL;
-    bal = gnc_lot_get_balance (lot);
-    opening_is_positive = gnc_numeric_positive_p (s->amount);
-    bal_is_positive = gnc_numeric_positive_p (bal);
-    if (opening_is_positive != bal_is_positive) return NULL;
-
-    trans = s->parent;
-    if (els->currency &&
-            (FALSE == gnc_commodity_equiv (els->currency,
-                                           trans->common_currency)))
-    {
-        return NULL;
-    }
-
-    if (els->date_pred (els->ts, trans->date_posted))
-    {
-        els->ts = trans->date_posted;
-        els->lot = lot;
-    }
-
-    return NULL;
-}
-
+/* The open lots are kept in an index by the account, see
+ * gnc_account_find_open_lot(). */
 static inline GNCLot *
 xaccAccountFindOpenLot (Account *acc, gnc_numeric sign,
-                        gnc_commodity *currency,
-                        gint64 guess,
-                        gboolean (*date_pred)(Timespec, Timespec))
+                        gnc_commodity *currency, gboolean latest)
 {
-    struct find_lot_s es;
-
-    es.lot = NULL;
-    es.currency = currency;
-    es.ts.tv_sec = guess;
-    es.ts.tv_nsec = 0;
-    es.date_pred = date_pred;
-
-    if (gnc_numeric_positive_p(sign)) es.numeric_pred = gnc_numeric_negative_p;
-    else es.numeric_pred = gnc_numeric_positive_p;
-
-    xaccAccountForEachLot (acc, finder_helper, &es);
-    return es.lot;
+    /* A positive split goes into a lot opened by a negative one. */
+    return gnc_account_find_open_lot (acc, !gnc_numeric_positive_p (sign),
+                                      currency, latest);
 }
 
 GNCLot *
@@ -195,8 +121,7 @@ xaccAccountFindEarliestOpenLot (Account *acc, gnc_numeric sign,
     ENTER (" sign=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, sign.num,
            sign.denom);
 
-    lot = xaccAccountFindOpenLot (acc, sign, currency,
-                                  G_MAXINT64, earliest_pred);
+    lot = xaccAccountFindOpenLot (acc, sign, currency, FALSE);
     LEAVE ("found lot=%p %s baln=%s", lot, gnc_lot_get_title (lot),
            gnc_num_dbg_to_string(gnc_lot_get_balance(lot)));
     return lot;
@@ -210,8 +135,7 @@ xaccAccountFindLatestOpenLot (Account *acc, gnc_numeric sign,
     ENTER (" sign=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
            sign.num, sign.denom);
 
-    lot = xaccAccountFindOpenLot (acc, sign, currency,
-                                  G_MININT64, latest_pred);
+    lot = xaccAccountFindOpenLot (acc, sign, currency, TRUE);
     LEAVE ("found lot=%p %s", lot, gnc_lot_get_title (lot));
     return lot;
 }
@@ -326,9 +250,7 @@ xaccSplitAssignToLot (Split *split, GNCLot *lot)
         Split * new_split;
         gnc_numeric amt_a, amt_b, amt_tot;
         gnc_numeric val_a, val_b, val_tot;
-        gnc_numeric frac;
         Transaction *trans;
-        Timespec ts;
 
         acc = split->acc;
         xaccAccountBeginEdit (acc);
@@ -349,11 +271,9 @@ xaccSplitAssignToLot (Split *split, GNCLot *lot)
          * i.e. so that (amt_a / amt_tot) = (val_a / val_tot)
          */
         val_tot = split->value;
-        frac = gnc_numeric_div (amt_a, amt_tot,
-                                GNC_DENOM_AUTO, GNC_HOW_DENOM_REDUCE);
-        val_a = gnc_numeric_mul (frac, val_tot,
-                                 gnc_numeric_denom(val_tot),
-                                 GNC_HOW_RND_ROUND_HALF_UP | GNC_HOW_DENOM_EXACT);
+        val_a = gnc_numeric_mul_div (val_tot, amt_a, amt_tot,
+                                     gnc_numeric_denom(val_tot),
+                                     GNC_HOW_RND_ROUND_HALF_UP | GNC_HOW_DENOM_EXACT);
 
         val_b = gnc_numeric_sub_fixed (val_tot, val_a);
         if (gnc_numeric_check(val_a))
@@ -398,8 +318,8 @@ xaccSplitAssignToLot (Split *split, GNCLot *lot)
          * split-action which is the same as xaccSplitGetAction */
         gnc_set_num_action(NULL, new_split, NULL, gnc_get_num_action(NULL, split));
         xaccSplitSetReconcile (new_split, xaccSplitGetReconcile (split));
-        ts = xaccSplitRetDateReconciledTS (split);
-        xaccSplitSetDateReconciledTS (new_split, &ts);
+        xaccSplitSetDateReconciledSecs (new_split,
+                                        xaccSplitGetDateReconciled (split));
 
         /* Set the lot-split and peer_guid properties on the two
          * splits to indicate that they're linked. 
@@ -533,7 +453,6 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
     gnc_commodity *currency = NULL;
     gnc_numeric zero = gnc_numeric_zero();
     gnc_numeric value = zero;
-    gnc_numeric frac;
     gnc_numeric opening_amount, opening_value;
     gnc_numeric lot_amount, lot_value;
     gnc_commodity *opening_currency;
@@ -720,14 +639,11 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
      * cost_basis = purchase_price * current_split_amount
      * cap_gain = current_split_value - cost_basis
      */
-    /* Fraction of the lot that this split represents: */
-    frac = gnc_numeric_div (split->amount, lot_amount,
-                            GNC_DENOM_AUTO,
-                            GNC_HOW_DENOM_REDUCE);
-    /* Basis for this split: */
-    value = gnc_numeric_mul (frac, lot_value,
-                             gnc_numeric_denom(opening_value),
-                             GNC_HOW_DENOM_EXACT | GNC_HOW_RND_ROUND_HALF_UP);
+    /* Basis for this split, the fraction of the lot it represents
+     * times the lot's value: */
+    value = gnc_numeric_mul_div (lot_value, split->amount, lot_amount,
+                                 gnc_numeric_denom(opening_value),
+                                 GNC_HOW_DENOM_EXACT | GNC_HOW_RND_ROUND_HALF_UP);
     /* Capital gain for this split: */
     value = gnc_numeric_sub (value, split->value,
                              GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
@@ -762,7 +678,6 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
     {
         Transaction *trans;
         Split *lot_split, *gain_split;
-        Timespec ts;
         gboolean new_gain_split;
         gnc_numeric negvalue = gnc_numeric_neg (value);
 
@@ -869,8 +784,7 @@ xaccSplitComputeCapGains(Split *split, Account *gain_acc)
         if (new_gain_split)
         {
             /* Common to both */
-            ts = xaccTransRetDatePostedTS (split->parent);
-            xaccTransSetDatePostedTS (trans, &ts);
+            xaccTransSetDatePostedSecs (trans, xaccTransGetDate (split->parent));
             xaccTransSetDateEnteredSecs (trans, gnc_time (NULL));
 
             xaccSplitSetAmount (lot_split, zero);
@@ -931,6 +845,25 @@ xaccSplitGetCapGains(Split * split)
 
 /* ============================================================== */
 
+/* Whether xaccSplitComputeCapGains() could find anything to do for
+ * split once the lot's opening splits are no longer dirty; see the
+ * test there.  Splits that record gains stand for their source split. */
+static gboolean
+split_gains_dirty (Split *split)
+{
+    xaccSplitDetermineGainStatus (split);
+    if (GAINS_STATUS_GAINS & split->gains)
+    {
+        /* Let xaccSplitComputeCapGains() recover a bad pointer. */
+        if (!split->gains_split) return TRUE;
+        split = split->gains_split;
+        xaccSplitDetermineGainStatus (split);
+    }
+    return (split->gains & GAINS_STATUS_A_VDIRTY) ||
+           !split->gains_split ||
+           (split->gains_split->gains & GAINS_STATUS_A_VDIRTY);
+}
+
 void
 xaccLotComputeCapGains (GNCLot *lot, Account *gain_acc)
 {
@@ -968,10 +901,14 @@ xaccLotComputeCapGains (GNCLot *lot, Account *gain_acc)
         }
     }
 
+    /* Only the splits whose gains are dirty, or whose opening splits
+     * changed, have anything to recompute; skipping the rest here saves
+     * each of them another walk through the lot. */
     for (node = gnc_lot_get_split_list(lot); node; node = node->next)
     {
         Split *s = node->data;
-        xaccSplitComputeCapGains (s, gain_acc);
+        if (split_gains_dirty (s))
+            xaccSplitComputeCapGains (s, gain_acc);
     }
     LEAVE("(lot=%p)", lot);
 }
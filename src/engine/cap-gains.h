@@ -199,7 +199,9 @@ Split * xaccSplitAssignToLot (Split *split, GNCLot *lot);
  *  less than the opening amount, the gains are pro-rated.
  *
  *  The xaccLotComputeCapGains() routine merely invokes the above on
- *    each split in the lot.
+ *    each split in the lot whose gains may have changed: those that
+ *    are dirty themselves, or all of them if an opening split's value
+ *    changed.
  */
 
 void xaccSplitComputeCapGains(Split *split, Account *gain_acc);
@@ -59,4 +59,11 @@ gnc_commodity * gnc_scm_to_commodity(SCM scm);
 SCM gnc_commodity_to_scm (const gnc_commodity *commodity);
 SCM gnc_book_to_scm (const QofBook *book);
 
+/* The balances of root and its descendants at each of the timepairs in
+ * dates, as a vector with one (account . #(balance ...)) pair per row of
+ * xaccAccountTreeGetBalanceMatrix. */
+SCM gnc_account_tree_get_balance_matrix (Account *root, SCM dates,
+        gnc_commodity *report_commodity,
+        gboolean include_children);
+
 #endif
@@ -2141,3 +2141,48 @@ gnc_book_to_scm (const QofBook *book)
 {
     return gnc_generic_to_scm(book, "_p_QofBook");
 }
+
+SCM
+gnc_account_tree_get_balance_matrix (Account *root, SCM dates,
+                                     gnc_commodity *report_commodity,
+                                     gboolean include_children)
+{
+    GList *accounts, *node;
+    gnc_numeric *matrix;
+    time64 *times;
+    guint n_dates, n_rows, i, j;
+    SCM result;
+
+    if (!root || !scm_is_true (scm_list_p (dates)))
+        return SCM_BOOL_F;
+
+    n_dates = scm_to_uint (scm_length (dates));
+    times = g_new (time64, n_dates);
+    for (i = 0; i < n_dates; i++, dates = SCM_CDR (dates))
+        times[i] = gnc_timepair2timespec (SCM_CAR (dates)).tv_sec;
+
+    matrix = xaccAccountTreeGetBalanceMatrix (root, times, n_dates,
+             report_commodity,
+             include_children);
+
+    accounts = g_list_prepend (gnc_account_get_descendants (root), root);
+    n_rows = g_list_length (accounts);
+    result = scm_c_make_vector (n_rows, SCM_BOOL_F);
+    for (node = accounts, i = 0; node; node = node->next, i++)
+    {
+        SCM row = scm_c_make_vector (n_dates, SCM_BOOL_F);
+
+        for (j = 0; j < n_dates; j++)
+            scm_c_vector_set_x (row, j,
+                                gnc_numeric_to_scm (matrix[i * n_dates + j]));
+        scm_c_vector_set_x (result, i,
+                            scm_cons (gnc_generic_to_scm (node->data,
+                                      "_p_Account"),
+                                      row));
+    }
+
+    g_list_free (accounts);
+    g_free (matrix);
+    g_free (times);
+    return result;
+}
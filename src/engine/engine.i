@@ -48,6 +48,7 @@
 #include "gncJob.h"
 #include "gncOrder.h"
 #include "gncOwner.h"
+#include "gncAging.h"
 #include "gncTaxTable.h"
 #include "gncVendor.h"
 #include "gncBusGuile.h"
@@ -87,6 +88,20 @@ static const GncGUID * gncBudgetGetGUID(GncBudget *x)
 { return qof_instance_get_guid(QOF_INSTANCE(x)); }
 %}
 
+/* xaccAccountGetPostDateRange for guile: the earliest and latest post
+ * dates as a pair, or #f if there are no splits. */
+%inline %{
+static SCM xaccAccountGetPostDateRangeSCM(const Account *acc,
+                                          gboolean include_children)
+{
+    time64 first, last;
+
+    if (!xaccAccountGetPostDateRange (acc, include_children, &first, &last))
+        return SCM_BOOL_F;
+    return scm_cons (scm_from_int64 (first), scm_from_int64 (last));
+}
+%}
+
 /* NB: The object ownership annotations should already cover all the
 functions currently used in guile, but not all the functions that are
 wrapped.  So, we should contract the interface to wrap only the used
@@ -103,6 +118,7 @@ functions. */
 
 %newobject xaccQueryGetSplitsUniqueTrans;
 %newobject xaccQueryGetTransactions;
+%newobject xaccTransReverseMany;
 %newobject xaccQueryGetLots;
 
 %newobject xaccSplitGetCorrAccountFullName;
@@ -199,7 +215,25 @@ SplitList * qof_query_run_subquery (QofQuery *q, const QofQuery *q);
 %ignore GNC_ERROR_OVERFLOW;
 %ignore GNC_ERROR_DENOM_DIFF;
 %ignore GNC_ERROR_REMAINDER;
+
+/* gnc-numeric-sum-array takes a list of numbers in place of the array. */
+%typemap(in) (const gnc_numeric *values, size_t n_values) {
+  SCM list = $input;
+  long len = scm_ilength (list);
+  size_t i = 0;
+
+  $2 = len > 0 ? len : 0;   /* not a proper list: sum nothing */
+  $1 = g_new (gnc_numeric, $2);
+  while (!scm_is_null (list) && i < $2)
+  {
+    $1[i++] = gnc_scm_to_numeric (SCM_CAR (list));
+    list = SCM_CDR (list);
+  }
+}
+%typemap(freearg) (const gnc_numeric *values, size_t n_values) "g_free ($1);"
+
 %include <gnc-numeric.h>
+%clear (const gnc_numeric *values, size_t n_values);
 
 Timespec timespecCanonicalDayTime(Timespec t);
 
@@ -72,8 +72,18 @@ typedef struct BudgetPrivate
 
     /* Number of periods */
     guint  num_periods;
+
+    /* The account amounts read from the KVP so far, by account GUID */
+    GHashTable *acct_hash;
 } BudgetPrivate;
 
+/* The amounts of one account for each period, copied from the KVP */
+typedef struct
+{
+    gnc_numeric value;
+    gboolean is_set;
+} BudgetPeriodValue;
+
 #define GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE((o), GNC_TYPE_BUDGET, BudgetPrivate))
 
@@ -96,6 +106,9 @@ gnc_budget_init(GncBudget* budget)
     priv->description = CACHE_INSERT("");
 
     priv->num_periods = 12;
+    priv->acct_hash = g_hash_table_new_full (guid_hash_to_guint,
+                      guid_g_hash_table_equal,
+                      (GDestroyNotify) guid_free, g_free);
     gnc_gdate_set_today (&date);
     g_date_subtract_days(&date, g_date_get_day(&date) - 1);
     recurrenceSet(&priv->recurrence, 1, PERIOD_MONTH, &date, WEEKEND_ADJ_NONE);
@@ -264,6 +277,7 @@ gnc_budget_free(QofInstance *inst)
 
     CACHE_REMOVE(priv->name);
     CACHE_REMOVE(priv->description);
+    g_hash_table_destroy (priv->acct_hash);
 
     /* qof_instance_release (&budget->inst); */
     g_object_unref(budget);
@@ -460,6 +474,7 @@ gnc_budget_set_num_periods(GncBudget* budget, guint num_periods)
 
     gnc_budget_begin_edit(budget);
     priv->num_periods = num_periods;
+    g_hash_table_remove_all (priv->acct_hash);
     qof_instance_set_dirty(&budget->inst);
     gnc_budget_commit_edit(budget);
 
@@ -485,6 +500,79 @@ make_period_path (const Account *account, guint period_num, char *path)
     bufend = guid_to_string_buff(guid, path);
     g_sprintf(bufend, "/%d", period_num);
 }
+
+typedef struct
+{
+    BudgetPeriodValue *values;
+    guint num_periods;
+} ReadPeriodValues;
+
+static void
+read_period_value (const char *key, const GValue *value, gpointer data)
+{
+    ReadPeriodValues *info = data;
+    guint64 period_num;
+    char *end;
+
+    /* Values of periods past num_periods are left over from before it
+     * was reduced, and are looked up in the KVP directly. */
+    period_num = g_ascii_strtoull (key, &end, 10);
+    if (*end || end == key || period_num >= info->num_periods)
+        return;
+
+    if (G_VALUE_HOLDS (value, GNC_TYPE_NUMERIC) && g_value_get_boxed (value))
+    {
+        info->values[period_num].value =
+            *(gnc_numeric*)g_value_get_boxed (value);
+        info->values[period_num].is_set = TRUE;
+    }
+}
+
+/* Return the account's values for each of the budget's periods,
+ * reading the account's frame of the KVP the first time. */
+static BudgetPeriodValue *
+get_account_values (const GncBudget *budget, const Account *account)
+{
+    BudgetPrivate *priv = GET_PRIVATE(budget);
+    const GncGUID *guid = xaccAccountGetGUID(account);
+    ReadPeriodValues info;
+    gchar guidstr[GUID_ENCODING_LENGTH+1];
+
+    info.values = g_hash_table_lookup (priv->acct_hash, guid);
+    if (info.values)
+        return info.values;
+
+    info.values = g_new0 (BudgetPeriodValue, priv->num_periods);
+    info.num_periods = priv->num_periods;
+    guid_to_string_buff (guid, guidstr);
+    qof_instance_foreach_slot (QOF_INSTANCE (budget), guidstr,
+                               read_period_value, &info);
+
+    g_hash_table_insert (priv->acct_hash, guid_copy (guid), info.values);
+    return info.values;
+}
+
+/* Keep the account's values, if they have been read, in step with
+ * the KVP. */
+static void
+update_account_value (GncBudget *budget, const Account *account,
+                      guint period_num, const gnc_numeric *val)
+{
+    BudgetPrivate *priv = GET_PRIVATE(budget);
+    BudgetPeriodValue *values;
+
+    if (period_num >= priv->num_periods)
+        return;
+
+    values = g_hash_table_lookup (priv->acct_hash,
+                                  xaccAccountGetGUID(account));
+    if (!values)
+        return;
+
+    values[period_num].is_set = (val != NULL);
+    values[period_num].value = val ? *val : gnc_numeric_zero();
+}
+
 /* period_num is zero-based */
 /* What happens when account is deleted, after we have an entry for it? */
 void
@@ -499,6 +587,7 @@ gnc_budget_unset_account_period_value(GncBudget *budget, const Account *account,
 
     gnc_budget_begin_edit(budget);
     qof_instance_set_kvp (QOF_INSTANCE (budget), path, NULL);
+    update_account_value (budget, account, period_num, NULL);
     qof_instance_set_dirty(&budget->inst);
     gnc_budget_commit_edit(budget);
 
@@ -529,13 +618,17 @@ gnc_budget_set_account_period_value(GncBudget *budget, const Account *account,
 
     gnc_budget_begin_edit(budget);
     if (gnc_numeric_check(val))
+    {
         qof_instance_set_kvp (QOF_INSTANCE (budget), path, NULL);
+        update_account_value (budget, account, period_num, NULL);
+    }
     else
     {
         GValue v = G_VALUE_INIT;
         g_value_init (&v, GNC_TYPE_NUMERIC);
         g_value_set_boxed (&v, &val);
         qof_instance_set_kvp (QOF_INSTANCE (budget), path, &v);
+        update_account_value (budget, account, period_num, &val);
     }
     qof_instance_set_dirty(&budget->inst);
     gnc_budget_commit_edit(budget);
@@ -559,6 +652,9 @@ gnc_budget_is_account_period_value_set(const GncBudget *budget,
     g_return_val_if_fail(GNC_IS_BUDGET(budget), FALSE);
     g_return_val_if_fail(account, FALSE);
 
+    if (period_num < GET_PRIVATE(budget)->num_periods)
+        return get_account_values (budget, account)[period_num].is_set;
+
     make_period_path (account, period_num, path);
     qof_instance_get_kvp (QOF_INSTANCE (budget), path, &v);
     if (G_VALUE_HOLDS_BOXED (&v))
@@ -578,6 +674,13 @@ gnc_budget_get_account_period_value(const GncBudget *budget,
     g_return_val_if_fail(GNC_IS_BUDGET(budget), gnc_numeric_zero());
     g_return_val_if_fail(account, gnc_numeric_zero());
 
+    if (period_num < GET_PRIVATE(budget)->num_periods)
+    {
+        BudgetPeriodValue *values = get_account_values (budget, account);
+        return values[period_num].is_set ? values[period_num].value :
+               gnc_numeric_zero();
+    }
+
     make_period_path (account, period_num, path);
     qof_instance_get_kvp (QOF_INSTANCE (budget), path, &v);
     if (G_VALUE_HOLDS_BOXED (&v))
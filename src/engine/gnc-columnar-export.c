@@ -0,0 +1,442 @@
+/********************************************************************\
+ * gnc-columnar-export.c -- write a book as typed columns           *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Account.h"
+#include "Split.h"
+#include "Transaction.h"
+#include "gnc-commodity.h"
+#include "gnc-engine.h"
+#include "gnc-lot.h"
+#include "gnc-pricedb.h"
+#include "gnc-columnar-export.h"
+
+static QofLogModule log_module = GNC_MOD_ENGINE;
+
+static const guchar columnar_magic[8] = { 'G', 'N', 'C', 'C', 'O', 'L', 0, 1 };
+
+typedef struct
+{
+    const char *name;
+    GncColumnType type;
+} ColumnDef;
+
+/* The table being written: each column's values for the rows of the
+ * current group, and the column the next value goes to. */
+typedef struct
+{
+    FILE *fh;
+    gboolean failed;
+    guint group_rows;
+
+    const ColumnDef *defs;
+    guint n_columns;
+    GByteArray **columns;
+    guint column;
+    guint rows;
+} ColumnarWriter;
+
+static void
+write_bytes (ColumnarWriter *w, gconstpointer data, gsize len)
+{
+    if (w->failed || len == 0)
+        return;
+    if (fwrite (data, 1, len, w->fh) != len)
+        w->failed = TRUE;
+}
+
+static void
+write_u32 (ColumnarWriter *w, guint32 val)
+{
+    val = GUINT32_TO_LE (val);
+    write_bytes (w, &val, sizeof (val));
+}
+
+static void
+write_u64 (ColumnarWriter *w, guint64 val)
+{
+    val = GUINT64_TO_LE (val);
+    write_bytes (w, &val, sizeof (val));
+}
+
+static void
+write_name (ColumnarWriter *w, const char *name)
+{
+    gsize len = strlen (name);
+    write_u32 (w, len);
+    write_bytes (w, name, len);
+}
+
+static void
+flush_group (ColumnarWriter *w)
+{
+    guint i;
+
+    if (w->rows == 0)
+        return;
+    write_u32 (w, w->rows);
+    for (i = 0; i < w->n_columns; i++)
+    {
+        GByteArray *col = w->columns[i];
+        write_u64 (w, col->len);
+        write_bytes (w, col->data, col->len);
+        g_byte_array_set_size (col, 0);
+    }
+    w->rows = 0;
+}
+
+static void
+begin_table (ColumnarWriter *w, const char *name, const ColumnDef *defs,
+             guint n_columns)
+{
+    guint i;
+
+    w->defs = defs;
+    w->n_columns = n_columns;
+    w->columns = g_new (GByteArray*, n_columns);
+    w->column = 0;
+    w->rows = 0;
+
+    write_name (w, name);
+    write_u32 (w, n_columns);
+    for (i = 0; i < n_columns; i++)
+    {
+        guint8 type = defs[i].type;
+        write_bytes (w, &type, 1);
+        write_name (w, defs[i].name);
+        w->columns[i] = g_byte_array_new ();
+    }
+}
+
+static void
+end_table (ColumnarWriter *w)
+{
+    guint i;
+
+    flush_group (w);
+    write_u32 (w, 0);
+    for (i = 0; i < w->n_columns; i++)
+        g_byte_array_free (w->columns[i], TRUE);
+    g_free (w->columns);
+    w->columns = NULL;
+    w->n_columns = 0;
+}
+
+static GByteArray *
+next_column (ColumnarWriter *w, GncColumnType type)
+{
+    g_assert (w->column < w->n_columns);
+    g_assert (w->defs[w->column].type == type);
+    return w->columns[w->column++];
+}
+
+static void
+put_guid (ColumnarWriter *w, const GncGUID *guid)
+{
+    static const guchar no_guid[GUID_DATA_SIZE] = { 0 };
+    g_byte_array_append (next_column (w, GNC_COLUMN_GUID),
+                         guid ? guid->reserved : no_guid, GUID_DATA_SIZE);
+}
+
+static void
+put_instance (ColumnarWriter *w, gconstpointer inst)
+{
+    put_guid (w, inst ? qof_instance_get_guid (inst) : NULL);
+}
+
+static void
+put_int64 (ColumnarWriter *w, gint64 val)
+{
+    guint64 le = GUINT64_TO_LE ((guint64) val);
+    g_byte_array_append (next_column (w, GNC_COLUMN_INT64),
+                         (const guint8*) &le, sizeof (le));
+}
+
+static void
+put_string (ColumnarWriter *w, const char *str)
+{
+    GByteArray *col = next_column (w, GNC_COLUMN_STRING);
+    guint32 len = str ? strlen (str) : 0;
+    guint32 le = GUINT32_TO_LE (len);
+
+    g_byte_array_append (col, (const guint8*) &le, sizeof (le));
+    if (len)
+        g_byte_array_append (col, (const guint8*) str, len);
+}
+
+static void
+put_bool (ColumnarWriter *w, gboolean val)
+{
+    guint8 byte = val ? 1 : 0;
+    g_byte_array_append (next_column (w, GNC_COLUMN_BOOL), &byte, 1);
+}
+
+static void
+put_numeric (ColumnarWriter *w, gnc_numeric val)
+{
+    put_int64 (w, val.num);
+    put_int64 (w, val.denom);
+}
+
+static void
+put_commodity (ColumnarWriter *w, const gnc_commodity *comm)
+{
+    put_string (w, comm ? gnc_commodity_get_unique_name (comm) : NULL);
+}
+
+static void
+end_row (ColumnarWriter *w)
+{
+    g_assert (w->column == w->n_columns);
+    w->column = 0;
+    if (++w->rows >= w->group_rows)
+        flush_group (w);
+}
+
+/* Accounts ********************************************************/
+
+static const ColumnDef account_columns[] =
+{
+    { "guid", GNC_COLUMN_GUID },
+    { "parent_guid", GNC_COLUMN_GUID },
+    { "name", GNC_COLUMN_STRING },
+    { "code", GNC_COLUMN_STRING },
+    { "description", GNC_COLUMN_STRING },
+    { "type", GNC_COLUMN_INT64 },
+    { "commodity", GNC_COLUMN_STRING },
+    { "placeholder", GNC_COLUMN_BOOL },
+    { "hidden", GNC_COLUMN_BOOL },
+};
+
+static void
+write_account_row (QofInstance *inst, gpointer data)
+{
+    ColumnarWriter *w = data;
+    Account *acc = GNC_ACCOUNT (inst);
+
+    put_instance (w, acc);
+    put_instance (w, gnc_account_get_parent (acc));
+    put_string (w, xaccAccountGetName (acc));
+    put_string (w, xaccAccountGetCode (acc));
+    put_string (w, xaccAccountGetDescription (acc));
+    put_int64 (w, xaccAccountGetType (acc));
+    put_commodity (w, xaccAccountGetCommodity (acc));
+    put_bool (w, xaccAccountGetPlaceholder (acc));
+    put_bool (w, xaccAccountGetHidden (acc));
+    end_row (w);
+}
+
+/* Transactions ****************************************************/
+
+static const ColumnDef transaction_columns[] =
+{
+    { "guid", GNC_COLUMN_GUID },
+    { "currency", GNC_COLUMN_STRING },
+    { "num", GNC_COLUMN_STRING },
+    { "description", GNC_COLUMN_STRING },
+    { "post_date", GNC_COLUMN_INT64 },
+    { "enter_date", GNC_COLUMN_INT64 },
+};
+
+static void
+write_transaction_row (QofInstance *inst, gpointer data)
+{
+    ColumnarWriter *w = data;
+    Transaction *trans = GNC_TRANSACTION (inst);
+
+    put_instance (w, trans);
+    put_commodity (w, xaccTransGetCurrency (trans));
+    put_string (w, xaccTransGetNum (trans));
+    put_string (w, xaccTransGetDescription (trans));
+    put_int64 (w, xaccTransGetDate (trans));
+    put_int64 (w, xaccTransGetDateEntered (trans));
+    end_row (w);
+}
+
+/* Splits **********************************************************/
+
+static const ColumnDef split_columns[] =
+{
+    { "guid", GNC_COLUMN_GUID },
+    { "trans_guid", GNC_COLUMN_GUID },
+    { "account_guid", GNC_COLUMN_GUID },
+    { "lot_guid", GNC_COLUMN_GUID },
+    { "memo", GNC_COLUMN_STRING },
+    { "action", GNC_COLUMN_STRING },
+    { "reconcile_state", GNC_COLUMN_INT64 },
+    { "reconcile_date", GNC_COLUMN_INT64 },
+    { "amount_num", GNC_COLUMN_INT64 },
+    { "amount_denom", GNC_COLUMN_INT64 },
+    { "value_num", GNC_COLUMN_INT64 },
+    { "value_denom", GNC_COLUMN_INT64 },
+};
+
+static void
+write_split_row (QofInstance *inst, gpointer data)
+{
+    ColumnarWriter *w = data;
+    Split *split = GNC_SPLIT (inst);
+
+    put_instance (w, split);
+    put_instance (w, xaccSplitGetParent (split));
+    put_instance (w, xaccSplitGetAccount (split));
+    put_instance (w, xaccSplitGetLot (split));
+    put_string (w, xaccSplitGetMemo (split));
+    put_string (w, xaccSplitGetAction (split));
+    put_int64 (w, xaccSplitGetReconcile (split));
+    put_int64 (w, xaccSplitGetDateReconciled (split));
+    put_numeric (w, xaccSplitGetAmount (split));
+    put_numeric (w, xaccSplitGetValue (split));
+    end_row (w);
+}
+
+/* Prices **********************************************************/
+
+static const ColumnDef price_columns[] =
+{
+    { "guid", GNC_COLUMN_GUID },
+    { "commodity", GNC_COLUMN_STRING },
+    { "currency", GNC_COLUMN_STRING },
+    { "date", GNC_COLUMN_INT64 },
+    { "source", GNC_COLUMN_STRING },
+    { "type", GNC_COLUMN_STRING },
+    { "value_num", GNC_COLUMN_INT64 },
+    { "value_denom", GNC_COLUMN_INT64 },
+};
+
+static gboolean
+write_price_row (GNCPrice *price, gpointer data)
+{
+    ColumnarWriter *w = data;
+
+    put_instance (w, price);
+    put_commodity (w, gnc_price_get_commodity (price));
+    put_commodity (w, gnc_price_get_currency (price));
+    put_int64 (w, gnc_price_get_time (price).tv_sec);
+    put_string (w, gnc_price_get_source_string (price));
+    put_string (w, gnc_price_get_typestr (price));
+    put_numeric (w, gnc_price_get_value (price));
+    end_row (w);
+    return !w->failed;
+}
+
+/* Lots ************************************************************/
+
+static const ColumnDef lot_columns[] =
+{
+    { "guid", GNC_COLUMN_GUID },
+    { "account_guid", GNC_COLUMN_GUID },
+    { "title", GNC_COLUMN_STRING },
+    { "notes", GNC_COLUMN_STRING },
+    { "closed", GNC_COLUMN_BOOL },
+};
+
+static void
+write_lot_row (QofInstance *inst, gpointer data)
+{
+    ColumnarWriter *w = data;
+    GNCLot *lot = GNC_LOT (inst);
+
+    put_instance (w, lot);
+    put_instance (w, gnc_lot_get_account (lot));
+    put_string (w, gnc_lot_get_title (lot));
+    put_string (w, gnc_lot_get_notes (lot));
+    put_bool (w, gnc_lot_is_closed (lot));
+    end_row (w);
+}
+
+/* The whole book *************************************************/
+
+static void
+write_collection (ColumnarWriter *w, QofBook *book, QofIdType type,
+                  const char *name, const ColumnDef *defs, guint n_columns,
+                  QofInstanceForeachCB row_cb)
+{
+    begin_table (w, name, defs, n_columns);
+    qof_collection_foreach_unordered (qof_book_get_collection (book, type),
+                                      row_cb, w);
+    end_table (w);
+}
+
+static void
+load_account_splits (Account *acc, gpointer data)
+{
+    gnc_account_load_splits (acc);
+}
+
+gboolean
+gnc_book_export_columnar (QofBook *book, const gchar *filename,
+                          guint group_rows)
+{
+    ColumnarWriter w = { NULL };
+    GNCPriceDB *db;
+
+    g_return_val_if_fail (book, FALSE);
+    g_return_val_if_fail (filename, FALSE);
+
+    ENTER ("(book=%p, file=%s)", book, filename);
+    w.fh = g_fopen (filename, "wb");
+    if (!w.fh)
+    {
+        PERR ("Can't open %s: %s", filename, g_strerror (errno));
+        LEAVE (" ");
+        return FALSE;
+    }
+    w.group_rows = group_rows ? group_rows : GNC_COLUMNAR_GROUP_ROWS;
+
+    /* Nothing the backend still holds may be missed. */
+    gnc_account_foreach_descendant (gnc_book_get_root_account (book),
+                                    load_account_splits, NULL);
+    db = gnc_pricedb_get_db (book);
+    gnc_pricedb_load_all_prices (db);
+
+    write_bytes (&w, columnar_magic, sizeof (columnar_magic));
+    write_collection (&w, book, GNC_ID_ACCOUNT, "accounts", account_columns,
+                      G_N_ELEMENTS (account_columns), write_account_row);
+    write_collection (&w, book, GNC_ID_TRANS, "transactions",
+                      transaction_columns, G_N_ELEMENTS (transaction_columns),
+                      write_transaction_row);
+    write_collection (&w, book, GNC_ID_SPLIT, "splits", split_columns,
+                      G_N_ELEMENTS (split_columns), write_split_row);
+
+    begin_table (&w, "prices", price_columns, G_N_ELEMENTS (price_columns));
+    gnc_pricedb_foreach_price (db, write_price_row, &w, FALSE);
+    end_table (&w);
+
+    write_collection (&w, book, GNC_ID_LOT, "lots", lot_columns,
+                      G_N_ELEMENTS (lot_columns), write_lot_row);
+    write_u32 (&w, 0);
+
+    if (fclose (w.fh) != 0)
+        w.failed = TRUE;
+    if (w.failed)
+        PERR ("Error writing %s", filename);
+    LEAVE ("%s", w.failed ? "failed" : "done");
+    return !w.failed;
+}
@@ -0,0 +1,92 @@
+/********************************************************************\
+ * gnc-columnar-export.h -- write a book as typed columns           *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Engine
+    @{ */
+/** @file gnc-columnar-export.h
+    @brief Export of a book's objects as typed columns, for analysis
+    tools that would otherwise have to parse a CSV export back.
+
+    The file is written in one pass over each collection, buffering a
+    row group of each table at a time.  Its layout is:
+
+    @verbatim
+    file    "GNCCOL" 0x00 0x01, the tables, then a u32 0
+    table   u32 name length, name, u32 number of columns, for each
+            column a u8 type, u32 name length and name; then the row
+            groups, then a u32 0
+    group   u32 number of rows (never 0), then for each column in order
+            a u64 byte count and that many bytes of column data
+    @endverbatim
+
+    Every integer is little-endian and names are UTF-8 without a
+    terminator.  Column data holds one value per row:
+
+    - GNC_COLUMN_GUID: the 16 bytes of the GUID, all zero for none.
+    - GNC_COLUMN_INT64: 8 bytes, two's complement.  Dates are time64
+      seconds and amounts are split into num and denom columns.
+    - GNC_COLUMN_STRING: a u32 length and that many bytes.
+    - GNC_COLUMN_BOOL: one byte, 0 or 1.
+
+    The tables are "accounts", "transactions", "splits", "prices" and
+    "lots", in that order; readers should find columns by name, since
+    more may be added.
+*/
+
+#ifndef GNC_COLUMNAR_EXPORT_H
+#define GNC_COLUMNAR_EXPORT_H
+
+#include <glib.h>
+#include "qof.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef enum
+{
+    GNC_COLUMN_GUID = 1,
+    GNC_COLUMN_INT64 = 2,
+    GNC_COLUMN_STRING = 3,
+    GNC_COLUMN_BOOL = 4
+} GncColumnType;
+
+/** The rows buffered per table when no group size is given. */
+#define GNC_COLUMNAR_GROUP_ROWS 65536
+
+/** Write the accounts, transactions, splits, prices and lots of book to
+ *  filename in the layout above.  Transactions and prices a backend has
+ *  left pending are loaded first.
+ *
+ *  @param group_rows The number of rows per row group, which bounds the
+ *  memory used; 0 for GNC_COLUMNAR_GROUP_ROWS.
+ *
+ *  @return TRUE if the whole file was written. */
+gboolean gnc_book_export_columnar (QofBook *book, const gchar *filename,
+                                   guint group_rows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/** @} */
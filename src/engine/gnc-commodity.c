@@ -108,6 +108,8 @@ struct gnc_commodity_namespace_s
     gboolean     iso4217;
     GHashTable * cm_table;
     GList      * cm_list;
+    /* The commodities by printname, for gnc_commodity_table_find_full */
+    GHashTable * printname_index;
 };
 
 struct _GncCommodityNamespaceClass
@@ -119,6 +121,8 @@ struct gnc_commodity_table_s
 {
     GHashTable * ns_table;
     GList      * ns_list;
+    /* The commodities of all namespaces by CUSIP */
+    GHashTable * cusip_index;
 };
 
 struct gnc_new_iso_code
@@ -610,6 +614,102 @@ reset_unique_name(CommodityPrivate *priv)
                                         priv->mnemonic ? priv->mnemonic : "");
 }
 
+/* The printname and CUSIP indexes map a key to the GList of the table's
+ * commodities that have it; neither key need be unique. */
+static GHashTable *
+commodity_index_new (void)
+{
+    return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void
+commodity_index_free_list (gpointer key, gpointer value, gpointer user_data)
+{
+    g_list_free (value);
+}
+
+static void
+commodity_index_destroy (GHashTable *index)
+{
+    g_hash_table_foreach (index, commodity_index_free_list, NULL);
+    g_hash_table_destroy (index);
+}
+
+static void
+commodity_index_add (GHashTable *index, const char *key, gnc_commodity *cm)
+{
+    GList *list;
+
+    if (!key || !*key) return;
+    list = g_list_append (g_hash_table_lookup (index, key), cm);
+    if (!list->next)
+        g_hash_table_insert (index, g_strdup (key), list);
+}
+
+static gboolean
+commodity_index_remove (GHashTable *index, const char *key, gnc_commodity *cm)
+{
+    GList *list, *node;
+
+    if (!key || !*key) return FALSE;
+    list = g_hash_table_lookup (index, key);
+    node = g_list_find (list, cm);
+    if (!node) return FALSE;
+    list = g_list_delete_link (list, node);
+    if (list)
+        g_hash_table_insert (index, g_strdup (key), list);
+    else
+        g_hash_table_remove (index, key);
+    return TRUE;
+}
+
+static void
+commodity_table_index (gnc_commodity_table *table,
+                       gnc_commodity_namespace *nsp, gnc_commodity *cm)
+{
+    CommodityPrivate* priv = GET_PRIVATE(cm);
+
+    commodity_index_add (nsp->printname_index, priv->printname, cm);
+    commodity_index_add (table->cusip_index, priv->cusip, cm);
+}
+
+/* Every commodity in the table is in its namespace's printname index,
+ * so that says whether cm was indexed at all. */
+static gboolean
+commodity_table_unindex (gnc_commodity_table *table,
+                         gnc_commodity_namespace *nsp, gnc_commodity *cm)
+{
+    CommodityPrivate* priv = GET_PRIVATE(cm);
+
+    if (!commodity_index_remove (nsp->printname_index, priv->printname, cm))
+        return FALSE;
+    commodity_index_remove (table->cusip_index, priv->cusip, cm);
+    return TRUE;
+}
+
+/* Takes cm out of its book's table indexes before a setter changes one
+ * of their keys, returning the table to give to commodity_reindex(), or
+ * NULL if cm is not in the table. */
+static gnc_commodity_table *
+commodity_unindex (gnc_commodity *cm)
+{
+    CommodityPrivate* priv = GET_PRIVATE(cm);
+    gnc_commodity_table *table;
+
+    table = gnc_commodity_table_get_table (qof_instance_get_book (&cm->inst));
+    if (!table || !priv->name_space ||
+            !commodity_table_unindex (table, priv->name_space, cm))
+        return NULL;
+    return table;
+}
+
+static void
+commodity_reindex (gnc_commodity_table *table, gnc_commodity *cm)
+{
+    if (table)
+        commodity_table_index (table, GET_PRIVATE(cm)->name_space, cm);
+}
+
 /* GObject Initialization */
 G_DEFINE_TYPE(gnc_commodity, gnc_commodity, QOF_TYPE_INSTANCE);
 
@@ -1214,18 +1314,21 @@ void
 gnc_commodity_set_mnemonic(gnc_commodity * cm, const char * mnemonic)
 {
     CommodityPrivate* priv;
+    gnc_commodity_table *table;
 
     if (!cm) return;
     priv = GET_PRIVATE(cm);
     if (priv->mnemonic == mnemonic) return;
 
     gnc_commodity_begin_edit(cm);
+    table = commodity_unindex (cm);
     CACHE_REMOVE (priv->mnemonic);
     priv->mnemonic = CACHE_INSERT(mnemonic);
 
     mark_commodity_dirty (cm);
     reset_printname(priv);
     reset_unique_name(priv);
+    commodity_reindex (table, cm);
     gnc_commodity_commit_edit(cm);
 }
 
@@ -1267,17 +1370,20 @@ void
 gnc_commodity_set_fullname(gnc_commodity * cm, const char * fullname)
 {
     CommodityPrivate* priv;
+    gnc_commodity_table *table;
 
     if (!cm) return;
     priv = GET_PRIVATE(cm);
     if (priv->fullname == fullname) return;
 
+    table = commodity_unindex (cm);
     CACHE_REMOVE (priv->fullname);
     priv->fullname = CACHE_INSERT (fullname);
 
     gnc_commodity_begin_edit(cm);
     mark_commodity_dirty(cm);
     reset_printname(priv);
+    commodity_reindex (table, cm);
     gnc_commodity_commit_edit(cm);
 }
 
@@ -1290,6 +1396,7 @@ gnc_commodity_set_cusip(gnc_commodity * cm,
                         const char * cusip)
 {
     CommodityPrivate* priv;
+    gnc_commodity_table *table;
 
     if (!cm) return;
 
@@ -1297,8 +1404,10 @@ gnc_commodity_set_cusip(gnc_commodity * cm,
     if (priv->cusip == cusip) return;
 
     gnc_commodity_begin_edit(cm);
+    table = commodity_unindex (cm);
     CACHE_REMOVE (priv->cusip);
     priv->cusip = CACHE_INSERT (cusip);
+    commodity_reindex (table, cm);
     mark_commodity_dirty(cm);
     gnc_commodity_commit_edit(cm);
 }
@@ -1715,6 +1824,7 @@ gnc_commodity_table_new(void)
     gnc_commodity_table * retval = g_new0(gnc_commodity_table, 1);
     retval->ns_table = g_hash_table_new(&g_str_hash, &g_str_equal);
     retval->ns_list = NULL;
+    retval->cusip_index = commodity_index_new ();
     return retval;
 }
 
@@ -1868,28 +1978,36 @@ gnc_commodity_table_find_full(const gnc_commodity_table * table,
                               const char * name_space,
                               const char * fullname)
 {
-    gnc_commodity * retval = NULL;
-    GList         * all;
-    GList         * iterator;
+    gnc_commodity_namespace * nsp;
+    GList                   * matches;
 
     if (!fullname || (fullname[0] == '\0'))
         return NULL;
 
-    all = gnc_commodity_table_get_commodities(table, name_space);
+    nsp = gnc_commodity_table_find_namespace(table, name_space);
+    if (!nsp)
+        return NULL;
 
-    for (iterator = all; iterator; iterator = iterator->next)
-    {
-        if (!strcmp(fullname,
-                    gnc_commodity_get_printname(iterator->data)))
-        {
-            retval = iterator->data;
-            break;
-        }
-    }
+    matches = g_hash_table_lookup(nsp->printname_index, fullname);
+    return matches ? matches->data : NULL;
+}
+
+/********************************************************************
+ * gnc_commodity_table_lookup_by_cusip
+ * locate a commodity in any namespace by its CUSIP or exchange code
+ ********************************************************************/
 
-    g_list_free (all);
+gnc_commodity *
+gnc_commodity_table_lookup_by_cusip(const gnc_commodity_table * table,
+                                    const char * cusip)
+{
+    GList * matches;
 
-    return retval;
+    if (!table || !cusip || (cusip[0] == '\0'))
+        return NULL;
+
+    matches = g_hash_table_lookup(table->cusip_index, cusip);
+    return matches ? matches->data : NULL;
 }
 
 
@@ -1968,6 +2086,7 @@ gnc_commodity_table_insert(gnc_commodity_table * table,
                         CACHE_INSERT(priv->mnemonic),
                         (gpointer)comm);
     nsp->cm_list = g_list_append(nsp->cm_list, comm);
+    commodity_table_index (table, nsp, comm);
 
     qof_event_gen (&comm->inst, QOF_EVENT_ADD, NULL);
     LEAVE ("(table=%p, comm=%p)", table, comm);
@@ -2002,6 +2121,7 @@ gnc_commodity_table_remove(gnc_commodity_table * table,
     if (!nsp) return;
 
     nsp->cm_list = g_list_remove(nsp->cm_list, comm);
+    commodity_table_unindex (table, nsp, comm);
     g_hash_table_remove (nsp->cm_table, priv->mnemonic);
     /* XXX minor mem leak, should remove the key as well */
 }
@@ -2253,6 +2373,7 @@ gnc_commodity_table_add_namespace(gnc_commodity_table * table,
     {
         ns = g_object_new(GNC_TYPE_COMMODITY_NAMESPACE, NULL);
         ns->cm_table = g_hash_table_new(g_str_hash, g_str_equal);
+        ns->printname_index = commodity_index_new ();
         ns->name = CACHE_INSERT((gpointer)name_space);
         ns->iso4217 = gnc_commodity_namespace_is_iso(name_space);
         qof_instance_init_data (&ns->inst, GNC_ID_COMMODITY_NAMESPACE, book);
@@ -2283,9 +2404,12 @@ gnc_commodity_table_find_namespace(const gnc_commodity_table * table,
 gnc_commodity *
 gnc_commodity_find_commodity_by_guid(const GncGUID *guid, QofBook *book)
 {
+    static gint type_id = -1;
     QofCollection *col;
     if (!guid || !book) return NULL;
-    col = qof_book_get_collection (book, GNC_ID_COMMODITY);
+    if (type_id < 0)
+        type_id = qof_object_get_type_id (GNC_ID_COMMODITY);
+    col = qof_book_get_collection_by_id (book, type_id);
     return (gnc_commodity *) qof_collection_lookup_entity (col, guid);
 }
 
@@ -2308,6 +2432,7 @@ gnc_commodity_table_delete_namespace(gnc_commodity_table * table,
                                      const char * name_space)
 {
     gnc_commodity_namespace * ns;
+    GList *node;
 
     if (!table) return;
 
@@ -2319,6 +2444,14 @@ gnc_commodity_table_delete_namespace(gnc_commodity_table * table,
     g_hash_table_remove(table->ns_table, name_space);
     table->ns_list = g_list_remove(table->ns_list, ns);
 
+    /* The commodities can't find the namespace to leave the indexes
+     * once it is out of ns_table. */
+    for (node = ns->cm_list; node; node = node->next)
+        commodity_index_remove (table->cusip_index,
+                                GET_PRIVATE(node->data)->cusip, node->data);
+    commodity_index_destroy (ns->printname_index);
+    ns->printname_index = NULL;
+
     g_list_free(ns->cm_list);
     ns->cm_list = NULL;
 
@@ -2406,6 +2539,8 @@ gnc_commodity_table_destroy(gnc_commodity_table * t)
     t->ns_list = NULL;
     g_hash_table_destroy(t->ns_table);
     t->ns_table = NULL;
+    commodity_index_destroy (t->cusip_index);
+    t->cusip_index = NULL;
     g_free(t);
     LEAVE ("table=%p", t);
 }
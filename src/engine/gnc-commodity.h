@@ -739,6 +739,17 @@ gnc_commodity_table_lookup_unique(const gnc_commodity_table *table,
 gnc_commodity * gnc_commodity_table_find_full(const gnc_commodity_table * t,
         const char * commodity_namespace,
         const char * fullname);
+/** Find a commodity in any namespace of the table by its CUSIP or other
+ *  exchange specific code.
+ *
+ *  @param table A pointer to the commodity table
+ *
+ *  @param cusip The code to look for.
+ *
+ *  @return A commodity with that code, or NULL if there is none.  When
+ *  several have it, which one is returned is unspecified. */
+gnc_commodity * gnc_commodity_table_lookup_by_cusip(const gnc_commodity_table * table,
+        const char * cusip);
 
 /*@ dependent @*/
 gnc_commodity * gnc_commodity_find_commodity_by_guid(const GncGUID *guid,
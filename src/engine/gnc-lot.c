@@ -90,10 +90,29 @@ typedef struct LotPrivate
     signed char is_closed;
 #define LOT_CLOSED_UNKNOWN (-1)
 
+    /* The balance, valid while balance_cached; thrown away together
+     * with is_closed by gnc_lot_set_closed_unknown(). */
+    gnc_numeric balance;
+    gboolean balance_cached;
+
+    /* The splits in the order of their gains source transactions, with
+     * running totals, for gnc_lot_get_balance_before(); NULL until it's
+     * needed and whenever the balance cache is thrown away. */
+    GArray *before_index;
+
     /* traversal marker, handy for preventing recursion */
     unsigned char marker;
 } LotPrivate;
 
+typedef struct
+{
+    Split *split;
+    Split *source;              /* gains source split, or split itself */
+    Transaction *trans;         /* source's transaction */
+    gnc_numeric amount;         /* totals up to and including split */
+    gnc_numeric value;
+} LotBeforeEntry;
+
 #define GET_PRIVATE(o) \
     (G_TYPE_INSTANCE_GET_PRIVATE((o), GNC_TYPE_LOT, LotPrivate))
 
@@ -130,6 +149,9 @@ gnc_lot_dispose(GObject *lotp)
 static void
 gnc_lot_finalize(GObject* lotp)
 {
+    LotPrivate* priv = GET_PRIVATE(lotp);
+    if (priv->before_index)
+        g_array_free (priv->before_index, TRUE);
     G_OBJECT_CLASS(gnc_lot_parent_class)->finalize(lotp);
 }
 
@@ -296,10 +318,17 @@ gnc_lot_free(GNCLot* lot)
     qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_DESTROY, NULL);
 
     priv = GET_PRIVATE(lot);
-    for (node = priv->splits; node; node = node->next)
+    /* When the book is closing the splits and the account may be gone
+     * already; they don't need to forget the lot. */
+    if (!qof_book_shutting_down (qof_instance_get_book (lot)))
     {
-        Split *s = node->data;
-        s->lot = NULL;
+        for (node = priv->splits; node; node = node->next)
+        {
+            Split *s = node->data;
+            s->lot = NULL;
+        }
+        if (priv->account)
+            gnc_account_forget_lot (priv->account, lot);
     }
     g_list_free (priv->splits);
 
@@ -408,6 +437,14 @@ gnc_lot_set_closed_unknown(GNCLot* lot)
     {
         priv = GET_PRIVATE(lot);
         priv->is_closed = LOT_CLOSED_UNKNOWN;
+        priv->balance_cached = FALSE;
+        if (priv->before_index)
+        {
+            g_array_free (priv->before_index, TRUE);
+            priv->before_index = NULL;
+        }
+        if (priv->account)
+            gnc_account_lot_changed (priv->account, lot);
     }
 }
 
@@ -491,6 +528,12 @@ gnc_lot_get_balance (GNCLot *lot)
     if (!lot) return zero;
 
     priv = GET_PRIVATE(lot);
+    if (priv->balance_cached)
+    {
+        priv->is_closed = gnc_numeric_zero_p (priv->balance);
+        return priv->balance;
+    }
+
     if (!priv->splits)
     {
         priv->is_closed = FALSE;
@@ -517,18 +560,75 @@ gnc_lot_get_balance (GNCLot *lot)
     {
         priv->is_closed = FALSE;
     }
+    priv->balance = baln;
+    priv->balance_cached = TRUE;
 
     return baln;
 }
 
 /* ============================================================= */
 
+/* If this is a gains split, the source of the gains, whose transaction
+ * stands in for its own in the comparisons: gains splits are in separate
+ * transactions that may sort after non-gains transactions. */
+static Split *
+lot_split_source (const Split *split)
+{
+    Split *source = xaccSplitGetGainsSourceSplit (split);
+    return source ? source : (Split *) split;
+}
+
+static gint
+lot_before_entry_cmp (gconstpointer a, gconstpointer b)
+{
+    const LotBeforeEntry *ea = a, *eb = b;
+    return xaccTransOrder (ea->trans, eb->trans);
+}
+
+static GArray *
+lot_get_before_index (LotPrivate *priv)
+{
+    GList *node;
+    gnc_numeric amt = gnc_numeric_zero ();
+    gnc_numeric val = gnc_numeric_zero ();
+    guint i;
+
+    if (priv->before_index)
+        return priv->before_index;
+
+    priv->before_index = g_array_sized_new (FALSE, FALSE, sizeof (LotBeforeEntry),
+                                            g_list_length (priv->splits));
+    for (node = priv->splits; node; node = node->next)
+    {
+        LotBeforeEntry entry;
+        entry.split = node->data;
+        entry.source = lot_split_source (entry.split);
+        entry.trans = xaccSplitGetParent (entry.source);
+        g_array_append_val (priv->before_index, entry);
+    }
+    g_array_sort (priv->before_index, lot_before_entry_cmp);
+
+    for (i = 0; i < priv->before_index->len; ++i)
+    {
+        LotBeforeEntry *entry = &g_array_index (priv->before_index,
+                                                LotBeforeEntry, i);
+        amt = gnc_numeric_add_fixed (amt, xaccSplitGetAmount (entry->split));
+        val = gnc_numeric_add_fixed (val, xaccSplitGetValue (entry->split));
+        entry->amount = amt;
+        entry->value = val;
+    }
+    return priv->before_index;
+}
+
 void
 gnc_lot_get_balance_before (const GNCLot *lot, const Split *split,
                             gnc_numeric *amount, gnc_numeric *value)
 {
     LotPrivate* priv;
-    GList *node;
+    GArray *index;
+    const Split *target;
+    Transaction *tb;
+    guint lo, hi, i;
     gnc_numeric zero = gnc_numeric_zero();
     gnc_numeric amt = zero;
     gnc_numeric val = zero;
@@ -538,32 +638,41 @@ gnc_lot_get_balance_before (const GNCLot *lot, const Split *split,
     if (lot == NULL) return;
 
     priv = GET_PRIVATE(lot);
-    if (priv->splits)
+    if (!priv->splits) return;
+
+    target = lot_split_source (split);
+    tb = xaccSplitGetParent (target);
+    index = lot_get_before_index (priv);
+
+    /* Everything from transactions before the target's, ... */
+    lo = 0;
+    hi = index->len;
+    while (lo < hi)
     {
-        Transaction *ta, *tb;
-        const Split *target;
-        /* If this is a gains split, find the source of the gains and use
-           its transaction for the comparison.  Gains splits are in separate
-           transactions that may sort after non-gains transactions.  */
-        target = xaccSplitGetGainsSourceSplit (split);
-        if (target == NULL)
-            target = split;
-        tb = xaccSplitGetParent (target);
-        for (node = priv->splits; node; node = node->next)
+        guint mid = lo + (hi - lo) / 2;
+        if (xaccTransOrder (g_array_index (index, LotBeforeEntry, mid).trans,
+                            tb) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo > 0)
+    {
+        LotBeforeEntry *entry = &g_array_index (index, LotBeforeEntry, lo - 1);
+        amt = entry->amount;
+        val = entry->value;
+    }
+
+    /* ... and the other splits of the target's own transaction. */
+    for (i = lo; i < index->len; ++i)
+    {
+        LotBeforeEntry *entry = &g_array_index (index, LotBeforeEntry, i);
+        if (entry->trans != tb)
+            break;
+        if (entry->source != target)
         {
-            Split *s = node->data;
-            Split *source = xaccSplitGetGainsSourceSplit (s);
-            if (source == NULL)
-                source = s;
-            ta = xaccSplitGetParent (source);
-            if ((ta == tb && source != target) ||
-                    xaccTransOrder (ta, tb) < 0)
-            {
-                gnc_numeric tmpval = xaccSplitGetAmount (s);
-                amt = gnc_numeric_add_fixed (amt, tmpval);
-                tmpval = xaccSplitGetValue (s);
-                val = gnc_numeric_add_fixed (val, tmpval);
-            }
+            amt = gnc_numeric_add_fixed (amt, xaccSplitGetAmount (entry->split));
+            val = gnc_numeric_add_fixed (val, xaccSplitGetValue (entry->split));
         }
     }
 
@@ -618,7 +727,7 @@ gnc_lot_add_split (GNCLot *lot, Split *split)
     priv->splits = g_list_append (priv->splits, split);
 
     /* for recomputation of is-closed */
-    priv->is_closed = LOT_CLOSED_UNKNOWN;
+    gnc_lot_set_closed_unknown (lot);
     gnc_lot_commit_edit(lot);
 
     qof_event_gen (QOF_INSTANCE(lot), QOF_EVENT_MODIFY, NULL);
@@ -637,7 +746,7 @@ gnc_lot_remove_split (GNCLot *lot, Split *split)
     qof_instance_set_dirty(QOF_INSTANCE(lot));
     priv->splits = g_list_remove (priv->splits, split);
     xaccSplitSetLot(split, NULL);
-    priv->is_closed = LOT_CLOSED_UNKNOWN;   /* force an is-closed computation */
+    gnc_lot_set_closed_unknown (lot);   /* force an is-closed computation */
 
     if (NULL == priv->splits)
     {
@@ -688,7 +797,7 @@ destroy_lot_on_book_close(QofInstance *ent, gpointer data)
 {
     GNCLot* lot = GNC_LOT(ent);
 
-    gnc_lot_destroy(lot);
+    gnc_lot_free(lot);
 }
 
 static void
@@ -0,0 +1,83 @@
+/********************************************************************\
+ * gnc-memory-report.c -- what a book holds in memory               *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gnc-memory-report.h"
+#include "gnc-pricedb.h"
+
+void
+gnc_memory_report_write (QofBook *book, FILE *out, guint max_subtrees)
+{
+    GList *usage, *subtrees, *node;
+    gsize instance_total = 0, kvp_total = 0, cache_bytes, price_bytes;
+    guint cache_entries;
+    guint64 cache_refs;
+
+    g_return_if_fail (book != NULL);
+    g_return_if_fail (out != NULL);
+
+    fprintf (out, "%-20s %10s %12s %10s %10s %12s\n", "Type", "Instances",
+             "Bytes", "KVP frames", "KVP values", "KVP bytes");
+    usage = qof_book_get_memory_usage (book);
+    for (node = usage; node; node = node->next)
+    {
+        QofBookTypeMemory *type = node->data;
+        fprintf (out, "%-20s %10u %12" G_GSIZE_FORMAT " %10" G_GUINT64_FORMAT
+                 " %10" G_GUINT64_FORMAT " %12" G_GSIZE_FORMAT "\n",
+                 type->type, type->instances, type->instance_bytes,
+                 type->kvp_frames, type->kvp_values, type->kvp_bytes);
+        instance_total += type->instance_bytes;
+        kvp_total += type->kvp_bytes;
+    }
+    g_list_free_full (usage, g_free);
+    fprintf (out, "%-20s %10s %12" G_GSIZE_FORMAT " %10s %10s %12"
+             G_GSIZE_FORMAT "\n\n", "Total", "", instance_total, "", "",
+             kvp_total);
+
+    qof_string_cache_stats (&cache_entries, &cache_refs, &cache_bytes);
+    fprintf (out, "String cache: %u strings, %" G_GUINT64_FORMAT
+             " references, %" G_GSIZE_FORMAT " bytes\n", cache_entries,
+             cache_refs, cache_bytes);
+    price_bytes = gnc_pricedb_get_memory_usage (gnc_pricedb_get_db (book));
+    fprintf (out, "Price lists and caches: %" G_GSIZE_FORMAT " bytes\n",
+             price_bytes);
+
+    if (max_subtrees == 0)
+        return;
+    fprintf (out, "\nLargest KVP subtrees:\n");
+    fprintf (out, "%12s %10s %-20s %-32s %s\n", "Bytes", "Values", "Type",
+             "GUID", "Key");
+    subtrees = qof_book_get_largest_kvp_subtrees (book, max_subtrees);
+    for (node = subtrees; node; node = node->next)
+    {
+        QofKvpSubtreeMemory *subtree = node->data;
+        gchar guid[GUID_ENCODING_LENGTH + 1];
+        guid_to_string_buff (&subtree->guid, guid);
+        fprintf (out, "%12" G_GSIZE_FORMAT " %10" G_GUINT64_FORMAT
+                 " %-20s %-32s %s\n", subtree->bytes, subtree->values,
+                 subtree->type, guid, subtree->key);
+    }
+    qof_book_free_kvp_subtrees (subtrees);
+}
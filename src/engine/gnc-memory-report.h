@@ -0,0 +1,46 @@
+/********************************************************************\
+ * gnc-memory-report.h -- what a book holds in memory               *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Engine
+    @{ */
+/** @file gnc-memory-report.h
+    @brief A readable summary of a book's memory use
+
+    The report puts together qof_book_get_memory_usage(),
+    qof_book_get_largest_kvp_subtrees(), qof_string_cache_stats() and
+    gnc_pricedb_get_memory_usage(), which are there for programs that
+    want the numbers themselves.
+*/
+
+#ifndef GNC_MEMORY_REPORT_H
+#define GNC_MEMORY_REPORT_H
+
+#include <stdio.h>
+#include <glib.h>
+#include "qof.h"
+
+/** Write the report on book to out: the instances and KVP slots of
+ *  each type, the string cache, the price database and the
+ *  max_subtrees largest top-level KVP subtrees. */
+void gnc_memory_report_write (QofBook *book, FILE *out, guint max_subtrees);
+
+#endif /* GNC_MEMORY_REPORT_H */
+/** @} */
@@ -56,7 +56,16 @@ struct gnc_price_db_s
 {
     QofInstance inst;              /* globally unique object identifier */
     GHashTable *commodity_hash;
+    GHashTable *series_hash;       /* PriceSeries for each price list */
+    GHashTable *path_cache;        /* ConversionPath for each pair seen */
+    GHashTable *lookup_cache;      /* Recent lookup results */
+    GHashTable *commodity_prices;  /* Each commodity's prices, newest first */
+    GQueue lookup_lru;             /* lookup_cache entries, newest first */
+    GHashTable *pending_series;    /* Pairs with prices left in the backend */
+    guint64 lookup_hits;
+    guint64 lookup_misses;
     gboolean bulk_update;		 /* TRUE while reading XML file, etc. */
+    GPtrArray *bulk_prices;        /* Prices added during a bulk update */
 };
 
 struct _GncPriceDBClass
@@ -93,6 +102,9 @@ void     gnc_pricedb_substitute_commodity(GNCPriceDB *db,
 /** register the pricedb object with the gncObject system */
 gboolean gnc_pricedb_register (void);
 
+/** A count of the price changes in all price databases */
+guint gnc_pricedb_get_mod_count (void);
+
 QofBackend * xaccPriceDBGetBackend (GNCPriceDB *prdb);
 
 #endif
@@ -420,10 +420,21 @@ static void commit_err (QofInstance *inst, QofBackendError errcode)
 
 static void noop (QofInstance *inst) {}
 
+/* Bumped on every price change, so cached converted balances can tell
+ * when they may have gone stale. */
+static guint mod_count = 0;
+
+guint
+gnc_pricedb_get_mod_count (void)
+{
+    return mod_count;
+}
+
 void
 gnc_price_commit_edit (GNCPrice *p)
 {
     if (!qof_commit_edit (QOF_INSTANCE(p))) return;
+    mod_count++;
     qof_commit_edit_part2 (&p->inst, commit_err, noop, noop);
 }
 
@@ -818,6 +829,576 @@ gnc_price_list_equal(PriceList *prices1, PriceList *prices2)
     return TRUE;
 }
 
+/* ==================================================================== */
+/* Price series
+
+   Each (commodity, currency) price list in the database is shadowed by a
+   PriceSeries: an array of the list's nodes in oldest-to-newest order,
+   i.e. the reverse of the list. That lets add_price and remove_price find
+   a price's place with a binary search and link or unlink its node
+   directly, and lets the time-based lookups bisect the prices instead of
+   walking the list from the newest one. New quotes usually arrive at the
+   newest end, which is the tail of the array, so appending them is cheap.
+   The lists themselves stay as they were for everyone iterating them.
+ */
+
+typedef struct
+{
+    const gnc_commodity *commodity;
+    const gnc_commodity *currency;
+} CommodityPair;
+
+typedef struct
+{
+    CommodityPair key;
+    GPtrArray *nodes;
+} PriceSeries;
+
+/* The hash and equality functions work for any struct beginning with a
+ * CommodityPair. */
+static guint
+commodity_pair_hash (gconstpointer key)
+{
+    const CommodityPair *pair = key;
+    return g_direct_hash (pair->commodity) * 31 +
+        g_direct_hash (pair->currency);
+}
+
+static gboolean
+commodity_pair_equal (gconstpointer a, gconstpointer b)
+{
+    const CommodityPair *pa = a, *pb = b;
+    return pa->commodity == pb->commodity && pa->currency == pb->currency;
+}
+
+static void
+price_series_free (gpointer data)
+{
+    PriceSeries *series = data;
+    g_ptr_array_free (series->nodes, TRUE);
+    g_slice_free (PriceSeries, series);
+}
+
+static GHashTable*
+price_series_table_new (void)
+{
+    return g_hash_table_new_full (commodity_pair_hash, commodity_pair_equal,
+                                  price_series_free, NULL);
+}
+
+static void pricedb_forget_conversion_paths (GNCPriceDB *db);
+static void pricedb_forget_lookups (GNCPriceDB *db);
+static GHashTable* commodity_prices_table_new (void);
+
+static PriceSeries*
+price_series_lookup (GNCPriceDB *db, const gnc_commodity *commodity,
+                     const gnc_commodity *currency)
+{
+    CommodityPair key;
+    if (!db->series_hash) return NULL;
+    key.commodity = commodity;
+    key.currency = currency;
+    return g_hash_table_lookup (db->series_hash, &key);
+}
+
+#define SERIES_PRICE(series, i) \
+    ((GNCPrice*)((GList*)g_ptr_array_index ((series)->nodes, (i)))->data)
+
+/* The number of prices in the series that come after p in list order, which
+ * is the index p has or would have in the array. */
+static guint
+price_series_position (const PriceSeries *series, const GNCPrice *p)
+{
+    guint low = 0, high = series->nodes->len;
+    while (low < high)
+    {
+        guint mid = low + (high - low) / 2;
+        if (compare_prices_by_date (SERIES_PRICE (series, mid), p) > 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/* The number of prices in the series dated no later than t. */
+static guint
+price_series_count_until (const PriceSeries *series, Timespec t)
+{
+    guint low = 0, high = series->nodes->len;
+    while (low < high)
+    {
+        guint mid = low + (high - low) / 2;
+        Timespec price_t = gnc_price_get_time (SERIES_PRICE (series, mid));
+        if (timespec_cmp (&price_t, &t) <= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static gboolean
+price_series_has_duplicate (const PriceSeries *series, GNCPrice *p,
+                            guint position)
+{
+    PriceListIsDuplStruct dupl = {p, FALSE};
+    Timespec day = timespecCanonicalDayTime (gnc_price_get_time (p));
+    guint len = series->nodes->len;
+    guint i;
+
+    /* Prices on the same day as p are all next to its position. */
+    for (i = position; i < len && !dupl.isDupl; ++i)
+    {
+        GNCPrice *other = SERIES_PRICE (series, i);
+        Timespec other_day = timespecCanonicalDayTime (gnc_price_get_time (other));
+        if (!timespec_equal (&day, &other_day))
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    for (i = position; i > 0 && !dupl.isDupl; --i)
+    {
+        GNCPrice *other = SERIES_PRICE (series, i - 1);
+        Timespec other_day = timespecCanonicalDayTime (gnc_price_get_time (other));
+        if (!timespec_equal (&day, &other_day))
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    return dupl.isDupl;
+}
+
+/* The series counterpart of gnc_price_list_insert: adds p to *prices, which
+ * must be the list the series shadows, and to the series, creating the
+ * series if this is the first price for the pair. */
+static gboolean
+price_series_insert (GNCPriceDB *db, PriceList **prices, GNCPrice *p,
+                     gboolean check_dupl)
+{
+    PriceSeries *series;
+    GList *node;
+    guint position, len;
+
+    series = price_series_lookup (db, p->commodity, p->currency);
+    if (!series)
+    {
+        series = g_slice_new (PriceSeries);
+        series->key.commodity = p->commodity;
+        series->key.currency = p->currency;
+        series->nodes = g_ptr_array_new ();
+        g_hash_table_insert (db->series_hash, series, series);
+        pricedb_forget_conversion_paths (db);
+    }
+
+    position = price_series_position (series, p);
+    if (check_dupl && price_series_has_duplicate (series, p, position))
+        return TRUE;
+
+    pricedb_forget_lookups (db);
+    gnc_price_ref (p);
+    len = series->nodes->len;
+    if (len == 0)
+    {
+        *prices = g_list_prepend (*prices, p);
+        node = *prices;
+    }
+    else if (position == 0)
+    {
+        /* The oldest price goes after the list's tail. */
+        GList *tail = g_ptr_array_index (series->nodes, 0);
+        node = g_list_alloc ();
+        node->data = p;
+        node->prev = tail;
+        tail->next = node;
+    }
+    else
+    {
+        GList *older = g_ptr_array_index (series->nodes, position - 1);
+        *prices = g_list_insert_before (*prices, older, p);
+        node = older->prev;
+    }
+
+    g_ptr_array_add (series->nodes, NULL);
+    if (position < len)
+        memmove (series->nodes->pdata + position + 1,
+                 series->nodes->pdata + position,
+                 (len - position) * sizeof (gpointer));
+    g_ptr_array_index (series->nodes, position) = node;
+    return TRUE;
+}
+
+/* The series counterpart of gnc_price_list_remove. */
+static gboolean
+price_series_remove (GNCPriceDB *db, PriceList **prices, GNCPrice *p)
+{
+    PriceSeries *series;
+    guint position;
+    GList *node;
+
+    pricedb_forget_lookups (db);
+    series = price_series_lookup (db, p->commodity, p->currency);
+    if (!series)
+        return gnc_price_list_remove (prices, p);
+
+    position = price_series_position (series, p);
+    if (position >= series->nodes->len ||
+        SERIES_PRICE (series, position) != p)
+    {
+        /* p's sort key changed behind our back; fall back to a scan. */
+        for (position = 0; position < series->nodes->len; ++position)
+            if (SERIES_PRICE (series, position) == p)
+                break;
+        if (position == series->nodes->len)
+            return TRUE;
+    }
+
+    node = g_ptr_array_index (series->nodes, position);
+    g_ptr_array_remove_index (series->nodes, position);
+    *prices = g_list_delete_link (*prices, node);
+    gnc_price_unref (p);
+
+    if (series->nodes->len == 0)
+    {
+        g_hash_table_remove (db->series_hash, series);
+        pricedb_forget_conversion_paths (db);
+    }
+    return TRUE;
+}
+
+/* Bulk updates
+
+   While db->bulk_update is set add_price only queues prices in
+   db->bulk_prices. Ending the bulk update sorts the queue by series and
+   date, merges each run into its series in one pass, dropping duplicates,
+   and only then generates the add events.
+ */
+
+static gint
+compare_prices_by_series (gconstpointer a, gconstpointer b)
+{
+    const GNCPrice *pa = *(GNCPrice* const*)a;
+    const GNCPrice *pb = *(GNCPrice* const*)b;
+
+    if (pa->commodity != pb->commodity)
+        return pa->commodity < pb->commodity ? -1 : 1;
+    if (pa->currency != pb->currency)
+        return pa->currency < pb->currency ? -1 : 1;
+    /* Oldest first, as in a PriceSeries. */
+    return -compare_prices_by_date (pa, pb);
+}
+
+/* Is p a duplicate of any of the prices on its day in the merged array so
+ * far or in the part of the series that hasn't been merged yet? */
+static gboolean
+price_is_bulk_duplicate (GNCPrice *p, GPtrArray *merged,
+                         const PriceSeries *series, guint next_old)
+{
+    PriceListIsDuplStruct dupl = {p, FALSE};
+    Timespec day = timespecCanonicalDayTime (gnc_price_get_time (p));
+    guint i;
+
+    for (i = merged->len; i > 0 && !dupl.isDupl; --i)
+    {
+        GNCPrice *other = g_ptr_array_index (merged, i - 1);
+        Timespec other_day = timespecCanonicalDayTime (gnc_price_get_time (other));
+        if (!timespec_equal (&day, &other_day))
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    for (i = next_old; series && i < series->nodes->len && !dupl.isDupl; ++i)
+    {
+        GNCPrice *other = SERIES_PRICE (series, i);
+        Timespec other_day = timespecCanonicalDayTime (gnc_price_get_time (other));
+        if (!timespec_equal (&day, &other_day))
+            break;
+        price_list_is_duplicate (other, &dupl);
+    }
+    return dupl.isDupl;
+}
+
+/* Merge count prices of one series, sorted oldest first, into the database.
+ * The queue's references pass to the price list. */
+static void
+price_series_merge (GNCPriceDB *db, GNCPrice **prices, guint count)
+{
+    gnc_commodity *commodity = prices[0]->commodity;
+    gnc_commodity *currency = prices[0]->currency;
+    PriceSeries *series = price_series_lookup (db, commodity, currency);
+    guint old_len = series ? series->nodes->len : 0;
+    GPtrArray *merged = g_ptr_array_sized_new (old_len + count);
+    GHashTable *currency_hash;
+    PriceList *price_list;
+    guint i = 0, j = 0;
+
+    while (i < old_len || j < count)
+    {
+        GNCPrice *p;
+        if (j == count ||
+            (i < old_len &&
+             compare_prices_by_date (SERIES_PRICE (series, i), prices[j]) > 0))
+        {
+            g_ptr_array_add (merged, SERIES_PRICE (series, i++));
+            continue;
+        }
+        p = prices[j++];
+        if (price_is_bulk_duplicate (p, merged, series, i))
+        {
+            p->db = NULL;
+            gnc_price_unref (p);
+            continue;
+        }
+        g_ptr_array_add (merged, p);
+        qof_event_gen (&p->inst, QOF_EVENT_ADD, NULL);
+    }
+
+    if (merged->len == old_len)
+    {
+        /* Everything was a duplicate. */
+        g_ptr_array_free (merged, TRUE);
+        return;
+    }
+
+    pricedb_forget_lookups (db);
+    currency_hash = g_hash_table_lookup (db->commodity_hash, commodity);
+    if (!currency_hash)
+    {
+        currency_hash = g_hash_table_new (NULL, NULL);
+        g_hash_table_insert (db->commodity_hash, commodity, currency_hash);
+    }
+    if (!series)
+    {
+        series = g_slice_new (PriceSeries);
+        series->key.commodity = commodity;
+        series->key.currency = currency;
+        series->nodes = g_ptr_array_new ();
+        g_hash_table_insert (db->series_hash, series, series);
+        pricedb_forget_conversion_paths (db);
+    }
+
+    /* Rebuild the list newest first from the merged prices. */
+    g_list_free (g_hash_table_lookup (currency_hash, currency));
+    price_list = NULL;
+    g_ptr_array_set_size (series->nodes, merged->len);
+    for (i = 0; i < merged->len; ++i)
+    {
+        price_list = g_list_prepend (price_list, g_ptr_array_index (merged, i));
+        g_ptr_array_index (series->nodes, i) = price_list;
+    }
+    g_hash_table_insert (currency_hash, currency, price_list);
+    g_ptr_array_free (merged, TRUE);
+}
+
+static gboolean
+pricedb_flush_bulk (GNCPriceDB *db)
+{
+    GPtrArray *pending = db->bulk_prices;
+    guint start, end;
+
+    if (!pending) return FALSE;
+    db->bulk_prices = NULL;
+    g_ptr_array_sort (pending, compare_prices_by_series);
+    for (start = 0; start < pending->len; start = end)
+    {
+        GNCPrice *first = g_ptr_array_index (pending, start);
+        for (end = start + 1; end < pending->len; ++end)
+        {
+            GNCPrice *p = g_ptr_array_index (pending, end);
+            if (p->commodity != first->commodity ||
+                p->currency != first->currency)
+                break;
+        }
+        price_series_merge (db, (GNCPrice**)pending->pdata + start,
+                            end - start);
+    }
+    g_ptr_array_free (pending, TRUE);
+    return TRUE;
+}
+
+/* Prices left in the backend
+
+   A backend may load only the latest prices of each pair at first and mark
+   the pair pending with the date since which all of its prices are in the
+   database; db->pending_series maps the pair to that date. Before a lookup
+   needs an earlier price of the pair the loader is asked for the prices
+   back to the one wanted. Nothing is pending, and pending_series is NULL,
+   unless a backend asks for it.
+ */
+
+typedef struct
+{
+    CommodityPair key;
+    Timespec loaded_since;
+} PendingSeries;
+
+static PriceDBPricesLoader prices_loader = NULL;
+
+void
+gnc_pricedb_set_prices_loader (PriceDBPricesLoader loader)
+{
+    prices_loader = loader;
+}
+
+static void
+pending_series_free (gpointer data)
+{
+    g_slice_free (PendingSeries, data);
+}
+
+void
+gnc_pricedb_set_prices_pending (GNCPriceDB *db, const gnc_commodity *commodity,
+                                const gnc_commodity *currency,
+                                const Timespec *loaded_since)
+{
+    CommodityPair key = {commodity, currency};
+    PendingSeries *pending;
+
+    g_return_if_fail (db && commodity && currency);
+
+    if (!loaded_since)
+    {
+        if (db->pending_series)
+            g_hash_table_remove (db->pending_series, &key);
+        return;
+    }
+    if (!db->pending_series)
+        db->pending_series =
+            g_hash_table_new_full (commodity_pair_hash, commodity_pair_equal,
+                                   pending_series_free, NULL);
+    pending = g_slice_new (PendingSeries);
+    pending->key = key;
+    pending->loaded_since = *loaded_since;
+    g_hash_table_replace (db->pending_series, pending, pending);
+}
+
+/* The pair is dropped from pending_series before calling the loader, which
+ * marks it again if it leaves earlier prices behind. */
+static void
+pricedb_load_pair (GNCPriceDB *db, const gnc_commodity *commodity,
+                   const gnc_commodity *currency, Timespec t)
+{
+    CommodityPair key = {commodity, currency};
+    PendingSeries *pending;
+    Timespec loaded_since;
+    QofBackend *be;
+
+    if (!db->pending_series) return;
+    pending = g_hash_table_lookup (db->pending_series, &key);
+    if (!pending || timespec_cmp (&t, &pending->loaded_since) >= 0)
+        return;
+    loaded_since = pending->loaded_since;
+    g_hash_table_remove (db->pending_series, &key);
+
+    be = qof_book_get_backend (qof_instance_get_book (&db->inst));
+    if (prices_loader == NULL || be == NULL)
+        return;
+    ENTER ("db=%p commodity=%p currency=%p", db, commodity, currency);
+    prices_loader (be, db, commodity, currency, t, loaded_since);
+    LEAVE (" ");
+}
+
+/* The lookups for a pair search the prices in both directions. */
+static void
+pricedb_load_pairs (GNCPriceDB *db, const gnc_commodity *commodity,
+                    const gnc_commodity *currency, Timespec t)
+{
+    if (!db->pending_series) return;
+    pricedb_load_pair (db, commodity, currency, t);
+    pricedb_load_pair (db, currency, commodity, t);
+}
+
+/* Load the pending pairs for which keep returns TRUE. */
+static void
+pricedb_load_pending (GNCPriceDB *db, Timespec t,
+                      gboolean (*keep) (const CommodityPair *pair,
+                                        gconstpointer data),
+                      gconstpointer data)
+{
+    GHashTableIter iter;
+    gpointer key;
+    GList *pairs = NULL, *node;
+
+    if (!db->pending_series) return;
+    /* The loader changes pending_series, so collect the pairs first. */
+    g_hash_table_iter_init (&iter, db->pending_series);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        if (!keep || keep (key, data))
+            pairs = g_list_prepend (pairs, g_memdup (key, sizeof (CommodityPair)));
+    for (node = pairs; node; node = node->next)
+    {
+        CommodityPair *pair = node->data;
+        pricedb_load_pair (db, pair->commodity, pair->currency, t);
+    }
+    g_list_free_full (pairs, g_free);
+}
+
+static gboolean
+pair_has_commodity (const CommodityPair *pair, gconstpointer commodity)
+{
+    return pair->commodity == commodity || pair->currency == commodity;
+}
+
+static const Timespec earliest_time = {G_MININT64, 0};
+
+static void
+pricedb_load_commodity (GNCPriceDB *db, const gnc_commodity *commodity,
+                        Timespec t)
+{
+    pricedb_load_pending (db, t, pair_has_commodity, commodity);
+}
+
+void
+gnc_pricedb_load_all_prices (GNCPriceDB *db)
+{
+    g_return_if_fail (db != NULL);
+    pricedb_load_pending (db, earliest_time, NULL, NULL);
+}
+
+/* Of two prices either of which may be NULL, return the one that comes first
+ * in a most-recent-first price list, or the last one if !first. */
+static GNCPrice*
+price_list_order_pick (GNCPrice *a, GNCPrice *b, gboolean first)
+{
+    if (!a) return b;
+    if (!b) return a;
+    if (compare_prices_by_date (a, b) < 0)
+        return first ? a : b;
+    return first ? b : a;
+}
+
+/* Find, among the prices for commodity in currency and for currency in
+ * commodity, the two that bracket t in the merged most-recent-first list:
+ * *before is the first price dated no later than t and *after the last one
+ * dated after t. Either may be NULL.
+ * @return FALSE if there are no prices for the pair at all.
+ */
+static gboolean
+price_series_bracket (GNCPriceDB *db, const gnc_commodity *commodity,
+                      const gnc_commodity *currency, Timespec t,
+                      GNCPrice **before, GNCPrice **after)
+{
+    const PriceSeries *pair[2];
+    int i;
+
+    pricedb_load_pairs (db, commodity, currency, t);
+    pair[0] = price_series_lookup (db, commodity, currency);
+    pair[1] = price_series_lookup (db, currency, commodity);
+    *before = *after = NULL;
+    for (i = 0; i < 2; ++i)
+    {
+        guint count;
+        if (!pair[i]) continue;
+        count = price_series_count_until (pair[i], t);
+        if (count > 0)
+            *before = price_list_order_pick (*before,
+                                             SERIES_PRICE (pair[i], count - 1),
+                                             TRUE);
+        if (count < pair[i]->nodes->len)
+            *after = price_list_order_pick (*after,
+                                            SERIES_PRICE (pair[i], count),
+                                            FALSE);
+    }
+    return pair[0] || pair[1];
+}
+
 /* ==================================================================== */
 /* GNCPriceDB functions
 
@@ -877,6 +1458,11 @@ gnc_pricedb_create(QofBook * book)
 
     result->commodity_hash = g_hash_table_new(NULL, NULL);
     g_return_val_if_fail (result->commodity_hash, NULL);
+    result->series_hash = price_series_table_new ();
+    result->path_cache = conversion_path_table_new ();
+    result->lookup_cache = price_lookup_table_new ();
+    g_queue_init (&result->lookup_lru);
+    result->commodity_prices = commodity_prices_table_new ();
     return result;
 }
 
@@ -916,6 +1502,18 @@ void
 gnc_pricedb_destroy(GNCPriceDB *db)
 {
     if (!db) return;
+    if (db->bulk_prices)
+    {
+        guint i;
+        for (i = 0; i < db->bulk_prices->len; ++i)
+        {
+            GNCPrice *p = g_ptr_array_index (db->bulk_prices, i);
+            p->db = NULL;
+            gnc_price_unref (p);
+        }
+        g_ptr_array_free (db->bulk_prices, TRUE);
+        db->bulk_prices = NULL;
+    }
     if (db->commodity_hash)
     {
         g_hash_table_foreach (db->commodity_hash,
@@ -924,6 +1522,22 @@ gnc_pricedb_destroy(GNCPriceDB *db)
     }
     g_hash_table_destroy (db->commodity_hash);
     db->commodity_hash = NULL;
+    if (db->series_hash)
+        g_hash_table_destroy (db->series_hash);
+    db->series_hash = NULL;
+    if (db->path_cache)
+        g_hash_table_destroy (db->path_cache);
+    db->path_cache = NULL;
+    g_queue_init (&db->lookup_lru);
+    if (db->lookup_cache)
+        g_hash_table_destroy (db->lookup_cache);
+    db->lookup_cache = NULL;
+    if (db->commodity_prices)
+        g_hash_table_destroy (db->commodity_prices);
+    db->commodity_prices = NULL;
+    if (db->pending_series)
+        g_hash_table_destroy (db->pending_series);
+    db->pending_series = NULL;
     /* qof_instance_release (&db->inst); */
     g_object_unref(db);
 }
@@ -932,6 +1546,12 @@ void
 gnc_pricedb_set_bulk_update(GNCPriceDB *db, gboolean bulk_update)
 {
     db->bulk_update = bulk_update;
+    if (!bulk_update && pricedb_flush_bulk (db))
+    {
+        gnc_pricedb_begin_edit(db);
+        qof_instance_set_dirty(&db->inst);
+        gnc_pricedb_commit_edit(db);
+    }
 }
 
 /* ==================================================================== */
@@ -1102,13 +1722,23 @@ add_price(GNCPriceDB *db, GNCPrice *p)
         LEAVE ("no commodity hash found ");
         return FALSE;
     }
+    if (db->bulk_update)
+    {
+        gnc_price_ref(p);
+        p->db = db;
+        if (!db->bulk_prices)
+            db->bulk_prices = g_ptr_array_new ();
+        g_ptr_array_add (db->bulk_prices, p);
+        LEAVE ("db=%p, pr=%p queued for bulk update", db, p);
+        return TRUE;
+    }
 /* Check for an existing price on the same day. If there is no existing price,
  * add this one. If this price is of equal or better precedence than the old
  * one, copy this one over the old one.
  */
     old_price = gnc_pricedb_lookup_day (db, p->commodity, p->currency,
                                         p->tmspec);
-    if (!db->bulk_update && old_price != NULL)
+    if (old_price != NULL)
     {
         if (p->source > old_price->source)
         {
@@ -1127,9 +1757,9 @@ add_price(GNCPriceDB *db, GNCPrice *p)
     }
 
     price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!gnc_price_list_insert(&price_list, p, !db->bulk_update))
+    if (!price_series_insert(db, &price_list, p, TRUE))
     {
-        LEAVE ("gnc_price_list_insert failed");
+        LEAVE ("price_series_insert failed");
         return FALSE;
     }
 
@@ -1172,9 +1802,13 @@ gnc_pricedb_add_price(GNCPriceDB *db, GNCPrice *p)
         return FALSE;
     }
 
-    gnc_pricedb_begin_edit(db);
-    qof_instance_set_dirty(&db->inst);
-    gnc_pricedb_commit_edit(db);
+    /* Queued prices dirty the database when the bulk update ends. */
+    if (!db->bulk_update)
+    {
+        gnc_pricedb_begin_edit(db);
+        qof_instance_set_dirty(&db->inst);
+        gnc_pricedb_commit_edit(db);
+    }
 
     LEAVE ("db=%p, pr=%p dirty=%d destroying=%d",
            db, p, qof_instance_get_dirty_flag(p),
@@ -1200,6 +1834,14 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
            db, p, qof_instance_get_dirty_flag(p),
            qof_instance_get_destroying(p));
 
+    if (db->bulk_prices && g_ptr_array_remove_fast (db->bulk_prices, p))
+    {
+        /* Still queued, so it was never in a list. */
+        gnc_price_unref(p);
+        LEAVE ("db=%p, pr=%p removed from bulk queue", db, p);
+        return TRUE;
+    }
+
     commodity = gnc_price_get_commodity(p);
     if (!commodity)
     {
@@ -1228,7 +1870,7 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
     qof_event_gen (&p->inst, QOF_EVENT_REMOVE, NULL);
     price_list = g_hash_table_lookup(currency_hash, currency);
     gnc_price_ref(p);
-    if (!gnc_price_list_remove(&price_list, p))
+    if (!price_series_remove(db, &price_list, p))
     {
         gnc_price_unref(p);
         LEAVE (" cannot remove price list");
@@ -1392,6 +2034,7 @@ gnc_pricedb_remove_old_prices(GNCPriceDB *db,
 
     /* Traverse the database once building up an external list of prices
      * to be deleted */
+    gnc_pricedb_load_all_prices (db);
     g_hash_table_foreach(db->commodity_hash,
                          pricedb_remove_foreach_currencies_hash,
                          &data);
@@ -1493,6 +2136,12 @@ pricedb_get_prices_internal(GNCPriceDB *db, const gnc_commodity *commodity,
     PriceList *forward_list = NULL, *reverse_list = NULL;
     g_return_val_if_fail (db != NULL, NULL);
     g_return_val_if_fail (commodity != NULL, NULL);
+    if (!currency)
+        pricedb_load_commodity (db, commodity, earliest_time);
+    else if (bidi)
+        pricedb_load_pairs (db, commodity, currency, earliest_time);
+    else
+        pricedb_load_pair (db, commodity, currency, earliest_time);
     forward_hash = g_hash_table_lookup(db->commodity_hash, commodity);
     if (currency && bidi)
         reverse_hash = g_hash_table_lookup(db->commodity_hash, currency);
@@ -1536,21 +2185,25 @@ gnc_pricedb_lookup_latest(GNCPriceDB *db,
                           const gnc_commodity *commodity,
                           const gnc_commodity *currency)
 {
-    GList *price_list;
-    GNCPrice *result;
-    GHashTable *currency_hash;
+    PriceSeries *forward, *reverse;
+    GNCPrice *result = NULL;
+    QOF_TRACE_BEGIN (start);
 
     if (!db || !commodity || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, commodity, currency);
 
-    price_list = pricedb_get_prices_internal(db, commodity, currency, TRUE);
-    if (!price_list) return NULL;
-    /* This works magically because prices are inserted in date-sorted
-     * order, and the latest date always comes first. So return the
-     * first in the list.  */
-    result = price_list->data;
+    /* The latest price is the newest, i.e. last, in either series. */
+    forward = price_series_lookup (db, commodity, currency);
+    reverse = price_series_lookup (db, currency, commodity);
+    if (forward)
+        result = SERIES_PRICE (forward, forward->nodes->len - 1);
+    if (reverse)
+        result = price_list_order_pick (result,
+                                        SERIES_PRICE (reverse,
+                                                      reverse->nodes->len - 1),
+                                        TRUE);
     gnc_price_ref(result);
-    g_list_free (price_list);
+    QOF_TRACE_END (start, "gnc_pricedb_lookup_latest");
     LEAVE(" ");
     return result;
 }
@@ -1800,6 +2453,7 @@ gnc_pricedb_lookup_nearest_in_time_any_currency(GNCPriceDB *db,
     if (!db || !commodity) return NULL;
     ENTER ("db=%p commodity=%p", db, commodity);
 
+    pricedb_load_commodity (db, commodity, t);
     pricedb_pricelist_traversal(db, price_list_scan_any_currency,
                                        &helper);
     prices = g_list_sort(prices, compare_prices_by_date);
@@ -1821,6 +2475,7 @@ gnc_pricedb_lookup_latest_before_any_currency(GNCPriceDB *db,
     if (!db || !commodity) return NULL;
     ENTER ("db=%p commodity=%p", db, commodity);
 
+    pricedb_load_commodity (db, commodity, t);
     pricedb_pricelist_traversal(db, price_list_scan_any_currency,
                                        &helper);
     prices = g_list_sort(prices, compare_prices_by_date);
@@ -1893,32 +2548,103 @@ gnc_pricedb_get_prices(GNCPriceDB *db,
     return result;
 }
 
-/* Return the number of prices in the data base for the given commodity
+/* The prices of a commodity
+
+   The price editor shows the prices of each commodity in every currency as
+   one list, newest first, and asks for the nth of them and for the position
+   of a price over and over. db->commodity_prices keeps that merged list as
+   an array for each commodity it is asked about, and the positions of its
+   prices once one is looked up. Like the lookup cache, it is forgotten on
+   any change to the prices.
  */
+
+typedef struct
+{
+    GPtrArray *prices;
+    GHashTable *positions;       /* GNCPrice* -> its index + 1 */
+} CommodityPrices;
+
 static void
-price_count_helper(gpointer key, gpointer value, gpointer data)
+commodity_prices_free (gpointer data)
 {
-    int *result = data;
-    GList *price_list = value;
+    CommodityPrices *cp = data;
+    g_ptr_array_free (cp->prices, TRUE);
+    if (cp->positions)
+        g_hash_table_destroy (cp->positions);
+    g_slice_free (CommodityPrices, cp);
+}
 
-    *result += g_list_length(price_list);
+static GHashTable*
+commodity_prices_table_new (void)
+{
+    return g_hash_table_new_full (NULL, NULL, NULL, commodity_prices_free);
+}
+
+static CommodityPrices*
+commodity_prices_get (GNCPriceDB *db, const gnc_commodity *c)
+{
+    CommodityPrices *cp;
+    GHashTable *currency_hash;
+    GHashTableIter iter;
+    gpointer key, value;
+    GList **price_array;
+    int num_currencies, i;
+
+    pricedb_load_commodity (db, c, earliest_time);
+    cp = g_hash_table_lookup (db->commodity_prices, c);
+    if (cp) return cp;
+
+    currency_hash = g_hash_table_lookup (db->commodity_hash, c);
+    if (!currency_hash) return NULL;
+
+    cp = g_slice_new0 (CommodityPrices);
+    cp->prices = g_ptr_array_new ();
+    num_currencies = g_hash_table_size (currency_hash);
+    price_array = g_new (GList *, num_currencies);
+    for (i = 0, g_hash_table_iter_init (&iter, currency_hash);
+         g_hash_table_iter_next (&iter, &key, &value) && i < num_currencies;
+         i++)
+        price_array[i] = value;
+
+    /* Merge the lists, each time taking the latest price of all the
+     * currencies; on the same time the first currency wins. */
+    while (TRUE)
+    {
+        GList **next_list = NULL;
+        int j;
+
+        for (j = 0; j < num_currencies; j++)
+        {
+            if (price_array[j] != NULL &&
+                (next_list == NULL ||
+                 compare_prices_by_date ((*next_list)->data,
+                                         (price_array[j])->data) > 0))
+                next_list = &price_array[j];
+        }
+        if (!next_list)
+            break;
+        g_ptr_array_add (cp->prices, (*next_list)->data);
+        *next_list = (*next_list)->next;
+    }
+    g_free (price_array);
+
+    g_hash_table_insert (db->commodity_prices, (gpointer)c, cp);
+    return cp;
 }
 
 int
 gnc_pricedb_num_prices(GNCPriceDB *db,
                        const gnc_commodity *c)
 {
+    CommodityPrices *cp;
     int result = 0;
-    GHashTable *currency_hash;
 
     if (!db || !c) return 0;
     ENTER ("db=%p commodity=%p", db, c);
 
-    currency_hash = g_hash_table_lookup(db->commodity_hash, c);
-    if (currency_hash)
-    {
-        g_hash_table_foreach(currency_hash, price_count_helper,  (gpointer)&result);
-    }
+    cp = commodity_prices_get (db, c);
+    if (cp)
+        result = cp->prices->len;
 
     LEAVE ("count=%d", result);
     return result;
@@ -1931,93 +2657,54 @@ gnc_pricedb_nth_price (GNCPriceDB *db,
                        const gnc_commodity *c,
                        const int n)
 {
+    CommodityPrices *cp;
     GNCPrice *result = NULL;
-    GHashTable *currency_hash;
 
     if (!db || !c || n < 0) return NULL;
     ENTER ("db=%p commodity=%p index=%d", db, c, n);
 
-    currency_hash = g_hash_table_lookup(db->commodity_hash, c);
-    if (currency_hash)
-    {
-        int num_currencies = g_hash_table_size(currency_hash);
-        if (num_currencies == 1)
-        {
-            /* Optimize the case of prices in only one currency, it's common
-               and much faster */
-            GHashTableIter iter;
-            gpointer key, value;
-            g_hash_table_iter_init(&iter, currency_hash);
-            if (g_hash_table_iter_next(&iter, &key, &value))
-            {
-                PriceList *prices = value;
-                result = g_list_nth_data(prices, n);
-            }
-        }
-        else if (num_currencies > 1)
-        {
-            /* Prices for multiple currencies, must find the nth entry in the
-               merged currency list. */
-            GList **price_array = (GList **)g_new(gpointer, num_currencies);
-            GList **next_list;
-            int i, j;
-            GHashTableIter iter;
-            gpointer key, value;
-
-            /* Build an array of all the currencies this commodity has prices for */
-            for (i = 0, g_hash_table_iter_init(&iter, currency_hash);
-                 g_hash_table_iter_next(&iter, &key, &value) && i < num_currencies;
-                 i++)
-            {
-                price_array[i] = value;
-            }
-
-            /* Iterate n times to get the nth price, each time finding the currency
-               with the latest price */
-            for (i = 0; i <= n; i++)
-            {
-                next_list = NULL;
-                for (j = 0; j < num_currencies; j++)
-                {
-                    /* Save this entry if it's the first one or later than
-                       the saved one. */
-                    if (price_array[j] != NULL &&
-                        (next_list == NULL || *next_list == NULL ||
-                        compare_prices_by_date((*next_list)->data, (price_array[j])->data) > 0))
-                    {
-                        next_list = &price_array[j];
-                    }
-                }
-                /* next_list points to the list with the latest price unless all
-                   the lists are empty */
-                if (next_list && *next_list)
-                {
-                    result = (*next_list)->data;
-                    *next_list = (*next_list)->next;
-                }
-                else
-                {
-                    /* all the lists are empty, "n" is greater than the number
-                       of prices for this commodity. */
-                    result = NULL;
-                    break;
-                }
-            }
-            g_free(price_array);
-        }
-    }
+    cp = commodity_prices_get (db, c);
+    if (cp && (guint)n < cp->prices->len)
+        result = g_ptr_array_index (cp->prices, n);
 
     LEAVE ("price=%p", result);
     return result;
 }
 
+int
+gnc_pricedb_nth_price_index (GNCPriceDB *db, const GNCPrice *p)
+{
+    CommodityPrices *cp;
+    guint i;
+
+    if (!db || !p || !p->commodity) return -1;
+
+    cp = commodity_prices_get (db, p->commodity);
+    if (!cp) return -1;
+
+    if (!cp->positions)
+    {
+        cp->positions = g_hash_table_new (NULL, NULL);
+        for (i = 0; i < cp->prices->len; i++)
+            g_hash_table_insert (cp->positions,
+                                 g_ptr_array_index (cp->prices, i),
+                                 GUINT_TO_POINTER (i + 1));
+    }
+    return (int)GPOINTER_TO_UINT (g_hash_table_lookup (cp->positions, p)) - 1;
+}
+
 GNCPrice *
 gnc_pricedb_lookup_day(GNCPriceDB *db,
                        const gnc_commodity *c,
                        const gnc_commodity *currency,
                        Timespec t)
 {
-    return lookup_nearest_in_time(db, c, currency, t, TRUE);
+    GNCPrice *result;
+    QOF_TRACE_BEGIN (start);
+
+    result = lookup_nearest_in_time(db, c, currency, t, TRUE);
+    QOF_TRACE_END (start, "gnc_pricedb_lookup_day");
+    return result;
 }
 
 GNCPrice *
@@ -2026,31 +2713,162 @@ gnc_pricedb_lookup_at_time(GNCPriceDB *db,
                            const gnc_commodity *currency,
                            Timespec t)
 {
-    GList *price_list;
-    GList *item = NULL;
-    GHashTable *currency_hash;
+    GNCPrice *before, *after;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    item = price_list;
-    while (item)
+    /* The first price not later than t is the one at t if there is one. */
+    price_series_bracket (db, c, currency, t, &before, &after);
+    if (before)
     {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
+        Timespec price_time = gnc_price_get_time(before);
         if (timespec_equal(&price_time, &t))
         {
-            gnc_price_ref(p);
-            g_list_free (price_list);
-            return p;
+            gnc_price_ref(before);
+            LEAVE (" ");
+            return before;
         }
-        item = item->next;
     }
-    g_list_free (price_list);
     LEAVE (" ");
     return NULL;
 }
 
+/* Lookup results
+
+   Reports ask for the same commodity, currency and date over and over, once
+   for each account holding the commodity. The results of the nearest-in-time
+   and latest-before searches are kept in db->lookup_cache, with
+   db->lookup_lru holding the entries most recently used first so that the
+   oldest can be dropped once there are PRICE_LOOKUP_CACHE_SIZE of them.
+   Since any change to a price list can change any result the whole cache is
+   forgotten then. The cached prices aren't reffed: they stay in the database
+   as long as the cache isn't emptied.
+ */
+
+#define PRICE_LOOKUP_CACHE_SIZE 256
+
+typedef enum
+{
+    PRICE_LOOKUP_NEAREST,
+    PRICE_LOOKUP_NEAREST_SAMEDAY,
+    PRICE_LOOKUP_LATEST_BEFORE,
+} PriceLookupKind;
+
+typedef struct
+{
+    CommodityPair pair;
+    Timespec t;
+    PriceLookupKind kind;
+} PriceLookupKey;
+
+typedef struct
+{
+    PriceLookupKey key;
+    GNCPrice *price;
+    GList link;                 /* In db->lookup_lru */
+} PriceLookupEntry;
+
+static guint
+price_lookup_hash (gconstpointer key)
+{
+    const PriceLookupKey *k = key;
+    guint hash = commodity_pair_hash (&k->pair);
+    hash = hash * 31 + (guint)k->t.tv_sec;
+    hash = hash * 31 + (guint)k->t.tv_nsec;
+    return hash * 31 + k->kind;
+}
+
+static gboolean
+price_lookup_equal (gconstpointer a, gconstpointer b)
+{
+    const PriceLookupKey *ka = a;
+    const PriceLookupKey *kb = b;
+    return commodity_pair_equal (&ka->pair, &kb->pair) &&
+        ka->kind == kb->kind && timespec_equal (&ka->t, &kb->t);
+}
+
+static void
+price_lookup_entry_free (gpointer data)
+{
+    g_slice_free (PriceLookupEntry, data);
+}
+
+static GHashTable*
+price_lookup_table_new (void)
+{
+    return g_hash_table_new_full (price_lookup_hash, price_lookup_equal,
+                                  NULL, price_lookup_entry_free);
+}
+
+static void
+pricedb_forget_lookups (GNCPriceDB *db)
+{
+    mod_count++;
+    /* The links live in the entries, so the queue doesn't own anything. */
+    g_queue_init (&db->lookup_lru);
+    if (db->lookup_cache)
+        g_hash_table_remove_all (db->lookup_cache);
+    if (db->commodity_prices)
+        g_hash_table_remove_all (db->commodity_prices);
+}
+
+/* Find a cached result. Returns FALSE on a miss; on a hit *result is set to
+ * the cached price, which may be NULL, with a reference added. */
+static gboolean
+price_lookup_cached (GNCPriceDB *db, const gnc_commodity *c,
+                     const gnc_commodity *currency, Timespec t,
+                     PriceLookupKind kind, GNCPrice **result)
+{
+    PriceLookupKey key = {{c, currency}, t, kind};
+    PriceLookupEntry *entry;
+
+    if (!db->lookup_cache) return FALSE;
+    entry = g_hash_table_lookup (db->lookup_cache, &key);
+    if (!entry)
+    {
+        ++db->lookup_misses;
+        return FALSE;
+    }
+    ++db->lookup_hits;
+    g_queue_unlink (&db->lookup_lru, &entry->link);
+    g_queue_push_head_link (&db->lookup_lru, &entry->link);
+    gnc_price_ref (entry->price);
+    *result = entry->price;
+    return TRUE;
+}
+
+static void
+price_lookup_remember (GNCPriceDB *db, const gnc_commodity *c,
+                       const gnc_commodity *currency, Timespec t,
+                       PriceLookupKind kind, GNCPrice *result)
+{
+    PriceLookupEntry *entry;
+
+    if (!db->lookup_cache) return;
+    if (db->lookup_lru.length >= PRICE_LOOKUP_CACHE_SIZE)
+    {
+        GList *oldest = g_queue_pop_tail_link (&db->lookup_lru);
+        entry = oldest->data;
+        g_hash_table_remove (db->lookup_cache, &entry->key);
+    }
+    entry = g_slice_new0 (PriceLookupEntry);
+    entry->key.pair.commodity = c;
+    entry->key.pair.currency = currency;
+    entry->key.t = t;
+    entry->key.kind = kind;
+    entry->price = result;
+    entry->link.data = entry;
+    g_queue_push_head_link (&db->lookup_lru, &entry->link);
+    g_hash_table_insert (db->lookup_cache, &entry->key, entry);
+}
+
+void
+gnc_pricedb_get_lookup_stats (GNCPriceDB *db, guint64 *hits, guint64 *misses)
+{
+    if (hits) *hits = db ? db->lookup_hits : 0;
+    if (misses) *misses = db ? db->lookup_misses : 0;
+}
+
 static GNCPrice *
 lookup_nearest_in_time(GNCPriceDB *db,
                        const gnc_commodity *c,
@@ -2058,36 +2876,31 @@ lookup_nearest_in_time(GNCPriceDB *db,
                        Timespec t,
                        gboolean sameday)
 {
-    GList *price_list;
     GNCPrice *current_price = NULL;
     GNCPrice *next_price = NULL;
     GNCPrice *result = NULL;
-    GList *item = NULL;
-    GHashTable *currency_hash;
+    PriceLookupKind kind = sameday ? PRICE_LOOKUP_NEAREST_SAMEDAY :
+        PRICE_LOOKUP_NEAREST;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-
-    /* default answer */
-    current_price = item->data;
-
-    /* find the first candidate past the one we want.  Remember that
-       prices are in most-recent-first order. */
-    while (!next_price && item)
+    if (price_lookup_cached (db, c, currency, t, kind, &result))
     {
-        GNCPrice *p = item->data;
-        Timespec price_time = gnc_price_get_time(p);
-        if (timespec_cmp(&price_time, &t) <= 0)
-        {
-            next_price = item->data;
-            break;
-        }
-        current_price = item->data;
-        item = item->next;
+        LEAVE (" cached");
+        return result;
+    }
+    /* In the merged most-recent-first list of prices, next_price is the
+       first candidate not later than the one we want and current_price the
+       one just before it, or next_price itself if it heads the list. */
+    if (!price_series_bracket (db, c, currency, t, &next_price,
+                               &current_price))
+    {
+        price_lookup_remember (db, c, currency, t, kind, NULL);
+        LEAVE (" no prices");
+        return NULL;
     }
+    if (!current_price)
+        current_price = next_price;
 
     if (current_price)      /* How can this be null??? */
     {
@@ -2158,8 +2971,8 @@ lookup_nearest_in_time(GNCPriceDB *db,
         }
     }
 
+    price_lookup_remember (db, c, currency, t, kind, result);
     gnc_price_ref(result);
-    g_list_free (price_list);
     LEAVE (" ");
     return result;
 }
@@ -2170,7 +2983,12 @@ gnc_pricedb_lookup_nearest_in_time(GNCPriceDB *db,
                                    const gnc_commodity *currency,
                                    Timespec t)
 {
-    return lookup_nearest_in_time(db, c, currency, t, FALSE);
+    GNCPrice *result;
+    QOF_TRACE_BEGIN (start);
+
+    result = lookup_nearest_in_time(db, c, currency, t, FALSE);
+    QOF_TRACE_END (start, "gnc_pricedb_lookup_nearest_in_time");
+    return result;
 }
 
 GNCPrice *
@@ -2179,29 +2997,21 @@ gnc_pricedb_lookup_latest_before (GNCPriceDB *db,
                                   gnc_commodity *currency,
                                   Timespec t)
 {
-    GList *price_list;
     GNCPrice *current_price = NULL;
-    /*  GNCPrice *next_price = NULL;
-        GNCPrice *result = NULL;*/
-    GList *item = NULL;
-    GHashTable *currency_hash;
-    Timespec price_time;
+    GNCPrice *later_price = NULL;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-    do
+    if (price_lookup_cached (db, c, currency, t, PRICE_LOOKUP_LATEST_BEFORE,
+                             &current_price))
     {
-        price_time = gnc_price_get_time (item->data);
-        if (timespec_cmp(&price_time, &t) <= 0)
-            current_price = item->data;
-        item = item->next;
+        LEAVE (" cached");
+        return current_price;
     }
-    while (timespec_cmp(&price_time, &t) > 0 && item);
+    price_series_bracket (db, c, currency, t, &current_price, &later_price);
+    price_lookup_remember (db, c, currency, t, PRICE_LOOKUP_LATEST_BEFORE,
+                           current_price);
     gnc_price_ref(current_price);
-    g_list_free (price_list);
     LEAVE (" ");
     return current_price;
 }
@@ -2242,43 +3052,105 @@ typedef struct
     GNCPrice *to;
 } PriceTuple;
 
-static PriceTuple
-extract_common_prices (PriceList *from_prices, PriceList *to_prices)
+/* Conversion paths
+
+   When there's no price between two commodities the conversion goes
+   through a third one that has prices with both. Finding the candidates
+   means looking at every price series in the database, so the result is
+   kept per (from, to) pair in db->path_cache until a series is created or
+   dropped, which are the only changes that can alter it.
+ */
+
+typedef struct
 {
-    PriceTuple retval = {NULL, NULL};
-    GList *from_node = NULL, *to_node = NULL;
-    GNCPrice *from_price, *to_price;
+    CommodityPair key;
+    GList *bridges;     /* gnc_commodity* with prices to both from and to */
+} ConversionPath;
 
-    for (from_node = from_prices; from_node != NULL;
-         from_node = g_list_next(from_node))
-    {
-        for (to_node = to_prices; to_node != NULL;
-             to_node = g_list_next(to_node))
-        {
-            gnc_commodity *to_com, *to_cur;
-            gnc_commodity *from_com, *from_cur;
-            to_price = GNC_PRICE(to_node->data);
-            from_price = GNC_PRICE(from_node->data);
-            to_com = gnc_price_get_commodity (to_price);
-            to_cur = gnc_price_get_currency (to_price);
-            from_com = gnc_price_get_commodity (from_price);
-            from_cur = gnc_price_get_currency (from_price);
-            if (to_com == from_com || to_com == from_cur ||
-                to_cur == from_com || to_cur == from_cur)
-                break;
-            to_price = NULL;
-            from_price = NULL;
-        }
-        if (to_price != NULL && from_price != NULL)
-            break;
-    }
-    if (from_price == NULL || to_price == NULL)
-        return retval;
-    gnc_price_ref(from_price);
-    gnc_price_ref(to_price);
-    retval.from = from_price;
-    retval.to = to_price;
-    return retval;
+static void
+conversion_path_free (gpointer data)
+{
+    ConversionPath *path = data;
+    g_list_free (path->bridges);
+    g_slice_free (ConversionPath, path);
+}
+
+static GHashTable*
+conversion_path_table_new (void)
+{
+    return g_hash_table_new_full (commodity_pair_hash, commodity_pair_equal,
+                                  conversion_path_free, NULL);
+}
+
+static void
+pricedb_forget_conversion_paths (GNCPriceDB *db)
+{
+    if (db->path_cache)
+        g_hash_table_remove_all (db->path_cache);
+}
+
+typedef struct
+{
+    const gnc_commodity *from;
+    const gnc_commodity *to;
+    GHashTable *from_peers;
+    GHashTable *to_peers;
+} ConversionPeers;
+
+static void
+collect_conversion_peers (gpointer key, gpointer value, gpointer user_data)
+{
+    const CommodityPair *pair = key;
+    ConversionPeers *peers = user_data;
+    if (pair->commodity == peers->from)
+        g_hash_table_insert (peers->from_peers, (gpointer)pair->currency, NULL);
+    else if (pair->currency == peers->from)
+        g_hash_table_insert (peers->from_peers, (gpointer)pair->commodity, NULL);
+    if (pair->commodity == peers->to)
+        g_hash_table_insert (peers->to_peers, (gpointer)pair->currency, NULL);
+    else if (pair->currency == peers->to)
+        g_hash_table_insert (peers->to_peers, (gpointer)pair->commodity, NULL);
+}
+
+static GList*
+pricedb_conversion_bridges (GNCPriceDB *db, const gnc_commodity *from,
+                            const gnc_commodity *to)
+{
+    CommodityPair key = {from, to};
+    ConversionPath *path = g_hash_table_lookup (db->path_cache, &key);
+    if (!path)
+    {
+        ConversionPeers peers = {from, to, g_hash_table_new (NULL, NULL),
+                                 g_hash_table_new (NULL, NULL)};
+        GHashTableIter iter;
+        gpointer peer;
+
+        g_hash_table_foreach (db->series_hash, collect_conversion_peers,
+                              &peers);
+        path = g_slice_new (ConversionPath);
+        path->key = key;
+        path->bridges = NULL;
+        g_hash_table_iter_init (&iter, peers.from_peers);
+        while (g_hash_table_iter_next (&iter, &peer, NULL))
+            if (peer != to && g_hash_table_lookup_extended (peers.to_peers,
+                                                            peer, NULL, NULL))
+                path->bridges = g_list_prepend (path->bridges, peer);
+        g_hash_table_destroy (peers.from_peers);
+        g_hash_table_destroy (peers.to_peers);
+        g_hash_table_insert (db->path_cache, path, path);
+    }
+    return path->bridges;
+}
+
+static GNCPrice*
+conversion_price (GNCPriceDB *db, const gnc_commodity *a,
+                  const gnc_commodity *b, Timespec *t)
+{
+    if (t)
+        return gnc_pricedb_lookup_nearest_in_time (db, a, b, *t);
+    return gnc_pricedb_lookup_latest_before (db, (gnc_commodity*)a,
+                                             (gnc_commodity*)b,
+                                             timespec_now ());
 }
 
 static gnc_numeric
@@ -2295,13 +3167,11 @@ convert_balance(gnc_numeric bal, const gnc_commodity *from,
 
     int no_round = GNC_HOW_DENOM_EXACT | GNC_HOW_RND_NEVER;
     if (from_cur == from && to_cur == to)
-        return gnc_numeric_div(gnc_numeric_mul(bal, to_val, GNC_DENOM_AUTO,
-                                               no_round),
-                               from_val, fraction, GNC_HOW_RND_ROUND);
+        return gnc_numeric_mul_div(bal, to_val, from_val, fraction,
+                                   GNC_HOW_RND_ROUND);
     if (from_com == from && to_com == to)
-        return gnc_numeric_div(gnc_numeric_mul(bal, from_val, GNC_DENOM_AUTO,
-                                               no_round),
-                               to_val, fraction, GNC_HOW_RND_ROUND);
+        return gnc_numeric_mul_div(bal, from_val, to_val, fraction,
+                                   GNC_HOW_RND_ROUND);
     if (from_cur == from)
         return gnc_numeric_div(bal, gnc_numeric_mul(from_val, to_val,
                                                     GNC_DENOM_AUTO, no_round),
@@ -2316,37 +3186,45 @@ indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
                              const gnc_commodity *from, const gnc_commodity *to,
                              Timespec *t )
 {
-    GList *from_prices = NULL, *to_prices = NULL;
-    PriceTuple tuple;
-    gnc_numeric zero = gnc_numeric_zero();
+    PriceTuple tuple = {NULL, NULL};
+    gnc_numeric retval = gnc_numeric_zero();
+    GList *node;
     if (from == NULL || to == NULL)
-        return zero;
+        return retval;
     if (gnc_numeric_zero_p(bal))
-        return zero;
-    if (t == NULL)
-    {
-        from_prices = gnc_pricedb_lookup_latest_any_currency(db, from);
-        /* "to" is often the book currency which may have lots of prices,
-            so avoid getting them if they aren't needed. */
-        if (from_prices)
-            to_prices = gnc_pricedb_lookup_latest_any_currency(db, to);
+        return retval;
+    /* Use the bridge with the most recent price for "from", which is the one
+       that the from-side price list used to put first. */
+    for (node = pricedb_conversion_bridges (db, from, to); node;
+         node = g_list_next (node))
+    {
+        GNCPrice *from_price, *to_price;
+        from_price = conversion_price (db, from, node->data, t);
+        if (!from_price)
+            continue;
+        if (tuple.from && compare_prices_by_date (tuple.from, from_price) <= 0)
+        {
+            gnc_price_unref (from_price);
+            continue;
+        }
+        to_price = conversion_price (db, to, node->data, t);
+        if (!to_price)
+        {
+            gnc_price_unref (from_price);
+            continue;
+        }
+        gnc_price_unref (tuple.from);
+        gnc_price_unref (tuple.to);
+        tuple.from = from_price;
+        tuple.to = to_price;
     }
-    else
-    {
-        from_prices = gnc_pricedb_lookup_nearest_in_time_any_currency(db,
-                                                                      from, *t);
-        if (from_prices)
-            to_prices = gnc_pricedb_lookup_nearest_in_time_any_currency(db,
-                                                                    to, *t);
-    }
-    if (from_prices == NULL || to_prices == NULL)
-        return zero;
-    tuple = extract_common_prices(from_prices, to_prices);
-    gnc_price_list_destroy(from_prices);
-    gnc_price_list_destroy(to_prices);
     if (tuple.from)
-        return convert_balance(bal, from, to, tuple);
-    return zero;
+    {
+        retval = convert_balance(bal, from, to, tuple);
+        gnc_price_unref (tuple.from);
+        gnc_price_unref (tuple.to);
+    }
+    return retval;
 }
 
 
@@ -2598,6 +3476,8 @@ gnc_pricedb_foreach_price(GNCPriceDB *db,
                           gboolean stable_order)
 {
     ENTER ("db=%p f=%p", db, f);
+    if (db)
+        gnc_pricedb_load_all_prices (db);
     if (stable_order)
     {
         LEAVE (" stable order found");
@@ -2947,4 +3827,80 @@ gnc_pricedb_register (void)
     return qof_object_register (&pricedb_object_def);
 }
 
+/* ==================================================================== */
+/* Memory accounting.  The prices themselves are instances and counted
+   with the book's collections; this is what the database keeps around
+   them.  A hash table entry is taken as three pointers and a table as
+   the 64 bytes of its header. */
+
+#define HASH_TABLE_BYTES 64
+#define HASH_ENTRY_BYTES (3 * sizeof (gpointer))
+
+static void
+pricedb_memory_currency (gpointer key, gpointer val, gpointer user_data)
+{
+    gsize *bytes = user_data;
+    *bytes += HASH_ENTRY_BYTES + g_list_length (val) * sizeof (GList);
+}
+
+static void
+pricedb_memory_commodity (gpointer key, gpointer val, gpointer user_data)
+{
+    gsize *bytes = user_data;
+    *bytes += HASH_ENTRY_BYTES + HASH_TABLE_BYTES;
+    g_hash_table_foreach (val, pricedb_memory_currency, bytes);
+}
+
+static void
+pricedb_memory_series (gpointer key, gpointer val, gpointer user_data)
+{
+    PriceSeries *series = val;
+    gsize *bytes = user_data;
+    *bytes += HASH_ENTRY_BYTES + sizeof (PriceSeries) + sizeof (GPtrArray) +
+              series->nodes->len * sizeof (gpointer);
+}
+
+static void
+pricedb_memory_path (gpointer key, gpointer val, gpointer user_data)
+{
+    ConversionPath *path = val;
+    gsize *bytes = user_data;
+    *bytes += HASH_ENTRY_BYTES + sizeof (ConversionPath) +
+              g_list_length (path->bridges) * sizeof (GList);
+}
+
+static void
+pricedb_memory_commodity_prices (gpointer key, gpointer val, gpointer user_data)
+{
+    CommodityPrices *cp = val;
+    gsize *bytes = user_data;
+    *bytes += HASH_ENTRY_BYTES + sizeof (CommodityPrices) +
+              cp->prices->len * sizeof (gpointer);
+    if (cp->positions)
+        *bytes += HASH_TABLE_BYTES + cp->prices->len * HASH_ENTRY_BYTES;
+}
+
+gsize
+gnc_pricedb_get_memory_usage (GNCPriceDB *db)
+{
+    gsize bytes;
+
+    if (!db) return 0;
+    bytes = 5 * HASH_TABLE_BYTES;
+    if (db->commodity_hash)
+        g_hash_table_foreach (db->commodity_hash, pricedb_memory_commodity,
+                              &bytes);
+    if (db->series_hash)
+        g_hash_table_foreach (db->series_hash, pricedb_memory_series, &bytes);
+    if (db->path_cache)
+        g_hash_table_foreach (db->path_cache, pricedb_memory_path, &bytes);
+    if (db->lookup_cache)
+        bytes += g_hash_table_size (db->lookup_cache) *
+                 (HASH_ENTRY_BYTES + sizeof (PriceLookupEntry));
+    if (db->commodity_prices)
+        g_hash_table_foreach (db->commodity_prices,
+                              pricedb_memory_commodity_prices, &bytes);
+    return bytes;
+}
+
 /* ========================= END OF FILE ============================== */
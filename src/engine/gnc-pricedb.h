@@ -346,14 +346,52 @@ void gnc_pricedb_begin_edit (GNCPriceDB *);
 /** @brief Commit an edit. */
 void gnc_pricedb_commit_edit (GNCPriceDB *);
 
-/** @brief Set flag to indicate whether duplication checks should be performed.
+/** @brief Set flag to indicate whether prices are being added in bulk.
  *
- * Normally used at load time to speed up loading the pricedb.
+ * Normally used at load time to speed up loading the pricedb. While the flag
+ * is set added prices are only queued and aren't found by lookups; clearing
+ * it sorts the queued prices into their lists in one pass, dropping
+ * duplicates, and marks the pricedb dirty once.
  * @param db The pricedb
- * @param bulk_update TRUE to disable duplication checks, FALSE to enable them.
+ * @param bulk_update TRUE to start queueing prices, FALSE to add the queued
+ * prices.
  */
 void gnc_pricedb_set_bulk_update(GNCPriceDB *db, gboolean bulk_update);
 
+/** A backend that leaves the older prices of some pairs in the database
+ * registers one of these to load them as they are needed.  It loads the
+ * prices of @a commodity in @a currency dated before @a loaded_since and
+ * no earlier than the latest one dated no later than @a t, or all those
+ * before @a loaded_since if there is no such price or @a t.tv_sec is
+ * INT64_MIN.  If it leaves earlier prices behind it marks the pair
+ * pending again with gnc_pricedb_set_prices_pending().
+ */
+typedef void (*PriceDBPricesLoader) (QofBackend *be, GNCPriceDB *db,
+                                     const gnc_commodity *commodity,
+                                     const gnc_commodity *currency,
+                                     Timespec t, Timespec loaded_since);
+
+/** @brief Set the function pending prices are loaded with. */
+void gnc_pricedb_set_prices_loader (PriceDBPricesLoader loader);
+
+/** @brief Mark whether prices of a pair are still in the backend.
+ *
+ * Only backends should call this.  Lookups that need prices of @a
+ * commodity in @a currency dated before @a loaded_since have the
+ * PriceDBPricesLoader load them first; iterating over all the prices
+ * loads everything.
+ * @param db The pricedb
+ * @param loaded_since The pair's prices from this date on are all in the
+ * pricedb; it must be the date of one of them.  NULL if all are.
+ */
+void gnc_pricedb_set_prices_pending (GNCPriceDB *db,
+                                     const gnc_commodity *commodity,
+                                     const gnc_commodity *currency,
+                                     const Timespec *loaded_since);
+
+/** @brief Load every price still pending in the backend. */
+void gnc_pricedb_load_all_prices (GNCPriceDB *db);
+
 /** @brief Add a price to the pricedb.
  *
  * You may drop your reference to the price (i.e. call unref) after this
@@ -608,7 +646,36 @@ gnc_pricedb_nth_price (GNCPriceDB *db,
                        const gnc_commodity *c,
                        const int n);
 
+/** @brief Get the position of a price among the prices of its commodity
+ * @param db The pricedb
+ * @param p The price
+ * @return The index at which gnc_pricedb_nth_price() returns p, or -1 if p
+ * isn't in the database. Like gnc_pricedb_nth_price() this takes constant
+ * time until the prices change.
+ */
+int
+gnc_pricedb_nth_price_index (GNCPriceDB *db, const GNCPrice *p);
+
+/** @brief Report how well the lookup result cache is doing.
+ *
+ * gnc_pricedb_lookup_nearest_in_time() and
+ * gnc_pricedb_lookup_latest_before() remember their most recent results
+ * until a price is added or removed.
+ * @param db The pricedb
+ * @param hits Set to the number of lookups answered from the cache.
+ * @param misses Set to the number of lookups that had to search.
+ */
+void gnc_pricedb_get_lookup_stats (GNCPriceDB *db, guint64 *hits,
+                                   guint64 *misses);
+
 /* The following two convenience functions are used to test the xml backend */
+/** @brief Estimate the bytes the database holds besides the prices:
+ * their lists and series, and the lookup and conversion caches.
+ *
+ * @param db The pricedb
+ */
+gsize gnc_pricedb_get_memory_usage (GNCPriceDB *db);
+
 /** @brief Return the number of prices in the database.
  *
  * For XML Backend Testing
@@ -30,9 +30,33 @@
 static QofSession * current_session = NULL;
 static QofLogModule log_module = GNC_MOD_ENGINE;
 
+/* The session a thread has put in place of the current one. */
+#ifndef HAVE_GLIB_2_32
+static GStaticPrivate thread_session_key = G_STATIC_PRIVATE_INIT;
+#define thread_session_get() g_static_private_get (&thread_session_key)
+#define thread_session_set(s) g_static_private_set (&thread_session_key, s, NULL)
+#else
+static GPrivate thread_session_key = G_PRIVATE_INIT (NULL);
+#define thread_session_get() g_private_get (&thread_session_key)
+#define thread_session_set(s) g_private_set (&thread_session_key, s)
+#endif
+
+QofSession *
+gnc_set_thread_session (QofSession *session)
+{
+    QofSession *old = thread_session_get ();
+    thread_session_set (session);
+    return old;
+}
+
 QofSession *
 gnc_get_current_session (void)
 {
+    QofSession *session = thread_session_get ();
+
+    if (session)
+        return session;
+
     if (!current_session)
     {
         qof_event_suspend();
@@ -46,7 +70,7 @@ gnc_get_current_session (void)
 gboolean
 gnc_current_session_exist(void)
 {
-    return (current_session != NULL);
+    return (thread_session_get () != NULL || current_session != NULL);
 }
 
 void
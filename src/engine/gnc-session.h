@@ -25,3 +25,10 @@ QofSession * gnc_get_current_session (void);
 void gnc_clear_current_session(void);
 void gnc_set_current_session (QofSession *session);
 gboolean gnc_current_session_exist(void);
+
+/** Make session the calling thread's current session, in place of the
+ * one the other threads share, so that gnc_get_current_session() and
+ * gnc_get_current_book() work on it there.  The session isn't owned;
+ * NULL returns the thread to the shared session.
+ * @return The session that was set for the thread before, if any. */
+QofSession * gnc_set_thread_session (QofSession *session);
@@ -0,0 +1,315 @@
+/********************************************************************\
+ * gncAging.c -- Business Interface:  A/R and A/P aging             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "gncAging.h"
+#include "gncBusiness.h"
+#include "gncInvoice.h"
+#include "gnc-lot.h"
+#include "Split.h"
+#include "Transaction.h"
+
+struct _gncAging
+{
+    GArray *bucket_ends;        /* Timespec, increasing */
+    GList *owners;              /* GncAgingOwner, in order of appearance */
+    GHashTable *owner_hash;     /* owner GncGUID* -> GncAgingOwner */
+};
+
+struct _gncAgingOwner
+{
+    GncOwner owner;
+    gnc_commodity *currency;
+    gnc_numeric *buckets;
+    guint n_buckets;
+    gnc_numeric overpayment;
+};
+
+static QofLogModule log_module = GNC_MOD_BUSINESS;
+
+GncAging *
+gncAgingNew (void)
+{
+    GncAging *aging = g_new0 (GncAging, 1);
+
+    aging->bucket_ends = g_array_new (FALSE, FALSE, sizeof (Timespec));
+    aging->owner_hash = g_hash_table_new (guid_hash_to_guint,
+                                          guid_g_hash_table_equal);
+    return aging;
+}
+
+static void
+aging_clear_owners (GncAging *aging)
+{
+    GList *node;
+
+    g_hash_table_remove_all (aging->owner_hash);
+    for (node = aging->owners; node; node = node->next)
+    {
+        GncAgingOwner *ao = node->data;
+        g_free (ao->buckets);
+        g_free (ao);
+    }
+    g_list_free (aging->owners);
+    aging->owners = NULL;
+}
+
+void
+gncAgingDestroy (GncAging *aging)
+{
+    if (!aging) return;
+    aging_clear_owners (aging);
+    g_hash_table_destroy (aging->owner_hash);
+    g_array_free (aging->bucket_ends, TRUE);
+    g_free (aging);
+}
+
+void
+gncAgingAddBucket (GncAging *aging, Timespec end)
+{
+    g_return_if_fail (aging);
+    g_return_if_fail (!aging->owners);
+    g_array_append_val (aging->bucket_ends, end);
+}
+
+guint
+gncAgingGetNumBuckets (const GncAging *aging)
+{
+    g_return_val_if_fail (aging, 0);
+    return aging->bucket_ends->len;
+}
+
+/* The owner of the document or payment the split belongs to: that of
+ * the transaction's invoice, else that of the first lot among the
+ * transaction's splits that has an invoice or an owner. */
+static gboolean
+aging_owner_from_split (Split *split, GncOwner *result)
+{
+    Transaction *txn = xaccSplitGetParent (split);
+    GncInvoice *invoice = gncInvoiceGetInvoiceFromTxn (txn);
+    GncOwner lot_owner;
+    const GncOwner *owner = NULL;
+    GList *node;
+
+    if (invoice)
+        owner = gncInvoiceGetOwner (invoice);
+    for (node = xaccTransGetSplitList (txn); !owner && node; node = node->next)
+    {
+        GNCLot *lot = xaccSplitGetLot (node->data);
+
+        if (!lot)
+            continue;
+        invoice = gncInvoiceGetInvoiceFromLot (lot);
+        if (invoice)
+            owner = gncInvoiceGetOwner (invoice);
+        else if (gncOwnerGetOwnerFromLot (lot, &lot_owner))
+            owner = &lot_owner;
+    }
+    if (!owner || !gncOwnerIsValid (gncOwnerGetEndOwner (owner)))
+        return FALSE;
+
+    gncOwnerCopy (gncOwnerGetEndOwner (owner), result);
+    return TRUE;
+}
+
+/* A document: use up the overpayment, then age what is left */
+static void
+aging_add_document (GncAging *aging, GncAgingOwner *ao, gnc_numeric amount,
+                    Timespec date)
+{
+    guint i, last = aging->bucket_ends->len - 1;
+
+    if (gnc_numeric_compare (amount, ao->overpayment) >= 0)
+    {
+        amount = gnc_numeric_sub_fixed (amount, ao->overpayment);
+        ao->overpayment = gnc_numeric_zero ();
+    }
+    else
+    {
+        ao->overpayment = gnc_numeric_sub_fixed (ao->overpayment, amount);
+        amount = gnc_numeric_zero ();
+    }
+
+    for (i = 0; i < last; i++)
+    {
+        Timespec end = g_array_index (aging->bucket_ends, Timespec, i);
+        if (timespec_cmp (&date, &end) < 0)
+            break;
+    }
+    ao->buckets[i] = gnc_numeric_add_fixed (ao->buckets[i], amount);
+}
+
+/* A payment: pay off the oldest buckets first.  Payments are assumed
+ * to be applied in FIFO order, whatever lots they were linked to. */
+static void
+aging_add_payment (GncAging *aging, GncAgingOwner *ao, gnc_numeric amount)
+{
+    guint i;
+
+    if (gnc_numeric_positive_p (ao->overpayment))
+    {
+        ao->overpayment = gnc_numeric_add_fixed (ao->overpayment, amount);
+        return;
+    }
+
+    for (i = 0; i < aging->bucket_ends->len; i++)
+    {
+        if (gnc_numeric_compare (ao->buckets[i], amount) >= 0)
+        {
+            ao->buckets[i] = gnc_numeric_sub_fixed (ao->buckets[i], amount);
+            amount = gnc_numeric_zero ();
+            break;
+        }
+        amount = gnc_numeric_sub_fixed (amount, ao->buckets[i]);
+        ao->buckets[i] = gnc_numeric_zero ();
+    }
+    ao->overpayment = amount;
+}
+
+static GncAgingOwner *
+aging_get_owner (GncAging *aging, const GncOwner *owner,
+                 gnc_commodity *currency)
+{
+    GncAgingOwner *ao;
+    guint i;
+
+    ao = g_hash_table_lookup (aging->owner_hash, gncOwnerGetGUID (owner));
+    if (ao)
+        return ao;
+
+    ao = g_new0 (GncAgingOwner, 1);
+    gncOwnerCopy (owner, &ao->owner);
+    ao->currency = currency;
+    ao->n_buckets = aging->bucket_ends->len;
+    ao->buckets = g_new (gnc_numeric, ao->n_buckets);
+    for (i = 0; i < ao->n_buckets; i++)
+        ao->buckets[i] = gnc_numeric_zero ();
+    ao->overpayment = gnc_numeric_zero ();
+
+    aging->owners = g_list_prepend (aging->owners, ao);
+    g_hash_table_insert (aging->owner_hash,
+                         (gpointer)gncOwnerGetGUID (&ao->owner), ao);
+    return ao;
+}
+
+void
+gncAgingRun (GncAging *aging, Account *acc, Timespec to_date,
+             gboolean reverse, gboolean use_post_date, gboolean show_zeros)
+{
+    gint i, n_splits;
+
+    g_return_if_fail (aging && acc);
+    g_return_if_fail (aging->bucket_ends->len > 0);
+
+    aging_clear_owners (aging);
+
+    /* The splits come sorted by the date posted */
+    n_splits = gnc_account_n_splits (acc);
+    for (i = 0; i < n_splits; i++)
+    {
+        Split *split = gnc_account_nth_split (acc, i);
+        Transaction *txn = xaccSplitGetParent (split);
+        Timespec posted = xaccTransRetDatePostedTS (txn);
+        GNCLot *lot;
+        GncOwner owner;
+        GncAgingOwner *ao;
+        gnc_commodity *currency;
+        gnc_numeric value;
+
+        if (timespec_cmp (&posted, &to_date) > 0)
+            break;
+        if (xaccSplitGetReconcile (split) == VREC)
+            continue;
+
+        /* Splits of paid off lots don't matter, unless the owners with
+         * nothing owed are wanted too. */
+        lot = xaccSplitGetLot (split);
+        if (lot && gnc_lot_is_closed (lot) && !show_zeros)
+            continue;
+
+        if (!aging_owner_from_split (split, &owner))
+            continue;
+
+        currency = xaccTransGetCurrency (txn);
+        ao = aging_get_owner (aging, &owner, currency);
+        if (!gnc_commodity_equiv (currency, ao->currency))
+        {
+            PWARN ("Ignoring transaction in %s for owner %s, whose other "
+                   "transactions are in %s",
+                   gnc_commodity_get_mnemonic (currency),
+                   gncOwnerGetName (&owner),
+                   gnc_commodity_get_mnemonic (ao->currency));
+            continue;
+        }
+
+        value = xaccSplitGetValue (split);
+        if (reverse)
+            value = gnc_numeric_neg (value);
+
+        if (gnc_numeric_negative_p (value))
+            aging_add_document (aging, ao, gnc_numeric_neg (value),
+                                use_post_date ? posted :
+                                xaccTransRetDateDueTS (txn));
+        else
+            aging_add_payment (aging, ao, value);
+    }
+    aging->owners = g_list_reverse (aging->owners);
+}
+
+GncAgingOwnerList *
+gncAgingGetOwners (const GncAging *aging)
+{
+    g_return_val_if_fail (aging, NULL);
+    return aging->owners;
+}
+
+const GncOwner *
+gncAgingOwnerGetOwner (const GncAgingOwner *ao)
+{
+    g_return_val_if_fail (ao, NULL);
+    return &ao->owner;
+}
+
+gnc_commodity *
+gncAgingOwnerGetCurrency (const GncAgingOwner *ao)
+{
+    g_return_val_if_fail (ao, NULL);
+    return ao->currency;
+}
+
+gnc_numeric
+gncAgingOwnerGetBucket (const GncAgingOwner *ao, guint bucket)
+{
+    g_return_val_if_fail (ao, gnc_numeric_zero ());
+    g_return_val_if_fail (bucket < ao->n_buckets, gnc_numeric_zero ());
+    return ao->buckets[bucket];
+}
+
+gnc_numeric
+gncAgingOwnerGetOverpayment (const GncAgingOwner *ao)
+{
+    g_return_val_if_fail (ao, gnc_numeric_zero ());
+    return ao->overpayment;
+}
@@ -0,0 +1,87 @@
+/********************************************************************\
+ * gncAging.h -- Business Interface:  A/R and A/P aging             *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @addtogroup Business
+    @{ */
+/** @addtogroup Aging
+    @{ */
+/** @file gncAging.h
+    @brief Business Interface:  age the amounts owed by or to each owner
+    of an A/R or A/P account.
+
+    The amounts are collected per owner into a list of buckets of
+    increasing date.  Documents (invoices, bills) are added to the bucket
+    their date falls in and payments are taken from the oldest buckets
+    first; whatever is paid beyond that is kept as the owner's
+    overpayment and used up by later documents.
+*/
+
+#ifndef GNC_AGING_H_
+#define GNC_AGING_H_
+
+#include "qof.h"
+#include "Account.h"
+#include "gncOwner.h"
+
+typedef struct _gncAging GncAging;
+typedef struct _gncAgingOwner GncAgingOwner;
+typedef GList GncAgingOwnerList;
+
+/** Create an aging without buckets */
+GncAging *gncAgingNew (void);
+void gncAgingDestroy (GncAging *aging);
+
+/** Add a bucket after the existing ones.  It holds the documents dated
+ * before end and not before the end of the previous bucket; documents
+ * dated after the last bucket's end go in the last bucket. */
+void gncAgingAddBucket (GncAging *aging, Timespec end);
+guint gncAgingGetNumBuckets (const GncAging *aging);
+
+/** Age the splits of acc posted up to and including to_date, replacing
+ * the results of any previous run.
+ *
+ * @param reverse Negate the split values, so that the documents of a
+ * payable account count like those of a receivable one.
+ * @param use_post_date Date documents by their post date rather than
+ * their due date.
+ * @param show_zeros Also count the splits of closed lots, so that owners
+ * with nothing owed still get a result.
+ */
+void gncAgingRun (GncAging *aging, Account *acc, Timespec to_date,
+                  gboolean reverse, gboolean use_post_date,
+                  gboolean show_zeros);
+
+/** The results of the last run, one per owner in the order the owners
+ * were first seen.  The list belongs to the aging. */
+GncAgingOwnerList *gncAgingGetOwners (const GncAging *aging);
+
+/** The (end) owner of the result */
+const GncOwner *gncAgingOwnerGetOwner (const GncAgingOwner *ao);
+/** The currency of the owner's transactions.  Transactions in other
+ * currencies are left out. */
+gnc_commodity *gncAgingOwnerGetCurrency (const GncAgingOwner *ao);
+/** The amount owed in the given bucket, counting from the oldest */
+gnc_numeric gncAgingOwnerGetBucket (const GncAgingOwner *ao, guint bucket);
+gnc_numeric gncAgingOwnerGetOverpayment (const GncAgingOwner *ao);
+
+#endif /* GNC_AGING_H_ */
+/** @} */
+/** @} */
@@ -65,10 +65,21 @@ struct _gncBillTermClass
 struct _book_info
 {
     GList *         terms;        /* visible terms */
+    GHashTable *    by_name;      /* names to the first visible term
+                                     of each, or NULL until looked up */
 };
 
 static QofLogModule log_module = GNC_MOD_BUSINESS;
 
+/* Called whenever the visible terms or their names change. */
+static inline void
+forget_names (struct _book_info *bi)
+{
+    if (!bi->by_name) return;
+    g_hash_table_destroy (bi->by_name);
+    bi->by_name = NULL;
+}
+
 #define _GNC_MOD_NAME        GNC_ID_BILLTERM
 
 #define SET_STR(obj, member, str) { \
@@ -101,6 +112,7 @@ static inline void maybe_resort_list (GncBillTerm *term)
     if (term->parent || term->invisible) return;
     bi = qof_book_get_data (qof_instance_get_book(term), _GNC_MOD_NAME);
     bi->terms = g_list_sort (bi->terms, (GCompareFunc)gncBillTermCompare);
+    forget_names (bi);
 }
 
 static inline void addObj (GncBillTerm *term)
@@ -109,6 +121,7 @@ static inline void addObj (GncBillTerm *term)
     bi = qof_book_get_data (qof_instance_get_book(term), _GNC_MOD_NAME);
     bi->terms = g_list_insert_sorted (bi->terms, term,
                                       (GCompareFunc)gncBillTermCompare);
+    forget_names (bi);
 }
 
 static inline void remObj (GncBillTerm *term)
@@ -116,6 +129,7 @@ static inline void remObj (GncBillTerm *term)
     struct _book_info *bi;
     bi = qof_book_get_data (qof_instance_get_book(term), _GNC_MOD_NAME);
     bi->terms = g_list_remove (bi->terms, term);
+    forget_names (bi);
 }
 
 static inline void
@@ -497,15 +511,24 @@ void gncBillTermCommitEdit (GncBillTerm *term)
 
 GncBillTerm *gncBillTermLookupByName (QofBook *book, const char *name)
 {
-    GList *list = gncBillTermGetTerms (book);
+    struct _book_info *bi;
+    GList *node;
 
-    for ( ; list; list = list->next)
+    if (!book || !name) return NULL;
+    bi = qof_book_get_data (book, _GNC_MOD_NAME);
+    qof_book_cache_lock (book);
+    if (!bi->by_name)
     {
-        GncBillTerm *term = list->data;
-        if (!g_strcmp0 (term->name, name))
-            return list->data;
+        bi->by_name = g_hash_table_new (g_str_hash, g_str_equal);
+        for (node = bi->terms; node; node = node->next)
+        {
+            GncBillTerm *term = node->data;
+            if (!g_hash_table_lookup (bi->by_name, term->name))
+                g_hash_table_insert (bi->by_name, term->name, term);
+        }
     }
-    return NULL;
+    qof_book_cache_unlock (book);
+    return g_hash_table_lookup (bi->by_name, name);
 }
 
 GList * gncBillTermGetTerms (QofBook *book)
@@ -849,6 +872,7 @@ static void _gncBillTermDestroy (QofBook *book)
     bi = qof_book_get_data (book, _GNC_MOD_NAME);
 
     g_list_free (bi->terms);
+    forget_names (bi);
     g_free (bi);
 }
 
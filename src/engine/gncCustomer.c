@@ -332,7 +332,9 @@ GncCustomer *gncCustomerCreate (QofBook *book)
 
     if (gs_address_event_handler_id == 0)
     {
-        gs_address_event_handler_id = qof_event_register_handler(listen_for_address_events, NULL);
+        gs_address_event_handler_id =
+            qof_event_register_typed_handler(GNC_ID_ADDRESS, QOF_EVENT_MODIFY,
+                                             listen_for_address_events, NULL);
     }
 
     qof_event_gen (&cust->inst, QOF_EVENT_CREATE, NULL);
@@ -945,6 +947,8 @@ gboolean gncCustomerRegister (void)
         return FALSE;
     }
     qof_class_register (_GNC_MOD_NAME, (QofSortFunc)gncCustomerCompare, params);
+    qof_query_register_string_index (_GNC_MOD_NAME, CUSTOMER_ID);
+    qof_query_register_string_index (_GNC_MOD_NAME, CUSTOMER_NAME);
     if (!qof_choice_create(GNC_ID_CUSTOMER))
     {
         return FALSE;
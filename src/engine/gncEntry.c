@@ -36,6 +36,7 @@
 #include "gncEntryP.h"
 #include "gnc-features.h"
 #include "gncInvoice.h"
+#include "gncInvoiceP.h"
 #include "gncOrder.h"
 
 struct _gncEntry
@@ -207,6 +208,17 @@ void mark_entry (GncEntry *entry)
     qof_event_gen (&entry->inst, QOF_EVENT_MODIFY, NULL);
 }
 
+static void mark_entry_values (GncEntry *entry);
+static void
+mark_entry_values (GncEntry *entry)
+{
+    entry->values_dirty = TRUE;
+    if (entry->invoice)
+        gncInvoiceEntryValuesChanged (entry->invoice, entry);
+    if (entry->bill)
+        gncInvoiceEntryValuesChanged (entry->bill, entry);
+}
+
 /* ================================================================ */
 
 enum
@@ -555,7 +567,7 @@ void gncEntrySetQuantity (GncEntry *entry, gnc_numeric quantity)
     if (gnc_numeric_eq (entry->quantity, quantity)) return;
     gncEntryBeginEdit (entry);
     entry->quantity = quantity;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -566,7 +578,7 @@ void gncEntrySetDocQuantity (GncEntry *entry, gnc_numeric quantity, gboolean is_
     if (gnc_numeric_eq (entry->quantity, (is_cn ? gnc_numeric_neg (quantity) : quantity))) return;
     gncEntryBeginEdit (entry);
     entry->quantity = (is_cn ? gnc_numeric_neg (quantity) : quantity);
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -589,7 +601,7 @@ void gncEntrySetInvPrice (GncEntry *entry, gnc_numeric price)
     if (gnc_numeric_eq (entry->i_price, price)) return;
     gncEntryBeginEdit (entry);
     entry->i_price = price;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -600,7 +612,7 @@ void gncEntrySetInvTaxable (GncEntry *entry, gboolean taxable)
     if (entry->i_taxable == taxable) return;
     gncEntryBeginEdit (entry);
     entry->i_taxable = taxable;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -611,7 +623,7 @@ void gncEntrySetInvTaxIncluded (GncEntry *entry, gboolean taxincluded)
     if (entry->i_taxincluded == taxincluded) return;
     gncEntryBeginEdit (entry);
     entry->i_taxincluded = taxincluded;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -626,7 +638,7 @@ void gncEntrySetInvTaxTable (GncEntry *entry, GncTaxTable *table)
     if (table)
         gncTaxTableIncRef (table);
     entry->i_tax_table = table;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -637,7 +649,7 @@ void gncEntrySetInvDiscount (GncEntry *entry, gnc_numeric discount)
     if (gnc_numeric_eq (entry->i_discount, discount)) return;
     gncEntryBeginEdit (entry);
     entry->i_discount = discount;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -649,7 +661,7 @@ void gncEntrySetInvDiscountType (GncEntry *entry, GncAmountType type)
 
     gncEntryBeginEdit (entry);
     entry->i_disc_type = type;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -661,7 +673,7 @@ void gncEntrySetInvDiscountHow (GncEntry *entry, GncDiscountHow how)
 
     gncEntryBeginEdit (entry);
     entry->i_disc_how = how;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -675,7 +687,7 @@ void qofEntrySetInvDiscType (GncEntry *entry, const char *type_string)
     if (entry->i_disc_type == type) return;
     gncEntryBeginEdit (entry);
     entry->i_disc_type = type;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 
@@ -690,7 +702,7 @@ void qofEntrySetInvDiscHow  (GncEntry *entry, const char *type)
     gncEntryDiscountStringToHow(type, &how);
     if (entry->i_disc_how == how) return;
     entry->i_disc_how = how;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -713,7 +725,7 @@ void gncEntrySetBillPrice (GncEntry *entry, gnc_numeric price)
     if (gnc_numeric_eq (entry->b_price, price)) return;
     gncEntryBeginEdit (entry);
     entry->b_price = price;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -724,7 +736,7 @@ void gncEntrySetBillTaxable (GncEntry *entry, gboolean taxable)
     if (entry->b_taxable == taxable) return;
     gncEntryBeginEdit (entry);
     entry->b_taxable = taxable;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -735,7 +747,7 @@ void gncEntrySetBillTaxIncluded (GncEntry *entry, gboolean taxincluded)
     if (entry->b_taxincluded == taxincluded) return;
     gncEntryBeginEdit (entry);
     entry->b_taxincluded = taxincluded;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -750,7 +762,7 @@ void gncEntrySetBillTaxTable (GncEntry *entry, GncTaxTable *table)
     if (table)
         gncTaxTableIncRef (table);
     entry->b_tax_table = table;
-    entry->values_dirty = TRUE;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -783,6 +795,7 @@ void gncEntrySetBillPayment (GncEntry *entry, GncEntryPaymentType type)
     if (entry->b_payment == type) return;
     gncEntryBeginEdit (entry);
     entry->b_payment = type;
+    mark_entry_values (entry);
     mark_entry (entry);
     gncEntryCommitEdit (entry);
 }
@@ -867,7 +880,7 @@ void gncEntryCopy (const GncEntry *src, GncEntry *dest, gboolean add_entry)
             gncBillAddEntry (src->bill, dest);
     }
 
-    dest->values_dirty = TRUE;
+    mark_entry_values (dest);
     mark_entry (dest);
     gncEntryCommitEdit (dest);
 }
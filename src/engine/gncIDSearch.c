@@ -105,17 +105,17 @@ static void * search(QofBook * book, const gchar *id, void * object, GncSearchTy
     if (type == CUSTOMER)
     {
         qof_query_search_for(q,GNC_CUSTOMER_MODULE_NAME);
-        qof_query_add_term (q, qof_query_build_param_list("CUSTOMER_ID"), string_pred_data, QOF_QUERY_AND);
+        qof_query_add_term (q, qof_query_build_param_list(CUSTOMER_ID, NULL), string_pred_data, QOF_QUERY_AND);
     }
     else if (type ==  INVOICE || type ==  BILL)
     {
         qof_query_search_for(q,GNC_INVOICE_MODULE_NAME);
-        qof_query_add_term (q, qof_query_build_param_list("INVOICE_ID"), string_pred_data, QOF_QUERY_AND);
+        qof_query_add_term (q, qof_query_build_param_list(INVOICE_ID, NULL), string_pred_data, QOF_QUERY_AND);
     }
     else if (type == VENDOR)
     {
         qof_query_search_for(q,GNC_VENDOR_MODULE_NAME);
-        qof_query_add_term (q, qof_query_build_param_list("VENDOR_ID"), string_pred_data, QOF_QUERY_AND);
+        qof_query_add_term (q, qof_query_build_param_list(VENDOR_ID, NULL), string_pred_data, QOF_QUERY_AND);
     }
 
 
@@ -35,6 +35,7 @@
 
 #include "Transaction.h"
 #include "Account.h"
+#include "TransLog.h"
 #include "gncBillTermP.h"
 #include "gncEntry.h"
 #include "gncEntryP.h"
@@ -43,6 +44,7 @@
 #include "gncInvoice.h"
 #include "gncInvoiceP.h"
 #include "gncOwnerP.h"
+#include "gncTaxTableP.h"
 #include "engine-helpers.h"
 
 struct _gncInvoice
@@ -71,8 +73,29 @@ struct _gncInvoice
     Account       *posted_acc;
     Transaction   *posted_txn;
     GNCLot        *posted_lot;
+
+    /* Running totals of the entries' document values.  Each entry's
+     * contribution is kept in entry_totals so a changed entry can be
+     * swapped out without walking the whole list again; see
+     * gncInvoiceGetTotalInternal. */
+    gboolean      totals_valid;
+    gboolean      totals_is_cust_doc;
+    gboolean      totals_is_cn;
+    guint         totals_taxtable_mods;
+    gnc_numeric   total_value[GNC_PAYMENT_CARD + 1];
+    gnc_numeric   total_tax[GNC_PAYMENT_CARD + 1];
+    GHashTable    *entry_totals;
+    GList         *changed_entries;
 };
 
+typedef struct
+{
+    gnc_numeric value;
+    gnc_numeric tax;
+    GncEntryPaymentType type;
+    gboolean changed;
+} EntryTotals;
+
 struct _gncInvoiceClass
 {
     QofInstanceClass parent_class;
@@ -95,6 +118,7 @@ static QofLogModule log_module = GNC_MOD_BUSINESS;
 	}
 
 static void mark_invoice (GncInvoice *invoice);
+static void remove_entry_totals (GncInvoice *invoice, GncEntry *entry);
 static void
 mark_invoice (GncInvoice *invoice)
 {
@@ -421,6 +445,9 @@ static void gncInvoiceFree (GncInvoice *invoice)
     CACHE_REMOVE (invoice->billing_id);
     g_list_free (invoice->entries);
     g_list_free (invoice->prices);
+    if (invoice->entry_totals)
+        g_hash_table_destroy (invoice->entry_totals);
+    g_list_free (invoice->changed_entries);
 
     if (invoice->printname) g_free (invoice->printname);
 
@@ -570,6 +597,7 @@ void gncInvoiceSetCurrency (GncInvoice *invoice, gnc_commodity *currency)
         return;
     gncInvoiceBeginEdit (invoice);
     invoice->currency = currency;
+    invoice->totals_valid = FALSE;
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
 }
@@ -644,6 +672,7 @@ void gncInvoiceAddEntry (GncInvoice *invoice, GncEntry *entry)
     gncEntrySetInvoice (entry, invoice);
     invoice->entries = g_list_insert_sorted (invoice->entries, entry,
                        (GCompareFunc)gncEntryCompare);
+    gncInvoiceEntryValuesChanged (invoice, entry);
     mark_invoice (invoice);
     gncInvoiceCommitEdit (invoice);
 }
@@ -653,6 +682,7 @@ void gncInvoiceRemoveEntry (GncInvoice *invoice, GncEntry *entry)
     if (!invoice || !entry) return;
 
     gncInvoiceBeginEdit (invoice);
+    remove_entry_totals (invoice, entry);
     gncEntrySetInvoice (entry, NULL);
     invoice->entries = g_list_remove (invoice->entries, entry);
     mark_invoice (invoice);
@@ -702,6 +732,7 @@ void gncBillAddEntry (GncInvoice *bill, GncEntry *entry)
     gncEntrySetBill (entry, bill);
     bill->entries = g_list_insert_sorted (bill->entries, entry,
                                           (GCompareFunc)gncEntryCompare);
+    gncInvoiceEntryValuesChanged (bill, entry);
     mark_invoice (bill);
     gncInvoiceCommitEdit (bill);
 }
@@ -711,6 +742,7 @@ void gncBillRemoveEntry (GncInvoice *bill, GncEntry *entry)
     if (!bill || !entry) return;
 
     gncInvoiceBeginEdit (bill);
+    remove_entry_totals (bill, entry);
     gncEntrySetBill (entry, NULL);
     bill->entries = g_list_remove (bill->entries, entry);
     mark_invoice (bill);
@@ -862,16 +894,98 @@ GncOwnerType gncInvoiceGetOwnerType (const GncInvoice *invoice)
     return (gncOwnerGetType (owner));
 }
 
-static gnc_numeric
-gncInvoiceGetTotalInternal (GncInvoice *invoice, gboolean use_value,
-                            gboolean use_tax,
-                            gboolean use_payment_type, GncEntryPaymentType type)
+/* Add (sign 1) or take out (sign -1) an entry's contribution to the
+ * invoice's running totals. */
+static void
+apply_entry_totals (GncInvoice *invoice, const EntryTotals *et, gint sign)
+{
+    gnc_numeric value = et->value, tax = et->tax;
+    gint type = et->type;
+
+    if (sign < 0)
+    {
+        value = gnc_numeric_neg (value);
+        tax = gnc_numeric_neg (tax);
+    }
+    invoice->total_value[0] = gnc_numeric_add (invoice->total_value[0], value,
+                                               GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    invoice->total_tax[0] = gnc_numeric_add (invoice->total_tax[0], tax,
+                                             GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    if (type < GNC_PAYMENT_CASH || type > GNC_PAYMENT_CARD)
+        return;
+    invoice->total_value[type] = gnc_numeric_add (invoice->total_value[type], value,
+                                                  GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    invoice->total_tax[type] = gnc_numeric_add (invoice->total_tax[type], tax,
+                                                GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+}
+
+/* Fetch the entry's current values into et.  Bad values contribute
+ * nothing, as they always have. */
+static void
+compute_entry_totals (GncInvoice *invoice, GncEntry *entry, EntryTotals *et)
+{
+    gboolean is_cust_doc = invoice->totals_is_cust_doc;
+    gboolean is_cn = invoice->totals_is_cn;
+
+    et->type = gncEntryGetBillPayment (entry);
+    et->changed = FALSE;
+
+    et->value = gncEntryGetDocValue (entry, FALSE, is_cust_doc, is_cn);
+    if (gnc_numeric_check (et->value) != GNC_ERROR_OK)
+    {
+        g_warning ("bad value in our entry");
+        et->value = gnc_numeric_zero ();
+    }
+
+    et->tax = gncEntryGetDocTaxValue (entry, FALSE, is_cust_doc, is_cn);
+    if (gnc_numeric_check (et->tax) != GNC_ERROR_OK)
+    {
+        g_warning ("bad tax-value in our entry");
+        et->tax = gnc_numeric_zero ();
+    }
+}
+
+static void
+rebuild_invoice_totals (GncInvoice *invoice, gboolean is_cust_doc, gboolean is_cn)
 {
     GList *node;
-    gnc_numeric total = gnc_numeric_zero();
-    gboolean is_cust_doc, is_cn;
+    gint i;
 
-    g_return_val_if_fail (invoice, total);
+    if (invoice->entry_totals)
+        g_hash_table_remove_all (invoice->entry_totals);
+    else
+        invoice->entry_totals = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                       NULL, g_free);
+    g_list_free (invoice->changed_entries);
+    invoice->changed_entries = NULL;
+
+    for (i = 0; i <= GNC_PAYMENT_CARD; i++)
+    {
+        invoice->total_value[i] = gnc_numeric_zero ();
+        invoice->total_tax[i] = gnc_numeric_zero ();
+    }
+    invoice->totals_is_cust_doc = is_cust_doc;
+    invoice->totals_is_cn = is_cn;
+    invoice->totals_taxtable_mods = gncTaxTableGetModCount ();
+
+    for (node = invoice->entries; node; node = node->next)
+    {
+        EntryTotals *et = g_new0 (EntryTotals, 1);
+        compute_entry_totals (invoice, node->data, et);
+        apply_entry_totals (invoice, et, 1);
+        g_hash_table_insert (invoice->entry_totals, node->data, et);
+    }
+    invoice->totals_valid = TRUE;
+}
+
+/* Bring the running totals up to date.  Only the entries that changed
+ * since the last call are looked at, unless something that affects
+ * every entry (document type, credit note flag, a tax table) changed. */
+static void
+update_invoice_totals (GncInvoice *invoice)
+{
+    gboolean is_cust_doc, is_cn;
+    GList *node;
 
     /* Is the current document an invoice/credit note related to a customer or a vendor/employee ?
      * The GncEntry code needs to know to return the proper entry amounts
@@ -879,32 +993,93 @@ gncInvoiceGetTotalInternal (GncInvoice *invoice, gboolean use_value,
     is_cust_doc = (gncInvoiceGetOwnerType (invoice) == GNC_OWNER_CUSTOMER);
     is_cn = gncInvoiceGetIsCreditNote (invoice);
 
-    for (node = gncInvoiceGetEntries(invoice); node; node = node->next)
+    if (!invoice->totals_valid ||
+            invoice->totals_is_cust_doc != is_cust_doc ||
+            invoice->totals_is_cn != is_cn ||
+            invoice->totals_taxtable_mods != gncTaxTableGetModCount ())
     {
-        GncEntry *entry = node->data;
-        gnc_numeric value, tax;
+        rebuild_invoice_totals (invoice, is_cust_doc, is_cn);
+        return;
+    }
+
+    for (node = invoice->changed_entries; node; node = node->next)
+    {
+        EntryTotals *et = g_hash_table_lookup (invoice->entry_totals, node->data);
 
-        if (use_payment_type && gncEntryGetBillPayment (entry) != type)
+        if (!et || !et->changed)
             continue;
+        apply_entry_totals (invoice, et, -1);
+        compute_entry_totals (invoice, node->data, et);
+        apply_entry_totals (invoice, et, 1);
+    }
+    g_list_free (invoice->changed_entries);
+    invoice->changed_entries = NULL;
+}
 
-        value = gncEntryGetDocValue (entry, FALSE, is_cust_doc, is_cn);
-        if (gnc_numeric_check (value) == GNC_ERROR_OK)
-        {
-            if (use_value)
-                total = gnc_numeric_add (total, value, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-        }
-        else
-            g_warning ("bad value in our entry");
+void
+gncInvoiceEntryValuesChanged (GncInvoice *invoice, GncEntry *entry)
+{
+    EntryTotals *et;
 
-        if (use_tax)
-        {
-            tax = gncEntryGetDocTaxValue (entry, FALSE, is_cust_doc, is_cn);
-            if (gnc_numeric_check (tax) == GNC_ERROR_OK)
-                total = gnc_numeric_add (total, tax, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            else
-                g_warning ("bad tax-value in our entry");
-        }
+    if (!invoice || !entry || !invoice->totals_valid)
+        return;
+
+    et = g_hash_table_lookup (invoice->entry_totals, entry);
+    if (!et)
+    {
+        /* A new entry contributes nothing until the next update. */
+        et = g_new0 (EntryTotals, 1);
+        et->value = gnc_numeric_zero ();
+        et->tax = gnc_numeric_zero ();
+        et->type = gncEntryGetBillPayment (entry);
+        g_hash_table_insert (invoice->entry_totals, entry, et);
+    }
+    if (et->changed)
+        return;
+    et->changed = TRUE;
+    invoice->changed_entries = g_list_prepend (invoice->changed_entries, entry);
+}
+
+static void
+remove_entry_totals (GncInvoice *invoice, GncEntry *entry)
+{
+    EntryTotals *et;
+
+    if (!invoice->totals_valid)
+        return;
+
+    et = g_hash_table_lookup (invoice->entry_totals, entry);
+    if (!et)
+        return;
+    apply_entry_totals (invoice, et, -1);
+    g_hash_table_remove (invoice->entry_totals, entry);
+}
+
+static gnc_numeric
+gncInvoiceGetTotalInternal (GncInvoice *invoice, gboolean use_value,
+                            gboolean use_tax,
+                            gboolean use_payment_type, GncEntryPaymentType type)
+{
+    gnc_numeric total = gnc_numeric_zero();
+    gint i = 0;
+
+    g_return_val_if_fail (invoice, total);
+
+    update_invoice_totals (invoice);
+
+    if (use_payment_type)
+    {
+        if (type < GNC_PAYMENT_CASH || type > GNC_PAYMENT_CARD)
+            return total;
+        i = type;
     }
+
+    if (use_value)
+        total = gnc_numeric_add (total, invoice->total_value[i],
+                                 GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+    if (use_tax)
+        total = gnc_numeric_add (total, invoice->total_tax[i],
+                                 GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
     return total;
 }
 
@@ -1174,6 +1349,7 @@ gncInvoiceAttachToLot (GncInvoice *invoice, GNCLot *lot)
     qof_instance_set (QOF_INSTANCE (lot), "invoice", guid, NULL);
     gnc_lot_commit_edit (lot);
     gncInvoiceSetPostedLot (invoice, lot);
+    gncOwnerLotOwnerChanged (lot);
 }
 
 GncInvoice * gncInvoiceGetInvoiceFromLot (GNCLot *lot)
@@ -1365,6 +1541,33 @@ static gboolean gncInvoicePostAddSplit (QofBook *book,
     return TRUE;
 }
 
+/* As gncAccountValueAdd, but finds acc's value through index instead of
+ * walking the list, which gets long when many entries post to many
+ * accounts. */
+static GList *
+post_split_info_add (GList *splitinfo, GHashTable *index, Account *acc,
+                     gnc_numeric value)
+{
+    GncAccountValue *acc_val;
+
+    g_return_val_if_fail (acc, splitinfo);
+    g_return_val_if_fail (gnc_numeric_check (value) == GNC_ERROR_OK, splitinfo);
+
+    acc_val = g_hash_table_lookup (index, acc);
+    if (acc_val)
+    {
+        acc_val->value = gnc_numeric_add (acc_val->value, value, GNC_DENOM_AUTO,
+                                          GNC_HOW_DENOM_LCD);
+        return splitinfo;
+    }
+
+    acc_val = g_new0 (GncAccountValue, 1);
+    acc_val->account = acc;
+    acc_val->value = value;
+    g_hash_table_insert (index, acc, acc_val);
+    return g_list_prepend (splitinfo, acc_val);
+}
+
 Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
                                        Timespec *post_date, Timespec *due_date,
                                        const char * memo, gboolean accumulatesplits,
@@ -1375,6 +1578,7 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
     GNCLot *lot = NULL;
     GList *iter;
     GList *splitinfo = NULL;
+    GHashTable *splitinfo_index;
     gnc_numeric total;
     gboolean is_cust_doc;
     gboolean is_cn;
@@ -1441,10 +1645,11 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
      * then create the appropriate splits in this txn.
      */
     total = gnc_numeric_zero();
+    splitinfo_index = g_hash_table_new (g_direct_hash, g_direct_equal);
     for (iter = gncInvoiceGetEntries(invoice); iter; iter = iter->next)
     {
         gnc_numeric value, tax;
-        GList *taxes;
+        GList *taxes, *tax_iter;
         GncEntry * entry = iter->data;
         Account *this_acc;
 
@@ -1477,7 +1682,8 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
             if (gnc_numeric_check (value) == GNC_ERROR_OK)
             {
                 if (accumulatesplits)
-                    splitinfo = gncAccountValueAdd (splitinfo, this_acc, value);
+                    splitinfo = post_split_info_add (splitinfo, splitinfo_index,
+                                                     this_acc, value);
                 else if (!gncInvoicePostAddSplit (book, this_acc, txn, value,
                                                   gncEntryGetDescription (entry),
                                                   type, invoice))
@@ -1486,6 +1692,7 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
                       We can't really do anything sensible about it, and this is
                       a user-interface free zone so we can't try asking the user
                       again either, have to return NULL*/
+                    g_hash_table_destroy (splitinfo_index);
                     return NULL;
                 }
 
@@ -1523,7 +1730,12 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
         }
 
         /* now merge in the TaxValues */
-        splitinfo = gncAccountValueAddList (splitinfo, taxes);
+        for (tax_iter = taxes; tax_iter; tax_iter = tax_iter->next)
+        {
+            GncAccountValue *tax_val = tax_iter->data;
+            splitinfo = post_split_info_add (splitinfo, splitinfo_index,
+                                             tax_val->account, tax_val->value);
+        }
 
         /* ... and add the tax total */
         if (gnc_numeric_check (tax) == GNC_ERROR_OK)
@@ -1533,6 +1745,7 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
 
         gncAccountValueDestroy (taxes);
     } /* for */
+    g_hash_table_destroy (splitinfo_index);
 
     /* Iterate through the splitinfo list and generate the splits */
     for (iter = splitinfo; iter; iter = iter->next)
@@ -1623,6 +1836,60 @@ Transaction * gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
     return txn;
 }
 
+GList *
+gncInvoicePostListToAccount (GList *invoices, Account *acc,
+                             Timespec *post_date, Timespec *due_date,
+                             const char *memo, gboolean accumulatesplits,
+                             gboolean autopay)
+{
+    GList *node, *posted = NULL, *failed = NULL;
+
+    if (!acc) return g_list_copy (invoices);
+
+    /* Hold the events, the log and the scrubs of the new transactions
+     * until every invoice is posted. */
+    qof_event_begin_batch ();
+    xaccLogBeginGroup ();
+    xaccTransBeginDeferredScrub ();
+
+    for (node = invoices; node; node = node->next)
+    {
+        GncInvoice *invoice = node->data;
+        Timespec invoice_due_date;
+        Timespec *this_due_date = due_date;
+
+        if (!due_date && post_date && invoice)
+        {
+            invoice_due_date = gncBillTermComputeDueDate (invoice->terms,
+                                                          *post_date);
+            this_due_date = &invoice_due_date;
+        }
+
+        if (gncInvoicePostToAccount (invoice, acc, post_date, this_due_date,
+                                     memo, accumulatesplits, FALSE))
+            posted = g_list_prepend (posted, invoice);
+        else
+            failed = g_list_prepend (failed, invoice);
+    }
+
+    xaccTransEndDeferredScrub ();
+
+    /* Link the lots once all of them exist, in the order posted, as if
+     * each invoice had been posted by itself. */
+    if (autopay)
+    {
+        posted = g_list_reverse (posted);
+        for (node = posted; node; node = node->next)
+            gncInvoiceAutoApplyPayments (node->data);
+    }
+    g_list_free (posted);
+
+    xaccLogEndGroup ();
+    qof_event_end_batch ();
+
+    return g_list_reverse (failed);
+}
+
 gboolean
 gncInvoiceUnpost (GncInvoice *invoice, gboolean reset_tax_tables)
 {
@@ -1794,7 +2061,7 @@ void gncInvoiceAutoApplyPayments (GncInvoice *invoice)
     GNCLot *inv_lot;
     Account *acct;
     const GncOwner *owner;
-    GList *lot_list;
+    GList *lot_list, *node, *next;
     struct lotmatch lm;
 
     /* General note: "paying" in this context means balancing
@@ -1820,8 +2087,13 @@ void gncInvoiceAutoApplyPayments (GncInvoice *invoice)
      * could be used. */
     lm.positive_balance =  gnc_numeric_positive_p (gnc_lot_get_balance (inv_lot));
     lm.owner = owner;
-    lot_list = xaccAccountFindOpenLots (acct, gnc_lot_match_owner_balancing,
-                                        &lm, NULL);
+    lot_list = gncOwnerFindOpenLots (owner, acct, NULL);
+    for (node = lot_list; node; node = next)
+    {
+        next = node->next;
+        if (!gnc_lot_match_owner_balancing (node->data, &lm))
+            lot_list = g_list_delete_link (lot_list, node);
+    }
 
     lot_list = g_list_prepend (lot_list, inv_lot);
     gncOwnerAutoApplyPaymentsWithLots (owner, lot_list);
@@ -2134,6 +2406,7 @@ gboolean gncInvoiceRegister (void)
     };
 
     qof_class_register (_GNC_MOD_NAME, (QofSortFunc)gncInvoiceCompare, params);
+    qof_query_register_string_index (_GNC_MOD_NAME, INVOICE_ID);
     reg_lot ();
     reg_txn ();
 
@@ -213,6 +213,25 @@ gncInvoicePostToAccount (GncInvoice *invoice, Account *acc,
                          const char *memo, gboolean accumulatesplits,
                          gboolean autopay);
 
+/**
+ * Post each invoice in invoices to acc as gncInvoicePostToAccount()
+ * would, for batch billing runs.  The whole run is one event batch and
+ * one transaction log group, and the new transactions are scrubbed
+ * together at the end.  If autopay is TRUE, payments are applied once
+ * every invoice is posted, invoice by invoice in the order given.
+ *
+ * If due_date is NULL each invoice's due date is computed from its own
+ * billing terms and post_date.
+ *
+ * Returns the invoices that could not be posted, in the order given.
+ * Free the list with g_list_free, not the invoices.
+ */
+GList *
+gncInvoicePostListToAccount (GList *invoices, Account *acc,
+                             Timespec *post_date, Timespec *due_date,
+                             const char *memo, gboolean accumulatesplits,
+                             gboolean autopay);
+
 /**
  * Unpost this invoice.  This will destroy the posted transaction and
  * return the invoice to its unposted state.  It may leave empty lots
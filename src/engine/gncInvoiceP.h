@@ -39,6 +39,9 @@ gchar *gncInvoiceNextID (QofBook *book, const GncOwner *owner);
 void gncInvoiceSetPostedAcc (GncInvoice *invoice, Account *acc);
 void gncInvoiceSetPostedTxn (GncInvoice *invoice, Transaction *txn);
 void gncInvoiceSetPostedLot (GncInvoice *invoice, GNCLot *lot);
+/** Called by an entry of this invoice whenever its values change, so the
+ * invoice can fold the new values into its running totals. */
+void gncInvoiceEntryValuesChanged (GncInvoice *invoice, GncEntry *entry);
 //void gncInvoiceSetPaidTxn (GncInvoice *invoice, Transaction *txn);
 
 #define gncInvoiceSetGUID(I,G) qof_instance_set_guid(QOF_INSTANCE(I),(G))
@@ -359,6 +359,8 @@ void gncJobSetOwner (GncJob *job, GncOwner *owner)
     }
 
     gncOwnerCopy (owner, &(job->owner));
+    /* The job's invoice lots now belong to another end owner */
+    gncOwnerLotIndexReset (qof_instance_get_book (QOF_INSTANCE (job)));
 
     switch (gncOwnerGetType (&(job->owner)))
     {
@@ -599,6 +601,8 @@ gboolean gncJobRegister (void)
     }
 
     qof_class_register (_GNC_MOD_NAME, (QofSortFunc)gncJobCompare, params);
+    qof_query_register_string_index (_GNC_MOD_NAME, JOB_ID);
+    qof_query_register_string_index (_GNC_MOD_NAME, JOB_NAME);
 #ifdef GNUCASH_MAJOR_VERSION
     qofJobGetOwner(NULL);
     qofJobSetOwner(NULL, NULL);
@@ -609,6 +609,7 @@ void gncOwnerAttachToLot (const GncOwner *owner, GNCLot *lot)
 		      GNC_OWNER_GUID, gncOwnerGetGUID (owner),
 		      NULL);
     gnc_lot_commit_edit (lot);
+    gncOwnerLotOwnerChanged (lot);
 }
 
 gboolean gncOwnerGetOwnerFromLot (GNCLot *lot, GncOwner *owner)
@@ -722,6 +723,192 @@ gncOwnerLotsSortFunc (GNCLot *lotA, GNCLot *lotB)
     return timespec_cmp (&da, &db);
 }
 
+/* ================================================================ */
+/* Owner lot index
+ *
+ * The GUIDs of each end owner's lots in the book's A/R and A/P
+ * accounts, built on the first gncOwnerFindOpenLots and extended as
+ * lots are attached to owners or invoices.  An entry goes stale when
+ * its lot is destroyed or changes hands; lookups verify every lot they
+ * return and drop the stale ones. */
+
+#define OWNER_LOT_INDEX "gnc-owner-lot-index"
+
+typedef struct
+{
+    GHashTable *owners;     /* owner GncGUID* -> OwnerLots */
+    gboolean built;
+} OwnerLotIndex;
+
+typedef struct
+{
+    GList *lots;            /* GncGUID* of the lots, in account order */
+} OwnerLots;
+
+static void
+owner_lots_free (gpointer data)
+{
+    OwnerLots *ol = data;
+    g_list_free_full (ol->lots, (GDestroyNotify)guid_free);
+    g_free (ol);
+}
+
+static void
+owner_lot_index_destroy (QofBook *book, gpointer key, gpointer data)
+{
+    OwnerLotIndex *index = data;
+    g_hash_table_destroy (index->owners);
+    g_free (index);
+}
+
+/* The owner gncOwnerLotMatchOwnerFunc would find for this lot */
+static const GncGUID *
+lot_end_owner_guid (GNCLot *lot)
+{
+    GncOwner lot_owner;
+    GncInvoice *invoice = gncInvoiceGetInvoiceFromLot (lot);
+
+    if (invoice)
+        return gncOwnerGetEndGUID (gncInvoiceGetOwner (invoice));
+    if (gncOwnerGetOwnerFromLot (lot, &lot_owner))
+        return gncOwnerGetEndGUID (&lot_owner);
+    return NULL;
+}
+
+static void
+owner_lot_index_add (OwnerLotIndex *index, GNCLot *lot, gboolean check_dup)
+{
+    const GncGUID *owner_guid = lot_end_owner_guid (lot);
+    const GncGUID *lot_guid = qof_instance_get_guid (QOF_INSTANCE (lot));
+    OwnerLots *ol;
+    GList *node;
+
+    if (!owner_guid) return;
+
+    ol = g_hash_table_lookup (index->owners, owner_guid);
+    if (!ol)
+    {
+        ol = g_new0 (OwnerLots, 1);
+        g_hash_table_insert (index->owners, guid_copy (owner_guid), ol);
+    }
+    if (check_dup)
+        for (node = ol->lots; node; node = node->next)
+            if (guid_equal (node->data, lot_guid))
+                return;
+    ol->lots = g_list_prepend (ol->lots, guid_copy (lot_guid));
+}
+
+static OwnerLotIndex *
+get_owner_lot_index (QofBook *book, gboolean build)
+{
+    OwnerLotIndex *index = qof_book_get_data (book, OWNER_LOT_INDEX);
+    GList *accounts, *acc_node;
+
+    if (!index)
+    {
+        if (!build) return NULL;
+        index = g_new0 (OwnerLotIndex, 1);
+        index->owners = g_hash_table_new_full (guid_hash_to_guint,
+                                               guid_g_hash_table_equal,
+                                               (GDestroyNotify)guid_free,
+                                               owner_lots_free);
+        qof_book_set_data_fin (book, OWNER_LOT_INDEX, index,
+                               owner_lot_index_destroy);
+    }
+    if (index->built || !build)
+        return index;
+
+    /* Walk each account's lots backwards so that every owner's list
+     * ends up in the account's own order. */
+    g_hash_table_remove_all (index->owners);
+    accounts = gnc_account_get_descendants (gnc_book_get_root_account (book));
+    for (acc_node = accounts; acc_node; acc_node = acc_node->next)
+    {
+        Account *acc = acc_node->data;
+        LotList *lots, *node;
+
+        if (!xaccAccountIsAPARType (xaccAccountGetType (acc)))
+            continue;
+        lots = xaccAccountGetLotList (acc);
+        for (node = g_list_last (lots); node; node = node->prev)
+            owner_lot_index_add (index, node->data, FALSE);
+        g_list_free (lots);
+    }
+    g_list_free (accounts);
+    index->built = TRUE;
+    return index;
+}
+
+void
+gncOwnerLotOwnerChanged (GNCLot *lot)
+{
+    OwnerLotIndex *index;
+
+    if (!lot) return;
+    index = get_owner_lot_index (gnc_lot_get_book (lot), FALSE);
+    if (index && index->built)
+        owner_lot_index_add (index, lot, TRUE);
+}
+
+void
+gncOwnerLotIndexReset (QofBook *book)
+{
+    OwnerLotIndex *index;
+
+    if (!book) return;
+    index = get_owner_lot_index (book, FALSE);
+    if (!index) return;
+    g_hash_table_remove_all (index->owners);
+    index->built = FALSE;
+}
+
+LotList *
+gncOwnerFindOpenLots (const GncOwner *owner, Account *account,
+                      GCompareFunc sort_func)
+{
+    OwnerLotIndex *index;
+    OwnerLots *ol;
+    const GncGUID *owner_guid;
+    QofBook *book;
+    GList *node, *retval = NULL;
+
+    g_return_val_if_fail (owner && account, NULL);
+
+    /* Only the A/R and A/P accounts are indexed */
+    if (!xaccAccountIsAPARType (xaccAccountGetType (account)))
+        return xaccAccountFindOpenLots (account, gncOwnerLotMatchOwnerFunc,
+                                        (gpointer)owner, sort_func);
+
+    owner_guid = gncOwnerGetGUID (owner);
+    if (!owner_guid) return NULL;
+
+    book = gnc_account_get_book (account);
+    index = get_owner_lot_index (book, TRUE);
+    ol = g_hash_table_lookup (index->owners, owner_guid);
+    if (!ol) return NULL;
+
+    node = ol->lots;
+    while (node)
+    {
+        GList *next = node->next;
+        GNCLot *lot = gnc_lot_lookup (node->data, book);
+
+        if (!lot || !gncOwnerLotMatchOwnerFunc (lot, (gpointer)owner))
+        {
+            guid_free (node->data);
+            ol->lots = g_list_delete_link (ol->lots, node);
+        }
+        else if (gnc_lot_get_account (lot) == account &&
+                 !gnc_lot_is_closed (lot))
+            retval = g_list_prepend (retval, lot);
+        node = next;
+    }
+
+    if (sort_func)
+        retval = g_list_sort (retval, sort_func);
+    return retval;
+}
+
 GNCLot *
 gncOwnerCreatePaymentLot (const GncOwner *owner, Transaction **preset_txn,
                           Account *posted_acc, Account *xfer_acc,
@@ -1402,8 +1589,7 @@ gncOwnerApplyPayment (const GncOwner *owner, Transaction **preset_txn, GList *lo
     if (lots)
         selected_lots = lots;
     else if (auto_pay)
-        selected_lots = xaccAccountFindOpenLots (posted_acc, gncOwnerLotMatchOwnerFunc,
-                        (gpointer)owner, NULL);
+        selected_lots = gncOwnerFindOpenLots (owner, posted_acc, NULL);
 
     /* And link the selected lots and the payment lot together as well as possible.
      * If the payment was bigger than the selected documents/overpayments, only
@@ -1482,8 +1668,7 @@ gncOwnerGetBalanceInCurrency (const GncOwner *owner,
             continue;
 
         /* Get a list of open lots for this owner and account */
-        lot_list = xaccAccountFindOpenLots (account, gncOwnerLotMatchOwnerFunc,
-                                            (gpointer)owner, NULL);
+        lot_list = gncOwnerFindOpenLots (owner, account, NULL);
         /* For each lot */
         for (lot_node = lot_list; lot_node; lot_node = lot_node->next)
         {
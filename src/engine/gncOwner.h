@@ -184,6 +184,15 @@ void gncOwnerAttachToLot (const GncOwner *owner, GNCLot *lot);
  */
 gboolean gncOwnerLotMatchOwnerFunc (GNCLot *lot, gpointer user_data);
 
+/** Return the open lots of the owner in account, sorted with sort_func
+ * if it isn't NULL.  This gives the same lots as calling
+ * xaccAccountFindOpenLots with gncOwnerLotMatchOwnerFunc, but in an
+ * A/R or A/P account only the owner's own lots are looked at. The
+ * list must be freed by the caller, the lots must not.
+ */
+LotList * gncOwnerFindOpenLots (const GncOwner *owner, Account *account,
+                                GCompareFunc sort_func);
+
 /** Helper function used to sort lots by date. If the lot is
  * linked to an invoice, use the invoice posted date, otherwise
  * use the lot's opened date.
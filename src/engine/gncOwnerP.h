@@ -32,5 +32,14 @@
 
 gboolean gncOwnerRegister (void);
 
+/** Tell the owner lot index that the owner of lot, or the invoice
+ * posted to it, was set. */
+void gncOwnerLotOwnerChanged (GNCLot *lot);
+
+/** Throw away the book's owner lot index, to be rebuilt on the next
+ * lookup.  Needed when lots change owner wholesale, as when a job moves
+ * to another customer. */
+void gncOwnerLotIndexReset (QofBook *book);
+
 
 #endif /* GNC_OWNERP_H_ */
@@ -66,10 +66,21 @@ struct _gncTaxTableEntry
 struct _book_info
 {
     GList *         tables;          /* visible tables */
+    GHashTable *    by_name;         /* names to the first visible table
+                                        of each, or NULL until looked up */
 };
 
 static QofLogModule log_module = GNC_MOD_BUSINESS;
 
+/* Called whenever the visible tables or their names change. */
+static inline void
+forget_names (struct _book_info *bi)
+{
+    if (!bi->by_name) return;
+    g_hash_table_destroy (bi->by_name);
+    bi->by_name = NULL;
+}
+
 /* =============================================================== */
 /* You must edit the functions in this block in tandem.  KEEP THEM IN
    SYNC! */
@@ -160,12 +171,18 @@ maybe_resort_list (GncTaxTable *table)
     if (table->parent || table->invisible) return;
     bi = qof_book_get_data (qof_instance_get_book(table), _GNC_MOD_NAME);
     bi->tables = g_list_sort (bi->tables, (GCompareFunc)gncTaxTableCompare);
+    forget_names (bi);
 }
 
+/* Bumped on every tax table change, so cached invoice totals can tell
+ * when their entries' tax values may have gone stale. */
+static guint mod_count = 0;
+
 static inline void
 mod_table (GncTaxTable *table)
 {
     timespecFromTime64 (&table->modtime, gnc_time (NULL));
+    mod_count++;
 }
 
 static inline void addObj (GncTaxTable *table)
@@ -174,6 +191,7 @@ static inline void addObj (GncTaxTable *table)
     bi = qof_book_get_data (qof_instance_get_book(table), _GNC_MOD_NAME);
     bi->tables = g_list_insert_sorted (bi->tables, table,
                                        (GCompareFunc)gncTaxTableCompare);
+    forget_names (bi);
 }
 
 static inline void remObj (GncTaxTable *table)
@@ -181,6 +199,7 @@ static inline void remObj (GncTaxTable *table)
     struct _book_info *bi;
     bi = qof_book_get_data (qof_instance_get_book(table), _GNC_MOD_NAME);
     bi->tables = g_list_remove (bi->tables, table);
+    forget_names (bi);
 }
 
 static inline void
@@ -556,6 +575,7 @@ void gncTaxTableMakeInvisible (GncTaxTable *table)
     table->invisible = TRUE;
     bi = qof_book_get_data (qof_instance_get_book(table), _GNC_MOD_NAME);
     bi->tables = g_list_remove (bi->tables, table);
+    forget_names (bi);
     gncTaxTableCommitEdit (table);
 }
 
@@ -670,15 +690,24 @@ void gncTaxTableCommitEdit (GncTaxTable *table)
 
 GncTaxTable *gncTaxTableLookupByName (QofBook *book, const char *name)
 {
-    GList *list = gncTaxTableGetTables (book);
+    struct _book_info *bi;
+    GList *node;
 
-    for ( ; list; list = list->next)
+    if (!book || !name) return NULL;
+    bi = qof_book_get_data (book, _GNC_MOD_NAME);
+    qof_book_cache_lock (book);
+    if (!bi->by_name)
     {
-        GncTaxTable *table = list->data;
-        if (!g_strcmp0 (table->name, name))
-            return list->data;
+        bi->by_name = g_hash_table_new (g_str_hash, g_str_equal);
+        for (node = bi->tables; node; node = node->next)
+        {
+            GncTaxTable *table = node->data;
+            if (!g_hash_table_lookup (bi->by_name, table->name))
+                g_hash_table_insert (bi->by_name, table->name, table);
+        }
     }
-    return NULL;
+    qof_book_cache_unlock (book);
+    return g_hash_table_lookup (bi->by_name, name);
 }
 
 GList * gncTaxTableGetTables (QofBook *book)
@@ -761,6 +790,11 @@ gint64 gncTaxTableGetRefcount (const GncTaxTable *table)
     return table->refcount;
 }
 
+guint gncTaxTableGetModCount (void)
+{
+    return mod_count;
+}
+
 Timespec gncTaxTableLastModified (const GncTaxTable *table)
 {
     Timespec ts = { 0 , 0 };
@@ -1006,6 +1040,7 @@ static void _gncTaxTableDestroy (QofBook *book)
     bi = qof_book_get_data (book, _GNC_MOD_NAME);
 
     g_list_free (bi->tables);
+    forget_names (bi);
     g_free (bi);
 }
 
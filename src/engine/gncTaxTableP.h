@@ -40,6 +40,9 @@ void gncTaxTableMakeInvisible (GncTaxTable *table);
 
 gboolean gncTaxTableGetInvisible (const GncTaxTable *table);
 
+/** Returns a counter that changes whenever any tax table is modified. */
+guint gncTaxTableGetModCount (void);
+
 GncTaxTable* gncTaxTableEntryGetTable( const GncTaxTableEntry* entry );
 
 #define gncTaxTableSetGUID(E,G) qof_instance_set_guid(QOF_INSTANCE(E),(G))
@@ -476,7 +476,9 @@ GncVendor *gncVendorCreate (QofBook *book)
 
     if (gs_address_event_handler_id == 0)
     {
-        gs_address_event_handler_id = qof_event_register_handler(listen_for_address_events, NULL);
+        gs_address_event_handler_id =
+            qof_event_register_typed_handler(GNC_ID_ADDRESS, QOF_EVENT_MODIFY,
+                                             listen_for_address_events, NULL);
     }
 
     qof_event_gen (&vendor->inst, QOF_EVENT_CREATE, NULL);
@@ -1003,6 +1005,8 @@ gboolean gncVendorRegister (void)
     }
 
     qof_class_register (_GNC_MOD_NAME, (QofSortFunc)gncVendorCompare, params);
+    qof_query_register_string_index (_GNC_MOD_NAME, VENDOR_ID);
+    qof_query_register_string_index (_GNC_MOD_NAME, VENDOR_NAME);
 
     return qof_object_register (&gncVendorDesc);
 }
@@ -0,0 +1,596 @@
+/***************************************************************************
+ *            bench-engine.cpp
+ *
+ *  Engine microbenchmarks over reproducible generated books
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+/* bench-engine builds a book of a requested size from a fixed seed and
+ * times the engine operations the other performance work is measured
+ * against.  Each result is printed as one JSON object per line on
+ * stdout, preceded by a line recording the parameters of the run, so
+ * that runs can be compared with a script:
+ *
+ *   {"benchmark":"balance-recompute","iterations":200,"seconds":0.0123}
+ *
+ * The file backends are searched for in each --backend-dir, by default
+ * the build tree's own; a benchmark whose backend cannot be loaded is
+ * reported with "skipped":true.
+ */
+extern "C"
+{
+#include "config.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "qof.h"
+#include "cashobjects.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "Split.h"
+#include "SplitP.h"
+#include "Query.h"
+#include "Scrub.h"
+#include "SchedXaction.h"
+#include "SX-book.h"
+#include "gnc-commodity.h"
+#include "gnc-pricedb.h"
+#include "gnc-session.h"
+#include "gnc-engine.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+}
+
+static gint num_accounts = 50;
+static gint num_transactions = 10000;
+static gint splits_per_transaction = 2;
+static gint num_prices = 5000;
+static gint kvp_density = 10;
+static gint num_sxes = 20;
+static gint iterations = 20;
+static gint seed = 1;
+static gchar **backend_dirs = NULL;
+
+/* Dates are spread over ten years ending at a fixed point so that two
+ * runs with the same seed produce identical books. */
+static const time64 bench_end_time = 1420070400; /* 2015-01-01 */
+static const time64 bench_span = 10 * 365 * 24 * 3600;
+
+static GOptionEntry bench_options[] =
+{
+    { "accounts", 'a', 0, G_OPTION_ARG_INT, &num_accounts,
+      "Number of leaf accounts", "N" },
+    { "transactions", 't', 0, G_OPTION_ARG_INT, &num_transactions,
+      "Number of transactions", "N" },
+    { "splits", 's', 0, G_OPTION_ARG_INT, &splits_per_transaction,
+      "Splits per transaction", "N" },
+    { "prices", 'p', 0, G_OPTION_ARG_INT, &num_prices,
+      "Number of prices in the price database", "N" },
+    { "kvp-density", 'k', 0, G_OPTION_ARG_INT, &kvp_density,
+      "Percentage of objects carrying random KVP slots", "PCT" },
+    { "sxes", 'x', 0, G_OPTION_ARG_INT, &num_sxes,
+      "Number of daily scheduled transactions", "N" },
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+      "Repetitions of each in-memory benchmark", "N" },
+    { "seed", 'r', 0, G_OPTION_ARG_INT, &seed,
+      "Seed for the book generator", "N" },
+    { "backend-dir", 'b', 0, G_OPTION_ARG_FILENAME_ARRAY, &backend_dirs,
+      "Directory to search for the xml and dbi backend modules", "DIR" },
+    { NULL }
+};
+
+typedef struct
+{
+    QofBook *book;
+    Account *root;
+    GPtrArray *accounts;
+    gnc_commodity *currency;
+    GPtrArray *stocks;
+} BenchBook;
+
+static void bench_report (const char *name, gint count, gint64 usecs);
+static void bench_skip (const char *name, const char *reason);
+static void bench_maybe_add_slots (QofInstance *inst);
+static void bench_build_book (BenchBook *bb);
+
+static void
+bench_report (const char *name, gint count, gint64 usecs)
+{
+    printf ("{\"benchmark\":\"%s\",\"iterations\":%d,\"seconds\":%.6f}\n",
+            name, count, usecs / (double) G_USEC_PER_SEC);
+    fflush (stdout);
+}
+
+static void
+bench_skip (const char *name, const char *reason)
+{
+    printf ("{\"benchmark\":\"%s\",\"skipped\":true,\"reason\":\"%s\"}\n",
+            name, reason);
+    fflush (stdout);
+}
+
+static void
+bench_maybe_add_slots (QofInstance *inst)
+{
+    if (get_random_int_in_range (1, 100) <= kvp_density)
+        qof_instance_set_slots (inst, get_random_kvp_frame ());
+}
+
+static void
+bench_build_book (BenchBook *bb)
+{
+    gnc_commodity_table *table = gnc_commodity_table_get_table (bb->book);
+    GNCPriceDB *pdb = gnc_pricedb_get_db (bb->book);
+    gint i, j;
+
+    bb->currency = gnc_commodity_new (bb->book, "US Dollar", "CURRENCY",
+                                      "USD", "840", 100);
+    bb->currency = gnc_commodity_table_insert (table, bb->currency);
+
+    bb->root = gnc_book_get_root_account (bb->book);
+    bb->accounts = g_ptr_array_new ();
+    bb->stocks = g_ptr_array_new ();
+    for (i = 0; i < num_accounts; i++)
+    {
+        Account *acc = xaccMallocAccount (bb->book);
+        gchar *name = g_strdup_printf ("Account %d", i);
+        xaccAccountBeginEdit (acc);
+        xaccAccountSetName (acc, name);
+        xaccAccountSetType (acc, i % 2 ? ACCT_TYPE_EXPENSE : ACCT_TYPE_BANK);
+        xaccAccountSetCommodity (acc, bb->currency);
+        bench_maybe_add_slots (QOF_INSTANCE (acc));
+        gnc_account_append_child (bb->root, acc);
+        xaccAccountCommitEdit (acc);
+        g_ptr_array_add (bb->accounts, acc);
+        g_free (name);
+    }
+
+    for (i = 0; i < num_transactions; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (bb->book);
+        gint64 balance = 0;
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, bb->currency);
+        xaccTransSetDatePostedSecs (trans, bench_end_time - bench_span +
+                                    get_random_int_in_range (0, bench_span));
+        xaccTransSetDescription (trans, "Benchmark transaction");
+        bench_maybe_add_slots (QOF_INSTANCE (trans));
+        for (j = 0; j < splits_per_transaction; j++)
+        {
+            Split *split = xaccMallocSplit (bb->book);
+            Account *acc = static_cast<Account*>(
+                g_ptr_array_index (bb->accounts,
+                                   get_random_int_in_range (0, num_accounts - 1)));
+            gint64 amount = j < splits_per_transaction - 1 ?
+                get_random_int_in_range (-100000, 100000) : -balance;
+            gnc_numeric value = gnc_numeric_create (amount, 100);
+            balance += amount;
+            xaccSplitSetParent (split, trans);
+            xaccSplitSetAccount (split, acc);
+            xaccSplitSetValue (split, value);
+            xaccSplitSetAmount (split, value);
+            bench_maybe_add_slots (QOF_INSTANCE (split));
+        }
+        xaccTransCommitEdit (trans);
+    }
+
+    for (i = 0; i < 10; i++)
+    {
+        gchar *mnemonic = g_strdup_printf ("STK%d", i);
+        gnc_commodity *stock = gnc_commodity_new (bb->book, mnemonic,
+                                                  "NASDAQ", mnemonic, "",
+                                                  10000);
+        g_ptr_array_add (bb->stocks,
+                         gnc_commodity_table_insert (table, stock));
+        g_free (mnemonic);
+    }
+    for (i = 0; i < num_prices; i++)
+    {
+        GNCPrice *price = gnc_price_create (bb->book);
+        Timespec ts = { bench_end_time - bench_span +
+                        get_random_int_in_range (0, bench_span), 0 };
+        gnc_price_begin_edit (price);
+        gnc_price_set_commodity (price, static_cast<gnc_commodity*>(
+                                     g_ptr_array_index (bb->stocks, i % 10)));
+        gnc_price_set_currency (price, bb->currency);
+        gnc_price_set_time (price, ts);
+        gnc_price_set_source (price, PRICE_SOURCE_USER_PRICE);
+        gnc_price_set_typestr (price, "last");
+        gnc_price_set_value (price, gnc_numeric_create (
+                                 get_random_int_in_range (1, 1000000), 100));
+        gnc_price_commit_edit (price);
+        gnc_pricedb_add_price (pdb, price);
+        gnc_price_unref (price);
+    }
+
+    for (i = 0; i < num_sxes; i++)
+    {
+        GDate start;
+        gchar *name = g_strdup_printf ("Daily SX %d", i);
+        Timespec ts = { bench_end_time - bench_span, 0 };
+        start = timespec_to_gdate (ts);
+        add_daily_sx (name, &start, NULL, NULL);
+        g_free (name);
+    }
+}
+
+static void
+bench_balances (BenchBook *bb)
+{
+    gint64 start;
+    gint i;
+    guint a;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+        for (a = 0; a < bb->accounts->len; a++)
+        {
+            Account *acc = static_cast<Account*>(
+                g_ptr_array_index (bb->accounts, a));
+            gnc_account_set_balance_dirty (acc);
+            xaccAccountRecomputeBalance (acc);
+        }
+    bench_report ("balance-recompute", iterations * bb->accounts->len,
+                  g_get_monotonic_time () - start);
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+        for (a = 0; a < bb->accounts->len; a++)
+        {
+            Account *acc = static_cast<Account*>(
+                g_ptr_array_index (bb->accounts, a));
+            time64 when = bench_end_time - bench_span +
+                          get_random_int_in_range (0, bench_span);
+            xaccAccountGetBalanceAsOfDate (acc, when);
+        }
+    bench_report ("balance-as-of-date", iterations * bb->accounts->len,
+                  g_get_monotonic_time () - start);
+}
+
+/* Walk every split of every account reading the fields a balance or
+ * register scan reads, so that the cost of the split layout shows up
+ * apart from the balance index.  "split-bytes" in the parameters is
+ * the size of the split it walks. */
+static void
+bench_split_scan (BenchBook *bb)
+{
+    gnc_numeric sum = gnc_numeric_zero ();
+    gint count = 0, cleared = 0, orphans = 0;
+    gint64 start;
+    gint i;
+    guint a;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < iterations; i++)
+        for (a = 0; a < bb->accounts->len; a++)
+        {
+            AccountSplitIter iter;
+            Split *split;
+            gnc_account_split_iter_init (&iter, static_cast<Account*>(
+                                             g_ptr_array_index (bb->accounts, a)));
+            while ((split = gnc_account_split_iter_next (&iter)) != NULL)
+            {
+                sum = gnc_numeric_add_fixed (sum, xaccSplitGetAmount (split));
+                if (xaccSplitGetReconcile (split) != NREC)
+                    cleared++;
+                if (xaccSplitGetParent (split) == NULL)
+                    orphans++;
+                count++;
+            }
+        }
+    bench_report ("split-scan", count, g_get_monotonic_time () - start);
+    if (orphans > 0 || cleared > count)
+        fprintf (stderr, "split-scan: %d orphaned splits\n", orphans);
+}
+
+static void
+bench_queries (BenchBook *bb)
+{
+    gint64 start = g_get_monotonic_time ();
+    gint i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+        time64 from = bench_end_time - bench_span +
+                      get_random_int_in_range (0, bench_span);
+        qof_query_set_book (q, bb->book);
+        xaccQueryAddDateMatchTT (q, TRUE, from, TRUE, from + 30 * 24 * 3600,
+                                 QOF_QUERY_AND);
+        qof_query_run (q);
+        qof_query_destroy (q);
+    }
+    bench_report ("query-date-range", iterations,
+                  g_get_monotonic_time () - start);
+}
+
+static void
+bench_prices (BenchBook *bb)
+{
+    GNCPriceDB *pdb = gnc_pricedb_get_db (bb->book);
+    gint count = iterations * 100;
+    gint64 start = g_get_monotonic_time ();
+    gint i;
+
+    for (i = 0; i < count; i++)
+    {
+        Timespec ts = { bench_end_time - bench_span +
+                        get_random_int_in_range (0, bench_span), 0 };
+        gnc_commodity *stock = static_cast<gnc_commodity*>(
+            g_ptr_array_index (bb->stocks, i % bb->stocks->len));
+        GNCPrice *price = gnc_pricedb_lookup_nearest_in_time (pdb, stock,
+                                                              bb->currency,
+                                                              ts);
+        gnc_price_unref (price);
+    }
+    bench_report ("price-lookup-nearest", count,
+                  g_get_monotonic_time () - start);
+}
+
+/* Sums with equal denominators take the int64 fast path, while the mixed
+ * ones go through GncRational. */
+static void
+bench_numeric_add (void)
+{
+    gint count = iterations * 50000;
+    gnc_numeric a = gnc_numeric_create (1234, 100);
+    gnc_numeric b = gnc_numeric_create (12340, 1000);
+    gnc_numeric sum = gnc_numeric_create (0, 100);
+    gint64 start = g_get_monotonic_time ();
+    gint i;
+
+    for (i = 0; i < count; i++)
+        sum = gnc_numeric_add (sum, a, GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
+    bench_report ("numeric-add-same-denom", count,
+                  g_get_monotonic_time () - start);
+    if (gnc_numeric_check (sum))
+        fprintf (stderr, "numeric-add-same-denom overflowed\n");
+
+    sum = gnc_numeric_create (0, 1000);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < count; i++)
+        sum = gnc_numeric_add (sum, (i & 1) ? a : b, 1000, GNC_HOW_RND_NEVER);
+    bench_report ("numeric-add-mixed-denom", count,
+                  g_get_monotonic_time () - start);
+    if (gnc_numeric_check (sum))
+        fprintf (stderr, "numeric-add-mixed-denom overflowed\n");
+}
+
+/* Resident set size in pages, 0 where /proc isn't available. */
+static glong
+bench_rss (void)
+{
+    gchar *statm = NULL;
+    glong size = 0, resident = 0;
+
+    if (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL))
+        sscanf (statm, "%ld %ld", &size, &resident);
+    g_free (statm);
+    return resident;
+}
+
+/* Creates and destroys a book of bare two-split transactions, reporting
+ * the memory they took along with the times. */
+static void
+bench_split_allocation (void)
+{
+    QofBook *book = qof_book_new ();
+    Account *acc = xaccMallocAccount (book);
+    glong rss_before = bench_rss ();
+    gint64 start = g_get_monotonic_time ();
+    gint i;
+
+    xaccAccountBeginEdit (acc);
+    for (i = 0; i < num_transactions; i++)
+    {
+        Split *debit = xaccMallocSplit (book);
+        Split *credit = xaccMallocSplit (book);
+        Transaction *trans = xaccMallocTransaction (book);
+
+        xaccTransBeginEdit (trans);
+        xaccSplitSetParent (debit, trans);
+        xaccSplitSetParent (credit, trans);
+        xaccSplitSetMemo (debit, "split allocation");
+        xaccSplitSetAccount (debit, acc);
+        xaccSplitSetAccount (credit, acc);
+        xaccTransCommitEdit (trans);
+    }
+    xaccAccountCommitEdit (acc);
+    bench_report ("transaction-create", num_transactions,
+                  g_get_monotonic_time () - start);
+    printf ("{\"benchmark\":\"transaction-memory\",\"iterations\":%d,"
+            "\"resident-pages\":%ld}\n", num_transactions,
+            bench_rss () - rss_before);
+
+    start = g_get_monotonic_time ();
+    qof_book_destroy (book);
+    bench_report ("transaction-destroy", num_transactions,
+                  g_get_monotonic_time () - start);
+}
+
+static void
+bench_scrub (BenchBook *bb)
+{
+    gint64 start = g_get_monotonic_time ();
+
+    xaccAccountTreeScrubImbalance (bb->root);
+    bench_report ("scrub-imbalance", 1, g_get_monotonic_time () - start);
+}
+
+static void
+bench_sx_instances (BenchBook *bb)
+{
+    SchedXactions *sxes = gnc_book_get_schedxactions (bb->book);
+    Timespec ts = { bench_end_time, 0 };
+    GDate end = timespec_to_gdate (ts);
+    gint count = 0;
+    gint64 start;
+    GList *node;
+
+    start = g_get_monotonic_time ();
+    for (node = sxes->sx_list; node != NULL; node = node->next)
+    {
+        SchedXaction *sx = static_cast<SchedXaction*>(node->data);
+        SXTmpStateData *state = gnc_sx_create_temporal_state (sx);
+        GDate next = xaccSchedXactionGetNextInstance (sx, state);
+        while (g_date_valid (&next) && g_date_compare (&next, &end) <= 0)
+        {
+            count++;
+            gnc_sx_incr_temporal_state (sx, state);
+            next = xaccSchedXactionGetNextInstance (sx, state);
+        }
+        gnc_sx_destroy_temporal_state (state);
+    }
+    bench_report ("sx-instances", count, g_get_monotonic_time () - start);
+}
+
+/* Save the current book through a new session at url, then load it
+ * back into a second session.  The book is swapped into the saving
+ * session and back so that the in-memory benchmarks above still run
+ * against it. */
+static void
+bench_file_backend (const char *name, const char *url)
+{
+    QofSession *current = gnc_get_current_session ();
+    QofSession *save = qof_session_new ();
+    QofSession *load;
+    gchar *label;
+    gint64 start;
+
+    qof_session_begin (save, url, FALSE, TRUE, TRUE);
+    if (qof_session_get_error (save) != ERR_BACKEND_NO_ERR)
+    {
+        bench_skip (name, qof_session_get_error_message (save));
+        qof_session_destroy (save);
+        return;
+    }
+    qof_session_swap_data (current, save);
+    start = g_get_monotonic_time ();
+    qof_session_save (save, NULL);
+    label = g_strdup_printf ("%s-save", name);
+    bench_report (label, 1, g_get_monotonic_time () - start);
+    g_free (label);
+    qof_session_swap_data (current, save);
+    qof_session_end (save);
+    qof_session_destroy (save);
+
+    load = qof_session_new ();
+    qof_session_begin (load, url, TRUE, FALSE, FALSE);
+    start = g_get_monotonic_time ();
+    qof_session_load (load, NULL);
+    label = g_strdup_printf ("%s-load", name);
+    bench_report (label, 1, g_get_monotonic_time () - start);
+    g_free (label);
+    qof_session_end (load);
+    qof_session_destroy (load);
+}
+
+static gboolean
+bench_load_backend (const char *module)
+{
+    gchar **dir;
+
+    for (dir = backend_dirs; *dir != NULL; dir++)
+        if (qof_load_backend_library (*dir, module))
+            return TRUE;
+    return FALSE;
+}
+
+static void
+bench_backend (const char *name, const char *module, const char *scheme,
+               const char *suffix)
+{
+    gchar *file, *path, *url;
+
+    if (!bench_load_backend (module))
+    {
+        bench_skip (name, "backend not loaded");
+        return;
+    }
+    file = g_strdup_printf ("bench-engine-%d.%s", seed, suffix);
+    path = g_build_filename (g_get_tmp_dir (), file, NULL);
+    url = g_strdup_printf ("%s://%s", scheme, path);
+    g_unlink (path);
+    bench_file_backend (name, url);
+    g_unlink (path);
+    g_free (url);
+    g_free (path);
+    g_free (file);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context = g_option_context_new ("- engine benchmarks");
+    GError *error = NULL;
+    BenchBook bb;
+    gint64 start;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+    num_accounts = MAX (num_accounts, 1);
+    splits_per_transaction = MAX (splits_per_transaction, 2);
+    iterations = MAX (iterations, 1);
+    if (backend_dirs == NULL)
+    {
+        backend_dirs = g_new0 (gchar*, 3);
+        backend_dirs[0] = g_strdup ("../../backend/xml/.libs");
+        backend_dirs[1] = g_strdup ("../../backend/dbi/.libs");
+    }
+
+    qof_init ();
+    cashobjects_register ();
+    srand (seed);
+
+    printf ("{\"parameters\":{\"accounts\":%d,\"transactions\":%d,"
+            "\"splits\":%d,\"prices\":%d,\"kvp-density\":%d,\"sxes\":%d,"
+            "\"iterations\":%d,\"seed\":%d,\"split-bytes\":%d}}\n",
+            num_accounts, num_transactions, splits_per_transaction,
+            num_prices, kvp_density, num_sxes, iterations, seed,
+            (gint) sizeof (Split));
+
+    bb.book = qof_session_get_book (gnc_get_current_session ());
+    start = g_get_monotonic_time ();
+    bench_build_book (&bb);
+    bench_report ("build-book", 1, g_get_monotonic_time () - start);
+
+    bench_balances (&bb);
+    bench_split_scan (&bb);
+    bench_queries (&bb);
+    bench_prices (&bb);
+    bench_numeric_add ();
+    bench_split_allocation ();
+    bench_sx_instances (&bb);
+    bench_backend ("xml", "gncmod-backend-xml", "xml", "gnucash");
+    bench_backend ("sqlite", "gncmod-backend-dbi", "sqlite3", "sqlite");
+    bench_scrub (&bb);
+
+    g_ptr_array_free (bb.accounts, TRUE);
+    g_ptr_array_free (bb.stocks, TRUE);
+    g_strfreev (backend_dirs);
+    gnc_clear_current_session ();
+    qof_close ();
+    return 0;
+}
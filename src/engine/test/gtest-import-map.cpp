@@ -270,6 +270,35 @@ TEST_F(ImapBayesTest, FindAccountBayes)
     EXPECT_EQ(nullptr, account);
 }
 
+TEST_F(ImapBayesTest, FindAccountBayesAfterChanges)
+{
+    // Compile the (empty) map, then let add_account_bayes update it
+    EXPECT_EQ(nullptr, gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    gnc_account_imap_add_account_bayes(t_imap, t_list1, t_expense_account1);
+    EXPECT_EQ(t_expense_account1,
+              gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    // foo and bar are now as likely to be either account
+    gnc_account_imap_add_account_bayes(t_imap, t_list1, t_expense_account2);
+    EXPECT_EQ(nullptr, gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    for (int i = 0; i < 3; ++i)
+        gnc_account_imap_add_account_bayes(t_imap, t_list1, t_expense_account2);
+    EXPECT_EQ(t_expense_account2,
+              gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    EXPECT_EQ(nullptr, gnc_account_imap_find_account_bayes(t_imap, t_list3));
+
+    // Other edits of the map are seen once they're committed
+    auto root = qof_instance_get_slots(QOF_INSTANCE(t_bank_account));
+    auto acct1_guid = guid_to_string (xaccAccountGetGUID(t_expense_account1));
+    xaccAccountBeginEdit(t_bank_account);
+    root->set_path({IMAP_FRAME_BAYES, pepper, acct1_guid},
+                   new KvpValue(INT64_C(1)));
+    qof_instance_set_dirty(QOF_INSTANCE(t_bank_account));
+    xaccAccountCommitEdit(t_bank_account);
+    EXPECT_EQ(t_expense_account1,
+              gnc_account_imap_find_account_bayes(t_imap, t_list3));
+    g_free(acct1_guid);
+}
+
 TEST_F(ImapBayesTest, AddAccountBayes)
 {
     // prevent the embedded beginedit/commitedit from doing anything
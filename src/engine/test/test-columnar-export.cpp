@@ -0,0 +1,258 @@
+/***************************************************************************
+ *            test-columnar-export.cpp
+ *
+ *  Writes a random book with gnc_book_export_columnar() and reads the
+ *  file back.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+extern "C"
+{
+#include "config.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "cashobjects.h"
+#include "Split.h"
+#include "TransLog.h"
+#include "gnc-columnar-export.h"
+#include "gnc-pricedb.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+}
+
+#include <string>
+#include <vector>
+
+/* Just enough of a reader to check the file. */
+struct Column
+{
+    std::string name;
+    int type;
+    std::vector<guint8> data;
+};
+
+struct Table
+{
+    std::string name;
+    std::vector<Column> columns;
+    guint rows = 0;
+    guint groups = 0;
+};
+
+class Reader
+{
+public:
+    Reader(const gchar *data, gsize len) : m_data(data), m_len(len) {}
+    bool ok() const { return m_ok; }
+    bool at_end() const { return m_pos == m_len; }
+
+    const guint8 *bytes(gsize len)
+    {
+        if (!m_ok || m_len - m_pos < len)
+        {
+            m_ok = false;
+            return nullptr;
+        }
+        auto p = reinterpret_cast<const guint8*>(m_data + m_pos);
+        m_pos += len;
+        return p;
+    }
+    guint32 u32()
+    {
+        guint32 val = 0;
+        if (auto p = bytes(sizeof val))
+            memcpy(&val, p, sizeof val);
+        return GUINT32_FROM_LE(val);
+    }
+    guint64 u64()
+    {
+        guint64 val = 0;
+        if (auto p = bytes(sizeof val))
+            memcpy(&val, p, sizeof val);
+        return GUINT64_FROM_LE(val);
+    }
+    std::string name(guint32 len)
+    {
+        auto p = bytes(len);
+        return p ? std::string(reinterpret_cast<const char*>(p), len) : "";
+    }
+
+private:
+    const gchar *m_data;
+    gsize m_len;
+    gsize m_pos = 0;
+    bool m_ok = true;
+};
+
+static bool
+read_tables (Reader& reader, std::vector<Table>& tables)
+{
+    static const guint8 magic[8] = { 'G', 'N', 'C', 'C', 'O', 'L', 0, 1 };
+    auto head = reader.bytes(sizeof magic);
+    if (!head || memcmp (head, magic, sizeof magic))
+        return false;
+
+    for (guint32 len; (len = reader.u32()) && reader.ok();)
+    {
+        Table table;
+        table.name = reader.name(len);
+        auto n_columns = reader.u32();
+        for (guint32 i = 0; i < n_columns && reader.ok(); ++i)
+        {
+            Column col;
+            auto type = reader.bytes(1);
+            col.type = type ? *type : 0;
+            col.name = reader.name(reader.u32());
+            table.columns.push_back(col);
+        }
+        for (guint32 rows; (rows = reader.u32()) && reader.ok();)
+        {
+            table.rows += rows;
+            table.groups++;
+            for (auto& col : table.columns)
+            {
+                auto size = reader.u64();
+                auto p = reader.bytes(size);
+                if (p)
+                    col.data.insert(col.data.end(), p, p + size);
+            }
+        }
+        tables.push_back(table);
+    }
+    return reader.ok() && reader.at_end();
+}
+
+static const Column *
+find_column (const Table& table, const char *name)
+{
+    for (auto& col : table.columns)
+        if (col.name == name)
+            return &col;
+    return nullptr;
+}
+
+static gint64
+int64_at (const Column *col, guint row)
+{
+    guint64 val;
+    memcpy (&val, col->data.data() + row * sizeof val, sizeof val);
+    return GUINT64_FROM_LE(val);
+}
+
+static void
+check_splits (QofBook *book, const Table& table)
+{
+    auto guids = find_column (table, "guid");
+    auto num = find_column (table, "amount_num");
+    auto denom = find_column (table, "amount_denom");
+    auto value_num = find_column (table, "value_num");
+
+    do_test (guids && guids->type == GNC_COLUMN_GUID &&
+             guids->data.size() == table.rows * GUID_DATA_SIZE,
+             "split guids are 16 bytes each");
+    do_test (num && denom && value_num && num->type == GNC_COLUMN_INT64 &&
+             num->data.size() == table.rows * sizeof (gint64),
+             "split amounts are int64 columns");
+    if (!guids || !num || !denom || !value_num)
+        return;
+
+    guint matched = 0;
+    for (guint row = 0; row < table.rows; ++row)
+    {
+        GncGUID guid;
+        memcpy (guid.reserved, guids->data.data() + row * GUID_DATA_SIZE,
+                GUID_DATA_SIZE);
+        auto split = xaccSplitLookup (&guid, book);
+        if (!split)
+            continue;
+        auto amount = xaccSplitGetAmount (split);
+        if (amount.num == int64_at (num, row) &&
+            amount.denom == int64_at (denom, row) &&
+            xaccSplitGetValue (split).num == int64_at (value_num, row))
+            matched++;
+    }
+    do_test (matched == table.rows, "each split row matches its split");
+}
+
+static void
+run_test (void)
+{
+    QofBook *book = get_random_book ();
+    gchar *filename = NULL, *contents = NULL;
+    gsize len = 0;
+    gint fd;
+
+    add_random_transactions_to_book (book, 50);
+
+    fd = g_file_open_tmp ("test-columnar-XXXXXX", &filename, NULL);
+    do_test (fd >= 0, "temporary file created");
+    if (fd < 0)
+        return;
+    close (fd);
+
+    /* A small group size, so that the tables need several groups. */
+    do_test (gnc_book_export_columnar (book, filename, 7), "book exported");
+    do_test (g_file_get_contents (filename, &contents, &len, NULL),
+             "export read back");
+
+    Reader reader(contents, len);
+    std::vector<Table> tables;
+    do_test (read_tables (reader, tables), "export is well formed");
+
+    const char *names[] = { "accounts", "transactions", "splits", "prices",
+                            "lots" };
+    QofIdType types[] = { GNC_ID_ACCOUNT, GNC_ID_TRANS, GNC_ID_SPLIT, NULL,
+                          GNC_ID_LOT };
+    do_test (tables.size() == G_N_ELEMENTS (names), "all tables written");
+    for (guint i = 0; i < tables.size() && i < G_N_ELEMENTS (names); ++i)
+    {
+        auto& table = tables[i];
+        guint expected = types[i] ?
+            qof_collection_count (qof_book_get_collection (book, types[i])) :
+            gnc_pricedb_get_num_prices (gnc_pricedb_get_db (book));
+
+        do_test (table.name == names[i], "tables in order");
+        do_test_args (table.rows == expected, "one row per object",
+                      __FILE__, __LINE__, "%s: %u rows, %u objects",
+                      names[i], table.rows, expected);
+        do_test (table.groups == (table.rows + 6) / 7,
+                 "rows written in groups");
+        if (table.name == "splits")
+            check_splits (book, table);
+    }
+
+    g_free (contents);
+    g_unlink (filename);
+    g_free (filename);
+    qof_book_destroy (book);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init();
+    if (cashobjects_register())
+    {
+        xaccLogDisable ();
+        run_test ();
+        print_test_results();
+    }
+    qof_close();
+    return get_rv();
+}
@@ -181,6 +181,43 @@ test_commodity(void)
         }
     }
 
+    {
+        QofBook *book = qof_book_new ();
+        gnc_commodity_table *tbl = gnc_commodity_table_get_table (book);
+        gnc_commodity *a, *b;
+
+        a = gnc_commodity_new (book, "Alpha Fund", "FUND", "ALF",
+                               "123456789", 1000);
+        b = gnc_commodity_new (book, "Beta Fund", "FUND", "BTF", NULL, 1000);
+        gnc_commodity_table_insert (tbl, a);
+        gnc_commodity_table_insert (tbl, b);
+
+        do_test (gnc_commodity_table_lookup_by_cusip (tbl, "123456789") == a,
+                 "lookup by cusip");
+        do_test (gnc_commodity_table_find_full (tbl, "FUND", "ALF (Alpha Fund)")
+                 == a, "find by printname");
+        do_test (gnc_commodity_table_find_full (tbl, "AMEX", "ALF (Alpha Fund)")
+                 == NULL, "find by printname in another namespace");
+
+        gnc_commodity_set_cusip (b, "123456789");
+        gnc_commodity_set_cusip (a, "987654321");
+        do_test (gnc_commodity_table_lookup_by_cusip (tbl, "123456789") == b,
+                 "lookup by changed cusip");
+        do_test (gnc_commodity_table_lookup_by_cusip (tbl, "987654321") == a,
+                 "lookup by new cusip");
+
+        gnc_commodity_set_fullname (a, "Alpha Growth Fund");
+        do_test (gnc_commodity_table_find_full (tbl, "FUND", "ALF (Alpha Fund)")
+                 == NULL, "find by old printname");
+        do_test (gnc_commodity_table_find_full (tbl, "FUND",
+                 "ALF (Alpha Growth Fund)") == a, "find by new printname");
+
+        gnc_commodity_table_remove (tbl, b);
+        do_test (gnc_commodity_table_lookup_by_cusip (tbl, "123456789") == NULL,
+                 "lookup by cusip after remove");
+        gnc_commodity_destroy (b);
+        qof_book_destroy (book);
+    }
 }
 
 int
@@ -32,6 +32,7 @@ extern "C"
 #include "qof.h"
 #include "Account.h"
 #include "Scrub3.h"
+#include "gnc-lot.h"
 #include "cashobjects.h"
 #include "test-stuff.h"
 #include "test-engine-stuff.h"
@@ -41,6 +42,69 @@ extern "C"
 static gint transaction_num = 320;
 static gint	max_iterate = 10;
 
+/* Compare the lot's cached balances with sums over its splits. */
+static void
+check_lot_balances (GNCLot *lot)
+{
+    SplitList *splits = gnc_lot_get_split_list (lot), *node, *other;
+    gnc_numeric total = gnc_numeric_zero ();
+
+    for (node = splits; node; node = node->next)
+    {
+        Split *split = static_cast<Split*>(node->data);
+        Split *target = xaccSplitGetGainsSourceSplit (split);
+        Transaction *tb;
+        gnc_numeric amt = gnc_numeric_zero (), val = gnc_numeric_zero ();
+        gnc_numeric lot_amt, lot_val;
+
+        total = gnc_numeric_add_fixed (total, xaccSplitGetAmount (split));
+        if (!target) target = split;
+        tb = xaccSplitGetParent (target);
+        for (other = splits; other; other = other->next)
+        {
+            Split *s = static_cast<Split*>(other->data);
+            Split *source = xaccSplitGetGainsSourceSplit (s);
+            Transaction *ta;
+            if (!source) source = s;
+            ta = xaccSplitGetParent (source);
+            if ((ta == tb && source != target) || xaccTransOrder (ta, tb) < 0)
+            {
+                amt = gnc_numeric_add_fixed (amt, xaccSplitGetAmount (s));
+                val = gnc_numeric_add_fixed (val, xaccSplitGetValue (s));
+            }
+        }
+        gnc_lot_get_balance_before (lot, split, &lot_amt, &lot_val);
+        do_test (gnc_numeric_equal (amt, lot_amt), "lot amount before split");
+        do_test (gnc_numeric_equal (val, lot_val), "lot value before split");
+    }
+    do_test (gnc_numeric_equal (total, gnc_lot_get_balance (lot)),
+             "lot balance");
+}
+
+static void
+check_balances (Account *acc, gpointer data)
+{
+    LotList *lots = xaccAccountGetLotList (acc), *node;
+    for (node = lots; node; node = node->next)
+    {
+        GNCLot *lot = static_cast<GNCLot*>(node->data);
+        Split *split = gnc_lot_get_earliest_split (lot);
+        Transaction *trans;
+
+        check_lot_balances (lot);
+        if (!split) continue;
+        /* Changing an amount must throw the cached balances away. */
+        trans = xaccSplitGetParent (split);
+        xaccTransBeginEdit (trans);
+        xaccSplitSetAmount (split, gnc_numeric_add_fixed (xaccSplitGetAmount (split),
+                                                          gnc_numeric_create (1, 1)));
+        check_lot_balances (lot);
+        xaccTransRollbackEdit (trans);
+        check_lot_balances (lot);
+    }
+    g_list_free (lots);
+}
+
 static void
 run_test (void)
 {
@@ -59,6 +123,7 @@ run_test (void)
 
     root = gnc_book_get_root_account (book);
     xaccAccountTreeScrubLots (root);
+    gnc_account_foreach_descendant (root, check_balances, NULL);
 
     /* --------------------------------------------------------- */
     /* In the second test, we create an account with unrealized gains,
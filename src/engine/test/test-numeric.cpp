@@ -170,6 +170,28 @@ check_reduce (void)
                     gnc_numeric_create (1, 1024 * 1024 * 1024),
                     rval,
                     val, "check_reduce(3): expected %s got %s = reduce(%s)");
+
+    /* Powers of ten take a shortcut around the GCD. */
+    val = gnc_numeric_create(-1562500LL, 10000000LL);
+    rval = gnc_numeric_reduce (val);
+    check_unary_op (gnc_numeric_eq,
+                    gnc_numeric_create (-5, 32),
+                    rval,
+                    val, "check_reduce(4): expected %s got %s = reduce(%s)");
+
+    val = gnc_numeric_create(250000000000000000LL, 1000000000000000000LL);
+    rval = gnc_numeric_reduce (val);
+    check_unary_op (gnc_numeric_eq,
+                    gnc_numeric_create (1, 4),
+                    rval,
+                    val, "check_reduce(5): expected %s got %s = reduce(%s)");
+
+    val = gnc_numeric_create(0, 1000);
+    rval = gnc_numeric_reduce (val);
+    check_unary_op (gnc_numeric_eq,
+                    gnc_numeric_create (0, 1),
+                    rval,
+                    val, "check_reduce(6): expected %s got %s = reduce(%s)");
 }
 
 /* ======================================================= */
@@ -429,6 +451,13 @@ check_add_subtract (void)
                                      GNC_HOW_RND_ROUND),
                      a, b, "expected %s got %s = %s + %s for add 6 sig figs");
 
+    check_binary_op (gnc_numeric_create(5833333333333333LL,
+                                        10000000000000000LL),
+                     gnc_numeric_add(a, b, GNC_DENOM_AUTO,
+                                     GNC_HOW_DENOM_SIGFIGS(16) |
+                                     GNC_HOW_RND_ROUND),
+                     a, b, "expected %s got %s = %s + %s for add 16 sig figs");
+
     check_binary_op (gnc_numeric_create(1, 12),
                      gnc_numeric_sub(a, b, GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT),
                      a, b, "expected %s got %s = %s - %s for sub exact");
@@ -667,6 +696,98 @@ check_add_subtract_overflow (void)
 
 /* ======================================================= */
 
+static void
+check_add_subtract_same_denom (void)
+{
+    gnc_numeric a = gnc_numeric_create (150, 100);
+    gnc_numeric b = gnc_numeric_create (-25, 100);
+    gnc_numeric big = gnc_numeric_create (INT64_MAX - 10, 100);
+
+    check_binary_op (gnc_numeric_create (125, 100),
+                     gnc_numeric_add (a, b, GNC_DENOM_AUTO,
+                                      GNC_HOW_DENOM_FIXED | GNC_HOW_RND_NEVER),
+                     a, b, "expected %s got %s = %s + %s for add fixed");
+    check_binary_op (gnc_numeric_create (175, 100),
+                     gnc_numeric_sub (a, b, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD),
+                     a, b, "expected %s got %s = %s - %s for sub lcd");
+    check_binary_op (gnc_numeric_create (125, 100),
+                     gnc_numeric_add (a, b, 100, GNC_HOW_RND_NEVER),
+                     a, b, "expected %s got %s = %s + %s for add 100ths");
+    /* The fast path mustn't skip reducing or converting the result */
+    check_binary_op (gnc_numeric_create (5, 4),
+                     gnc_numeric_add (a, b, GNC_DENOM_AUTO,
+                                      GNC_HOW_DENOM_REDUCE),
+                     a, b, "expected %s got %s = %s + %s for add reduce");
+    check_binary_op (gnc_numeric_create (13, 10),
+                     gnc_numeric_add (a, b, 10, GNC_HOW_RND_ROUND_HALF_UP),
+                     a, b, "expected %s got %s = %s + %s for add 10ths");
+    /* An int64 overflow falls back to the 128-bit code */
+    do_test (gnc_numeric_check (gnc_numeric_add (big, a, GNC_DENOM_AUTO,
+                                                 GNC_HOW_DENOM_FIXED)) ==
+             GNC_ERROR_OVERFLOW, "same-denominator add overflow");
+    do_test (gnc_numeric_check (gnc_numeric_add (big, b, GNC_DENOM_AUTO,
+                                                 GNC_HOW_DENOM_FIXED)) ==
+             GNC_ERROR_OK, "same-denominator add near the limit");
+}
+
+static void
+check_sum_array (void)
+{
+    gnc_numeric values[] = {
+        gnc_numeric_create (150, 100),
+        gnc_numeric_create (INT64_MAX - 100, 100),
+        gnc_numeric_create (-25, 100),
+        gnc_numeric_create (-(INT64_MAX - 100), 100),
+        gnc_numeric_create (0, 7),
+    };
+    gnc_numeric mixed[] = {
+        gnc_numeric_create (1, 3),
+        gnc_numeric_create (1, 4),
+        gnc_numeric_create (5, 100),
+    };
+    gnc_numeric multiplied[] = {
+        gnc_numeric_create (INT64_C(1) << 61, -8),
+        gnc_numeric_create (-(INT64_C(1) << 61), -8),
+        gnc_numeric_create (3, 1),
+    };
+    gnc_numeric sum;
+
+    /* The lane overflows on the way but the total doesn't */
+    sum = gnc_numeric_sum_array (values, G_N_ELEMENTS (values),
+                                 GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
+    do_test (gnc_numeric_eq (sum, gnc_numeric_create (125, 100)),
+             "sum array with overflowing lane");
+    sum = gnc_numeric_sum_array (values, 0, GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_FIXED);
+    do_test (gnc_numeric_zero_p (sum), "sum empty array");
+
+    sum = gnc_numeric_sum_array (mixed, G_N_ELEMENTS (mixed), 100,
+                                 GNC_HOW_RND_ROUND_HALF_UP);
+    do_test (gnc_numeric_eq (sum, gnc_numeric_create (63, 100)),
+             "sum array of mixed denominators rounded once");
+    sum = gnc_numeric_sum_array (mixed, G_N_ELEMENTS (mixed), GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_LCD);
+    do_test (gnc_numeric_eq (sum, gnc_numeric_create (190, 300)),
+             "sum array of mixed denominators exactly");
+    sum = gnc_numeric_sum_array (mixed, G_N_ELEMENTS (mixed), GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_FIXED);
+    do_test (gnc_numeric_check (sum) == GNC_ERROR_DENOM_DIFF,
+             "sum array of mixed denominators fixed");
+
+    /* Negative denominators multiply; the products needn't fit in 64 bits
+     * as long as the sum does. */
+    sum = gnc_numeric_sum_array (multiplied, G_N_ELEMENTS (multiplied),
+                                 GNC_DENOM_AUTO, GNC_HOW_DENOM_FIXED);
+    do_test (gnc_numeric_eq (sum, gnc_numeric_create (3, 1)),
+             "sum array of multiples too big for an int64");
+    sum = gnc_numeric_sum_array (multiplied, 1, GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_FIXED);
+    do_test (gnc_numeric_check (sum) == GNC_ERROR_OVERFLOW,
+             "sum array of a multiple too big for an int64");
+}
+
+/* ======================================================= */
+
 
 static void
 check_mult_div (void)
@@ -695,6 +816,29 @@ check_mult_div (void)
                      gnc_numeric_mul(a, b, GNC_DENOM_AUTO, GNC_HOW_DENOM_EXACT),
                      a, b, "expected %s got %s = %s * %s mult exact");
 
+    /* A negative product too big for 64 bits is an overflow, too. */
+    a = gnc_numeric_create(-4611686018427387904LL, 1);
+    b = gnc_numeric_create(4, 1);
+    do_test (gnc_numeric_check (gnc_numeric_mul (a, b, GNC_DENOM_AUTO,
+                                                 GNC_HOW_DENOM_EXACT)) ==
+             GNC_ERROR_OVERFLOW, "negative mult overflow");
+
+    /* mul_div keeps the product at 128 bits; this one doesn't fit 64. */
+    a = gnc_numeric_create(123456789012LL, 1000);
+    b = gnc_numeric_create(987654321098765LL, 1000000);
+    c = gnc_numeric_create(1234567, 1000);
+    check_binary_op (gnc_numeric_create(9876550331952849LL, 100),
+                     gnc_numeric_mul_div(a, b, c, 100, GNC_HOW_RND_ROUND),
+                     a, b, "expected %s got %s = %s * %s / c mul_div 100ths");
+
+    a = gnc_numeric_create(-5, 3);
+    b = gnc_numeric_create(7, 11);
+    c = gnc_numeric_create(2, 13);
+    check_binary_op (gnc_numeric_create(-689, 100),
+                     gnc_numeric_mul_div(a, b, c, 100,
+                                         GNC_HOW_RND_ROUND_HALF_UP),
+                     a, b, "expected %s got %s = %s * %s / c mul_div half up");
+
     a = gnc_numeric_create(2, 6);
     b = gnc_numeric_create(1, 4);
 
@@ -992,6 +1136,8 @@ run_test (void)
     check_neg();
     check_add_subtract();
     check_add_subtract_overflow ();
+    check_add_subtract_same_denom ();
+    check_sum_array ();
     check_mult_div ();
     check_reciprocal();
 }
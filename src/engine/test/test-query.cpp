@@ -67,6 +67,402 @@ test_trans_query (Transaction *trans, gpointer data)
     return 0;
 }
 
+/* A query for an account's splits is answered from the account's split
+ * list, and must still find all of them and nothing else. */
+static void
+test_account_query (Account *acc, gpointer data)
+{
+    QofBook *book = QOF_BOOK(data);
+    GList *splits = xaccAccountGetSplitList (acc);
+    GList *list, *node;
+    QofQuery *q;
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_OR);
+
+    list = qof_query_run (q);
+    if (g_list_length (list) != g_list_length (splits))
+    {
+        failure_args ("test account query", __FILE__, __LINE__,
+                      "number of matching splits %d not %d",
+                      g_list_length (list), g_list_length (splits));
+        qof_query_destroy (q);
+        return;
+    }
+    for (node = list; node; node = node->next)
+        if (xaccSplitGetAccount (static_cast<Split*>(node->data)) != acc)
+        {
+            failure ("matching split is in the wrong account");
+            qof_query_destroy (q);
+            return;
+        }
+
+    success ("found the account's splits");
+    qof_query_destroy (q);
+}
+
+/* Asking for the last few sorted splits must give the tail of the full
+ * sorted result. */
+static void
+test_max_results (QofBook *book)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    GList *all, *last, *node;
+    const gint max = 5;
+
+    qof_query_set_book (q, book);
+    qof_query_set_sort_order (q,
+                              qof_query_build_param_list (SPLIT_TRANS,
+                                                          TRANS_DATE_POSTED,
+                                                          NULL),
+                              qof_query_build_param_list (SPLIT_VALUE, NULL),
+                              NULL);
+    all = g_list_copy (qof_query_run (q));
+    qof_query_set_max_results (q, max);
+    last = qof_query_run (q);
+
+    node = g_list_nth (all, MAX ((gint)g_list_length (all) - max, 0));
+    for (; node && last; node = node->next, last = last->next)
+        if (node->data != last->data)
+            break;
+    if (node || last)
+        failure ("max results isn't the end of the sorted splits");
+    else
+        success ("max results is the end of the sorted splits");
+    g_list_free (all);
+    qof_query_destroy (q);
+}
+
+/* The sorted splits must be in order of all the sort keys. */
+static void
+test_sort_order (QofBook *book)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    GList *list, *node;
+
+    qof_query_set_book (q, book);
+    qof_query_set_sort_order (q,
+                              qof_query_build_param_list (SPLIT_ACCT_FULLNAME,
+                                                          NULL),
+                              qof_query_build_param_list (SPLIT_TRANS,
+                                                          TRANS_DATE_POSTED,
+                                                          NULL),
+                              NULL);
+    qof_query_set_sort_increasing (q, TRUE, FALSE, TRUE);
+    list = qof_query_run (q);
+
+    for (node = list; node && node->next; node = node->next)
+    {
+        Split *a = static_cast<Split*>(node->data);
+        Split *b = static_cast<Split*>(node->next->data);
+        int cmp = xaccSplitCompareAccountFullNames (a, b);
+
+        /* then by decreasing date */
+        if (cmp == 0 && xaccTransGetDate (xaccSplitGetParent (a)) <
+                xaccTransGetDate (xaccSplitGetParent (b)))
+            cmp = 1;
+        if (cmp > 0)
+            break;
+    }
+    if (node && node->next)
+        failure ("sorted splits are out of order");
+    else
+        success ("sorted splits are in order");
+    qof_query_destroy (q);
+}
+
+/* Case-insensitive searches must fold ASCII and other descriptions alike. */
+static void
+test_description_nocase (QofBook *book)
+{
+    static const struct
+    {
+        const char *description;
+        const char *needle;
+    } cases[] =
+    {
+        { "Grocery Run", "CERY r" },
+        { "\xc3\x9c" "ber Caf\xc3\xa9", "\xc3\xbc" "BER CAF\xc3\x89" },
+    };
+    gnc_commodity *currency = get_random_commodity (book);
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (cases); ++i)
+    {
+        Transaction *trans = xaccMallocTransaction (book);
+        QofQuery *q = qof_query_create_for (GNC_ID_TRANS);
+        GList *list;
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, currency);
+        xaccTransSetDescription (trans, cases[i].description);
+        xaccTransCommitEdit (trans);
+
+        qof_query_set_book (q, book);
+        qof_query_add_term (q, qof_query_build_param_list (TRANS_DESCRIPTION,
+                                                           NULL),
+                            qof_query_string_predicate (QOF_COMPARE_CONTAINS,
+                                                        cases[i].needle,
+                                                        QOF_STRING_MATCH_CASEINSENSITIVE,
+                                                        FALSE),
+                            QOF_QUERY_AND);
+        list = qof_query_run (q);
+        if (g_list_find (list, trans))
+            success ("found description ignoring case");
+        else
+            failure_args ("test description nocase", __FILE__, __LINE__,
+                          "no match for %s in %s", cases[i].needle,
+                          cases[i].description);
+        qof_query_destroy (q);
+    }
+}
+
+static guint
+num_query_count (QofBook *book, const char *num, Transaction *trans)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    GList *node;
+    guint count = 0;
+
+    qof_query_set_book (q, book);
+    qof_query_add_term (q, qof_query_build_param_list (SPLIT_TRANS, TRANS_NUM,
+                                                       NULL),
+                        qof_query_string_predicate (QOF_COMPARE_EQUAL, num,
+                                                    QOF_STRING_MATCH_NORMAL,
+                                                    FALSE),
+                        QOF_QUERY_AND);
+    /* Any split of another transaction spoils the count. */
+    for (node = qof_query_run (q); node; node = node->next)
+    {
+        if (xaccSplitGetParent (static_cast<Split*>(node->data)) != trans)
+        {
+            count = G_MAXUINT;
+            break;
+        }
+        ++count;
+    }
+    qof_query_destroy (q);
+    return count;
+}
+
+/* A search for a transaction number is answered from the index of
+ * transactions by number, which has to follow the number's changes. */
+static void
+test_num_query (QofBook *book, Account *root)
+{
+    GList *accounts = gnc_account_get_descendants (root);
+    Split *split = NULL;
+    Transaction *trans;
+    guint nsplits;
+
+    for (GList *node = accounts; node && !split; node = node->next)
+        split = static_cast<Split*>(g_list_nth_data (xaccAccountGetSplitList
+                                    (static_cast<Account*>(node->data)), 0));
+    g_list_free (accounts);
+    if (!split)
+        return;
+    trans = xaccSplitGetParent (split);
+    nsplits = g_list_length (xaccTransGetSplitList (trans));
+
+    xaccTransBeginEdit (trans);
+    xaccTransSetNum (trans, "test-num-query-1");
+    xaccTransCommitEdit (trans);
+    if (num_query_count (book, "test-num-query-1", trans) != nsplits)
+        failure ("number search missed the transaction's splits");
+    else
+        success ("number search found the transaction's splits");
+
+    xaccTransBeginEdit (trans);
+    xaccTransSetNum (trans, "test-num-query-2");
+    xaccTransCommitEdit (trans);
+    if (num_query_count (book, "test-num-query-1", trans) != 0 ||
+        num_query_count (book, "test-num-query-2", trans) != nsplits)
+        failure ("number search didn't follow the change of number");
+    else
+        success ("number search followed the change of number");
+}
+
+static gboolean
+unreconciled_query_ok (QofBook *book, Account *acc)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    guint expected = 0, found = 0;
+    GList *node;
+
+    for (node = xaccAccountGetSplitList (acc); node; node = node->next)
+    {
+        char recn = xaccSplitGetReconcile (static_cast<Split*>(node->data));
+        if (recn == NREC || recn == CREC)
+            ++expected;
+    }
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    xaccQueryAddClearedMatch (q, static_cast<cleared_match_t>
+                              (CLEARED_NO | CLEARED_CLEARED), QOF_QUERY_AND);
+    for (node = qof_query_run (q); node; node = node->next, ++found)
+    {
+        auto split = static_cast<Split*>(node->data);
+        char recn = xaccSplitGetReconcile (split);
+        if (xaccSplitGetAccount (split) != acc ||
+            (recn != NREC && recn != CREC))
+            break;
+    }
+    qof_query_destroy (q);
+    return !node && found == expected;
+}
+
+/* The query the reconcile window runs comes from the account's set of
+ * splits that aren't reconciled, which follows their reconcile states. */
+static void
+test_unreconciled_query (QofBook *book, Account *root)
+{
+    GList *accounts = gnc_account_get_descendants (root);
+    Split *split = NULL;
+
+    for (GList *node = accounts; node && !split; node = node->next)
+        split = static_cast<Split*>(g_list_nth_data (xaccAccountGetSplitList
+                                    (static_cast<Account*>(node->data)), 0));
+    g_list_free (accounts);
+    if (!split)
+        return;
+
+    xaccSplitSetReconcile (split, YREC);
+    if (!unreconciled_query_ok (book, xaccSplitGetAccount (split)))
+        failure ("unreconciled splits wrong after reconciling one");
+    else
+        success ("unreconciled splits right after reconciling one");
+    xaccSplitSetReconcile (split, NREC);
+    if (!unreconciled_query_ok (book, xaccSplitGetAccount (split)))
+        failure ("unreconciled splits wrong after unreconciling one");
+    else
+        success ("unreconciled splits right after unreconciling one");
+}
+
+static gboolean
+same_splits (GList *a, GList *b)
+{
+    for (; a && b; a = a->next, b = b->next)
+        if (a->data != b->data)
+            return FALSE;
+    return !a && !b;
+}
+
+/* A live query must follow changes to its splits and their transactions
+ * and give the same results as running it afresh. */
+static void
+test_live_query (QofBook *book, Account *root)
+{
+    GList *accounts = gnc_account_get_descendants (root);
+    GList *node, *added, *changed, *removed;
+    Account *acc = NULL;
+    QofQuery *q, *fresh;
+    Split *moved, *gone;
+    Transaction *trans;
+
+    for (node = accounts; node; node = node->next)
+        if (!acc || (g_list_length (xaccAccountGetSplitList (static_cast<Account*>(node->data))) >
+                     g_list_length (xaccAccountGetSplitList (acc))))
+            acc = static_cast<Account*>(node->data);
+    g_list_free (accounts);
+    if (!acc || g_list_length (xaccAccountGetSplitList (acc)) < 2)
+        return;
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    qof_query_set_sort_order (q,
+                              qof_query_build_param_list (SPLIT_TRANS,
+                                                          TRANS_DATE_POSTED,
+                                                          NULL),
+                              qof_query_build_param_list (QUERY_DEFAULT_SORT,
+                                                          NULL),
+                              NULL);
+    qof_query_set_live (q, TRUE);
+    qof_query_run (q);
+    if (qof_query_take_changes (q, &added, &changed, &removed))
+        failure ("first changes of a live query should be a reset");
+
+    moved = static_cast<Split*>(qof_query_last_run (q)->data);
+    gone = static_cast<Split*>(qof_query_last_run (q)->next->data);
+    trans = xaccSplitGetParent (moved);
+    xaccTransBeginEdit (trans);
+    xaccTransSetDatePostedSecs (trans, gnc_time (NULL) + 365 * 24 * 3600);
+    xaccTransCommitEdit (trans);
+    if (xaccSplitGetParent (gone) != trans)
+    {
+        trans = xaccSplitGetParent (gone);
+        xaccTransBeginEdit (trans);
+        xaccSplitDestroy (gone);
+        xaccTransCommitEdit (trans);
+    }
+    else
+        gone = NULL;
+
+    if (!qof_query_take_changes (q, &added, &changed, &removed))
+        failure ("live query lost track of the changes");
+    else if (!g_list_find (changed, moved) ||
+             (gone && !g_list_find (removed, gone)) || added)
+        failure ("live query reported the wrong changes");
+    else
+        success ("live query reported the changes");
+    g_list_free (added);
+    g_list_free (changed);
+    g_list_free (removed);
+
+    fresh = qof_query_copy (q);
+    if (!same_splits (qof_query_run (q), qof_query_run (fresh)))
+        failure ("live query results differ from a fresh run");
+    else
+        success ("live query results match a fresh run");
+    qof_query_destroy (fresh);
+    qof_query_destroy (q);
+}
+
+/* Checking the splits on several threads, which the query only does
+ * while a snapshot of the book is held, must find the same matches, in
+ * the same order, as checking them on one. */
+static void
+test_threaded_scan (void)
+{
+    QofSession *session = get_random_session ();
+    QofBook *book = qof_session_get_book (session);
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    QofBookSnapshot *snapshot;
+    GList *serial, *threaded, *node;
+
+    add_random_transactions_to_book (book, 2000);
+    qof_book_enable_snapshots (book);
+    qof_query_set_book (q, book);
+    qof_query_add_term (q, qof_query_build_param_list (SPLIT_VALUE, NULL),
+                        qof_query_numeric_predicate (QOF_COMPARE_GT,
+                                                     QOF_NUMERIC_MATCH_ANY,
+                                                     gnc_numeric_zero ()),
+                        QOF_QUERY_AND);
+
+    qof_query_set_thread_count (1);
+    serial = g_list_copy (qof_query_run (q));
+    qof_query_set_thread_count (4);
+    snapshot = qof_book_snapshot_take (book);
+    threaded = qof_query_run (q);
+    qof_book_snapshot_unref (snapshot);
+    qof_query_set_thread_count (1);
+
+    for (node = serial; node && threaded;
+         node = node->next, threaded = threaded->next)
+        if (node->data != threaded->data)
+            break;
+    if (node || threaded)
+        failure ("threaded scan found different splits");
+    else
+        success ("threaded scan found the same splits");
+
+    g_list_free (serial);
+    qof_query_destroy (q);
+    qof_session_end (session);
+}
+
 static void
 run_test (void)
 {
@@ -81,6 +477,13 @@ run_test (void)
     add_random_transactions_to_book (book, 20);
 
     xaccAccountTreeForEachTransaction (root, test_trans_query, book);
+    gnc_account_foreach_descendant (root, test_account_query, book);
+    test_max_results (book);
+    test_sort_order (book);
+    test_description_nocase (book);
+    test_num_query (book, root);
+    test_unreconciled_query (book, root);
+    test_live_query (book, root);
 
     qof_session_end (session);
 }
@@ -108,6 +511,7 @@ main (int argc, char **argv)
     {
         run_test ();
     }
+    test_threaded_scan ();
     success("queries seem to work");
 
 cleanup:
@@ -325,6 +325,42 @@ static void test_some()
     test_specific(PERIOD_DAY, 7,    4, 1, 2000,    4, 8, 2000,  4, 15, 2000);
 }
 
+/* The nth instance must be where stepping from the start n times
+   ends up. */
+static void test_nth_instance(PeriodType pt, guint16 mult,
+                              GDateMonth sm, GDateDay sd, GDateYear sy,
+                              guint n)
+{
+    GDate start, ref, next, nth;
+    Recurrence r;
+    guint i;
+
+    g_date_set_dmy(&start, sd, sm, sy);
+    recurrenceSet(&r, mult, pt, &start, WEEKEND_ADJ_NONE);
+
+    for (next = ref = start, i = 0; i < n; i++)
+    {
+        recurrenceNextInstance(&r, &ref, &next);
+        ref = next;
+    }
+    recurrenceNthInstance(&r, n, &nth);
+    test_equal(&nth, &next);
+}
+
+static void test_nth_instances()
+{
+    test_nth_instance(PERIOD_DAY, 1,     3, 15, 2007,   0);
+    test_nth_instance(PERIOD_DAY, 3,     3, 15, 2007,   500);
+    test_nth_instance(PERIOD_WEEK, 2,    12, 30, 1999,  60);
+    test_nth_instance(PERIOD_MONTH, 1,   1, 31, 2003,   25);
+    test_nth_instance(PERIOD_MONTH, 5,   8, 30, 2003,   17);
+    test_nth_instance(PERIOD_MONTH, 1,   2, 28, 2003,   13);
+    test_nth_instance(PERIOD_YEAR, 1,    2, 29, 2000,   9);
+    test_nth_instance(PERIOD_YEAR, 3,    10, 1, 1990,   7);
+    test_nth_instance(PERIOD_END_OF_MONTH, 1,   4, 12, 2005,   14);
+    test_nth_instance(PERIOD_LAST_WEEKDAY, 1,   4, 29, 2005,   11);
+}
+
 static void test_use()
 {
     Recurrence *r;
@@ -343,6 +379,8 @@ static void test_main()
 
     test_some();
 
+    test_nth_instances();
+
     test_all();
 
     qof_book_destroy (book);
@@ -28,6 +28,7 @@ extern "C"
 #include <gnc-event.h>
 #include <gnc-gdate-utils.h>
 #include <qofinstance-p.h>
+#include <qofbackend-p.h>
 /* Add specific headers for this class */
 #include "../Account.h"
 #include "../AccountP.h"
@@ -898,7 +899,7 @@ test_xaccFreeAccount (Fixture *fixture, gconstpointer pData)
     /* Check that we've got children, lots, and splits to remove */
     g_assert (p_priv->children != NULL);
     g_assert (p_priv->lots != NULL);
-    g_assert (p_priv->splits != NULL);
+    g_assert_cmpuint (p_priv->splits->len, !=, 0);
     g_assert (p_priv->parent != NULL);
     g_assert (p_priv->commodity != NULL);
     g_assert_cmpint (check1->hits, ==, 0);
@@ -1013,7 +1014,7 @@ test_xaccAccountCommitEdit (Fixture *fixture, gconstpointer pData)
     /* Check that we've got children, lots, and splits to remove */
     g_assert (p_priv->children != NULL);
     g_assert (p_priv->lots != NULL);
-    g_assert (p_priv->splits != NULL);
+    g_assert_cmpuint (p_priv->splits->len, !=, 0);
     g_assert (p_priv->parent != NULL);
     g_assert (p_priv->commodity != NULL);
     g_assert_cmpint (check1->hits, ==, 0);
@@ -1029,7 +1030,7 @@ test_xaccAccountCommitEdit (Fixture *fixture, gconstpointer pData)
     test_signal_assert_hits (sig2, 0);
     g_assert (p_priv->children != NULL);
     g_assert (p_priv->lots != NULL);
-    g_assert (p_priv->splits != NULL);
+    g_assert_cmpuint (p_priv->splits->len, !=, 0);
     g_assert (p_priv->parent != NULL);
     g_assert (p_priv->commodity != NULL);
     g_assert_cmpint (check1->hits, ==, 0);
@@ -1119,19 +1120,19 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
 
     /* Check that the call fails with invalid account and split (throws) */
     g_assert (!gnc_account_insert_split (NULL, split1));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 0);
+    g_assert_cmpuint (priv->splits->len, == , 0);
     g_assert (!priv->sort_dirty);
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 0);
     test_signal_assert_hits (sig2, 0);
     g_assert (!gnc_account_insert_split (fixture->acct, NULL));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 0);
+    g_assert_cmpuint (priv->splits->len, == , 0);
     g_assert (!priv->sort_dirty);
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 0);
     test_signal_assert_hits (sig2, 0);
     /* g_assert (!gnc_account_insert_split (fixture->acct, (Split*)priv)); */
-    /* g_assert_cmpuint (g_list_length (priv->splits), == , 0); */
+    /* g_assert_cmpuint (priv->splits->len, == , 0); */
     /* g_assert (!priv->sort_dirty); */
     /* g_assert (!priv->balance_dirty); */
     /* test_signal_assert_hits (sig1, 0); */
@@ -1144,7 +1145,7 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
 
     /* Check that it works the first time */
     g_assert (gnc_account_insert_split (fixture->acct, split1));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 1);
+    g_assert_cmpuint (priv->splits->len, == , 1);
     g_assert (!priv->sort_dirty);
     g_assert (priv->balance_dirty);
     test_signal_assert_hits (sig1, 1);
@@ -1156,7 +1157,7 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     sig3 = test_signal_new (&fixture->acct->inst, GNC_EVENT_ITEM_ADDED, split2);
     /* Now add a second split to the account and check that sort_dirty isn't set. We have to bump the editlevel to force this. */
     g_assert (gnc_account_insert_split (fixture->acct, split2));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 2);
+    g_assert_cmpuint (priv->splits->len, == , 2);
     g_assert (!priv->sort_dirty);
     g_assert (priv->balance_dirty);
     test_signal_assert_hits (sig1, 2);
@@ -1167,7 +1168,7 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     qof_instance_increase_editlevel (fixture->acct);
     g_assert (gnc_account_insert_split (fixture->acct, split3));
     qof_instance_decrease_editlevel (fixture->acct);
-    g_assert_cmpuint (g_list_length (priv->splits), == , 3);
+    g_assert_cmpuint (priv->splits->len, == , 3);
     g_assert (priv->sort_dirty);
     g_assert (priv->balance_dirty);
     test_signal_assert_hits (sig1, 3);
@@ -1178,7 +1179,7 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     sig3 = test_signal_new (&fixture->acct->inst, GNC_EVENT_ITEM_REMOVED,
                             split3);
     g_assert (gnc_account_remove_split (fixture->acct, split3));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 2);
+    g_assert_cmpuint (priv->splits->len, == , 2);
     g_assert (priv->sort_dirty);
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 4);
@@ -1186,7 +1187,7 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
     /* And do it again to make sure that it fails when the split has
      * already been removed */
     g_assert (!gnc_account_remove_split (fixture->acct, split3));
-    g_assert_cmpuint (g_list_length (priv->splits), == , 2);
+    g_assert_cmpuint (priv->splits->len, == , 2);
     g_assert (priv->sort_dirty);
     g_assert (!priv->balance_dirty);
     test_signal_assert_hits (sig1, 4);
@@ -1200,8 +1201,39 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
 void
 xaccAccountSortSplits (Account *acc, gboolean force)// C: 4 in 2
 Make static?
-Passthrough, no test.
 */
+static void
+test_xaccAccountSortSplits (Fixture *fixture, gconstpointer pData)
+{
+    auto root = gnc_account_get_root (fixture->acct);
+    auto accounts = gnc_account_get_descendants (root);
+
+    for (auto node = accounts; node; node = node->next)
+    {
+        auto acc = static_cast<Account*>(node->data);
+        auto priv = fixture->func->get_private (acc);
+        guint len = priv->splits->len;
+
+        if (len < 2)
+            continue;
+        /* Undo the order, then sort it back */
+        for (guint i = 0; i < len / 2; i++)
+        {
+            gpointer tmp = priv->splits->pdata[i];
+            priv->splits->pdata[i] = priv->splits->pdata[len - 1 - i];
+            priv->splits->pdata[len - 1 - i] = tmp;
+        }
+        priv->sort_dirty = TRUE;
+        xaccAccountSortSplits (acc, TRUE);
+        g_assert (!priv->sort_dirty);
+        for (guint i = 1; i < len; i++)
+            g_assert_cmpint (xaccSplitOrder (
+                                 static_cast<Split*>(priv->splits->pdata[i - 1]),
+                                 static_cast<Split*>(priv->splits->pdata[i])),
+                             <, 0);
+    }
+    g_list_free (accounts);
+}
 /* xaccAccountBringUpToDate
 static void
 xaccAccountBringUpToDate (Account *acc)// 3
@@ -1350,6 +1382,92 @@ test_xaccAccountRecomputeBalance (Fixture *fixture, gconstpointer pData)
     g_assert (!priv->balance_dirty);
 }
 
+static void
+check_running_balances (AccountPrivate *priv)
+{
+    auto bal = priv->starting_balance;
+    auto clr_bal = priv->starting_cleared_balance;
+    for (guint i = 0; i < priv->splits->len; ++i)
+    {
+        auto split = static_cast<Split*>(g_ptr_array_index (priv->splits, i));
+        bal = gnc_numeric_add_fixed (bal, xaccSplitGetAmount (split));
+        if (xaccSplitGetReconcile (split) != NREC)
+            clr_bal = gnc_numeric_add_fixed (clr_bal,
+                                             xaccSplitGetAmount (split));
+        g_assert (gnc_numeric_eq (xaccSplitGetBalance (split), bal));
+        g_assert (gnc_numeric_eq (xaccSplitGetClearedBalance (split),
+                                  clr_bal));
+    }
+    g_assert (gnc_numeric_eq (priv->balance, bal));
+    g_assert (gnc_numeric_eq (priv->cleared_balance, clr_bal));
+}
+
+/* Add one split a day to acct starting at date, each in its own
+ * transaction, with increasing amounts and alternating reconcile
+ * states. */
+static void
+add_daily_splits (Account *acct, time64 date, Split **splits,
+                  guint num_splits)
+{
+    auto book = gnc_account_get_book (acct);
+    for (guint ind = 0; ind < num_splits; ind++)
+    {
+        auto txn = xaccMallocTransaction (book);
+        auto split = xaccMallocSplit (book);
+        auto amount = gnc_numeric_create (100 * (ind + 1), 100);
+        xaccTransBeginEdit (txn);
+        xaccTransSetDatePostedSecs (txn, date + ind * 86400);
+        xaccSplitSetParent (split, txn);
+        g_object_set (split, "account", acct, "amount", &amount, NULL);
+        xaccSplitSetReconcile (split, ind % 2 ? CREC : NREC);
+        gnc_account_insert_split (acct, split);
+        qof_commit_edit (QOF_INSTANCE (txn));
+        splits[ind] = split;
+    }
+}
+
+/* The balance index only re-sums the block holding a changed split, so
+ * use enough splits to get several blocks and check that the running
+ * balances after an edit in an early block are still right. */
+static void
+test_xaccAccountRecomputeBalance_incremental (Fixture *fixture,
+                                              gconstpointer pData)
+{
+    const guint num_splits = 600;
+    auto book = gnc_account_get_book (fixture->acct);
+    auto acct = xaccMallocAccount (book);
+    auto priv = fixture->func->get_private (acct);
+    Split *splits[num_splits];
+
+    gnc_account_append_child (fixture->acct, acct);
+    add_daily_splits (acct, gnc_time (NULL) - num_splits * 86400,
+                      splits, num_splits);
+    xaccAccountRecomputeBalance (acct);
+    g_assert_cmpuint (priv->balance_blocks->len, >, 1);
+    check_running_balances (priv);
+
+    auto txn = xaccSplitGetParent (splits[10]);
+    xaccTransBeginEdit (txn);
+    xaccSplitSetAmount (splits[10], gnc_numeric_create (-5000, 100));
+    qof_commit_edit (QOF_INSTANCE (txn));
+    g_assert (priv->balance_dirty);
+    xaccAccountRecomputeBalance (acct);
+    check_running_balances (priv);
+
+    g_assert (gnc_account_remove_split (acct, splits[300]));
+    check_running_balances (priv);
+    g_assert (gnc_account_insert_split (acct, splits[300]));
+    xaccAccountRecomputeBalance (acct);
+    check_running_balances (priv);
+
+    txn = xaccSplitGetParent (splits[0]);
+    xaccTransBeginEdit (txn);
+    xaccSplitSetReconcile (splits[0], YREC);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    xaccAccountRecomputeBalance (acct);
+    check_running_balances (priv);
+}
+
 /* xaccAccountOrder
 int
 xaccAccountOrder (const Account *aa, const Account *ab)// C: 11 in 3 */
@@ -1765,6 +1883,38 @@ test_gnc_account_lookup_by_full_name (Fixture *fixture, gconstpointer pData)
     g_free (code);
 }
 
+/* The lookups above are indexed; renaming and moving accounts
+ * afterwards must be seen by the next lookup. */
+static void
+test_gnc_account_lookup_index (Fixture *fixture, gconstpointer pData)
+{
+    auto root = gnc_account_get_root (fixture->acct);
+    auto income = gnc_account_lookup_by_name (root, "income");
+    auto taxable = gnc_account_lookup_by_full_name (root, "income:taxable");
+    auto target = gnc_account_lookup_by_full_name (root, "income:taxable:int");
+
+    g_assert (target != NULL);
+    g_assert (gnc_account_lookup_by_name (income, "int") == target);
+
+    xaccAccountSetName (target, "interest");
+    g_assert (gnc_account_lookup_by_name (taxable, "int") == NULL);
+    g_assert (gnc_account_lookup_by_name (income, "int") ==
+              gnc_account_lookup_by_full_name (root, "income:exempt:int"));
+    g_assert (gnc_account_lookup_by_name (root, "interest") == target);
+    g_assert (gnc_account_lookup_by_full_name (root,
+              "income:taxable:interest") == target);
+
+    xaccAccountSetCode (target, "4999");
+    g_assert (gnc_account_lookup_by_code (root, "4160") == NULL);
+    g_assert (gnc_account_lookup_by_code (income, "4999") == target);
+
+    gnc_account_append_child (root, target);
+    g_assert (gnc_account_lookup_by_name (income, "interest") == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root,
+              "income:taxable:interest") == NULL);
+    g_assert (gnc_account_lookup_by_full_name (root, "interest") == target);
+}
+
 static void
 thunk (Account *s, gpointer data)
 {
@@ -1953,6 +2103,121 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
 }
+static void
+test_xaccAccountGetBalanceAsOfDate_index (Fixture *fixture,
+                                          gconstpointer pData)
+{
+    const guint num_splits = 40;
+    auto book = gnc_account_get_book (fixture->acct);
+    auto acct = xaccMallocAccount (book);
+    time64 start = gnc_time (NULL) - num_splits * 86400;
+    Split *splits[num_splits];
+    gnc_account_append_child (fixture->acct, acct);
+    add_daily_splits (acct, start, splits, num_splits);
+    g_assert (gnc_account_remove_split (acct, splits[20]));
+
+    auto bal = gnc_numeric_zero ();
+    for (guint ind = 0; ind < num_splits; ind++)
+    {
+        auto val = xaccAccountGetBalanceAsOfDate (acct, start + ind * 86400);
+        g_assert (gnc_numeric_eq (val, bal));
+        if (ind != 20)
+            bal = gnc_numeric_add_fixed (bal, xaccSplitGetAmount (splits[ind]));
+    }
+    g_assert (gnc_numeric_eq (xaccAccountGetBalanceAsOfDate (acct,
+                              gnc_time (NULL)), bal));
+
+    /* Putting the split back must keep the index in step. */
+    g_assert (gnc_account_insert_split (acct, splits[20]));
+    bal = gnc_numeric_zero ();
+    for (guint ind = 0; ind <= 20; ind++)
+        bal = gnc_numeric_add_fixed (bal, xaccSplitGetAmount (splits[ind]));
+    g_assert (gnc_numeric_eq (xaccAccountGetBalanceAsOfDate (acct,
+                              start + 21 * 86400), bal));
+}
+/* xaccAccountTreeGetBalanceMatrix
+gnc_numeric *
+xaccAccountTreeGetBalanceMatrix (Account *root, const time64 *dates,
+                                 guint n_dates,
+                                 gnc_commodity *report_commodity,
+                                 gboolean include_children)// C: 1 SCM: 1 */
+static void
+test_xaccAccountTreeGetBalanceMatrix (Fixture *fixture, gconstpointer pData)
+{
+    auto root = gnc_account_get_root (fixture->acct);
+    auto now = gnc_time (NULL);
+    /* Not all increasing, to exercise the restarted search. */
+    time64 dates[] = { now - 10 * 86400, now - 3 * 86400, now,
+                       now - 5 * 86400, now + 86400
+                     };
+    const guint n_dates = G_N_ELEMENTS (dates);
+    gnc_commodity *commodities[] = { NULL, xaccAccountGetCommodity (root) };
+    gboolean recursions[] = { FALSE, TRUE };
+
+    for (auto commodity : commodities)
+        for (auto include_children : recursions)
+        {
+            auto matrix = xaccAccountTreeGetBalanceMatrix (root, dates,
+                          n_dates, commodity, include_children);
+            auto accounts = g_list_prepend (gnc_account_get_descendants (root),
+                                            root);
+            guint row = 0;
+
+            for (auto node = accounts; node; node = node->next, ++row)
+                for (guint ind = 0; ind < n_dates; ind++)
+                {
+                    auto bal = xaccAccountGetBalanceAsOfDateInCurrency (
+                                   static_cast<Account*>(node->data),
+                                   dates[ind], commodity, include_children);
+                    g_assert (gnc_numeric_equal (matrix[row * n_dates + ind],
+                                                 bal));
+                }
+            g_list_free (accounts);
+            g_free (matrix);
+        }
+}
+/* The subtree totals are cached, so check that they follow the
+ * balances and the tree. */
+static void
+test_xaccAccountGetBalanceInCurrency_cached (Fixture *fixture,
+                                             gconstpointer pData)
+{
+    auto book = gnc_account_get_book (fixture->acct);
+    auto commodity = gnc_commodity_new (book, "US Dollar", "CURRENCY", "USD",
+                                        "0", 100);
+    auto parent = xaccMallocAccount (book);
+    auto child = xaccMallocAccount (book);
+    time64 start = gnc_time (NULL) - 10 * 86400;
+    Split *splits[3];
+
+    xaccAccountSetCommodity (parent, commodity);
+    xaccAccountSetCommodity (child, commodity);
+    gnc_account_append_child (fixture->acct, parent);
+    gnc_account_append_child (parent, child);
+    add_daily_splits (parent, start, splits, 2);
+    add_daily_splits (child, start, splits, 3);
+    xaccAccountRecomputeBalance (parent);
+    xaccAccountRecomputeBalance (child);
+
+    /* 1 + 2 in the parent, 1 + 2 + 3 in the child */
+    auto total = gnc_numeric_create (9, 1);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalanceInCurrency (parent, NULL,
+                                 TRUE), total));
+    g_assert (gnc_numeric_equal (xaccAccountGetBalanceInCurrency (parent, NULL,
+                                 TRUE), total));
+
+    add_daily_splits (child, start, splits, 1);
+    xaccAccountRecomputeBalance (child);
+    total = gnc_numeric_create (10, 1);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalanceInCurrency (parent, NULL,
+                                 TRUE), total));
+
+    gnc_account_remove_child (parent, child);
+    total = gnc_numeric_create (3, 1);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalanceInCurrency (parent, NULL,
+                                 TRUE), total));
+    gnc_account_append_child (parent, child);
+}
 /* xaccAccountGetPresentBalance
 gnc_numeric
 xaccAccountGetPresentBalance (const Account *acc)// C: 4 in 2 */
@@ -2009,6 +2274,157 @@ test_xaccAccountGetPresentBalance (Fixture *fixture, gconstpointer pData)
  * xaccAccountGetSplitList
  * xaccAccountGetLotList
  */
+/* gnc_account_split_iter_next
+Split *
+gnc_account_split_iter_next (AccountSplitIter *iter) */
+static void
+test_gnc_account_split_iter (Fixture *fixture, gconstpointer pData)
+{
+    const guint num_splits = 20;
+    auto book = gnc_account_get_book (fixture->acct);
+    auto acct = xaccMallocAccount (book);
+    Split *splits[num_splits];
+    AccountSplitIter iter;
+    Split *split;
+    guint count = 0;
+
+    gnc_account_append_child (fixture->acct, acct);
+    add_daily_splits (acct, gnc_time (NULL) - num_splits * 86400,
+                      splits, num_splits);
+    g_assert_cmpint (gnc_account_n_splits (acct), ==, num_splits);
+    g_assert (gnc_account_nth_split (acct, 0) == splits[0]);
+    g_assert (gnc_account_nth_split (acct, num_splits - 1) ==
+              splits[num_splits - 1]);
+    g_assert (gnc_account_nth_split (acct, num_splits) == NULL);
+    g_assert (gnc_account_nth_split (acct, -1) == NULL);
+
+    /* The list view matches the vector and follows later changes. */
+    auto list = xaccAccountGetSplitList (acct);
+    g_assert_cmpuint (g_list_length (list), ==, num_splits);
+    g_assert (g_list_nth_data (list, 5) == splits[5]);
+    g_assert (gnc_account_remove_split (acct, splits[5]));
+    list = xaccAccountGetSplitList (acct);
+    g_assert_cmpuint (g_list_length (list), ==, num_splits - 1);
+    g_assert (g_list_nth_data (list, 5) == splits[6]);
+    g_assert (gnc_account_insert_split (acct, splits[5]));
+    g_assert (xaccAccountGetSplitList (acct) == list);
+    g_assert (g_list_nth_data (list, 5) == splits[5]);
+
+    /* Removing the split just returned doesn't derail the iterator. */
+    gnc_account_split_iter_init (&iter, acct);
+    while ((split = gnc_account_split_iter_next (&iter)))
+    {
+        g_assert (split == splits[count]);
+        if (count % 3 == 0)
+            g_assert (gnc_account_remove_split (acct, split));
+        ++count;
+    }
+    g_assert_cmpuint (count, ==, num_splits);
+    g_assert_cmpint (gnc_account_n_splits (acct), ==, num_splits - 7);
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (acct)), ==,
+                      num_splits - 7);
+}
+
+static guint splits_loader_calls = 0;
+
+static void
+load_pending_splits (QofBackend *be, Account *acct)
+{
+    Split *splits[3];
+    ++splits_loader_calls;
+    g_assert (!gnc_account_get_splits_pending (acct));
+    add_daily_splits (acct, gnc_time (NULL), splits, 3);
+    /* Asking again while loading mustn't load again. */
+    g_assert_cmpint (gnc_account_n_splits (acct), ==, 3);
+}
+
+static void
+test_gnc_account_load_splits (Fixture *fixture, gconstpointer pData)
+{
+    auto book = gnc_account_get_book (fixture->acct);
+    auto acct = xaccMallocAccount (book);
+    auto be = g_new0 (QofBackend, 1);
+
+    gnc_account_append_child (fixture->acct, acct);
+    qof_book_set_backend (book, be);
+    gnc_account_set_splits_loader (load_pending_splits);
+    splits_loader_calls = 0;
+
+    /* Nothing happens unless the backend marked the account. */
+    g_assert_cmpint (gnc_account_n_splits (acct), ==, 0);
+    g_assert_cmpuint (splits_loader_calls, ==, 0);
+
+    gnc_account_set_splits_pending (acct, TRUE);
+    g_assert (gnc_account_get_splits_pending (acct));
+    g_assert_cmpuint (g_list_length (xaccAccountGetSplitList (acct)), ==, 3);
+    g_assert_cmpuint (splits_loader_calls, ==, 1);
+    g_assert (!gnc_account_get_splits_pending (acct));
+    g_assert_cmpint (gnc_account_n_splits (acct), ==, 3);
+    g_assert_cmpuint (splits_loader_calls, ==, 1);
+
+    gnc_account_set_splits_loader (NULL);
+    qof_book_set_backend (book, NULL);
+    g_free (be);
+}
+
+static gboolean balance_loader_answers = TRUE;
+
+static gboolean
+load_pending_balance (QofBackend *be, Account *acct, time64 date,
+                      gnc_numeric *balance)
+{
+    if (!balance_loader_answers)
+        return FALSE;
+    *balance = gnc_numeric_create (date % 1000, 100);
+    return TRUE;
+}
+
+static void
+test_gnc_account_balance_loader (Fixture *fixture, gconstpointer pData)
+{
+    auto book = gnc_account_get_book (fixture->acct);
+    auto acct = xaccMallocAccount (book);
+    auto be = g_new0 (QofBackend, 1);
+    auto commodity = gnc_commodity_new (book, "US Dollar", "CURRENCY", "USD",
+                                        "0", 100);
+    time64 dates[] = { 1000123, 1000456 };
+
+    xaccAccountSetCommodity (acct, commodity);
+    gnc_account_append_child (fixture->acct, acct);
+    qof_book_set_backend (book, be);
+    gnc_account_set_splits_loader (load_pending_splits);
+    gnc_account_set_balance_loader (load_pending_balance);
+    splits_loader_calls = 0;
+    balance_loader_answers = TRUE;
+
+    /* A pending account's balances come from the backend. */
+    gnc_account_set_splits_pending (acct, TRUE);
+    g_assert (gnc_numeric_equal (xaccAccountGetBalanceAsOfDate (acct, dates[0]),
+                                 gnc_numeric_create (123, 100)));
+    auto matrix = xaccAccountTreeGetBalanceMatrix (acct, dates, 2, NULL, FALSE);
+    g_assert (gnc_numeric_equal (matrix[0], gnc_numeric_create (123, 100)));
+    g_assert (gnc_numeric_equal (matrix[1], gnc_numeric_create (456, 100)));
+    g_free (matrix);
+    g_assert_cmpuint (splits_loader_calls, ==, 0);
+    g_assert (gnc_account_get_splits_pending (acct));
+
+    /* If the backend can't tell, the splits get loaded. */
+    balance_loader_answers = FALSE;
+    g_assert (gnc_numeric_zero_p (xaccAccountGetBalanceAsOfDate (acct,
+                                                                 dates[0])));
+    g_assert_cmpuint (splits_loader_calls, ==, 1);
+    g_assert (!gnc_account_get_splits_pending (acct));
+
+    /* Once loaded, the backend isn't asked. */
+    balance_loader_answers = TRUE;
+    g_assert (gnc_numeric_zero_p (xaccAccountGetBalanceAsOfDate (acct,
+                                                                 dates[1])));
+
+    gnc_account_set_balance_loader (NULL);
+    gnc_account_set_splits_loader (NULL);
+    qof_book_set_backend (book, NULL);
+    g_free (be);
+}
 /* xaccAccountFindOpenLots
 LotList *
 xaccAccountFindOpenLots (const Account *acc,// C: 24 in 13 */
@@ -2083,6 +2499,101 @@ test_xaccAccountForEachLot (Fixture *fixture, gconstpointer pData)
     xaccAccountForEachLot (acct, bogus_for_each_lot_func, &count_calls);
     g_assert_cmpint (count_calls, == , 5);
 }
+/* gnc_account_find_open_lot
+GNCLot *
+gnc_account_find_open_lot (Account *acc, gboolean opened_positive,
+                           const gnc_commodity *currency, gboolean latest)
+ * The answers are compared with a search of every lot the way
+ * cap-gains.c used to do it, before and after the lots change.
+ */
+static GNCLot*
+search_open_lot (Account *acct, gboolean opened_positive, gboolean latest)
+{
+    GNCLot *found = NULL;
+    Timespec found_ts = {0, 0};
+    auto lots = xaccAccountGetLotList (acct);
+
+    for (auto node = lots; node; node = node->next)
+    {
+        auto lot = static_cast<GNCLot*>(node->data);
+        if (gnc_lot_is_closed (lot)) continue;
+        auto s = gnc_lot_get_earliest_split (lot);
+        if (s == NULL || gnc_numeric_zero_p (xaccSplitGetAmount (s)))
+            continue;
+        if (gnc_numeric_positive_p (xaccSplitGetAmount (s)) != opened_positive)
+            continue;
+        if (gnc_numeric_positive_p (gnc_lot_get_balance (lot)) != opened_positive)
+            continue;
+        auto ts = xaccTransRetDatePostedTS (xaccSplitGetParent (s));
+        if (found == NULL ||
+            (latest ? timespec_cmp (&ts, &found_ts) > 0 :
+             timespec_cmp (&ts, &found_ts) < 0))
+        {
+            found = lot;
+            found_ts = ts;
+        }
+    }
+    g_list_free (lots);
+    return found;
+}
+
+static void
+check_open_lots (Account *acct)
+{
+    for (auto positive : {FALSE, TRUE})
+        for (auto latest : {FALSE, TRUE})
+            g_assert (gnc_account_find_open_lot (acct, positive, NULL, latest) ==
+                      search_open_lot (acct, positive, latest));
+}
+
+static void
+test_gnc_account_find_open_lot (Fixture *fixture, gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    Account *acct = gnc_account_lookup_by_name (root, "baz");
+    Account *money = gnc_account_lookup_by_name (root, "money");
+    auto book = gnc_account_get_book (acct);
+
+    g_assert (acct);
+    check_open_lots (acct);
+    g_assert (gnc_account_find_open_lot (acct, TRUE, NULL, FALSE) != NULL);
+
+    /* Open another lot, earlier than the others.  Like setup(), skip the
+     * scrubbing in xaccTransCommitEdit. */
+    auto txn = xaccMallocTransaction (book);
+    auto split = xaccMallocSplit (book);
+    auto other = xaccMallocSplit (book);
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, gnc_time (NULL) - 20 * 86400);
+    xaccSplitSetParent (split, txn);
+    xaccSplitSetParent (other, txn);
+    xaccSplitSetAccount (split, acct);
+    xaccSplitSetAccount (other, money);
+    xaccSplitSetAmount (split, gnc_numeric_create (200, 1));
+    xaccSplitSetValue (split, gnc_numeric_create (20000, 100));
+    xaccSplitSetAmount (other, gnc_numeric_create (-20000, 100));
+    xaccSplitSetValue (other, gnc_numeric_create (-20000, 100));
+    gnc_account_insert_split (acct, split);
+    gnc_account_insert_split (money, other);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    auto lot = gnc_lot_new (book);
+    gnc_lot_add_split (lot, split);
+    check_open_lots (acct);
+    g_assert (gnc_account_find_open_lot (acct, TRUE, NULL, FALSE) == lot);
+
+    /* Moving its date makes it the latest one instead. */
+    xaccTransBeginEdit (txn);
+    xaccTransSetDatePostedSecs (txn, gnc_time (NULL) + 20 * 86400);
+    qof_commit_edit (QOF_INSTANCE (txn));
+    check_open_lots (acct);
+    g_assert (gnc_account_find_open_lot (acct, TRUE, NULL, TRUE) == lot);
+
+    /* And emptying it takes it out. */
+    gnc_lot_remove_split (lot, split);
+    check_open_lots (acct);
+    g_assert (gnc_account_find_open_lot (acct, TRUE, NULL, TRUE) != lot);
+    gnc_lot_destroy (lot);
+}
 /* These getters and setters look in KVP, so I guess their delegators instead:
  * xaccAccountGetTaxRelated
  * xaccAccountSetTaxRelated
@@ -2353,6 +2864,117 @@ test_xaccAccountFindTransByDesc (Fixture *fixture, gconstpointer pData)
     g_assert_cmpstr (desc, == , "pepper");
     g_free (desc);
 }
+/* The finders look descriptions up in an index, which has to follow
+ * changes to them. */
+static void
+test_xaccAccountFindTransByDesc_Changed (Fixture *fixture, gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    Account *baz = gnc_account_lookup_by_name (root, "baz");
+    Transaction *pepper = xaccAccountFindTransByDesc (baz, "pepper");
+    Transaction *salt = xaccAccountFindTransByDesc (baz, "salt");
+
+    g_assert (pepper && salt && pepper != salt);
+    g_assert (!xaccAccountFindTransByDesc (baz, "cumin"));
+    xaccTransSetDescription (pepper, "cumin");
+    g_assert (xaccAccountFindTransByDesc (baz, "cumin") == pepper);
+    g_assert (!xaccAccountFindTransByDesc (baz, "pepper"));
+
+    /* The most recent transaction with a description wins. */
+    xaccTransSetDescription (pepper, "salt");
+    g_assert (xaccAccountFindTransByDesc (baz, "salt") == salt);
+    xaccTransSetDescription (salt, "cumin");
+    g_assert (xaccAccountFindTransByDesc (baz, "salt") == pepper);
+    g_assert (xaccAccountFindTransByDesc (baz, "cumin") == salt);
+}
+/* The online id index has to follow changes to the splits' and the
+ * transactions' online ids and the splits leaving the account. */
+static void
+test_gnc_account_find_split_by_online_id (Fixture *fixture,
+        gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    Account *baz = gnc_account_lookup_by_name (root, "baz");
+    Transaction *pepper = xaccAccountFindTransByDesc (baz, "pepper");
+    Transaction *salt = xaccAccountFindTransByDesc (baz, "salt");
+    Split *psplit = xaccTransFindSplitByAccount (pepper, baz);
+    Split *ssplit = xaccTransFindSplitByAccount (salt, baz);
+
+    g_assert (psplit && ssplit);
+    g_assert (!gnc_account_find_split_by_online_id (baz, "id-1"));
+    xaccTransBeginEdit (pepper);
+    qof_instance_set (QOF_INSTANCE (psplit), "online-id", "id-1", NULL);
+    xaccTransCommitEdit (pepper);
+    g_assert (gnc_account_find_split_by_online_id (baz, "id-1") == psplit);
+
+    /* A split without an online id of its own has its transaction's. */
+    xaccTransBeginEdit (salt);
+    qof_instance_set (QOF_INSTANCE (salt), "online-id", "id-2", NULL);
+    xaccTransCommitEdit (salt);
+    g_assert (gnc_account_find_split_by_online_id (baz, "id-2") == ssplit);
+
+    xaccTransBeginEdit (pepper);
+    qof_instance_set (QOF_INSTANCE (psplit), "online-id", "id-3", NULL);
+    xaccTransCommitEdit (pepper);
+    g_assert (!gnc_account_find_split_by_online_id (baz, "id-1"));
+    g_assert (gnc_account_find_split_by_online_id (baz, "id-3") == psplit);
+
+    xaccTransBeginEdit (salt);
+    xaccTransDestroy (salt);
+    xaccTransCommitEdit (salt);
+    g_assert (!gnc_account_find_split_by_online_id (baz, "id-2"));
+    g_assert (gnc_account_find_split_by_online_id (baz, "id-3") == psplit);
+}
+/* The split counts and date ranges of subtrees are cached and have to
+ * follow new splits and changes to the tree. */
+static void
+test_xaccAccountGetPostDateRange (Fixture *fixture, gconstpointer pData)
+{
+    auto root = gnc_account_get_root (fixture->acct);
+    auto baz = gnc_account_lookup_by_name (root, "baz");
+    auto baz_parent = gnc_account_get_parent (baz);
+    auto descendants = gnc_account_get_descendants (root);
+    auto subtree = xaccMallocAccount (gnc_account_get_book (root));
+    gint64 count = 0, baz_count, parent_count;
+    time64 first = G_MAXINT64, last = G_MININT64, f, l;
+    Split *splits[2];
+
+    for (auto node = descendants; node; node = node->next)
+    {
+        auto acct = static_cast<Account*>(node->data);
+        for (gint i = 0; i < gnc_account_n_splits (acct); ++i)
+        {
+            auto split = gnc_account_nth_split (acct, i);
+            auto date = xaccTransGetDate (xaccSplitGetParent (split));
+            first = MIN (first, date);
+            last = MAX (last, date);
+            ++count;
+        }
+    }
+    g_list_free (descendants);
+    g_assert_cmpint (count, >, 0);
+    g_assert_cmpint (xaccAccountCountSplits (root, TRUE), ==, count);
+    g_assert (xaccAccountGetPostDateRange (root, TRUE, &f, &l));
+    g_assert_cmpint (f, ==, first);
+    g_assert_cmpint (l, ==, last);
+
+    add_daily_splits (baz, first - 2 * 86400, splits, 2);
+    g_assert_cmpint (xaccAccountCountSplits (root, TRUE), ==, count + 2);
+    g_assert (xaccAccountGetPostDateRange (root, TRUE, &f, NULL));
+    g_assert_cmpint (f, ==, first - 2 * 86400);
+    g_assert (xaccAccountGetPostDateRange (baz, FALSE, &f, NULL));
+    g_assert_cmpint (f, ==, first - 2 * 86400);
+
+    gnc_account_append_child (root, subtree);
+    g_assert (!xaccAccountGetPostDateRange (subtree, TRUE, NULL, NULL));
+    baz_count = xaccAccountCountSplits (baz, TRUE);
+    parent_count = xaccAccountCountSplits (baz_parent, TRUE);
+    gnc_account_append_child (subtree, baz);
+    g_assert_cmpint (xaccAccountCountSplits (subtree, TRUE), ==, baz_count);
+    g_assert_cmpint (xaccAccountCountSplits (baz_parent, TRUE), ==,
+                     parent_count - baz_count);
+    g_assert_cmpint (xaccAccountCountSplits (root, TRUE), ==, count + 2);
+}
 /* gnc_account_join_children
 void
 gnc_account_join_children (Account *to_parent, Account *from_parent)// C: 4 in 2 SCM: 3 in 3*/
@@ -2551,8 +3173,10 @@ test_suite_account (void)
 // GNC_TEST_ADD (suitename, "xaccAcctChildrenEqual", Fixture, NULL, setup, test_xaccAcctChildrenEqual,  teardown );
 // GNC_TEST_ADD (suitename, "xaccAccountEqual", Fixture, NULL, setup, test_xaccAccountEqual,  teardown );
     GNC_TEST_ADD (suitename, "gnc account insert & remove split", Fixture, NULL, setup, test_gnc_account_insert_remove_split,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountSortSplits", Fixture, &complex_data, setup, test_xaccAccountSortSplits,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccount Insert and Remove Lot", Fixture, &good_data, setup, test_xaccAccountInsertRemoveLot,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountRecomputeBalance", Fixture, &some_data, setup, test_xaccAccountRecomputeBalance,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountRecomputeBalance incremental", Fixture, NULL, setup, test_xaccAccountRecomputeBalance_incremental,  teardown );
     GNC_TEST_ADD_FUNC (suitename, "xaccAccountOrder", test_xaccAccountOrder );
     GNC_TEST_ADD (suitename, "qofAccountSetParent", Fixture, &some_data, setup, test_qofAccountSetParent,  teardown );
     GNC_TEST_ADD (suitename, "gnc account append/remove child", Fixture, NULL, setup, test_gnc_account_append_remove_child,  teardown );
@@ -2565,21 +3189,32 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "gnc account lookup by code", Fixture, &complex, setup, test_gnc_account_lookup_by_code,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name helper", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name_helper,  teardown );
     GNC_TEST_ADD (suitename, "gnc account lookup by full name", Fixture, &complex, setup, test_gnc_account_lookup_by_full_name,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account lookup index", Fixture, &complex, setup, test_gnc_account_lookup_index,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach child", Fixture, &complex, setup, test_gnc_account_foreach_child,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach descendant", Fixture, &complex, setup, test_gnc_account_foreach_descendant,  teardown );
     GNC_TEST_ADD (suitename, "gnc account foreach descendant until", Fixture, &complex, setup, test_gnc_account_foreach_descendant_until,  teardown );
     GNC_TEST_ADD (suitename, "gnc account get full name", Fixture, &good_data, setup, test_gnc_account_get_full_name,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetProjectedMinimumBalance", Fixture, &some_data, setup, test_xaccAccountGetProjectedMinimumBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetBalanceAsOfDate", Fixture, &some_data, setup, test_xaccAccountGetBalanceAsOfDate,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalanceAsOfDate index", Fixture, NULL, setup, test_xaccAccountGetBalanceAsOfDate_index, teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountTreeGetBalanceMatrix", Fixture, &complex_data, setup, test_xaccAccountTreeGetBalanceMatrix,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalanceInCurrency cached", Fixture, NULL, setup, test_xaccAccountGetBalanceInCurrency_cached,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetPresentBalance", Fixture, &some_data, setup, test_xaccAccountGetPresentBalance,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account split iter", Fixture, NULL, setup, test_gnc_account_split_iter, teardown );
+    GNC_TEST_ADD (suitename, "gnc account load splits", Fixture, NULL, setup, test_gnc_account_load_splits, teardown );
+    GNC_TEST_ADD (suitename, "gnc account balance loader", Fixture, NULL, setup, test_gnc_account_balance_loader, teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindOpenLots", Fixture, &complex_data, setup, test_xaccAccountFindOpenLots,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachLot", Fixture, &complex_data, setup, test_xaccAccountForEachLot,  teardown );
+    GNC_TEST_ADD (suitename, "gnc_account_find_open_lot", Fixture, &complex_data, setup, test_gnc_account_find_open_lot,  teardown );
 
     GNC_TEST_ADD (suitename, "xaccAccountHasAncestor", Fixture, &complex, setup, test_xaccAccountHasAncestor,  teardown );
     GNC_TEST_ADD_FUNC (suitename, "AccountType Stuff", test_xaccAccountType_Stuff );
     GNC_TEST_ADD_FUNC (suitename, "AccountType Compatibility", test_xaccAccountType_Compatibility);
     GNC_TEST_ADD (suitename, "xaccAccountFindSplitByDesc", Fixture, &complex_data, setup, test_xaccAccountFindSplitByDesc,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindTransByDesc", Fixture, &complex_data, setup, test_xaccAccountFindTransByDesc,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountFindTransByDesc changed", Fixture, &complex_data, setup, test_xaccAccountFindTransByDesc_Changed,  teardown );
+    GNC_TEST_ADD (suitename, "gnc account find split by online id", Fixture, &complex_data, setup, test_gnc_account_find_split_by_online_id,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetPostDateRange", Fixture, &complex_data, setup, test_xaccAccountGetPostDateRange,  teardown );
     GNC_TEST_ADD (suitename, "gnc account join children", Fixture, &complex, setup, test_gnc_account_join_children,  teardown );
     GNC_TEST_ADD (suitename, "gnc account merge children", Fixture, &complex_data, setup, test_gnc_account_merge_children,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachTransaction", Fixture, &complex_data, setup, test_xaccAccountForEachTransaction,  teardown );
@@ -24,6 +24,7 @@
 #include <glib.h>
 #include <unittest-support.h>
 #include <gnc-event.h>
+#include <qofinstance-p.h>
 /* Add specific headers for this class */
 #include "gnc-budget.h"
 
@@ -2577,6 +2578,43 @@ test_gnc_set_budget_account_period_value()
     qof_book_destroy(book);
 }
 
+static void
+test_gnc_budget_account_period_value_kvp()
+{
+    QofBook *book = qof_book_new();
+    GncBudget* budget = gnc_budget_new(book);
+    Account *acc = gnc_account_create_root(book);
+    gchar path[GUID_ENCODING_LENGTH + 4];
+    gnc_numeric num = gnc_numeric_create (250, 1);
+    GValue v = G_VALUE_INIT;
+
+    /* Values loaded straight into the KVP, as the backends do, are seen
+     * when the account's values are first read. */
+    guid_to_string_buff(xaccAccountGetGUID(acc), path);
+    strcat(path, "/3");
+    g_value_init (&v, GNC_TYPE_NUMERIC);
+    g_value_set_boxed (&v, &num);
+    qof_instance_set_kvp (QOF_INSTANCE (budget), path, &v);
+    g_value_unset (&v);
+
+    g_assert(gnc_budget_is_account_period_value_set(budget, acc, 3));
+    g_assert(!gnc_budget_is_account_period_value_set(budget, acc, 4));
+    g_assert(gnc_numeric_equal(gnc_budget_get_account_period_value(budget, acc, 3),
+                               num));
+
+    gnc_budget_unset_account_period_value(budget, acc, 3);
+    g_assert(!gnc_budget_is_account_period_value_set(budget, acc, 3));
+
+    gnc_budget_set_num_periods(budget, 24);
+    gnc_budget_set_account_period_value(budget, acc, 20, num);
+    g_assert(gnc_numeric_equal(gnc_budget_get_account_period_value(budget, acc, 20),
+                               num));
+    g_assert(!gnc_budget_is_account_period_value_set(budget, acc, 3));
+
+    gnc_budget_destroy(budget);
+    qof_book_destroy(book);
+}
+
 void
 test_suite_budget(void)
 {
@@ -2586,6 +2624,7 @@ test_suite_budget(void)
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_num_periods()", test_gnc_set_budget_num_periods);
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_recurrence()", test_gnc_set_budget_recurrence);
     GNC_TEST_ADD_FUNC(suitename, "gnc_budget_set_account_period_value()", test_gnc_set_budget_account_period_value);
+    GNC_TEST_ADD_FUNC(suitename, "gnc_budget account period values in KVP", test_gnc_budget_account_period_value_kvp);
 
 #if 0
     GNC_TEST_ADD_FUNC (suitename, "gnc set account separator", test_gnc_set_account_separator);
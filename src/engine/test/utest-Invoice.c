@@ -25,6 +25,9 @@
 #include <qof.h>
 #include <unittest-support.h>
 #include "../gncInvoice.h"
+#include "../gncEntry.h"
+#include "../gncOwner.h"
+#include "../gncAging.h"
 
 static const gchar *suitename = "/engine/gncInvoice";
 void test_suite_gncInvoice ( void );
@@ -88,8 +91,257 @@ test_invoice_post ( Fixture *fixture, gconstpointer pData )
     g_assert(!gncInvoiceIsPosted(invoice));
 }
 
+static GncEntry *
+make_entry (QofBook *book, gint64 quantity, gint64 price)
+{
+    GncEntry *entry = gncEntryCreate(book);
+    gncEntrySetQuantity(entry, gnc_numeric_create(quantity, 1));
+    gncEntrySetInvPrice(entry, gnc_numeric_create(price, 1));
+    return entry;
+}
+
+static void
+test_invoice_totals ( Fixture *fixture, gconstpointer pData )
+{
+    GncInvoice *invoice = gncInvoiceCreate(fixture->book);
+    GncEntry *entry1, *entry2;
+
+    gncInvoiceSetCurrency(invoice, fixture->commodity);
+    gncInvoiceSetOwner(invoice, &fixture->owner);
+    g_assert(gnc_numeric_zero_p(gncInvoiceGetTotal(invoice)));
+
+    entry1 = make_entry(fixture->book, 2, 10);
+    entry2 = make_entry(fixture->book, 3, 5);
+    gncInvoiceAddEntry(invoice, entry1);
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(20, 1)));
+    gncInvoiceAddEntry(invoice, entry2);
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(35, 1)));
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotalSubtotal(invoice),
+                               gnc_numeric_create(35, 1)));
+    g_assert(gnc_numeric_zero_p(gncInvoiceGetTotalTax(invoice)));
+
+    /* Changing one entry only moves the totals by its difference */
+    gncEntrySetInvPrice(entry1, gnc_numeric_create(7, 1));
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(29, 1)));
+    gncEntrySetQuantity(entry2, gnc_numeric_create(1, 1));
+    gncEntrySetQuantity(entry2, gnc_numeric_create(4, 1));
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(34, 1)));
+
+    gncEntrySetBillPayment(entry2, GNC_PAYMENT_CARD);
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotalOf(invoice, GNC_PAYMENT_CARD),
+                               gnc_numeric_create(20, 1)));
+
+    gncInvoiceSetIsCreditNote(invoice, TRUE);
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(-34, 1)));
+    gncInvoiceSetIsCreditNote(invoice, FALSE);
+
+    gncInvoiceRemoveEntry(invoice, entry1);
+    g_assert(gnc_numeric_equal(gncInvoiceGetTotal(invoice),
+                               gnc_numeric_create(20, 1)));
+    gncInvoiceRemoveEntry(invoice, entry2);
+    g_assert(gnc_numeric_zero_p(gncInvoiceGetTotal(invoice)));
+
+    gncEntryBeginEdit(entry1);
+    gncEntryDestroy(entry1);
+    gncEntryBeginEdit(entry2);
+    gncEntryDestroy(entry2);
+    gncInvoiceBeginEdit(invoice);
+    gncInvoiceDestroy(invoice);
+}
+
+static Split *
+find_account_split (Transaction *txn, Account *acc)
+{
+    GList *node;
+    for (node = xaccTransGetSplitList(txn); node; node = node->next)
+        if (xaccSplitGetAccount(node->data) == acc)
+            return node->data;
+    return NULL;
+}
+
+static void
+test_invoice_post_accumulate ( Fixture *fixture, gconstpointer pData )
+{
+    GncInvoice *invoice = gncInvoiceCreate(fixture->book);
+    Timespec ts1 = timespec_now(), ts2 = ts1;
+    Account *income1 = xaccMallocAccount(fixture->book);
+    Account *income2 = xaccMallocAccount(fixture->book);
+    GncEntry *entry1, *entry2, *entry3;
+    Transaction *txn;
+
+    xaccAccountSetCommodity(income1, fixture->commodity);
+    xaccAccountSetCommodity(income2, fixture->commodity);
+    gncInvoiceSetCurrency(invoice, fixture->commodity);
+    gncInvoiceSetOwner(invoice, &fixture->owner);
+
+    entry1 = make_entry(fixture->book, 2, 10);
+    entry2 = make_entry(fixture->book, 1, 4);
+    entry3 = make_entry(fixture->book, 3, 5);
+    gncEntrySetInvAccount(entry1, income1);
+    gncEntrySetInvAccount(entry2, income2);
+    gncEntrySetInvAccount(entry3, income1);
+    gncInvoiceAddEntry(invoice, entry1);
+    gncInvoiceAddEntry(invoice, entry2);
+    gncInvoiceAddEntry(invoice, entry3);
+
+    /* One split for each income account and one for the posted account */
+    txn = gncInvoicePostToAccount(invoice, fixture->account, &ts1, &ts2,
+                                  "memo", TRUE, FALSE);
+    g_assert(txn);
+    g_assert_cmpint(xaccTransCountSplits(txn), ==, 3);
+    g_assert(gnc_numeric_equal(xaccSplitGetValue(find_account_split(txn, income1)),
+                               gnc_numeric_create(-35, 1)));
+    g_assert(gnc_numeric_equal(xaccSplitGetValue(find_account_split(txn, income2)),
+                               gnc_numeric_create(-4, 1)));
+    g_assert(gnc_numeric_equal(xaccSplitGetValue(find_account_split(txn, fixture->account)),
+                               gnc_numeric_create(39, 1)));
+
+    gncInvoiceUnpost(invoice, TRUE);
+    g_assert(!gncInvoiceIsPosted(invoice));
+}
+
+static void
+test_invoice_post_list ( Fixture *fixture, gconstpointer pData )
+{
+    GncInvoice *invoice1 = gncInvoiceCreate(fixture->book);
+    GncInvoice *invoice2 = gncInvoiceCreate(fixture->book);
+    Timespec ts1 = timespec_now(), ts2 = ts1, due;
+    GList *invoices = NULL, *failed;
+
+    gncInvoiceSetCurrency(invoice1, fixture->commodity);
+    gncInvoiceSetOwner(invoice1, &fixture->owner);
+    gncInvoiceSetCurrency(invoice2, fixture->commodity);
+    gncInvoiceSetOwner(invoice2, &fixture->owner);
+    gncInvoicePostToAccount(invoice2, fixture->account, &ts1, &ts2, "memo",
+                            TRUE, FALSE);
+
+    /* invoice2 is already posted, so only it fails */
+    invoices = g_list_append(invoices, invoice1);
+    invoices = g_list_append(invoices, invoice2);
+    failed = gncInvoicePostListToAccount(invoices, fixture->account, &ts1,
+                                         NULL, "memo", TRUE, TRUE);
+    g_assert_cmpint(g_list_length(failed), ==, 1);
+    g_assert(failed->data == invoice2);
+    g_assert(gncInvoiceIsPosted(invoice1));
+    /* Without billing terms the invoice is due when posted */
+    due = gncInvoiceGetDateDue(invoice1);
+    g_assert(timespec_equal(&due, &ts1));
+    g_list_free(failed);
+    g_list_free(invoices);
+
+    gncInvoiceUnpost(invoice1, TRUE);
+    gncInvoiceUnpost(invoice2, TRUE);
+}
+
+static void
+test_invoice_owner_lots ( Fixture *fixture, gconstpointer pData )
+{
+    GncInvoice *invoice = gncInvoiceCreate(fixture->book);
+    GncCustomer *other = gncCustomerCreate(fixture->book);
+    Account *income = xaccMallocAccount(fixture->book);
+    GncOwner other_owner;
+    GncEntry *entry;
+    Timespec ts1 = timespec_now(), ts2 = ts1;
+    GList *lots, *scanned;
+
+    xaccAccountSetType(fixture->account, ACCT_TYPE_RECEIVABLE);
+    xaccAccountSetType(income, ACCT_TYPE_INCOME);
+    xaccAccountSetCommodity(income, fixture->commodity);
+    gncOwnerInitCustomer(&other_owner, other);
+
+    gncInvoiceSetCurrency(invoice, fixture->commodity);
+    gncInvoiceSetOwner(invoice, &fixture->owner);
+    entry = make_entry(fixture->book, 2, 10);
+    gncEntrySetInvAccount(entry, income);
+    gncInvoiceAddEntry(invoice, entry);
+
+    g_assert(gncOwnerFindOpenLots(&fixture->owner, fixture->account, NULL) == NULL);
+    gncInvoicePostToAccount(invoice, fixture->account, &ts1, &ts2, "memo", TRUE, FALSE);
+
+    lots = gncOwnerFindOpenLots(&fixture->owner, fixture->account, NULL);
+    scanned = xaccAccountFindOpenLots(fixture->account, gncOwnerLotMatchOwnerFunc,
+                                      &fixture->owner, NULL);
+    g_assert_cmpint(g_list_length(lots), ==, 1);
+    g_assert(lots->data == gncInvoiceGetPostedLot(invoice));
+    g_assert_cmpint(g_list_length(scanned), ==, 1);
+    g_assert(scanned->data == lots->data);
+    g_list_free(lots);
+    g_list_free(scanned);
+
+    g_assert(gncOwnerFindOpenLots(&other_owner, fixture->account, NULL) == NULL);
+    g_assert(gncOwnerFindOpenLots(&fixture->owner, income, NULL) == NULL);
+
+    gncInvoiceUnpost(invoice, TRUE);
+    gncCustomerBeginEdit(other);
+    gncCustomerDestroy(other);
+    xaccAccountBeginEdit(income);
+    xaccAccountDestroy(income);
+}
+
+static void
+test_invoice_aging ( Fixture *fixture, gconstpointer pData )
+{
+    GncInvoice *invoice = gncInvoiceCreate(fixture->book);
+    Account *income = xaccMallocAccount(fixture->book);
+    GncAging *aging;
+    GncAgingOwner *ao;
+    GncEntry *entry;
+    Timespec now = timespec_now(), ts1 = now, ts2 = now, end;
+    GList *owners;
+
+    xaccAccountSetType(fixture->account, ACCT_TYPE_RECEIVABLE);
+    xaccAccountSetType(income, ACCT_TYPE_INCOME);
+    xaccAccountSetCommodity(income, fixture->commodity);
+
+    gncInvoiceSetCurrency(invoice, fixture->commodity);
+    gncInvoiceSetOwner(invoice, &fixture->owner);
+    entry = make_entry(fixture->book, 2, 10);
+    gncEntrySetInvAccount(entry, income);
+    gncInvoiceAddEntry(invoice, entry);
+    gncInvoicePostToAccount(invoice, fixture->account, &ts1, &ts2, "memo", TRUE, FALSE);
+
+    aging = gncAgingNew();
+    end = now;
+    end.tv_sec -= 30 * 24 * 3600;
+    gncAgingAddBucket(aging, end);
+    end.tv_sec = now.tv_sec + 24 * 3600;
+    gncAgingAddBucket(aging, end);
+    g_assert_cmpint(gncAgingGetNumBuckets(aging), ==, 2);
+
+    end.tv_sec = now.tv_sec - 24 * 3600;
+    gncAgingRun(aging, fixture->account, end, TRUE, FALSE, FALSE);
+    g_assert(gncAgingGetOwners(aging) == NULL);
+
+    end.tv_sec = now.tv_sec + 24 * 3600;
+    gncAgingRun(aging, fixture->account, end, TRUE, FALSE, FALSE);
+    owners = gncAgingGetOwners(aging);
+    g_assert_cmpint(g_list_length(owners), ==, 1);
+    ao = owners->data;
+    g_assert(gncOwnerEqual(gncAgingOwnerGetOwner(ao), &fixture->owner));
+    g_assert(gncAgingOwnerGetCurrency(ao) == fixture->commodity);
+    g_assert(gnc_numeric_zero_p(gncAgingOwnerGetBucket(ao, 0)));
+    g_assert(gnc_numeric_equal(gncAgingOwnerGetBucket(ao, 1),
+                               gnc_numeric_create(20, 1)));
+    g_assert(gnc_numeric_zero_p(gncAgingOwnerGetOverpayment(ao)));
+    gncAgingDestroy(aging);
+
+    gncInvoiceUnpost(invoice, TRUE);
+    xaccAccountBeginEdit(income);
+    xaccAccountDestroy(income);
+}
+
 void
 test_suite_gncInvoice ( void )
 {
     GNC_TEST_ADD( suitename, "post", Fixture, NULL, setup, test_invoice_post, teardown );
+    GNC_TEST_ADD( suitename, "post accumulate", Fixture, NULL, setup, test_invoice_post_accumulate, teardown );
+    GNC_TEST_ADD( suitename, "post list", Fixture, NULL, setup, test_invoice_post_list, teardown );
+    GNC_TEST_ADD( suitename, "totals", Fixture, NULL, setup, test_invoice_totals, teardown );
+    GNC_TEST_ADD( suitename, "owner lots", Fixture, NULL, setup, test_invoice_owner_lots, teardown );
+    GNC_TEST_ADD( suitename, "aging", Fixture, NULL, setup, test_invoice_aging, teardown );
 }
@@ -25,6 +25,7 @@ extern "C"
 {
 #include "config.h"
 #include <string.h>
+#include <stdio.h>
 #include <glib.h>
 #include <unittest-support.h>
 /* Add specific headers for this class */
@@ -90,7 +91,7 @@ setup (Fixture *fixture, gconstpointer pData)
     fixture->split->parent = txn;
     fixture->split->amount = amount;
     fixture->split->value = value;
-    fixture->split->date_reconciled = time;
+    fixture->split->date_reconciled = time.tv_sec;
     fixture->split->reconciled = YREC;
     fixture->split->gains = GAINS_STATUS_VALU_DIRTY;
     fixture->split->gains_split = gains_split;
@@ -305,7 +306,7 @@ test_xaccDupeSplit (Fixture *fixture, gconstpointer pData)
     g_assert_cmpstr (split->action, ==, f_split->action);
     g_assert (compare (split->inst.kvp_data, f_split->inst.kvp_data) == 0);
     g_assert_cmpint (split->reconciled, ==, f_split->reconciled);
-    g_assert (timespec_equal (&(split->date_reconciled), &(f_split->date_reconciled)));
+    g_assert (split->date_reconciled == f_split->date_reconciled);
     g_assert (gnc_numeric_equal (split->value, f_split->value));
     g_assert (gnc_numeric_equal (split->amount, f_split->amount));
     /* xaccDupeSplit intentionally doesn't copy the balances */
@@ -340,7 +341,7 @@ test_xaccSplitCloneNoKvp (Fixture *fixture, gconstpointer pData)
     g_assert_cmpstr (split->action, ==, f_split->action);
     g_assert (split->inst.kvp_data->empty());
     g_assert_cmpint (split->reconciled, ==, f_split->reconciled);
-    g_assert (timespec_equal (&(split->date_reconciled), &(f_split->date_reconciled)));
+    g_assert (split->date_reconciled == f_split->date_reconciled);
     g_assert (gnc_numeric_equal (split->value, f_split->value));
     g_assert (gnc_numeric_equal (split->amount, f_split->amount));
     g_assert (gnc_numeric_equal (split->balance, f_split->balance));
@@ -1128,7 +1129,7 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
      * split-action based on book option.
      */
     o_split->parent = o_txn;
-    split->parent->date_posted = timespec_now ();
+    split->parent->date_posted = gnc_time (NULL);
     o_split->parent->date_posted = split->parent->date_posted;
 
     /* The book_use_split_action_for_num_field book option hasn't been set so it
@@ -1206,14 +1207,13 @@ test_xaccSplitOrder (Fixture *fixture, gconstpointer pData)
     o_split->value = split->value;
     /* Make sure that it doesn't crash if o_split->date_reconciled == NULL */
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, 1);
-    o_split->date_reconciled = timespec_now();
-    o_split->date_reconciled.tv_sec -= 50;
+    o_split->date_reconciled = gnc_time (NULL);
+    o_split->date_reconciled -= 50;
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, 1);
-    o_split->date_reconciled.tv_sec += 100;
+    o_split->date_reconciled += 100;
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==, -1);
 
-    o_split->date_reconciled.tv_sec = split->date_reconciled.tv_sec;
-    o_split->date_reconciled.tv_nsec = split->date_reconciled.tv_nsec;
+    o_split->date_reconciled = split->date_reconciled;
 
     g_assert_cmpint (xaccSplitOrder (split, o_split), ==,
                      qof_instance_guid_compare (split, o_split));
@@ -1252,13 +1252,13 @@ test_xaccSplitOrderDateOnly (Fixture *fixture, gconstpointer pData)
     g_assert_cmpint (xaccSplitOrderDateOnly (split, o_split), ==, 1);
     split->parent = txn;
 
-    txn->date_posted = timespec_now ();
-    o_txn->date_posted = timespec_now ();
-    o_txn->date_posted.tv_sec -= 50;
+    txn->date_posted = gnc_time (NULL);
+    o_txn->date_posted = gnc_time (NULL);
+    o_txn->date_posted -= 50;
     g_assert_cmpint (xaccSplitOrderDateOnly (split, o_split), ==, 1);
-    o_txn->date_posted.tv_sec += 100;
+    o_txn->date_posted += 100;
     g_assert_cmpint (xaccSplitOrderDateOnly (split, o_split), ==, -1);
-    o_txn->date_posted.tv_sec -= 50;
+    o_txn->date_posted -= 50;
     g_assert_cmpint (xaccSplitOrderDateOnly (split, o_split), ==, -1);
 
     test_destroy (o_split);
@@ -1471,6 +1471,11 @@ test_xaccSplitCompareAccountFullNames (Fixture *fixture, gconstpointer pData)
     g_assert_cmpint (xaccSplitCompareAccountFullNames (split, NULL), ==, 1);
     g_assert_cmpint (xaccSplitCompareAccountFullNames (NULL, split), ==, -1);
     g_assert_cmpint (xaccSplitCompareAccountFullNames (split, split1), <, 0);
+    /* The cached names must follow renames and moves */
+    xaccAccountSetName (fixture->split->acc, "zebra");
+    g_assert_cmpint (xaccSplitCompareAccountFullNames (split, split1), >, 0);
+    gnc_account_append_child (fixture->split->acc, acc2);
+    g_assert_cmpint (xaccSplitCompareAccountFullNames (split, split1), <, 0);
 
     xaccTransBeginEdit (txn);
     xaccSplitSetParent (split1, txn);
@@ -1871,6 +1876,40 @@ test_xaccSplitVoid (Fixture *fixture, gconstpointer pData)
     g_assert_cmpint (fixture->split->reconciled, ==, NREC);
 }
 
+#define SPLIT_ALLOC_TRANS 1000
+/* A book full of transactions must go away cleanly; bench-engine times
+ * the same allocation. */
+static void
+test_split_allocation (void)
+{
+    QofBook *book = qof_book_new ();
+    Account *acc = xaccMallocAccount (book);
+    Transaction *txn = NULL;
+    gint i;
+
+    xaccAccountBeginEdit (acc);
+    for (i = 0; i < SPLIT_ALLOC_TRANS; ++i)
+    {
+        Split *debit = xaccMallocSplit (book);
+        Split *credit = xaccMallocSplit (book);
+
+        txn = xaccMallocTransaction (book);
+        xaccTransBeginEdit (txn);
+        xaccSplitSetParent (debit, txn);
+        xaccSplitSetParent (credit, txn);
+        xaccSplitSetMemo (debit, "split allocation");
+        xaccSplitSetAccount (debit, acc);
+        xaccSplitSetAccount (credit, acc);
+        xaccTransCommitEdit (txn);
+    }
+    xaccAccountCommitEdit (acc);
+    g_assert_cmpint (xaccTransCountSplits (txn), ==, 2);
+    g_assert_cmpint (g_list_length (xaccAccountGetSplitList (acc)), ==,
+                     2 * SPLIT_ALLOC_TRANS);
+
+    qof_book_destroy (book);
+}
+
 /* The rest of these are simple setters and getters unworthy of testing:
  * qofSplitSetMemo // Not Used
  * xaccSplitSetMemo // C: 26 in 13 SCM: 2 in 2 Local: 1:0:0
@@ -1942,5 +1981,6 @@ test_suite_split (void)
     GNC_TEST_ADD (suitename, "xaccSplitMakeStockSplit", Fixture, NULL, setup, test_xaccSplitMakeStockSplit, teardown);
     GNC_TEST_ADD (suitename, "xaccSplitGetOtherSplit", Fixture, NULL, setup, test_xaccSplitGetOtherSplit, teardown);
     GNC_TEST_ADD (suitename, "xaccSplitVoid", Fixture, NULL, setup, test_xaccSplitVoid, teardown);
+    GNC_TEST_ADD_FUNC (suitename, "split allocation", test_split_allocation);
 
 }
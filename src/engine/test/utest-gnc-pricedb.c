@@ -961,6 +961,45 @@ test_gnc_pricedb_get_prices (PriceDBFixture *fixture, gconstpointer pData)
     g_assert_cmpint(g_list_length(prices), ==, 4);
     gnc_price_list_destroy(prices);
 }
+/* gnc_pricedb_nth_price
+GNCPrice *
+gnc_pricedb_nth_price (GNCPriceDB *db,
+*/
+static void
+test_gnc_pricedb_nth_price (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    gnc_commodity *usd = fixture->com->usd;
+    PriceList *prices = gnc_pricedb_get_prices(db, usd, NULL);
+    int num = gnc_pricedb_num_prices(db, usd);
+    GNCPrice *first;
+    int i;
+
+    g_assert_cmpint(num, ==, g_list_length(prices));
+    for (i = 0; i < num; i++)
+    {
+        GNCPrice *price = gnc_pricedb_nth_price(db, usd, i);
+        g_assert(g_list_find(prices, price) != NULL);
+        g_assert_cmpint(gnc_pricedb_nth_price_index(db, price), ==, i);
+        if (i > 0)
+        {
+            Timespec t = gnc_price_get_time(price);
+            Timespec prev = gnc_price_get_time(gnc_pricedb_nth_price(db, usd, i - 1));
+            g_assert_cmpint(timespec_cmp(&prev, &t), >=, 0);
+        }
+    }
+    g_assert(gnc_pricedb_nth_price(db, usd, num) == NULL);
+    gnc_price_list_destroy(prices);
+
+    /* The positions follow a removal. */
+    first = gnc_pricedb_nth_price(db, usd, 0);
+    gnc_price_ref(first);
+    gnc_pricedb_remove_price(db, first);
+    g_assert_cmpint(gnc_pricedb_num_prices(db, usd), ==, num - 1);
+    g_assert_cmpint(gnc_pricedb_nth_price_index(db, first), ==, -1);
+    g_assert_cmpint(gnc_pricedb_nth_price_index(db, gnc_pricedb_nth_price(db, usd, 0)), ==, 0);
+    gnc_price_unref(first);
+}
 /* gnc_pricedb_lookup_day
 GNCPrice *
 gnc_pricedb_lookup_day(GNCPriceDB *db,// C: 4 in 2 SCM: 2 in 1 Local: 1:0:0
@@ -1022,6 +1061,243 @@ test_gnc_pricedb_lookup_nearest_in_time (PriceDBFixture *fixture, gconstpointer
 GNCPrice *
 gnc_pricedb_lookup_latest_before (GNCPriceDB *db,// Local: 0:0:0
 */
+static void
+test_gnc_pricedb_lookup_latest_before (PriceDBFixture *fixture, gconstpointer pData)
+{
+    Timespec t = gnc_dmy2timespec(1, 1, 2013);
+    Timespec expected = gnc_dmy2timespec(17, 11, 2012);
+    Timespec price_time;
+    GNCPrice *price =
+        gnc_pricedb_lookup_latest_before(fixture->pricedb, fixture->com->usd,
+                                         fixture->com->aud, t);
+    /* The newest price before t is the reverse-direction AUD/USD one. */
+    g_assert_cmpstr(GET_COM_NAME(price), ==, "AUD");
+    price_time = gnc_price_get_time(price);
+    g_assert(timespec_equal(&price_time, &expected));
+    gnc_price_unref(price);
+
+    t = gnc_dmy2timespec(1, 1, 2009);
+    price = gnc_pricedb_lookup_latest_before(fixture->pricedb, fixture->com->usd,
+                                             fixture->com->aud, t);
+    g_assert(price == NULL);
+}
+
+/* Removing and re-adding prices must keep the time lookups consistent with
+ * the price lists. */
+static void
+test_gnc_pricedb_lookup_after_remove (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    Timespec t = gnc_dmy2timespec(1, 1, 2013);
+    Timespec t_new = gnc_dmy2timespec(30, 12, 2012);
+    Timespec t_prev = gnc_dmy2timespec(13, 10, 2012);
+    Timespec price_time;
+    PriceList *prices;
+    GNCPrice *price =
+        gnc_pricedb_lookup_latest_before(db, fixture->com->gbp,
+                                         fixture->com->usd, t);
+    GNCPrice *new_price;
+
+    g_assert(gnc_pricedb_remove_price(db, price));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_latest_before(db, fixture->com->gbp,
+                                             fixture->com->usd, t);
+    price_time = gnc_price_get_time(price);
+    g_assert(timespec_equal(&price_time, &t_prev));
+    gnc_price_unref(price);
+    prices = gnc_pricedb_get_prices(db, fixture->com->gbp, fixture->com->usd);
+    g_assert_cmpint(g_list_length(prices), ==, 6);
+    gnc_price_list_destroy(prices);
+
+    new_price = construct_price(book, fixture->com->gbp, fixture->com->usd,
+                                t_new, PRICE_SOURCE_FQ,
+                                gnc_numeric_create(158000, 100000));
+    g_assert(gnc_pricedb_add_price(db, new_price));
+    price = gnc_pricedb_lookup_latest_before(db, fixture->com->gbp,
+                                             fixture->com->usd, t);
+    g_assert(price == new_price);
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_at_time(db, fixture->com->usd,
+                                       fixture->com->gbp, t_new);
+    g_assert(price == new_price);
+    gnc_price_unref(price);
+}
+/* Prices added in bulk aren't visible until the bulk update ends, when they
+ * are sorted into place and duplicates dropped. */
+static void
+test_gnc_pricedb_bulk_update (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    Commodities *c = fixture->com;
+    Timespec t_new = gnc_dmy2timespec(2, 3, 2015);
+    Timespec t_mid = gnc_dmy2timespec(6, 6, 2012);
+    PriceList *prices, *node;
+    GNCPrice *price, *latest;
+    guint count;
+
+    prices = gnc_pricedb_get_prices(db, c->amzn, c->usd);
+    count = g_list_length(prices);
+    latest = prices->data;
+    gnc_price_list_destroy(prices);
+
+    gnc_pricedb_set_bulk_update(db, TRUE);
+    g_assert(gnc_pricedb_add_price(db, construct_price(book, c->amzn, c->usd,
+                                                       t_new, PRICE_SOURCE_FQ,
+                                       gnc_numeric_create(38032, 100))));
+    g_assert(gnc_pricedb_add_price(db, construct_price(book, c->amzn, c->usd,
+                                                       t_mid, PRICE_SOURCE_FQ,
+                                       gnc_numeric_create(21855, 100))));
+    /* Duplicates of a queued price and of one already in the list. */
+    g_assert(gnc_pricedb_add_price(db, construct_price(book, c->amzn, c->usd,
+                                                       t_new, PRICE_SOURCE_FQ,
+                                       gnc_numeric_create(38032, 100))));
+    g_assert(gnc_pricedb_add_price(db, construct_price(book, c->amzn, c->usd,
+                                              gnc_dmy2timespec(12, 11, 2014),
+                                              PRICE_SOURCE_FQ,
+                                              gnc_numeric_create(31151, 100))));
+    price = gnc_pricedb_lookup_latest(db, c->amzn, c->usd);
+    g_assert(price == latest);
+    gnc_price_unref(price);
+    gnc_pricedb_set_bulk_update(db, FALSE);
+
+    prices = gnc_pricedb_get_prices(db, c->amzn, c->usd);
+    g_assert_cmpint(g_list_length(prices), ==, count + 2);
+    for (node = prices; node->next; node = node->next)
+    {
+        Timespec t1 = gnc_price_get_time(node->data);
+        Timespec t2 = gnc_price_get_time(node->next->data);
+        g_assert(timespec_cmp(&t1, &t2) > 0);
+    }
+    gnc_price_list_destroy(prices);
+
+    price = gnc_pricedb_lookup_latest(db, c->amzn, c->usd);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(38032, 100)));
+    gnc_price_unref(price);
+    price = gnc_pricedb_lookup_at_time(db, c->usd, c->amzn, t_mid);
+    g_assert(price);
+    gnc_price_unref(price);
+}
+static guint prices_loader_calls = 0;
+
+/* The backend holds two amzn prices older than those in the fixture. */
+static void
+load_pending_prices (QofBackend *be, GNCPriceDB *db,
+                     const gnc_commodity *commodity,
+                     const gnc_commodity *currency,
+                     Timespec t, Timespec loaded_since)
+{
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    Timespec older = gnc_dmy2timespec(5, 1, 2009);
+    Timespec oldest = gnc_dmy2timespec(7, 1, 2008);
+
+    ++prices_loader_calls;
+    if (timespec_cmp(&older, &loaded_since) < 0)
+        gnc_pricedb_add_price(db, construct_price(book, (gnc_commodity*)commodity,
+                                                  (gnc_commodity*)currency,
+                                                  older, PRICE_SOURCE_FQ,
+                                       gnc_numeric_create(5497, 100)));
+    if (timespec_cmp(&t, &older) >= 0)
+    {
+        gnc_pricedb_set_prices_pending(db, commodity, currency, &older);
+        return;
+    }
+    gnc_pricedb_add_price(db, construct_price(book, (gnc_commodity*)commodity,
+                                              (gnc_commodity*)currency,
+                                              oldest, PRICE_SOURCE_FQ,
+                                   gnc_numeric_create(8900, 100)));
+}
+
+static void
+test_gnc_pricedb_prices_loader (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    Commodities *c = fixture->com;
+    QofBackend *be = g_new0(QofBackend, 1);
+    Timespec loaded_since = gnc_dmy2timespec(13, 4, 2009);
+    Timespec t;
+    PriceList *prices;
+    GNCPrice *price;
+
+    qof_book_set_backend(book, be);
+    gnc_pricedb_set_prices_loader(load_pending_prices);
+    prices_loader_calls = 0;
+    gnc_pricedb_set_prices_pending(db, c->amzn, c->usd, &loaded_since);
+
+    /* Lookups the loaded prices answer don't go to the backend. */
+    t = gnc_dmy2timespec(1, 1, 2012);
+    price = gnc_pricedb_lookup_latest_before(db, c->amzn, c->usd, t);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(22252, 100)));
+    gnc_price_unref(price);
+    g_assert_cmpuint(prices_loader_calls, ==, 0);
+
+    /* An earlier one loads back to the price wanted. */
+    t = gnc_dmy2timespec(1, 2, 2009);
+    price = gnc_pricedb_lookup_latest_before(db, c->amzn, c->usd, t);
+    g_assert(gnc_numeric_equal(gnc_price_get_value(price),
+                               gnc_numeric_create(5497, 100)));
+    gnc_price_unref(price);
+    g_assert_cmpuint(prices_loader_calls, ==, 1);
+    price = gnc_pricedb_lookup_nearest_in_time(db, c->usd, c->amzn, t);
+    g_assert(price);
+    gnc_price_unref(price);
+    g_assert_cmpuint(prices_loader_calls, ==, 1);
+
+    /* The whole list loads the rest, once. */
+    prices = gnc_pricedb_get_prices(db, c->amzn, c->usd);
+    g_assert_cmpint(g_list_length(prices), ==, 8);
+    gnc_price_list_destroy(prices);
+    g_assert_cmpuint(prices_loader_calls, ==, 2);
+    prices = gnc_pricedb_get_prices(db, c->amzn, c->usd);
+    gnc_price_list_destroy(prices);
+    gnc_pricedb_load_all_prices(db);
+    g_assert_cmpuint(prices_loader_calls, ==, 2);
+
+    gnc_pricedb_set_prices_loader(NULL);
+    qof_book_set_backend(book, NULL);
+    g_free(be);
+}
+/* Repeated lookups are answered from the cache until the prices change. */
+static void
+test_gnc_pricedb_lookup_cache (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    Commodities *c = fixture->com;
+    Timespec t = gnc_dmy2timespec(1, 1, 2013);
+    Timespec t_new = gnc_dmy2timespec(2, 1, 2013);
+    guint64 hits, misses, hits0, misses0;
+    GNCPrice *price1, *price2, *new_price;
+
+    gnc_pricedb_get_lookup_stats(db, &hits0, &misses0);
+    price1 = gnc_pricedb_lookup_nearest_in_time(db, c->amzn, c->usd, t);
+    price2 = gnc_pricedb_lookup_nearest_in_time(db, c->amzn, c->usd, t);
+    g_assert(price1 == price2);
+    gnc_price_unref(price2);
+    price2 = gnc_pricedb_lookup_latest_before(db, c->amzn, c->usd, t);
+    g_assert(price1 == price2);
+    gnc_price_unref(price2);
+    gnc_pricedb_get_lookup_stats(db, &hits, &misses);
+    g_assert_cmpint(hits - hits0, ==, 1);
+    g_assert_cmpint(misses - misses0, ==, 2);
+
+    new_price = construct_price(book, c->amzn, c->usd, t_new,
+                                PRICE_SOURCE_FQ,
+                                gnc_numeric_create(25032, 100));
+    g_assert(gnc_pricedb_add_price(db, new_price));
+    price2 = gnc_pricedb_lookup_nearest_in_time(db, c->amzn, c->usd, t);
+    g_assert(price2 == new_price);
+    gnc_price_unref(price2);
+    gnc_pricedb_get_lookup_stats(db, &hits, &misses);
+    /* Adding looked for a price on the same day too. */
+    g_assert_cmpint(hits - hits0, ==, 1);
+    g_assert_cmpint(misses - misses0, ==, 4);
+    gnc_price_unref(price1);
+}
 /* direct_balance_conversion
 static gnc_numeric
 direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,// Local: 2:0:0
@@ -1128,6 +1404,30 @@ test_gnc_pricedb_convert_balance_nearest_price (PriceDBFixture *fixture, gconstp
     g_assert_cmpint(result.denom, ==, 100);
 
 }
+/* The conversion path for a pair must be recomputed once a price links
+ * them through a new bridge commodity. */
+static void
+test_gnc_pricedb_convert_balance_new_path (PriceDBFixture *fixture, gconstpointer pData)
+{
+    GNCPriceDB *db = fixture->pricedb;
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(db));
+    gnc_numeric from = gnc_numeric_create(10000, 100);
+    gnc_numeric result =
+        gnc_pricedb_convert_balance_latest_price(db, from, fixture->com->eur,
+                                                 fixture->com->aud);
+    g_assert(gnc_numeric_zero_p(result));
+    gnc_pricedb_add_price(db, construct_price(book, fixture->com->gbp,
+                                              fixture->com->aud,
+                                              gnc_dmy2timespec(12, 11, 2014),
+                                              PRICE_SOURCE_FQ,
+                                              gnc_numeric_create(180000, 100000)));
+    result = gnc_pricedb_convert_balance_latest_price(db, from,
+                                                      fixture->com->eur,
+                                                      fixture->com->aud);
+    /* 100 EUR / 1.26836 EUR/GBP * 1.8 AUD/GBP */
+    g_assert_cmpint(result.num, ==, 14192);
+    g_assert_cmpint(result.denom, ==, 100);
+}
 /* pricedb_foreach_pricelist
 static void
 pricedb_foreach_pricelist(gpointer key, gpointer val, gpointer user_data)// Local: 0:1:0
@@ -1375,15 +1675,22 @@ test_suite_gnc_pricedb (void)
 // GNC_TEST_ADD (suitename, "hash values helper", PriceDBFixture, NULL, setup, test_hash_values_helper, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb has prices", PriceDBFixture, NULL, setup, test_gnc_pricedb_has_prices, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb get prices", PriceDBFixture, NULL, setup, test_gnc_pricedb_get_prices, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb nth price", PriceDBFixture, NULL, setup, test_gnc_pricedb_nth_price, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb lookup day", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_day, teardown);
 // GNC_TEST_ADD (suitename, "lookup nearest in time", Fixture, NULL, setup, test_lookup_nearest_in_time, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb lookup nearest in time", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_nearest_in_time, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup latest before", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_latest_before, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup after remove", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_after_remove, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb bulk update", PriceDBFixture, NULL, setup, test_gnc_pricedb_bulk_update, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup cache", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_cache, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb prices loader", PriceDBFixture, NULL, setup, test_gnc_pricedb_prices_loader, teardown);
 // GNC_TEST_ADD (suitename, "direct balance conversion", Fixture, NULL, setup, test_direct_balance_conversion, teardown);
 // GNC_TEST_ADD (suitename, "extract common prices", Fixture, NULL, setup, test_extract_common_prices, teardown);
 // GNC_TEST_ADD (suitename, "convert balance", Fixture, NULL, setup, test_convert_balance, teardown);
 // GNC_TEST_ADD (suitename, "indirect balance conversion", Fixture, NULL, setup, test_indirect_balance_conversion, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance latest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_latest_price, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance nearest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_nearest_price, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb convert balance new path", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_new_path, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach pricelist", Fixture, NULL, setup, test_pricedb_foreach_pricelist, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach currencies hash", Fixture, NULL, setup, test_pricedb_foreach_currencies_hash, teardown);
 // GNC_TEST_ADD (suitename, "unstable price traversal", Fixture, NULL, setup, test_unstable_price_traversal, teardown);
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <gmodule.h>
+#include <glib/gstdio.h>
 #include <sys/types.h>
 #ifdef HAVE_DIRENT_H
 # include <dirent.h>
@@ -64,6 +65,31 @@ typedef struct
 
 static GNCModuleInfo * gnc_module_get_info(const char * lib_path);
 
+/* The module cache
+ *
+ * Finding out what a library is means dlopening it and with it
+ * everything it links to, which is most of the startup time of a
+ * program that only needs a few of them. So what gnc_module_get_info()
+ * finds -- including that a file isn't a module -- is kept in a key
+ * file in the user's cache directory, one group per library, and used
+ * as long as the library's size and modification time are unchanged.
+ */
+#define MODULE_CACHE_KEY_SIZE "size"
+#define MODULE_CACHE_KEY_MTIME "mtime"
+#define MODULE_CACHE_KEY_PATH "path"
+#define MODULE_CACHE_KEY_DESCRIPTION "description"
+#define MODULE_CACHE_KEY_INTERFACE "interface"
+#define MODULE_CACHE_KEY_AGE "age"
+#define MODULE_CACHE_KEY_REVISION "revision"
+
+static gchar * gnc_module_cache_filename(void);
+static gboolean gnc_module_cache_lookup(GKeyFile *cache, const char *fullpath,
+                                        const GStatBuf *st,
+                                        GNCModuleInfo **info);
+static void gnc_module_cache_store(GKeyFile *cache, const char *fullpath,
+                                   const GStatBuf *st,
+                                   const GNCModuleInfo *info);
+
 /*************************************************************
  * gnc_module_system_search_dirs
  * return a list of dirs to look in for gnc_module libraries
@@ -169,12 +195,21 @@ gnc_module_system_refresh(void)
 {
     GList * search_dirs;
     GList * current;
+    gchar * cache_filename;
+    GKeyFile * cache = g_key_file_new();
+    GKeyFile * new_cache = g_key_file_new();
+    gboolean cache_changed = FALSE;
+    gsize n_cached = 0, n_seen = 0;
 
     if (!loaded_modules)
     {
         gnc_module_system_init();
     }
 
+    cache_filename = gnc_module_cache_filename();
+    if (g_key_file_load_from_file(cache, cache_filename, G_KEY_FILE_NONE, NULL))
+        g_strfreev(g_key_file_get_groups(cache, &n_cached));
+
     /* get the GNC_MODULE_PATH and split it into directories */
     search_dirs = gnc_module_system_search_dirs();
 
@@ -207,9 +242,22 @@ gnc_module_system_refresh(void)
             {
                 /* get the full path name, then dlopen the library and see
                  * if it has the appropriate symbols to be a gnc_module */
+                GStatBuf st;
+
                 fullpath = g_build_filename((const gchar *)(current->data),
                                             dent, (char*)NULL);
-                info     = gnc_module_get_info(fullpath);
+                if (g_stat(fullpath, &st) != 0)
+                {
+                    g_free(fullpath);
+                    continue;
+                }
+                if (!gnc_module_cache_lookup(cache, fullpath, &st, &info))
+                {
+                    info = gnc_module_get_info(fullpath);
+                    cache_changed = TRUE;
+                }
+                gnc_module_cache_store(new_cache, fullpath, &st, info);
+                ++n_seen;
 
                 if (info)
                 {
@@ -227,6 +275,107 @@ gnc_module_system_refresh(void)
         g_free(current->data);
     }
     g_list_free(current);
+
+    /* Also drops the libraries that have gone away. */
+    if (cache_changed || n_seen != n_cached)
+    {
+        gchar *dirname = g_path_get_dirname(cache_filename);
+        gchar *data = g_key_file_to_data(new_cache, NULL, NULL);
+
+        if (g_mkdir_with_parents(dirname, 0700) != 0 ||
+                !g_file_set_contents(cache_filename, data, -1, NULL))
+            PWARN("Can't write the module cache %s", cache_filename);
+        g_free(data);
+        g_free(dirname);
+    }
+    g_key_file_free(new_cache);
+    g_key_file_free(cache);
+    g_free(cache_filename);
+}
+
+/*************************************************************
+ * gnc_module_cache_filename
+ * where the module cache lives
+ *************************************************************/
+
+static gchar *
+gnc_module_cache_filename(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), PACKAGE, "module-cache",
+                            (char*)NULL);
+}
+
+/*************************************************************
+ * gnc_module_cache_lookup
+ * if the cache knows the library as it is now, set *info to a new
+ * copy of what it knows, NULL if it isn't a module
+ *************************************************************/
+
+static gboolean
+gnc_module_cache_lookup(GKeyFile *cache, const char *fullpath,
+                        const GStatBuf *st, GNCModuleInfo **info)
+{
+    GError *error = NULL;
+    gint64 size, mtime;
+
+    *info = NULL;
+    if (!g_key_file_has_group(cache, fullpath))
+        return FALSE;
+    size = g_key_file_get_int64(cache, fullpath, MODULE_CACHE_KEY_SIZE, &error);
+    if (!error)
+        mtime = g_key_file_get_int64(cache, fullpath, MODULE_CACHE_KEY_MTIME,
+                                     &error);
+    if (error)
+    {
+        g_error_free(error);
+        return FALSE;
+    }
+    if (size != (gint64)st->st_size || mtime != (gint64)st->st_mtime)
+        return FALSE;
+
+    /* A library that isn't a module has nothing but its size and time. */
+    if (!g_key_file_has_key(cache, fullpath, MODULE_CACHE_KEY_PATH, NULL))
+        return TRUE;
+
+    *info = g_new0(GNCModuleInfo, 1);
+    (*info)->module_path = g_key_file_get_string(cache, fullpath,
+                           MODULE_CACHE_KEY_PATH, NULL);
+    (*info)->module_description = g_key_file_get_string(cache, fullpath,
+                                  MODULE_CACHE_KEY_DESCRIPTION, NULL);
+    (*info)->module_filepath = g_strdup(fullpath);
+    (*info)->module_interface = g_key_file_get_integer(cache, fullpath,
+                                MODULE_CACHE_KEY_INTERFACE, NULL);
+    (*info)->module_age = g_key_file_get_integer(cache, fullpath,
+                          MODULE_CACHE_KEY_AGE, NULL);
+    (*info)->module_revision = g_key_file_get_integer(cache, fullpath,
+                               MODULE_CACHE_KEY_REVISION, NULL);
+    return TRUE;
+}
+
+/*************************************************************
+ * gnc_module_cache_store
+ * record what the library is, info being NULL if it isn't a module
+ *************************************************************/
+
+static void
+gnc_module_cache_store(GKeyFile *cache, const char *fullpath,
+                       const GStatBuf *st, const GNCModuleInfo *info)
+{
+    g_key_file_set_int64(cache, fullpath, MODULE_CACHE_KEY_SIZE, st->st_size);
+    g_key_file_set_int64(cache, fullpath, MODULE_CACHE_KEY_MTIME, st->st_mtime);
+    if (!info)
+        return;
+    g_key_file_set_string(cache, fullpath, MODULE_CACHE_KEY_PATH,
+                          info->module_path ? info->module_path : "");
+    g_key_file_set_string(cache, fullpath, MODULE_CACHE_KEY_DESCRIPTION,
+                          info->module_description ?
+                          info->module_description : "");
+    g_key_file_set_integer(cache, fullpath, MODULE_CACHE_KEY_INTERFACE,
+                           info->module_interface);
+    g_key_file_set_integer(cache, fullpath, MODULE_CACHE_KEY_AGE,
+                           info->module_age);
+    g_key_file_set_integer(cache, fullpath, MODULE_CACHE_KEY_REVISION,
+                           info->module_revision);
 }
 
 
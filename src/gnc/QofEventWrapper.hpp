@@ -88,6 +88,24 @@ namespace detail
     {
         return GNC_ID_SPLIT;
     }
+
+    /** Calls the receiver's member function, with the event data if it
+     * takes a third argument. */
+    template<class ReceiverT, class ValuePtrT>
+    inline void invokeSlot(ReceiverT& receiver,
+                           void (ReceiverT::*func)(ValuePtrT, QofEventId),
+                           ValuePtrT vptr, QofEventId event_type, gpointer)
+    {
+        (receiver.*func)(vptr, event_type);
+    }
+    template<class ReceiverT, class ValuePtrT>
+    inline void invokeSlot(ReceiverT& receiver,
+                           void (ReceiverT::*func)(ValuePtrT, QofEventId, gpointer),
+                           ValuePtrT vptr, QofEventId event_type,
+                           gpointer event_data)
+    {
+        (receiver.*func)(vptr, event_type, event_data);
+    }
 }
 
 /** Template wrapper class for objects which want to receive
@@ -96,7 +114,9 @@ namespace detail
  *
  * The receiver's class is the first template argument; the argument
  * type of the to-be-called member function is the second template
- * (usually a pointer type). */
+ * (usually a pointer type). The member function may take the event
+ * data as a third, gpointer argument, which then is the third template
+ * argument's signature. */
 template<class ReceiverT, class ValuePtrT, typename SlotFunc = void (ReceiverT::*)(ValuePtrT, QofEventId)>
 class QofEventWrapper
 {
@@ -143,7 +163,8 @@ private:
 
         // Call the pointer-to-member function with that weird C++
         // syntax
-        (m_receiver.*m_receiveFunc)(vptr, event_type);
+        gnc::detail::invokeSlot(m_receiver, m_receiveFunc, vptr, event_type,
+                                event_data);
     }
 
     ReceiverT& m_receiver;
@@ -0,0 +1,59 @@
+/*
+ * SessionLoader.cpp
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+#include "gnc/SessionLoader.hpp"
+#include <cassert>
+
+namespace gnc
+{
+
+SessionLoader *SessionLoader::s_running = NULL;
+
+SessionLoader::SessionLoader(::QofSession *session, QObject *parent)
+        : QThread(parent)
+        , m_session(session)
+{
+}
+
+SessionLoader::~SessionLoader()
+{
+    wait();
+}
+
+void SessionLoader::run()
+{
+    assert(!s_running);
+    s_running = this;
+    qof_session_load(m_session, &SessionLoader::percentage_func);
+    s_running = NULL;
+}
+
+/* Called on the loading thread; the signals are queued to the
+ * receivers' thread. */
+void SessionLoader::percentage_func(const char *message, double percent)
+{
+    assert(s_running);
+    if (message && *message)
+        Q_EMIT s_running->message(QString::fromUtf8(message));
+    Q_EMIT s_running->progress(int(percent));
+}
+
+} // END namespace gnc
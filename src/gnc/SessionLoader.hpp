@@ -0,0 +1,74 @@
+/*
+ * SessionLoader.hpp
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, contact:
+ *
+ * Free Software Foundation           Voice:  +1-617-542-5942
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org
+ */
+
+#ifndef GNC_SESSIONLOADER_HPP
+#define GNC_SESSIONLOADER_HPP
+
+#include "config.h"
+extern "C"
+{
+#include "qof.h"
+}
+
+#include <QtCore/QThread>
+#include <QtCore/QString>
+
+namespace gnc
+{
+
+/** Runs qof_session_load() of a session that has already begun on a
+ * thread of its own, so that the window stays responsive while a large
+ * book is read.  The backend's progress reaches the GUI thread through
+ * the queued progress() and message() signals.
+ *
+ * Nothing else may touch the engine until finished() has been emitted;
+ * the caller is responsible for keeping the user away from it.  Only
+ * one loader may run at a time, because QofPercentageFunc carries no
+ * user data.
+ */
+class SessionLoader : public QThread
+{
+    Q_OBJECT
+public:
+    SessionLoader(::QofSession *session, QObject *parent = 0);
+    ~SessionLoader();
+
+    ::QofSession *session() const { return m_session; }
+
+Q_SIGNALS:
+    /** The load is percent done, from 0 to 100. */
+    void progress(int percent);
+    /** The backend's description of what it is loading now. */
+    void message(const QString &text);
+
+protected:
+    void run();
+
+private:
+    static void percentage_func(const char *message, double percent);
+
+    ::QofSession *m_session;
+    static SessionLoader *s_running;
+};
+
+} // END namespace gnc
+
+#endif
@@ -32,12 +32,17 @@
 #include <QMessageBox>
 #include <QDateTime>
 
+#include <algorithm>
+
 #include "app-utils/gnc-ui-util.h" // for gnc_get_reconcile_str
 
 namespace gnc
 {
 
-
+static bool splitLessThan( ::Split* a, ::Split* b)
+{
+    return xaccSplitOrder(a, b) < 0;
+}
 
 SplitListModel::SplitListModel(const Glib::RefPtr<Account> acc, QUndoStack* undoStack, QObject *parent)
         : QAbstractItemModel(parent)
@@ -47,6 +52,8 @@ SplitListModel::SplitListModel(const Glib::RefPtr<Account> acc, QUndoStack* undo
         , m_eventWrapper(*this, &SplitListModel::transactionEvent)
         , m_eventWrapperAccount(*this, &SplitListModel::accountEvent)
         , m_enableNewTransaction(true)
+        , m_rowCache(ROW_CACHE_SIZE)
+        , m_balanceGeneration(0)
 {
     recreateCache();
 
@@ -64,6 +71,7 @@ void SplitListModel::recreateCache()
 
     // Cache the mapping of transactions to split in the m_hash
     m_hash.clear();
+    m_rowCache.clear();
     for (int k = 0; k < m_list.size(); ++k)
     {
         m_hash.insert(Glib::wrap(m_list[k])->get_parent()->gobj(), k);
@@ -73,6 +81,80 @@ void SplitListModel::recreateCache()
         reset();
 }
 
+int SplitListModel::sortedRow( ::Split* split) const
+{
+    return std::lower_bound(m_list.begin(), m_list.end(), split, splitLessThan)
+           - m_list.begin();
+}
+
+void SplitListModel::rehash(int firstRow)
+{
+    for (int k = firstRow; k < m_list.size(); ++k)
+    {
+        // A split added to the account may not have its transaction yet
+        ::Transaction* trans = xaccSplitGetParent(m_list[k]);
+        if (trans)
+            m_hash.insert(trans, k);
+    }
+}
+
+void SplitListModel::balanceChanged(int firstRow)
+{
+    ++m_balanceGeneration;
+    if (firstRow < m_list.size())
+        Q_EMIT dataChanged(index(firstRow, COLUMN_BALANCE),
+                           index(m_list.size() - 1, COLUMN_BALANCE));
+}
+
+void SplitListModel::insertSplit( ::Split* split)
+{
+    if (m_list.contains(split))
+        return;
+    int row = sortedRow(split);
+    beginInsertRows(QModelIndex(), row, row);
+    m_list.insert(row, split);
+    rehash(row);
+    endInsertRows();
+    balanceChanged(row + 1);
+}
+
+void SplitListModel::removeSplit( ::Split* split)
+{
+    int row = m_list.indexOf(split);
+    if (row < 0)
+        return;
+    beginRemoveRows(QModelIndex(), row, row);
+    m_list.removeAt(row);
+    m_rowCache.remove(split);
+    ::Transaction* trans = xaccSplitGetParent(split);
+    if (m_hash.value(trans, -1) == row)
+        m_hash.remove(trans);
+    rehash(row);
+    endRemoveRows();
+    balanceChanged(row);
+}
+
+int SplitListModel::resortRow(int row)
+{
+    ::Split* split = m_list.at(row);
+    bool inOrder = (row == 0 || !splitLessThan(split, m_list.at(row - 1)))
+                   && (row == m_list.size() - 1
+                       || !splitLessThan(m_list.at(row + 1), split));
+    if (inOrder)
+        return row;
+
+    m_list.removeAt(row);
+    int dest = sortedRow(split);
+    m_list.insert(row, split);
+    // beginMoveRows() counts the destination before the row is taken out
+    beginMoveRows(QModelIndex(), row, row, QModelIndex(),
+                  dest > row ? dest + 1 : dest);
+    m_list.move(row, dest);
+    rehash(qMin(row, dest));
+    endMoveRows();
+    return dest;
+}
+
 void SplitListModel::recreateTmpTrans()
 {
     m_tmpTransaction.reset_content();
@@ -126,8 +208,8 @@ bool SplitListModel::removeRows(int position, int rows, const QModelIndex &index
         QUndoCommand* cmd = cmd::destroyTransaction(t);
         m_undoStack->push(cmd);
     }
-    // No beginInsertRows/endInsertRows because reset() is called in
-    // recreateCache() anyway.
+    // No beginRemoveRows/endRemoveRows because removeSplit() is
+    // called upon the account's GNC_EVENT_ITEM_REMOVED anyway.
     return true;
 }
 
@@ -271,101 +353,65 @@ QVariant SplitListModel::data(const QModelIndex& index, int role) const
         // Normal case: We are in a row that displays a normal
         // transaction and split
 
-        Glib::RefPtr<Split> split = Glib::wrap(static_cast< ::Split*>(index.internalPointer()));
+        const RowCache& cache = rowCache(static_cast< ::Split*>(index.internalPointer()));
+        switch (role)
+        {
+        case Qt::DisplayRole:
+            return cache.cells[index.column()];
+        case Qt::EditRole:
+            return index.column() == COLUMN_BALANCE
+                   ? QVariant() : cache.cells[index.column()];
+        case Qt::ForegroundRole:
+            if (index.column() == COLUMN_BALANCE)
+                return cache.balanceNegative ? QBrush(Qt::red) : QBrush();
+            return QVariant();
+        default:
+            return QVariant();
+        }
+    }
+}
+
+const SplitListModel::RowCache& SplitListModel::rowCache( ::Split* gsplit) const
+{
+    RowCache* cache = m_rowCache.object(gsplit);
+    if (cache && cache->balanceGeneration == m_balanceGeneration)
+        return *cache;
+
+    Glib::RefPtr<Split> split = Glib::wrap(gsplit);
+    PrintAmountInfo printInfo(split, false);
+    if (!cache)
+    {
+        cache = new RowCache;
         Glib::RefPtr<Transaction> trans(split->get_parent());
         Numeric amount = split->get_value(); // Alternatively: xaccSplitConvertAmount(split.gobj(), split.getAccount().gobj());
-        PrintAmountInfo printInfo(split, false);
 
-        switch (index.column())
+        cache->cells[COLUMN_DATE] = g2q(trans->get_date_posted());
+        cache->cells[COLUMN_NUM] = g2q(trans->get_num());
+        cache->cells[COLUMN_DESC] = g2q(trans->get_description());
+        if (trans->get_num_splits() == 2)
+            cache->cells[COLUMN_ACCOUNT] = QVariant::fromValue(split->get_other_split()->get_account()->gobj());
+        else
+            cache->cells[COLUMN_ACCOUNT] = g2q(split->get_corr_account_full_name());
+        cache->cells[COLUMN_RECONCILE] = QString::fromUtf8(gnc_get_reconcile_str(split->get_reconcile()));
+        if (amount.positive_p())
         {
-        case COLUMN_DATE:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                return g2q(trans->get_date_posted());
-            default:
-                return QVariant();
-            }
-        case COLUMN_NUM:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                return g2q(trans->get_num());
-            default:
-                return QVariant();
-            }
-        case COLUMN_DESC:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                return g2q(trans->get_description());
-            default:
-                return QVariant();
-            }
-        case COLUMN_ACCOUNT:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                if (trans->get_num_splits() == 2)
-                    return QVariant::fromValue(split->get_other_split()->get_account()->gobj());
-                else
-                    return g2q(split->get_corr_account_full_name());
-            default:
-                return QVariant();
-            }
-        case COLUMN_RECONCILE:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                return QString::fromUtf8(gnc_get_reconcile_str(split->get_reconcile()));
-            default:
-                return QVariant();
-            }
-        case COLUMN_INCREASE:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                if (amount.positive_p())
-                    return g2q(amount.printAmount(printInfo));
-                else
-                    return QString();
-            default:
-                return QVariant();
-            }
-        case COLUMN_DECREASE:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-            case Qt::EditRole:
-                if (amount.positive_p())
-                    return QString();
-                else
-                    return g2q(amount.neg().printAmount(printInfo));
-            default:
-                return QVariant();
-            }
-        case COLUMN_BALANCE:
-            switch (role)
-            {
-            case Qt::DisplayRole:
-                return g2q(split->get_balance().printAmount(printInfo));
-            case Qt::ForegroundRole:
-                return split->get_balance().negative_p()
-                       ? QBrush(Qt::red)
-                       : QBrush();
-            default:
-                return QVariant();
-            }
-        default:
-            return QVariant();
+            cache->cells[COLUMN_INCREASE] = g2q(amount.printAmount(printInfo));
+            cache->cells[COLUMN_DECREASE] = QString();
         }
+        else
+        {
+            cache->cells[COLUMN_INCREASE] = QString();
+            cache->cells[COLUMN_DECREASE] = g2q(amount.neg().printAmount(printInfo));
+        }
+        m_rowCache.insert(gsplit, cache);
     }
+    // The balances change with every row above, so they are kept only
+    // until the next such change
+    Numeric balance = split->get_balance();
+    cache->cells[COLUMN_BALANCE] = g2q(balance.printAmount(printInfo));
+    cache->balanceNegative = balance.negative_p();
+    cache->balanceGeneration = m_balanceGeneration;
+    return *cache;
 }
 
 QVariant SplitListModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -657,12 +703,28 @@ void SplitListModel::transactionEvent( ::Transaction* trans, QofEventId event_ty
     switch (event_type)
     {
     case QOF_EVENT_MODIFY:
-        if (m_hash.contains(trans))
+    {
+        int firstRow = m_list.size();
+        for (GList* node = xaccTransGetSplitList(trans); node; node = node->next)
         {
-            int row = m_hash.value(trans);
+            ::Split* split = static_cast< ::Split*>(node->data);
+            if (xaccSplitGetAccount(split) != m_account->gobj())
+                continue;
+            m_rowCache.remove(split);
+            int oldRow = m_hash.value(trans, -1);
+            if (oldRow < 0 || oldRow >= m_list.size() || m_list.at(oldRow) != split)
+                oldRow = m_list.indexOf(split);
+            if (oldRow < 0)
+                continue;
+            int row = resortRow(oldRow);
             Q_EMIT dataChanged(index(row, 0), index(row, columnCount() - 1));
+            firstRow = qMin(firstRow, qMin(oldRow, row));
         }
+        // The amount or the order may have changed, and with it the
+        // balances of the rows below
+        balanceChanged(firstRow);
         break;
+    }
     case GNC_EVENT_ITEM_REMOVED:
     case GNC_EVENT_ITEM_ADDED:
         // This event is triggered by a split being added (or removed)
@@ -680,17 +742,36 @@ void SplitListModel::transactionEvent( ::Transaction* trans, QofEventId event_ty
 
 }
 
-void SplitListModel::accountEvent( ::Account* acc, QofEventId event_type)
+void SplitListModel::accountEvent( ::Account* acc, QofEventId event_type,
+                                  gpointer event_data)
 {
     if (acc != m_account->gobj())
+    {
+        // Another account's name may be shown in the transfer column
+        if (event_type == QOF_EVENT_MODIFY && !m_list.isEmpty())
+        {
+            m_rowCache.clear();
+            Q_EMIT dataChanged(index(0, COLUMN_ACCOUNT),
+                               index(m_list.size() - 1, COLUMN_ACCOUNT));
+        }
         return;
+    }
     //qDebug() << "SplitListModel::accountEvent, id=" << qofEventToString(event_type);
 
     switch (event_type)
     {
-    case GNC_EVENT_ITEM_REMOVED:
     case GNC_EVENT_ITEM_ADDED:
-        recreateCache();
+        // The event data is the split added to the account
+        if (event_data)
+            insertSplit(static_cast< ::Split*>(event_data));
+        else
+            recreateCache();
+        break;
+    case GNC_EVENT_ITEM_REMOVED:
+        if (event_data)
+            removeSplit(static_cast< ::Split*>(event_data));
+        else
+            recreateCache();
         break;
     case QOF_EVENT_MODIFY:
     case GNC_EVENT_ITEM_CHANGED:
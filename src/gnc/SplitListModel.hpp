@@ -38,6 +38,7 @@ extern "C"
 #include <QAbstractItemModel>
 #include <QAbstractItemDelegate>
 #include <QHash>
+#include <QCache>
 class QUndoStack;
 
 namespace gnc
@@ -83,12 +84,36 @@ public:
 
 public Q_SLOTS:
     void transactionEvent( ::Transaction* trans, QofEventId event_type);
-    void accountEvent( ::Account* trans, QofEventId event_type);
+    void accountEvent( ::Account* acc, QofEventId event_type, gpointer event_data);
     void editorClosed(const QModelIndex& index, QAbstractItemDelegate::EndEditHint hint);
 
 private:
     void recreateCache();
     void recreateTmpTrans();
+    /** The row at which the split belongs in the sorted m_list. */
+    int sortedRow( ::Split* split) const;
+    void insertSplit( ::Split* split);
+    void removeSplit( ::Split* split);
+    /** Moves the transaction's row if its date changed its order. */
+    int resortRow(int row);
+    /** Updates the m_hash entries of the rows from the given one on. */
+    void rehash(int firstRow);
+    /** Signals the change of the balances from the given row on, all of
+     * which follow from the engine's running balances. */
+    void balanceChanged(int firstRow);
+
+    /** The formatted cells of a split's row, made when the row is first
+     * shown. */
+    struct RowCache
+    {
+        QVariant cells[COLUMN_LAST];
+        bool balanceNegative;
+        /** The balance is stale unless this is m_balanceGeneration */
+        unsigned int balanceGeneration;
+    };
+    const RowCache& rowCache( ::Split* split) const;
+    /** About a few screens full of rows */
+    static const int ROW_CACHE_SIZE = 500;
 
 protected:
     Glib::RefPtr<Account> m_account;
@@ -99,10 +124,15 @@ protected:
 
     /** The wrapper for receiving events from gnc. */
     QofEventWrapper<SplitListModel, ::Transaction*> m_eventWrapper;
-    QofEventWrapper<SplitListModel, ::Account*> m_eventWrapperAccount;
+    QofEventWrapper<SplitListModel, ::Account*,
+                    void (SplitListModel::*)( ::Account*, QofEventId, gpointer)> m_eventWrapperAccount;
 
     bool m_enableNewTransaction;
     TmpTransaction m_tmpTransaction;
+
+    /** The rows shown lately, least recently used evicted first. */
+    mutable QCache< ::Split*, RowCache> m_rowCache;
+    unsigned int m_balanceGeneration;
 };
 
 } // END namespace gnc
@@ -24,6 +24,7 @@
 #include <QtGui/QCloseEvent>
 #include <QtGui/QFileDialog>
 #include <QtGui/QMessageBox>
+#include <QtCore/QEventLoop>
 #include <QtGui/QProgressBar>
 #include <QtGui/QPushButton>
 #include <QtGui/QToolBar>
@@ -52,6 +53,7 @@ extern "C"
 #include "gncmm/Split.hpp"
 #include "gnc/SplitListModel.hpp"
 #include "gnc/RecentFileMenu.hpp"
+#include "gnc/SessionLoader.hpp"
 
 /* Temp solution for accounts list */
 #include "gnc/fpo/ViewletView.hpp"
@@ -466,14 +468,23 @@ void MainWindow::loadFile(const QString &fileName)
             statusBar()->showMessage(tr("Loading user data..."));
             statusBar()->addPermanentWidget(&progressBar);
             progressBar.show();
-            // This local progress_functor is a workaround on how to
-            // pass the suitable function pointer to session_load -
-            // not very nice because of its static member, but it does
-            // the trick for now.
-            progress_functor functor(&progressBar);
-
-            // Do the loading.
-            qof_session_load (new_session, &progress_functor::static_func);
+
+            // Do the loading on a thread of its own so that the window
+            // keeps repainting and showing the progress.  The engine
+            // belongs to the loader until it is done, so user input is
+            // held back and closeEvent() refuses to close meanwhile.
+            SessionLoader loader(new_session);
+            QEventLoop loop;
+            connect(&loader, SIGNAL(progress(int)),
+                    &progressBar, SLOT(setValue(int)));
+            connect(&loader, SIGNAL(message(const QString&)),
+                    statusBar(), SLOT(showMessage(const QString&)));
+            connect(&loader, SIGNAL(finished()), &loop, SLOT(quit()));
+            m_loading = true;
+            loader.start();
+            loop.exec(QEventLoop::ExcludeUserInputEvents);
+            loader.wait();
+            m_loading = false;
 
             // Remove the progress bar again from the status bar.
             statusBar()->removeWidget(&progressBar);
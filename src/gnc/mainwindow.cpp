@@ -79,6 +79,7 @@ MainWindow::MainWindow()
         : ui(new Ui::MainWindow)
         , m_menuRecentFiles(new RecentFileMenu(tr("Open &Recent")))
         , m_undoStack(new QUndoStack(this))
+        , m_loading(false)
 {
     ui->setupUi(this);
 
@@ -567,6 +568,12 @@ void MainWindow::on_actionCut_triggered()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
+    /* The book being loaded can't be closed before it is complete. */
+    if (m_loading)
+    {
+        event->ignore();
+        return;
+    }
     if (maybeSave())
     {
         m_dboard->mainWindowCloseEvent();
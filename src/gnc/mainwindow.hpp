@@ -138,6 +138,7 @@ private:
     QToolButton *m_btnTransferFundsWidget;
     QSharedPointer<RecentFileMenu> m_menuRecentFiles;
     QUndoStack *m_undoStack;
+    bool m_loading;
 
     Dashboard *m_dboard;
 
@@ -52,20 +52,39 @@ static void listen_for_account_events  (QofInstance *entity,  QofEventId event_t
 typedef struct
 {
     QuickFill *qf;
-    gboolean load_list_store;
     GtkListStore *list_store;
     QofBook *book;
     Account *root;
     gint  listener;
     AccountBoolCB dont_add_cb;
     gpointer dont_add_data;
+    /* Account * -> QFBEntry *, so that an event changes only the rows
+     * it is about. */
+    GHashTable *entries;
 } QFB;
 
+typedef struct
+{
+    gchar *name;
+    /* Whether dont_add_cb let the account into the list store. */
+    gboolean listed;
+    /* List store iters persist as long as their row. */
+    GtkTreeIter iter;
+} QFBEntry;
+
+static void
+shared_quickfill_entry_free (gpointer data)
+{
+    QFBEntry *entry = data;
+    g_free (entry->name);
+    g_free (entry);
+}
+
 static void
 shared_quickfill_destroy (QofBook *book, gpointer key, gpointer user_data)
 {
     QFB *qfb = user_data;
-    gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL_REGISTER,
+    gnc_prefs_remove_cb_by_func (GNC_PREFS_GROUP_GENERAL,
                                  GNC_PREF_ACCOUNT_SEPARATOR,
                                  shared_quickfill_pref_changed,
                                  qfb);
@@ -75,70 +94,93 @@ shared_quickfill_destroy (QofBook *book, gpointer key, gpointer user_data)
                                  qfb);
     gnc_quickfill_destroy (qfb->qf);
     g_object_unref(qfb->list_store);
+    g_hash_table_destroy (qfb->entries);
     qof_event_unregister_handler (qfb->listener);
     g_free (qfb);
 }
 
 
-typedef struct find_data
-{
-    GList *accounts;
-    GList *refs;
-} find_data;
-
-static gboolean
-shared_quickfill_find_accounts (GtkTreeModel *model,
-                                GtkTreePath *path,
-                                GtkTreeIter *iter,
-                                gpointer user_data)
+/* Take the account out of the quickfill and the list store */
+static void
+shared_quickfill_remove (QFB *qfb, Account *account)
 {
-    Account *account = NULL;
-    find_data *data = user_data;
-    GtkTreeRowReference* ref;
-    GList *tmp;
+    QFBEntry *entry = g_hash_table_lookup (qfb->entries, account);
+
+    if (!entry) return;
 
-    gtk_tree_model_get(model, iter, ACCOUNT_POINTER, &account, -1);
-    for (tmp = data->accounts; tmp; tmp = g_list_next(tmp))
+    if (entry->listed)
     {
-        if (tmp->data == account)
-        {
-            ref = gtk_tree_row_reference_new(model, path);
-            data->refs = g_list_append(data->refs, ref);
-            data->accounts = g_list_remove_link(data->accounts, tmp);
-            return (data->accounts == NULL);
-        }
+        DEBUG("remove %s", entry->name);
+        gnc_quickfill_remove (qfb->qf, entry->name, QUICKFILL_ALPHA);
+        gtk_list_store_remove (qfb->list_store, &entry->iter);
     }
-
-    return FALSE;
+    g_hash_table_remove (qfb->entries, account);
 }
 
 
-/* Splat the account name into the shared quickfill object */
+/* Splat the account name into the shared quickfill object, or bring
+ * the name there up to date. */
 static void
 load_shared_qf_cb (Account *account, gpointer data)
 {
     QFB *qfb = data;
+    QFBEntry *entry;
+    gboolean skip = FALSE, renamed;
     char *name;
-    GtkTreeIter iter;
 
     if (qfb->dont_add_cb)
+        skip = (qfb->dont_add_cb) (account, qfb->dont_add_data);
+
+    name = gnc_get_account_name_for_register (account);
+    if (NULL == name)
+    {
+        shared_quickfill_remove (qfb, account);
+        return;
+    }
+
+    entry = g_hash_table_lookup (qfb->entries, account);
+    if (!entry)
     {
-        gboolean skip = (qfb->dont_add_cb) (account, qfb->dont_add_data);
-        if (skip) return;
+        entry = g_new0 (QFBEntry, 1);
+        g_hash_table_insert (qfb->entries, account, entry);
     }
+    renamed = (g_strcmp0 (entry->name, name) != 0);
 
-    name = gnc_get_account_name_for_register (account);
-    if (NULL == name) return;
-    gnc_quickfill_insert (qfb->qf, name, QUICKFILL_ALPHA);
-    if (qfb->load_list_store)
+    if (entry->listed && (skip || renamed))
     {
-        gtk_list_store_append (qfb->list_store, &iter);
-        gtk_list_store_set (qfb->list_store, &iter,
+        gnc_quickfill_remove (qfb->qf, entry->name, QUICKFILL_ALPHA);
+        if (skip)
+        {
+            gtk_list_store_remove (qfb->list_store, &entry->iter);
+            entry->listed = FALSE;
+        }
+    }
+
+    if (!skip && (!entry->listed || renamed))
+    {
+        if (!entry->listed)
+        {
+            gtk_list_store_append (qfb->list_store, &entry->iter);
+            gtk_list_store_set (qfb->list_store, &entry->iter,
+                                ACCOUNT_POINTER, account,
+                                -1);
+            entry->listed = TRUE;
+        }
+        gnc_quickfill_insert (qfb->qf, name, QUICKFILL_ALPHA);
+        gtk_list_store_set (qfb->list_store, &entry->iter,
                             ACCOUNT_NAME, name,
-                            ACCOUNT_POINTER, account,
                             -1);
     }
-    g_free(name);
+
+    g_free (entry->name);
+    entry->name = name;
+}
+
+
+static void
+remove_shared_qf_cb (Account *account, gpointer data)
+{
+    shared_quickfill_remove (data, account);
 }
 
 
@@ -149,10 +191,9 @@ shared_quickfill_pref_changed (gpointer prefs, gchar *pref, gpointer user_data)
 
     /* Reload the quickfill */
     gnc_quickfill_purge(qfb->qf);
+    g_hash_table_remove_all(qfb->entries);
     gtk_list_store_clear(qfb->list_store);
-    qfb->load_list_store = TRUE;
     gnc_account_foreach_descendant(qfb->root, load_shared_qf_cb, qfb);
-    qfb->load_list_store = FALSE;
 }
 
 
@@ -172,9 +213,10 @@ build_shared_quickfill (QofBook *book, Account *root, const char * key,
     qfb->listener = 0;
     qfb->dont_add_cb = cb;
     qfb->dont_add_data = data;
-    qfb->load_list_store = TRUE;
     qfb->list_store =
         gtk_list_store_new (NUM_ACCOUNT_COLUMNS, G_TYPE_STRING, G_TYPE_POINTER);
+    qfb->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL, shared_quickfill_entry_free);
 
     gnc_prefs_register_cb (GNC_PREFS_GROUP_GENERAL,
                            GNC_PREF_ACCOUNT_SEPARATOR,
@@ -187,7 +229,6 @@ build_shared_quickfill (QofBook *book, Account *root, const char * key,
                            qfb);
 
     gnc_account_foreach_descendant(root, load_shared_qf_cb, qfb);
-    qfb->load_list_store = FALSE;
 
     qfb->listener =
         qof_event_register_handler (listen_for_account_events, qfb);
@@ -232,25 +273,21 @@ gnc_get_shared_account_name_list_store (Account *root,
 }
 
 /* Since we are maintaining a 'global' quickfill list, we need to
- * update it whenever the user creates a new account.  So listen
- * for account modification events, and add new accounts.
+ * update it whenever the user creates, changes, moves or deletes an
+ * account.  Each event touches only the rows of the account, and of
+ * its descendants when their full names change with it.
  */
 static void
 listen_for_account_events  (QofInstance *entity,  QofEventId event_type,
                             gpointer user_data, gpointer event_data)
 {
     QFB *qfb = user_data;
-    QuickFill *qf = qfb->qf;
-    QuickFill *match;
-    char * name;
-    const char *match_str;
     Account *account;
-    GtkTreeIter iter;
-    find_data data = { 0 };
-    GtkTreePath *path;
-    GList *tmp;
+    QFBEntry *entry;
+    gchar *old_name;
 
-    if (0 == (event_type & (QOF_EVENT_MODIFY | QOF_EVENT_ADD | QOF_EVENT_REMOVE)))
+    if (0 == (event_type & (QOF_EVENT_MODIFY | QOF_EVENT_ADD |
+                            QOF_EVENT_REMOVE | QOF_EVENT_DESTROY)))
         return;
 
     if (!GNC_IS_ACCOUNT (entity))
@@ -260,146 +297,51 @@ listen_for_account_events  (QofInstance *entity,  QofEventId event_type,
     ENTER("entity %p, event type %x, user data %p, ecent data %p",
           entity, event_type, user_data, event_data);
 
-    if (gnc_account_get_root(account) != qfb->root)
+    /* A destroyed account may already be out of the tree. */
+    if (event_type == QOF_EVENT_DESTROY)
     {
-        LEAVE("root account mismatch");
+        shared_quickfill_remove (qfb, account);
+        LEAVE("destroyed");
         return;
     }
 
-    name = gnc_get_account_name_for_register(account);
-    if (NULL == name)
+    if (gnc_account_get_root(account) != qfb->root)
     {
-        LEAVE("account has no name");
+        LEAVE("root account mismatch");
         return;
     }
 
     switch (event_type)
     {
     case QOF_EVENT_MODIFY:
-        DEBUG("modify %s", name);
-
-        /* Find the account (and all its descendants) in the model.  The
-         * full name of all these accounts has changed. */
-        data.accounts = gnc_account_get_descendants(account);
-        data.accounts = g_list_prepend(data.accounts, account);
-        gtk_tree_model_foreach(GTK_TREE_MODEL(qfb->list_store),
-                               shared_quickfill_find_accounts, &data);
-
-        /* Update the existing items in the list store.  Its possible
-         * that the change has caused an existing item to now become
-         * hidden, in which case it needs to be removed from the list
-         * store.  Otherwise its a simple update of the name string. */
-        for (tmp = data.refs; tmp; tmp = g_list_next(tmp))
-        {
-            path = gtk_tree_row_reference_get_path(tmp->data);
-            gtk_tree_row_reference_free(tmp->data);
-            if (!gtk_tree_model_get_iter(GTK_TREE_MODEL(qfb->list_store),
-                                         &iter, path))
-            {
-                gtk_tree_path_free(path);
-                continue;
-            }
-            gtk_tree_path_free(path);
-            gtk_tree_model_get(GTK_TREE_MODEL(qfb->list_store), &iter,
-                               ACCOUNT_POINTER, &account,
-                               -1);
-            if (qfb->dont_add_cb &&
-                    qfb->dont_add_cb(account, qfb->dont_add_data))
-            {
-                gtk_list_store_remove(qfb->list_store, &iter);
-            }
-            else
-            {
-                gchar *aname = gnc_get_account_name_for_register(account);
-                gtk_list_store_set(qfb->list_store, &iter,
-                                   ACCOUNT_NAME, aname,
-                                   -1);
-                g_free(aname);
-            }
-        }
-
-        /* Any accounts that weren't found in the tree are accounts that
-         * were hidden but have now become visible. Add them to the list
-         * store. */
-        for (tmp = data.accounts; tmp; tmp = g_list_next(tmp))
-        {
-            account = tmp->data;
-            if (qfb->dont_add_cb)
-            {
-                if (qfb->dont_add_cb(account, qfb->dont_add_data))
-                {
-                    continue;
-                }
-            }
-            gtk_list_store_append (qfb->list_store, &iter);
-            gtk_list_store_set (qfb->list_store, &iter,
-                                ACCOUNT_NAME, name,
-                                ACCOUNT_POINTER, account,
-                                -1);
-        }
+        /* Most modify events are balance changes, which change
+         * nothing here.  A new name changes the full names of all the
+         * descendants too. */
+        entry = g_hash_table_lookup (qfb->entries, account);
+        old_name = entry ? g_strdup (entry->name) : NULL;
+        load_shared_qf_cb (account, qfb);
+        entry = g_hash_table_lookup (qfb->entries, account);
+        if (g_strcmp0 (old_name, entry ? entry->name : NULL) != 0)
+            gnc_account_foreach_descendant (account, load_shared_qf_cb, qfb);
+        g_free (old_name);
         break;
 
     case QOF_EVENT_REMOVE:
-        DEBUG("remove %s", name);
-
-        /* Remove from qf */
-        gnc_quickfill_remove(qfb->qf, name, QUICKFILL_ALPHA);
-
-        /* Does the account exist in the model? */
-        data.accounts = g_list_append(NULL, account);
-        gtk_tree_model_foreach(GTK_TREE_MODEL(qfb->list_store),
-                               shared_quickfill_find_accounts, &data);
-
-        /* Remove from list store */
-        for (tmp = data.refs; tmp; tmp = g_list_next(tmp))
-        {
-            path = gtk_tree_row_reference_get_path (tmp->data);
-            gtk_tree_row_reference_free (tmp->data);
-            if (gtk_tree_model_get_iter(GTK_TREE_MODEL(qfb->list_store),
-                                        &iter, path))
-            {
-                gtk_list_store_remove(qfb->list_store, &iter);
-            }
-            gtk_tree_path_free(path);
-        }
+        /* The subtree is being deleted or moved; a move adds it back. */
+        shared_quickfill_remove (qfb, account);
+        gnc_account_foreach_descendant (account, remove_shared_qf_cb, qfb);
         break;
 
     case QOF_EVENT_ADD:
-        DEBUG("add %s", name);
-        if (qfb->dont_add_cb &&
-                qfb->dont_add_cb(account, qfb->dont_add_data))
-            break;
-
-        match = gnc_quickfill_get_string_match (qf, name);
-        if (match)
-        {
-            match_str = gnc_quickfill_string (match);
-            if (match_str && (g_strcmp0(match_str, name) != 0))
-            {
-                PINFO ("got match for %s", name);
-                break;
-            }
-        }
-
-        PINFO ("insert new account %s into qf=%p", name, qf);
-        gnc_quickfill_insert (qf, name, QUICKFILL_ALPHA);
-        gtk_list_store_append (qfb->list_store, &iter);
-        gtk_list_store_set (qfb->list_store, &iter,
-                            ACCOUNT_NAME, name,
-                            ACCOUNT_POINTER, account,
-                            -1);
+        load_shared_qf_cb (account, qfb);
+        gnc_account_foreach_descendant (account, load_shared_qf_cb, qfb);
         break;
 
     default:
-        DEBUG("other %s", name);
+        DEBUG("other event %x", event_type);
         break;
     }
 
-    if (data.accounts)
-        g_list_free(data.accounts);
-    if (data.refs)
-        g_list_free(data.refs);
-    g_free(name);
     LEAVE(" ");
 }
 
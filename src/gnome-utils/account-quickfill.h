@@ -63,10 +63,11 @@ typedef gboolean (*AccountBoolCB) (Account *, gpointer);
  *  Each is identified with the 'key'.  Be sure to use distinct,
  *  unique keys that don't conflict with other users of QofBook.
  *
- *  This code listens to account creation events, and automatically
- *  adds new accounts to the quickfill list (assuming skip_cb allows
- *  it).  This code does not currently listen to account-destroy
- *  events.
+ *  This code listens to account events, and keeps the quickfill and
+ *  the list store up to date as accounts are added, renamed, moved,
+ *  changed so that skip_cb decides differently, or destroyed.  Each
+ *  event only touches the entries of the account, and of its
+ *  descendants when their full names change with it.
  */
 QuickFill * gnc_get_shared_account_name_quickfill (Account *root,
         const char * key,
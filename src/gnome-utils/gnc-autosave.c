@@ -61,9 +61,9 @@ autosave_remove_timer_cb(QofBook *book, gpointer key, gpointer user_data);
  * "undirty".
  *
  * - Or the auto-save timer hits its timeout, hence calling
- * autosave_timeout_cb(). In this case gnc_file_save() is invoked, the
- * auto-save timer is removed, and all returns to the initial state
- * with the book "undirty".  (As an exceptional addition to this, on
+ * autosave_timeout_cb(). In this case gnc_file_save_in_background()
+ * is invoked, the auto-save timer is removed, and all returns to the
+ * initial state with the book "undirty".  (As an exceptional addition to this, on
  * the very first call to autosave_timeout_cb, if the key
  * autosave_show_explanation is true, an explanation dialog of this
  * feature is shown to the user, and the key autosave_show_explanation
@@ -206,7 +206,7 @@ static gboolean autosave_timeout_cb(gpointer user_data)
         else
             g_debug("autosave_timeout_cb: toplevel is not a GNC_WINDOW\n");
 
-        gnc_file_save();
+        gnc_file_save_in_background();
 
         gnc_main_window_set_progressbar_window(NULL);
 
@@ -1258,8 +1258,8 @@ gnc_file_do_export(const char * filename)
 
 static gboolean been_here_before = FALSE;
 
-void
-gnc_file_save (void)
+static void
+gnc_file_save_internal (gboolean background)
 {
     QofBackendError io_err;
     const char * newfile;
@@ -1294,7 +1294,10 @@ gnc_file_save (void)
     save_in_progress++;
     gnc_set_busy_cursor (NULL, TRUE);
     gnc_window_show_progress(_("Writing file..."), 0.0);
-    qof_session_save (session, gnc_window_show_progress);
+    if (background)
+        qof_session_save_in_background (session, gnc_window_show_progress);
+    else
+        qof_session_save (session, gnc_window_show_progress);
     gnc_window_show_progress(NULL, -1.0);
     gnc_unset_busy_cursor (NULL);
     save_in_progress--;
@@ -1320,6 +1323,18 @@ gnc_file_save (void)
     LEAVE (" ");
 }
 
+void
+gnc_file_save (void)
+{
+    gnc_file_save_internal (FALSE);
+}
+
+void
+gnc_file_save_in_background (void)
+{
+    gnc_file_save_internal (TRUE);
+}
+
 /* Note: this dialog will only be used when dbi is not enabled
  *       paths used in it always refer to files and are
  *       never db uris. See gnc_file_do_save_as for that.
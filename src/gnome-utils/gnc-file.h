@@ -48,6 +48,11 @@
  *    gnc_file_save_as() routine).  The existing session will remain
  *    open for further editing.
  *
+ * The gnc_file_save_in_background() routine saves as gnc_file_save()
+ *    does, but lets the backend finish writing the file in a background
+ *    thread where it can. Autosave uses it, so as not to hold up the
+ *    user for the whole save.
+ *
  * The gnc_file_save_as() routine will prompt the user for a filename
  *    to save the account data to (using the standard GUI file dialogue
  *    box).  If the user specifies a filename, the account data will be
@@ -130,6 +135,7 @@ void gnc_file_new (void);
 gboolean gnc_file_open (void);
 void gnc_file_export(void);
 void gnc_file_save (void);
+void gnc_file_save_in_background (void);
 void gnc_file_save_as (void);
 void gnc_file_do_export(const char* filename);
 void gnc_file_do_save_as(const char* filename);
@@ -169,6 +169,7 @@ static void gnc_main_window_cmd_help_about (GtkAction *action, GncMainWindow *wi
 static void do_popup_menu(GncPluginPage *page, GdkEventButton *event);
 static gboolean gnc_main_window_popup_menu_cb (GtkWidget *widget, GncPluginPage *page);
 static GtkWidget *gnc_main_window_get_statusbar (GncWindow *window_in);
+static void gnc_main_window_progress_cancel_cb (GtkButton *button, gpointer user_data);
 static void statusbar_notification_lastmodified(void);
 
 #ifdef MAC_INTEGRATION
@@ -201,6 +202,9 @@ typedef struct GncMainWindowPrivate
      *  window that is contained in the status bar.  This pointer
      *  provides easy access for updating the progressbar. */
     GtkWidget *progressbar;
+    /** The button next to the progress bar that cancels the operation
+     *  in progress.  Only shown when the operation can be cancelled. */
+    GtkWidget *progress_cancel_button;
     /** Pointer to the about dialog.  We need this so that we create
      *  only one, can attach to its activate-link signal, and can
      *  destroy it with the main window.
@@ -3545,6 +3549,15 @@ gnc_main_window_setup_window (GncMainWindow *window)
     gtk_progress_bar_set_pulse_step(GTK_PROGRESS_BAR(priv->progressbar),
                                     0.01);
 
+    priv->progress_cancel_button = gtk_button_new_from_stock (GTK_STOCK_CANCEL);
+    gtk_button_set_relief (GTK_BUTTON (priv->progress_cancel_button),
+                           GTK_RELIEF_NONE);
+    gtk_widget_set_no_show_all (priv->progress_cancel_button, TRUE);
+    gtk_box_pack_start (GTK_BOX (priv->statusbar),
+                        priv->progress_cancel_button, FALSE, TRUE, 0);
+    g_signal_connect (G_OBJECT (priv->progress_cancel_button), "clicked",
+                      G_CALLBACK (gnc_main_window_progress_cancel_cb), NULL);
+
     window->ui_merge = gtk_ui_manager_new ();
 
     /* Create menu and toolbar information */
@@ -4529,6 +4542,32 @@ gnc_main_window_get_progressbar (GncWindow *window_in)
 }
 
 
+/** Retrieve the button that cancels the operation whose progress is
+ *  shown in the progress bar of a main window object.  This function
+ *  is called via a vector off a generic window interface.
+ *
+ *  @param window_in A pointer to a generic window. */
+static GtkWidget *
+gnc_main_window_get_progress_cancel_button (GncWindow *window_in)
+{
+    GncMainWindowPrivate *priv;
+    GncMainWindow *window;
+
+    g_return_val_if_fail (GNC_IS_MAIN_WINDOW (window_in), NULL);
+
+    window = GNC_MAIN_WINDOW(window_in);
+    priv = GNC_MAIN_WINDOW_GET_PRIVATE(window);
+    return priv->progress_cancel_button;
+}
+
+
+static void
+gnc_main_window_progress_cancel_cb (GtkButton *button, gpointer user_data)
+{
+    gnc_window_cancel_progress ();
+}
+
+
 static void
 gnc_main_window_all_ui_set_sensitive (GncWindow *unused, gboolean sensitive)
 {
@@ -4570,6 +4609,7 @@ gnc_window_main_window_init (GncWindowIface *iface)
     iface->get_statusbar   = gnc_main_window_get_statusbar;
     iface->get_progressbar = gnc_main_window_get_progressbar;
     iface->ui_set_sensitive = gnc_main_window_all_ui_set_sensitive;
+    iface->get_progress_cancel_button = gnc_main_window_get_progress_cancel_button;
 }
 
 
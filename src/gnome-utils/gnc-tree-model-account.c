@@ -38,6 +38,7 @@
 #include "gnc-engine.h"
 #include "gnc-event.h"
 #include "gnc-gobject-utils.h"
+#include "gnc-pricedb.h"
 #include "gnc-ui-balances.h"
 #include "gnc-ui-util.h"
 
@@ -90,6 +91,62 @@ static void gnc_tree_model_account_event_handler (QofInstance *entity,
         GncTreeModelAccount *model,
         GncEventData *ed);
 
+/** The balances shown in the columns of the model.  Each color
+ *  column uses the sign of the balance of the same name. */
+typedef enum
+{
+    ACCOUNT_BALANCE_PRESENT,
+    ACCOUNT_BALANCE_PRESENT_REPORT,
+    ACCOUNT_BALANCE_BALANCE,
+    ACCOUNT_BALANCE_BALANCE_REPORT,
+    ACCOUNT_BALANCE_BALANCE_PERIOD,
+    ACCOUNT_BALANCE_CLEARED,
+    ACCOUNT_BALANCE_CLEARED_REPORT,
+    ACCOUNT_BALANCE_RECONCILED,
+    ACCOUNT_BALANCE_RECONCILED_REPORT,
+    ACCOUNT_BALANCE_FUTURE_MIN,
+    ACCOUNT_BALANCE_FUTURE_MIN_REPORT,
+    ACCOUNT_BALANCE_TOTAL,
+    ACCOUNT_BALANCE_TOTAL_REPORT,
+    ACCOUNT_BALANCE_TOTAL_PERIOD,
+    ACCOUNT_BALANCE_NUM
+} AccountBalance;
+
+/** How each balance is computed.  The period balances have no
+ *  function, they are computed by
+ *  gnc_tree_model_account_compute_period_balance(). */
+static const struct
+{
+    xaccGetBalanceInCurrencyFn fn;
+    gboolean recurse;
+    gboolean report;
+} account_balances[ACCOUNT_BALANCE_NUM] =
+{
+    { xaccAccountGetPresentBalanceInCurrency, TRUE, FALSE },
+    { xaccAccountGetPresentBalanceInCurrency, TRUE, TRUE },
+    { xaccAccountGetBalanceInCurrency, FALSE, FALSE },
+    { xaccAccountGetBalanceInCurrency, FALSE, TRUE },
+    { NULL, FALSE, FALSE },
+    { xaccAccountGetClearedBalanceInCurrency, TRUE, FALSE },
+    { xaccAccountGetClearedBalanceInCurrency, TRUE, TRUE },
+    { xaccAccountGetReconciledBalanceInCurrency, TRUE, FALSE },
+    { xaccAccountGetReconciledBalanceInCurrency, TRUE, TRUE },
+    { xaccAccountGetProjectedMinimumBalanceInCurrency, TRUE, FALSE },
+    { xaccAccountGetProjectedMinimumBalanceInCurrency, TRUE, TRUE },
+    { xaccAccountGetBalanceInCurrency, TRUE, FALSE },
+    { xaccAccountGetBalanceInCurrency, TRUE, TRUE },
+    { NULL, TRUE, FALSE },
+};
+
+/** The balances of one account as they have been asked for.  A NULL
+ *  string is one that hasn't been computed since the account or one
+ *  of its descendants last changed. */
+typedef struct
+{
+    gchar *string[ACCOUNT_BALANCE_NUM];
+    gboolean negative[ACCOUNT_BALANCE_NUM];
+} AccountBalanceCache;
+
 /** The instance private data for an account tree model. */
 typedef struct GncTreeModelAccountPrivate
 {
@@ -97,6 +154,12 @@ typedef struct GncTreeModelAccountPrivate
     Account *root;
     gint event_handler_id;
     const gchar *negative_color;
+    /* Account * -> AccountBalanceCache *.  GTK asks for a cell each
+     * time it is drawn, sorted or measured, and most balances sum
+     * every split of a subtree. */
+    GHashTable *balance_cache;
+    /* The present balances move on at midnight. */
+    time64 balance_cache_expires;
 } GncTreeModelAccountPrivate;
 
 #define GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(o)  \
@@ -126,6 +189,49 @@ gnc_tree_model_account_update_color (gpointer gsettings, gchar *key, gpointer us
     use_red = gnc_prefs_get_bool (GNC_PREFS_GROUP_GENERAL, GNC_PREF_NEGATIVE_IN_RED);
     priv->negative_color = use_red ? "red" : NULL;
 }
+
+static void
+account_balance_cache_free (gpointer data)
+{
+    AccountBalanceCache *cache = data;
+    gint i;
+
+    for (i = 0; i < ACCOUNT_BALANCE_NUM; i++)
+        g_free (cache->string[i]);
+    g_free (cache);
+}
+
+/** Forget the balances of account and of its ancestors, which
+ *  include it.
+ *
+ *  @internal
+ */
+static void
+gnc_tree_model_account_invalidate (GncTreeModelAccount *model,
+                                   Account *account)
+{
+    GncTreeModelAccountPrivate *priv;
+
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    for ( ; account; account = gnc_account_get_parent (account))
+        g_hash_table_remove (priv->balance_cache, account);
+}
+
+/** Forget every balance, for the preferences that change how all of
+ *  them are computed or printed.
+ *
+ *  @internal
+ */
+static void
+gnc_tree_model_account_invalidate_all (gpointer gsettings, gchar *key,
+                                       gpointer user_data)
+{
+    GncTreeModelAccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_TREE_MODEL_ACCOUNT(user_data));
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(user_data);
+    g_hash_table_remove_all (priv->balance_cache);
+}
 /************************************************************/
 /*               g_object required functions                */
 /************************************************************/
@@ -206,10 +312,19 @@ gnc_tree_model_account_init (GncTreeModelAccount *model)
     priv->book = NULL;
     priv->root = NULL;
     priv->negative_color = red ? "red" : NULL;
+    priv->balance_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                          NULL, account_balance_cache_free);
+    priv->balance_cache_expires = 0;
 
     gnc_prefs_register_cb(GNC_PREFS_GROUP_GENERAL, GNC_PREF_NEGATIVE_IN_RED,
                           gnc_tree_model_account_update_color,
                           model);
+    gnc_prefs_register_group_cb(GNC_PREFS_GROUP_GENERAL,
+                                gnc_tree_model_account_invalidate_all,
+                                model);
+    gnc_prefs_register_group_cb(GNC_PREFS_GROUP_ACCT_SUMMARY,
+                                gnc_tree_model_account_invalidate_all,
+                                model);
 
     LEAVE(" ");
 }
@@ -229,6 +344,7 @@ gnc_tree_model_account_finalize (GObject *object)
     priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
 
     priv->book = NULL;
+    g_hash_table_destroy (priv->balance_cache);
 
     if (G_OBJECT_CLASS (parent_class)->finalize)
         G_OBJECT_CLASS(parent_class)->finalize (object);
@@ -258,6 +374,12 @@ gnc_tree_model_account_dispose (GObject *object)
     gnc_prefs_remove_cb_by_func(GNC_PREFS_GROUP_GENERAL, GNC_PREF_NEGATIVE_IN_RED,
                                 gnc_tree_model_account_update_color,
                                 model);
+    gnc_prefs_remove_group_cb_by_func(GNC_PREFS_GROUP_GENERAL,
+                                      gnc_tree_model_account_invalidate_all,
+                                      model);
+    gnc_prefs_remove_group_cb_by_func(GNC_PREFS_GROUP_ACCT_SUMMARY,
+                                      gnc_tree_model_account_invalidate_all,
+                                      model);
 
     if (G_OBJECT_CLASS (parent_class)->dispose)
         G_OBJECT_CLASS (parent_class)->dispose (object);
@@ -598,6 +720,60 @@ gnc_tree_model_account_compute_period_balance(GncTreeModelAccount *model,
     return g_strdup(xaccPrintAmount(b3, gnc_account_print_info(acct, TRUE)));
 }
 
+/** Return one of the balances of acct, computing it only if it isn't
+ *  in the cache.  The string belongs to the cache.
+ *
+ *  @internal
+ */
+static const gchar *
+gnc_tree_model_account_get_balance (GncTreeModelAccount *model,
+                                    Account *acct,
+                                    AccountBalance which,
+                                    gboolean *negative)
+{
+    GncTreeModelAccountPrivate *priv;
+    AccountBalanceCache *cache;
+    time64 now;
+
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    now = gnc_time (NULL);
+    if (now > priv->balance_cache_expires)
+    {
+        g_hash_table_remove_all (priv->balance_cache);
+        priv->balance_cache_expires = gnc_time64_get_today_end ();
+    }
+
+    cache = g_hash_table_lookup (priv->balance_cache, acct);
+    if (!cache)
+    {
+        cache = g_new0 (AccountBalanceCache, 1);
+        g_hash_table_insert (priv->balance_cache, acct, cache);
+    }
+
+    if (!cache->string[which])
+    {
+        if (account_balances[which].fn == NULL)
+            cache->string[which] =
+                gnc_tree_model_account_compute_period_balance
+                (model, acct, account_balances[which].recurse,
+                 &cache->negative[which]);
+        else if (account_balances[which].report)
+            cache->string[which] =
+                gnc_ui_account_get_print_report_balance
+                (account_balances[which].fn, acct,
+                 account_balances[which].recurse, &cache->negative[which]);
+        else
+            cache->string[which] =
+                gnc_ui_account_get_print_balance
+                (account_balances[which].fn, acct,
+                 account_balances[which].recurse, &cache->negative[which]);
+    }
+
+    if (negative)
+        *negative = cache->negative[which];
+    return cache->string[which];
+}
+
 static void
 gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
                                   GtkTreeIter *iter,
@@ -608,7 +784,6 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
     GncTreeModelAccountPrivate *priv;
     Account *account;
     gboolean negative; /* used to set "deficit style" also known as red numbers */
-    gchar *string;
     time64 last_date;
 
     g_return_if_fail (GNC_IS_TREE_MODEL_ACCOUNT (model));
@@ -652,86 +827,71 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
 
     case GNC_TREE_MODEL_ACCOUNT_COL_PRESENT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_PRESENT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_PRESENT_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_PRESENT_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_PRESENT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetPresentBalanceInCurrency,
-                 account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_PRESENT, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free(string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_BALANCE:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, FALSE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_BALANCE, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_BALANCE_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetBalanceInCurrency,
-                 account, FALSE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_BALANCE_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_BALANCE:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, FALSE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_BALANCE, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free(string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_BALANCE_PERIOD:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_tree_model_account_compute_period_balance(model, account, FALSE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_BALANCE_PERIOD, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_BALANCE_PERIOD:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_tree_model_account_compute_period_balance(model, account, FALSE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_BALANCE_PERIOD, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_CLEARED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_CLEARED, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_CLEARED_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_CLEARED_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_CLEARED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetClearedBalanceInCurrency,
-                 account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_CLEARED, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free(string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_RECONCILED, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_RECONCILED_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_RECONCILED_DATE:
         g_value_init (value, G_TYPE_STRING);
@@ -743,61 +903,50 @@ gnc_tree_model_account_get_value (GtkTreeModel *tree_model,
 
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_RECONCILED:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetReconciledBalanceInCurrency,
-                 account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_RECONCILED, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_FUTURE_MIN:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_FUTURE_MIN_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_FUTURE_MIN:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetProjectedMinimumBalanceInCurrency,
-                 account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_FUTURE_MIN, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_TOTAL:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_TOTAL, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_TOTAL_REPORT:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_report_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_TOTAL_REPORT, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_TOTAL:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_ui_account_get_print_balance(xaccAccountGetBalanceInCurrency,
-                 account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_TOTAL, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free (string);
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_TOTAL_PERIOD:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_tree_model_account_compute_period_balance(model, account, TRUE, &negative);
-        g_value_take_string (value, string);
+        g_value_set_string (value,
+                            gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_TOTAL_PERIOD, NULL));
         break;
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_TOTAL_PERIOD:
         g_value_init (value, G_TYPE_STRING);
-        string = gnc_tree_model_account_compute_period_balance(model, account, TRUE, &negative);
+        gnc_tree_model_account_get_balance(model, account, ACCOUNT_BALANCE_TOTAL_PERIOD, &negative);
         gnc_tree_model_account_set_color(model, negative, value);
-        g_free (string);
         break;
 
     case GNC_TREE_MODEL_ACCOUNT_COL_COLOR_ACCOUNT:
@@ -1301,14 +1450,24 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
     Account *account, *parent;
 
     g_return_if_fail(model);	/* Required */
+    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
+    /* The balances in other currencies use the prices. */
+    if (GNC_IS_PRICE(entity))
+    {
+        g_hash_table_remove_all (priv->balance_cache);
+        return;
+    }
     if (!GNC_IS_ACCOUNT(entity))
         return;
 
     ENTER("entity %p of type %d, model %p, event_data %p",
           entity, event_type, model, ed);
-    priv = GNC_TREE_MODEL_ACCOUNT_GET_PRIVATE(model);
 
     account = GNC_ACCOUNT(entity);
+    /* A destroyed account may have left the tree already, and its
+     * address may be reused. */
+    if (event_type == QOF_EVENT_DESTROY)
+        g_hash_table_remove (priv->balance_cache, account);
     if (gnc_account_get_book(account) != priv->book)
     {
         LEAVE("not in this book");
@@ -1332,6 +1491,7 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
             break;
         }
         increment_stamp(model);
+        gnc_tree_model_account_invalidate(model, account);
         if (!gnc_tree_model_account_get_iter(GTK_TREE_MODEL(model), &iter, path))
         {
             DEBUG("can't generate iter");
@@ -1347,6 +1507,8 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
         parent = ed->node ? GNC_ACCOUNT(ed->node) : priv->root;
         parent_name = ed->node ? xaccAccountGetName(parent) : "Root";
         DEBUG("remove child %d of account %p (%s)", ed->idx, parent, parent_name);
+        g_hash_table_remove (priv->balance_cache, account);
+        gnc_tree_model_account_invalidate(model, parent);
         path = gnc_tree_model_account_get_path_from_account(model, parent);
         if (!path)
         {
@@ -1360,7 +1522,12 @@ gnc_tree_model_account_event_handler (QofInstance *entity,
         break;
 
     case QOF_EVENT_MODIFY:
+    case GNC_EVENT_ITEM_ADDED:
+    case GNC_EVENT_ITEM_REMOVED:
+    case GNC_EVENT_ITEM_CHANGED:
+        /* The splits of an account only send the item events. */
         DEBUG("modify  account %p (%s)", account, xaccAccountGetName(account));
+        gnc_tree_model_account_invalidate(model, account);
         path = gnc_tree_model_account_get_path_from_account(model, account);
         if (!path)
         {
@@ -101,9 +101,11 @@ struct GncTreeModelSplitRegPrivate
     QofBook *book;                   // GNC Book
     Account *anchor;                 // Account of register
 
-    GList *full_tlist;               // List of unique transactions derived from the query slist in same order
+    GPtrArray  *full_tlist;          // Array of unique transactions derived from the query slist in same order
+    GHashTable *full_tlist_index;    // Transaction * -> its position in full_tlist + 1
     GList *tlist;                    // List of unique transactions derived from the full_tlist to display in same order
     gint   tlist_start;              // The position of the first transaction in tlist in the full_tlist
+    GHashTable *tlist_keys;          // tlist node -> its position + 1, the sort keys, NULL when tlist changes
 
     Transaction *btrans;             // The Blank transaction
 
@@ -388,6 +390,31 @@ gnc_tree_model_split_reg_init (GncTreeModelSplitReg *model)
 }
 
 
+/* Forget the sort keys after a change to the tlist */
+static void
+gtm_sr_tlist_changed (GncTreeModelSplitReg *model)
+{
+    if (model->priv->tlist_keys)
+        g_hash_table_destroy (model->priv->tlist_keys);
+    model->priv->tlist_keys = NULL;
+}
+
+
+/* Free the full_tlist and its index */
+static void
+gtm_sr_free_full_tlist (GncTreeModelSplitReg *model)
+{
+    GncTreeModelSplitRegPrivate *priv = model->priv;
+
+    if (priv->full_tlist)
+        g_ptr_array_free (priv->full_tlist, TRUE);
+    priv->full_tlist = NULL;
+    if (priv->full_tlist_index)
+        g_hash_table_destroy (priv->full_tlist_index);
+    priv->full_tlist_index = NULL;
+}
+
+
 static void
 gnc_tree_model_split_reg_finalize (GObject *object)
 {
@@ -431,8 +458,8 @@ gnc_tree_model_split_reg_dispose (GObject *object)
     priv->tlist = NULL;
 
     /* Free the full_tlist */
-    g_list_free (priv->full_tlist);
-    priv->full_tlist = NULL;
+    gtm_sr_free_full_tlist (model);
+    gtm_sr_tlist_changed (model);
 
     /* Free the blank split */
     priv->bsplit = NULL;
@@ -552,61 +579,50 @@ gtm_sr_remove_all_rows (GncTreeModelSplitReg *model)
     g_list_free (rr_list);
 }
 
+/* Make the tlist the slice of num_of_rows transactions of the
+   full_tlist starting at priv->tlist_start. */
+static void
+gtm_sr_reg_load_slice (GncTreeModelSplitReg *model, gint num_of_rows)
+{
+    GncTreeModelSplitRegPrivate *priv;
+    gint i, end;
+
+    priv = model->priv;
+
+    priv->tlist_start = CLAMP (priv->tlist_start, 0, (gint) priv->full_tlist->len);
+    end = MIN (priv->tlist_start + num_of_rows, (gint) priv->full_tlist->len);
+
+    /* Build it from the end, so each transaction is added in constant time */
+    for (i = end - 1; i >= priv->tlist_start; i--)
+        priv->tlist = g_list_prepend (priv->tlist, g_ptr_array_index (priv->full_tlist, i));
+
+    gtm_sr_tlist_changed (model);
+}
+
+
 static void
 gtm_sr_reg_load (GncTreeModelSplitReg *model, GncTreeModelSplitRegUpdate model_update, gint num_of_rows)
 {
     GncTreeModelSplitRegPrivate *priv;
-    GList *node;
-    gint rows = 0;
 
     priv = model->priv;
 
     if (model_update == VIEW_HOME)
     {
         priv->tlist_start = 0;
-
-        for (node = g_list_nth (priv->full_tlist, priv->tlist_start); node; node = node->next)
-        {
-            Transaction *trans = node->data;
-
-            priv->tlist = g_list_append (priv->tlist, trans);
-            rows++;
-
-            if (rows == num_of_rows)
-                break;
-        } 
+        gtm_sr_reg_load_slice (model, num_of_rows);
     }
-    
+
     if (model_update == VIEW_END)
     {
-        priv->tlist_start = g_list_length (priv->full_tlist) - num_of_rows;
-
-        for (node = g_list_nth (priv->full_tlist, priv->tlist_start); node; node = node->next)
-        {
-            Transaction *trans = node->data;
-
-            priv->tlist = g_list_append (priv->tlist, trans);
-            rows++;
-
-            if (rows == num_of_rows)
-                break;
-        } 
+        priv->tlist_start = priv->full_tlist->len - num_of_rows;
+        gtm_sr_reg_load_slice (model, num_of_rows);
     }
 
     if (model_update == VIEW_GOTO)
     {
         priv->tlist_start = num_of_rows - NUM_OF_TRANS*1.5;
-
-        for (node = g_list_nth (priv->full_tlist, priv->tlist_start); node; node = node->next)
-        {
-            Transaction *trans = node->data;
-
-            priv->tlist = g_list_append (priv->tlist, trans);
-            rows++;
-
-            if (rows == (NUM_OF_TRANS*3))
-                break;
-        } 
+        gtm_sr_reg_load_slice (model, NUM_OF_TRANS*3);
     }
 }
 
@@ -616,8 +632,8 @@ void
 gnc_tree_model_split_reg_load (GncTreeModelSplitReg *model, GList *slist, Account *default_account)
 {
     GncTreeModelSplitRegPrivate *priv;
-    GList *node;
-    gint rows = 0;
+    GList *tlist, *node;
+    guint i;
 
     ENTER("#### Load ModelSplitReg = %p and slist length is %d ####", model, g_list_length (slist));
 
@@ -625,54 +641,65 @@ gnc_tree_model_split_reg_load (GncTreeModelSplitReg *model, GList *slist, Accoun
 
     /* Clear the treeview */
     gtm_sr_remove_all_rows (model);
-    priv->full_tlist = NULL;
+    gtm_sr_free_full_tlist (model);
+    g_list_free (priv->tlist);
     priv->tlist = NULL;
+    priv->tlist_start = 0;
 
     if (model->current_trans == NULL)
         model->current_trans = priv->btrans;
 
+    /* Get a list of Unique Transactions from an slist */
+    tlist = xaccSplitListGetUniqueTransactions (slist);
+    priv->full_tlist = g_ptr_array_sized_new (g_list_length (tlist) + 1);
+
     if (model->sort_direction == GTK_SORT_ASCENDING)
     {
-        /* Get a list of Unique Transactions from an slist */
-        priv->full_tlist = xaccSplitListGetUniqueTransactions (slist);
+        for (node = tlist; node; node = node->next)
+            g_ptr_array_add (priv->full_tlist, node->data);
 
         /* Add the blank transaction to the full_tlist */
-        priv->full_tlist = g_list_append (priv->full_tlist, priv->btrans);
+        g_ptr_array_add (priv->full_tlist, priv->btrans);
     }
     else
     {
-        /* Get a list of Unique Transactions from an slist */
-        priv->full_tlist = xaccSplitListGetUniqueTransactions (slist);
-
-        /* Add the blank transaction to the full_tlist */
-        priv->full_tlist = g_list_append (priv->full_tlist, priv->btrans);
+        /* Add the blank transaction and the rest in reverse */
+        g_ptr_array_add (priv->full_tlist, priv->btrans);
 
-        /* Reverse the full_tlist */
-        priv->full_tlist = g_list_reverse (priv->full_tlist);
+        for (node = g_list_last (tlist); node; node = node->prev)
+            g_ptr_array_add (priv->full_tlist, node->data);
     }
+    g_list_free (tlist);
+
+    /* Index the positions for the scrollbar, keeping the first of any duplicates */
+    priv->full_tlist_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = priv->full_tlist->len; i > 0; i--)
+        g_hash_table_insert (priv->full_tlist_index,
+                             g_ptr_array_index (priv->full_tlist, i - 1),
+                             GUINT_TO_POINTER (i));
 
     // Update the scrollbar
     gnc_tree_model_split_reg_sync_scrollbar (model);
 
-    model->number_of_trans_in_full_tlist = g_list_length (priv->full_tlist);
+    model->number_of_trans_in_full_tlist = priv->full_tlist->len;
 
-    if (g_list_length (priv->full_tlist) < NUM_OF_TRANS*3)
+    if (priv->full_tlist->len < NUM_OF_TRANS*3)
     {
         // Copy the full_tlist to tlist
-        priv->tlist = g_list_copy (priv->full_tlist);
+        gtm_sr_reg_load_slice (model, priv->full_tlist->len);
     }
     else
     {
         if (model->position_of_trans_in_full_tlist < (NUM_OF_TRANS*3))
             gtm_sr_reg_load (model, VIEW_HOME, NUM_OF_TRANS*3);
-        else if (model->position_of_trans_in_full_tlist > g_list_length (priv->full_tlist) - (NUM_OF_TRANS*3))
+        else if (model->position_of_trans_in_full_tlist > priv->full_tlist->len - (NUM_OF_TRANS*3))
             gtm_sr_reg_load (model, VIEW_END, NUM_OF_TRANS*3);
         else
             gtm_sr_reg_load (model, VIEW_GOTO, model->position_of_trans_in_full_tlist);
     }
 
     PINFO("#### Register for Account '%s' has %d transactions and %d splits and tlist is %d ####",
-          default_account ? xaccAccountGetName (default_account) : "NULL", g_list_length (priv->full_tlist), g_list_length (slist), g_list_length (priv->tlist));
+          default_account ? xaccAccountGetName (default_account) : "NULL", priv->full_tlist->len, g_list_length (slist), g_list_length (priv->tlist));
 
     /* Update the completion model liststores */
     g_idle_add ((GSourceFunc) gnc_tree_model_split_reg_update_completion, model);
@@ -688,17 +715,19 @@ void
 gnc_tree_model_split_reg_move (GncTreeModelSplitReg *model, GncTreeModelSplitRegUpdate model_update)
 {
     GncTreeModelSplitRegPrivate *priv;
-    GList *inode, *dnode;
-    gint rows = 0;
+    gint i;
     gint icount = 0;
     gint dcount = 0;
+    gint len;
 
     priv = model->priv;
 
     // if list is not long enougth, return
-    if (g_list_length (priv->full_tlist) < NUM_OF_TRANS*3)
+    if (!priv->full_tlist || priv->full_tlist->len < NUM_OF_TRANS*3)
         return;
 
+    len = priv->full_tlist->len;
+
     if ((model_update == VIEW_UP) && (model->current_row < NUM_OF_TRANS) && (priv->tlist_start > 0))
     {
         gint dblock_end = 0;
@@ -717,34 +746,20 @@ gnc_tree_model_split_reg_move (GncTreeModelSplitReg *model, GncTreeModelSplitReg
         priv->tlist_start = iblock_start;
 
         // Insert at the front end
-        for (inode = g_list_nth (priv->full_tlist, iblock_end); inode; inode = inode->prev)
-        {
-            Transaction *trans = inode->data;
-
-            gtm_sr_insert_trans (model, trans, TRUE);
+        for (i = iblock_end; i >= iblock_start; i--)
+            gtm_sr_insert_trans (model, g_ptr_array_index (priv->full_tlist, i), TRUE);
 
-            rows++;
-
-            if (rows == icount)
-                break;
-        }
-        rows = 0;
         // Delete at the back end
-        for (dnode = g_list_nth (priv->full_tlist, dblock_end); dnode; dnode = dnode->prev)
+        if (dblock_end < len)
         {
-            Transaction *trans = dnode->data;
-
-            gtm_sr_delete_trans (model, trans);
-
-            rows++;
-
-            if (rows == dcount)
-                break;
+            for (i = dblock_end; i >= dblock_start; i--)
+                gtm_sr_delete_trans (model, g_ptr_array_index (priv->full_tlist, i));
         }
+
         g_signal_emit_by_name (model, "refresh_view");
     }
 
-    if ((model_update == VIEW_DOWN) && (model->current_row > NUM_OF_TRANS*2) && (priv->tlist_start < (g_list_length (priv->full_tlist) - NUM_OF_TRANS*3 )))
+    if ((model_update == VIEW_DOWN) && (model->current_row > NUM_OF_TRANS*2) && (priv->tlist_start < (len - NUM_OF_TRANS*3 )))
     {
         gint dblock_end = 0;
         gint iblock_start = priv->tlist_start + NUM_OF_TRANS*3;
@@ -754,8 +769,8 @@ gnc_tree_model_split_reg_move (GncTreeModelSplitReg *model, GncTreeModelSplitReg
         if (iblock_start < 0)
             iblock_start = 0;
 
-        if (iblock_end > g_list_length (priv->full_tlist))
-            iblock_end = g_list_length (priv->full_tlist) - 1;
+        if (iblock_end > len)
+            iblock_end = len - 1;
 
         icount = iblock_end - iblock_start + 1;
 
@@ -765,30 +780,13 @@ gnc_tree_model_split_reg_move (GncTreeModelSplitReg *model, GncTreeModelSplitReg
         priv->tlist_start = dblock_end;
 
         // Insert at the back end
-        for (inode = g_list_nth (priv->full_tlist, iblock_start); inode; inode = inode->next)
-        {
-            Transaction *trans = inode->data;
-
-            gtm_sr_insert_trans (model, trans, FALSE);
-
-            rows++;
+        for (i = iblock_start; i < iblock_start + icount && i < len; i++)
+            gtm_sr_insert_trans (model, g_ptr_array_index (priv->full_tlist, i), FALSE);
 
-            if (rows == icount)
-                break;
-        }
-        rows = 0;
         // Delete at the front end
-        for (dnode = g_list_nth (priv->full_tlist, dblock_start); dnode; dnode = dnode->next)
-        {
-            Transaction *trans = dnode->data;
-
-            gtm_sr_delete_trans (model, trans);
+        for (i = dblock_start; i < dblock_start + dcount && i < len; i++)
+            gtm_sr_delete_trans (model, g_ptr_array_index (priv->full_tlist, i));
 
-            rows++;
-
-            if (rows == dcount)
-                break;
-        }
         g_signal_emit_by_name (model, "refresh_view");
     }
 }
@@ -799,20 +797,15 @@ Transaction *
 gnc_tree_model_split_reg_get_first_trans (GncTreeModelSplitReg *model)
 {
     GncTreeModelSplitRegPrivate *priv;
-    GList *node;
     Transaction *trans;
 
     priv = model->priv;
 
-    node = g_list_first (priv->full_tlist);
-
-    trans = node->data;
+    trans = g_ptr_array_index (priv->full_tlist, 0);
 
     if (trans == priv->btrans)
-    {
-        node = g_list_last (priv->full_tlist);
-        trans = node->data;
-    }
+        trans = g_ptr_array_index (priv->full_tlist, priv->full_tlist->len - 1);
+
     return trans;
 }
 
@@ -841,16 +834,14 @@ gnc_tree_model_split_reg_get_tooltip (GncTreeModelSplitReg *model, gint position
     const gchar *date_text;
     const gchar *desc_text;
     Timespec ts = {0,0};
-    GList *node;
 
     priv = model->priv;
 
-    node = g_list_nth (priv->full_tlist, position);
-    if (node == NULL)
+    if (!priv->full_tlist || position < 0 || position >= priv->full_tlist->len)
        return g_strconcat ("Error", NULL);
     else
     {
-        trans = node->data;
+        trans = g_ptr_array_index (priv->full_tlist, position);
         if (trans == NULL)
            return g_strconcat ("Error", NULL);
         else if (trans == priv->btrans)
@@ -872,15 +863,13 @@ void
 gnc_tree_model_split_reg_set_current_trans_by_position (GncTreeModelSplitReg *model, gint position)
 {
     GncTreeModelSplitRegPrivate *priv;
-    GList *node;
 
     priv = model->priv;
 
-    node = g_list_nth (priv->full_tlist, position);
-    if (node == NULL)
-        node = g_list_last (priv->full_tlist);
+    if (position < 0 || position >= priv->full_tlist->len)
+        position = priv->full_tlist->len - 1;
 
-    model->current_trans = node->data;
+    model->current_trans = g_ptr_array_index (priv->full_tlist, position);
 }
 
 
@@ -892,7 +881,10 @@ gnc_tree_model_split_reg_sync_scrollbar (GncTreeModelSplitReg *model)
 
     priv = model->priv;
 
-    model->position_of_trans_in_full_tlist = g_list_index (priv->full_tlist, model->current_trans);
+    if (priv->full_tlist_index)
+        model->position_of_trans_in_full_tlist = GPOINTER_TO_UINT (g_hash_table_lookup (priv->full_tlist_index, model->current_trans)) - 1;
+    else
+        model->position_of_trans_in_full_tlist = -1;
 
     g_signal_emit_by_name (model, "scroll_sync");
 }
@@ -2265,6 +2257,37 @@ gnc_tree_model_split_get_blank_trans (GncTreeModelSplitReg *model)
 }
 
 
+/* The sort key of an iter, its position in the tlist and the
+   position of its split in the transaction, which is what its path
+   holds. The tlist positions are computed once for each change of
+   the tlist, rather than walking it for each comparison. */
+static void
+gtm_sr_sort_key (GncTreeModelSplitReg *model, GtkTreeIter *iter, gint *tpos, gint *spos)
+{
+    GncTreeModelSplitRegPrivate *priv = model->priv;
+    GList *tnode = iter->user_data2;
+    GList *snode = iter->user_data3;
+
+    if (!priv->tlist_keys)
+    {
+        GList *node;
+        gint i = 0;
+
+        priv->tlist_keys = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (node = priv->tlist; node; node = node->next)
+            g_hash_table_insert (priv->tlist_keys, node, GINT_TO_POINTER (++i));
+    }
+    *tpos = GPOINTER_TO_INT (g_hash_table_lookup (priv->tlist_keys, tnode)) - 1;
+
+    if (!IS_SPLIT (iter))
+        *spos = IS_TROW2 (iter) ? 0 : -1;
+    else if ((tnode == priv->bsplit_parent_node) && (IS_BLANK (iter)))
+        *spos = xaccTransCountSplits (tnode->data);
+    else
+        *spos = xaccTransGetSplitIndex (tnode->data, snode->data);
+}
+
+
 /* Dummy Sort function */
 gint
 gnc_tree_model_split_reg_sort_iter_compare_func (GtkTreeModel *tm,
@@ -2273,15 +2296,23 @@ gnc_tree_model_split_reg_sort_iter_compare_func (GtkTreeModel *tm,
                           gpointer      user_data)
 {
     GncTreeModelSplitReg *model = GNC_TREE_MODEL_SPLIT_REG (tm);
+    gint tpos_a, spos_a, tpos_b, spos_b, result;
 
     /* This is really a dummy sort function, it leaves the list as is. */
+    gtm_sr_sort_key (model, a, &tpos_a, &spos_a);
+    gtm_sr_sort_key (model, b, &tpos_b, &spos_b);
+
+    if (tpos_a != tpos_b)
+        result = tpos_a < tpos_b ? -1 : 1;
+    else if (spos_a != spos_b)
+        result = spos_a < spos_b ? -1 : 1;
+    else
+        result = 0;
 
     if (model->sort_direction == GTK_SORT_ASCENDING)
-        return gtk_tree_path_compare (gnc_tree_model_split_reg_get_path (tm, a),
-                                      gnc_tree_model_split_reg_get_path (tm, b));
+        return result;
     else
-        return gtk_tree_path_compare (gnc_tree_model_split_reg_get_path (tm, b),
-                                      gnc_tree_model_split_reg_get_path (tm, a));
+        return -result;
 }
 
 /*##########################################################################*/
@@ -2434,10 +2465,16 @@ gtm_sr_insert_trans (GncTreeModelSplitReg *model, Transaction *trans, gboolean b
 
     ENTER("insert transaction %p into model %p", trans, model);
     if (before == TRUE)
+    {
         model->priv->tlist = g_list_prepend (model->priv->tlist, trans);
+        tnode = model->priv->tlist;
+    }
     else
+    {
         model->priv->tlist = g_list_append (model->priv->tlist, trans);
-    tnode = g_list_find (model->priv->tlist, trans);
+        tnode = g_list_last (model->priv->tlist);
+    }
+    gtm_sr_tlist_changed (model);
 
     iter = gtm_sr_make_iter (model, TROW1, tnode, NULL);
     gtm_sr_insert_row_at (model, &iter);
@@ -2505,6 +2542,7 @@ gtm_sr_delete_trans (GncTreeModelSplitReg *model, Transaction *trans)
     gtm_sr_delete_row_at (model, &iter);
 
     model->priv->tlist = g_list_delete_link (model->priv->tlist, tnode);
+    gtm_sr_tlist_changed (model);
     LEAVE(" ");
 }
 
@@ -3237,6 +3275,7 @@ gnc_tree_model_split_reg_event_handler (QofInstance *entity,
             {
                 priv->btrans = xaccMallocTransaction (priv->book);
                 priv->tlist = g_list_append (priv->tlist, priv->btrans);
+                gtm_sr_tlist_changed (model);
 
                 tnode = g_list_find (priv->tlist, priv->btrans);
                 /* Insert a new blank trans */
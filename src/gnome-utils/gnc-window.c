@@ -100,6 +100,18 @@ gnc_window_get_progressbar (GncWindow *window)
     return GNC_WINDOW_GET_IFACE (window)->get_progressbar (window);
 }
 
+static GtkWidget *
+gnc_window_get_progress_cancel_button (GncWindow *window)
+{
+    g_return_val_if_fail(GNC_WINDOW (window), NULL);
+
+    /* optional */
+    if (GNC_WINDOW_GET_IFACE (window)->get_progress_cancel_button == NULL)
+        return NULL;
+
+    return GNC_WINDOW_GET_IFACE (window)->get_progress_cancel_button (window);
+}
+
 /************************************************************
  *              Auxiliary status bar functions              *
  ************************************************************/
@@ -161,12 +173,31 @@ gnc_window_get_progressbar_window (void)
     return progress_bar_hack_window;
 }
 
+static GncWindowProgressCancelFunc progress_cancel_func = NULL;
+static gpointer progress_cancel_data = NULL;
+
+void
+gnc_window_set_progress_cancel_func (GncWindowProgressCancelFunc func,
+                                     gpointer user_data)
+{
+    progress_cancel_func = func;
+    progress_cancel_data = user_data;
+}
+
+
+void
+gnc_window_cancel_progress (void)
+{
+    if (progress_cancel_func)
+        progress_cancel_func (progress_cancel_data);
+}
+
 
 void
 gnc_window_show_progress (const char *message, double percentage)
 {
     GncWindow *window;
-    GtkWidget *progressbar;
+    GtkWidget *progressbar, *cancel_button;
 
     window = progress_bar_hack_window;
     if (window == NULL)
@@ -181,6 +212,17 @@ gnc_window_show_progress (const char *message, double percentage)
 
     gnc_update_splash_screen(message, percentage);
 
+    /* The window is insensitive while progress is shown, only this
+     * button stays usable. */
+    cancel_button = gnc_window_get_progress_cancel_button (window);
+    if (cancel_button)
+    {
+        if (percentage < 0 || progress_cancel_func == NULL)
+            gtk_widget_hide (cancel_button);
+        else
+            gtk_widget_show (cancel_button);
+    }
+
     if (percentage < 0)
     {
         gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progressbar), " ");
@@ -64,8 +64,11 @@ typedef struct
     GtkWidget * (* get_statusbar) (GncWindow *window);
     GtkWidget * (* get_progressbar) (GncWindow *window);
     void (* ui_set_sensitive) (GncWindow *window, gboolean sensitive);
+    GtkWidget * (* get_progress_cancel_button) (GncWindow *window);
 } GncWindowIface;
 
+typedef void (* GncWindowProgressCancelFunc) (gpointer user_data);
+
 /* function prototypes */
 GType          gnc_window_get_type (void);
 
@@ -77,6 +80,11 @@ void           gnc_window_set_status (GncWindow *window, GncPluginPage *page, co
 void           gnc_window_set_progressbar_window (GncWindow *window);
 GncWindow     *gnc_window_get_progressbar_window (void);
 void           gnc_window_show_progress (const char *message, double percentage);
+/** Offer a cancel button next to the progress bar while progress is
+ *  shown.  Clicking it calls func; pass NULL to remove the button.*/
+void           gnc_window_set_progress_cancel_func (GncWindowProgressCancelFunc func,
+        gpointer user_data);
+void           gnc_window_cancel_progress (void);
 
 G_END_DECLS
 
@@ -411,7 +411,7 @@ category_checkbox_toggled (GtkCellRendererToggle *toggle,
 static void
 account_categories_tree_view_prepare (hierarchy_data  *data)
 {
-    GSList *list;
+    const GSList *list;
     gchar *gnc_accounts_dir;
     gchar *locale_dir;
     GtkTreeView *tree_view;
@@ -423,7 +423,9 @@ account_categories_tree_view_prepare (hierarchy_data  *data)
 
     gnc_accounts_dir = gnc_path_get_accountsdir ();
     locale_dir = gnc_get_ea_locale_dir (gnc_accounts_dir);
-    list = gnc_load_example_account_list (locale_dir);
+    /* Only the descriptions are read here; a template's accounts are
+     * read when it is selected or merged. */
+    list = gnc_get_example_account_index (locale_dir);
     g_free (gnc_accounts_dir);
     g_free (locale_dir);
 
@@ -434,7 +436,7 @@ account_categories_tree_view_prepare (hierarchy_data  *data)
     gtk_tree_view_set_model (tree_view, GTK_TREE_MODEL(model));
     g_object_unref (model);
 
-    g_slist_foreach(list, (GFunc)add_one_category, data);
+    g_slist_foreach((GSList *)list, (GFunc)add_one_category, data);
 
     g_signal_connect (G_OBJECT (model), "row_changed",
                       G_CALLBACK (categories_selection_changed),
@@ -555,6 +557,9 @@ categories_tree_selection_changed (GtkTreeSelection *selection,
                                  gea->long_description :
                                  _("No description provided."), -1);
 
+        if (!gnc_example_account_load_accounts (gea))
+            return;
+
         tree_view = gnc_tree_view_account_new_with_root (gea->root, FALSE);
         /* Override the normal fixed (user settable) sizing */
         column = gtk_tree_view_get_column(GTK_TREE_VIEW(tree_view), 0);
@@ -647,22 +652,47 @@ struct add_group_data_struct
     Account *to;
     Account *parent;
     gnc_commodity *com;
+    GHashTable *maps;   /* Account* -> gnc_account_merge_child_map */
 };
 
+static GHashTable *
+get_child_map (GHashTable *maps, Account *parent)
+{
+    GHashTable *map = g_hash_table_lookup (maps, parent);
+
+    if (!map)
+    {
+        map = gnc_account_merge_child_map (parent);
+        g_hash_table_insert (maps, parent, map);
+    }
+    return map;
+}
+
 static void
 add_groups_for_each (Account *toadd, gpointer data)
 {
     struct add_group_data_struct *dadata = data;
     Account *foundact;
+    GHashTable *map = NULL;
 
-    foundact = gnc_account_lookup_by_name(dadata->to, xaccAccountGetName(toadd));
+    if (dadata->to)
+    {
+        map = get_child_map (dadata->maps, dadata->to);
+        foundact = gnc_account_merge_lookup (map, dadata->to,
+                                             xaccAccountGetName(toadd));
+    }
+    else
+        foundact = NULL;
 
     if (!foundact)
     {
         foundact = clone_account (toadd, dadata->com);
 
         if (dadata->to)
+        {
             gnc_account_append_child (dadata->to, foundact);
+            gnc_account_merge_child_map_add (map, foundact);
+        }
         else if (dadata->parent)
             gnc_account_append_child (dadata->parent, foundact);
         else
@@ -679,6 +709,7 @@ add_groups_for_each (Account *toadd, gpointer data)
             downdata.to = foundact;
             downdata.parent = foundact;
             downdata.com = dadata->com;
+            downdata.maps = dadata->maps;
 
             gnc_account_foreach_child (toadd, add_groups_for_each, &downdata);
         }
@@ -687,12 +718,13 @@ add_groups_for_each (Account *toadd, gpointer data)
 
 static void
 add_new_accounts_with_random_guids (Account *into, Account *from,
-                                    gnc_commodity *com)
+                                    gnc_commodity *com, GHashTable *maps)
 {
     struct add_group_data_struct data;
     data.to = into;
     data.parent = NULL;
     data.com = com;
+    data.maps = maps;
 
     gnc_account_foreach_child (from, add_groups_for_each, &data);
 }
@@ -702,13 +734,20 @@ hierarchy_merge_accounts (GSList *dalist, gnc_commodity *com)
 {
     GSList *mark;
     Account *ret = xaccMallocAccount (gnc_get_current_book ());
+    /* The children of every account merged into, by name, so that each
+     * template account is matched without searching the tree. */
+    GHashTable *maps = g_hash_table_new_full (NULL, NULL, NULL,
+                       (GDestroyNotify)g_hash_table_destroy);
 
     for (mark = dalist; mark; mark = mark->next)
     {
         GncExampleAccount *xea = mark->data;
 
-        add_new_accounts_with_random_guids (ret, xea->root, com);
+        if (!gnc_example_account_load_accounts (xea))
+            continue;
+        add_new_accounts_with_random_guids (ret, xea->root, com, maps);
     }
+    g_hash_table_destroy (maps);
 
     return ret;
 }
@@ -122,8 +122,8 @@ static void gbv_selection_changed_cb(
     GtkTreeSelection *selection, GncBudgetView *view);
 #endif
 static void gbv_treeview_resized_cb(GtkWidget* widget, GtkAllocation* allocation, GncBudgetView* view);
-static gnc_numeric gbv_get_accumulated_budget_amount(GncBudget* budget,
-        Account* account, guint period_num);
+static const gnc_numeric *gbv_get_account_amounts(GncBudgetViewPrivate *priv,
+        Account *account);
 
 /** \brief the private budget view structure
 
@@ -136,6 +136,9 @@ static gnc_numeric gbv_get_accumulated_budget_amount(GncBudget* budget,
         @param totals_col_list List of columns in the totals_tree_view
         @param total_col The totals column on the right of all the accounts.
         @param fd No idea what this does.
+        @param amounts The amounts shown for each account, see \ref gbv_get_account_amounts.
+        @param amounts_num_periods The number of periods in each array in amounts.
+        @param event_handler_id The handler that empties amounts when the budget or the account tree changes.
 */
 struct GncBudgetViewPrivate
 {
@@ -155,6 +158,10 @@ struct GncBudgetViewPrivate
     Account* assets;
     Account* liabilities;
     Account* rootAcct;
+
+    GHashTable *amounts;
+    guint amounts_num_periods;
+    gint event_handler_id;
 };
 
 #define GNC_BUDGET_VIEW_GET_PRIVATE(o)  \
@@ -206,6 +213,32 @@ gnc_budget_view_class_init(GncBudgetViewClass *klass)
 }
 
 
+/** \brief Forget the cached amounts when they may have changed.
+
+The amounts depend on the budget's values and on how the accounts nest, so the
+cache is emptied when the budget is modified or an account is created,
+destroyed or moved.
+*/
+static void
+gbv_event_handler(QofInstance *entity, QofEventId event_type,
+                  gpointer handler_data, gpointer event_data)
+{
+    GncBudgetView *view = GNC_BUDGET_VIEW(handler_data);
+    GncBudgetViewPrivate *priv = GNC_BUDGET_VIEW_GET_PRIVATE(view);
+
+    if (entity == QOF_INSTANCE(priv->budget))
+    {
+        if (event_type & QOF_EVENT_MODIFY)
+            g_hash_table_remove_all(priv->amounts);
+    }
+    else if (GNC_IS_ACCOUNT(entity))
+    {
+        if (event_type & (QOF_EVENT_CREATE | QOF_EVENT_DESTROY |
+                          QOF_EVENT_ADD | QOF_EVENT_REMOVE))
+            g_hash_table_remove_all(priv->amounts);
+    }
+}
+
 static void
 gnc_budget_view_init(GncBudgetView *budget_view)
 {
@@ -222,6 +255,10 @@ gnc_budget_view_init(GncBudgetView *budget_view)
     num_top_accounts = gnc_account_n_children(root);
     
     priv->rootAcct = root;
+    priv->amounts = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                          NULL, g_free);
+    priv->event_handler_id = qof_event_handler_register(gbv_event_handler,
+                             budget_view);
 
     for (i = 0; i < num_top_accounts; ++i)
     {
@@ -260,6 +297,10 @@ gnc_budget_view_finalize(GObject *object)
     view = GNC_BUDGET_VIEW(object);
     g_return_if_fail(GNC_IS_BUDGET_VIEW(view));
 
+    priv = GNC_BUDGET_VIEW_GET_PRIVATE(view);
+    qof_event_handler_unregister(priv->event_handler_id);
+    g_hash_table_destroy(priv->amounts);
+
     G_OBJECT_CLASS(gnc_budget_view_parent_class)->finalize(object);
     LEAVE(" ");
 }
@@ -688,67 +729,78 @@ gbv_selection_changed_cb(GtkTreeSelection *selection, GncBudgetView *view)
 }
 #endif
 
-/** \brief Structure to assist in calculating of sub account totals.
-
-This structure is utilised by the functions \ref budget_accum_helper and \ref gbv_get_accumulated_budget_amount to find the totals of sub-accounts in an account tree.
-@param total The running total of the account in question
-@param budget The gnc budget under examination.
-@param period_num The specific period_num that we are finding the totals for.
-*/
-typedef struct
-{
-    gnc_numeric total;
-    GncBudget* budget;
-    guint period_num;
-} BudgetAccumulationInfo;
-
-/** \brief Function to assist in the calculation of sub-account totals.
+/** \brief Function to find the amounts shown for an account.
 
-This function is used in conjunction with the function \ref gbv_get_accumulated_budget_amount to find the total of sub accounts. \ref gbv_get_accumulated_budget_amount passes this function to \ref gnc_account_foreach_child function in order to perform this operation. The latter method then calls \ref budget_accum_helper on all of the sub accounts of the main account passed in order to calculate the accumulated total.
+Returns an array holding the amount shown for the account in each period
+followed by the total for the account.  A period's amount is the budget value
+if one is set, else the sum of the children's amounts; the total leaves out
+values in error.  The arrays are computed once for each account and kept until
+\ref gbv_event_handler empties the cache, so drawing a cell only reads them.
 */
-static void
-budget_accum_helper(Account* account, gpointer data)
+static const gnc_numeric *
+gbv_get_account_amounts(GncBudgetViewPrivate *priv, Account *account)
 {
-    BudgetAccumulationInfo* info = (BudgetAccumulationInfo*)data;
-    gnc_numeric numeric;
-
-    if (gnc_budget_is_account_period_value_set(info->budget, account, info->period_num))
-    {
-        numeric = gnc_budget_get_account_period_value(info->budget, account, info->period_num);
-        info->total = gnc_numeric_add(info->total, numeric, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-    }
-    else if (gnc_account_n_children(account) != 0)
+    gnc_numeric *amounts;
+    const gnc_numeric **child_amounts;
+    GList *children, *node;
+    guint num_periods, num_children, period_num, i;
+
+    amounts = g_hash_table_lookup(priv->amounts, account);
+    if (amounts)
+        return amounts;
+
+    if (g_hash_table_size(priv->amounts) == 0)
+        priv->amounts_num_periods = gnc_budget_get_num_periods(priv->budget);
+    num_periods = priv->amounts_num_periods;
+
+    children = gnc_account_get_children(account);
+    num_children = g_list_length(children);
+    child_amounts = g_new(const gnc_numeric *, num_children);
+    for (node = children, i = 0; node; node = node->next, i++)
+        child_amounts[i] = gbv_get_account_amounts(priv, node->data);
+    g_list_free(children);
+
+    amounts = g_new(gnc_numeric, num_periods + 1);
+    amounts[num_periods] = gnc_numeric_zero();
+    for (period_num = 0; period_num < num_periods; ++period_num)
     {
-        numeric = gbv_get_accumulated_budget_amount(info->budget, account, info->period_num);
-        info->total = gnc_numeric_add(info->total, numeric, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+        if (gnc_budget_is_account_period_value_set(priv->budget, account, period_num))
+        {
+            amounts[period_num] = gnc_budget_get_account_period_value(priv->budget,
+                                  account, period_num);
+            if (gnc_numeric_check(amounts[period_num]))
+                continue;
+        }
+        else
+        {
+            amounts[period_num] = gnc_numeric_zero();
+            for (i = 0; i < num_children; i++)
+                amounts[period_num] = gnc_numeric_add(amounts[period_num],
+                                                      child_amounts[i][period_num],
+                                                      GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
+        }
+        amounts[num_periods] = gnc_numeric_add(amounts[num_periods],
+                                               amounts[period_num],
+                                               GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
     }
-}
+    g_free(child_amounts);
 
-/** \brief Function to calculate the accumulated budget amount in a given account at a specified period number.
+    g_hash_table_insert(priv->amounts, account, amounts);
+    return amounts;
+}
 
-This function uses the \ref budget_accum_helper to calculate the accumulated budget amount in a given budget account for a specified period number. If the acocunt does not have children, then it simply returns the balance of the account.
+/** \brief Function to find the amount shown for an account in a period, or its total if period_num is negative.
 */
 static gnc_numeric
-gbv_get_accumulated_budget_amount(GncBudget* budget, Account* account, guint period_num)
+gbv_get_account_amount(GncBudgetViewPrivate *priv, Account *account, gint period_num)
 {
-    BudgetAccumulationInfo info;
-
-    info.total = gnc_numeric_zero();
-    info.budget = budget;
-    info.period_num = period_num;
-    
+    const gnc_numeric *amounts = gbv_get_account_amounts(priv, account);
 
-    
-    if (!gnc_budget_is_account_period_value_set(budget, account, period_num))
-    {
-    	gnc_account_foreach_child(account, budget_accum_helper, &info);
-    }
-    else
-    {
-    	info.total = gnc_budget_get_account_period_value(budget, account, period_num);
-    }
-    	return info.total;
-    
+    if (period_num < 0)
+        return amounts[priv->amounts_num_periods];
+    if (period_num >= priv->amounts_num_periods)
+        return gnc_numeric_zero();
+    return amounts[period_num];
 }
 
 /** \brief Calculates and displays budget amount for a period in a defined account.
@@ -763,11 +815,13 @@ budget_col_source(Account *account, GtkTreeViewColumn *col,
                   GtkCellRenderer *cell)
 {
     GncBudget *budget;
+    GncBudgetViewPrivate *priv;
     guint period_num;
     gnc_numeric numeric;
     gchar amtbuff[100]; //FIXME: overkill, where's the #define?
 
     budget = GNC_BUDGET(g_object_get_data(G_OBJECT(col), "budget"));
+    priv = GNC_BUDGET_VIEW_GET_PRIVATE(g_object_get_data(G_OBJECT(col), "view"));
     period_num = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(col),
                                   "period_num"));
 
@@ -779,7 +833,7 @@ budget_col_source(Account *account, GtkTreeViewColumn *col,
         }
         else
         {
-            numeric = gbv_get_accumulated_budget_amount(budget, account, period_num);
+            numeric = gbv_get_account_amount(priv, account, period_num);
             xaccSPrintAmount(amtbuff, numeric,
                              gnc_account_print_info(account, FALSE));
             g_object_set(cell, "foreground", "dark gray", NULL);
@@ -803,52 +857,18 @@ budget_col_source(Account *account, GtkTreeViewColumn *col,
     return g_strdup(amtbuff);
 }
 
-/** \brief Function to find the total for an account for display in the totals column to the right.
-*/
-static gnc_numeric
-bgv_get_total_for_account(Account* account, GncBudget* budget)
-{
-    guint num_periods;
-    int period_num;
-    gnc_numeric numeric;
-    gnc_numeric total = gnc_numeric_zero();
-
-    num_periods = gnc_budget_get_num_periods(budget);
-    for (period_num = 0; period_num < num_periods; ++period_num)
-    {
-        if (!gnc_budget_is_account_period_value_set(budget, account, period_num))
-        {
-            if (gnc_account_n_children(account) != 0)
-            {
-                numeric = gbv_get_accumulated_budget_amount(budget, account, period_num);
-                total = gnc_numeric_add(total, numeric, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            }
-        }
-        else
-        {
-            numeric = gnc_budget_get_account_period_value(budget, account, period_num);
-            if (!gnc_numeric_check(numeric))
-            {
-                total = gnc_numeric_add(total, numeric, GNC_DENOM_AUTO, GNC_HOW_DENOM_LCD);
-            }
-        }
-    }
-
-    return total;
-}
-
 /** \brief Function to find and display the total for a specified account.
 */
 static gchar *
 budget_total_col_source(Account *account, GtkTreeViewColumn *col,
                         GtkCellRenderer *cell)
 {
-    GncBudget *budget;
+    GncBudgetViewPrivate *priv;
     gnc_numeric total = gnc_numeric_zero();
     gchar amtbuff[100]; //FIXME: overkill, where's the #define?
 
-    budget = GNC_BUDGET(g_object_get_data(G_OBJECT(col), "budget"));
-    total = bgv_get_total_for_account(account, budget);
+    priv = GNC_BUDGET_VIEW_GET_PRIVATE(g_object_get_data(G_OBJECT(col), "view"));
+    total = gbv_get_account_amount(priv, account, -1);
     xaccSPrintAmount(amtbuff, total,
                      gnc_account_print_info(account, FALSE));
     return g_strdup(amtbuff);
@@ -886,7 +906,7 @@ budget_col_edited(Account *account, GtkTreeViewColumn *col,
 
 This function is called on each row within the totals tree (i.e. assets, expenses, transfers, and totals) in order to 
 update the total values in the totals tree (grand totals at the bottom of the budget page). It looks at which type of account is currently being examined, and then calls the function
-\ref gbv_get_accumulated_budget_amount on all of the relevant children accounts of the root. It then sets the value and color of the cell based on this information in the totals tree widget.
+\ref gbv_get_account_amount on all of the relevant children accounts of the root. It then sets the value and color of the cell based on this information in the totals tree widget.
 
 */
 static void
@@ -897,7 +917,6 @@ totals_col_source(GtkTreeViewColumn *col, GtkCellRenderer *cell,
     GncBudgetView* view;
     GncBudgetViewPrivate* priv;
     gint row_type;
-    GncBudget *budget;
     Account* account; // used to make things easier in the adding up processes
     gint period_num;
     gnc_numeric value; // used to assist in adding and subtracting
@@ -917,7 +936,6 @@ totals_col_source(GtkTreeViewColumn *col, GtkCellRenderer *cell,
     priv = GNC_BUDGET_VIEW_GET_PRIVATE(view);
 
     gtk_tree_model_get(s_model, s_iter, 1, &row_type, -1);
-    budget = GNC_BUDGET(g_object_get_data(G_OBJECT(col), "budget"));
     period_num = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(col),
                                  "period_num"));
 
@@ -932,14 +950,7 @@ totals_col_source(GtkTreeViewColumn *col, GtkCellRenderer *cell,
     	
     	// find the total for this account
     	
-    	if (period_num < 0)
-    	{
-    		value = bgv_get_total_for_account(account, budget);
-    	}
-    	else
-    	{
-    		value = gbv_get_accumulated_budget_amount(budget, account, period_num);
-    	}
+    	value = gbv_get_account_amount(priv, account, period_num);
 
 		// test for what account type, and add 'value' to the appopriate total
     	
@@ -1118,6 +1129,7 @@ gnc_budget_view_refresh(GncBudgetView *view)
     g_return_if_fail(view != NULL);
     priv = GNC_BUDGET_VIEW_GET_PRIVATE(view);
 
+    g_hash_table_remove_all(priv->amounts);
     num_periods = gnc_budget_get_num_periods(priv->budget);
     col_list = priv->period_col_list;
     totals_col_list = priv->totals_col_list;
@@ -1161,6 +1173,7 @@ gnc_budget_view_refresh(GncBudgetView *view)
                   GNC_TREE_VIEW_ACCOUNT(priv->tree_view), "",
                   budget_col_source, budget_col_edited);
         g_object_set_data(G_OBJECT(col), "budget", priv->budget);
+        g_object_set_data(G_OBJECT(col), "view", view);
         g_object_set_data(G_OBJECT(col), "period_num",
                           GUINT_TO_POINTER(num_periods_visible));
         col_list = g_list_append(col_list, col);
@@ -1191,6 +1204,7 @@ gnc_budget_view_refresh(GncBudgetView *view)
                               GNC_TREE_VIEW_ACCOUNT(priv->tree_view), _("Total"),
                               budget_total_col_source, NULL);
         g_object_set_data(G_OBJECT(priv->total_col), "budget", priv->budget);
+        g_object_set_data(G_OBJECT(priv->total_col), "view", view);
 
         col = gbv_create_totals_column(view, -1);
         if (col != NULL)
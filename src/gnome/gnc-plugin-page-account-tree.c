@@ -63,6 +63,7 @@
 #include "gnc-tree-model-account-types.h"
 #include "gnc-ui.h"
 #include "gnc-ui-util.h"
+#include "gnc-window.h"
 #include "dialog-lot-viewer.h"
 #include "window-reconcile.h"
 #include "window-autoclear.h"
@@ -1683,43 +1684,58 @@ gnc_plugin_page_account_tree_cmd_scrub (GtkAction *action, GncPluginPageAccountT
     gnc_resume_gui_refresh ();
 }
 
+static gboolean
+scrub_kp_handler (GtkWidget *widget, GdkEventKey *event, gpointer data)
+{
+    if (event->keyval != GDK_KEY_Escape)
+        return FALSE;
+
+    if (gnc_verify_dialog (widget, FALSE, "%s",
+                           _("'Check & Repair' is currently running, do you want to abort it?")))
+        gnc_set_abort_scrub (TRUE);
+    return TRUE;
+}
+
+/* Check & Repair account and its descendants, showing the progress in the
+ * page's window; pressing Escape offers to stop it. */
 static void
-gnc_plugin_page_account_tree_cmd_scrub_sub (GtkAction *action, GncPluginPageAccountTree *page)
+scrub_account_tree (GncPluginPageAccountTree *page, Account *account)
 {
-    Account *account = gnc_plugin_page_account_tree_get_current_account (page);
+    GtkWidget *window = GNC_PLUGIN_PAGE (page)->window;
+    gulong scrub_kp_handler_id;
 
-    g_return_if_fail (account != NULL);
+    if (gnc_get_ongoing_scrub ())
+        return;
 
     gnc_suspend_gui_refresh ();
-
-    xaccAccountTreeScrubOrphans (account);
-    xaccAccountTreeScrubImbalance (account);
+    gnc_window_set_progressbar_window (GNC_WINDOW (window));
+    scrub_kp_handler_id = g_signal_connect (G_OBJECT (window), "key-press-event",
+                                            G_CALLBACK (scrub_kp_handler), NULL);
 
     // XXX: Lots/capital gains scrubbing is disabled
-    if (g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL)
-        xaccAccountTreeScrubLots(account);
-
-    gncScrubBusinessAccountTree(account);
+    xaccAccountTreeScrubAll (account, g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL,
+                             gnc_window_show_progress);
 
+    g_signal_handler_disconnect (G_OBJECT (window), scrub_kp_handler_id);
+    gnc_window_show_progress (NULL, -1.0);
+    gnc_window_set_progressbar_window (NULL);
     gnc_resume_gui_refresh ();
 }
 
 static void
-gnc_plugin_page_account_tree_cmd_scrub_all (GtkAction *action, GncPluginPageAccountTree *page)
+gnc_plugin_page_account_tree_cmd_scrub_sub (GtkAction *action, GncPluginPageAccountTree *page)
 {
-    Account *root = gnc_get_current_root_account ();
-
-    gnc_suspend_gui_refresh ();
+    Account *account = gnc_plugin_page_account_tree_get_current_account (page);
 
-    xaccAccountTreeScrubOrphans (root);
-    xaccAccountTreeScrubImbalance (root);
-    // XXX: Lots/capital gains scrubbing is disabled
-    if (g_getenv("GNC_AUTO_SCRUB_LOTS") != NULL)
-        xaccAccountTreeScrubLots(root);
+    g_return_if_fail (account != NULL);
 
-    gncScrubBusinessAccountTree(root);
+    scrub_account_tree (page, account);
+}
 
-    gnc_resume_gui_refresh ();
+static void
+gnc_plugin_page_account_tree_cmd_scrub_all (GtkAction *action, GncPluginPageAccountTree *page)
+{
+    scrub_account_tree (page, gnc_get_current_root_account ());
 }
 
 /** @} */
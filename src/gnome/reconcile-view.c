@@ -60,6 +60,7 @@ static void gnc_reconcile_view_init (GNCReconcileView *view);
 static void gnc_reconcile_view_class_init (GNCReconcileViewClass *klass);
 static void gnc_reconcile_view_finalize (GObject *object);
 static gpointer gnc_reconcile_view_is_reconciled (gpointer item, gpointer user_data);
+static void grv_mark_split (GNCReconcileView *view, Split *split);
 static void gnc_reconcile_view_line_toggled (GNCQueryView *qview, gpointer item, gpointer user_data);
 static void gnc_reconcile_view_double_click_entry (GNCQueryView *qview, gpointer item, gpointer user_data);
 static void gnc_reconcile_view_row_selected (GNCQueryView *qview, gpointer item, gpointer user_data);
@@ -339,7 +340,7 @@ gnc_reconcile_view_new (Account *account, GNCReconcileViewType type,
 
             if (recn == CREC &&
 		gnc_difftime (trans_date, statement_date) <= 0)
-		g_hash_table_insert (view->reconciled, split, split);
+		grv_mark_split (view, split);
         }
     }
 
@@ -359,6 +360,7 @@ gnc_reconcile_view_init (GNCReconcileView *view)
                 qof_book_use_split_action_for_num_field(gnc_get_current_book());
 
     view->reconciled = g_hash_table_new (NULL, NULL);
+    view->reconciled_total = gnc_numeric_zero ();
     view->account = NULL;
     view->sibling = NULL;
 
@@ -443,6 +445,24 @@ gnc_reconcile_view_class_init (GNCReconcileViewClass *klass)
 }
 
 
+/* The reconciled total follows each toggle, so that the window's
+ * totals don't have to add up all the marked splits every time. */
+static void
+grv_mark_split (GNCReconcileView *view, Split *split)
+{
+    g_hash_table_insert (view->reconciled, split, split);
+    view->reconciled_total = gnc_numeric_add_fixed (view->reconciled_total,
+                                                    xaccSplitGetAmount (split));
+}
+
+static void
+grv_unmark_split (GNCReconcileView *view, Split *split)
+{
+    g_hash_table_remove (view->reconciled, split);
+    view->reconciled_total = gnc_numeric_sub_fixed (view->reconciled_total,
+                                                    xaccSplitGetAmount (split));
+}
+
 static void
 gnc_reconcile_view_toggle_split (GNCReconcileView *view, Split *split)
 {
@@ -454,9 +474,9 @@ gnc_reconcile_view_toggle_split (GNCReconcileView *view, Split *split)
     current = g_hash_table_lookup (view->reconciled, split);
 
     if (current == NULL)
-        g_hash_table_insert (view->reconciled, split, split);
+        grv_mark_split (view, split);
     else
-        g_hash_table_remove (view->reconciled, split);
+        grv_unmark_split (view, split);
 }
 
 
@@ -795,14 +815,17 @@ gnc_reconcile_view_is_reconciled (gpointer item, gpointer user_data)
  * Args: view - view to refresh                                     *
  * Returns: nothing                                                 *
 \********************************************************************/
-static void
+static gboolean
 grv_refresh_helper (gpointer key, gpointer value, gpointer user_data)
 {
     GNCReconcileView *view = user_data;
     GNCQueryView *qview = GNC_QUERY_VIEW (view);
 
     if (!gnc_query_view_item_in_view (qview, key))
-        g_hash_table_remove (view->reconciled, key);
+        return TRUE;
+    view->reconciled_total = gnc_numeric_add_fixed (view->reconciled_total,
+                                                    xaccSplitGetAmount (key));
+    return FALSE;
 }
 
 void
@@ -816,9 +839,12 @@ gnc_reconcile_view_refresh (GNCReconcileView *view)
     qview = GNC_QUERY_VIEW (view);
     gnc_query_view_refresh (qview);
 
-    /* Now verify that everything in the reconcile hash is still in qview */
+    /* Now verify that everything in the reconcile hash is still in qview,
+     * and total the amounts again since the splits may have been edited */
+    view->reconciled_total = gnc_numeric_zero ();
     if (view->reconciled)
-        g_hash_table_foreach (view->reconciled, grv_refresh_helper, view);
+        g_hash_table_foreach_remove (view->reconciled, grv_refresh_helper,
+                                     view);
 }
 
 
@@ -829,15 +855,6 @@ gnc_reconcile_view_refresh (GNCReconcileView *view)
  * Args: view - view to get reconciled balance of                   *
  * Returns: reconciled balance (gnc_numeric)                        *
 \********************************************************************/
-static void
-grv_balance_hash_helper (gpointer key, gpointer value, gpointer user_data)
-{
-    Split *split = key;
-    gnc_numeric *total = user_data;
-
-    *total = gnc_numeric_add_fixed (*total, xaccSplitGetAmount (split));
-}
-
 gnc_numeric
 gnc_reconcile_view_reconciled_balance (GNCReconcileView *view)
 {
@@ -849,9 +866,7 @@ gnc_reconcile_view_reconciled_balance (GNCReconcileView *view)
     if (view->reconciled == NULL)
         return total;
 
-    g_hash_table_foreach (view->reconciled, grv_balance_hash_helper, &total);
-
-    return gnc_numeric_abs (total);
+    return gnc_numeric_abs (view->reconciled_total);
 }
 
 
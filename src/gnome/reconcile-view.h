@@ -49,6 +49,7 @@ struct GNCReconcileView
     GNCQueryView         qview;
 
     GHashTable          *reconciled;
+    gnc_numeric          reconciled_total; /* Sum of the amounts in reconciled */
     Account             *account;
     GList               *column_list;
 
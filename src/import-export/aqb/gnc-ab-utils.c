@@ -63,6 +63,7 @@ static gpointer join_ab_strings_cb(const gchar *str, gpointer user_data);
 static Account *gnc_ab_accinfo_to_gnc_acc(
     AB_IMEXPORTER_ACCOUNTINFO *account_info);
 static Account *gnc_ab_txn_to_gnc_acc(
+    GncABImExContextImport *data,
     const AB_TRANSACTION *transaction);
 static const AB_TRANSACTION *txn_transaction_cb(
     const AB_TRANSACTION *element, gpointer user_data);
@@ -83,6 +84,9 @@ struct _GncABImExContextImport
     AB_JOB_LIST2 *job_list;
     GNCImportMainMatcher *generic_importer;
     GData *tmp_job_list;
+    /* The account chosen for each local online id while importing the
+     * transactions, NULL if there was none. */
+    GHashTable *txn_accounts;
 };
 
 void
@@ -610,16 +614,21 @@ gnc_ab_accinfo_to_gnc_acc(AB_IMEXPORTER_ACCOUNTINFO *acc_info)
 
 /**
  * Call gnc_import_select_account() on the online id constructed using
- * the local information in @a transaction.
+ * the local information in @a transaction.  The answer is remembered in
+ * @a data, so that the account tree is searched, and the user asked,
+ * once for each local account rather than for each transaction.
  *
+ * @param data The import context
  * @param transaction AB_TRANSACTION
  * @return A GnuCash account, or NULL otherwise
  */
 static Account *
-gnc_ab_txn_to_gnc_acc(const AB_TRANSACTION *transaction)
+gnc_ab_txn_to_gnc_acc(GncABImExContextImport *data,
+                      const AB_TRANSACTION *transaction)
 {
     const gchar *bankcode, *accountnumber;
     gchar *online_id;
+    gpointer cached;
     Account *gnc_acc;
 
     g_return_val_if_fail(transaction, NULL);
@@ -634,6 +643,12 @@ gnc_ab_txn_to_gnc_acc(const AB_TRANSACTION *transaction)
     online_id = g_strconcat(bankcode ? bankcode : "",
                             accountnumber ? accountnumber : "",
                             (gchar*)NULL);
+    if (g_hash_table_lookup_extended(data->txn_accounts, online_id, NULL,
+                                     &cached))
+    {
+        g_free(online_id);
+        return cached;
+    }
     gnc_acc = gnc_import_select_account(
                   NULL, online_id, 1, AB_Transaction_GetLocalName(transaction),
                   NULL, ACCT_TYPE_NONE, NULL, NULL);
@@ -642,7 +657,8 @@ gnc_ab_txn_to_gnc_acc(const AB_TRANSACTION *transaction)
         g_warning("gnc_ab_txn_to_gnc_acc: Could not determine source account"
                   " for online_id %s", online_id);
     }
-    g_free(online_id);
+    /* The table takes online_id. */
+    g_hash_table_insert(data->txn_accounts, online_id, gnc_acc);
 
     return gnc_acc;
 }
@@ -658,7 +674,7 @@ txn_transaction_cb(const AB_TRANSACTION *element, gpointer user_data)
     g_return_val_if_fail(element && data, NULL);
 
     /* Create a GnuCash transaction from ab_trans */
-    txnacc = gnc_ab_txn_to_gnc_acc(element);
+    txnacc = gnc_ab_txn_to_gnc_acc(data, element);
     gnc_trans = gnc_ab_trans_to_gnc(element, txnacc ? txnacc : data->gnc_acc);
 
     if (data->execute_txns && data->ab_acc)
@@ -1082,8 +1098,14 @@ gnc_ab_import_context(AB_IMEXPORTER_CONTEXT *context,
 
     /* Import transactions */
     if (!(awaiting & IGNORE_TRANSACTIONS))
+    {
+        data->txn_accounts = g_hash_table_new_full(g_str_hash, g_str_equal,
+                             g_free, NULL);
         AB_ImExporterContext_AccountInfoForEach(context, txn_accountinfo_cb,
                                                 data);
+        g_hash_table_destroy(data->txn_accounts);
+    }
+    data->txn_accounts = NULL;
 
     /* Check balances */
     if (!(awaiting & IGNORE_BALANCES))
@@ -0,0 +1,167 @@
+/*******************************************************************\
+ * csv-export-helpers.c -- Line building for the CSV exports        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+/** @file csv-export-helpers.c
+    @brief Line building for the CSV exports
+*/
+#include "config.h"
+
+#include <glib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include "gnc-ui-util.h"
+
+#include "csv-export-helpers.h"
+
+void
+csv_export_append_field (GString *line, const CsvExportInfo *info,
+                         const gchar *field)
+{
+    gboolean need_quote;
+    const gchar *quote;
+
+    if (!field)
+        field = "";
+
+    /* Check for separator string and \n and " in field,
+       if so quote field if not allready quoted */
+    need_quote = !info->use_quotes &&
+                 (strchr (field, '"') || strchr (field, '\n') ||
+                  strstr (field, info->separator_str));
+
+    if (need_quote)
+        g_string_append_c (line, '"');
+    /* Check for " and then "" them */
+    while ((quote = strchr (field, '"')) != NULL)
+    {
+        g_string_append_len (line, field, quote - field + 1);
+        g_string_append_c (line, '"');
+        field = quote + 1;
+    }
+    g_string_append (line, field);
+    if (need_quote)
+        g_string_append_c (line, '"');
+}
+
+/* The items are cut into chunks which worker threads format into
+ * strings, and the calling thread writes the strings out in the
+ * original order, so the file is exactly what a serial export writes.
+ */
+#define CSV_EXPORT_CHUNK_SIZE 256
+
+typedef struct
+{
+    gpointer *items;
+    guint n_items;
+    CsvExportFormatFunc format;
+    CsvExportInfo *info;
+    GString *text;
+    GAsyncQueue *done;
+} CsvExportChunk;
+
+static void
+format_chunk (gpointer data, gpointer user_data)
+{
+    CsvExportChunk *chunk = data;
+    guint i;
+
+    for (i = 0; i < chunk->n_items; i++)
+        chunk->format (chunk->text, chunk->items[i], chunk->info);
+    g_async_queue_push (chunk->done, chunk);
+}
+
+static gint
+export_threads (void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    return g_get_num_processors ();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1;
+#endif
+}
+
+gboolean
+csv_export_write_items (FILE *fh, GPtrArray *items, CsvExportFormatFunc format,
+                        CsvExportInfo *info)
+{
+    GQueue pending = G_QUEUE_INIT;
+    GThreadPool *pool = NULL;
+    gint threads = export_threads ();
+    guint next = 0;
+    gboolean success = TRUE;
+
+    if (threads > 1 && items->len >= 2 * CSV_EXPORT_CHUNK_SIZE)
+    {
+        char buf[64];
+
+        /* The number separators are set up on first use. */
+        xaccSPrintAmount (buf, gnc_numeric_zero (), gnc_default_share_print_info ());
+        pool = g_thread_pool_new (format_chunk, NULL, threads, FALSE, NULL);
+    }
+    /* Without a pool the chunks are formatted here, one at a time. */
+    if (!pool)
+        threads = 1;
+
+    while (next < items->len || !g_queue_is_empty (&pending))
+    {
+        CsvExportChunk *chunk;
+
+        /* Keep a bounded number of chunks in flight. */
+        while (next < items->len &&
+               g_queue_get_length (&pending) < 4 * (guint) threads)
+        {
+            chunk = g_new (CsvExportChunk, 1);
+            chunk->items = items->pdata + next;
+            chunk->n_items = MIN (CSV_EXPORT_CHUNK_SIZE, items->len - next);
+            chunk->format = format;
+            chunk->info = info;
+            chunk->text = g_string_sized_new (chunk->n_items * 128);
+            chunk->done = g_async_queue_new ();
+            next += chunk->n_items;
+            if (pool)
+                g_thread_pool_push (pool, chunk, NULL);
+            else
+                format_chunk (chunk, NULL);
+            g_queue_push_tail (&pending, chunk);
+        }
+
+        chunk = g_queue_pop_head (&pending);
+        g_async_queue_pop (chunk->done);
+        if (success &&
+            fwrite (chunk->text->str, 1, chunk->text->len, fh) != chunk->text->len)
+        {
+            success = FALSE;
+            /* Nothing more is worth formatting. */
+            next = items->len;
+        }
+        g_async_queue_unref (chunk->done);
+        g_string_free (chunk->text, TRUE);
+        g_free (chunk);
+    }
+
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+    return success;
+}
@@ -0,0 +1,61 @@
+/*******************************************************************\
+ * csv-export-helpers.h -- Line building for the CSV exports        *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+/** @file csv-export-helpers.h
+    @brief Line building for the CSV exports
+*/
+#ifndef CSV_EXPORT_HELPERS
+#define CSV_EXPORT_HELPERS
+
+#include <stdio.h>
+#include "assistant-csv-export.h"
+
+/* CSV spec requires CRLF line endings. Tweak the end-of-line string so this
+ * true for each platform */
+#ifdef G_OS_WIN32
+# define EOLSTR "\n"
+#else
+# define EOLSTR "\r\n"
+#endif
+
+/** Append field to line, doubling its quotes, and quoted when it holds
+ *  a quote, a new line or the separator and the separators don't
+ *  quote every field already.
+ */
+void csv_export_append_field (GString *line, const CsvExportInfo *info,
+                              const gchar *field);
+
+/** Formats the lines of one item onto the end of text. It may run on
+ *  any thread, so it must only read the engine, and only use the
+ *  printing functions that write into a buffer of the caller's.
+ */
+typedef void (*CsvExportFormatFunc) (GString *text, gpointer item,
+                                     CsvExportInfo *info);
+
+/** Write the lines of items to fh in order, formatting them on a
+ *  thread pool when there are enough to make that worthwhile.
+ *
+ *  @return FALSE if writing failed.
+ */
+gboolean csv_export_write_items (FILE *fh, GPtrArray *items,
+                                 CsvExportFormatFunc format,
+                                 CsvExportInfo *info);
+
+#endif
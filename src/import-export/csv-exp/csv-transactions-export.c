@@ -38,23 +38,24 @@
 #include "qofbookslots.h"
 
 #include "csv-transactions-export.h"
+#include "csv-export-helpers.h"
 
 /* This static indicates the debugging module that this .o belongs to. */
 static QofLogModule log_module = GNC_MOD_ASSISTANT;
 
-/* CSV spec requires CRLF line endings. Tweak the end-of-line string so this
- * true for each platform */
-#ifdef G_OS_WIN32
-# define EOLSTR "\n"
-#else
-# define EOLSTR "\r\n"
-#endif
-
 
 enum GncCsvLineType {TRANS_SIMPLE,
                      TRANS_COMPLEX,
                      SPLIT_LINE};
 
+/* A transaction to export, as found in the account acc through split */
+typedef struct
+{
+    Account     *acc;
+    Transaction *trans;
+    Split       *split;
+} CsvExportTrans;
+
 /*******************************************************************/
 
 /*******************************************************
@@ -79,504 +80,308 @@ gboolean write_line_to_file (FILE *fh, char * line)
         return TRUE;
 }
 
+/******************** Helper functions *********************/
 
-/*******************************************************
- * csv_txn_test_field_string
- *
- * Test the field string for ," and new lines
- *******************************************************/
-static
-gchar *csv_txn_test_field_string (CsvExportInfo *info, const gchar *string_in)
-{
-    gboolean need_quote = FALSE;
-    gchar **parts;
-    gchar *string_parts;
-    gchar *string_out;
-
-    /* Check for " and then "" them */
-    parts = g_strsplit (string_in, "\"", -1);
-    string_parts = g_strjoinv ("\"\"", parts);
-    g_strfreev (parts);
-
-    /* Check for separator string and \n and " in field,
-       if so quote field if not allready quoted */
-    if (g_strrstr (string_parts, info->separator_str) != NULL)
-        need_quote = TRUE;
-    if (g_strrstr (string_parts, "\n") != NULL)
-        need_quote = TRUE;
-    if (g_strrstr (string_parts, "\"") != NULL)
-        need_quote = TRUE;
-
-    if (!info->use_quotes && need_quote)
-        string_out = g_strconcat ("\"", string_parts, "\"", NULL);
-    else
-        string_out = g_strdup (string_parts);
+/* The lines are built up in a GString, one field after another. They
+ * may be formatted on a worker thread, so dates and amounts are
+ * printed into local buffers rather than the static ones of
+ * gnc_print_date and xaccPrintAmount. */
 
-    g_free (string_parts);
-    return string_out;
+// A field followed by the separator
+static void
+add_field (GString *line, const gchar *field, CsvExportInfo *info)
+{
+    csv_export_append_field (line, info, field);
+    g_string_append (line, info->mid_sep);
 }
 
-/******************** Helper functions *********************/
+static void
+add_amount_field (GString *line, gnc_numeric amount, GNCPrintAmountInfo print_info,
+                  CsvExportInfo *info)
+{
+    char buf[1024];
+
+    if (!xaccSPrintAmount (buf, amount, print_info))
+        buf[0] = '\0';
+    add_field (line, buf, info);
+}
 
 // Transaction line starts with Date
-static gchar*
-begin_trans_string (Transaction *trans, CsvExportInfo *info)
+static void
+begin_trans_string (GString *line, Transaction *trans, CsvExportInfo *info)
 {
-    gchar *date = qof_print_date (xaccTransGetDate (trans));
-    gchar *result = g_strconcat (info->end_sep, date, info->mid_sep, NULL);
-    g_free (date);
-    return result;
+    char date[MAX_DATE_LENGTH + 1];
+
+    qof_print_date_buff (date, sizeof (date), xaccTransGetDate (trans));
+    g_string_append (line, info->end_sep);
+    g_string_append (line, date);
+    g_string_append (line, info->mid_sep);
 }
 
 
 // Split line start
-static gchar*
-begin_split_string (Transaction *trans, Split *split, gboolean t_void, CsvExportInfo *info)
+static void
+begin_split_string (GString *line, Transaction *trans, Split *split, gboolean t_void, CsvExportInfo *info)
 {
-    const gchar *str_rec_date;
-    const gchar *start;
-    gchar       *conv;
-    gchar       *result;
+    char         str_rec_date[MAX_DATE_LENGTH + 1] = "";
     Timespec     ts = {0,0};
 
     if (xaccSplitGetReconcile (split) == YREC)
     {
         xaccSplitGetDateReconciledTS (split, &ts);
-        str_rec_date = gnc_print_date (ts);
+        qof_print_date_buff (str_rec_date, sizeof (str_rec_date), ts.tv_sec);
     }
-    else
-        str_rec_date = "";
 
+    g_string_append (line, info->end_sep);
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, str_rec_date);
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, info->mid_sep);
     if (t_void)
-    {
-        start = xaccTransGetVoidReason (trans) ? xaccTransGetVoidReason (trans) : "" ;
-        conv = csv_txn_test_field_string (info, start);
-        result = g_strconcat (info->end_sep, info->mid_sep, info->mid_sep, str_rec_date,
-                              info->mid_sep, info->mid_sep, info->mid_sep, info->mid_sep, conv, info->mid_sep, NULL);
-        g_free (conv);
-    }
-    else
-         result = g_strconcat (info->end_sep, info->mid_sep, info->mid_sep, str_rec_date,
-                               info->mid_sep, info->mid_sep, info->mid_sep, info->mid_sep, info->mid_sep, NULL);
-
-    return result;
+        csv_export_append_field (line, info, xaccTransGetVoidReason (trans));
+    g_string_append (line, info->mid_sep);
 }
 
 
 // Transaction Type
-static gchar*
-add_type (gchar *so_far, Transaction *trans, CsvExportInfo *info)
+static void
+add_type (GString *line, Transaction *trans, CsvExportInfo *info)
 {
-    gchar       *result;
-    char         type;
-    static char  ss[2];
-
-    type = xaccTransGetTxnType (trans);
+    char type = xaccTransGetTxnType (trans);
 
     if (type == TXN_TYPE_NONE)
         type = ' ';
-    ss[0] = type;
-    ss[1] = '\0';
-    result = g_strconcat (so_far, ss, info->mid_sep, NULL);
-    g_free (so_far);
-    return result;
+    g_string_append_c (line, type);
+    g_string_append (line, info->mid_sep);
 }
 
 // Second Date
-static gchar*
-add_second_date (gchar *so_far, Transaction *trans, CsvExportInfo *info)
+static void
+add_second_date (GString *line, Transaction *trans, CsvExportInfo *info)
 {
-    gchar       *result;
-    const gchar *second_date;
-    char         type;
-    Timespec     ts = {0,0};
-
-    type = xaccTransGetTxnType (trans);
-
-    if (type == TXN_TYPE_INVOICE)
+    if (xaccTransGetTxnType (trans) == TXN_TYPE_INVOICE)
     {
+        char second_date[MAX_DATE_LENGTH + 1];
+        Timespec ts = {0,0};
+
         xaccTransGetDateDueTS (trans, &ts);
-        second_date = gnc_print_date (ts);
-        result = g_strconcat (so_far, second_date, info->mid_sep, NULL);
+        qof_print_date_buff (second_date, sizeof (second_date), ts.tv_sec);
+        g_string_append (line, second_date);
     }
-    else
-        result = g_strconcat (so_far, info->mid_sep, NULL);
-
-    g_free (so_far);
-    return result;
+    g_string_append (line, info->mid_sep);
 }
 
 // Account Name short or Long
-static gchar*
-add_account_name (gchar *so_far, Account *acc, Split *split, gboolean full, CsvExportInfo *info)
+static void
+add_account_name (GString *line, Account *acc, Split *split, gboolean full, CsvExportInfo *info)
 {
-    gchar       *name = NULL;
-    gchar       *conv;
-    gchar       *result;
-    Account     *account = NULL;
+    Account     *account = split ? xaccSplitGetAccount (split) : acc;
 
-    if (split == NULL)
+    if (account == NULL)
+        add_field (line, " ", info);
+    else if (full)
     {
-        if (acc == NULL)
-            name = g_strdup (" ");
-        else
-            account = acc;
+        gchar *name = gnc_account_get_full_name (account);
+        add_field (line, name, info);
+        g_free (name);
     }
     else
-        account = xaccSplitGetAccount (split);
-
-    if (account != NULL)
-    {
-        if (full)
-            name = gnc_account_get_full_name (account);
-        else
-            name = g_strdup (xaccAccountGetName (account));
-    }
-    conv = csv_txn_test_field_string (info, name);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (name);
-    g_free (conv);
-    g_free (so_far);
-    return result;
-}
-
-// Number
-static gchar*
-add_number (gchar *so_far, Transaction *trans, CsvExportInfo *info)
-{
-    const gchar *num;
-    gchar       *conv;
-    gchar       *result;
-
-    num = xaccTransGetNum (trans) ? xaccTransGetNum (trans) : "" ;
-    conv = csv_txn_test_field_string (info, num);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
-}
-
-// Description
-static gchar*
-add_description (gchar *so_far, Transaction *trans, CsvExportInfo *info)
-{
-    const gchar *desc;
-    gchar       *conv;
-    gchar       *result;
-
-    desc = xaccTransGetDescription (trans) ? xaccTransGetDescription (trans) : "" ;
-    conv = csv_txn_test_field_string (info, desc);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
-}
-
-// Notes
-static gchar*
-add_notes (gchar *so_far, Transaction *trans, CsvExportInfo *info)
-{
-    const gchar *notes;
-    gchar       *conv;
-    gchar       *result;
-
-    notes = xaccTransGetNotes (trans) ? xaccTransGetNotes (trans) : "" ;
-    conv = csv_txn_test_field_string (info, notes);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
-}
-
-// Memo
-static gchar*
-add_memo (gchar *so_far, Split *split, CsvExportInfo *info)
-{
-    const gchar *memo;
-    gchar       *conv;
-    gchar       *result;
-
-    memo = xaccSplitGetMemo (split) ? xaccSplitGetMemo (split) : "" ;
-    conv = csv_txn_test_field_string (info, memo);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
+        add_field (line, xaccAccountGetName (account), info);
 }
 
 // Full Category Path or Not
-static gchar*
-add_category (gchar *so_far, Split *split, gboolean full, CsvExportInfo *info)
+static void
+add_category (GString *line, Split *split, gboolean full, CsvExportInfo *info)
 {
-    gchar       *cat;
-    gchar       *conv;
-    gchar       *result;
-
     if (full)
-        cat = xaccSplitGetCorrAccountFullName (split);
+    {
+        gchar *cat = xaccSplitGetCorrAccountFullName (split);
+        add_field (line, cat, info);
+        g_free (cat);
+    }
     else
-        cat = g_strdup(xaccSplitGetCorrAccountName (split));
-
-    conv = csv_txn_test_field_string (info, cat);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (cat);
-    g_free (conv);
-    g_free (so_far);
-    return result;
+        add_field (line, xaccSplitGetCorrAccountName (split), info);
 }
 
 // Line Type
-static gchar*
-add_line_type (gchar *so_far, gint line_type, CsvExportInfo *info)
+static void
+add_line_type (GString *line, gint line_type, CsvExportInfo *info)
 {
-    gchar *result;
-
-    if (line_type == SPLIT_LINE)
-        result = g_strconcat (so_far, "S", info->mid_sep, NULL);
-    else
-        result = g_strconcat (so_far, "T", info->mid_sep, NULL);
-
-    g_free (so_far);
-    return result;
+    g_string_append (line, line_type == SPLIT_LINE ? "S" : "T");
+    g_string_append (line, info->mid_sep);
 }
 
 // Action
-static gchar*
-add_action (gchar *so_far, Split *split, gint line_type, CsvExportInfo *info)
+static void
+add_action (GString *line, Split *split, gint line_type, CsvExportInfo *info)
 {
-    const gchar *action;
-    gchar       *conv;
-    gchar       *result;
-
     if ((line_type == TRANS_COMPLEX)||(line_type == TRANS_SIMPLE))
-        result = g_strconcat (so_far, "", info->mid_sep, NULL);
+        g_string_append (line, info->mid_sep);
     else
-    {
-        action = xaccSplitGetAction (split);
-        conv = csv_txn_test_field_string (info, action);
-        result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-        g_free (conv);
-    }
-    g_free (so_far);
-    return result;
+        add_field (line, xaccSplitGetAction (split), info);
 }
 
 // Reconcile
-static gchar*
-add_reconcile (gchar *so_far, Split *split, CsvExportInfo *info)
-{
-    const gchar *recon;
-    gchar       *conv;
-    gchar       *result;
-
-    recon = gnc_get_reconcile_str (xaccSplitGetReconcile (split));
-    conv = csv_txn_test_field_string (info, recon);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
-}
-
-// Commodity Mnemonic
-static gchar*
-add_comm_mnemonic (gchar *so_far, Transaction *trans, Split *split, CsvExportInfo *info)
+static void
+add_reconcile (GString *line, Split *split, CsvExportInfo *info)
 {
-    const gchar *comm_m;
-    gchar       *conv;
-    gchar       *result;
-
-    if (split == NULL)
-        comm_m = gnc_commodity_get_mnemonic (xaccTransGetCurrency (trans));
-    else
-        comm_m = gnc_commodity_get_mnemonic (xaccAccountGetCommodity (xaccSplitGetAccount(split)));
-
-    conv = csv_txn_test_field_string (info, comm_m);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
+    add_field (line, gnc_get_reconcile_str (xaccSplitGetReconcile (split)), info);
 }
 
-// Commodity Namespace
-static gchar*
-add_comm_namespace (gchar *so_far, Transaction *trans, Split *split, CsvExportInfo *info)
+// Commodity Mnemonic and Namespace
+static gnc_commodity *
+line_commodity (Transaction *trans, Split *split)
 {
-    const gchar *comm_n;
-    gchar       *conv;
-    gchar       *result;
-
     if (split == NULL)
-        comm_n = gnc_commodity_get_namespace (xaccTransGetCurrency (trans));
-    else
-        comm_n = gnc_commodity_get_namespace (xaccAccountGetCommodity (xaccSplitGetAccount(split)));
-
-    conv = csv_txn_test_field_string (info, comm_n);
-    result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
+        return xaccTransGetCurrency (trans);
+    return xaccAccountGetCommodity (xaccSplitGetAccount (split));
 }
 
 // Amount with Symbol or not
-static gchar*
-add_amount (gchar *so_far, Split *split, gboolean t_void, gboolean symbol, gint line_type, CsvExportInfo *info)
+static void
+add_amount (GString *line, Split *split, gboolean t_void, gboolean symbol, gint line_type, CsvExportInfo *info)
 {
-    const gchar *amt;
-    gchar       *conv;
-    gchar       *result;
-
     if (line_type == TRANS_COMPLEX)
-        result = g_strconcat (so_far, "", info->mid_sep, NULL);
+        g_string_append (line, info->mid_sep);
+    else if (symbol)
+        add_amount_field (line, t_void ? gnc_numeric_zero () : xaccSplitGetAmount (split),
+                          gnc_split_amount_print_info (split, TRUE), info);
     else
-    {
-        if (symbol)
-        {
-            if (t_void)
-                amt = xaccPrintAmount (gnc_numeric_zero(), gnc_split_amount_print_info (split, TRUE));
-            else
-                amt = xaccPrintAmount (xaccSplitGetAmount (split), gnc_split_amount_print_info (split, TRUE));
-        }
-        else
-        {
-            if (t_void)
-                amt = xaccPrintAmount (xaccSplitVoidFormerAmount (split), gnc_split_amount_print_info (split, FALSE));
-            else
-                amt = xaccPrintAmount (xaccSplitGetAmount (split), gnc_split_amount_print_info (split, FALSE));
-        }
-        conv = csv_txn_test_field_string (info, amt);
-        result = g_strconcat (so_far, conv, info->mid_sep, NULL);
-        g_free (conv);
-    }
-    g_free (so_far);
-    return result;
+        add_amount_field (line, t_void ? xaccSplitVoidFormerAmount (split) : xaccSplitGetAmount (split),
+                          gnc_split_amount_print_info (split, FALSE), info);
 }
 
-// Share Price / Conversion factor
-static gchar*
-add_rate (gchar *so_far, Split *split, gboolean t_void, CsvExportInfo *info)
+// Share Price / Conversion factor, ending the line
+static void
+add_price (GString *line, gnc_numeric price, Split *split, CsvExportInfo *info)
 {
-    const gchar *amt;
-    gchar       *conv;
-    gchar       *result;
-
-    if (t_void)
-        amt = xaccPrintAmount (gnc_numeric_zero(), gnc_split_amount_print_info (split, FALSE));
-    else
-        amt = xaccPrintAmount (xaccSplitGetSharePrice (split), gnc_split_amount_print_info (split, FALSE));
+    char buf[1024];
 
-    conv = csv_txn_test_field_string (info, amt);
-    result = g_strconcat (so_far, conv, info->end_sep, EOLSTR, NULL);
-    g_free (conv);
-    g_free (so_far);
-    return result;
+    if (!xaccSPrintAmount (buf, price, gnc_split_amount_print_info (split, FALSE)))
+        buf[0] = '\0';
+    csv_export_append_field (line, info, buf);
+    g_string_append (line, info->end_sep);
+    g_string_append (line, EOLSTR);
 }
 
-// Share Price / Conversion factor
-static gchar*
-add_price (gchar *so_far, Split *split, gboolean t_void, CsvExportInfo *info)
+// Transaction End of Line
+static void
+add_trans_eol (GString *line, CsvExportInfo *info)
 {
-    const gchar *string_amount;
-    gchar       *conv;
-    gchar       *result;
-
-    if (t_void)
-    {
-        gnc_numeric cf = gnc_numeric_div (xaccSplitVoidFormerValue (split), xaccSplitVoidFormerAmount (split), GNC_DENOM_AUTO,
-                                                   GNC_HOW_DENOM_SIGFIGS(6) | GNC_HOW_RND_ROUND_HALF_UP);
-        string_amount = xaccPrintAmount (cf, gnc_split_amount_print_info (split, FALSE));
-    }
-    else
-        string_amount = xaccPrintAmount (xaccSplitGetSharePrice (split), gnc_split_amount_print_info (split, FALSE));
-
-    conv = csv_txn_test_field_string (info, string_amount);
-    result = g_strconcat (so_far, conv, info->end_sep, EOLSTR, NULL);
-    g_free (conv);
-    return result;
+    g_string_append (line, info->mid_sep);
+    g_string_append (line, info->end_sep);
+    g_string_append (line, EOLSTR);
 }
 
-// Transaction End of Line
-static gchar*
-add_trans_eol (gchar *so_far, CsvExportInfo *info)
+static const gchar *
+string_or_empty (const gchar *string)
 {
-    gchar *result = g_strconcat (so_far, "", info->mid_sep, "", info->end_sep, EOLSTR, NULL);
-
-    g_free (so_far);
-    return result;
+    return string ? string : "";
 }
 
 /******************************************************************************/
 
-static gchar*
-make_simple_trans_line (Account *acc, Transaction *trans, Split *split, CsvExportInfo *info)
+static void
+make_simple_trans_line (GString *line, Account *acc, Transaction *trans, Split *split, CsvExportInfo *info)
 {
     gboolean t_void = xaccTransGetVoidStatus (trans);
 
-    gchar *result = begin_trans_string (trans, info);
-    result = add_account_name (result, acc, NULL, TRUE, info);
-    result = add_number (result, trans, info);
-    result = add_description (result, trans, info);
-    result = add_category (result, split, TRUE, info);
-    result = add_reconcile (result, split, info);
-    result = add_amount (result, split, t_void, TRUE, TRANS_SIMPLE, info);
-    result = add_amount (result, split, t_void, FALSE, TRANS_SIMPLE, info);
-    result = add_rate (result, split, t_void, info);
-    return result;
+    begin_trans_string (line, trans, info);
+    add_account_name (line, acc, NULL, TRUE, info);
+    add_field (line, string_or_empty (xaccTransGetNum (trans)), info);
+    add_field (line, string_or_empty (xaccTransGetDescription (trans)), info);
+    add_category (line, split, TRUE, info);
+    add_reconcile (line, split, info);
+    add_amount (line, split, t_void, TRUE, TRANS_SIMPLE, info);
+    add_amount (line, split, t_void, FALSE, TRANS_SIMPLE, info);
+    // Rate
+    add_price (line, t_void ? gnc_numeric_zero () : xaccSplitGetSharePrice (split), split, info);
 }
 
-static gchar*
-make_complex_trans_line (Account *acc, Transaction *trans, Split *split, CsvExportInfo *info)
+static void
+make_complex_trans_line (GString *line, Account *acc, Transaction *trans, Split *split, CsvExportInfo *info)
 {
     gboolean t_void = xaccTransGetVoidStatus (trans);
-
-    gchar *result = begin_trans_string (trans, info);
-    result = add_type (result, trans, info);
-    result = add_second_date (result, trans, info);
-    result = add_account_name (result, acc, NULL, FALSE, info);
-    result = add_number (result, trans, info);
-    result = add_description (result, trans, info);
-    result = add_notes (result, trans, info);
-    result = add_memo (result, split, info);
-    result = add_category (result, split, TRUE, info);
-    result = add_category (result, split, FALSE, info);
-    result = add_line_type (result, TRANS_COMPLEX, info);
-    result = add_action (result,split, TRANS_COMPLEX, info);
-    result = add_reconcile (result, split, info);
-    result = add_amount (result, split, t_void, TRUE, TRANS_COMPLEX, info);
-    result = add_comm_mnemonic (result, trans, NULL, info);
-    result = add_comm_namespace (result, trans, NULL, info);
-    result = add_trans_eol (result, info);
-    return result;
+    gnc_commodity *comm = line_commodity (trans, NULL);
+
+    begin_trans_string (line, trans, info);
+    add_type (line, trans, info);
+    add_second_date (line, trans, info);
+    add_account_name (line, acc, NULL, FALSE, info);
+    add_field (line, string_or_empty (xaccTransGetNum (trans)), info);
+    add_field (line, string_or_empty (xaccTransGetDescription (trans)), info);
+    add_field (line, string_or_empty (xaccTransGetNotes (trans)), info);
+    add_field (line, string_or_empty (xaccSplitGetMemo (split)), info);
+    add_category (line, split, TRUE, info);
+    add_category (line, split, FALSE, info);
+    add_line_type (line, TRANS_COMPLEX, info);
+    add_action (line, split, TRANS_COMPLEX, info);
+    add_reconcile (line, split, info);
+    add_amount (line, split, t_void, TRUE, TRANS_COMPLEX, info);
+    add_field (line, gnc_commodity_get_mnemonic (comm), info);
+    add_field (line, gnc_commodity_get_namespace (comm), info);
+    add_trans_eol (line, info);
 }
 
-static gchar*
-make_complex_split_line (Transaction *trans, Split *split, CsvExportInfo *info)
+static void
+make_complex_split_line (GString *line, Transaction *trans, Split *split, CsvExportInfo *info)
 {
     gboolean t_void = xaccTransGetVoidStatus (trans);
+    gnc_commodity *comm = line_commodity (trans, split);
+    gnc_numeric price;
+
+    begin_split_string (line, trans, split, t_void, info);
+    add_field (line, string_or_empty (xaccSplitGetMemo (split)), info);
+    add_account_name (line, NULL, split, TRUE, info);
+    add_account_name (line, NULL, split, FALSE, info);
+    add_line_type (line, SPLIT_LINE, info);
+    add_action (line, split, SPLIT_LINE, info);
+    add_reconcile (line, split, info);
+    add_amount (line, split, t_void, TRUE, SPLIT_LINE, info);
+    add_field (line, gnc_commodity_get_mnemonic (comm), info);
+    add_field (line, gnc_commodity_get_namespace (comm), info);
+    add_amount (line, split, t_void, FALSE, SPLIT_LINE, info);
+    if (t_void)
+        price = gnc_numeric_div (xaccSplitVoidFormerValue (split), xaccSplitVoidFormerAmount (split), GNC_DENOM_AUTO,
+                                 GNC_HOW_DENOM_SIGFIGS(6) | GNC_HOW_RND_ROUND_HALF_UP);
+    else
+        price = xaccSplitGetSharePrice (split);
+    add_price (line, price, split, info);
+}
+
+/* The CsvExportFormatFunc of the transactions: a single line for the
+ * simple layout, else the transaction line and one line per split. */
+static void
+format_trans (GString *text, gpointer item, CsvExportInfo *info)
+{
+    CsvExportTrans *export_trans = item;
+    Transaction *trans = export_trans->trans;
+    GList *node;
+
+    if (info->simple_layout)
+    {
+        make_simple_trans_line (text, export_trans->acc, trans, export_trans->split, info);
+        return;
+    }
 
-    gchar *result = begin_split_string (trans, split, t_void, info);
-    result = add_memo (result, split, info);
-    result = add_account_name (result, NULL, split, TRUE, info);
-    result = add_account_name (result, NULL, split, FALSE, info);
-    result = add_line_type (result, SPLIT_LINE, info);
-    result = add_action (result,split, SPLIT_LINE, info);
-    result = add_reconcile (result, split, info);
-    result = add_amount (result, split, t_void, TRUE, SPLIT_LINE, info);
-    result = add_comm_mnemonic (result, trans, split, info);
-    result = add_comm_namespace (result, trans, split, info);
-    result = add_amount (result, split, t_void, FALSE, SPLIT_LINE, info);
-    result = add_price (result, split, t_void, info);
-    return result;
+    make_complex_trans_line (text, export_trans->acc, trans, export_trans->split, info);
+    for (node = xaccTransGetSplitList (trans); node; node = node->next)
+        make_complex_split_line (text, trans, node->data, info);
 }
 
 
 /*******************************************************
  * account_splits
  *
- * gather the splits / transactions for an account and
- * send them to a file
+ * gather the transactions of an account not yet in
+ * exported, in the order they are to be written
  *******************************************************/
 static
-void account_splits (CsvExportInfo *info, Account *acc, FILE *fh )
+void account_splits (CsvExportInfo *info, Account *acc, GPtrArray *items,
+                     GHashTable *exported)
 {
     GSList  *p1, *p2;
     GList   *splits;
@@ -602,77 +407,31 @@ void account_splits (CsvExportInfo *info, Account *acc, FILE *fh )
     /* Run the query */
     for (splits = qof_query_run (info->query); splits; splits = splits->next)
     {
-        Split       *split;
-        Transaction *trans;
-        SplitList   *s_list;
-        GList       *node;
-        Split       *t_split;
-        int          nSplits;
-        int          cnt;
-        gchar       *line;
-
-        split = splits->data;
-        trans = xaccSplitGetParent (split);
-        nSplits = xaccTransCountSplits (trans);
-        s_list = xaccTransGetSplitList (trans);
-
-        // Look for trans already exported in trans_list
-        if (g_list_find (info->trans_list, trans) != NULL)
+        Split          *split = splits->data;
+        Transaction    *trans = xaccSplitGetParent (split);
+        CsvExportTrans *export_trans;
+
+        // Look for trans already exported
+        if (g_hash_table_lookup (exported, trans))
             continue;
 
         // Look for blank split
         if (xaccSplitGetAccount (split) == NULL)
             continue;
 
-        // This will be a simple layout equivalent to a single line register view.
-        if (info->simple_layout)
-        {
-            line = make_simple_trans_line (acc, trans, split, info);
-
-            /* Write to file */
-            if (!write_line_to_file (fh, line))
-            {
-                info->failed = TRUE;
-                break;
-            }
-            g_free (line);
-            continue;
-        }
-
-        // Complex Transaction Line.
-        line = make_complex_trans_line (acc, trans, split, info);
-
-        /* Write to file */
-        if (!write_line_to_file (fh, line))
-        {
-            info->failed = TRUE;
-            break;
-        }
-        g_free (line);
-
-        /* Loop through the list of splits for the Transaction */
-        node = s_list;
-        cnt = 0;
-        while ((cnt < nSplits) && (info->failed == FALSE))
-        {
-            t_split = node->data;
-
-            // Complex Split Line.
-            line = make_complex_split_line (trans, t_split, info);
-
-            if (!write_line_to_file (fh, line))
-                info->failed = TRUE;
+        export_trans = g_new (CsvExportTrans, 1);
+        export_trans->acc = acc;
+        export_trans->trans = trans;
+        export_trans->split = split;
+        g_ptr_array_add (items, export_trans);
 
-            g_free (line);
-
-            cnt++;
-            node = node->next;
-        }
-        info->trans_list = g_list_prepend (info->trans_list, trans); // add trans to trans_list
+        /* A simple layout line is that of a single line register view,
+         * one per split, so the transaction can be exported again. */
+        if (!info->simple_layout)
+            g_hash_table_insert (exported, trans, trans);
     }
     if (info->export_type == XML_EXPORT_TRANS)
         qof_query_destroy (info->query);
-    g_list_free (splits);
 }
 
 
@@ -686,6 +445,8 @@ void csv_transactions_export (CsvExportInfo *info)
     FILE    *fh;
     Account *acc;
     GList   *ptr;
+    GPtrArray *items;
+    GHashTable *exported;
     gboolean num_action = qof_book_use_split_action_for_num_field (gnc_get_current_book());
 
     ENTER("");
@@ -710,7 +471,6 @@ void csv_transactions_export (CsvExportInfo *info)
     if (fh != NULL)
     {
         gchar *header;
-        int i;
 
         /* Header string */
         if (info->simple_layout)
@@ -741,24 +501,33 @@ void csv_transactions_export (CsvExportInfo *info)
         {
             info->failed = TRUE;
             g_free (header);
+            fclose (fh);
             return;
         }
         g_free (header);
 
+        /* Which account each transaction is exported from depends on
+         * the order of the accounts, so that is settled first; the
+         * lines are then formatted in parallel. */
+        items = g_ptr_array_new_with_free_func (g_free);
+        exported = g_hash_table_new (g_direct_hash, g_direct_equal);
         if (info->export_type == XML_EXPORT_TRANS)
         {
             /* Go through list of accounts */
-            for (ptr = info->csva.account_list, i = 0; ptr; ptr = g_list_next(ptr), i++)
+            for (ptr = info->csva.account_list; ptr; ptr = g_list_next(ptr))
             {
                 acc = ptr->data;
                 DEBUG("Account being processed is : %s", xaccAccountGetName (acc));
-                account_splits (info, acc, fh);
+                account_splits (info, acc, items, exported);
             }
         }
         else
-            account_splits (info, info->account, fh);
+            account_splits (info, info->account, items, exported);
+        g_hash_table_destroy (exported);
 
-        g_list_free (info->trans_list); // free trans_list
+        if (!csv_export_write_items (fh, items, format_trans, info))
+            info->failed = TRUE;
+        g_ptr_array_free (items, TRUE);
     }
     else
         info->failed = TRUE;
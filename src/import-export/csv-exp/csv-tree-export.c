@@ -34,18 +34,11 @@
 #include "gnc-ui-util.h"
 
 #include "csv-tree-export.h"
+#include "csv-export-helpers.h"
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_ASSISTANT;
 
-/* CSV spec requires CRLF line endings. Tweak the end-of-line string so this
- * true for each platform */
-#ifdef G_OS_WIN32
-# define EOLSTR "\n"
-#else
-# define EOLSTR "\r\n"
-#endif
-
 /******************************************************************/
 
 /*******************************************************
@@ -70,40 +63,64 @@ gboolean write_line_to_file (FILE *fh, char * line)
         return TRUE;
 }
 
+static const gchar *
+string_or_empty (const gchar *string)
+{
+    return string ? string : "";
+}
+
 /*******************************************************
- * csv_test_field_string
+ * format_account
  *
- * Test the field string for ," and new lines
+ * The CsvExportFormatFunc of the account tree: one line
+ * with the settings of the account
  *******************************************************/
-static
-gchar *csv_test_field_string (CsvExportInfo *info, const gchar *string_in)
+static void
+format_account (GString *line, gpointer item, CsvExportInfo *info)
 {
-    gboolean need_quote = FALSE;
-    gchar **parts;
-    gchar *string_parts;
-    gchar *string_out;
-
-    /* Check for " and then "" them */
-    parts = g_strsplit (string_in, "\"", -1);
-    string_parts = g_strjoinv ("\"\"", parts);
-    g_strfreev (parts);
-
-    /* Check for separator string and \n and " in field,
-       if so quote field if not allready quoted */
-    if (g_strrstr (string_parts, info->separator_str) != NULL)
-        need_quote = TRUE;
-    if (g_strrstr (string_parts, "\n") != NULL)
-        need_quote = TRUE;
-    if (g_strrstr (string_parts, "\"") != NULL)
-        need_quote = TRUE;
-
-    if (!info->use_quotes && need_quote)
-        string_out = g_strconcat ("\"", string_parts, "\"", NULL);
-    else
-        string_out = g_strdup (string_parts);
-
-    g_free (string_parts);
-    return string_out;
+    Account *acc = item;
+    gchar *fullname;
+
+    /* Type */
+    g_string_append (line, info->end_sep);
+    g_string_append (line, xaccAccountTypeEnumAsString (xaccAccountGetType (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Full Name */
+    fullname = gnc_account_get_full_name (acc);
+    csv_export_append_field (line, info, fullname);
+    g_string_append (line, info->mid_sep);
+    g_free (fullname);
+    /* Name */
+    csv_export_append_field (line, info, xaccAccountGetName (acc));
+    g_string_append (line, info->mid_sep);
+    /* Code */
+    csv_export_append_field (line, info, string_or_empty (xaccAccountGetCode (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Description */
+    csv_export_append_field (line, info, string_or_empty (xaccAccountGetDescription (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Color */
+    g_string_append (line, string_or_empty (xaccAccountGetColor (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Notes */
+    csv_export_append_field (line, info, string_or_empty (xaccAccountGetNotes (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Commodity Mnemonic */
+    csv_export_append_field (line, info, gnc_commodity_get_mnemonic (xaccAccountGetCommodity (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Commodity Namespace */
+    csv_export_append_field (line, info, gnc_commodity_get_namespace (xaccAccountGetCommodity (acc)));
+    g_string_append (line, info->mid_sep);
+    /* Hidden */
+    g_string_append (line, xaccAccountGetHidden (acc) ? "T" : "F");
+    g_string_append (line, info->mid_sep);
+    /* Tax */
+    g_string_append (line, xaccAccountGetTaxRelated (acc) ? "T" : "F");
+    g_string_append (line, info->mid_sep);
+    /* Place Holder / end of line marker */
+    g_string_append (line, xaccAccountGetPlaceholder (acc) ? "T" : "F");
+    g_string_append (line, info->end_sep);
+    g_string_append (line, EOLSTR);
 }
 
 /*******************************************************
@@ -115,7 +132,6 @@ void csv_tree_export (CsvExportInfo *info)
 {
     FILE    *fh;
     Account *root;
-    Account *acc;
     GList   *accts, *ptr;
 
     ENTER("");
@@ -131,124 +147,45 @@ void csv_tree_export (CsvExportInfo *info)
     if (fh != NULL)
     {
         gchar *header;
-        gchar *part1;
-        gchar *part2;
-        const gchar *currentSel;
-        gchar *end_sep;
-        gchar *mid_sep;
-        int i;
-
+        GPtrArray *items;
 
         /* Set up separators */
         if (info->use_quotes)
         {
-            end_sep = "\"";
-            mid_sep = g_strconcat ("\"", info->separator_str, "\"", NULL);
+            info->end_sep = "\"";
+            info->mid_sep = g_strconcat ("\"", info->separator_str, "\"", NULL);
         }
         else
         {
-            end_sep = "";
-            mid_sep = g_strconcat (info->separator_str, NULL);
+            info->end_sep = "";
+            info->mid_sep = g_strconcat (info->separator_str, NULL);
         }
 
         /* Header string, 'eol = end of line marker' */
-        header = g_strconcat (end_sep, _("type"), mid_sep, _("full_name"), mid_sep, _("name"), mid_sep,
-                                _("code"), mid_sep, _("description"), mid_sep, _("color"), mid_sep,
-                                _("notes"), mid_sep, _("commoditym"), mid_sep, _("commodityn"), mid_sep,
-                                _("hidden"), mid_sep, _("tax"), mid_sep, _("place_holder"), end_sep, EOLSTR, NULL);
+        header = g_strconcat (info->end_sep, _("type"), info->mid_sep, _("full_name"), info->mid_sep, _("name"), info->mid_sep,
+                                _("code"), info->mid_sep, _("description"), info->mid_sep, _("color"), info->mid_sep,
+                                _("notes"), info->mid_sep, _("commoditym"), info->mid_sep, _("commodityn"), info->mid_sep,
+                                _("hidden"), info->mid_sep, _("tax"), info->mid_sep, _("place_holder"), info->end_sep, EOLSTR, NULL);
         DEBUG("Header String: %s", header);
 
         /* Write header line */
         if (!write_line_to_file (fh, header))
         {
             info->failed = TRUE;
-            g_free (mid_sep);
             g_free (header);
+            fclose (fh);
+            g_list_free (accts);
             return;
         }
         g_free (header);
 
         /* Go through list of accounts */
-        for (ptr = accts, i = 0; ptr; ptr = g_list_next (ptr), i++)
-        {
-            gchar *fullname = NULL;
-            gchar *str_temp = NULL;
-            acc = ptr->data;
-            DEBUG("Account being processed is : %s", xaccAccountGetName (acc));
-            /* Type */
-            currentSel = xaccAccountTypeEnumAsString (xaccAccountGetType (acc));
-            part1 = g_strconcat (end_sep, currentSel, mid_sep, NULL);
-            /* Full Name */
-            fullname = gnc_account_get_full_name (acc);
-            str_temp = csv_test_field_string (info, fullname);
-            part2 = g_strconcat (part1, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (fullname);
-            g_free (part1);
-            /* Name */
-            currentSel = xaccAccountGetName (acc);
-            str_temp = csv_test_field_string (info, currentSel);
-            part1 = g_strconcat (part2, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part2);
-            /* Code */
-            currentSel = xaccAccountGetCode (acc) ? xaccAccountGetCode (acc) : "";
-            str_temp = csv_test_field_string (info, currentSel);
-            part2 = g_strconcat (part1, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part1);
-            /* Description */
-            currentSel = xaccAccountGetDescription (acc) ? xaccAccountGetDescription (acc) : "";
-            str_temp = csv_test_field_string (info, currentSel);
-            part1 = g_strconcat (part2, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part2);
-            /* Color */
-            currentSel = xaccAccountGetColor (acc) ? xaccAccountGetColor (acc) : "" ;
-            part2 = g_strconcat (part1, currentSel, mid_sep, NULL);
-            g_free (part1);
-            /* Notes */
-            currentSel = xaccAccountGetNotes (acc) ? xaccAccountGetNotes (acc) : "" ;
-            str_temp = csv_test_field_string (info, currentSel);
-            part1 = g_strconcat (part2, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part2);
-            /* Commodity Mnemonic */
-            currentSel = gnc_commodity_get_mnemonic (xaccAccountGetCommodity (acc));
-            str_temp = csv_test_field_string (info, currentSel);
-            part2 = g_strconcat (part1, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part1);
-            /* Commodity Namespace */
-            currentSel = gnc_commodity_get_namespace (xaccAccountGetCommodity (acc));
-            str_temp = csv_test_field_string (info, currentSel);
-            part1 = g_strconcat (part2, str_temp, mid_sep, NULL);
-            g_free (str_temp);
-            g_free (part2);
-            /* Hidden */
-            currentSel = xaccAccountGetHidden (acc) ? "T" : "F" ;
-            part2 = g_strconcat (part1, currentSel, mid_sep, NULL);
-            g_free (part1);
-            /* Tax */
-            currentSel = xaccAccountGetTaxRelated (acc) ? "T" : "F" ;
-            part1 = g_strconcat (part2, currentSel, mid_sep, NULL);
-            g_free (part2);
-            /* Place Holder / end of line marker */
-            currentSel = xaccAccountGetPlaceholder (acc) ? "T" : "F" ;
-            part2 = g_strconcat (part1, currentSel, end_sep, EOLSTR, NULL);
-            g_free (part1);
-
-            DEBUG("Account String: %s", part2);
-
-            /* Write to file */
-            if (!write_line_to_file (fh, part2))
-            {
-                info->failed = TRUE;
-                break;
-            }
-            g_free (part2);
-        }
-        g_free (mid_sep);
+        items = g_ptr_array_new ();
+        for (ptr = accts; ptr; ptr = g_list_next (ptr))
+            g_ptr_array_add (items, ptr->data);
+        if (!csv_export_write_items (fh, items, format_account, info))
+            info->failed = TRUE;
+        g_ptr_array_free (items, TRUE);
     }
     else
         info->failed = TRUE;
@@ -258,6 +195,3 @@ void csv_tree_export (CsvExportInfo *info)
     g_list_free (accts);
     LEAVE("");
 }
-
-
-
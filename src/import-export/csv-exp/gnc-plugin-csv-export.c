@@ -29,6 +29,10 @@
 #include "gnc-plugin-manager.h"
 
 #include "assistant-csv-export.h"
+#include "gnc-columnar-export.h"
+#include "gnc-file.h"
+#include "gnc-ui.h"
+#include "gnc-ui-util.h"
 
 #include "gnc-plugin-page-register.h"
 /*################## Added for Reg2 #################*/
@@ -44,6 +48,7 @@ static void gnc_plugin_csv_export_finalize (GObject *object);
 static void gnc_plugin_csv_export_tree_cmd (GtkAction *action, GncMainWindowActionData *data);
 static void gnc_plugin_csv_export_trans_cmd (GtkAction *action, GncMainWindowActionData *data);
 static void gnc_plugin_csv_export_register_cmd (GtkAction *action, GncMainWindowActionData *data);
+static void gnc_plugin_csv_export_columnar_cmd (GtkAction *action, GncMainWindowActionData *data);
 
 #define PLUGIN_ACTIONS_NAME "gnc-plugin-csv-export-actions"
 #define PLUGIN_UI_FILENAME  "gnc-plugin-csv-export-ui.xml"
@@ -65,6 +70,11 @@ static GtkActionEntry gnc_plugin_actions [] =
         N_("Export the Active Register to a CSV file"),
         G_CALLBACK (gnc_plugin_csv_export_register_cmd)
     },
+    {
+        "ColumnarExportBookAction", GTK_STOCK_CONVERT, N_("Export _Book to Columnar File..."), NULL,
+        N_("Export the accounts, transactions, splits, prices and lots as typed columns for analysis tools"),
+        G_CALLBACK (gnc_plugin_csv_export_columnar_cmd)
+    },
 };
 static guint gnc_plugin_n_actions = G_N_ELEMENTS (gnc_plugin_actions);
 
@@ -195,6 +205,27 @@ gnc_plugin_csv_export_register_cmd (GtkAction *action,
 /*################## Added for Reg2 #################*/
 }
 
+static void
+gnc_plugin_csv_export_columnar_cmd (GtkAction *action,
+                                    GncMainWindowActionData *data)
+{
+    gchar *filename;
+    gboolean written;
+
+    filename = gnc_file_dialog (_("Export Book to Columnar File"), NULL, NULL,
+                                GNC_FILE_DIALOG_EXPORT);
+    if (!filename)
+        return;
+
+    gnc_set_busy_cursor (NULL, TRUE);
+    written = gnc_book_export_columnar (gnc_get_current_book (), filename, 0);
+    gnc_unset_busy_cursor (NULL);
+    if (!written)
+        gnc_error_dialog (GTK_WIDGET (data->window),
+                          _("The book could not be written to %s."), filename);
+    g_free (filename);
+}
+
 /************************************************************
  *                    Plugin Bootstrapping                   *
  ************************************************************/
@@ -38,13 +38,13 @@
 #include "gnc-csv-account-map.h"
 
 #include "gnc-ui-util.h"
+#include "gnc-locale-utils.h"
 #include "engine-helpers.h"
 
 #include <string.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <regex.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -98,195 +98,147 @@ static StfParseOptions_t* default_parse_options (void)
     return options;
 }
 
-/** Parses a string into a date, given a format. The format must
- * include the year. This function should only be called by
- * parse_date.
+/** A scanner for one of the formats in date_format_user. Dates are
+ * written as up to three numbers separated by one of "-/.'", with
+ * optional spaces around the numbers; formats with a year also accept
+ * eight digits without separators. Anything following the last number
+ * is ignored.
+ */
+typedef struct
+{
+    int n_fields;   /**< 3 for formats with a year, 2 without */
+    char order[3];  /**< 'y', 'm' and 'd' in the order they are written */
+} DateParser;
+
+/* One entry for each format in date_format_user, in the same order. */
+static const DateParser date_parsers[] = {{3, {'y', 'm', 'd'}},
+                                          {3, {'d', 'm', 'y'}},
+                                          {3, {'m', 'd', 'y'}},
+                                          {2, {'d', 'm'}},
+                                          {2, {'m', 'd'}}
+                                         };
+
+/** The longest number accepted in a date field */
+#define DATE_FIELD_MAX_DIGITS 4
+
+/** Reads the numbers of a date with separators from date_str.
  * @param date_str The string containing a date being parsed
- * @param format An index specifying a format in date_format_user
- * @return The parsed value of date_str on success or -1 on failure
+ * @param n_fields The number of fields to read
+ * @param fields Returns the value of each field in the order written
+ * @return TRUE if date_str starts with n_fields numbers, FALSE otherwise
  */
-static time64 parse_date_with_year (const char* date_str, int format)
+static gboolean scan_date_fields (const char* date_str, int n_fields, int* fields)
 {
+    const char* p = date_str;
+    int i;
 
-    int i, j, mem_length, year = -1, month = -1, day = -1;
-    Timespec ts;
-    /* Buffer for containing individual parts (e.g. year, month, day) of a date */
-    char date_segment[5];
-
-    /* The compiled regular expression */
-    regex_t preg = {0};
-
-    /* An array containing indices specifying the matched substrings in date_str */
-    regmatch_t pmatch[4] = { {0}, {0}, {0}, {0} };
-
-    /* The regular expression for parsing dates */
-    const char* regex = "^ *([0-9]+) *[-/.'] *([0-9]+) *[-/.'] *([0-9]+).*$|^ *([0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9]).*$";
-
-    /* We get our matches using the regular expression. */
-    regcomp (&preg, regex, REG_EXTENDED);
-    regexec (&preg, date_str, 4, pmatch, 0);
-    regfree (&preg);
-
-    /* If there wasn't a match, there was an error. */
-    if (pmatch[0].rm_eo == 0)
-        return -1;
-
-    /* If this is a string without separators ... */
-    if (pmatch[1].rm_so == -1)
+    for (i = 0; i < n_fields; i++)
     {
-        /* ... we will fill in the indices based on the user's selection. */
-        int k = 0; /* k traverses date_str by keeping track of where separators "should" be. */
-        j = 1; /* j traverses pmatch. */
-        for (i = 0; date_format_user[format][i]; i++)
-        {
-            char segment_type = date_format_user[format][i];
-            /* Only do something if this is a meaningful character */
-            if (segment_type == 'y' || segment_type == 'm' || segment_type == 'd')
-            {
-                pmatch[j].rm_so = k;
-                switch (segment_type)
-                {
-                case 'm':
-                case 'd':
-                    k += 2;
-                    break;
-
-                case 'y':
-                    k += 4;
-                    break;
-                }
+        int digits = 0, value = 0;
 
-                pmatch[j].rm_eo = k;
-                j++;
-            }
+        while (*p == ' ')
+            p++;
+        if (i > 0)
+        {
+            if (*p != '-' && *p != '/' && *p != '.' && *p != '\'')
+                return FALSE;
+            p++;
+            while (*p == ' ')
+                p++;
         }
-    }
-
-    /* j traverses pmatch (index 0 contains the entire string, so we
-     * start at index 1 for the first meaningful match). */
-    j = 1;
-    /* Go through the date format and interpret the matches in order of
-     * the sections in the date format. */
-    for (i = 0; date_format_user[format][i]; i++)
-    {
-        char segment_type = date_format_user[format][i];
-        /* Only do something if this is a meaningful character */
-        if (segment_type == 'y' || segment_type == 'm' || segment_type == 'd')
+        for (; g_ascii_isdigit (*p); p++)
         {
-            /* Copy the matching substring into date_segment so that we can
-             * convert it into an integer. */
-            mem_length = pmatch[j].rm_eo - pmatch[j].rm_so;
-            memcpy (date_segment, date_str + pmatch[j].rm_so, mem_length);
-            date_segment[mem_length] = '\0';
-
-            /* Set the appropriate member of retvalue. Save the original
-             * values so that we can check if they change when we use gnc_mktime
-             * below. */
-            switch (segment_type)
-            {
-            case 'y':
-                year = atoi (date_segment);
+            if (++digits > DATE_FIELD_MAX_DIGITS)
+                return FALSE;
+            value = value * 10 + (*p - '0');
+        }
+        if (digits == 0)
+            return FALSE;
+        fields[i] = value;
+    }
+    return TRUE;
+}
 
-                /* Handle two-digit years. */
-                if (year < 100)
-                {
-                    /* We allow two-digit years in the range 1969 - 2068. */
-                    if (year < 69)
-                        year += 2000;
-                    else
-                        year += 1900;
-                }
-                break;
+/** Reads the fields of a date written as eight digits without
+ * separators, four for the year and two each for the month and day.
+ * @param date_str The string containing a date being parsed
+ * @param parser The format of date_str
+ * @param fields Returns the value of each field in the order written
+ * @return TRUE if date_str starts with eight digits, FALSE otherwise
+ */
+static gboolean scan_date_compact (const char* date_str, const DateParser* parser,
+                                   int* fields)
+{
+    const char* p = date_str;
+    int i, j;
 
-            case 'm':
-                month =atoi (date_segment);
-                break;
+    while (*p == ' ')
+        p++;
+    for (i = 0; i < 8; i++)
+        if (!g_ascii_isdigit (p[i]))
+            return FALSE;
 
-            case 'd':
-                day = atoi (date_segment);
-                break;
-            }
-            j++;
-        }
+    for (i = 0; i < parser->n_fields; i++)
+    {
+        int length = parser->order[i] == 'y' ? 4 : 2;
+        fields[i] = 0;
+        for (j = 0; j < length; j++, p++)
+            fields[i] = fields[i] * 10 + (*p - '0');
     }
-    ts = gnc_dmy2timespec_neutral(day, month, year);
-    return ts.tv_sec;
+    return TRUE;
 }
 
-/** Parses a string into a date, given a format. The format cannot
- * include the year. This function should only be called by
- * parse_date.
+/** Parses a string into a date with a parser from date_parsers.
  * @param date_str The string containing a date being parsed
- * @param format An index specifying a format in date_format_user
+ * @param parser The format of date_str
  * @return The parsed value of date_str on success or -1 on failure
  */
-static time64 parse_date_without_year (const char* date_str, int format)
+static time64 parse_date_with_parser (const char* date_str, const DateParser* parser)
 {
     Timespec ts;
-    int i, j, mem_length, year = -1, month = -1, day = -1;
-
-    /* Buffer for containing individual parts (e.g. year, month, day) of a date */
-    gchar* date_segment;
-
-    /* The compiled regular expression */
-    regex_t preg = {0};
-
-    /* An array containing indices specifying the matched substrings in date_str */
-    regmatch_t pmatch[3] = { {0}, {0}, {0} };
-
-    /* The regular expression for parsing dates */
-    const char* regex = "^ *([0-9]+) *[-/.'] *([0-9]+).*$";
-
-    /* We get our matches using the regular expression. */
-    regcomp (&preg, regex, REG_EXTENDED);
-    regexec (&preg, date_str, 3, pmatch, 0);
-    regfree (&preg);
-    /* Set day, month, and year to today. We'll replace day & month with the
-     * values from the string.
-     */
-    gnc_timespec2dmy(timespec_now(), &day, &month, &year);
-    /* If there wasn't a match, there was an error. */
-    if (pmatch[0].rm_eo == 0)
+    int fields[3];
+    int i, year = -1, month = -1, day = -1;
+
+    if (!scan_date_fields (date_str, parser->n_fields, fields)
+        && (parser->n_fields < 3
+            || !scan_date_compact (date_str, parser, fields)))
         return -1;
 
-    /* j traverses pmatch (index 0 contains the entire string, so we
-     * start at index 1 for the first meaningful match). */
-    j = 1;
-    /* Go through the date format and interpret the matches in order of
-     * the sections in the date format. */
-    for (i = 0; date_format_user[format][i]; i++)
+    /* Without a year in the format we use today's. */
+    if (parser->n_fields < 3)
+        gnc_timespec2dmy (timespec_now(), &day, &month, &year);
+
+    for (i = 0; i < parser->n_fields; i++)
     {
-        char segment_type = date_format_user[format][i];
-        /* Only do something if this is a meaningful character */
-        if (segment_type == 'm' || segment_type == 'd')
+        switch (parser->order[i])
         {
-            /* Copy the matching substring into date_segment so that we can
-             * convert it into an integer. */
-            mem_length = pmatch[j].rm_eo - pmatch[j].rm_so;
-            date_segment = g_new (gchar, mem_length);
-            memcpy(date_segment, date_str + pmatch[j].rm_so, mem_length);
-            date_segment[mem_length] = '\0';
-
-            /* Set the appropriate member of retvalue. Save the original
-             * values so that we can check if they change when we use gnc_mktime
-             * below. */
-            switch (segment_type)
-            {
-            case 'm':
-                month = atoi (date_segment);
-                break;
+        case 'y':
+            year = fields[i];
 
-            case 'd':
-                day = atoi (date_segment);
-                break;
+            /* Handle two-digit years. */
+            if (year < 100)
+            {
+                /* We allow two-digit years in the range 1969 - 2068. */
+                if (year < 69)
+                    year += 2000;
+                else
+                    year += 1900;
             }
-            g_free (date_segment);
-            j++;
+            break;
+
+        case 'm':
+            month = fields[i];
+            break;
+
+        case 'd':
+            day = fields[i];
+            break;
         }
     }
-    if (month > 12 || day > 31)
+
+    if (parser->n_fields < 3 && (month > 12 || day > 31))
         return -1;
-    ts = gnc_dmy2timespec_neutral(day, month, year);
+    ts = gnc_dmy2timespec_neutral (day, month, year);
     return ts.tv_sec;
 }
 
@@ -300,10 +252,7 @@ static time64 parse_date_without_year (const char* date_str, int format)
  */
 time64 parse_date (const char* date_str, int format)
 {
-    if (strchr (date_format_user[format], 'y'))
-        return parse_date_with_year (date_str, format);
-    else
-        return parse_date_without_year (date_str, format);
+    return parse_date_with_parser (date_str, &date_parsers[format]);
 }
 
 /** Constructor for GncCsvParseData.
@@ -352,7 +301,7 @@ void gnc_csv_parse_data_free (GncCsvParseData* parse_data)
         stf_parse_general_free (parse_data->orig_lines);
 
     if (parse_data->orig_row_lengths != NULL)
-        g_array_free (parse_data->orig_row_lengths, FALSE);
+        g_array_free (parse_data->orig_row_lengths, TRUE);
 
     if (parse_data->options != NULL)
         stf_parse_options_free (parse_data->options);
@@ -401,11 +350,31 @@ int gnc_csv_convert_encoding (GncCsvParseData* parse_data, const char* encoding,
     if (parse_data->file_str.begin != NULL)
         g_free(parse_data->file_str.begin);
 
+    /* Data that is already UTF-8 only needs checking, which is much
+     * faster than running it through iconv. */
+    if (g_ascii_strcasecmp (encoding, "UTF-8") == 0)
+    {
+        gsize length = parse_data->raw_str.end - parse_data->raw_str.begin;
+        const gchar* invalid;
+
+        parse_data->file_str.begin = NULL;
+        if (!g_utf8_validate (parse_data->raw_str.begin, length, &invalid))
+        {
+            g_set_error (error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                         "%s", _("Invalid byte sequence in conversion input"));
+            return 1;
+        }
+        parse_data->file_str.begin = g_malloc (length + 1);
+        memcpy (parse_data->file_str.begin, parse_data->raw_str.begin, length);
+        parse_data->file_str.begin[length] = '\0';
+        bytes_written = length;
+    }
     /* Do the actual translation to UTF-8. */
-    parse_data->file_str.begin = g_convert (parse_data->raw_str.begin,
-                                           parse_data->raw_str.end - parse_data->raw_str.begin,
-                                           "UTF-8", encoding, &bytes_read, &bytes_written,
-                                           error);
+    else
+        parse_data->file_str.begin = g_convert (parse_data->raw_str.begin,
+                                               parse_data->raw_str.end - parse_data->raw_str.begin,
+                                               "UTF-8", encoding, &bytes_read, &bytes_written,
+                                               error);
     /* Handle errors that occur. */
     if (parse_data->file_str.begin == NULL)
         return 1;
@@ -491,7 +460,11 @@ int gnc_csv_parse (GncCsvParseData* parse_data, gboolean guessColTypes, GError**
     if (parse_data->orig_lines != NULL)
     {
         stf_parse_general_free (parse_data->orig_lines);
+        parse_data->orig_lines = NULL;
     }
+    /* The cells of the old lines are gone with them; otherwise
+     * every reparse would add another copy of the file to the chunk. */
+    g_string_chunk_clear (parse_data->chunk);
 
     /* If everything is fine ... */
     if (parse_data->file_str.begin != NULL)
@@ -509,7 +482,7 @@ int gnc_csv_parse (GncCsvParseData* parse_data, gboolean guessColTypes, GError**
 
     /* Record the original row lengths of parse_data->orig_lines. */
     if (parse_data->orig_row_lengths != NULL)
-        g_array_free (parse_data->orig_row_lengths, FALSE);
+        g_array_free (parse_data->orig_row_lengths, TRUE);
 
     parse_data->orig_row_lengths =
         g_array_sized_new (FALSE, FALSE, sizeof(int), parse_data->orig_lines->len);
@@ -576,6 +549,7 @@ int gnc_csv_parse (GncCsvParseData* parse_data, gboolean guessColTypes, GError**
 typedef struct
 {
     int date_format; /**< The format for parsing dates */
+    const DateParser* date_parser; /**< The parser for date_format */
     int currency_format; /**< The format for currency */
     Account* account; /**< The account the transaction belongs to */
     GList* properties; /**< List of TransProperties */
@@ -634,13 +608,11 @@ static gboolean trans_property_set (TransProperty* prop, char* str)
 {
     char *endptr, *possible_currency_symbol, *str_dupe;
     gnc_numeric val;
-    int reti;
-    regex_t regex;
     switch (prop->type)
     {
     case GNC_CSV_DATE:
         prop->value = g_new(time64, 1);
-        *((time64*)(prop->value)) = parse_date(str, prop->list->date_format);
+        *((time64*)(prop->value)) = parse_date_with_parser (str, prop->list->date_parser);
         return *((time64*)(prop->value)) != -1;
 
     case GNC_CSV_DESCRIPTION:
@@ -660,9 +632,7 @@ static gboolean trans_property_set (TransProperty* prop, char* str)
     case GNC_CSV_WITHDRAWAL:
         str_dupe = g_strdup (str); /* First, we make a copy so we can't mess up real data. */
         /* If a cell is empty or just spaces make its value = "0" */
-        reti = regcomp(&regex, "[0-9]", 0);
-        reti = regexec(&regex, str_dupe, 0, NULL, 0);
-        if (reti == REG_NOMATCH)
+        if (strpbrk (str_dupe, "0123456789") == NULL)
         {
             g_free (str_dupe);
             str_dupe = g_strdup ("0");
@@ -737,6 +707,7 @@ static TransPropertyList* trans_property_list_new (Account* account, int date_fo
     TransPropertyList* list = g_new (TransPropertyList, 1);
     list->account = account;
     list->date_format = date_format;
+    list->date_parser = date_format < 0 ? NULL : &date_parsers[date_format];
     list->currency_format = currency_format;
     list->properties = NULL;
     return list;
@@ -1036,6 +1007,132 @@ static GncCsvTransLine* trans_property_list_to_trans (TransPropertyList* list, g
     return trans_line;
 }
 
+/** The properties parsed from one row by parse_row_properties. */
+typedef struct
+{
+    TransPropertyList* list;    /**< The row's properties, NULL if a column failed */
+    gchar* error_message;       /**< What failed if list is NULL */
+} GncCsvRowParse;
+
+/** Parses the cells of one row into a TransPropertyList without its
+ * account. This doesn't touch the engine, so it can run on a worker
+ * thread: "Account" and "Other Account" columns are left for the
+ * caller.
+ * @param parse_data Data that is being parsed
+ * @param row The row in parse_data->orig_lines
+ * @param result Where the properties or the error message go
+ */
+static void parse_row_properties (GncCsvParseData* parse_data, int row,
+                                  GncCsvRowParse* result)
+{
+    GPtrArray* line = parse_data->orig_lines->pdata[row];
+    GArray* column_types = parse_data->column_types;
+    TransPropertyList* list = trans_property_list_new (NULL, parse_data->date_format,
+                              parse_data->currency_format);
+    int j;
+
+    for (j = 0; j < line->len; j++)
+    {
+        TransProperty* property;
+        int type = column_types->data[j];
+
+        /* We do nothing in "None" or "Account" columns. */
+        if (type == GNC_CSV_NONE || type == GNC_CSV_ACCOUNT || type == GNC_CSV_OACCOUNT)
+            continue;
+
+        /* Affect the transaction appropriately. */
+        property = trans_property_new (type, list);
+        if (trans_property_set (property, line->pdata[j]))
+            trans_property_list_add (property);
+        else
+        {
+            result->error_message = g_strdup_printf (_("%s column could not be understood."),
+                                    _(gnc_csv_column_type_strs[property->type]));
+            trans_property_free (property);
+            trans_property_list_free (list);
+            return;
+        }
+    }
+    result->list = list;
+}
+
+/** The number of rows each task on the parsing thread pool handles. */
+#define CSV_PARSE_CHUNK_SIZE 256
+
+typedef struct
+{
+    GncCsvParseData* parse_data;
+    const int* rows;
+    GncCsvRowParse* results;
+    guint n_rows;
+    GAsyncQueue* done;
+} GncCsvParseChunk;
+
+static void parse_rows_chunk (gpointer data, gpointer user_data)
+{
+    GncCsvParseChunk* chunk = data;
+    guint k;
+
+    for (k = 0; k < chunk->n_rows; k++)
+        parse_row_properties (chunk->parse_data, chunk->rows[k], &chunk->results[k]);
+    g_async_queue_push (chunk->done, chunk);
+}
+
+static gint parse_rows_threads (void)
+{
+#if GLIB_CHECK_VERSION(2, 36, 0)
+    return g_get_num_processors ();
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#else
+    return 1;
+#endif
+}
+
+/** Parses the given rows with parse_row_properties, on a thread pool
+ * if there are enough of them to make it worthwhile.
+ * @param parse_data Data that is being parsed
+ * @param rows The rows to parse
+ * @param results One GncCsvRowParse for each of rows
+ */
+static void parse_rows (GncCsvParseData* parse_data, GArray* rows,
+                        GncCsvRowParse* results)
+{
+    GThreadPool* pool = NULL;
+    GAsyncQueue* done = g_async_queue_new ();
+    guint next, n_chunks = 0;
+    gint threads = parse_rows_threads ();
+
+    if (threads > 1 && rows->len >= 2 * CSV_PARSE_CHUNK_SIZE)
+    {
+        /* The locale data for parsing amounts is set up on first use. */
+        gnc_localeconv ();
+        /* Without a pool the chunks are parsed here, one at a time. */
+        pool = g_thread_pool_new (parse_rows_chunk, NULL, threads, FALSE, NULL);
+    }
+
+    for (next = 0; next < rows->len; next += CSV_PARSE_CHUNK_SIZE)
+    {
+        GncCsvParseChunk* chunk = g_new (GncCsvParseChunk, 1);
+        chunk->parse_data = parse_data;
+        chunk->rows = &g_array_index (rows, int, next);
+        chunk->results = results + next;
+        chunk->n_rows = MIN (CSV_PARSE_CHUNK_SIZE, rows->len - next);
+        chunk->done = done;
+        if (pool)
+            g_thread_pool_push (pool, chunk, NULL);
+        else
+            parse_rows_chunk (chunk, NULL);
+        n_chunks++;
+    }
+    for (; n_chunks > 0; n_chunks--)
+        g_free (g_async_queue_pop (done));
+
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+    g_async_queue_unref (done);
+}
+
 /** Creates a list of transactions from parsed data. Transactions that
  * could be created from rows are placed in parse_data->transactions;
  * rows that fail are placed in parse_data->error_lines. (Note: there
@@ -1051,8 +1148,14 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
 {
     gboolean hasBalanceColumn;
     int i, j, max_cols = 0;
+    guint r;
     GArray* column_types = parse_data->column_types;
+    /* The rows to convert, and their parsed cells */
+    GArray* rows;
+    GncCsvRowParse* parsed;
     GList *error_lines = NULL, *begin_error_lines = NULL;
+    /* The last element of parse_data->error_lines, for appending. */
+    GList *last_error_line = NULL;
     Account *home_account = NULL;
 
     /* last_transaction points to the last element in
@@ -1070,6 +1173,7 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
 
         if (parse_data->transactions != NULL)
             g_list_free (parse_data->transactions);
+        parse_data->transactions = NULL;
     }
     parse_data->error_lines = NULL;
 
@@ -1104,15 +1208,48 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
     if (parse_data->end_row > parse_data->orig_lines->len)
         parse_data->end_row = parse_data->orig_lines->len;
 
+    /* Collect the rows first ... */
+    rows = g_array_new (FALSE, FALSE, sizeof (int));
     while (i < parse_data->end_row)
     {
-        GPtrArray* line = parse_data->orig_lines->pdata[i];
+        g_array_append_val (rows, i);
+
+        /* Increment to the next row. */
+        if (redo_errors)
+        {
+            /* Move to the next error line in the list. */
+            error_lines = g_list_next (error_lines);
+            if (error_lines == NULL)
+                i = parse_data->orig_lines->len; /* Don't continue the for loop. */
+            else
+                i = GPOINTER_TO_INT(error_lines->data);
+        }
+        else
+        {
+            if (parse_data->skip_rows == FALSE)
+                i++;
+            else
+                i = i + 2;
+        }
+    }
+
+    /* ... then parse their dates, amounts and so on, on other threads if
+     * there are many, and only then look up the accounts and create the
+     * transactions here. */
+    parsed = g_new0 (GncCsvRowParse, rows->len);
+    parse_rows (parse_data, rows, parsed);
+
+    for (r = 0; r < rows->len; r++)
+    {
+        GPtrArray* line;
         /* This flag is TRUE if there are any errors in this row. */
         gboolean errors = FALSE;
         gchar* error_message = NULL;
-        TransPropertyList* list;
+        TransPropertyList* list = parsed[r].list;
         GncCsvTransLine* trans_line = NULL;
 
+        i = g_array_index (rows, int, r);
+        line = parse_data->orig_lines->pdata[i];
         home_account = account;
 
         // If account = NULL, we should have an Account column
@@ -1133,47 +1270,46 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
             error_message = g_strdup_printf (_("Account column could not be understood."));
             errors = TRUE;
         }
+        else if (list == NULL)
+        {
+            error_message = parsed[r].error_message;
+            parsed[r].error_message = NULL;
+            errors = TRUE;
+        }
         else
         {
-            list = trans_property_list_new (home_account, parse_data->date_format, parse_data->currency_format);
+            list->account = home_account;
 
+            /* The "Other Account" columns need the engine, so they are
+             * looked up here rather than with the rest of the row. */
             for (j = 0; j < line->len; j++)
             {
-                /* We do nothing in "None" or "Account" columns. */
-                if ((column_types->data[j] != GNC_CSV_NONE) && (column_types->data[j] != GNC_CSV_ACCOUNT))
+                if (column_types->data[j] == GNC_CSV_OACCOUNT)
                 {
-                    /* Affect the transaction appropriately. */
-                    TransProperty* property = trans_property_new (column_types->data[j], list);
-                    gboolean succeeded = trans_property_set (property, line->pdata[j]);
-
-                    /* TODO Maybe move error handling to within TransPropertyList functions? */
-                    if (succeeded)
-                        trans_property_list_add (property);
-                    else
-                    {
-                        errors = TRUE;
-                        error_message = g_strdup_printf (_("%s column could not be understood."),
-                                                        _(gnc_csv_column_type_strs[property->type]));
-                        trans_property_free (property);
-                        break;
-                    }
+                    TransProperty* property = trans_property_new (GNC_CSV_OACCOUNT, list);
+                    trans_property_set (property, line->pdata[j]);
+                    trans_property_list_add (property);
                 }
             }
 
             /* If we had success, add the transaction to parse_data->transaction. */
-            if (!errors)
-            {
-                trans_line = trans_property_list_to_trans (list, &error_message);
-                errors = trans_line == NULL;
-            }
-            trans_property_list_free (list);
+            trans_line = trans_property_list_to_trans (list, &error_message);
+            errors = trans_line == NULL;
         }
+        if (list != NULL)
+            trans_property_list_free (list);
+        g_free (parsed[r].error_message);
 
         /* If there were errors, add this line to parse_data->error_lines. */
         if (errors)
         {
-            parse_data->error_lines = g_list_append (parse_data->error_lines,
-                                                    GINT_TO_POINTER(i));
+            /* Appending at the known end keeps this linear in the
+             * number of rows. */
+            last_error_line = g_list_append (last_error_line, GINT_TO_POINTER(i));
+            if (parse_data->error_lines == NULL)
+                parse_data->error_lines = last_error_line;
+            else
+                last_error_line = g_list_next (last_error_line);
             /* If there's already an error message, we need to replace it. */
             if (line->len > (int)(parse_data->orig_row_lengths->data[i]))
             {
@@ -1200,12 +1336,17 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
             if (last_transaction == NULL ||
                     xaccTransGetDate (((GncCsvTransLine*)(last_transaction->data))->trans) <= xaccTransGetDate (trans_line->trans))
             {
-                parse_data->transactions = g_list_append (parse_data->transactions, trans_line);
                 /* If this is the first transaction, we need to get last_transaction on track. */
                 if (last_transaction == NULL)
+                {
+                    parse_data->transactions = g_list_append (parse_data->transactions, trans_line);
                     last_transaction = parse_data->transactions;
-                else /* Otherwise, we can just continue. */
+                }
+                else /* Otherwise, append after it and continue. */
+                {
+                    g_list_append (last_transaction, trans_line);
                     last_transaction = g_list_next (last_transaction);
+                }
             }
             /* Otherwise, search backward for the correct spot. */
             else
@@ -1226,25 +1367,9 @@ int gnc_csv_parse_to_trans (GncCsvParseData* parse_data, Account* account,
                 parse_data->transactions = g_list_insert_before (parse_data->transactions, insertion_spot, trans_line);
             }
         }
-
-        /* Increment to the next row. */
-        if (redo_errors)
-        {
-            /* Move to the next error line in the list. */
-            error_lines = g_list_next (error_lines);
-            if (error_lines == NULL)
-                i = parse_data->orig_lines->len; /* Don't continue the for loop. */
-            else
-                i = GPOINTER_TO_INT(error_lines->data);
-        }
-        else
-        {
-            if (parse_data->skip_rows == FALSE)
-                i++;
-            else
-                i = i + 2;
-        }
     }
+    g_free (parsed);
+    g_array_free (rows, TRUE);
 
     /* If we have a balance column, set the appropriate amounts on the transactions. */
     hasBalanceColumn = FALSE;
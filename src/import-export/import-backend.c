@@ -108,6 +108,20 @@ struct _matchinfo
     gboolean update_proposed;
 };
 
+struct _matchsession
+{
+    gint match_date_hardlimit;
+
+    /* GList of candidate Splits for each MatchBucketKey, in query order. */
+    GHashTable * candidates;
+};
+
+typedef struct
+{
+    Account * account;
+    gint64 day;
+} MatchBucketKey;
+
 /* Some simple getters and setters for the above data types. */
 
 GList *
@@ -806,62 +820,162 @@ static void split_find_match (GNCImportTransInfo * trans_info,
 }/* end split_find_match */
 
 
-/** /brief Iterate through all splits of the originating account of the given
-   transaction, and find all matching splits there. */
-void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
-                                   gint process_threshold,
-                                   double fuzzy_amount_difference,
-                                   gint match_date_hardlimit)
+/* The day number of a time, rounding towards the past. */
+static gint64
+match_day (time64 time)
 {
-    GList * list_element;
-    Query *query = qof_query_create_for(GNC_ID_SPLIT);
-    g_assert (trans_info);
+    return time >= 0 ? time / 86400 : (time - 86399) / 86400;
+}
+
+static guint
+match_bucket_key_hash (gconstpointer key)
+{
+    const MatchBucketKey *k = key;
+    return g_direct_hash (k->account) ^ (guint) k->day;
+}
+
+static gboolean
+match_bucket_key_equal (gconstpointer a, gconstpointer b)
+{
+    const MatchBucketKey *ka = a, *kb = b;
+    return ka->account == kb->account && ka->day == kb->day;
+}
 
-    /* Get list of splits of the originating account. */
+GNCImportMatchSession *
+gnc_import_MatchSession_new (GList *trans_infos, gint match_date_hardlimit)
+{
+    GNCImportMatchSession *session;
+    GList *accounts = NULL, *node;
+    time64 first = 0, last = 0;
+    Query *query;
+
+    session = g_new0 (GNCImportMatchSession, 1);
+    session->match_date_hardlimit = match_date_hardlimit;
+    session->candidates = g_hash_table_new_full (match_bucket_key_hash,
+                          match_bucket_key_equal,
+                          g_free, NULL);
+    if (trans_infos == NULL)
+        return session;
+
+    /* One query for the whole date range and all accounts in question,
+       instead of one for each imported transaction. */
+    for (node = trans_infos; node; node = node->next)
     {
-        /* We used to traverse *all* splits of the account by using
-           xaccAccountGetSplitList, which is a bad idea because 90% of these
-           splits are outside the date range that is interesting. We should
-           rather use a query according to the date region, which is
-           implemented here.
-        */
+        GNCImportTransInfo *trans_info = node->data;
         Account *importaccount =
             xaccSplitGetAccount (gnc_import_TransInfo_get_fsplit (trans_info));
-        time64 download_time = xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
-
-        qof_query_set_book (query, gnc_get_current_book());
-        xaccQueryAddSingleAccountMatch (query, importaccount,
-                                        QOF_QUERY_AND);
-        xaccQueryAddDateMatchTT (query,
-                                 TRUE, download_time - match_date_hardlimit * 86400,
-                                 TRUE, download_time + match_date_hardlimit * 86400,
-                                 QOF_QUERY_AND);
-        list_element = qof_query_run (query);
-        /* Sigh. Doesnt help too much. We still create and run one query
-           for each imported transaction. Maybe it would improve
-           performance further if there is one single (master-)query at
-           the beginning, matching the full date range and all accounts in
-           question. However, this doesnt quite work because this function
-           here is called from each gnc_gen_trans_list_add_trans(), which
-           is called one at a time. Therefore the whole importer would
-           have to change its behaviour: Accept the imported txns via
-           gnc_gen_trans_list_add_trans(), and only when
-           gnc_gen_trans_list_run() is called, then calculate all the
-           different match candidates. That's too much work for now.
-        */
+        time64 download_time =
+            xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+
+        if (!g_list_find (accounts, importaccount))
+            accounts = g_list_prepend (accounts, importaccount);
+        if (node == trans_infos || download_time < first)
+            first = download_time;
+        if (node == trans_infos || download_time > last)
+            last = download_time;
     }
 
-    /* Traverse that list, calling split_find_match on each one. Note
-       that xaccAccountForEachSplit is declared in Account.h but
-       implemented nowhere :-( */
-    while (list_element != NULL)
+    query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, gnc_get_current_book());
+    xaccQueryAddAccountMatch (query, accounts, QOF_GUID_MATCH_ANY,
+                              QOF_QUERY_AND);
+    xaccQueryAddDateMatchTT (query,
+                             TRUE, first - match_date_hardlimit * 86400,
+                             TRUE, last + match_date_hardlimit * 86400,
+                             QOF_QUERY_AND);
+
+    /* Walk the results backwards so that prepending keeps each bucket
+       in the query's order. */
+    for (node = g_list_last (qof_query_run (query)); node; node = node->prev)
     {
-        split_find_match (trans_info, list_element->data,
-                          process_threshold, fuzzy_amount_difference);
-        list_element = g_list_next (list_element);
+        Split *split = node->data;
+        MatchBucketKey *key = g_new (MatchBucketKey, 1);
+        GList *bucket;
+
+        key->account = xaccSplitGetAccount (split);
+        key->day = match_day (xaccTransGetDate (xaccSplitGetParent (split)));
+        bucket = g_hash_table_lookup (session->candidates, key);
+        g_hash_table_insert (session->candidates, key,
+                             g_list_prepend (bucket, split));
     }
 
     qof_query_destroy (query);
+    g_list_free (accounts);
+    return session;
+}
+
+void
+gnc_import_MatchSession_destroy (GNCImportMatchSession *session)
+{
+    GHashTableIter iter;
+    gpointer bucket;
+
+    if (!session) return;
+
+    g_hash_table_iter_init (&iter, session->candidates);
+    while (g_hash_table_iter_next (&iter, NULL, &bucket))
+        g_list_free (bucket);
+    g_hash_table_destroy (session->candidates);
+    g_free (session);
+}
+
+void
+gnc_import_MatchSession_find_split_matches (GNCImportMatchSession *session,
+        GNCImportTransInfo *trans_info,
+        gint process_threshold,
+        double fuzzy_amount_difference)
+{
+    MatchBucketKey key;
+    time64 download_time, first, last;
+    gint64 last_day;
+    g_assert (session);
+    g_assert (trans_info);
+
+    key.account =
+        xaccSplitGetAccount (gnc_import_TransInfo_get_fsplit (trans_info));
+    download_time = xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+    first = download_time - session->match_date_hardlimit * 86400;
+    last = download_time + session->match_date_hardlimit * 86400;
+    last_day = match_day (last);
+
+    /* Only the days within the hard limit; the first and last of them
+       may hold splits just outside of it. */
+    for (key.day = match_day (first); key.day <= last_day; key.day++)
+    {
+        GList *node = g_hash_table_lookup (session->candidates, &key);
+        for (; node; node = node->next)
+        {
+            Split *split = node->data;
+            time64 date = xaccTransGetDate (xaccSplitGetParent (split));
+            if (date < first || date > last)
+                continue;
+            split_find_match (trans_info, split,
+                              process_threshold, fuzzy_amount_difference);
+        }
+    }
+}
+
+/** /brief Iterate through all splits of the originating account of the given
+   transaction, and find all matching splits there. */
+void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
+                                   gint process_threshold,
+                                   double fuzzy_amount_difference,
+                                   gint match_date_hardlimit)
+{
+    GNCImportMatchSession *session;
+    GList *trans_infos;
+    g_assert (trans_info);
+
+    /* The importer matches all transactions at once through
+       gnc_import_TransInfo_init_matches_in_session(); this is the
+       single transaction case of it. */
+    trans_infos = g_list_prepend (NULL, trans_info);
+    session = gnc_import_MatchSession_new (trans_infos, match_date_hardlimit);
+    gnc_import_MatchSession_find_split_matches (session, trans_info,
+            process_threshold,
+            fuzzy_amount_difference);
+    gnc_import_MatchSession_destroy (session);
+    g_list_free (trans_infos);
 }
 
 
@@ -1082,66 +1196,23 @@ gnc_import_process_trans_item (GncImportMatchMap *matchmap,
     return FALSE;
 }
 
-/********************************************************************\
- * check_trans_online_id() Callback function used by
- * gnc_import_exists_online_id.  Takes pointers to transaction and split,
- * returns 0 if their online_ids  do NOT match, or if the split
- * belongs to the transaction
-\********************************************************************/
-static gint check_trans_online_id(Transaction *trans1, void *user_data)
-{
-    Account *account;
-    Split *split1;
-    Split *split2 = user_data;
-    const gchar *online_id1;
-    const gchar *online_id2;
-
-    account = xaccSplitGetAccount(split2);
-    split1 = xaccTransFindSplitByAccount(trans1, account);
-    if (split1 == split2)
-        return 0;
-
-    /* hack - we really want to iterate over the _splits_ of the account
-       instead of the transactions */
-    g_assert(split1 != NULL);
-
-    if (gnc_import_split_has_online_id(split1))
-        online_id1 = gnc_import_get_split_online_id(split1);
-    else
-        online_id1 = gnc_import_get_trans_online_id(trans1);
-
-    online_id2 = gnc_import_get_split_online_id(split2);
-
-    if ((online_id1 == NULL) ||
-            (online_id2 == NULL) ||
-            (strcmp(online_id1, online_id2) != 0))
-    {
-        return 0;
-    }
-    else
-    {
-        /*printf("test_trans_online_id(): Duplicate found\n");*/
-        return 1;
-    }
-}
-
 /** Checks whether the given transaction's online_id already exists in
   its parent account. */
 gboolean gnc_import_exists_online_id (Transaction *trans)
 {
-    gboolean online_id_exists = FALSE;
-    Account *dest_acct;
-    Split *source_split;
+    gboolean online_id_exists;
+    Split *source_split, *match;
+    gchar *online_id;
 
     /* Look for an online_id in the first split */
     source_split = xaccTransGetSplit(trans, 0);
     g_assert(source_split);
 
-    /* DEBUG("%s%d%s","Checking split ",i," for duplicates"); */
-    dest_acct = xaccSplitGetAccount(source_split);
-    online_id_exists = xaccAccountForEachTransaction(dest_acct,
-                       check_trans_online_id,
-                       source_split);
+    online_id = (gchar *) gnc_import_get_split_online_id(source_split);
+    match = gnc_account_find_split_by_online_id(xaccSplitGetAccount(source_split),
+            online_id);
+    online_id_exists = match && match != source_split;
+    g_free(online_id);
 
     /* If it does, abort the process for this transaction, since it is
        already in the system. */
@@ -1198,16 +1269,32 @@ static gint compare_probability (gconstpointer a,
 void
 gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                    GNCImportSettings *settings)
+{
+    GNCImportMatchSession *session;
+    GList *trans_infos;
+    g_assert (trans_info);
+
+    trans_infos = g_list_prepend (NULL, trans_info);
+    session = gnc_import_MatchSession_new (trans_infos,
+                                           gnc_import_Settings_get_match_date_hardlimit (settings));
+    gnc_import_TransInfo_init_matches_in_session (trans_info, settings, session);
+    gnc_import_MatchSession_destroy (session);
+    g_list_free (trans_infos);
+}
+
+void
+gnc_import_TransInfo_init_matches_in_session (GNCImportTransInfo *trans_info,
+        GNCImportSettings *settings,
+        GNCImportMatchSession *session)
 {
     GNCImportMatchInfo * best_match = NULL;
     g_assert (trans_info);
 
 
     /* Find all split matches in originating account. */
-    gnc_import_find_split_matches(trans_info,
-                                  gnc_import_Settings_get_display_threshold (settings),
-                                  gnc_import_Settings_get_fuzzy_amount (settings),
-                                  gnc_import_Settings_get_match_date_hardlimit (settings));
+    gnc_import_MatchSession_find_split_matches (session, trans_info,
+            gnc_import_Settings_get_display_threshold (settings),
+            gnc_import_Settings_get_fuzzy_amount (settings));
 
     if (trans_info->match_list != NULL)
     {
@@ -33,6 +33,7 @@
 
 typedef struct _transactioninfo GNCImportTransInfo;
 typedef struct _matchinfo GNCImportMatchInfo;
+typedef struct _matchsession GNCImportMatchSession;
 
 typedef enum _action
 {
@@ -100,6 +101,40 @@ void
 gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                    GNCImportSettings *settings);
 
+/** Collects, with one query, the candidate splits for matching all of
+ * the given transactions: every split in any of their originating
+ * accounts dated within match_date_hardlimit days of any of them. The
+ * candidates are indexed by account and day so that each transaction
+ * only looks at the splits within its own date window.
+ *
+ * The session is a snapshot; destroy it before the book changes.
+ *
+ * @param trans_infos A GList of the GNCImportTransInfos to be matched.
+ *
+ * @param match_date_hardlimit See gnc_import_find_split_matches().
+ */
+GNCImportMatchSession *
+gnc_import_MatchSession_new (GList *trans_infos, gint match_date_hardlimit);
+
+/** Frees a session made by gnc_import_MatchSession_new(). */
+void gnc_import_MatchSession_destroy (GNCImportMatchSession *session);
+
+/** Like gnc_import_find_split_matches(), but takes the candidates from
+ * the session instead of querying the book. trans_info must have been
+ * among the transactions the session was made for. */
+void gnc_import_MatchSession_find_split_matches (GNCImportMatchSession *session,
+        GNCImportTransInfo *trans_info,
+        gint process_threshold,
+        double fuzzy_amount_difference);
+
+/** Like gnc_import_TransInfo_init_matches(), but takes the candidates
+ * from the session.
+ */
+void
+gnc_import_TransInfo_init_matches_in_session (GNCImportTransInfo *trans_info,
+        GNCImportSettings *settings,
+        GNCImportMatchSession *session);
+
 /** This function is intended to be called when the importer dialog is
  * finished. It should be called once for each imported transaction
  * and processes each ImportTransInfo according to its selected action:
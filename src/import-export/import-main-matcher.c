@@ -48,6 +48,7 @@
 #include "import-backend.h"
 #include "import-account-matcher.h"
 #include "app-utils/gnc-component-manager.h"
+#include "TransLog.h"
 
 #define GNC_PREFS_GROUP "dialogs.import.generic.transaction-list"
 
@@ -63,6 +64,12 @@ struct _main_matcher_info
     int selected_row;
     GNCTransactionProcessedCB transaction_processed_cb;
     gpointer user_data;
+    /* Transactions added since the last matching, and the idle source
+       which matches them together. */
+    GList *pending_matches;
+    guint match_idle_id;
+    /* The confidence pixbufs, by score, made as rows are drawn. */
+    GHashTable *probability_pixbufs;
 };
 
 enum downloaded_cols
@@ -76,7 +83,6 @@ enum downloaded_cols
     DOWNLOADED_COL_ACTION_CLEAR,
     DOWNLOADED_COL_ACTION_UPDATE,
     DOWNLOADED_COL_ACTION_INFO,
-    DOWNLOADED_COL_ACTION_PIXBUF,
     DOWNLOADED_COL_DATA,
     DOWNLOADED_COL_COLOR,
     NUM_DOWNLOADED_COLS
@@ -88,6 +94,10 @@ enum downloaded_cols
 
 static QofLogModule log_module = GNC_MOD_IMPORT;
 
+/* The GUIDs of the transactions that the matcher added the last time it
+   was run, for gnc_gen_trans_list_get_last_imported(). */
+static GList *last_imported = NULL;
+
 void on_matcher_ok_clicked (GtkButton *button, GNCImportMainMatcher *info);
 void on_matcher_cancel_clicked (GtkButton *button, gpointer user_data);
 void on_matcher_help_clicked (GtkButton *button, gpointer user_data);
@@ -97,16 +107,32 @@ void on_matcher_help_close_clicked (GtkButton *button, gpointer user_data);
 static void
 refresh_model_row(GNCImportMainMatcher *gui, GtkTreeModel *model,
                   GtkTreeIter *iter, GNCImportTransInfo *info);
+static void
+gnc_gen_trans_list_match_pending (GNCImportMainMatcher *gui);
 
 void gnc_gen_trans_list_delete (GNCImportMainMatcher *info)
 {
     GtkTreeModel *model;
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
+    GList *node;
 
     if (info == NULL)
         return;
 
+    if (info->match_idle_id)
+        g_source_remove (info->match_idle_id);
+    /* The transactions not shown yet. */
+    for (node = info->pending_matches; node; node = node->next)
+    {
+        if (info->transaction_processed_cb)
+            info->transaction_processed_cb (node->data, FALSE,
+                                            info->user_data);
+        gnc_import_TransInfo_delete (node->data);
+    }
+    g_list_free (info->pending_matches);
+    g_hash_table_destroy (info->probability_pixbufs);
+
     model = gtk_tree_view_get_model(info->view);
     if (gtk_tree_model_get_iter_first(model, &iter))
     {
@@ -152,6 +178,7 @@ on_matcher_ok_clicked (GtkButton *button,
 
     /*   DEBUG ("Begin") */
 
+    gnc_gen_trans_list_match_pending (info);
     model = gtk_tree_view_get_model(info->view);
     if (!gtk_tree_model_get_iter_first(model, &iter))
         return;
@@ -159,15 +186,34 @@ on_matcher_ok_clicked (GtkButton *button,
     /* Don't run any queries and/or split sorts while processing the matcher
     results. */
     gnc_suspend_gui_refresh();
+    /* Deliver the events of all of the transactions together at the end. */
+    qof_event_begin_batch();
+    /* Flush the transaction log in groups rather than per transaction. */
+    xaccLogBeginGroup();
+    /* Balance the imported transactions together once they're all in. */
+    xaccTransBeginDeferredScrub();
+    xaccTransBeginJournaledEdits();
+
+    g_list_free_full (last_imported, (GDestroyNotify)guid_free);
+    last_imported = NULL;
 
     do
     {
+        gboolean adding;
+
         gtk_tree_model_get(model, &iter,
                            DOWNLOADED_COL_DATA, &trans_info,
                            -1);
 
+        adding = gnc_import_TransInfo_get_action (trans_info) == GNCImport_ADD;
         if (gnc_import_process_trans_item(NULL, trans_info))
         {
+            if (adding)
+            {
+                Transaction *trans = gnc_import_TransInfo_get_trans (trans_info);
+                last_imported = g_list_prepend (last_imported,
+                                                guid_copy (xaccTransGetGUID (trans)));
+            }
             if (info->transaction_processed_cb)
             {
                 info->transaction_processed_cb(trans_info,
@@ -177,7 +223,12 @@ on_matcher_ok_clicked (GtkButton *button,
         }
     }
     while (gtk_tree_model_iter_next (model, &iter));
+    last_imported = g_list_reverse (last_imported);
 
+    xaccTransEndJournaledEdits();
+    xaccTransEndDeferredScrub();
+    xaccLogEndGroup();
+    qof_event_end_batch();
     /* Allow GUI refresh again. */
     gnc_resume_gui_refresh();
 
@@ -271,6 +322,7 @@ gnc_gen_trans_add_toggled_cb (GtkCellRendererToggle *cell_renderer,
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
 
+    gnc_gen_trans_list_match_pending (gui);
     model = gtk_tree_view_get_model(gui->view);
     if (!gtk_tree_model_get_iter_from_string(model, &iter, path))
         return;
@@ -297,6 +349,7 @@ gnc_gen_trans_clear_toggled_cb (GtkCellRendererToggle *cell_renderer,
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
 
+    gnc_gen_trans_list_match_pending (gui);
     model = gtk_tree_view_get_model(gui->view);
     if (!gtk_tree_model_get_iter_from_string(model, &iter, path))
         return;
@@ -323,6 +376,7 @@ gnc_gen_trans_update_toggled_cb (GtkCellRendererToggle *cell_renderer,
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
 
+    gnc_gen_trans_list_match_pending (gui);
     model = gtk_tree_view_get_model(gui->view);
     if (!gtk_tree_model_get_iter_from_string(model, &iter, path))
         return;
@@ -350,6 +404,7 @@ gnc_gen_trans_row_activated_cb (GtkTreeView           *view,
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
 
+    gnc_gen_trans_list_match_pending (gui);
     model = gtk_tree_view_get_model(gui->view);
     if (!gtk_tree_model_get_iter(model, &iter, path))
         return;
@@ -436,6 +491,39 @@ add_toggle_column(GtkTreeView *view, const gchar *title, int col_num,
     return column;
 }
 
+/* Show the confidence of the selected match of the transactions that
+   aren't new. The pixbufs are only made for the rows drawn, once for
+   each score. */
+static void
+probability_cell_data_func (GtkTreeViewColumn *column,
+                            GtkCellRenderer *renderer,
+                            GtkTreeModel *model,
+                            GtkTreeIter *iter,
+                            gpointer user_data)
+{
+    GNCImportMainMatcher *gui = user_data;
+    GNCImportTransInfo *trans_info;
+    GdkPixbuf *pixbuf = NULL;
+
+    gtk_tree_model_get(model, iter, DOWNLOADED_COL_DATA, &trans_info, -1);
+    if (trans_info
+            && gnc_import_TransInfo_get_action(trans_info) != GNCImport_ADD)
+    {
+        gint score = gnc_import_MatchInfo_get_probability
+                     (gnc_import_TransInfo_get_selected_match (trans_info));
+        pixbuf = g_hash_table_lookup (gui->probability_pixbufs,
+                                      GINT_TO_POINTER(score));
+        if (!pixbuf)
+        {
+            pixbuf = gen_probability_pixbuf (score, gui->user_settings,
+                                             GTK_WIDGET(gui->view));
+            g_hash_table_insert (gui->probability_pixbufs,
+                                 GINT_TO_POINTER(score), pixbuf);
+        }
+    }
+    g_object_set (renderer, "pixbuf", pixbuf, NULL);
+}
+
 static void
 gnc_gen_trans_init_view (GNCImportMainMatcher *info,
                          gboolean show_account,
@@ -452,7 +540,7 @@ gnc_gen_trans_init_view (GNCImportMainMatcher *info,
                                G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING,
                                G_TYPE_STRING, G_TYPE_STRING, G_TYPE_BOOLEAN,
                                G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_STRING,
-                               GDK_TYPE_PIXBUF, G_TYPE_POINTER, G_TYPE_STRING);
+                               G_TYPE_POINTER, G_TYPE_STRING);
     gtk_tree_view_set_model(view, GTK_TREE_MODEL(store));
     g_object_unref(store);
 
@@ -475,9 +563,11 @@ gnc_gen_trans_init_view (GNCImportMainMatcher *info,
     renderer = gtk_cell_renderer_pixbuf_new();
     g_object_set(renderer, "xalign", 0.0, NULL);
     column = gtk_tree_view_column_new_with_attributes(_("Info"), renderer,
-             "pixbuf", DOWNLOADED_COL_ACTION_PIXBUF,
              "cell-background", DOWNLOADED_COL_COLOR,
              NULL);
+    gtk_tree_view_column_set_cell_data_func(column, renderer,
+                                            probability_cell_data_func,
+                                            info, NULL);
     renderer = gtk_cell_renderer_text_new();
     g_object_set(G_OBJECT(renderer),
                  "foreground", "black",
@@ -515,6 +605,9 @@ GNCImportMainMatcher *gnc_gen_trans_list_new (GtkWidget *parent,
     gboolean show_update;
 
     info = g_new0 (GNCImportMainMatcher, 1);
+    info->probability_pixbufs = g_hash_table_new_full (g_direct_hash,
+                                g_direct_equal,
+                                NULL, g_object_unref);
 
     /* Initialize user Settings. */
     info->user_settings = gnc_import_Settings_new ();
@@ -582,6 +675,9 @@ GNCImportMainMatcher * gnc_gen_trans_assist_new (GtkWidget *parent,
     gboolean show_update;
 
     info = g_new0 (GNCImportMainMatcher, 1);
+    info->probability_pixbufs = g_hash_table_new_full (g_direct_hash,
+                                g_direct_equal,
+                                NULL, g_object_unref);
 
     /* Initialize user Settings. */
     info->user_settings = gnc_import_Settings_new ();
@@ -634,6 +730,20 @@ void gnc_gen_trans_assist_start (GNCImportMainMatcher *info)
  *                   Assistant routines End                      *
  *****************************************************************/
 
+GList *
+gnc_gen_trans_list_get_last_imported (QofBook *book)
+{
+    GList *node, *transactions = NULL;
+
+    for (node = last_imported; node; node = node->next)
+    {
+        Transaction *trans = xaccTransLookup (node->data, book);
+        if (trans && !qof_instance_get_destroying (trans))
+            transactions = g_list_prepend (transactions, trans);
+    }
+    return g_list_reverse (transactions);
+}
+
 void gnc_gen_trans_list_add_tp_cb(GNCImportMainMatcher *info,
                                   GNCTransactionProcessedCB trans_processed_cb,
                                   gpointer user_data)
@@ -647,6 +757,7 @@ gboolean gnc_gen_trans_list_run (GNCImportMainMatcher *info)
     gboolean result;
 
     /* DEBUG("Begin"); */
+    gnc_gen_trans_list_match_pending (info);
     result = gtk_dialog_run (GTK_DIALOG (info->dialog));
     /* DEBUG("Result was %d", result); */
 
@@ -816,57 +927,86 @@ refresh_model_row (GNCImportMainMatcher *gui,
     if (text)
         g_free(text);
 
-    /* Set the pixmaps */
+    /* Set the toggles; the confidence pixmap is drawn from the data. */
     gtk_list_store_set(store, iter,
                        DOWNLOADED_COL_ACTION_ADD,
                        gnc_import_TransInfo_get_action(info) == GNCImport_ADD,
-                       -1);
-    if (gnc_import_TransInfo_get_action(info) == GNCImport_SKIP)
-    {
-        /*Show the best match's confidence pixmap in the info column*/
-        gtk_list_store_set(store, iter,
-                           DOWNLOADED_COL_ACTION_PIXBUF,
-                           gen_probability_pixbuf( gnc_import_MatchInfo_get_probability
-                                   ( gnc_import_TransInfo_get_selected_match (info)),
-                                   gui->user_settings,
-                                   GTK_WIDGET(gui->view)),
-                           -1);
-    }
-
-    gtk_list_store_set(store, iter,
                        DOWNLOADED_COL_ACTION_CLEAR,
                        gnc_import_TransInfo_get_action(info) == GNCImport_CLEAR,
+                       DOWNLOADED_COL_ACTION_UPDATE,
+                       gnc_import_TransInfo_get_action(info) == GNCImport_UPDATE,
                        -1);
-    if (gnc_import_TransInfo_get_action(info) == GNCImport_CLEAR)
+
+    selection = gtk_tree_view_get_selection(gui->view);
+    gtk_tree_selection_unselect_all(selection);
+}
+
+/* Find the matches of the transactions added since the last time, with
+   a single query for all of them, and show them. The rows are added with
+   the model detached from the view and unsorted, and sorted once at the
+   end. */
+static void
+gnc_gen_trans_list_match_pending (GNCImportMainMatcher *gui)
+{
+    GNCImportMatchSession *session;
+    GtkTreeModel *model;
+    GtkTreeSortable *sortable;
+    GtkTreeIter iter;
+    GtkSortType order;
+    gint sort_column;
+    gboolean sorted;
+    GList *node;
+
+    if (gui->match_idle_id)
     {
-        /*Show the best match's confidence pixmap in the info column*/
-        gtk_list_store_set(store, iter,
-                           DOWNLOADED_COL_ACTION_PIXBUF,
-                           gen_probability_pixbuf( gnc_import_MatchInfo_get_probability
-                                   ( gnc_import_TransInfo_get_selected_match (info)),
-                                   gui->user_settings,
-                                   GTK_WIDGET(gui->view)),
-                           -1);
+        g_source_remove (gui->match_idle_id);
+        gui->match_idle_id = 0;
     }
+    if (!gui->pending_matches)
+        return;
 
-    gtk_list_store_set(store, iter,
-                       DOWNLOADED_COL_ACTION_UPDATE,
-                       gnc_import_TransInfo_get_action(info) == GNCImport_UPDATE,
-                       -1);
-    if (gnc_import_TransInfo_get_action(info) == GNCImport_UPDATE)
+    /* Keep the order in which the transactions were added. */
+    gui->pending_matches = g_list_reverse (gui->pending_matches);
+
+    session = gnc_import_MatchSession_new (gui->pending_matches,
+                                           gnc_import_Settings_get_match_date_hardlimit (gui->user_settings));
+    for (node = gui->pending_matches; node; node = node->next)
+        gnc_import_TransInfo_init_matches_in_session (node->data,
+                gui->user_settings,
+                session);
+    gnc_import_MatchSession_destroy (session);
+
+    model = g_object_ref (gtk_tree_view_get_model(gui->view));
+    sortable = GTK_TREE_SORTABLE(model);
+    sorted = gtk_tree_sortable_get_sort_column_id (sortable, &sort_column,
+             &order);
+    if (sorted)
+        gtk_tree_sortable_set_sort_column_id (sortable,
+                                              GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+                                              order);
+    gtk_tree_view_set_model (gui->view, NULL);
+
+    for (node = gui->pending_matches; node; node = node->next)
     {
-        /*Show the best match's confidence pixmap in the info column*/
-        gtk_list_store_set(store, iter,
-                           DOWNLOADED_COL_ACTION_PIXBUF,
-                           gen_probability_pixbuf( gnc_import_MatchInfo_get_probability
-                                   ( gnc_import_TransInfo_get_selected_match (info)),
-                                   gui->user_settings,
-                                   GTK_WIDGET(gui->view)),
-                           -1);
+        gtk_list_store_append (GTK_LIST_STORE(model), &iter);
+        refresh_model_row (gui, model, &iter, node->data);
     }
+    g_list_free (gui->pending_matches);
+    gui->pending_matches = NULL;
 
-    selection = gtk_tree_view_get_selection(gui->view);
-    gtk_tree_selection_unselect_all(selection);
+    gtk_tree_view_set_model (gui->view, model);
+    if (sorted)
+        gtk_tree_sortable_set_sort_column_id (sortable, sort_column, order);
+    g_object_unref (model);
+}
+
+static gboolean
+match_pending_idle (gpointer user_data)
+{
+    GNCImportMainMatcher *gui = user_data;
+    gui->match_idle_id = 0;
+    gnc_gen_trans_list_match_pending (gui);
+    return FALSE;
 }
 
 void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans)
@@ -878,8 +1018,6 @@ void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans)
 void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transaction *trans, guint32 ref_id)
 {
     GNCImportTransInfo * transaction_info = NULL;
-    GtkTreeModel *model;
-    GtkTreeIter iter;
     g_assert (gui);
     g_assert (trans);
 
@@ -891,12 +1029,12 @@ void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transac
         transaction_info = gnc_import_TransInfo_new(trans, NULL);
         gnc_import_TransInfo_set_ref_id(transaction_info, ref_id);
 
-        gnc_import_TransInfo_init_matches(transaction_info,
-                                          gui->user_settings);
-
-        model = gtk_tree_view_get_model(gui->view);
-        gtk_list_store_append(GTK_LIST_STORE(model), &iter);
-        refresh_model_row (gui, model, &iter, transaction_info);
+        /* The matches are found and the rows added later, for all of the
+           transactions added meanwhile together. */
+        gui->pending_matches = g_list_prepend (gui->pending_matches,
+                                               transaction_info);
+        if (!gui->match_idle_id)
+            gui->match_idle_id = g_idle_add (match_pending_idle, gui);
     }
     return;
 }/* end gnc_import_add_trans_with_ref_id() */
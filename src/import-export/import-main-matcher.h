@@ -132,6 +132,18 @@ void gnc_gen_trans_list_add_tp_cb(GNCImportMainMatcher *info,
                                   gpointer user_data);
 
 
+/** Returns the transactions that the matcher added to book the last
+ *  time it was run, in the order they were shown, so that an import
+ *  that went wrong can be rolled back with xaccTransVoidMany() or
+ *  xaccTransReverseMany().  Transactions deleted since are left out.
+ *
+ *  @param book The book the transactions were imported into.
+ *
+ *  @return The transactions.  Free the list with g_list_free, not the
+ *  transactions.
+ */
+GList *gnc_gen_trans_list_get_last_imported (QofBook *book);
+
 /** Deletes the given object. */
 void gnc_gen_trans_list_delete (GNCImportMainMatcher *info);
 
@@ -145,6 +157,9 @@ void gnc_gen_trans_list_delete (GNCImportMainMatcher *info);
  * Only the first split will be used for matching.  The transaction
  * must NOT be commited. The Importer takes over ownership of the
  * passed transaction.
+ *
+ * The transactions added are matched and shown together, once the main
+ * loop is idle, so a whole file can be added in one go cheaply.
  */
 void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans);
 
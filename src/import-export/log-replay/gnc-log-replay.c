@@ -42,6 +42,8 @@
 #include "qof.h"
 #include "gnc-ui-util.h"
 #include "gnc-gui-query.h"
+#include "gnc-component-manager.h"
+#include "gnc-window.h"
 
 #define GNC_PREFS_GROUP "dialogs.log-replay"
 
@@ -100,6 +102,27 @@ typedef struct _split_record
     Timespec date_reconciled;
     int date_reconciled_present;
 } split_record;
+
+/* A transaction edited by the replay. It stays open until the whole log
+   has been read, so that it is committed once however many records it
+   has. */
+typedef struct
+{
+    GncGUID guid;
+    Transaction *trans;
+    char *trans_ro;
+} replay_trans;
+
+/* The state of a replay of a log file. */
+typedef struct
+{
+    GHashTable *by_guid;    /* GncGUID* -> replay_trans*, of open_trans */
+    GPtrArray *open_trans;  /* The replay_trans, in the order of the log */
+    guint n_records;        /* Records read */
+    guint n_corrupted;      /* Records which couldn't be read */
+    guint n_committed;      /* Transactions changed */
+    guint n_deleted;        /* Transactions deleted */
+} replay_state;
 /********************************************************************\
  * gnc_file_log_replay_import
  * Entry point
@@ -359,8 +382,37 @@ static void dump_split_record(split_record record)
     }
 }
 
+static replay_trans *replay_find_trans (replay_state *state,
+        const GncGUID *guid)
+{
+    return g_hash_table_lookup (state->by_guid, guid);
+}
+
+/* Keep trans, which the replay began to edit, open until the end. */
+static void replay_add_trans (replay_state *state, Transaction *trans,
+                              char *trans_ro)
+{
+    replay_trans *rt = g_new0 (replay_trans, 1);
+    rt->guid = *qof_instance_get_guid (QOF_INSTANCE (trans));
+    rt->trans = trans;
+    rt->trans_ro = trans_ro;
+    g_hash_table_insert (state->by_guid, &rt->guid, rt);
+    g_ptr_array_add (state->open_trans, rt);
+}
+
+static void replay_commit_trans (replay_state *state, replay_trans *rt)
+{
+    if (rt->trans == NULL)
+        return;
+    state->n_committed++;
+    xaccTransScrubCurrency (rt->trans);
+    xaccTransSetReadOnly (rt->trans, rt->trans_ro);
+    xaccTransCommitEdit (rt->trans);
+    rt->trans = NULL;
+}
+
 /* File pointer must already be at the begining of a record */
-static void  process_trans_record(  FILE *log_file)
+static void  process_trans_record(  FILE *log_file, replay_state *state)
 {
     char read_buf[2048];
     char *read_retval;
@@ -371,6 +423,8 @@ static void  process_trans_record(  FILE *log_file)
     int split_num = 0;
     split_record record;
     Transaction * trans = NULL;
+    replay_trans * rt = NULL;
+    gboolean deleted = FALSE;
     Split * split = NULL;
     Account * acct = NULL;
     QofBook * book = gnc_get_current_book();
@@ -383,6 +437,7 @@ static void  process_trans_record(  FILE *log_file)
         if (read_retval != NULL && strncmp(record_end_str, read_buf, strlen(record_end_str)) != 0) /* If we are not at the end of the record */
         {
             split_num++;
+            state->n_records++;
             /*DEBUG("process_trans_record(): Line read: %s%s",read_buf ,"\n");*/
             record = interpret_split_record( read_buf);
             dump_split_record( record);
@@ -398,10 +453,22 @@ static void  process_trans_record(  FILE *log_file)
                     break;
                 case LOG_DELETE:
                     DEBUG("process_trans_record(): Playing back LOG_DELETE");
-                    if ((trans = xaccTransLookup (&(record.trans_guid), book)) != NULL
+                    deleted = TRUE;
+                    if (first_record == TRUE
+                            && (rt = replay_find_trans (state, &(record.trans_guid))) != NULL
+                            && rt->trans != NULL)
+                    {
+                        /* Edited earlier in this replay and still open. */
+                        first_record = FALSE;
+                        trans = rt->trans;
+                        xaccTransClearReadOnly(trans);
+                        xaccTransDestroy(trans);
+                    }
+                    else if ((trans = xaccTransLookup (&(record.trans_guid), book)) != NULL
                             && first_record == TRUE)
                     {
                         first_record = FALSE;
+                        rt = NULL;
                         if (xaccTransGetReadOnly(trans))
                         {
                             PWARN("Destroying a read only transaction.");
@@ -422,8 +489,13 @@ static void  process_trans_record(  FILE *log_file)
                     if (record.trans_guid_present == TRUE
                             && first_record == TRUE)
                     {
-                        trans = xaccTransLookupDirect (record.trans_guid, book);
-                        if (trans != NULL)
+                        rt = replay_find_trans (state, &(record.trans_guid));
+                        if (rt != NULL && rt->trans != NULL)
+                        {
+                            DEBUG("process_trans_record(): Transaction already being replayed");
+                            trans = rt->trans;
+                        }
+                        else if ((trans = xaccTransLookupDirect (record.trans_guid, book)) != NULL)
                         {
                             DEBUG("process_trans_record(): Transaction to be edited was found");
                             xaccTransBeginEdit(trans);
@@ -443,6 +515,11 @@ static void  process_trans_record(  FILE *log_file)
 
                         qof_instance_set_guid (QOF_INSTANCE (trans),
 					       &(record.trans_guid));
+                        if (trans != (rt ? rt->trans : NULL))
+                        {
+                            replay_add_trans (state, trans, trans_ro);
+                            trans_ro = NULL;
+                        }
                         /*Fill the transaction info*/
                         if (record.date_entered_present)
                         {
@@ -527,21 +604,89 @@ static void  process_trans_record(  FILE *log_file)
             else
             {
                 PERR("Corrupted record");
+                state->n_corrupted++;
             }
         }
         else /* The record ended */
         {
             record_ended = TRUE;
             DEBUG("process_trans_record(): Record ended\n");
-            if (trans != NULL) /*If we played with a transaction, commit it here*/
+            /* Deletions are committed right away; edited transactions
+               stay open until the end of the log. */
+            if (trans != NULL && deleted)
             {
-                xaccTransScrubCurrency(trans);
-                xaccTransSetReadOnly(trans, trans_ro);
+                if (rt != NULL && rt->trans == trans)
+                    rt->trans = NULL;
                 xaccTransCommitEdit(trans);
-                g_free(trans_ro);
+                state->n_deleted++;
             }
+            g_free(trans_ro);
+        }
+    }
+}
+
+/* Replay the records of log_file, which must be just past the header.
+   Each transaction is committed once, with the engine events delivered
+   together and the scrubbing deferred until all of them are done. */
+static void replay_log_file (FILE *log_file, const char *filename)
+{
+    char read_buf[256];
+    const char * record_start_str = "===== START";
+    replay_state state = { NULL, NULL, 0, 0, 0, 0 };
+    GStatBuf statbuf;
+    double file_size;
+    guint n_blocks = 0, i;
+    gchar *summary;
+
+    file_size = (g_stat (filename, &statbuf) == 0 && statbuf.st_size > 0)
+                ? statbuf.st_size : 0;
+    state.by_guid = g_hash_table_new (guid_hash_to_guint,
+                                      guid_g_hash_table_equal);
+    state.open_trans = g_ptr_array_new ();
+
+    gnc_suspend_gui_refresh ();
+    qof_event_begin_batch ();
+    xaccTransBeginDeferredScrub ();
+
+    gnc_window_show_progress (_("Replaying log file..."), 0.0);
+    while (fgets(read_buf, sizeof(read_buf), log_file) != NULL)
+    {
+        /*DEBUG("Chunk read: %s",read_buf);*/
+        if (strncmp(record_start_str, read_buf, strlen(record_start_str)) == 0) /* If a record started */
+        {
+            process_trans_record(log_file, &state);
+            if (file_size > 0 && ++n_blocks % 100 == 0)
+                gnc_window_show_progress (NULL,
+                                          80.0 * ftell (log_file) / file_size);
         }
     }
+
+    gnc_window_show_progress (_("Committing replayed transactions..."), 80.0);
+    for (i = 0; i < state.open_trans->len; i++)
+        replay_commit_trans (&state, g_ptr_array_index (state.open_trans, i));
+    xaccTransEndDeferredScrub ();
+    qof_event_end_batch ();
+    gnc_resume_gui_refresh ();
+    gnc_window_show_progress (NULL, -1.0);
+
+    summary = g_strdup_printf (_("Replayed %u records: %u transactions "
+                                 "changed, %u deleted and %u records "
+                                 "which could not be read."),
+                               state.n_records,
+                               state.n_committed,
+                               state.n_deleted, state.n_corrupted);
+    PINFO ("%s", summary);
+    gnc_info_dialog (NULL, "%s", summary);
+    g_free (summary);
+
+    for (i = 0; i < state.open_trans->len; i++)
+    {
+        replay_trans *rt = g_ptr_array_index (state.open_trans, i);
+        g_free (rt->trans_ro);
+        g_free (rt);
+    }
+    g_ptr_array_free (state.open_trans, TRUE);
+    g_hash_table_destroy (state.by_guid);
 }
 
 void gnc_file_log_replay (void)
@@ -552,7 +697,6 @@ void gnc_file_log_replay (void)
     char *read_retval;
     GtkFileFilter *filter;
     FILE *log_file;
-    char * record_start_str = "===== START";
     /* NOTE: This string must match src/engine/TransLog.c (sans newline) */
     char * expected_header_orig = "mod\ttrans_guid\tsplit_guid\ttime_now\t"
                                   "date_entered\tdate_posted\tacc_guid\tacc_name\tnum\tdescription\t"
@@ -634,16 +778,7 @@ void gnc_file_log_replay (void)
                     }
                     else
                     {
-                        do
-                        {
-                            read_retval = fgets(read_buf, sizeof(read_buf), log_file);
-                            /*DEBUG("Chunk read: %s",read_retval);*/
-                            if (strncmp(record_start_str, read_buf, strlen(record_start_str)) == 0) /* If a record started */
-                            {
-                                process_trans_record(log_file);
-                            }
-                        }
-                        while (feof(log_file) == 0);
+                        replay_log_file (log_file, selected_filename);
                     }
                 }
                 fclose(log_file);
@@ -28,6 +28,7 @@
 /** The gnc_file_log_replay() routine will pop up a standard file
  *     selection dialogue asking the user to pick a log file to replay. If one
  *     is selected the the .log file is opened and read.  It's contents
- *     are then silently merged in the current log file. */
+ *     are then merged in the current log file, committing each
+ *     transaction once, and a summary of the replay is shown. */
 void              gnc_file_log_replay (void);
 #endif
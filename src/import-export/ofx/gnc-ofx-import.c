@@ -1034,7 +1034,11 @@ void gnc_file_ofx_import (void)
 #endif
 
         DEBUG("Opening selected file");
+        /* Deliver the events of the new transactions together; the
+           matcher shows them all at once when the file is done. */
+        qof_event_begin_batch();
         libofx_proc_file(libofx_context, selected_filename, AUTODETECT);
+        qof_event_end_batch();
         g_free(selected_filename);
     }
 
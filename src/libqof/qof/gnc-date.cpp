@@ -114,7 +114,7 @@ gnc_localtime_r (const time64 *secs, struct tm* time)
 {
     try
     {
-	*time = static_cast<struct tm>(GncDateTime(*secs));
+	*time = static_cast<struct tm>(GncDateTimeValue(*secs));
 	return time;
     }
     catch(std::invalid_argument)
@@ -186,8 +186,8 @@ gnc_gmtime (const time64 *secs)
 {
     try
     {
+	GncDateTimeValue gncdt(*secs);
 	auto time = static_cast<struct tm*>(calloc(1, sizeof(struct tm)));
-	GncDateTime gncdt(*secs);
 	*time = gncdt.utc_tm();
 	return time;
     }
@@ -204,7 +204,7 @@ gnc_mktime (struct tm* time)
     try
     {
 	normalize_struct_tm (time);
-	GncDateTime gncdt(*time);
+	GncDateTimeValue gncdt(*time);
 	return static_cast<time64>(gncdt) - gncdt.offset();
     }
     catch(std::invalid_argument)
@@ -219,7 +219,7 @@ gnc_timegm (struct tm* time)
     try
     {
 	normalize_struct_tm(time);
-	return static_cast<time64>(GncDateTime(*time));
+	return static_cast<time64>(GncDateTimeValue(*time));
     }
     catch(std::invalid_argument)
     {
@@ -1176,6 +1176,69 @@ gnc_timespec_to_iso8601_buff (Timespec ts, char * buff)
     return buff + sstr.length();
 }
 
+static inline char*
+put_digits (char* p, unsigned int val, int width)
+{
+    for (int i = width - 1; i >= 0; --i)
+    {
+        p[i] = '0' + val % 10;
+        val /= 10;
+    }
+    return p + width;
+}
+
+char *
+gnc_time64_to_iso8601_local_buff (time64 t, char * buff)
+{
+    g_return_val_if_fail (buff, NULL);
+
+    try
+    {
+        GncDateTimeValue value (t);
+        auto tm = static_cast<struct tm>(value);
+        auto year = tm.tm_year + 1900;
+        /* Years of other widths are left to boost. */
+        if (year < 1000 || year > 9999)
+        {
+            GncDateTime gncdt (t);
+            auto sstr = gncdt.format ("%Y-%m-%d %H:%M:%S %q");
+            if (sstr.length () >= GNC_ISO8601_LOCAL_BUFF_SIZE)
+                return NULL;
+            strcpy (buff, sstr.c_str ());
+            return buff + sstr.length ();
+        }
+
+        auto p = buff;
+        p = put_digits (p, year, 4);
+        *p++ = '-';
+        p = put_digits (p, tm.tm_mon + 1, 2);
+        *p++ = '-';
+        p = put_digits (p, tm.tm_mday, 2);
+        *p++ = ' ';
+        p = put_digits (p, tm.tm_hour, 2);
+        *p++ = ':';
+        p = put_digits (p, tm.tm_min, 2);
+        *p++ = ':';
+        p = put_digits (p, tm.tm_sec, 2);
+        *p++ = ' ';
+
+        /* As boost's %q: the sign, then the hours and minutes of the
+         * offset with any seconds dropped. */
+        auto offset = value.offset ();
+        *p++ = offset < 0 ? '-' : '+';
+        if (offset < 0)
+            offset = -offset;
+        p = put_digits (p, offset / 3600, 2);
+        p = put_digits (p, offset / 60 % 60, 2);
+        *p = '\0';
+        return p;
+    }
+    catch(...)
+    {
+        return NULL;
+    }
+}
+
 void
 gnc_timespec2dmy (Timespec t, int *day, int *month, int *year)
 {
@@ -1240,7 +1303,7 @@ gnc_dmy2timespec_neutral (int day, int month, int year)
     date.tm_min = 59;
     date.tm_sec = 0;
 
-    GncDateTime gncdt(date);
+    GncDateTimeValue gncdt(date);
     auto offset = gncdt.offset() / 3600;
     if (offset < -11)
         date.tm_hour = -offset;
@@ -386,6 +386,18 @@ Timespec gnc_iso8601_to_timespec_gmt(const gchar *);
  */
 gchar * gnc_timespec_to_iso8601_buff (Timespec ts, gchar * buff);
 
+/** The room gnc_time64_to_iso8601_local_buff() needs. */
+#define GNC_ISO8601_LOCAL_BUFF_SIZE 32
+
+/** Print t in the local time zone as "2016-05-01 13:45:10 +0200", which is
+ *  what gnc_print_time64 (t, "%Y-%m-%d %H:%M:%S %q") gives, into buff
+ *  without allocating.  The UTC offset comes from the time zone's compiled
+ *  table of transitions, so no boost local time is built.  buff must hold
+ *  GNC_ISO8601_LOCAL_BUFF_SIZE characters.
+ *  \return A pointer to the terminating NUL, or NULL if t can't be
+ *  printed. */
+gchar * gnc_time64_to_iso8601_local_buff (time64 t, gchar * buff);
+
 /** Set the proleptic Gregorian day, month, and year from a Timespec
  * \param ts: input timespec
  * \param day: output day, 1 - 31
@@ -29,6 +29,7 @@ extern "C"
 }
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstring>
 #include <memory>
 #include <iostream>
 #include <sstream>
@@ -45,7 +46,12 @@ using LDTBase = boost::local_time::local_date_time_base<PTime, boost::date_time:
 using boost::date_time::not_a_date_time;
 using time64 = int64_t;
 
-static const TimeZoneProvider tzp;
+/* Made the first time a date needs it, not when the library loads. */
+static inline const TimeZoneProvider&
+tzp()
+{
+    return TimeZoneProvider::instance();
+}
 // For converting to/from POSIX time.
 static const PTime unix_epoch (Date(1970, boost::gregorian::Jan, 1),
         boost::posix_time::seconds(0));
@@ -104,7 +110,7 @@ LDT_from_unix_local(const time64 time)
         PTime temp(unix_epoch.date(),
                    boost::posix_time::hours(time / 3600) +
                    boost::posix_time::seconds(time % 3600));
-        auto tz = tzp.get(temp.date().year());
+        auto tz = tzp().get(temp.date().year());
         return LDT(temp, tz);
     }
     catch(boost::gregorian::bad_year)
@@ -121,7 +127,7 @@ LDT_from_struct_tm(const struct tm tm)
         auto tdate = boost::gregorian::date_from_tm(tm);
         auto tdur = boost::posix_time::time_duration(tm.tm_hour, tm.tm_min,
                                                      tm.tm_sec, 0);
-        auto tz = tzp.get(tdate.year());
+        auto tz = tzp().get(tdate.year());
         return LDT(PTime(tdate, tdur), tz);
     }
     catch(boost::gregorian::bad_year)
@@ -133,16 +139,16 @@ LDT_from_struct_tm(const struct tm tm)
 class GncDateTimeImpl
 {
 public:
-    GncDateTimeImpl() : m_time(unix_epoch, tzp.get(unix_epoch.date().year())) {}
+    GncDateTimeImpl() : m_time(unix_epoch, tzp().get(unix_epoch.date().year())) {}
     GncDateTimeImpl(const time64 time) : m_time(LDT_from_unix_local(time)) {}
     GncDateTimeImpl(const struct tm tm) : m_time(LDT_from_struct_tm(tm)) {}
     GncDateTimeImpl(const std::string str);
-    GncDateTimeImpl(PTime&& pt) : m_time(pt, tzp.get(pt.date().year())) {}
+    GncDateTimeImpl(PTime&& pt) : m_time(pt, tzp().get(pt.date().year())) {}
     GncDateTimeImpl(LDT&& ldt) : m_time(ldt) {}
 
     operator time64() const;
     operator struct tm() const;
-    void now() { m_time = boost::local_time::local_sec_clock::local_time(tzp.get(boost::gregorian::day_clock::local_day().year())); }
+    void now() { m_time = boost::local_time::local_sec_clock::local_time(tzp().get(boost::gregorian::day_clock::local_day().year())); }
     long offset() const;
     struct tm utc_tm() const { return to_tm(m_time.utc_time()); }
     std::unique_ptr<GncDateImpl> date() const;
@@ -256,6 +262,130 @@ GncDateTimeImpl::format(const char* format) const
     return ss.str();
 }
 
+/* GncDateTimeValue */
+
+/* Converting through GncDateTimeImpl builds a boost local_date_time and
+ * looks up the year's zone, which is slow for the many conversions made by
+ * the register and reports. TimeZoneProvider::get_offset() finds the UTC
+ * offset in the table of transitions compiled when the zone was loaded, so
+ * GncDateTimeValue needs only integer arithmetic. Times outside the table
+ * still go through GncDateTimeImpl. */
+namespace
+{
+
+const int64_t secs_per_day = INT64_C(86400);
+
+inline int64_t
+floor_div (int64_t a, int64_t b) noexcept
+{
+    return a / b - (a % b < 0);
+}
+
+/* Days since 1970-01-01 of a proleptic Gregorian date and back, after
+ * Howard Hinnant's chrono-compatible date algorithms. */
+int64_t
+days_from_civil (int64_t y, unsigned m, unsigned d) noexcept
+{
+    y -= m <= 2;
+    auto era = (y >= 0 ? y : y - 399) / 400;
+    auto yoe = static_cast<unsigned>(y - era * 400);
+    auto doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+void
+civil_from_days (int64_t z, int64_t& y, unsigned& m, unsigned& d) noexcept
+{
+    z += 719468;
+    auto era = (z >= 0 ? z : z - 146096) / 146097;
+    auto doe = static_cast<unsigned>(z - era * 146097);
+    auto yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    auto doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    auto mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+struct tm
+tm_from_secs (time64 secs) noexcept
+{
+    struct tm time;
+    auto day = floor_div (secs, secs_per_day);
+    auto secs_of_day = secs - day * secs_per_day;
+    int64_t year;
+    unsigned month, mday;
+    civil_from_days (day, year, month, mday);
+
+    memset (&time, 0, sizeof (struct tm));
+    time.tm_sec = secs_of_day % 60;
+    time.tm_min = secs_of_day / 60 % 60;
+    time.tm_hour = secs_of_day / 3600;
+    time.tm_mday = mday;
+    time.tm_mon = month - 1;
+    time.tm_year = year - 1900;
+    time.tm_wday = (day % 7 + 11) % 7;   // 1970-01-01 was a Thursday
+    time.tm_yday = day - days_from_civil (year, 1, 1);
+    return time;
+}
+
+}
+
+void
+GncDateTimeValue::set_offset ()
+{
+    if (tzp().get_offset (m_time, m_offset, m_isdst))
+        return;
+    GncDateTimeImpl impl (m_time);
+    m_offset = impl.offset ();
+    m_isdst = static_cast<struct tm>(impl).tm_isdst;
+}
+
+GncDateTimeValue::GncDateTimeValue (const time64 time) : m_time {time}
+{
+    set_offset ();
+}
+
+GncDateTimeValue::GncDateTimeValue (const struct tm& tm)
+{
+    auto year = tm.tm_year + 1900;
+    if (year < 1400 || year > 9999)
+        throw(std::invalid_argument("Time value is outside the supported year range."));
+    m_time = days_from_civil (year, tm.tm_mon + 1, tm.tm_mday) * secs_per_day +
+        tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+    set_offset ();
+}
+
+GncDateTimeValue::operator struct tm () const noexcept
+{
+    auto time = tm_from_secs (m_time + m_offset);
+    time.tm_isdst = m_isdst;
+#if HAVE_STRUCT_TM_GMTOFF
+    time.tm_gmtoff = m_offset;
+#endif
+    return time;
+}
+
+struct tm
+GncDateTimeValue::utc_tm () const noexcept
+{
+    auto time = tm_from_secs (m_time);
+    time.tm_isdst = -1;
+    return time;
+}
+
+ymd
+GncDateTimeValue::year_month_day () const noexcept
+{
+    int64_t year;
+    unsigned month, day;
+    civil_from_days (floor_div (m_time + m_offset, secs_per_day),
+                     year, month, day);
+    return {static_cast<int>(year), static_cast<int>(month),
+            static_cast<int>(day)};
+}
+
 /* =================== Presentation-class Implementations ====================*/
 /* GncDate */
 GncDate::GncDate() : m_impl{new GncDateImpl} {}
@@ -26,6 +26,7 @@
 #define  __GNC_DATETIME_HPP__
 
 #include <cstdint>
+#include <ctime>
 #include <memory>
 #include <string>
 
@@ -166,4 +167,49 @@ private:
     std::unique_ptr<GncDateTimeImpl> m_impl;
 };
 
+/** GnuCash DateTime value class
+ *
+ * Holds a time and its UTC offset in the current timezone, like
+ * GncDateTime, but by value: it needs no heap allocation, and the offsets
+ * are cached by day, so it is much cheaper for converting many times
+ * between time64 and struct tm. Formatting, parsing and the other
+ * operations are only available from GncDateTime.
+ */
+class GncDateTimeValue
+{
+public:
+/** Construct a GncDateTimeValue representing the timestamp as seconds
+ * from the POSIX epoch (1970-01-01T00:00:00UTC).
+ * @param time: Seconds from the POSIX epoch.
+ * @exception std::invalid_argument if the year is outside the constraints.
+ */
+    explicit GncDateTimeValue(const time64 time);
+/** Construct a GncDateTimeValue from a struct tm, taking its fields as
+ * UTC as GncDateTime(const struct tm) does. The fields must be
+ * normalized.
+ * @exception std::invalid_argument if the year is outside the constraints.
+ */
+    explicit GncDateTimeValue(const struct tm& tm);
+/** Cast to a time64, seconds from the POSIX epoch. */
+    explicit operator time64() const noexcept { return m_time; }
+/** Cast to a struct tm in the current timezone. Timezone field isn't
+ * filled. */
+    explicit operator struct tm() const noexcept;
+/** Obtain the UTC offset in seconds
+ *  @return seconds difference between this local time and UTC. West
+ *  is negative.
+ */
+    long offset() const noexcept { return m_offset; }
+/** Obtain a struct tm representing the time in UTC. */
+    struct tm utc_tm() const noexcept;
+/** Obtain the date in the current timezone. */
+    ymd year_month_day() const noexcept;
+
+private:
+    void set_offset();
+    time64 m_time;
+    long m_offset;
+    int m_isdst;
+};
+
 #endif // __GNC_DATETIME_HPP__
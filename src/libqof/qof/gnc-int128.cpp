@@ -38,10 +38,38 @@ extern "C"
  * Addison-Wesley, 1998.
  */
 
+/* GCC and Clang provide a 128-bit integer type on 64-bit targets, which
+ * compiles to the processor's wide multiply and divide. Where it's
+ * available the magnitudes are multiplied, divided and reduced with it;
+ * the flags are handled the same either way. Define GNC_INT128_PORTABLE
+ * to use the limb arithmetic anyway, e.g. to test it.
+ */
+#if defined(__SIZEOF_INT128__) && !defined(GNC_INT128_PORTABLE)
+#define GNC_INT128_NATIVE 1
+#endif
+
 namespace {
     static const unsigned int sublegs = GncInt128::numlegs * 2;
     static const unsigned int sublegbits = GncInt128::legbits / 2;
     static const uint64_t sublegmask = (UINT64_C(1) << sublegbits) - 1;
+#ifdef GNC_INT128_NATIVE
+    __extension__ typedef unsigned __int128 native_uint128;
+
+    inline native_uint128
+    native_from_legs (uint64_t hi, uint64_t lo) noexcept
+    {
+        return (static_cast<native_uint128>(hi) << GncInt128::legbits) | lo;
+    }
+
+    inline unsigned int
+    native_ctz (native_uint128 n) noexcept
+    {
+        auto lo = static_cast<uint64_t>(n);
+        return lo ? __builtin_ctzll (lo) :
+            GncInt128::legbits +
+            __builtin_ctzll (static_cast<uint64_t>(n >> GncInt128::legbits));
+    }
+#endif
 }
 
 GncInt128::GncInt128 () : m_flags {}, m_hi {0}, m_lo {0}{}
@@ -135,6 +163,37 @@ GncInt128::gcd(GncInt128 b) const noexcept
     if (isOverflow() || isNan())
         return *this;
 
+#ifdef GNC_INT128_NATIVE
+    /* Stein's algorithm on the magnitudes; the sign doesn't matter. */
+    auto u = native_from_legs (m_hi, m_lo);
+    auto v = native_from_legs (b.m_hi, b.m_lo);
+    auto shift = native_ctz (u | v);
+    u >>= native_ctz (u);
+    while (v && (u >> legbits || v >> legbits))
+    {
+        v >>= native_ctz (v);
+        if (u > v)
+            std::swap (u, v);
+        v -= u;
+    }
+    /* Most operands get down to one leg quickly; if v ran out first, u is
+     * the gcd however wide it is. */
+    if (v)
+    {
+        uint64_t u64 {static_cast<uint64_t>(u)}, v64 {static_cast<uint64_t>(v)};
+        while (v64)
+        {
+            v64 >>= __builtin_ctzll (v64);
+            if (u64 > v64)
+                std::swap (u64, v64);
+            v64 -= u64;
+        }
+        u = u64;
+    }
+    u <<= shift;
+    return GncInt128 (static_cast<uint64_t>(u >> legbits),
+                      static_cast<uint64_t>(u));
+#else
     GncInt128 a (isNeg() ? -(*this) : *this);
     if (b.isNeg()) b = -b;
 
@@ -157,6 +216,7 @@ GncInt128::gcd(GncInt128 b) const noexcept
         t = a - b;  //B6
     }
     return a << k;
+#endif
 }
 
 /* Since u * v = gcd(u, v) * lcm(u, v), we find lcm by u / gcd * v. */
@@ -229,11 +289,17 @@ GncInt128::abs() const noexcept
 unsigned int
 GncInt128::bits() const noexcept
 {
+#ifdef GNC_INT128_NATIVE
+    if (m_hi)
+        return maxbits - __builtin_clzll (m_hi);
+    return m_lo ? legbits - __builtin_clzll (m_lo) : 0;
+#else
     unsigned int bits {static_cast<unsigned int>(m_hi == 0 ? 0 : 64)};
     uint64_t temp {(m_hi == 0 ? m_lo : m_hi)};
     for (;temp > 0; temp >>= 1)
         ++bits;
     return bits;
+#endif
 }
 
 
@@ -417,6 +483,14 @@ GncInt128::operator*= (const GncInt128& b) noexcept
         return *this;
     }
 
+#ifdef GNC_INT128_NATIVE
+    /* The bits test above guarantees that the product fits. */
+    auto product = native_from_legs (m_hi, m_lo) *
+        native_from_legs (b.m_hi, b.m_lo);
+    m_hi = static_cast<uint64_t>(product >> legbits);
+    m_lo = static_cast<uint64_t>(product);
+    return *this;
+#else
 /* This is Knuth's "classical" multi-precision multiplication algorithm
  * truncated to a GncInt128 result with the loop unrolled for clarity and with
  * overflow and zero checks beforehand to save time. See Donald Knuth, "The Art
@@ -438,20 +512,22 @@ GncInt128::operator*= (const GncInt128& b) noexcept
 
     rv[0] = av[0] * bv[0];
 
+    /* A carry out of rv[1] is worth 2^96, one in rv[3]; a carry out of
+     * rv[2] or rv[3] is beyond 2^128. */
     rv[1] = av[1] * bv [0];
     scratch = rv[1] + av[0] * bv[1];
-    carry = rv[1] > scratch ? 1 : 0;
+    uint64_t carry96 {rv[1] > scratch ? UINT64_C(1) : UINT64_C(0)};
     rv[1] = scratch;
 
-    rv[2] = av[2] * bv[0] + carry; //0xffff^2 + 1 < 0xffffffff, can't overflow
+    rv[2] = av[2] * bv[0];
     scratch = rv[2] + av[1] * bv[1];
     carry = rv[2] > scratch ? 1 : 0;
     rv[2] = scratch + av[0] * bv[2];
     carry += scratch > rv[2] ? 1 : 0;
 
-    rv[3] = av[3] * bv[0] + carry;
+    rv[3] = av[3] * bv[0] + carry96; //0xffffffff^2 + 1 can't overflow
     scratch = rv[3] + av[2] * bv[1];
-    carry = rv[3] > scratch ? 1 : 0;
+    carry += rv[3] > scratch ? 1 : 0;
     rv[3] = scratch + av[1] * bv[2];
     carry += scratch > rv[3] ? 1 : 0;
     scratch = rv[3] + av[0] * bv[3];
@@ -474,8 +550,10 @@ GncInt128::operator*= (const GncInt128& b) noexcept
         return *this;
     }
     return *this;
+#endif
 }
 
+#ifndef GNC_INT128_NATIVE
 namespace {
 /* Algorithm from Knuth (full citation at operator*=) p272ff.  Again, there
  * are faster algorithms out there, but they require much larger numbers to
@@ -603,6 +681,7 @@ div_single_leg (uint64_t* u, size_t m, uint64_t v, GncInt128& q, GncInt128& r) n
 }
 
 }// namespace
+#endif
 
  void
 GncInt128::div (const GncInt128& b, GncInt128& q, GncInt128& r) noexcept
@@ -651,6 +730,15 @@ GncInt128::div (const GncInt128& b, GncInt128& q, GncInt128& r) noexcept
         return;
     }
 
+#ifdef GNC_INT128_NATIVE
+    auto u = native_from_legs (m_hi, m_lo);
+    auto v = native_from_legs (b.m_hi, b.m_lo);
+    auto quot = u / v, rem = u % v;
+    q.m_hi = static_cast<uint64_t>(quot >> legbits);
+    q.m_lo = static_cast<uint64_t>(quot);
+    r.m_hi = static_cast<uint64_t>(rem >> legbits);
+    r.m_lo = static_cast<uint64_t>(rem);
+#else
     uint64_t u[sublegs + 2] {(m_lo & sublegmask), (m_lo >> sublegbits),
             (m_hi & sublegmask), (m_hi >> sublegbits), 0, 0};
     uint64_t v[sublegs] {(b.m_lo & sublegmask), (b.m_lo >> sublegbits),
@@ -663,6 +751,7 @@ GncInt128::div (const GncInt128& b, GncInt128& q, GncInt128& r) noexcept
         return div_single_leg (u, m, v[0], q, r);
 
     return div_multi_leg (u, m, v, n, q, r);
+#endif
 }
 
 GncInt128&
@@ -248,15 +248,58 @@ gnc_numeric_same(gnc_numeric a, gnc_numeric b, gint64 denom,
  *  gnc_numeric_add
  ********************************************************************/
 
+/* Most sums in the engine are of amounts in the same commodity, so they
+ * share a denominator and the result keeps it. When the requested
+ * denominator works out to that shared one, and the reduce or sigfigs
+ * type won't change it afterwards, the sum is just the sum of the
+ * numerators; return FALSE to fall back to GncRational if that doesn't
+ * fit in 64 bits.
+ */
+static inline gboolean
+numeric_add_same_denom (gnc_numeric a, gnc_numeric b, gint64 denom,
+                        gint how, gnc_numeric *result)
+{
+    gint64 num;
+
+    if (a.denom != b.denom || a.denom <= 0)
+        return FALSE;
+    if (denom == GNC_DENOM_AUTO)
+    {
+        gint type = how & GNC_NUMERIC_DENOM_MASK;
+        if (type == GNC_HOW_DENOM_REDUCE || type == GNC_HOW_DENOM_SIGFIG)
+            return FALSE;
+    }
+    else if (denom != a.denom)
+        return FALSE;
+
+#if (defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__)
+    if (__builtin_add_overflow (a.num, b.num, &num))
+        return FALSE;
+#else
+    if ((b.num > 0 && a.num > INT64_MAX - b.num) ||
+        (b.num < 0 && a.num < INT64_MIN - b.num))
+        return FALSE;
+    num = a.num + b.num;
+#endif
+    result->num = num;
+    result->denom = a.denom;
+    return TRUE;
+}
+
 gnc_numeric
 gnc_numeric_add(gnc_numeric a, gnc_numeric b,
                 gint64 denom, gint how)
 {
+    gnc_numeric sum;
+
     if (gnc_numeric_check(a) || gnc_numeric_check(b))
     {
         return gnc_numeric_error(GNC_ERROR_ARG);
     }
 
+    if (numeric_add_same_denom (a, b, denom, how, &sum))
+        return sum;
+
     GncNumeric an (a), bn (b);
     GncDenom new_denom (an, bn, denom, how);
     if (new_denom.m_error)
@@ -285,6 +328,152 @@ gnc_numeric_sub(gnc_numeric a, gnc_numeric b,
     return gnc_numeric_add (a, nb, denom, how);
 }
 
+/* *******************************************************************
+ *  gnc_numeric_sum_array
+ ********************************************************************/
+
+/* Sums are kept in a few int64 lanes, one per denominator; a lane is
+ * folded into the exact 128-bit total when its sum would overflow or
+ * when a new denominator needs its slot. */
+#define SUM_LANES 8
+
+struct SumLane
+{
+    gint64 denom;
+    gint64 num;
+};
+
+static void
+sum_fold_lane (GncInt128& total_num, GncInt128& total_den,
+               const SumLane& lane)
+{
+    GncInt128 den (lane.denom);
+    GncInt128 lcm = total_den.lcm (den);
+    total_num = total_num * (lcm / total_den) +
+        GncInt128 (lane.num) * (lcm / den);
+    total_den = lcm;
+}
+
+gnc_numeric
+gnc_numeric_sum_array(const gnc_numeric *values, size_t n_values,
+                      gint64 denom, gint how)
+{
+    SumLane lanes[SUM_LANES];
+    guint n_lanes = 0, next_victim = 0;
+    GncInt128 total_num (0), total_den (1);
+    gint64 fixed_denom = 0;
+    gboolean seen_nonzero = FALSE, mixed = FALSE;
+
+    if (!values && n_values)
+        return gnc_numeric_error (GNC_ERROR_ARG);
+
+    for (size_t i = 0; i < n_values; ++i)
+    {
+        gnc_numeric v = values[i];
+        GncInt128 product;
+        bool too_big = false;
+        guint lane;
+
+        if (gnc_numeric_check (v))
+            return gnc_numeric_error (GNC_ERROR_ARG);
+        if (v.denom < 0)        /* a multiplier, not a denominator */
+        {
+            product = GncInt128 (v.num) * -GncInt128 (v.denom);
+            too_big = product.isBig ();
+            if (!too_big)
+                v.num = static_cast<int64_t>(product);
+            v.denom = 1;
+        }
+
+        if (v.num != 0)
+        {
+            if (!seen_nonzero)
+                fixed_denom = v.denom;
+            else if (v.denom != fixed_denom)
+                mixed = TRUE;
+            seen_nonzero = TRUE;
+        }
+        else
+        {
+            if (i == 0)
+                fixed_denom = v.denom;
+            continue;
+        }
+
+        /* A product too big for a lane goes straight into the exact total;
+         * if the sum is as well, converting it back reports the overflow,
+         * as gnc_numeric_add would. */
+        if (too_big)
+        {
+            total_num += product * total_den;
+            continue;
+        }
+
+        for (lane = 0; lane < n_lanes; ++lane)
+            if (lanes[lane].denom == v.denom)
+                break;
+        if (lane == n_lanes)
+        {
+            if (n_lanes < SUM_LANES)
+                ++n_lanes;
+            else
+            {
+                lane = next_victim;
+                next_victim = (next_victim + 1) % SUM_LANES;
+                sum_fold_lane (total_num, total_den, lanes[lane]);
+            }
+            lanes[lane].denom = v.denom;
+            lanes[lane].num = 0;
+        }
+
+        gint64 sum;
+#if (defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__)
+        if (__builtin_add_overflow (lanes[lane].num, v.num, &sum))
+#else
+        sum = (gint64) ((guint64) lanes[lane].num + (guint64) v.num);
+        if ((v.num > 0 && sum < lanes[lane].num) ||
+            (v.num < 0 && sum > lanes[lane].num))
+#endif
+        {
+            sum_fold_lane (total_num, total_den, lanes[lane]);
+            sum = v.num;
+        }
+        lanes[lane].num = sum;
+    }
+
+    /* With a single lane and nothing folded yet, skip the 128-bit math
+     * entirely if no conversion is needed. */
+    if (n_lanes == 1 && total_num.isZero ())
+    {
+        gnc_numeric sum {lanes[0].num, lanes[0].denom};
+        gint type = how & GNC_NUMERIC_DENOM_MASK;
+        if (denom == sum.denom ||
+            (denom == GNC_DENOM_AUTO && type != GNC_HOW_DENOM_REDUCE &&
+             type != GNC_HOW_DENOM_SIGFIG))
+            return sum;
+    }
+
+    for (guint lane = 0; lane < n_lanes; ++lane)
+        sum_fold_lane (total_num, total_den, lanes[lane]);
+
+    if (denom == GNC_DENOM_AUTO &&
+        (how & GNC_NUMERIC_DENOM_MASK) == GNC_HOW_DENOM_FIXED)
+    {
+        if (mixed)
+            return gnc_numeric_error (GNC_ERROR_DENOM_DIFF);
+        if (!seen_nonzero)
+            return gnc_numeric_create (0, fixed_denom ? fixed_denom : 1);
+        denom = fixed_denom;
+    }
+
+    GncNumeric total (total_num, total_den), zero (gnc_numeric_zero());
+    GncDenom new_denom (total, zero, denom, how);
+    if (new_denom.m_error)
+        return gnc_numeric_error (new_denom.m_error);
+    total.round (new_denom);
+    return static_cast<gnc_numeric>(total);
+}
+
 /* *******************************************************************
  *  gnc_numeric_mul
  ********************************************************************/
@@ -328,6 +517,32 @@ gnc_numeric_div(gnc_numeric a, gnc_numeric b,
     return static_cast<gnc_numeric>(an.div(bn, new_denom));
 }
 
+/* *******************************************************************
+ *  gnc_numeric_mul_div
+ ********************************************************************/
+
+gnc_numeric
+gnc_numeric_mul_div(gnc_numeric a, gnc_numeric b, gnc_numeric c,
+                    gint64 denom, gint how)
+{
+    if (gnc_numeric_check(a) || gnc_numeric_check(b) ||
+        gnc_numeric_check(c))
+    {
+        return gnc_numeric_error(GNC_ERROR_ARG);
+    }
+
+    /* Two 64-bit factors can't overflow, so the product needs no
+     * rounding and goes straight into the division. */
+    GncNumeric an (a), bn (b), cn (c);
+    an.m_num *= bn.m_num;
+    an.m_den *= bn.m_den;
+    GncDenom new_denom (an, cn, denom, how);
+    if (new_denom.m_error)
+        return gnc_numeric_error (new_denom.m_error);
+
+    return static_cast<gnc_numeric>(an.div(cn, new_denom));
+}
+
 /* *******************************************************************
  *  gnc_numeric_neg
  *  negate the argument
@@ -688,15 +903,44 @@ gnc_numeric_div_with_error(gnc_numeric a, gnc_numeric b,
  ********************************************************************/
 
 gchar *
-gnc_numeric_to_string(gnc_numeric n)
+gnc_int64_to_buff(gint64 val, gchar *buff)
 {
-    gchar *result;
-    gint64 tmpnum = n.num;
-    gint64 tmpdenom = n.denom;
+    char digits[GNC_INT64_BUFF_SIZE];
+    char *end = digits + sizeof digits;
+    char *d = end;
+    /* The magnitude as unsigned, so that G_MININT64 needs no special case. */
+    guint64 mag = val < 0 ? 0 - static_cast<guint64>(val) : val;
 
-    result = g_strdup_printf("%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT, tmpnum, tmpdenom);
+    do
+    {
+        *--d = '0' + mag % 10;
+        mag /= 10;
+    }
+    while (mag);
+
+    if (val < 0)
+        *buff++ = '-';
+    memcpy(buff, d, end - d);
+    buff += end - d;
+    *buff = '\0';
+    return buff;
+}
+
+gchar *
+gnc_numeric_to_buff(gnc_numeric n, gchar *buff)
+{
+    buff = gnc_int64_to_buff(n.num, buff);
+    *buff++ = '/';
+    return gnc_int64_to_buff(n.denom, buff);
+}
+
+gchar *
+gnc_numeric_to_string(gnc_numeric n)
+{
+    gchar buff[GNC_NUMERIC_BUFF_SIZE];
 
-    return result;
+    gnc_numeric_to_buff(n, buff);
+    return g_strdup(buff);
 }
 
 gchar *
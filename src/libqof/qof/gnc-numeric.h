@@ -336,6 +336,21 @@ gdouble      gnc_numeric_to_double(gnc_numeric n);
  *  caller (it was allocated through g_strdup) */
 gchar *gnc_numeric_to_string(gnc_numeric n);
 
+/** The room gnc_int64_to_buff() needs: 19 digits, a sign and the NUL. */
+#define GNC_INT64_BUFF_SIZE 24
+/** The room gnc_numeric_to_buff() needs. */
+#define GNC_NUMERIC_BUFF_SIZE (2 * GNC_INT64_BUFF_SIZE)
+
+/** Write val in decimal to buff, which must hold GNC_INT64_BUFF_SIZE
+ *  characters, without allocating.
+ *  @return A pointer to the terminating NUL. */
+gchar *gnc_int64_to_buff(gint64 val, gchar *buff);
+
+/** Write n as gnc_numeric_to_string() does to buff, which must hold
+ *  GNC_NUMERIC_BUFF_SIZE characters, without allocating.
+ *  @return A pointer to the terminating NUL. */
+gchar *gnc_numeric_to_buff(gnc_numeric n, gchar *buff);
+
 /** Convert to string. Uses a static, non-thread-safe buffer.
  *  For internal use only. */
 gchar * gnc_num_dbg_to_string(gnc_numeric n);
@@ -417,6 +432,15 @@ gnc_numeric gnc_numeric_mul(gnc_numeric a, gnc_numeric b,
  */
 gnc_numeric gnc_numeric_div(gnc_numeric x, gnc_numeric y,
                             gint64 denom, gint how);
+
+/** Return a*b/c rounded once to denom as how specifies.  It's the
+ *  same as dividing gnc_numeric_mul(a, b, GNC_DENOM_AUTO,
+ *  GNC_HOW_DENOM_EXACT) by c, except that the product is kept at 128
+ *  bits rather than having to fit a gnc_numeric, so it's what to use
+ *  for valuations like amount * price / rate.
+ */
+gnc_numeric gnc_numeric_mul_div(gnc_numeric a, gnc_numeric b,
+                                gnc_numeric c, gint64 denom, gint how);
 /** Returns a newly created gnc_numeric that is the negative of the
  * given gnc_numeric value. For a given gnc_numeric "a/b" the returned
  * value is "-a/b".  */
@@ -448,6 +472,22 @@ gnc_numeric gnc_numeric_sub_fixed(gnc_numeric a, gnc_numeric b)
     return gnc_numeric_sub(a, b, GNC_DENOM_AUTO,
                            GNC_HOW_DENOM_FIXED | GNC_HOW_RND_NEVER);
 }
+
+/** Return the sum of the @a n_values numbers in @a values.  The sum is
+ *  computed exactly and converted to @a denom with @a how only once,
+ *  which makes it both faster and, when rounding, more accurate than
+ *  adding the values one at a time with gnc_numeric_add().  Values are
+ *  accumulated in 64 bits per distinct denominator, so long runs of
+ *  amounts in one commodity cost an integer add each.
+ *
+ *  The denominators of zero values are ignored.  With GNC_DENOM_AUTO
+ *  and GNC_HOW_DENOM_FIXED all of the non-zero values must have the
+ *  same denominator, or GNC_ERROR_DENOM_DIFF is returned.  An empty
+ *  array sums to zero, and an invalid value in the array makes the
+ *  result GNC_ERROR_ARG.
+ */
+gnc_numeric gnc_numeric_sum_array(const gnc_numeric *values, size_t n_values,
+                                  gint64 denom, gint how);
 /** @} */
 
 /** @name Arithmetic Functions with Exact Error Returns
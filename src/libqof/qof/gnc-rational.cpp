@@ -22,21 +22,97 @@
 
 #include "gnc-rational.hpp"
 
+#include <algorithm>
+#include <array>
+
 static const gint64 pten[] = { 1, 10, 100, 1000, 10000, 100000, 1000000,
 			       10000000, 100000000, 1000000000, 10000000000,
 			       100000000000, 1000000000000, 10000000000000,
-			       100000000000000, 10000000000000000,
-			       100000000000000000, 1000000000000000000};
+			       100000000000000, 1000000000000000,
+			       10000000000000000, 100000000000000000,
+			       1000000000000000000};
 static const int POWTEN_OVERFLOW {-5};
+static const int pten_max {sizeof (pten) / sizeof (pten[0]) - 1};
 
 static inline gint64
 powten (int exp)
 {
-    if (exp > 18 || exp < -18)
+    if (exp > pten_max || exp < -pten_max)
 	return POWTEN_OVERFLOW;
     return exp < 0 ? -pten[-exp] : pten[exp];
 }
 
+/* The exponent of val if it's a power of ten that fits in an int64_t,
+ * else -1. Nearly every denominator in a book is one.
+ */
+static int
+powten_exponent (const GncInt128& val) noexcept
+{
+    if (val.isNeg() || val.isBig() || val.isZero())
+        return -1;
+    auto num = static_cast<int64_t>(val);
+    auto power = std::lower_bound (pten, pten + pten_max + 1, num);
+    if (power == pten + pten_max + 1 || *power != num)
+        return -1;
+    return power - pten;
+}
+
+/* The number of decimal digits in val, less one, found by comparing it
+ * with the powers of ten up to 10^38 instead of dividing it by ten.
+ */
+static unsigned int
+decimal_digits (const GncInt128& val) noexcept
+{
+    static const auto powers = [] {
+        std::array<GncInt128, 39> p;
+        p[0] = 1;
+        for (size_t i = 1; i < p.size(); ++i)
+            p[i] = p[i - 1] * 10;
+        return p;
+    }();
+    auto digits = std::upper_bound (powers.begin(), powers.end(), val) -
+        powers.begin();
+    return digits > 1 ? digits - 1 : 0;
+}
+
+/* gcd(num, 10^exp) is 2^i * 5^j, where i and j are how often, up to
+ * exp, num divides by 2 and by 5; that's cheaper to find than running
+ * the general algorithm on the full width.
+ */
+static GncInt128
+powten_gcd (const GncInt128& num, int exp) noexcept
+{
+    auto rest = static_cast<uint64_t>(num.abs());
+    int twos {}, fives {};
+    while (twos < exp && !(rest & 1))
+    {
+        rest >>= 1;
+        ++twos;
+    }
+    int64_t factor {INT64_C(1) << twos};
+    while (fives < exp && rest % 5 == 0)
+    {
+        rest /= 5;
+        factor *= 5;
+        ++fives;
+    }
+    return factor;
+}
+
+/* The LCM of two denominators, skipping the GCD when they're equal or
+ * both powers of ten.
+ */
+static GncInt128
+denom_lcm (const GncInt128& a, const GncInt128& b) noexcept
+{
+    if (a == b)
+        return a;
+    auto a_exp = powten_exponent (a), b_exp = powten_exponent (b);
+    if (a_exp >= 0 && b_exp >= 0)
+        return a_exp > b_exp ? a : b;
+    return a.lcm (b);
+}
+
 GncRational::GncRational (gnc_numeric n) noexcept :
     m_num (n.num), m_den (n.denom), m_error {GNC_ERROR_OK}
 {
@@ -63,7 +139,11 @@ GncRational::operator gnc_numeric () const noexcept
     {
         return {static_cast<int64_t>(m_num), static_cast<int64_t>(m_den)};
     }
-    catch (std::overflow_error)
+    catch (const std::overflow_error&)
+    {
+        return gnc_numeric_error (GNC_ERROR_OVERFLOW);
+    }
+    catch (const std::underflow_error&)
     {
         return gnc_numeric_error (GNC_ERROR_OVERFLOW);
     }
@@ -152,8 +232,17 @@ GncRational::add (const GncRational& b, GncDenom& d) noexcept
             m_error = b.m_error;
         return *this;
     }
-    GncInt128 lcm = m_den.lcm (b.m_den);
-    m_num = m_num * lcm / m_den + b.m_num * lcm / b.m_den;
+    if (m_den == b.m_den)
+    {
+        m_num += b.m_num;
+        round (d);
+        return *this;
+    }
+    /* lcm divides exactly by both denominators, so divide first to
+     * keep the products small.
+     */
+    GncInt128 lcm = denom_lcm (m_den, b.m_den);
+    m_num = m_num * (lcm / m_den) + b.m_num * (lcm / b.m_den);
     m_den = lcm;
     round (d);
     return *this;
@@ -320,7 +409,7 @@ GncDenom::GncDenom (GncRational& a, GncRational& b,
         break;
 
     case DenomType::lcd:
-        m_value = a.m_den.lcm(b.m_den);
+        m_value = denom_lcm (a.m_den, b.m_den);
         m_auto = false;
         break;
     default:
@@ -339,8 +428,16 @@ GncDenom::reduce (const GncRational& a) noexcept
     default:
         break;
     case DenomType::reduce:
-        m_value = a.m_den / a.m_num.gcd(a.m_den);
+    {
+        auto exp = a.m_num.isBig() ? -1 : powten_exponent (a.m_den);
+        if (exp == 0)
+            m_value = 1;
+        else if (exp > 0)
+            m_value = a.m_den / powten_gcd (a.m_num, exp);
+        else
+            m_value = a.m_den / a.m_num.gcd(a.m_den);
         break;
+    }
 
     case DenomType::sigfigs:
         GncInt128 val {};
@@ -348,12 +445,7 @@ GncDenom::reduce (const GncRational& a) noexcept
             val = a.m_num.abs() / a.m_den;
         else
             val = a.m_den / a.m_num.abs();
-        unsigned int digits {};
-        while (val >= 10)
-        {
-            ++digits;
-            val /= 10;
-        }
+        unsigned int digits {decimal_digits (val)};
         m_value = (a.m_num.abs() > a.m_den ? powten (m_sigfigs - digits - 1) :
                    powten (m_sigfigs + digits));
         m_auto = false;
@@ -283,6 +283,7 @@ TimeZoneProvider::TimeZoneProvider (const std::string& identifier) :
     if (key_name.empty())
     {
         load_windows_default_tz();
+        compile_transitions();
         return;
     }
     std::string subkey = reg_key + key_name;
@@ -302,11 +303,17 @@ TimeZoneProvider::TimeZoneProvider (const std::string& identifier) :
 	this->load_windows_classic_tz (key, names);
     else
 	throw std::invalid_argument ("No data for TZ " + key_name);
+    compile_transitions();
 }
 #elif PLATFORM(POSIX)
 using std::to_string;
 #include <istream>
+#include <fstream>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using boost::posix_time::ptime;;
 //To enable using Transition with different meanings for IANA files
@@ -347,34 +354,35 @@ namespace IANAParser
 	uint8_t index;
     };
 
-    static std::unique_ptr<char[]>
-    find_tz_file(const std::string& name)
+    static std::string
+    tz_file_name(const std::string& name)
     {
-	std::ifstream ifs;
         auto tzname = name;
         if (tzname.empty())
             if (auto tzenv = getenv("TZ"))
                 tzname = std::string(std::getenv("TZ"));
         //std::cout << "Testing tzname " << tzname << "\n";
-        if (!tzname.empty())
-        {
+        if (tzname.empty())
+            return tzname;
 //POSIX specifies that that identifier should begin with ':', but we
 //should be liberal. If it's there, it's not part of the filename.
-	    if (tzname[0] == ':')
-		tzname.erase(tzname.begin());
-	    if (tzname[0] == '/') //Absolute filename
-	    {
-		ifs.open(tzname, std::ios::in|std::ios::binary|std::ios::ate);
-	    }
-	    else
-	    {
-		const char* tzdir_c = std::getenv("TZDIR");
-		std::string tzdir = tzdir_c ? tzdir_c : "/usr/share/zoneinfo";
+	if (tzname[0] == ':')
+	    tzname.erase(tzname.begin());
+	if (!tzname.empty() && tzname[0] == '/') //Absolute filename
+	    return tzname;
+	const char* tzdir_c = std::getenv("TZDIR");
+	std::string tzdir = tzdir_c ? tzdir_c : "/usr/share/zoneinfo";
 //Note that we're not checking the filename.
-		ifs.open(std::move(tzdir + "/" + tzname),
-			 std::ios::in|std::ios::binary|std::ios::ate);
-	    }
-	}
+	return tzdir + "/" + tzname;
+    }
+
+    static std::unique_ptr<char[]>
+    find_tz_file(const std::string& name)
+    {
+	std::ifstream ifs;
+        auto filename = tz_file_name(name);
+        if (!filename.empty())
+	    ifs.open(filename, std::ios::in|std::ios::binary|std::ios::ate);
 
 	if (! ifs.is_open())
 	    throw std::invalid_argument("The timezone string failed to resolve to a valid filename");
@@ -603,6 +611,7 @@ void
 TimeZoneProvider::parse_file(const std::string& tzname)
 {
     IANAParser::IANAParser parser(tzname);
+    zone_file = IANAParser::tz_file_name(tzname);
     auto last_info = std::find_if(parser.tzinfo.begin(), parser.tzinfo.end(),
                                   [](IANAParser::TZInfo tz)
                                   {return !tz.info.isdst;});
@@ -694,9 +703,145 @@ TimeZoneProvider::TimeZoneProvider(const std::string& tzname) :  zone_vector {}
             }
         }
     }
+    auto cache_dir = std::getenv("GNC_TZ_CACHE_DIR");
+    if (!cache_dir || !*cache_dir || zone_file.empty())
+    {
+        compile_transitions();
+        return;
+    }
+    if (load_transitions(cache_dir))
+        return;
+    compile_transitions();
+    save_transitions(cache_dir);
+}
+
+/* A cache file holds the transitions compiled from one zoneinfo file, in
+ * the machine's byte order: the magic, the zoneinfo file's name, the
+ * key that tells whether it has changed, the year range, transitions_end,
+ * the number of transitions and then the transitions themselves. The
+ * magic's version must change whenever compile_transitions does.
+ */
+static const char tz_cache_magic[8] = {'G', 'N', 'C', 'T', 'Z', 'C', 0, 1};
+
+struct TZCacheKey
+{
+    int64_t mtime;
+    int64_t size;
+    int64_t inode;
+    uint32_t min_year;
+    uint32_t max_year;
+};
+
+static bool
+tz_cache_key(const std::string& zone_file, TZCacheKey& key)
+{
+    struct stat info;
+    if (stat(zone_file.c_str(), &info))
+        return false;
+    memset(&key, 0, sizeof key);
+    key.mtime = info.st_mtime;
+    key.size = info.st_size;
+    key.inode = info.st_ino;
+    key.min_year = TimeZoneProvider::min_year;
+    key.max_year = TimeZoneProvider::max_year;
+    return true;
+}
+
+static std::string
+tz_cache_file_name(const std::string& cache_dir, const std::string& zone_file)
+{
+    auto name = zone_file;
+    std::replace(name.begin(), name.end(), '/', '_');
+    return cache_dir + "/" + name + ".tzcache";
+}
+
+bool
+TimeZoneProvider::load_transitions(const std::string& cache_dir)
+{
+    TZCacheKey key, file_key;
+    if (!tz_cache_key(zone_file, key))
+        return false;
+    std::ifstream ifs(tz_cache_file_name(cache_dir, zone_file),
+                      std::ios::in|std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    char magic[sizeof tz_cache_magic];
+    uint32_t name_len {0};
+    ifs.read(magic, sizeof magic);
+    ifs.read(reinterpret_cast<char*>(&name_len), sizeof name_len);
+    if (!ifs || memcmp(magic, tz_cache_magic, sizeof magic) ||
+        name_len != zone_file.size())
+        return false;
+    std::string name(name_len, '\0');
+    ifs.read(&name[0], name_len);
+    ifs.read(reinterpret_cast<char*>(&file_key), sizeof file_key);
+    if (!ifs || name != zone_file || memcmp(&key, &file_key, sizeof key))
+        return false;
+
+    int64_t end {0};
+    uint64_t count {0};
+    ifs.read(reinterpret_cast<char*>(&end), sizeof end);
+    ifs.read(reinterpret_cast<char*>(&count), sizeof count);
+    /* Even a zone changing every month wouldn't come near this. */
+    if (!ifs || count == 0 || count > (max_year - min_year + 1) * 64)
+        return false;
+    TZ_Transitions cached(count);
+    ifs.read(reinterpret_cast<char*>(cached.data()),
+             count * sizeof(TZ_Transition));
+    if (!ifs)
+        return false;
+    for (size_t i = 1; i < cached.size(); ++i)
+        if (cached[i].utc <= cached[i - 1].utc)
+            return false;
+
+    transitions = std::move(cached);
+    transitions_end = end;
+    return true;
+}
+
+void
+TimeZoneProvider::save_transitions(const std::string& cache_dir) const
+{
+    TZCacheKey key;
+    if (transitions.empty() || !tz_cache_key(zone_file, key))
+        return;
+    auto filename = tz_cache_file_name(cache_dir, zone_file);
+    /* Written aside and renamed into place so that another process never
+     * reads half a file. */
+    auto tempname = filename + "." + to_string(getpid());
+    {
+        std::ofstream ofs(tempname, std::ios::out|std::ios::binary|std::ios::trunc);
+        uint32_t name_len = zone_file.size();
+        uint64_t count = transitions.size();
+        ofs.write(tz_cache_magic, sizeof tz_cache_magic);
+        ofs.write(reinterpret_cast<const char*>(&name_len), sizeof name_len);
+        ofs.write(zone_file.data(), name_len);
+        ofs.write(reinterpret_cast<const char*>(&key), sizeof key);
+        ofs.write(reinterpret_cast<const char*>(&transitions_end),
+                  sizeof transitions_end);
+        ofs.write(reinterpret_cast<const char*>(&count), sizeof count);
+        ofs.write(reinterpret_cast<const char*>(transitions.data()),
+                  count * sizeof(TZ_Transition));
+        ofs.close();
+        if (ofs)
+        {
+            if (std::rename(tempname.c_str(), filename.c_str()) == 0)
+                return;
+        }
+    }
+    PWARN("Unable to write the time zone cache %s", filename.c_str());
+    std::remove(tempname.c_str());
 }
 #endif
 
+const TimeZoneProvider&
+TimeZoneProvider::instance()
+{
+    static const TimeZoneProvider tzp;
+    return tzp;
+}
+
 
 TZ_Ptr
 TimeZoneProvider::get(int year) const noexcept
@@ -714,3 +859,111 @@ TimeZoneProvider::get(int year) const noexcept
     }
     return iter->second;
 }
+
+/* The transitions of each year are at its start, where get() may switch
+ * zones, and where the zone's DST starts and ends. boost decides DST
+ * from the local standard time, comparing it with the start and end
+ * times and with those moved by the DST offset, so each of those is a
+ * candidate, in the years either side as well as this one since the
+ * local year can differ from the UTC year. Each candidate is checked with a
+ * local_date_time so that the table gives what boost does; runs of the
+ * same offset are merged.
+ */
+static int64_t
+epoch_seconds (const boost::posix_time::ptime& time)
+{
+    static const boost::posix_time::ptime epoch (boost::gregorian::date(1970, 1, 1));
+    return (time - epoch).ticks() / duration::ticks_per_second();
+}
+
+void
+TimeZoneProvider::compile_transitions()
+{
+    using boost::gregorian::date;
+    using boost::posix_time::ptime;
+    using LDT = boost::local_time::local_date_time;
+
+    transitions.clear();
+    transitions_end = epoch_seconds(ptime(date(max_year, 1, 1))) +
+        INT64_C(365) * 86400;
+    for (int year = min_year; year <= static_cast<int>(max_year); ++year)
+    {
+        auto tz = get(year);
+        auto year_start = epoch_seconds(ptime(date(year, 1, 1)));
+        auto year_end = year < static_cast<int>(max_year) ?
+            epoch_seconds(ptime(date(year + 1, 1, 1))) : transitions_end;
+        auto base = tz->base_utc_offset().total_seconds();
+        std::vector<int64_t> candidates {year_start};
+        if (tz->has_dst())
+        {
+            int64_t dst_len = tz->dst_offset().total_seconds();
+            for (int local_year = year - 1; local_year <= year + 1; ++local_year)
+            {
+                try
+                {
+                    auto start = epoch_seconds(tz->dst_local_start_time(local_year)) - base;
+                    auto end = epoch_seconds(tz->dst_local_end_time(local_year)) - base;
+                    for (auto shift : {-dst_len, int64_t{0}, dst_len})
+                    {
+                        candidates.push_back(start + shift);
+                        candidates.push_back(end + shift);
+                    }
+                }
+                catch(const std::out_of_range&)
+                {
+                    continue;
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+        }
+        for (auto utc : candidates)
+        {
+            if (utc < year_start || utc >= year_end)
+                continue;
+            int32_t isdst {0}, offset {static_cast<int32_t>(base)};
+            if (tz->has_dst())
+            {
+                try
+                {
+                    LDT ldt (ptime(date(1970, 1, 1),
+                                   duration(utc / 3600, 0, utc % 3600)), tz);
+                    isdst = ldt.is_dst();
+                    offset = (ldt.local_time() - ldt.utc_time()).total_seconds();
+                }
+                catch(const std::out_of_range&)
+                {
+                    continue;
+                }
+            }
+            if (!transitions.empty() && transitions.back().offset == offset &&
+                transitions.back().isdst == isdst)
+                continue;
+            transitions.push_back({utc, offset, isdst});
+        }
+    }
+}
+
+bool
+TimeZoneProvider::get_offset(int64_t utc, long& offset, int& isdst) const noexcept
+{
+    static thread_local size_t last {0};
+    if (transitions.empty() || utc < transitions.front().utc ||
+        utc >= transitions_end)
+        return false;
+    auto contains = [&](size_t i)
+        {
+            return transitions[i].utc <= utc &&
+                (i + 1 == transitions.size() || utc < transitions[i + 1].utc);
+        };
+    if (last >= transitions.size() || !contains(last))
+    {
+        auto iter = std::upper_bound(transitions.begin(), transitions.end(),
+                                     utc, [](int64_t t, const TZ_Transition& tr)
+                                     { return t < tr.utc; });
+        last = iter - transitions.begin() - 1;
+    }
+    offset = transitions[last].offset;
+    isdst = transitions[last].isdst;
+    return true;
+}
+
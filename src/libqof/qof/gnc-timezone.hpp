@@ -32,6 +32,9 @@ extern "C"
 
 #define BOOST_ERROR_CODE_HEADER_ONLY
 #include <boost/date_time/local_time/local_time.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace gnc
 {
@@ -44,6 +47,17 @@ using TZ_Entry = std::pair<int, TZ_Ptr>;
 using TZ_Vector = std::vector<TZ_Entry>;
 using time_zone_names = boost::local_time::time_zone_names;
 
+/** From utc, in seconds from the POSIX epoch, until the next transition
+ * local time is utc + offset seconds, and daylight time if isdst.
+ */
+struct TZ_Transition
+{
+    int64_t utc;
+    int32_t offset;
+    int32_t isdst;
+};
+using TZ_Transitions = std::vector<TZ_Transition>;
+
 class TimeZoneProvider
 {
 public:
@@ -55,15 +69,38 @@ public:
     TimeZoneProvider operator=(const TimeZoneProvider&) = delete;
     TimeZoneProvider operator=(const TimeZoneProvider&&) = delete;
     TZ_Ptr get (int year) const noexcept;
+/** Find the UTC offset in seconds and whether it's daylight time at utc,
+ * seconds from the POSIX epoch, by a binary search of the transitions
+ * compiled from the zones when the provider was made. The answer is the
+ * one a boost::local_time::local_date_time in get(utc's year) gives.
+ * @return false if utc is outside min_year to max_year.
+ */
+    bool get_offset (int64_t utc, long& offset, int& isdst) const noexcept;
+/** The provider for the current locale's time zone, made the first time it's
+ * asked for and shared by every caller from then on.
+ *
+ * Compiling the transitions of 1400 to 9999 is much the slowest part of
+ * making a provider. If the environment variable GNC_TZ_CACHE_DIR names a
+ * directory, a provider parsed from a zoneinfo file keeps its compiled
+ * transitions there and reads them back until the file changes.
+ */
+    static const TimeZoneProvider& instance();
     static const unsigned int min_year; //1400
     static const unsigned int max_year; //9999
 private:
     void parse_file(const std::string& tzname);
+    void compile_transitions();
     TZ_Vector zone_vector;
+    TZ_Transitions transitions;
+    int64_t transitions_end;
 #if PLATFORM(WINDOWS)
     void load_windows_dynamic_tz(HKEY, time_zone_names);
     void load_windows_classic_tz(HKEY, time_zone_names);
     void load_windows_default_tz(void);
+#else
+    bool load_transitions(const std::string& cache_dir);
+    void save_transitions(const std::string& cache_dir) const;
+    std::string zone_file; //The zoneinfo file parsed, if any.
 #endif
 };
 
@@ -0,0 +1,156 @@
+/********************************************************************
+ * guid-table.cpp - Open-addressing hash table keyed by GncGUID.    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ *******************************************************************/
+
+#include "guid-table.hpp"
+#include <cstring>
+#include <utility>
+
+static const size_t initial_slots = 16;
+static const size_t npos = static_cast<size_t>(-1);
+
+/* Fold the two halves together so that GUIDs which only differ in their
+ * last eight bytes still land in different slots. */
+uint64_t
+GncGuidTable::hash(const GncGUID& guid) noexcept
+{
+    uint64_t head, tail;
+    std::memcpy(&head, guid.reserved, sizeof(head));
+    std::memcpy(&tail, guid.reserved + sizeof(head), sizeof(tail));
+    return head ^ tail;
+}
+
+/* How far the entry at index is from the slot it hashes to. */
+size_t
+GncGuidTable::probe_distance(size_t index) const noexcept
+{
+    auto mask = m_slots.size() - 1;
+    return (index - (hash(m_slots[index].guid) & mask)) & mask;
+}
+
+size_t
+GncGuidTable::find(const GncGUID& guid) const noexcept
+{
+    if (m_slots.empty())
+        return npos;
+    auto mask = m_slots.size() - 1;
+    auto index = hash(guid) & mask;
+    for (size_t dist = 0; ; ++dist, index = (index + 1) & mask)
+    {
+        auto& slot = m_slots[index];
+        /* An entry closer to home than we are would have been displaced by
+         * guid had it been inserted, so guid isn't here. */
+        if (!slot.value || probe_distance(index) < dist)
+            return npos;
+        if (std::memcmp(slot.guid.reserved, guid.reserved,
+                        GUID_DATA_SIZE) == 0)
+            return index;
+    }
+}
+
+void*
+GncGuidTable::lookup(const GncGUID& guid) const noexcept
+{
+    auto index = find(guid);
+    return index == npos ? nullptr : m_slots[index].value;
+}
+
+/* Put a slot known not to be in the table into it, displacing any entry that
+ * is nearer its home than the one being placed. */
+void
+GncGuidTable::place(Slot slot) noexcept
+{
+    auto mask = m_slots.size() - 1;
+    auto index = hash(slot.guid) & mask;
+    for (size_t dist = 0; ; ++dist, index = (index + 1) & mask)
+    {
+        auto& here = m_slots[index];
+        if (!here.value)
+        {
+            here = slot;
+            return;
+        }
+        auto here_dist = probe_distance(index);
+        if (here_dist < dist)
+        {
+            std::swap(here, slot);
+            dist = here_dist;
+        }
+    }
+}
+
+void
+GncGuidTable::grow()
+{
+    std::vector<Slot> old(m_slots.empty() ? initial_slots :
+                          m_slots.size() * 2, Slot{});
+    m_slots.swap(old);
+    for (auto& slot : old)
+        if (slot.value)
+            place(slot);
+}
+
+void
+GncGuidTable::insert(const GncGUID& guid, void* value)
+{
+    if (!value)
+    {
+        remove(guid);
+        return;
+    }
+    auto index = find(guid);
+    if (index != npos)
+    {
+        m_slots[index].value = value;
+        return;
+    }
+    if ((m_size + 1) * 8 > m_slots.size() * 7)
+        grow();
+    place(Slot{guid, value});
+    ++m_size;
+}
+
+bool
+GncGuidTable::remove(const GncGUID& guid) noexcept
+{
+    auto index = find(guid);
+    if (index == npos)
+        return false;
+    auto mask = m_slots.size() - 1;
+    for (auto next = (index + 1) & mask;
+         m_slots[next].value && probe_distance(next) > 0;
+         index = next, next = (next + 1) & mask)
+        m_slots[index] = m_slots[next];
+    m_slots[index].value = nullptr;
+    --m_size;
+    return true;
+}
+
+std::vector<void*>
+GncGuidTable::values() const
+{
+    std::vector<void*> ret;
+    ret.reserve(m_size);
+    for (auto& slot : m_slots)
+        if (slot.value)
+            ret.push_back(slot.value);
+    return ret;
+}
@@ -0,0 +1,97 @@
+/********************************************************************
+ * guid-table.hpp - Open-addressing hash table keyed by GncGUID.    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ *******************************************************************/
+#ifndef GUID_TABLE_HPP_HEADER
+#define GUID_TABLE_HPP_HEADER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+extern "C" {
+#include "guid.h"
+}
+
+/** Maps GncGUIDs to pointers; QofCollection uses it to find its instances.
+ *
+ * The GUIDs are stored in the table itself rather than pointed to, and since
+ * they are already random their bytes are used as the hash without further
+ * mixing. Collisions are resolved by linear probing with Robin Hood
+ * displacement, which keeps probe sequences short enough that the table can
+ * be filled to 7/8 before it grows, and removal shifts the following entries
+ * back so that no tombstones are needed.
+ *
+ * Values may not be nullptr, which marks an empty slot.
+ */
+class GncGuidTable
+{
+public:
+    GncGuidTable() noexcept = default;
+    GncGuidTable(const GncGuidTable&) = delete;
+    GncGuidTable& operator=(const GncGuidTable&) = delete;
+
+    /** Return the value stored for guid, or nullptr if there isn't one. */
+    void* lookup(const GncGUID& guid) const noexcept;
+    /** Store value for guid, replacing any value already there. */
+    void insert(const GncGUID& guid, void* value);
+    /** Remove guid from the table.
+     * @return true if it was there. */
+    bool remove(const GncGUID& guid) noexcept;
+    size_t size() const noexcept { return m_size; }
+    /** Copy out the values, in no particular order. Callers iterating over
+     * the result may change the table meanwhile. */
+    std::vector<void*> values() const;
+    /** Call func with each value, in no particular order. func mustn't
+     * insert into or remove from the table. */
+    template <typename F> void for_each(F func) const
+    {
+        for_each_in_chunk(0, 1, func);
+    }
+    /** Call func with the values in the chunk'th of n_chunks equal parts
+     * of the table. The chunks together cover each value once, so that
+     * separate threads can walk separate chunks while nothing changes the
+     * table. */
+    template <typename F> void
+    for_each_in_chunk(size_t chunk, size_t n_chunks, F func) const
+    {
+        auto slots = m_slots.size();
+        auto end = slots * (chunk + 1) / n_chunks;
+        for (auto index = slots * chunk / n_chunks; index < end; ++index)
+            if (m_slots[index].value)
+                func(m_slots[index].value);
+    }
+
+private:
+    struct Slot
+    {
+        GncGUID guid;
+        void* value;
+    };
+    static uint64_t hash(const GncGUID& guid) noexcept;
+    size_t probe_distance(size_t index) const noexcept;
+    size_t find(const GncGUID& guid) const noexcept;
+    void place(Slot slot) noexcept;
+    void grow();
+
+    std::vector<Slot> m_slots;
+    size_t m_size = 0;
+};
+
+#endif //GUID_TABLE_HPP_HEADER
@@ -58,10 +58,144 @@ extern "C"
 #include <boost/uuid/uuid_io.hpp>
 #include <sstream>
 #include <string>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
+/* Hex codecs *******************************************************/
+
+/* The backends convert every GncGUID to and from its 32 lower case hex
+ * digits, so these avoid boost's generic UUID formatting and parsing,
+ * which allocate and throw. guid_hex_decode accepts either case, like
+ * boost::uuids::string_generator, but only the undecorated form; callers
+ * fall back to the generator for anything else. */
+
+static void
+guid_hex_encode (const unsigned char * bytes, char * out) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i nibble = _mm_set1_epi8 (0x0f);
+    const __m128i nine = _mm_set1_epi8 (9);
+    const __m128i zero = _mm_set1_epi8 ('0');
+    const __m128i alpha = _mm_set1_epi8 ('a' - '0' - 10);
+    __m128i in = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(bytes));
+    __m128i hi = _mm_and_si128 (_mm_srli_epi16 (in, 4), nibble);
+    __m128i lo = _mm_and_si128 (in, nibble);
+    __m128i digits[2] = { _mm_unpacklo_epi8 (hi, lo),
+                          _mm_unpackhi_epi8 (hi, lo) };
+    for (int i = 0; i < 2; ++i)
+    {
+        __m128i letters = _mm_and_si128 (_mm_cmpgt_epi8 (digits[i], nine),
+                                         alpha);
+        __m128i chars = _mm_add_epi8 (_mm_add_epi8 (digits[i], zero), letters);
+        _mm_storeu_si128 (reinterpret_cast<__m128i*>(out + 16 * i), chars);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t nine = vdupq_n_u8 (9);
+    const uint8x16_t zero = vdupq_n_u8 ('0');
+    const uint8x16_t alpha = vdupq_n_u8 ('a' - '0' - 10);
+    uint8x16_t in = vld1q_u8 (bytes);
+    uint8x16_t digits[2] = { vshrq_n_u8 (in, 4),
+                             vandq_u8 (in, vdupq_n_u8 (0x0f)) };
+    uint8x16x2_t chars;
+    for (int i = 0; i < 2; ++i)
+        chars.val[i] = vaddq_u8 (vaddq_u8 (digits[i], zero),
+                                 vandq_u8 (vcgtq_u8 (digits[i], nine), alpha));
+    vst2q_u8 (reinterpret_cast<uint8_t*>(out), chars);
+#else
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < GUID_DATA_SIZE; ++i)
+    {
+        out[2 * i] = hex[bytes[i] >> 4];
+        out[2 * i + 1] = hex[bytes[i] & 0x0f];
+    }
+#endif
+    out[GUID_ENCODING_LENGTH] = '\0';
+}
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON)
+static inline int
+hex_digit_value (unsigned char c) noexcept
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+#endif
+
+/* Decode str if it is exactly GUID_ENCODING_LENGTH hex digits. */
+static bool
+guid_hex_decode (const char * str, unsigned char * bytes) noexcept
+{
+    /* Make sure the vector loads stay within the string. */
+    if (strnlen (str, GUID_ENCODING_LENGTH + 1) != GUID_ENCODING_LENGTH)
+        return false;
+#if defined(__SSE2__)
+    const __m128i case_bit = _mm_set1_epi8 (0x20);
+    __m128i values[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        __m128i c = _mm_loadu_si128 (reinterpret_cast<const __m128i*>(str + 16 * i));
+        /* Bytes above 0x7f are negative, so they fail both tests. */
+        __m128i is_digit = _mm_and_si128 (_mm_cmpgt_epi8 (c, _mm_set1_epi8 ('0' - 1)),
+                                          _mm_cmplt_epi8 (c, _mm_set1_epi8 ('9' + 1)));
+        __m128i l = _mm_or_si128 (c, case_bit);
+        __m128i is_alpha = _mm_and_si128 (_mm_cmpgt_epi8 (l, _mm_set1_epi8 ('a' - 1)),
+                                          _mm_cmplt_epi8 (l, _mm_set1_epi8 ('f' + 1)));
+        if (_mm_movemask_epi8 (_mm_or_si128 (is_digit, is_alpha)) != 0xffff)
+            return false;
+        __m128i v = _mm_or_si128 (
+            _mm_and_si128 (is_digit, _mm_sub_epi8 (c, _mm_set1_epi8 ('0'))),
+            _mm_and_si128 (is_alpha, _mm_sub_epi8 (l, _mm_set1_epi8 ('a' - 10))));
+        /* Each 16 bit lane holds a high nibble in its low byte and a low
+         * nibble in its high byte; combine them into the low byte. */
+        values[i] = _mm_or_si128 (
+            _mm_slli_epi16 (_mm_and_si128 (v, _mm_set1_epi16 (0x00ff)), 4),
+            _mm_srli_epi16 (v, 8));
+    }
+    _mm_storeu_si128 (reinterpret_cast<__m128i*>(bytes),
+                      _mm_packus_epi16 (values[0], values[1]));
+    return true;
+#elif defined(__ARM_NEON)
+    uint8x16x2_t c = vld2q_u8 (reinterpret_cast<const uint8_t*>(str));
+    uint8x16_t v[2];
+    uint8x16_t valid = vdupq_n_u8 (0xff);
+    for (int i = 0; i < 2; ++i)
+    {
+        uint8x16_t d = vsubq_u8 (c.val[i], vdupq_n_u8 ('0'));
+        uint8x16_t l = vsubq_u8 (vorrq_u8 (c.val[i], vdupq_n_u8 (0x20)),
+                                 vdupq_n_u8 ('a'));
+        uint8x16_t is_digit = vcltq_u8 (d, vdupq_n_u8 (10));
+        uint8x16_t is_alpha = vcltq_u8 (l, vdupq_n_u8 (6));
+        valid = vandq_u8 (valid, vorrq_u8 (is_digit, is_alpha));
+        v[i] = vbslq_u8 (is_digit, d, vaddq_u8 (l, vdupq_n_u8 (10)));
+    }
+    uint8x8_t folded = vand_u8 (vget_low_u8 (valid), vget_high_u8 (valid));
+    if (vget_lane_u64 (vreinterpret_u64_u8 (folded), 0) != ~UINT64_C(0))
+        return false;
+    vst1q_u8 (bytes, vorrq_u8 (vshlq_n_u8 (v[0], 4), v[1]));
+    return true;
+#else
+    for (int i = 0; i < GUID_DATA_SIZE; ++i)
+    {
+        int hi = hex_digit_value (str[2 * i]);
+        int lo = hex_digit_value (str[2 * i + 1]);
+        if (hi < 0 || lo < 0)
+            return false;
+        bytes[i] = (hi << 4) | lo;
+    }
+    return true;
+#endif
+}
+
 /**
  * gnc_value_get_guid
  *
@@ -165,9 +299,9 @@ gchar *
 guid_to_string (const GncGUID * guid)
 {
     if (!guid) return nullptr;
-    gnc::GUID temp {*guid};
-    auto temp_str = temp.to_string ();
-    return g_strdup (temp_str.c_str ());
+    gchar *str = static_cast<gchar*>(g_malloc (GUID_ENCODING_LENGTH + 1));
+    guid_hex_encode (guid->reserved, str);
+    return str;
 }
 
 gchar *
@@ -175,11 +309,8 @@ guid_to_string_buff (const GncGUID * guid, gchar *str)
 {
     if (!str || !guid) return NULL;
 
-    gnc::GUID temp {*guid};
-    auto val = temp.to_string ();
-    /*We need to be sure to copy the terminating null character.*/
-    std::copy (val.c_str (), val.c_str () + val.size () + 1, str);
-    return str + val.size ();
+    guid_hex_encode (guid->reserved, str);
+    return str + GUID_ENCODING_LENGTH;
 }
 
 gboolean
@@ -187,6 +318,8 @@ string_to_guid (const char * str, GncGUID * guid)
 {
     if (!guid || !str) return false;
 
+    if (guid_hex_decode (str, guid->reserved))
+        return true;
     try
     {
         guid_assign (*guid, gnc::GUID::from_string (str));
@@ -310,14 +443,116 @@ gnc_guid_get_type (void)
     return type;
 }
 
+namespace
+{
+
+/* A ChaCha20 keystream (RFC 7539, with a 64 bit block counter and no
+ * nonce) used as the random number generator for new GUIDs. Each thread
+ * has its own, keyed once from boost's system-seeded generator, and
+ * computes several blocks at a time. */
+class GuidRandom
+{
+public:
+    GuidRandom ();
+    void fill (uint8_t * out) noexcept;
+
+private:
+    void refill () noexcept;
+
+    static const size_t block_size = 64;
+    static const size_t buffer_blocks = 16;
+    uint32_t m_state[16];
+    uint8_t m_buffer[block_size * buffer_blocks];
+    size_t m_used;
+};
+
+GuidRandom::GuidRandom () : m_used {sizeof (m_buffer)}
+{
+    /* "expand 32-byte k" */
+    m_state[0] = 0x61707865;
+    m_state[1] = 0x3320646e;
+    m_state[2] = 0x79622d32;
+    m_state[3] = 0x6b206574;
+    boost::uuids::random_generator seeder;
+    auto key1 = seeder ();
+    auto key2 = seeder ();
+    memcpy (&m_state[4], key1.data, 16);
+    memcpy (&m_state[8], key2.data, 16);
+    for (int i = 12; i < 16; ++i)
+        m_state[i] = 0;
+}
+
+static inline uint32_t
+rotl (uint32_t v, int n) noexcept
+{
+    return (v << n) | (v >> (32 - n));
+}
+
+#define QUARTERROUND(a, b, c, d) \
+    x[a] += x[b]; x[d] = rotl (x[d] ^ x[a], 16); \
+    x[c] += x[d]; x[b] = rotl (x[b] ^ x[c], 12); \
+    x[a] += x[b]; x[d] = rotl (x[d] ^ x[a], 8);  \
+    x[c] += x[d]; x[b] = rotl (x[b] ^ x[c], 7)
+
+void
+GuidRandom::refill () noexcept
+{
+    for (size_t block = 0; block < buffer_blocks; ++block)
+    {
+        uint32_t x[16];
+        memcpy (x, m_state, sizeof (x));
+        for (int round = 0; round < 10; ++round)
+        {
+            QUARTERROUND (0, 4, 8, 12);
+            QUARTERROUND (1, 5, 9, 13);
+            QUARTERROUND (2, 6, 10, 14);
+            QUARTERROUND (3, 7, 11, 15);
+            QUARTERROUND (0, 5, 10, 15);
+            QUARTERROUND (1, 6, 11, 12);
+            QUARTERROUND (2, 7, 8, 13);
+            QUARTERROUND (3, 4, 9, 14);
+        }
+        auto out = m_buffer + block * block_size;
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t v = x[i] + m_state[i];
+            out[4 * i] = v;
+            out[4 * i + 1] = v >> 8;
+            out[4 * i + 2] = v >> 16;
+            out[4 * i + 3] = v >> 24;
+        }
+        if (++m_state[12] == 0)
+            ++m_state[13];
+    }
+    m_used = 0;
+}
+
+#undef QUARTERROUND
+
+void
+GuidRandom::fill (uint8_t * out) noexcept
+{
+    if (m_used + GUID_DATA_SIZE > sizeof (m_buffer))
+        refill ();
+    memcpy (out, m_buffer + m_used, GUID_DATA_SIZE);
+    m_used += GUID_DATA_SIZE;
+}
+
+}
+
 namespace gnc
 {
 
 GUID
 GUID::create_random () noexcept
 {
-    static boost::uuids::random_generator gen;
-    return {gen ()};
+    static thread_local GuidRandom gen;
+    boost::uuids::uuid ret;
+    gen.fill (ret.data);
+    /* Mark it as a version 4 (random) UUID, as boost's generator does. */
+    ret.data[6] = (ret.data[6] & 0x0f) | 0x40;
+    ret.data[8] = (ret.data[8] & 0x3f) | 0x80;
+    return {ret};
 }
 
 GUID::GUID (boost::uuids::uuid const & other) noexcept
@@ -334,17 +569,17 @@ GUID::null_guid () noexcept
 std::string
 GUID::to_string () const noexcept
 {
-    auto const & val = boost::uuids::to_string (implementation);
-    std::string ret;
-    std::for_each (val.begin (), val.end (), [&ret] (char a) {
-        if (a != '-') ret.push_back (a);
-    });
-    return ret;
+    char buf[GUID_ENCODING_LENGTH + 1];
+    guid_hex_encode (implementation.data, buf);
+    return {buf, GUID_ENCODING_LENGTH};
 }
 
 GUID
 GUID::from_string (std::string const & str) throw (guid_syntax_exception)
 {
+    boost::uuids::uuid ret;
+    if (guid_hex_decode (str.c_str (), ret.data))
+        return {ret};
     try
     {
         static boost::uuids::string_generator strgen;
@@ -377,12 +377,53 @@ delete_visitor::operator()(KvpFrame * & value)
     delete value;
 }
 
+void*
+KvpValueImpl::operator new(size_t size)
+{
+    return g_slice_alloc(size);
+}
+
+void
+KvpValueImpl::operator delete(void* ptr, size_t size) noexcept
+{
+    g_slice_free1(size, ptr);
+}
+
 KvpValueImpl::~KvpValueImpl() noexcept
 {
     delete_visitor d;
     boost::apply_visitor(d, datastore);
 }
 
+void
+KvpValueImpl::add_memory_usage (KvpMemoryUsage& usage) const noexcept
+{
+    ++usage.values;
+    usage.bytes += sizeof(*this);
+    if (datastore.type() == typeid(const gchar *))
+    {
+        auto str = get<const gchar *>();
+        usage.bytes += str ? strlen (str) + 1 : 0;
+    }
+    else if (datastore.type() == typeid(GncGUID*))
+        usage.bytes += sizeof(GncGUID);
+    else if (datastore.type() == typeid(GList*))
+    {
+        for (auto node = get<GList *>(); node != nullptr; node = node->next)
+        {
+            usage.bytes += sizeof(GList);
+            if (node->data)
+                static_cast<KvpValueImpl*>(node->data)->add_memory_usage (usage);
+        }
+    }
+    else if (datastore.type() == typeid(KvpFrame*))
+    {
+        auto frame = get<KvpFrame *>();
+        if (frame)
+            frame->add_memory_usage (usage);
+    }
+}
+
 void
 KvpValueImpl::duplicate(const KvpValueImpl& other) noexcept
 {
@@ -54,6 +54,16 @@ extern "C"
  * * GDate
  */
 
+/** What a KVP tree holds, as counted by the memory accounting. The bytes
+ * are an estimate: the structures and their payloads, without the
+ * allocators' overhead or the keys, which are in the string cache. */
+struct KvpMemoryUsage
+{
+    size_t frames;
+    size_t values;
+    size_t bytes;
+};
+
 struct KvpValueImpl
 {
     public:
@@ -106,6 +116,12 @@ struct KvpValueImpl
      */
     ~KvpValueImpl() noexcept;
 
+    /**
+     * Values are small and numerous, so they come from GSlice's slabs.
+     */
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size) noexcept;
+
     /**
      * Replaces the frame within this KvpValueImpl.
      *
@@ -139,6 +155,9 @@ struct KvpValueImpl
 
     char * to_string() const noexcept;
 
+    /** Add this value and whatever it holds to usage. */
+    void add_memory_usage (KvpMemoryUsage& usage) const noexcept;
+
     template <typename T>
     T get() const noexcept;
 
@@ -46,41 +46,215 @@ static const char delim = '/';
 
 KvpFrameImpl::KvpFrameImpl(const KvpFrameImpl & rhs) noexcept
 {
-    std::for_each(rhs.m_valuemap.begin(), rhs.m_valuemap.end(),
-        [this](const map_type::value_type & a)
+    if (rhs.m_valuemap)
+        m_valuemap.reset(new map_type);
+    else
+        m_slots.reserve(rhs.m_slots.size());
+    rhs.for_each_entry(
+        [this](const char* key, KvpValue* value)
         {
-            auto key = static_cast<char *>(qof_string_cache_insert(a.first));
-            auto val = new KvpValueImpl(*a.second);
-            this->m_valuemap.insert({key,val});
+            auto cachedkey =
+                static_cast<const char *>(qof_string_cache_insert(key));
+            auto val = new KvpValueImpl(*value);
+            /* rhs is already in key order, so appending keeps m_slots
+             * sorted. */
+            if (m_valuemap)
+                m_valuemap->insert({cachedkey, val});
+            else
+                m_slots.emplace_back(cachedkey, val);
         }
     );
 }
 
+void*
+KvpFrameImpl::operator new(size_t size)
+{
+    return g_slice_alloc(size);
+}
+
+void
+KvpFrameImpl::operator delete(void* ptr, size_t size) noexcept
+{
+    g_slice_free1(size, ptr);
+}
+
 KvpFrameImpl::~KvpFrameImpl() noexcept
 {
-    std::for_each(m_valuemap.begin(), m_valuemap.end(),
-		 [](const map_type::value_type &a){
-		      qof_string_cache_remove(a.first);
-		      delete a.second;
-		  }
-	);
-    m_valuemap.clear();
+    for_each_entry(
+        [](const char* key, KvpValue* value)
+        {
+            qof_string_cache_remove(key);
+            delete value;
+        }
+    );
+    m_slots.clear();
+    m_valuemap.reset();
+}
+
+/* Keys in the frame come from the string cache, so a caller handing back a
+ * key it got from the frame (as the backends and for_each_slot users do)
+ * matches on the pointer without a strcmp.
+ */
+static inline bool
+slot_key_less(const KvpFrameImpl::slot_type& slot, const char* key) noexcept
+{
+    return slot.first != key && std::strcmp(slot.first, key) < 0;
 }
 
-static inline Path
-make_vector(std::string key)
+static inline KvpFrameImpl::vector_type::iterator
+find_slot(KvpFrameImpl::vector_type& slots, const char* key) noexcept
 {
-    Path path;
-    for (auto length = key.find(delim); length != std::string::npos;)
+    auto spot = std::lower_bound(slots.begin(), slots.end(), key,
+                                 slot_key_less);
+    if (spot != slots.end() &&
+        (spot->first == key || std::strcmp(spot->first, key) == 0))
+        return spot;
+    return slots.end();
+}
+
+KvpValue*
+KvpFrameImpl::find_local(const char* key) const noexcept
+{
+    if (m_valuemap)
     {
-        if (length != 0)
-            path.push_back(key.substr(0, length));
-        key = key.substr(length + 1);
-        length = key.find(delim);
+        auto spot = m_valuemap->find(key);
+        return spot == m_valuemap->end() ? nullptr : spot->second;
     }
-    if (!key.empty())
-	path.push_back(key);
-    return path;
+    auto& slots = const_cast<vector_type&>(m_slots);
+    auto spot = find_slot(slots, key);
+    return spot == slots.end() ? nullptr : spot->second;
+}
+
+/* Calls func(segment, last) with each non-empty segment of the
+ * '/'-delimited path in turn until it returns false. The segments are
+ * NUL-terminated: the path's own tail for the last one, otherwise a copy
+ * in a buffer on the stack, so that resolving a path doesn't allocate
+ * unless a key is longer than the buffer.
+ */
+template <typename F> static void
+for_each_path_segment(const char* path, F func) noexcept
+{
+    char buf[128];
+    while (*path == delim)
+        ++path;
+    while (*path)
+    {
+        auto end = strchr(path, delim);
+        if (end == nullptr)
+        {
+            func(path, true);
+            return;
+        }
+        auto len = static_cast<size_t>(end - path);
+        while (*end == delim)
+            ++end;
+        auto last = *end == '\0';
+        bool more;
+        if (len < sizeof(buf))
+        {
+            memcpy(buf, path, len);
+            buf[len] = '\0';
+            more = func(buf, last);
+        }
+        else
+            more = func(std::string(path, len).c_str(), last);
+        if (!more || last)
+            return;
+        path = end;
+    }
+}
+
+/* The subframe at key, which has no delimiter, creating it in place of
+ * whatever is there if asked to. */
+static inline KvpFrameImpl*
+descend(KvpFrameImpl* frame, const char* key, bool create) noexcept
+{
+    auto slot = frame->get_slot(key);
+    if (slot != nullptr && slot->get_type() == KvpValue::Type::FRAME)
+        return slot->get<KvpFrame*>();
+    if (!create)
+        return nullptr;
+    auto new_frame = new KvpFrame;
+    delete frame->set(key, new KvpValue{new_frame});
+    return new_frame;
+}
+
+/* The frame at the end of the whole '/'-delimited path. */
+static inline KvpFrameImpl*
+descend_path(KvpFrameImpl* frame, const char* path, bool create) noexcept
+{
+    for_each_path_segment(path,
+        [&frame, create](const char* key, bool)
+        {
+            frame = descend(frame, key, create);
+            return frame != nullptr;
+        });
+    return frame;
+}
+
+static inline KvpValue*
+get_in_path(const KvpFrameImpl* frame, const char* path) noexcept
+{
+    auto cur_frame = const_cast<KvpFrameImpl*>(frame);
+    KvpValue* ret {nullptr};
+    for_each_path_segment(path,
+        [&cur_frame, &ret](const char* key, bool last)
+        {
+            if (last)
+            {
+                ret = cur_frame->get_slot(key);
+                return false;
+            }
+            cur_frame = descend(cur_frame, key, false);
+            return cur_frame != nullptr;
+        });
+    return ret;
+}
+
+static inline KvpValue*
+set_in_path(KvpFrameImpl* frame, const char* path, KvpValue* value,
+            bool create) noexcept
+{
+    KvpValue* ret {nullptr};
+    for_each_path_segment(path,
+        [&frame, &ret, value, create](const char* key, bool last)
+        {
+            if (last)
+            {
+                ret = frame->set(key, value);
+                return false;
+            }
+            frame = descend(frame, key, create);
+            return frame != nullptr;
+        });
+    return ret;
+}
+
+KvpPath::KvpPath(const char* path) noexcept
+{
+    if (path == nullptr)
+        return;
+    for_each_path_segment(path,
+        [this](const char* key, bool)
+        {
+            m_keys.push_back(static_cast<const char*>(
+                                 qof_string_cache_insert(key)));
+            return true;
+        });
+}
+
+KvpPath::KvpPath(const KvpPath& other) noexcept
+{
+    m_keys.reserve(other.m_keys.size());
+    for (auto key : other.m_keys)
+        m_keys.push_back(static_cast<const char*>(
+                             qof_string_cache_insert(key)));
+}
+
+KvpPath::~KvpPath() noexcept
+{
+    for (auto key : m_keys)
+        qof_string_cache_remove(key);
 }
 
 KvpValue*
@@ -88,94 +262,115 @@ KvpFrameImpl::set(const char* key, KvpValue* value) noexcept
 {
     if (!key) return nullptr;
     if (strchr(key, delim))
-        return set(make_vector(key), value);
+        return set_in_path(this, key, value, false);
     KvpValue* ret {nullptr};
-    auto spot = m_valuemap.find(key);
-    if (spot != m_valuemap.end())
+    if (m_valuemap)
+    {
+        auto spot = m_valuemap->find(key);
+        if (spot != m_valuemap->end())
+        {
+            qof_string_cache_remove(spot->first);
+            ret = spot->second;
+            m_valuemap->erase(spot);
+        }
+        if (value)
+        {
+            auto cachedkey =
+                static_cast<const char *>(qof_string_cache_insert(key));
+            m_valuemap->insert({cachedkey,value});
+        }
+        return ret;
+    }
+
+    auto spot = std::lower_bound(m_slots.begin(), m_slots.end(), key,
+                                 slot_key_less);
+    if (spot != m_slots.end() &&
+        (spot->first == key || std::strcmp(spot->first, key) == 0))
     {
-        qof_string_cache_remove(spot->first);
         ret = spot->second;
-        m_valuemap.erase(spot);
+        if (value)
+        {
+            /* Replacing in place keeps the cached key. */
+            spot->second = value;
+            return ret;
+        }
+        qof_string_cache_remove(spot->first);
+        m_slots.erase(spot);
+        return ret;
     }
 
     if (value)
     {
         auto cachedkey =
             static_cast<const char *>(qof_string_cache_insert(key));
-        m_valuemap.insert({cachedkey,value});
+        if (m_slots.size() < flat_max)
+        {
+            m_slots.insert(spot, slot_type{cachedkey, value});
+        }
+        else
+        {
+            m_valuemap.reset(new map_type(m_slots.begin(), m_slots.end()));
+            m_valuemap->insert({cachedkey, value});
+            vector_type().swap(m_slots);
+        }
     }
 
     return ret;
 }
 
-static inline KvpFrameImpl*
-walk_path_or_nullptr(const KvpFrameImpl* frame, Path& path)
+KvpValue*
+KvpFrameImpl::set(const Path& path, KvpValue* value) noexcept
 {
-    KvpFrameImpl* cur_frame = const_cast<KvpFrameImpl*>(frame);
-    for(auto key:path)
-    {
-        auto slot = cur_frame->get_slot(key.c_str());
-        if (slot == nullptr || slot->get_type() != KvpValue::Type::FRAME)
+    if (path.empty())
+        return nullptr;
+    auto cur_frame = this;
+    for (auto key = path.begin(); key + 1 != path.end(); ++key)
+        if ((cur_frame = descend_path(cur_frame, key->c_str(), false)) == nullptr)
             return nullptr;
-        cur_frame = slot->get<KvpFrame*>();
-    }
-    return cur_frame;
+    return set_in_path(cur_frame, path.back().c_str(), value, false);
 }
 
 KvpValue*
-KvpFrameImpl::set(Path path, KvpValue* value) noexcept
+KvpFrameImpl::set(const KvpPath& path, KvpValue* value) noexcept
 {
-    auto last_key = path.back();
-    path.pop_back();
-    auto cur_frame = walk_path_or_nullptr(this, path);
-    if (cur_frame == nullptr)
+    auto& keys = path.keys();
+    if (keys.empty())
         return nullptr;
-    if (last_key.find(delim) != std::string::npos)
-        return set(make_vector(last_key), value);
-    return cur_frame->set(last_key.c_str(), value);
+    auto cur_frame = this;
+    for (auto key = keys.begin(); key + 1 != keys.end(); ++key)
+        if ((cur_frame = descend(cur_frame, *key, false)) == nullptr)
+            return nullptr;
+    return cur_frame->set(keys.back(), value);
 }
 
-static inline KvpFrameImpl*
-walk_path_and_create(KvpFrameImpl* frame, Path path)
+KvpValue*
+KvpFrameImpl::set_path(const char* path, KvpValue* value) noexcept
 {
-     for(auto key:path)
-    {
-	if (key.empty())
-	    continue;
-        if (key.find(delim) != std::string::npos)
-        {
-            frame = walk_path_and_create(frame, make_vector(key));
-            continue;
-        }
-        auto slot = frame->get_slot(key.c_str());
-        if (slot == nullptr || slot->get_type() != KvpValue::Type::FRAME)
-        {
-            auto new_frame = new KvpFrame;
-            delete frame->set(key.c_str(), new KvpValue{new_frame});
-            frame = new_frame;
-            continue;
-        }
-        frame = slot->get<KvpFrame*>();
-    }
-    return frame;
+    if (!path) return nullptr;
+    return set_in_path(this, path, value, true);
 }
 
 KvpValue*
-KvpFrameImpl::set_path(const char* path, KvpValue* value) noexcept
+KvpFrameImpl::set_path(const Path& path, KvpValue* value) noexcept
 {
-    return set_path(make_vector(path), value);
+    if (path.empty())
+        return nullptr;
+    auto cur_frame = this;
+    for (auto key = path.begin(); key + 1 != path.end(); ++key)
+        cur_frame = descend_path(cur_frame, key->c_str(), true);
+    return set_in_path(cur_frame, path.back().c_str(), value, true);
 }
 
 KvpValue*
-KvpFrameImpl::set_path(Path path, KvpValue* value) noexcept
+KvpFrameImpl::set_path(const KvpPath& path, KvpValue* value) noexcept
 {
+    auto& keys = path.keys();
+    if (keys.empty())
+        return nullptr;
     auto cur_frame = this;
-    auto last_key = path.back();
-    path.pop_back();
-    cur_frame = walk_path_and_create(const_cast<KvpFrame*>(this), path);
-    if (last_key.find(delim) != std::string::npos)
-        return set_path(make_vector(last_key), value);
-    return cur_frame->set(last_key.c_str(), value);
+    for (auto key = keys.begin(); key + 1 != keys.end(); ++key)
+        cur_frame = descend(cur_frame, *key, true);
+    return cur_frame->set(keys.back(), value);
 }
 
 std::string
@@ -184,15 +379,15 @@ KvpFrameImpl::to_string() const noexcept
     std::ostringstream ret;
     ret << "{\n";
 
-    std::for_each(m_valuemap.begin(), m_valuemap.end(),
-        [this,&ret](const map_type::value_type &a)
+    for_each_entry(
+        [&ret](const char* key, KvpValue* value)
         {
             ret << "    ";
-            if (a.first)
-                ret << a.first;
+            if (key)
+                ret << key;
             ret << " => ";
-            if (a.second)
-                ret << a.second->to_string();
+            if (value)
+                ret << value->to_string();
             ret << ",\n";
         }
     );
@@ -205,25 +400,45 @@ std::vector<std::string>
 KvpFrameImpl::get_keys() const noexcept
 {
     std::vector<std::string> ret;
-    std::for_each(m_valuemap.begin(), m_valuemap.end(),
-        [&ret](const KvpFrameImpl::map_type::value_type &a)
+    ret.reserve(size());
+    for_each_entry(
+        [&ret](const char* key, KvpValue*)
         {
-            ret.push_back(a.first);
+            ret.push_back(key);
         }
     );
     return ret;
 }
 
+/* A std::map node is the slot plus three links and the colour, which
+ * pads to another pointer. */
+void
+KvpFrameImpl::add_memory_usage (KvpMemoryUsage& usage) const noexcept
+{
+    ++usage.frames;
+    usage.bytes += sizeof(*this) + m_slots.capacity() * sizeof(slot_type);
+    if (m_valuemap)
+        usage.bytes += sizeof(map_type) +
+            m_valuemap->size() * (sizeof(slot_type) + 4 * sizeof(void*));
+    for_each_entry(
+        [&usage](const char*, KvpValue* value)
+        {
+            if (value)
+                value->add_memory_usage (usage);
+        }
+    );
+}
+
 void
 KvpFrameImpl::for_each_slot(void (*proc)(const char *key, KvpValue *value,
                                          void * data),
                             void *data) const noexcept
 {
     if (!proc) return;
-    std::for_each (m_valuemap.begin(), m_valuemap.end(),
-        [proc,data](const KvpFrameImpl::map_type::value_type & a)
+    for_each_entry(
+        [proc,data](const char* key, KvpValue* value)
         {
-            proc (a.first, a.second, data);
+            proc (key, value, data);
         }
     );
 }
@@ -233,25 +448,33 @@ KvpFrameImpl::get_slot(const char * key) const noexcept
 {
     if (!key) return nullptr;
     if (strchr(key, delim))
-        return get_slot(make_vector(key));
-    auto spot = m_valuemap.find(key);
-    if (spot == m_valuemap.end())
-        return nullptr;
-    return spot->second;
+        return get_in_path(this, key);
+    return find_local(key);
 }
 
 KvpValueImpl *
-KvpFrameImpl::get_slot(Path path) const noexcept
+KvpFrameImpl::get_slot(const Path& path) const noexcept
 {
-    auto last_key = path.back();
-    path.pop_back();
-    auto cur_frame = walk_path_or_nullptr(this, path);
-    if (cur_frame == nullptr)
+    if (path.empty())
         return nullptr;
-    if (last_key.find(delim) != std::string::npos)
-        return get_slot(make_vector(last_key));
-    return cur_frame->get_slot(last_key.c_str());
+    auto cur_frame = const_cast<KvpFrameImpl*>(this);
+    for (auto key = path.begin(); key + 1 != path.end(); ++key)
+        if ((cur_frame = descend_path(cur_frame, key->c_str(), false)) == nullptr)
+            return nullptr;
+    return cur_frame->get_slot(path.back().c_str());
+}
 
+KvpValueImpl *
+KvpFrameImpl::get_slot(const KvpPath& path) const noexcept
+{
+    auto& keys = path.keys();
+    if (keys.empty())
+        return nullptr;
+    auto cur_frame = const_cast<KvpFrameImpl*>(this);
+    for (auto key = keys.begin(); key + 1 != keys.end(); ++key)
+        if ((cur_frame = descend(cur_frame, *key, false)) == nullptr)
+            return nullptr;
+    return cur_frame->find_local(keys.back());
 }
 
 int compare(const KvpFrameImpl * one, const KvpFrameImpl * two) noexcept
@@ -271,20 +494,25 @@ int compare(const KvpFrameImpl * one, const KvpFrameImpl * two) noexcept
  */
 int compare(const KvpFrameImpl & one, const KvpFrameImpl & two) noexcept
 {
-    for (const auto & a : one.m_valuemap)
-    {
-        auto otherspot = two.m_valuemap.find(a.first);
-        if (otherspot == two.m_valuemap.end())
+    int ret = 0;
+    bool done = false;
+    one.for_each_entry(
+        [&two, &ret, &done](const char* key, KvpValue* value)
         {
-            return 1;
+            if (done)
+                return;
+            auto other = two.find_local(key);
+            if (other == nullptr)
+                ret = 1;
+            else
+                ret = compare(value, other);
+            done = ret != 0;
         }
-        auto comparison = compare(a.second,otherspot->second);
-
-        if (comparison != 0)
-            return comparison;
-    }
+    );
+    if (done)
+        return ret;
 
-    if (one.m_valuemap.size() < two.m_valuemap.size())
+    if (one.size() < two.size())
         return -1;
     return 0;
 }
@@ -90,11 +90,37 @@
 
 #include "kvp-value.hpp"
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <cstring>
 using Path = std::vector<std::string>;
 
+/** A '/'-delimited path split once into keys from the string cache, for
+ * call sites that use the same path again and again. Build it outside the
+ * loop and the lookups through it neither split the path nor allocate:
+ *
+ *     KvpPath path {"hbci/template-list"};
+ *     for (auto node = books; node; node = g_list_next (node))
+ *         ... qof_instance_get_slots (node->data)->get_slot(path) ...
+ *
+ * It holds references in the string cache, so it mustn't outlive it: don't
+ * make one static.
+ */
+class KvpPath
+{
+public:
+    explicit KvpPath(const char* path) noexcept;
+    KvpPath(const KvpPath&) noexcept;
+    KvpPath& operator=(const KvpPath&) = delete;
+    ~KvpPath() noexcept;
+    bool empty() const noexcept { return m_keys.empty(); }
+    const std::vector<const char*>& keys() const noexcept { return m_keys; }
+private:
+    std::vector<const char*> m_keys;
+};
+
 /** Implements KvpFrame.
  *  It's a struct because QofInstance needs to use the typename to declare a
  *  KvpFrame* member, and QofInstance's API is C until its children are all
@@ -120,6 +146,15 @@ struct KvpFrameImpl
 	    }
     };
     using map_type = std::map<const char *, KvpValue*, cstring_comparer>;
+    using slot_type = std::pair<const char *, KvpValue*>;
+    using vector_type = std::vector<slot_type>;
+    /* Most frames -- a split's online_id or notes, an account's import map
+     * entry -- hold only a handful of slots. Those are kept in a vector
+     * sorted by key, which costs one allocation for the whole frame instead
+     * of one tree node per slot. A frame growing past this many slots is
+     * moved into a map_type.
+     */
+    static constexpr size_t flat_max = 16;
 
     public:
     KvpFrameImpl() noexcept {};
@@ -134,6 +169,13 @@ struct KvpFrameImpl
      */
     ~KvpFrameImpl() noexcept;
 
+    /**
+     * Every QofInstance has a frame, so frames come from GSlice's slabs
+     * like the instances themselves instead of one malloc each.
+     */
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size) noexcept;
+
     /**
      * Set the value with the key in the immediate frame, replacing and
      * returning the old value if it exists or nullptr if it doesn't. Takes
@@ -157,7 +199,9 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set(const Path& path, KvpValue* newvalue) noexcept;
+    /** As set(Path), with a precompiled path. */
+    KvpValue* set(const KvpPath& path, KvpValue* newvalue) noexcept;
     /**
      * Set the value with the key in a subframe following the keys in path,
      * replacing and returning the old value if it exists or nullptr if it
@@ -181,7 +225,9 @@ struct KvpFrameImpl
      * @param newvalue: The value to set at key.
      * @return The old value if there was one or nullptr.
      */
-    KvpValue* set_path(Path path, KvpValue* newvalue) noexcept;
+    KvpValue* set_path(const Path& path, KvpValue* newvalue) noexcept;
+    /** As set_path(Path), with a precompiled path. */
+    KvpValue* set_path(const KvpPath& path, KvpValue* newvalue) noexcept;
     /**
      * Make a string representation of the frame. Mostly useful for debugging.
      * @return A std::string representing the frame and all its children.
@@ -194,6 +240,9 @@ struct KvpFrameImpl
      */
     std::vector<std::string> get_keys() const noexcept;
 
+    /** Add this frame and everything below it to usage. */
+    void add_memory_usage (KvpMemoryUsage& usage) const noexcept;
+
     /** Get the value for the key or nullptr if it doesn't exist.
      * @param key: The key.
      * @return The value at the key or nullptr.
@@ -203,7 +252,9 @@ struct KvpFrameImpl
      * @param path: Path of keys leading to the desired value.
      * @return The value at the key or nullptr.
      */
-    KvpValue* get_slot(Path keys) const noexcept;
+    KvpValue* get_slot(const Path& keys) const noexcept;
+    /** As get_slot(Path), with a precompiled path. */
+    KvpValue* get_slot(const KvpPath& path) const noexcept;
     /** Convenience wrapper for std::for_each, which should be preferred.
      */
     void for_each_slot(void (*proc)(const char *key, KvpValue *value,
@@ -213,11 +264,32 @@ struct KvpFrameImpl
     /** Test for emptiness
      * @return true if the frame contains nothing.
      */
-    bool empty() const noexcept { return m_valuemap.empty(); }
+    bool empty() const noexcept
+    {
+        return m_valuemap ? m_valuemap->empty() : m_slots.empty();
+    }
     friend int compare(const KvpFrameImpl&, const KvpFrameImpl&) noexcept;
 
     private:
-    map_type m_valuemap;
+    /* Call func with each (key, value) pair in key order. */
+    template <typename F> void for_each_entry(F func) const noexcept
+    {
+        if (m_valuemap)
+            for (const auto& a : *m_valuemap)
+                func(a.first, a.second);
+        else
+            for (const auto& a : m_slots)
+                func(a.first, a.second);
+    }
+    size_t size() const noexcept
+    {
+        return m_valuemap ? m_valuemap->size() : m_slots.size();
+    }
+    KvpValue* find_local(const char* key) const noexcept;
+    vector_type m_slots;
+    /* Only allocated once the frame has more than flat_max slots; m_slots is
+     * empty from then on. */
+    std::unique_ptr<map_type> m_valuemap;
 };
 
 int compare (const KvpFrameImpl &, const KvpFrameImpl &) noexcept;
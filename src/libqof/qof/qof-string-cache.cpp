@@ -43,40 +43,99 @@ static QofLogModule log_module = QOF_MOD_UTIL;
 /* =================================================================== */
 /* The QOF string cache                                                */
 /*                                                                     */
-/* The cache is a GHashTable where a copy of the string is the key,    */
-/* and a ref count is the value                                        */
+/* The cache is split into shards, each a GHashTable protected by its  */
+/* own mutex, so that threads interning different strings rarely wait  */
+/* on each other. A string's shard is picked from the top bits of its  */
+/* hash. Each entry is a single allocation holding the refcount        */
+/* followed by the string; the table's key points at the string and    */
+/* its value at the entry.                                             */
 /* =================================================================== */
 
-static GHashTable* qof_string_cache = NULL;
+#define QOF_STRING_CACHE_SHARD_BITS 4
+#define QOF_STRING_CACHE_SHARDS (1 << QOF_STRING_CACHE_SHARD_BITS)
 
-static GHashTable*
-qof_get_string_cache(void)
+typedef struct
 {
-    if (!qof_string_cache)
+    guint refcount;
+    gchar str[1];
+} CacheEntry;
+
+typedef struct
+{
+    GHashTable* table;
+#ifdef HAVE_GLIB_2_32
+    GMutex lock;
+#else
+    GMutex* lock;
+#endif
+} CacheShard;
+
+static CacheShard qof_string_cache[QOF_STRING_CACHE_SHARDS];
+
+#ifdef HAVE_GLIB_2_32
+#define SHARD_LOCK(shard) g_mutex_lock (&(shard)->lock)
+#define SHARD_UNLOCK(shard) g_mutex_unlock (&(shard)->lock)
+#else
+#define SHARD_LOCK(shard) g_mutex_lock ((shard)->lock)
+#define SHARD_UNLOCK(shard) g_mutex_unlock ((shard)->lock)
+#endif
+
+/* The locks are created once and outlive qof_string_cache_destroy, which
+ * only drops the tables. */
+static void
+qof_string_cache_init_locks (void)
+{
+    static gsize initialized = 0;
+    if (g_once_init_enter (&initialized))
     {
-        qof_string_cache = g_hash_table_new_full(
-                               g_str_hash,               /* hash_func          */
-                               g_str_equal,              /* key_equal_func     */
-                               g_free,                   /* key_destroy_func   */
-                               g_free);                  /* value_destroy_func */
+        for (int i = 0; i < QOF_STRING_CACHE_SHARDS; ++i)
+        {
+#ifdef HAVE_GLIB_2_32
+            g_mutex_init (&qof_string_cache[i].lock);
+#else
+            qof_string_cache[i].lock = g_mutex_new ();
+#endif
+        }
+        g_once_init_leave (&initialized, 1);
     }
-    return qof_string_cache;
+}
+
+/* Returns the locked shard for a key with this hash, creating its table if
+ * need be. The caller must SHARD_UNLOCK it. */
+static CacheShard*
+qof_string_cache_lock_shard (guint hash)
+{
+    qof_string_cache_init_locks ();
+    auto shard = &qof_string_cache[hash >> (32 - QOF_STRING_CACHE_SHARD_BITS)];
+    SHARD_LOCK (shard);
+    if (!shard->table)
+        shard->table = g_hash_table_new_full(
+                           g_str_hash,               /* hash_func          */
+                           g_str_equal,              /* key_equal_func     */
+                           NULL,                     /* key_destroy_func   */
+                           g_free);                  /* value_destroy_func */
+    return shard;
 }
 
 void
 qof_string_cache_init(void)
 {
-    (void)qof_get_string_cache();
+    qof_string_cache_init_locks ();
 }
 
 void
 qof_string_cache_destroy (void)
 {
-    if (qof_string_cache)
+    qof_string_cache_init_locks ();
+    for (int i = 0; i < QOF_STRING_CACHE_SHARDS; ++i)
     {
-        g_hash_table_destroy(qof_string_cache);
+        auto shard = &qof_string_cache[i];
+        SHARD_LOCK (shard);
+        if (shard->table)
+            g_hash_table_destroy (shard->table);
+        shard->table = NULL;
+        SHARD_UNLOCK (shard);
     }
-    qof_string_cache = NULL;
 }
 
 /* If the key exists in the cache, check the refcount.  If 1, just
@@ -86,21 +145,21 @@ qof_string_cache_remove(gconstpointer key)
 {
     if (key)
     {
-        GHashTable* cache = qof_get_string_cache();
-        gpointer value;
-        gpointer cache_key;
-        if (g_hash_table_lookup_extended(cache, key, &cache_key, &value))
+        auto shard = qof_string_cache_lock_shard (g_str_hash (key));
+        auto entry = static_cast<CacheEntry*>(g_hash_table_lookup (shard->table,
+                                                                   key));
+        if (entry)
         {
-            guint* refcount = (guint*)value;
-            if (*refcount == 1)
+            if (entry->refcount == 1)
             {
-                g_hash_table_remove(cache, key);
+                g_hash_table_remove(shard->table, key);
             }
             else
             {
-                --(*refcount);
+                --entry->refcount;
             }
         }
+        SHARD_UNLOCK (shard);
     }
 }
 
@@ -111,25 +170,60 @@ qof_string_cache_insert(gconstpointer key)
 {
     if (key)
     {
-        GHashTable* cache = qof_get_string_cache();
-        gpointer value;
-        gpointer cache_key;
-        if (g_hash_table_lookup_extended(cache, key, &cache_key, &value))
+        auto shard = qof_string_cache_lock_shard (g_str_hash (key));
+        auto entry = static_cast<CacheEntry*>(g_hash_table_lookup (shard->table,
+                                                                   key));
+        if (entry)
         {
-            guint* refcount = (guint*)value;
-            ++(*refcount);
-            return cache_key;
+            ++entry->refcount;
         }
         else
         {
-            gpointer new_key = g_strdup(static_cast<const char*>(key));
-            guint* refcount = static_cast<unsigned int*>(g_malloc(sizeof(guint)));
-            *refcount = 1;
-            g_hash_table_insert(cache, new_key, refcount);
-            return new_key;
+            auto len = strlen (static_cast<const char*>(key));
+            entry = static_cast<CacheEntry*>(g_malloc (sizeof(CacheEntry) + len));
+            entry->refcount = 1;
+            memcpy (entry->str, key, len + 1);
+            g_hash_table_insert(shard->table, entry->str, entry);
         }
+        SHARD_UNLOCK (shard);
+        return entry->str;
     }
     return NULL;
 }
 
+/* The table nodes are three pointers in each GHashTable: key, value and
+ * hash, though glib packs the hashes; close enough for an estimate. */
+void
+qof_string_cache_stats (guint *entries, guint64 *references, gsize *bytes)
+{
+    guint count = 0;
+    guint64 refs = 0;
+    gsize size = 0;
+
+    qof_string_cache_init_locks ();
+    for (int i = 0; i < QOF_STRING_CACHE_SHARDS; ++i)
+    {
+        auto shard = &qof_string_cache[i];
+        GHashTableIter iter;
+        gpointer key, value;
+        SHARD_LOCK (shard);
+        if (shard->table)
+        {
+            g_hash_table_iter_init (&iter, shard->table);
+            while (g_hash_table_iter_next (&iter, &key, &value))
+            {
+                auto entry = static_cast<CacheEntry*>(value);
+                ++count;
+                refs += entry->refcount;
+                size += sizeof(CacheEntry) + strlen (entry->str) +
+                    3 * sizeof(gpointer);
+            }
+        }
+        SHARD_UNLOCK (shard);
+    }
+    if (entries) *entries = count;
+    if (references) *references = refs;
+    if (bytes) *bytes = size;
+}
+
 /* ************************ END OF FILE ***************************** */
@@ -66,7 +66,8 @@ extern "C"
  * Note that all the work is done when inserting or removing.  Once
  * cached the strings are just plain C strings.
  *
- * The string cache is demand-created on first use.
+ * The string cache is demand-created on first use. Inserting and removing
+ * strings is safe from any thread.
  *
  **/
 
@@ -86,6 +87,13 @@ void qof_string_cache_remove(gconstpointer key);
 */
 gpointer qof_string_cache_insert(gconstpointer key);
 
+/** Report the cache's size for the memory accounting: the number of
+   distinct strings, their total references, and the bytes held by the
+   entries and the tables' nodes.  Any pointer may be NULL.
+*/
+void qof_string_cache_stats(guint *entries, guint64 *references,
+                            gsize *bytes);
+
 #define CACHE_INSERT(str) qof_string_cache_insert((gconstpointer)(str))
 #define CACHE_REMOVE(str) qof_string_cache_remove((str))
 
@@ -261,6 +261,10 @@ struct QofBackend_s
 
     void (*sync) (QofBackend *, /*@ dependent @*/ QofBook *);
     void (*safe_sync) (QofBackend *, /*@ dependent @*/ QofBook *);
+    /* Sync, leaving as much of the writing as possible to a background
+     * thread; NULL when the backend can only sync in the foreground.
+     */
+    void (*background_sync) (QofBackend *, /*@ dependent @*/ QofBook *);
     /* This is implented only in the XML backend where it exports only a chart
      * of accounts.
      */
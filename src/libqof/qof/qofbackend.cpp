@@ -152,6 +152,7 @@ qof_backend_init(QofBackend *be)
 
     be->sync = NULL;
     be->safe_sync = NULL;
+    be->background_sync = NULL;
 
     be->export_fn = NULL;
 
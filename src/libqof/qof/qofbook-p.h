@@ -75,6 +75,13 @@ backends (when reading the GncGUID from the data source). */
 gchar *qof_book_normalize_counter_format_internal(const gchar *p,
         const gchar* gint64_format, gchar **err_msg);
 
+/** Brackets the writer's changes to the book: waits for the snapshots to
+ * be released and keeps new ones from being taken until the matching
+ * qof_book_end_write().  They nest.  No-ops unless snapshots are enabled.
+ */
+void qof_book_begin_write (QofBook *book);
+void qof_book_end_write (QofBook *book);
+
 /** This debugging function can be used to traverse the book structure
  *    and all subsidiary structures, printing out which structures
  *    have been marked dirty.
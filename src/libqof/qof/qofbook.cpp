@@ -58,8 +58,55 @@ extern "C"
 #include "qofobject-p.h"
 #include "qofbookslots.h"
 #include "kvp_frame.hpp"
+#include <algorithm>
+#include <vector>
 
 static QofLogModule log_module = QOF_MOD_ENGINE;
+
+/* Snapshots: a readers-writer lock that, unlike GRWLock, may be released
+ * from another thread than the one that took it, as a snapshot's last
+ * reference may be dropped anywhere.  Waiting writers keep new readers
+ * out so that they can't be starved. */
+struct QofBookSnapshotState
+{
+#ifdef HAVE_GLIB_2_32
+    GMutex lock;
+    GCond cond;
+    GRecMutex cache_lock;
+#else
+    GMutex *lock;
+    GCond *cond;
+    GStaticRecMutex cache_lock;
+#endif
+    guint readers;
+    guint writers_waiting;
+    gboolean writing;
+    guint write_depth;          /* The writer's nesting; only it uses it */
+    gint generation;
+};
+
+struct _QofBookSnapshot
+{
+    QofBook *book;
+    gint refcount;
+    gint generation;
+};
+
+#ifdef HAVE_GLIB_2_32
+#define SNAPSHOT_LOCK(state) g_mutex_lock (&(state)->lock)
+#define SNAPSHOT_UNLOCK(state) g_mutex_unlock (&(state)->lock)
+#define SNAPSHOT_WAIT(state) g_cond_wait (&(state)->cond, &(state)->lock)
+#define SNAPSHOT_BROADCAST(state) g_cond_broadcast (&(state)->cond)
+#define CACHE_LOCK(state) g_rec_mutex_lock (&(state)->cache_lock)
+#define CACHE_UNLOCK(state) g_rec_mutex_unlock (&(state)->cache_lock)
+#else
+#define SNAPSHOT_LOCK(state) g_mutex_lock ((state)->lock)
+#define SNAPSHOT_UNLOCK(state) g_mutex_unlock ((state)->lock)
+#define SNAPSHOT_WAIT(state) g_cond_wait ((state)->cond, (state)->lock)
+#define SNAPSHOT_BROADCAST(state) g_cond_broadcast ((state)->cond)
+#define CACHE_LOCK(state) g_static_rec_mutex_lock (&(state)->cache_lock)
+#define CACHE_UNLOCK(state) g_static_rec_mutex_unlock (&(state)->cache_lock)
+#endif
 #define AB_KEY "hbci"
 #define AB_TEMPLATES "template-list"
 
@@ -431,12 +478,17 @@ qof_book_destroy (QofBook *book)
     book->shutting_down = TRUE;
     qof_event_force (&book->inst, QOF_EVENT_DESTROY, NULL);
 
+    /* Whoever listens has been told the whole book is going, so the
+     * events of each instance freed with it would only cost time. */
+    qof_event_suspend ();
+
     /* Call the list of finalizers, let them do their thing.
      * Do this before tearing into the rest of the book.
      */
     g_hash_table_foreach (book->data_table_finalizers, book_final, book);
 
     qof_object_book_end (book);
+    qof_event_resume ();
 
     g_hash_table_destroy (book->data_table_finalizers);
     book->data_table_finalizers = NULL;
@@ -445,6 +497,22 @@ qof_book_destroy (QofBook *book)
 
     /* qof_instance_release (&book->inst); */
 
+    if (book->snapshot_state)
+    {
+        auto state = book->snapshot_state;
+        book->snapshot_state = NULL;
+#ifdef HAVE_GLIB_2_32
+        g_mutex_clear (&state->lock);
+        g_cond_clear (&state->cond);
+        g_rec_mutex_clear (&state->cache_lock);
+#else
+        g_mutex_free (state->lock);
+        g_cond_free (state->cond);
+        g_static_rec_mutex_free (&state->cache_lock);
+#endif
+        g_free (state);
+    }
+
     /* Note: we need to save this hashtable until after we remove ourself
      * from it, otherwise we'll crash in our dispose() function when we
      * DO remove ourself from the collection but the collection had already
@@ -460,6 +528,304 @@ qof_book_destroy (QofBook *book)
 
 /* ====================================================================== */
 
+void
+qof_book_enable_snapshots (QofBook *book)
+{
+    g_return_if_fail (book != NULL);
+    if (book->snapshot_state)
+        return;
+
+    auto state = g_new0 (QofBookSnapshotState, 1);
+#ifdef HAVE_GLIB_2_32
+    g_mutex_init (&state->lock);
+    g_cond_init (&state->cond);
+    g_rec_mutex_init (&state->cache_lock);
+#else
+    state->lock = g_mutex_new ();
+    state->cond = g_cond_new ();
+    g_static_rec_mutex_init (&state->cache_lock);
+#endif
+    book->snapshot_state = state;
+}
+
+gboolean
+qof_book_snapshots_enabled (const QofBook *book)
+{
+    return book && book->snapshot_state;
+}
+
+gboolean
+qof_book_snapshot_held (const QofBook *book)
+{
+    if (!qof_book_snapshots_enabled (book))
+        return FALSE;
+    auto state = book->snapshot_state;
+    SNAPSHOT_LOCK (state);
+    gboolean held = state->readers > 0;
+    SNAPSHOT_UNLOCK (state);
+    return held;
+}
+
+QofBookSnapshot *
+qof_book_snapshot_take (QofBook *book)
+{
+    g_return_val_if_fail (book != NULL, NULL);
+    auto state = book->snapshot_state;
+    g_return_val_if_fail (state != NULL, NULL);
+
+    SNAPSHOT_LOCK (state);
+    while (state->writing || state->writers_waiting > 0)
+        SNAPSHOT_WAIT (state);
+    ++state->readers;
+    auto generation = state->generation;
+    SNAPSHOT_UNLOCK (state);
+
+    auto snapshot = g_new (QofBookSnapshot, 1);
+    snapshot->book = book;
+    snapshot->refcount = 1;
+    snapshot->generation = generation;
+    return snapshot;
+}
+
+QofBookSnapshot *
+qof_book_snapshot_ref (QofBookSnapshot *snapshot)
+{
+    g_return_val_if_fail (snapshot != NULL, NULL);
+    g_atomic_int_inc (&snapshot->refcount);
+    return snapshot;
+}
+
+void
+qof_book_snapshot_unref (QofBookSnapshot *snapshot)
+{
+    g_return_if_fail (snapshot != NULL);
+    if (!g_atomic_int_dec_and_test (&snapshot->refcount))
+        return;
+
+    auto state = snapshot->book->snapshot_state;
+    SNAPSHOT_LOCK (state);
+    if (--state->readers == 0)
+        SNAPSHOT_BROADCAST (state);
+    SNAPSHOT_UNLOCK (state);
+    g_free (snapshot);
+}
+
+QofBook *
+qof_book_snapshot_get_book (const QofBookSnapshot *snapshot)
+{
+    g_return_val_if_fail (snapshot != NULL, NULL);
+    return snapshot->book;
+}
+
+gint
+qof_book_snapshot_get_generation (const QofBookSnapshot *snapshot)
+{
+    g_return_val_if_fail (snapshot != NULL, 0);
+    return snapshot->generation;
+}
+
+gint
+qof_book_get_generation (const QofBook *book)
+{
+    if (!book || !book->snapshot_state)
+        return 0;
+    return g_atomic_int_get (&book->snapshot_state->generation);
+}
+
+void
+qof_book_begin_write (QofBook *book)
+{
+    if (!book || !book->snapshot_state)
+        return;
+    auto state = book->snapshot_state;
+    if (state->write_depth++ > 0)
+        return;
+
+    SNAPSHOT_LOCK (state);
+    ++state->writers_waiting;
+    while (state->readers > 0)
+        SNAPSHOT_WAIT (state);
+    --state->writers_waiting;
+    state->writing = TRUE;
+    SNAPSHOT_UNLOCK (state);
+}
+
+void
+qof_book_end_write (QofBook *book)
+{
+    if (!book || !book->snapshot_state)
+        return;
+    auto state = book->snapshot_state;
+    /* Snapshots may have been enabled inside the write. */
+    if (state->write_depth == 0 || --state->write_depth > 0)
+        return;
+
+    SNAPSHOT_LOCK (state);
+    state->writing = FALSE;
+    g_atomic_int_inc (&state->generation);
+    SNAPSHOT_BROADCAST (state);
+    SNAPSHOT_UNLOCK (state);
+}
+
+void
+qof_book_cache_lock (const QofBook *book)
+{
+    if (book && book->snapshot_state)
+        CACHE_LOCK (book->snapshot_state);
+}
+
+void
+qof_book_cache_unlock (const QofBook *book)
+{
+    if (book && book->snapshot_state)
+        CACHE_UNLOCK (book->snapshot_state);
+}
+
+/* ====================================================================== */
+/* Memory accounting */
+
+struct KvpSubtree
+{
+    QofIdTypeConst type;
+    const GncGUID *guid;
+    const char *key;       /* The frame's own, valid during the walk */
+    KvpMemoryUsage usage;
+};
+
+struct MemoryWalk
+{
+    GList *types;                      /* of QofBookTypeMemory */
+    std::vector<KvpSubtree> *subtrees; /* nullptr if not wanted */
+    QofInstance *inst;
+};
+
+static void
+memory_walk_slot (const char *key, KvpValue *value, void *data)
+{
+    auto walk = static_cast<MemoryWalk*>(data);
+    auto type_usage = static_cast<QofBookTypeMemory*>(walk->types->data);
+    KvpSubtree subtree {type_usage->type, qof_instance_get_guid (walk->inst),
+                        key, {0, 0, 0}};
+    if (value == nullptr)
+        return;
+    value->add_memory_usage (subtree.usage);
+    walk->subtrees->push_back (subtree);
+}
+
+static void
+memory_walk_instance (QofInstance *inst, gpointer data)
+{
+    auto walk = static_cast<MemoryWalk*>(data);
+    auto type_usage = static_cast<QofBookTypeMemory*>(walk->types->data);
+    auto frame = qof_instance_get_slots (inst);
+    GTypeQuery query;
+
+    g_type_query (G_OBJECT_TYPE (inst), &query);
+    ++type_usage->instances;
+    type_usage->instance_bytes += query.instance_size;
+    if (frame == nullptr)
+        return;
+
+    KvpMemoryUsage usage {0, 0, 0};
+    frame->add_memory_usage (usage);
+    type_usage->kvp_frames += usage.frames;
+    type_usage->kvp_values += usage.values;
+    type_usage->kvp_bytes += usage.bytes;
+    if (walk->subtrees == nullptr)
+        return;
+    walk->inst = inst;
+    frame->for_each_slot (memory_walk_slot, walk);
+}
+
+static void
+memory_walk_collection (QofCollection *col, gpointer data)
+{
+    auto walk = static_cast<MemoryWalk*>(data);
+    auto type_usage = g_new0 (QofBookTypeMemory, 1);
+
+    type_usage->type = qof_collection_get_type (col);
+    walk->types = g_list_prepend (walk->types, type_usage);
+    qof_collection_foreach_unordered (col, memory_walk_instance, walk);
+}
+
+static gint
+memory_type_compare (gconstpointer a, gconstpointer b)
+{
+    auto ua = static_cast<const QofBookTypeMemory*>(a);
+    auto ub = static_cast<const QofBookTypeMemory*>(b);
+    auto sa = ua->instance_bytes + ua->kvp_bytes;
+    auto sb = ub->instance_bytes + ub->kvp_bytes;
+    return sa > sb ? -1 : sa < sb ? 1 : g_strcmp0 (ua->type, ub->type);
+}
+
+static void
+memory_walk_book (QofBook *book, MemoryWalk *walk)
+{
+    auto book_usage = g_new0 (QofBookTypeMemory, 1);
+
+    book_usage->type = QOF_ID_BOOK;
+    walk->types = g_list_prepend (walk->types, book_usage);
+    memory_walk_instance (QOF_INSTANCE (book), walk);
+    qof_book_foreach_collection (book, memory_walk_collection, walk);
+}
+
+GList *
+qof_book_get_memory_usage (QofBook *book)
+{
+    MemoryWalk walk {nullptr, nullptr, nullptr};
+
+    g_return_val_if_fail (QOF_IS_BOOK (book), nullptr);
+    memory_walk_book (book, &walk);
+    return g_list_sort (walk.types, memory_type_compare);
+}
+
+GList *
+qof_book_get_largest_kvp_subtrees (QofBook *book, guint max)
+{
+    std::vector<KvpSubtree> subtrees;
+    MemoryWalk walk {nullptr, &subtrees, nullptr};
+    GList *result = nullptr;
+
+    g_return_val_if_fail (QOF_IS_BOOK (book), nullptr);
+    memory_walk_book (book, &walk);
+    g_list_free_full (walk.types, g_free);
+
+    auto count = std::min (static_cast<size_t>(max), subtrees.size ());
+    std::partial_sort (subtrees.begin (), subtrees.begin () + count,
+                       subtrees.end (),
+                       [](const KvpSubtree& a, const KvpSubtree& b)
+                       {
+                           return a.usage.bytes > b.usage.bytes;
+                       });
+    for (size_t i = count; i-- > 0;)
+    {
+        auto entry = g_new0 (QofKvpSubtreeMemory, 1);
+        entry->type = subtrees[i].type;
+        entry->guid = *subtrees[i].guid;
+        entry->key = g_strdup (subtrees[i].key);
+        entry->values = subtrees[i].usage.values;
+        entry->bytes = subtrees[i].usage.bytes;
+        result = g_list_prepend (result, entry);
+    }
+    return result;
+}
+
+static void
+kvp_subtree_free (gpointer data)
+{
+    auto entry = static_cast<QofKvpSubtreeMemory*>(data);
+    g_free (entry->key);
+    g_free (entry);
+}
+
+void
+qof_book_free_kvp_subtrees (GList *subtrees)
+{
+    g_list_free_full (subtrees, kvp_subtree_free);
+}
+
+/* ====================================================================== */
+
 gboolean
 qof_book_session_not_saved (const QofBook *book)
 {
@@ -605,14 +971,26 @@ qof_book_get_collection (const QofBook *book, QofIdType entity_type)
     col = static_cast<QofCollection*>(g_hash_table_lookup (book->hash_of_collections, entity_type));
     if (!col)
     {
+        auto type_id = qof_object_get_type_id (entity_type);
         col = qof_collection_new (entity_type);
         g_hash_table_insert(
             book->hash_of_collections,
             qof_string_cache_insert((gpointer) entity_type), col);
+        if (type_id < QOF_BOOK_TYPE_IDS)
+            const_cast<QofBook*>(book)->collections_by_id[type_id] = col;
     }
     return col;
 }
 
+QofCollection *
+qof_book_get_collection_by_id (const QofBook *book, gint type_id)
+{
+    if (!book || type_id < 0) return NULL;
+    if (type_id < QOF_BOOK_TYPE_IDS && book->collections_by_id[type_id])
+        return book->collections_by_id[type_id];
+    return qof_book_get_collection (book, qof_object_get_type_name (type_id));
+}
+
 struct _iterate
 {
     QofCollectionForeachCB  fn;
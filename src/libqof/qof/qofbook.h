@@ -73,6 +73,15 @@ typedef struct KvpValueImpl KvpValue;
 
 typedef void (*QofBookDirtyCB) (QofBook *, gboolean dirty, gpointer user_data);
 
+/** How many collections a book keeps at hand by type ID, see
+ * qof_book_get_collection_by_id(). */
+#define QOF_BOOK_TYPE_IDS 64
+
+/** A book held still for reading by other threads, see
+ * qof_book_snapshot_take(). */
+typedef struct _QofBookSnapshot QofBookSnapshot;
+typedef struct QofBookSnapshotState QofBookSnapshotState;
+
 typedef struct gnc_option_db GNCOptionDB;
 
 typedef void (*GNCOptionSave) (GNCOptionDB*, QofBook*, gboolean);
@@ -112,6 +121,10 @@ struct _QofBook
      */
     GHashTable * hash_of_collections;
 
+    /* The same collections, indexed by qof_object_get_type_id() so that
+     * lookups needn't hash the type's name. */
+    QofCollection *collections_by_id[QOF_BOOK_TYPE_IDS];
+
     /* In order to store arbitrary data, for extensibility, add a table
      * that will be used to hold arbitrary pointers.
      */
@@ -147,6 +160,10 @@ struct _QofBook
      * except that it provides a nice convenience, avoiding a lookup
      * from the session.  Better solutions welcome ... */
     QofBackend *backend;
+
+    /* The readers and the writer of the book once snapshots are enabled,
+     * NULL until then. */
+    QofBookSnapshotState *snapshot_state;
 };
 
 struct _QofBookClass
@@ -166,10 +183,13 @@ GType qof_book_get_type(void);
  * only be used as the last statement in the definition of a function,
  * but not somewhere inline in the code. */
 #define QOF_BOOK_RETURN_ENTITY(book,guid,e_type,c_type) {   \
+  static gint type_id = -1;                                 \
   QofInstance *val = NULL;                                  \
   if ((guid != NULL) && (book != NULL)) {		    \
     const QofCollection *col;                               \
-    col = qof_book_get_collection (book, e_type);           \
+    if (type_id < 0)                                        \
+      type_id = qof_object_get_type_id (e_type);            \
+    col = qof_book_get_collection_by_id (book, type_id);    \
     val = qof_collection_lookup_entity (col, guid);         \
   }                                                         \
   return (c_type *) val;                                    \
@@ -190,7 +210,9 @@ gboolean qof_book_register (void);
 QofBook * qof_book_new (void);
 
 /** End any editing sessions associated with book, and free all memory
-    associated with it. */
+    associated with it.  The book's own QOF_EVENT_DESTROY is the last event
+    sent for it and its instances: they are freed with events suspended and
+    without going through the backend. */
 void      qof_book_destroy (QofBook *book);
 
 /** Close a book to editing.
@@ -216,6 +238,14 @@ void qof_book_mark_closed (QofBook *book);
 /*@ dependent @*/
 QofCollection  * qof_book_get_collection (const QofBook *, QofIdType);
 
+/** Return the collection of the type that qof_object_get_type_id() gave
+ * type_id, as qof_book_get_collection() does, but without hashing the
+ * type's name.  Callers look the ID up once and keep it.
+ *
+ * @return NULL if type_id isn't one that has been given out. */
+/*@ dependent @*/
+QofCollection  * qof_book_get_collection_by_id (const QofBook *, gint type_id);
+
 /** Invoke the indicated callback on each collection in the book. */
 typedef void (*QofCollectionForeachCB) (QofCollection *, gpointer user_data);
 void qof_book_foreach_collection (const QofBook *, QofCollectionForeachCB, gpointer);
@@ -412,6 +442,96 @@ KvpValue* qof_book_get_option (QofBook *book, GSList *path);
  */
 void qof_book_options_delete (QofBook *book);
 /** @} End of Doxygen Include */
+
+/** @name Read snapshots
+ *
+ * Everything in QOF and the engine expects to be used from one thread.
+ * Snapshots let other threads read a book while that thread, the
+ * writer, goes on using it.  A snapshot holds the book still: while
+ * there is one, the writer waits before it begins or commits an edit or
+ * adds an instance to or removes one from a collection.  The commits
+ * waited for go through once the last snapshot is released, so readers
+ * should hold on to them briefly.  There can be any number of snapshots
+ * at a time.
+ *
+ * An instance already open for editing when the snapshot was taken may
+ * still change under it, so readers must leave out those with a
+ * non-zero qof_instance_get_editlevel().  Readers mustn't edit anything.
+ * The engine's lazily computed balances and indexes are guarded with
+ * qof_book_cache_lock(), so they can be read.
+ * @{
+ */
+/** Makes the book's edits wait for the snapshots. The writer must call it
+ * before any other thread takes a snapshot. */
+void qof_book_enable_snapshots (QofBook *book);
+gboolean qof_book_snapshots_enabled (const QofBook *book);
+/** Whether any thread holds a snapshot of the book, so that the writer
+ * can't edit it until the snapshot is released. */
+gboolean qof_book_snapshot_held (const QofBook *book);
+
+/** Takes a snapshot of the book.  It waits for the writer's edit or
+ * commit in progress to finish, and it deadlocks if the writer itself
+ * calls it from within one.
+ * @return The snapshot with a reference count of 1, or NULL if
+ * snapshots aren't enabled
+ */
+QofBookSnapshot *qof_book_snapshot_take (QofBook *book);
+QofBookSnapshot *qof_book_snapshot_ref (QofBookSnapshot *snapshot);
+/** Releases the reference.  The last one releases the snapshot, from
+ * whichever thread it is. */
+void qof_book_snapshot_unref (QofBookSnapshot *snapshot);
+QofBook *qof_book_snapshot_get_book (const QofBookSnapshot *snapshot);
+/** The number of writes the book had when the snapshot was taken.  What
+ * was computed from a snapshot stays valid for later snapshots of the
+ * same generation. */
+gint qof_book_snapshot_get_generation (const QofBookSnapshot *snapshot);
+/** The book's current number of writes. */
+gint qof_book_get_generation (const QofBook *book);
+
+/** Serializes the updates of the caches that reading the book fills in.
+ * Recursive; no-ops unless snapshots are enabled. */
+void qof_book_cache_lock (const QofBook *book);
+void qof_book_cache_unlock (const QofBook *book);
+/** @} */
+
+/** @name Memory accounting
+ * Estimates of what a book's instances and their KVP slots hold in
+ * memory, for finding out what makes a book big.  The bytes are
+ * approximate: structure sizes and payloads, without allocator overhead.
+ * Strings shared through the string cache, the KVP keys among them, are
+ * reported by qof_string_cache_stats() instead.
+ * @{
+ */
+typedef struct
+{
+    QofIdTypeConst type;
+    guint instances;
+    gsize instance_bytes;  /**< The instance structures */
+    guint64 kvp_frames;
+    guint64 kvp_values;
+    gsize kvp_bytes;       /**< Their KVP frames and values */
+} QofBookTypeMemory;
+
+/** Returns a QofBookTypeMemory for each type of instance in the book,
+ * and for the book itself, largest first.  Free the list with
+ * g_list_free_full (list, g_free). */
+GList *qof_book_get_memory_usage (QofBook *book);
+
+typedef struct
+{
+    QofIdTypeConst type;
+    GncGUID guid;          /**< The instance holding the subtree */
+    gchar *key;            /**< Its top-level key */
+    guint64 values;
+    gsize bytes;
+} QofKvpSubtreeMemory;
+
+/** Returns the at most max largest top-level KVP subtrees in the book,
+ * as QofKvpSubtreeMemory, largest first.  Free the list with
+ * qof_book_free_kvp_subtrees(). */
+GList *qof_book_get_largest_kvp_subtrees (QofBook *book, guint max);
+void qof_book_free_kvp_subtrees (GList *subtrees);
+/** @} */
 /** deprecated */
 #define qof_book_get_guid(X) qof_entity_get_guid (QOF_INSTANCE(X))
 
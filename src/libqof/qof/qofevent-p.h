@@ -34,6 +34,7 @@ typedef struct
     gpointer user_data;
 
     gint handler_id;
+    QofEventId event_mask;      /* 0 for every event */
 } HandlerInfo;
 
 /* generates an event even when events are suspended! */
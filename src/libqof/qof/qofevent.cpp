@@ -31,54 +31,173 @@ extern "C"
 #include "qof.h"
 #include "qofevent-p.h"
 
+typedef struct
+{
+    GList *handlers;
+} TypedHandlers;
+
+typedef struct
+{
+    QofEventBatchHandler handler;
+    gpointer user_data;
+
+    gint handler_id;
+} BatchHandlerInfo;
+
+/* Everything the event code keeps.  A thread that hasn't made a context
+ * of its own current uses the default one. */
+struct QofEventContext
+{
+    guint   suspend_counter;
+    gint    next_handler_id;
+    guint   handler_run_level;
+    guint   pending_deletes;
+    GList   *handlers;
+
+    /* Handlers for the events of a single type, keyed by the QofIdType.
+     * The values are TypedHandlers so that the lists can be changed in
+     * place. */
+    GHashTable *typed_handlers;
+
+    GList   *batch_handlers;
+
+    /* While a batch is open the events are collected in batch_events, one
+     * record per entity, and batch_index maps each entity to its position
+     * there plus one. */
+    guint   batch_counter;
+    GArray  *batch_events;
+    GHashTable *batch_index;
+};
+
 /* Static Variables ************************************************/
-static guint   suspend_counter   = 0;
-static gint    next_handler_id   = 1;
-static guint   handler_run_level = 0;
-static guint   pending_deletes   = 0;
-static GList   *handlers  =   NULL;
+static QofEventContext default_context = { 0, 1 };
+static thread_local QofEventContext *thread_context = NULL;
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
 /* Implementations *************************************************/
 
-static gint
-find_next_handler_id(void)
+static inline QofEventContext *
+event_context (void)
 {
-    HandlerInfo *hi;
-    gint handler_id;
-    GList *node;
+    return thread_context ? thread_context : &default_context;
+}
 
-    /* look for a free handler id */
-    handler_id = next_handler_id;
-    node = handlers;
+QofEventContext *
+qof_event_context_new (void)
+{
+    QofEventContext *ctx = g_new0 (QofEventContext, 1);
+    ctx->next_handler_id = 1;
+    return ctx;
+}
 
-    while (node)
-    {
-        hi = static_cast<HandlerInfo*>(node->data);
+static void
+free_handler_list (GList *list)
+{
+    g_list_free_full (list, g_free);
+}
+
+void
+qof_event_context_destroy (QofEventContext *ctx)
+{
+    GHashTableIter iter;
+    gpointer value;
 
-        if (hi->handler_id == handler_id)
+    if (!ctx || ctx == &default_context)
+        return;
+    g_return_if_fail (ctx != thread_context);
+
+    free_handler_list (ctx->handlers);
+    free_handler_list (ctx->batch_handlers);
+    if (ctx->typed_handlers)
+    {
+        g_hash_table_iter_init (&iter, ctx->typed_handlers);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
         {
-            handler_id++;
-            node = handlers;
-            continue;
+            free_handler_list (static_cast<TypedHandlers*>(value)->handlers);
+            g_free (value);
         }
-
-        node = node->next;
+        g_hash_table_destroy (ctx->typed_handlers);
+    }
+    if (ctx->batch_events)
+    {
+        PWARN ("destroying a context with an open batch");
+        g_array_free (ctx->batch_events, TRUE);
+        g_hash_table_destroy (ctx->batch_index);
     }
+    g_free (ctx);
+}
+
+QofEventContext *
+qof_event_set_thread_context (QofEventContext *ctx)
+{
+    QofEventContext *old = thread_context;
+    thread_context = ctx == &default_context ? NULL : ctx;
+    return old;
+}
+
+static gboolean
+handler_list_has_id (GList *list, gint handler_id)
+{
+    for (; list; list = list->next)
+        if (static_cast<HandlerInfo*>(list->data)->handler_id == handler_id)
+            return TRUE;
+    return FALSE;
+}
+
+static gboolean
+handler_id_in_use (QofEventContext *ctx, gint handler_id)
+{
+    GHashTableIter iter;
+    gpointer value;
+
+    if (handler_list_has_id (ctx->handlers, handler_id))
+        return TRUE;
+    for (GList *node = ctx->batch_handlers; node; node = node->next)
+        if (static_cast<BatchHandlerInfo*>(node->data)->handler_id == handler_id)
+            return TRUE;
+    if (!ctx->typed_handlers)
+        return FALSE;
+    g_hash_table_iter_init (&iter, ctx->typed_handlers);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        if (handler_list_has_id (static_cast<TypedHandlers*>(value)->handlers,
+                                 handler_id))
+            return TRUE;
+    return FALSE;
+}
+
+static gint
+find_next_handler_id(QofEventContext *ctx)
+{
+    gint handler_id;
+
+    /* look for a free handler id */
+    handler_id = ctx->next_handler_id;
+    while (handler_id_in_use (ctx, handler_id))
+        handler_id++;
+
     /* Update id for next registration */
-    next_handler_id = handler_id + 1;
+    ctx->next_handler_id = handler_id + 1;
     return handler_id;
 }
 
 gint
 qof_event_register_handler (QofEventHandler handler, gpointer user_data)
 {
+    return qof_event_register_typed_handler (NULL, 0, handler, user_data);
+}
+
+gint
+qof_event_register_typed_handler (QofIdTypeConst type, QofEventId event_mask,
+                                  QofEventHandler handler, gpointer user_data)
+{
+    QofEventContext *ctx = event_context ();
     HandlerInfo *hi;
     gint handler_id;
 
-    ENTER ("(handler=%p, data=%p)", handler, user_data);
+    ENTER ("(type=%s, mask=%x, handler=%p, data=%p)", type ? type : "(all)",
+           event_mask, handler, user_data);
 
     /* sanity check */
     if (!handler)
@@ -88,7 +207,7 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
     }
 
     /* look for a free handler id */
-    handler_id = find_next_handler_id();
+    handler_id = find_next_handler_id(ctx);
 
     /* Found one, add the handler */
     hi = g_new0 (HandlerInfo, 1);
@@ -96,19 +215,89 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
     hi->handler = handler;
     hi->user_data = user_data;
     hi->handler_id = handler_id;
+    hi->event_mask = event_mask;
 
-    handlers = g_list_prepend (handlers, hi);
+    if (type)
+    {
+        TypedHandlers *th;
+        if (!ctx->typed_handlers)
+            ctx->typed_handlers = g_hash_table_new (g_str_hash, g_str_equal);
+        th = static_cast<TypedHandlers*>(g_hash_table_lookup (ctx->typed_handlers,
+                                                              type));
+        if (!th)
+        {
+            th = g_new0 (TypedHandlers, 1);
+            g_hash_table_insert (ctx->typed_handlers, (gpointer)type, th);
+        }
+        th->handlers = g_list_prepend (th->handlers, hi);
+    }
+    else
+        ctx->handlers = g_list_prepend (ctx->handlers, hi);
     LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
     return handler_id;
 }
 
-void
-qof_event_unregister_handler (gint handler_id)
+gint
+qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                  gpointer user_data)
+{
+    QofEventContext *ctx = event_context ();
+    BatchHandlerInfo *hi;
+
+    ENTER ("(handler=%p, data=%p)", handler, user_data);
+    if (!handler)
+    {
+        PERR ("no handler specified");
+        return 0;
+    }
+
+    hi = g_new0 (BatchHandlerInfo, 1);
+    hi->handler = handler;
+    hi->user_data = user_data;
+    hi->handler_id = find_next_handler_id(ctx);
+
+    ctx->batch_handlers = g_list_prepend (ctx->batch_handlers, hi);
+    LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data,
+           hi->handler_id);
+    return hi->handler_id;
+}
+
+static gboolean
+unregister_batch_handler (QofEventContext *ctx, gint handler_id)
 {
     GList *node;
 
-    ENTER ("(handler_id=%d)", handler_id);
-    for (node = handlers; node; node = node->next)
+    for (node = ctx->batch_handlers; node; node = node->next)
+    {
+        BatchHandlerInfo *hi = static_cast<BatchHandlerInfo*>(node->data);
+
+        if (hi->handler_id != handler_id)
+            continue;
+
+        LEAVE ("(handler_id=%d) handler=%p data=%p", handler_id,
+               hi->handler, hi->user_data);
+        hi->handler = NULL;
+        if (ctx->handler_run_level == 0)
+        {
+            ctx->batch_handlers = g_list_delete_link (ctx->batch_handlers, node);
+            g_free (hi);
+        }
+        else
+        {
+            ctx->pending_deletes++;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Unregister handler_id if it is in *list. */
+static gboolean
+unregister_from_list (QofEventContext *ctx, GList **list, gint handler_id)
+{
+    GList *node;
+
+    for (node = *list; node; node = node->next)
     {
         HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
 
@@ -127,18 +316,43 @@ qof_event_unregister_handler (gint handler_id)
         /* safety -- clear the handler in case we're running events now */
         hi->handler = NULL;
 
-        if (handler_run_level == 0)
+        if (ctx->handler_run_level == 0)
         {
-            handlers = g_list_remove_link (handlers, node);
+            *list = g_list_remove_link (*list, node);
             g_list_free_1 (node);
             g_free (hi);
         }
         else
         {
-            pending_deletes++;
+            ctx->pending_deletes++;
         }
 
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void
+qof_event_unregister_handler (gint handler_id)
+{
+    QofEventContext *ctx = event_context ();
+
+    ENTER ("(handler_id=%d)", handler_id);
+    if (unregister_from_list (ctx, &ctx->handlers, handler_id))
         return;
+    if (unregister_batch_handler (ctx, handler_id))
+        return;
+    if (ctx->typed_handlers)
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init (&iter, ctx->typed_handlers);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+            if (unregister_from_list (ctx,
+                                      &static_cast<TypedHandlers*>(value)->handlers,
+                                      handler_id))
+                return;
     }
 
     PERR ("no such handler: %d", handler_id);
@@ -147,9 +361,11 @@ qof_event_unregister_handler (gint handler_id)
 void
 qof_event_suspend (void)
 {
-    suspend_counter++;
+    QofEventContext *ctx = event_context ();
+
+    ctx->suspend_counter++;
 
-    if (suspend_counter == 0)
+    if (ctx->suspend_counter == 0)
     {
         PERR ("suspend counter overflow");
     }
@@ -158,88 +374,313 @@ qof_event_suspend (void)
 void
 qof_event_resume (void)
 {
-    if (suspend_counter == 0)
+    QofEventContext *ctx = event_context ();
+
+    if (ctx->suspend_counter == 0)
     {
         PERR ("suspend counter underflow");
         return;
     }
 
-    suspend_counter--;
+    ctx->suspend_counter--;
 }
 
 static void
-qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
-                             gpointer event_data)
+run_handlers (GList *list, QofInstance *entity, QofEventId event_id,
+              gpointer event_data)
 {
     GList *node;
     GList *next_node = NULL;
 
-    g_return_if_fail(entity);
-
-    switch (event_id)
-    {
-    case QOF_EVENT_NONE:
-    {
-        /* if none, don't log, just return. */
-        return;
-    }
-    }
-
-    handler_run_level++;
-    for (node = handlers; node; node = next_node)
+    for (node = list; node; node = next_node)
     {
         HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
 
         next_node = node->next;
-        if (hi->handler)
+        if (hi->handler && (!hi->event_mask || (hi->event_mask & event_id)))
         {
             PINFO("id=%d hi=%p han=%p data=%p", hi->handler_id, hi,
                   hi->handler, event_data);
             hi->handler (entity, event_id, hi->user_data, event_data);
         }
     }
-    handler_run_level--;
+}
+
+/* Free the handlers unregistered while events were running. */
+static GList *
+sweep_handlers (GList *list)
+{
+    GList *node;
+    GList *next_node = NULL;
+
+    for (node = list; node; node = next_node)
+    {
+        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+        next_node = node->next;
+        if (hi->handler == NULL)
+        {
+            /* remove this node from the list, then free this node */
+            list = g_list_remove_link (list, node);
+            g_list_free_1 (node);
+            g_free (hi);
+        }
+    }
+    return list;
+}
 
-    /* If we're the outermost event runner and we have pending deletes
-     * then go delete the handlers now.
-     */
-    if (handler_run_level == 0 && pending_deletes)
+/* If we're the outermost event runner and we have pending deletes
+ * then go delete the handlers now.
+ */
+static void
+sweep_pending_deletes (QofEventContext *ctx)
+{
+    if (ctx->handler_run_level == 0 && ctx->pending_deletes)
     {
-        for (node = handlers; node; node = next_node)
+        GList *node, *next_node;
+
+        ctx->handlers = sweep_handlers (ctx->handlers);
+        for (node = ctx->batch_handlers; node; node = next_node)
         {
-            HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+            BatchHandlerInfo *hi = static_cast<BatchHandlerInfo*>(node->data);
             next_node = node->next;
             if (hi->handler == NULL)
             {
-                /* remove this node from the list, then free this node */
-                handlers = g_list_remove_link (handlers, node);
-                g_list_free_1 (node);
+                ctx->batch_handlers = g_list_delete_link (ctx->batch_handlers,
+                                                          node);
                 g_free (hi);
             }
         }
-        pending_deletes = 0;
+        if (ctx->typed_handlers)
+        {
+            GHashTableIter iter;
+            gpointer value;
+
+            g_hash_table_iter_init (&iter, ctx->typed_handlers);
+            while (g_hash_table_iter_next (&iter, NULL, &value))
+            {
+                TypedHandlers *th = static_cast<TypedHandlers*>(value);
+                th->handlers = sweep_handlers (th->handlers);
+            }
+        }
+        ctx->pending_deletes = 0;
     }
 }
 
+static void
+qof_event_generate_internal (QofEventContext *ctx, QofInstance *entity,
+                             QofEventId event_id, gpointer event_data)
+{
+
+    g_return_if_fail(entity);
+
+    switch (event_id)
+    {
+    case QOF_EVENT_NONE:
+    {
+        /* if none, don't log, just return. */
+        return;
+    }
+    }
+
+    ctx->handler_run_level++;
+    run_handlers (ctx->handlers, entity, event_id, event_data);
+    if (ctx->typed_handlers && entity->e_type)
+    {
+        TypedHandlers *th = static_cast<TypedHandlers*>(
+            g_hash_table_lookup (ctx->typed_handlers, entity->e_type));
+        if (th)
+            run_handlers (th->handlers, entity, event_id, event_data);
+    }
+    ctx->handler_run_level--;
+
+    sweep_pending_deletes (ctx);
+}
+
+static void
+run_batch_handlers (QofEventContext *ctx, const QofEventRecord *events,
+                    guint n_events)
+{
+    GList *node;
+    GList *next_node = NULL;
+
+    if (!ctx->batch_handlers || !n_events)
+        return;
+
+    ctx->handler_run_level++;
+    for (node = ctx->batch_handlers; node; node = next_node)
+    {
+        BatchHandlerInfo *hi = static_cast<BatchHandlerInfo*>(node->data);
+
+        next_node = node->next;
+        if (hi->handler)
+            hi->handler (events, n_events, hi->user_data);
+    }
+    ctx->handler_run_level--;
+
+    sweep_pending_deletes (ctx);
+}
+
+static void
+qof_event_dispatch (QofEventContext *ctx, QofInstance *entity,
+                    QofEventId event_id, gpointer event_data)
+{
+    QofEventRecord record = { entity, event_id };
+
+    if (event_id == QOF_EVENT_NONE)
+        return;
+    qof_event_generate_internal (ctx, entity, event_id, event_data);
+    run_batch_handlers (ctx, &record, 1);
+}
+
+/* Deliver a record collected by a batch: the ordinary handlers are given
+ * each of its events separately, in the order of their ids. */
+static void
+deliver_record (QofEventContext *ctx, const QofEventRecord *record)
+{
+    guint mask = static_cast<guint>(record->event_mask);
+
+    for (guint bit = 1; bit && bit <= mask; bit <<= 1)
+        if (mask & bit)
+            qof_event_generate_internal (ctx, record->entity,
+                                         static_cast<QofEventId>(bit), NULL);
+}
+
+static void
+batch_record (QofEventContext *ctx, QofInstance *entity, QofEventId event_id)
+{
+    gpointer index;
+
+    if (!ctx->batch_events)
+    {
+        ctx->batch_events = g_array_new (FALSE, FALSE, sizeof (QofEventRecord));
+        ctx->batch_index = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+
+    index = g_hash_table_lookup (ctx->batch_index, entity);
+    if (index)
+    {
+        g_array_index (ctx->batch_events, QofEventRecord,
+                       GPOINTER_TO_UINT (index) - 1).event_mask |= event_id;
+        return;
+    }
+
+    QofEventRecord record = { entity, event_id };
+    g_array_append_val (ctx->batch_events, record);
+    g_hash_table_insert (ctx->batch_index, entity,
+                         GUINT_TO_POINTER (ctx->batch_events->len));
+}
+
+/* An entity about to be destroyed can't wait for the end of the batch, so
+ * deliver what has been collected for it now. */
+static void
+batch_flush_entity (QofEventContext *ctx, QofInstance *entity)
+{
+    gpointer index;
+    QofEventRecord *slot;
+    QofEventRecord record;
+
+    if (!ctx->batch_index)
+        return;
+    index = g_hash_table_lookup (ctx->batch_index, entity);
+    if (!index)
+        return;
+
+    slot = &g_array_index (ctx->batch_events, QofEventRecord,
+                           GPOINTER_TO_UINT (index) - 1);
+    record = *slot;
+    slot->entity = NULL;
+    g_hash_table_remove (ctx->batch_index, entity);
+
+    deliver_record (ctx, &record);
+    run_batch_handlers (ctx, &record, 1);
+}
+
+void
+qof_event_begin_batch (void)
+{
+    event_context ()->batch_counter++;
+}
+
+void
+qof_event_end_batch (void)
+{
+    QofEventContext *ctx = event_context ();
+    GArray *events;
+    guint i, n;
+
+    if (ctx->batch_counter == 0)
+    {
+        PERR ("batch counter underflow");
+        return;
+    }
+    if (--ctx->batch_counter || !ctx->batch_events)
+        return;
+
+    /* The handlers may generate events of their own, which are delivered
+     * at once now that the batch is closed. */
+    events = ctx->batch_events;
+    ctx->batch_events = NULL;
+    g_hash_table_destroy (ctx->batch_index);
+    ctx->batch_index = NULL;
+
+    for (i = 0, n = 0; i < events->len; i++)
+    {
+        QofEventRecord *record = &g_array_index (events, QofEventRecord, i);
+        if (!record->entity)
+            continue;
+        g_array_index (events, QofEventRecord, n++) = *record;
+    }
+    g_array_set_size (events, n);
+
+    PINFO ("delivering %u batched entities", n);
+    for (i = 0; i < n; i++)
+        deliver_record (ctx, &g_array_index (events, QofEventRecord, i));
+    run_batch_handlers (ctx, reinterpret_cast<QofEventRecord*>(events->data), n);
+
+    g_array_free (events, TRUE);
+}
+
+gboolean
+qof_event_is_batching (void)
+{
+    return event_context ()->batch_counter > 0;
+}
+
 void
 qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data)
 {
     if (!entity)
         return;
 
-    qof_event_generate_internal (entity, event_id, event_data);
+    qof_event_dispatch (event_context (), entity, event_id, event_data);
 }
 
 void
 qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
 {
+    QofEventContext *ctx;
+
     if (!entity)
         return;
 
-    if (suspend_counter)
+    ctx = event_context ();
+    if (ctx->suspend_counter)
         return;
 
-    qof_event_generate_internal (entity, event_id, event_data);
+    if (ctx->batch_counter && event_id != QOF_EVENT_NONE)
+    {
+        /* event_data often points to the caller's stack, so events that
+         * carry any can't be kept for later. */
+        if (!event_data && !(event_id & QOF_EVENT_DESTROY))
+        {
+            batch_record (ctx, entity, event_id);
+            return;
+        }
+        if (event_id & QOF_EVENT_DESTROY)
+            batch_flush_entity (ctx, entity);
+    }
+
+    qof_event_dispatch (ctx, entity, event_id, event_data);
 }
 
 /* =========================== END OF FILE ======================= */
@@ -98,6 +98,56 @@ typedef void (*QofEventHandler) (QofInstance *ent,  QofEventId event_type,
  */
 gint qof_event_register_handler (QofEventHandler handler, gpointer handler_data);
 
+/** \brief Register a handler for some events of one type of entity.
+ *
+ * Unlike handlers registered with qof_event_register_handler, which see
+ * every event, the handler is only invoked for the events of entities of
+ * the given type, so that generating the events of other types doesn't
+ * cost anything for it.
+ *
+ * @param type:  the QofIdType of the entities to watch, or NULL for all
+ * @param event_mask: the events to watch, or 0 for all of them
+ * @param handler:   handler to register
+ * @param handler_data: data provided when handler is invoked
+ *
+ * @return id identifying handler, to be passed to
+ * qof_event_unregister_handler
+ */
+gint qof_event_register_typed_handler (QofIdTypeConst type,
+                                       QofEventId event_mask,
+                                       QofEventHandler handler,
+                                       gpointer handler_data);
+
+/** One entry of a batch of events: the entity and the ids of all of the
+ * events it generated, or'ed together. */
+typedef struct
+{
+    QofInstance *entity;
+    QofEventId event_mask;
+} QofEventRecord;
+
+/** \brief Handler invoked with a batch of events.
+ *
+ * @param events:   the entities and their events, in the order the entities
+ *                  first generated one. Outside of a batch each event is
+ *                  delivered as a batch of its own.
+ * @param n_events: the number of records in events.
+ * @param handler_data: data supplied when handler was registered.
+ */
+typedef void (*QofEventBatchHandler) (const QofEventRecord *events,
+                                      guint n_events, gpointer handler_data);
+
+/** \brief Register a handler that receives events in batches.
+ *
+ * @param handler:   handler to register
+ * @param handler_data: data provided when handler is invoked
+ *
+ * @return id identifying handler, to be passed to
+ * qof_event_unregister_handler
+ */
+gint qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                       gpointer handler_data);
+
 /** \brief Unregister an event handler.
  *
  * @param handler_id: the id of the handler to unregister
@@ -139,6 +189,47 @@ void qof_event_suspend (void);
 /** Resume engine event generation. */
 void qof_event_resume (void);
 
+/** \brief Collect engine events until the matching qof_event_end_batch.
+ *
+ *  Unlike qof_event_suspend the events aren't lost: each entity's events
+ *  are recorded once, however often it generates them, and delivered when
+ *  the outermost batch ends. Ordinary handlers then get one call per
+ *  entity and event id, and batch handlers a single call with all of the
+ *  records. Events carrying event_data are delivered at once, as are
+ *  QOF_EVENT_DESTROY events, which are preceded by whatever was collected
+ *  for the entity. Batches may be nested.
+ */
+void qof_event_begin_batch (void);
+
+/** End a batch begun with qof_event_begin_batch, delivering its events if it
+ * was the outermost one. */
+void qof_event_end_batch (void);
+
+/** @return TRUE while a batch is open. */
+gboolean qof_event_is_batching (void);
+
+/** \brief The handlers, suspensions and batches of one set of books.
+ *
+ *  By default every thread shares one context. A thread working on a
+ *  session of its own, independent of the others, may make a context of
+ *  its own current; from then on the handlers it registers, the events
+ *  its engine objects generate and its suspensions and batches are seen
+ *  by that thread alone, and no locking is needed between them.
+ */
+typedef struct QofEventContext QofEventContext;
+
+/** Create an empty event context. */
+QofEventContext *qof_event_context_new (void);
+
+/** Destroy a context along with the handlers still registered in it. It
+ * mustn't be current on any thread. */
+void qof_event_context_destroy (QofEventContext *ctx);
+
+/** Make ctx the calling thread's event context; NULL returns the thread
+ * to the shared one.
+ * @return The context that was current before, NULL for the shared one. */
+QofEventContext *qof_event_set_thread_context (QofEventContext *ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,9 @@ extern "C"
 #include "qof.h"
 #include "qofid-p.h"
 #include "qofinstance-p.h"
+#include "qofbook-p.h"
+#include "guid-table.hpp"
+#include <algorithm>
 
 static QofLogModule log_module = QOF_MOD_ENGINE;
 
@@ -40,7 +43,7 @@ struct QofCollection_s
     QofIdType    e_type;
     gboolean     is_dirty;
 
-    GHashTable * hash_of_entities;
+    GncGuidTable * hash_of_entities;
     gpointer     data;       /* place where object class can hang arbitrary data */
 };
 
@@ -52,7 +55,7 @@ qof_collection_new (QofIdType type)
     QofCollection *col;
     col = g_new0(QofCollection, 1);
     col->e_type = static_cast<QofIdType>(CACHE_INSERT (type));
-    col->hash_of_entities = guid_hash_table_new();
+    col->hash_of_entities = new GncGuidTable;
     col->data = NULL;
     return col;
 }
@@ -61,7 +64,7 @@ void
 qof_collection_destroy (QofCollection *col)
 {
     CACHE_REMOVE (col->e_type);
-    g_hash_table_destroy(col->hash_of_entities);
+    delete col->hash_of_entities;
     col->e_type = NULL;
     col->hash_of_entities = NULL;
     col->data = NULL;   /** XXX there should be a destroy notifier for this */
@@ -89,7 +92,9 @@ qof_collection_remove_entity (QofInstance *ent)
     col = qof_instance_get_collection(ent);
     if (!col) return;
     guid = qof_instance_get_guid(ent);
-    g_hash_table_remove (col->hash_of_entities, guid);
+    qof_book_begin_write (qof_instance_get_book (ent));
+    col->hash_of_entities->remove (*guid);
+    qof_book_end_write (qof_instance_get_book (ent));
     qof_instance_set_collection(ent, NULL);
 }
 
@@ -103,7 +108,9 @@ qof_collection_insert_entity (QofCollection *col, QofInstance *ent)
     if (guid_equal(guid, guid_null())) return;
     g_return_if_fail (col->e_type == ent->e_type);
     qof_collection_remove_entity (ent);
-    g_hash_table_insert (col->hash_of_entities, (gpointer)guid, ent);
+    qof_book_begin_write (qof_instance_get_book (ent));
+    col->hash_of_entities->insert (*guid, ent);
+    qof_book_end_write (qof_instance_get_book (ent));
     qof_instance_set_collection(ent, col);
 }
 
@@ -129,7 +136,9 @@ qof_collection_add_entity (QofCollection *coll, QofInstance *ent)
     {
         return FALSE;
     }
-    g_hash_table_insert (coll->hash_of_entities, (gpointer)guid, ent);
+    qof_book_begin_write (qof_instance_get_book (ent));
+    coll->hash_of_entities->insert (*guid, ent);
+    qof_book_end_write (qof_instance_get_book (ent));
     return TRUE;
 }
 
@@ -199,12 +208,12 @@ qof_collection_compare (QofCollection *target, QofCollection *merge)
         return -1;
     }
     qof_collection_set_data(target, &value);
-    qof_collection_foreach(merge, collection_compare_cb, target);
+    qof_collection_foreach_unordered(merge, collection_compare_cb, target);
     value = *(gint*)qof_collection_get_data(target);
     if (value == 0)
     {
         qof_collection_set_data(merge, &value);
-        qof_collection_foreach(target, collection_compare_cb, merge);
+        qof_collection_foreach_unordered(target, collection_compare_cb, merge);
         value = *(gint*)qof_collection_get_data(merge);
     }
     return value;
@@ -216,8 +225,7 @@ qof_collection_lookup_entity (const QofCollection *col, const GncGUID * guid)
     QofInstance *ent;
     g_return_val_if_fail (col, NULL);
     if (guid == NULL) return NULL;
-    ent = static_cast<QofInstance*>(g_hash_table_lookup (col->hash_of_entities,
-							 guid));
+    ent = static_cast<QofInstance*>(col->hash_of_entities->lookup (*guid));
     return ent;
 }
 
@@ -245,7 +253,7 @@ qof_collection_count (const QofCollection *col)
 {
     guint c;
 
-    c = g_hash_table_size(col->hash_of_entities);
+    c = col->hash_of_entities->size();
     return c;
 }
 
@@ -280,7 +288,7 @@ qof_collection_print_dirty (const QofCollection *col, gpointer dummy)
 {
     if (col->is_dirty)
         printf("%s collection is dirty.\n", col->e_type);
-    qof_collection_foreach(col, (QofInstanceForeachCB)qof_instance_print_dirty, NULL);
+    qof_collection_foreach_unordered(col, (QofInstanceForeachCB)qof_instance_print_dirty, NULL);
 }
 
 /* =============================================================== */
@@ -302,40 +310,62 @@ qof_collection_set_data (QofCollection *col, gpointer user_data)
 
 /* =============================================================== */
 
-struct _iterate
+void
+qof_collection_foreach (const QofCollection *col, QofInstanceForeachCB cb_func,
+                        gpointer user_data)
 {
-    QofInstanceForeachCB      fcn;
-    gpointer                data;
-};
+    g_return_if_fail (col);
+    g_return_if_fail (cb_func);
 
-static void
-foreach_cb (gpointer item, gpointer arg)
-{
-    struct _iterate *iter = static_cast<_iterate*>(arg);
-    QofInstance *ent = static_cast<QofInstance*>(item);
+    PINFO("Hash Table size of %s before is %" G_GSIZE_FORMAT, col->e_type,
+          col->hash_of_entities->size());
+
+    /* The callback may add or remove entities, so work from a copy. */
+    auto entries = col->hash_of_entities->values();
+    for (auto ent : entries)
+        cb_func (static_cast<QofInstance*>(ent), user_data);
 
-    iter->fcn (ent, iter->data);
+    PINFO("Hash Table size of %s after is %" G_GSIZE_FORMAT, col->e_type,
+          col->hash_of_entities->size());
 }
 
 void
-qof_collection_foreach (const QofCollection *col, QofInstanceForeachCB cb_func,
-                        gpointer user_data)
+qof_collection_foreach_unordered (const QofCollection *col,
+                                  QofInstanceForeachCB cb_func,
+                                  gpointer user_data)
 {
-    struct _iterate iter;
-    GList *entries;
-
     g_return_if_fail (col);
     g_return_if_fail (cb_func);
 
-    iter.fcn = cb_func;
-    iter.data = user_data;
+    col->hash_of_entities->for_each ([=](void* ent)
+        { cb_func (static_cast<QofInstance*>(ent), user_data); });
+}
 
-    PINFO("Hash Table size of %s before is %d", col->e_type, g_hash_table_size(col->hash_of_entities));
+void
+qof_collection_foreach_chunk (const QofCollection *col, guint chunk,
+                              guint n_chunks, QofInstanceForeachCB cb_func,
+                              gpointer user_data)
+{
+    g_return_if_fail (col);
+    g_return_if_fail (cb_func);
+    g_return_if_fail (chunk < n_chunks);
 
-    entries = g_hash_table_get_values (col->hash_of_entities);
-    g_list_foreach (entries, foreach_cb, &iter);
-    g_list_free (entries);
+    col->hash_of_entities->for_each_in_chunk (chunk, n_chunks, [=](void* ent)
+        { cb_func (static_cast<QofInstance*>(ent), user_data); });
+}
+
+void
+qof_collection_foreach_sorted (const QofCollection *col,
+                               QofInstanceForeachCB cb_func,
+                               gpointer user_data)
+{
+    g_return_if_fail (col);
+    g_return_if_fail (cb_func);
 
-    PINFO("Hash Table size of %s after is %d", col->e_type, g_hash_table_size(col->hash_of_entities));
+    auto entries = col->hash_of_entities->values();
+    std::sort (entries.begin(), entries.end(), [](void* a, void* b)
+        { return qof_instance_guid_compare (a, b) < 0; });
+    for (auto ent : entries)
+        cb_func (static_cast<QofInstance*>(ent), user_data);
 }
 /* =============================================================== */
@@ -167,10 +167,32 @@ QofInstance * qof_collection_lookup_entity (const QofCollection *, const GncGUID
 /** Callback type for qof_collection_foreach */
 typedef void (*QofInstanceForeachCB) (QofInstance *, gpointer user_data);
 
-/** Call the callback for each entity in the collection. */
+/** Call the callback for each entity in the collection, in no particular
+ * order.  It works from a copy of the collection, so the callback may add
+ * and remove entities. */
 void qof_collection_foreach (const QofCollection *, QofInstanceForeachCB,
                              gpointer user_data);
 
+/** Like qof_collection_foreach(), but walks the collection itself rather
+ * than a copy.  The callback mustn't add entities to this collection or
+ * remove them from it, which includes destroying them. */
+void qof_collection_foreach_unordered (const QofCollection *,
+                                       QofInstanceForeachCB,
+                                       gpointer user_data);
+
+/** Call the callback for the entities in the chunk'th of n_chunks parts of
+ * the collection.  Walking chunks 0 to n_chunks - 1 visits each entity
+ * once.  The callback mustn't add or remove entities; readers holding a
+ * QofBookSnapshot may walk different chunks from different threads. */
+void qof_collection_foreach_chunk (const QofCollection *, guint chunk,
+                                   guint n_chunks, QofInstanceForeachCB,
+                                   gpointer user_data);
+
+/** Like qof_collection_foreach(), but in the order of the entities'
+ * GUIDs, for output that should come out the same from run to run. */
+void qof_collection_foreach_sorted (const QofCollection *,
+                                    QofInstanceForeachCB, gpointer user_data);
+
 /** Store and retreive arbitrary object-defined data
  *
  * XXX We need to add a callback for when the collection is being
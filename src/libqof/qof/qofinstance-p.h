@@ -130,6 +130,23 @@ void qof_instance_set_kvp (QofInstance *inst, const gchar *key, const GValue *va
  */
 void qof_instance_get_kvp (const QofInstance *inst, const gchar *key, GValue
 *value);
+/** Typed lookups of a KVP slot that skip the GValue. Each returns what
+ * the slot holds when it holds that type, without copying it: the string
+ * and GUID belong to the slot and are only good until it changes.
+ * @param inst: The QofInstance
+ * @param key: The key of or '/'-delimited path to the slot.
+ * @return The string or GUID, or NULL if the slot is missing or of another
+ * type. The int64 and numeric forms store the value in *value and return
+ * TRUE, or return FALSE and leave *value alone.
+ */
+const char* qof_instance_get_kvp_string (const QofInstance *inst,
+                                         const gchar *key);
+gboolean qof_instance_get_kvp_int64 (const QofInstance *inst, const gchar *key,
+                                     gint64 *value);
+gboolean qof_instance_get_kvp_numeric (const QofInstance *inst,
+                                       const gchar *key, gnc_numeric *value);
+const GncGUID* qof_instance_get_kvp_guid (const QofInstance *inst,
+                                          const gchar *key);
 /** @} Close out the DOxygen ingroup */
 /* Functions to isolate the KVP mechanism inside QOF for cases where
 GValue * operations won't work.
@@ -137,6 +154,12 @@ GValue * operations won't work.
 void qof_instance_copy_kvp (QofInstance *to, const QofInstance *from);
 void qof_instance_swap_kvp (QofInstance *a, QofInstance *b);
 int qof_instance_compare_kvp (const QofInstance *a, const QofInstance *b);
+/** A copy of the instance's slots, to be put back by
+ *  qof_instance_restore_kvp() or freed by qof_instance_free_saved_kvp(). */
+KvpFrame* qof_instance_save_kvp (const QofInstance *inst);
+/** Replaces the instance's slots with saved ones, taking them over. */
+void qof_instance_restore_kvp (QofInstance *inst, KvpFrame *saved);
+void qof_instance_free_saved_kvp (KvpFrame *saved);
 /** Returns a g_strdup'd string which must be g_freed. */
 char* qof_instance_kvp_as_string (const QofInstance *inst);
 void qof_instance_kvp_add_guid (const QofInstance *inst, const char* path,
@@ -833,7 +833,7 @@ get_referring_object_helper(QofCollection* coll, gpointer user_data)
     QofInstance* first_instance = NULL;
     GetReferringObjectHelperData* data = (GetReferringObjectHelperData*)user_data;
 
-    qof_collection_foreach(coll, get_referring_object_instance_helper, &first_instance);
+    qof_collection_foreach_unordered(coll, get_referring_object_instance_helper, &first_instance);
 
     if (first_instance != NULL)
     {
@@ -881,7 +881,7 @@ qof_instance_get_referring_object_list_from_collection(const QofCollection* coll
     data.inst = ref;
     data.list = NULL;
 
-    qof_collection_foreach(coll, get_typed_referring_object_instance_helper, &data);
+    qof_collection_foreach_unordered(coll, get_typed_referring_object_instance_helper, &data);
     return data.list;
 }
 
@@ -962,17 +962,24 @@ qof_begin_edit (QofInstance *inst)
     if (!inst) return FALSE;
 
     priv = GET_PRIVATE(inst);
+    qof_book_begin_write (priv->book);
     priv->editlevel++;
-    if (1 < priv->editlevel) return FALSE;
+    if (1 < priv->editlevel)
+    {
+        qof_book_end_write (priv->book);
+        return FALSE;
+    }
     if (0 >= priv->editlevel)
         priv->editlevel = 1;
 
-    be = qof_book_get_backend(priv->book);
+    be = qof_book_shutting_down(priv->book) ? NULL :
+        qof_book_get_backend(priv->book);
     if (be && qof_backend_begin_exists(be))
         qof_backend_run_begin(be, inst);
     else
         priv->dirty = TRUE;
 
+    qof_book_end_write (priv->book);
     return TRUE;
 }
 
@@ -983,22 +990,50 @@ gboolean qof_commit_edit (QofInstance *inst)
     if (!inst) return FALSE;
 
     priv = GET_PRIVATE(inst);
+    qof_book_begin_write (priv->book);
     priv->editlevel--;
-    if (0 < priv->editlevel) return FALSE;
+    if (0 < priv->editlevel)
+    {
+        qof_book_end_write (priv->book);
+        return FALSE;
+    }
 
     if (0 > priv->editlevel)
     {
         PERR ("unbalanced call - resetting (was %d)", priv->editlevel);
         priv->editlevel = 0;
     }
+    qof_book_end_write (priv->book);
     return TRUE;
 }
 
+static gboolean
+qof_commit_edit_part2_locked (QofInstance *inst,
+                              void (*on_error)(QofInstance *, QofBackendError),
+                              void (*on_done)(QofInstance *),
+                              void (*on_free)(QofInstance *));
+
 gboolean
 qof_commit_edit_part2(QofInstance *inst,
                       void (*on_error)(QofInstance *, QofBackendError),
                       void (*on_done)(QofInstance *),
                       void (*on_free)(QofInstance *))
+{
+    QOF_TRACE_SCOPE ("qof_commit_edit");
+    /* on_free may take the instance with it. */
+    QofBook *book = GET_PRIVATE(inst)->book;
+    qof_book_begin_write (book);
+    auto retval = qof_commit_edit_part2_locked (inst, on_error, on_done,
+                                                on_free);
+    qof_book_end_write (book);
+    return retval;
+}
+
+static gboolean
+qof_commit_edit_part2_locked (QofInstance *inst,
+                              void (*on_error)(QofInstance *, QofBackendError),
+                              void (*on_done)(QofInstance *),
+                              void (*on_free)(QofInstance *))
 {
     QofInstancePrivate *priv;
     QofBackend * be;
@@ -1012,7 +1047,9 @@ qof_commit_edit_part2(QofInstance *inst,
     }
 
     /* See if there's a backend.  If there is, invoke it. */
-    be = qof_book_get_backend(priv->book);
+    /* Tearing the book down mustn't delete anything it was saved to. */
+    be = qof_book_shutting_down(priv->book) ? NULL :
+        qof_book_get_backend(priv->book);
     if (be && qof_backend_commit_exists(be))
     {
         QofBackendError errcode;
@@ -1080,6 +1117,50 @@ qof_instance_get_kvp (const QofInstance *inst, const gchar *key, GValue *value)
     }
 }
 
+static inline KvpValue*
+get_kvp_slot (const QofInstance *inst, const gchar *key,
+              KvpValue::Type type)
+{
+    auto slot = inst->kvp_data->get_slot(key);
+    return slot != nullptr && slot->get_type() == type ? slot : nullptr;
+}
+
+const char*
+qof_instance_get_kvp_string (const QofInstance *inst, const gchar *key)
+{
+    auto slot = get_kvp_slot (inst, key, KvpValue::Type::STRING);
+    return slot ? slot->get<const char*>() : nullptr;
+}
+
+gboolean
+qof_instance_get_kvp_int64 (const QofInstance *inst, const gchar *key,
+                            gint64 *value)
+{
+    auto slot = get_kvp_slot (inst, key, KvpValue::Type::INT64);
+    if (slot == nullptr)
+        return FALSE;
+    *value = slot->get<int64_t>();
+    return TRUE;
+}
+
+gboolean
+qof_instance_get_kvp_numeric (const QofInstance *inst, const gchar *key,
+                              gnc_numeric *value)
+{
+    auto slot = get_kvp_slot (inst, key, KvpValue::Type::NUMERIC);
+    if (slot == nullptr)
+        return FALSE;
+    *value = slot->get<gnc_numeric>();
+    return TRUE;
+}
+
+const GncGUID*
+qof_instance_get_kvp_guid (const QofInstance *inst, const gchar *key)
+{
+    auto slot = get_kvp_slot (inst, key, KvpValue::Type::GUID);
+    return slot ? slot->get<GncGUID*>() : nullptr;
+}
+
 void
 qof_instance_copy_kvp (QofInstance *to, const QofInstance *from)
 {
@@ -1093,6 +1174,25 @@ qof_instance_swap_kvp (QofInstance *a, QofInstance *b)
     std::swap(a->kvp_data, b->kvp_data);
 }
 
+KvpFrame*
+qof_instance_save_kvp (const QofInstance *inst)
+{
+    return new KvpFrame(*inst->kvp_data);
+}
+
+void
+qof_instance_restore_kvp (QofInstance *inst, KvpFrame *saved)
+{
+    delete inst->kvp_data;
+    inst->kvp_data = saved;
+}
+
+void
+qof_instance_free_saved_kvp (KvpFrame *saved)
+{
+    delete saved;
+}
+
 int
 qof_instance_compare_kvp (const QofInstance *a, const QofInstance *b)
 {
@@ -65,6 +65,7 @@ static gchar* function_buffer = NULL;
 static gint qof_log_num_spaces = 0;
 static GHashTable *log_table = NULL;
 static GLogFunc previous_handler = NULL;
+static gchar *trace_filename = NULL;
 
 void
 qof_log_indent(void)
@@ -198,11 +199,26 @@ qof_log_init_filename(const gchar* log_filename)
     {
         g_critical("Cannot open log output file \"%s\", using stderr.", log_filename);
     }
+
+    if (!trace_filename && g_getenv("GNC_TRACE_FILE"))
+    {
+        trace_filename = g_strdup(g_getenv("GNC_TRACE_FILE"));
+        qof_trace_set_enabled(TRUE);
+    }
 }
 
 void
 qof_log_shutdown (void)
 {
+    if (trace_filename)
+    {
+        qof_trace_set_enabled(FALSE);
+        if (!qof_trace_write(trace_filename))
+            g_warning("Cannot write the trace to \"%s\".", trace_filename);
+        g_free(trace_filename);
+        trace_filename = NULL;
+    }
+
     if (fout && fout != stderr && fout != stdout)
     {
         fclose(fout);
@@ -465,3 +481,168 @@ qof_log_level_from_string(const gchar *str)
     if (g_ascii_strncasecmp("debug", str, 5) == 0) return QOF_LOG_DEBUG;
     return QOF_LOG_DEBUG;
 }
+
+/* Tracing */
+
+struct QofTraceEvent
+{
+    const char *name;
+    gint64 ts;
+    gint64 value;               /* The duration of a timed event */
+    char phase;                 /* 'X' timed, 'C' counter */
+};
+
+struct QofTraceBuffer
+{
+    gint tid;
+    gint next;                  /* Written only by the owning thread */
+    QofTraceEvent events[QOF_TRACE_BUFFER_SIZE];
+};
+
+static gint trace_enabled = FALSE;
+static gint trace_next_tid = 0;
+/* Every thread's buffer, kept after the thread ends so that its events
+ * get written too. The lock is only taken when a thread records its
+ * first event and when the trace is written or cleared. */
+G_LOCK_DEFINE_STATIC (trace_buffers);
+static GPtrArray *trace_buffers = NULL;
+static thread_local QofTraceBuffer *trace_buffer = nullptr;
+
+static QofTraceBuffer *
+trace_get_buffer (void)
+{
+    if (G_LIKELY (trace_buffer))
+        return trace_buffer;
+
+    trace_buffer = g_new0 (QofTraceBuffer, 1);
+    trace_buffer->tid = g_atomic_int_add (&trace_next_tid, 1) + 1;
+    G_LOCK (trace_buffers);
+    if (!trace_buffers)
+        trace_buffers = g_ptr_array_new ();
+    g_ptr_array_add (trace_buffers, trace_buffer);
+    G_UNLOCK (trace_buffers);
+    return trace_buffer;
+}
+
+static void
+trace_record (const char *name, char phase, gint64 ts, gint64 value)
+{
+    auto buffer = trace_get_buffer ();
+    auto next = buffer->next;
+    auto event = &buffer->events[next % QOF_TRACE_BUFFER_SIZE];
+
+    event->name = name;
+    event->ts = ts;
+    event->value = value;
+    event->phase = phase;
+    /* Wraps around after 2^31 events, rather than overflowing. */
+    g_atomic_int_set (&buffer->next,
+                      next + 1 < G_MAXINT ? next + 1 :
+                      QOF_TRACE_BUFFER_SIZE);
+}
+
+void
+qof_trace_set_enabled (gboolean enabled)
+{
+    g_atomic_int_set (&trace_enabled, enabled ? TRUE : FALSE);
+}
+
+gboolean
+qof_trace_enabled (void)
+{
+    return g_atomic_int_get (&trace_enabled);
+}
+
+gint64
+qof_trace_begin (void)
+{
+    if (!g_atomic_int_get (&trace_enabled))
+        return 0;
+    return g_get_monotonic_time ();
+}
+
+void
+qof_trace_end (const char *name, gint64 start)
+{
+    if (!start || !name)
+        return;
+    trace_record (name, 'X', start, g_get_monotonic_time () - start);
+}
+
+void
+qof_trace_counter (const char *name, gint64 value)
+{
+    if (!name || !g_atomic_int_get (&trace_enabled))
+        return;
+    trace_record (name, 'C', g_get_monotonic_time (), value);
+}
+
+static void
+trace_append_json_string (GString *out, const char *str)
+{
+    g_string_append_c (out, '"');
+    for (auto c = str; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            g_string_append_printf (out, "\\%c", *c);
+        else if ((guchar)*c < 0x20)
+            g_string_append_printf (out, "\\u%04x", (guchar)*c);
+        else
+            g_string_append_c (out, *c);
+    }
+    g_string_append_c (out, '"');
+}
+
+gboolean
+qof_trace_write (const char *filename)
+{
+    g_return_val_if_fail (filename, FALSE);
+
+    auto out = g_string_new ("{\"traceEvents\":[");
+    auto first = TRUE;
+
+    G_LOCK (trace_buffers);
+    for (guint i = 0; trace_buffers && i < trace_buffers->len; ++i)
+    {
+        auto buffer = static_cast<QofTraceBuffer*>(g_ptr_array_index (trace_buffers, i));
+        gint next = g_atomic_int_get (&buffer->next);
+        gint count = MIN (next, QOF_TRACE_BUFFER_SIZE);
+
+        for (gint j = next - count; j < next; ++j)
+        {
+            auto event = &buffer->events[j % QOF_TRACE_BUFFER_SIZE];
+
+            g_string_append (out, first ? "\n" : ",\n");
+            first = FALSE;
+            g_string_append (out, "{\"name\":");
+            trace_append_json_string (out, event->name);
+            g_string_append_printf (out, ",\"ph\":\"%c\",\"ts\":%" G_GINT64_FORMAT
+                                    ",\"pid\":1,\"tid\":%d", event->phase,
+                                    event->ts, buffer->tid);
+            if (event->phase == 'X')
+                g_string_append_printf (out, ",\"dur\":%" G_GINT64_FORMAT "}",
+                                        event->value);
+            else
+                g_string_append_printf (out, ",\"args\":{\"value\":%"
+                                        G_GINT64_FORMAT "}}", event->value);
+        }
+    }
+    G_UNLOCK (trace_buffers);
+    g_string_append (out, "\n]}\n");
+
+    auto ok = g_file_set_contents (filename, out->str, out->len, NULL);
+    g_string_free (out, TRUE);
+    return ok;
+}
+
+void
+qof_trace_clear (void)
+{
+    G_LOCK (trace_buffers);
+    for (guint i = 0; trace_buffers && i < trace_buffers->len; ++i)
+    {
+        auto buffer = static_cast<QofTraceBuffer*>(g_ptr_array_index (trace_buffers, i));
+        g_atomic_int_set (&buffer->next, 0);
+    }
+    G_UNLOCK (trace_buffers);
+}
@@ -293,9 +293,88 @@ void qof_log_set_default(QofLogLevel log_level);
   g_return_if_fail(test); \
 } while (0);
 
+/** @name Tracing
+ *
+ * Low-overhead timings and counters for the hot paths -- loading,
+ * commits, queries, price lookups, report runs -- that can be left in
+ * production builds.  Nothing is recorded until tracing is turned on,
+ * and then each thread records into a ring buffer of its own holding
+ * its last QOF_TRACE_BUFFER_SIZE events, so recording takes no lock.
+ * The trace is written in the Chrome trace event format, which
+ * chrome://tracing and Perfetto display.
+ *
+ * Setting the environment variable GNC_TRACE_FILE to a file name turns
+ * tracing on when logging is initialized and writes the trace to the
+ * file at qof_log_shutdown().  Defining QOF_DISABLE_TRACE when building
+ * removes the QOF_TRACE macros.
+ *
+ * The names of events must outlive the trace; use string literals.
+ * @{
+ */
+#define QOF_TRACE_BUFFER_SIZE 16384
+
+/** Turns recording on or off. */
+void qof_trace_set_enabled (gboolean enabled);
+gboolean qof_trace_enabled (void);
+
+/** @return The start time of a timed event, 0 if tracing is off. */
+gint64 qof_trace_begin (void);
+/** Records the event named @a name as lasting from @a start until now. */
+void qof_trace_end (const char *name, gint64 start);
+/** Records the value of the counter named @a name. */
+void qof_trace_counter (const char *name, gint64 value);
+
+/** Writes the events recorded so far as Chrome trace JSON.  The threads
+ *  go on recording meanwhile, so write when they are quiet.
+ *  @return FALSE if the file couldn't be written
+ */
+gboolean qof_trace_write (const char *filename);
+/** Drops the events recorded so far. */
+void qof_trace_clear (void);
+
+#ifndef QOF_DISABLE_TRACE
+/** Declares @a var and starts timing an event in it. */
+#define QOF_TRACE_BEGIN(var) gint64 var = qof_trace_begin ()
+/** Ends the event started with QOF_TRACE_BEGIN(var). */
+#define QOF_TRACE_END(var, name) do { \
+    if (var) qof_trace_end (name, var); \
+} while (0)
+#define QOF_TRACE_COUNTER(name, value) do { \
+    if (qof_trace_enabled ()) qof_trace_counter (name, value); \
+} while (0)
+#else
+#define QOF_TRACE_BEGIN(var)
+#define QOF_TRACE_END(var, name) do { } while (0)
+#define QOF_TRACE_COUNTER(name, value) do { } while (0)
+#endif
+/** @} */
 
 #ifdef __cplusplus
 }
+
+/** Times the enclosing scope as an event named @a name, see
+ *  QOF_TRACE_SCOPE. */
+class QofTraceScope
+{
+public:
+    explicit QofTraceScope (const char *name) noexcept :
+        m_name{name}, m_start{qof_trace_begin ()} {}
+    ~QofTraceScope () { if (m_start) qof_trace_end (m_name, m_start); }
+    QofTraceScope (const QofTraceScope&) = delete;
+    QofTraceScope& operator= (const QofTraceScope&) = delete;
+private:
+    const char *m_name;
+    gint64 m_start;
+};
+
+#ifndef QOF_DISABLE_TRACE
+#define QOF_TRACE_CONCAT_(a, b) a ## b
+#define QOF_TRACE_CONCAT(a, b) QOF_TRACE_CONCAT_(a, b)
+#define QOF_TRACE_SCOPE(name) \
+    QofTraceScope QOF_TRACE_CONCAT(qof_trace_scope_, __LINE__) {name}
+#else
+#define QOF_TRACE_SCOPE(name)
+#endif
 #endif
 
 #endif /* _QOF_LOG_H */
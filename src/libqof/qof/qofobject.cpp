@@ -29,6 +29,8 @@ extern "C"
 #include <glib.h>
 }
 
+#include <deque>
+#include <string>
 #include "qof.h"
 #include "qofobject-p.h"
 
@@ -37,6 +39,10 @@ static QofLogModule log_module = QOF_MOD_OBJECT;
 static gboolean object_is_initialized = FALSE;
 static GList *object_modules = NULL;
 static GList *book_list = NULL;
+/* Indexed by type ID.  It never shrinks, so the IDs that lookups keep
+ * stay good, and a deque doesn't move the names as it grows. */
+static std::deque<std::string> type_ids;
+G_LOCK_DEFINE_STATIC (type_ids);
 
 /*
  * These getters are used in tests to reach static vars from outside
@@ -328,6 +334,7 @@ gboolean qof_object_register (const QofObject *object)
         object_modules = g_list_prepend (object_modules, (gpointer)object);
     else
         return FALSE;
+    qof_object_get_type_id (object->e_type);
 
     /* Now initialize all the known books */
     if (object->book_begin && book_list)
@@ -340,6 +347,34 @@ gboolean qof_object_register (const QofObject *object)
     return TRUE;
 }
 
+gint
+qof_object_get_type_id (QofIdTypeConst type_name)
+{
+    gint type_id;
+
+    if (!type_name) return -1;
+    G_LOCK (type_ids);
+    for (type_id = 0; type_id < static_cast<gint>(type_ids.size()); type_id++)
+        if (type_ids[type_id] == type_name)
+            break;
+    if (type_id == static_cast<gint>(type_ids.size()))
+        type_ids.emplace_back (type_name);
+    G_UNLOCK (type_ids);
+    return type_id;
+}
+
+QofIdTypeConst
+qof_object_get_type_name (gint type_id)
+{
+    QofIdTypeConst type_name = NULL;
+
+    G_LOCK (type_ids);
+    if (type_id >= 0 && type_id < static_cast<gint>(type_ids.size()))
+        type_name = type_ids[type_id].c_str ();
+    G_UNLOCK (type_ids);
+    return type_name;
+}
+
 const QofObject * qof_object_lookup (QofIdTypeConst name)
 {
     GList *iter;
@@ -137,6 +137,18 @@ void qof_object_shutdown (void);
 /** Register new types of object objects */
 gboolean qof_object_register (const QofObject *object);
 
+/** Return the small integer standing for type_name, for
+ * qof_book_get_collection_by_id().  Registering an object gives its type
+ * the next free one, as does asking for a type that hasn't got one yet;
+ * they count up from 0 and stay the same until the program exits, across
+ * qof_object_shutdown().
+ *
+ * @return The ID, or -1 if type_name is NULL. */
+gint qof_object_get_type_id (QofIdTypeConst type_name);
+
+/** The type that qof_object_get_type_id() gave type_id, or NULL. */
+QofIdTypeConst qof_object_get_type_name (gint type_id);
+
 /** Lookup an object definition */
 const QofObject * qof_object_lookup (QofIdTypeConst type_name);
 
@@ -32,6 +32,9 @@ extern "C"
 #include <string.h>
 }
 
+#include <algorithm>
+#include <vector>
+
 #include "qof.h"
 #include "qofbackend-p.h"
 #include "qofbook-p.h"
@@ -73,6 +76,8 @@ struct _QofQuerySort
     QofCompareFunc      comp_fcn;       /* When you are comparing core types */
 };
 
+typedef struct _QofQueryLive QofQueryLive;
+
 /* The QUERY structure */
 struct _QofQuery
 {
@@ -104,6 +109,9 @@ struct _QofQuery
     gint              changed;
 
     GList *           results;
+
+    /* Matches kept up to date from events, if the query is live */
+    QofQueryLive *    live;
 };
 
 typedef struct _QofQueryCB
@@ -111,8 +119,55 @@ typedef struct _QofQueryCB
     QofQuery *        query;
     GList *           list;
     gint              count;
+    GHashTable *      seen;     /* Instances already offered by an index */
+    GArray *          heap;     /* Best max_results matches, if sorting */
 } QofQueryCB;
 
+typedef struct
+{
+    gpointer          object;
+    guint             seq;      /* Order in which the match was found */
+} QofQueryHeapItem;
+
+typedef struct
+{
+    QofIdTypeConst        obj_type;
+    QofQueryParamList *   param_path;
+    QofQueryGuidIndexFunc func;
+    /* For an index of only the instances with one of chars at char_path */
+    QofQueryParamList *   char_path;
+    gchar *               chars;
+} QofQueryGuidIndex;
+
+/* The indexes registered with qof_query_register_guid_index */
+static GSList *guid_indexes = NULL;
+
+typedef struct
+{
+    QofIdTypeConst        obj_type;
+    const char *          param_name;
+    gchar *               book_key;     /* Where books keep their index */
+} QofQueryStringIndex;
+
+/* The indexes registered with qof_query_register_string_index */
+static GSList *string_indexes = NULL;
+
+typedef struct
+{
+    QofIdTypeConst         obj_type;
+    QofIdTypeConst         changed_type;
+    QofQueryDependentsFunc func;
+} QofQueryDependents;
+
+/* The functions registered with qof_query_register_dependents */
+static GSList *query_dependents = NULL;
+
+/* Threads used to check large collections of books with a snapshot. */
+static guint query_thread_count = 1;
+
+/* The fewest instances worth giving a thread of their own. */
+#define QUERY_CHUNK_MIN 1024
+
 /* initial_term will be owned by the new Query */
 static void query_init (QofQuery *q, QofQueryTerm *initial_term)
 {
@@ -276,35 +331,23 @@ static void free_members (QofQuery *q)
     q->results = NULL;
 }
 
-static int cmp_func (const QofQuerySort *sort, QofSortFunc default_sort,
-                     const gconstpointer a, const gconstpointer b)
+/* Whether the sort compares converted objects, rather than using the
+ * default sort or finding everything equal. */
+static gboolean sort_converts (const QofQuerySort *sort)
 {
-    QofParam *param = NULL;
-    GSList *node;
-    gpointer conva, convb;
-
-    g_return_val_if_fail (sort, 0);
-
-    /* See if this is a default sort */
-    if (sort->use_default)
-    {
-        if (default_sort) return default_sort (a, b);
-        return 0;
-    }
-
-    /* If no parameters, consider them equal */
-    if (!sort->param_fcns) return 0;
+    return !sort->use_default && sort->param_fcns &&
+           (sort->comp_fcn || sort->obj_cmp);
+}
 
-    /* no compare function, consider the two objects equal */
-    if (!sort->comp_fcn && !sort->obj_cmp) return 0;
+/* Walk the chain of parameters from obj to what the sort compares */
+static gpointer sort_convert (const QofQuerySort *sort, gpointer obj)
+{
+    GSList *node;
 
-    /* Do the list of conversions */
-    conva = (gpointer)a;
-    convb = (gpointer)b;
     for (node = static_cast<GSList*>(sort->param_fcns); node;
 	 node = static_cast<GSList*>(node->next))
     {
-        param = static_cast<QofParam*>(node->data);
+        QofParam *param = static_cast<QofParam*>(node->data);
 
         /* The last term is really the "parameter getter",
          * unless we're comparing objects ;) */
@@ -312,20 +355,44 @@ static int cmp_func (const QofQuerySort *sort, QofSortFunc default_sort,
             break;
 
         /* Do the converstions */
-        conva = (param->param_getfcn) (conva, param);
-        convb = (param->param_getfcn) (convb, param);
+        obj = (param->param_getfcn) (obj, param);
     }
+    return obj;
+}
 
-    /* And now return the (appropriate) compare */
+/* Compare the results of sort_convert() */
+static int cmp_converted (const QofQuerySort *sort, gpointer conva,
+                          gpointer convb)
+{
     if (sort->comp_fcn)
     {
-        int rc = sort->comp_fcn (conva, convb, sort->options, param);
-        return rc;
+        QofParam *param =
+            static_cast<QofParam*>(g_slist_last (sort->param_fcns)->data);
+        return sort->comp_fcn (conva, convb, sort->options, param);
     }
 
     return sort->obj_cmp (conva, convb);
 }
 
+static int cmp_func (const QofQuerySort *sort, QofSortFunc default_sort,
+                     const gconstpointer a, const gconstpointer b)
+{
+    g_return_val_if_fail (sort, 0);
+
+    /* See if this is a default sort */
+    if (sort->use_default)
+    {
+        if (default_sort) return default_sort (a, b);
+        return 0;
+    }
+
+    /* If no parameters, or no compare function, consider them equal */
+    if (!sort_converts (sort)) return 0;
+
+    return cmp_converted (sort, sort_convert (sort, (gpointer)a),
+                          sort_convert (sort, (gpointer)b));
+}
+
 static int
 sort_func (const gconstpointer a, const gconstpointer b, const gpointer q)
 {
@@ -356,6 +423,79 @@ sort_func (const gconstpointer a, const gconstpointer b, const gpointer q)
     }
 }
 
+/* A match decorated with what each of the query's sorts compares, so
+ * that sorting walks the parameter chains once per match instead of
+ * twice per comparison. */
+struct QofQuerySortItem
+{
+    gpointer object;
+    gpointer conv[3];
+};
+
+static int
+sort_item_level_cmp (const QofQuerySort *sort, QofSortFunc default_sort,
+                     const QofQuerySortItem &a, const QofQuerySortItem &b,
+                     int level)
+{
+    if (sort->use_default)
+        return default_sort ? default_sort (a.object, b.object) : 0;
+    if (!sort_converts (sort))
+        return 0;
+    return cmp_converted (sort, a.conv[level], b.conv[level]);
+}
+
+/* The same order as sort_func() */
+static int
+sort_item_cmp (const QofQuery *q, const QofQuerySortItem &a,
+               const QofQuerySortItem &b)
+{
+    const QofQuerySort *sorts[3] = {&q->primary_sort, &q->secondary_sort,
+                                    &q->tertiary_sort};
+    int level, retval = 0;
+
+    for (level = 0; level < 3; level++)
+    {
+        retval = sort_item_level_cmp (sorts[level], q->defaultSort, a, b,
+                                      level);
+        if (retval != 0 || level == 2)
+            break;
+    }
+    return sorts[level]->increasing ? retval : -retval;
+}
+
+/* Sort the matches like g_list_sort_with_data (list, sort_func, q),
+ * decorating them first; the list nodes are reused. */
+static GList *
+sort_matches (QofQuery *q, GList *list)
+{
+    const QofQuerySort *sorts[3] = {&q->primary_sort, &q->secondary_sort,
+                                    &q->tertiary_sort};
+    std::vector<QofQuerySortItem> items;
+    GList *node;
+    size_t i;
+
+    items.reserve (g_list_length (list));
+    for (node = list; node; node = node->next)
+    {
+        QofQuerySortItem item;
+        int level;
+
+        item.object = node->data;
+        for (level = 0; level < 3; level++)
+            item.conv[level] = sort_converts (sorts[level]) ?
+                               sort_convert (sorts[level], node->data) : NULL;
+        items.push_back (item);
+    }
+
+    std::stable_sort (items.begin (), items.end (),
+                      [q](const QofQuerySortItem &a, const QofQuerySortItem &b)
+                      { return sort_item_cmp (q, a, b) < 0; });
+
+    for (node = list, i = 0; node; node = node->next, i++)
+        node->data = items[i].object;
+    return list;
+}
+
 /* ==================================================================== */
 /* This is the main workhorse for performing the query.  For each
  * object, it walks over all of the query terms to see if the
@@ -567,6 +707,100 @@ static void compile_terms (QofQuery *q)
     LEAVE (" query=%p", q);
 }
 
+/* Order heap items the way the full, stable sort would, so that of equal
+ * matches the later ones are kept just as when cropping a sorted list. */
+static int
+heap_item_cmp (const QofQueryHeapItem *a, const QofQueryHeapItem *b,
+               QofQuery *q)
+{
+    int retval = sort_func (a->object, b->object, q);
+    if (retval) return retval;
+    return a->seq < b->seq ? -1 : a->seq > b->seq ? 1 : 0;
+}
+
+/* Keep the max_results greatest matches in a min-heap, so that when
+ * there are few results wanted from many matches we needn't sort them
+ * all. */
+static void
+heap_add_match (QofQueryCB *ql, gpointer object)
+{
+    QofQuery *q = ql->query;
+    GArray *heap = ql->heap;
+    QofQueryHeapItem item = {object, (guint)ql->count};
+    guint i, child;
+
+    if (heap->len < (guint)q->max_results)
+    {
+        /* Sift up. */
+        g_array_append_val (heap, item);
+        for (i = heap->len - 1; i > 0; i = (i - 1) / 2)
+        {
+            QofQueryHeapItem *parent = &g_array_index (heap, QofQueryHeapItem,
+                                                       (i - 1) / 2);
+            if (heap_item_cmp (parent, &item, q) <= 0)
+                break;
+            g_array_index (heap, QofQueryHeapItem, i) = *parent;
+        }
+        g_array_index (heap, QofQueryHeapItem, i) = item;
+        return;
+    }
+
+    if (heap_item_cmp (&item, &g_array_index (heap, QofQueryHeapItem, 0),
+                       q) <= 0)
+        return;
+    /* Replace the least and sift down. */
+    for (i = 0; (child = 2 * i + 1) < heap->len; i = child)
+    {
+        QofQueryHeapItem *least = &g_array_index (heap, QofQueryHeapItem,
+                                                  child);
+        if (child + 1 < heap->len &&
+            heap_item_cmp (least + 1, least, q) < 0)
+        {
+            ++child;
+            ++least;
+        }
+        if (heap_item_cmp (&item, least, q) <= 0)
+            break;
+        g_array_index (heap, QofQueryHeapItem, i) = *least;
+    }
+    g_array_index (heap, QofQueryHeapItem, i) = item;
+}
+
+static gint
+heap_item_sort_cmp (gconstpointer a, gconstpointer b, gpointer q)
+{
+    return heap_item_cmp (static_cast<const QofQueryHeapItem*>(a),
+                          static_cast<const QofQueryHeapItem*>(b),
+                          static_cast<QofQuery*>(q));
+}
+
+/* Turn the heap into the sorted list of matches. */
+static GList *
+heap_take_matches (QofQueryCB *ql)
+{
+    GArray *heap = ql->heap;
+    GList *list = NULL;
+    guint i;
+
+    g_array_sort_with_data (heap, heap_item_sort_cmp, ql->query);
+    for (i = heap->len; i > 0; --i)
+        list = g_list_prepend (list, g_array_index (heap, QofQueryHeapItem,
+                                                    i - 1).object);
+    g_array_free (heap, TRUE);
+    ql->heap = NULL;
+    return list;
+}
+
+static void
+query_add_match (QofQueryCB *ql, gpointer object)
+{
+    if (ql->heap)
+        heap_add_match (ql, object);
+    else
+        ql->list = g_list_prepend (ql->list, object);
+    ql->count++;
+}
+
 static void check_item_cb (gpointer object, gpointer user_data)
 {
     QofQueryCB* ql = static_cast<QofQueryCB*>(user_data);
@@ -574,10 +808,7 @@ static void check_item_cb (gpointer object, gpointer user_data)
     if (!object || !ql) return;
 
     if (check_object (ql->query, object))
-    {
-        ql->list = g_list_prepend (ql->list, object);
-        ql->count++;
-    }
+        query_add_match (ql, object);
     return;
 }
 
@@ -723,12 +954,20 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
     }
 }
 
+static gboolean
+query_is_sorted (const QofQuery *q)
+{
+    return (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
+            (q->primary_sort.use_default && q->defaultSort));
+}
+
 static GList * qof_query_run_internal (QofQuery *q,
                                        void(*run_cb)(QofQueryCB*, gpointer),
                                        gpointer cb_arg)
 {
     GList *matching_objects = NULL;
     int        object_count = 0;
+    gboolean   sorted;
 
     if (!q) return NULL;
     g_return_val_if_fail (q->search_for, NULL);
@@ -749,34 +988,48 @@ static GList * qof_query_run_internal (QofQuery *q,
     if (qof_log_check (log_module, QOF_LOG_DEBUG))
         qof_query_print (q);
 
+    sorted = query_is_sorted (q);
+
     /* Now run the query over all the objects and save the results */
     {
         QofQueryCB qcb;
 
         memset (&qcb, 0, sizeof (qcb));
         qcb.query = q;
+        /* If only the last few sorted matches are wanted, keep just those
+         * as we go. */
+        if (sorted && q->max_results > 0)
+            qcb.heap = g_array_new (FALSE, FALSE, sizeof (QofQueryHeapItem));
 
         /* Run the query callback */
         run_cb(&qcb, cb_arg);
 
-        matching_objects = qcb.list;
-        object_count = qcb.count;
+        if (qcb.heap)
+        {
+            matching_objects = heap_take_matches (&qcb);
+            object_count = MIN (qcb.count, q->max_results);
+        }
+        else
+        {
+            matching_objects = qcb.list;
+            object_count = qcb.count;
+        }
     }
     PINFO ("matching objects=%p count=%d", matching_objects, object_count);
 
-    /* There is no absolute need to reverse this list, since it's being
-     * sorted below. However, in the common case, we will be searching
-     * in a confined location where the objects are already in order,
-     * thus reversing will put us in the correct order we want and make
-     * the sorting go much faster.
-     */
-    matching_objects = g_list_reverse(matching_objects);
-
-    /* Now sort the matching objects based on the search criteria */
-    if (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
-            (q->primary_sort.use_default && q->defaultSort))
+    if (!sorted || q->max_results <= 0)
     {
-        matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
+        /* There is no absolute need to reverse this list, since it's being
+         * sorted below. However, in the common case, we will be searching
+         * in a confined location where the objects are already in order,
+         * thus reversing will put us in the correct order we want and make
+         * the sorting go much faster.
+         */
+        matching_objects = g_list_reverse(matching_objects);
+
+        /* Now sort the matching objects based on the search criteria */
+        if (sorted)
+            matching_objects = sort_matches (q, matching_objects);
     }
 
     /* Crop the list to limit the number of splits. */
@@ -815,6 +1068,611 @@ static GList * qof_query_run_internal (QofQuery *q,
     return matching_objects;
 }
 
+/* String indexes
+
+   A string index maps each value of a string parameter to the instances
+   of a book having it. It is built the first time a query can use it and
+   then kept up to date from the instances' events. Events are lost while
+   they are suspended, as they are during a load, and the index is built
+   again when its size no longer agrees with the collection's; while a
+   batch holds the events back it isn't used at all.
+ */
+
+typedef struct
+{
+    const QofQueryStringIndex * index;
+    QofBook *             book;
+    const QofParam *      param;
+    gint                  handler_id;
+    GHashTable *          keys;         /* Value to a GPtrArray of instances */
+    GHashTable *          instances;    /* Instance to its value in keys */
+} QofQueryStringIndexData;
+
+static const char *
+string_index_value (const QofQueryStringIndexData *data, gpointer inst)
+{
+    auto value = static_cast<const char*>(data->param->param_getfcn (inst,
+                                          data->param));
+    return value ? value : "";
+}
+
+static void
+string_index_add (QofQueryStringIndexData *data, gpointer inst)
+{
+    const char *value = string_index_value (data, inst);
+    gpointer key, insts;
+
+    if (!g_hash_table_lookup_extended (data->keys, value, &key, &insts))
+    {
+        key = g_strdup (value);
+        insts = g_ptr_array_new ();
+        g_hash_table_insert (data->keys, key, insts);
+    }
+    g_ptr_array_add (static_cast<GPtrArray*>(insts), inst);
+    g_hash_table_insert (data->instances, inst, key);
+}
+
+static void
+string_index_remove (QofQueryStringIndexData *data, gpointer inst)
+{
+    gpointer key = g_hash_table_lookup (data->instances, inst);
+    GPtrArray *insts;
+
+    if (!key) return;
+    g_hash_table_remove (data->instances, inst);
+    insts = static_cast<GPtrArray*>(g_hash_table_lookup (data->keys, key));
+    g_ptr_array_remove_fast (insts, inst);
+    if (insts->len == 0)
+        g_hash_table_remove (data->keys, key);
+}
+
+static void
+string_index_event_handler (QofInstance *ent, QofEventId event_type,
+                            gpointer user_data, gpointer event_data)
+{
+    auto data = static_cast<QofQueryStringIndexData*>(user_data);
+    const char *key;
+
+    if (qof_instance_get_book (ent) != data->book)
+        return;
+    if (event_type & QOF_EVENT_DESTROY)
+    {
+        string_index_remove (data, ent);
+        return;
+    }
+    key = static_cast<const char*>(g_hash_table_lookup (data->instances, ent));
+    if (key && !g_strcmp0 (key, string_index_value (data, ent)))
+        return;
+    string_index_remove (data, ent);
+    string_index_add (data, ent);
+}
+
+static void
+string_index_add_cb (QofInstance *inst, gpointer user_data)
+{
+    string_index_add (static_cast<QofQueryStringIndexData*>(user_data), inst);
+}
+
+static void
+string_index_data_free (QofBook *book, gpointer key, gpointer user_data)
+{
+    auto data = static_cast<QofQueryStringIndexData*>(user_data);
+
+    qof_event_unregister_handler (data->handler_id);
+    g_hash_table_destroy (data->instances);
+    g_hash_table_destroy (data->keys);
+    g_free (data);
+}
+
+static void
+string_index_array_free (gpointer data)
+{
+    g_ptr_array_free (static_cast<GPtrArray*>(data), TRUE);
+}
+
+/* The index of book, up to date, or NULL if it can't be used now. */
+static QofQueryStringIndexData *
+string_index_get (const QofQueryStringIndex *index, QofBook *book)
+{
+    QofCollection *col = qof_book_get_collection (book, index->obj_type);
+    QofQueryStringIndexData *data;
+
+    if (qof_event_is_batching ())
+        return NULL;
+    data = static_cast<QofQueryStringIndexData*>(qof_book_get_data (book,
+                                                 index->book_key));
+    if (!data)
+    {
+        const QofParam *param = qof_class_get_parameter (index->obj_type,
+                                                         index->param_name);
+        if (!param || g_strcmp0 (param->param_type, QOF_TYPE_STRING))
+            return NULL;
+        data = g_new0 (QofQueryStringIndexData, 1);
+        data->index = index;
+        data->book = book;
+        data->param = param;
+        data->keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                            string_index_array_free);
+        data->instances = g_hash_table_new (NULL, NULL);
+        data->handler_id = qof_event_register_typed_handler
+            (index->obj_type, static_cast<QofEventId>(QOF_EVENT_CREATE |
+                    QOF_EVENT_MODIFY | QOF_EVENT_ADD | QOF_EVENT_DESTROY),
+             string_index_event_handler, data);
+        qof_book_set_data_fin (book, index->book_key, data,
+                               string_index_data_free);
+    }
+    if (g_hash_table_size (data->instances) != qof_collection_count (col))
+    {
+        PINFO ("building the %s index of %s", index->param_name,
+               index->obj_type);
+        g_hash_table_remove_all (data->instances);
+        g_hash_table_remove_all (data->keys);
+        qof_collection_foreach_unordered (col, string_index_add_cb, data);
+    }
+    return data;
+}
+
+static const QofQueryStringIndex *
+string_index_find (QofIdTypeConst obj_type, const char *param_name)
+{
+    for (GSList *node = string_indexes; node; node = node->next)
+    {
+        auto index = static_cast<QofQueryStringIndex*>(node->data);
+        if (!g_strcmp0 (index->obj_type, obj_type) &&
+            !g_strcmp0 (index->param_name, param_name))
+            return index;
+    }
+    return NULL;
+}
+
+void
+qof_query_register_string_index (QofIdTypeConst obj_type,
+                                 const char *param_name)
+{
+    QofQueryStringIndex *index;
+
+    g_return_if_fail (obj_type && param_name);
+    if (string_index_find (obj_type, param_name))
+        return;
+    index = g_new (QofQueryStringIndex, 1);
+    index->obj_type = obj_type;
+    index->param_name = param_name;
+    index->book_key = g_strdup_printf ("qof-query-string-index:%s:%s",
+                                       obj_type, param_name);
+    string_indexes = g_slist_prepend (string_indexes, index);
+}
+
+static void
+query_string_index_free (gpointer data)
+{
+    QofQueryStringIndex *index = static_cast<QofQueryStringIndex*>(data);
+    g_free (index->book_key);
+    g_free (index);
+}
+
+/* Index planning
+
+   For each OR-clause query_index_find looks for a term that restricts the
+   instances it can match to those found through an index: either the
+   collection itself, for terms on QOF_PARAM_GUID, or a GUID index
+   registered for the term's parameter path, or a string index for an
+   exact match on a string parameter, of the instances themselves or of
+   the objects they depend on. If every clause has one, the instances the
+   indexes return are the only ones that need checking.
+ */
+
+typedef struct
+{
+    const QofQueryTerm *      term;
+    const QofQueryGuidIndex * index;    /* NULL to use the collection */
+    QofQueryStringIndexData * strings;  /* Set for a string term */
+    QofQueryDependentsFunc    via;      /* Their dependents are the matches */
+} QofQueryIndexStep;
+
+static gboolean
+query_term_is_guid_match (const QofQueryTerm *qt)
+{
+    const query_guid_def *pdata = (const query_guid_def*)qt->pdata;
+
+    if (qt->invert || !qt->param_fcns || !qt->pred_fcn)
+        return FALSE;
+    if (g_strcmp0 (qt->pdata->type_name, QOF_TYPE_GUID))
+        return FALSE;
+    return pdata->options == QOF_GUID_MATCH_ANY;
+}
+
+/* Only exact matches: a case-insensitive one compares by collation,
+ * which a hash of the values can't follow. */
+static gboolean
+query_term_is_string_match (const QofQueryTerm *qt)
+{
+    const query_string_def *pdata = (const query_string_def*)qt->pdata;
+
+    if (qt->invert || !qt->param_fcns || !qt->pred_fcn)
+        return FALSE;
+    if (g_strcmp0 (qt->pdata->type_name, QOF_TYPE_STRING))
+        return FALSE;
+    return qt->pdata->how == QOF_COMPARE_EQUAL && !pdata->is_regex &&
+        pdata->options == QOF_STRING_MATCH_NORMAL;
+}
+
+static gboolean
+query_string_index_find (const QofQuery *q, QofBook *book,
+                         const QofQueryParamList *path,
+                         QofQueryIndexStep *step)
+{
+    const QofQueryStringIndex *index;
+    QofIdTypeConst type = q->search_for;
+
+    step->via = NULL;
+    if (path && path->next && !path->next->next)
+    {
+        const QofParam *param = qof_class_get_parameter (type,
+                                  static_cast<char*>(path->data));
+        if (!param)
+            return FALSE;
+        type = param->param_type;
+        for (GSList *node = query_dependents; node; node = node->next)
+        {
+            auto deps = static_cast<QofQueryDependents*>(node->data);
+            if (!g_strcmp0 (deps->obj_type, q->search_for) &&
+                !g_strcmp0 (deps->changed_type, type))
+                step->via = deps->func;
+        }
+        if (!step->via)
+            return FALSE;
+        path = path->next;
+    }
+    if (!path || path->next)
+        return FALSE;
+    index = string_index_find (type, static_cast<char*>(path->data));
+    if (!index)
+        return FALSE;
+    step->strings = string_index_get (index, book);
+    return step->strings != NULL;
+}
+
+/* Whether clause only lets through instances with one of index's chars. */
+static gboolean
+query_clause_limits_chars (const GList *clause, const QofQueryGuidIndex *index)
+{
+    for (const GList *node = clause; node; node = node->next)
+    {
+        const QofQueryTerm *qt = static_cast<QofQueryTerm*>(node->data);
+        const query_char_def *pdata = (const query_char_def*)qt->pdata;
+        const char *c;
+
+        if (qt->invert || !qt->param_fcns || !qt->pred_fcn ||
+            g_strcmp0 (qt->pdata->type_name, QOF_TYPE_CHAR) ||
+            pdata->options != QOF_CHAR_MATCH_ANY ||
+            param_list_cmp (qt->param_list, index->char_path))
+            continue;
+        for (c = pdata->char_list; *c; ++c)
+            if (!strchr (index->chars, *c))
+                break;
+        if (!*c)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+query_index_find (const QofQuery *q, QofBook *book, const GList *clause,
+                  QofQueryIndexStep *step)
+{
+    const GList *node;
+
+    for (node = clause; node; node = node->next)
+    {
+        const QofQueryTerm *qt = static_cast<QofQueryTerm*>(node->data);
+        const QofQueryParamList *path = qt->param_list;
+        GSList *inode;
+
+        step->term = qt;
+        step->index = NULL;
+        step->strings = NULL;
+        if (query_term_is_string_match (qt))
+        {
+            if (query_string_index_find (q, book, path, step))
+                return TRUE;
+            continue;
+        }
+        if (!query_term_is_guid_match (qt))
+            continue;
+        if (path && !path->next &&
+            !g_strcmp0 (static_cast<char*>(path->data), QOF_PARAM_GUID))
+            return TRUE;
+        /* A smaller index the rest of the clause allows beats the whole */
+        for (inode = guid_indexes; inode; inode = inode->next)
+        {
+            auto index = static_cast<QofQueryGuidIndex*>(inode->data);
+            if (g_strcmp0 (index->obj_type, q->search_for) ||
+                param_list_cmp (index->param_path, path))
+                continue;
+            if (!index->char_path)
+            {
+                if (!step->index)
+                    step->index = index;
+            }
+            else if (query_clause_limits_chars (clause, index))
+            {
+                step->index = index;
+                break;
+            }
+        }
+        if (step->index)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void check_unseen_item_cb (gpointer object, gpointer user_data)
+{
+    QofQueryCB* ql = static_cast<QofQueryCB*>(user_data);
+
+    if (!object || g_hash_table_lookup (ql->seen, object)) return;
+    g_hash_table_insert (ql->seen, object, object);
+    check_item_cb (object, user_data);
+}
+
+static void
+query_run_string_step (const QofQueryIndexStep *step, QofInstanceForeachCB cb,
+                       QofQueryCB *qcb)
+{
+    const char *value = ((query_string_t)step->term->pdata)->matchstring;
+    auto insts = static_cast<GPtrArray*>(g_hash_table_lookup
+                                         (step->strings->keys,
+                                          value ? value : ""));
+    guint i;
+
+    if (!insts) return;
+    for (i = 0; i < insts->len; ++i)
+    {
+        auto inst = static_cast<QofInstance*>(g_ptr_array_index (insts, i));
+        if (step->via)
+            step->via (inst, cb, qcb);
+        else
+            cb (inst, qcb);
+    }
+}
+
+/* Run the query over the instances of book found through the indexes.
+ * Returns FALSE, having done nothing, if some clause can't use one. */
+static gboolean
+query_run_indexed (QofQueryCB *qcb, QofBook *book)
+{
+    QofQuery *q = qcb->query;
+    guint nclauses = g_list_length (q->terms);
+    QofQueryIndexStep *plan;
+    QofInstanceForeachCB cb;
+    gboolean single;
+    GList *or_ptr;
+    guint i;
+
+    if (nclauses == 0) return FALSE;
+    plan = g_new (QofQueryIndexStep, nclauses);
+    single = (nclauses == 1);
+    for (or_ptr = q->terms, i = 0; or_ptr; or_ptr = or_ptr->next, ++i)
+    {
+        if (!query_index_find (q, book, static_cast<GList*>(or_ptr->data),
+                               &plan[i]))
+        {
+            g_free (plan);
+            return FALSE;
+        }
+        if (!plan[i].strings &&
+            g_list_length (((query_guid_t)plan[i].term->pdata)->guids) > 1)
+            single = FALSE;
+    }
+
+    /* The same instance can come from several GUIDs or clauses. */
+    if (!single)
+        qcb->seen = g_hash_table_new (NULL, NULL);
+    cb = (QofInstanceForeachCB)(single ? check_item_cb : check_unseen_item_cb);
+    for (i = 0; i < nclauses; ++i)
+    {
+        GList *node;
+        QofCollection *col;
+
+        if (plan[i].strings)
+        {
+            query_run_string_step (&plan[i], cb, qcb);
+            continue;
+        }
+        node = ((query_guid_t)plan[i].term->pdata)->guids;
+        col = plan[i].index ? NULL :
+            qof_book_get_collection (book, q->search_for);
+        for (; node; node = node->next)
+        {
+            const GncGUID *guid = static_cast<GncGUID*>(node->data);
+            if (plan[i].index)
+                plan[i].index->func (book, guid, cb, qcb);
+            else
+                cb (qof_collection_lookup_entity (col, guid), qcb);
+        }
+    }
+    if (qcb->seen)
+        g_hash_table_destroy (qcb->seen);
+    qcb->seen = NULL;
+    g_free (plan);
+    return TRUE;
+}
+
+void
+qof_query_register_guid_index (QofIdTypeConst obj_type,
+                               QofQueryParamList *param_path,
+                               QofQueryGuidIndexFunc func)
+{
+    QofQueryGuidIndex *index;
+
+    g_return_if_fail (obj_type && param_path && func);
+    index = g_new (QofQueryGuidIndex, 1);
+    index->obj_type = obj_type;
+    index->param_path = param_path;
+    index->func = func;
+    index->char_path = NULL;
+    index->chars = NULL;
+    guid_indexes = g_slist_prepend (guid_indexes, index);
+}
+
+void
+qof_query_register_guid_char_index (QofIdTypeConst obj_type,
+                                    QofQueryParamList *param_path,
+                                    QofQueryParamList *char_path,
+                                    const char *chars,
+                                    QofQueryGuidIndexFunc func)
+{
+    QofQueryGuidIndex *index;
+
+    g_return_if_fail (obj_type && param_path && char_path && chars && func);
+    index = g_new (QofQueryGuidIndex, 1);
+    index->obj_type = obj_type;
+    index->param_path = param_path;
+    index->func = func;
+    index->char_path = char_path;
+    index->chars = g_strdup (chars);
+    guid_indexes = g_slist_prepend (guid_indexes, index);
+}
+
+static void
+query_guid_index_free (gpointer data)
+{
+    QofQueryGuidIndex *index = static_cast<QofQueryGuidIndex*>(data);
+    g_slist_free (index->param_path);
+    g_slist_free (index->char_path);
+    g_free (index->chars);
+    g_free (index);
+}
+
+/* Parallel scans
+
+   check_object doesn't change the compiled query, but the parameter
+   getters it calls may fill in the instances' lazy caches, such as the
+   account balances and the transaction imbalances.  Those caches are
+   updated under qof_book_cache_lock(), which only locks once snapshots
+   are enabled, and only a held snapshot keeps the writer from editing the
+   instances during the scan.  So a large collection is only split among
+   threads while someone holds a snapshot of its book.  Each thread records
+   which instances of its chunk matched and the matches are then collected
+   in collection order, just as a serial scan would have found them.
+ */
+
+typedef struct
+{
+    const QofQuery *  query;
+    gpointer *        objects;
+    guint8 *          matched;
+    guint             count;
+} QofQueryChunk;
+
+static gpointer
+check_chunk (gpointer data)
+{
+    QofQueryChunk *chunk = static_cast<QofQueryChunk*>(data);
+    guint i;
+
+    for (i = 0; i < chunk->count; ++i)
+        chunk->matched[i] = check_object (chunk->query, chunk->objects[i]);
+    return NULL;
+}
+
+static void
+query_collect_cb (QofInstance *inst, gpointer user_data)
+{
+    g_ptr_array_add (static_cast<GPtrArray*>(user_data), inst);
+}
+
+static void
+query_run_scan (QofQueryCB *qcb, QofBook *book)
+{
+    QofQuery *q = qcb->query;
+    guint nthreads = qof_query_get_thread_count ();
+    GPtrArray *objects;
+    QofQueryChunk *chunks;
+    GThread **threads;
+    guint8 *matched;
+    guint i, size;
+
+#ifndef HAVE_GLIB_2_32
+    if (!g_thread_supported ())
+        nthreads = 1;
+#endif
+    if (nthreads < 2 || !qof_book_snapshot_held (book))
+    {
+        qof_object_foreach (q->search_for, book,
+                            (QofInstanceForeachCB) check_item_cb, qcb);
+        return;
+    }
+
+    objects = g_ptr_array_new ();
+    qof_object_foreach (q->search_for, book, query_collect_cb, objects);
+    nthreads = MIN (nthreads, objects->len / QUERY_CHUNK_MIN);
+    if (nthreads < 2)
+    {
+        for (i = 0; i < objects->len; ++i)
+            check_item_cb (g_ptr_array_index (objects, i), qcb);
+        g_ptr_array_free (objects, TRUE);
+        return;
+    }
+
+    matched = g_new0 (guint8, objects->len);
+    chunks = g_new (QofQueryChunk, nthreads);
+    threads = g_new0 (GThread*, nthreads);
+    size = (objects->len + nthreads - 1) / nthreads;
+    for (i = 0; i < nthreads; ++i)
+    {
+        guint start = i * size;
+        chunks[i].query = q;
+        chunks[i].objects = objects->pdata + start;
+        chunks[i].matched = matched + start;
+        chunks[i].count = MIN (size, objects->len - start);
+    }
+    /* The first chunk is ours; a chunk whose thread can't be started is
+     * checked here too. */
+    for (i = 1; i < nthreads; ++i)
+#ifdef HAVE_GLIB_2_32
+        threads[i] = g_thread_try_new ("qof-query", check_chunk, &chunks[i],
+                                       NULL);
+#else
+        threads[i] = g_thread_create (check_chunk, &chunks[i], TRUE, NULL);
+#endif
+    check_chunk (&chunks[0]);
+    for (i = 1; i < nthreads; ++i)
+    {
+        if (threads[i])
+            g_thread_join (threads[i]);
+        else
+            check_chunk (&chunks[i]);
+    }
+
+    for (i = 0; i < objects->len; ++i)
+        if (matched[i])
+            query_add_match (qcb, g_ptr_array_index (objects, i));
+
+    g_free (threads);
+    g_free (chunks);
+    g_free (matched);
+    g_ptr_array_free (objects, TRUE);
+}
+
+void
+qof_query_set_thread_count (guint count)
+{
+    if (!count)
+#ifdef HAVE_GLIB_2_36
+        count = g_get_num_processors ();
+#else
+        count = 1;
+#endif
+    query_thread_count = count;
+}
+
+guint
+qof_query_get_thread_count (void)
+{
+    return query_thread_count;
+}
+
 static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
 {
     GList *node;
@@ -840,14 +1698,420 @@ static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
             }
         }
 #endif
-        /* And then iterate over all the objects */
-        qof_object_foreach (qcb->query->search_for, book,
-                            (QofInstanceForeachCB) check_item_cb, qcb);
+        /* And then iterate over all the objects, or just those in the
+         * indexes if we can */
+        if (!query_run_indexed (qcb, book))
+            query_run_scan (qcb, book);
+    }
+}
+
+/* Live queries
+
+   A live query keeps all of its matches, sorted, in live->matches and
+   watches the events for its books. When an instance of the searched-for
+   type changes it is checked again and moved, added or dropped; when an
+   instance of another type that the terms or sorts read through changes,
+   the instances depending on it, as found by a function registered with
+   qof_query_register_dependents, are checked instead. A change to a type
+   read through with no such function, or to the query itself, means the
+   matches have to be found again by a full run.
+ */
+
+typedef struct
+{
+    QofIdTypeConst         type;
+    QofQueryDependentsFunc func;        /* NULL to run the query again */
+} QofQueryLiveDep;
+
+struct _QofQueryLive
+{
+    gint                handler_id;
+    gboolean            valid;          /* matches reflects the books */
+    gboolean            dirty;          /* q->results is out of date */
+    gboolean            reset;          /* changes since the last take are lost */
+    GSequence *         matches;
+    GHashTable *        iters;          /* Instance to its GSequenceIter */
+    GSList *            deps;           /* QofQueryLiveDep for other types read */
+    GHashTable *        added;
+    GHashTable *        changed;
+    GHashTable *        removed;
+};
+
+void
+qof_query_register_dependents (QofIdTypeConst obj_type,
+                               QofIdTypeConst changed_type,
+                               QofQueryDependentsFunc func)
+{
+    QofQueryDependents *deps;
+
+    g_return_if_fail (obj_type && changed_type && func);
+    deps = g_new (QofQueryDependents, 1);
+    deps->obj_type = obj_type;
+    deps->changed_type = changed_type;
+    deps->func = func;
+    query_dependents = g_slist_prepend (query_dependents, deps);
+}
+
+static gint
+live_cmp (gconstpointer a, gconstpointer b, gpointer q)
+{
+    return sort_func (a, b, q);
+}
+
+/* Note that changes to instances of type can change what q matches. */
+static void
+live_add_dep (QofQuery *q, QofIdTypeConst type)
+{
+    QofQueryLive *live = q->live;
+    QofQueryLiveDep *dep;
+    GSList *node;
+
+    for (node = live->deps; node; node = node->next)
+        if (!g_strcmp0 (static_cast<QofQueryLiveDep*>(node->data)->type, type))
+            return;
+
+    dep = g_new0 (QofQueryLiveDep, 1);
+    dep->type = type;
+    for (node = query_dependents; node; node = node->next)
+    {
+        auto deps = static_cast<QofQueryDependents*>(node->data);
+        if (!g_strcmp0 (deps->obj_type, q->search_for) &&
+            !g_strcmp0 (deps->changed_type, type))
+        {
+            dep->func = deps->func;
+            break;
+        }
+    }
+    live->deps = g_slist_prepend (live->deps, dep);
+}
+
+/* Find the types of the other instances read along a parameter path. Only
+ * an instance's GUID never changes, so a path ending in it doesn't depend
+ * on the instance. */
+static void
+live_add_path_deps (QofQuery *q, const QofQueryParamList *path)
+{
+    QofIdTypeConst type = q->search_for;
+    gboolean other = FALSE;
+
+    for (; path; path = path->next, other = TRUE)
+    {
+        const char *name = static_cast<const char*>(path->data);
+        const QofParam *param;
+
+        if (other)
+        {
+            if (!path->next && !g_strcmp0 (name, QOF_PARAM_GUID))
+                return;
+            live_add_dep (q, type);
+        }
+        param = qof_class_get_parameter (type, name);
+        if (!param)
+            return;
+        type = param->param_type;
+        if (!qof_class_is_registered (type))
+            return;
+    }
+    /* The path ends with an instance, which a sort compares. */
+    if (other)
+        live_add_dep (q, type);
+}
+
+static void
+live_find_deps (QofQuery *q)
+{
+    GList *or_ptr, *and_ptr;
+
+    g_slist_free_full (q->live->deps, g_free);
+    q->live->deps = NULL;
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+        for (and_ptr = static_cast<GList*>(or_ptr->data); and_ptr;
+             and_ptr = and_ptr->next)
+            live_add_path_deps (q, static_cast<QofQueryTerm*>(and_ptr->data)->param_list);
+    live_add_path_deps (q, q->primary_sort.param_list);
+    live_add_path_deps (q, q->secondary_sort.param_list);
+    live_add_path_deps (q, q->tertiary_sort.param_list);
+
+    /* There's no telling what the default sort reads, but the types with
+     * dependents are the likely ones. */
+    if (q->primary_sort.use_default || q->secondary_sort.use_default ||
+        q->tertiary_sort.use_default)
+    {
+        GSList *node;
+        for (node = query_dependents; node; node = node->next)
+        {
+            auto deps = static_cast<QofQueryDependents*>(node->data);
+            if (!g_strcmp0 (deps->obj_type, q->search_for))
+                live_add_dep (q, deps->changed_type);
+        }
+    }
+}
+
+static void
+live_forget (QofQueryLive *live)
+{
+    g_hash_table_remove_all (live->iters);
+    g_hash_table_remove_all (live->added);
+    g_hash_table_remove_all (live->changed);
+    g_hash_table_remove_all (live->removed);
+    g_sequence_remove_range (g_sequence_get_begin_iter (live->matches),
+                             g_sequence_get_end_iter (live->matches));
+    live->valid = FALSE;
+    live->reset = TRUE;
+}
+
+static void
+live_rebuild (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+    QofQueryCB qcb;
+    GList *node;
+
+    live_forget (live);
+    if (q->changed)
+    {
+        query_clear_compiles (q);
+        compile_terms (q);
+        q->changed = 0;
+    }
+    live_find_deps (q);
+
+    memset (&qcb, 0, sizeof (qcb));
+    qcb.query = q;
+    qof_query_run_cb (&qcb, NULL);
+    qcb.list = g_list_reverse (qcb.list);
+    for (node = qcb.list; node; node = node->next)
+        g_sequence_append (live->matches, node->data);
+    g_list_free (qcb.list);
+    if (query_is_sorted (q))
+        g_sequence_sort (live->matches, live_cmp, q);
+    for (GSequenceIter *iter = g_sequence_get_begin_iter (live->matches);
+         !g_sequence_iter_is_end (iter); iter = g_sequence_iter_next (iter))
+        g_hash_table_insert (live->iters, g_sequence_get (iter), iter);
+
+    live->valid = TRUE;
+    live->dirty = TRUE;
+}
+
+static void
+live_collect_cb (QofInstance *inst, gpointer user_data)
+{
+    g_ptr_array_add (static_cast<GPtrArray*>(user_data), inst);
+}
+
+/* Check the affected instances again. They all come out of the sequence
+ * before any goes back, since the sort keys of several may have changed
+ * together. */
+static void
+live_recheck (QofQuery *q, GPtrArray *affected, gboolean destroyed)
+{
+    QofQueryLive *live = q->live;
+    gboolean sorted = query_is_sorted (q);
+    guint8 *was = g_new0 (guint8, affected->len);
+    guint i;
+
+    for (i = 0; i < affected->len; ++i)
+    {
+        gpointer inst = g_ptr_array_index (affected, i);
+        auto iter = static_cast<GSequenceIter*>(g_hash_table_lookup (live->iters, inst));
+        if (!iter) continue;
+        g_sequence_remove (iter);
+        g_hash_table_remove (live->iters, inst);
+        was[i] = TRUE;
+    }
+
+    for (i = 0; i < affected->len; ++i)
+    {
+        gpointer inst = g_ptr_array_index (affected, i);
+        gboolean now = !destroyed &&
+            !qof_instance_get_destroying (QOF_INSTANCE (inst)) &&
+            check_object (q, inst);
+
+        if (now)
+        {
+            GSequenceIter *iter = sorted ?
+                g_sequence_insert_sorted (live->matches, inst, live_cmp, q) :
+                g_sequence_append (live->matches, inst);
+            g_hash_table_insert (live->iters, inst, iter);
+        }
+        if (was[i] && now)
+        {
+            if (!g_hash_table_lookup (live->added, inst))
+                g_hash_table_insert (live->changed, inst, inst);
+        }
+        else if (now)
+        {
+            if (g_hash_table_remove (live->removed, inst))
+                g_hash_table_insert (live->changed, inst, inst);
+            else
+                g_hash_table_insert (live->added, inst, inst);
+        }
+        else if (was[i])
+        {
+            g_hash_table_remove (live->changed, inst);
+            if (!g_hash_table_remove (live->added, inst))
+                g_hash_table_insert (live->removed, inst, inst);
+        }
+        if (was[i] || now)
+            live->dirty = TRUE;
+    }
+    g_free (was);
+}
+
+static void
+live_event_handler (QofInstance *ent, QofEventId event_type,
+                    gpointer handler_data, gpointer event_data)
+{
+    QofQuery *q = static_cast<QofQuery*>(handler_data);
+    QofQueryLive *live = q->live;
+    GPtrArray *affected;
+    GSList *node;
+
+    if (!live->valid || !ent) return;
+    if (!(event_type & (QOF_EVENT_CREATE | QOF_EVENT_MODIFY |
+                        QOF_EVENT_DESTROY | QOF_EVENT_ADD |
+                        QOF_EVENT_REMOVE)))
+        return;
+    if (!g_list_find (q->books, qof_instance_get_book (ent)))
+        return;
+
+    if (!g_strcmp0 (ent->e_type, q->search_for))
+    {
+        affected = g_ptr_array_sized_new (1);
+        g_ptr_array_add (affected, ent);
+        live_recheck (q, affected, event_type == QOF_EVENT_DESTROY);
+        g_ptr_array_free (affected, TRUE);
+        return;
+    }
+
+    for (node = live->deps; node; node = node->next)
+    {
+        auto dep = static_cast<QofQueryLiveDep*>(node->data);
+        if (g_strcmp0 (dep->type, ent->e_type))
+            continue;
+        if (!dep->func)
+        {
+            live_forget (live);
+            return;
+        }
+        /* The dependents get their own events when they go. */
+        if (event_type == QOF_EVENT_DESTROY)
+            return;
+        affected = g_ptr_array_new ();
+        dep->func (ent, live_collect_cb, affected);
+        live_recheck (q, affected, FALSE);
+        g_ptr_array_free (affected, TRUE);
+        return;
+    }
+}
+
+static GList *
+live_run (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+    GSequenceIter *iter = NULL;
+    GList *list = NULL;
+    gint count;
+
+    g_return_val_if_fail (q->search_for, NULL);
+    g_return_val_if_fail (q->books, NULL);
+    ENTER (" q=%p", q);
+
+    if (!live->valid || q->changed)
+        live_rebuild (q);
+    if (!live->dirty)
+    {
+        LEAVE (" q=%p unchanged", q);
+        return q->results;
+    }
+
+    /* As for a full run, keep the last max_results matches. */
+    count = g_sequence_get_length (live->matches);
+    if (q->max_results > -1)
+        count = MIN (count, q->max_results);
+    if (count > 0)
+        iter = g_sequence_get_end_iter (live->matches);
+    for (; count > 0; --count)
+    {
+        iter = g_sequence_iter_prev (iter);
+        list = g_list_prepend (list, g_sequence_get (iter));
+    }
+
+    g_list_free (q->results);
+    q->results = list;
+    live->dirty = FALSE;
+    LEAVE (" q=%p", q);
+    return list;
+}
+
+static void
+live_free (QofQueryLive *live)
+{
+    qof_event_unregister_handler (live->handler_id);
+    g_sequence_free (live->matches);
+    g_hash_table_destroy (live->iters);
+    g_hash_table_destroy (live->added);
+    g_hash_table_destroy (live->changed);
+    g_hash_table_destroy (live->removed);
+    g_slist_free_full (live->deps, g_free);
+    g_free (live);
+}
+
+void
+qof_query_set_live (QofQuery *q, gboolean live)
+{
+    if (!q || live == (q->live != NULL)) return;
+
+    if (!live)
+    {
+        live_free (q->live);
+        q->live = NULL;
+        return;
+    }
+
+    q->live = g_new0 (QofQueryLive, 1);
+    q->live->matches = g_sequence_new (NULL);
+    q->live->iters = g_hash_table_new (NULL, NULL);
+    q->live->added = g_hash_table_new (NULL, NULL);
+    q->live->changed = g_hash_table_new (NULL, NULL);
+    q->live->removed = g_hash_table_new (NULL, NULL);
+    q->live->reset = TRUE;
+    q->live->handler_id = qof_event_register_handler (live_event_handler, q);
+}
+
+gboolean
+qof_query_take_changes (QofQuery *q, GList **added, GList **changed,
+                        GList **removed)
+{
+    QofQueryLive *live;
+    gboolean complete;
+
+    if (added) *added = NULL;
+    if (changed) *changed = NULL;
+    if (removed) *removed = NULL;
+    if (!q || !q->live) return FALSE;
+
+    live = q->live;
+    complete = live->valid && !live->reset;
+    if (complete)
+    {
+        if (added) *added = g_hash_table_get_keys (live->added);
+        if (changed) *changed = g_hash_table_get_keys (live->changed);
+        if (removed) *removed = g_hash_table_get_keys (live->removed);
     }
+    g_hash_table_remove_all (live->added);
+    g_hash_table_remove_all (live->changed);
+    g_hash_table_remove_all (live->removed);
+    if (live->valid)
+        live->reset = FALSE;
+    return complete;
 }
 
 GList * qof_query_run (QofQuery *q)
 {
+    QOF_TRACE_SCOPE ("qof_query_run");
+    if (q && q->live)
+        return live_run (q);
     /* Just a wrapper */
     return qof_query_run_internal(q, qof_query_run_cb, NULL);
 }
@@ -993,6 +2257,7 @@ GSList * qof_query_get_term_type (QofQuery *q, QofQueryParamList *term_param)
 void qof_query_destroy (QofQuery *q)
 {
     if (!q) return;
+    qof_query_set_live (q, FALSE);
     free_members (q);
     query_clear_compiles (q);
     g_hash_table_destroy (q->be_compiled);
@@ -1015,6 +2280,7 @@ QofQuery * qof_query_copy (QofQuery *q)
     copy->terms = copy_or_terms (q->terms);
     copy->books = g_list_copy (q->books);
     copy->results = g_list_copy (q->results);
+    copy->live = NULL;
 
     copy_sort (&(copy->primary_sort), &(q->primary_sort));
     copy_sort (&(copy->secondary_sort), &(q->secondary_sort));
@@ -1350,6 +2616,12 @@ void qof_query_init (void)
 
 void qof_query_shutdown (void)
 {
+    g_slist_free_full (guid_indexes, query_guid_index_free);
+    guid_indexes = NULL;
+    g_slist_free_full (string_indexes, query_string_index_free);
+    string_indexes = NULL;
+    g_slist_free_full (query_dependents, g_free);
+    query_dependents = NULL;
     qof_class_shutdown ();
     qof_query_core_shutdown ();
 }
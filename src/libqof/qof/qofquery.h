@@ -227,6 +227,106 @@ GList * qof_query_run (QofQuery *query);
  */
 GList * qof_query_last_run (QofQuery *query);
 
+/** Enumerate the instances whose parameter at an index's path is guid,
+ *  for example the splits in the account with that GUID. */
+typedef void (*QofQueryGuidIndexFunc) (QofBook *book, const GncGUID *guid,
+                                       QofInstanceForeachCB cb,
+                                       gpointer user_data);
+
+/** Tell the query engine about a faster way than checking every instance
+ *  of obj_type to find the ones for which a term matching any of a list of
+ *  GUIDs at param_path can be true.  qof_query_run() drives the search
+ *  from such an index when every OR-clause of the query has a
+ *  non-inverted term it can use, and then checks the remaining terms on
+ *  the instances the index returns.  Terms matching an instance's own
+ *  QOF_PARAM_GUID are always looked up in the collection.
+ *
+ *  The param_path becomes the property of the query engine.
+ */
+void qof_query_register_guid_index (QofIdTypeConst obj_type,
+                                    QofQueryParamList *param_path,
+                                    QofQueryGuidIndexFunc func);
+
+/** Like qof_query_register_guid_index(), for an index that only returns
+ *  the instances whose char parameter at char_path is one of chars.  It
+ *  is preferred to the plain index for the same param_path in clauses
+ *  that also have a non-inverted term matching any of a subset of chars
+ *  at char_path, such as the splits of an account that are not yet
+ *  reconciled.
+ *
+ *  The paths become the property of the query engine.
+ */
+void qof_query_register_guid_char_index (QofIdTypeConst obj_type,
+                                         QofQueryParamList *param_path,
+                                         QofQueryParamList *char_path,
+                                         const char *chars,
+                                         QofQueryGuidIndexFunc func);
+
+/** Have the query engine keep, for each book, an index of the instances
+ *  of obj_type by the value of their string parameter param_name.  It is
+ *  used like a GUID index for non-inverted terms that match the value
+ *  exactly, case and all, either at param_name itself or through a
+ *  parameter of another type for whose instances
+ *  qof_query_register_dependents() knows the dependents of obj_type: with
+ *  Split's dependents of a Transaction, an index of transactions by
+ *  number serves split searches on the transaction's number.
+ *
+ *  The index is built on first use and maintained from the instances'
+ *  events, so the instances must generate QOF_EVENT_MODIFY when the
+ *  parameter changes.  param_name must outlive the query engine.
+ */
+void qof_query_register_string_index (QofIdTypeConst obj_type,
+                                      const char *param_name);
+
+/** Set how many threads qof_query_run() may use to check the instances
+ *  of a large collection.  The default, 1, turns threading off and 0
+ *  uses the number of processors.  The threads are only used while some
+ *  thread holds a snapshot of the book (see qof_book_snapshot_take()),
+ *  and the parameter getters and predicates used in queries must be safe
+ *  to call from several threads at once, guarding whatever they cache
+ *  with qof_book_cache_lock().
+ */
+void qof_query_set_thread_count (guint count);
+guint qof_query_get_thread_count (void);
+
+/** Enumerate the instances that may match a query differently after a
+ *  change to changed, for example the splits of a transaction. */
+typedef void (*QofQueryDependentsFunc) (QofInstance *changed,
+                                        QofInstanceForeachCB cb,
+                                        gpointer user_data);
+
+/** Tell live queries for obj_type which instances to check again when an
+ *  instance of changed_type that their terms or sorts read changes.
+ *  Without one a live query has to be run again in full after such a
+ *  change.
+ */
+void qof_query_register_dependents (QofIdTypeConst obj_type,
+                                    QofIdTypeConst changed_type,
+                                    QofQueryDependentsFunc func);
+
+/** Keep the results of a query up to date as its books change.
+ *
+ *  A live query keeps all its matches and watches the engine's events,
+ *  checking only the changed instances, and those depending on them,
+ *  against its terms.  qof_query_run() then returns the maintained
+ *  results, only searching the books again after the query itself has
+ *  been changed or after a change it couldn't follow.  Copies of a live
+ *  query are not live.
+ */
+void qof_query_set_live (QofQuery *q, gboolean live);
+
+/** Return the instances that a live query has started matching, that
+ *  still match but have changed, and that no longer match since the last
+ *  call.  The lists must be freed by the caller; the removed instances
+ *  may already have been destroyed and must not be dereferenced.
+ *
+ *  @return FALSE if the query isn't live or had to search the books
+ *  again, in which case the lists are empty and the caller should take
+ *  the whole result from qof_query_run().
+ */
+gboolean qof_query_take_changes (QofQuery *q, GList **added,
+                                 GList **changed, GList **removed);
+
 /** Perform a subquery, return the results.
  *  Instead of running over a book, the subquery runs over the results
  *  of the primary query.
@@ -68,6 +68,7 @@ typedef struct
     QofStringMatch	options;
     gboolean		is_regex;
     gchar *		matchstring;
+    gchar *		folded;	/* matchstring case-folded and normalized */
     regex_t		compiled;
 } query_string_def, *query_string_t;
 
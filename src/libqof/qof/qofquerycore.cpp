@@ -125,6 +125,44 @@ static GHashTable *predEqualTable = NULL;
 
 /* QOF_TYPE_STRING */
 
+/* Does haystack contain folded, a needle already case-folded and
+ * normalized, ignoring case? */
+static gboolean
+string_contains_nocase (const char *haystack, const char *folded)
+{
+    char buf[256];
+    char *lower;
+    gchar *casefold, *normalized;
+    gboolean found;
+    gsize len;
+
+    /* Most descriptions and memos are ASCII, whose case-folded,
+     * normalized form is just the lower-case one, so spare them the trip
+     * through the Unicode tables. */
+    for (len = 0; haystack[len]; ++len)
+        if ((guchar)haystack[len] >= 0x80)
+            break;
+    if (!haystack[len])
+    {
+        gsize i;
+        lower = len < sizeof (buf) ? buf : static_cast<char*>(g_malloc (len + 1));
+        for (i = 0; i < len; ++i)
+            lower[i] = g_ascii_tolower (haystack[i]);
+        lower[len] = '\0';
+        found = strstr (lower, folded) != NULL;
+        if (lower != buf)
+            g_free (lower);
+        return found;
+    }
+
+    casefold = g_utf8_casefold (haystack, -1);
+    normalized = g_utf8_normalize (casefold, -1, G_NORMALIZE_ALL);
+    g_free (casefold);
+    found = normalized && strstr (normalized, folded) != NULL;
+    g_free (normalized);
+    return found;
+}
+
 static int
 string_match_predicate (gpointer object,
                         QofParam *getter,
@@ -152,7 +190,7 @@ string_match_predicate (gpointer object,
         {
             if (pd->how == QOF_COMPARE_CONTAINS || pd->how == QOF_COMPARE_NCONTAINS)
             {
-                if (qof_utf8_substr_nocase (s, pdata->matchstring)) //uses strstr
+                if (string_contains_nocase (s, pdata->folded))
                     ret = 1;
             }
             else
@@ -249,6 +287,7 @@ string_free_pdata (QofQueryPredData *pd)
         regfree (&pdata->compiled);
 
     g_free (pdata->matchstring);
+    g_free (pdata->folded);
     g_free (pdata);
 }
 
@@ -309,6 +348,15 @@ qof_query_string_predicate (QofQueryCompare how,
         }
         pdata->is_regex = TRUE;
     }
+    else if (options == QOF_STRING_MATCH_CASEINSENSITIVE)
+    {
+        /* Fold the needle once rather than for every object checked. */
+        gchar *casefold = g_utf8_casefold (str, -1);
+        pdata->folded = g_utf8_normalize (casefold, -1, G_NORMALIZE_ALL);
+        g_free (casefold);
+        if (!pdata->folded)
+            pdata->folded = g_strdup (str);
+    }
 
     return ((QofQueryPredData*)pdata);
 }
@@ -1388,7 +1436,7 @@ qof_query_collect_predicate (QofGuidMatch options, QofCollection *coll)
     pdata = g_new0 (query_coll_def, 1);
     pdata->pd.type_name = query_collect_type;
     pdata->options = options;
-    qof_collection_foreach(coll, query_collect_cb, pdata);
+    qof_collection_foreach_unordered(coll, query_collect_cb, pdata);
     if (NULL == pdata->guids)
     {
         return NULL;
@@ -451,6 +451,19 @@ QofSessionImpl::is_saving () const noexcept
 
 void
 QofSessionImpl::save (QofPercentageFunc percentage_func) noexcept
+{
+    sync_backend (percentage_func, false);
+}
+
+void
+QofSessionImpl::save_in_background (QofPercentageFunc percentage_func) noexcept
+{
+    sync_backend (percentage_func, true);
+}
+
+void
+QofSessionImpl::sync_backend (QofPercentageFunc percentage_func,
+                              bool background) noexcept
 {
     m_saving = true;
     ENTER ("sess=%p book_id=%s", this, m_book_id.c_str ());
@@ -470,9 +483,14 @@ QofSessionImpl::save (QofPercentageFunc percentage_func) noexcept
         /* if invoked as SaveAs(), then backend not yet set */
         qof_book_set_backend (m_book, backend);
         backend->percentage = percentage_func;
-        if (backend->sync)
+        /* Backends that can't write in the background save in the
+         * foreground instead. */
+        auto sync = backend->sync;
+        if (background && backend->background_sync)
+            sync = backend->background_sync;
+        if (sync)
         {
-            (backend->sync)(backend, m_book);
+            (sync)(backend, m_book);
             QofBackendError err {qof_backend_get_error (backend)};
             if (ERR_BACKEND_NO_ERR != err)
             {
@@ -650,6 +668,14 @@ qof_session_save (QofSession *session,
     session->save (percentage_func);
 }
 
+void
+qof_session_save_in_background (QofSession *session,
+                                QofPercentageFunc percentage_func)
+{
+    if (!session) return;
+    session->save_in_background (percentage_func);
+}
+
 void
 qof_session_safe_save(QofSession *session, QofPercentageFunc percentage_func)
 {
@@ -236,6 +236,17 @@ QofBackend * qof_session_get_backend(const QofSession *session);
 void     qof_session_save (QofSession *session,
                            QofPercentageFunc percentage_func);
 
+/**
+ * Save as qof_session_save() does, but let the backend finish the
+ * write in a background thread where it can. The book is marked saved
+ * as of the moment its state was captured; edits made afterwards mark
+ * it dirty again. A write that fails in the background marks the book
+ * dirty too, and its error is reported by the next save or by
+ * qof_session_end(). Backends without background writes just save.
+ */
+void     qof_session_save_in_background (QofSession *session,
+                                         QofPercentageFunc percentage_func);
+
 /**
  * A special version of save used in the sql backend which moves the
  * existing tables aside, then saves everything to new tables, then
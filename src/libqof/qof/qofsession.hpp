@@ -48,6 +48,9 @@ struct QofSessionImpl
     void ensure_all_data_loaded () noexcept;
     void load (QofPercentageFunc) noexcept;
     void save (QofPercentageFunc) noexcept;
+    /** Save as save() does, but let the backend finish writing in the
+     * background where it can. */
+    void save_in_background (QofPercentageFunc) noexcept;
     void safe_save (QofPercentageFunc) noexcept;
     bool save_in_progress () const noexcept;
     bool export_session (QofSessionImpl & real_session, QofPercentageFunc) noexcept;
@@ -85,6 +88,8 @@ private:
 
     void load_backend (std::string access_method) noexcept;
 
+    void sync_backend (QofPercentageFunc, bool background) noexcept;
+
     /* A book holds pointers to the various types of datasets.
      * A session has exactly one book. */
     QofBook * m_book;
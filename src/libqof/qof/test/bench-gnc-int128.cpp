@@ -0,0 +1,139 @@
+/********************************************************************
+ * bench-gnc-int128.cpp -- timings of the GncInt128 arithmetic      *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ *******************************************************************/
+
+/* bench-gnc-int128 runs each GncInt128 operation that gnc_numeric
+ * leans on over --count operand pairs drawn from --seed and prints one
+ * JSON object per operation:
+ *
+ *   {"benchmark":"multiply-wide","iterations":1000000,"seconds":0.012}
+ *
+ * The "narrow" operands are below 2^63, as amounts and denominators
+ * are; "wide" ones are products of two of those, as cross-multiplied
+ * numerators are.  Build it with -DGNC_INT128_PORTABLE to time the
+ * limb arithmetic where the compiler has a native 128-bit type.
+ */
+
+extern "C"
+{
+#include "config.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+}
+#include <vector>
+#include "../gnc-int128.hpp"
+
+static gint count = 1000000;
+static gint seed = 1;
+
+static GOptionEntry bench_options[] =
+{
+    { "count", 'n', 0, G_OPTION_ARG_INT, &count,
+      "Operand pairs for each benchmark", "N" },
+    { "seed", 'r', 0, G_OPTION_ARG_INT, &seed,
+      "Seed for the operands", "N" },
+    { NULL }
+};
+
+static uint64_t
+bench_random (void)
+{
+    return (static_cast<uint64_t>(rand ()) << 42) ^
+        (static_cast<uint64_t>(rand ()) << 21) ^ rand ();
+}
+
+static void
+bench_report (const char* name, gint iterations, gint64 usecs)
+{
+    printf ("{\"benchmark\":\"%s\",\"iterations\":%d,\"seconds\":%.6f}\n",
+            name, iterations, usecs / (double) G_USEC_PER_SEC);
+    fflush (stdout);
+}
+
+/* Each result is folded into a sum so the loop can't be dropped. */
+template <typename Op> static void
+bench_op (const char* name, const std::vector<GncInt128>& a,
+          const std::vector<GncInt128>& b, Op op)
+{
+    GncInt128 sum {};
+    auto start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; i++)
+        sum ^= op (a[i], b[i]);
+    bench_report (name, count, g_get_monotonic_time () - start);
+    if (sum.isNan ())
+        fprintf (stderr, "%s: NaN\n", name);
+}
+
+int
+main (int argc, char** argv)
+{
+    auto context = g_option_context_new ("- GncInt128 benchmarks");
+    GError* error = NULL;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+    count = MAX (count, 1);
+
+    srand (seed);
+    printf ("{\"parameters\":{\"count\":%d,\"seed\":%d}}\n", count, seed);
+
+    std::vector<GncInt128> narrow_a, narrow_b, wide_a, wide_b;
+    for (gint i = 0; i < count; i++)
+    {
+        GncInt128 a (bench_random () >> 1), b ((bench_random () >> 1) | 1);
+        GncInt128 c (bench_random () >> 1), d ((bench_random () >> 1) | 1);
+        if (rand () % 4 == 0)
+            a = -a;
+        narrow_a.push_back (a);
+        narrow_b.push_back (b);
+        wide_a.push_back (a * c);
+        wide_b.push_back (b * ((d >> (rand () % 48)) | 1));
+    }
+
+    bench_op ("add", wide_a, wide_b,
+              [](const GncInt128& x, const GncInt128& y) { return x + y; });
+    bench_op ("multiply-narrow", narrow_a, narrow_b,
+              [](const GncInt128& x, const GncInt128& y) { return x * y; });
+    bench_op ("multiply-wide", narrow_a, wide_b,
+              [](const GncInt128& x, const GncInt128& y)
+              { return (x >> 32) * y; });
+    bench_op ("divide-narrow", wide_a, narrow_b,
+              [](const GncInt128& x, const GncInt128& y) { return x / y; });
+    bench_op ("divide-wide", wide_a, wide_b,
+              [](const GncInt128& x, const GncInt128& y) { return x / y; });
+    bench_op ("remainder-wide", wide_a, wide_b,
+              [](const GncInt128& x, const GncInt128& y) { return x % y; });
+    bench_op ("gcd-narrow", narrow_a, narrow_b,
+              [](const GncInt128& x, const GncInt128& y) { return x.gcd (y); });
+    bench_op ("gcd-wide", wide_a, wide_b,
+              [](const GncInt128& x, const GncInt128& y) { return x.gcd (y); });
+    bench_op ("lcm", narrow_a, narrow_b,
+              [](const GncInt128& x, const GncInt128& y) { return x.lcm (y); });
+    return 0;
+}
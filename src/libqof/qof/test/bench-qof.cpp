@@ -0,0 +1,220 @@
+/********************************************************************
+ * bench-qof.cpp -- timings of QOF's lookup and conversion paths    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ *******************************************************************/
+
+/* bench-qof times the QOF operations whose speed the unit tests used to
+ * print, --count times each, and prints one JSON object per benchmark:
+ *
+ *   {"benchmark":"string-cache-1-thread","iterations":200000,"seconds":0.021}
+ *
+ * Threaded benchmarks count the operations of each thread.
+ */
+
+extern "C"
+{
+#include "config.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "qof.h"
+}
+#include "../guid-table.hpp"
+#include "../gnc-datetime.hpp"
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static gint count = 200000;
+static gint threads = 8;
+
+static GOptionEntry bench_options[] =
+{
+    { "count", 'n', 0, G_OPTION_ARG_INT, &count,
+      "Operations for each benchmark", "N" },
+    { "threads", 't', 0, G_OPTION_ARG_INT, &threads,
+      "Threads for the threaded benchmarks", "N" },
+    { NULL }
+};
+
+static void
+bench_report (const char* name, gint iterations, gint64 usecs)
+{
+    printf ("{\"benchmark\":\"%s\",\"iterations\":%d,\"seconds\":%.6f}\n",
+            name, iterations, usecs / (double) G_USEC_PER_SEC);
+    fflush (stdout);
+}
+
+/* Each thread takes and drops a reference to the strings in turn, so
+ * that the shards see concurrent inserts and removes of the same keys. */
+static void
+bench_string_cache (void)
+{
+    std::vector<std::string> strings (1000);
+    for (size_t i = 0; i < strings.size (); ++i)
+        strings[i] = "cache-bench-" + std::to_string (i);
+    auto run = [&strings]()
+        {
+            for (gint i = 0; i < count; ++i)
+            {
+                auto& str = strings[i % strings.size ()];
+                qof_string_cache_remove (qof_string_cache_insert (str.c_str ()));
+            }
+        };
+
+    auto start = g_get_monotonic_time ();
+    run ();
+    bench_report ("string-cache-1-thread", count,
+                  g_get_monotonic_time () - start);
+
+    std::vector<std::thread> workers;
+    start = g_get_monotonic_time ();
+    for (gint i = 0; i < threads; ++i)
+        workers.emplace_back (run);
+    for (auto& worker : workers)
+        worker.join ();
+    auto name = "string-cache-" + std::to_string (threads) + "-threads";
+    bench_report (name.c_str (), count, g_get_monotonic_time () - start);
+}
+
+/* Against the GHashTable that QofCollection used before GncGuidTable. */
+static void
+bench_guid_table (void)
+{
+    std::vector<GncGUID> guids (100000);
+    for (auto& guid : guids)
+        guid = guid_new_return ();
+    auto hash = guid_hash_table_new ();
+    GncGuidTable table;
+    for (auto& guid : guids)
+    {
+        g_hash_table_insert (hash, &guid, &guid);
+        table.insert (guid, &guid);
+    }
+
+    size_t found = 0;
+    auto start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+        found += g_hash_table_lookup (hash, &guids[i % guids.size ()]) != nullptr;
+    bench_report ("guid-lookup-ghashtable", count,
+                  g_get_monotonic_time () - start);
+
+    start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+        found += table.lookup (guids[i % guids.size ()]) != nullptr;
+    bench_report ("guid-lookup-guidtable", count,
+                  g_get_monotonic_time () - start);
+    g_hash_table_destroy (hash);
+    if (found != 2 * static_cast<size_t>(count))
+        fprintf (stderr, "guid-lookup: missed %zu\n", 2 * count - found);
+}
+
+/* Against the boost conversions that guid.cpp used before. */
+static void
+bench_guid_hex (void)
+{
+    std::vector<GncGUID> guids (1000);
+    for (auto& guid : guids)
+        guid = guid_new_return ();
+    boost::uuids::string_generator strgen;
+    char buf[GUID_ENCODING_LENGTH + 1];
+    gint ok = 0;
+
+    auto start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+    {
+        boost::uuids::uuid uuid;
+        memcpy (uuid.data, guids[i % guids.size ()].reserved, GUID_DATA_SIZE);
+        auto str = boost::uuids::to_string (uuid);
+        str.erase (std::remove (str.begin (), str.end (), '-'), str.end ());
+        ok += strgen (str) == uuid;
+    }
+    bench_report ("guid-round-trip-boost", count,
+                  g_get_monotonic_time () - start);
+
+    start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+    {
+        GncGUID parsed;
+        guid_to_string_buff (&guids[i % guids.size ()], buf);
+        ok += string_to_guid (buf, &parsed) &&
+            guid_equal (&parsed, &guids[i % guids.size ()]);
+    }
+    bench_report ("guid-round-trip-hex", count,
+                  g_get_monotonic_time () - start);
+    if (ok != 2 * count)
+        fprintf (stderr, "guid-round-trip: %d failed\n", 2 * count - ok);
+}
+
+/* GncDateTimeValue's offset table against GncDateTime's boost zones. */
+static void
+bench_datetime (void)
+{
+    const time64 base = 1420070400; //2015-01-01 00:00:00 Z
+    long sum = 0;
+
+    auto start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+        sum += static_cast<struct tm>(GncDateTime (base + i * 3593)).tm_hour;
+    bench_report ("time64-to-tm-datetime", count,
+                  g_get_monotonic_time () - start);
+
+    start = g_get_monotonic_time ();
+    for (gint i = 0; i < count; ++i)
+        sum -= static_cast<struct tm>(GncDateTimeValue (base + i * 3593)).tm_hour;
+    bench_report ("time64-to-tm-value", count,
+                  g_get_monotonic_time () - start);
+    if (sum)
+        fprintf (stderr, "time64-to-tm: the conversions differ\n");
+}
+
+int
+main (int argc, char** argv)
+{
+    auto context = g_option_context_new ("- QOF benchmarks");
+    GError* error = NULL;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+    count = MAX (count, 1);
+    threads = MAX (threads, 1);
+
+    qof_init ();
+    printf ("{\"parameters\":{\"count\":%d,\"threads\":%d}}\n", count, threads);
+
+    bench_string_cache ();
+    bench_guid_table ();
+    bench_guid_hex ();
+    bench_datetime ();
+
+    qof_close ();
+    return 0;
+}
@@ -87,3 +87,56 @@ TEST(gnc_datetime_functions, test_date)
     EXPECT_EQ(ymd.month, 11);
     EXPECT_EQ(ymd.day, 13);
 }
+
+static void
+expect_same_tm(const struct tm& a, const struct tm& b)
+{
+    EXPECT_EQ(a.tm_year, b.tm_year);
+    EXPECT_EQ(a.tm_mon, b.tm_mon);
+    EXPECT_EQ(a.tm_mday, b.tm_mday);
+    EXPECT_EQ(a.tm_hour, b.tm_hour);
+    EXPECT_EQ(a.tm_min, b.tm_min);
+    EXPECT_EQ(a.tm_sec, b.tm_sec);
+    EXPECT_EQ(a.tm_wday, b.tm_wday);
+    EXPECT_EQ(a.tm_yday, b.tm_yday);
+    EXPECT_EQ(a.tm_isdst, b.tm_isdst);
+}
+
+TEST(gnc_datetime_value, test_matches_gncdatetime)
+{
+    /* Every 7 hours and a bit from 1900 to 2100, which includes the
+     * offset changes of any zone the tests run in. */
+    for (time64 time = -2208988800; time < 4102444800; time += 25247)
+    {
+        GncDateTime atime(time);
+        GncDateTimeValue value(time);
+        EXPECT_EQ(static_cast<time64>(value), time);
+        EXPECT_EQ(value.offset(), atime.offset());
+        expect_same_tm(static_cast<struct tm>(value),
+                       static_cast<struct tm>(atime));
+        expect_same_tm(value.utc_tm(), atime.utc_tm());
+        auto ymd = value.year_month_day();
+        auto date_ymd = atime.date().year_month_day();
+        EXPECT_EQ(ymd.year, date_ymd.year);
+        EXPECT_EQ(ymd.month, date_ymd.month);
+        EXPECT_EQ(ymd.day, date_ymd.day);
+    }
+}
+
+TEST(gnc_datetime_value, test_struct_tm_constructor)
+{
+#ifdef HAVE_STRUCT_TM_GMTOFF
+    const struct tm tm {0, 0, 12, 13, 10, 145, 0, 0, 0, NULL, 0 };
+#else
+    const struct tm tm {0, 0, 12, 13, 10, 145, 0, 0, 0 };
+#endif
+    GncDateTimeValue value(tm);
+    GncDateTime atime(tm);
+    EXPECT_EQ(static_cast<time64>(value), static_cast<time64>(atime));
+    EXPECT_EQ(value.offset(), atime.offset());
+
+    struct tm bad = tm;
+    bad.tm_year = 10000 - 1900;
+    EXPECT_THROW(GncDateTimeValue{bad}, std::invalid_argument);
+    EXPECT_THROW(GncDateTimeValue{MAXTIME + 86400}, std::invalid_argument);
+}
@@ -340,6 +340,11 @@ TEST(qofint128_functions, multiply)
     EXPECT_EQ (GncInt128(UINT64_C(1149052180967758316), UINT64_C(6323251814974894144)), smallest *= smaller);
     EXPECT_FALSE (smallest.isOverflow());
 
+    GncInt128 wide (UINT64_C(0xa9014739da9d3729));
+    wide *= GncInt128 (UINT64_C(0xd32f467dfabb6f64));
+    EXPECT_EQ (GncInt128(UINT64_C(0x8b6b437a476f4d61),
+                         UINT64_C(0xc082461de5475304)), wide);
+    EXPECT_FALSE (wide.isOverflow());
 }
 
 TEST(qofint128_functions, divide)
@@ -445,6 +450,24 @@ TEST(qofint128_functions, GCD)
     EXPECT_EQ (big, smaller.lcm (smallest));
 }
 
+/* Both operands and their gcd wider than 64 bits. */
+TEST(qofint128_functions, wide_GCD)
+{
+    GncInt128 wide (UINT64_C(1), UINT64_C(1)); // 2^64 + 1
+    GncInt128 wider (UINT64_C(0x1234), UINT64_C(9920249030613615975));
+
+    EXPECT_EQ (wide, wide.gcd (wide));
+    EXPECT_EQ (wide, (wide * GncInt128 (3)).gcd (wide * GncInt128 (5)));
+    EXPECT_EQ (wide, (-wide * GncInt128 (3)).gcd (wide * GncInt128 (5)));
+    EXPECT_EQ (wide * GncInt128 (8),
+               (wide * GncInt128 (24)).gcd (wide * GncInt128 (32)));
+    EXPECT_EQ (wider, (wider * GncInt128 (7)).gcd (wider * GncInt128 (11)));
+    EXPECT_EQ (wider, wider.gcd (wider * GncInt128 (1000003)));
+    EXPECT_EQ (wide, wide.lcm (wide));
+    EXPECT_EQ (wider * GncInt128 (77),
+               (wider * GncInt128 (7)).lcm (wider * GncInt128 (11)));
+}
+
 TEST(qofint128_functions, pow)
 {
 
@@ -23,6 +23,9 @@
 
 #include <gtest/gtest.h>
 #include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 #include "../gnc-timezone.hpp"
 
 TEST(gnc_timezone_constructors, test_default_constructor)
@@ -70,6 +73,70 @@ TEST(gnc_timezone_constructors, test_posix_timezone)
 }
 #endif
 
+#if !PLATFORM(WINDOWS)
+TEST(gnc_timezone_offsets, test_pacific_time_offsets)
+{
+    TimeZoneProvider tzp ("America/Los_Angeles");
+    long offset;
+    int isdst;
+    // 2006-01-15 and 2006-07-15 12:00 UTC
+    EXPECT_TRUE(tzp.get_offset(INT64_C(1137326400), offset, isdst));
+    EXPECT_EQ(-8 * 3600, offset);
+    EXPECT_EQ(0, isdst);
+    EXPECT_TRUE(tzp.get_offset(INT64_C(1152964800), offset, isdst));
+    EXPECT_EQ(-7 * 3600, offset);
+    EXPECT_EQ(1, isdst);
+    EXPECT_FALSE(tzp.get_offset(INT64_C(253402300800) + 366 * 86400,
+                                offset, isdst));
+}
+
+TEST(gnc_timezone_offsets, test_offsets_match_local_date_time)
+{
+    using boost::posix_time::ptime;
+    using boost::posix_time::hours;
+    TimeZoneProvider tzp ("Australia/Lord_Howe");
+    ptime epoch (boost::gregorian::date(1970, 1, 1));
+    for (int64_t utc = INT64_C(946684800); utc < INT64_C(1262304000);
+         utc += 1800)
+    {
+        ptime time = epoch + hours(utc / 3600) +
+            boost::posix_time::seconds(utc % 3600);
+        boost::local_time::local_date_time ldt (time, tzp.get(time.date().year()));
+        long offset;
+        int isdst;
+        ASSERT_TRUE(tzp.get_offset(utc, offset, isdst));
+        EXPECT_EQ((ldt.local_time() - ldt.utc_time()).total_seconds(), offset);
+        EXPECT_EQ(ldt.is_dst(), isdst != 0);
+    }
+}
+
+TEST(gnc_timezone_offsets, test_cached_transitions)
+{
+    char dir[] = "/tmp/gnc-tzcache-XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    setenv("GNC_TZ_CACHE_DIR", dir, 1);
+    TimeZoneProvider compiled ("America/New_York");
+    TimeZoneProvider cached ("America/New_York");
+    unsetenv("GNC_TZ_CACHE_DIR");
+    TimeZoneProvider uncached ("America/New_York");
+    for (int64_t utc = INT64_C(-2208988800); utc < INT64_C(4102444800);
+         utc += 86400 * 7 + 3599)
+    {
+        long offset, cached_offset;
+        int isdst, cached_isdst;
+        ASSERT_TRUE(uncached.get_offset(utc, offset, isdst));
+        ASSERT_TRUE(cached.get_offset(utc, cached_offset, cached_isdst));
+        EXPECT_EQ(offset, cached_offset);
+        EXPECT_EQ(isdst, cached_isdst);
+    }
+    std::string cache_file (dir);
+    cache_file += "/_usr_share_zoneinfo_America_New_York.tzcache";
+    if (!getenv("TZDIR"))
+        EXPECT_EQ(0, remove(cache_file.c_str()));
+    rmdir(dir);
+}
+#endif
+
 TEST(gnc_timezone_constructors, test_bogus_time_constructor)
 {
     TimeZoneProvider tzp ("New York Standard Time");
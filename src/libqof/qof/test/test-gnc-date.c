@@ -182,6 +182,34 @@ test_gnc_localtime (void)
     }
 }
 
+/* gnc_localtime_r caches the UTC offsets of the days it has converted, so
+ * walk through a couple of years, both ways, including the days the
+ * offset changes. */
+static void
+test_gnc_localtime_cached (void)
+{
+    const time64 start = 1420070400LL; /* 2015-01-01 00:00:00 UTC */
+    const time64 step = 3593;
+    const int count = 2 * 365 * 24;
+    int i, pass;
+    for (pass = 0; pass < 2; pass++)
+        for (i = 0; i < count; i++)
+        {
+            time64 secs = start + (pass ? count - i : i) * step;
+            time_t tsecs = (time_t)secs;
+            struct tm time, ans;
+            g_assert (gnc_localtime_r (&secs, &time) == &time);
+            ans = *localtime (&tsecs);
+            g_assert_cmpint (time.tm_year, ==, ans.tm_year);
+            g_assert_cmpint (time.tm_yday, ==, ans.tm_yday);
+            g_assert_cmpint (time.tm_wday, ==, ans.tm_wday);
+            g_assert_cmpint (time.tm_hour, ==, ans.tm_hour);
+            g_assert_cmpint (time.tm_min, ==, ans.tm_min);
+            g_assert_cmpint (time.tm_sec, ==, ans.tm_sec);
+            g_assert_cmpint (time.tm_isdst, ==, ans.tm_isdst);
+        }
+}
+
 static void
 test_gnc_gmtime (void)
 {
@@ -1732,6 +1760,31 @@ test_gnc_timespec_to_iso8601_buff (FixtureA *f, gconstpointer pData)
     g_assert_cmpstr (buff, ==, time_str);
     g_free (time_str);
 }
+/* gnc_time64_to_iso8601_local_buff
+char *
+gnc_time64_to_iso8601_local_buff (time64 t, char * buff)
+*/
+static void
+test_gnc_time64_to_iso8601_local_buff (FixtureA *f, gconstpointer pData)
+{
+    Timespec times[] = { f->ts0, f->ts1, f->ts2, f->ts3, f->ts4, f->ts5 };
+    time64 others[] = { -1, INT64_C(-14159025000), INT64_C(4102444800) };
+    gchar buff[GNC_ISO8601_LOCAL_BUFF_SIZE];
+    gchar *end, *expected;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (times) + G_N_ELEMENTS (others); ++i)
+    {
+        time64 t = i < G_N_ELEMENTS (times) ? times[i].tv_sec :
+            others[i - G_N_ELEMENTS (times)];
+        end = gnc_time64_to_iso8601_local_buff (t, buff);
+        expected = gnc_print_time64 (t, "%Y-%m-%d %H:%M:%S %q");
+        g_assert (end != NULL);
+        g_assert_cmpint (end - buff, ==, strlen (buff));
+        g_assert_cmpstr (buff, ==, expected);
+        g_free (expected);
+    }
+}
 /* gnc_timespec2dmy
 void
 gnc_timespec2dmy (Timespec t, int *day, int *month, int *year)// C: 1  Local: 0:0:0
@@ -2135,6 +2188,7 @@ test_suite_gnc_date (void)
 {
     tz = g_time_zone_new_local();
     GNC_TEST_ADD_FUNC (suitename, "gnc localtime", test_gnc_localtime);
+    GNC_TEST_ADD_FUNC (suitename, "gnc localtime cached", test_gnc_localtime_cached);
     GNC_TEST_ADD_FUNC (suitename, "gnc gmtime", test_gnc_gmtime);
     GNC_TEST_ADD_FUNC (suitename, "gnc mktime", test_gnc_mktime);
     GNC_TEST_ADD_FUNC (suitename, "gnc mktime normalization", test_gnc_mktime_normalization);
@@ -2170,6 +2224,7 @@ test_suite_gnc_date (void)
     GNC_TEST_ADD_FUNC (suitename, "gnc_date_timestamp", test_gnc_date_timestamp);
     GNC_TEST_ADD (suitename, "gnc iso8601 to timespec gmt", FixtureA, NULL, setup, test_gnc_iso8601_to_timespec_gmt, NULL);
     GNC_TEST_ADD (suitename, "gnc timespec to iso8601 buff", FixtureA, NULL, setup, test_gnc_timespec_to_iso8601_buff, NULL);
+    GNC_TEST_ADD (suitename, "gnc time64 to iso8601 local buff", FixtureA, NULL, setup, test_gnc_time64_to_iso8601_local_buff, NULL);
     GNC_TEST_ADD (suitename, "gnc timespec2dmy", FixtureA, NULL, setup, test_gnc_timespec2dmy, NULL);
 // GNC_TEST_ADD_FUNC (suitename, "gnc dmy2timespec internal", test_gnc_dmy2timespec_internal);
 
@@ -23,12 +23,19 @@
  ********************************************************************/
 
 #include "../guid.hpp"
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
 
 #include <random>
 #include <sstream>
 #include <iomanip>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST (GncGUID, creation)
@@ -39,6 +46,41 @@ TEST (GncGUID, creation)
     GncGUID other;
 }
 
+TEST (GncGUID, random_is_version_4)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        GncGUID guid = gnc::GUID::create_random ();
+        EXPECT_EQ (0x40, guid.reserved[6] & 0xf0);
+        EXPECT_EQ (0x80, guid.reserved[8] & 0xc0);
+    }
+}
+
+/* Each thread has its own generator; they must not hand out the same
+ * GUIDs. */
+TEST (GncGUID, create_random_threads)
+{
+    const size_t per_thread = 10000;
+    const int n_threads = 4;
+    std::vector<std::vector<gnc::GUID>> results (n_threads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n_threads; ++i)
+        threads.emplace_back ([&results, i, per_thread] {
+            for (size_t j = 0; j < per_thread; ++j)
+                results[i].push_back (gnc::GUID::create_random ());
+        });
+    for (auto& thread : threads)
+        thread.join ();
+
+    std::vector<std::string> all;
+    for (auto& result : results)
+        for (auto& guid : result)
+            all.push_back (guid.to_string ());
+    std::sort (all.begin (), all.end ());
+    EXPECT_EQ (all.end (), std::adjacent_find (all.begin (), all.end ()));
+    EXPECT_EQ (per_thread * n_threads, all.size ());
+}
+
 TEST (GncGUID, copy)
 {
     auto guid = gnc::GUID::create_random ();
@@ -94,3 +136,56 @@ TEST (GncGUID, round_trip)
     EXPECT_EQ (guid1, guid2);
 }
 
+TEST (GncGUID, hex_forms)
+{
+    GncGUID guid = gnc::GUID::create_random ();
+    char buf[GUID_ENCODING_LENGTH + 1];
+    EXPECT_EQ (buf + GUID_ENCODING_LENGTH, guid_to_string_buff (&guid, buf));
+    EXPECT_EQ (GUID_ENCODING_LENGTH, strlen (buf));
+    for (int i = 0; i < GUID_DATA_SIZE; ++i)
+    {
+        char byte[3];
+        snprintf (byte, sizeof (byte), "%02x", guid.reserved[i]);
+        EXPECT_EQ (byte[0], buf[2 * i]);
+        EXPECT_EQ (byte[1], buf[2 * i + 1]);
+    }
+
+    GncGUID parsed;
+    EXPECT_TRUE (string_to_guid (buf, &parsed));
+    EXPECT_TRUE (guid_equal (&guid, &parsed));
+
+    std::string upper {buf};
+    std::transform (upper.begin (), upper.end (), upper.begin (), ::toupper);
+    EXPECT_TRUE (string_to_guid (upper.c_str (), &parsed));
+    EXPECT_TRUE (guid_equal (&guid, &parsed));
+
+    /* Decorated forms still go through boost's parser. */
+    std::string dashed {buf};
+    dashed.insert (20, "-").insert (16, "-").insert (12, "-").insert (8, "-");
+    EXPECT_TRUE (string_to_guid (dashed.c_str (), &parsed));
+    EXPECT_TRUE (guid_equal (&guid, &parsed));
+
+    EXPECT_FALSE (string_to_guid ("0123456789abcdef", &parsed));
+}
+
+/* The hex conversions must agree with the boost ones used before. */
+TEST (GncGUID, hex_round_trip)
+{
+    boost::uuids::string_generator strgen;
+    char buf[GUID_ENCODING_LENGTH + 1];
+    for (int i = 0; i < 1000; ++i)
+    {
+        GncGUID guid = gnc::GUID::create_random ();
+        boost::uuids::uuid uuid;
+        std::memcpy (uuid.data, guid.reserved, GUID_DATA_SIZE);
+        auto str = boost::uuids::to_string (uuid);
+        str.erase (std::remove (str.begin (), str.end (), '-'), str.end ());
+        EXPECT_TRUE (strgen (str) == uuid);
+
+        GncGUID parsed;
+        guid_to_string_buff (&guid, buf);
+        EXPECT_EQ (str, std::string {buf});
+        EXPECT_TRUE (string_to_guid (buf, &parsed));
+        EXPECT_TRUE (guid_equal (&parsed, &guid));
+    }
+}
@@ -40,8 +40,28 @@ test_gnc_numeric_add (void)
     g_assert (gnc_numeric_equal (result, goal_ab));
 }
 
+static void
+test_gnc_numeric_to_buff (void)
+{
+    gnc_numeric nums[] = { { 0, 1 }, { -1, 100 }, { 123456789987654321, 1000000000 },
+                           { G_MAXINT64, G_MININT64 }, { G_MININT64, 1 } };
+    gchar buff[GNC_NUMERIC_BUFF_SIZE];
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (nums); ++i)
+    {
+        gchar *expected = g_strdup_printf ("%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
+                                           nums[i].num, nums[i].denom);
+        gchar *end = gnc_numeric_to_buff (nums[i], buff);
+        g_assert_cmpstr (buff, ==, expected);
+        g_assert_cmpint (end - buff, ==, strlen (expected));
+        g_free (expected);
+    }
+}
+
 void
 test_suite_gnc_numeric ( void )
 {
     GNC_TEST_ADD_FUNC( suitename, "gnc-numeric add", test_gnc_numeric_add );
+    GNC_TEST_ADD_FUNC( suitename, "gnc-numeric to buff", test_gnc_numeric_to_buff );
 }
@@ -0,0 +1,114 @@
+/********************************************************************
+ * test-guid-table.cpp: A Google Test suite for GncGuidTable.       *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+
+#include "../guid-table.hpp"
+#include <glib.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+class GuidTableTest : public ::testing::Test
+{
+public:
+    GuidTableTest() : t_guids(200), t_values(200)
+    {
+        for (auto& guid : t_guids)
+            guid = guid_new_return();
+    }
+protected:
+    GncGuidTable t_table;
+    std::vector<GncGUID> t_guids;
+    std::vector<int> t_values;
+};
+
+TEST_F (GuidTableTest, InsertLookup)
+{
+    EXPECT_EQ (nullptr, t_table.lookup(t_guids[0]));
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        t_table.insert(t_guids[i], &t_values[i]);
+    EXPECT_EQ (t_guids.size(), t_table.size());
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        EXPECT_EQ (&t_values[i], t_table.lookup(t_guids[i]));
+    auto other = guid_new_return();
+    EXPECT_EQ (nullptr, t_table.lookup(other));
+}
+
+TEST_F (GuidTableTest, Replace)
+{
+    t_table.insert(t_guids[0], &t_values[0]);
+    t_table.insert(t_guids[0], &t_values[1]);
+    EXPECT_EQ (1u, t_table.size());
+    EXPECT_EQ (&t_values[1], t_table.lookup(t_guids[0]));
+}
+
+TEST_F (GuidTableTest, Remove)
+{
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        t_table.insert(t_guids[i], &t_values[i]);
+    for (size_t i = 0; i < t_guids.size(); i += 2)
+        EXPECT_TRUE (t_table.remove(t_guids[i]));
+    EXPECT_FALSE (t_table.remove(t_guids[0]));
+    EXPECT_EQ (t_guids.size() / 2, t_table.size());
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        EXPECT_EQ (i % 2 ? &t_values[i] : nullptr, t_table.lookup(t_guids[i]));
+}
+
+/* GUIDs that share their first half must still be told apart. */
+TEST_F (GuidTableTest, SharedPrefix)
+{
+    for (size_t i = 0; i < t_guids.size(); ++i)
+    {
+        std::memcpy (t_guids[i].reserved, t_guids[0].reserved, 8);
+        t_table.insert(t_guids[i], &t_values[i]);
+    }
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        EXPECT_EQ (&t_values[i], t_table.lookup(t_guids[i]));
+}
+
+TEST_F (GuidTableTest, Values)
+{
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        t_table.insert(t_guids[i], &t_values[i]);
+    auto values = t_table.values();
+    EXPECT_EQ (t_guids.size(), values.size());
+    for (auto& val : t_values)
+        EXPECT_NE (values.end(), std::find (values.begin(), values.end(), &val));
+}
+
+TEST_F (GuidTableTest, ForEach)
+{
+    for (size_t i = 0; i < t_guids.size(); ++i)
+        t_table.insert(t_guids[i], &t_values[i]);
+    std::vector<void*> seen;
+    t_table.for_each([&seen](void* val) { seen.push_back(val); });
+    auto values = t_table.values();
+    EXPECT_EQ (values, seen);
+
+    /* The chunks together see each value once, in the same order. */
+    seen.clear();
+    for (size_t chunk = 0; chunk < 7; ++chunk)
+        t_table.for_each_in_chunk(chunk, 7,
+                                  [&seen](void* val) { seen.push_back(val); });
+    EXPECT_EQ (values, seen);
+}
@@ -195,6 +195,31 @@ TEST_F (KvpFrameTest, GetSlotPath)
     EXPECT_EQ (v1, t_root.get_slot(path3a));
 }
 
+TEST_F (KvpFrameTest, PrecompiledPath)
+{
+    KvpPath path1 {"/top//second/twenty-first"};
+    KvpPath path2 {"top/third/thirty-first"};
+    KvpPath path3 {"top/second/twenty/twenty-first"};
+    KvpPath copy {path3};
+    auto v1 = new KvpValueImpl {15.0};
+    auto v2 = new KvpValueImpl { (int64_t)52};
+
+    EXPECT_EQ (3u, path1.keys().size());
+    EXPECT_TRUE (KvpPath{"//"}.empty());
+    EXPECT_EQ (t_int_val, t_root.get_slot(KvpPath{"top/first"}));
+    EXPECT_EQ (nullptr, t_root.set(path1, v1));
+    EXPECT_EQ (v1, t_root.get_slot("top/second/twenty-first"));
+    EXPECT_EQ (v1, t_root.get_slot("top//second/twenty-first/"));
+    EXPECT_EQ (v1, t_root.set(path1, v2));
+    EXPECT_EQ (nullptr, t_root.set(path2, v1));
+    EXPECT_EQ (nullptr, t_root.get_slot(path2));
+    EXPECT_EQ (nullptr, t_root.set(path3, v1));
+    EXPECT_EQ (nullptr, t_root.set_path(copy, v1));
+    EXPECT_EQ (v1, t_root.get_slot(path3));
+    EXPECT_EQ (v1, t_root.get_slot("top/second/twenty//twenty-first"));
+    EXPECT_EQ (v2, t_root.get_slot(path1));
+}
+
 TEST_F (KvpFrameTest, Empty)
 {
     KvpFrameImpl f1, f2;
@@ -202,3 +227,46 @@ TEST_F (KvpFrameTest, Empty)
     EXPECT_TRUE(f1.empty());
     EXPECT_FALSE(f2.empty());
 }
+
+TEST_F (KvpFrameTest, ManySlots)
+{
+    KvpFrameImpl f1;
+    std::vector<std::string> keys;
+    for (int64_t i = 0; i < 40; ++i)
+        keys.push_back(std::string{"slot-"} + std::to_string(100 - i));
+    for (size_t i = 0; i < keys.size(); ++i)
+        EXPECT_EQ (nullptr, f1.set(keys[i].c_str(), new KvpValue {int64_t(i)}));
+    for (size_t i = 0; i < keys.size(); ++i)
+        EXPECT_EQ (int64_t(i), f1.get_slot(keys[i].c_str())->get<int64_t>());
+    auto got = f1.get_keys();
+    EXPECT_EQ (keys.size(), got.size());
+    EXPECT_TRUE (std::is_sorted(got.begin(), got.end()));
+    KvpFrameImpl f2 {f1};
+    EXPECT_EQ (0, compare(f1, f2));
+    delete f2.set(keys[0].c_str(), nullptr);
+    EXPECT_EQ (nullptr, f2.get_slot(keys[0].c_str()));
+    EXPECT_EQ (1, compare(f1, f2));
+}
+
+TEST_F (KvpFrameTest, MemoryUsage)
+{
+    KvpMemoryUsage empty {0, 0, 0};
+    KvpFrameImpl f1;
+    f1.add_memory_usage(empty);
+    EXPECT_EQ (1u, empty.frames);
+    EXPECT_EQ (0u, empty.values);
+
+    KvpMemoryUsage usage {0, 0, 0};
+    /* t_root holds the frame "top", whose three values include another
+     * frame. */
+    t_root.add_memory_usage(usage);
+    EXPECT_LT (empty.bytes, usage.bytes);
+    EXPECT_EQ (3u, usage.frames);
+    EXPECT_EQ (4u, usage.values);
+
+    KvpMemoryUsage longer {0, 0, 0};
+    t_root.set("string", new KvpValue {g_strdup(std::string(1000, 'x').c_str())});
+    t_root.add_memory_usage(longer);
+    EXPECT_EQ (5u, longer.values);
+    EXPECT_LE (usage.bytes + sizeof(KvpValue) + 1001, longer.bytes);
+}
@@ -77,8 +77,94 @@ test_qof_string_cache( void )
     g_assert(str1_1 != str1_4);
 }
 
+static void
+test_qof_string_cache_stats( void )
+{
+    guint entries, more_entries;
+    guint64 refs, more_refs;
+    gsize bytes, more_bytes;
+    gchar* cached;
+
+    qof_string_cache_stats(&entries, &refs, &bytes);
+    cached = qof_string_cache_insert("a string only the stats test uses");
+    qof_string_cache_insert(cached);
+    qof_string_cache_stats(&more_entries, &more_refs, &more_bytes);
+    g_assert_cmpuint(more_entries, ==, entries + 1);
+    g_assert_cmpuint(more_refs, ==, refs + 2);
+    g_assert_cmpuint(more_bytes, >, bytes + strlen(cached));
+    qof_string_cache_remove(cached);
+    qof_string_cache_remove(cached);
+    qof_string_cache_stats(&more_entries, NULL, NULL);
+    g_assert_cmpuint(more_entries, ==, entries);
+}
+
+#define CACHE_TEST_THREADS 8
+#define CACHE_TEST_STRINGS 1000
+#define CACHE_TEST_REPS 200
+
+static gchar* cache_test_strings[CACHE_TEST_STRINGS];
+
+/* Each thread takes and drops a reference to every string in the shared set
+ * many times, so the shards see concurrent inserts and removes of the same
+ * keys. */
+static gpointer
+string_cache_thread (gpointer data)
+{
+    gint rep, i;
+    for (rep = 0; rep < CACHE_TEST_REPS; ++rep)
+        for (i = 0; i < CACHE_TEST_STRINGS; ++i)
+        {
+            gpointer cached = qof_string_cache_insert (cache_test_strings[i]);
+            if (strcmp (cached, cache_test_strings[i]) != 0)
+                return GINT_TO_POINTER (1);
+            qof_string_cache_remove (cached);
+        }
+    return NULL;
+}
+
+/* Runs CACHE_TEST_THREADS of them while the test holds a reference to each
+ * string, which must survive. */
+static void
+test_qof_string_cache_threads( void )
+{
+    GThread* threads[CACHE_TEST_THREADS];
+    gpointer held[CACHE_TEST_STRINGS];
+    gint i;
+
+    for (i = 0; i < CACHE_TEST_STRINGS; ++i)
+    {
+        cache_test_strings[i] = g_strdup_printf ("cache-test-%d", i);
+        held[i] = qof_string_cache_insert (cache_test_strings[i]);
+    }
+
+    g_assert (string_cache_thread (NULL) == NULL);
+    for (i = 0; i < CACHE_TEST_THREADS; ++i)
+#ifndef HAVE_GLIB_2_32
+        threads[i] = g_thread_create (string_cache_thread, NULL, TRUE, NULL);
+#else
+        threads[i] = g_thread_new ("string-cache", string_cache_thread, NULL);
+#endif
+    for (i = 0; i < CACHE_TEST_THREADS; ++i)
+        g_assert (g_thread_join (threads[i]) == NULL);
+
+    /* The references taken before the threads ran must still be the
+     * cached copies. */
+    for (i = 0; i < CACHE_TEST_STRINGS; ++i)
+    {
+        gpointer cached = qof_string_cache_insert (cache_test_strings[i]);
+        g_assert (cached == held[i]);
+        qof_string_cache_remove (cached);
+        qof_string_cache_remove (held[i]);
+        g_free (cache_test_strings[i]);
+    }
+}
+
 void
 test_suite_qof_string_cache ( void )
 {
     GNC_TEST_ADD_FUNC( suitename, "string-cache", test_qof_string_cache);
+    GNC_TEST_ADD_FUNC( suitename, "string-cache-stats",
+                       test_qof_string_cache_stats);
+    GNC_TEST_ADD_FUNC( suitename, "string-cache-threads",
+                       test_qof_string_cache_threads);
 }
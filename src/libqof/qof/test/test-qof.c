@@ -30,6 +30,7 @@ extern void test_suite_qofinstance();
 extern void test_suite_qofobject();
 extern void test_suite_gnc_date();
 extern void test_suite_qof_string_cache();
+extern void test_suite_qoflog();
 
 int
 main (int   argc,
@@ -46,6 +47,7 @@ main (int   argc,
     test_suite_qofobject();
     test_suite_gnc_date();
     test_suite_qof_string_cache();
+    test_suite_qoflog();
 
     return g_test_run( );
 }
@@ -769,6 +769,35 @@ test_book_get_collection( Fixture *fixture, gconstpointer pData )
     g_assert( m_col == m_col2 );
 }
 
+static void
+test_book_get_collection_by_id( Fixture *fixture, gconstpointer pData )
+{
+    QofIdType my_type = "my id type";
+    gint type_id;
+    QofCollection *m_col;
+
+    g_test_message( "Testing type IDs" );
+    g_assert_cmpint( qof_object_get_type_id( NULL ), ==, -1 );
+    type_id = qof_object_get_type_id( my_type );
+    g_assert_cmpint( type_id, >=, 0 );
+    g_assert_cmpint( qof_object_get_type_id( "my id type" ), ==, type_id );
+    g_assert_cmpstr( qof_object_get_type_name( type_id ), ==, my_type );
+    g_assert( qof_object_get_type_name( -1 ) == NULL );
+    g_assert_cmpint( qof_object_get_type_id( "my other id type" ), !=, type_id );
+
+    g_test_message( "Testing when book is null or the ID is bad" );
+    g_assert( qof_book_get_collection_by_id( NULL, type_id ) == NULL );
+    g_assert( qof_book_get_collection_by_id( fixture->book, -1 ) == NULL );
+    g_assert( qof_book_get_collection_by_id( fixture->book, G_MAXINT ) == NULL );
+
+    g_test_message( "Testing that both lookups find the same collection" );
+    m_col = qof_book_get_collection_by_id( fixture->book, type_id );
+    g_assert( m_col != NULL );
+    g_assert_cmpstr( qof_collection_get_type( m_col ), ==, my_type );
+    g_assert( qof_book_get_collection( fixture->book, my_type ) == m_col );
+    g_assert( qof_book_get_collection_by_id( fixture->book, type_id ) == m_col );
+}
+
 static void
 test_book_foreach_collection( Fixture *fixture, gconstpointer pData )
 {
@@ -885,6 +914,98 @@ test_book_mark_closed( Fixture *fixture, gconstpointer pData )
     g_assert_cmpstr( &fixture->book->book_open, == , "n" );
 }
 
+static gpointer
+snapshot_writer_thread( gpointer data )
+{
+    QofBook *book = data;
+
+    qof_book_begin_write( book );
+    qof_book_end_write( book );
+    return GINT_TO_POINTER( qof_book_get_generation( book ) );
+}
+
+static void
+test_book_snapshots( Fixture *fixture, gconstpointer pData )
+{
+    QofBookSnapshot *snapshot;
+    GThread *writer;
+    gint generation;
+
+    g_test_message( "Testing a book without snapshots" );
+    g_assert( !qof_book_snapshots_enabled( fixture->book ) );
+    g_assert( qof_book_snapshot_take( fixture->book ) == NULL );
+    qof_book_begin_write( fixture->book );
+    qof_book_end_write( fixture->book );
+
+    g_test_message( "Testing the generation" );
+    qof_book_enable_snapshots( fixture->book );
+    g_assert( qof_book_snapshots_enabled( fixture->book ) );
+    generation = qof_book_get_generation( fixture->book );
+    qof_book_begin_write( fixture->book );
+    qof_book_begin_write( fixture->book );
+    qof_book_end_write( fixture->book );
+    g_assert_cmpint( qof_book_get_generation( fixture->book ), == , generation );
+    qof_book_end_write( fixture->book );
+    g_assert_cmpint( qof_book_get_generation( fixture->book ), == , generation + 1 );
+
+    g_test_message( "Testing that a write waits for the snapshot" );
+    snapshot = qof_book_snapshot_take( fixture->book );
+    g_assert( qof_book_snapshot_get_book( snapshot ) == fixture->book );
+    g_assert_cmpint( qof_book_snapshot_get_generation( snapshot ), == , generation + 1 );
+    g_assert( qof_book_snapshot_ref( snapshot ) == snapshot );
+#ifndef HAVE_GLIB_2_32
+    writer = g_thread_create( snapshot_writer_thread, fixture->book, TRUE, NULL );
+#else
+    writer = g_thread_new( "snapshot-writer", snapshot_writer_thread, fixture->book );
+#endif
+    g_usleep( G_USEC_PER_SEC / 10 );
+    g_assert_cmpint( qof_book_get_generation( fixture->book ), == , generation + 1 );
+    qof_book_snapshot_unref( snapshot );
+    g_usleep( G_USEC_PER_SEC / 10 );
+    g_assert_cmpint( qof_book_get_generation( fixture->book ), == , generation + 1 );
+    qof_book_snapshot_unref( snapshot );
+    g_assert_cmpint( GPOINTER_TO_INT( g_thread_join( writer ) ), == , generation + 2 );
+}
+
+static void
+test_book_memory_usage( Fixture *fixture, gconstpointer pData )
+{
+    GList *usage, *subtrees, *node;
+    QofBookTypeMemory *book_usage = NULL;
+    QofKvpSubtreeMemory *largest;
+    gchar *big = g_strnfill( 4096, 'x' );
+
+    g_test_message( "Testing the book's own instance and slots" );
+    qof_book_set_string_option( fixture->book, "small", "x" );
+    qof_book_set_string_option( fixture->book, "big", big );
+    usage = qof_book_get_memory_usage( fixture->book );
+    g_assert( usage );
+    for ( node = usage; node; node = node->next )
+    {
+        QofBookTypeMemory *type = node->data;
+        if ( g_strcmp0( type->type, QOF_ID_BOOK ) == 0 )
+            book_usage = type;
+    }
+    g_assert( book_usage );
+    g_assert_cmpint( book_usage->instances, == , 1 );
+    g_assert_cmpint( book_usage->instance_bytes, >= , sizeof( QofBook ) );
+    g_assert_cmpint( book_usage->kvp_values, >= , 2 );
+    g_assert_cmpint( book_usage->kvp_bytes, > , 4096 );
+    g_list_free_full( usage, g_free );
+
+    g_test_message( "Testing the largest subtrees" );
+    subtrees = qof_book_get_largest_kvp_subtrees( fixture->book, 1 );
+    g_assert_cmpint( g_list_length( subtrees ), == , 1 );
+    largest = subtrees->data;
+    g_assert_cmpstr( largest->type, == , QOF_ID_BOOK );
+    g_assert_cmpstr( largest->key, == , "big" );
+    g_assert( guid_equal( &largest->guid,
+                          qof_instance_get_guid( QOF_INSTANCE( fixture->book ) ) ) );
+    g_assert_cmpint( largest->bytes, > , 4096 );
+    qof_book_free_kvp_subtrees( subtrees );
+    g_free( big );
+}
+
 static void
 test_book_new_destroy( void )
 {
@@ -941,8 +1062,11 @@ test_suite_qofbook ( void )
     GNC_TEST_ADD( suitename, "shutting down", Fixture, NULL, setup, test_book_shutting_down, teardown );
     GNC_TEST_ADD( suitename, "set get data", Fixture, NULL, setup, test_book_set_get_data, teardown );
     GNC_TEST_ADD( suitename, "get collection", Fixture, NULL, setup, test_book_get_collection, teardown );
+    GNC_TEST_ADD( suitename, "get collection by id", Fixture, NULL, setup, test_book_get_collection_by_id, teardown );
     GNC_TEST_ADD( suitename, "foreach collection", Fixture, NULL, setup, test_book_foreach_collection, teardown );
     GNC_TEST_ADD_FUNC( suitename, "set data finalizers", test_book_set_data_fin );
     GNC_TEST_ADD( suitename, "mark closed", Fixture, NULL, setup, test_book_mark_closed, teardown );
+    GNC_TEST_ADD( suitename, "snapshots", Fixture, NULL, setup, test_book_snapshots, teardown );
+    GNC_TEST_ADD( suitename, "memory usage", Fixture, NULL, setup, test_book_memory_usage, teardown );
     GNC_TEST_ADD_FUNC( suitename, "book new and destroy", test_book_new_destroy );
 }
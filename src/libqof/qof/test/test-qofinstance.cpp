@@ -28,7 +28,9 @@ extern "C"
 #include <unittest-support.h>
 #include "../qof.h"
 #include "../qofbackend-p.h"
+#include "../qofinstance-p.h"
 }
+#include "../kvp-value.hpp"
 #include "../kvp_frame.hpp"
 static const gchar *suitename = "/qof/qofinstance";
 extern "C" void test_suite_qofinstance ( void );
@@ -265,6 +267,42 @@ test_instance_get_set_slots( Fixture *fixture, gconstpointer pData )
 
 }
 
+static void
+test_instance_get_kvp_typed( Fixture *fixture, gconstpointer pData )
+{
+    auto frame = qof_instance_get_slots( fixture->inst );
+    auto guid = guid_new();
+    gnc_numeric num = gnc_numeric_create( 123, 100 ), num_out = gnc_numeric_zero();
+    gint64 int_out = 7;
+
+    frame->set_path( "a/string", new KvpValue{g_strdup( "a value" )} );
+    frame->set( "int", new KvpValue{INT64_C(42)} );
+    frame->set( "numeric", new KvpValue{num} );
+    frame->set( "guid", new KvpValue{guid_copy( guid )} );
+
+    g_test_message( "Test that each slot comes back as its own type" );
+    auto str = qof_instance_get_kvp_string( fixture->inst, "a/string" );
+    g_assert( str == frame->get_slot( "a/string" )->get<const char*>() );
+    g_assert_cmpstr( str, ==, "a value" );
+    g_assert( qof_instance_get_kvp_int64( fixture->inst, "int", &int_out ) );
+    g_assert_cmpint( int_out, ==, 42 );
+    g_assert( qof_instance_get_kvp_numeric( fixture->inst, "numeric", &num_out ) );
+    g_assert( gnc_numeric_equal( num, num_out ) );
+    g_assert( guid_equal( guid, qof_instance_get_kvp_guid( fixture->inst, "guid" ) ) );
+
+    g_test_message( "Test missing slots and slots of another type" );
+    int_out = 7;
+    g_assert( qof_instance_get_kvp_string( fixture->inst, "int" ) == NULL );
+    g_assert( qof_instance_get_kvp_string( fixture->inst, "a/none" ) == NULL );
+    g_assert( !qof_instance_get_kvp_int64( fixture->inst, "a/string", &int_out ) );
+    g_assert( !qof_instance_get_kvp_int64( fixture->inst, "none", &int_out ) );
+    g_assert_cmpint( int_out, ==, 7 );
+    g_assert( !qof_instance_get_kvp_numeric( fixture->inst, "int", &num_out ) );
+    g_assert( gnc_numeric_equal( num, num_out ) );
+    g_assert( qof_instance_get_kvp_guid( fixture->inst, "numeric" ) == NULL );
+    guid_free( guid );
+}
+
 static void
 test_instance_version_cmp( void )
 {
@@ -1038,7 +1076,205 @@ test_instance_get_referring_object_list( void )
     qof_book_destroy( book );
 }
 
-extern "C" void
+extern "C" static void
+count_event_handler( QofInstance *inst, QofEventId event_type,
+                     gpointer user_data, gpointer event_data )
+{
+    (*static_cast<guint*>(user_data))++;
+}
+
+static void
+test_instance_typed_event_handler( void )
+{
+    QofInstance *watched;
+    QofInstance *other;
+    QofBook *book;
+    guint all_count = 0, typed_count = 0, masked_count = 0;
+    gint all_id, typed_id, masked_id;
+
+    /* setup */
+    watched = static_cast<QofInstance*>(g_object_new( QOF_TYPE_INSTANCE, NULL ));
+    other = static_cast<QofInstance*>(g_object_new( QOF_TYPE_INSTANCE, NULL ));
+    book = qof_book_new();
+    qof_instance_init_data( watched, "watched type", book );
+    qof_instance_init_data( other, "other type", book );
+    all_id = qof_event_register_handler( count_event_handler, &all_count );
+    typed_id = qof_event_register_typed_handler( "watched type", 0,
+                                                 count_event_handler,
+                                                 &typed_count );
+    masked_id = qof_event_register_typed_handler( "watched type",
+                                                  QOF_EVENT_DESTROY,
+                                                  count_event_handler,
+                                                  &masked_count );
+    g_assert_cmpint( all_id, != , typed_id );
+    g_assert_cmpint( typed_id, != , masked_id );
+
+    g_test_message( "Test that typed handlers only see their own type" );
+    qof_event_gen( other, QOF_EVENT_MODIFY, NULL );
+    qof_event_gen( watched, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( all_count, == , 2 );
+    g_assert_cmpuint( typed_count, == , 1 );
+    g_assert_cmpuint( masked_count, == , 0 );
+
+    g_test_message( "Test that the event mask is honoured" );
+    qof_event_gen( watched, QOF_EVENT_DESTROY, NULL );
+    g_assert_cmpuint( all_count, == , 3 );
+    g_assert_cmpuint( typed_count, == , 2 );
+    g_assert_cmpuint( masked_count, == , 1 );
+
+    g_test_message( "Test that unregistered typed handlers are not called" );
+    qof_event_unregister_handler( typed_id );
+    qof_event_gen( watched, QOF_EVENT_DESTROY, NULL );
+    g_assert_cmpuint( all_count, == , 4 );
+    g_assert_cmpuint( typed_count, == , 2 );
+    g_assert_cmpuint( masked_count, == , 2 );
+
+    /* clean */
+    qof_event_unregister_handler( masked_id );
+    qof_event_unregister_handler( all_id );
+    g_object_unref( watched );
+    g_object_unref( other );
+    qof_book_destroy( book );
+}
+
+static struct
+{
+    guint calls;
+    guint records;
+    QofEventId mask;
+} batch_struct;
+
+static void
+count_batch_handler( const QofEventRecord *events, guint n_events,
+                     gpointer user_data )
+{
+    batch_struct.calls++;
+    batch_struct.records += n_events;
+    for ( guint i = 0; i < n_events; i++ )
+        if ( events[i].entity == user_data )
+            batch_struct.mask |= events[i].event_mask;
+}
+
+static void
+test_instance_batch_events( void )
+{
+    QofInstance *first;
+    QofInstance *second;
+    QofBook *book;
+    guint count = 0;
+    gint id, batch_id;
+
+    /* setup */
+    first = static_cast<QofInstance*>(g_object_new( QOF_TYPE_INSTANCE, NULL ));
+    second = static_cast<QofInstance*>(g_object_new( QOF_TYPE_INSTANCE, NULL ));
+    book = qof_book_new();
+    qof_instance_init_data( first, "test type", book );
+    qof_instance_init_data( second, "test type", book );
+    batch_struct = { 0, 0, 0 };
+    id = qof_event_register_handler( count_event_handler, &count );
+    batch_id = qof_event_register_batch_handler( count_batch_handler, first );
+
+    g_test_message( "Test that events outside a batch are delivered at once" );
+    qof_event_gen( first, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( count, == , 1 );
+    g_assert_cmpuint( batch_struct.calls, == , 1 );
+
+    g_test_message( "Test that a batch coalesces repeated events" );
+    count = 0;
+    batch_struct = { 0, 0, 0 };
+    qof_event_begin_batch();
+    qof_event_begin_batch();
+    g_assert( qof_event_is_batching() );
+    for ( int i = 0; i < 100; i++ )
+    {
+        qof_event_gen( first, QOF_EVENT_MODIFY, NULL );
+        qof_event_gen( second, QOF_EVENT_MODIFY, NULL );
+    }
+    qof_event_gen( first, QOF_EVENT_ADD, NULL );
+    qof_event_end_batch();
+    g_assert_cmpuint( count, == , 0 );
+    qof_event_end_batch();
+    g_assert( !qof_event_is_batching() );
+    g_assert_cmpuint( count, == , 3 );
+    g_assert_cmpuint( batch_struct.calls, == , 1 );
+    g_assert_cmpuint( batch_struct.records, == , 2 );
+    g_assert_cmpint( batch_struct.mask, == , QOF_EVENT_MODIFY | QOF_EVENT_ADD );
+
+    g_test_message( "Test that a destroy delivers the entity's events first" );
+    count = 0;
+    batch_struct = { 0, 0, 0 };
+    qof_event_begin_batch();
+    qof_event_gen( first, QOF_EVENT_MODIFY, NULL );
+    qof_event_gen( second, QOF_EVENT_MODIFY, NULL );
+    qof_event_gen( first, QOF_EVENT_DESTROY, NULL );
+    g_assert_cmpuint( count, == , 2 );
+    g_assert_cmpint( batch_struct.mask, == , QOF_EVENT_MODIFY | QOF_EVENT_DESTROY );
+    qof_event_end_batch();
+    g_assert_cmpuint( count, == , 3 );
+    g_assert_cmpuint( batch_struct.records, == , 3 );
+
+    /* clean */
+    qof_event_unregister_handler( batch_id );
+    qof_event_unregister_handler( id );
+    g_object_unref( first );
+    g_object_unref( second );
+    qof_book_destroy( book );
+}
+
+static void
+test_instance_event_contexts( void )
+{
+    QofInstance *inst;
+    QofBook *book;
+    QofEventContext *ctx;
+    guint shared_count = 0, own_count = 0;
+    gint shared_id, own_id;
+
+    /* setup */
+    inst = static_cast<QofInstance*>(g_object_new( QOF_TYPE_INSTANCE, NULL ));
+    book = qof_book_new();
+    qof_instance_init_data( inst, "test type", book );
+    shared_id = qof_event_register_handler( count_event_handler, &shared_count );
+    ctx = qof_event_context_new();
+
+    g_test_message( "Test that a thread's own context has handlers of its own" );
+    g_assert( qof_event_set_thread_context( ctx ) == NULL );
+    own_id = qof_event_register_handler( count_event_handler, &own_count );
+    qof_event_gen( inst, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( shared_count, == , 0 );
+    g_assert_cmpuint( own_count, == , 1 );
+
+    g_test_message( "Test that suspensions and batches stay in their context" );
+    qof_event_suspend();
+    qof_event_begin_batch();
+    g_assert( qof_event_set_thread_context( NULL ) == ctx );
+    g_assert( !qof_event_is_batching() );
+    qof_event_gen( inst, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( shared_count, == , 1 );
+    g_assert_cmpuint( own_count, == , 1 );
+    qof_event_set_thread_context( ctx );
+    g_assert( qof_event_is_batching() );
+    qof_event_end_batch();
+    qof_event_resume();
+
+    g_test_message( "Test that handlers are unregistered from their context" );
+    qof_event_set_thread_context( NULL );
+    qof_event_unregister_handler( shared_id );
+    qof_event_gen( inst, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( shared_count, == , 1 );
+    qof_event_set_thread_context( ctx );
+    qof_event_gen( inst, QOF_EVENT_MODIFY, NULL );
+    g_assert_cmpuint( own_count, == , 2 );
+
+    /* clean */
+    qof_event_unregister_handler( own_id );
+    qof_event_set_thread_context( NULL );
+    qof_event_context_destroy( ctx );
+    g_object_unref( inst );
+    qof_book_destroy( book );
+}
+
+void
 test_suite_qofinstance ( void )
 {
     GNC_TEST_ADD( suitename, "set get book", Fixture, NULL, setup, test_instance_set_get_book, teardown );
@@ -1046,6 +1282,7 @@ test_suite_qofinstance ( void )
     GNC_TEST_ADD_FUNC( suitename, "instance new and destroy", test_instance_new_destroy );
     GNC_TEST_ADD_FUNC( suitename, "init data", test_instance_init_data );
     GNC_TEST_ADD( suitename, "get set slots", Fixture, NULL, setup, test_instance_get_set_slots, teardown );
+    GNC_TEST_ADD( suitename, "get kvp typed", Fixture, NULL, setup, test_instance_get_kvp_typed, teardown );
     GNC_TEST_ADD_FUNC( suitename, "version compare", test_instance_version_cmp );
     GNC_TEST_ADD( suitename, "get set dirty", Fixture, NULL, setup, test_instance_get_set_dirty, teardown );
     GNC_TEST_ADD( suitename, "display name", Fixture, NULL, setup, test_instance_display_name, teardown );
@@ -1056,4 +1293,7 @@ test_suite_qofinstance ( void )
     GNC_TEST_ADD_FUNC( suitename, "instance get referring object list from collection", test_instance_get_referring_object_list_from_collection );
     GNC_TEST_ADD_FUNC( suitename, "instance get typed referring object list", test_instance_get_typed_referring_object_list);
     GNC_TEST_ADD_FUNC( suitename, "instance get referring object list", test_instance_get_referring_object_list );
+    GNC_TEST_ADD_FUNC( suitename, "typed event handler", test_instance_typed_event_handler );
+    GNC_TEST_ADD_FUNC( suitename, "batch events", test_instance_batch_events );
+    GNC_TEST_ADD_FUNC( suitename, "event contexts", test_instance_event_contexts );
 }
@@ -0,0 +1,110 @@
+/********************************************************************
+ * test-qoflog.c: GLib g_test test suite for the tracing in qoflog  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+\********************************************************************/
+
+#include "config.h"
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unittest-support.h>
+#include "qof.h"
+
+static const gchar *suitename = "/qof/qoflog";
+void test_suite_qoflog ( void );
+
+static gchar *
+trace_contents ( void )
+{
+    gchar *filename = g_build_filename (g_get_tmp_dir (),
+                                        "test-qoflog-trace.json", NULL);
+    gchar *contents = NULL;
+
+    g_assert (qof_trace_write (filename));
+    g_assert (g_file_get_contents (filename, &contents, NULL, NULL));
+    g_unlink (filename);
+    g_free (filename);
+    return contents;
+}
+
+static gpointer
+trace_thread ( gpointer data )
+{
+    QOF_TRACE_BEGIN (start);
+    QOF_TRACE_END (start, "thread \"event\"");
+    return NULL;
+}
+
+static void
+test_qof_trace( void )
+{
+    GThread *thread;
+    gchar *contents;
+    gint i;
+
+    g_test_message ("Testing that nothing is recorded while tracing is off");
+    qof_trace_clear ();
+    g_assert (!qof_trace_enabled ());
+    g_assert_cmpint (qof_trace_begin (), ==, 0);
+    QOF_TRACE_COUNTER ("off counter", 1);
+    contents = trace_contents ();
+    g_assert_cmpstr (contents, ==, "{\"traceEvents\":[\n]}\n");
+    g_free (contents);
+
+    g_test_message ("Testing timed events and counters");
+    qof_trace_set_enabled (TRUE);
+    {
+        QOF_TRACE_BEGIN (start);
+        g_assert (start != 0);
+        g_usleep (1000);
+        QOF_TRACE_END (start, "timed");
+    }
+    QOF_TRACE_COUNTER ("counter", 42);
+#ifndef HAVE_GLIB_2_32
+    thread = g_thread_create (trace_thread, NULL, TRUE, NULL);
+#else
+    thread = g_thread_new ("trace", trace_thread, NULL);
+#endif
+    g_thread_join (thread);
+    contents = trace_contents ();
+    g_assert (strstr (contents, "{\"name\":\"timed\",\"ph\":\"X\","));
+    g_assert (strstr (contents, "{\"name\":\"counter\",\"ph\":\"C\","));
+    g_assert (strstr (contents, "\"args\":{\"value\":42}}"));
+    g_assert (strstr (contents, "{\"name\":\"thread \\\"event\\\"\""));
+    g_assert (!strstr (contents, "off counter"));
+    g_free (contents);
+
+    g_test_message ("Testing that the buffer keeps the latest events");
+    qof_trace_clear ();
+    for (i = 0; i < QOF_TRACE_BUFFER_SIZE + 1; ++i)
+        qof_trace_counter (i ? "later" : "first", i);
+    contents = trace_contents ();
+    g_assert (!strstr (contents, "first"));
+    g_assert (strstr (contents, "\"args\":{\"value\":16384}}"));
+    g_free (contents);
+
+    qof_trace_set_enabled (FALSE);
+    qof_trace_clear ();
+}
+
+void
+test_suite_qoflog ( void )
+{
+    GNC_TEST_ADD_FUNC( suitename, "trace", test_qof_trace);
+}
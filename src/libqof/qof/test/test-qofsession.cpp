@@ -32,6 +32,7 @@
 static QofBook * exported_book {nullptr};
 static bool safe_sync_called {false};
 static bool sync_called {false};
+static bool background_sync_called {false};
 static bool load_error {true};
 static bool hook_called {false};
 static bool data_loaded {false};
@@ -56,6 +57,11 @@ void test_sync (QofBackend *, QofBook *)
     sync_called = true;
 }
 
+void test_background_sync (QofBackend *, QofBook *)
+{
+    background_sync_called = true;
+}
+
 void test_export_fn (QofBackend *, QofBook * book)
 {
     exported_book = book;
@@ -70,6 +76,7 @@ QofBackend * test_backend_factory ()
     ret->load = &test_load;
     ret->sync = &test_sync;
     ret->safe_sync = &test_safe_sync;
+    ret->background_sync = &test_background_sync;
     ret->export_fn = &test_export_fn;
     ret->error_msg = nullptr;
     ret->fullpath = nullptr;
@@ -195,6 +202,24 @@ TEST (QofSessionTest, save)
     sync_called = false;
 }
 
+TEST (QofSessionTest, save_in_background)
+{
+    qof_backend_register_provider (get_provider ());
+    QofSession s;
+    s.begin ("book1", false, false, false);
+    s.save_in_background (nullptr);
+    EXPECT_EQ (background_sync_called, true);
+    EXPECT_EQ (sync_called, false);
+    background_sync_called = false;
+    /* Without background writes the backend just syncs. */
+    qof_book_get_backend (s.get_book ())->background_sync = nullptr;
+    s.save_in_background (nullptr);
+    EXPECT_EQ (sync_called, true);
+    EXPECT_EQ (background_sync_called, false);
+    qof_backend_unregister_all_providers ();
+    sync_called = false;
+}
+
 TEST (QofSessionTest, safe_save)
 {
     qof_backend_register_provider (get_provider ());
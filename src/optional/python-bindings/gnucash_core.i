@@ -80,6 +80,7 @@
 #include "gncTaxTable.h"
 #include "gncIDSearch.h"
 #include "engine/gnc-pricedb.h"
+#include "gnc-columnar-export.h"
 #include "app-utils/gnc-prefs-utils.h"
 #include "cap-gains.h"
 #include "Scrub3.h"
@@ -89,6 +90,9 @@
 
 %include <base-typemaps.i>
 
+/* Wrapped below for sequences of Transaction objects. */
+%ignore xaccTransVoidMany;
+%ignore xaccTransReverseMany;
 %include <engine-common.i>
 
 %include <qofbackend.h>
@@ -215,6 +219,244 @@ static const GncGUID * gncEntryGetGUID(GncEntry *x);
 
 %include <cap-gains.h>
 %include <Scrub3.h>
+%include <gnc-columnar-export.h>
+
+/* Bulk export of an account's splits, so that scripts summarizing a long
+ * history need not wrap every Split and GncNumeric.  Each column is a
+ * bytearray in native byte order that numpy.frombuffer() takes as is:
+ * post_date, amount_num, amount_denom, value_num and value_denom hold an
+ * int64 per split, guid and trans_guid GUID_DATA_SIZE bytes per split. */
+%inline %{
+static char *
+split_arrays_add_column (PyObject *dict, const char *name, Py_ssize_t size)
+{
+    PyObject *column = PyByteArray_FromStringAndSize (NULL, size);
+    int failed;
+
+    if (column == NULL)
+        return NULL;
+    failed = PyDict_SetItemString (dict, name, column);
+    /* The dict keeps the column alive */
+    Py_DECREF (column);
+    return failed ? NULL : PyByteArray_AS_STRING (column);
+}
+
+static PyObject *
+gnc_account_get_split_arrays (const Account *account)
+{
+    GList *splits = xaccAccountGetSplitList (account), *node;
+    Py_ssize_t n = g_list_length (splits), i = 0;
+    PyObject *dict = PyDict_New ();
+    gint64 *post_date, *amount_num, *amount_denom, *value_num, *value_denom;
+    char *guid, *trans_guid;
+
+    if (dict == NULL)
+        return NULL;
+    post_date = (gint64 *) split_arrays_add_column (dict, "post_date",
+                                                    n * sizeof (gint64));
+    amount_num = (gint64 *) split_arrays_add_column (dict, "amount_num",
+                                                     n * sizeof (gint64));
+    amount_denom = (gint64 *) split_arrays_add_column (dict, "amount_denom",
+                                                       n * sizeof (gint64));
+    value_num = (gint64 *) split_arrays_add_column (dict, "value_num",
+                                                    n * sizeof (gint64));
+    value_denom = (gint64 *) split_arrays_add_column (dict, "value_denom",
+                                                      n * sizeof (gint64));
+    guid = split_arrays_add_column (dict, "guid", n * GUID_DATA_SIZE);
+    trans_guid = split_arrays_add_column (dict, "trans_guid",
+                                          n * GUID_DATA_SIZE);
+    if (!post_date || !amount_num || !amount_denom || !value_num ||
+        !value_denom || !guid || !trans_guid)
+    {
+        Py_DECREF (dict);
+        return NULL;
+    }
+
+    for (node = splits; node; node = node->next, i++)
+    {
+        Split *split = node->data;
+        Transaction *trans = xaccSplitGetParent (split);
+        gnc_numeric amount = xaccSplitGetAmount (split);
+        gnc_numeric value = xaccSplitGetValue (split);
+
+        post_date[i] = trans ? xaccTransGetDate (trans) : 0;
+        amount_num[i] = amount.num;
+        amount_denom[i] = amount.denom;
+        value_num[i] = value.num;
+        value_denom[i] = value.denom;
+        memcpy (guid + i * GUID_DATA_SIZE,
+                qof_instance_get_guid (QOF_INSTANCE (split)), GUID_DATA_SIZE);
+        if (trans)
+            memcpy (trans_guid + i * GUID_DATA_SIZE,
+                    qof_instance_get_guid (QOF_INSTANCE (trans)),
+                    GUID_DATA_SIZE);
+        else
+            memset (trans_guid + i * GUID_DATA_SIZE, 0, GUID_DATA_SIZE);
+    }
+    return dict;
+}
+%}
+
+/* Batch posting for billing runs; see gncInvoicePostListToAccount().
+ * invoices is a sequence of Invoice or Bill objects, and the ones that
+ * could not be posted are returned as a list of those same objects. */
+%inline %{
+static PyObject *
+gnc_account_post_invoices (Account *acc, PyObject *invoices,
+                           Timespec *post_date, Timespec *due_date,
+                           const char *memo, gboolean accumulatesplits,
+                           gboolean autopay)
+{
+    PyObject *seq = PySequence_Fast (invoices, "invoices must be a sequence");
+    PyObject *result;
+    GHashTable *objects;
+    GList *list = NULL, *failed, *node;
+    Py_ssize_t i;
+
+    if (seq == NULL)
+        return NULL;
+    objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (i = PySequence_Fast_GET_SIZE (seq) - 1; i >= 0; i--)
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM (seq, i);
+        PyObject *instance = PyObject_GetAttrString (item, "instance");
+        void *invoice = NULL;
+        int res;
+
+        if (instance == NULL)
+        {
+            PyErr_Clear ();
+            instance = item;
+            Py_INCREF (instance);
+        }
+        res = SWIG_ConvertPtr (instance, &invoice, SWIGTYPE_p__gncInvoice, 0);
+        Py_DECREF (instance);
+        if (!SWIG_IsOK (res))
+        {
+            PyErr_SetString (PyExc_TypeError,
+                             "invoices must contain Invoice or Bill objects");
+            g_list_free (list);
+            g_hash_table_destroy (objects);
+            Py_DECREF (seq);
+            return NULL;
+        }
+        list = g_list_prepend (list, invoice);
+        g_hash_table_insert (objects, invoice, item);
+    }
+
+    failed = gncInvoicePostListToAccount (list, acc, post_date, due_date, memo,
+                                          accumulatesplits, autopay);
+    result = PyList_New (0);
+    for (node = failed; node && result; node = node->next)
+        if (PyList_Append (result, g_hash_table_lookup (objects, node->data)) < 0)
+        {
+            Py_DECREF (result);
+            result = NULL;
+        }
+    g_list_free (failed);
+    g_list_free (list);
+    g_hash_table_destroy (objects);
+    Py_DECREF (seq);
+    return result;
+}
+%}
+
+/* Bulk voiding and reversal, for rolling back a bad import; see
+ * xaccTransVoidMany() and xaccTransReverseMany().  transactions is a
+ * sequence of Transaction objects, all of them in book. */
+%{
+static GList *
+transactions_from_sequence (QofBook *book, PyObject *transactions)
+{
+    PyObject *seq = PySequence_Fast (transactions,
+                                     "transactions must be a sequence");
+    GList *list = NULL;
+    Py_ssize_t i;
+
+    if (seq == NULL)
+        return NULL;
+    for (i = PySequence_Fast_GET_SIZE (seq) - 1; i >= 0; i--)
+    {
+        PyObject *item = PySequence_Fast_GET_ITEM (seq, i);
+        PyObject *instance = PyObject_GetAttrString (item, "instance");
+        void *trans = NULL;
+        int res;
+
+        if (instance == NULL)
+        {
+            PyErr_Clear ();
+            instance = item;
+            Py_INCREF (instance);
+        }
+        res = SWIG_ConvertPtr (instance, &trans, SWIGTYPE_p_Transaction, 0);
+        Py_DECREF (instance);
+        if (!SWIG_IsOK (res) || trans == NULL)
+        {
+            PyErr_SetString (PyExc_TypeError,
+                             "transactions must contain Transaction objects");
+            break;
+        }
+        if (xaccTransGetBook (trans) != book)
+        {
+            PyErr_SetString (PyExc_ValueError,
+                             "transactions must belong to the book");
+            break;
+        }
+        list = g_list_prepend (list, trans);
+    }
+    Py_DECREF (seq);
+    if (PyErr_Occurred ())
+    {
+        g_list_free (list);
+        return NULL;
+    }
+    return list;
+}
+%}
+
+%inline %{
+static PyObject *
+gnc_book_void_transactions (QofBook *book, PyObject *transactions,
+                            const char *reason)
+{
+    GList *list = transactions_from_sequence (book, transactions);
+
+    if (PyErr_Occurred ())
+        return NULL;
+    xaccTransVoidMany (list, reason);
+    g_list_free (list);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+gnc_book_reverse_transactions (QofBook *book, PyObject *transactions)
+{
+    GList *list = transactions_from_sequence (book, transactions);
+    GList *reversed, *node;
+    PyObject *result;
+
+    if (PyErr_Occurred ())
+        return NULL;
+    reversed = xaccTransReverseMany (list);
+    result = PyList_New (0);
+    for (node = reversed; node && result; node = node->next)
+    {
+        PyObject *trans = SWIG_NewPointerObj (node->data,
+                                              SWIGTYPE_p_Transaction, 0);
+        if (trans == NULL || PyList_Append (result, trans) < 0)
+        {
+            Py_XDECREF (trans);
+            Py_DECREF (result);
+            result = NULL;
+            break;
+        }
+        Py_DECREF (trans);
+    }
+    g_list_free (reversed);
+    g_list_free (list);
+    return result;
+}
+%}
 
 %init %{
 gnc_environment_setup();
@@ -170,6 +170,12 @@ class Book(GnuCashCoreClass):
     Methods of interest
     get_root_account -- Returns the root level Account
     get_table -- Returns a commodity lookup table, of type GncCommodityTable
+    void_transactions -- Voids a list of Transactions in one batch, for
+      rolling back a bad import
+    reverse_transactions -- Reverses a list of Transactions in one batch
+      and returns the new ones
+    export_columnar -- Writes the accounts, transactions, splits, prices
+      and lots to a file of typed columns, see gnc-columnar-export.h
     """
     def InvoiceLookup(self, guid):
         from gnucash_business import Invoice
@@ -436,6 +442,17 @@ class Account(GnuCashCoreClass):
 
     These are not strings, they are attributes you can import from this
     module
+
+    get_split_arrays() returns the account's splits as a dict of columns,
+    each a bytearray for numpy.frombuffer(): post_date, amount_num,
+    amount_denom, value_num and value_denom as int64, guid and trans_guid
+    as 16 bytes per split.  It is much faster than walking GetSplitList()
+    for long histories.
+
+    post_invoices(invoices, post_date, due_date, memo, accumulate, autopay)
+    posts a list of invoices or bills to the account in one batch, as
+    PostToAccount() would one at a time, and returns the invoices that
+    could not be posted.
     """
     _new_instance = 'xaccMallocAccount'
 
@@ -499,6 +516,9 @@ Book.add_method('gnc_book_set_root_account', 'set_root_account')
 Book.add_method('gnc_commodity_table_get_table', 'get_table')
 Book.add_method('gnc_pricedb_get_db', 'get_price_db')
 Book.add_method('qof_book_increment_and_format_counter', 'increment_and_format_counter')
+Book.add_method('gnc_book_void_transactions', 'void_transactions')
+Book.add_method('gnc_book_reverse_transactions', 'reverse_transactions')
+Book.add_method('gnc_book_export_columnar', 'export_columnar')
 
 #Functions that return Account
 Book.get_root_account = method_function_returns_instance(
@@ -509,6 +529,9 @@ Book.get_table = method_function_returns_instance(
 #Functions that return GNCPriceDB
 Book.get_price_db = method_function_returns_instance(
     Book.get_price_db, GncPriceDB)
+#Functions that return lists of Transaction
+Book.reverse_transactions = method_function_returns_instance_list(
+    Book.reverse_transactions, Transaction)
 
 # GncNumeric
 GncNumeric.add_constructor_and_methods_with_prefix('gnc_numeric_', 'create')
@@ -1,5 +1,6 @@
 from unittest import main
 from datetime import datetime
+from struct import unpack
 from gnucash import Book, Account, Split, GncCommodity, GncNumeric, \
     Transaction
 
@@ -66,5 +67,39 @@ class TestAccount( AccountSession ):
         self.account.ScrubLots()
         self.assertEqual(len(self.account.GetLotList()),1)
 
+    def test_split_arrays(self):
+        other = Account(self.book)
+        self.account.SetCommodity(self.currency)
+        other.SetCommodity(self.currency)
+
+        tx = Transaction(self.book)
+        tx.BeginEdit()
+        tx.SetCurrency(self.currency)
+        tx.SetDatePostedTS(datetime.now())
+
+        s1 = Split(self.book)
+        s1.SetParent(tx)
+        s1.SetAccount(self.account)
+        s1.SetAmount(GncNumeric(-250, 100))
+        s1.SetValue(GncNumeric(-250, 100))
+
+        s2 = Split(self.book)
+        s2.SetParent(tx)
+        s2.SetAccount(other)
+        s2.SetAmount(GncNumeric(250, 100))
+        s2.SetValue(GncNumeric(250, 100))
+        tx.CommitEdit()
+
+        arrays = self.account.get_split_arrays()
+        self.assertEqual(len(arrays['guid']), 16)
+        self.assertEqual(unpack('=q', bytes(arrays['post_date']))[0],
+                         tx.GetDate())
+        self.assertEqual(unpack('=q', bytes(arrays['amount_num']))[0], -250)
+        self.assertEqual(unpack('=q', bytes(arrays['amount_denom']))[0], 100)
+        self.assertEqual(unpack('=q', bytes(arrays['value_num']))[0], -250)
+        self.assertEqual(unpack('=q', bytes(arrays['value_denom']))[0], 100)
+        self.assertEqual(len(Account(self.book).get_split_arrays()['value_num']),
+                         0)
+
 if __name__ == '__main__':
     main()
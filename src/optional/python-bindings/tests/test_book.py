@@ -1,4 +1,5 @@
 from unittest import TestCase, main
+import os, tempfile
 
 from gnucash import Session
 
@@ -13,5 +14,15 @@ class TestBook( BookSession ):
     def test_markclosed(self):
         self.ses.end()
 
+    def test_export_columnar(self):
+        fd, filename = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            self.assertTrue(self.book.export_columnar(filename, 0))
+            with open(filename, 'rb') as f:
+                self.assertEqual(f.read(8), b'GNCCOL\x00\x01')
+        finally:
+            os.remove(filename)
+
 if __name__ == '__main__':
     main()
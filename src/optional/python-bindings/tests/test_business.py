@@ -58,6 +58,26 @@ class TestBusiness( BusinessSession ):
     def test_post(self):
         self.assertTrue( self.invoice.IsPosted() )
 
+    def test_post_invoices(self):
+        invoices = []
+        for n in range(2):
+            invoice = Invoice(self.book, 'BatchID%d' % n, self.currency,
+                              self.customer)
+            invoice.SetDateOpened(self.today)
+            entry = Entry(self.book)
+            entry.SetDate(self.today)
+            entry.SetQuantity(GncNumeric(1))
+            entry.SetInvAccount(self.income)
+            entry.SetInvPrice(GncNumeric(10))
+            invoice.AddEntry(entry)
+            invoices.append(invoice)
+        # self.invoice is posted already, so it is the one that fails
+        failed = self.receivable.post_invoices(invoices + [self.invoice],
+            self.today, self.today, "", True, False)
+        self.assertEqual( [self.invoice], failed )
+        for invoice in invoices:
+            self.assertTrue( invoice.IsPosted() )
+
     def test_owner(self):
         OWNER = self.invoice.GetOwner()
         self.assertTrue( self.customer.Equal( OWNER ) )
@@ -133,5 +133,28 @@ class TestTransaction( TransactionSession ):
         self.trans.SetNotes(NOTE)
         self.assertEquals( NOTE, self.trans.GetNotes() )
 
+    def test_void_reverse_many(self):
+        TRANS2 = Transaction(self.book)
+        TRANS2.BeginEdit()
+        TRANS2.SetCurrency(self.currency)
+        Split(self.book).SetParent(TRANS2)
+        TRANS2.CommitEdit()
+        TRANSACTIONS = [self.trans, TRANS2]
+
+        REVERSED = self.book.reverse_transactions(TRANSACTIONS)
+        self.assertEquals( 2, len(REVERSED) )
+        for TRANS, REV in zip(TRANSACTIONS, REVERSED):
+            self.assertTrue( REV.Equal(TRANS.GetReversedBy(), True, False,
+                                       False, False) )
+
+        REASON = 'Bad import'
+        self.book.void_transactions(TRANSACTIONS, REASON)
+        for TRANS in TRANSACTIONS:
+            self.assertTrue( TRANS.GetVoidStatus() )
+            self.assertEquals( REASON, TRANS.GetVoidReason() )
+
+        self.assertRaises( TypeError, self.book.void_transactions,
+                           [self.split], REASON )
+
 if __name__ == '__main__':
     main()
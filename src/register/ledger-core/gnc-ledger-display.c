@@ -532,15 +532,43 @@ gnc_ledger_display_set_watches (GNCLedgerDisplay *ld, GList *splits)
     }
 }
 
+/* Every transaction commit generates GNC_EVENT_ITEM_CHANGED for the
+ * accounts of its splits, which all of the ledgers watch. Only those for
+ * the leader, or for its descendants in a subaccount ledger, can change
+ * what a ledger with a leader shows; anything else of interest to it
+ * arrives as a modify of a watched transaction or account. */
+static gboolean
+change_affects_ledger (GNCLedgerDisplay *ld, Account *leader,
+                       const GncComponentChange *change)
+{
+    Account *account;
+
+    if (!leader || g_strcmp0 (change->entity_type, GNC_ID_ACCOUNT) ||
+        (change->event_mask & ~GNC_EVENT_ITEM_CHANGED))
+        return TRUE;
+
+    if (guid_equal (&change->guid, &ld->leader))
+        return TRUE;
+
+    if (ld->ld_type != LD_SUBACCOUNT)
+        return FALSE;
+
+    account = xaccAccountLookup (&change->guid, gnc_get_current_book ());
+    return !account || xaccAccountHasAncestor (account, leader);
+}
+
 static void
-refresh_handler (GHashTable *changes, gpointer user_data)
+refresh_handler (const GncComponentChange *changes, guint n_changes,
+                 gpointer user_data)
 {
     GNCLedgerDisplay *ld = user_data;
-    const EventInfo *info;
+    Account *leader = NULL;
     gboolean has_leader;
     GList *splits;
+    guint i;
 
-    ENTER("changes=%p, user_data=%p", changes, user_data);
+    ENTER("changes=%p, n_changes=%u, user_data=%p", changes, n_changes,
+          user_data);
 
     if (ld->loading)
     {
@@ -552,7 +580,7 @@ refresh_handler (GHashTable *changes, gpointer user_data)
 
     if (has_leader)
     {
-        Account *leader = gnc_ledger_display_leader (ld);
+        leader = gnc_ledger_display_leader (ld);
         if (!leader)
         {
             gnc_close_gui_component (ld->component_id);
@@ -561,22 +589,34 @@ refresh_handler (GHashTable *changes, gpointer user_data)
         }
     }
 
-    if (changes && has_leader)
+    if (changes)
     {
-        info = gnc_gui_get_entity_events (changes, &ld->leader);
-        if (info && (info->event_mask & QOF_EVENT_DESTROY))
+        gboolean affected = FALSE;
+
+        for (i = 0; i < n_changes; i++)
         {
-            gnc_close_gui_component (ld->component_id);
-            LEAVE("destroy");
+            if (has_leader && (changes[i].event_mask & QOF_EVENT_DESTROY) &&
+                guid_equal (&changes[i].guid, &ld->leader))
+            {
+                gnc_close_gui_component (ld->component_id);
+                LEAVE("destroy");
+                return;
+            }
+            if (!affected)
+                affected = change_affects_ledger (ld, leader, &changes[i]);
+        }
+
+        if (!affected)
+        {
+            LEAVE("no relevant changes");
             return;
         }
     }
 
-    /* Its not clear if we should re-run the query, or if we should
-     * just use qof_query_last_run().  Its possible that the dates
-     * changed, requiring a full new query.  Similar considerations
-     * needed for multi-user mode.
+    /* The query is live, so this only searches the book again if the
+     * query itself changed.
      */
+    xaccQueryLoadPendingSplits (ld->query);
     splits = qof_query_run (ld->query);
 
     gnc_ledger_display_set_watches (ld, splits);
@@ -653,6 +693,9 @@ gnc_ledger_display_make_query (GNCLedgerDisplay *ld,
 
     accounts = g_list_prepend (accounts, leader);
 
+    /* The query only finds splits that are in memory. */
+    g_list_foreach (accounts, (GFunc) gnc_account_load_splits, NULL);
+
     xaccQueryAddAccountMatch (ld->query, accounts,
                               QOF_GUID_MATCH_ANY, QOF_QUERY_AND);
 
@@ -771,7 +814,11 @@ gnc_ledger_display_internal (Account *lead_account, Query *q,
     else
         gnc_ledger_display_make_query (ld, limit, reg_type);
 
-    ld->component_id = gnc_register_gui_component (klass,
+    /* Follow changes to the splits instead of searching the book on every
+     * refresh. */
+    qof_query_set_live (ld->query, TRUE);
+
+    ld->component_id = gnc_register_gui_component_delta (klass,
                        refresh_handler,
                        close_handler, ld);
 
@@ -785,6 +832,7 @@ gnc_ledger_display_internal (Account *lead_account, Query *q,
 
     gnc_split_register_set_data (ld->reg, ld, gnc_ledger_display_parent);
 
+    xaccQueryLoadPendingSplits (ld->query);
     splits = qof_query_run (ld->query);
 
     gnc_ledger_display_set_watches (ld, splits);
@@ -804,6 +852,7 @@ gnc_ledger_display_set_query (GNCLedgerDisplay *ledger_display, Query *q)
 
     qof_query_destroy (ledger_display->query);
     ledger_display->query = qof_query_copy (q);
+    qof_query_set_live (ledger_display->query, TRUE);
 }
 
 GNCLedgerDisplay *
@@ -853,6 +902,7 @@ gnc_ledger_display_refresh (GNCLedgerDisplay *ld)
         return;
     }
 
+    xaccQueryLoadPendingSplits (ld->query);
     gnc_ledger_display_refresh_internal (ld, qof_query_run (ld->query));
     LEAVE(" ");
 }
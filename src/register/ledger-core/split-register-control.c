@@ -519,6 +519,9 @@ gnc_split_register_move_cursor (VirtualLocation *p_new_virt_loc,
         info->rate_reset = RATE_RESET_NOT_REQD;
     }
 
+    /* The rows the cursor leaves may have changed. */
+    gnc_split_register_forget_entries (reg);
+
     gnc_resume_gui_refresh ();
 
     /* redrawing the register can muck everything up */
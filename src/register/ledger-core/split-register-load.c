@@ -39,6 +39,7 @@
 #include "split-register-p.h"
 #include "engine-helpers.h"
 #include "gnc-prefs.h"
+#include "gnc-trans-quickfill.h"
 #include "pricecell.h"
 
 
@@ -231,8 +232,7 @@ _find_split_with_parent_txn(gconstpointer a, gconstpointer b)
     return xaccSplitGetParent(split) == txn ? 0 : 1;
 }
 
-static void add_quickfill_completions(TableLayout *layout, Transaction *trans,
-                                      Split *split, gboolean has_last_num)
+static void add_quickfill_completions(TableLayout *layout, Transaction *trans)
 {
     Split *s;
     int i = 0;
@@ -245,11 +245,6 @@ static void add_quickfill_completions(TableLayout *layout, Transaction *trans,
         (QuickFillCell *) gnc_table_layout_get_cell(layout, NOTES_CELL),
         xaccTransGetNotes(trans));
 
-    if (!has_last_num)
-        gnc_num_cell_set_last_num(
-            (NumCell *) gnc_table_layout_get_cell(layout, NUM_CELL),
-            gnc_get_num_action(trans, split));
-
     while ((s = xaccTransGetSplit(trans, i)) != NULL)
     {
         gnc_quickfill_cell_add_completion(
@@ -259,6 +254,39 @@ static void add_quickfill_completions(TableLayout *layout, Transaction *trans,
     }
 }
 
+/* The number of transactions added to the quickfill cells per idle call */
+#define QUICKFILL_IDLE_CHUNK 500
+
+/* Add the completions of the transactions loaded on the first pass a
+ * chunk at a time, so that the register is shown without waiting for
+ * all of them. Transactions deleted meanwhile are skipped. */
+static gboolean
+quickfill_idle (gpointer user_data)
+{
+    SplitRegister *reg = user_data;
+    SRInfo *info = gnc_split_register_get_info (reg);
+    GArray *pending = info->quickfill_pending;
+    QofBook *book = gnc_get_current_book ();
+    guint i, n = MIN (pending->len, QUICKFILL_IDLE_CHUNK);
+
+    for (i = 0; i < n; i++)
+    {
+        Transaction *trans = xaccTransLookup (&g_array_index (pending,
+                                              GncGUID, i), book);
+        if (trans)
+            add_quickfill_completions (reg->table->layout, trans);
+    }
+    g_array_remove_range (pending, 0, n);
+
+    if (pending->len > 0)
+        return TRUE;
+
+    g_array_free (pending, TRUE);
+    info->quickfill_pending = NULL;
+    info->quickfill_idle_id = 0;
+    return FALSE;
+}
+
 static Split*
 create_blank_split (Account *default_account, SRInfo *info)
 {
@@ -377,6 +405,7 @@ gnc_split_register_load (SplitRegister *reg, GList * slist,
     gboolean future_after_blank = gnc_prefs_get_bool(GNC_PREFS_GROUP_GENERAL_REGISTER,
                                                      GNC_PREF_FUTURE_AFTER_BLANK);
     gboolean added_blank_trans = FALSE;
+    gboolean single_account = (default_account != NULL && !reg->is_template);
 
     VirtualCellLocation vcell_loc;
     VirtualLocation save_loc;
@@ -394,6 +423,9 @@ gnc_split_register_load (SplitRegister *reg, GList * slist,
 
     ENTER("reg=%p, slist=%p, default_account=%p", reg, slist, default_account);
 
+    /* The rows are about to be laid out again. */
+    gnc_split_register_forget_entries (reg);
+
     blank_split = xaccSplitLookup (&info->blank_split_guid,
                                    gnc_get_current_book ());
 
@@ -639,9 +671,24 @@ gnc_split_register_load (SplitRegister *reg, GList * slist,
         }
 
         /* If this is the first load of the register,
-         * fill up the quickfill cells. */
+         * fill up the quickfill cells. That is done once the register
+         * is shown, so only remember the transaction here. */
         if (info->first_pass)
-            add_quickfill_completions(reg->table->layout, trans, split, has_last_num);
+        {
+            if (xaccSplitGetAccount (split) != default_account)
+                single_account = FALSE;
+
+            if (!has_last_num)
+                gnc_num_cell_set_last_num(
+                    (NumCell *) gnc_table_layout_get_cell(table->layout, NUM_CELL),
+                    gnc_get_num_action(trans, split));
+
+            if (!info->quickfill_pending)
+                info->quickfill_pending = g_array_new (FALSE, FALSE,
+                                                       sizeof (GncGUID));
+            g_array_append_vals (info->quickfill_pending,
+                                 xaccTransGetGUID (trans), 1);
+        }
 
         if (trans == find_trans)
             new_trans_row = vcell_loc.virt_row;
@@ -663,6 +710,37 @@ gnc_split_register_load (SplitRegister *reg, GList * slist,
     if (multi_line)
         g_hash_table_destroy (trans_table);
 
+    /* A register showing only the splits of its account uses the
+     * quickfills shared by all of that account's registers, which are
+     * kept up to date by transaction events. */
+    if (info->first_pass && single_account)
+    {
+        TableLayout *layout = table->layout;
+
+        gnc_quickfill_cell_use_quickfill_cache (
+            (QuickFillCell *) gnc_table_layout_get_cell (layout, DESC_CELL),
+            gnc_get_shared_trans_quickfill (default_account,
+                                            GNC_TRANS_QF_DESCRIPTION));
+        gnc_quickfill_cell_use_quickfill_cache (
+            (QuickFillCell *) gnc_table_layout_get_cell (layout, NOTES_CELL),
+            gnc_get_shared_trans_quickfill (default_account,
+                                            GNC_TRANS_QF_NOTES));
+        gnc_quickfill_cell_use_quickfill_cache (
+            (QuickFillCell *) gnc_table_layout_get_cell (layout, MEMO_CELL),
+            gnc_get_shared_trans_quickfill (default_account,
+                                            GNC_TRANS_QF_MEMO));
+
+        if (info->quickfill_pending)
+        {
+            g_array_free (info->quickfill_pending, TRUE);
+            info->quickfill_pending = NULL;
+        }
+    }
+
+    if (info->quickfill_pending && !info->quickfill_idle_id)
+        info->quickfill_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+                                  quickfill_idle, reg, NULL);
+
     /* add the blank split at the end. */
     if (pending_trans == blank_trans)
         found_pending = TRUE;
@@ -2275,6 +2275,124 @@ gnc_split_register_guid_copy (gpointer p_to, gconstpointer p_from)
     *to = from ? *from : *guid_null();
 }
 
+/* The balances, amounts and transfer accounts of the rows outside the
+ * cursor are worked out over and over as the register is drawn, and
+ * the running balances walk the ledger each time.  Remember them until
+ * the next load or cursor move; see gnc_split_register_lookup_entry. */
+static const char *
+gnc_split_register_cached_entry (TableGetEntryHandler compute,
+                                 VirtualLocation virt_loc,
+                                 gboolean translate,
+                                 gboolean *conditionally_changed,
+                                 gpointer user_data)
+{
+    SplitRegister *reg = user_data;
+    gboolean changed = FALSE;
+    const char *entry;
+
+    if (gnc_split_register_lookup_entry (reg, virt_loc, translate, &entry))
+        return entry;
+
+    entry = compute (virt_loc, translate, &changed, user_data);
+    if (changed)
+    {
+        /* Entries that may change with the cursor aren't remembered. */
+        if (conditionally_changed)
+            *conditionally_changed = TRUE;
+        return entry;
+    }
+
+    return gnc_split_register_remember_entry (reg, virt_loc, translate, entry);
+}
+
+static const char *
+gnc_split_register_get_cached_balance_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_balance_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_price_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_price_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_shares_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_shares_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_tshares_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_tshares_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_xfrm_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_xfrm_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_mxfrm_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_mxfrm_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_tdebcred_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_tdebcred_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
+static const char *
+gnc_split_register_get_cached_debcred_entry (VirtualLocation virt_loc,
+        gboolean translate,
+        gboolean *conditionally_changed,
+        gpointer user_data)
+{
+    return gnc_split_register_cached_entry
+           (gnc_split_register_get_debcred_entry, virt_loc, translate,
+            conditionally_changed, user_data);
+}
+
 
 static void
 gnc_split_register_colorize_negative (gpointer gsettings, gchar *key, gpointer unused)
@@ -2352,39 +2470,39 @@ gnc_split_register_model_new (void)
                                        MEMO_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_balance_entry,
+                                       gnc_split_register_get_cached_balance_entry,
                                        BALN_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_balance_entry,
+                                       gnc_split_register_get_cached_balance_entry,
                                        TBALN_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_price_entry,
+                                       gnc_split_register_get_cached_price_entry,
                                        PRIC_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_shares_entry,
+                                       gnc_split_register_get_cached_shares_entry,
                                        SHRS_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_tshares_entry,
+                                       gnc_split_register_get_cached_tshares_entry,
                                        TSHRS_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_xfrm_entry,
+                                       gnc_split_register_get_cached_xfrm_entry,
                                        XFRM_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_mxfrm_entry,
+                                       gnc_split_register_get_cached_mxfrm_entry,
                                        MXFRM_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_tdebcred_entry,
+                                       gnc_split_register_get_cached_tdebcred_entry,
                                        TDEBT_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_tdebcred_entry,
+                                       gnc_split_register_get_cached_tdebcred_entry,
                                        TCRED_CELL);
 
     gnc_table_model_set_entry_handler (model,
@@ -2396,11 +2514,11 @@ gnc_split_register_model_new (void)
                                        TYPE_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_debcred_entry,
+                                       gnc_split_register_get_cached_debcred_entry,
                                        DEBT_CELL);
 
     gnc_table_model_set_entry_handler (model,
-                                       gnc_split_register_get_debcred_entry,
+                                       gnc_split_register_get_cached_debcred_entry,
                                        CRED_CELL);
 
     gnc_table_model_set_entry_handler (model,
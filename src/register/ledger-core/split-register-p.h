@@ -133,6 +133,16 @@ struct sr_info
 
     /** true if the account separator has changed */
     gboolean separator_changed;
+
+    /** The transactions, by GUID, whose descriptions, notes and memos
+     * are still to be added to the quickfill cells after the first load,
+     * and the idle source adding them. */
+    GArray *quickfill_pending;
+    guint quickfill_idle_id;
+
+    /** The entries already worked out for the costlier cells outside
+     * the cursor, by location; see gnc_split_register_lookup_entry(). */
+    GHashTable *entry_cache;
 };
 
 
@@ -178,6 +188,29 @@ void gnc_split_register_set_trans_visible (SplitRegister *reg,
 
 void gnc_split_register_set_cell_fractions (SplitRegister *reg, Split *split);
 
+/** The entry of the cell at virt_loc as it was last worked out, if it
+ * is still known.  Entries are remembered for the cells outside the
+ * cursor until the register is loaded again or the cursor moves, since
+ * either may follow a change to the engine.
+ *
+ * @return TRUE and the entry, which may be NULL, in *entry if known. */
+gboolean gnc_split_register_lookup_entry (SplitRegister *reg,
+        VirtualLocation virt_loc,
+        gboolean translate,
+        const char **entry);
+
+/** Remember the entry of the cell at virt_loc, unless it is in the
+ * cursor.
+ *
+ * @return The copy remembered, or entry itself if it wasn't. */
+const char * gnc_split_register_remember_entry (SplitRegister *reg,
+        VirtualLocation virt_loc,
+        gboolean translate,
+        const char *entry);
+
+/** Forget all of the remembered entries. */
+void gnc_split_register_forget_entries (SplitRegister *reg);
+
 CellBlock * gnc_split_register_get_passive_cursor (SplitRegister *reg);
 CellBlock * gnc_split_register_get_active_cursor (SplitRegister *reg);
 
@@ -112,6 +112,85 @@ gnc_split_register_get_default_account (SplitRegister *reg)
                               gnc_get_current_book ());
 }
 
+/* The entry cache
+ *
+ * The balances, amounts and account names of the rows are worked out
+ * from the engine and formatted every time a row is drawn.  They are
+ * kept here instead, under their location and translate flag packed
+ * into an int64.  The cursor's own cells are left out, because they
+ * follow the edits in progress.
+ */
+
+static gint64
+entry_cache_key (VirtualLocation virt_loc, gboolean translate)
+{
+    return ((gint64) virt_loc.vcell_loc.virt_row << 32) |
+           ((virt_loc.vcell_loc.virt_col & 0xff) << 24) |
+           ((virt_loc.phys_row_offset & 0xff) << 16) |
+           ((virt_loc.phys_col_offset & 0x7fff) << 1) |
+           (translate ? 1 : 0);
+}
+
+static gboolean
+entry_cache_covers (SplitRegister *reg, VirtualLocation virt_loc)
+{
+    return reg && reg->table &&
+           !virt_cell_loc_equal (reg->table->current_cursor_loc.vcell_loc,
+                                 virt_loc.vcell_loc);
+}
+
+gboolean
+gnc_split_register_lookup_entry (SplitRegister *reg,
+                                 VirtualLocation virt_loc,
+                                 gboolean translate,
+                                 const char **entry)
+{
+    SRInfo *info = gnc_split_register_get_info (reg);
+    gint64 key;
+    gpointer value;
+
+    if (!info || !info->entry_cache || !entry_cache_covers (reg, virt_loc))
+        return FALSE;
+
+    key = entry_cache_key (virt_loc, translate);
+    if (!g_hash_table_lookup_extended (info->entry_cache, &key, NULL, &value))
+        return FALSE;
+    *entry = value;
+    return TRUE;
+}
+
+const char *
+gnc_split_register_remember_entry (SplitRegister *reg,
+                                   VirtualLocation virt_loc,
+                                   gboolean translate,
+                                   const char *entry)
+{
+    SRInfo *info = gnc_split_register_get_info (reg);
+    gint64 *key;
+    char *copy;
+
+    if (!info || !entry_cache_covers (reg, virt_loc))
+        return entry;
+
+    if (!info->entry_cache)
+        info->entry_cache = g_hash_table_new_full (g_int64_hash,
+                            g_int64_equal, g_free, g_free);
+    key = g_new (gint64, 1);
+    *key = entry_cache_key (virt_loc, translate);
+    copy = g_strdup (entry);
+    g_hash_table_replace (info->entry_cache, key, copy);
+    return copy;
+}
+
+void
+gnc_split_register_forget_entries (SplitRegister *reg)
+{
+    SRInfo *info = gnc_split_register_get_info (reg);
+
+    if (info && info->entry_cache)
+        g_hash_table_remove_all (info->entry_cache);
+}
+
 void
 gnc_split_register_set_template_account (SplitRegister *reg,
         Account *template_account)
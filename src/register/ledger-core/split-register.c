@@ -2862,6 +2862,13 @@ gnc_split_register_destroy_info (SplitRegister *reg)
     g_free (info->credit_str);
     g_free (info->tcredit_str);
 
+    if (info->quickfill_idle_id)
+        g_source_remove (info->quickfill_idle_id);
+    if (info->quickfill_pending)
+        g_array_free (info->quickfill_pending, TRUE);
+    if (info->entry_cache)
+        g_hash_table_destroy (info->entry_cache);
+
     info->debit_str = NULL;
     info->tdebit_str = NULL;
     info->credit_str = NULL;
@@ -176,27 +176,17 @@ gnucash_grid_find_block_by_pixel (GnucashGrid *grid,
     g_return_val_if_fail(y >= 0, NULL);
     g_return_val_if_fail(x >= 0, NULL);
 
-    do
-    {
-        block = gnucash_sheet_get_block (grid->sheet, vc_loc);
-        if (!block)
-            return NULL;
-
-        if (block->visible &&
-                y >= block->origin_y &&
-                y < block->origin_y + block->style->dimensions->height)
-        {
-            if (vcell_loc)
-                vcell_loc->virt_row = vc_loc.virt_row;
-            break;
-        }
-        vc_loc.virt_row++;
-    }
-    while (vc_loc.virt_row < grid->sheet->num_virt_rows);
+    vc_loc.virt_row = gnucash_sheet_y_pixel_to_block (grid->sheet, y);
+    if (vc_loc.virt_row >= grid->sheet->num_virt_rows)
+        return NULL;
 
-    if (vc_loc.virt_row == grid->sheet->num_virt_rows)
+    block = gnucash_sheet_get_block (grid->sheet, vc_loc);
+    if (!block || y < block->origin_y)
         return NULL;
 
+    if (vcell_loc)
+        vcell_loc->virt_row = vc_loc.virt_row;
+
     do
     {
         block = gnucash_sheet_get_block (grid->sheet, vc_loc);
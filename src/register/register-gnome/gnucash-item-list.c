@@ -50,8 +50,6 @@ enum
 static GnomeCanvasWidgetClass *gnc_item_list_parent_class;
 static guint gnc_item_list_signals[LAST_SIGNAL];
 
-gboolean _gnc_item_find_selection(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer data);
-
 gint
 gnc_item_list_num_entries (GncItemList *item_list)
 {
@@ -117,51 +115,97 @@ gnc_item_list_set_sort_enabled(GncItemList *item_list, gboolean enabled)
 }
 
 
-typedef struct _findSelectionData
+/* Finding an item by its string used to walk the whole store, and the
+ * combo cells look one up with each key typed.  Each store, which may
+ * be shared between lists, gets an index of its rows by string
+ * instead.  It is built when first needed and dropped whenever a row
+ * is added, changed, removed or moved. */
+static GQuark
+gnc_item_list_index_quark (void)
 {
-    GncItemList *item_list;
-    const char *string_to_find;
-    GtkTreePath *found_path;
-} FindSelectionData;
+    static GQuark quark = 0;
 
-gboolean
-_gnc_item_find_selection(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer data)
+    if (!quark)
+        quark = g_quark_from_static_string ("gnc-item-list-index");
+    return quark;
+}
+
+static void
+gnc_item_list_index_forget (GtkTreeModel *model)
+{
+    g_signal_handlers_disconnect_by_func (model, gnc_item_list_index_forget,
+                                          model);
+    g_object_set_qdata (G_OBJECT (model), gnc_item_list_index_quark (), NULL);
+}
+
+static GHashTable *
+gnc_item_list_get_index (GtkTreeModel *model)
 {
-    FindSelectionData *to_find = (FindSelectionData*)data;
-    gchar *iterStr;
-    gboolean found;
-
-    gtk_tree_model_get(model, iter, 0, &iterStr, -1);
-    found = g_strcmp0(to_find->string_to_find, iterStr) == 0;
-    g_free(iterStr);
-    if (found)
+    GHashTable *index;
+    GtkTreeIter iter;
+    gboolean valid;
+    gint row = 0;
+
+    index = g_object_get_qdata (G_OBJECT (model), gnc_item_list_index_quark ());
+    if (index)
+        return index;
+
+    index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (valid = gtk_tree_model_get_iter_first (model, &iter); valid;
+            valid = gtk_tree_model_iter_next (model, &iter), row++)
     {
-        to_find->found_path = gtk_tree_path_copy(path);
-        return TRUE;
+        gchar *string;
+
+        gtk_tree_model_get (model, &iter, 0, &string, -1);
+        /* The first of equal strings is the one found. */
+        if (string && !g_hash_table_lookup_extended (index, string, NULL, NULL))
+            g_hash_table_insert (index, string, GINT_TO_POINTER (row));
+        else
+            g_free (string);
     }
-    return FALSE;
+
+    g_object_set_qdata_full (G_OBJECT (model), gnc_item_list_index_quark (),
+                             index, (GDestroyNotify) g_hash_table_destroy);
+    g_signal_connect_swapped (model, "row-inserted",
+                              G_CALLBACK (gnc_item_list_index_forget), model);
+    g_signal_connect_swapped (model, "row-changed",
+                              G_CALLBACK (gnc_item_list_index_forget), model);
+    g_signal_connect_swapped (model, "row-deleted",
+                              G_CALLBACK (gnc_item_list_index_forget), model);
+    g_signal_connect_swapped (model, "rows-reordered",
+                              G_CALLBACK (gnc_item_list_index_forget), model);
+    return index;
+}
+
+/* The path of the first row holding string, or NULL. */
+static GtkTreePath *
+gnc_item_list_find (GncItemList *item_list, const char *string)
+{
+    GHashTable *index;
+    gpointer row;
+
+    if (string == NULL)
+        return NULL;
+
+    index = gnc_item_list_get_index (GTK_TREE_MODEL (item_list->list_store));
+    if (!g_hash_table_lookup_extended (index, string, NULL, &row))
+        return NULL;
+    return gtk_tree_path_new_from_indices (GPOINTER_TO_INT (row), -1);
 }
 
 gboolean
 gnc_item_in_list (GncItemList *item_list, const char *string)
 {
-    FindSelectionData *to_find_data;
-    gboolean result;
+    GtkTreePath *path;
 
     g_return_val_if_fail(item_list != NULL, FALSE);
     g_return_val_if_fail(IS_GNC_ITEM_LIST(item_list), FALSE);
 
-    to_find_data = (FindSelectionData*)g_new0(FindSelectionData, 1);
-    to_find_data->item_list = item_list;
-    to_find_data->string_to_find = string;
-
-    gtk_tree_model_foreach(GTK_TREE_MODEL(item_list->list_store),
-                           _gnc_item_find_selection,
-                           to_find_data);
-
-    result = (to_find_data->found_path != NULL);
-    g_free(to_find_data);
-    return result;
+    path = gnc_item_list_find (item_list, string);
+    if (path == NULL)
+        return FALSE;
+    gtk_tree_path_free (path);
+    return TRUE;
 }
 
 
@@ -169,7 +213,7 @@ void
 gnc_item_list_select (GncItemList *item_list, const char *string)
 {
     GtkTreeSelection *tree_sel = NULL;
-    FindSelectionData *to_find_data;
+    GtkTreePath *path;
 
     g_return_if_fail(item_list != NULL);
     g_return_if_fail(IS_GNC_ITEM_LIST(item_list));
@@ -182,26 +226,16 @@ gnc_item_list_select (GncItemList *item_list, const char *string)
         return;
     }
 
-    to_find_data = (FindSelectionData*)g_new0(FindSelectionData, 1);
-    to_find_data->item_list = item_list;
-    to_find_data->string_to_find = string;
-
-    gtk_tree_model_foreach(GTK_TREE_MODEL(item_list->list_store),
-                           _gnc_item_find_selection,
-                           to_find_data);
-
-    if (to_find_data->found_path != NULL)
+    path = gnc_item_list_find (item_list, string);
+    if (path != NULL)
     {
-        gtk_tree_view_set_cursor(item_list->tree_view, to_find_data->found_path, NULL, FALSE);
-        gtk_tree_path_free(to_find_data->found_path);
+        gtk_tree_view_set_cursor(item_list->tree_view, path, NULL, FALSE);
+        gtk_tree_path_free(path);
 
         gnc_item_list_show_selected(item_list);
     }
-
-    g_free(to_find_data);
 }
 
-
 void
 gnc_item_list_show_selected (GncItemList *item_list)
 {
@@ -362,22 +362,42 @@ gnucash_sheet_cursor_move (GnucashSheet *sheet, VirtualLocation virt_loc)
 }
 
 
-static gint
+gint
 gnucash_sheet_y_pixel_to_block (GnucashSheet *sheet, int y)
 {
     VirtualCellLocation vcell_loc = { 1, 0 };
+    gint low = 1;
+    gint high = sheet->num_virt_rows;
+
+    /* gnucash_sheet_recompute_block_offsets lays the blocks out top to
+     * bottom, hidden ones taking no space, so their bottom edges never
+     * decrease and the first one below y can be found by bisection. */
+    while (low < high)
+    {
+        SheetBlock *block;
+        gint bottom;
+
+        vcell_loc.virt_row = low + (high - low) / 2;
+        block = gnucash_sheet_get_block (sheet, vcell_loc);
 
-    for (;
+        bottom = block->origin_y;
+        if (block->visible)
+            bottom += block->style->dimensions->height;
+
+        if (bottom > y)
+            high = vcell_loc.virt_row;
+        else
+            low = vcell_loc.virt_row + 1;
+    }
+
+    for (vcell_loc.virt_row = low;
             vcell_loc.virt_row < sheet->num_virt_rows;
             vcell_loc.virt_row++)
     {
         SheetBlock *block;
 
         block = gnucash_sheet_get_block (sheet, vcell_loc);
-        if (!block || !block->visible)
-            continue;
-
-        if (block->origin_y + block->style->dimensions->height > y)
+        if (block && block->visible)
             break;
     }
 
@@ -107,6 +107,10 @@ void gnucash_sheet_cursor_set_from_table (GnucashSheet *sheet,
 
 void gnucash_sheet_compute_visible_range (GnucashSheet *sheet);
 
+/** Return the first visible virtual row whose block ends below
+ *  pixel row y, or the number of virtual rows if there is none. */
+gint gnucash_sheet_y_pixel_to_block (GnucashSheet *sheet, int y);
+
 void gnucash_sheet_make_cell_visible (GnucashSheet *sheet,
                                       VirtualLocation virt_loc);
 
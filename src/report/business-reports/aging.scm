@@ -108,156 +108,23 @@
 (define company-set-overpayment
   (record-modifier company-info 'overpayment))
 
-;; Put an invoice in the appropriate bucket
-
-(define (process-invoice company amount bucket-intervals date)
-  (define (in-interval this-date current-bucket)
-    (gnc:timepair-lt this-date current-bucket))
-
-  (define (find-bucket current-bucket bucket-intervals date)  
-    (gnc:debug "looking for bucket for date: " date)
-    (begin
-      (gnc:debug "current bucket: " current-bucket)
-      (gnc:debug "bucket-intervals: " bucket-intervals)
-      (if (> current-bucket (vector-length bucket-intervals))
-	  (gnc:error "sanity check failed in find-bucket")
-	  (if (in-interval date (vector-ref bucket-intervals current-bucket))
-	      (begin
-		(gnc:debug "found bucket")
-		current-bucket)
-	      (find-bucket (+ current-bucket 1) bucket-intervals date)))))
-
-  (define (calculate-adjusted-values amount overpayment)
-    (if (>= (gnc-numeric-compare amount overpayment) 0)
-	(cons (gnc-numeric-sub-fixed amount overpayment)
-	      (gnc-numeric-zero))
-	(cons (gnc-numeric-zero)
-	      (gnc-numeric-sub-fixed overpayment amount))))
-
-  (let* ((current-overpayment (company-get-overpayment company))
-	 (adjusted-values (calculate-adjusted-values amount current-overpayment))
-	 (adjusted-amount (car adjusted-values))
-	 (adjusted-overpayment (cdr adjusted-values))
-	 (bucket-index (find-bucket 0 bucket-intervals date))
-	 (buckets (company-get-buckets company))
-	 (new-bucket-value 
-	  (gnc-numeric-add-fixed adjusted-amount (vector-ref buckets bucket-index))))
-    (vector-set! buckets bucket-index new-bucket-value)
-    (company-set-buckets company buckets)
-    (company-set-overpayment company adjusted-overpayment)))
-
-
-;; NOTE: We assume that bill payments occur in a FIFO manner - ie
-;; any payment to a company goes towards the *oldest* bill first
-
-
-(define (process-payment company amount)
-  (define (process-payment-driver amount buckets current-bucket-index)
-    (if (>= current-bucket-index (vector-length buckets))
-	amount
-	(let ((current-bucket-amt (vector-ref buckets current-bucket-index)))
-	  (if (>= (gnc-numeric-compare current-bucket-amt amount) 0)
-	      (begin
-		(vector-set! buckets current-bucket-index (gnc-numeric-sub-fixed
-							   current-bucket-amt amount))
-		(gnc-numeric-zero))
-	      (begin
-		(vector-set! buckets current-bucket-index (gnc-numeric-zero))
-		(process-payment-driver 
-		 (gnc-numeric-sub-fixed amount current-bucket-amt)
-		 buckets
-		 (+ current-bucket-index 1)))))))
-
-  (let ((overpayment (company-get-overpayment company)))
-	;; if there's already an overpayment, make it bigger
-    (gnc:debug "processing payment of " amount)
-    (gnc:debug "overpayment was " overpayment)
-
-	(if (gnc-numeric-positive-p overpayment)
-	    (company-set-overpayment company (gnc-numeric-add-fixed overpayment amount))
-
-	    (let ((result (process-payment-driver amount (company-get-buckets company) 0)))
-	      (gnc:debug "payment-driver processed.  new overpayment: " result)
-	      (company-set-overpayment company result)))))
-
-;; determine date function to use 
-(define (get-selected-date-from-txn transaction date-type)
-  (if (eq? date-type 'postdate)
-      (gnc-transaction-get-date-posted transaction)
-      (xaccTransRetDateDueTS transaction)))		    
-  
-;; deal with a transaction - figure out if we've seen the company before
-;; if so, either process it as a bill or a payment, if not, create
-;; a new company record in the hash
-
-(define (update-company-hash hash split bucket-intervals
-			     reverse? show-zeros date-type)
-
-  (define (do-update value)
-    (let* ((transaction (xaccSplitGetParent split))
-	   (temp-owner (gncOwnerNew))
-	   (owner (gnc:owner-from-split split temp-owner)))
-
-      (if (not (null? owner))
-       (let* ((guid (gncOwnerReturnGUID owner))
-	      (this-currency (xaccTransGetCurrency transaction))
-	      (this-date (get-selected-date-from-txn transaction date-type))
-	      (company-info (hash-ref hash guid)))
-
-	 (gnc:debug "update-company-hash called")
-	 (gnc:debug "owner: " owner ", guid: " guid)
-	 (gnc:debug "split-value: " value)
-	 (if reverse? (set! value (gnc-numeric-neg value)))
-	 (if company-info
-	     ;; if it's an existing company, destroy the temp owner and
-	     ;; then make sure the currencies match
-	     (begin
-	       (if (not (gnc-commodity-equiv
-			 this-currency
-			 (company-get-currency company-info)))
-		   (let ((error-str
-			  (string-append "IGNORING TRANSACTION!\n" "Invoice Owner: " (gncOwnerGetName owner)
-					 "\nTransaction GUID:" (gncTransGetGuid transaction)
-					 "\nTransaction Currency" (gnc-commodity-get-mnemonic this-currency)
-					 "\nClient Currency" (gnc-ommodity-get-mnemonic(company-get-currency company-info)))))
-		     (gnc-error-dialog '() error-str)
-		     (gnc:error error-str)
-		     (cons #f (sprintf
-			       (_ "Transactions relating to '%s' contain \
-more than one currency. This report is not designed to cope with this possibility.")  (gncOwnerGetName owner))))
-		   (begin
-		     (gnc:debug "it's an old company")
-		     (if (gnc-numeric-negative-p value)
-			 (process-invoice company-info (gnc-numeric-neg value) bucket-intervals this-date)
-			 (process-payment company-info value))
-		     (hash-set! hash guid company-info)
-		     (cons #t guid)))
-	       (gncOwnerFree temp-owner))
-
-	     ;; if it's a new company
-	     (begin
-	       (gnc:debug "value" value)
-	       (let ((new-company (make-company this-currency owner)))
-		 (if (gnc-numeric-negative-p value)
-		     (process-invoice new-company (gnc-numeric-neg value) bucket-intervals this-date)
-		     (process-payment new-company value))
-		 (hash-set! hash guid new-company))
-	       (cons #t guid))))
-       ; else (no owner)
-       (gncOwnerFree temp-owner))))
-
-  ;; figure out if this split is part of a closed lot
-  ;; also save the split value...
-  (let* ((lot (xaccSplitGetLot split))
-	 (value (xaccSplitGetValue split))
-	 (is-paid? (if (null? lot) #f (gnc-lot-is-closed lot))))
-
-    ;; if it's closed, then ignore it because it doesn't matter.
-    ;; XXX: we _could_ just set the value to 0 in order to list
-    ;;      the company.  I'm not sure what to do.  Perhaps add an
-    ;;      option?
-    (if (or (not is-paid?) show-zeros)
-	(do-update value))))
+;; Copy the owners' buckets aged by the engine into company records.
+;; The guid is the hash key the records used to be filed under; the
+;; sort predicates still use it to break ties.
+
+(define (aging-owner->company aging-owner)
+  (let* ((owner (gncOwnerNew))
+	 (buckets (new-bucket-vector)))
+    (gncOwnerCopy (gncAgingOwnerGetOwner aging-owner) owner)
+    (let loop ((i 0))
+      (if (< i num-buckets)
+	  (begin
+	    (vector-set! buckets i (gncAgingOwnerGetBucket aging-owner i))
+	    (loop (+ i 1)))))
+    (let ((company (make-company (gncAgingOwnerGetCurrency aging-owner) owner)))
+      (company-set-buckets company buckets)
+      (company-set-overpayment company (gncAgingOwnerGetOverpayment aging-owner))
+      (cons (gncOwnerReturnGUID owner) company))))
 
 ;; get the total debt from the buckets
 (define (buckets-get-total buckets)
@@ -312,25 +179,6 @@ more than one currency. This report is not designed to cope with this possibilit
 	     difference)))
 
 
-;; set up the query to get the splits in the chosen account
-;; XXX: FIXME: begindate is a hack -- we currently only go back a year
-(define (setup-query query account date)
-  (define (date-copy date)
-    (cons (car date) (cdr date)))
-  (let ((begindate (make-zdate))) ;Set begindate to the start of the Epoch
-;    (gnc:debug "Account: " account)
-    (gnc:debug "begindate" begindate)
-    (gnc:debug "date" date)
-    (qof-query-set-book query (gnc-get-current-book))
-    (gnc:query-set-match-non-voids-only! query (gnc-get-current-book))
-    (xaccQueryAddSingleAccountMatch query account QOF-QUERY-AND)
-    (xaccQueryAddDateMatchTS query #t begindate #t date QOF-QUERY-AND)
-    (qof-query-set-sort-order query
-			      (list SPLIT-TRANS TRANS-DATE-POSTED)
-			      '() '())
-    (qof-query-set-sort-increasing query #t #t #t)))
-
-
 (define (aging-options-generator options)
   (let* ((add-option 
           (lambda (new-option)
@@ -654,8 +502,7 @@ copying this report to a spreadsheet for use in a mail merge.")
 
   (set! receivable (eq? (op-value "__hidden" "receivable-or-payable") 'R))
   (gnc:report-starting reportname)
-  (let* ((companys (make-hash-table 23))
-	 (report-title (op-value gnc:pagename-general gnc:optname-reportname))
+  (let* ((report-title (op-value gnc:pagename-general gnc:optname-reportname))
         ;; document will be the HTML document that we return.
 	(report-date (gnc:timepair-end-day-time 
 		      (gnc:date-option-absolute-time
@@ -685,7 +532,6 @@ copying this report to a spreadsheet for use in a mail merge.")
 	(exchange-fn (gnc:case-exchange-fn price-source report-currency report-date))
 	(total-collector-list (make-collector-list))
 	(table (gnc:make-html-table))
-	(query (qof-query-create-for-splits))
 	(company-list '())
 	(work-done 0)
 	(work-to-do 0)
@@ -732,31 +578,17 @@ copying this report to a spreadsheet for use in a mail merge.")
 				     
     (if (not (null? account))
 	(begin
-	  (setup-query query account report-date)
-	  ;; get the appropriate splits
-	  (let ((splits (qof-query-run query)))
-;	    (gnc:debug "splits" splits)
+	  ;; age the account's splits, per owner
+	  (let ((aging (gncAgingNew)))
+	    (for-each (lambda (end) (gncAgingAddBucket aging end))
+		      (vector->list interval-vec))
+	    (gncAgingRun aging account report-date reverse?
+			 (eq? date-type 'postdate) show-zeros)
+	    (set! company-list
+		  (map aging-owner->company (gncAgingGetOwners aging)))
+	    (gncAgingDestroy aging))
+	  (gnc:report-percent-done 50)
 
-	    ;; build the table
-	    (set! work-to-do (length splits))
-	    ;; work-done is already zero
-	    (for-each (lambda (split)
-			(gnc:report-percent-done (* 50 (/ work-done work-to-do)))
-			(set! work-done (+ 1 work-done))
-			(update-company-hash companys 
-					      split 
-					      interval-vec 
-					      reverse? show-zeros
-                                              date-type))
-			splits)
-;	    (gnc:debug "companys" companys)
-	    ;; turn the hash into a list
-	    (hash-for-each (lambda (key value)
-			     (set! company-list
-				   (cons (cons key value) company-list)))
-			   companys)
-;	    (gnc:debug "company list" company-list)
-	   
 	    (set! company-list (sort-list! company-list
 					    sort-pred))
 
@@ -849,12 +681,11 @@ copying this report to a spreadsheet for use in a mail merge.")
 						   multi-totals-p)))
 	     
 	    (gnc:html-document-add-object!
-	     document table)))
+	     document table))
 	(gnc:html-document-add-object!
 	 document
 	 (gnc:make-html-text
 	  (_ "No valid account selected. Click on the Options button and select the account to use."))))
-    (qof-query-destroy query)
     (gnc:report-finished)
     document))
 
@@ -86,6 +86,11 @@ dirty_same_stylesheet(gpointer key, gpointer val, gpointer data)
         /* This makes _me_ feel dirty! */
         if (scm_is_procedure(func))
             scm_call_2(func, report, SCM_BOOL_T);
+
+        /* The options are unchanged, so drop the cached html too. */
+        func = scm_c_eval_string("gnc:report-set-ctext!");
+        if (scm_is_procedure(func))
+            scm_call_2(func, report, SCM_BOOL_F);
     }
 }
 
@@ -174,6 +174,7 @@ static void gnc_plugin_page_report_forw_cb(GtkAction *action, GncPluginPageRepor
 static void gnc_plugin_page_report_back_cb(GtkAction *action, GncPluginPageReport *rep);
 static void gnc_plugin_page_report_reload_cb(GtkAction *action, GncPluginPageReport *rep);
 static void gnc_plugin_page_report_stop_cb(GtkAction *action, GncPluginPageReport *rep);
+static void gnc_plugin_page_report_cancel_cb(gpointer user_data);
 static void gnc_plugin_page_report_save_cb(GtkAction *action, GncPluginPageReport *rep);
 static void gnc_plugin_page_report_save_as_cb(GtkAction *action, GncPluginPageReport *rep);
 static void gnc_plugin_page_report_export_cb(GtkAction *action, GncPluginPageReport *rep);
@@ -379,8 +380,10 @@ gnc_plugin_page_report_create_widget( GncPluginPage *page )
     g_free(id_name);
     g_free(child_name);
     gnc_window_set_progressbar_window( GNC_WINDOW(page->window) );
+    gnc_window_set_progress_cancel_func( gnc_plugin_page_report_cancel_cb, NULL );
     gnc_html_show_url(priv->html, type, url_location, url_label, 0);
     g_free(url_location);
+    gnc_window_set_progress_cancel_func( NULL, NULL );
     gnc_window_set_progressbar_window( NULL );
 
     g_signal_connect(priv->container, "expose_event",
@@ -672,7 +675,9 @@ gnc_plugin_page_report_expose_event_cb(GtkWidget *unused, GdkEventExpose *unused
 
     priv->need_reload = FALSE;
     gnc_window_set_progressbar_window( GNC_WINDOW(GNC_PLUGIN_PAGE(page)->window) );
+    gnc_window_set_progress_cancel_func( gnc_plugin_page_report_cancel_cb, NULL );
     gnc_html_reload(priv->html);
+    gnc_window_set_progress_cancel_func( NULL, NULL );
     gnc_window_set_progressbar_window( NULL );
     LEAVE( "reload forced" );
 }
@@ -1319,9 +1324,18 @@ gnc_plugin_page_report_stop_cb( GtkAction *action, GncPluginPageReport *report )
     GncPluginPageReportPrivate *priv;
 
     priv = GNC_PLUGIN_PAGE_REPORT_GET_PRIVATE(report);
+    gnc_report_cancel();
     gnc_html_cancel(priv->html);
 }
 
+/* Called from the cancel button next to the progress bar while the
+ * report is being rendered. */
+static void
+gnc_plugin_page_report_cancel_cb( gpointer user_data )
+{
+    gnc_report_cancel();
+}
+
 /* Returns SCM_BOOL_F if cancel. Returns SCM_BOOL_T if html.
  * Otherwise returns pair from export_types. */
 static SCM
@@ -256,7 +256,15 @@ gnc_html_report_stream_cb (const char *location, char ** data, int *len)
 
     ok = gnc_run_report_id_string (location, data);
 
-    if (!ok)
+    if (!ok && gnc_report_cancel_requested ())
+    {
+        *data = g_strdup_printf ("<html><body><h3>%s</h3>"
+                                 "<p>%s</p></body></html>",
+                                 _("Report cancelled"),
+                                 _("The report was cancelled before it was finished. "
+                                   "Reload it to run it again."));
+    }
+    else if (!ok)
     {
         *data = g_strdup_printf ("<html><body><h3>%s</h3>"
                                  "<p>%s</p></body></html>",
@@ -25,6 +25,7 @@
 #include "config.h"
 
 #include <glib.h>
+#include <glib/gi18n.h>
 #include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <libguile.h>
@@ -39,6 +40,7 @@
 #include "gnc-guile-utils.h"
 #include "gnc-report.h"
 #include "gnc-engine.h"
+#include "gnc-ui-util.h"
 
 static QofLogModule log_module = GNC_MOD_GUI;
 
@@ -142,25 +144,75 @@ gnc_reports_get_global(void)
     return reports;
 }
 
+/* Bumped on every engine event and whenever the current book is
+ * replaced, so that a report's cached output can tell whether anything
+ * it read may have changed since. */
+static guint book_generation = 0;
+static gint book_event_handler_id = 0;
+static GncGUID book_generation_guid;
+
+static void
+book_event_handler (QofInstance *entity, QofEventId event_type,
+                    gpointer handler_data, gpointer event_data)
+{
+    book_generation++;
+}
+
+guint
+gnc_report_book_generation (void)
+{
+    QofBook *book = gnc_get_current_book ();
+
+    if (!book_event_handler_id)
+        book_event_handler_id =
+            qof_event_register_handler (book_event_handler, NULL);
+
+    /* Books are loaded with the events suspended. */
+    if (book && !guid_equal (&book_generation_guid,
+                             qof_instance_get_guid (QOF_INSTANCE (book))))
+    {
+        book_generation_guid = *qof_instance_get_guid (QOF_INSTANCE (book));
+        book_generation++;
+    }
+    return book_generation;
+}
+
 static void
 error_handler(const char *str)
 {
     g_warning("Failure running report: %s", str);
 }
 
+static gboolean report_cancel_requested = FALSE;
+
+void
+gnc_report_cancel (void)
+{
+    report_cancel_requested = TRUE;
+}
+
+gboolean
+gnc_report_cancel_requested (void)
+{
+    return report_cancel_requested;
+}
+
 gboolean
 gnc_run_report (gint report_id, char ** data)
 {
     gchar *free_data;
     SCM scm_text;
     gchar *str;
+    QOF_TRACE_BEGIN (start);
 
     g_return_val_if_fail (data != NULL, FALSE);
     *data = NULL;
+    report_cancel_requested = FALSE;
 
     str = g_strdup_printf("(gnc:report-run %d)", report_id);
     scm_text = gfec_eval_string(str, error_handler);
     g_free(str);
+    QOF_TRACE_END (start, "gnc_run_report");
 
     if (scm_text == SCM_UNDEFINED || !scm_is_string (scm_text))
         return FALSE;
@@ -170,10 +222,95 @@ gnc_run_report (gint report_id, char ** data)
     return TRUE;
 }
 
+/* The markers html-table.scm puts into tables too long to lay out at
+ * once: after the part to repeat at the top of each page, and between
+ * the pages' rows. */
+#define REPORT_TABLE_HEAD_END "<!--gnc:table-head-end-->"
+#define REPORT_PAGE_BREAK "<!--gnc:page-break-->"
+
+static void
+report_page_links (GString *page, gint report_id, guint n, guint n_pages)
+{
+    g_string_append (page, "<p class=\"gnc-report-pages\">");
+    if (n > 1)
+        g_string_append_printf (page, "<a href=\"gnc-report:id=%d&amp;page=%u\">"
+                                "%s</a> ", report_id, n - 1, _("Previous page"));
+    g_string_append_printf (page, _("Page %u of %u"), n, n_pages);
+    if (n < n_pages)
+        g_string_append_printf (page, " <a href=\"gnc-report:id=%d&amp;page=%u\">"
+                                "%s</a>", report_id, n + 1, _("Next page"));
+    g_string_append (page, "</p>\n");
+}
+
+/* Page n, counting from 1, of the report html, or NULL if it has just
+ * the one page.  Later pages get the document's head and reopen the
+ * table they start in. */
+static gchar *
+report_get_page (const gchar *html, gint report_id, guint n)
+{
+    GPtrArray *breaks = g_ptr_array_new ();
+    const gchar *mark, *start, *end, *body;
+    GString *page;
+    guint n_pages;
+
+    for (mark = strstr (html, REPORT_PAGE_BREAK); mark;
+            mark = strstr (mark + strlen (REPORT_PAGE_BREAK), REPORT_PAGE_BREAK))
+        g_ptr_array_add (breaks, (gpointer) mark);
+    if (breaks->len == 0)
+    {
+        g_ptr_array_free (breaks, TRUE);
+        return NULL;
+    }
+
+    n_pages = breaks->len + 1;
+    n = CLAMP (n, 1, n_pages);
+    start = n == 1 ? html :
+            (const gchar *) g_ptr_array_index (breaks, n - 2) +
+            strlen (REPORT_PAGE_BREAK);
+    end = n == n_pages ? html + strlen (html) :
+          g_ptr_array_index (breaks, n - 1);
+    g_ptr_array_free (breaks, TRUE);
+
+    page = g_string_sized_new (end - start + 1024);
+    body = strstr (html, "<body");
+    if (body)
+        body = strchr (body, '>');
+    if (n > 1)
+    {
+        const gchar *head_end, *table;
+
+        if (body && body < start)
+            g_string_append_len (page, html, body + 1 - html);
+        report_page_links (page, report_id, n, n_pages);
+
+        head_end = g_strrstr_len (html, start - html, REPORT_TABLE_HEAD_END);
+        table = head_end ? g_strrstr_len (html, head_end - html, "<table") : NULL;
+        if (table)
+            g_string_append_len (page, table, head_end - table);
+    }
+
+    g_string_append_len (page, start, end - start);
+
+    if (n < n_pages)
+    {
+        g_string_append (page, "</table>\n");
+        report_page_links (page, report_id, n, n_pages);
+        if (body)
+            g_string_append (page, "</body>\n</html>\n");
+    }
+    else
+        report_page_links (page, report_id, n, n_pages);
+
+    return g_string_free (page, FALSE);
+}
+
 gboolean
 gnc_run_report_id_string (const char * id_string, char **data)
 {
     gint report_id;
+    const char *page_str;
+    guint page = 1;
+    gchar *paged;
 
     g_return_val_if_fail (id_string != NULL, FALSE);
     g_return_val_if_fail (data != NULL, FALSE);
@@ -185,7 +322,21 @@ gnc_run_report_id_string (const char * id_string, char **data)
     if (sscanf (id_string + 3, "%d", &report_id) != 1)
         return FALSE;
 
-    return gnc_run_report (report_id, data);
+    /* "id=N&page=P" asks for a page of a report split into them. */
+    page_str = strstr (id_string, "&page=");
+    if (page_str)
+        sscanf (page_str + 6, "%u", &page);
+
+    if (!gnc_run_report (report_id, data))
+        return FALSE;
+
+    paged = report_get_page (*data, report_id, page);
+    if (paged)
+    {
+        g_free (*data);
+        *data = paged;
+    }
+    return TRUE;
 }
 
 gchar*
@@ -32,6 +32,10 @@
 #define SAVED_REPORTS_FILE_OLD_REV "saved-reports-2.0"
 
 gboolean gnc_run_report (gint report_id, char ** data);
+
+/** Run the report of the "id=N" id_string.  Reports with tables too
+ *  long to lay out in one go come a page at a time: "id=N&page=P" asks
+ *  for page P, and each page links to the ones before and after it. */
 gboolean gnc_run_report_id_string (const char * id_string, char **data);
 
 /**
@@ -49,6 +53,15 @@ gint gnc_report_add(SCM report);
 void gnc_reports_flush_global(void);
 GHashTable *gnc_reports_get_global(void);
 
+/** A count that changes whenever the current book, or anything in it,
+ *  may have changed. */
+guint gnc_report_book_generation (void);
+
+/** Ask the report being run to stop at its next progress update.  The
+ *  request is dropped when the next report starts running. */
+void gnc_report_cancel (void);
+gboolean gnc_report_cancel_requested (void);
+
 gchar* gnc_get_default_report_font_family(void);
 
 gboolean gnc_saved_reports_backup (void);
@@ -125,6 +125,20 @@
     (do-list tree)
     retval))
 
+;; writes a tree of reversed lists of strings, as built by the render
+;; functions, straight to port in document order.  Unlike collapsing the
+;; tree first, this doesn't hold a second copy of every fragment.
+(define (gnc:html-document-tree-write tree port)
+  (define (write-elt elt)
+    (cond ((string? elt) (display elt port))
+          ((list? elt) (for-each write-elt (reverse elt)))
+          (else (display elt port))))
+  (write-elt tree))
+
+(define (gnc:html-document-tree->string tree)
+  (call-with-output-string
+   (lambda (port) (gnc:html-document-tree-write tree port))))
+
 ;; first optional argument is "headers?"
 ;; returns the html document as a string, I think.
 (define (gnc:html-document-render doc . rest) 
@@ -192,7 +206,7 @@
           (gnc:html-document-pop-style doc)
           (gnc:html-style-table-uncompile (gnc:html-document-style doc))
 
-          (string-concatenate (gnc:html-document-tree-collapse retval))))))
+          (gnc:html-document-tree->string retval)))))
 
 
 (define (gnc:html-document-push-style doc style)
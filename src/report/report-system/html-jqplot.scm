@@ -42,3 +42,46 @@
     (set! s1 (regexp-substitute/global #f "&" s1 'pre "&amp;" 'post))
     (set! s1 (regexp-substitute/global #f "<" s1 'pre "&lt;" 'post))
     (regexp-substitute/global #f ">" s1 'pre "&gt;" 'post))
+
+;; Charts of daily data over many years have far more points than the
+;; chart has pixels, and every one of them slows down building the page
+;; and drawing the chart.  The charts draw at most this many points per
+;; series unless their point-budget says otherwise.
+(define jqplot-default-point-budget 1000)
+
+(define (jqplot-decimate points budget y-of)
+  ;; Keep the first and the last of the list points and, of each of
+  ;; (budget - 2) / 2 equal runs of the others, the ones with the
+  ;; smallest and the largest (y-of point), in their order.  Peaks
+  ;; and troughs survive, which evenly spaced sampling would lose.
+  (let ((n (length points)))
+    (if (or (not (number? budget)) (< budget 4) (<= n budget))
+        points
+        (let* ((v (list->vector points))
+               (inner (- n 2))
+               (buckets (quotient (- budget 2) 2))
+               (result (list (vector-ref v 0))))
+          (do ((b 0 (+ b 1)))
+              ((= b buckets))
+            (let ((start (+ 1 (quotient (* b inner) buckets)))
+                  (end (+ 1 (quotient (* (+ b 1) inner) buckets))))
+              (if (< start end)
+                  (let loop ((i (+ start 1))
+                             (lo start) (lo-y (y-of (vector-ref v start)))
+                             (hi start) (hi-y (y-of (vector-ref v start))))
+                    (if (< i end)
+                        (let ((y (y-of (vector-ref v i))))
+                          (loop (+ i 1)
+                                (if (< y lo-y) i lo) (min y lo-y)
+                                (if (> y hi-y) i hi) (max y hi-y)))
+                        (begin
+                          (set! result (cons (vector-ref v (min lo hi)) result))
+                          (if (not (= lo hi))
+                              (set! result
+                                    (cons (vector-ref v (max lo hi))
+                                          result)))))))))
+          (reverse (cons (vector-ref v (- n 1)) result))))))
+
+(define (jqplot-js-array strings)
+  ;; A JavaScript array literal of the already formatted elements.
+  (string-append "[" (string-join strings ",") "]"))
@@ -48,7 +48,8 @@
                       button-1-legend-urls
                       button-2-legend-urls
                       button-3-legend-urls
-                      line-width)))
+                      line-width
+                      point-budget)))
 
 (define gnc:html-linechart?
   (record-predicate <html-linechart>))
@@ -86,6 +87,7 @@
     #f   ;;button-2-legend-urls
     #f   ;;button-3-legend-urls
     1.5  ;;line-width
+    jqplot-default-point-budget ;;point-budget
   )
 )
 
@@ -240,6 +242,13 @@
 (define gnc:html-linechart-set-line-width!
   (record-modifier <html-linechart> 'line-width))
 
+;; The most points drawn of each line, or #f to draw them all.
+(define gnc:html-linechart-point-budget
+  (record-accessor <html-linechart> 'point-budget))
+
+(define gnc:html-linechart-set-point-budget!
+  (record-modifier <html-linechart> 'point-budget))
+
 (define (gnc:html-linechart-append-row! linechart newrow)
   (let ((dd (gnc:html-linechart-data linechart)))
     (set! dd (append dd (list newrow)))
@@ -392,19 +401,19 @@
          (col-colors (catenate-escaped-strings
                       (gnc:html-linechart-col-colors linechart)))
          (line-width (gnc:html-linechart-line-width linechart))
-         (series-data-start (lambda (series-index)
+         (point-budget (gnc:html-linechart-point-budget linechart))
+         ;; Each series is one array literal of [date, y] pairs.
+         (series-data (lambda (series-index points)
                          (push "var d")
                          (push series-index)
-                         (push " = [];\n")))
-         (series-data-add (lambda (series-index date y)
-                         (push (string-append
-                               "  d"
-                               (number->string series-index)
-                               ".push(["
-                               "\"" date "\""
-                               ", "
-                               (number->string y)
-                               "]);\n"))))
+                         (push " = ")
+                         (push (jqplot-js-array
+                                (map (lambda (point)
+                                       (string-append
+                                        "[\"" (car point) "\","
+                                        (number->string (cdr point)) "]"))
+                                     points)))
+                         (push ";\n")))
          (series-data-end (lambda (series-index label)
                          (push "data.push(d")
                          (push series-index)
@@ -439,26 +448,41 @@
             (push "var series = [];\n")
 
             (if (and data (list? data))
-              (let ((rows (length data))
-                    (cols 0))
-                (let loop ((col 0) (rowcnt 0))
-                  (series-data-start col)
-                  (if (list? (car data))
-                      (begin 
-                        (set! cols (length (car data)))))    
-                  (for-each
-                    (lambda (row)
-                      (if (< rowcnt rows)
-                        (series-data-add col
-                          (list-ref (gnc:html-linechart-row-labels linechart) rowcnt)
-                          (ensure-numeric (list-ref-safe row col))
-                        )
-                      )
-                      (set! rowcnt (+ rowcnt 1)))
-                    data)
+              (let* ((cols (if (list? (car data)) (length (car data)) 0))
+                     ;; The rows paired with their dates, walking both
+                     ;; lists together rather than indexing into them.
+                     (rows (let loop ((data data)
+                                      (labels (gnc:html-linechart-row-labels
+                                               linechart))
+                                      (rows '()))
+                             (if (or (null? data) (null? labels))
+                                 (reverse rows)
+                                 (loop (cdr data) (cdr labels)
+                                       (cons (cons (car labels) (car data))
+                                             rows)))))
+                     (row-values (lambda (row)
+                                   (map ensure-numeric
+                                        (if (list? (cdr row)) (cdr row) '()))))
+                     ;; Stacked lines have to keep the same dates, so
+                     ;; those are chosen by the rows' totals instead.
+                     (stacked-rows
+                      (and (gnc:html-linechart-stacked? linechart)
+                           (jqplot-decimate rows point-budget
+                                            (lambda (row)
+                                              (apply + (row-values row)))))))
+                (let loop ((col 0))
+                  (let ((points (map (lambda (row)
+                                       (cons (car row)
+                                             (ensure-numeric
+                                              (list-ref-safe (cdr row) col))))
+                                     (or stacked-rows rows))))
+                    (series-data col (if stacked-rows
+                                         points
+                                         (jqplot-decimate points point-budget
+                                                          cdr))))
                   (series-data-end col (list-ref-safe (gnc:html-linechart-col-labels linechart) col))
                   (if (< col (- cols 1))
-                      (loop (+ 1 col) 0)))))
+                      (loop (+ 1 col))))))
 
 
             (push "var options = {
@@ -44,6 +44,8 @@
                       ;; as returned by gnc:color-option->hex-string, prefixed by
                       ;; #, like "#ff0000" for red
                       markercolor
+                      ;; The most points drawn, or #f to draw them all.
+                      point-budget
                       )))
 
 (define gnc:html-scatter? 
@@ -58,7 +60,8 @@
   (record-constructor <html-scatter>))
 
 (define (gnc:make-html-scatter)
-  (gnc:make-html-scatter-internal -1 -1 #f #f #f #f '() #f #f))
+  (gnc:make-html-scatter-internal -1 -1 #f #f #f #f '() #f #f
+                                  jqplot-default-point-budget))
 
 (define gnc:html-scatter-width
   (record-accessor <html-scatter> 'width))
@@ -90,6 +93,12 @@
 (define gnc:html-scatter-set-x-axis-label!
   (record-modifier <html-scatter> 'x-axis-label))
 
+(define gnc:html-scatter-point-budget
+  (record-accessor <html-scatter> 'point-budget))
+
+(define gnc:html-scatter-set-point-budget!
+  (record-modifier <html-scatter> 'point-budget))
+
 (define gnc:html-scatter-y-axis-label
   (record-accessor <html-scatter> 'y-axis-label))
 
@@ -162,20 +171,22 @@
             (push "px;\"></div>\n")
             (push "<script id=\"source\">\n$(function () {")
 
-            (push "var data = [];")
             (push "var series = [];\n")
 
-            (if (and data (list? data))
-              (let ((x-data (map-in-order car data))
-                    (y-data (map-in-order cadr data)))
-                (for-each (lambda (x y)
-                         (push "  data.push([")
-                         (push (ensure-numeric x))
-                         (push ", ")
-                         (push (ensure-numeric y))
-                         (push "]);\n"))
-                       x-data y-data)
-            ))
+            (push "var data = ")
+            (push (jqplot-js-array
+                   (map (lambda (point)
+                          (string-append
+                           "[" (number->string (car point))
+                           "," (number->string (cdr point)) "]"))
+                        (jqplot-decimate
+                         (map (lambda (x-y)
+                                (cons (ensure-numeric (car x-y))
+                                      (ensure-numeric (cadr x-y))))
+                              data)
+                         (gnc:html-scatter-point-budget scatter)
+                         cdr))))
+            (push ";\n")
 
 
             (push "var options = {
@@ -627,9 +627,19 @@
      t1 (+ (gnc:html-table-num-rows t1)
            (gnc:html-table-num-rows t2)))))
 
+;; Tables with more rows than this are split into pages for the report
+;; viewer, which shows one at a time; laying out a table of a hundred
+;; thousand rows at once can hang it for a minute.  The markers are
+;; comments, so the whole document still displays, exports and prints
+;; as one.  The viewer does the splitting, see gnc-report.c.
+(define gnc:html-table-page-rows 2000)
+(define gnc:html-table-head-end-marker "<!--gnc:table-head-end-->")
+(define gnc:html-table-page-break-marker "<!--gnc:page-break-->")
+
 (define (gnc:html-table-render table doc)
   (let* ((retval '())
-         (push (lambda (l) (set! retval (cons l retval)))))
+         (push (lambda (l) (set! retval (cons l retval))))
+         (paged? (> (gnc:html-table-num-rows table) gnc:html-table-page-rows)))
     
     ;; compile the table style to make other compiles faster 
     (gnc:html-style-table-compile 
@@ -699,6 +709,9 @@
             style (gnc:html-document-style-stack doc)))
        #f)
      #f (gnc:html-table-col-styles table))
+
+    ;; everything up to here is repeated at the top of each page
+    (if paged? (push gnc:html-table-head-end-marker))
     
     ;; now iterate over the rows 
     (let ((rownum 0) (colnum 0))
@@ -708,6 +721,9 @@
                 (gnc:html-table-row-style table rownum))
                (rowmarkup 
                 (gnc:html-table-row-markup table rownum)))
+           (if (and paged? (> rownum 0)
+                    (zero? (remainder rownum gnc:html-table-page-rows)))
+               (push gnc:html-table-page-break-marker))
            ;; set default row markup
            (if (not rowmarkup)
                (set! rowmarkup "tr"))
@@ -144,8 +144,7 @@
            ((string? rendered-elt)
             rendered-elt)
            ((list? rendered-elt)
-            (apply string-append
-                   (gnc:html-document-tree-collapse rendered-elt)))
+            (gnc:html-document-tree->string rendered-elt))
            (#t 
             (format "hold on there podner. form='~s'\n" rendered-elt)
             ""))))
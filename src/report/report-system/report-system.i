@@ -36,6 +36,9 @@ SCM scm_init_sw_report_system_module (void);
 
 SCM gnc_report_find(gint id);
 gint gnc_report_add(SCM report);
+guint gnc_report_book_generation (void);
+void gnc_report_cancel (void);
+gboolean gnc_report_cancel_requested (void);
 
 %newobject gnc_get_default_report_font_family;
 gchar* gnc_get_default_report_font_family();
@@ -277,6 +277,8 @@
 (export gnc:html-document?)
 (export gnc:html-document-set-style!)
 (export gnc:html-document-tree-collapse)
+(export gnc:html-document-tree-write)
+(export gnc:html-document-tree->string)
 (export gnc:html-document-render)
 (export gnc:html-document-push-style)
 (export gnc:html-document-pop-style)
@@ -355,6 +357,8 @@
 (export gnc:html-scatter-set-marker!)
 (export gnc:html-scatter-markercolor)
 (export gnc:html-scatter-set-markercolor!)
+(export gnc:html-scatter-point-budget)
+(export gnc:html-scatter-set-point-budget!)
 (export gnc:html-scatter-add-datapoint!)
 (export gnc:html-scatter-render)
 
@@ -415,6 +419,8 @@
 (export gnc:html-linechart-render linechart)
 (export gnc:html-linechart-set-line-width!)
 (export gnc:html-linechart-line-width)
+(export gnc:html-linechart-point-budget)
+(export gnc:html-linechart-set-point-budget!)
 ;; html-style-info.scm
 
 (export <html-markup-style-info>)
@@ -678,6 +684,7 @@
 (export gnc-commodity-collector-commodity-count)
 (export gnc:account-get-balance-at-date)
 (export gnc:account-get-comm-balance-at-date)
+(export gnc:account-tree-get-balances-at-dates)
 (export gnc:account-get-comm-value-interval)
 (export gnc:account-get-comm-value-at-date)
 (export gnc:accounts-get-balance-helper)
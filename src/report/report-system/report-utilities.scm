@@ -503,6 +503,25 @@
 				       (xaccSplitGetBalance (car splits))))
       balance-collector))
 
+;; Get the balances of all the accounts in the tree of root at each of
+;; the dates, with or without the children.  Like
+;; gnc:account-get-comm-balance-at-date the splits posted at a date are
+;; included.  Returns a hash table from each account's GUID to a vector
+;; of <gnc:numeric> balances, one per date, each in the account's own
+;; commodity.
+(define (gnc:account-tree-get-balances-at-dates root dates include-children?)
+  (let ((matrix (gnc-account-tree-get-balance-matrix
+                 root
+                 (map (lambda (date) (cons (+ (car date) 1) 0)) dates)
+                 '() include-children?))
+        (balances (make-hash-table)))
+    (if matrix
+        (for-each
+         (lambda (row)
+           (hash-set! balances (gncAccountGetGUID (car row)) (cdr row)))
+         (vector->list matrix)))
+    balances))
+
 ;; Calculate the increase in the balance of the account in terms of
 ;; "value" (as opposed to "amount") between the specified dates.
 ;; If include-children? is true, the balances of all children (not
@@ -699,7 +718,10 @@
 (define (gnc:report-percent-done percent)
   (if (> percent 100)
       (gnc:warn "report more than 100% finished. " percent))
-  (gnc-window-show-progress "" percent))
+  (gnc-window-show-progress "" percent)
+  ;; the progress update lets the user ask for the report to stop
+  (if (gnc-report-cancel-requested)
+      (throw 'gnc:report-cancelled)))
 
 (define (gnc:report-finished)
   (gnc-window-show-progress "" -1))
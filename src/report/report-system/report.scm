@@ -706,6 +706,22 @@
     save-ok?))
 
 
+;; The key of the inputs a report's cached html was rendered from, by
+;; report id.  A dirty report whose key still matches gets its cached
+;; html back; only the options, the book and the day are looked at, so
+;; a report with embedded reports has no key and always reruns.
+(define *gnc:_report-ctext-keys_* (make-hash-table 23))
+
+(define (gnc:report-ctext-key report headers?)
+  (let ((options (gnc:report-options report)))
+    (if (and options
+             (null? (or (gnc:report-embedded-list options) '())))
+        (list (gnc:generate-restore-forms options "options")
+              (gnc-report-book-generation)
+              (strftime "%Y-%m-%d" (localtime (current-time)))
+              headers?)
+        #f)))
+
 ;; gets the renderer from the report template;
 ;; gets the stylesheet from the report;
 ;; renders the html doc and caches the resulting string;
@@ -713,12 +729,17 @@
 ;; Now accepts either an html-doc or finished HTML from the renderer -
 ;; the former requires further processing, the latter is just returned.
 (define (gnc:report-render-html report headers?)
-  (if (and (not (gnc:report-dirty? report))
-           (gnc:report-ctext report))
+  (if (and (gnc:report-ctext report)
+           (or (not (gnc:report-dirty? report))
+               (let ((key (gnc:report-ctext-key report headers?)))
+                 (and key
+                      (equal? key (hash-ref *gnc:_report-ctext-keys_*
+                                            (gnc:report-id report)))))))
       ;; if there's clean cached text, return it 
-      ;;(begin
-      (gnc:report-ctext report)
-      ;;  )
+      (begin
+        ;; Don't run the options-changed callback, nothing changed.
+        (gnc:report-set-dirty?-internal! report #f)
+        (gnc:report-ctext report))
       
       ;; otherwise, rerun the report 
       (let ((template (hash-ref *gnc:_report-templates_* 
@@ -736,6 +757,11 @@
                             (set! html (gnc:html-document-render doc headers?))))
                         (gnc:report-set-ctext! report html) ;; cache the html
                         (gnc:report-set-dirty?! report #f)  ;; mark it clean
+                        ;; taken after rendering, which may itself have
+                        ;; caused engine events
+                        (hash-set! *gnc:_report-ctext-keys_*
+                                   (gnc:report-id report)
+                                   (gnc:report-ctext-key report headers?))
                         html)
                       #f))
 	doc))) ;; YUK! inner doc is html-doc object; outer doc is a string.
@@ -753,11 +779,15 @@
     (gnc:backtrace-if-exception 
      (lambda ()
        (if report
-	   (begin 
-	     (set! html (gnc:report-render-html report #t))
-             (set! html (gnc:substring-replace-from-to html "jquery.min.js" "" 2 -1))
-             (set! html (gnc:substring-replace-from-to html "jquery.jqplot.js" "" 2 -1))
-           ))))
+	   ;; a cancelled report leaves nothing cached and stays dirty
+	   (catch 'gnc:report-cancelled
+	     (lambda ()
+	       (set! html (gnc:report-render-html report #t))
+	       (set! html (gnc:substring-replace-from-to html "jquery.min.js" "" 2 -1))
+	       (set! html (gnc:substring-replace-from-to html "jquery.jqplot.js" "" 2 -1)))
+	     (lambda args
+	       (set! html #f)
+	       (gnc:report-finished))))))
     (gnc-unset-busy-cursor '())
     html))
 
@@ -259,25 +259,35 @@
     ;; settings. Uses the collector->double conversion function
     ;; above. Returns a list of doubles.
     (define (process-datelist accounts dates income?)
-      (map
-       (lambda (date)
-         (collector->double
-          ((if inc-exp?
-               (if income?
-                   gnc:accounts-get-comm-total-income
-                   gnc:accounts-get-comm-total-expense)
-               gnc:accounts-get-comm-total-assets)
-           accounts
-           (lambda (account)
-             (if inc-exp?
-                 ;; for inc-exp, 'date' is a pair of time values, else
-                 ;; it is a time value.
-                 (gnc:account-get-comm-balance-interval
-                  account (first date) (second date) #f)
-                 (gnc:account-get-comm-balance-at-date
-                  account date #f))))
-          (if inc-exp? (second date) date)))
-       dates))
+      ;; The balances at all the dates are looked up at once.
+      (let ((balances (if inc-exp? #f
+                          (gnc:account-tree-get-balances-at-dates
+                           (gnc-get-current-root-account) dates #f))))
+        (map
+         (lambda (date index)
+           (collector->double
+            ((if inc-exp?
+                 (if income?
+                     gnc:accounts-get-comm-total-income
+                     gnc:accounts-get-comm-total-expense)
+                 gnc:accounts-get-comm-total-assets)
+             accounts
+             (lambda (account)
+               (if inc-exp?
+                   ;; for inc-exp, 'date' is a pair of time values, else
+                   ;; it is a time value.
+                   (gnc:account-get-comm-balance-interval
+                    account (first date) (second date) #f)
+                   (let ((collector (gnc:make-commodity-collector))
+                         (row (hash-ref balances
+                                        (gncAccountGetGUID account))))
+                     (if row
+                         (collector 'add (xaccAccountGetCommodity account)
+                                    (vector-ref row index)))
+                     collector))))
+            (if inc-exp? (second date) date)))
+         dates
+         (iota (length dates)))))
 
     (gnc:report-percent-done 1)
     (set! commodity-list (gnc:accounts-get-commodities
@@ -0,0 +1,376 @@
+/***************************************************************************
+ *            bench-reports.c
+ *
+ *  Timings of the standard and business reports on a generated book
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+/* bench-reports builds a book of a requested size from a fixed seed,
+ * with a typed account tree, customers' invoices and vendors' bills
+ * posted to A/R and A/P, and hands it to bench-reports.scm.  That
+ * renders each report --repeat times with fixed options and prints one
+ * JSON object per report with the wall time, the time spent in Guile's
+ * collector and the bytes allocated:
+ *
+ *   {"benchmark":"Transaction Report","iterations":3,"seconds":2.51,
+ *    "gc-seconds":0.42,"gc-runs":31,"allocated":401604608,"bytes":911042}
+ *
+ * --save-baseline writes the per-rendering results to a file that a
+ * later run's --baseline compares against; the run then fails if any
+ * report got more than --tolerance percent slower or hungrier.
+ */
+#include "config.h"
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libguile.h>
+#include "qof.h"
+#include "Account.h"
+#include "Transaction.h"
+#include "Split.h"
+#include "gnc-commodity.h"
+#include "gncCustomer.h"
+#include "gncVendor.h"
+#include "gncEntry.h"
+#include "gncInvoice.h"
+#include "gncOwner.h"
+#include "gnc-module.h"
+#include "gnc-ui-util.h"
+#include "test-stuff.h"
+
+static gint num_accounts = 40;
+static gint num_transactions = 20000;
+static gint num_owners = 20;
+static gint num_invoices = 1000;
+static gint repeat = 3;
+static gint seed = 1;
+static gint tolerance = 20;
+static gchar *baseline = NULL;
+static gchar *save_baseline = NULL;
+
+/* As in bench-engine, dates are spread over years ending at a fixed
+ * point so that two runs with the same seed produce identical books. */
+static const time64 bench_end_time = 1420070400; /* 2015-01-01 */
+static const time64 bench_span = 5 * 365 * 24 * 3600;
+
+static GOptionEntry bench_options[] =
+{
+    { "accounts", 'a', 0, G_OPTION_ARG_INT, &num_accounts,
+      "Number of leaf accounts", "N" },
+    { "transactions", 't', 0, G_OPTION_ARG_INT, &num_transactions,
+      "Number of transactions", "N" },
+    { "owners", 'o', 0, G_OPTION_ARG_INT, &num_owners,
+      "Number of customers and of vendors", "N" },
+    { "invoices", 'i', 0, G_OPTION_ARG_INT, &num_invoices,
+      "Number of posted invoices and of posted bills", "N" },
+    { "repeat", 'n', 0, G_OPTION_ARG_INT, &repeat,
+      "Timed renderings of each report", "N" },
+    { "seed", 'r', 0, G_OPTION_ARG_INT, &seed,
+      "Seed for the book generator", "N" },
+    { "baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline,
+      "Compare the results with those saved in FILE", "FILE" },
+    { "save-baseline", 's', 0, G_OPTION_ARG_FILENAME, &save_baseline,
+      "Save the results to FILE", "FILE" },
+    { "tolerance", 'T', 0, G_OPTION_ARG_INT, &tolerance,
+      "Percentage above the baseline that counts as a regression", "PCT" },
+    { NULL }
+};
+
+typedef struct
+{
+    QofBook *book;
+    gnc_commodity *currency;
+    GPtrArray *balance_accounts;
+    GPtrArray *income_accounts;
+    Account *receivable;
+    Account *payable;
+    Account *sales;
+    Account *purchases;
+} BenchBook;
+
+static time64
+bench_random_time (void)
+{
+    return bench_end_time - bench_span + get_random_int_in_range (0, bench_span);
+}
+
+static Account *
+bench_new_account (BenchBook *bb, Account *parent, const char *name,
+                   GNCAccountType type)
+{
+    Account *acc = xaccMallocAccount (bb->book);
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountSetType (acc, type);
+    xaccAccountSetCommodity (acc, bb->currency);
+    gnc_account_append_child (parent, acc);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+static void
+bench_build_accounts (BenchBook *bb)
+{
+    static const GNCAccountType balance_types[] =
+    { ACCT_TYPE_BANK, ACCT_TYPE_CASH, ACCT_TYPE_CREDIT, ACCT_TYPE_ASSET };
+    static const GNCAccountType income_types[] =
+    { ACCT_TYPE_EXPENSE, ACCT_TYPE_EXPENSE, ACCT_TYPE_EXPENSE, ACCT_TYPE_INCOME };
+    Account *root = gnc_book_get_root_account (bb->book);
+    Account *assets, *liabilities, *income, *expenses;
+    gint i;
+
+    assets = bench_new_account (bb, root, "Assets", ACCT_TYPE_ASSET);
+    liabilities = bench_new_account (bb, root, "Liabilities",
+                                     ACCT_TYPE_LIABILITY);
+    income = bench_new_account (bb, root, "Income", ACCT_TYPE_INCOME);
+    expenses = bench_new_account (bb, root, "Expenses", ACCT_TYPE_EXPENSE);
+    bench_new_account (bb, root, "Equity", ACCT_TYPE_EQUITY);
+
+    bb->receivable = bench_new_account (bb, assets, "Accounts Receivable",
+                                        ACCT_TYPE_RECEIVABLE);
+    bb->payable = bench_new_account (bb, liabilities, "Accounts Payable",
+                                     ACCT_TYPE_PAYABLE);
+    bb->sales = bench_new_account (bb, income, "Sales", ACCT_TYPE_INCOME);
+    bb->purchases = bench_new_account (bb, expenses, "Purchases",
+                                       ACCT_TYPE_EXPENSE);
+
+    /* Half the leaves hold balances, half are income and expenses. */
+    bb->balance_accounts = g_ptr_array_new ();
+    bb->income_accounts = g_ptr_array_new ();
+    for (i = 0; i < MAX (num_accounts / 2, 1); i++)
+    {
+        GNCAccountType type = balance_types[i % G_N_ELEMENTS (balance_types)];
+        gchar *name = g_strdup_printf ("Account %d", i);
+        g_ptr_array_add (bb->balance_accounts,
+                         bench_new_account (bb, type == ACCT_TYPE_CREDIT ?
+                                            liabilities : assets, name, type));
+        g_free (name);
+
+        type = income_types[i % G_N_ELEMENTS (income_types)];
+        name = g_strdup_printf ("Category %d", i);
+        g_ptr_array_add (bb->income_accounts,
+                         bench_new_account (bb, type == ACCT_TYPE_INCOME ?
+                                            income : expenses, name, type));
+        g_free (name);
+    }
+}
+
+static void
+bench_build_transactions (BenchBook *bb)
+{
+    static const char *descriptions[] =
+    { "Groceries", "Salary", "Rent", "Fuel", "Transfer", "Dinner", NULL };
+    gint i;
+
+    for (i = 0; i < num_transactions; i++)
+    {
+        Transaction *trans = xaccMallocTransaction (bb->book);
+        Split *from = xaccMallocSplit (bb->book);
+        Split *to = xaccMallocSplit (bb->book);
+        GPtrArray *others = get_random_int_in_range (0, 9) ?
+                            bb->income_accounts : bb->balance_accounts;
+        gnc_numeric value =
+            gnc_numeric_create (get_random_int_in_range (-100000, 100000), 100);
+
+        xaccTransBeginEdit (trans);
+        xaccTransSetCurrency (trans, bb->currency);
+        xaccTransSetDatePostedSecs (trans, bench_random_time ());
+        xaccTransSetDescription (trans,
+                                 get_random_string_in_array (descriptions));
+        xaccSplitSetParent (from, trans);
+        xaccSplitSetAccount (from, g_ptr_array_index (
+                                 bb->balance_accounts,
+                                 get_random_int_in_range (
+                                     0, bb->balance_accounts->len - 1)));
+        xaccSplitSetValue (from, value);
+        xaccSplitSetAmount (from, value);
+        value = gnc_numeric_neg (value);
+        xaccSplitSetParent (to, trans);
+        xaccSplitSetAccount (to, g_ptr_array_index (
+                                 others,
+                                 get_random_int_in_range (0, others->len - 1)));
+        xaccSplitSetValue (to, value);
+        xaccSplitSetAmount (to, value);
+        xaccTransCommitEdit (trans);
+    }
+}
+
+static void
+bench_post_invoice (BenchBook *bb, GncOwner *owner, gboolean bill)
+{
+    GncInvoice *invoice = gncInvoiceCreate (bb->book);
+    GncEntry *entry = gncEntryCreate (bb->book);
+    Timespec opened = { bench_random_time (), 0 };
+    Timespec due = { opened.tv_sec + 30 * 24 * 3600, 0 };
+    GDate date = timespec_to_gdate (opened);
+    gnc_numeric price =
+        gnc_numeric_create (get_random_int_in_range (100, 500000), 100);
+
+    gncInvoiceBeginEdit (invoice);
+    gncInvoiceSetOwner (invoice, owner);
+    gncInvoiceSetCurrency (invoice, bb->currency);
+    gncInvoiceSetDateOpened (invoice, opened);
+
+    gncEntryBeginEdit (entry);
+    gncEntrySetDateGDate (entry, &date);
+    gncEntrySetDescription (entry, "Benchmark entry");
+    gncEntrySetQuantity (entry, gnc_numeric_create (
+                             get_random_int_in_range (1, 10), 1));
+    if (bill)
+    {
+        gncEntrySetBillAccount (entry, bb->purchases);
+        gncEntrySetBillPrice (entry, price);
+        gncBillAddEntry (invoice, entry);
+    }
+    else
+    {
+        gncEntrySetInvAccount (entry, bb->sales);
+        gncEntrySetInvPrice (entry, price);
+        gncInvoiceAddEntry (invoice, entry);
+    }
+    gncEntryCommitEdit (entry);
+    gncInvoiceCommitEdit (invoice);
+
+    gncInvoicePostToAccount (invoice, bill ? bb->payable : bb->receivable,
+                             &opened, &due, "Benchmark", TRUE, FALSE);
+}
+
+static void
+bench_build_business (BenchBook *bb)
+{
+    GPtrArray *customers = g_ptr_array_new ();
+    GPtrArray *vendors = g_ptr_array_new ();
+    gint i;
+
+    for (i = 0; i < MAX (num_owners, 1); i++)
+    {
+        GncCustomer *customer = gncCustomerCreate (bb->book);
+        GncVendor *vendor = gncVendorCreate (bb->book);
+        gchar *name = g_strdup_printf ("Customer %d", i);
+
+        gncCustomerBeginEdit (customer);
+        gncCustomerSetName (customer, name);
+        gncCustomerSetCurrency (customer, bb->currency);
+        gncCustomerCommitEdit (customer);
+        g_ptr_array_add (customers, customer);
+        g_free (name);
+
+        name = g_strdup_printf ("Vendor %d", i);
+        gncVendorBeginEdit (vendor);
+        gncVendorSetName (vendor, name);
+        gncVendorSetCurrency (vendor, bb->currency);
+        gncVendorCommitEdit (vendor);
+        g_ptr_array_add (vendors, vendor);
+        g_free (name);
+    }
+
+    for (i = 0; i < num_invoices; i++)
+    {
+        GncOwner owner;
+        gncOwnerInitCustomer (&owner, g_ptr_array_index (
+                                  customers, i % customers->len));
+        bench_post_invoice (bb, &owner, FALSE);
+        gncOwnerInitVendor (&owner, g_ptr_array_index (
+                                vendors, i % vendors->len));
+        bench_post_invoice (bb, &owner, TRUE);
+    }
+    g_ptr_array_free (customers, TRUE);
+    g_ptr_array_free (vendors, TRUE);
+}
+
+static void
+bench_build_book (BenchBook *bb)
+{
+    gnc_commodity_table *table = gnc_commodity_table_get_table (bb->book);
+
+    bb->currency = gnc_commodity_new (bb->book, "US Dollar", "CURRENCY",
+                                      "USD", "840", 100);
+    bb->currency = gnc_commodity_table_insert (table, bb->currency);
+
+    qof_event_suspend ();
+    bench_build_accounts (bb);
+    bench_build_transactions (bb);
+    bench_build_business (bb);
+    qof_event_resume ();
+}
+
+static void
+guile_main (void *closure, int argc, char **argv)
+{
+    BenchBook bb;
+    SCM run, result;
+
+    gnc_module_system_init ();
+    if (!gnc_module_load ("gnucash/app-utils", 0))
+    {
+        fprintf (stderr, "Can't load gnucash/app-utils\n");
+        exit (1);
+    }
+
+    bb.book = gnc_get_current_book ();
+    bench_build_book (&bb);
+
+    scm_c_eval_string ("(use-modules (gnucash report standard-reports test bench-reports))");
+    run = scm_c_eval_string ("run-report-benchmarks");
+    result = scm_apply (run,
+                        scm_list_n (scm_from_int (repeat),
+                                    scm_from_int64 (bench_end_time - bench_span),
+                                    scm_from_int64 (bench_end_time),
+                                    baseline ? scm_from_locale_string (baseline)
+                                    : SCM_BOOL_F,
+                                    save_baseline ?
+                                    scm_from_locale_string (save_baseline)
+                                    : SCM_BOOL_F,
+                                    scm_from_int (tolerance),
+                                    SCM_UNDEFINED),
+                        SCM_EOL);
+    g_ptr_array_free (bb.balance_accounts, TRUE);
+    g_ptr_array_free (bb.income_accounts, TRUE);
+    exit (scm_is_true (result) ? 0 : 2);
+}
+
+int
+main (int argc, char **argv)
+{
+    GOptionContext *context = g_option_context_new ("- report benchmarks");
+    GError *error = NULL;
+
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    g_option_context_free (context);
+    repeat = MAX (repeat, 1);
+    tolerance = MAX (tolerance, 0);
+
+    qof_init ();
+    qof_log_init_filename_special ("stderr");
+    g_setenv ("GNC_UNINSTALLED", "1", TRUE);
+    srand (seed);
+    printf ("{\"parameters\":{\"accounts\":%d,\"transactions\":%d,"
+            "\"owners\":%d,\"invoices\":%d,\"repeat\":%d,\"seed\":%d}}\n",
+            num_accounts, num_transactions, num_owners, num_invoices,
+            repeat, seed);
+    fflush (stdout);
+
+    scm_boot_guile (argc, argv, guile_main, NULL);
+    return 0;
+}
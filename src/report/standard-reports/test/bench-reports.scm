@@ -0,0 +1,229 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; This program is free software; you can redistribute it and/or
+;; modify it under the terms of the GNU General Public License as
+;; published by the Free Software Foundation; either version 2 of
+;; the License, or (at your option) any later version.
+;;
+;; This program is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+;;
+;; You should have received a copy of the GNU General Public License
+;; along with this program; if not, contact:
+;;
+;; Free Software Foundation           Voice:  +1-617-542-5942
+;; 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652
+;; Boston, MA  02110-1301,  USA       gnu@gnu.org
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+;; The Scheme half of bench-reports: it renders each report in
+;; bench-report-names against the book bench-reports.c built and
+;; prints one JSON object per report, in the form the other bench
+;; programs use:
+;;
+;;   {"benchmark":"Balance Sheet","iterations":3,"seconds":1.234567,
+;;    "gc-seconds":0.210000,"gc-runs":12,"allocated":104857600,
+;;    "bytes":48213}
+;;
+;; "allocated" is null where Guile's gc-stats don't count bytes.
+;; Timings only mean something on the machine that took them, so the
+;; baseline is an s-expression written on that machine with
+;; --save-baseline; with --baseline each result is compared to it and
+;; a report that takes longer or allocates more than the tolerance
+;; allows is marked "regression":true.
+
+(define-module (gnucash report standard-reports test bench-reports))
+
+(use-modules (ice-9 format))
+(use-modules (srfi srfi-1))
+
+(use-modules (gnucash gnc-module))
+(gnc:module-load "gnucash/report/report-system" 0)
+(gnc:module-load "gnucash/report/standard-reports" 0)
+
+(use-modules (gnucash engine))
+(use-modules (sw_engine))
+(use-modules (gnucash app-utils))
+(use-modules (gnucash report report-system))
+(use-modules (gnucash report business-reports))
+
+(export bench-report-names)
+(export run-report-benchmarks)
+
+(define bench-report-names
+  (list "Account Summary"
+        "Balance Sheet"
+        "Income Statement"
+        "Trial Balance"
+        "Cash Flow"
+        "General Journal"
+        "Transaction Report"
+        "Income Over Time"
+        "Net Worth Linechart"
+        "Receivable Aging"
+        "Payable Aging"
+        "Customer Summary"))
+
+(define (bench-find-template name)
+  (let ((found #f))
+    (gnc:report-templates-for-each
+     (lambda (id template)
+       (if (equal? name (gnc:report-template-name template))
+           (set! found id))))
+    found))
+
+;; Every date option gets a fixed date rather than one relative to
+;; today, and every account list all the book's accounts, so that the
+;; reports see the whole generated book on every run.
+(define (bench-set-options report start end)
+  (let ((accounts (gnc-account-get-descendants-sorted
+                   (gnc-get-current-root-account))))
+    (gnc:options-for-each
+     (lambda (option)
+       (case (gnc:option-type option)
+         ((date)
+          (gnc:option-set-value
+           option
+           (cons 'absolute
+                 (cons (if (member (gnc:option-name option)
+                                   '("Start Date" "From"))
+                           start end)
+                       0))))
+         ((account-list)
+          (gnc:option-set-value option accounts))))
+     (gnc:report-options report))))
+
+(define (bench-render report)
+  (gnc:report-set-ctext! report #f)
+  (gnc:report-set-dirty?! report #t)
+  (gnc:report-render-html report #t))
+
+(define (bench-gc-stat stats key)
+  (assq-ref stats key))
+
+(define (bench-seconds ticks)
+  (exact->inexact (/ ticks internal-time-units-per-second)))
+
+;; Render report once to settle anything computed on first use, then
+;; time repeat more renderings.
+(define (bench-measure report repeat)
+  (bench-render report)
+  (let* ((before (gc-stats))
+         (start (get-internal-real-time))
+         (html (let loop ((i 1) (html (bench-render report)))
+                 (if (< i repeat)
+                     (loop (+ i 1) (bench-render report))
+                     html)))
+         (end (get-internal-real-time))
+         (after (gc-stats))
+         (delta (lambda (key)
+                  (let ((a (bench-gc-stat after key))
+                        (b (bench-gc-stat before key)))
+                    (and a b (- a b))))))
+    (list (cons 'iterations repeat)
+          (cons 'seconds (bench-seconds (- end start)))
+          (cons 'gc-seconds (bench-seconds (or (delta 'gc-time-taken) 0)))
+          (cons 'gc-runs (delta 'gc-times))
+          (cons 'allocated (delta 'heap-total-allocated))
+          (cons 'bytes (if (string? html) (string-length html) 0)))))
+
+(define (bench-json-value value)
+  (cond ((eq? value #t) "true")
+        ((not value) "null")
+        ((string? value) (format #f "~s" value))
+        ((and (exact? value) (integer? value)) (number->string value))
+        ((symbol? value) (symbol->string value))
+        (else (format #f "~,6f" (exact->inexact value)))))
+
+(define (bench-print name fields)
+  (display
+   (string-append
+    "{\"benchmark\":" (bench-json-value name)
+    (apply string-append
+           (map (lambda (field)
+                  (string-append ",\"" (symbol->string (car field)) "\":"
+                                 (bench-json-value (cdr field))))
+                fields))
+    "}\n"))
+  (force-output))
+
+;; A baseline entry holds the seconds and bytes allocated per
+;; rendering, so that runs with different --repeat compare.
+(define (bench-per-rendering result key)
+  (let ((value (assq-ref result key)))
+    (and value (exact->inexact (/ value (assq-ref result 'iterations))))))
+
+(define (bench-baseline-entry name result)
+  (list name
+        (cons 'seconds (bench-per-rendering result 'seconds))
+        (cons 'allocated (bench-per-rendering result 'allocated))))
+
+(define (bench-worse? now then tolerance)
+  (and now then (> then 0)
+       (> now (* then (+ 1 (/ tolerance 100))))))
+
+(define (bench-compare result entry tolerance)
+  (let ((seconds (bench-per-rendering result 'seconds))
+        (allocated (bench-per-rendering result 'allocated))
+        (base-seconds (assq-ref (cdr entry) 'seconds))
+        (base-allocated (assq-ref (cdr entry) 'allocated)))
+    (list (cons 'baseline-seconds base-seconds)
+          (cons 'baseline-allocated base-allocated)
+          (cons 'regression
+                (if (or (bench-worse? seconds base-seconds tolerance)
+                        (bench-worse? allocated base-allocated tolerance))
+                    'true 'false)))))
+
+(define (bench-read-baseline file)
+  (if (and file (access? file R_OK))
+      (call-with-input-file file read)
+      '()))
+
+(define (bench-write-baseline file entries)
+  (call-with-output-file file
+    (lambda (port)
+      (display ";; bench-reports baseline: seconds and bytes allocated per rendering\n" port)
+      (write entries port)
+      (newline port))))
+
+;; Run every benchmark; report dates run from start to end.  Returns
+;; #t unless a report regressed against baseline-file.
+(define (run-report-benchmarks repeat start end baseline-file save-file
+                               tolerance)
+  (let ((baseline (bench-read-baseline baseline-file))
+        (regressions 0)
+        (entries '()))
+    (for-each
+     (lambda (name)
+       (let ((template-id (bench-find-template name)))
+         (if (not template-id)
+             (bench-print name (list (cons 'skipped #t)
+                                     (cons 'reason "no such report")))
+             (let* ((report (gnc-report-find (gnc:make-report template-id)))
+                    (result (catch #t
+                              (lambda ()
+                                (bench-set-options report start end)
+                                (bench-measure report repeat))
+                              (lambda args #f)))
+                    (entry (assoc name baseline)))
+               (if (not result)
+                   (bench-print name (list (cons 'skipped #t)
+                                           (cons 'reason "render failed")))
+                   (let ((comparison (if entry
+                                         (bench-compare result entry tolerance)
+                                         '())))
+                     (if (eq? (assq-ref comparison 'regression) 'true)
+                         (set! regressions (+ regressions 1)))
+                     (set! entries
+                           (cons (bench-baseline-entry name result) entries))
+                     (bench-print name (append result comparison))))))))
+     bench-report-names)
+    (if save-file
+        (bench-write-baseline save-file (reverse entries)))
+    (if (not (null? baseline))
+        (begin
+          (format #t "{\"regressions\":~a,\"tolerance\":~a}\n"
+                  regressions tolerance)
+          (force-output)))
+    (= regressions 0)))
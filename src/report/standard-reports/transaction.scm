@@ -1485,6 +1485,7 @@ Credit Card, and Income accounts.")))))
 	    (gnc:query-set-match-voids-only! query (gnc-get-current-book)))
 	   (else #f))
 
+          (xaccQueryLoadPendingSplits query)
           (set! splits (qof-query-run query))
 
           ;;(gnc:warn "Splits in trep-renderer:" splits)
@@ -113,6 +113,11 @@
 (define gnc:*finance-quote-helper*
   (string-append (gnc-path-get-bindir) "/gnc-fq-helper"))
 
+;; The most gnc-fq-helper processes to run at once, and the most
+;; symbols to send any one of them in a request.
+(define gnc:*finance-quote-helper-count* 4)
+(define gnc:*finance-quote-chunk-size* 50)
+
 (define (gnc:fq-get-quotes requests)
   ;; requests should be a list where each item is of the form
   ;;
@@ -151,50 +156,141 @@
   ;; was unparsable.  See the gnc-fq-helper for more details
   ;; about it's output.
 
-  (let ((quoter '())
-        (to-child #f)
-        (from-child #f))
-
-    (define (start-quoter)
+  ;; Requests for many symbols are split into chunks of at most
+  ;; gnc:*finance-quote-chunk-size* symbols, and the chunks are shared
+  ;; out among up to gnc:*finance-quote-helper-count* helpers that run
+  ;; side by side.  Each helper is sent its next chunk as soon as it
+  ;; has answered the last one.  The results of a request's chunks are
+  ;; put back together, so the output is the same as if each request
+  ;; had gone to a single helper.
+
+  (define (split-request request)
+    (let ((size gnc:*finance-quote-chunk-size*))
+      (if (equal? (car request) "currency")
+          (list request)
+          (let loop ((syms (cdr request))
+                     (chunks '()))
+            (if (<= (length syms) size)
+                (reverse (cons (cons (car request) syms) chunks))
+                (loop (list-tail syms size)
+                      (cons (cons (car request) (list-head syms size))
+                            chunks)))))))
+
+  (define (join-results chunks results)
+    ;; An error symbol from any chunk is the result of the whole
+    ;; request, as it would have been from one helper.  A chunk that
+    ;; failed outright stands for a failed quote for each of its symbols.
+    (if (null? (cdr results))
+        (car results)
+        (or (find (lambda (result) (and result (not (list? result))))
+                  results)
+            (append-map (lambda (chunk result)
+                          (if (list? result)
+                              result
+                              (make-list (length (cdr chunk)) #f)))
+                        chunks results))))
+
+  (let* ((chunk-lists (map split-request requests))
+         (chunks (list->vector (apply append chunk-lists)))
+         (results (make-vector (vector-length chunks) #f))
+         (quoters '()))
+
+    (define (start-quoters)
       (if (not (string-null? gnc:*finance-quote-helper*))
-          (set! quoter (gnc-spawn-process-async
-                        (list "perl" "-w" gnc:*finance-quote-helper*) #t))))
+          (do ((i 0 (+ i 1)))
+              ((>= i (min gnc:*finance-quote-helper-count*
+                          (vector-length chunks))))
+            (let ((quoter (gnc-spawn-process-async
+                           (list "perl" "-w" gnc:*finance-quote-helper*) #t)))
+              (if (not (null? quoter))
+                  (set! quoters
+                        (cons (list quoter
+                                    (fdes->outport (gnc-process-get-fd quoter 0))
+                                    (fdes->inport (gnc-process-get-fd quoter 1)))
+                              quoters)))))))
+
+    (define (send-chunk to-child index)
+      (let ((request (vector-ref chunks index)))
+        (catch
+         #t
+         (lambda ()
+           (gnc:debug "handling-request: " request)
+           ;; we need to display the first element (the method, so it
+           ;; won't be quoted) and then write the rest
+           (display #\( to-child)
+           (display (car request) to-child)
+           (display " " to-child)
+           (for-each (lambda (x) (write x to-child)) (cdr request))
+           (display #\) to-child)
+           (newline to-child)
+           (force-output to-child)
+           #t)
+         (lambda (key . args)
+           (vector-set! results index key)
+           #f))))
+
+    (define (read-result from-child index)
+      (catch
+       #t
+       (lambda ()
+         (let ((result (read from-child)))
+           (gnc:debug "results: " result)
+           (vector-set! results index result)))
+       (lambda (key . args)
+         (vector-set! results index key))))
 
     (define (get-quotes)
-      (if (not (null? quoter))
-          (let ((results #f))
-            (set! to-child (fdes->outport (gnc-process-get-fd quoter 0)))
-            (set! from-child (fdes->inport (gnc-process-get-fd quoter 1)))
-            (map
-             (lambda (request)
-               (catch
-                #t
-                (lambda ()
-                  (gnc:debug "handling-request: " request)
-                  ;; we need to display the first element (the method, so it
-                  ;; won't be quoted) and then write the rest
-                  (display #\( to-child)
-                  (display (car request) to-child)
-                  (display " " to-child)
-                  (for-each (lambda (x) (write x to-child)) (cdr request))
-                  (display #\) to-child)
-                  (newline to-child)
-                  (force-output to-child)
-                  (set! results (read from-child))
-                  (gnc:debug "results: " results)
-                  results)
-                (lambda (key . args)
-                  key)))
-             requests))))
-
-    (define (kill-quoter)
-      (if (not (null? quoter))
-          (gnc-detach-process quoter #t)))
+      (if (not (null? quoters))
+          (let ((pending (make-vector (length quoters) #f))
+                (next 0))
+
+            ;; Give the chunk numbered next to quoter q, if there is one.
+            (define (give-next! q)
+              (vector-set! pending q #f)
+              (let loop ()
+                (if (< next (vector-length chunks))
+                    (let ((index next))
+                      (set! next (+ next 1))
+                      (if (send-chunk (cadr (list-ref quoters q)) index)
+                          (vector-set! pending q index)
+                          (loop))))))
+
+            (do ((q 0 (+ q 1))) ((>= q (length quoters)))
+              (give-next! q))
+            (let loop ()
+              (if (any identity (vector->list pending))
+                  (begin
+                    (do ((q 0 (+ q 1))) ((>= q (length quoters)))
+                      (let ((index (vector-ref pending q)))
+                        (if index
+                            (begin
+                              (read-result (caddr (list-ref quoters q)) index)
+                              (give-next! q)))))
+                    (loop))))
+
+            (let loop ((chunk-lists chunk-lists)
+                       (index 0)
+                       (joined '()))
+              (if (null? chunk-lists)
+                  (reverse joined)
+                  (let ((n (length (car chunk-lists))))
+                    (loop (cdr chunk-lists)
+                          (+ index n)
+                          (cons (join-results
+                                 (car chunk-lists)
+                                 (map (lambda (i) (vector-ref results i))
+                                      (iota n index)))
+                                joined))))))
+          #f))
+
+    (define (kill-quoters)
+      (for-each (lambda (quoter) (gnc-detach-process (car quoter) #t))
+                quoters))
 
     (dynamic-wind
-        start-quoter
+        start-quoters
         get-quotes
-        kill-quoter)))
+        kill-quoters)))
 
 (define (gnc:book-add-quotes window book)
 
@@ -452,7 +548,9 @@
       ))
 
   (define (book-add-prices! book prices)
+    ;; Queue the prices and sort them in all at once.
     (let ((pricedb (gnc-pricedb-get-db book)))
+      (gnc-pricedb-set-bulk-update pricedb #t)
       (for-each
        (lambda (price)
          (if price
@@ -460,7 +558,8 @@
                (gnc-pricedb-add-price pricedb price)
                (gnc-price-unref price)
                #f)))
-       prices)))
+       prices)
+      (gnc-pricedb-set-bulk-update pricedb #f)))
 
   ;; FIXME: uses of gnc:warn in here need to be cleaned up.  Right
   ;; now, they'll result in funny formatting.